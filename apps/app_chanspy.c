@@ -951,6 +951,9 @@ static int common_exec(struct ast_channel *chan, struct ast_flags *flags,
 			}
 		} else if (!ast_strlen_zero(exten)) {
 			iter = ast_channel_iterator_by_exten_new(exten, context);
+		} else if (mygroup && !ast_test_flag(flags, OPTION_DAHDI_SCAN)) {
+			/* Only the channels in one of our groups can be spied on */
+			iter = ast_channel_iterator_by_spygroup_new(mygroup);
 		} else {
 			iter = ast_channel_iterator_all_new();
 		}
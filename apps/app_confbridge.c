@@ -332,6 +332,49 @@
 		<description>
 		</description>
 	</manager>
+	<manager name="ConfbridgeLink" language="en_US">
+		<synopsis>
+			Link a Confbridge conference to the same conference on another node.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Conference" required="true" />
+			<parameter name="Destination" required="true">
+				<para>The address and port to send the mix of this node to, such as
+				<literal>10.0.0.2:10000</literal>.</para>
+			</parameter>
+			<parameter name="Codec" required="false">
+				<para>The format the two nodes exchange their mixes in. Defaults to
+				<literal>slin16</literal>.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Adds a UnicastRTP channel to the conference that sends the mix of the
+			participants on this node to <replaceable>Destination</replaceable> and plays
+			what it receives from there to them, but not back out on the link.  The
+			response holds the <literal>Channel</literal> of the link and the
+			<literal>LocalAddress</literal> and <literal>LocalPort</literal> it receives
+			on.</para>
+			<para>The link sends its media back to wherever the media it receives comes
+			from, so two nodes are linked by calling this action on the second node with
+			any port of the first, then on the first node with the
+			<literal>LocalPort</literal> the second one returned.</para>
+		</description>
+	</manager>
+	<manager name="ConfbridgeUnlink" language="en_US">
+		<synopsis>
+			Remove links of a Confbridge conference to other nodes.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Conference" required="true" />
+			<parameter name="Channel" required="false">
+				<para>The link channel to remove. All links are removed if omitted.</para>
+			</parameter>
+		</syntax>
+		<description>
+		</description>
+	</manager>
 	<manager name="ConfbridgeSetSingleVideoSrc" language="en_US">
 		<synopsis>
 			Set a conference user as the single video source distributed to all other participants.
@@ -760,6 +803,119 @@ static int conf_start_record(struct confbridge_conference *conference)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Link the conference to the same conference on another node
+ *
+ * \param conference The conference bridge to link
+ * \param destination Address and port of the link on the other node
+ * \param codec Format to exchange the mixes in, slin16 if empty
+ *
+ * The link is a UnicastRTP channel in the bridge like any other participant,
+ * so it sends the other node the mix of the local participants only, and the
+ * mix it brings back is heard by everyone here but is never sent back out on
+ * it.  The channel is symmetric, so the other node may link to any port on
+ * this host and learns the right one from the media sent to it.
+ *
+ * \note Must be called with the conference locked
+ *
+ * \return The link channel, with a reference, or NULL on failure
+ */
+static struct ast_channel *conf_add_link(struct confbridge_conference *conference,
+	const char *destination, const char *codec)
+{
+	struct ast_channel *chan;
+	struct ast_format_cap *cap;
+	struct ast_bridge_features *features;
+	char *data;
+
+	features = ast_bridge_features_new();
+	if (!features) {
+		return NULL;
+	}
+	ast_set_flag(&features->feature_flags, AST_BRIDGE_CHANNEL_FLAG_IMMOVABLE);
+
+	cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!cap) {
+		ast_bridge_features_destroy(features);
+		return NULL;
+	}
+	ast_format_cap_append(cap, ast_format_slin16, 0);
+
+	if (ast_asprintf(&data, "%s/c(%s)s", destination, S_OR(codec, "slin16")) < 0) {
+		ao2_ref(cap, -1);
+		ast_bridge_features_destroy(features);
+		return NULL;
+	}
+
+	/* Create the link channel. */
+	chan = ast_request("UnicastRTP", cap, NULL, NULL, data, NULL);
+	ao2_ref(cap, -1);
+	if (!chan) {
+		ast_free(data);
+		ast_bridge_features_destroy(features);
+		return NULL;
+	}
+	ast_free(data);
+	if (ast_call(chan, destination, 0)) {
+		ast_hangup(chan);
+		ast_bridge_features_destroy(features);
+		return NULL;
+	}
+
+	/* Put the channel into the conference bridge. */
+	if (AST_VECTOR_APPEND(&conference->links, ast_channel_ref(chan))) {
+		ast_channel_unref(chan);
+		ast_hangup(chan);
+		ast_bridge_features_destroy(features);
+		return NULL;
+	}
+	if (ast_bridge_impart(conference->bridge, chan, NULL, features,
+		AST_BRIDGE_IMPART_CHAN_INDEPENDENT)) {
+		ast_channel_unref(AST_VECTOR_REMOVE_UNORDERED(&conference->links,
+			AST_VECTOR_SIZE(&conference->links) - 1));
+		ast_hangup(chan);
+		return NULL;
+	}
+
+	ast_debug(1, "Conference '%s' linked to '%s' on %s\n", conference->name, destination,
+		ast_channel_name(chan));
+
+	return ast_channel_ref(chan);
+}
+
+/*!
+ * \internal
+ * \brief Remove links of the conference to other nodes
+ *
+ * \param conference The conference bridge
+ * \param name Name of the link channel to remove, NULL for all of them
+ *
+ * \note Must be called with the conference locked
+ *
+ * \return The number of links removed
+ */
+static int conf_remove_links(struct confbridge_conference *conference, const char *name)
+{
+	struct ast_frame f = { AST_FRAME_CONTROL, .subclass.integer = AST_CONTROL_HANGUP };
+	int removed = 0;
+	int i;
+
+	for (i = AST_VECTOR_SIZE(&conference->links) - 1; i >= 0; i--) {
+		struct ast_channel *chan = AST_VECTOR_GET(&conference->links, i);
+
+		if (name && strcasecmp(ast_channel_name(chan), name)) {
+			continue;
+		}
+		AST_VECTOR_REMOVE_UNORDERED(&conference->links, i);
+		ast_queue_frame(chan, &f);
+		ast_channel_unref(chan);
+		removed++;
+	}
+
+	return removed;
+}
+
 /* \brief Playback the given filename and monitor for any dtmf interrupts.
  *
  * This function is used to playback sound files on a given channel and optionally
@@ -1053,6 +1209,8 @@ static void destroy_conference_bridge(void *obj)
 	}
 
 	ast_channel_cleanup(conference->record_chan);
+	AST_VECTOR_CALLBACK_VOID(&conference->links, ast_channel_unref);
+	AST_VECTOR_FREE(&conference->links);
 	ast_free(conference->orig_rec_file);
 	ast_free(conference->record_filename);
 
@@ -1334,6 +1492,7 @@ void conf_ended(struct confbridge_conference *conference)
 	}
 	ao2_lock(conference);
 	conf_stop_record(conference);
+	conf_remove_links(conference, NULL);
 	ao2_unlock(conference);
 }
 
@@ -1475,6 +1634,10 @@ static struct confbridge_conference *join_conference_bridge(const char *conferen
 		ast_bridge_set_internal_sample_rate(conference->bridge, conference->b_profile.internal_sample_rate);
 		/* Set the internal mixing interval on the bridge from the bridge profile */
 		ast_bridge_set_mixing_interval(conference->bridge, conference->b_profile.mix_interval);
+		/* Set the number of extra mixing threads on the bridge from the bridge profile */
+		ast_bridge_set_mixing_threads(conference->bridge, conference->b_profile.mixing_threads);
+		/* Set the number of loudest talkers mixed on the bridge from the bridge profile */
+		ast_bridge_set_max_talkers(conference->bridge, conference->b_profile.max_talkers);
 
 		if (ast_test_flag(&conference->b_profile, BRIDGE_OPT_VIDEO_SRC_FOLLOW_TALKER)) {
 			ast_bridge_set_talker_src_video_mode(conference->bridge);
@@ -3645,6 +3808,98 @@ static int action_confbridgestartrecord(struct mansession *s, const struct messa
 	astman_send_ack(s, m, "Conference Recording Started.");
 	return 0;
 }
+static int action_confbridgelink(struct mansession *s, const struct message *m)
+{
+	const char *conference_name = astman_get_header(m, "Conference");
+	const char *destination = astman_get_header(m, "Destination");
+	const char *codec = astman_get_header(m, "Codec");
+	const char *id = astman_get_header(m, "ActionID");
+	struct confbridge_conference *conference;
+	struct ast_channel *chan;
+
+	if (ast_strlen_zero(conference_name)) {
+		astman_send_error(s, m, "No Conference name provided.");
+		return 0;
+	}
+	if (ast_strlen_zero(destination)) {
+		astman_send_error(s, m, "No Destination provided.");
+		return 0;
+	}
+	if (!ao2_container_count(conference_bridges)) {
+		astman_send_error(s, m, "No active conferences.");
+		return 0;
+	}
+
+	conference = ao2_find(conference_bridges, conference_name, OBJ_KEY);
+	if (!conference) {
+		astman_send_error(s, m, "No Conference by that name found.");
+		return 0;
+	}
+
+	ao2_lock(conference);
+	chan = conf_add_link(conference, destination, codec);
+	ao2_unlock(conference);
+	ao2_ref(conference, -1);
+
+	if (!chan) {
+		astman_send_error(s, m, "Internal error linking conference.");
+		return 0;
+	}
+
+	ast_channel_lock(chan);
+	astman_append(s, "Response: Success\r\n");
+	if (!ast_strlen_zero(id)) {
+		astman_append(s, "ActionID: %s\r\n", id);
+	}
+	astman_append(s,
+		"Message: Conference linked\r\n"
+		"Channel: %s\r\n"
+		"LocalAddress: %s\r\n"
+		"LocalPort: %s\r\n"
+		"\r\n",
+		ast_channel_name(chan),
+		S_OR(pbx_builtin_getvar_helper(chan, "UNICASTRTP_LOCAL_ADDRESS"), ""),
+		S_OR(pbx_builtin_getvar_helper(chan, "UNICASTRTP_LOCAL_PORT"), ""));
+	ast_channel_unlock(chan);
+	ast_channel_unref(chan);
+	return 0;
+}
+
+static int action_confbridgeunlink(struct mansession *s, const struct message *m)
+{
+	const char *conference_name = astman_get_header(m, "Conference");
+	const char *channel = astman_get_header(m, "Channel");
+	struct confbridge_conference *conference;
+	int removed;
+
+	if (ast_strlen_zero(conference_name)) {
+		astman_send_error(s, m, "No Conference name provided.");
+		return 0;
+	}
+	if (!ao2_container_count(conference_bridges)) {
+		astman_send_error(s, m, "No active conferences.");
+		return 0;
+	}
+
+	conference = ao2_find(conference_bridges, conference_name, OBJ_KEY);
+	if (!conference) {
+		astman_send_error(s, m, "No Conference by that name found.");
+		return 0;
+	}
+
+	ao2_lock(conference);
+	removed = conf_remove_links(conference, S_OR(channel, NULL));
+	ao2_unlock(conference);
+	ao2_ref(conference, -1);
+
+	if (!removed) {
+		astman_send_error(s, m, "No link by that name found in Conference.");
+		return 0;
+	}
+	astman_send_ack(s, m, "Conference unlinked");
+	return 0;
+}
+
 static int action_confbridgestoprecord(struct mansession *s, const struct message *m)
 {
 	const char *conference_name = astman_get_header(m, "Conference");
@@ -3894,6 +4149,8 @@ static int unload_module(void)
 	ast_manager_unregister("ConfbridgeLock");
 	ast_manager_unregister("ConfbridgeStartRecord");
 	ast_manager_unregister("ConfbridgeStopRecord");
+	ast_manager_unregister("ConfbridgeLink");
+	ast_manager_unregister("ConfbridgeUnlink");
 	ast_manager_unregister("ConfbridgeSetSingleVideoSrc");
 
 	/* Unsubscribe from stasis confbridge message type and clean it up. */
@@ -3963,6 +4220,8 @@ static int load_module(void)
 	res |= ast_manager_register_xml("ConfbridgeLock", EVENT_FLAG_CALL, action_confbridgelock);
 	res |= ast_manager_register_xml("ConfbridgeStartRecord", EVENT_FLAG_SYSTEM, action_confbridgestartrecord);
 	res |= ast_manager_register_xml("ConfbridgeStopRecord", EVENT_FLAG_SYSTEM, action_confbridgestoprecord);
+	res |= ast_manager_register_xml("ConfbridgeLink", EVENT_FLAG_SYSTEM, action_confbridgelink);
+	res |= ast_manager_register_xml("ConfbridgeUnlink", EVENT_FLAG_SYSTEM, action_confbridgeunlink);
 	res |= ast_manager_register_xml("ConfbridgeSetSingleVideoSrc", EVENT_FLAG_CALL, action_confbridgesetsinglevideosrc);
 	if (res) {
 		unload_module();
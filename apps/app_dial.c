@@ -837,6 +837,115 @@ static void hanguptree(struct dial_head *out_chans, struct ast_channel *exceptio
 	}
 }
 
+/*!
+ * \internal
+ * \brief Request the destinations of a Dial() to several of them at the same time
+ *
+ * \param chan Calling channel
+ * \param peers The destinations, separated by '&'
+ * \param requests Set to the requests made, NULL when none were
+ *
+ * \note The destinations up to the first malformed one are requested.
+ *
+ * \return Number of requests made
+ */
+static size_t request_destinations(struct ast_channel *chan, const char *peers, struct ast_channel_request **requests)
+{
+	char *rest = ast_strdupa(peers);
+	char *cur;
+	struct ast_channel_request *reqs;
+	struct ast_format_cap *nativeformats;
+	size_t count = 0;
+	size_t size = 1;
+
+	*requests = NULL;
+
+	for (cur = rest; (cur = strchr(cur, '&')); cur++) {
+		size++;
+	}
+	if (size < 2 || !(reqs = ast_calloc(size, sizeof(*reqs)))) {
+		return 0;
+	}
+
+	while ((cur = strsep(&rest, "&"))) {
+		char *number = cur;
+		char *tech = strsep(&number, "/");
+
+		if (ast_strlen_zero(number)) {
+			break;
+		}
+		reqs[count].type = tech;
+		reqs[count].addr = number;
+		count++;
+	}
+	if (count < 2) {
+		ast_free(reqs);
+		return 0;
+	}
+
+	ast_channel_lock(chan);
+	nativeformats = ao2_bump(ast_channel_nativeformats(chan));
+	ast_channel_unlock(chan);
+
+	for (size = 0; size < count; size++) {
+		reqs[size].request_cap = nativeformats;
+	}
+	ast_request_multiple(reqs, count, chan);
+
+	ao2_cleanup(nativeformats);
+
+	*requests = reqs;
+	return count;
+}
+
+/*!
+ * \internal
+ * \brief Hang up the channels requested by request_destinations() not taken and free them
+ */
+static void requests_free(struct ast_channel_request *requests, size_t count)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		if (requests[i].chan) {
+			ast_hangup(requests[i].chan);
+		}
+	}
+	ast_free(requests);
+}
+
+/*!
+ * \internal
+ * \brief Place the calls to several destinations of a Dial() at the same time
+ *
+ * \param out_chans The destinations
+ *
+ * \return The calls placed, in the order of \a out_chans, NULL when none were
+ */
+static struct ast_channel_call *call_destinations(struct dial_head *out_chans)
+{
+	struct chanlist *outgoing;
+	struct ast_channel_call *calls;
+	size_t count = 0;
+
+	AST_LIST_TRAVERSE(out_chans, outgoing, node) {
+		count++;
+	}
+	if (count < 2 || !(calls = ast_calloc(count, sizeof(*calls)))) {
+		return NULL;
+	}
+
+	count = 0;
+	AST_LIST_TRAVERSE(out_chans, outgoing, node) {
+		calls[count].chan = outgoing->chan;
+		calls[count].addr = outgoing->number;
+		count++;
+	}
+	ast_call_multiple(calls, count);
+
+	return calls;
+}
+
 #define AST_MAX_WATCHERS 256
 
 /*
@@ -2198,6 +2307,10 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 	struct ast_flags64 opts = { 0, };
 	char *opt_args[OPT_ARG_ARRAY_SIZE];
 	int fulldial = 0, num_dialed = 0;
+	struct ast_channel_request *requests = NULL;
+	size_t num_requested = 0;
+	struct ast_channel_call *calls;
+	size_t num_called = 0;
 	int ignore_cc = 0;
 	char device_name[AST_CHANNEL_NAME];
 	char forced_clid_name[AST_MAX_EXTENSION];
@@ -2454,6 +2567,9 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		ast_app_exec_sub(NULL, chan, opt_args[OPT_ARG_PREDIAL_CALLER], 0);
 	}
 
+	/* Request several destinations at the same time rather than waiting on each in turn */
+	num_requested = request_destinations(chan, args.peers, &requests);
+
 	/* loop through the list of dial destinations */
 	rest = args.peers;
 	while ((cur = strsep(&rest, "&")) ) {
@@ -2519,7 +2635,14 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 
 		ast_channel_unlock(chan);
 
-		tc = ast_request(tmp->tech, nativeformats, NULL, chan, tmp->number, &cause);
+		if (num_dialed <= num_requested) {
+			/* Already requested along with the other destinations */
+			tc = requests[num_dialed - 1].chan;
+			cause = requests[num_dialed - 1].cause;
+			requests[num_dialed - 1].chan = NULL;
+		} else {
+			tc = ast_request(tmp->tech, nativeformats, NULL, chan, tmp->number, &cause);
+		}
 
 		ao2_cleanup(nativeformats);
 
@@ -2666,6 +2789,11 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		AST_LIST_INSERT_TAIL(&out_chans, tmp, node);
 	}
 
+	if (requests) {
+		requests_free(requests, num_requested);
+		requests = NULL;
+	}
+
 	/*
 	 * PREDIAL: Run gosub on all of the callee channels
 	 *
@@ -2695,9 +2823,14 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		}
 	}
 
-	/* Start all outgoing calls */
+	/* Start all outgoing calls, several of them at the same time */
+	calls = call_destinations(&out_chans);
 	AST_LIST_TRAVERSE_SAFE_BEGIN(&out_chans, tmp, node) {
-		res = ast_call(tmp->chan, tmp->number, 0); /* Place the call, but don't wait on the answer */
+		if (calls) {
+			res = calls[num_called++].res;
+		} else {
+			res = ast_call(tmp->chan, tmp->number, 0); /* Place the call, but don't wait on the answer */
+		}
 		ast_channel_lock(chan);
 
 		/* check the results of ast_call */
@@ -2729,6 +2862,7 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		}
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
+	ast_free(calls);
 
 	if (ast_strlen_zero(args.timeout)) {
 		to = -1;
@@ -3205,6 +3339,10 @@ static int dial_exec_full(struct ast_channel *chan, const char *data, struct ast
 		}
 	}
 out:
+	if (requests) {
+		requests_free(requests, num_requested);
+	}
+
 	if (moh) {
 		moh = 0;
 		ast_moh_stop(chan);
@@ -617,6 +617,207 @@ static void mixmonitor_save_prep(struct mixmonitor *mixmonitor, char *filename,
 	}
 }
 
+/*! \brief Number of reads from the audiohook that may wait for the disk before any are dropped (30 seconds at 8kHz) */
+#define WRITE_QUEUE_MAX 1500
+
+/*! \brief Frames read from the audiohook at once, waiting to be written to the recording */
+struct mixmonitor_frames {
+	struct ast_frame *fr;
+	struct ast_frame *fr_read;
+	struct ast_frame *fr_write;
+	AST_LIST_ENTRY(mixmonitor_frames) list;
+};
+
+/*!
+ * \brief Write-behind state of a recording
+ *
+ * The recording thread hands the frames it reads to a writer thread, so a
+ * slow or stalled disk holds up the writer instead of the reads from the
+ * audiohook.
+ */
+struct mixmonitor_writer {
+	struct mixmonitor *mixmonitor;
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	AST_LIST_HEAD_NOLOCK(, mixmonitor_frames) queue;
+	/*! Number of entries in queue */
+	int queued;
+	/*! Number of entries dropped because the queue was full */
+	int dropped;
+	/*! Set when no more frames will be queued */
+	int done;
+	pthread_t thread;
+};
+
+static void mixmonitor_frames_free(struct mixmonitor_frames *frames)
+{
+	if (frames->fr) {
+		ast_frame_free(frames->fr, 0);
+	}
+	if (frames->fr_read) {
+		ast_frame_free(frames->fr_read, 0);
+	}
+	if (frames->fr_write) {
+		ast_frame_free(frames->fr_write, 0);
+	}
+	ast_free(frames);
+}
+
+static void mixmonitor_write_frames(struct ast_filestream *fs, struct ast_frame *fr)
+{
+	struct ast_frame *cur;
+
+	if (!fs || !fr) {
+		return;
+	}
+
+	for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		ast_writestream(fs, cur);
+	}
+}
+
+/*!
+ * \internal
+ * \pre mixmonitor_ds must be locked before calling this function
+ */
+static void mixmonitor_ds_write(struct mixmonitor_ds *mixmonitor_ds, struct mixmonitor_frames *frames)
+{
+	mixmonitor_write_frames(mixmonitor_ds->fs_read, frames->fr_read);
+	mixmonitor_write_frames(mixmonitor_ds->fs_write, frames->fr_write);
+	mixmonitor_write_frames(mixmonitor_ds->fs, frames->fr);
+}
+
+static void *mixmonitor_writer_thread(void *obj)
+{
+	struct mixmonitor_writer *writer = obj;
+	struct mixmonitor_ds *mixmonitor_ds = writer->mixmonitor->mixmonitor_ds;
+	struct mixmonitor_frames *frames;
+	AST_LIST_HEAD_NOLOCK(, mixmonitor_frames) batch;
+	int done;
+
+	if (writer->mixmonitor->callid) {
+		ast_callid_threadassoc_add(writer->mixmonitor->callid);
+	}
+
+	do {
+		ast_mutex_lock(&writer->lock);
+		while (AST_LIST_EMPTY(&writer->queue) && !writer->done) {
+			ast_cond_wait(&writer->cond, &writer->lock);
+		}
+		batch.first = AST_LIST_FIRST(&writer->queue);
+		batch.last = AST_LIST_LAST(&writer->queue);
+		AST_LIST_HEAD_INIT_NOLOCK(&writer->queue);
+		writer->queued = 0;
+		done = writer->done;
+		ast_mutex_unlock(&writer->lock);
+
+		/* Everything that queued up while the disk was busy goes out together */
+		ast_mutex_lock(&mixmonitor_ds->lock);
+		AST_LIST_TRAVERSE(&batch, frames, list) {
+			mixmonitor_ds_write(mixmonitor_ds, frames);
+		}
+		ast_mutex_unlock(&mixmonitor_ds->lock);
+
+		while ((frames = AST_LIST_REMOVE_HEAD(&batch, list))) {
+			mixmonitor_frames_free(frames);
+		}
+	} while (!done);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Hand frames read from the audiohook to the writer
+ *
+ * \note Takes ownership of the frames, which are freed if they are dropped.
+ */
+static void mixmonitor_writer_queue(struct mixmonitor_writer *writer, struct ast_frame *fr,
+	struct ast_frame *fr_read, struct ast_frame *fr_write)
+{
+	struct mixmonitor_frames *frames;
+
+	if (!(frames = ast_calloc(1, sizeof(*frames)))) {
+		ast_frame_free(fr, 0);
+		if (fr_read) {
+			ast_frame_free(fr_read, 0);
+		}
+		if (fr_write) {
+			ast_frame_free(fr_write, 0);
+		}
+		return;
+	}
+	frames->fr = fr;
+	frames->fr_read = fr_read;
+	frames->fr_write = fr_write;
+
+	if (writer->thread == AST_PTHREADT_NULL) {
+		/* No writer thread, so write it here as we always used to */
+		ast_mutex_lock(&writer->mixmonitor->mixmonitor_ds->lock);
+		mixmonitor_ds_write(writer->mixmonitor->mixmonitor_ds, frames);
+		ast_mutex_unlock(&writer->mixmonitor->mixmonitor_ds->lock);
+		mixmonitor_frames_free(frames);
+		return;
+	}
+
+	ast_mutex_lock(&writer->lock);
+	if (writer->queued >= WRITE_QUEUE_MAX) {
+		if (!writer->dropped++) {
+			ast_log(LOG_WARNING, "MixMonitor %s cannot write to disk fast enough, dropping audio\n",
+				writer->mixmonitor->name);
+		}
+		ast_mutex_unlock(&writer->lock);
+		mixmonitor_frames_free(frames);
+		return;
+	}
+	AST_LIST_INSERT_TAIL(&writer->queue, frames, list);
+	writer->queued++;
+	ast_cond_signal(&writer->cond);
+	ast_mutex_unlock(&writer->lock);
+}
+
+static void mixmonitor_writer_start(struct mixmonitor_writer *writer, struct mixmonitor *mixmonitor)
+{
+	writer->mixmonitor = mixmonitor;
+	ast_mutex_init(&writer->lock);
+	ast_cond_init(&writer->cond, NULL);
+	AST_LIST_HEAD_INIT_NOLOCK(&writer->queue);
+	writer->queued = 0;
+	writer->dropped = 0;
+	writer->done = 0;
+
+	if (ast_pthread_create(&writer->thread, NULL, mixmonitor_writer_thread, writer)) {
+		ast_log(LOG_WARNING, "Unable to start the writer for MixMonitor %s, writing as it records\n",
+			mixmonitor->name);
+		writer->thread = AST_PTHREADT_NULL;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Write out everything still queued and stop the writer
+ */
+static void mixmonitor_writer_stop(struct mixmonitor_writer *writer)
+{
+	if (writer->thread != AST_PTHREADT_NULL) {
+		ast_mutex_lock(&writer->lock);
+		writer->done = 1;
+		ast_cond_signal(&writer->cond);
+		ast_mutex_unlock(&writer->lock);
+
+		pthread_join(writer->thread, NULL);
+		writer->thread = AST_PTHREADT_NULL;
+	}
+
+	if (writer->dropped) {
+		ast_log(LOG_WARNING, "MixMonitor %s dropped %d frames that could not be written in time\n",
+			writer->mixmonitor->name, writer->dropped);
+	}
+
+	ast_mutex_destroy(&writer->lock);
+	ast_cond_destroy(&writer->cond);
+}
+
 static void *mixmonitor_thread(void *obj)
 {
 	struct mixmonitor *mixmonitor = obj;
@@ -631,6 +832,7 @@ static void *mixmonitor_thread(void *obj)
 	unsigned int oflags;
 	int errflag = 0;
 	struct ast_format *format_slin;
+	struct mixmonitor_writer writer;
 
 	/* Keep callid association before any log messages */
 	if (mixmonitor->callid) {
@@ -652,6 +854,8 @@ static void *mixmonitor_thread(void *obj)
 
 	ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
 
+	mixmonitor_writer_start(&writer, mixmonitor);
+
 	/* The audiohook must enter and exit the loop locked */
 	ast_audiohook_lock(&mixmonitor->audiohook);
 	while (mixmonitor->audiohook.status == AST_AUDIOHOOK_STATUS_RUNNING && !mixmonitor->mixmonitor_ds->fs_quit) {
@@ -676,43 +880,17 @@ static void *mixmonitor_thread(void *obj)
 		if (!ast_test_flag(mixmonitor, MUXFLAG_BRIDGED)
 			|| (mixmonitor->autochan->chan
 				&& ast_channel_is_bridged(mixmonitor->autochan->chan))) {
-			ast_mutex_lock(&mixmonitor->mixmonitor_ds->lock);
-
-			/* Write out the frame(s) */
-			if ((*fs_read) && (fr_read)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_read; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_read, cur);
-				}
+			/* The writer owns the frame(s) from here on */
+			mixmonitor_writer_queue(&writer, fr, fr_read, fr_write);
+		} else {
+			/* All done! free it. */
+			ast_frame_free(fr, 0);
+			if (fr_read) {
+				ast_frame_free(fr_read, 0);
 			}
-
-			if ((*fs_write) && (fr_write)) {
-				struct ast_frame *cur;
-
-				for (cur = fr_write; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs_write, cur);
-				}
+			if (fr_write) {
+				ast_frame_free(fr_write, 0);
 			}
-
-			if ((*fs) && (fr)) {
-				struct ast_frame *cur;
-
-				for (cur = fr; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					ast_writestream(*fs, cur);
-				}
-			}
-			ast_mutex_unlock(&mixmonitor->mixmonitor_ds->lock);
-		}
-		/* All done! free it. */
-		if (fr) {
-			ast_frame_free(fr, 0);
-		}
-		if (fr_read) {
-			ast_frame_free(fr_read, 0);
-		}
-		if (fr_write) {
-			ast_frame_free(fr_write, 0);
 		}
 
 		fr = NULL;
@@ -724,6 +902,8 @@ static void *mixmonitor_thread(void *obj)
 
 	ast_audiohook_unlock(&mixmonitor->audiohook);
 
+	mixmonitor_writer_stop(&writer);
+
 	ast_autochan_channel_lock(mixmonitor->autochan);
 	if (ast_test_flag(mixmonitor, MUXFLAG_BEEP_STOP)) {
 		ast_stream_and_wait(mixmonitor->autochan->chan, "beep", "");
@@ -977,6 +977,21 @@
 		<description>
 		</description>
 	</manager>
+	<manager name="QueueRealtimeRefresh" language="en_US">
+		<synopsis>
+			Refresh realtime queues from the database.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Queue">
+				<para>The name of the queue to refresh. If no queue name is specified, then all queues in memory are refreshed.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Loads the queue parameters and realtime members again right away, instead of
+			waiting for the next <literal>realtime_refresh</literal> interval.</para>
+		</description>
+	</manager>
 	<manager name="QueueReset" language="en_US">
 		<synopsis>
 			Reset queue statistics.
@@ -1436,6 +1451,15 @@ static int negative_penalty_invalid = 0;
 /*! \brief queues.conf [general] option */
 static int log_membername_as_agent = 0;
 
+/*! \brief queues.conf [general] option, seconds realtime queues are served from memory */
+static int realtime_refresh = 0;
+
+/*! \brief The thread refreshing realtime queues in the background */
+static pthread_t realtime_refresh_thread = AST_PTHREADT_NULL;
+static ast_mutex_t realtime_refresh_lock;
+static ast_cond_t realtime_refresh_cond;
+static int realtime_refresh_stop;
+
 /*! \brief name of the ringinuse field in the realtime database */
 static char *realtime_ringinuse_field;
 
@@ -1688,6 +1712,7 @@ struct call_queue {
 	int rrpos;                          /*!< Round Robin - position */
 	int memberdelay;                    /*!< Seconds to delay connecting member to caller */
 	int autofill;                       /*!< Ignore the head call status and ring an available agent */
+	time_t rt_refreshed;                /*!< When the queue and its realtime members were last loaded */
 
 	struct ao2_container *members;      /*!< Head of the list of members */
 	struct queue_ent *head;             /*!< Head of the list of callers */
@@ -2354,6 +2379,108 @@ static void pending_members_remove(struct member *mem)
 	ao2_find(pending_members, mem, OBJ_POINTER | OBJ_NODATA | OBJ_UNLINK);
 }
 
+/*!
+ * \brief A device and a queue with members following its state
+ *
+ * Lets device_state_cb() visit only the queues a device is in.  An entry
+ * is added whenever a member is linked into a queue or changes its
+ * state_interface, with the queue locked.  It is removed once
+ * device_state_cb() finds no member of the queue following the device, so
+ * the index may briefly name queues a device is no longer in but never
+ * misses one it is in.
+ */
+struct member_device {
+	/*! Name of the queue, stored after the device */
+	const char *queue;
+	char device[0];
+};
+
+static struct ao2_container *member_devices;
+#define MAX_MEMBER_DEVICE_BUCKETS 1021
+
+static int member_devices_hash(const void *obj, const int flags)
+{
+	const struct member_device *object;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		object = obj;
+		key = object->device;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_case_hash(key);
+}
+
+static int member_devices_cmp(void *obj, void *arg, int flags)
+{
+	const struct member_device *object_left = obj;
+	const struct member_device *object_right = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		return !strcasecmp(object_left->device, object_right->device)
+			&& !strcasecmp(object_left->queue, object_right->queue) ? CMP_MATCH : 0;
+	case OBJ_SEARCH_KEY:
+		return !strcasecmp(object_left->device, arg) ? CMP_MATCH : 0;
+	default:
+		return 0;
+	}
+}
+
+/*! \brief Copy the device whose state changes reach a member through device_state_cb() */
+static void member_state_device(const struct member *mem, char *device, size_t size)
+{
+	char *slash_pos;
+
+	ast_copy_string(device, mem->state_interface, size);
+	if ((slash_pos = strchr(device, '/'))) {
+		if (!strncasecmp(device, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
+			*slash_pos = '\0';
+		}
+	}
+}
+
+/*!
+ * \brief Index the device of a member linked into a queue
+ * \note The queue should be locked or not yet linked into queues.
+ */
+static void member_devices_add(struct call_queue *q, struct member *mem)
+{
+	struct member_device *md;
+	struct member_device *found;
+	char device[80];
+	size_t device_len;
+
+	member_state_device(mem, device, sizeof(device));
+	device_len = strlen(device) + 1;
+
+	md = ao2_alloc_options(sizeof(*md) + device_len + strlen(q->name) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!md) {
+		return;
+	}
+	strcpy(md->device, device); /* Safe */
+	md->queue = md->device + device_len;
+	strcpy((char *) md->queue, q->name); /* Safe */
+
+	ao2_lock(member_devices);
+	found = ao2_find(member_devices, md, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+	if (found) {
+		ao2_ref(found, -1);
+	} else {
+		ao2_link_flags(member_devices, md, OBJ_NOLOCK);
+	}
+	ao2_unlock(member_devices);
+	ao2_ref(md, -1);
+}
+
 /*! \brief set a member's status based on device state of that member's state_interface.
  *
  * Lock interface list find sc, iterate through each queues queue_member list for member to
@@ -2420,11 +2547,13 @@ static int is_member_available(struct call_queue *q, struct member *mem)
 /*! \brief set a member's status based on device state of that member's interface*/
 static void device_state_cb(void *unused, struct stasis_subscription *sub, struct stasis_message *msg)
 {
-	struct ao2_iterator miter, qiter;
+	struct ao2_iterator miter;
+	struct ao2_iterator *qiter;
 	struct ast_device_state_message *dev_state;
+	struct member_device *md;
 	struct member *m;
 	struct call_queue *q;
-	char interface[80], *slash_pos;
+	char interface[80];
 	int found = 0;			/* Found this member in any queue */
 	int found_member;		/* Found this member in this queue */
 	int avail = 0;			/* Found an available member in this queue */
@@ -2439,8 +2568,17 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	qiter = ao2_iterator_init(queues, 0);
-	while ((q = ao2_t_iterator_next(&qiter, "Iterate over queues"))) {
+	/* Only visit the queues the device is in */
+	qiter = ao2_find(member_devices, dev_state->device, OBJ_SEARCH_KEY | OBJ_MULTIPLE);
+	while (qiter && (md = ao2_iterator_next(qiter))) {
+		struct call_queue tmpq = {
+			.name = md->queue,
+		};
+
+		if (!(q = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Find queue of device"))) {
+			ao2_ref(md, -1);
+			continue;
+		}
 		ao2_lock(q);
 
 		avail = 0;
@@ -2448,13 +2586,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		miter = ao2_iterator_init(q->members, 0);
 		for (; (m = ao2_iterator_next(&miter)); ao2_ref(m, -1)) {
 			if (!found_member) {
-				ast_copy_string(interface, m->state_interface, sizeof(interface));
-
-				if ((slash_pos = strchr(interface, '/'))) {
-					if (!strncasecmp(interface, "Local/", 6) && (slash_pos = strchr(slash_pos + 1, '/'))) {
-						*slash_pos = '\0';
-					}
-				}
+				member_state_device(m, interface, sizeof(interface));
 
 				if (!strcasecmp(interface, dev_state->device)) {
 					found_member = 1;
@@ -2480,14 +2612,20 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 			} else {
 				ast_devstate_changed(AST_DEVICE_INUSE, AST_DEVSTATE_CACHABLE, "Queue:%s_avail", q->name);
 			}
+		} else {
+			/* No member follows the device anymore */
+			ao2_unlink(member_devices, md);
 		}
 
 		ao2_iterator_destroy(&miter);
 
 		ao2_unlock(q);
-		queue_t_unref(q, "Done with iterator");
+		queue_t_unref(q, "Done with device queue");
+		ao2_ref(md, -1);
+	}
+	if (qiter) {
+		ao2_iterator_destroy(qiter);
 	}
-	ao2_iterator_destroy(&qiter);
 
 	if (found) {
 		ast_debug(1, "Device '%s' changed to state '%u' (%s)\n",
@@ -3219,6 +3357,7 @@ static void queue_set_param(struct call_queue *q, const char *param, const char
  */
 static void member_add_to_queue(struct call_queue *queue, struct member *mem)
 {
+	member_devices_add(queue, mem);
 	ao2_lock(queue->members);
 	mem->queuepos = ao2_container_count(queue->members);
 	ao2_link(queue->members, mem);
@@ -3309,6 +3448,7 @@ static void rt_handle_member_record(struct call_queue *q, char *interface, struc
 			}
 			if (strcasecmp(state_interface, m->state_interface)) {
 				ast_copy_string(m->state_interface, state_interface, sizeof(m->state_interface));
+				member_devices_add(q, m);
 			}
 			m->penalty = penalty;
 			m->ringinuse = ringinuse;
@@ -3530,6 +3670,17 @@ static struct call_queue *find_queue_by_name_rt(const char *queuename, struct as
 /*!
  * note  */
 
+/*!
+ * \internal
+ * \brief Whether a queue was loaded from realtime recently enough to be used as is.
+ */
+static int realtime_queue_fresh(struct call_queue *q)
+{
+	int interval = realtime_refresh;
+
+	return interval && q->rt_refreshed && time(NULL) - q->rt_refreshed < interval;
+}
+
 /*!
  * \internal
  * \brief Returns reference to the named queue. If the queue is realtime, it will load the queue as well.
@@ -3550,6 +3701,11 @@ static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 	/* Find the queue in the in-core list first. */
 	q = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Look for queue in memory first");
 
+	if (q && realtime_queue_fresh(q)) {
+		/* The refresh thread keeps it current, no need to ask the DB */
+		return q;
+	}
+
 	if (!q || q->realtime) {
 		/*! \note Load from realtime before taking the "queues" container lock, to avoid blocking all
 		   queue operations while waiting for the DB.
@@ -3579,6 +3735,7 @@ static struct call_queue *find_load_queue_rt_friendly(const char *queuename)
 
 		/* update the use_weight value if the queue's has gained or lost a weight */
 		if (q) {
+			q->rt_refreshed = time(NULL);
 			if (!q->weight && prev_weight) {
 				ast_atomic_fetchadd_int(&use_weight, -1);
 			}
@@ -3616,6 +3773,11 @@ static void update_realtime_members(struct call_queue *q)
 	char *interface = NULL;
 	struct ao2_iterator mem_iter;
 
+	if (realtime_queue_fresh(q)) {
+		return;
+	}
+	q->rt_refreshed = time(NULL);
+
 	if (!(member_config = ast_load_realtime_multientry("queue_members", "interface LIKE", "%", "queue_name", q->name , SENTINEL))) {
 		/* This queue doesn't have realtime members. If the queue still has any realtime
 		 * members in memory, they need to be removed.
@@ -8910,6 +9072,17 @@ static void queue_set_global_params(struct ast_config *cfg)
 	if ((general_val = ast_variable_retrieve(cfg, "general", "log_membername_as_agent"))) {
 		log_membername_as_agent = ast_true(general_val);
 	}
+	realtime_refresh = 0;
+	if ((general_val = ast_variable_retrieve(cfg, "general", "realtime_refresh"))) {
+		if (sscanf(general_val, "%30d", &realtime_refresh) != 1 || realtime_refresh < 0) {
+			ast_log(LOG_WARNING, "Invalid realtime_refresh '%s', realtime queues will not be cached\n", general_val);
+			realtime_refresh = 0;
+		}
+	}
+	/* Pick up the new interval */
+	ast_mutex_lock(&realtime_refresh_lock);
+	ast_cond_signal(&realtime_refresh_cond);
+	ast_mutex_unlock(&realtime_refresh_lock);
 }
 
 /*! \brief reload information pertaining to a single member
@@ -8995,6 +9168,7 @@ static void reload_single_member(const char *memberdata, struct call_queue *q)
 	if ((newm = create_queue_member(interface, membername, penalty, cur ? cur->paused : 0, state_interface, ringinuse))) {
 		if (cur) {
 			/* Round Robin Queue Position must be copied if this is replacing an existing member */
+			member_devices_add(q, newm);
 			ao2_lock(q->members);
 			newm->queuepos = cur->queuepos;
 			ao2_link(q->members, newm);
@@ -10053,6 +10227,96 @@ static int manager_queue_reload(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Load a queue and its members from realtime again, whether or not they are still fresh.
+ *
+ * \retval 0 if the queue still exists
+ * \retval -1 if it does not
+ */
+static int realtime_queue_refresh(const char *queuename)
+{
+	struct call_queue *q;
+	struct call_queue tmpq = {
+		.name = queuename,
+	};
+
+	if ((q = ao2_t_find(queues, &tmpq, OBJ_POINTER, "Expire queue for refresh"))) {
+		q->rt_refreshed = 0;
+		queue_t_unref(q, "Expired queue for refresh");
+	}
+	if (!(q = find_load_queue_rt_friendly(queuename))) {
+		return -1;
+	}
+	queue_t_unref(q, "Refreshed queue");
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Refresh every queue in memory that has anything in realtime.
+ */
+static void realtime_queues_refresh(void)
+{
+	struct call_queue *q;
+	struct ao2_iterator queue_iter;
+
+	if (!ast_check_realtime("queues") && !ast_check_realtime("queue_members")) {
+		return;
+	}
+
+	queue_iter = ao2_iterator_init(queues, 0);
+	while ((q = ao2_t_iterator_next(&queue_iter, "Iterate through queues"))) {
+		realtime_queue_refresh(q->name);
+		queue_t_unref(q, "Done with iterator");
+	}
+	ao2_iterator_destroy(&queue_iter);
+}
+
+/*!
+ * \internal
+ * \brief Keep realtime queues current so joining callers are served from memory.
+ */
+static void *realtime_refresh_run(void *data)
+{
+	ast_mutex_lock(&realtime_refresh_lock);
+	while (!realtime_refresh_stop) {
+		int interval = realtime_refresh;
+		struct timespec ts = { 0, };
+
+		if (!interval) {
+			ast_cond_wait(&realtime_refresh_cond, &realtime_refresh_lock);
+			continue;
+		}
+		ts.tv_sec = time(NULL) + interval;
+		if (ast_cond_timedwait(&realtime_refresh_cond, &realtime_refresh_lock, &ts) != ETIMEDOUT) {
+			/* Woken up to stop or for a new interval */
+			continue;
+		}
+
+		ast_mutex_unlock(&realtime_refresh_lock);
+		realtime_queues_refresh();
+		ast_mutex_lock(&realtime_refresh_lock);
+	}
+	ast_mutex_unlock(&realtime_refresh_lock);
+
+	return NULL;
+}
+
+static int manager_queue_realtime_refresh(struct mansession *s, const struct message *m)
+{
+	const char *queuename = astman_get_header(m, "Queue");
+
+	if (ast_strlen_zero(queuename)) {
+		realtime_queues_refresh();
+	} else if (realtime_queue_refresh(queuename)) {
+		astman_send_error(s, m, "No such queue");
+		return 0;
+	}
+	astman_send_ack(s, m, "Queue refreshed successfully");
+	return 0;
+}
+
 static int manager_queue_reset(struct mansession *s, const struct message *m)
 {
 	const char *queuename = NULL;
@@ -11021,6 +11285,7 @@ static int unload_module(void)
 	ast_manager_unregister("QueuePenalty");
 	ast_manager_unregister("QueueReload");
 	ast_manager_unregister("QueueReset");
+	ast_manager_unregister("QueueRealtimeRefresh");
 	ast_manager_unregister("QueueMemberRingInUse");
 	ast_unregister_application(app_aqm);
 	ast_unregister_application(app_rqm);
@@ -11043,9 +11308,21 @@ static int unload_module(void)
 
 	ast_extension_state_del(0, extension_state_cb);
 
+	if (realtime_refresh_thread != AST_PTHREADT_NULL) {
+		ast_mutex_lock(&realtime_refresh_lock);
+		realtime_refresh_stop = 1;
+		ast_cond_signal(&realtime_refresh_cond);
+		ast_mutex_unlock(&realtime_refresh_lock);
+		pthread_join(realtime_refresh_thread, NULL);
+		realtime_refresh_thread = AST_PTHREADT_NULL;
+	}
+	ast_mutex_destroy(&realtime_refresh_lock);
+	ast_cond_destroy(&realtime_refresh_cond);
+
 	ast_unload_realtime("queue_members");
 	ao2_cleanup(queues);
 	ao2_cleanup(pending_members);
+	ao2_cleanup(member_devices);
 
 	queues = NULL;
 	return 0;
@@ -11069,8 +11346,14 @@ static int load_module(void)
 	struct stasis_topic *queue_topic;
 	struct stasis_topic *manager_topic;
 
+	ast_mutex_init(&realtime_refresh_lock);
+	ast_cond_init(&realtime_refresh_cond, NULL);
+	realtime_refresh_stop = 0;
+
 	queues = ao2_container_alloc(MAX_QUEUE_BUCKETS, queue_hash_cb, queue_cmp_cb);
 	if (!queues) {
+		ast_mutex_destroy(&realtime_refresh_lock);
+		ast_cond_destroy(&realtime_refresh_cond);
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -11081,6 +11364,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	member_devices = ao2_container_alloc(
+		MAX_MEMBER_DEVICE_BUCKETS, member_devices_hash, member_devices_cmp);
+	if (!member_devices) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	use_weight = 0;
 
 	if (reload_handler(0, &mask, NULL)) {
@@ -11138,6 +11428,7 @@ static int load_module(void)
 	err |= ast_manager_register_xml("QueueRule", 0, manager_queue_rule_show);
 	err |= ast_manager_register_xml("QueueReload", 0, manager_queue_reload);
 	err |= ast_manager_register_xml("QueueReset", 0, manager_queue_reset);
+	err |= ast_manager_register_xml("QueueRealtimeRefresh", 0, manager_queue_realtime_refresh);
 	err |= ast_custom_function_register(&queuevar_function);
 	err |= ast_custom_function_register(&queueexists_function);
 	err |= ast_custom_function_register(&queuemembercount_function);
@@ -11147,6 +11438,12 @@ static int load_module(void)
 	err |= ast_custom_function_register(&queuewaitingcount_function);
 	err |= ast_custom_function_register(&queuememberpenalty_function);
 
+	if (ast_pthread_create(&realtime_refresh_thread, NULL, realtime_refresh_run, NULL)) {
+		ast_log(LOG_ERROR, "Unable to start the realtime queue refresh thread\n");
+		realtime_refresh_thread = AST_PTHREADT_NULL;
+		err = -1;
+	}
+
 	/* in the following subscribe call, do I use DEVICE_STATE, or DEVICE_STATE_CHANGE? */
 	device_state_sub = stasis_subscribe(ast_device_state_topic_all(), device_state_cb, NULL);
 	if (!device_state_sub) {
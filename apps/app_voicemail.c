@@ -110,6 +110,10 @@
 #if defined(__FreeBSD__) || defined(__OpenBSD__)
 #include <sys/wait.h>
 #endif
+#ifdef HAVE_INOTIFY
+#include <sys/inotify.h>
+#include "asterisk/poll-compat.h"
+#endif
 
 #include "asterisk/logger.h"
 #include "asterisk/lock.h"
@@ -1212,6 +1216,145 @@ static int inprocess_count(const char *context, const char *mailbox, int delta)
 
 #if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
 static int __has_voicemail(const char *context, const char *mailbox, const char *folder, int shortcircuit);
+
+/*!
+ * \brief The message count of a mailbox folder.
+ *
+ * Counting the messages of a folder means reading its directory.  The count
+ * is kept for as long as the directory is not modified, so MWI polls,
+ * VMCOUNT() and logins only read a directory again once a message was
+ * deposited, deleted or moved, by Asterisk or by anything else.
+ */
+struct msgcount {
+	/*! Messages in the folder */
+	int count;
+	/*! Device, inode and modification time of the directory when counted */
+	dev_t dev;
+	ino_t ino;
+	time_t mtime;
+	/*! Path of the folder directory */
+	char path[0];
+};
+
+/*! \brief Message counts of the folders counted, by path */
+static struct ao2_container *msgcount_cache;
+
+/*! \brief Non-zero to cache message counts, the msgcountcache option */
+static int msgcount_cache_enabled = 1;
+
+#ifdef HAVE_INOTIFY
+/*! \brief inotify(7) descriptor watching the counted folders while polling, guarded by the cache lock */
+static int msgcount_inotify_fd = -1;
+#endif
+
+AO2_STRING_FIELD_HASH_FN(msgcount, path)
+AO2_STRING_FIELD_CMP_FN(msgcount, path)
+
+/*!
+ * \internal
+ * \brief Forget the message count of the folder a message file is in.
+ *
+ * \param file Path of a message file, or of the folder followed by a slash.
+ */
+static void msgcount_invalidate(const char *file)
+{
+	char *dir = ast_strdupa(file);
+	char *slash = strrchr(dir, '/');
+
+	if (!msgcount_cache || !slash) {
+		return;
+	}
+	*slash = '\0';
+	ao2_find(msgcount_cache, dir, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+}
+
+/*!
+ * \internal
+ * \brief Count the messages in a folder, or get the count kept since it was last modified.
+ *
+ * \return The number of messages, 0 if the folder does not exist.
+ */
+static int msgcount_get(const char *dir)
+{
+	struct msgcount *cached = NULL;
+	struct stat st;
+	DIR *d;
+	struct dirent *de;
+	int count = 0;
+
+	if (stat(dir, &st)) {
+		if (msgcount_cache) {
+			ao2_find(msgcount_cache, dir, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+		}
+		return 0;
+	}
+
+	if (msgcount_cache_enabled && msgcount_cache
+		&& (cached = ao2_find(msgcount_cache, dir, OBJ_SEARCH_KEY))) {
+		ao2_lock(cached);
+		if (cached->dev == st.st_dev && cached->ino == st.st_ino && cached->mtime == st.st_mtime) {
+			count = cached->count;
+			ao2_unlock(cached);
+			ao2_ref(cached, -1);
+			return count;
+		}
+		ao2_unlock(cached);
+	}
+
+	if (!(d = opendir(dir))) {
+		ao2_cleanup(cached);
+		return 0;
+	}
+	while ((de = readdir(d))) {
+		if (!strncasecmp(de->d_name, "msg", 3) && !strncasecmp(de->d_name + 8, "txt", 3)) {
+			count++;
+		}
+	}
+	closedir(d);
+
+	/*
+	 * A change made in the same second as the stat() above would not change
+	 * the modification time, so a directory modified that recently is
+	 * counted again next time.
+	 */
+	if (!msgcount_cache_enabled || !msgcount_cache || st.st_mtime >= time(NULL) - 1) {
+		if (cached) {
+			ao2_unlink(msgcount_cache, cached);
+			ao2_ref(cached, -1);
+		}
+		return count;
+	}
+
+	if (!cached) {
+		cached = ao2_alloc(sizeof(*cached) + strlen(dir) + 1, NULL);
+		if (!cached) {
+			return count;
+		}
+		strcpy(cached->path, dir); /* SAFE */
+		ao2_link(msgcount_cache, cached);
+	}
+	ao2_lock(cached);
+	cached->dev = st.st_dev;
+	cached->ino = st.st_ino;
+	cached->mtime = st.st_mtime;
+	cached->count = count;
+	ao2_unlock(cached);
+	ao2_ref(cached, -1);
+
+#ifdef HAVE_INOTIFY
+	ao2_lock(msgcount_cache);
+	if (msgcount_inotify_fd > -1
+		&& inotify_add_watch(msgcount_inotify_fd, dir,
+			IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF) < 0) {
+		ast_debug(1, "Unable to watch '%s' for new messages: %s\n", dir, strerror(errno));
+	}
+	ao2_unlock(msgcount_cache);
+#endif
+
+	return count;
+}
+#else
+#define msgcount_invalidate(file)
 #endif
 
 /*!
@@ -4537,6 +4680,8 @@ static void rename_file(char *sfn, char *dfn)
 		ast_update_realtime("voicemail_data", "filename", sfn, "filename", dfn, SENTINEL);
 	}
 	rename(stxt, dtxt);
+	msgcount_invalidate(sfn);
+	msgcount_invalidate(dfn);
 }
 
 /*! 
@@ -4699,6 +4844,7 @@ static void copy_plain_file(char *frompath, char *topath)
 	}
 	copy(frompath2, topath2);
 	ast_variables_destroy(var);
+	msgcount_invalidate(topath);
 }
 #endif
 
@@ -4725,6 +4871,7 @@ static int vm_delete(char *file)
 	}
 	snprintf(txt, txtsize, "%s.txt", file);
 	unlink(txt);
+	msgcount_invalidate(file);
 	return ast_filedelete(file, NULL);
 }
 
@@ -5967,10 +6114,8 @@ static int messagecount(const char *mailbox_id, const char *folder)
 
 static int __has_voicemail(const char *context, const char *mailbox, const char *folder, int shortcircuit)
 {
-	DIR *dir;
-	struct dirent *de;
 	char fn[256];
-	int ret = 0;
+	int ret;
 
 	/* If no mailbox, return immediately */
 	if (ast_strlen_zero(mailbox))
@@ -5983,23 +6128,9 @@ static int __has_voicemail(const char *context, const char *mailbox, const char
 
 	snprintf(fn, sizeof(fn), "%s%s/%s/%s", VM_SPOOL_DIR, context, mailbox, folder);
 
-	if (!(dir = opendir(fn)))
-		return 0;
-
-	while ((de = readdir(dir))) {
-		if (!strncasecmp(de->d_name, "msg", 3)) {
-			if (shortcircuit) {
-				ret = 1;
-				break;
-			} else if (!strncasecmp(de->d_name + 8, "txt", 3)) {
-				ret++;
-			}
-		}
-	}
-
-	closedir(dir);
+	ret = msgcount_get(fn);
 
-	return ret;
+	return shortcircuit ? ret > 0 : ret;
 }
 
 /** 
@@ -6419,6 +6550,7 @@ static int msg_create_from_file(struct ast_vm_recording_data *recdata)
 
 	snprintf(desttxtfile, sizeof(desttxtfile), "%s.txt", destination);
 	rename(tmptxtfile, desttxtfile);
+	msgcount_invalidate(destination);
 
 	if (chmod(desttxtfile, VOICEMAIL_FILE_MODE) < 0) {
 		ast_log(AST_LOG_ERROR, "Couldn't set permissions on voicemail text file %s: %s", desttxtfile, strerror(errno));
@@ -6928,6 +7060,7 @@ static int leave_voicemail(struct ast_channel *chan, char *ext, struct leave_vm_
 					snprintf(txtfile, sizeof(txtfile), "%s.txt", fn);
 					ast_filerename(tmptxtfile, fn, NULL);
 					rename(tmptxtfile, txtfile);
+					msgcount_invalidate(fn);
 					inprocess_count(vmu->mailbox, vmu->context, -1);
 
 					/* Properly set permissions on voicemail text descriptor file.
@@ -13070,8 +13203,73 @@ static void poll_subscribed_mailboxes(void)
 	AST_RWLIST_UNLOCK(&mwi_subs);
 }
 
+#if defined(HAVE_INOTIFY) && !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+/*!
+ * \internal
+ * \brief Wait for a counted folder to change or for the next poll.
+ *
+ * \retval 1 if a message was added to or removed from a counted folder.
+ * \retval 0 if the poll interval passed, or when stopping.
+ */
+static int mb_poll_wait(int fd, struct timeval next)
+{
+	char buf[8192] __attribute__((aligned(__alignof__(struct inotify_event))));
+	struct pollfd pfd = { .fd = fd, .events = POLLIN };
+	struct inotify_event *iev;
+	int64_t ms;
+	ssize_t res;
+	ssize_t len;
+	int changed = 0;
+
+	while (poll_thread_run && !changed && (ms = ast_tvdiff_ms(next, ast_tvnow())) > 0) {
+		/* Wake up every second to notice the thread being stopped. */
+		if (ast_poll(&pfd, 1, MIN(ms, 1000)) <= 0) {
+			continue;
+		}
+		if ((res = read(fd, buf, sizeof(buf))) <= 0) {
+			continue;
+		}
+		for (iev = (void *) buf; res >= (ssize_t) sizeof(*iev); iev = (void *) ((char *) iev + len)) {
+			len = sizeof(*iev) + iev->len;
+			res -= len;
+			if ((iev->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_Q_OVERFLOW))
+				|| (iev->len && ast_ends_with(iev->name, ".txt"))) {
+				changed = 1;
+			}
+		}
+	}
+
+	return changed;
+}
+#endif
+
 static void *mb_poll_thread(void *data)
 {
+#if defined(HAVE_INOTIFY) && !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	struct timeval next = ast_tvnow();
+	int fd;
+
+	ao2_lock(msgcount_cache);
+	fd = msgcount_inotify_fd;
+	ao2_unlock(msgcount_cache);
+
+	/*
+	 * The folders counted by a poll are watched, so a message deposited or
+	 * removed by something else is noticed at once.  The polls at the poll
+	 * interval only catch folders that could not be watched, and only read
+	 * the folders that were modified.
+	 */
+	while (fd > -1 && poll_thread_run) {
+		if (!mb_poll_wait(fd, next)) {
+			next = ast_tvadd(ast_tvnow(), ast_samp2tv(poll_freq, 1));
+		}
+		if (!poll_thread_run) {
+			break;
+		}
+		poll_subscribed_mailboxes();
+	}
+#endif
+
 	while (poll_thread_run) {
 		struct timespec ts = { 0, };
 		struct timeval wait;
@@ -13233,6 +13431,15 @@ static void start_poll_thread(void)
 
 	poll_thread_run = 1;
 
+#if defined(HAVE_INOTIFY) && !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	ao2_lock(msgcount_cache);
+	if (msgcount_cache_enabled && (msgcount_inotify_fd = inotify_init()) < 0) {
+		ast_log(LOG_WARNING, "Unable to watch mailboxes with inotify(7), polling only: %s\n",
+			strerror(errno));
+	}
+	ao2_unlock(msgcount_cache);
+#endif
+
 	if ((errcode = ast_pthread_create(&poll_thread, NULL, mb_poll_thread, NULL))) {
 		ast_log(LOG_ERROR, "Could not create thread: %s\n", strerror(errcode));
 	}
@@ -13251,6 +13458,15 @@ static void stop_poll_thread(void)
 	pthread_join(poll_thread, NULL);
 
 	poll_thread = AST_PTHREADT_NULL;
+
+#if defined(HAVE_INOTIFY) && !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	ao2_lock(msgcount_cache);
+	if (msgcount_inotify_fd > -1) {
+		close(msgcount_inotify_fd);
+		msgcount_inotify_fd = -1;
+	}
+	ao2_unlock(msgcount_cache);
+#endif
 }
 
 static int manager_voicemail_refresh(struct mansession *s, const struct message *m)
@@ -14046,6 +14262,16 @@ static int actual_load_config(int reload, struct ast_config *cfg, struct ast_con
 		if ((val = ast_variable_retrieve(cfg, "general", "pollmailboxes")))
 			poll_mailboxes = ast_true(val);
 
+#if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+		msgcount_cache_enabled = 1;
+		if ((val = ast_variable_retrieve(cfg, "general", "msgcountcache"))) {
+			msgcount_cache_enabled = ast_true(val);
+		}
+		if (!msgcount_cache_enabled) {
+			ao2_callback(msgcount_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+		}
+#endif
+
 		memset(fromstring, 0, sizeof(fromstring));
 		memset(pagerfromstring, 0, sizeof(pagerfromstring));
 		strcpy(charset, "ISO-8859-1");
@@ -14931,6 +15157,11 @@ static int unload_module(void)
 	if (poll_thread != AST_PTHREADT_NULL)
 		stop_poll_thread();
 
+#if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	ao2_cleanup(msgcount_cache);
+	msgcount_cache = NULL;
+#endif
+
 	mwi_subscription_tps = ast_taskprocessor_unreference(mwi_subscription_tps);
 	ast_unload_realtime("voicemail");
 	ast_unload_realtime("voicemail_data");
@@ -14964,6 +15195,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+#if !(defined(ODBC_STORAGE) || defined(IMAP_STORAGE))
+	if (!(msgcount_cache = ao2_container_alloc(1567, msgcount_hash_fn, msgcount_cmp_fn))) {
+		ao2_ref(inprocess_container, -1);
+		return AST_MODULE_LOAD_FAILURE;
+	}
+#endif
+
 	/* compute the location of the voicemail spool directory */
 	snprintf(VM_SPOOL_DIR, sizeof(VM_SPOOL_DIR), "%s/voicemail/", ast_config_AST_SPOOL_DIR);
 	
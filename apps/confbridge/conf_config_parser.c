@@ -283,6 +283,32 @@
 						or 80.
 					</para></description>
 				</configOption>
+				<configOption name="mixing_threads" default="0">
+					<synopsis>Sets the number of extra threads used to mix audio for each participant</synopsis>
+					<description><para>
+						Summing the audio of every talker is always done by the bridge's
+						mixing thread, but building each participant's mix without their
+						own audio and encoding it to their codec can be spread across
+						this many additional threads.  Very large conferences can then
+						use more than one CPU core.  Translation results are only shared
+						between participants handled by the same thread, so this should
+						be left at 0 unless a single conference is saturating a core.
+						Valid values are 0 through 16.
+					</para></description>
+				</configOption>
+				<configOption name="max_talkers" default="0">
+					<synopsis>Sets the number of loudest talkers mixed into the conference</synopsis>
+					<description><para>
+						When more participants than this are talking at once, only the
+						ones with the highest recent audio energy are mixed.  The audio
+						of the others is discarded without being mixed, and they hear
+						the same mix as the participants who are not talking.  This
+						bounds the mixing work of a conference however many people
+						speak over each other, and keeps background noise from many
+						open microphones out of the mix.  Valid values are 0 through 64.
+						By default 0 is used and every talker is mixed.
+					</para></description>
+				</configOption>
 				<configOption name="binaural_active">
 					<synopsis>If true binaural conferencing with stereo audio is active</synopsis>
 					<description><para>
@@ -1589,6 +1615,14 @@ static char *handle_cli_confbridge_show_bridge_profile(struct ast_cli_entry *e,
 		ast_cli(a->fd,"Mixing Interval:      Default 20ms\n");
 	}
 
+	ast_cli(a->fd,"Mixing Threads:       %u\n", b_profile.mixing_threads);
+
+	if (b_profile.max_talkers) {
+		ast_cli(a->fd,"Max Talkers:          %u\n", b_profile.max_talkers);
+	} else {
+		ast_cli(a->fd,"Max Talkers:          No Limit\n");
+	}
+
 	ast_cli(a->fd,"Record Conference:    %s\n",
 		b_profile.flags & BRIDGE_OPT_RECORD_CONFERENCE ?
 		"yes" : "no");
@@ -2180,6 +2214,8 @@ int conf_load_config(void)
 	aco_option_register(&cfg_info, "internal_sample_rate", ACO_EXACT, bridge_types, "0", OPT_UINT_T, PARSE_DEFAULT, FLDSET(struct bridge_profile, internal_sample_rate), 0);
 	aco_option_register(&cfg_info, "binaural_active", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_BINAURAL_ACTIVE);
 	aco_option_register_custom(&cfg_info, "mixing_interval", ACO_EXACT, bridge_types, "20", mix_interval_handler, 0);
+	aco_option_register(&cfg_info, "mixing_threads", ACO_EXACT, bridge_types, "0", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct bridge_profile, mixing_threads), 0, 16);
+	aco_option_register(&cfg_info, "max_talkers", ACO_EXACT, bridge_types, "0", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct bridge_profile, max_talkers), 0, 64);
 	aco_option_register(&cfg_info, "record_conference", ACO_EXACT, bridge_types, "no", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_CONFERENCE);
 	aco_option_register_custom(&cfg_info, "video_mode", ACO_EXACT, bridge_types, NULL, video_mode_handler, 0);
 	aco_option_register(&cfg_info, "record_file_append", ACO_EXACT, bridge_types, "yes", OPT_BOOLFLAG_T, 1, FLDSET(struct bridge_profile, flags), BRIDGE_OPT_RECORD_FILE_APPEND);
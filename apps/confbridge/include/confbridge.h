@@ -25,6 +25,7 @@
 #include "asterisk/app.h"
 #include "asterisk/logger.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/vector.h"
 #include "asterisk/channel.h"
 #include "asterisk/bridge.h"
 #include "asterisk/bridge_features.h"
@@ -210,6 +211,8 @@ struct bridge_profile {
 	unsigned int max_members;          /*!< The maximum number of participants allowed in the conference */
 	unsigned int internal_sample_rate; /*!< The internal sample rate of the bridge. 0 when set to auto adjust mode. */
 	unsigned int mix_interval;  /*!< The internal mixing interval used by the bridge. When set to 0 the bridgewill use a default interval. */
+	unsigned int mixing_threads; /*!< The number of extra threads the bridge mixes participant audio with. 0 mixes in one thread. */
+	unsigned int max_talkers;   /*!< The number of loudest talkers the bridge mixes. 0 mixes every talker. */
 	struct bridge_profile_sounds *sounds;
 	char regcontext[AST_MAX_CONTEXT];
 };
@@ -229,6 +232,7 @@ struct confbridge_conference {
 	struct ast_channel *record_chan;                                  /*!< Channel used for recording the conference */
 	struct ast_str *record_filename;                                  /*!< Recording filename. */
 	struct ast_str *orig_rec_file;                                    /*!< Previous b_profile.rec_file. */
+	AST_VECTOR(, struct ast_channel *) links;                        /*!< Channels exchanging the mix with the conference on other nodes */
 	AST_LIST_HEAD_NOLOCK(, confbridge_user) active_list;              /*!< List of users participating in the conference bridge */
 	AST_LIST_HEAD_NOLOCK(, confbridge_user) waiting_list;             /*!< List of users waiting to join the conference bridge */
 	struct ast_taskprocessor *playback_queue;                         /*!< Queue for playing back bridge announcements and managing the announcer channel */
@@ -116,6 +116,39 @@ static enum ast_rtp_glue_result native_rtp_bridge_get(struct ast_channel *c0, st
 	}
 }
 
+/*!
+ * \internal
+ * \brief Tell an RTP engine about a local bridge and keep the channel polling the right fd
+ *
+ * The engine may hand reading of the RTP socket to another thread while
+ * locally bridged, in which case the instance fd changes and the channel
+ * must poll the new one.
+ *
+ * \note The channel must be locked when calling this function.
+ */
+static void native_rtp_local_bridge(struct ast_channel *chan, struct ast_rtp_instance *instance0,
+	struct ast_rtp_instance *instance1)
+{
+	int old_fd = ast_rtp_instance_fd(instance0, 0);
+	int new_fd;
+	int i;
+
+	if (!ast_rtp_instance_get_engine(instance0)->local_bridge) {
+		return;
+	}
+	ast_rtp_instance_get_engine(instance0)->local_bridge(instance0, instance1);
+
+	new_fd = ast_rtp_instance_fd(instance0, 0);
+	if (new_fd == old_fd) {
+		return;
+	}
+	for (i = 0; i < AST_MAX_FDS; i++) {
+		if (ast_channel_fd(chan, i) == old_fd) {
+			ast_channel_set_fd(chan, i, new_fd);
+		}
+	}
+}
+
 /*!
  * \internal
  * \brief Start native RTP bridging of two channels
@@ -149,12 +182,8 @@ static void native_rtp_bridge_start(struct ast_bridge *bridge, struct ast_channe
 
 	switch (native_type) {
 	case AST_RTP_GLUE_RESULT_LOCAL:
-		if (ast_rtp_instance_get_engine(instance0)->local_bridge) {
-			ast_rtp_instance_get_engine(instance0)->local_bridge(instance0, instance1);
-		}
-		if (ast_rtp_instance_get_engine(instance1)->local_bridge) {
-			ast_rtp_instance_get_engine(instance1)->local_bridge(instance1, instance0);
-		}
+		native_rtp_local_bridge(bc0->chan, instance0, instance1);
+		native_rtp_local_bridge(bc1->chan, instance1, instance0);
 		ast_rtp_instance_set_bridged(instance0, instance1);
 		ast_rtp_instance_set_bridged(instance1, instance0);
 		ast_verb(4, "Locally RTP bridged '%s' and '%s' in stack\n",
@@ -217,11 +246,9 @@ static void native_rtp_bridge_stop(struct ast_bridge *bridge, struct ast_channel
 
 	switch (native_type) {
 	case AST_RTP_GLUE_RESULT_LOCAL:
-		if (ast_rtp_instance_get_engine(instance0)->local_bridge) {
-			ast_rtp_instance_get_engine(instance0)->local_bridge(instance0, NULL);
-		}
-		if (instance1 && ast_rtp_instance_get_engine(instance1)->local_bridge) {
-			ast_rtp_instance_get_engine(instance1)->local_bridge(instance1, NULL);
+		native_rtp_local_bridge(bc0->chan, instance0, NULL);
+		if (instance1) {
+			native_rtp_local_bridge(bc1->chan, instance1, NULL);
 		}
 		ast_rtp_instance_set_bridged(instance0, NULL);
 		if (instance1) {
@@ -0,0 +1,170 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Native UDPTL bridging technology module
+ *
+ * Relays T.38 between two channels that have both negotiated it, by
+ * sending the UDPTL packets one channel receives out of the other as they
+ * are, rather than decoding them into frames and encoding them again.
+ *
+ * \ingroup bridges
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/channel.h"
+#include "asterisk/bridge.h"
+#include "asterisk/bridge_technology.h"
+#include "asterisk/frame.h"
+#include "asterisk/udptl.h"
+
+/*! \brief Get the UDPTL session of a channel, if it has negotiated T.38 */
+static struct ast_udptl *native_udptl_get(struct ast_channel *chan)
+{
+	if (ast_channel_get_t38_state(chan) != T38_STATE_NEGOTIATED) {
+		return NULL;
+	}
+
+	return ast_udptl_get_instance(chan);
+}
+
+static int native_udptl_bridge_compatible(struct ast_bridge *bridge)
+{
+	struct ast_bridge_channel *bc0 = AST_LIST_FIRST(&bridge->channels);
+	struct ast_bridge_channel *bc1 = AST_LIST_LAST(&bridge->channels);
+	struct ast_udptl *udptl0;
+	struct ast_udptl *udptl1;
+
+	/* We require two channels before even considering native bridging */
+	if (bridge->num_channels != 2) {
+		ast_debug(1, "Bridge '%s' can not use native UDPTL bridge as two channels are required\n",
+			bridge->uniqueid);
+		return 0;
+	}
+
+	udptl0 = native_udptl_get(bc0->chan);
+	udptl1 = native_udptl_get(bc1->chan);
+	if (!udptl0 || !udptl1) {
+		ast_debug(1, "Bridge '%s' can not use native UDPTL bridge as T.38 is not negotiated on both channels\n",
+			bridge->uniqueid);
+		return 0;
+	}
+
+	if (ast_udptl_get_error_correction_scheme(udptl0) != ast_udptl_get_error_correction_scheme(udptl1)) {
+		ast_debug(1, "Bridge '%s' can not use native UDPTL bridge as the error correction schemes differ\n",
+			bridge->uniqueid);
+		return 0;
+	}
+
+	return 1;
+}
+
+/*! \brief Start relaying between the two channels of the bridge, if both are there */
+static void native_udptl_bridge_start(struct ast_bridge *bridge)
+{
+	struct ast_bridge_channel *bc0 = AST_LIST_FIRST(&bridge->channels);
+	struct ast_bridge_channel *bc1 = AST_LIST_LAST(&bridge->channels);
+	struct ast_udptl *udptl0;
+	struct ast_udptl *udptl1;
+
+	if (bc0 == bc1) {
+		return;
+	}
+
+	udptl0 = native_udptl_get(bc0->chan);
+	udptl1 = native_udptl_get(bc1->chan);
+	if (!udptl0 || !udptl1) {
+		return;
+	}
+
+	ast_verb(4, "Relaying T.38 between '%s' and '%s'\n",
+		ast_channel_name(bc0->chan), ast_channel_name(bc1->chan));
+	ast_udptl_set_relay(udptl0, udptl1);
+}
+
+/*! \brief Stop relaying for a channel leaving the bridge, which also stops its peer */
+static void native_udptl_bridge_stop(struct ast_bridge_channel *bridge_channel)
+{
+	struct ast_udptl *udptl = ast_udptl_get_instance(bridge_channel->chan);
+
+	if (udptl) {
+		ast_udptl_set_relay(udptl, NULL);
+	}
+}
+
+static int native_udptl_bridge_join(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel)
+{
+	native_udptl_bridge_start(bridge);
+	return 0;
+}
+
+static void native_udptl_bridge_unsuspend(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel)
+{
+	native_udptl_bridge_start(bridge);
+}
+
+static void native_udptl_bridge_leave(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel)
+{
+	native_udptl_bridge_stop(bridge_channel);
+}
+
+static void native_udptl_bridge_suspend(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel)
+{
+	native_udptl_bridge_stop(bridge_channel);
+}
+
+static int native_udptl_bridge_write(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
+{
+	/* Anything not relayed, such as T.38 parameters and packets that could not be relayed, goes through */
+	return ast_bridge_queue_everyone_else(bridge, bridge_channel, frame);
+}
+
+static struct ast_bridge_technology native_udptl_bridge = {
+	.name = "native_udptl",
+	.capabilities = AST_BRIDGE_CAPABILITY_NATIVE,
+	/* Preferred over native RTP, which has no media to move while T.38 is negotiated */
+	.preference = AST_BRIDGE_PREFERENCE_BASE_NATIVE + 1,
+	.join = native_udptl_bridge_join,
+	.unsuspend = native_udptl_bridge_unsuspend,
+	.leave = native_udptl_bridge_leave,
+	.suspend = native_udptl_bridge_suspend,
+	.write = native_udptl_bridge_write,
+	.compatible = native_udptl_bridge_compatible,
+};
+
+static int unload_module(void)
+{
+	ast_bridge_technology_unregister(&native_udptl_bridge);
+	return 0;
+}
+
+static int load_module(void)
+{
+	if (ast_bridge_technology_register(&native_udptl_bridge)) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Native UDPTL bridging module");
@@ -52,6 +52,10 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/timing.h"
 #include "asterisk/translate.h"
+#include "asterisk/test.h"
+#include "asterisk/thread_placement.h"
+
+#include "bridge_softmix/include/bridge_softmix_mixing.h"
 
 #define MAX_DATALEN 8096
 
@@ -70,6 +74,12 @@
 /*! \brief Number of mixing iterations to perform between gathering statistics. */
 #define SOFTMIX_STAT_INTERVAL 100
 
+/*! \brief Maximum number of extra threads a bridge may use to mix listener audio. */
+#define SOFTMIX_MAX_MIXING_THREADS 16
+
+/*! \brief Maximum number of loudest talkers a bridge may limit mixing to. */
+#define SOFTMIX_MAX_TALKERS 64
+
 /* This is the threshold in ms at which a channel's own audio will stop getting
  * mixed out its own write audio stream because it is not talking. */
 #define DEFAULT_SOFTMIX_SILENCE_THRESHOLD 2500
@@ -110,6 +120,10 @@ struct softmix_channel {
 	unsigned int talking:1;
 	/*! TRUE if the channel provided audio for this mixing interval */
 	unsigned int have_audio:1;
+	/*! TRUE if the channel is talking but not among the loudest talkers mixed */
+	unsigned int unmixed:1;
+	/*! Smoothed energy of the audio the channel writes, to rank talkers */
+	int talker_energy;
 	/*! Buffer containing final mixed audio from all sources */
 	short final_buf[MAX_DATALEN];
 	/*! Buffer containing only the audio from the channel */
@@ -155,12 +169,6 @@ struct softmix_stats {
 	unsigned int locked_rate;
 };
 
-struct softmix_mixing_array {
-	unsigned int max_num_entries;
-	unsigned int used_entries;
-	int16_t **buffers;
-};
-
 struct softmix_translate_helper_entry {
 	int num_times_requested; /*!< Once this entry is no longer requested, free the trans_pvt
 	                              and re-init if it was usable. */
@@ -175,6 +183,93 @@ struct softmix_translate_helper {
 	AST_LIST_HEAD_NOLOCK(, softmix_translate_helper_entry) entries;
 };
 
+struct softmix_mixing_workers;
+
+/*! \brief A share of the bridge's listeners mixed and encoded by one thread */
+struct softmix_mixing_shard {
+	/*! Translation helper only used by this shard's thread */
+	struct softmix_translate_helper trans_helper;
+	/*! Worker set this shard belongs to */
+	struct softmix_mixing_workers *workers;
+	/*! Thread mixing this shard.  Shard 0 is mixed by the mixing thread itself. */
+	pthread_t thread;
+	/*! Position of this shard in the worker set */
+	unsigned int index;
+};
+
+/*!
+ * \brief Threads that split the per listener half of each mixing interval
+ *
+ * The mixing thread always sums every talker itself.  Removing each
+ * listener's own audio, translating, and queueing the result is then
+ * divided between the shards, with every shard taking each
+ * num_shards'th listener.  The mixing thread holds the bridge lock and
+ * waits for all the shards to finish, so the channel list is stable
+ * while the workers walk it.
+ */
+struct softmix_mixing_workers {
+	/*! Lock protecting the job fields and signaling the workers */
+	ast_mutex_t lock;
+	/*! Signaled when a new job is available or the workers should stop */
+	ast_cond_t work;
+	/*! Signaled when the last worker finishes the current job */
+	ast_cond_t done;
+	/*! Bridge being mixed */
+	struct ast_bridge *bridge;
+	/*!
+	 * \brief Mix of every talker for the current interval
+	 *
+	 * \note Read only while the shards run.  Listeners that are not
+	 * talking are all queued this frame, or one shared translation
+	 * of it, instead of a private copy.
+	 */
+	struct ast_frame mix_frame;
+	/*!
+	 * \brief Copy of mix_frame whose payload the listeners' queued frames
+	 * reference instead of each copying it, NULL if it could not be made
+	 */
+	struct ast_frame *shared_mix_frame;
+	/*! Incremented each time a job is handed to the workers */
+	unsigned int generation;
+	/*! Number of workers that have not finished the current job */
+	unsigned int pending;
+	/*! Number of extra threads requested by the bridge */
+	unsigned int requested;
+	/*! Number of entries in shards */
+	unsigned int num_shards;
+	/*! The shards, shard 0 belongs to the mixing thread */
+	struct softmix_mixing_shard *shards;
+	/*! TRUE if the worker threads should exit */
+	unsigned int stop:1;
+};
+
+/*!
+ * \internal
+ * \brief Build a path translating the mix to the format of some listeners
+ *
+ * The mix does not need the default resampling quality, so paths in and
+ * out of the bridge use the faster one.
+ */
+static struct ast_trans_pvt *softmix_build_path(struct ast_format *dst, struct ast_format *src)
+{
+	struct ast_trans_pvt *path = ast_translator_build_path(dst, src);
+
+	ast_translate_path_set_quality(path, AST_TRANSLATE_QUALITY_FAST);
+	return path;
+}
+
+/*!
+ * \internal
+ * \brief Set the quality of a channel's translation paths in and out of the mix
+ *
+ * \note The channel must be locked.
+ */
+static void softmix_channel_path_quality(struct ast_channel *chan, enum ast_translate_quality quality)
+{
+	ast_translate_path_set_quality(ast_channel_readtrans(chan), quality);
+	ast_translate_path_set_quality(ast_channel_writetrans(chan), quality);
+}
+
 static struct softmix_translate_helper_entry *softmix_translate_helper_entry_alloc(struct ast_format *dst)
 {
 	struct softmix_translate_helper_entry *entry;
@@ -225,7 +320,7 @@ static void softmix_translate_helper_change_rate(struct softmix_translate_helper
 	AST_LIST_TRAVERSE_SAFE_BEGIN(&trans_helper->entries, entry, entry) {
 		if (entry->trans_pvt) {
 			ast_translator_free_path(entry->trans_pvt);
-			if (!(entry->trans_pvt = ast_translator_build_path(entry->dst_format, trans_helper->slin_src))) {
+			if (!(entry->trans_pvt = softmix_build_path(entry->dst_format, trans_helper->slin_src))) {
 				AST_LIST_REMOVE_CURRENT(entry);
 				entry = softmix_translate_helper_free_entry(entry);
 			}
@@ -236,56 +331,90 @@ static void softmix_translate_helper_change_rate(struct softmix_translate_helper
 
 /*!
  * \internal
- * \brief Get the next available audio on the softmix channel's read stream
+ * \brief Mix the next available audio on the softmix channel's read stream
  * and determine if it should be mixed out or not on the write stream.
  *
- * \retval pointer to buffer containing the exact number of samples requested on success.
- * \retval NULL if no samples are present
+ * The audio is mixed straight from the factory.  Only the audio of talkers
+ * is removed from what they hear, so only theirs is copied to our_buf.
+ * A channel that starts talking before the mix is written out hears the
+ * shared mix for that interval.
+ *
+ * \param sc The softmix channel
+ * \param mix Buffer to mix the audio into
+ * \param num_samples Number of samples to mix
+ *
+ * \retval 1 if the audio was mixed
+ * \retval 0 if not enough samples are present
  */
-static int16_t *softmix_process_read_audio(struct softmix_channel *sc, unsigned int num_samples)
+static int softmix_process_read_audio(struct softmix_channel *sc, int16_t *mix, unsigned int num_samples)
 {
-	if ((ast_slinfactory_available(&sc->factory) >= num_samples) &&
-		ast_slinfactory_read(&sc->factory, sc->our_buf, num_samples)) {
-		sc->have_audio = 1;
-		return sc->our_buf;
+	const short *samples;
+	unsigned int done;
+	unsigned int len;
+
+	if (ast_slinfactory_available(&sc->factory) < num_samples) {
+		sc->have_audio = 0;
+		return 0;
 	}
-	sc->have_audio = 0;
-	return NULL;
+
+	sc->have_audio = sc->talking;
+	for (done = 0; done < num_samples; done += len) {
+		len = ast_slinfactory_peek(&sc->factory, &samples, num_samples - done);
+		softmix_mix_add(mix + done, samples, len);
+		if (sc->have_audio) {
+			memcpy(sc->our_buf + done, samples, len * sizeof(*samples));
+		}
+		ast_slinfactory_consume(&sc->factory, len);
+	}
+
+	return 1;
 }
 
 /*!
  * \internal
- * \brief Process a softmix channel's write audio
+ * \brief Process a talking softmix channel's write audio
  *
- * \details This function will remove the channel's talking from its own audio if present and
- * possibly even do the channel's write translation for it depending on how many other
- * channels use the same write format.
+ * \details This function will remove the channel's talking from its own audio.
+ * The result is unique to the channel so it does its own write translation.
  */
 static void softmix_process_write_audio(struct softmix_translate_helper *trans_helper,
 	struct ast_format *raw_write_fmt,
 	struct softmix_channel *sc)
 {
 	struct softmix_translate_helper_entry *entry = NULL;
-	int i;
 
-	/* If we provided audio that was not determined to be silence,
-	 * then take it out while in slinear format. */
-	if (sc->have_audio && sc->talking) {
-		for (i = 0; i < sc->write_frame.samples; i++) {
-			ast_slinear_saturated_subtract(&sc->final_buf[i], &sc->our_buf[i]);
-		}
-		/* check to see if any entries exist for the format. if not we'll want
-		   to remove it during cleanup */
-		AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
-			if (ast_format_cmp(entry->dst_format, raw_write_fmt) == AST_FORMAT_CMP_EQUAL) {
-				++entry->num_times_requested;
-				break;
-			}
+	softmix_mix_subtract(sc->final_buf, sc->our_buf, sc->write_frame.samples);
+	/* check to see if any entries exist for the format. if not we'll want
+	   to remove it during cleanup */
+	AST_LIST_TRAVERSE(&trans_helper->entries, entry, entry) {
+		if (ast_format_cmp(entry->dst_format, raw_write_fmt) == AST_FORMAT_CMP_EQUAL) {
+			++entry->num_times_requested;
+			break;
 		}
-		/* do not do any special write translate optimization if we had to make
-		 * a special mix for them to remove their own audio. */
-		return;
 	}
+}
+
+/*!
+ * \internal
+ * \brief Get the write audio for a softmix channel that is not talking
+ *
+ * \details Every channel not talking hears the same mix, so it is translated at
+ * most once per destination format per mixing interval and the same frame is
+ * queued to all of those channels.
+ *
+ * \param trans_helper Translation helper of the calling shard.
+ * \param raw_write_fmt The channel's raw write format.
+ * \param mix_frame The signed linear mix of every talker.
+ *
+ * \return The frame to queue to the channel.  It is owned by the helper or
+ * is \a mix_frame, so it must be duplicated by the queueing code.  Its
+ * payload is normally shared, which makes that duplication cheap.
+ */
+static struct ast_frame *softmix_process_shared_write_audio(struct softmix_translate_helper *trans_helper,
+	struct ast_format *raw_write_fmt,
+	struct ast_frame *mix_frame)
+{
+	struct softmix_translate_helper_entry *entry = NULL;
 
 	/* Attempt to optimize channels using the same translation path/codec. Build a list of entries
 	   of translation paths and track the number of references for each type. Each one of the same
@@ -299,16 +428,22 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 			continue;
 		}
 		if (!entry->trans_pvt && (entry->num_times_requested > 1)) {
-			entry->trans_pvt = ast_translator_build_path(entry->dst_format, trans_helper->slin_src);
+			entry->trans_pvt = softmix_build_path(entry->dst_format, trans_helper->slin_src);
 		}
 		if (entry->trans_pvt && !entry->out_frame) {
-			entry->out_frame = ast_translate(entry->trans_pvt, &sc->write_frame, 0);
+			entry->out_frame = ast_translate(entry->trans_pvt, mix_frame, 0);
+			if (entry->out_frame && !AST_LIST_NEXT(entry->out_frame, frame_list)) {
+				struct ast_frame *shared = ast_frdup_shared(entry->out_frame);
+
+				/* Let every listener's queued frame reference one copy of the translation. */
+				if (shared) {
+					ast_frfree(entry->out_frame);
+					entry->out_frame = shared;
+				}
+			}
 		}
-		if (entry->out_frame && (entry->out_frame->datalen < MAX_DATALEN)) {
-			ao2_replace(sc->write_frame.subclass.format, entry->out_frame->subclass.format);
-			memcpy(sc->final_buf, entry->out_frame->data.ptr, entry->out_frame->datalen);
-			sc->write_frame.datalen = entry->out_frame->datalen;
-			sc->write_frame.samples = entry->out_frame->samples;
+		if (entry->out_frame) {
+			return entry->out_frame;
 		}
 		break;
 	}
@@ -317,6 +452,9 @@ static void softmix_process_write_audio(struct softmix_translate_helper *trans_h
 	if (!entry && (entry = softmix_translate_helper_entry_alloc(raw_write_fmt))) {
 		AST_LIST_INSERT_HEAD(&trans_helper->entries, entry, entry);
 	}
+
+	/* The channel's own write path will translate the mix. */
+	return mix_frame;
 }
 
 static void softmix_translate_helper_cleanup(struct softmix_translate_helper *trans_helper)
@@ -396,6 +534,9 @@ static void set_softmix_bridge_data(int rate, int interval, struct ast_bridge_ch
 		ast_channel_rawreadformat(bridge_channel->chan), slin_format);
 	ast_channel_unlock(bridge_channel->chan);
 	setup_fail |= ast_set_write_format(bridge_channel->chan, slin_format);
+	ast_channel_lock(bridge_channel->chan);
+	softmix_channel_path_quality(bridge_channel->chan, AST_TRANSLATE_QUALITY_FAST);
+	ast_channel_unlock(bridge_channel->chan);
 
 	/* set up new DSP.  This is on the read side only right before the read frame enters the smoother.  */
 	sc->dsp = ast_dsp_new_with_rate(rate);
@@ -482,6 +623,11 @@ static void softmix_bridge_leave(struct ast_bridge *bridge, struct ast_bridge_ch
 	}
 	bridge_channel->tech_pvt = NULL;
 
+	/* The paths may outlive the bridge if the formats being restored match. */
+	ast_channel_lock(bridge_channel->chan);
+	softmix_channel_path_quality(bridge_channel->chan, AST_TRANSLATE_QUALITY_DEFAULT);
+	ast_channel_unlock(bridge_channel->chan);
+
 	/* Drop mutex lock */
 	ast_mutex_destroy(&sc->lock);
 
@@ -603,6 +749,8 @@ static void softmix_bridge_write_voice(struct ast_bridge *bridge, struct ast_bri
 			ast_format_get_name(sc->read_slin_format));
 		ast_set_read_format_path(bridge_channel->chan, frame->subclass.format,
 			sc->read_slin_format);
+		ast_translate_path_set_quality(ast_channel_readtrans(bridge_channel->chan),
+			AST_TRANSLATE_QUALITY_FAST);
 		ast_channel_unlock(bridge_channel->chan);
 	}
 
@@ -610,6 +758,7 @@ static void softmix_bridge_write_voice(struct ast_bridge *bridge, struct ast_bri
 	if (sc->dsp) {
 		ast_dsp_silence_with_energy(sc->dsp, frame, &totalsilence, &cur_energy);
 	}
+	sc->talker_energy += (cur_energy - sc->talker_energy) / 8;
 
 	if (bridge->softmix.video_mode.mode == AST_BRIDGE_VIDEO_MODE_TALKER_SRC) {
 		int cur_slot = sc->video_talker.energy_history_cur_slot;
@@ -868,35 +1017,295 @@ static unsigned int analyse_softmix_stats(struct softmix_stats *stats, struct so
 	return 0;
 }
 
-static int softmix_mixing_array_init(struct softmix_mixing_array *mixing_array, unsigned int starting_num_entries)
+/*!
+ * \internal
+ * \brief Mark every talker but the loudest ones to be left out of the mix.
+ *
+ * \param bridge Bridge being mixed.
+ * \param max_talkers Number of talkers to mix.
+ */
+static void softmix_select_talkers(struct ast_bridge *bridge, unsigned int max_talkers)
 {
-	memset(mixing_array, 0, sizeof(*mixing_array));
-	mixing_array->max_num_entries = starting_num_entries;
-	if (!(mixing_array->buffers = ast_calloc(mixing_array->max_num_entries, sizeof(int16_t *)))) {
-		ast_log(LOG_NOTICE, "Failed to allocate softmix mixing structure.\n");
-		return -1;
+	struct softmix_channel *loudest[SOFTMIX_MAX_TALKERS];
+	int energies[SOFTMIX_MAX_TALKERS];
+	unsigned int num_loudest = 0;
+	struct ast_bridge_channel *bridge_channel;
+	unsigned int idx;
+
+	if (max_talkers > SOFTMIX_MAX_TALKERS) {
+		max_talkers = SOFTMIX_MAX_TALKERS;
+	}
+
+	AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+		struct softmix_channel *sc = bridge_channel->tech_pvt;
+		int talking;
+		int energy;
+
+		if (!sc || bridge_channel->suspended) {
+			continue;
+		}
+
+		ast_mutex_lock(&sc->lock);
+		talking = sc->talking;
+		sc->unmixed = talking;
+		energy = sc->talker_energy;
+		ast_mutex_unlock(&sc->lock);
+		if (!talking) {
+			continue;
+		}
+
+		/* Keep the loudest talkers sorted, loudest first. */
+		if (num_loudest == max_talkers) {
+			if (energy <= energies[num_loudest - 1]) {
+				continue;
+			}
+			--num_loudest;
+		}
+		for (idx = num_loudest; idx && energies[idx - 1] < energy; --idx) {
+			loudest[idx] = loudest[idx - 1];
+			energies[idx] = energies[idx - 1];
+		}
+		loudest[idx] = sc;
+		energies[idx] = energy;
+		++num_loudest;
+	}
+
+	for (idx = 0; idx < num_loudest; ++idx) {
+		ast_mutex_lock(&loudest[idx]->lock);
+		loudest[idx]->unmixed = 0;
+		ast_mutex_unlock(&loudest[idx]->lock);
 	}
-	return 0;
 }
 
-static void softmix_mixing_array_destroy(struct softmix_mixing_array *mixing_array)
+/*!
+ * \internal
+ * \brief Remove each listener's own audio from the mix and queue it to them.
+ *
+ * \param workers Worker set holding the current job.
+ * \param shard Shard of the listeners to process.
+ */
+static void softmix_mix_listeners(struct softmix_mixing_workers *workers, struct softmix_mixing_shard *shard)
 {
-	ast_free(mixing_array->buffers);
+	struct ast_bridge_channel *bridge_channel;
+	unsigned int position = 0;
+
+	AST_LIST_TRAVERSE(&workers->bridge->channels, bridge_channel, entry) {
+		struct softmix_channel *sc = bridge_channel->tech_pvt;
+
+		if (!sc || bridge_channel->suspended) {
+			/* This channel failed to join successfully or is suspended. */
+			continue;
+		}
+
+		if (position++ % workers->num_shards != shard->index) {
+			/* Another shard handles this channel. */
+			continue;
+		}
+
+		ast_mutex_lock(&sc->lock);
+
+		/* Make SLINEAR write frame from local buffer */
+		if (!(sc->have_audio && sc->talking)) {
+			struct ast_frame *shared;
+
+			/* Everyone not talking hears the same audio. */
+			ast_mutex_unlock(&sc->lock);
+			shared = softmix_process_shared_write_audio(&shard->trans_helper,
+				ast_channel_rawwriteformat(bridge_channel->chan),
+				workers->shared_mix_frame ?: &workers->mix_frame);
+			ast_bridge_channel_queue_frame(bridge_channel, shared);
+			continue;
+		}
+
+		ao2_t_replace(sc->write_frame.subclass.format, workers->mix_frame.subclass.format,
+			"Replace softmix channel slin format");
+		sc->write_frame.datalen = workers->mix_frame.datalen;
+		sc->write_frame.samples = workers->mix_frame.samples;
+		memcpy(sc->final_buf, workers->mix_frame.data.ptr, workers->mix_frame.datalen);
+
+		/* process the softmix channel's new write audio */
+		softmix_process_write_audio(&shard->trans_helper, ast_channel_rawwriteformat(bridge_channel->chan), sc);
+
+		ast_mutex_unlock(&sc->lock);
+
+		/* A frame is now ready for the channel. */
+		ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
+	}
 }
 
-static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array, unsigned int num_entries)
+/*!
+ * \internal
+ * \brief Thread mixing one shard of the listeners each interval.
+ */
+static void *softmix_mixing_worker(void *data)
 {
-	int16_t **tmp;
-	/* give it some room to grow since memory is cheap but allocations can be expensive */
-	mixing_array->max_num_entries = num_entries;
-	if (!(tmp = ast_realloc(mixing_array->buffers, (mixing_array->max_num_entries * sizeof(int16_t *))))) {
-		ast_log(LOG_NOTICE, "Failed to re-allocate softmix mixing structure.\n");
+	struct softmix_mixing_shard *shard = data;
+	struct softmix_mixing_workers *workers = shard->workers;
+	unsigned int generation = 0;
+
+	ast_thread_place(AST_THREAD_ROLE_MIXING, workers->bridge->numa_node);
+	if (workers->bridge->callid) {
+		ast_callid_threadassoc_add(workers->bridge->callid);
+	}
+
+	ast_mutex_lock(&workers->lock);
+	for (;;) {
+		while (!workers->stop && workers->generation == generation) {
+			ast_cond_wait(&workers->work, &workers->lock);
+		}
+		if (workers->stop) {
+			break;
+		}
+		generation = workers->generation;
+		ast_mutex_unlock(&workers->lock);
+
+		softmix_mix_listeners(workers, shard);
+
+		ast_mutex_lock(&workers->lock);
+		if (!--workers->pending) {
+			ast_cond_signal(&workers->done);
+		}
+	}
+	ast_mutex_unlock(&workers->lock);
+
+	return NULL;
+}
+
+static void softmix_mixing_workers_destroy(struct softmix_mixing_workers *workers)
+{
+	unsigned int idx;
+
+	if (!workers->shards) {
+		return;
+	}
+
+	ast_mutex_lock(&workers->lock);
+	workers->stop = 1;
+	ast_cond_broadcast(&workers->work);
+	ast_mutex_unlock(&workers->lock);
+
+	for (idx = 0; idx < workers->num_shards; ++idx) {
+		if (workers->shards[idx].thread != AST_PTHREADT_NULL) {
+			pthread_join(workers->shards[idx].thread, NULL);
+		}
+		softmix_translate_helper_destroy(&workers->shards[idx].trans_helper);
+	}
+
+	ast_free(workers->shards);
+	workers->shards = NULL;
+	workers->num_shards = 0;
+	ast_mutex_destroy(&workers->lock);
+	ast_cond_destroy(&workers->work);
+	ast_cond_destroy(&workers->done);
+}
+
+/*!
+ * \internal
+ * \brief Start the threads used to mix the bridge's listeners.
+ *
+ * \param workers Worker set to initialize.
+ * \param bridge Bridge being mixed.
+ * \param sample_rate Internal sample rate of the bridge.
+ *
+ * \note On failure \a workers is left safe to destroy.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int softmix_mixing_workers_init(struct softmix_mixing_workers *workers,
+	struct ast_bridge *bridge, unsigned int sample_rate)
+{
+	unsigned int idx;
+
+	memset(workers, 0, sizeof(*workers));
+	workers->bridge = bridge;
+	workers->requested = bridge->softmix.mixing_threads;
+	workers->num_shards = MIN(workers->requested, SOFTMIX_MAX_MIXING_THREADS) + 1;
+	workers->shards = ast_calloc(workers->num_shards, sizeof(*workers->shards));
+	if (!workers->shards) {
+		ast_log(LOG_NOTICE, "Failed to allocate softmix mixing shards.\n");
 		return -1;
 	}
-	mixing_array->buffers = tmp;
+	ast_mutex_init(&workers->lock);
+	ast_cond_init(&workers->work, NULL);
+	ast_cond_init(&workers->done, NULL);
+
+	for (idx = 0; idx < workers->num_shards; ++idx) {
+		struct softmix_mixing_shard *shard = &workers->shards[idx];
+
+		shard->workers = workers;
+		shard->index = idx;
+		shard->thread = AST_PTHREADT_NULL;
+		softmix_translate_helper_init(&shard->trans_helper, sample_rate);
+	}
+
+	for (idx = 1; idx < workers->num_shards; ++idx) {
+		struct softmix_mixing_shard *shard = &workers->shards[idx];
+
+		if (ast_pthread_create(&shard->thread, NULL, softmix_mixing_worker, shard)) {
+			ast_log(LOG_WARNING, "Bridge %s: Could only start %u of %u mixing threads.\n",
+				bridge->uniqueid, idx - 1, workers->num_shards - 1);
+			shard->thread = AST_PTHREADT_NULL;
+			/* Mix with the threads that did start.  No job has been handed out yet. */
+			workers->num_shards = idx;
+			break;
+		}
+	}
+
+	if (workers->num_shards > 1) {
+		ast_debug(1, "Bridge %s: mixing listeners with %u extra threads\n",
+			bridge->uniqueid, workers->num_shards - 1);
+	}
+
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Mix and queue audio to every listener, splitting the work among the shards.
+ *
+ * \note The bridge must be locked by the caller until this returns.
+ */
+static void softmix_mixing_workers_run(struct softmix_mixing_workers *workers,
+	const int16_t *buf, struct ast_format *cur_slin, unsigned int samples, unsigned int datalen)
+{
+	struct ast_frame *mix_frame = &workers->mix_frame;
+
+	if (workers->num_shards > 1) {
+		ast_mutex_lock(&workers->lock);
+	}
+
+	memset(mix_frame, 0, sizeof(*mix_frame));
+	mix_frame->frametype = AST_FRAME_VOICE;
+	mix_frame->subclass.format = cur_slin;
+	mix_frame->data.ptr = (int16_t *) buf;
+	mix_frame->samples = samples;
+	mix_frame->datalen = datalen;
+	workers->shared_mix_frame = ast_frdup_shared(mix_frame);
+
+	if (workers->num_shards == 1) {
+		softmix_mix_listeners(workers, &workers->shards[0]);
+	} else {
+		workers->pending = workers->num_shards - 1;
+		workers->generation++;
+		ast_cond_broadcast(&workers->work);
+		ast_mutex_unlock(&workers->lock);
+
+		softmix_mix_listeners(workers, &workers->shards[0]);
+
+		ast_mutex_lock(&workers->lock);
+		while (workers->pending) {
+			ast_cond_wait(&workers->done, &workers->lock);
+		}
+		ast_mutex_unlock(&workers->lock);
+	}
+
+	if (workers->shared_mix_frame) {
+		ast_frfree(workers->shared_mix_frame);
+		workers->shared_mix_frame = NULL;
+	}
+}
+
 /*!
  * \brief Mixing loop.
  *
@@ -906,27 +1315,22 @@ static int softmix_mixing_array_grow(struct softmix_mixing_array *mixing_array,
 static int softmix_mixing_loop(struct ast_bridge *bridge)
 {
 	struct softmix_stats stats = { { 0 }, };
-	struct softmix_mixing_array mixing_array;
 	struct softmix_bridge_data *softmix_data = bridge->tech_pvt;
 	struct ast_timer *timer;
-	struct softmix_translate_helper trans_helper;
+	struct softmix_mixing_workers workers;
 	int16_t buf[MAX_DATALEN];
 	unsigned int stat_iteration_counter = 0; /* counts down, gather stats at zero and reset. */
 	int timingfd;
 	int update_all_rates = 0; /* set this when the internal sample rate has changed */
 	unsigned int idx;
-	unsigned int x;
 	int res = -1;
 
 	timer = softmix_data->timer;
 	timingfd = ast_timer_fd(timer);
-	softmix_translate_helper_init(&trans_helper, softmix_data->internal_rate);
-	ast_timer_set_rate(timer, (1000 / softmix_data->internal_mixing_interval));
-
-	/* Give the mixing array room to grow, memory is cheap but allocations are expensive. */
-	if (softmix_mixing_array_init(&mixing_array, bridge->num_channels + 10)) {
-		goto softmix_cleanup;
+	if (softmix_mixing_workers_init(&workers, bridge, softmix_data->internal_rate)) {
+		return -1;
 	}
+	ast_timer_set_rate(timer, (1000 / softmix_data->internal_mixing_interval));
 
 	/*
 	 * XXX Softmix needs to use channel roles to determine who gets
@@ -938,6 +1342,7 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 		struct ast_format *cur_slin = ast_format_cache_get_slin_by_rate(softmix_data->internal_rate);
 		unsigned int softmix_samples = SOFTMIX_SAMPLES(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
 		unsigned int softmix_datalen = SOFTMIX_DATALEN(softmix_data->internal_rate, softmix_data->internal_mixing_interval);
+		unsigned int max_talkers;
 
 		if (softmix_datalen > MAX_DATALEN) {
 			/* This should NEVER happen, but if it does we need to know about it. Almost
@@ -950,15 +1355,8 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			goto softmix_cleanup;
 		}
 
-		/* Grow the mixing array buffer as participants are added. */
-		if (mixing_array.max_num_entries < bridge->num_channels
-			&& softmix_mixing_array_grow(&mixing_array, bridge->num_channels + 5)) {
-			goto softmix_cleanup;
-		}
-
-		/* init the number of buffers stored in the mixing array to 0.
-		 * As buffers are added for mixing, this number is incremented. */
-		mixing_array.used_entries = 0;
+		/* Channels with audio are mixed into this as it is pulled from their factories */
+		memset(buf, 0, softmix_datalen);
 
 		/* These variables help determine if a rate change is required */
 		if (!stat_iteration_counter) {
@@ -966,9 +1364,18 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			stats.locked_rate = bridge->softmix.internal_sample_rate;
 		}
 
-		/* If the sample rate has changed, update the translator helper */
+		/* If the sample rate has changed, update the translator helpers */
 		if (update_all_rates) {
-			softmix_translate_helper_change_rate(&trans_helper, softmix_data->internal_rate);
+			for (idx = 0; idx < workers.num_shards; ++idx) {
+				softmix_translate_helper_change_rate(&workers.shards[idx].trans_helper,
+					softmix_data->internal_rate);
+			}
+		}
+
+		/* Pick the talkers to mix if the bridge is limited to the loudest ones */
+		max_talkers = bridge->softmix.max_talkers;
+		if (max_talkers) {
+			softmix_select_talkers(bridge, max_talkers);
 		}
 
 		/* Go through pulling audio from each factory that has it available */
@@ -997,46 +1404,18 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 
 			/* Try to get audio from the factory if available */
 			ast_mutex_lock(&sc->lock);
-			if ((mixing_array.buffers[mixing_array.used_entries] = softmix_process_read_audio(sc, softmix_samples))) {
-				mixing_array.used_entries++;
+			if (max_talkers && sc->unmixed) {
+				/* Not among the loudest talkers, so it hears the shared mix. */
+				ast_slinfactory_flush(&sc->factory);
+				sc->have_audio = 0;
+			} else {
+				softmix_process_read_audio(sc, buf, softmix_samples);
 			}
 			ast_mutex_unlock(&sc->lock);
 		}
 
-		/* mix it like crazy */
-		memset(buf, 0, softmix_datalen);
-		for (idx = 0; idx < mixing_array.used_entries; ++idx) {
-			for (x = 0; x < softmix_samples; ++x) {
-				ast_slinear_saturated_add(buf + x, mixing_array.buffers[idx] + x);
-			}
-		}
-
 		/* Next step go through removing the channel's own audio and creating a good frame... */
-		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
-			struct softmix_channel *sc = bridge_channel->tech_pvt;
-
-			if (!sc || bridge_channel->suspended) {
-				/* This channel failed to join successfully or is suspended. */
-				continue;
-			}
-
-			ast_mutex_lock(&sc->lock);
-
-			/* Make SLINEAR write frame from local buffer */
-			ao2_t_replace(sc->write_frame.subclass.format, cur_slin,
-				"Replace softmix channel slin format");
-			sc->write_frame.datalen = softmix_datalen;
-			sc->write_frame.samples = softmix_samples;
-			memcpy(sc->final_buf, buf, softmix_datalen);
-
-			/* process the softmix channel's new write audio */
-			softmix_process_write_audio(&trans_helper, ast_channel_rawwriteformat(bridge_channel->chan), sc);
-
-			ast_mutex_unlock(&sc->lock);
-
-			/* A frame is now ready for the channel. */
-			ast_bridge_channel_queue_frame(bridge_channel, &sc->write_frame);
-		}
+		softmix_mixing_workers_run(&workers, buf, cur_slin, softmix_samples, softmix_datalen);
 
 		update_all_rates = 0;
 		if (!stat_iteration_counter) {
@@ -1047,7 +1426,9 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 
 		ast_bridge_unlock(bridge);
 		/* cleanup any translation frame data from the previous mixing iteration. */
-		softmix_translate_helper_cleanup(&trans_helper);
+		for (idx = 0; idx < workers.num_shards; ++idx) {
+			softmix_translate_helper_cleanup(&workers.shards[idx].trans_helper);
+		}
 		/* Wait for the timing source to tell us to wake up and get things done */
 		ast_waitfor_n_fd(&timingfd, 1, &timeout, NULL);
 		if (ast_timer_ack(timer, 1) < 0) {
@@ -1065,13 +1446,20 @@ static int softmix_mixing_loop(struct ast_bridge *bridge)
 			ast_timer_set_rate(timer, (1000 / softmix_data->internal_mixing_interval));
 			update_all_rates = 1; /* if the interval changes, the rates must be adjusted as well just to be notified new interval.*/
 		}
+
+		/* restart the listener mixing threads if the number wanted changed. */
+		if (bridge->softmix.mixing_threads != workers.requested) {
+			softmix_mixing_workers_destroy(&workers);
+			if (softmix_mixing_workers_init(&workers, bridge, softmix_data->internal_rate)) {
+				goto softmix_cleanup;
+			}
+		}
 	}
 
 	res = 0;
 
 softmix_cleanup:
-	softmix_translate_helper_destroy(&trans_helper);
-	softmix_mixing_array_destroy(&mixing_array);
+	softmix_mixing_workers_destroy(&workers);
 	return res;
 }
 
@@ -1089,6 +1477,8 @@ static void *softmix_mixing_thread(void *data)
 	struct softmix_bridge_data *softmix_data = data;
 	struct ast_bridge *bridge = softmix_data->bridge;
 
+	ast_thread_place(AST_THREAD_ROLE_MIXING, bridge->numa_node);
+
 	ast_bridge_lock(bridge);
 	if (bridge->callid) {
 		ast_callid_threadassoc_add(bridge->callid);
@@ -1237,18 +1627,176 @@ static struct ast_bridge_technology softmix_bridge = {
 	.write = softmix_bridge_write,
 };
 
+#ifdef TEST_FRAMEWORK
+/*! Participants mixed by the benchmark */
+#define TEST_MIX_PARTICIPANTS 200
+/*! 20ms of audio at 48kHz */
+#define TEST_MIX_SAMPLES 960
+/*! Mixing intervals timed per kernel */
+#define TEST_MIX_ITERATIONS 50
+
+static int16_t test_random_sample(void)
+{
+	/* Bias toward the extremes so saturation is exercised. */
+	switch (ast_random() % 4) {
+	case 0:
+		return (ast_random() % 2) ? SHRT_MAX : SHRT_MIN;
+	case 1:
+		return (ast_random() % 2) ? SHRT_MAX - (ast_random() % 64) : SHRT_MIN + (ast_random() % 64);
+	default:
+		return (int16_t) (ast_random() & 0xffff);
+	}
+}
+
+AST_TEST_DEFINE(softmix_mixing_kernels)
+{
+	const struct softmix_mixing_kernel *scalar = softmix_mixing_kernel_get(0);
+	const struct softmix_mixing_kernel *kernel;
+	int16_t expected[TEST_MIX_SAMPLES + 31];
+	int16_t actual[TEST_MIX_SAMPLES + 31];
+	int16_t src[TEST_MIX_SAMPLES + 31];
+	unsigned int index;
+	unsigned int samples;
+	unsigned int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mixing_kernels";
+		info->category = "/bridges/bridge_softmix/";
+		info->summary = "Test the softmix mixing kernels";
+		info->description =
+			"Compares every mixing kernel the CPU supports against the scalar\n"
+			"saturating add and subtract, including unaligned buffers and tails.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (index = 1; (kernel = softmix_mixing_kernel_get(index)); index++) {
+		if (!kernel->supported()) {
+			ast_test_status_update(test, "Kernel '%s' not supported by this CPU, skipping\n",
+				kernel->name);
+			continue;
+		}
+
+		for (samples = 0; samples < ARRAY_LEN(src); samples += (samples < 40) ? 1 : 83) {
+			unsigned int offset = samples % 3;
+
+			for (i = 0; i < samples; i++) {
+				expected[i] = test_random_sample();
+				src[i] = test_random_sample();
+			}
+			memcpy(actual + offset, expected, samples * sizeof(*actual));
+
+			scalar->add(expected, src, samples);
+			kernel->add(actual + offset, src, samples);
+			if (memcmp(expected, actual + offset, samples * sizeof(*actual))) {
+				ast_test_status_update(test, "Kernel '%s' add differs from scalar with %u samples\n",
+					kernel->name, samples);
+				return AST_TEST_FAIL;
+			}
+
+			scalar->subtract(expected, src, samples);
+			kernel->subtract(actual + offset, src, samples);
+			if (memcmp(expected, actual + offset, samples * sizeof(*actual))) {
+				ast_test_status_update(test, "Kernel '%s' subtract differs from scalar with %u samples\n",
+					kernel->name, samples);
+				return AST_TEST_FAIL;
+			}
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(softmix_mixing_benchmark)
+{
+	const struct softmix_mixing_kernel *kernel;
+	int16_t (*participants)[TEST_MIX_SAMPLES];
+	int16_t mix[TEST_MIX_SAMPLES];
+	int16_t out[TEST_MIX_SAMPLES];
+	int64_t scalar_us = 0;
+	unsigned int index;
+	unsigned int i;
+	unsigned int j;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "mixing_benchmark";
+		info->category = "/bridges/bridge_softmix/";
+		info->summary = "Benchmark the softmix mixing kernels";
+		info->description =
+			"Times mixing a 200 participant 48kHz conference with each supported\n"
+			"kernel and reports the speedup over the scalar kernel.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	participants = ast_malloc(sizeof(*participants) * TEST_MIX_PARTICIPANTS);
+	if (!participants) {
+		return AST_TEST_FAIL;
+	}
+	for (i = 0; i < TEST_MIX_PARTICIPANTS; i++) {
+		for (j = 0; j < TEST_MIX_SAMPLES; j++) {
+			participants[i][j] = (int16_t) (ast_random() & 0xffff) / 8;
+		}
+	}
+
+	for (index = 0; (kernel = softmix_mixing_kernel_get(index)); index++) {
+		struct timeval start;
+		int64_t elapsed;
+		unsigned int iteration;
+
+		if (!kernel->supported()) {
+			continue;
+		}
+
+		start = ast_tvnow();
+		for (iteration = 0; iteration < TEST_MIX_ITERATIONS; iteration++) {
+			/* Same work the mixing thread does each interval. */
+			memset(mix, 0, sizeof(mix));
+			for (i = 0; i < TEST_MIX_PARTICIPANTS; i++) {
+				kernel->add(mix, participants[i], TEST_MIX_SAMPLES);
+			}
+			for (i = 0; i < TEST_MIX_PARTICIPANTS; i++) {
+				memcpy(out, mix, sizeof(out));
+				kernel->subtract(out, participants[i], TEST_MIX_SAMPLES);
+			}
+		}
+		elapsed = MAX(ast_tvdiff_us(ast_tvnow(), start), 1);
+		if (!index) {
+			scalar_us = elapsed;
+		}
+
+		ast_test_status_update(test, "%-6s: %6" PRId64 " usec per interval, %.2fx scalar\n",
+			kernel->name, elapsed / TEST_MIX_ITERATIONS, (double) scalar_us / elapsed);
+	}
+
+	ast_free(participants);
+
+	return AST_TEST_PASS;
+}
+#endif
+
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(softmix_mixing_kernels);
+	AST_TEST_UNREGISTER(softmix_mixing_benchmark);
 	ast_bridge_technology_unregister(&softmix_bridge);
 	return 0;
 }
 
 static int load_module(void)
 {
+	ast_debug(1, "Using the %s softmix mixing kernel\n", softmix_mixing_kernel_init()->name);
+
 	if (ast_bridge_technology_register(&softmix_bridge)) {
 		unload_module();
 		return AST_MODULE_LOAD_DECLINE;
 	}
+	AST_TEST_REGISTER(softmix_mixing_kernels);
+	AST_TEST_REGISTER(softmix_mixing_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
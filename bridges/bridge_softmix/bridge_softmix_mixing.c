@@ -0,0 +1,197 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Saturating signed linear mixing kernels for bridge_softmix
+ *
+ * The mixing thread spends nearly all of its time adding and subtracting
+ * signed linear buffers.  Those loops map directly onto the saturating
+ * 16-bit vector instructions most CPUs provide, so a kernel for each
+ * instruction set is compiled in and the best one the running CPU
+ * supports is picked when the module loads.
+ *
+ * \ingroup bridges
+ */
+
+#include "asterisk.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SOFTMIX_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define SOFTMIX_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+#include "asterisk/utils.h"
+
+#include "include/bridge_softmix_mixing.h"
+
+static int scalar_supported(void)
+{
+	return 1;
+}
+
+static void scalar_add(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; i++) {
+		ast_slinear_saturated_add(&dst[i], (int16_t *) &src[i]);
+	}
+}
+
+static void scalar_subtract(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; i++) {
+		ast_slinear_saturated_subtract(&dst[i], (int16_t *) &src[i]);
+	}
+}
+
+#ifdef SOFTMIX_HAVE_X86
+static int sse2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+static void __attribute__((target("sse2"))) sse2_add(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) &dst[i]);
+		__m128i b = _mm_loadu_si128((const __m128i *) &src[i]);
+
+		_mm_storeu_si128((__m128i *) &dst[i], _mm_adds_epi16(a, b));
+	}
+	scalar_add(dst + i, src + i, samples - i);
+}
+
+static void __attribute__((target("sse2"))) sse2_subtract(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i a = _mm_loadu_si128((const __m128i *) &dst[i]);
+		__m128i b = _mm_loadu_si128((const __m128i *) &src[i]);
+
+		_mm_storeu_si128((__m128i *) &dst[i], _mm_subs_epi16(a, b));
+	}
+	scalar_subtract(dst + i, src + i, samples - i);
+}
+
+static int avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static void __attribute__((target("avx2"))) avx2_add(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) &dst[i]);
+		__m256i b = _mm256_loadu_si256((const __m256i *) &src[i]);
+
+		_mm256_storeu_si256((__m256i *) &dst[i], _mm256_adds_epi16(a, b));
+	}
+	scalar_add(dst + i, src + i, samples - i);
+}
+
+static void __attribute__((target("avx2"))) avx2_subtract(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i a = _mm256_loadu_si256((const __m256i *) &dst[i]);
+		__m256i b = _mm256_loadu_si256((const __m256i *) &src[i]);
+
+		_mm256_storeu_si256((__m256i *) &dst[i], _mm256_subs_epi16(a, b));
+	}
+	scalar_subtract(dst + i, src + i, samples - i);
+}
+#endif /* SOFTMIX_HAVE_X86 */
+
+#ifdef SOFTMIX_HAVE_NEON
+/* NEON is part of the baseline when the compiler was told to use it. */
+static int neon_supported(void)
+{
+	return 1;
+}
+
+static void neon_add(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		vst1q_s16(&dst[i], vqaddq_s16(vld1q_s16(&dst[i]), vld1q_s16(&src[i])));
+	}
+	scalar_add(dst + i, src + i, samples - i);
+}
+
+static void neon_subtract(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		vst1q_s16(&dst[i], vqsubq_s16(vld1q_s16(&dst[i]), vld1q_s16(&src[i])));
+	}
+	scalar_subtract(dst + i, src + i, samples - i);
+}
+#endif /* SOFTMIX_HAVE_NEON */
+
+/*! \brief Compiled in kernels, from least to most preferred */
+static const struct softmix_mixing_kernel kernels[] = {
+	{ "scalar", scalar_supported, scalar_add, scalar_subtract },
+#ifdef SOFTMIX_HAVE_X86
+	{ "sse2", sse2_supported, sse2_add, sse2_subtract },
+	{ "avx2", avx2_supported, avx2_add, avx2_subtract },
+#endif
+#ifdef SOFTMIX_HAVE_NEON
+	{ "neon", neon_supported, neon_add, neon_subtract },
+#endif
+};
+
+const struct softmix_mixing_kernel *softmix_mixing = &kernels[0];
+
+const struct softmix_mixing_kernel *softmix_mixing_kernel_init(void)
+{
+	int i;
+
+	for (i = ARRAY_LEN(kernels) - 1; i > 0; i--) {
+		if (kernels[i].supported()) {
+			break;
+		}
+	}
+	softmix_mixing = &kernels[i];
+
+	return softmix_mixing;
+}
+
+const struct softmix_mixing_kernel *softmix_mixing_kernel_get(unsigned int index)
+{
+	if (index >= ARRAY_LEN(kernels)) {
+		return NULL;
+	}
+	return &kernels[index];
+}
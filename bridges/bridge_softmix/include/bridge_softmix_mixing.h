@@ -0,0 +1,91 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Saturating signed linear mixing kernels for bridge_softmix
+ *
+ * \ingroup bridges
+ */
+
+#ifndef _ASTERISK_BRIDGE_SOFTMIX_MIXING_H
+#define _ASTERISK_BRIDGE_SOFTMIX_MIXING_H
+
+/*!
+ * \brief A set of saturating mixing routines for one instruction set
+ *
+ * Every kernel produces exactly the same output as looping over the
+ * samples with ast_slinear_saturated_add() and
+ * ast_slinear_saturated_subtract().
+ */
+struct softmix_mixing_kernel {
+	/*! Name of the instruction set the kernel uses */
+	const char *name;
+	/*! Non-zero if the running CPU can execute this kernel */
+	int (*supported)(void);
+	/*!
+	 * \brief Add samples to a buffer, saturating on overflow
+	 *
+	 * \param dst Buffer to add the samples into
+	 * \param src Samples to add
+	 * \param samples Number of samples
+	 */
+	void (*add)(int16_t *dst, const int16_t *src, unsigned int samples);
+	/*!
+	 * \brief Subtract samples from a buffer, saturating on overflow
+	 *
+	 * \param dst Buffer to subtract the samples from
+	 * \param src Samples to subtract
+	 * \param samples Number of samples
+	 */
+	void (*subtract)(int16_t *dst, const int16_t *src, unsigned int samples);
+};
+
+/*! \brief The kernel used by the mixing thread, set by softmix_mixing_kernel_init() */
+extern const struct softmix_mixing_kernel *softmix_mixing;
+
+/*!
+ * \brief Select the fastest kernel the running CPU supports
+ *
+ * \return The selected kernel, which is also stored in \ref softmix_mixing
+ */
+const struct softmix_mixing_kernel *softmix_mixing_kernel_init(void);
+
+/*!
+ * \brief Get a kernel compiled into the module by index
+ *
+ * Index 0 is always the portable scalar kernel.
+ *
+ * \param index Index of the kernel
+ *
+ * \retval NULL if there is no kernel at \a index
+ * \retval non-NULL the kernel, which may not be supported by the running CPU
+ */
+const struct softmix_mixing_kernel *softmix_mixing_kernel_get(unsigned int index);
+
+/*! \brief Mix \a src into \a dst with the selected kernel */
+static force_inline void softmix_mix_add(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	softmix_mixing->add(dst, src, samples);
+}
+
+/*! \brief Remove \a src from \a dst with the selected kernel */
+static force_inline void softmix_mix_subtract(int16_t *dst, const int16_t *src, unsigned int samples)
+{
+	softmix_mixing->subtract(dst, src, samples);
+}
+
+#endif /* _ASTERISK_BRIDGE_SOFTMIX_MIXING_H */
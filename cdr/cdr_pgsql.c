@@ -59,6 +59,9 @@
 
 #define DATE_FORMAT "'%Y-%m-%d %T'"
 
+/*! \brief The most records inserted by a single INSERT statement */
+#define MAX_INSERT_ROWS 256
+
 static const char name[] = "pgsql";
 static const char config[] = "cdr_pgsql.conf";
 
@@ -105,10 +108,8 @@ static AST_RWLIST_HEAD_STATIC(psql_columns, columns);
 				if (ast_str_strlen(var_sql) + size + 1 > ast_str_size(var_sql)) { \
 					if (ast_str_make_space(&var_sql, ((ast_str_size(var_sql) + size + 3) / 512 + 1) * 512) != 0) { \
 						ast_log(LOG_ERROR, "Unable to allocate sufficient memory. Insert CDR '%s:%s' failed.\n", pghostname, table); \
-						ast_free(sql); \
-						ast_free(sql2); \
-						AST_RWLIST_UNLOCK(&psql_columns); \
-						ast_mutex_unlock(&pgsql_lock); \
+						*columns = sql; \
+						*values = sql2; \
 						return -1; \
 					} \
 				} \
@@ -197,11 +198,176 @@ static void pgsql_reconnect(void)
 	ast_free(conn_info);
 }
 
-static int pgsql_log(struct ast_cdr *cdr)
+/*!
+ * \internal
+ * \brief Format the columns and values of a CDR for an INSERT
+ *
+ * \param cdr The CDR to format
+ * \param columns Set to the comma separated, quoted column names
+ * \param values Set to the parenthesized, comma separated values
+ *
+ * \note Must be called with pgsql_lock and the psql_columns list lock held
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int pgsql_format_row(struct ast_cdr *cdr, struct ast_str **columns, struct ast_str **values)
 {
+	struct ast_str *sql = *columns, *sql2 = *values;
 	struct ast_tm tm;
+	struct columns *cur;
+	char buf[257], escapebuf[513], *value;
+	char *separator = "";
+
+	ast_str_reset(sql);
+	ast_str_set(&sql2, 0, "(");
+
+	AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
+		/* For fields not set, simply skip them */
+		ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
+		if (strcmp(cur->name, "calldate") == 0 && !value) {
+			ast_cdr_format_var(cdr, "start", &value, buf, sizeof(buf), 0);
+		}
+		if (!value) {
+			if (cur->notnull && !cur->hasdefault) {
+				/* Field is NOT NULL (but no default), must include it anyway */
+				LENGTHEN_BUF1(strlen(cur->name) + 2);
+				ast_str_append(&sql, 0, "%s\"%s\"", separator, cur->name);
+				LENGTHEN_BUF2(3);
+				ast_str_append(&sql2, 0, "%s''", separator);
+				separator = ", ";
+			}
+			continue;
+		}
+
+		LENGTHEN_BUF1(strlen(cur->name) + 2);
+		ast_str_append(&sql, 0, "%s\"%s\"", separator, cur->name);
+
+		if (strcmp(cur->name, "start") == 0 || strcmp(cur->name, "calldate") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				LENGTHEN_BUF2(13);
+				ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->start.tv_sec);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->start.tv_sec + (double)cdr->start.tv_usec / 1000000.0);
+			} else {
+				/* char, hopefully */
+				LENGTHEN_BUF2(31);
+				ast_localtime(&cdr->start, &tm, tz);
+				ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
+				ast_str_append(&sql2, 0, "%s%s", separator, buf);
+			}
+		} else if (strcmp(cur->name, "answer") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				LENGTHEN_BUF2(13);
+				ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->answer.tv_sec);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->answer.tv_sec + (double)cdr->answer.tv_usec / 1000000.0);
+			} else {
+				/* char, hopefully */
+				LENGTHEN_BUF2(31);
+				ast_localtime(&cdr->answer, &tm, tz);
+				ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
+				ast_str_append(&sql2, 0, "%s%s", separator, buf);
+			}
+		} else if (strcmp(cur->name, "end") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				LENGTHEN_BUF2(13);
+				ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->end.tv_sec);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->end.tv_sec + (double)cdr->end.tv_usec / 1000000.0);
+			} else {
+				/* char, hopefully */
+				LENGTHEN_BUF2(31);
+				ast_localtime(&cdr->end, &tm, tz);
+				ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
+				ast_str_append(&sql2, 0, "%s%s", separator, buf);
+			}
+		} else if (strcmp(cur->name, "duration") == 0 || strcmp(cur->name, "billsec") == 0) {
+			if (cur->type[0] == 'i') {
+				/* Get integer, no need to escape anything */
+				ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
+				LENGTHEN_BUF2(13);
+				ast_str_append(&sql2, 0, "%s%s", separator, value);
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				struct timeval *when = cur->name[0] == 'd' ? &cdr->start : ast_tvzero(cdr->answer) ? &cdr->end : &cdr->answer;
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s%f", separator, (double) (ast_tvdiff_us(cdr->end, *when) / 1000000.0));
+			} else {
+				/* Char field, probably */
+				struct timeval *when = cur->name[0] == 'd' ? &cdr->start : ast_tvzero(cdr->answer) ? &cdr->end : &cdr->answer;
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s'%f'", separator, (double) (ast_tvdiff_us(cdr->end, *when) / 1000000.0));
+			}
+		} else if (strcmp(cur->name, "disposition") == 0 || strcmp(cur->name, "amaflags") == 0) {
+			if (strncmp(cur->type, "int", 3) == 0) {
+				/* Integer, no need to escape anything */
+				ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 1);
+				LENGTHEN_BUF2(13);
+				ast_str_append(&sql2, 0, "%s%s", separator, value);
+			} else {
+				/* Although this is a char field, there are no special characters in the values for these fields */
+				ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
+				LENGTHEN_BUF2(31);
+				ast_str_append(&sql2, 0, "%s'%s'", separator, value);
+			}
+		} else {
+			/* Arbitrary field, could be anything */
+			ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
+			if (strncmp(cur->type, "int", 3) == 0) {
+				long long whatever;
+				if (value && sscanf(value, "%30lld", &whatever) == 1) {
+					LENGTHEN_BUF2(26);
+					ast_str_append(&sql2, 0, "%s%lld", separator, whatever);
+				} else {
+					LENGTHEN_BUF2(2);
+					ast_str_append(&sql2, 0, "%s0", separator);
+				}
+			} else if (strncmp(cur->type, "float", 5) == 0) {
+				long double whatever;
+				if (value && sscanf(value, "%30Lf", &whatever) == 1) {
+					LENGTHEN_BUF2(51);
+					ast_str_append(&sql2, 0, "%s%30Lf", separator, whatever);
+				} else {
+					LENGTHEN_BUF2(2);
+					ast_str_append(&sql2, 0, "%s0", separator);
+				}
+			/* XXX Might want to handle dates, times, and other misc fields here XXX */
+			} else {
+				if (value)
+					PQescapeStringConn(conn, escapebuf, value, strlen(value), NULL);
+				else
+					escapebuf[0] = '\0';
+				LENGTHEN_BUF2(strlen(escapebuf) + 3);
+				ast_str_append(&sql2, 0, "%s'%s'", separator, escapebuf);
+			}
+		}
+		separator = ", ";
+	}
+
+	ast_str_append(&sql2, 0, ")");
+
+	*columns = sql;
+	*values = sql2;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Insert CDRs into the database
+ *
+ * Consecutive records that set the same columns are inserted by a single
+ * multi-row INSERT, and all of the statements are sent at once so that
+ * they run in one transaction.
+ */
+static int pgsql_log_batch(struct ast_cdr **cdrs, size_t count)
+{
 	char *pgerror;
 	PGresult *result;
+	size_t i;
+	int res = 0;
 
 	ast_mutex_lock(&pgsql_lock);
 
@@ -229,151 +395,51 @@ static int pgsql_log(struct ast_cdr *cdr)
 	}
 
 	if (connected) {
-		struct columns *cur;
-		struct ast_str *sql = ast_str_create(maxsize), *sql2 = ast_str_create(maxsize2);
-		char buf[257], escapebuf[513], *value;
-		char *separator = "";
-
-		if (!sql || !sql2) {
+		struct ast_str *sql = ast_str_create(maxsize);
+		struct ast_str *columns = ast_str_create(maxsize2);
+		struct ast_str *values = ast_str_create(maxsize2);
+		struct ast_str *insert_columns = ast_str_create(maxsize2);
+		int rows = 0;
+		int inserted = 0;
+
+		if (!sql || !columns || !values || !insert_columns) {
 			ast_free(sql);
-			ast_free(sql2);
+			ast_free(columns);
+			ast_free(values);
+			ast_free(insert_columns);
+			ast_mutex_unlock(&pgsql_lock);
 			return -1;
 		}
 
-		ast_str_set(&sql, 0, "INSERT INTO %s (", table);
-		ast_str_set(&sql2, 0, " VALUES (");
-
 		AST_RWLIST_RDLOCK(&psql_columns);
-		AST_RWLIST_TRAVERSE(&psql_columns, cur, list) {
-			/* For fields not set, simply skip them */
-			ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
-			if (strcmp(cur->name, "calldate") == 0 && !value) {
-				ast_cdr_format_var(cdr, "start", &value, buf, sizeof(buf), 0);
-			}
-			if (!value) {
-				if (cur->notnull && !cur->hasdefault) {
-					/* Field is NOT NULL (but no default), must include it anyway */
-					LENGTHEN_BUF1(strlen(cur->name) + 2);
-					ast_str_append(&sql, 0, "%s\"%s\"", separator, cur->name);
-					LENGTHEN_BUF2(3);
-					ast_str_append(&sql2, 0, "%s''", separator);
-					separator = ", ";
-				}
+		for (i = 0; i < count; i++) {
+			if (pgsql_format_row(cdrs[i], &columns, &values)) {
+				res = -1;
 				continue;
 			}
 
-			LENGTHEN_BUF1(strlen(cur->name) + 2);
-			ast_str_append(&sql, 0, "%s\"%s\"", separator, cur->name);
-
-			if (strcmp(cur->name, "start") == 0 || strcmp(cur->name, "calldate") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->start.tv_sec);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->start.tv_sec + (double)cdr->start.tv_usec / 1000000.0);
-				} else {
-					/* char, hopefully */
-					LENGTHEN_BUF2(31);
-					ast_localtime(&cdr->start, &tm, tz);
-					ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
-					ast_str_append(&sql2, 0, "%s%s", separator, buf);
-				}
-			} else if (strcmp(cur->name, "answer") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->answer.tv_sec);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->answer.tv_sec + (double)cdr->answer.tv_usec / 1000000.0);
-				} else {
-					/* char, hopefully */
-					LENGTHEN_BUF2(31);
-					ast_localtime(&cdr->answer, &tm, tz);
-					ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
-					ast_str_append(&sql2, 0, "%s%s", separator, buf);
-				}
-			} else if (strcmp(cur->name, "end") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%ld", separator, (long) cdr->end.tv_sec);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", separator, (double)cdr->end.tv_sec + (double)cdr->end.tv_usec / 1000000.0);
-				} else {
-					/* char, hopefully */
-					LENGTHEN_BUF2(31);
-					ast_localtime(&cdr->end, &tm, tz);
-					ast_strftime(buf, sizeof(buf), DATE_FORMAT, &tm);
-					ast_str_append(&sql2, 0, "%s%s", separator, buf);
-				}
-			} else if (strcmp(cur->name, "duration") == 0 || strcmp(cur->name, "billsec") == 0) {
-				if (cur->type[0] == 'i') {
-					/* Get integer, no need to escape anything */
-					ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%s", separator, value);
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					struct timeval *when = cur->name[0] == 'd' ? &cdr->start : ast_tvzero(cdr->answer) ? &cdr->end : &cdr->answer;
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s%f", separator, (double) (ast_tvdiff_us(cdr->end, *when) / 1000000.0));
-				} else {
-					/* Char field, probably */
-					struct timeval *when = cur->name[0] == 'd' ? &cdr->start : ast_tvzero(cdr->answer) ? &cdr->end : &cdr->answer;
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s'%f'", separator, (double) (ast_tvdiff_us(cdr->end, *when) / 1000000.0));
-				}
-			} else if (strcmp(cur->name, "disposition") == 0 || strcmp(cur->name, "amaflags") == 0) {
-				if (strncmp(cur->type, "int", 3) == 0) {
-					/* Integer, no need to escape anything */
-					ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 1);
-					LENGTHEN_BUF2(13);
-					ast_str_append(&sql2, 0, "%s%s", separator, value);
-				} else {
-					/* Although this is a char field, there are no special characters in the values for these fields */
-					ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
-					LENGTHEN_BUF2(31);
-					ast_str_append(&sql2, 0, "%s'%s'", separator, value);
-				}
+			if (rows && (rows == MAX_INSERT_ROWS
+				|| strcmp(ast_str_buffer(columns), ast_str_buffer(insert_columns)))) {
+				ast_str_append(&sql, 0, "; ");
+				rows = 0;
+			}
+			if (!rows) {
+				ast_str_append(&sql, 0, "INSERT INTO %s (%s) VALUES %s",
+					table, ast_str_buffer(columns), ast_str_buffer(values));
+				ast_str_set(&insert_columns, 0, "%s", ast_str_buffer(columns));
 			} else {
-				/* Arbitrary field, could be anything */
-				ast_cdr_format_var(cdr, cur->name, &value, buf, sizeof(buf), 0);
-				if (strncmp(cur->type, "int", 3) == 0) {
-					long long whatever;
-					if (value && sscanf(value, "%30lld", &whatever) == 1) {
-						LENGTHEN_BUF2(26);
-						ast_str_append(&sql2, 0, "%s%lld", separator, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", separator);
-					}
-				} else if (strncmp(cur->type, "float", 5) == 0) {
-					long double whatever;
-					if (value && sscanf(value, "%30Lf", &whatever) == 1) {
-						LENGTHEN_BUF2(51);
-						ast_str_append(&sql2, 0, "%s%30Lf", separator, whatever);
-					} else {
-						LENGTHEN_BUF2(2);
-						ast_str_append(&sql2, 0, "%s0", separator);
-					}
-				/* XXX Might want to handle dates, times, and other misc fields here XXX */
-				} else {
-					if (value)
-						PQescapeStringConn(conn, escapebuf, value, strlen(value), NULL);
-					else
-						escapebuf[0] = '\0';
-					LENGTHEN_BUF2(strlen(escapebuf) + 3);
-					ast_str_append(&sql2, 0, "%s'%s'", separator, escapebuf);
-				}
+				ast_str_append(&sql, 0, ", %s", ast_str_buffer(values));
 			}
-			separator = ", ";
+			rows++;
+			inserted++;
 		}
-
-		LENGTHEN_BUF1(ast_str_strlen(sql2) + 2);
 		AST_RWLIST_UNLOCK(&psql_columns);
-		ast_str_append(&sql, 0, ")%s)", ast_str_buffer(sql2));
 
-		ast_debug(3, "Inserting a CDR record: [%s]\n", ast_str_buffer(sql));
+		if (!inserted) {
+			goto cleanup;
+		}
+
+		ast_debug(3, "Inserting %d CDR record(s): [%s]\n", inserted, ast_str_buffer(sql));
 
 		/* Test to be sure we're still connected... */
 		/* If we're connected, and connection is working, good. */
@@ -395,10 +461,8 @@ static int pgsql_log(struct ast_cdr *cdr)
 				PQfinish(conn);
 				conn = NULL;
 				connected = 0;
-				ast_mutex_unlock(&pgsql_lock);
-				ast_free(sql);
-				ast_free(sql2);
-				return -1;
+				res = -1;
+				goto cleanup;
 			}
 		}
 		result = PQexec(conn, ast_str_buffer(sql));
@@ -417,41 +481,44 @@ static int pgsql_log(struct ast_cdr *cdr)
 				result = PQexec(conn, ast_str_buffer(sql));
 				if (PQresultStatus(result) != PGRES_COMMAND_OK) {
 					pgerror = PQresultErrorMessage(result);
-					ast_log(LOG_ERROR, "HARD ERROR!  Attempted reconnection failed.  DROPPING CALL RECORD!\n");
+					ast_log(LOG_ERROR, "HARD ERROR!  Attempted reconnection failed.  DROPPING %d CALL RECORD(S)!\n", inserted);
 					ast_log(LOG_ERROR, "Reason: %s\n", pgerror);
+					res = -1;
 				}  else {
 					/* Second try worked out ok */
-					totalrecords++;
-					records++;
-					ast_mutex_unlock(&pgsql_lock);
-					PQclear(result);
-					return 0;
+					totalrecords += inserted;
+					records += inserted;
 				}
+			} else {
+				res = -1;
 			}
-			ast_mutex_unlock(&pgsql_lock);
-			PQclear(result);
-			ast_free(sql);
-			ast_free(sql2);
-			return -1;
 		} else {
-			totalrecords++;
-			records++;
+			totalrecords += inserted;
+			records += inserted;
 		}
 		PQclear(result);
 
 		/* Next time, just allocate buffers that are that big to start with. */
-		if (ast_str_strlen(sql) > maxsize) {
+		if (inserted == 1 && ast_str_strlen(sql) > maxsize) {
 			maxsize = ast_str_strlen(sql);
 		}
-		if (ast_str_strlen(sql2) > maxsize2) {
-			maxsize2 = ast_str_strlen(sql2);
+		if (ast_str_strlen(values) > maxsize2) {
+			maxsize2 = ast_str_strlen(values);
 		}
 
+cleanup:
 		ast_free(sql);
-		ast_free(sql2);
+		ast_free(columns);
+		ast_free(values);
+		ast_free(insert_columns);
 	}
 	ast_mutex_unlock(&pgsql_lock);
-	return 0;
+	return res;
+}
+
+static int pgsql_log(struct ast_cdr *cdr)
+{
+	return pgsql_log_batch(&cdr, 1);
 }
 
 /* This function should be called without holding the pgsql_columns lock */
@@ -763,7 +830,7 @@ static int load_module(void)
 	if (config_module(0)) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
-	return ast_cdr_register(name, ast_module_info->description, pgsql_log)
+	return ast_cdr_register_batch(name, ast_module_info->description, pgsql_log, pgsql_log_batch)
 		? AST_MODULE_LOAD_DECLINE : 0;
 }
 
@@ -337,6 +337,7 @@ static int jittertargetextra = 40; /* number of milliseconds the new jitter buff
 
 static int trunkfreq = 20;
 static int trunkmaxsize = MAX_TRUNKDATA;
+static int trunkmaxdelay = 0;		/*!< Most ms a lightly loaded trunk is held to fill up, 0 to not hold */
 
 static int authdebug = 0;
 static int autokill = 0;
@@ -607,6 +608,13 @@ struct iax2_trunk_peer {
 	int trunkmaxmtu;
 	int trunkerror;
 	int calls;
+	struct timeval trunkoldest;		/*!< When the oldest call chunk in trunkdata was queued */
+	/* Transmit statistics, for iax2 show netstats */
+	unsigned int txmsgs;			/*!< Trunk messages sent */
+	unsigned int txchunks;			/*!< Call chunks sent in them */
+	uint64_t txbytes;			/*!< Trunk data bytes sent in them */
+	unsigned int txfull;			/*!< Messages sent early because they reached the MTU */
+	unsigned int txheld;			/*!< Timer ticks the trunk was held to fill up */
 	AST_LIST_ENTRY(iax2_trunk_peer) list;
 };
 
@@ -676,6 +684,8 @@ static int iaxmaxthreadcount = DEFAULT_MAX_THREAD_COUNT;
 static int iaxdynamicthreadcount = 0;
 static int iaxdynamicthreadnum = 0;
 static int iaxactivethreadcount = 0;
+static int iaxnetthreadcount = 1;
+static int iaxaffinitythreadcount = 0;
 
 struct iax_rr {
 	int jitter;
@@ -1048,10 +1058,15 @@ enum iax2_thread_iostate {
 enum iax2_thread_type {
 	IAX_THREAD_TYPE_POOL,
 	IAX_THREAD_TYPE_DYNAMIC,
+	IAX_THREAD_TYPE_AFFINITY,
 };
 
 struct iax2_pkt_buf {
 	AST_LIST_ENTRY(iax2_pkt_buf) entry;
+	/*! The address the frame came from */
+	struct ast_sockaddr addr;
+	/*! The socket the frame was read from */
+	int fd;
 	size_t len;
 	unsigned char buf[1];
 };
@@ -1095,6 +1110,8 @@ struct iax2_thread {
 	 *  a call which this thread is already processing a full frame for, they
 	 *  are queued up here. */
 	AST_LIST_HEAD_NOLOCK(, iax2_pkt_buf) full_frames;
+	/*! Number of frames in full_frames */
+	unsigned int queued;
 	unsigned char stop;
 };
 
@@ -1103,6 +1120,23 @@ static AST_LIST_HEAD_STATIC(idle_list, iax2_thread);
 static AST_LIST_HEAD_STATIC(active_list, iax2_thread);
 static AST_LIST_HEAD_STATIC(dynamic_list, iax2_thread);
 
+/*! \brief A thread reading sockets of its own, besides the network thread */
+struct iax2_net_reader {
+	pthread_t threadid;
+	struct io_context *io;
+};
+
+/*! Readers started for iaxnetthreadcount */
+static struct iax2_net_reader *net_readers;
+static int net_reader_count;
+
+/*! Threads the frames of each call are queued to, for iaxaffinitythreadcount */
+static struct iax2_thread **affinity_threads;
+static int affinity_thread_count;
+
+/*! \brief Most frames queued to an affinity thread before more are dropped */
+#define MAX_AFFINITY_QUEUE 1000
+
 static void *iax2_process_thread(void *data);
 static void iax2_destroy(int callno);
 
@@ -1464,6 +1498,8 @@ static void acl_change_stasis_subscribe(void)
 	if (!acl_change_sub) {
 		acl_change_sub = stasis_subscribe(ast_security_topic(),
 			acl_change_stasis_cb, NULL);
+		stasis_subscription_accept_message_type(acl_change_sub, ast_named_acl_change_type());
+		stasis_subscription_set_filter(acl_change_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 	}
 }
 
@@ -6281,10 +6317,22 @@ static int iax2_trunk_queue(struct chan_iax2_pvt *pvt, struct iax_frame *fr)
 	struct timeval now;
 	struct ast_iax2_meta_trunk_entry *met;
 	struct ast_iax2_meta_trunk_mini *mtm;
+	unsigned int chunklen;
 
 	f = &fr->af;
 	tpeer = find_tpeer(&pvt->addr, pvt->sockfd);
 	if (tpeer) {
+		chunklen = f->datalen + (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)
+			? sizeof(struct ast_iax2_meta_trunk_mini) : sizeof(struct ast_iax2_meta_trunk_entry));
+
+		/* Ship what we have first if this chunk would take it past the MTU */
+		if (global_max_trunk_mtu > 0 && tpeer->trunkdatalen
+			&& tpeer->trunkdatalen + chunklen > global_max_trunk_mtu) {
+			now = ast_tvnow();
+			send_trunk(tpeer, &now);
+			tpeer->txfull++;
+			trunk_untimed++;
+		}
 
 		if (tpeer->trunkdatalen + f->datalen + 4 >= tpeer->trunkdataalloc) {
 			/* Need to reallocate space */
@@ -6304,6 +6352,10 @@ static int iax2_trunk_queue(struct chan_iax2_pvt *pvt, struct iax_frame *fr)
 			}
 		}
 
+		if (!tpeer->trunkdatalen) {
+			tpeer->trunkoldest = ast_tvnow();
+		}
+
 		/* Append to meta frame */
 		ptr = tpeer->trunkdata + IAX2_TRUNK_PREFACE + tpeer->trunkdatalen;
 		if (ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)) {
@@ -6336,6 +6388,7 @@ static int iax2_trunk_queue(struct chan_iax2_pvt *pvt, struct iax_frame *fr)
 		if (global_max_trunk_mtu > 0 && tpeer->trunkdatalen + f->datalen + 4 >= global_max_trunk_mtu) {
 			now = ast_tvnow();
 			send_trunk(tpeer, &now);
+			tpeer->txfull++;
 			trunk_untimed ++;
 		}
 
@@ -7035,6 +7088,7 @@ static char *handle_cli_iax2_show_threads(struct ast_cli_entry *e, int cmd, stru
 	time_t t;
 	int threadcount = 0, dynamiccount = 0;
 	char type;
+	int x;
 
 	switch (cmd) {
 	case CLI_INIT:
@@ -7094,6 +7148,14 @@ static char *handle_cli_iax2_show_threads(struct ast_cli_entry *e, int cmd, stru
 		dynamiccount++;
 	}
 	AST_LIST_UNLOCK(&dynamic_list);
+	if (affinity_thread_count) {
+		ast_cli(a->fd, "Affinity Threads:\n");
+		for (x = 0; x < affinity_thread_count; x++) {
+			thread = affinity_threads[x];
+			ast_cli(a->fd, "Thread %d: state=%u, update=%d, actions=%d, queued=%u\n",
+				thread->threadnum, thread->iostate, (int)(t - thread->checktime), thread->actions, thread->queued);
+		}
+	}
 	ast_cli(a->fd, "%d of %d threads accounted for with %d dynamic threads\n", threadcount, iaxthreadcount, dynamiccount);
 	return CLI_SUCCESS;
 }
@@ -7552,6 +7614,38 @@ static int ast_cli_netstats(struct mansession *s, int fd, int limit_fmt)
 	return numchans;
 }
 
+/*! \brief List how full the messages sent to each trunk peer are */
+static void cli_trunk_netstats(int fd)
+{
+#define FORMAT "%-40.40s %8u %8u %6u.%u %6u %5s %6u %6u\n"
+	struct iax2_trunk_peer *tpeer;
+	unsigned int avgchunks;
+	unsigned int avgbytes;
+	char fill[8];
+	int count = 0;
+
+	ast_cli(fd, "\n%-40.40s %8s %8s %8s %6s %5s %6s %6s\n", "Trunk peer", "Msgs", "Chunks",
+		"Chunks/m", "Bytes", "MTU%", "Full", "Held");
+	AST_LIST_LOCK(&tpeers);
+	AST_LIST_TRAVERSE(&tpeers, tpeer, list) {
+		ast_mutex_lock(&tpeer->lock);
+		avgchunks = tpeer->txmsgs ? tpeer->txchunks * 10 / tpeer->txmsgs : 0;
+		avgbytes = tpeer->txmsgs ? tpeer->txbytes / tpeer->txmsgs : 0;
+		if (global_max_trunk_mtu > 0) {
+			snprintf(fill, sizeof(fill), "%u", avgbytes * 100 / global_max_trunk_mtu);
+		} else {
+			ast_copy_string(fill, "-", sizeof(fill));
+		}
+		ast_cli(fd, FORMAT, ast_sockaddr_stringify(&tpeer->addr), tpeer->txmsgs, tpeer->txchunks,
+			avgchunks / 10, avgchunks % 10, avgbytes, fill, tpeer->txfull, tpeer->txheld);
+		ast_mutex_unlock(&tpeer->lock);
+		count++;
+	}
+	AST_LIST_UNLOCK(&tpeers);
+	ast_cli(fd, "%d active IAX trunk peer%s\n", count, (count != 1) ? "s" : "");
+#undef FORMAT
+}
+
 static char *handle_cli_iax2_show_netstats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	int numchans = 0;
@@ -7572,6 +7666,7 @@ static char *handle_cli_iax2_show_netstats(struct ast_cli_entry *e, int cmd, str
 	ast_cli(a->fd, "Channel               RTT  Jit  Del  Lost   %%  Drop  OOO  Kpkts  Jit  Del  Lost   %%  Drop  OOO  Kpkts FirstMsg    LastMsg\n");
 	numchans = ast_cli_netstats(NULL, a->fd, 1);
 	ast_cli(a->fd, "%d active IAX channel%s\n", numchans, (numchans != 1) ? "s" : "");
+	cli_trunk_netstats(a->fd);
 	return CLI_SUCCESS;
 }
 
@@ -9423,6 +9518,11 @@ static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 		fr->datalen = tpeer->trunkdatalen + sizeof(struct ast_iax2_meta_hdr) + sizeof(struct ast_iax2_meta_trunk_hdr);
 		res = transmit_trunk(fr, &tpeer->addr, tpeer->sockfd);
 		calls = tpeer->calls;
+		if (res >= 0) {
+			tpeer->txmsgs++;
+			tpeer->txchunks += calls;
+			tpeer->txbytes += tpeer->trunkdatalen;
+		}
 #if 0
 		ast_debug(1, "Trunking %d call chunks in %d bytes to %s:%d, ts=%d\n", calls, fr->datalen, ast_inet_ntoa(tpeer->addr.sin_addr), ntohs(tpeer->addr.sin_port), ntohl(mth->ts));
 #endif
@@ -9435,6 +9535,25 @@ static int send_trunk(struct iax2_trunk_peer *tpeer, struct timeval *now)
 	return calls;
 }
 
+/*!
+ * \brief Whether a timer tick should leave the trunk data of a peer to fill up
+ *
+ * A trunk carrying little is held while its oldest call chunk can wait
+ * another tick within trunkmaxdelay, so fewer and fuller messages are sent.
+ * Only chunks with their own timestamps can be held, as without them the
+ * far end times every chunk of a message by the message.
+ */
+static int iax2_trunk_hold(struct iax2_trunk_peer *tpeer, struct timeval *now)
+{
+	int mtu = global_max_trunk_mtu > 0 ? global_max_trunk_mtu : MAX_TRUNK_MTU;
+
+	return trunkmaxdelay > 0
+		&& ast_test_flag64(&globalflags, IAX_TRUNKTIMESTAMPS)
+		&& tpeer->trunkdatalen
+		&& tpeer->trunkdatalen < mtu / 2
+		&& ast_tvdiff_ms(*now, tpeer->trunkoldest) + trunkfreq <= trunkmaxdelay;
+}
+
 static inline int iax2_trunk_expired(struct iax2_trunk_peer *tpeer, struct timeval *now)
 {
 	/* Drop when trunk is about 5 seconds idle */
@@ -9473,6 +9592,8 @@ static int timing_read(int *id, int fd, short events, void *cbdata)
 			   could be in use */
 			AST_LIST_REMOVE_CURRENT(list);
 			drop = tpeer;
+		} else if (iax2_trunk_hold(tpeer, &now)) {
+			tpeer->txheld++;
 		} else {
 			res = send_trunk(tpeer, &now);
 			trunk_timed++;
@@ -9702,8 +9823,11 @@ static void handle_deferred_full_frames(struct iax2_thread *thread)
 	ast_mutex_lock(&thread->lock);
 
 	while ((pkt_buf = AST_LIST_REMOVE_HEAD(&thread->full_frames, entry))) {
+		thread->queued--;
 		ast_mutex_unlock(&thread->lock);
 
+		thread->iofd = pkt_buf->fd;
+		ast_sockaddr_copy(&thread->ioaddr, &pkt_buf->addr);
 		thread->buf = pkt_buf->buf;
 		thread->buf_len = pkt_buf->len;
 		thread->buf_size = pkt_buf->len + 1;
@@ -9735,6 +9859,8 @@ static void defer_full_frame(struct iax2_thread *from_here, struct iax2_thread *
 
 	pkt_buf->len = from_here->buf_len;
 	memcpy(pkt_buf->buf, from_here->buf, pkt_buf->len);
+	pkt_buf->fd = from_here->iofd;
+	ast_sockaddr_copy(&pkt_buf->addr, &from_here->ioaddr);
 
 	fh = (struct ast_iax2_full_hdr *) pkt_buf->buf;
 	ast_mutex_lock(&to_here->lock);
@@ -9749,6 +9875,7 @@ static void defer_full_frame(struct iax2_thread *from_here, struct iax2_thread *
 
 	if (!cur_pkt_buf)
 		AST_LIST_INSERT_TAIL(&to_here->full_frames, pkt_buf, entry);
+	to_here->queued++;
 
 	to_here->iostate = IAX_IOSTATE_READY;
 	ast_cond_signal(&to_here->cond);
@@ -9756,6 +9883,69 @@ static void defer_full_frame(struct iax2_thread *from_here, struct iax2_thread *
 	ast_mutex_unlock(&to_here->lock);
 }
 
+/*!
+ * \brief Read a frame and queue it to the affinity thread of its call
+ *
+ * The frames of a call, told apart by the address they come from and the
+ * call number of the sender, always go to the same thread.  They are then
+ * processed in order without looking at what the other threads are doing.
+ */
+static int socket_read_affinity(int fd)
+{
+	unsigned char buf[4096];
+	struct ast_sockaddr addr;
+	struct iax2_pkt_buf *pkt_buf;
+	struct iax2_thread *thread;
+	unsigned int callno = 0;
+	ssize_t len;
+
+	len = ast_recvfrom(fd, buf, sizeof(buf), 0, &addr);
+	if (len < 0) {
+		if (errno != ECONNREFUSED && errno != EAGAIN)
+			ast_log(LOG_WARNING, "Error: %s\n", strerror(errno));
+		handle_error();
+		return 1;
+	}
+	if (test_losspct && ((100.0 * ast_random() / (RAND_MAX + 1.0)) < test_losspct)) { /* simulate random loss condition */
+		return 1;
+	}
+
+	/* Full and mini frames start with the call number of the sender, video
+	 * frames have it after a zero word.  Meta frames carry the frames of many
+	 * calls and are spread by their command instead. */
+	if (len >= 4) {
+		callno = ((buf[0] << 8) | buf[1]) & ~IAX_FLAG_FULL;
+		if (!callno) {
+			callno = ((buf[2] << 8) | buf[3]) & ~IAX_FLAG_FULL;
+		}
+	}
+	thread = affinity_threads[((unsigned int) ast_sockaddr_hash(&addr) ^ callno) % affinity_thread_count];
+
+	if (!(pkt_buf = ast_malloc(sizeof(*pkt_buf) + len))) {
+		return 1;
+	}
+	pkt_buf->len = len;
+	memcpy(pkt_buf->buf, buf, len);
+	pkt_buf->buf[len] = '\0';
+	pkt_buf->fd = fd;
+	ast_sockaddr_copy(&pkt_buf->addr, &addr);
+
+	ast_mutex_lock(&thread->lock);
+	if (thread->queued >= MAX_AFFINITY_QUEUE) {
+		ast_mutex_unlock(&thread->lock);
+		ast_debug(1, "IAX2 affinity thread %d is behind, dropping frame from %s\n",
+			thread->threadnum, ast_sockaddr_stringify(&addr));
+		ast_free(pkt_buf);
+		return 1;
+	}
+	AST_LIST_INSERT_TAIL(&thread->full_frames, pkt_buf, entry);
+	thread->queued++;
+	ast_cond_signal(&thread->cond);
+	ast_mutex_unlock(&thread->lock);
+
+	return 1;
+}
+
 static int socket_read(int *id, int fd, short events, void *cbdata)
 {
 	struct iax2_thread *thread;
@@ -9763,6 +9953,10 @@ static int socket_read(int *id, int fd, short events, void *cbdata)
 	static time_t last_errtime = 0;
 	struct ast_iax2_full_hdr *fh;
 
+	if (affinity_thread_count) {
+		return socket_read_affinity(fd);
+	}
+
 	if (!(thread = find_idle_thread())) {
 		time(&t);
 		if (t != last_errtime) {
@@ -11973,6 +12167,32 @@ static void iax2_process_thread_cleanup(void *data)
 	ast_atomic_dec_and_test(&iaxactivethreadcount);
 }
 
+/*! \brief Process the frames queued to an affinity thread, in the order they were read */
+static void *iax2_affinity_thread(void *data)
+{
+	struct iax2_thread *thread = data;
+
+	ast_mutex_lock(&thread->lock);
+	while (!thread->stop) {
+		if (AST_LIST_EMPTY(&thread->full_frames)) {
+			thread->iostate = IAX_IOSTATE_IDLE;
+			ast_cond_wait(&thread->cond, &thread->lock);
+			continue;
+		}
+		thread->iostate = IAX_IOSTATE_PROCESSING;
+		thread->actions++;
+		ast_mutex_unlock(&thread->lock);
+
+		handle_deferred_full_frames(thread);
+		time(&thread->checktime);
+
+		ast_mutex_lock(&thread->lock);
+	}
+	ast_mutex_unlock(&thread->lock);
+
+	return NULL;
+}
+
 static void *iax2_process_thread(void *data)
 {
 	struct iax2_thread *thread = data;
@@ -12558,9 +12778,12 @@ static struct ast_channel *iax2_request(const char *type, struct ast_format_cap
 	return c;
 }
 
-static void *network_thread(void *ignore)
+static void *network_thread(void *data)
 {
-	if (timer) {
+	struct io_context *ioc = data;
+
+	/* The trunk timer is only watched by the network thread, not the readers */
+	if (ioc == io && timer) {
 		ast_io_add(io, ast_timer_fd(timer), timing_read, AST_IO_IN | AST_IO_PRI, NULL);
 	}
 
@@ -12569,7 +12792,7 @@ static void *network_thread(void *ignore)
 		/* Wake up once a second just in case SIGURG was sent while
 		 * we weren't in poll(), to make sure we don't hang when trying
 		 * to unload. */
-		if (ast_io_wait(io, 1000) <= 0) {
+		if (ast_io_wait(ioc, 1000) <= 0) {
 			break;
 		}
 	}
@@ -12577,6 +12800,78 @@ static void *network_thread(void *ignore)
 	return NULL;
 }
 
+static void stop_network_thread(pthread_t *threadid)
+{
+	if (*threadid != AST_PTHREADT_NULL) {
+		pthread_cancel(*threadid);
+		pthread_kill(*threadid, SIGURG);
+		pthread_join(*threadid, NULL);
+		*threadid = AST_PTHREADT_NULL;
+	}
+}
+
+static int start_affinity_threads(void)
+{
+	struct iax2_thread *thread;
+	int x;
+
+	if (!iaxaffinitythreadcount
+		|| !(affinity_threads = ast_calloc(iaxaffinitythreadcount, sizeof(*affinity_threads)))) {
+		return 0;
+	}
+
+	for (x = 0; x < iaxaffinitythreadcount; x++) {
+		if (!(thread = ast_calloc(1, sizeof(*thread)))) {
+			break;
+		}
+		thread->type = IAX_THREAD_TYPE_AFFINITY;
+		thread->threadnum = x + 1;
+		ast_mutex_init(&thread->lock);
+		ast_cond_init(&thread->cond, NULL);
+		if (ast_pthread_create_background(&thread->threadid, NULL, iax2_affinity_thread, thread)) {
+			ast_log(LOG_WARNING, "Failed to create new thread!\n");
+			ast_mutex_destroy(&thread->lock);
+			ast_cond_destroy(&thread->cond);
+			ast_free(thread);
+			break;
+		}
+		affinity_threads[x] = thread;
+	}
+
+	/* Only dispatch to the threads once they all run */
+	affinity_thread_count = x;
+
+	return x;
+}
+
+static void stop_affinity_threads(void)
+{
+	struct iax2_pkt_buf *pkt_buf;
+	struct iax2_thread *thread;
+	int x;
+	int count = affinity_thread_count;
+
+	affinity_thread_count = 0;
+	for (x = 0; x < count; x++) {
+		thread = affinity_threads[x];
+
+		ast_mutex_lock(&thread->lock);
+		thread->stop = 1;
+		ast_cond_signal(&thread->cond);
+		ast_mutex_unlock(&thread->lock);
+		pthread_join(thread->threadid, NULL);
+
+		while ((pkt_buf = AST_LIST_REMOVE_HEAD(&thread->full_frames, entry))) {
+			ast_free(pkt_buf);
+		}
+		ast_mutex_destroy(&thread->lock);
+		ast_cond_destroy(&thread->cond);
+		ast_free(thread);
+	}
+	ast_free(affinity_threads);
+	affinity_threads = NULL;
+}
+
 static int start_network_thread(void)
 {
 	struct iax2_thread *thread;
@@ -12616,10 +12911,19 @@ static int start_network_thread(void)
 			AST_LIST_UNLOCK(&idle_list);
 		}
 	}
-	if (ast_pthread_create_background(&netthreadid, NULL, network_thread, NULL)) {
+	if (start_affinity_threads()) {
+		ast_verb(2, "%d affinity threads started\n", affinity_thread_count);
+	}
+	if (ast_pthread_create_background(&netthreadid, NULL, network_thread, io)) {
 		ast_log(LOG_ERROR, "Failed to create new thread!\n");
 		return -1;
 	}
+	for (x = 0; x < net_reader_count; x++) {
+		if (ast_pthread_create_background(&net_readers[x].threadid, NULL, network_thread, net_readers[x].io)) {
+			ast_log(LOG_WARNING, "Failed to create new thread!\n");
+			net_readers[x].threadid = AST_PTHREADT_NULL;
+		}
+	}
 	ast_verb(2, "%d helper threads started\n", threadcount);
 	return 0;
 }
@@ -13436,6 +13740,7 @@ static void set_config_destroy(void)
 	strcpy(mohinterpret, "");
 	strcpy(mohsuggest, "");
 	trunkmaxsize = MAX_TRUNKDATA;
+	trunkmaxdelay = 0;
 	amaflags = 0;
 	delayreject = 0;
 	ast_clear_flag64((&globalflags), IAX_NOTRANSFER | IAX_TRANSFERMEDIA | IAX_USEJITTERBUF |
@@ -13445,6 +13750,76 @@ static void set_config_destroy(void)
 	ao2_callback(calltoken_ignores, OBJ_NODATA, addr_range_delme_cb, NULL);
 }
 
+/*!
+ * \brief Create the io contexts of the readers for iaxnetthreadcount
+ *
+ * This runs before any binding is applied, since every binding needs a
+ * socket for each reader.  The readers are started with the network thread.
+ */
+static void start_net_readers(const char *value)
+{
+	int x;
+
+	if (value) {
+		iaxnetthreadcount = atoi(value);
+		if (iaxnetthreadcount < 1) {
+			ast_log(LOG_NOTICE, "iaxnetthreadcount must be at least 1.\n");
+			iaxnetthreadcount = 1;
+		} else if (iaxnetthreadcount > 64) {
+			ast_log(LOG_NOTICE, "limiting iaxnetthreadcount to 64\n");
+			iaxnetthreadcount = 64;
+		}
+	}
+
+	if (iaxnetthreadcount < 2
+		|| !(net_readers = ast_calloc(iaxnetthreadcount - 1, sizeof(*net_readers)))) {
+		return;
+	}
+
+	for (x = 0; x < iaxnetthreadcount - 1; x++) {
+		if (!(net_readers[x].io = io_context_create())) {
+			ast_log(LOG_WARNING, "Failed to create I/O context\n");
+			break;
+		}
+		net_readers[x].threadid = AST_PTHREADT_NULL;
+	}
+	net_reader_count = x;
+}
+
+/*!
+ * \brief Bind an address to listen on
+ *
+ * With readers, the network thread and every reader get a socket of their
+ * own bound to the address, and the kernel spreads the peers sending to it
+ * across them.
+ */
+static struct ast_netsock *iax2_bindaddr(struct ast_sockaddr *addr)
+{
+	struct ast_netsock *ns;
+	struct ast_netsock *reader_ns;
+	int x;
+
+	if (!net_reader_count) {
+		return ast_netsock_bindaddr(netsock, io, addr, qos.tos, qos.cos, socket_read, NULL);
+	}
+
+	if (!(ns = ast_netsock_bindaddr_shared(netsock, io, addr, qos.tos, qos.cos, socket_read, NULL))) {
+		ast_log(LOG_WARNING, "Unable to share %s between IAX2 network threads, only one will read it\n",
+			ast_sockaddr_stringify(addr));
+		return ast_netsock_bindaddr(netsock, io, addr, qos.tos, qos.cos, socket_read, NULL);
+	}
+
+	for (x = 0; x < net_reader_count; x++) {
+		reader_ns = ast_netsock_bindaddr_shared(netsock, net_readers[x].io, addr, qos.tos, qos.cos, socket_read, NULL);
+		if (!reader_ns) {
+			break;
+		}
+		ast_netsock_unref(reader_ns);
+	}
+
+	return ns;
+}
+
 /*! \brief Load configuration */
 static int set_config(const char *config_file, int reload, int forced)
 {
@@ -13543,6 +13918,10 @@ static int set_config(const char *config_file, int reload, int forced)
 		if (ast_str2cos(tosval, &qos.cos))
 			ast_log(LOG_WARNING, "Invalid cos value, refer to QoS documentation\n");
 	}
+	if (!reload) {
+		start_net_readers(ast_variable_retrieve(cfg, "general", "iaxnetthreadcount"));
+	}
+
 	while(v) {
 		if (!strcasecmp(v->name, "bindport")) {
 			if (reload) {
@@ -13568,6 +13947,25 @@ static int set_config(const char *config_file, int reload, int forced)
 					iaxthreadcount = 256;
 				}
 			}
+		} else if (!strcasecmp(v->name, "iaxnetthreadcount")) {
+			/* Read before the bindings, see start_net_readers() */
+			if (reload && atoi(v->value) != iaxnetthreadcount) {
+				ast_log(LOG_NOTICE, "Ignoring any changes to iaxnetthreadcount during reload\n");
+			}
+		} else if (!strcasecmp(v->name, "iaxaffinitythreadcount")) {
+			if (reload) {
+				if (atoi(v->value) != iaxaffinitythreadcount)
+					ast_log(LOG_NOTICE, "Ignoring any changes to iaxaffinitythreadcount during reload\n");
+			} else {
+				iaxaffinitythreadcount = atoi(v->value);
+				if (iaxaffinitythreadcount < 0) {
+					ast_log(LOG_NOTICE, "iaxaffinitythreadcount must be 0 or higher.\n");
+					iaxaffinitythreadcount = 0;
+				} else if (iaxaffinitythreadcount > 256) {
+					ast_log(LOG_NOTICE, "limiting iaxaffinitythreadcount to 256\n");
+					iaxaffinitythreadcount = 256;
+				}
+			}
 		} else if (!strcasecmp(v->name, "iaxmaxthreadcount")) {
 			if (reload) {
 				AST_LIST_LOCK(&dynamic_list);
@@ -13621,7 +14019,7 @@ static int set_config(const char *config_file, int reload, int forced)
 						ast_sockaddr_set_port(&bindaddr, portno);
 					}
 
-					if (!(ns = ast_netsock_bindaddr(netsock, io, &bindaddr, qos.tos, qos.cos, socket_read, NULL))) {
+					if (!(ns = iax2_bindaddr(&bindaddr))) {
 						ast_log(LOG_WARNING, "Unable to apply binding to '%s' at line %d\n", v->value, v->lineno);
 					} else {
 						ast_verb(2, "Binding IAX2 to address %s\n", ast_sockaddr_stringify(&bindaddr));
@@ -13703,6 +14101,11 @@ static int set_config(const char *config_file, int reload, int forced)
 			if (timer) {
 				ast_timer_set_rate(timer, 1000 / trunkfreq);
 			}
+		} else if (!strcasecmp(v->name, "trunkmaxdelay")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &trunkmaxdelay, 0, 1000)) {
+				ast_log(LOG_NOTICE, "trunkmaxdelay must be between 0ms and 1000ms, at line %d\n", v->lineno);
+				trunkmaxdelay = 0;
+			}
 		} else if (!strcasecmp(v->name, "trunkmtu")) {
 			mtuv = atoi(v->value);
 			if (mtuv  == 0 )
@@ -13847,7 +14250,7 @@ static int set_config(const char *config_file, int reload, int forced)
 
 		ast_sockaddr_set_port(&bindaddr, portno);
 
-		if (!(ns = ast_netsock_bindaddr(netsock, io, &bindaddr, qos.tos, qos.cos, socket_read, NULL))) {
+		if (!(ns = iax2_bindaddr(&bindaddr))) {
 			ast_log(LOG_ERROR, "Unable to create network socket: %s\n", strerror(errno));
 		} else {
 			ast_verb(2, "Binding IAX2 to default address %s\n", ast_sockaddr_stringify(&bindaddr));
@@ -14704,10 +15107,9 @@ static int __unload_module(void)
 	ast_unregister_switch(&iax2_switch);
 	ast_channel_unregister(&iax2_tech);
 
-	if (netthreadid != AST_PTHREADT_NULL) {
-		pthread_cancel(netthreadid);
-		pthread_kill(netthreadid, SIGURG);
-		pthread_join(netthreadid, NULL);
+	stop_network_thread(&netthreadid);
+	for (x = 0; x < net_reader_count; x++) {
+		stop_network_thread(&net_readers[x].threadid);
 	}
 
 	for (x = 0; x < ARRAY_LEN(iaxs); x++) {
@@ -14720,9 +15122,16 @@ static int __unload_module(void)
 	cleanup_thread_list(&active_list);
 	cleanup_thread_list(&dynamic_list);
 	cleanup_thread_list(&idle_list);
+	stop_affinity_threads();
 
 	ast_netsock_release(netsock);
 	ast_netsock_release(outsock);
+	for (x = 0; x < net_reader_count; x++) {
+		io_context_destroy(net_readers[x].io);
+	}
+	ast_free(net_readers);
+	net_readers = NULL;
+	net_reader_count = 0;
 	for (x = 0; x < ARRAY_LEN(iaxs); x++) {
 		if (iaxs[x]) {
 			iax2_destroy(x);
@@ -15095,7 +15504,8 @@ static int load_module(void)
 		ast_mutex_init(&iaxsl[x]);
 	}
 
-	if (!(sched = ast_sched_context_create())) {
+	/* Retransmission and qualify timers are mostly deleted long before they expire. */
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Failed to create scheduler thread\n");
 		return AST_MODULE_LOAD_FAILURE;
 	}
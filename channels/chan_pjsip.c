@@ -969,6 +969,7 @@ static int chan_pjsip_devicestate(const char *data)
 	RAII_VAR(struct ast_sip_endpoint *, endpoint, ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "endpoint", data), ao2_cleanup);
 	enum ast_device_state state = AST_DEVICE_UNKNOWN;
 	RAII_VAR(struct ast_endpoint_snapshot *, endpoint_snapshot, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_endpoint_channel_ids *, channel_ids, NULL, ao2_cleanup);
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
 	struct ast_devstate_aggregate aggregate;
 	int num, inuse = 0;
@@ -990,7 +991,8 @@ static int chan_pjsip_devicestate(const char *data)
 		state = AST_DEVICE_NOT_INUSE;
 	}
 
-	if (!endpoint_snapshot->num_channels || !(cache = ast_channel_cache())) {
+	if (!endpoint_snapshot->num_channels || !(cache = ast_channel_cache())
+		|| !(channel_ids = ast_endpoint_snapshot_channel_ids(endpoint_snapshot))) {
 		return state;
 	}
 
@@ -998,12 +1000,12 @@ static int chan_pjsip_devicestate(const char *data)
 
 	ao2_ref(cache, +1);
 
-	for (num = 0; num < endpoint_snapshot->num_channels; num++) {
+	for (num = 0; num < channel_ids->num_channels; num++) {
 		RAII_VAR(struct stasis_message *, msg, NULL, ao2_cleanup);
 		struct ast_channel_snapshot *snapshot;
 
 		msg = stasis_cache_get(cache, ast_channel_snapshot_type(),
-			endpoint_snapshot->channel_ids[num]);
+			channel_ids->channel_ids[num]);
 
 		if (!msg) {
 			continue;
@@ -134,6 +134,8 @@ static struct ast_channel *multicast_rtp_request(const char *type, struct ast_fo
 		AST_APP_ARG(options);
 	);
 	struct ast_multicast_rtp_options *mcast_options = NULL;
+	char *destinations;
+	char *destination;
 
 	if (ast_strlen_zero(data)) {
 		ast_log(LOG_ERROR, "A multicast type and destination must be given to the 'MulticastRTP' channel\n");
@@ -151,9 +153,12 @@ static struct ast_channel *multicast_rtp_request(const char *type, struct ast_fo
 		ast_log(LOG_ERROR, "Destination is required for the 'MulticastRTP' channel\n");
 		goto failure;
 	}
-	if (!ast_sockaddr_parse(&destination_address, args.destination, PARSE_PORT_REQUIRE)) {
+	/* Further destinations, separated by '+', are sent the same RTP packets */
+	destinations = ast_strdupa(args.destination);
+	destination = strsep(&destinations, "+");
+	if (!ast_sockaddr_parse(&destination_address, destination, PARSE_PORT_REQUIRE)) {
 		ast_log(LOG_ERROR, "Destination address '%s' could not be parsed\n",
-			args.destination);
+			destination);
 		goto failure;
 	}
 
@@ -169,6 +174,19 @@ static struct ast_channel *multicast_rtp_request(const char *type, struct ast_fo
 		goto failure;
 	}
 
+	while ((destination = strsep(&destinations, "+"))) {
+		struct ast_sockaddr address;
+
+		if (!ast_sockaddr_parse(&address, destination, PARSE_PORT_REQUIRE)) {
+			ast_log(LOG_ERROR, "Destination address '%s' could not be parsed\n",
+				destination);
+			goto failure;
+		}
+		if (ast_multicast_rtp_options_add_destination(mcast_options, &address)) {
+			goto failure;
+		}
+	}
+
 	fmt = ast_multicast_rtp_options_get_format(mcast_options);
 	if (!fmt) {
 		fmt = ast_format_cap_get_format(cap, 0);
@@ -231,6 +249,7 @@ failure:
 enum {
 	OPT_RTP_CODEC =  (1 << 0),
 	OPT_RTP_ENGINE = (1 << 1),
+	OPT_RTP_SYMMETRIC = (1 << 2),
 };
 
 enum {
@@ -245,6 +264,8 @@ AST_APP_OPTIONS(unicast_rtp_options, BEGIN_OPTIONS
 	AST_APP_OPTION_ARG('c', OPT_RTP_CODEC, OPT_ARG_RTP_CODEC),
 	/*! Set the RTP engine to use for unicast RTP */
 	AST_APP_OPTION_ARG('e', OPT_RTP_ENGINE, OPT_ARG_RTP_ENGINE),
+	/*! Send to wherever the media received comes from */
+	AST_APP_OPTION('s', OPT_RTP_SYMMETRIC),
 END_OPTIONS );
 
 /*! \brief Function called when we should prepare to call the unicast destination */
@@ -331,6 +352,9 @@ static struct ast_channel *unicast_rtp_request(const char *type, struct ast_form
 	}
 	ast_rtp_instance_set_channel_id(instance, ast_channel_uniqueid(chan));
 	ast_rtp_instance_set_remote_address(instance, &address);
+	if (ast_test_flag(&opts, OPT_RTP_SYMMETRIC)) {
+		ast_rtp_instance_set_prop(instance, AST_RTP_PROPERTY_NAT, 1);
+	}
 	ast_channel_set_fd(chan, 0, ast_rtp_instance_fd(instance, 0));
 
 	ast_channel_tech_set(chan, &unicast_rtp_tech);
@@ -289,6 +289,7 @@
 #include "asterisk/http_websocket.h"
 #include "asterisk/format_cache.h"
 #include "asterisk/linkedlists.h"	/* for AST_LIST_NEXT */
+#include "asterisk/taskprocessor.h"
 
 /*** DOCUMENTATION
 	<application name="SIPDtmfMode" language="en_US">
@@ -839,7 +840,14 @@ static int network_change_sched_id = -1;
 
 static char used_context[AST_MAX_CONTEXT];        /*!< name of automatically created context for unloading */
 
-AST_MUTEX_DEFINE_STATIC(netlock);
+/*! \brief Serializes handling of received messages and changes to the UDP socket.
+ * UDP workers hold it shared, as all messages of a dialog are handled by the same worker. */
+AST_RWLOCK_DEFINE_STATIC(netlock);
+
+/*! \brief Threads received UDP messages are handed to by Call-ID, active when udpworkers is set.
+ * Only changed and used by the monitor thread, or before it starts. */
+static struct ast_taskprocessor *sip_udp_workers[SIP_MAX_UDP_WORKERS];
+static int sip_udp_worker_count;
 
 /*! \brief Protect the monitoring thread, so only one process can kill or start it, and not
    when it's doing something critical. */
@@ -999,8 +1007,14 @@ static struct ao2_container *threadt;
 
 /*! \brief  The peer list: Users, Peers and Friends */
 static struct ao2_container *peers;
+/*! \brief Peers by address and port, for exact matches */
+static struct ao2_container *peers_by_addr;
+/*! \brief Peers by address alone, only those that match any port (insecure=port, TCP or TLS) */
 static struct ao2_container *peers_by_ip;
 
+/*! \brief Addresses no realtime peer was found for, see rtcachemisses */
+static struct ao2_container *realtime_addr_misses;
+
 /*! \brief A bogus peer, to be used when authentication should fail */
 static AO2_GLOBAL_OBJ_STATIC(g_bogus_peer);
 /*! \brief We can recognize the bogus peer by this invalid MD5 hash */
@@ -1144,6 +1158,7 @@ static int get_address_family_filter(unsigned int transport);
 
 /*--- Transmitting responses and requests */
 static int sipsock_read(int *id, int fd, short events, void *ignore);
+static int sip_udp_worker_dispatch(struct sip_request *req, struct ast_sockaddr *addr);
 static int __sip_xmit(struct sip_pvt *p, struct ast_str *data);
 static int __sip_reliable_xmit(struct sip_pvt *p, uint32_t seqno, int resp, struct ast_str *data, int fatal, int sipmethod);
 static void add_cc_call_info_to_response(struct sip_pvt *p, struct sip_request *resp);
@@ -1364,6 +1379,9 @@ static void set_insecure_flags(struct ast_flags *flags, const char *value, int l
 static int handle_common_options(struct ast_flags *flags, struct ast_flags *mask, struct ast_variable *v);
 static void set_socket_transport(struct sip_socket *socket, int transport);
 static int peer_ipcmp_cb_full(void *obj, void *arg, void *data, int flags);
+static void link_peer_by_addr(struct sip_peer *peer, const char *tag);
+static void unlink_peer_by_addr(struct sip_peer *peer, const char *tag);
+static int peer_addrcmp_cb_full(void *obj, void *arg, void *data, int flags);
 
 /* Realtime device support */
 static void realtime_update_peer(const char *peername, struct ast_sockaddr *addr, const char *username, const char *fullcontact, const char *useragent, int expirey, unsigned short deprecated_username, int lastms, const char *path);
@@ -3204,6 +3222,12 @@ static void unlink_peers_from_tables(peer_unlink_flag_t flag)
 		ao2_iterator_destroy(peers_iter);
 	}
 
+	peers_iter = ao2_t_callback(peers_by_addr, OBJ_UNLINK | OBJ_MULTIPLE,
+		match_and_cleanup_peer_sched, &flag, "initiating callback to remove marked peers_by_addr");
+	if (peers_iter) {
+		ao2_iterator_destroy(peers_iter);
+	}
+
 	peers_iter = ao2_t_callback(peers_by_ip, OBJ_UNLINK | OBJ_MULTIPLE,
 		match_and_cleanup_peer_sched, &flag, "initiating callback to remove marked peers_by_ip");
 	if (peers_iter) {
@@ -5593,6 +5617,131 @@ static int register_realtime_peers_with_callbackextens(void)
 	return 0;
 }
 
+/*! \brief An address no realtime peer was found for */
+struct sip_addr_miss {
+	struct ast_sockaddr addr;
+	struct timeval expires;
+	char callbackexten[0];
+};
+
+/*! \brief Search key of realtime_addr_misses */
+struct sip_addr_miss_key {
+	const struct ast_sockaddr *addr;
+	const char *callbackexten;
+};
+
+/*! \brief Most addresses remembered in realtime_addr_misses */
+#define MAX_REALTIME_ADDR_MISSES 10000
+
+/*! \note Only the address is hashed, so the misses of an address can be forgotten together */
+static int addr_miss_hash_cb(const void *obj, const int flags)
+{
+	const struct ast_sockaddr *addr;
+	int ret;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		addr = ((const struct sip_addr_miss_key *) obj)->addr;
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		addr = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		addr = &((const struct sip_addr_miss *) obj)->addr;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	ret = ast_sockaddr_hash(addr) ^ ast_sockaddr_port(addr);
+	return ret < 0 ? -ret : ret;
+}
+
+static int addr_miss_cmp_cb(void *obj, void *arg, int flags)
+{
+	const struct sip_addr_miss *miss = obj;
+	const struct sip_addr_miss_key *key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		return !ast_sockaddr_cmp(&miss->addr, key->addr)
+			&& !strcmp(miss->callbackexten, S_OR(key->callbackexten, "")) ? CMP_MATCH : 0;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		return !ast_sockaddr_cmp(&miss->addr, arg) ? CMP_MATCH : 0;
+	default:
+		return 0;
+	}
+}
+
+static int addr_miss_expired_cb(void *obj, void *arg, int flags)
+{
+	const struct sip_addr_miss *miss = obj;
+	const struct timeval *now = arg;
+
+	return ast_tvcmp(miss->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*! \brief Whether no realtime peer was found for an address within rtcachemisses seconds */
+static int realtime_addr_missed(const struct ast_sockaddr *addr, const char *callbackexten)
+{
+	struct sip_addr_miss_key key = { .addr = addr, .callbackexten = callbackexten, };
+	struct sip_addr_miss *miss;
+	int missed;
+
+	if (!sip_cfg.rtcachemisses || !(miss = ao2_find(realtime_addr_misses, &key, OBJ_SEARCH_KEY))) {
+		return 0;
+	}
+
+	missed = ast_tvcmp(miss->expires, ast_tvnow()) > 0;
+	if (!missed) {
+		ao2_unlink(realtime_addr_misses, miss);
+	}
+	ao2_ref(miss, -1);
+
+	return missed;
+}
+
+/*! \brief Remember that no realtime peer was found for an address, for rtcachemisses seconds */
+static void realtime_addr_miss(const struct ast_sockaddr *addr, const char *callbackexten)
+{
+	struct sip_addr_miss *miss;
+	struct timeval now;
+
+	if (!sip_cfg.rtcachemisses) {
+		return;
+	}
+
+	callbackexten = S_OR(callbackexten, "");
+	miss = ao2_alloc_options(sizeof(*miss) + strlen(callbackexten) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!miss) {
+		return;
+	}
+	now = ast_tvnow();
+	ast_sockaddr_copy(&miss->addr, addr);
+	miss->expires = ast_tvadd(now, ast_samp2tv(sip_cfg.rtcachemisses, 1));
+	strcpy(miss->callbackexten, callbackexten); /* Safe */
+
+	ao2_lock(realtime_addr_misses);
+	if (ao2_container_count(realtime_addr_misses) >= MAX_REALTIME_ADDR_MISSES) {
+		ao2_callback(realtime_addr_misses, OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
+			addr_miss_expired_cb, &now);
+	}
+	if (ao2_container_count(realtime_addr_misses) < MAX_REALTIME_ADDR_MISSES) {
+		ao2_link_flags(realtime_addr_misses, miss, OBJ_NOLOCK);
+	}
+	ao2_unlock(realtime_addr_misses);
+	ao2_ref(miss, -1);
+}
+
+/*! \brief Forget the misses of an address a peer now uses */
+static void realtime_addr_misses_forget(const struct ast_sockaddr *addr)
+{
+	if (realtime_addr_misses && ao2_container_count(realtime_addr_misses)) {
+		ao2_find(realtime_addr_misses, addr, OBJ_SEARCH_PARTIAL_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE);
+	}
+}
+
 /*! \brief  realtime_peer: Get peer from realtime storage
  * Checks the "sippeers" realtime family from extconfig.conf
  * Checks the "sipregs" realtime family from extconfig.conf if it's configured.
@@ -5618,9 +5767,14 @@ static struct sip_peer *realtime_peer(const char *newpeername, struct ast_sockad
 
 	if (newpeername && realtime_peer_by_name(&newpeername, addr, ipaddr, &var, realtimeregs ? &varregs : NULL)) {
 		;
+	} else if (addr && !newpeername && realtime_addr_missed(addr, callbackexten)) {
+		return NULL;
 	} else if (addr && realtime_peer_by_addr(&newpeername, addr, ipaddr, callbackexten, &var, realtimeregs ? &varregs : NULL)) {
 		;
 	} else {
+		if (addr && !newpeername) {
+			realtime_addr_miss(addr, callbackexten);
+		}
 		return NULL;
 	}
 
@@ -5666,7 +5820,7 @@ static struct sip_peer *realtime_peer(const char *newpeername, struct ast_sockad
 		}
 		ao2_t_link(peers, peer, "link peer into peers table");
 		if (!ast_sockaddr_isnull(&peer->addr)) {
-			ao2_t_link(peers_by_ip, peer, "link peer into peers_by_ip table");
+			link_peer_by_addr(peer, "link peer into peers_by_ip table");
 		}
 	}
 	peer->is_realtime = 1;
@@ -5718,7 +5872,11 @@ static struct sip_peer *sip_find_peer_full(const char *peer, struct ast_sockaddr
 		ast_sockaddr_copy(&tmp_peer.addr, addr);
 		tmp_peer.flags[0].flags = 0;
 		tmp_peer.transports = transport;
-		p = ao2_t_callback_data(peers_by_ip, OBJ_POINTER, peer_ipcmp_cb_full, &tmp_peer, callbackexten, "ao2_find in peers_by_ip table");
+		p = ao2_t_callback_data(peers_by_addr, OBJ_POINTER, peer_addrcmp_cb_full, &tmp_peer, callbackexten, "ao2_find in peers_by_addr table");
+		if (!p && (transport & (AST_TRANSPORT_TLS | AST_TRANSPORT_TCP))) {
+			/* TCP and TLS peers match on any port */
+			p = ao2_t_callback_data(peers_by_ip, OBJ_POINTER, peer_ipcmp_cb_full, &tmp_peer, callbackexten, "ao2_find in peers_by_ip table");
+		}
 		if (!p) {
 			ast_set_flag(&tmp_peer.flags[0], SIP_INSECURE_PORT);
 			p = ao2_t_callback_data(peers_by_ip, OBJ_POINTER, peer_ipcmp_cb_full, &tmp_peer, callbackexten, "ao2_find in peers_by_ip table 2");
@@ -14804,7 +14962,7 @@ static void on_dns_update_peer(struct ast_sockaddr *old, struct ast_sockaddr *ne
 	}
 
 	if (!ast_sockaddr_isnull(&peer->addr)) {
-		ao2_unlink(peers_by_ip, peer);
+		unlink_peer_by_addr(peer, "unlink peer for new address");
 	}
 
 	if (!ast_sockaddr_port(new)) {
@@ -14818,7 +14976,7 @@ static void on_dns_update_peer(struct ast_sockaddr *old, struct ast_sockaddr *ne
 	ast_sockaddr_copy(&peer->addr, new);
 	ao2_unlock(peer);
 
-	ao2_link(peers_by_ip, peer);
+	link_peer_by_addr(peer, "link peer for new address");
 }
 
 static void on_dns_update_mwi(struct ast_sockaddr *old, struct ast_sockaddr *new, void *data)
@@ -16433,7 +16591,7 @@ static int expire_register(const void *data)
 		/* We still need to unlink the peer from the peers_by_ip table,
 		 * otherwise we end up with multiple copies hanging around each
 		 * time a registration expires and the peer re-registers. */
-		ao2_t_unlink(peers_by_ip, peer, "ao2_unlink of peer from peers_by_ip table");
+		unlink_peer_by_addr(peer, "ao2_unlink of peer from peers_by_ip table");
 	}
 
 	/* Only clear the addr after we check for destruction.  The addr must remain
@@ -16812,7 +16970,7 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 
 	/* If we were already linked into the peers_by_ip container unlink ourselves so nobody can find us */
 	if (!ast_sockaddr_isnull(&peer->addr) && (!peer->is_realtime || ast_test_flag(&global_flags[1], SIP_PAGE2_RTCACHEFRIENDS))) {
-		ao2_t_unlink(peers_by_ip, peer, "ao2_unlink of peer from peers_by_ip table");
+		unlink_peer_by_addr(peer, "ao2_unlink of peer from peers_by_ip table");
 	}
 
 	if ((transport_type != AST_TRANSPORT_WS) && (transport_type != AST_TRANSPORT_WSS) &&
@@ -16864,8 +17022,9 @@ static enum parse_register_result parse_register_contact(struct sip_pvt *pvt, st
 
 	/* Now that our address has been updated put ourselves back into the container for lookups */
 	if (!peer->is_realtime || ast_test_flag(&peer->flags[1], SIP_PAGE2_RTCACHEFRIENDS)) {
-		ao2_t_link(peers_by_ip, peer, "ao2_link into peers_by_ip table");
+		link_peer_by_addr(peer, "ao2_link into peers_by_ip table");
 	}
+	realtime_addr_misses_forget(&peer->addr);
 
 	/* Save SIP options profile */
 	peer->sipoptions = pvt->sipoptions;
@@ -17304,6 +17463,8 @@ static void acl_change_stasis_subscribe(void)
 	if (!acl_change_sub) {
 		acl_change_sub = stasis_subscribe(ast_security_topic(),
 			acl_change_stasis_cb, NULL);
+		stasis_subscription_accept_message_type(acl_change_sub, ast_named_acl_change_type());
+		stasis_subscription_set_filter(acl_change_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 	}
 
 }
@@ -17758,7 +17919,7 @@ static enum check_auth_result register_verify(struct sip_pvt *p, struct ast_sock
 		if (peer) {
 			ao2_t_link(peers, peer, "link peer into peer table");
 			if (!ast_sockaddr_isnull(&peer->addr)) {
-				ao2_t_link(peers_by_ip, peer, "link peer into peers-by-ip table");
+				link_peer_by_addr(peer, "link peer into peers-by-ip table");
 			}
 			ao2_lock(peer);
 			sip_cancel_destroy(p);
@@ -19000,8 +19161,18 @@ static enum check_auth_result check_peer_ok(struct sip_pvt *p, char *of,
 	 */
 	set_peer_nat(p, peer);
 
-	if (p->natdetected && ast_test_flag(&peer->flags[2], SIP_PAGE3_NAT_AUTO_RPORT)) {
+	if (p->natdetected && ast_test_flag(&peer->flags[2], SIP_PAGE3_NAT_AUTO_RPORT)
+		&& ast_sockaddr_cmp(&peer->addr, &p->recv)) {
+		struct sip_peer *linked;
+
+		/* The port is part of the key of peers_by_addr, move the peer if it is in there */
+		linked = ao2_t_callback(peers_by_addr, OBJ_POINTER | OBJ_UNLINK, ao2_match_by_addr, peer,
+			"unlink peer for its NAT address");
 		ast_sockaddr_copy(&peer->addr, &p->recv);
+		if (linked) {
+			ao2_t_link(peers_by_addr, peer, "link peer for its NAT address");
+			ao2_t_ref(linked, -1, "unlinked peer for its NAT address");
+		}
 	}
 
 	if (!ast_apply_acl(peer->acl, addr, "SIP Peer ACL: ")) {
@@ -20199,7 +20370,9 @@ static char *sip_show_objects(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 		return CLI_SHOWUSAGE;
 	ast_cli(a->fd, "-= Peer objects: %d static, %d realtime, %d autocreate =-\n\n", speerobjs, rpeerobjs, apeerobjs);
 	ao2_t_callback(peers, OBJ_NODATA, peer_dump_func, a, "initiate ao2_callback to dump peers");
-	ast_cli(a->fd, "-= Peer objects by IP =-\n\n");
+	ast_cli(a->fd, "-= Peer objects by address =-\n\n");
+	ao2_t_callback(peers_by_addr, OBJ_NODATA, peer_dump_func, a, "initiate ao2_callback to dump peers_by_addr");
+	ast_cli(a->fd, "-= Peer objects by IP, any port =-\n\n");
 	ao2_t_callback(peers_by_ip, OBJ_NODATA, peer_dump_func, a, "initiate ao2_callback to dump peers_by_ip");
 
 	iter = ao2_iterator_init(registry_list, 0);
@@ -20513,14 +20686,14 @@ static char *sip_prune_realtime(struct ast_cli_entry *e, int cmd, struct ast_cli
 			ast_copy_string(tmp.name, name, sizeof(tmp.name));
 			if ((peer = ao2_t_find(peers, &tmp, OBJ_POINTER | OBJ_UNLINK, "finding to unlink from peers"))) {
 				if (!ast_sockaddr_isnull(&peer->addr)) {
-					ao2_t_unlink(peers_by_ip, peer, "unlinking peer from peers_by_ip also");
+					unlink_peer_by_addr(peer, "unlinking peer from peers_by_ip also");
 				}
 				if (!ast_test_flag(&peer->flags[1], SIP_PAGE2_RTCACHEFRIENDS)) {
 					ast_cli(a->fd, "Peer '%s' is not a Realtime peer, cannot be pruned.\n", name);
 					/* put it back! */
 					ao2_t_link(peers, peer, "link peer into peer table");
 					if (!ast_sockaddr_isnull(&peer->addr)) {
-						ao2_t_link(peers_by_ip, peer, "link peer into peers_by_ip table");
+						link_peer_by_addr(peer, "link peer into peers_by_ip table");
 					}
 				} else
 					ast_cli(a->fd, "Peer '%s' pruned.\n", name);
@@ -21505,6 +21678,7 @@ static char *sip_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_
 	ast_cli(a->fd, "\n\nGlobal Settings:\n");
 	ast_cli(a->fd, "----------------\n");
 	ast_cli(a->fd, "  UDP Bindaddress:        %s\n", ast_sockaddr_stringify(&bindaddr));
+	ast_cli(a->fd, "  UDP Workers:            %d\n", sip_udp_worker_count);
 	if (ast_sockaddr_is_ipv6(&bindaddr) && ast_sockaddr_is_any(&bindaddr)) {
 		ast_cli(a->fd, "  ** Additional Info:\n");
 		ast_cli(a->fd, "     [::] may include IPv4 in addition to IPv6, if such a feature is enabled in the OS.\n");
@@ -21517,6 +21691,15 @@ static char *sip_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		default_tls_cfg.enabled != FALSE ?
 				ast_sockaddr_stringify(&sip_tls_desc.local_address) :
 				"Disabled");
+	if (default_tls_cfg.enabled != FALSE) {
+		struct ast_tls_handshake_stats stats;
+
+		ast_tcptls_handshake_stats(&sip_tls_desc, &stats);
+		ast_cli(a->fd, "  TLS Handshakes:         %lu (%lu resumed), %lu failed, %lu dropped\n",
+			stats.completed, stats.resumed, stats.failed, stats.dropped);
+		ast_cli(a->fd, "  TLS Handshake Time:     %lu us average, %lu us longest\n",
+			stats.completed ? stats.total_usec / stats.completed : 0, stats.max_usec);
+	}
 	ast_cli(a->fd, "  RTP Bindaddress:        %s\n",
 		!ast_sockaddr_isnull(&rtpbindaddr) ?
 				ast_sockaddr_stringify_addr(&rtpbindaddr) :
@@ -21703,6 +21886,7 @@ static char *sip_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		ast_cli(a->fd, "  Save sys. name:         %s\n", AST_CLI_YESNO(sip_cfg.rtsave_sysname));
 		ast_cli(a->fd, "  Save path header:       %s\n", AST_CLI_YESNO(sip_cfg.rtsave_path));
 		ast_cli(a->fd, "  Auto Clear:             %d (%s)\n", sip_cfg.rtautoclear, ast_test_flag(&global_flags[1], SIP_PAGE2_RTAUTOCLEAR) ? "Enabled" : "Disabled");
+		ast_cli(a->fd, "  Cache Misses:           %d\n", sip_cfg.rtcachemisses);
 	}
 	ast_cli(a->fd, "\n----\n");
 	return CLI_SUCCESS;
@@ -28912,6 +29096,10 @@ static int sipsock_read(int *id, int fd, short events, void *ignore)
 	req.socket.tcptls_session	= NULL;
 	req.socket.port = htons(ast_sockaddr_port(&bindaddr));
 
+	if (!sip_udp_worker_dispatch(&req, &addr)) {
+		return 1;
+	}
+
 	handle_request_do(&req, &addr);
 	deinit_req(&req);
 
@@ -28921,8 +29109,9 @@ static int sipsock_read(int *id, int fd, short events, void *ignore)
 /*! \brief Handle incoming SIP message - request or response
 
  	This is used for all transports (udp, tcp and tcp/tls)
+	\param exclusive Whether to hold netlock exclusively, or shared by a UDP worker
 */
-static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
+static int handle_request_full(struct sip_request *req, struct ast_sockaddr *addr, int exclusive)
 {
 	struct sip_pvt *p;
 	struct ast_channel *owner_chan_ref = NULL;
@@ -28951,13 +29140,17 @@ static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
 		ast_str_reset(req->data); /* nulling this out is NOT a good idea here. */
 		return 1;
 	}
-	ast_mutex_lock(&netlock);
+	if (exclusive) {
+		ast_rwlock_wrlock(&netlock);
+	} else {
+		ast_rwlock_rdlock(&netlock);
+	}
 
 	/* Find the active SIP dialog or create a new one */
 	p = find_call(req, addr, req->method);	/* returns p with a reference only. _NOT_ locked*/
 	if (p == NULL) {
 		ast_debug(1, "Invalid SIP message - rejected , no callid, len %zu\n", ast_str_strlen(req->data));
-		ast_mutex_unlock(&netlock);
+		ast_rwlock_unlock(&netlock);
 		return 1;
 	}
 
@@ -28997,7 +29190,7 @@ static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
 		ast_channel_unref(owner_chan_ref);
 	}
 	sip_pvt_unlock(p);
-	ast_mutex_unlock(&netlock);
+	ast_rwlock_unlock(&netlock);
 
 	if (p->logger_callid) {
 		ast_callid_threadassoc_remove();
@@ -29007,6 +29200,131 @@ static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
 	return 1;
 }
 
+static int handle_request_do(struct sip_request *req, struct ast_sockaddr *addr)
+{
+	return handle_request_full(req, addr, 1);
+}
+
+/*! \brief A received UDP message waiting for its worker */
+struct sip_udp_work {
+	struct sip_request req;
+	struct ast_sockaddr addr;
+};
+
+/*! \brief Handle a received UDP message in its worker */
+static int sip_udp_work_exec(void *data)
+{
+	struct sip_udp_work *work = data;
+
+	handle_request_full(&work->req, &work->addr, 0);
+	deinit_req(&work->req);
+	ast_free(work);
+
+	return 0;
+}
+
+/*! \brief Hash the Call-ID of an unparsed message, 0 if it has none
+ *
+ * Messages without a Call-ID are rejected by any worker, so which one does not matter.
+ */
+static unsigned int sip_udp_work_hash(const char *buf)
+{
+	const char *line = buf;
+
+	while (line && *line && *line != '\r' && *line != '\n') {
+		const char *value = NULL;
+
+		if (!strncasecmp(line, "Call-ID", 7)) {
+			value = line + 7;
+		} else if (*line == 'i' || *line == 'I') {
+			value = line + 1;
+		}
+
+		if (value) {
+			value = ast_skip_blanks(value);
+		}
+		if (value && *value == ':') {
+			unsigned int hash = 0;
+
+			for (value = ast_skip_blanks(value + 1); *value && *value != '\r' && *value != '\n'; value++) {
+				hash = hash * 33 ^ (unsigned char) *value;
+			}
+			return hash;
+		}
+
+		line = strchr(line, '\n');
+		if (line) {
+			line++;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Hand a received UDP message to the worker for its Call-ID
+ *
+ * All messages of a dialog, and so all retransmissions, are handled in order by the same worker.
+ *
+ * \retval 0 the worker now owns the request
+ * \retval -1 there are no workers, or the message could not be queued
+ */
+static int sip_udp_worker_dispatch(struct sip_request *req, struct ast_sockaddr *addr)
+{
+	struct sip_udp_work *work;
+	unsigned int worker;
+
+	if (!sip_udp_worker_count) {
+		return -1;
+	}
+
+	work = ast_malloc(sizeof(*work));
+	if (!work) {
+		return -1;
+	}
+
+	worker = sip_udp_work_hash(ast_str_buffer(req->data)) % sip_udp_worker_count;
+	work->req = *req;
+	ast_sockaddr_copy(&work->addr, addr);
+
+	if (ast_taskprocessor_push(sip_udp_workers[worker], sip_udp_work_exec, work)) {
+		ast_free(work);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*! \brief Change the number of UDP workers
+ *
+ * Workers being removed finish handling the messages already queued to them first.
+ */
+static void sip_udp_workers_set(int count)
+{
+	int i;
+
+	if (count == sip_udp_worker_count) {
+		return;
+	}
+
+	for (i = 0; i < sip_udp_worker_count; i++) {
+		ast_taskprocessor_unreference(sip_udp_workers[i]);
+		sip_udp_workers[i] = NULL;
+	}
+	sip_udp_worker_count = 0;
+
+	for (i = 0; i < count; i++) {
+		char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+		snprintf(name, sizeof(name), "chan_sip/udp-%02d", i);
+		sip_udp_workers[i] = ast_taskprocessor_get(name, TPS_REF_DEFAULT);
+		if (!sip_udp_workers[i]) {
+			ast_log(LOG_WARNING, "Unable to create UDP worker, using %d\n", i);
+			break;
+		}
+	}
+	sip_udp_worker_count = i;
+}
+
 /*! \brief Returns the port to use for this socket
  *
  * \param type The type of transport used
@@ -31147,7 +31465,7 @@ static struct sip_peer *build_peer(const char *name, struct ast_variable *v_head
 		/* we've unlinked the peer from the peers container but not unlinked from the peers_by_ip container yet
 		  this leads to a wrong refcounter and the peer object is never destroyed */
 		if (!ast_sockaddr_isnull(&peer->addr)) {
-			ao2_t_unlink(peers_by_ip, peer, "ao2_unlink peer from peers_by_ip table");
+			unlink_peer_by_addr(peer, "ao2_unlink peer from peers_by_ip table");
 		}
 		if (!(peer->the_mark)) {
 			firstpass = 0;
@@ -32046,6 +32364,9 @@ static int reload_config(enum channelreloadreason reason)
 	sip_cfg.contact_acl = ast_free_acl_list(sip_cfg.contact_acl);
 
 	default_tls_cfg.enabled = FALSE;		/* Default: Disable TLS */
+	default_tls_cfg.session_cache_size = 0;
+	default_tls_cfg.session_timeout = 0;
+	ast_clear_flag(&default_tls_cfg.flags, AST_SSL_NO_SESSION_CACHE | AST_SSL_NO_SESSION_TICKETS);
 	default_dtls_cfg.enabled = FALSE;		/* Default: Disable DTLS too */
 
 	if (reason != CHANNEL_MODULE_LOAD) {
@@ -32172,11 +32493,14 @@ static int reload_config(enum channelreloadreason reason)
 	global_rtpkeepalive = DEFAULT_RTPKEEPALIVE;
 	sip_cfg.allowtransfer = TRANSFER_OPENFORALL;	/* Merrily accept all transfers by default */
 	sip_cfg.rtautoclear = 120;
+	sip_cfg.rtcachemisses = 0;
+	ao2_callback(realtime_addr_misses, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
 	ast_set_flag(&global_flags[1], SIP_PAGE2_ALLOWSUBSCRIBE);	/* Default for all devices: TRUE */
 	ast_set_flag(&global_flags[1], SIP_PAGE2_ALLOWOVERLAP_YES);	/* Default for all devices: Yes */
 	sip_cfg.peer_rtupdate = TRUE;
 	global_dynamic_exclude_static = 0;	/* Exclude static peers */
 	sip_cfg.tcp_enabled = FALSE;
+	sip_cfg.udp_workers = 0;
 	sip_cfg.websocket_enabled = TRUE;
 	sip_cfg.websocket_write_timeout = AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT;
 
@@ -32347,6 +32671,12 @@ static int reload_config(enum channelreloadreason reason)
 					default_primary_transport = default_transports;
 				}
 			}
+		} else if (!strcasecmp(v->name, "udpworkers")) {
+			if (sscanf(v->value, "%30d", &sip_cfg.udp_workers) != 1
+				|| sip_cfg.udp_workers < 0 || SIP_MAX_UDP_WORKERS < sip_cfg.udp_workers) {
+				ast_log(LOG_WARNING, "'%s' is not a valid udpworkers value at line %d.  Using default.\n", v->value, v->lineno);
+				sip_cfg.udp_workers = 0;
+			}
 		} else if (!strcasecmp(v->name, "tcpenable")) {
 			if (!ast_false(v->value)) {
 				ast_debug(2, "Enabling TCP socket for listening\n");
@@ -32369,6 +32699,11 @@ static int reload_config(enum channelreloadreason reason)
 				ast_log(LOG_ERROR, "Bad ACL entry in configuration line %d : %s. Failing to load chan_sip.so\n", v->lineno, v->value);
 				return -1;
 			}
+		} else if (!strcasecmp(v->name, "rtcachemisses")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_IN_RANGE, &sip_cfg.rtcachemisses, 0, 3600)) {
+				ast_log(LOG_WARNING, "Invalid rtcachemisses '%s' at line %d, not caching misses\n", v->value, v->lineno);
+				sip_cfg.rtcachemisses = 0;
+			}
 		} else if (!strcasecmp(v->name, "rtautoclear")) {
 			int i = atoi(v->value);
 			if (i > 0) {
@@ -32907,7 +33242,7 @@ static int reload_config(enum channelreloadreason reason)
 		return 0;
 	}
 
-	ast_mutex_lock(&netlock);
+	ast_rwlock_wrlock(&netlock);
 	if ((sipsock > -1) && (ast_sockaddr_cmp(&old_bindaddr, &bindaddr))) {
 		close(sipsock);
 		sipsock = -1;
@@ -32918,7 +33253,7 @@ static int reload_config(enum channelreloadreason reason)
 		if (sipsock < 0) {
 			ast_log(LOG_WARNING, "Unable to create SIP socket: %s\n", strerror(errno));
 			ast_config_destroy(cfg);
-			ast_mutex_unlock(&netlock);
+			ast_rwlock_unlock(&netlock);
 			return -1;
 		} else {
 			/* Allow SIP clients on the same host to access us: */
@@ -32943,7 +33278,9 @@ static int reload_config(enum channelreloadreason reason)
 	} else {
 		ast_set_qos(sipsock, global_tos_sip, global_cos_sip, "SIP");
 	}
-	ast_mutex_unlock(&netlock);
+	ast_rwlock_unlock(&netlock);
+
+	sip_udp_workers_set(sip_cfg.udp_workers);
 
 	/* Start TCP server */
 	if (sip_cfg.tcp_enabled) {
@@ -33020,7 +33357,7 @@ static int reload_config(enum channelreloadreason reason)
 						peer->type = SIP_TYPE_USER | SIP_TYPE_PEER;
 						ao2_t_link(peers, peer, "link peer into peer table");
 						if ((peer->type & SIP_TYPE_PEER) && !ast_sockaddr_isnull(&peer->addr)) {
-							ao2_t_link(peers_by_ip, peer, "link peer into peers_by_ip table");
+							link_peer_by_addr(peer, "link peer into peers_by_ip table");
 						}
 
 						sip_unref_peer(peer, "sip_unref_peer: from reload_config");
@@ -33095,7 +33432,7 @@ static int reload_config(enum channelreloadreason reason)
 				display_nat_warning(cat, reason, &peer->flags[0]);
 				ao2_t_link(peers, peer, "link peer into peers table");
 				if ((peer->type & SIP_TYPE_PEER) && !ast_sockaddr_isnull(&peer->addr)) {
-					ao2_t_link(peers_by_ip, peer, "link peer into peers_by_ip table");
+					link_peer_by_addr(peer, "link peer into peers_by_ip table");
 				}
 				sip_unref_peer(peer, "unref the result of the build_peer call. Now, the links from the tables are the only ones left.");
 				peer_count++;
@@ -34071,6 +34408,60 @@ static int peer_ipcmp_cb(void *obj, void *arg, int flags)
 	return peer_ipcmp_cb_full(obj, arg, NULL, flags);
 }
 
+/*! \brief Hash function based on the peer's ip address and port */
+static int peer_addrhash_cb(const void *obj, const int flags)
+{
+	const struct sip_peer *peer = obj;
+	int ret;
+
+	ret = ast_sockaddr_hash(&peer->addr) ^ ast_sockaddr_port(&peer->addr);
+
+	return ret < 0 ? -ret : ret;
+}
+
+/*!
+ * \brief Match peers by IP and port number, and the callback extension if one is given
+ */
+static int peer_addrcmp_cb_full(void *obj, void *arg, void *data, int flags)
+{
+	struct sip_peer *peer = obj, *peer2 = arg;
+	char *callback = data;
+
+	if (!ast_strlen_zero(callback) && strcasecmp(peer->callback, callback)) {
+		return 0;
+	}
+
+	return !ast_sockaddr_cmp(&peer->addr, &peer2->addr) ? (CMP_MATCH | CMP_STOP) : 0;
+}
+
+static int peer_addrcmp_cb(void *obj, void *arg, int flags)
+{
+	return peer_addrcmp_cb_full(obj, arg, NULL, flags);
+}
+
+/*! \brief Whether a peer matches requests from its address on any port */
+static int peer_matches_any_port(const struct sip_peer *peer)
+{
+	return ast_test_flag(&peer->flags[0], SIP_INSECURE_PORT)
+		|| (peer->transports & (AST_TRANSPORT_TLS | AST_TRANSPORT_TCP));
+}
+
+/*! \brief Link a peer into the containers finding peers by address */
+static void link_peer_by_addr(struct sip_peer *peer, const char *tag)
+{
+	ao2_t_link(peers_by_addr, peer, tag);
+	if (peer_matches_any_port(peer)) {
+		ao2_t_link(peers_by_ip, peer, tag);
+	}
+}
+
+/*! \brief Unlink a peer from the containers finding peers by address */
+static void unlink_peer_by_addr(struct sip_peer *peer, const char *tag)
+{
+	ao2_t_unlink(peers_by_addr, peer, tag);
+	ao2_t_unlink(peers_by_ip, peer, tag);
+}
+
 static int threadt_hash_cb(const void *obj, const int flags)
 {
 	const struct sip_threadinfo *th = obj;
@@ -35185,12 +35576,14 @@ static int load_module(void)
 	/* the fact that ao2_containers can't resize automatically is a major worry! */
 	/* if the number of objects gets above MAX_XXX_BUCKETS, things will slow down */
 	peers = ao2_t_container_alloc(HASH_PEER_SIZE, peer_hash_cb, peer_cmp_cb, "allocate peers");
+	peers_by_addr = ao2_t_container_alloc(HASH_PEER_SIZE, peer_addrhash_cb, peer_addrcmp_cb, "allocate peers_by_addr");
 	peers_by_ip = ao2_t_container_alloc(HASH_PEER_SIZE, peer_iphash_cb, peer_ipcmp_cb, "allocate peers_by_ip");
+	realtime_addr_misses = ao2_t_container_alloc(HASH_PEER_SIZE, addr_miss_hash_cb, addr_miss_cmp_cb, "allocate realtime_addr_misses");
 	dialogs = ao2_t_container_alloc(HASH_DIALOG_SIZE, dialog_hash_cb, dialog_cmp_cb, "allocate dialogs");
 	dialogs_needdestroy = ao2_t_container_alloc(1, NULL, NULL, "allocate dialogs_needdestroy");
 	dialogs_rtpcheck = ao2_t_container_alloc(HASH_DIALOG_SIZE, dialog_hash_cb, dialog_cmp_cb, "allocate dialogs for rtpchecks");
 	threadt = ao2_t_container_alloc(HASH_DIALOG_SIZE, threadt_hash_cb, threadt_cmp_cb, "allocate threadt table");
-	if (!peers || !peers_by_ip || !dialogs || !dialogs_needdestroy || !dialogs_rtpcheck
+	if (!peers || !peers_by_addr || !peers_by_ip || !realtime_addr_misses || !dialogs || !dialogs_needdestroy || !dialogs_rtpcheck
 		|| !threadt) {
 		ast_log(LOG_ERROR, "Unable to create primary SIP container(s)\n");
 		unload_module();
@@ -35207,7 +35600,8 @@ static int load_module(void)
 	subscription_mwi_list = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX,
 		AO2_CONTAINER_ALLOC_OPT_INSERT_BEGIN, NULL, NULL, "allocate subscription_mwi_list");
 
-	if (!(sched = ast_sched_context_create())) {
+	/* Retransmission and qualify timers are mostly deleted long before they expire. */
+	if (!(sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Unable to create scheduler context\n");
 		unload_module();
 		return AST_MODULE_LOAD_FAILURE;
@@ -35458,6 +35852,9 @@ static int unload_module(void)
 		ast_mutex_unlock(&monlock);
 	}
 
+	/* Nothing else reads from the UDP socket, so let the workers finish what they were given */
+	sip_udp_workers_set(0);
+
 	cleanup_all_regs();
 
 	{
@@ -35529,7 +35926,9 @@ static int unload_module(void)
 	ao2_t_global_obj_release(g_bogus_peer, "Release the bogus peer.");
 
 	ao2_t_cleanup(peers, "unref the peers table");
+	ao2_t_cleanup(peers_by_addr, "unref the peers_by_addr table");
 	ao2_t_cleanup(peers_by_ip, "unref the peers_by_ip table");
+	ao2_t_cleanup(realtime_addr_misses, "unref the realtime_addr_misses table");
 	ao2_t_cleanup(dialogs, "unref the dialogs table");
 	ao2_t_cleanup(dialogs_needdestroy, "unref dialogs_needdestroy");
 	ao2_t_cleanup(dialogs_rtpcheck, "unref dialogs_rtpcheck");
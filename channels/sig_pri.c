@@ -413,12 +413,63 @@ static void sig_pri_deadlock_avoidance_private(struct sig_pri_chan *p)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Count taking the span lock, after waiting for it since start if busy.
+ *
+ * \note Assumes the pri->lock is already obtained.
+ */
+static void sig_pri_lock_taken(struct sig_pri_span *pri, const struct timeval *start)
+{
+	int64_t waited;
+
+	++pri->lock_stats.taken;
+	if (!start) {
+		return;
+	}
+	waited = ast_tvdiff_us(ast_tvnow(), *start);
+	++pri->lock_stats.waited;
+	pri->lock_stats.wait_us += waited;
+	if (pri->lock_stats.max_wait_us < waited) {
+		pri->lock_stats.max_wait_us = waited;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Obtain the span lock, counting how long it was waited for.
+ *
+ * \param pri PRI span control structure.
+ *
+ * \note Only for threads not holding a private lock, see pri_grab().
+ */
+static void sig_pri_span_lock(struct sig_pri_span *pri)
+{
+	struct timeval start;
+
+	if (!ast_mutex_trylock(&pri->lock)) {
+		sig_pri_lock_taken(pri, NULL);
+		return;
+	}
+	start = ast_tvnow();
+	ast_mutex_lock(&pri->lock);
+	sig_pri_lock_taken(pri, &start);
+}
+
 static void pri_grab(struct sig_pri_chan *p, struct sig_pri_span *pri)
 {
+	struct timeval start;
+
 	/* Grab the lock first */
-	while (ast_mutex_trylock(&pri->lock)) {
-		/* Avoid deadlock */
-		sig_pri_deadlock_avoidance_private(p);
+	if (ast_mutex_trylock(&pri->lock)) {
+		start = ast_tvnow();
+		do {
+			/* Avoid deadlock */
+			sig_pri_deadlock_avoidance_private(p);
+		} while (ast_mutex_trylock(&pri->lock));
+		sig_pri_lock_taken(pri, &start);
+	} else {
+		sig_pri_lock_taken(pri, NULL);
 	}
 	/* Then break the poll */
 	if (pri->master != AST_PTHREADT_NULL) {
@@ -6217,6 +6268,24 @@ setup_exit:;
 	}
 }
 
+/*!
+ * \internal
+ * \brief Count how long the span lock was held handling a D channel event.
+ *
+ * \note Assumes the pri->lock is already obtained.  Time the handler
+ * released the lock for, such as to create a channel, is counted too.
+ */
+static void sig_pri_event_handled(struct sig_pri_span *pri, const struct timeval *start)
+{
+	int64_t held = ast_tvdiff_us(ast_tvnow(), *start);
+
+	++pri->lock_stats.events;
+	pri->lock_stats.hold_us += held;
+	if (pri->lock_stats.max_hold_us < held) {
+		pri->lock_stats.max_hold_us = held;
+	}
+}
+
 static void *pri_dchannel(void *vpri)
 {
 	struct sig_pri_span *pri = vpri;
@@ -6271,7 +6340,7 @@ static void *pri_dchannel(void *vpri)
 		}
 		numdchans = i;
 		time(&t);
-		ast_mutex_lock(&pri->lock);
+		sig_pri_span_lock(pri);
 		if (pri->switchtype != PRI_SWITCH_GR303_TMC && (pri->sig != SIG_BRI_PTMP) && (pri->resetinterval > 0)) {
 			if (pri->resetting && pri_is_up(pri)) {
 				if (pri->resetpos < 0) {
@@ -6399,7 +6468,7 @@ static void *pri_dchannel(void *vpri)
 		pthread_testcancel();
 		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
 
-		ast_mutex_lock(&pri->lock);
+		sig_pri_span_lock(pri);
 		if (!res) {
 			for (which = 0; which < SIG_PRI_NUM_DCHANS; which++) {
 				if (!pri->dchans[which])
@@ -6435,6 +6504,7 @@ static void *pri_dchannel(void *vpri)
 		if (e) {
 			int chanpos = -1;
 			char cause_str[35];
+			struct timeval handled = ast_tvnow();
 
 			if (pri->debug) {
 				ast_verbose("Span %d: Processing event %s(%d)\n",
@@ -7605,6 +7675,7 @@ static void *pri_dchannel(void *vpri)
 			if (callid) {
 				ast_callid_threadassoc_remove();
 			}
+			sig_pri_event_handled(pri, &handled);
 		}
 		ast_mutex_unlock(&pri->lock);
 	}
@@ -8731,7 +8802,7 @@ int sig_pri_available(struct sig_pri_chan **pvt, int is_specific_channel)
 	}
 	pri = p->pri;
 
-	ast_mutex_lock(&pri->lock);
+	sig_pri_span_lock(pri);
 	if (
 #if defined(HAVE_PRI_CALL_WAITING)
 		/*
@@ -8873,7 +8944,7 @@ static void sig_pri_send_mwi_indication(struct sig_pri_span *pri, const char *vm
 		ast_copy_string(voicemail.number.str, vm_number, sizeof(voicemail.number.str));
 	}
 
-	ast_mutex_lock(&pri->lock);
+	sig_pri_span_lock(pri);
 #if defined(HAVE_PRI_MWI_V2)
 	pri_mwi_indicate_v2(pri->pri, &mailbox, &voicemail, 1 /* speech */, num_messages,
 		NULL, NULL, -1, 0);
@@ -9407,6 +9478,7 @@ void sig_pri_cli_show_span(int fd, int *dchannels, struct sig_pri_span *pri)
 {
 	int x;
 	char status[256];
+	struct sig_pri_lock_stats stats;
 
 	for (x = 0; x < SIG_PRI_NUM_DCHANS; x++) {
 		if (pri->dchans[x]) {
@@ -9431,6 +9503,17 @@ void sig_pri_cli_show_span(int fd, int *dchannels, struct sig_pri_span *pri)
 			ast_cli(fd, "\n");
 		}
 	}
+
+	ast_mutex_lock(&pri->lock);
+	stats = pri->lock_stats;
+	ast_mutex_unlock(&pri->lock);
+	ast_cli(fd, "Span lock taken: %lu, waited for: %lu (%.1f%%)\n", stats.taken, stats.waited,
+		stats.taken ? 100.0 * stats.waited / stats.taken : 0.0);
+	ast_cli(fd, "Span lock wait: %llu us average, %lu us longest\n",
+		stats.waited ? stats.wait_us / stats.waited : 0, stats.max_wait_us);
+	ast_cli(fd, "D-channel events: %lu, lock held %llu us average, %lu us longest\n",
+		stats.events, stats.events ? stats.hold_us / stats.events : 0, stats.max_hold_us);
+	ast_cli(fd, "\n");
 }
 
 int pri_send_keypad_facility_exec(struct sig_pri_chan *p, const char *digits)
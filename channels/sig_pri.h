@@ -443,6 +443,24 @@ enum sig_pri_colp_signaling {
 	SIG_PRI_COLP_UPDATE,
 };
 
+/*! \brief How long the lock of a span is waited for and held */
+struct sig_pri_lock_stats {
+	/*! Times a channel thread or the D channel thread took the lock */
+	unsigned long taken;
+	/*! Times the lock was busy and had to be waited for */
+	unsigned long waited;
+	/*! Microseconds waited for the lock in all */
+	unsigned long long wait_us;
+	/*! Longest wait for the lock in microseconds */
+	unsigned long max_wait_us;
+	/*! D channel events handled */
+	unsigned long events;
+	/*! Microseconds the lock was held handling D channel events in all */
+	unsigned long long hold_us;
+	/*! Longest the lock was held handling a D channel event in microseconds */
+	unsigned long max_hold_us;
+};
+
 struct sig_pri_span {
 	/* Should be set by user */
 	struct ast_cc_config_params *cc_params;			/*!< CC config parameters for each new call. */
@@ -616,6 +634,8 @@ struct sig_pri_span {
 	struct sig_pri_chan *pvts[SIG_PRI_MAX_CHANNELS];/*!< Member channel pvt structs */
 	pthread_t master;							/*!< Thread of master */
 	ast_mutex_t lock;							/*!< libpri access Mutex */
+	/*! How long the span lock is waited for and held, updated with it held */
+	struct sig_pri_lock_stats lock_stats;
 	time_t lastreset;							/*!< time when unused channels were last reset */
 	/*!
 	 * \brief Congestion device state of the span.
@@ -50,9 +50,8 @@ static int alawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 
 	pvt->samples += i;
 	pvt->datalen += i * 2;	/* 2 bytes/sample */
-	
-	while (i--)
-		*dst++ = AST_ALAW(*src++);
+
+	ast_alaw_decode(dst, src, i);
 
 	return 0;
 }
@@ -67,12 +66,54 @@ static int lintoalaw_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->samples += i;
 	pvt->datalen += i;	/* 1 byte/sample */
 
-	while (i--) 
-		*dst++ = AST_LIN2A(*src++);
+	ast_alaw_encode((unsigned char *) dst, src, i);
 
 	return 0;
 }
 
+/*!
+ * \brief Convert a batch of frames with one of the framein routines above.
+ *
+ * A-law conversion keeps no state, so every frame can be converted and
+ * emitted on its own without a trip through the generic wrappers.
+ */
+static inline struct ast_frame *alaw_batch(struct ast_trans_pvt *pvt, struct ast_frame *in,
+	int (*convert)(struct ast_trans_pvt *pvt, struct ast_frame *f))
+{
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+	struct ast_frame *out;
+
+	for (; in; in = AST_LIST_NEXT(in, frame_list)) {
+		if (!in->datalen || in->samples > BUFFER_SAMPLES) {
+			continue;
+		}
+		ast_trans_frame_timing(pvt, in);
+		convert(pvt, in);
+		if (!(out = ast_trans_frameout(pvt, 0, 0))) {
+			continue;
+		}
+		if (tail) {
+			AST_LIST_NEXT(tail, frame_list) = out;
+		} else {
+			head = out;
+		}
+		tail = out;
+	}
+
+	return head;
+}
+
+static struct ast_frame *alawtolin_batch(struct ast_trans_pvt *pvt, struct ast_frame *in)
+{
+	return alaw_batch(pvt, in, alawtolin_framein);
+}
+
+static struct ast_frame *lintoalaw_batch(struct ast_trans_pvt *pvt, struct ast_frame *in)
+{
+	return alaw_batch(pvt, in, lintoalaw_framein);
+}
+
 static struct ast_translator alawtolin = {
 	.name = "alawtolin",
 	.src_codec = {
@@ -87,6 +128,7 @@ static struct ast_translator alawtolin = {
 	},
 	.format = "slin",
 	.framein = alawtolin_framein,
+	.translate_batch = alawtolin_batch,
 	.sample = alaw_sample,
 	.buffer_samples = BUFFER_SAMPLES,
 	.buf_size = BUFFER_SAMPLES * 2,
@@ -106,6 +148,7 @@ static struct ast_translator lintoalaw = {
 	},
 	.format = "alaw",
 	.framein = lintoalaw_framein,
+	.translate_batch = lintoalaw_batch,
 	.sample = slin8_sample,
 	.buffer_samples = BUFFER_SAMPLES,
 	.buf_size = BUFFER_SAMPLES,
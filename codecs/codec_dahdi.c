@@ -295,14 +295,11 @@ struct codec_dahdi_pvt {
 static int ulawtolin(struct ast_trans_pvt *pvt, int samples)
 {
 	struct codec_dahdi_pvt *dahdip = pvt->pvt;
-	int i = samples;
 	uint8_t *src = &dahdip->ulaw_buffer[0];
 	int16_t *dst = pvt->outbuf.i16 + pvt->datalen;
 
 	/* convert and copy in outbuf */
-	while (i--) {
-		*dst++ = AST_MULAW(*src++);
-	}
+	ast_ulaw_decode(dst, src, samples);
 
 	return 0;
 }
@@ -320,9 +317,7 @@ static int lintoulaw(struct ast_trans_pvt *pvt, struct ast_frame *f)
 		return -i;
 	}
 
-	while (i--) {
-		*dst++ = AST_LIN2MU(*src++);
-	}
+	ast_ulaw_encode(dst, src, i);
 
 	dahdip->samples_in_buffer += f->samples;
 	return 0;
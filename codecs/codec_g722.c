@@ -39,11 +39,14 @@
 
 #include "asterisk.h"
 
+#include <math.h>
+
 #include "asterisk/linkedlists.h"
 #include "asterisk/module.h"
 #include "asterisk/config.h"
 #include "asterisk/translate.h"
 #include "asterisk/utils.h"
+#include "asterisk/test.h"
 
 #define BUFFER_SAMPLES   8096	/* size for the translation buffers */
 #define BUF_SHIFT	5
@@ -218,10 +221,124 @@ static struct ast_translator lin16tog722 = {
 	.buf_size = BUFFER_SAMPLES,
 };
 
+#ifdef TEST_FRAMEWORK
+/*! \brief One second of wideband audio for the QMF kernel test */
+#define TEST_SAMPLES 16000
+
+/*!
+ * \brief Encode and decode with the current QMF kernel.
+ *
+ * The decoder is also fed arbitrary G.722 data, which drives it to
+ * the limits of its range.
+ */
+static void g722_qmf_test_run(const int16_t *in, const uint8_t *noise, uint8_t *encoded, int16_t *decoded, int16_t *decoded_noise)
+{
+	g722_encode_state_t enc;
+	g722_decode_state_t dec;
+
+	g722_encode_init(&enc, 64000, 0);
+	g722_encode(&enc, encoded, in, TEST_SAMPLES);
+
+	g722_decode_init(&dec, 64000, 0);
+	g722_decode(&dec, decoded, encoded, TEST_SAMPLES / 2);
+
+	g722_decode_init(&dec, 64000, 0);
+	g722_decode(&dec, decoded_noise, noise, TEST_SAMPLES / 2);
+}
+
+AST_TEST_DEFINE(qmf_bit_exact)
+{
+	int16_t *in;
+	uint8_t *noise;
+	uint8_t *encoded[2];
+	int16_t *decoded[2];
+	int16_t *decoded_noise[2];
+	const char *kernel;
+	unsigned int seed = 1;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "qmf_bit_exact";
+		info->category = "/codecs/g722/";
+		info->summary = "G.722 QMF kernels are bit exact";
+		info->description =
+			"Check that the G.722 encoder and decoder give the same output with the\n"
+			"vector QMF kernel chosen for this CPU as with the scalar kernel.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	in = ast_malloc(TEST_SAMPLES * sizeof(*in));
+	noise = ast_malloc(TEST_SAMPLES / 2);
+	encoded[0] = ast_malloc(TEST_SAMPLES / 2);
+	encoded[1] = ast_malloc(TEST_SAMPLES / 2);
+	decoded[0] = ast_malloc(TEST_SAMPLES * sizeof(int16_t));
+	decoded[1] = ast_malloc(TEST_SAMPLES * sizeof(int16_t));
+	decoded_noise[0] = ast_malloc(TEST_SAMPLES * sizeof(int16_t));
+	decoded_noise[1] = ast_malloc(TEST_SAMPLES * sizeof(int16_t));
+	if (!in || !noise || !encoded[0] || !encoded[1] || !decoded[0] || !decoded[1]
+		|| !decoded_noise[0] || !decoded_noise[1]) {
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	/* A tone sweeping up to full scale, then clipped noise */
+	for (i = 0; i < TEST_SAMPLES; i++) {
+		seed = seed * 1103515245 + 12345;
+		if (i < TEST_SAMPLES / 2) {
+			in[i] = (int16_t) (sin(i * (i / 40000.0)) * 65 * i / 16);
+		} else {
+			in[i] = (int16_t) (seed >> 16);
+		}
+		if (i < TEST_SAMPLES / 2) {
+			noise[i] = seed >> 24;
+		}
+	}
+
+	g722_qmf_init();
+	kernel = g722_qmf_kernel_name();
+	ast_test_status_update(test, "Comparing the %s kernel with the scalar kernel\n", kernel);
+
+	g722_qmf_set_kernel("scalar");
+	g722_qmf_test_run(in, noise, encoded[0], decoded[0], decoded_noise[0]);
+	g722_qmf_set_kernel(kernel);
+	g722_qmf_test_run(in, noise, encoded[1], decoded[1], decoded_noise[1]);
+
+	if (memcmp(encoded[0], encoded[1], TEST_SAMPLES / 2)) {
+		ast_test_status_update(test, "Encoder output differs\n");
+		res = AST_TEST_FAIL;
+	}
+	if (memcmp(decoded[0], decoded[1], TEST_SAMPLES * sizeof(int16_t))) {
+		ast_test_status_update(test, "Decoder output differs\n");
+		res = AST_TEST_FAIL;
+	}
+	if (memcmp(decoded_noise[0], decoded_noise[1], TEST_SAMPLES * sizeof(int16_t))) {
+		ast_test_status_update(test, "Decoder output for arbitrary data differs\n");
+		res = AST_TEST_FAIL;
+	}
+
+cleanup:
+	ast_free(in);
+	ast_free(noise);
+	for (i = 0; i < 2; i++) {
+		ast_free(encoded[i]);
+		ast_free(decoded[i]);
+		ast_free(decoded_noise[i]);
+	}
+
+	return res;
+}
+#endif
+
 static int unload_module(void)
 {
 	int res = 0;
 
+	AST_TEST_UNREGISTER(qmf_bit_exact);
+
 	res |= ast_unregister_translator(&g722tolin);
 	res |= ast_unregister_translator(&lintog722);
 	res |= ast_unregister_translator(&g722tolin16);
@@ -234,6 +351,9 @@ static int load_module(void)
 {
 	int res = 0;
 
+	g722_qmf_init();
+	ast_verb(2, "G.722 QMF filter uses the %s kernel\n", g722_qmf_kernel_name());
+
 	res |= ast_register_translator(&g722tolin);
 	res |= ast_register_translator(&lintog722);
 	res |= ast_register_translator(&g722tolin16);
@@ -244,6 +364,8 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}	
 
+	AST_TEST_REGISTER(qmf_bit_exact);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
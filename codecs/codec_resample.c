@@ -35,9 +35,42 @@
 #include "asterisk/module.h"
 #include "asterisk/translate.h"
 #include "asterisk/slin.h"
+#include "asterisk/astobj2.h"
 
 #define OUTBUF_SAMPLES   11520
 
+/*! \brief Resampler quality for AST_TRANSLATE_QUALITY_DEFAULT */
+#define RESAMPLER_QUALITY 5
+
+/*! \brief Resampler quality for AST_TRANSLATE_QUALITY_FAST */
+#define RESAMPLER_FAST_QUALITY 2
+
+/*!
+ * \brief A resampler filter shared by every translation between two rates
+ *
+ * Computing the filter table is most of the work of creating a resampler,
+ * and the table only depends on the rates and the quality.  It is computed
+ * once, by a resampler which is never run, and the resampler of each
+ * translation borrows it.
+ */
+struct resamp_filter {
+	unsigned int in_rate;
+	unsigned int out_rate;
+	int quality;
+	/*! The resampler owning the filter table */
+	SpeexResamplerState *base;
+};
+
+/*! \brief Private data of a translation */
+struct resamp_pvt {
+	SpeexResamplerState *resampler;
+	/*! The filter the resampler borrows */
+	struct resamp_filter *filter;
+};
+
+/*! \brief The filters built so far, kept until the module unloads */
+static struct ao2_container *filters;
+
 static struct ast_translator *translators;
 static int trans_size;
 static struct ast_codec codec_list[] = {
@@ -88,11 +121,94 @@ static struct ast_codec codec_list[] = {
 	},
 };
 
-static int resamp_new(struct ast_trans_pvt *pvt)
+static int resamp_filter_hash_fn(const void *obj, const int flags)
+{
+	const struct resamp_filter *filter = obj;
+
+	return (filter->in_rate * 31 + filter->out_rate) * 31 + filter->quality;
+}
+
+static int resamp_filter_cmp_fn(void *obj, void *arg, int flags)
 {
+	const struct resamp_filter *left = obj;
+	const struct resamp_filter *right = arg;
+
+	return (left->in_rate == right->in_rate && left->out_rate == right->out_rate
+		&& left->quality == right->quality) ? CMP_MATCH : 0;
+}
+
+static void resamp_filter_destructor(void *obj)
+{
+	struct resamp_filter *filter = obj;
+
+	if (filter->base) {
+		speex_resampler_destroy(filter->base);
+	}
+}
+
+/*!
+ * \brief Find the filter for two rates and a quality, building it if needed
+ *
+ * \return The filter with a reference the caller must release, or NULL on failure
+ */
+static struct resamp_filter *resamp_filter_get(unsigned int in_rate, unsigned int out_rate, int quality)
+{
+	struct resamp_filter key = { .in_rate = in_rate, .out_rate = out_rate, .quality = quality, };
+	struct resamp_filter *filter;
 	int err;
 
-	if (!(pvt->pvt = speex_resampler_init(1, pvt->t->src_codec.sample_rate, pvt->t->dst_codec.sample_rate, 5, &err))) {
+	ao2_lock(filters);
+	filter = ao2_find(filters, &key, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+	if (!filter) {
+		filter = ao2_alloc_options(sizeof(*filter), resamp_filter_destructor,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (filter) {
+			*filter = key;
+			filter->base = speex_resampler_init(1, in_rate, out_rate, quality, &err);
+			if (filter->base) {
+				ao2_link_flags(filters, filter, OBJ_NOLOCK);
+			} else {
+				ao2_ref(filter, -1);
+				filter = NULL;
+			}
+		}
+	}
+	ao2_unlock(filters);
+
+	return filter;
+}
+
+/*! \brief Give a translation a resampler of the given quality, replacing any it has */
+static int resamp_setup(struct ast_trans_pvt *pvt, int quality)
+{
+	struct resamp_pvt *resamp = pvt->pvt;
+	struct resamp_filter *filter;
+	SpeexResamplerState *resampler;
+
+	filter = resamp_filter_get(pvt->t->src_codec.sample_rate, pvt->t->dst_codec.sample_rate, quality);
+	if (!filter) {
+		return -1;
+	}
+
+	resampler = speex_resampler_init_shared(filter->base, NULL);
+	if (!resampler) {
+		ao2_ref(filter, -1);
+		return -1;
+	}
+
+	if (resamp->resampler) {
+		speex_resampler_destroy(resamp->resampler);
+	}
+	ao2_cleanup(resamp->filter);
+	resamp->resampler = resampler;
+	resamp->filter = filter;
+
+	return 0;
+}
+
+static int resamp_new(struct ast_trans_pvt *pvt)
+{
+	if (resamp_setup(pvt, RESAMPLER_QUALITY)) {
 		return -1;
 	}
 
@@ -104,14 +220,32 @@ static int resamp_new(struct ast_trans_pvt *pvt)
 
 static void resamp_destroy(struct ast_trans_pvt *pvt)
 {
-	SpeexResamplerState *resamp_pvt = pvt->pvt;
+	struct resamp_pvt *resamp = pvt->pvt;
+
+	/* The resampler borrows the filter's table, so it goes first. */
+	if (resamp->resampler) {
+		speex_resampler_destroy(resamp->resampler);
+		resamp->resampler = NULL;
+	}
+	ao2_cleanup(resamp->filter);
+	resamp->filter = NULL;
+}
+
+static int resamp_set_quality(struct ast_trans_pvt *pvt, enum ast_translate_quality quality)
+{
+	struct resamp_pvt *resamp = pvt->pvt;
+	int level = quality == AST_TRANSLATE_QUALITY_FAST ? RESAMPLER_FAST_QUALITY : RESAMPLER_QUALITY;
+
+	if (resamp->filter->quality == level) {
+		return 0;
+	}
 
-	speex_resampler_destroy(resamp_pvt);
+	return resamp_setup(pvt, level);
 }
 
 static int resamp_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
-	SpeexResamplerState *resamp_pvt = pvt->pvt;
+	struct resamp_pvt *resamp = pvt->pvt;
 	unsigned int out_samples = OUTBUF_SAMPLES - pvt->samples;
 	unsigned int in_samples;
 
@@ -120,7 +254,7 @@ static int resamp_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	}
 	in_samples = f->datalen / 2;
 
-	speex_resampler_process_int(resamp_pvt,
+	speex_resampler_process_int(resamp->resampler,
 		0,
 		f->data.ptr,
 		&in_samples,
@@ -142,6 +276,8 @@ static int unload_module(void)
 		res |= ast_unregister_translator(&translators[idx]);
 	}
 	ast_free(translators);
+	ao2_cleanup(filters);
+	filters = NULL;
 
 	return res;
 }
@@ -151,8 +287,15 @@ static int load_module(void)
 	int res = 0;
 	int x, y, idx = 0;
 
+	filters = ao2_container_alloc(37, resamp_filter_hash_fn, resamp_filter_cmp_fn);
+	if (!filters) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	trans_size = ARRAY_LEN(codec_list) * (ARRAY_LEN(codec_list) - 1);
 	if (!(translators = ast_calloc(1, sizeof(struct ast_translator) * trans_size))) {
+		ao2_ref(filters, -1);
+		filters = NULL;
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
@@ -164,7 +307,8 @@ static int load_module(void)
 			translators[idx].newpvt = resamp_new;
 			translators[idx].destroy = resamp_destroy;
 			translators[idx].framein = resamp_framein;
-			translators[idx].desc_size = 0;
+			translators[idx].set_quality = resamp_set_quality;
+			translators[idx].desc_size = sizeof(struct resamp_pvt);
 			translators[idx].buffer_samples = OUTBUF_SAMPLES;
 			translators[idx].buf_size = (OUTBUF_SAMPLES * sizeof(int16_t));
 			memcpy(&translators[idx].src_codec, &codec_list[x], sizeof(struct ast_codec));
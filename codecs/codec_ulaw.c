@@ -52,8 +52,7 @@ static int ulawtolin_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->datalen += i * 2;	/* 2 bytes/sample */
 
 	/* convert and copy in outbuf */
-	while (i--)
-		*dst++ = AST_MULAW(*src++);
+	ast_ulaw_decode(dst, src, i);
 
 	return 0;
 }
@@ -68,12 +67,54 @@ static int lintoulaw_framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 	pvt->samples += i;
 	pvt->datalen += i;	/* 1 byte/sample */
 
-	while (i--)
-		*dst++ = AST_LIN2MU(*src++);
+	ast_ulaw_encode((unsigned char *) dst, src, i);
 
 	return 0;
 }
 
+/*!
+ * \brief translate_batch callback shared by every direction.
+ *
+ * Each frame is converted by \a convert and copied out straight away,
+ * which is all the framein and frameout wrappers end up doing for mu-law.
+ */
+static inline struct ast_frame *ulaw_batch(struct ast_trans_pvt *pvt, struct ast_frame *in,
+	int (*convert)(struct ast_trans_pvt *pvt, struct ast_frame *f))
+{
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+	struct ast_frame *out;
+
+	for (; in; in = AST_LIST_NEXT(in, frame_list)) {
+		if (!in->datalen || in->samples > BUFFER_SAMPLES) {
+			continue;
+		}
+		ast_trans_frame_timing(pvt, in);
+		convert(pvt, in);
+		if (!(out = ast_trans_frameout(pvt, 0, 0))) {
+			continue;
+		}
+		if (tail) {
+			AST_LIST_NEXT(tail, frame_list) = out;
+		} else {
+			head = out;
+		}
+		tail = out;
+	}
+
+	return head;
+}
+
+static struct ast_frame *ulawtolin_batch(struct ast_trans_pvt *pvt, struct ast_frame *in)
+{
+	return ulaw_batch(pvt, in, ulawtolin_framein);
+}
+
+static struct ast_frame *lintoulaw_batch(struct ast_trans_pvt *pvt, struct ast_frame *in)
+{
+	return ulaw_batch(pvt, in, lintoulaw_framein);
+}
+
 /*!
  * \brief The complete translator for ulawToLin.
  */
@@ -92,6 +133,7 @@ static struct ast_translator ulawtolin = {
 	},
 	.format = "slin",
 	.framein = ulawtolin_framein,
+	.translate_batch = ulawtolin_batch,
 	.sample = ulaw_sample,
 	.buffer_samples = BUFFER_SAMPLES,
 	.buf_size = BUFFER_SAMPLES * 2,
@@ -111,6 +153,7 @@ static struct ast_translator testlawtolin = {
 	},
 	.format = "slin",
 	.framein = ulawtolin_framein,
+	.translate_batch = ulawtolin_batch,
 	.sample = ulaw_sample,
 	.buffer_samples = BUFFER_SAMPLES,
 	.buf_size = BUFFER_SAMPLES * 2,
@@ -134,6 +177,7 @@ static struct ast_translator lintoulaw = {
 	},
 	.format = "ulaw",
 	.framein = lintoulaw_framein,
+	.translate_batch = lintoulaw_batch,
 	.sample = slin8_sample,
 	.buf_size = BUFFER_SAMPLES,
 	.buffer_samples = BUFFER_SAMPLES,
@@ -153,6 +197,7 @@ static struct ast_translator lintotestlaw = {
 	},
 	.format = "testlaw",
 	.framein = lintoulaw_framein,
+	.translate_batch = lintoulaw_batch,
 	.sample = slin8_sample,
 	.buf_size = BUFFER_SAMPLES,
 	.buffer_samples = BUFFER_SAMPLES,
@@ -65,8 +65,11 @@ typedef struct
     /*! 6 for 48000kbps, 7 for 56000kbps, or 8 for 64000kbps. */
     int bits_per_sample;
 
-    /*! Signal history for the QMF */
-    int x[24];
+    /*! Signal history for the QMF, kept twice so the 24 most recent samples
+        always start contiguously at x[x_pos] */
+    int16_t x[48];
+    /*! Start of the QMF signal history in x */
+    int x_pos;
 
     struct
     {
@@ -103,8 +106,11 @@ typedef struct
     /*! 6 for 48000kbps, 7 for 56000kbps, or 8 for 64000kbps. */
     int bits_per_sample;
 
-    /*! Signal history for the QMF */
-    int x[24];
+    /*! Signal history for the QMF, kept twice so the 24 most recent samples
+        always start contiguously at x[x_pos] */
+    int16_t x[48];
+    /*! Start of the QMF signal history in x */
+    int x_pos;
 
     struct
     {
@@ -133,6 +139,19 @@ typedef struct
 extern "C" {
 #endif
 
+/*! Select the fastest QMF filter kernel this CPU supports. */
+void g722_qmf_init(void);
+
+/*! Select a QMF filter kernel by name, returning -1 if it is unknown or not supported. */
+int g722_qmf_set_kernel(const char *name);
+
+/*! Name of the QMF filter kernel in use. */
+const char *g722_qmf_kernel_name(void);
+
+/*! Apply the QMF to the 24 most recent samples in x, oldest first, giving the
+    sums over the even and odd indexed samples. */
+void g722_qmf(const int16_t x[], int *sum_even_idx, int *sum_odd_idx);
+
 g722_encode_state_t *g722_encode_init(g722_encode_state_t *s, int rate, int options);
 int g722_encode_release(g722_encode_state_t *s);
 int g722_encode(g722_encode_state_t *s, uint8_t g722_data[], const int16_t amp[], int len);
@@ -235,10 +235,6 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
            1688,   1360,   1040,    728,
             432,    136,   -432,   -136
     };
-    static const int qmf_coeffs[12] =
-    {
-           3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
-    };
 
     int dlowt;
     int rlow;
@@ -252,7 +248,6 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
     int wd3;
     int code;
     int outlen;
-    int i;
     int j;
 
     outlen = 0;
@@ -375,18 +370,14 @@ int g722_decode(g722_decode_state_t *s, int16_t amp[], const uint8_t g722_data[]
             else
             {
                 /* Apply the receive QMF */
-                for (i = 0;  i < 22;  i++)
-                    s->x[i] = s->x[i + 2];
-                s->x[22] = rlow + rhigh;
-                s->x[23] = rlow - rhigh;
-
-                xout1 = 0;
-                xout2 = 0;
-                for (i = 0;  i < 12;  i++)
-                {
-                    xout2 += s->x[2*i]*qmf_coeffs[i];
-                    xout1 += s->x[2*i + 1]*qmf_coeffs[11 - i];
-                }
+                /* Replace the oldest two samples, in both copies of the history */
+                s->x[s->x_pos] =
+                s->x[s->x_pos + 24] = (int16_t) (rlow + rhigh);
+                s->x[s->x_pos + 1] =
+                s->x[s->x_pos + 25] = (int16_t) (rlow - rhigh);
+                s->x_pos = (s->x_pos + 2) % 24;
+
+                g722_qmf(&s->x[s->x_pos], &xout2, &xout1);
                 amp[outlen++] = (int16_t) (xout1 >> 11);
                 amp[outlen++] = (int16_t) (xout2 >> 11);
             }
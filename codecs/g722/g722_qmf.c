@@ -0,0 +1,232 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief The G.722 QMF filter bank, with vector kernels chosen at runtime.
+ *
+ * Both directions of the codec run the same 24 tap filter over the 24 most
+ * recent samples, once for every pair of wideband samples.  The history only
+ * ever holds 16 bit values, so the products and their sums fit in 32 bits and
+ * every kernel gives exactly the same result as the scalar one.
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <string.h>
+
+#include "g722.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define G722_HAVE_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define G722_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+
+static const int qmf_coeffs[12] =
+{
+       3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11,
+};
+
+struct g722_qmf_kernel
+{
+    const char *name;
+    int (*supported)(void);
+    void (*qmf)(const int16_t x[], int *sum_even_idx, int *sum_odd_idx);
+};
+
+static int scalar_supported(void)
+{
+    return 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static void scalar_qmf(const int16_t x[], int *sum_even_idx, int *sum_odd_idx)
+{
+    int even;
+    int odd;
+    int i;
+
+    even = 0;
+    odd = 0;
+    for (i = 0;  i < 12;  i++)
+    {
+        even += x[2*i]*qmf_coeffs[i];
+        odd += x[2*i + 1]*qmf_coeffs[11 - i];
+    }
+    *sum_even_idx = even;
+    *sum_odd_idx = odd;
+}
+/*- End of function --------------------------------------------------------*/
+
+#ifdef G722_HAVE_X86
+/* The coefficients laid out against the history, with zeros in the lanes of
+   the other sum, so pmaddwd does two taps of one sum per 32 bit lane. */
+static const int16_t sse2_even_coeffs[24] __attribute__((aligned(16))) =
+{
+       3, 0,  -11, 0,   12, 0,   32, 0, -210, 0,  951, 0,
+    3876, 0, -805, 0,  362, 0, -156, 0,   53, 0,  -11, 0
+};
+static const int16_t sse2_odd_coeffs[24] __attribute__((aligned(16))) =
+{
+    0,  -11, 0,   53, 0, -156, 0,  362, 0, -805, 0, 3876,
+    0,  951, 0, -210, 0,   32, 0,   12, 0,  -11, 0,    3
+};
+
+static int sse2_supported(void)
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int __attribute__((target("sse2"))) sse2_hsum(__m128i v)
+{
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2)));
+    v = _mm_add_epi32(v, _mm_shuffle_epi32(v, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(v);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void __attribute__((target("sse2"))) sse2_qmf(const int16_t x[], int *sum_even_idx, int *sum_odd_idx)
+{
+    __m128i x0 = _mm_loadu_si128((const __m128i *) &x[0]);
+    __m128i x1 = _mm_loadu_si128((const __m128i *) &x[8]);
+    __m128i x2 = _mm_loadu_si128((const __m128i *) &x[16]);
+    __m128i even;
+    __m128i odd;
+
+    even = _mm_madd_epi16(x0, _mm_load_si128((const __m128i *) &sse2_even_coeffs[0]));
+    even = _mm_add_epi32(even, _mm_madd_epi16(x1, _mm_load_si128((const __m128i *) &sse2_even_coeffs[8])));
+    even = _mm_add_epi32(even, _mm_madd_epi16(x2, _mm_load_si128((const __m128i *) &sse2_even_coeffs[16])));
+    odd = _mm_madd_epi16(x0, _mm_load_si128((const __m128i *) &sse2_odd_coeffs[0]));
+    odd = _mm_add_epi32(odd, _mm_madd_epi16(x1, _mm_load_si128((const __m128i *) &sse2_odd_coeffs[8])));
+    odd = _mm_add_epi32(odd, _mm_madd_epi16(x2, _mm_load_si128((const __m128i *) &sse2_odd_coeffs[16])));
+
+    *sum_even_idx = sse2_hsum(even);
+    *sum_odd_idx = sse2_hsum(odd);
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+#ifdef G722_HAVE_NEON
+/* The coefficients for the even and the odd indexed samples, in the order
+   vld2 deinterleaves the history. */
+static const int16_t neon_even_coeffs[12] =
+{
+       3,  -11,   12,   32, -210,  951, 3876, -805,  362, -156,   53,  -11
+};
+static const int16_t neon_odd_coeffs[12] =
+{
+     -11,   53, -156,  362, -805, 3876,  951, -210,   32,   12,  -11,    3
+};
+
+/* NEON is part of the baseline when the compiler was told to use it. */
+static int neon_supported(void)
+{
+    return 1;
+}
+/*- End of function --------------------------------------------------------*/
+
+static __inline__ int neon_hsum(int32x4_t v)
+{
+    int32x2_t sum = vadd_s32(vget_low_s32(v), vget_high_s32(v));
+
+    return vget_lane_s32(vpadd_s32(sum, sum), 0);
+}
+/*- End of function --------------------------------------------------------*/
+
+static void neon_qmf(const int16_t x[], int *sum_even_idx, int *sum_odd_idx)
+{
+    int16x8x2_t head = vld2q_s16(&x[0]);
+    int16x4x2_t tail = vld2_s16(&x[16]);
+    int16x8_t even_coeffs = vld1q_s16(&neon_even_coeffs[0]);
+    int16x8_t odd_coeffs = vld1q_s16(&neon_odd_coeffs[0]);
+    int32x4_t even;
+    int32x4_t odd;
+
+    even = vmull_s16(vget_low_s16(head.val[0]), vget_low_s16(even_coeffs));
+    even = vmlal_s16(even, vget_high_s16(head.val[0]), vget_high_s16(even_coeffs));
+    even = vmlal_s16(even, tail.val[0], vld1_s16(&neon_even_coeffs[8]));
+    odd = vmull_s16(vget_low_s16(head.val[1]), vget_low_s16(odd_coeffs));
+    odd = vmlal_s16(odd, vget_high_s16(head.val[1]), vget_high_s16(odd_coeffs));
+    odd = vmlal_s16(odd, tail.val[1], vld1_s16(&neon_odd_coeffs[8]));
+
+    *sum_even_idx = neon_hsum(even);
+    *sum_odd_idx = neon_hsum(odd);
+}
+/*- End of function --------------------------------------------------------*/
+#endif
+
+/*! Compiled in kernels, from least to most preferred */
+static const struct g722_qmf_kernel kernels[] =
+{
+    { "scalar", scalar_supported, scalar_qmf },
+#ifdef G722_HAVE_X86
+    { "sse2", sse2_supported, sse2_qmf },
+#endif
+#ifdef G722_HAVE_NEON
+    { "neon", neon_supported, neon_qmf },
+#endif
+};
+
+static const struct g722_qmf_kernel *qmf_kernel = &kernels[0];
+
+void g722_qmf_init(void)
+{
+    int i;
+
+    for (i = sizeof(kernels)/sizeof(kernels[0]) - 1;  i > 0;  i--)
+    {
+        if (kernels[i].supported())
+            break;
+    }
+    qmf_kernel = &kernels[i];
+}
+/*- End of function --------------------------------------------------------*/
+
+int g722_qmf_set_kernel(const char *name)
+{
+    int i;
+
+    for (i = 0;  i < (int) (sizeof(kernels)/sizeof(kernels[0]));  i++)
+    {
+        if (strcmp(kernels[i].name, name) == 0  &&  kernels[i].supported())
+        {
+            qmf_kernel = &kernels[i];
+            return 0;
+        }
+    }
+    return -1;
+}
+/*- End of function --------------------------------------------------------*/
+
+const char *g722_qmf_kernel_name(void)
+{
+    return qmf_kernel->name;
+}
+/*- End of function --------------------------------------------------------*/
+
+void g722_qmf(const int16_t x[], int *sum_even_idx, int *sum_odd_idx)
+{
+    qmf_kernel->qmf(x, sum_even_idx, sum_odd_idx);
+}
+/*- End of function --------------------------------------------------------*/
+/*- End of file ------------------------------------------------------------*/
@@ -92,6 +92,10 @@ static void speex_free (void *ptr) {free(ptr);}
 #include "resample_sse.h"
 #endif
 
+#if defined(FIXED_POINT) && (defined(__SSE2__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#include "resample_fixed_simd.h"
+#endif
+
 /* Numer of elements to allocate on the stack */
 #ifdef VAR_ARRAYS
 #define FIXED_STACK_ALLOC 8192
@@ -127,6 +131,7 @@ struct SpeexResamplerState_ {
    spx_word16_t *mem;
    spx_word16_t *sinc_table;
    spx_uint32_t sinc_table_length;
+   int          sinc_table_shared;
    resampler_basic_func resampler_ptr;
          
    int    in_stride;
@@ -330,7 +335,6 @@ static int resampler_basic_direct_single(SpeexResamplerState *st, spx_uint32_t c
    const int frac_advance = st->frac_advance;
    const spx_uint32_t den_rate = st->den_rate;
    spx_word32_t sum;
-   int j;
 
    while (!(last_sample >= (spx_int32_t)*in_len || out_sample >= (spx_int32_t)*out_len))
    {
@@ -339,6 +343,7 @@ static int resampler_basic_direct_single(SpeexResamplerState *st, spx_uint32_t c
 
 #ifndef OVERRIDE_INNER_PRODUCT_SINGLE
       float accum[4] = {0,0,0,0};
+      int j;
 
       for(j=0;j<N;j+=4) {
         accum[0] += sinc[j]*iptr[j];
@@ -545,6 +550,13 @@ static void update_filter(SpeexResamplerState *st)
    spx_uint32_t old_length;
    
    old_length = st->filt_len;
+   if (st->sinc_table_shared)
+   {
+      /* Leave the shared table alone and build one of our own */
+      st->sinc_table = NULL;
+      st->sinc_table_length = 0;
+      st->sinc_table_shared = 0;
+   }
    st->oversample = quality_map[st->quality].oversample;
    st->filt_len = quality_map[st->quality].base_length;
    
@@ -732,6 +744,7 @@ static void update_filter(SpeexResamplerState *st)
    st->den_rate = 0;
    st->quality = -1;
    st->sinc_table_length = 0;
+   st->sinc_table_shared = 0;
    st->mem_alloc_size = 0;
    st->filt_len = 0;
    st->mem = 0;
@@ -772,10 +785,52 @@ static void update_filter(SpeexResamplerState *st)
    return st;
 }
 
+ SpeexResamplerState *speex_resampler_init_shared(const SpeexResamplerState *base, int *err)
+{
+   spx_uint32_t i;
+   SpeexResamplerState *st;
+   st = (SpeexResamplerState *)speex_alloc(sizeof(SpeexResamplerState));
+   if (!st)
+   {
+      if (err)
+         *err = RESAMPLER_ERR_ALLOC_FAILED;
+      return NULL;
+   }
+   /* Rates, quality, filter parameters and the resampler function */
+   *st = *base;
+   st->started = 0;
+   st->sinc_table_shared = 1;
+
+   st->last_sample = (spx_int32_t*)speex_alloc(st->nb_channels*sizeof(int));
+   st->magic_samples = (spx_uint32_t*)speex_alloc(st->nb_channels*sizeof(int));
+   st->samp_frac_num = (spx_uint32_t*)speex_alloc(st->nb_channels*sizeof(int));
+   st->mem = (spx_word16_t*)speex_alloc(st->nb_channels*st->mem_alloc_size*sizeof(spx_word16_t));
+   if (!st->last_sample || !st->magic_samples || !st->samp_frac_num || !st->mem)
+   {
+      speex_resampler_destroy(st);
+      if (err)
+         *err = RESAMPLER_ERR_ALLOC_FAILED;
+      return NULL;
+   }
+   for (i=0;i<st->nb_channels;i++)
+   {
+      st->last_sample[i] = 0;
+      st->magic_samples[i] = 0;
+      st->samp_frac_num[i] = 0;
+   }
+   for (i=0;i<st->nb_channels*st->mem_alloc_size;i++)
+      st->mem[i] = 0;
+
+   if (err)
+      *err = RESAMPLER_ERR_SUCCESS;
+   return st;
+}
+
  void speex_resampler_destroy(SpeexResamplerState *st)
 {
    speex_free(st->mem);
-   speex_free(st->sinc_table);
+   if (!st->sinc_table_shared)
+      speex_free(st->sinc_table);
    speex_free(st->last_sample);
    speex_free(st->magic_samples);
    speex_free(st->samp_frac_num);
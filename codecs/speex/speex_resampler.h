@@ -58,6 +58,7 @@
       
 #define speex_resampler_init CAT_PREFIX(RANDOM_PREFIX,_resampler_init)
 #define speex_resampler_init_frac CAT_PREFIX(RANDOM_PREFIX,_resampler_init_frac)
+#define speex_resampler_init_shared CAT_PREFIX(RANDOM_PREFIX,_resampler_init_shared)
 #define speex_resampler_destroy CAT_PREFIX(RANDOM_PREFIX,_resampler_destroy)
 #define speex_resampler_process_float CAT_PREFIX(RANDOM_PREFIX,_resampler_process_float)
 #define speex_resampler_process_int CAT_PREFIX(RANDOM_PREFIX,_resampler_process_int)
@@ -143,6 +144,19 @@ SpeexResamplerState *speex_resampler_init(spx_uint32_t nb_channels,
  * @return Newly created resampler state
  * @retval NULL Error: not enough memory
  */
+/** Create a new resampler that uses the filter of an existing one.
+ * The new resampler has the same channels, rates and quality as base and
+ * reads its filter table, so base must be destroyed last.  Changing the
+ * rate or quality of the new resampler gives it a filter table of its own.
+ * @param base Resampler whose filter is shared. It should not process samples
+ * itself while it is being shared.
+ * @param err Returned error code
+ * @return Newly created resampler state
+ * @retval NULL Error: not enough memory
+ */
+SpeexResamplerState *speex_resampler_init_shared(const SpeexResamplerState *base,
+                                                 int *err);
+
 SpeexResamplerState *speex_resampler_init_frac(spx_uint32_t nb_channels, 
                                                spx_uint32_t ratio_num, 
                                                spx_uint32_t ratio_den, 
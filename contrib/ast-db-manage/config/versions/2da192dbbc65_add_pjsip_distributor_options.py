@@ -0,0 +1,24 @@
+"""Add distributor options to global
+
+Revision ID: 2da192dbbc65
+Revises: 4468b4a91372
+Create Date: 2026-10-14 16:40:12.306420
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '2da192dbbc65'
+down_revision = '4468b4a91372'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('distributor_pool_size', sa.Integer))
+    op.add_column('ps_globals', sa.Column('distributor_queue_high', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'distributor_pool_size')
+    op.drop_column('ps_globals', 'distributor_queue_high')
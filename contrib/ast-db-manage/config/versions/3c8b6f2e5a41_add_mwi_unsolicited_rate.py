@@ -0,0 +1,22 @@
+"""Add mwi_unsolicited_rate to global
+
+Revision ID: 3c8b6f2e5a41
+Revises: 7d1e5b3a94c2
+Create Date: 2026-10-15 09:14:36.204117
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '3c8b6f2e5a41'
+down_revision = '7d1e5b3a94c2'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('mwi_unsolicited_rate', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'mwi_unsolicited_rate')
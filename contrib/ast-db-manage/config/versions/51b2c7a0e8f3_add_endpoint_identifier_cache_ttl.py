@@ -0,0 +1,22 @@
+"""Add endpoint_identifier_cache_ttl to global
+
+Revision ID: 51b2c7a0e8f3
+Revises: 2da192dbbc65
+Create Date: 2026-10-14 17:05:41.118204
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '51b2c7a0e8f3'
+down_revision = '2da192dbbc65'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('endpoint_identifier_cache_ttl', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'endpoint_identifier_cache_ttl')
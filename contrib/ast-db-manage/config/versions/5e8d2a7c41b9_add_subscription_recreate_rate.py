@@ -0,0 +1,22 @@
+"""Add subscription_recreate_rate to global
+
+Revision ID: 5e8d2a7c41b9
+Revises: 3c8b6f2e5a41
+Create Date: 2026-10-15 11:42:08.371925
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '5e8d2a7c41b9'
+down_revision = '3c8b6f2e5a41'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('subscription_recreate_rate', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'subscription_recreate_rate')
@@ -0,0 +1,22 @@
+"""Add exten_state_coalesce_interval to global
+
+Revision ID: 6a3f0c2d9b17
+Revises: 51b2c7a0e8f3
+Create Date: 2026-10-14 18:02:13.552871
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '6a3f0c2d9b17'
+down_revision = '51b2c7a0e8f3'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_globals', sa.Column('exten_state_coalesce_interval', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_globals', 'exten_state_coalesce_interval')
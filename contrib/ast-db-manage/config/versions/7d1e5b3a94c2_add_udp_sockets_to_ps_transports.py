@@ -0,0 +1,22 @@
+"""Add udp_sockets to ps_transports
+
+Revision ID: 7d1e5b3a94c2
+Revises: 6a3f0c2d9b17
+Create Date: 2026-10-14 19:21:47.318240
+
+"""
+
+# revision identifiers, used by Alembic.
+revision = '7d1e5b3a94c2'
+down_revision = '6a3f0c2d9b17'
+
+from alembic import op
+import sqlalchemy as sa
+
+
+def upgrade():
+    op.add_column('ps_transports', sa.Column('udp_sockets', sa.Integer))
+
+
+def downgrade():
+    op.drop_column('ps_transports', 'udp_sockets')
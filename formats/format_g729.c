@@ -49,11 +49,21 @@ static struct ast_frame *g729_read(struct ast_filestream *s, int *whennext)
 	int res;
 	/* Send a frame from the file to the appropriate channel */
 	s->fr.samples = G729A_SAMPLES;
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, BUF_SIZE);
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) != s->fr.datalen) {
-		if (res && (res != 10))	/* XXX what for ? */
-			ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
-		return NULL;
+	if (s->map) {
+		size_t len = BUF_SIZE;
+		const void *data = ast_filestream_mapped_read(s, &len);
+
+		if (len != BUF_SIZE) {
+			return NULL;
+		}
+		AST_FRAME_SET_BUFFER(&s->fr, data, 0, BUF_SIZE);
+	} else {
+		AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, BUF_SIZE);
+		if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) != s->fr.datalen) {
+			if (res && (res != 10))	/* XXX what for ? */
+				ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
+			return NULL;
+		}
 	}
 	*whennext = s->fr.samples;
 	return &s->fr;
@@ -79,9 +89,14 @@ static int g729_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	long bytes;
 	off_t min,cur,max,offset=0;
 	min = 0;
-	cur = ftello(fs->f);
-	fseeko(fs->f, 0, SEEK_END);
-	max = ftello(fs->f);
+	if (fs->map) {
+		cur = fs->map_pos;
+		max = fs->map_len;
+	} else {
+		cur = ftello(fs->f);
+		fseeko(fs->f, 0, SEEK_END);
+		max = ftello(fs->f);
+	}
 	
 	bytes = BUF_SIZE * (sample_offset / G729A_SAMPLES);
 	if (whence == SEEK_SET)
@@ -95,6 +110,8 @@ static int g729_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	}
 	/* protect against seeking beyond begining. */
 	offset = (offset < min)?min:offset;
+	if (fs->map)
+		return ast_filestream_mapped_seek(fs, offset);
 	if (fseeko(fs->f, offset, SEEK_SET) < 0)
 		return -1;
 	return 0;
@@ -119,7 +136,7 @@ static int g729_trunc(struct ast_filestream *fs)
 
 static off_t g729_tell(struct ast_filestream *fs)
 {
-	off_t offset = ftello(fs->f);
+	off_t offset = fs->map ? fs->map_pos : ftello(fs->f);
 	return (offset/BUF_SIZE)*G729A_SAMPLES;
 }
 
@@ -132,6 +149,7 @@ static struct ast_format_def g729_f = {
 	.tell = g729_tell,
 	.read = g729_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static int load_module(void)
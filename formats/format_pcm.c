@@ -82,11 +82,22 @@ static struct ast_frame *pcm_read(struct ast_filestream *s, int *whennext)
 	
 	/* Send a frame from the file to the appropriate channel */
 
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, BUF_SIZE);
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
-		if (res)
-			ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
-		return NULL;
+	if (s->map) {
+		size_t len = BUF_SIZE;
+		const void *data = ast_filestream_mapped_read(s, &len);
+
+		if (!len) {
+			return NULL;
+		}
+		AST_FRAME_SET_BUFFER(&s->fr, data, 0, len);
+		res = len;
+	} else {
+		AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, BUF_SIZE);
+		if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
+			if (res)
+				ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
+			return NULL;
+		}
 	}
 	s->fr.datalen = res;
 	if (ast_format_cmp(s->fmt->format, ast_format_g722) == AST_FORMAT_CMP_EQUAL)
@@ -101,19 +112,24 @@ static int pcm_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 	off_t cur, max, offset = 0;
  	int ret = -1;	/* assume error */
 
-	if ((cur = ftello(fs->f)) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to determine current position in pcm filestream %p: %s\n", fs, strerror(errno));
-		return -1;
-	}
+	if (fs->map) {
+		cur = fs->map_pos;
+		max = fs->map_len;
+	} else {
+		if ((cur = ftello(fs->f)) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to determine current position in pcm filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to seek to end of pcm filestream %p: %s\n", fs, strerror(errno));
-		return -1;
-	}
+		if (fseeko(fs->f, 0, SEEK_END) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to seek to end of pcm filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 
-	if ((max = ftello(fs->f)) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to determine max position in pcm filestream %p: %s\n", fs, strerror(errno));
-		return -1;
+		if ((max = ftello(fs->f)) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to determine max position in pcm filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 	}
 
 	switch (whence) {
@@ -135,7 +151,7 @@ static int pcm_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 		ast_log(LOG_WARNING, "negative offset %ld, resetting to 0\n", (long) offset);
 		offset = 0;
 	}
-	if (whence == SEEK_FORCECUR && offset > max) { /* extend the file */
+	if (whence == SEEK_FORCECUR && offset > max && !fs->map) { /* extend the file */
 		size_t left = offset - max;
 		const char *src = (ast_format_cmp(fs->fmt->format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) ? alaw_silence : ulaw_silence;
 
@@ -151,7 +167,7 @@ static int pcm_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
 			ast_log(LOG_WARNING, "offset too large %ld, truncating to %ld\n", (long) offset, (long) max);
 			offset = max;
 		}
-		ret = fseeko(fs->f, offset, SEEK_SET);
+		ret = fs->map ? ast_filestream_mapped_seek(fs, offset) : fseeko(fs->f, offset, SEEK_SET);
 	}
 	return ret;
 }
@@ -174,7 +190,7 @@ static int pcm_trunc(struct ast_filestream *fs)
 
 static off_t pcm_tell(struct ast_filestream *fs)
 {
-	return ftello(fs->f);
+	return fs->map ? fs->map_pos : ftello(fs->f);
 }
 
 static int pcm_write(struct ast_filestream *fs, struct ast_frame *f)
@@ -458,6 +474,7 @@ static struct ast_format_def alaw_f = {
 	.tell = pcm_tell,
 	.read = pcm_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 #ifdef REALTIME_WRITE
 	.open = pcma_open,
 	.rewrite = pcma_rewrite,
@@ -474,6 +491,7 @@ static struct ast_format_def pcm_f = {
 	.tell = pcm_tell,
 	.read = pcm_read,
 	.buf_size = BUF_SIZE + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_format_def g722_f = {
@@ -485,6 +503,7 @@ static struct ast_format_def g722_f = {
 	.tell = pcm_tell,
 	.read = pcm_read,
 	.buf_size = (BUF_SIZE * 2) + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_format_def au_f = {
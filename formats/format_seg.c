@@ -0,0 +1,788 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Segmented recording formats
+ *
+ * An append only container for recordings in any of several codecs.  The
+ * file starts with a header naming the codec, followed by segments of
+ * about SEG_SEGMENT_MS of frames, each preceded by a header giving its
+ * length in samples and bytes.  Recordings are only ever appended to, so
+ * nothing has to be updated when a recording ends, and a recording can be
+ * played while it is still being written.  Seeking skips whole segments by
+ * their headers, and readers keep an index of the segments they have seen.
+ *
+ * All numbers are stored big endian.
+ *
+ * \ingroup formats
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include <sys/stat.h>
+
+#include "asterisk/mod_format.h"
+#include "asterisk/module.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/time.h"
+#include "asterisk/vector.h"
+
+/*! Magic of the file header */
+#define SEG_MAGIC "AstSeg\0\1"
+#define SEG_MAGIC_LEN 8
+/*! Magic, sample rate, reserved and codec name */
+#define SEG_HEADER_SIZE 32
+/*! Bytes of the codec name in the file header */
+#define SEG_CODEC_LEN 16
+
+/*! Magic of a segment header, "SegM" */
+#define SEG_SEGMENT_MAGIC 0x5365674dU
+/*! Magic, flags, samples and bytes */
+#define SEG_SEGMENT_HEADER_SIZE 16
+/*! The segment was written when the recording was closed */
+#define SEG_FLAG_END (1 << 0)
+
+/*! Bytes and samples of a frame */
+#define SEG_RECORD_HEADER_SIZE 4
+/*! Largest frame that can be stored */
+#define SEG_MAX_FRAME 8192
+
+/*! Milliseconds of frames collected before a segment is written */
+#define SEG_SEGMENT_MS 200
+/*! Milliseconds a player waits for a recording that stopped growing */
+#define SEG_LIVE_TIMEOUT_MS 3000
+
+/*! \brief Where a segment starts */
+struct seg_index_entry {
+	/*! Offset of the segment header in the file */
+	off_t offset;
+	/*! Sample position of the first frame in the segment */
+	int64_t start;
+};
+
+struct seg_desc {
+	/*! Non-zero if the stream writes the recording */
+	int writing;
+	/*! Segments seen or written, in file order */
+	AST_VECTOR(, struct seg_index_entry) index;
+
+	/* Reading */
+
+	/*! Offset of the next segment header */
+	off_t next;
+	/*! Bytes of the current segment not read yet */
+	unsigned int left;
+	/*! Samples of the current segment */
+	unsigned int seg_samples;
+	/*! Sample position */
+	int64_t pos;
+	/*! Samples of the last frame read */
+	unsigned int last_samples;
+	/*! Non-zero if the last segment entered was written when the recording closed */
+	int ended;
+	/*! When the reader caught up with the end of a recording still being written */
+	struct timeval stalled;
+
+	/* Writing */
+
+	/*! Frames of the segment not written yet */
+	unsigned char *pending;
+	size_t pending_len;
+	size_t pending_size;
+	unsigned int pending_samples;
+	/*! Samples in the segments written */
+	int64_t written;
+	/*! Sample position seeked to, which truncating cuts the recording at */
+	int64_t wpos;
+};
+
+static void seg_put16(unsigned char *p, unsigned int value)
+{
+	p[0] = value >> 8;
+	p[1] = value;
+}
+
+static void seg_put32(unsigned char *p, uint32_t value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+static unsigned int seg_get16(const unsigned char *p)
+{
+	return (p[0] << 8) | p[1];
+}
+
+static uint32_t seg_get32(const unsigned char *p)
+{
+	return ((uint32_t) p[0] << 24) | ((uint32_t) p[1] << 16) | ((uint32_t) p[2] << 8) | p[3];
+}
+
+/*!
+ * \internal
+ * \brief Index of the last segment starting at or before a sample position.
+ *
+ * \retval -1 if no segment known starts there.
+ */
+static int seg_index_find(struct seg_desc *desc, int64_t target)
+{
+	int low = 0;
+	int high = AST_VECTOR_SIZE(&desc->index) - 1;
+	int found = -1;
+	int mid;
+
+	while (low <= high) {
+		mid = (low + high) / 2;
+		if (AST_VECTOR_GET(&desc->index, mid).start <= target) {
+			found = mid;
+			low = mid + 1;
+		} else {
+			high = mid - 1;
+		}
+	}
+
+	return found;
+}
+
+static void seg_index_add(struct seg_desc *desc, off_t offset, int64_t start)
+{
+	struct seg_index_entry entry = { .offset = offset, .start = start, };
+	size_t count = AST_VECTOR_SIZE(&desc->index);
+
+	if (count && AST_VECTOR_GET(&desc->index, count - 1).offset >= offset) {
+		/* Seen already */
+		return;
+	}
+
+	/* The index only saves walking, so a failure to grow it is harmless. */
+	AST_VECTOR_APPEND(&desc->index, entry);
+}
+
+static int seg_open(struct ast_filestream *s)
+{
+	struct seg_desc *desc = s->_private;
+	unsigned char header[SEG_HEADER_SIZE];
+	char codec[SEG_CODEC_LEN + 1];
+
+	if (fread(header, 1, sizeof(header), s->f) != sizeof(header)) {
+		ast_log(LOG_WARNING, "Unable to read header of segmented recording\n");
+		return -1;
+	}
+	if (memcmp(header, SEG_MAGIC, SEG_MAGIC_LEN)) {
+		ast_log(LOG_WARNING, "Not a segmented recording\n");
+		return -1;
+	}
+
+	memcpy(codec, header + 16, SEG_CODEC_LEN);
+	codec[SEG_CODEC_LEN] = '\0';
+	if (strcmp(codec, ast_format_get_name(s->fmt->format))
+		|| seg_get32(header + 8) != ast_format_get_sample_rate(s->fmt->format)) {
+		ast_log(LOG_WARNING, "Segmented recording holds %s at %u Hz, not %s\n",
+			codec, seg_get32(header + 8), ast_format_get_name(s->fmt->format));
+		return -1;
+	}
+
+	if (AST_VECTOR_INIT(&desc->index, 32)) {
+		return -1;
+	}
+	desc->next = SEG_HEADER_SIZE;
+
+	return 0;
+}
+
+static int seg_rewrite(struct ast_filestream *s, const char *comment)
+{
+	struct seg_desc *desc = s->_private;
+	unsigned char header[SEG_HEADER_SIZE] = { 0, };
+	const char *codec = ast_format_get_name(s->fmt->format);
+	struct stat st;
+
+	if (fstat(fileno(s->f), &st)) {
+		ast_log(LOG_WARNING, "Unable to stat segmented recording: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (!st.st_size) {
+		memcpy(header, SEG_MAGIC, SEG_MAGIC_LEN);
+		seg_put32(header + 8, ast_format_get_sample_rate(s->fmt->format));
+		memcpy(header + 16, codec, MIN(strlen(codec), SEG_CODEC_LEN));
+		if (fwrite(header, 1, sizeof(header), s->f) != sizeof(header)) {
+			ast_log(LOG_WARNING, "Unable to write header of segmented recording: %s\n",
+				strerror(errno));
+			return -1;
+		}
+	}
+	/* else appending to a recording, which has its header already */
+
+	if (AST_VECTOR_INIT(&desc->index, 32)) {
+		return -1;
+	}
+	desc->writing = 1;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Append the frames collected to the recording as a segment.
+ *
+ * The segment is flushed to the file at once, which is as far behind as a
+ * player of the recording can be.
+ */
+static int seg_flush(struct ast_filestream *s, unsigned int flags)
+{
+	struct seg_desc *desc = s->_private;
+	unsigned char header[SEG_SEGMENT_HEADER_SIZE];
+	off_t offset;
+
+	if (!desc->pending_len && !(flags & SEG_FLAG_END)) {
+		return 0;
+	}
+
+	if ((offset = ftello(s->f)) < 0) {
+		ast_log(LOG_WARNING, "Unable to determine position in segmented recording: %s\n",
+			strerror(errno));
+		return -1;
+	}
+
+	seg_put32(header, SEG_SEGMENT_MAGIC);
+	seg_put32(header + 4, flags);
+	seg_put32(header + 8, desc->pending_samples);
+	seg_put32(header + 12, desc->pending_len);
+	if (fwrite(header, 1, sizeof(header), s->f) != sizeof(header)
+		|| fwrite(desc->pending, 1, desc->pending_len, s->f) != desc->pending_len
+		|| fflush(s->f)) {
+		ast_log(LOG_WARNING, "Unable to write segment of recording: %s\n", strerror(errno));
+		return -1;
+	}
+
+	if (desc->pending_len) {
+		seg_index_add(desc, offset, desc->written);
+	}
+	desc->written += desc->pending_samples;
+	desc->wpos = desc->written;
+	desc->pending_len = 0;
+	desc->pending_samples = 0;
+
+	return 0;
+}
+
+static int seg_write(struct ast_filestream *s, struct ast_frame *f)
+{
+	struct seg_desc *desc = s->_private;
+	size_t needed = desc->pending_len + SEG_RECORD_HEADER_SIZE + f->datalen;
+
+	if (!f->datalen) {
+		return 0;
+	}
+	if (f->datalen > SEG_MAX_FRAME || f->samples > 0xffff) {
+		ast_log(LOG_WARNING, "Frame of %d bytes is too large for a segmented recording\n",
+			f->datalen);
+		return -1;
+	}
+
+	if (needed > desc->pending_size) {
+		size_t size = MAX(desc->pending_size * 2, MAX(needed, 4096));
+		unsigned char *pending = ast_realloc(desc->pending, size);
+
+		if (!pending) {
+			return -1;
+		}
+		desc->pending = pending;
+		desc->pending_size = size;
+	}
+
+	seg_put16(desc->pending + desc->pending_len, f->datalen);
+	seg_put16(desc->pending + desc->pending_len + 2, f->samples);
+	memcpy(desc->pending + desc->pending_len + SEG_RECORD_HEADER_SIZE, f->data.ptr, f->datalen);
+	desc->pending_len = needed;
+	desc->pending_samples += f->samples;
+	desc->wpos = desc->written + desc->pending_samples;
+
+	if (desc->pending_samples >= ast_format_get_sample_rate(s->fmt->format) * SEG_SEGMENT_MS / 1000) {
+		return seg_flush(s, 0);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Enter the segment at desc->next.
+ *
+ * \retval 0 on success.
+ * \retval 1 if the segment has not been written completely yet.
+ * \retval -1 on error.
+ */
+static int seg_enter(struct ast_filestream *s)
+{
+	struct seg_desc *desc = s->_private;
+	unsigned char header[SEG_SEGMENT_HEADER_SIZE];
+	struct stat st;
+	uint32_t bytes;
+
+	if (fstat(fileno(s->f), &st)) {
+		ast_log(LOG_WARNING, "Unable to stat segmented recording: %s\n", strerror(errno));
+		return -1;
+	}
+	if (st.st_size < desc->next + SEG_SEGMENT_HEADER_SIZE) {
+		return 1;
+	}
+
+	/* Seeking also clears the end of file a reader of a growing recording has seen. */
+	if (fseeko(s->f, desc->next, SEEK_SET)
+		|| fread(header, 1, sizeof(header), s->f) != sizeof(header)) {
+		ast_log(LOG_WARNING, "Unable to read segment of recording: %s\n", strerror(errno));
+		return -1;
+	}
+	if (seg_get32(header) != SEG_SEGMENT_MAGIC) {
+		ast_log(LOG_WARNING, "Segmented recording is damaged at offset %jd\n",
+			(intmax_t) desc->next);
+		return -1;
+	}
+
+	bytes = seg_get32(header + 12);
+	if (st.st_size < desc->next + SEG_SEGMENT_HEADER_SIZE + bytes) {
+		return 1;
+	}
+
+	seg_index_add(desc, desc->next, desc->pos);
+	desc->ended = seg_get32(header + 4) & SEG_FLAG_END;
+	desc->seg_samples = seg_get32(header + 8);
+	desc->left = bytes;
+	desc->next += SEG_SEGMENT_HEADER_SIZE + bytes;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for a recording that is still being written to grow.
+ *
+ * A stream playing to a channel gets null frames, each as long as the last
+ * frame read, until another segment is appended.  Playback ends once the
+ * recording has been closed or has not grown for SEG_LIVE_TIMEOUT_MS.
+ */
+static struct ast_frame *seg_stall(struct ast_filestream *s, int *whennext)
+{
+	struct seg_desc *desc = s->_private;
+
+	if (desc->ended || !s->owner) {
+		return NULL;
+	}
+
+	if (ast_tvzero(desc->stalled)) {
+		desc->stalled = ast_tvnow();
+	} else if (ast_tvdiff_ms(ast_tvnow(), desc->stalled) >= SEG_LIVE_TIMEOUT_MS) {
+		return NULL;
+	}
+
+	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, 0);
+	s->fr.frametype = AST_FRAME_NULL;
+	s->fr.samples = 0;
+	*whennext = desc->last_samples ? desc->last_samples
+		: ast_format_get_sample_rate(s->fmt->format) / 50;
+
+	return &s->fr;
+}
+
+static struct ast_frame *seg_read(struct ast_filestream *s, int *whennext)
+{
+	struct seg_desc *desc = s->_private;
+	unsigned char header[SEG_RECORD_HEADER_SIZE];
+	unsigned int len;
+	unsigned int samples;
+	int res;
+
+	while (!desc->left) {
+		if ((res = seg_enter(s))) {
+			return res < 0 ? NULL : seg_stall(s, whennext);
+		}
+	}
+
+	if (desc->left < SEG_RECORD_HEADER_SIZE
+		|| fread(header, 1, sizeof(header), s->f) != sizeof(header)) {
+		goto damaged;
+	}
+	len = seg_get16(header);
+	samples = seg_get16(header + 2);
+	if (len > SEG_MAX_FRAME || len + SEG_RECORD_HEADER_SIZE > desc->left) {
+		goto damaged;
+	}
+
+	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, len);
+	if (fread(s->fr.data.ptr, 1, len, s->f) != len) {
+		goto damaged;
+	}
+
+	desc->left -= SEG_RECORD_HEADER_SIZE + len;
+	desc->pos += samples;
+	desc->last_samples = samples;
+	desc->stalled = ast_tv(0, 0);
+
+	s->fr.frametype = AST_FRAME_VOICE;
+	*whennext = s->fr.samples = samples;
+	return &s->fr;
+
+damaged:
+	ast_log(LOG_WARNING, "Segmented recording has a damaged frame before offset %jd\n",
+		(intmax_t) desc->next);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Move a reader to the frame holding a sample position.
+ *
+ * Whole segments are skipped by their headers, starting from the last
+ * segment seen that starts at or before the position.  A position past the
+ * end of the recording moves to its end.
+ */
+static int seg_seek_read(struct ast_filestream *fs, int64_t target)
+{
+	struct seg_desc *desc = fs->_private;
+	unsigned char header[SEG_RECORD_HEADER_SIZE];
+	unsigned int len;
+	unsigned int samples;
+	int i;
+	int res;
+
+	if ((i = seg_index_find(desc, target)) < 0) {
+		desc->next = SEG_HEADER_SIZE;
+		desc->pos = 0;
+	} else {
+		desc->next = AST_VECTOR_GET(&desc->index, i).offset;
+		desc->pos = AST_VECTOR_GET(&desc->index, i).start;
+	}
+	desc->left = 0;
+
+	for (;;) {
+		if ((res = seg_enter(fs))) {
+			return res < 0 ? -1 : 0;
+		}
+		if (desc->pos + desc->seg_samples > target) {
+			break;
+		}
+		desc->pos += desc->seg_samples;
+		desc->left = 0;
+	}
+
+	while (desc->left && desc->pos < target) {
+		if (fread(header, 1, sizeof(header), fs->f) != sizeof(header)) {
+			return -1;
+		}
+		len = seg_get16(header);
+		samples = seg_get16(header + 2);
+		if (desc->pos + samples > target) {
+			return fseeko(fs->f, -SEG_RECORD_HEADER_SIZE, SEEK_CUR);
+		}
+		if (fseeko(fs->f, len, SEEK_CUR)) {
+			return -1;
+		}
+		desc->left -= MIN(desc->left, SEG_RECORD_HEADER_SIZE + len);
+		desc->pos += samples;
+	}
+
+	return 0;
+}
+
+static int seg_seek(struct ast_filestream *fs, off_t sample_offset, int whence)
+{
+	struct seg_desc *desc = fs->_private;
+	int64_t cur = desc->writing ? desc->wpos : desc->pos;
+	int64_t target = 0;
+
+	if (whence == SEEK_SET) {
+		target = sample_offset;
+	} else if (whence == SEEK_CUR || whence == SEEK_FORCECUR) {
+		target = cur + sample_offset;
+	} else if (whence == SEEK_END) {
+		if (desc->writing) {
+			target = desc->written + desc->pending_samples - sample_offset;
+		} else {
+			if (seg_seek_read(fs, INT64_MAX)) {
+				return -1;
+			}
+			target = desc->pos - sample_offset;
+		}
+	}
+	if (target < 0) {
+		target = 0;
+	}
+
+	if (desc->writing) {
+		/* Frames are only ever appended, the position only matters to truncating */
+		desc->wpos = MIN(target, desc->written + desc->pending_samples);
+		return 0;
+	}
+
+	return seg_seek_read(fs, target);
+}
+
+/*!
+ * \internal
+ * \brief Cut a recording being written at the position seeked to.
+ *
+ * Frames not written yet are dropped after the frame holding the position.
+ * Written segments are dropped after the segment holding it, which keeps
+ * up to SEG_SEGMENT_MS more than asked for, rather than rewriting a
+ * segment.
+ */
+static int seg_trunc(struct ast_filestream *fs)
+{
+	struct seg_desc *desc = fs->_private;
+	struct seg_index_entry *next;
+	size_t offset = 0;
+	int64_t pos = desc->written;
+	int i;
+
+	if (!desc->writing) {
+		return -1;
+	}
+
+	if (desc->wpos >= desc->written) {
+		while (offset < desc->pending_len && pos < desc->wpos) {
+			pos += seg_get16(desc->pending + offset + 2);
+			offset += SEG_RECORD_HEADER_SIZE + seg_get16(desc->pending + offset);
+		}
+		desc->pending_len = offset;
+		desc->pending_samples = pos - desc->written;
+		desc->wpos = pos;
+		return 0;
+	}
+
+	desc->pending_len = 0;
+	desc->pending_samples = 0;
+
+	i = seg_index_find(desc, desc->wpos);
+	if (i < 0 || i + 1 >= AST_VECTOR_SIZE(&desc->index)) {
+		desc->wpos = desc->written;
+		return 0;
+	}
+
+	next = AST_VECTOR_GET_ADDR(&desc->index, i + 1);
+	if (fflush(fs->f) || ftruncate(fileno(fs->f), next->offset)
+		|| fseeko(fs->f, next->offset, SEEK_SET)) {
+		ast_log(LOG_WARNING, "Unable to truncate segmented recording: %s\n", strerror(errno));
+		return -1;
+	}
+	desc->written = desc->wpos = next->start;
+	while (AST_VECTOR_SIZE(&desc->index) > i + 1) {
+		AST_VECTOR_REMOVE_ORDERED(&desc->index, AST_VECTOR_SIZE(&desc->index) - 1);
+	}
+
+	return 0;
+}
+
+static off_t seg_tell(struct ast_filestream *fs)
+{
+	struct seg_desc *desc = fs->_private;
+
+	return desc->writing ? desc->wpos : desc->pos;
+}
+
+static void seg_close(struct ast_filestream *s)
+{
+	struct seg_desc *desc = s->_private;
+
+	if (desc->writing) {
+		/* Tell players of the recording that it will not grow any more */
+		seg_flush(s, SEG_FLAG_END);
+	}
+	ast_free(desc->pending);
+	AST_VECTOR_FREE(&desc->index);
+}
+
+static struct ast_format_def seg_f = {
+	.name = "seg",
+	.exts = "seg",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg16_f = {
+	.name = "seg16",
+	.exts = "seg16",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg48_f = {
+	.name = "seg48",
+	.exts = "seg48",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg_ulaw_f = {
+	.name = "seg_ulaw",
+	.exts = "seg_ulaw",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg_alaw_f = {
+	.name = "seg_alaw",
+	.exts = "seg_alaw",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg_gsm_f = {
+	.name = "seg_gsm",
+	.exts = "seg_gsm",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg_g722_f = {
+	.name = "seg_g722",
+	.exts = "seg_g722",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def seg_g729_f = {
+	.name = "seg_g729",
+	.exts = "seg_g729",
+	.open = seg_open,
+	.rewrite = seg_rewrite,
+	.write = seg_write,
+	.seek = seg_seek,
+	.trunc = seg_trunc,
+	.tell = seg_tell,
+	.read = seg_read,
+	.close = seg_close,
+	.buf_size = SEG_MAX_FRAME + AST_FRIENDLY_OFFSET,
+	.desc_size = sizeof(struct seg_desc),
+};
+
+static struct ast_format_def *seg_list[] = {
+	&seg_f,
+	&seg16_f,
+	&seg48_f,
+	&seg_ulaw_f,
+	&seg_alaw_f,
+	&seg_gsm_f,
+	&seg_g722_f,
+	&seg_g729_f,
+};
+
+static int unload_module(void)
+{
+	int res = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(seg_list); i++) {
+		if (ast_format_def_unregister(seg_list[i]->name)) {
+			res |= AST_MODULE_LOAD_FAILURE;
+		}
+	}
+	return res;
+}
+
+static int load_module(void)
+{
+	int i;
+
+	seg_f.format = ast_format_slin;
+	seg16_f.format = ast_format_slin16;
+	seg48_f.format = ast_format_slin48;
+	seg_ulaw_f.format = ast_format_ulaw;
+	seg_alaw_f.format = ast_format_alaw;
+	seg_gsm_f.format = ast_format_gsm;
+	seg_g722_f.format = ast_format_g722;
+	seg_g729_f.format = ast_format_g729;
+
+	for (i = 0; i < ARRAY_LEN(seg_list); i++) {
+		if (ast_format_def_register(seg_list[i])) {
+			unload_module();
+			return AST_MODULE_LOAD_FAILURE;
+		}
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "Segmented recording formats",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.load_pri = AST_MODPRI_APP_DEPEND
+);
@@ -37,11 +37,22 @@ static struct ast_frame *generic_read(struct ast_filestream *s, int *whennext, u
 	int res;
 	/* Send a frame from the file to the appropriate channel */
 
-	AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, buf_size);
-	if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
-		if (res)
-			ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
-		return NULL;
+	if (s->map) {
+		size_t len = buf_size;
+		const void *data = ast_filestream_mapped_read(s, &len);
+
+		if (len < 2) {
+			return NULL;
+		}
+		AST_FRAME_SET_BUFFER(&s->fr, data, 0, len);
+		res = len;
+	} else {
+		AST_FRAME_SET_BUFFER(&s->fr, s->buf, AST_FRIENDLY_OFFSET, buf_size);
+		if ((res = fread(s->fr.data.ptr, 1, s->fr.datalen, s->f)) < 1) {
+			if (res)
+				ast_log(LOG_WARNING, "Short read (%d) (%s)!\n", res, strerror(errno));
+			return NULL;
+		}
 	}
 	*whennext = s->fr.samples = res/2;
 	s->fr.datalen = res;
@@ -64,19 +75,24 @@ static int slinear_seek(struct ast_filestream *fs, off_t sample_offset, int when
 
 	sample_offset <<= 1;
 
-	if ((cur = ftello(fs->f)) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to determine current position in sln filestream %p: %s\n", fs, strerror(errno));
-		return -1;
-	}
+	if (fs->map) {
+		cur = fs->map_pos;
+		max = fs->map_len;
+	} else {
+		if ((cur = ftello(fs->f)) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to determine current position in sln filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 
-	if (fseeko(fs->f, 0, SEEK_END) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to seek to end of sln filestream %p: %s\n", fs, strerror(errno));
-		return -1;
-	}
+		if (fseeko(fs->f, 0, SEEK_END) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to seek to end of sln filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 
-	if ((max = ftello(fs->f)) < 0) {
-		ast_log(AST_LOG_WARNING, "Unable to determine max position in sln filestream %p: %s\n", fs, strerror(errno));
-		return -1;
+		if ((max = ftello(fs->f)) < 0) {
+			ast_log(AST_LOG_WARNING, "Unable to determine max position in sln filestream %p: %s\n", fs, strerror(errno));
+			return -1;
+		}
 	}
 
 	if (whence == SEEK_SET)
@@ -90,6 +106,9 @@ static int slinear_seek(struct ast_filestream *fs, off_t sample_offset, int when
 	}
 	/* always protect against seeking past begining. */
 	offset = (offset < min)?min:offset;
+	if (fs->map) {
+		return ast_filestream_mapped_seek(fs, offset);
+	}
 	return fseeko(fs->f, offset, SEEK_SET);
 }
 
@@ -112,7 +131,7 @@ static int slinear_trunc(struct ast_filestream *fs)
 
 static off_t slinear_tell(struct ast_filestream *fs)
 {
-	return ftello(fs->f) / 2;
+	return (fs->map ? fs->map_pos : ftello(fs->f)) / 2;
 }
 
 static struct ast_frame *slinear_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 320);}
@@ -125,6 +144,7 @@ static struct ast_format_def slin_f = {
 	.tell = slinear_tell,
 	.read = slinear_read,
 	.buf_size = 320 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear12_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 480);}
@@ -137,6 +157,7 @@ static struct ast_format_def slin12_f = {
 	.tell = slinear_tell,
 	.read = slinear12_read,
 	.buf_size = 480 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear16_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 640);}
@@ -149,6 +170,7 @@ static struct ast_format_def slin16_f = {
 	.tell = slinear_tell,
 	.read = slinear16_read,
 	.buf_size = 640 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear24_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 960);}
@@ -161,6 +183,7 @@ static struct ast_format_def slin24_f = {
 	.tell = slinear_tell,
 	.read = slinear24_read,
 	.buf_size = 960 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear32_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1280);}
@@ -173,6 +196,7 @@ static struct ast_format_def slin32_f = {
 	.tell = slinear_tell,
 	.read = slinear32_read,
 	.buf_size = 1280 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear44_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1764);}
@@ -185,6 +209,7 @@ static struct ast_format_def slin44_f = {
 	.tell = slinear_tell,
 	.read = slinear44_read,
 	.buf_size = 1764 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear48_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 1920);}
@@ -197,6 +222,7 @@ static struct ast_format_def slin48_f = {
 	.tell = slinear_tell,
 	.read = slinear48_read,
 	.buf_size = 1920 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear96_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 3840);}
@@ -209,6 +235,7 @@ static struct ast_format_def slin96_f = {
 	.tell = slinear_tell,
 	.read = slinear96_read,
 	.buf_size = 3840 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_frame *slinear192_read(struct ast_filestream *s, int *whennext){return generic_read(s, whennext, 7680);}
@@ -221,6 +248,7 @@ static struct ast_format_def slin192_f = {
 	.tell = slinear_tell,
 	.read = slinear192_read,
 	.buf_size = 7680 + AST_FRIENDLY_OFFSET,
+	.mmap_read = 1,
 };
 
 static struct ast_format_def *slin_list[] = {
@@ -32,6 +32,7 @@
  
 /*** MODULEINFO
 	<depend>curl</depend>
+	<depend>res_curl</depend>
 	<support_level>core</support_level>
  ***/
 
@@ -49,6 +50,7 @@
 #include "asterisk/utils.h"
 #include "asterisk/threadstorage.h"
 #include "asterisk/test.h"
+#include "asterisk/res_curl.h"
 
 /*** DOCUMENTATION
 	<function name="CURL" language="en_US">
@@ -587,6 +589,9 @@ static int curl_instance_init(void *data)
 	curl_easy_setopt(*curl, CURLOPT_WRITEFUNCTION, WriteMemoryCallback);
 	curl_easy_setopt(*curl, CURLOPT_USERAGENT, global_useragent);
 
+	/* Dialplan threads rarely live long enough to reuse their own connections */
+	ast_curl_share(*curl);
+
 	return 0;
 }
 
@@ -44,6 +44,7 @@
 #include "asterisk/app.h"
 #include "asterisk/cli.h"
 #include "asterisk/strings.h"
+#include "asterisk/manager.h"
 
 /*** DOCUMENTATION
 	<function name="ODBC_FETCH" language="en_US">
@@ -95,6 +96,24 @@
 			<para>Example: SELECT foo FROM bar WHERE baz='${SQL_ESC(${ARG1})}'</para>
 		</description>
 	</function>
+	<manager name="ODBCCacheFlush" language="en_US">
+		<synopsis>
+			Flush the cached results of func_odbc read queries.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Function">
+				<para>The name of the function whose cache is flushed, such as
+				<literal>ODBC_PRESENCE</literal>.  If not given, the caches of
+				all functions are flushed.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Discards the results cached by functions configured with
+			<literal>cache_ttl</literal>, so the next read of each function
+			queries the database again.</para>
+		</description>
+	</manager>
  ***/
 
 static char *config = "func_odbc.conf";
@@ -119,6 +138,12 @@ struct acf_odbc_query {
 	char *sql_insert;
 	unsigned int flags;
 	int rowlimit;
+	/*! Seconds a read result is cached for, 0 disables the cache */
+	int cache_ttl;
+	/*! Maximum number of cached read results */
+	int cache_size;
+	/*! Cached read results, keyed on the substituted read SQL */
+	struct ao2_container *cache;
 	struct ast_custom_function *acf;
 };
 
@@ -152,6 +177,128 @@ struct dsn {
 	char name[0];
 };
 
+/*! \brief A cached result of a single row read query */
+struct odbc_cache_entry {
+	/*! When the result may no longer be used */
+	struct timeval expires;
+	/*! The number of rows, for ODBCROWS */
+	int rows;
+	/*! The ODBCSTATUS of the query */
+	const char *status;
+	/*! The value the read returned */
+	char *value;
+	/*! The column names, for ~ODBCFIELDS~ */
+	char *colnames;
+	/*! The substituted SQL of the read */
+	char sql[0];
+};
+
+#define CACHE_BUCKETS 61
+
+#define DEFAULT_CACHE_SIZE 1000
+
+static int odbc_cache_hash(const void *obj, const int flags)
+{
+	const struct odbc_cache_entry *object;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		object = obj;
+		key = object->sql;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_hash(key);
+}
+
+static int odbc_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct odbc_cache_entry *object_left = obj;
+	const struct odbc_cache_entry *object_right = arg;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = object_right->sql;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (strcmp(object_left->sql, right_key)) {
+			return 0;
+		}
+		break;
+	default:
+		return 0;
+	}
+	return CMP_MATCH;
+}
+
+static int odbc_cache_expired(void *obj, void *arg, int flags)
+{
+	struct odbc_cache_entry *entry = obj;
+	struct timeval *now = arg;
+
+	return ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \brief Remember the result of a single row read
+ *
+ * If the cache is full, expired results are dropped first.  If it is
+ * still full the result is not cached.
+ */
+static void odbc_cache_store(struct ao2_container *cache, int ttl, int size, const char *sql,
+	const char *value, int rows, const char *status, const char *colnames)
+{
+	struct odbc_cache_entry *entry;
+	struct timeval now = ast_tvnow();
+	size_t sql_len = strlen(sql) + 1;
+	size_t value_len = strlen(value) + 1;
+
+	ao2_lock(cache);
+	ao2_find(cache, sql, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	if (ao2_container_count(cache) >= size) {
+		ao2_callback(cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+			odbc_cache_expired, &now);
+		if (ao2_container_count(cache) >= size) {
+			ao2_unlock(cache);
+			return;
+		}
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + sql_len + value_len + strlen(colnames) + 1,
+		NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		ao2_unlock(cache);
+		return;
+	}
+	entry->expires = ast_tvadd(now, ast_samp2tv(ttl, 1));
+	entry->rows = rows;
+	entry->status = status;
+	strcpy(entry->sql, sql);
+	entry->value = entry->sql + sql_len;
+	strcpy(entry->value, value);
+	entry->colnames = entry->value + value_len;
+	strcpy(entry->colnames, colnames);
+
+	ao2_link_flags(cache, entry, OBJ_NOLOCK);
+	ao2_unlock(cache);
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Discard every cached result of a query */
+static void odbc_cache_flush(struct acf_odbc_query *query)
+{
+	if (query->cache) {
+		ao2_callback(query->cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+}
+
 #define DSN_BUCKETS 37
 
 struct ao2_container *dsns;
@@ -544,6 +691,9 @@ static int acf_odbc_write(struct ast_channel *chan, const char *cmd, char *s, co
 		return -1;
 	}
 
+	/* Whatever the write changes may be what the reads have cached */
+	odbc_cache_flush(query);
+
 	if (!chan) {
 		if (!(chan = ast_dummy_channel_alloc())) {
 			AST_RWLIST_UNLOCK(&queries);
@@ -716,6 +866,8 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 	char varname[15], rowcount[12] = "-1";
 	struct ast_str *colnames = ast_str_thread_get(&colnames_buf, 16);
 	int res, x, y, buflen = 0, escapecommas, rowlimit = 1, multirow = 0, dsn_num, bogus_chan = 0;
+	int cache_ttl = 0, cache_size = 0;
+	RAII_VAR(struct ao2_container *, cache, NULL, ao2_cleanup);
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(field)[100];
 	);
@@ -813,8 +965,38 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 			AST_LIST_HEAD_INIT(resultset);
 		}
 	}
+
+	/* Only results of a single row are cached */
+	if (!resultset && query->cache) {
+		cache = ao2_bump(query->cache);
+		cache_ttl = query->cache_ttl;
+		cache_size = query->cache_size;
+	}
 	AST_RWLIST_UNLOCK(&queries);
 
+	if (cache) {
+		struct odbc_cache_entry *entry;
+
+		entry = ao2_find(cache, ast_str_buffer(sql), OBJ_SEARCH_KEY);
+		if (entry && ast_tvcmp(entry->expires, ast_tvnow()) > 0) {
+			ast_debug(2, "Using cached result for [%s]\n", ast_str_buffer(sql));
+			ast_copy_string(buf, entry->value, len);
+			if (!bogus_chan) {
+				snprintf(rowcount, sizeof(rowcount), "%d", entry->rows);
+				pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
+				pbx_builtin_setvar_helper(chan, "ODBCSTATUS", entry->status);
+				pbx_builtin_setvar_helper(chan, "~ODBCFIELDS~", entry->colnames);
+				ast_autoservice_stop(chan);
+			}
+			ao2_ref(entry, -1);
+			return 0;
+		}
+		if (entry) {
+			ao2_unlink(cache, entry);
+			ao2_ref(entry, -1);
+		}
+	}
+
 	for (dsn_num = 0; dsn_num < 5; dsn_num++) {
 		if (!ast_strlen_zero(query->readhandle[dsn_num])) {
 			obj = get_odbc_obj(query->readhandle[dsn_num], &dsn);
@@ -870,6 +1052,9 @@ static int acf_odbc_read(struct ast_channel *chan, const char *cmd, char *s, cha
 		SQLCloseCursor(stmt);
 		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
 		release_obj_or_dsn (&obj, &dsn);
+		if (cache && !res1) {
+			odbc_cache_store(cache, cache_ttl, cache_size, ast_str_buffer(sql), buf, 0, status, "");
+		}
 		if (!bogus_chan) {
 			pbx_builtin_setvar_helper(chan, "ODBCROWS", rowcount);
 			pbx_builtin_setvar_helper(chan, "ODBCSTATUS", status);
@@ -1047,6 +1232,10 @@ end_acf_read:
 	SQLCloseCursor(stmt);
 	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
 	release_obj_or_dsn (&obj, &dsn);
+	if (cache && y >= 0) {
+		odbc_cache_store(cache, cache_ttl, cache_size, ast_str_buffer(sql), buf, y, status,
+			ast_str_buffer(colnames));
+	}
 	if (resultset && !multirow) {
 		/* Fetch the first resultset */
 		if (!acf_fetch(chan, "", buf, buf, len)) {
@@ -1153,6 +1342,7 @@ static int free_acf_query(struct acf_odbc_query *query)
 		ast_free(query->sql_read);
 		ast_free(query->sql_write);
 		ast_free(query->sql_insert);
+		ao2_cleanup(query->cache);
 		ast_free(query);
 	}
 	return 0;
@@ -1270,6 +1460,27 @@ static int init_acf_query(struct ast_config *cfg, char *catg, struct acf_odbc_qu
 			sscanf(tmp, "%30d", &((*query)->rowlimit));
 	}
 
+	if ((tmp = ast_variable_retrieve(cfg, catg, "cache_ttl"))) {
+		sscanf(tmp, "%30d", &((*query)->cache_ttl));
+	}
+	(*query)->cache_size = DEFAULT_CACHE_SIZE;
+	if ((tmp = ast_variable_retrieve(cfg, catg, "cache_size"))) {
+		sscanf(tmp, "%30d", &((*query)->cache_size));
+	}
+	if ((*query)->cache_ttl > 0 && (*query)->cache_size > 0 && (*query)->sql_read) {
+		if (ast_test_flag((*query), OPT_MULTIROW) || (*query)->rowlimit > 1) {
+			ast_log(LOG_WARNING, "cache_ttl has no effect on multiple row queries (%s)\n", catg);
+		} else {
+			(*query)->cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+				CACHE_BUCKETS, odbc_cache_hash, NULL, odbc_cache_cmp);
+			if (!(*query)->cache) {
+				free_acf_query(*query);
+				*query = NULL;
+				return ENOMEM;
+			}
+		}
+	}
+
 	(*query)->acf = ast_calloc(1, sizeof(struct ast_custom_function));
 	if (!(*query)->acf) {
 		free_acf_query(*query);
@@ -1732,6 +1943,29 @@ static char *cli_odbc_write(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	return CLI_SUCCESS;
 }
 
+static int manager_cache_flush(struct mansession *s, const struct message *m)
+{
+	const char *function = astman_get_header(m, "Function");
+	struct acf_odbc_query *query;
+	int found = 0;
+
+	AST_RWLIST_RDLOCK(&queries);
+	AST_RWLIST_TRAVERSE(&queries, query, list) {
+		if (ast_strlen_zero(function) || !strcmp(query->acf->name, function)) {
+			odbc_cache_flush(query);
+			found = 1;
+		}
+	}
+	AST_RWLIST_UNLOCK(&queries);
+
+	if (!found) {
+		astman_send_error(s, m, "No such function");
+		return 0;
+	}
+	astman_send_ack(s, m, "Cache flushed");
+	return 0;
+}
+
 static struct ast_cli_entry cli_func_odbc[] = {
 	AST_CLI_DEFINE(cli_odbc_write, "Test setting a func_odbc function"),
 	AST_CLI_DEFINE(cli_odbc_read, "Test reading a func_odbc function"),
@@ -1800,6 +2034,7 @@ static int load_module(void)
 	ast_config_destroy(cfg);
 	res |= ast_custom_function_register(&escape_function);
 	ast_cli_register_multiple(cli_func_odbc, ARRAY_LEN(cli_func_odbc));
+	res |= ast_manager_register_xml("ODBCCacheFlush", EVENT_FLAG_SYSTEM, manager_cache_flush);
 
 	AST_RWLIST_UNLOCK(&queries);
 	return res;
@@ -1821,6 +2056,7 @@ static int unload_module(void)
 	res |= ast_custom_function_unregister(&fetch_function);
 	res |= ast_unregister_application(app_odbcfinish);
 	ast_cli_unregister_multiple(cli_func_odbc, ARRAY_LEN(cli_func_odbc));
+	ast_manager_unregister("ODBCCacheFlush");
 
 	/* Allow any threads waiting for this lock to pass (avoids a race) */
 	AST_RWLIST_UNLOCK(&queries);
@@ -36,18 +36,34 @@ int ast_cli_perms_init(int reload);	/*!< Provided by cli.c */
 int dnsmgr_init(void);			/*!< Provided by dnsmgr.c */
 void dnsmgr_start_refresh(void);	/*!< Provided by dnsmgr.c */
 int dnsmgr_reload(void);		/*!< Provided by dnsmgr.c */
+int ast_dns_cache_init(void);		/*!< Provided by dns_cache.c */
 int ast_dns_system_resolver_init(void); /*!< Provided by dns_system_resolver.c */
 void threadstorage_init(void);		/*!< Provided by threadstorage.c */
 int ast_device_state_engine_init(void);	/*!< Provided by devicestate.c */
 int astobj2_init(void);			/*!< Provided by astobj2.c */
 int ast_named_locks_init(void);		/*!< Provided by named_locks.c */
+int ast_lock_contention_init(void);	/*!< Provided by lock.c */
 int ast_file_init(void);		/*!< Provided by file.c */
+int ast_frame_init(void);		/*!< Provided by frame.c */
+int ast_frame_latency_init(void);	/*!< Provided by frame_latency.c */
+int ast_media_fork_init(void);		/*!< Provided by media_fork.c */
+int ast_thread_placement_init(void);	/*!< Provided by thread_placement.c */
+
+/*!
+ * \brief Set the placement "core show threads" shows for the calling thread.
+ *
+ * \param placement Allocated description, which is stolen.  NULL to clear it.
+ *
+ * \note Provided by asterisk.c, only without LOW_MEMORY.
+ */
+void ast_thread_list_set_placement(char *placement);
 int ast_features_init(void);            /*!< Provided by features.c */
 void ast_autoservice_init(void);	/*!< Provided by autoservice.c */
 int ast_data_init(void);		/*!< Provided by data.c */
 int ast_http_init(void);		/*!< Provided by http.c */
 int ast_http_reload(void);		/*!< Provided by http.c */
 int ast_tps_init(void); 		/*!< Provided by taskprocessor.c */
+int ast_threadpool_init(void);	/*!< Provided by threadpool.c */
 int ast_timing_init(void);		/*!< Provided by timing.c */
 int ast_indications_init(void); /*!< Provided by indications.c */
 int ast_indications_reload(void);/*!< Provided by indications.c */
@@ -55,6 +71,7 @@ void ast_stun_init(void);               /*!< Provided by stun.c */
 int ast_cel_engine_init(void);		/*!< Provided by cel.c */
 int ast_cel_engine_reload(void);	/*!< Provided by cel.c */
 int ast_ssl_init(void);                 /*!< Provided by ssl.c */
+int ast_tcptls_init(void);              /*!< Provided by tcptls.c */
 int ast_pj_init(void);                 /*!< Provided by libasteriskpj.c */
 int ast_test_init(void);            /*!< Provided by test.c */
 int ast_msg_init(void);             /*!< Provided by message.c */
@@ -123,4 +140,14 @@ int ast_sounds_index_init(void);
  */
 int ast_endpoint_init(void);
 
+/*!
+ * \brief Defer translation matrix rebuilds caused by new translators.
+ *
+ * \param defer Non-zero to start deferring, zero to stop and rebuild once
+ *        if any translator became available in the meantime.
+ *
+ * Implementation is in main/translate.c
+ */
+void ast_translate_defer_rebuild(int defer);
+
 #endif /* _ASTERISK__PRIVATE_H */
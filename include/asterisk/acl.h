@@ -54,6 +54,8 @@ struct ast_ha {
 	struct ast_sockaddr netmask;
 	enum ast_acl_sense sense;
 	struct ast_ha *next;
+	/*! Compiled form of the list, only set on its head. See ast_ha_compile(). */
+	struct ast_ha_trie *trie;
 };
 
 #define ACL_NAME_LENGTH 80
@@ -194,6 +196,29 @@ int ast_acl_list_is_empty(struct ast_acl_list *acl_list);
  */
 enum ast_acl_sense ast_apply_ha(const struct ast_ha *ha, const struct ast_sockaddr *addr);
 
+/*!
+ * \brief Compile a list of host access rules for faster matching
+ * \since 15.0.0
+ *
+ * \details
+ * The rules are built into a prefix trie for each address family, so
+ * ast_apply_ha() looks up the last rule matching an address in time
+ * proportional to the address length rather than to the number of rules.
+ * Lists of a few rules, and lists with non-contiguous netmasks, are still
+ * walked.
+ *
+ * The compiled form is attached to the head of the list and is shared by
+ * the copies made with ast_duplicate_ha_list().  It is dropped when a rule
+ * is appended with ast_append_ha().
+ *
+ * \note The list must not be applied by another thread while it is compiled.
+ *
+ * \param ha The head of the list of host access rules
+ * \retval 0 Success
+ * \retval -1 Failure, the list will be walked
+ */
+int ast_ha_compile(struct ast_ha *ha);
+
 /*!
  * \brief Apply a set of rules to a given IP address
  *
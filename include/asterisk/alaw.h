@@ -83,4 +83,22 @@ static inline unsigned char AST_LIN2A(short sample)
 
 #define AST_ALAW(a) (__ast_alaw[(int)(a)])
 
+/*!
+ * \brief Decode a buffer of a-law samples to signed linear
+ *
+ * Gives the same results as AST_ALAW() / AST_LIN2A(), using the vector
+ * instructions of the running CPU when they are available.
+ */
+void ast_alaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples);
+
+/*!
+ * \brief Encode a buffer of signed linear samples to a-law
+ */
+void ast_alaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples);
+
+/*!
+ * \brief Name of the conversion kernel ast_alaw_decode() and ast_alaw_encode() use
+ */
+const char *ast_alaw_kernel_name(void);
+
 #endif /* _ASTERISK_ALAW_H */
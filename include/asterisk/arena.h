@@ -0,0 +1,107 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Memory arenas
+ */
+
+#ifndef _ASTERISK_ARENA_H
+#define _ASTERISK_ARENA_H
+
+/*!
+ * \page Arenas Memory arenas
+ * \since 15.0.0
+ *
+ * An arena hands out memory carved from a few large chunks and gives
+ * all of it back at once when the arena is destroyed.  It suits data
+ * that lives exactly as long as some owner, such as a channel, and
+ * saves an allocator call for each piece.
+ *
+ * Memory can be handed back to the arena early with
+ * ast_arena_release().  It is not returned to the system but reused
+ * by later allocations of the same size class, so an owner that keeps
+ * replacing data does not make the arena grow without bound.
+ *
+ * An arena is safe to use from several threads at once.
+ */
+
+struct ast_arena;
+
+/*!
+ * \brief Create an arena.
+ * \since 15.0.0
+ *
+ * \param chunk_size Bytes to carve allocations from before the arena
+ * needs another chunk.  The first chunk is part of the arena allocation.
+ *
+ * \retval arena on success.
+ * \retval NULL on error.
+ */
+#define ast_arena_create(chunk_size) \
+	__ast_arena_create((chunk_size), __FILE__, __LINE__, __PRETTY_FUNCTION__)
+struct ast_arena *__ast_arena_create(size_t chunk_size, const char *file, int lineno, const char *func);
+
+/*!
+ * \brief Destroy an arena and everything allocated from it.
+ * \since 15.0.0
+ *
+ * \param arena Arena to destroy.  NULL is tolerated.
+ *
+ * \return Nothing
+ */
+void ast_arena_destroy(struct ast_arena *arena);
+
+/*!
+ * \brief Allocate zeroed memory from an arena.
+ * \since 15.0.0
+ *
+ * \param arena Arena to allocate from.
+ * \param size Bytes needed.
+ *
+ * \note The memory is suitably aligned for any kind of variable.
+ * It must not be passed to ast_free().
+ *
+ * \retval memory on success.
+ * \retval NULL on error.
+ */
+void *ast_arena_calloc(struct ast_arena *arena, size_t size);
+
+/*!
+ * \brief Give memory back to an arena for reuse.
+ * \since 15.0.0
+ *
+ * \param arena Arena the memory was allocated from.
+ * \param ptr Memory to give back.  NULL is tolerated.
+ * \param size Size the memory was allocated with.
+ *
+ * \return Nothing
+ */
+void ast_arena_release(struct ast_arena *arena, void *ptr, size_t size);
+
+/*!
+ * \brief Get how much memory an arena holds.
+ * \since 15.0.0
+ *
+ * \param arena Arena to look at.
+ * \param[out] size Bytes held in the arena chunks.
+ * \param[out] used Bytes carved from the chunks so far, including released ones.
+ *
+ * \return Nothing
+ */
+void ast_arena_usage(struct ast_arena *arena, size_t *size, size_t *used);
+
+#endif /* _ASTERISK_ARENA_H */
@@ -31,6 +31,7 @@
 
 #include "asterisk/http.h"
 #include "asterisk/json.h"
+#include "asterisk/vector.h"
 
 /* Forward-declare websocket structs. This avoids including http_websocket.h,
  * which causes optional_api stuff to happen, which makes optional_api more
@@ -46,6 +47,17 @@ struct ast_websocket;
  */
 enum ast_json_encoding_format ast_ari_json_format(void);
 
+/*!
+ * \brief Determine whether to validate the next outgoing message.
+ *
+ * Responses and events are only validated by developer mode builds, and
+ * then for one of every validation_sample_rate messages from ari.conf.
+ *
+ * \retval 1 if the message should be validated.
+ * \retval 0 if validation should be skipped.
+ */
+int ast_ari_validate_sample(void);
+
 struct ast_ari_response;
 
 /*!
@@ -101,6 +113,12 @@ struct ast_ari_response {
 	const char *response_text; /* Shouldn't http.c handle this? */
 	/*! Flag to indicate that no further response is needed */
 	int no_response:1;
+	/*! Flag to indicate the message only has some fields of its model, so is not validated */
+	unsigned int projected:1;
+	/*! Connection of the request, \c NULL if the response can not be streamed */
+	struct ast_tcptls_session_instance *ser;
+	/*! Method of the request */
+	enum ast_http_method method;
 };
 
 /*!
@@ -258,4 +276,37 @@ void ast_ari_response_created(struct ast_ari_response *response,
  */
 void ast_ari_response_alloc_failed(struct ast_ari_response *response);
 
+/*! \brief An object in a list response */
+struct ast_ari_list_item {
+	/*! Id the list is ordered and paged by */
+	const char *id;
+	/*! The listed object */
+	void *obj;
+};
+
+/*! \brief Objects in a list response */
+AST_VECTOR(ast_ari_list_items, struct ast_ari_list_item);
+
+/*!
+ * \brief Fill in \a response with one page of a list.
+ *
+ * The \a items are sorted by id, and those whose id sorts after \a after,
+ * up to \a limit of them, are converted to JSON.  Objects converted to
+ * \c NULL are left out.  If \a fields are given, only those fields and the
+ * \a key_fields are kept in each object.
+ *
+ * \param response Response to fill in.
+ * \param items Objects to list. These are sorted in place.
+ * \param after Id the page starts after, or \c NULL to start at the first.
+ * \param limit Most objects in the page, or 0 for all of them.
+ * \param fields Fields to keep in each object, or \c NULL to keep all of them.
+ * \param fields_count Length of \a fields.
+ * \param key_fields \c NULL terminated list of the fields always kept.
+ * \param to_json Function converting a listed object to JSON.
+ */
+void ast_ari_response_list_page(struct ast_ari_response *response,
+	struct ast_ari_list_items *items, const char *after, int limit,
+	const char **fields, size_t fields_count, const char * const *key_fields,
+	struct ast_json *(*to_json)(void *obj));
+
 #endif /* _ASTERISK_ARI_H */
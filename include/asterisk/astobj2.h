@@ -1220,6 +1220,47 @@ enum ao2_container_opts {
 	 * ao2_sort_fn.
 	 */
 	AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE = (3 << 1),
+	/*!
+	 * \brief Let a hash container add buckets as it fills up.
+	 *
+	 * \details The requested number of buckets is only the starting
+	 * size.  Whenever the load factor goes above one object per
+	 * bucket a link splits a single bucket, so the cost of growing
+	 * is spread over many links instead of being paid by one.
+	 *
+	 * \note Buckets are not split while a traversal or an iterator
+	 * is positioned in the container.  An iterator that is never
+	 * completed or destroyed keeps the container at its current size.
+	 *
+	 * \note Ignored by all but hash containers.
+	 *
+	 * \since 15.0.0
+	 */
+	AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE = (1 << 3),
+	/*!
+	 * \brief Let ao2_find() search a hash container without locking it.
+	 *
+	 * \details Meant for read-mostly registries.  A plain ao2_find()
+	 * by OBJ_SEARCH_OBJECT or OBJ_SEARCH_KEY in ascending order,
+	 * without OBJ_MULTIPLE, OBJ_UNLINK, OBJ_NODATA, or OBJ_NOLOCK, walks
+	 * the hash bucket without taking the container lock and only
+	 * bumps the found object's reference count.  Everything else,
+	 * including all writers, still takes the container lock.
+	 *
+	 * \note The container's reference to an object taken out of the
+	 * container is released only once every lock-free search that
+	 * could still see it has finished.  The object may therefore be
+	 * destroyed a few milliseconds after it is unlinked.
+	 *
+	 * \note The ao2_find() comparison callback can be called without
+	 * the container lock.
+	 *
+	 * \note Ignored by all but hash containers.  Cannot be combined
+	 * with AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE.
+	 *
+	 * \since 15.0.0
+	 */
+	AO2_CONTAINER_ALLOC_OPT_RCU = (1 << 4),
 };
 
 /*!
@@ -1977,7 +2018,8 @@ int ao2_iterator_count(struct ao2_iterator *iter);
  * \param field The string field in the structure to hash
  *
  * AO2_STRING_FIELD_HASH_CB(mystruct, myfield) will produce a function
- * named mystruct_hash_fn which hashes mystruct->myfield.
+ * named mystruct_hash_fn which hashes mystruct->myfield with
+ * ast_str_hash_fast().
  */
 #define AO2_STRING_FIELD_HASH_FN(stype, field) \
 static int stype ## _hash_fn(const void *obj, const int flags) \
@@ -1995,7 +2037,7 @@ static int stype ## _hash_fn(const void *obj, const int flags) \
 		ast_assert(0); \
 		return 0; \
 	} \
-	return ast_str_hash(key); \
+	return ast_str_hash_fast(key); \
 }
 
 /*!
@@ -263,6 +263,20 @@ struct ast_bridge_softmix {
 	 * for itself.
 	 */
 	unsigned int internal_mixing_interval;
+	/*!
+	 * \brief The number of extra threads softmix may use to mix
+	 * each listener's audio.
+	 *
+	 * \note When set to 0, all mixing is done by the bridge's
+	 * single mixing thread.
+	 */
+	unsigned int mixing_threads;
+	/*!
+	 * \brief The number of loudest talkers softmix mixes.
+	 *
+	 * \note When set to 0, every talker is mixed.
+	 */
+	unsigned int max_talkers;
 };
 
 /*!
@@ -306,6 +320,10 @@ struct ast_bridge {
 	unsigned int inhibit_merge;
 	/*! Cause code of the dissolved bridge. */
 	int cause;
+	/*! NUMA node to keep the threads of the bridge on. (-1 for any node) */
+	int numa_node;
+	/*! Technology compatibility results and transition state of a smart bridge. */
+	struct bridge_tech_state *tech_state;
 	/*! TRUE if the bridge was reconfigured. */
 	unsigned int reconfigured:1;
 	/*! TRUE if the bridge has been dissolved.  Any channel that now tries to join is immediately ejected. */
@@ -867,6 +885,28 @@ void ast_bridge_set_internal_sample_rate(struct ast_bridge *bridge, unsigned int
  */
 void ast_bridge_set_mixing_interval(struct ast_bridge *bridge, unsigned int mixing_interval);
 
+/*!
+ * \brief Adjust the number of extra threads a bridge uses to mix
+ * each participant's audio during multimix mode.
+ * \since 15.0.0
+ *
+ * \param bridge Bridge to change the mixing threads on.
+ * \param mixing_threads the number of threads.  If 0 is set the
+ * bridge tech mixes everything in its own mixing thread.
+ */
+void ast_bridge_set_mixing_threads(struct ast_bridge *bridge, unsigned int mixing_threads);
+
+/*!
+ * \brief Limit the number of talkers a bridge mixes during multimix
+ * mode to the loudest ones.
+ * \since 15.0.0
+ *
+ * \param bridge Bridge to change the talker limit on.
+ * \param max_talkers the number of talkers.  If 0 is set every
+ * talker is mixed.
+ */
+void ast_bridge_set_max_talkers(struct ast_bridge *bridge, unsigned int max_talkers);
+
 /*!
  * \brief Set a bridge to feed a single video source to all participants.
  */
@@ -114,7 +114,7 @@ struct ast_bridge_channel {
 	 * technology.
 	 */
 	void *tech_pvt;
-	/*! Thread handling the bridged channel (Needed by ast_bridge_depart) */
+	/*! Thread handling the bridged channel, possibly a bridge reactor (Needed by ast_bridge_depart) */
 	pthread_t thread;
 	/* v-- These flags change while the bridge is locked or before the channel is in the bridge. */
 	/*! TRUE if the channel is in a bridge. */
@@ -147,6 +147,14 @@ struct ast_bridge_channel {
 	AST_LIST_HEAD_NOLOCK(, ast_frame) wr_queue;
 	/*! Pipe to alert thread when frames are put into the wr_queue. */
 	int alert_pipe[2];
+	/*! Voice frames queued without the lock, written before wr_queue. */
+	struct bridge_channel_wr_ring *wr_ring;
+	/*! Frames in wr_queue.  Changed under the lock, read atomically. */
+	unsigned int wr_queue_count;
+	/*! Non-zero while the alert is signalled and not yet read. */
+	int wr_alerted;
+	/*! Voice frames dropped because wr_ring was full. */
+	unsigned long wr_dropped;
 	/*!
 	 * \brief The bridge channel thread activity.
 	 *
@@ -181,6 +181,54 @@ void bridge_channel_impart_signal(struct ast_channel *chan);
  */
 int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel);
 
+/*!
+ * \internal
+ * \brief Join the bridge_channel to the bridge, letting a reactor service it while idle
+ * \since 15.0.0
+ *
+ * \param bridge_channel The Channel in the bridge
+ * \param resume Thread function to continue the bridge_channel on.
+ *
+ * \details
+ * This behaves like bridge_channel_internal_join() while
+ * bridge reactors are disabled or the bridge_channel has
+ * features that need a dedicated thread.  Otherwise, the
+ * bridge_channel is handed to a reactor thread that services
+ * many idle channels and this returns early.  When the
+ * bridge_channel needs a thread again, the reactor starts
+ * resume on a new detached thread with the bridge_channel as
+ * its argument.  That thread must continue the join with
+ * bridge_channel_internal_join_resume().
+ *
+ * \note Only channels no other thread waits on, such as
+ * independent imparted channels, can be handed to a reactor.
+ *
+ * \retval 1 a reactor now services the bridge channel
+ * \retval 0 bridge channel successfully joined the bridge
+ * \retval -1 bridge channel failed to join the bridge
+ */
+int bridge_channel_internal_join_reactor(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data));
+
+/*!
+ * \internal
+ * \brief Continue servicing a bridge_channel a reactor gave back
+ * \since 15.0.0
+ *
+ * \param bridge_channel The Channel in the bridge
+ * \param resume Thread function to continue the bridge_channel on.
+ *
+ * \details
+ * Called on the thread a reactor started for the bridge_channel.
+ * It returns when the channel has been instructed to leave the
+ * bridge or has been handed to a reactor again.
+ *
+ * \retval 1 a reactor now services the bridge channel
+ * \retval 0 bridge channel left the bridge
+ */
+int bridge_channel_internal_join_resume(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data));
+
 /*!
  * \internal
  * \brief Temporarily suspend a channel from a bridge, handing control over to some
@@ -248,4 +296,13 @@ int bridge_channel_internal_queue_attended_transfer(struct ast_channel *transfer
  */
 int bridge_channel_internal_allows_optimization(struct ast_bridge_channel *bridge_channel);
 
+/*!
+ * \internal
+ * \brief Get how many frames are waiting to be written to a bridge channel.
+ * \since 15.0.0
+ *
+ * \note May be called from any thread; the count is only a snapshot.
+ */
+unsigned int bridge_channel_internal_queue_depth(struct ast_bridge_channel *bridge_channel);
+
 #endif /* _ASTERISK_PRIVATE_BRIDGING_H */
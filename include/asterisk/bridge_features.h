@@ -263,6 +263,8 @@ struct ast_bridge_hook_timer {
 struct ast_bridge_features {
 	/*! Attached DTMF feature hooks */
 	struct ao2_container *dtmf_hooks;
+	/*! DTMF feature hooks compiled for matching, built when needed. (Protected by the dtmf_hooks lock) */
+	struct bridge_dtmf_trie *dtmf_trie;
 	/*! Attached miscellaneous other hooks. */
 	struct ao2_container *other_hooks;
 	/*! Attached interval hooks */
@@ -198,6 +198,53 @@ void bridge_merge_inhibit_nolock(struct ast_bridge *bridge, int request);
  */
 void bridge_reconfigured(struct ast_bridge *bridge, unsigned int colp_update);
 
+/*!
+ * \internal
+ * \brief Forget the bridge technology compatibility results of a bridge.
+ * \since 15.0.0
+ *
+ * \param bridge Bridge whose channels changed in a way the results do
+ * not account for, such as a channel being marked unbridged.
+ * \param bridge_channel Only forget the results involving this channel,
+ * which is leaving the bridge.  NULL to forget every result.
+ *
+ * \note On entry, the bridge is already locked.
+ *
+ * \return Nothing
+ */
+void bridge_tech_compat_flush(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel);
+
+/*!
+ * \internal
+ * \brief Find the DTMF feature hook of a collected digit sequence.
+ * \since 15.0.0
+ *
+ * \param features Features whose DTMF hooks to match.
+ * \param dtmf Collected digits.
+ * \param more Set non-zero if no hook has exactly these digits but some
+ * start with them.
+ *
+ * \details
+ * The hooks are compiled into a digit trie the first time they are
+ * matched after changing.
+ *
+ * \retval hook with exactly these digits, which must be unreferenced.
+ * \retval NULL if no hook has exactly these digits.
+ */
+struct ast_bridge_hook_dtmf *bridge_dtmf_hook_match(struct ast_bridge_features *features,
+	const char *dtmf, int *more);
+
+/*!
+ * \internal
+ * \brief Note that the DTMF feature hooks of features changed.
+ * \since 15.0.0
+ *
+ * \param features Features whose DTMF hooks were linked or unlinked.
+ *
+ * \return Nothing
+ */
+void bridge_dtmf_hooks_changed(struct ast_bridge_features *features);
+
 /*!
  * \internal
  * \brief Dissolve the bridge.
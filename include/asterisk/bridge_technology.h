@@ -142,6 +142,11 @@ struct ast_bridge_technology {
 	 *
 	 * \note On entry, bridge may or may not already be locked.
 	 * However, it can be accessed as if it were locked.
+	 *
+	 * \note The result is reused while the bridge has the same one or
+	 * two channels, with the same channel technologies, native and raw
+	 * formats and number of DTMF hooks, until a channel in the bridge
+	 * is marked unbridged with ast_channel_set_unbridged().
 	 */
 	int (*compatible)(struct ast_bridge *bridge);
 	/*!
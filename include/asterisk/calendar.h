@@ -136,6 +136,7 @@ struct ast_calendar {
 	int unloading:1;
 	int pending_deletion:1;
 	struct ao2_container *events;  /*!< The events that are known at this time */
+	int devstate_sched;  /*!< Pending device state update for all the events changing at once */
 };
 
 /*! \brief Register a new calendar technology
@@ -147,6 +148,22 @@ struct ast_calendar {
  */
 int ast_calendar_register(struct ast_calendar_tech *tech);
 
+/*! \brief Wait for a turn to fetch a calendar from its server
+ *
+ * Only as many calendars as maxfetches in the general section of calendar.conf
+ * are fetched at once, so that many calendars refreshing together do not each
+ * open a connection.
+ *
+ * \param cal The calendar to be fetched
+ *
+ * \retval 0 the calendar may be fetched, after which ast_calendar_fetch_end() must be called
+ * \retval -1 the calendar is being unloaded
+ */
+int ast_calendar_fetch_begin(struct ast_calendar *cal);
+
+/*! \brief Give up the turn taken by ast_calendar_fetch_begin() */
+void ast_calendar_fetch_end(void);
+
 /*! \brief Unregister a new calendar technology
  *
  * \param tech calendar technology to unregister
@@ -457,6 +457,18 @@ int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf,
  */
 typedef int (*ast_cdrbe)(struct ast_cdr *cdr);
 
+/*!
+ * \brief CDR backend callback for a batch of records
+ * \since 15.0.0
+ *
+ * \param cdrs The records to post
+ * \param count The number of records in \a cdrs
+ *
+ * \warning As with \ref ast_cdrbe, the channels associated with the records
+ * are not guaranteed to exist.
+ */
+typedef int (*ast_cdrbe_batch)(struct ast_cdr **cdrs, size_t count);
+
 /*! \brief Return TRUE if CDR subsystem is enabled */
 int ast_cdr_is_enabled(void);
 
@@ -509,6 +521,21 @@ void ast_cdr_free(struct ast_cdr *cdr);
  */
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be);
 
+/*!
+ * \brief Register a CDR handling engine that can post a batch of records at once
+ * \since 15.0.0
+ *
+ * \param name name associated with the particular CDR handler
+ * \param desc description of the CDR handler
+ * \param be function pointer to a CDR handler, used for single records
+ * \param batch_be function pointer to a CDR handler, called with each batch
+ * of records when the CDR engine is in batch mode
+ *
+ * \retval 0 on success.
+ * \retval -1 on error
+ */
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch batch_be);
+
 /*!
  * \brief Unregister a CDR handling engine
  * \param name name of CDR handler to unregister
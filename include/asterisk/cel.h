@@ -235,6 +235,9 @@ struct ast_cel_general_config {
 	 * ast_str_container_alloc()ed and filled with ao2-allocated
 	 * char* which are all-lowercase application names. */
 	struct ao2_container *apps;
+	unsigned int shards;		/*!< Number of serializers events are generated on */
+	unsigned int backend_queue_size;	/*!< Events held in memory for each backend */
+	unsigned int backend_spill_size;	/*!< Kilobytes of events spilled to disk for each backend */
 };
 
 /*!
@@ -304,11 +307,39 @@ typedef void (*ast_cel_backend_cb)(struct ast_event *event);
  */
 int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback);
 
+/*!
+ * \brief CEL backend callback for a batch of events
+ * \since 15.0.0
+ *
+ * \param events The events, oldest first
+ * \param count The number of events, never zero
+ */
+typedef void (*ast_cel_backend_batch_cb)(struct ast_event **events, size_t count);
+
+/*!
+ * \brief Register a CEL backend that takes events in batches
+ * \since 15.0.0
+ *
+ * Events are queued for each backend and delivered on a thread of its
+ * own, so a slow backend does not hold up the others.  This backend is
+ * handed everything queued for it at once instead of one event at a time.
+ *
+ * \param name Name of backend to register
+ * \param batch_callback Callback to register
+ *
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_batch_cb batch_callback);
+
 /*!
  * \brief Unregister a CEL backend
  *
  * \param name Name of backend to unregister
  *
+ * \note Events already queued for the backend are delivered before this
+ * returns.  Events spilled to disk are kept for when it registers again.
+ *
  * \retval zero on success
  * \retval non-zero on failure
  * \since 12
@@ -1376,6 +1376,43 @@ struct ast_channel *ast_channel_release(struct ast_channel *chan);
  */
 struct ast_channel *ast_request(const char *type, struct ast_format_cap *request_cap, const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *addr, int *cause);
 
+/*!
+ * \brief One of several channels requested with ast_request_multiple()
+ * \since 15.0.0
+ */
+struct ast_channel_request {
+	/*! Type of channel to request */
+	const char *type;
+	/*! Format capabilities for the requested channel */
+	struct ast_format_cap *request_cap;
+	/*! Unique IDs to create the channel with, may be NULL */
+	const struct ast_assigned_ids *assignedids;
+	/*! Destination of the call */
+	const char *addr;
+	/*! The requested channel, NULL on failure */
+	struct ast_channel *chan;
+	/*! Cause of failure */
+	int cause;
+};
+
+/*!
+ * \brief Requests several channels at the same time
+ * \since 15.0.0
+ *
+ * \param requests Channels to request
+ * \param count Number of requests
+ * \param requestor channel asking for data
+ *
+ * \details
+ * Makes each request like ast_request() would, with requests that have to
+ * wait on a channel driver (such as one handing them to its own threads)
+ * waiting at the same time instead of one after the other.  Returns once
+ * every request is done, with the chan and cause of each request set.
+ *
+ * \note Absolutely _NO_ channel locks should be held before calling this function.
+ */
+void ast_request_multiple(struct ast_channel_request *requests, size_t count, const struct ast_channel *requestor);
+
 enum ast_channel_requestor_relationship {
 	/*! The requestor is the future bridge peer of the channel. */
 	AST_CHANNEL_REQUESTOR_BRIDGE_PEER,
@@ -1816,6 +1853,36 @@ int ast_pre_call(struct ast_channel *chan, const char *sub_args);
  */
 int ast_call(struct ast_channel *chan, const char *addr, int timeout);
 
+/*!
+ * \brief One of several calls placed with ast_call_multiple()
+ * \since 15.0.0
+ */
+struct ast_channel_call {
+	/*! Channel to call on */
+	struct ast_channel *chan;
+	/*! Destination of the call */
+	const char *addr;
+	/*! What ast_call() returned */
+	int res;
+};
+
+/*!
+ * \brief Places several calls at the same time
+ * \since 15.0.0
+ *
+ * \param calls Calls to place
+ * \param count Number of calls
+ *
+ * \details
+ * Places each call like ast_call() with no timeout would, with calls that
+ * have to wait on a channel driver placed at the same time instead of one
+ * after the other.  Returns once every call has been placed, with the res
+ * of each call set.
+ *
+ * \note Absolutely _NO_ channel locks should be held before calling this function.
+ */
+void ast_call_multiple(struct ast_channel_call *calls, size_t count);
+
 /*!
  * \brief Indicates condition of channel
  * \note Absolutely _NO_ channel locks should be held before calling this function.
@@ -2745,6 +2812,40 @@ struct ast_channel_iterator *ast_channel_iterator_destroy(struct ast_channel_ite
  */
 struct ast_channel_iterator *ast_channel_iterator_by_exten_new(const char *exten, const char *context);
 
+/*!
+ * \brief Create a new channel iterator based on spy group
+ *
+ * \param groups The spy groups, separated by ':', that channels must be in
+ *
+ * \details
+ * After creating an iterator using this function, the ast_channel_iterator_next()
+ * function can be used to iterate through all channels whose SPYGROUP variable
+ * holds at least one of the groups.  The channels are found through an index
+ * instead of by checking every channel.
+ *
+ * \note You must call ast_channel_iterator_destroy() when done.
+ *
+ * \retval NULL on failure
+ * \retval a new channel iterator based on the specified parameters
+ *
+ * \since 15.0.0
+ */
+struct ast_channel_iterator *ast_channel_iterator_by_spygroup_new(const char *groups);
+
+/*!
+ * \brief Bring the spy group index up to date with the SPYGROUP variable of a channel
+ *
+ * \param chan The channel whose SPYGROUP variable may have changed
+ *
+ * \details
+ * Anything that changes the variables of a channel other than
+ * pbx_builtin_setvar_helper() and pbx_builtin_pushvar_helper() must call
+ * this afterwards, for ast_channel_iterator_by_spygroup_new() to find it.
+ *
+ * \since 15.0.0
+ */
+void ast_channel_spygroup_index_update(struct ast_channel *chan);
+
 /*!
  * \brief Create a new channel iterator based on name
  *
@@ -4220,7 +4321,8 @@ void ast_channel_named_callgroups_set(struct ast_channel *chan, struct ast_named
 struct ast_namedgroups *ast_channel_named_pickupgroups(const struct ast_channel *chan);
 void ast_channel_named_pickupgroups_set(struct ast_channel *chan, struct ast_namedgroups *value);
 
-/* Alertpipe accessors--the "internal" functions for channel.c use only */
+/* Alertpipe accessors--the "internal" functions for channel.c use only.
+ * The channel must be locked when writing or reading an alert. */
 typedef enum {
 	AST_ALERT_READ_SUCCESS = 0,
 	AST_ALERT_NOT_READABLE,
@@ -4406,6 +4508,20 @@ struct varshead *ast_channel_get_ari_vars(struct ast_channel *chan);
  */
 struct varshead *ast_channel_get_vars(struct ast_channel *chan);
 
+/*!
+ * \since 15.0.0
+ * \brief Get the channel's memory arena.
+ *
+ * Memory allocated from the arena with ast_arena_calloc() is freed
+ * along with the channel.  It suits small per call data that never
+ * outlives the channel.
+ *
+ * \param chan Channel.
+ *
+ * \return The channel's arena.
+ */
+struct ast_arena *ast_channel_arena(struct ast_channel *chan);
+
 /*!
  * \since 12
  * \brief A topic which publishes the events for a particular channel.
@@ -25,5 +25,44 @@ int ast_channel_internal_is_finalized(struct ast_channel *chan);
 void ast_channel_internal_cleanup(struct ast_channel *chan);
 int ast_channel_internal_setup_topics(struct ast_channel *chan);
 
+struct ast_channel_snapshot;
+/*! Snapshot last published by ast_channel_publish_snapshot() (not a reference, chan must be locked) */
+struct ast_channel_snapshot *ast_channel_internal_snapshot(const struct ast_channel *chan);
+/*! Replace the snapshot last published, taking a reference to it (chan must be locked) */
+void ast_channel_internal_snapshot_set(struct ast_channel *chan, struct ast_channel_snapshot *snapshot);
+
+/*! Spy groups the channel is indexed under, "" if none, NULL while not in the channels container (chan must be locked) */
+const char *ast_channel_internal_spygroups(const struct ast_channel *chan);
+/*! Replace the spy groups the channel is indexed under (chan must be locked) */
+void ast_channel_internal_spygroups_set(struct ast_channel *chan, const char *spygroups);
+
+struct ast_frame_latency;
+/*! Latency of the sampled frames written to the channel, allocated if create is set (chan must be locked) */
+struct ast_frame_latency *ast_channel_internal_frame_latency(struct ast_channel *chan, int create);
+
+/*! \brief Memory used by channels, see ast_channel_internal_memory() */
+struct ast_channel_memory {
+	/*! Channels counted */
+	unsigned int channels;
+	/*! Bytes taken by the channel structures themselves */
+	size_t channel_size;
+	/*! Channels that allocated their rarely used members */
+	unsigned int cold;
+	/*! Bytes held by the channel arenas */
+	size_t arena_size;
+	/*! Bytes handed out from the channel arenas */
+	size_t arena_used;
+	/*! Datastores attached */
+	unsigned int datastores;
+	/*! Frames waiting on the read queues */
+	unsigned int readq_frames;
+	/*! Channels with audiohooks */
+	unsigned int audiohooks;
+	/*! Channels with framehooks */
+	unsigned int framehooks;
+};
+/*! Add the memory used by a channel to the totals in mem (chan must be locked) */
+void ast_channel_internal_memory(struct ast_channel *chan, struct ast_channel_memory *mem);
+
 void ast_channel_internal_errno_set(enum ast_channel_error error);
 enum ast_channel_error ast_channel_internal_errno(void);
@@ -28,6 +28,8 @@
 struct ast_var_t {
 	AST_LIST_ENTRY(ast_var_t) entries;
 	char *value;
+	/*! ast_var_hash() of the name without the initial underscores */
+	unsigned int hash;
 	char name[0];
 };
 
@@ -46,6 +48,20 @@ const char *ast_var_name(const struct ast_var_t *var);
 const char *ast_var_full_name(const struct ast_var_t *var);
 const char *ast_var_value(const struct ast_var_t *var);
 char *ast_var_find(const struct varshead *head, const char *name);
+
+/*!
+ * \brief Hash a variable name for comparison with ast_var_t.hash.
+ * \since 15.0.0
+ *
+ * \details Variables whose ast_var_name() matches name, with or without
+ * case, have this hash.  Comparing it first spares looking at the
+ * names of most other variables while searching a list.
+ *
+ * \param name Variable name without the initial underscores.
+ *
+ * \return The hash.
+ */
+unsigned int ast_var_hash(const char *name);
 struct varshead *ast_var_list_clone(struct varshead *head);
 
 #define AST_VAR_LIST_TRAVERSE(head, var) AST_LIST_TRAVERSE(head, var, entries)
@@ -112,6 +112,12 @@ typedef struct ast_config *realtime_multi_get(const char *database, const char *
 typedef int realtime_update(const char *database, const char *table, const char *keyfield, const char *entity, const struct ast_variable *fields);
 typedef int realtime_update2(const char *database, const char *table, const struct ast_variable *lookup_fields, const struct ast_variable *update_fields);
 typedef int realtime_store(const char *database, const char *table, const struct ast_variable *fields);
+
+/*!
+ * \brief Function pointer called to store several rows at once
+ * \since 15.0.0
+ */
+typedef int realtime_store_multiple(const char *database, const char *table, const struct ast_variable **rows, size_t count);
 typedef int realtime_destroy(const char *database, const char *table, const char *keyfield, const char *entity, const struct ast_variable *fields);
 
 /*!
@@ -135,6 +141,7 @@ struct ast_config_engine {
 	realtime_update *update_func;
 	realtime_update2 *update2_func;
 	realtime_store *store_func;
+	realtime_store_multiple *store_multiple_func;
 	realtime_destroy *destroy_func;
 	realtime_require *require_func;
 	realtime_unload *unload_func;
@@ -667,6 +674,23 @@ int ast_store_realtime_fields(const char *family, const struct ast_variable *fie
  */
 int ast_store_realtime(const char *family, ...) attribute_sentinel;
 
+/*!
+ * \brief Create several rows in realtime configuration at once
+ *
+ * \param family which family/config to be created
+ * \param rows the fields of each row
+ * \param count the number of rows
+ *
+ * \details
+ * Engines that support it store all of the rows with as few statements as
+ * possible.  Other engines store the rows one at a time.
+ *
+ * \return Number of rows stored, or -1 on error.
+ *
+ * \since 15.0.0
+ */
+int ast_store_realtime_multiple_fields(const char *family, const struct ast_variable **rows, size_t count);
+
 /*!
  * \brief Destroy realtime configuration
  *
@@ -762,6 +786,22 @@ int ast_config_engine_deregister(struct ast_config_engine *del);
  */
 int ast_realtime_is_mapping_defined(const char *family);
 
+/*!
+ * \brief Forget the cached realtime lookups of a family
+ *
+ * \param family The family to forget, or NULL for every family
+ *
+ * \details
+ * Lookups are cached for the families given in the [cache] section of
+ * extconfig.conf.  Changes made through the realtime API flush the cache of
+ * their family themselves.  This is for changes made to the database by
+ * something else.
+ *
+ * \retval 0 The cache was flushed
+ * \retval -1 The family has no cache
+ */
+int ast_realtime_cache_flush(const char *family);
+
 #ifdef TEST_FRAMEWORK
 /*!
  * \brief Add an explicit mapping for a family
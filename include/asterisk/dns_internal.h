@@ -293,3 +293,26 @@ int dns_parse_string(char *cur, uint8_t *size, char **val);
  * \note The query must be released upon completion or cancellation using ao2_ref
  */
 struct ast_dns_query *dns_query_alloc(const char *name, int rr_type, int rr_class, ast_dns_resolve_callback callback, void *data);
+
+/*!
+ * \brief Start resolving a query, from the DNS cache if it can be
+ *
+ * \param query The DNS query, allocated by dns_query_alloc()
+ *
+ * When the cache is enabled, a query for a name with a fresh result is
+ * completed from the cache, and a query for a name that is already being
+ * resolved waits for that resolution.  The query is then handed to the
+ * cache's own resolver, so it is cancelled as usual.  Otherwise the query
+ * is given to its resolver.
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int dns_cache_resolve(struct ast_dns_query *query);
+
+/*!
+ * \brief Forget every result in the DNS cache
+ *
+ * Queries still waiting for a resolution are completed when it is done.
+ */
+void dns_cache_flush(void);
@@ -115,6 +115,34 @@ int ast_dsp_silence(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence)
    in frames_energy variable. */
 int ast_dsp_silence_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence, int *frames_energy);
 
+/*!
+ * \brief Compute the average energy of the samples in a frame
+ *
+ * \param f The voice frame, in signed linear, ulaw or alaw
+ * \param energy Set to the average absolute value of the samples
+ * \param samples Set to the number of samples in the frame
+ *
+ * \retval 0 success
+ * \retval -1 the frame is not a voice frame in a supported format
+ *
+ * The energy is the same value ast_dsp_silence_with_energy() returns in
+ * frames_energy.  Code that feeds one frame to several detectors can
+ * compute it once and hand it to each with ast_dsp_silence_from_energy().
+ */
+int ast_dsp_frame_energy(const struct ast_frame *f, int *energy, int *samples);
+
+/*!
+ * \brief Return non-zero if a frame of known energy is silence
+ *
+ * \param dsp The DSP doing the silence detection
+ * \param energy The average energy of the frame, from ast_dsp_frame_energy()
+ * \param samples The number of samples in the frame
+ * \param totalsilence Updated as by ast_dsp_silence(). Can be NULL.
+ *
+ * Does what ast_dsp_silence() does, without computing the energy again.
+ */
+int ast_dsp_silence_from_energy(struct ast_dsp *dsp, int energy, int samples, int *totalsilence);
+
 /*!
  * \brief Return non-zero if this is noise.  Updates "totalnoise" with the total
  * number of seconds of noise
@@ -76,6 +76,25 @@ typedef void (ast_waitstream_fr_cb)(struct ast_channel *chan, long ms, enum ast_
  */
 int ast_streamfile(struct ast_channel *c, const char *filename, const char *preflang);
 
+/*!
+ * \brief Streams a list of files as one stream
+ * \since 15.0.0
+ *
+ * \param c channel to stream the files to
+ * \param files the names of the files, minus the extension, separated by '&'
+ * \param preflang the preferred language you wish to have the files streamed to you in
+ *
+ * All the files are found before the stream starts, in the format the first
+ * one is played in.  They are then played back to back without the stream
+ * being closed or the channel's write format being set between them.  Wait
+ * for the whole list with ast_waitstream().
+ *
+ * \retval 0 on success.
+ * \retval -1 if a file is missing or not available in the format of the
+ * first one, or on failure.  Nothing is streamed then.
+ */
+int ast_streamfile_list(struct ast_channel *c, const char *files, const char *preflang);
+
 /*!
  * \brief stream file until digit
  * If the file name is non-empty, try to play it.
@@ -167,6 +167,8 @@ struct ast_frame {
 	union { void *ptr; uint32_t uint32; char pad[8]; } data;
 	/*! Global delivery time */
 	struct timeval delivery;
+	/*! When the frame was read from a channel driver, if sampled for latency tracing */
+	struct timeval ingress;
 	/*! For placing in a linked list */
 	AST_LIST_ENTRY(ast_frame) frame_list;
 	/*! Misc. frame flags */
@@ -217,6 +219,10 @@ extern struct ast_frame ast_null_frame;
 #define AST_MALLOCD_DATA	(1 << 1)
 /*! Need the source be free'd? (haha!) */
 #define AST_MALLOCD_SRC		(1 << 2)
+/*! Was the header allocated from a frame slab?  Only used by the frame core. */
+#define AST_MALLOCD_SLAB	(1 << 3)
+/*! Is the data a reference counted payload shared with other frames?  It must not be modified. */
+#define AST_MALLOCD_SHARED	(1 << 4)
 
 /* MODEM subclasses */
 /*! T.38 Fax-over-IP */
@@ -554,6 +560,36 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr);
  */
 struct ast_frame *ast_frdup(const struct ast_frame *fr);
 
+/*! \brief Copies a frame, sharing its payload with the copy
+ * \param fr frame to copy
+ *
+ * The payload of the returned frame is a reference counted buffer marked
+ * with AST_MALLOCD_SHARED.  If \a fr already carries a shared payload the
+ * copy only takes another reference to it, otherwise the payload is copied
+ * once into a new shared buffer.  Use this when the same frame is handed to
+ * many consumers, such as every channel in a bridge, so that each of them
+ * gets its own header without another copy of the data.
+ *
+ * A shared payload has no headroom (an offset of 0) and must not be modified.
+ * Anything which needs to change the data in place must first call
+ * ast_frame_make_writable().
+ *
+ * \return Returns a frame on success, NULL on error
+ */
+struct ast_frame *ast_frdup_shared(const struct ast_frame *fr);
+
+/*! \brief Gives a frame a payload which may be modified
+ * \param fr frame to act upon
+ *
+ * If the payload of \a fr is shared with other frames it is replaced by a
+ * private copy with AST_FRIENDLY_OFFSET bytes of headroom, otherwise the
+ * frame is left alone.
+ *
+ * \retval 0 on success
+ * \retval -1 on error, in which case the frame is unchanged
+ */
+int ast_frame_make_writable(struct ast_frame *fr);
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples);
 
 /* Helpers for byteswapping native samples to/from
@@ -0,0 +1,128 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Media frame latency tracing
+ *
+ * When the asterisk.conf option frame_latency_sample is set, one in that
+ * many audio and video frames read from a channel driver is stamped with
+ * the time it was read.  The stamp follows the frame through queues,
+ * translators and bridges, and the time since it was read is counted in
+ * latency histograms where the frame passes through the translators, the
+ * bridge technologies and is finally written to a channel.
+ */
+
+#ifndef _ASTERISK_FRAME_LATENCY_H
+#define _ASTERISK_FRAME_LATENCY_H
+
+#include "asterisk/frame.h"
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*! Number of buckets in the frame latency histograms. */
+#define AST_FRAME_LATENCY_BUCKETS 8
+
+/*!
+ * \brief Latency of the frames sampled at one point.
+ * \since 15.0.0
+ *
+ * The histogram counts frames that took less than 1ms, 2ms, 5ms, 10ms,
+ * 20ms, 50ms, 100ms, and the rest since they were read.
+ */
+struct ast_frame_latency {
+	/*! Frames counted */
+	unsigned long samples;
+	/*! Total microseconds of the frames counted */
+	uint64_t total_us;
+	/*! Longest a frame took in microseconds */
+	unsigned long max_us;
+	/*! Frames counted by time taken */
+	unsigned long histogram[AST_FRAME_LATENCY_BUCKETS];
+};
+
+/*! Where bridge technologies are sampled, named after the technology */
+#define AST_FRAME_LATENCY_BRIDGE "bridge"
+/*! Where translation paths are sampled, named after the formats */
+#define AST_FRAME_LATENCY_TRANSLATE "translate"
+/*! Where frames are written to a channel, named after the channel type */
+#define AST_FRAME_LATENCY_WRITE "write"
+
+/*!
+ * \brief Stamp a frame read from a channel driver if it is sampled.
+ * \since 15.0.0
+ *
+ * \param f Frame read.  Audio and video frames get their ingress time
+ * set to now if sampled and cleared otherwise.
+ *
+ * \return Nothing
+ */
+void ast_frame_latency_stamp(struct ast_frame *f);
+
+/*!
+ * \brief Count the time since a frame was read in a histogram.
+ * \since 15.0.0
+ *
+ * \param latency Histogram to update, locked by the caller.
+ * \param ingress Ingress time of the frame.  Nothing is counted if it is zero.
+ *
+ * \return Nothing
+ */
+void ast_frame_latency_add(struct ast_frame_latency *latency, struct timeval ingress);
+
+/*!
+ * \brief Count the time since a frame was read at a named point.
+ * \since 15.0.0
+ *
+ * \param point Kind of point, such as AST_FRAME_LATENCY_BRIDGE.
+ * \param name Name of the point, such as the bridge technology.
+ * \param ingress Ingress time of the frame.  Nothing is counted if it is zero.
+ *
+ * \return Nothing
+ */
+void ast_frame_latency_record(const char *point, const char *name, struct timeval ingress);
+
+/*!
+ * \brief Get the label of a latency histogram bucket.
+ * \since 15.0.0
+ *
+ * \param bucket Bucket index, less than AST_FRAME_LATENCY_BUCKETS.
+ *
+ * \return Label such as "lt_1ms", suitable for a header or metric name.
+ */
+const char *ast_frame_latency_bucket_label(unsigned int bucket);
+
+/*!
+ * \brief Call a function with the latency of every named point.
+ * \since 15.0.0
+ *
+ * \param cb Function to call, in point and name order.  Returning non-zero
+ * stops the iteration.
+ * \param arg Passed to \a cb.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int ast_frame_latency_foreach(int (*cb)(const char *point, const char *name,
+	const struct ast_frame_latency *latency, void *arg), void *arg);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_FRAME_LATENCY_H */
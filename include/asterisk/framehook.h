@@ -171,6 +171,10 @@ enum ast_framehook_event {
  * to return a completely different frame, but when that occurs this function is in
  * charge of freeing the previous frame.
  *
+ * Media frames may carry a payload shared with other frames (AST_MALLOCD_SHARED),
+ * for example audio fanned out to every channel in a conference.  Before changing
+ * the data of a frame in place, call ast_frame_make_writable() on it.
+ *
  * The ast_channel will always be locked during this callback. Never attempt to unlock the
  * channel for any reason.
  *
@@ -106,6 +106,72 @@ struct ast_heap *ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_f
 		ssize_t index_offset);
 #endif
 
+/*!
+ * \brief Function type for getting the key of an element in a keyed heap
+ *
+ * \param elm the element
+ *
+ * \return the key.  The element with the largest key is at the top of the heap.
+ *
+ * \note The key is taken when the element is pushed and kept in the heap.  It
+ *       must not change while the element is on the heap.
+ * \since 15.0.0
+ */
+typedef int64_t (*ast_heap_key_fn)(void *elm);
+
+/*!
+ * \brief Create a keyed max heap
+ *
+ * \param init_height The initial height of the heap to allocate space for,
+ *        as for ast_heap_create()
+ * \param key_fn The function that gets the key of an element
+ * \param cmp_fn Optional function to break a tie between elements with equal
+ *        keys.  If NULL, the order of elements with equal keys is not defined.
+ * \param index_offset Where the element keeps its index, as for ast_heap_create()
+ *
+ * A keyed heap is a four-ary heap that keeps the key of each element next to
+ * the pointer to it, with the four children of an element on one cache line.
+ * Pushing and popping only look at the elements themselves to break ties, so
+ * a heap of many elements takes far fewer cache misses and is half as deep as
+ * the binary heap made by ast_heap_create().  It is used through the same
+ * functions.
+ *
+ * Example Usage:
+ *
+ * \code
+ *
+ * struct myobj {
+ *    struct timeval when;
+ *    ssize_t __heap_index;
+ * };
+ *
+ * static int64_t myobj_key(void *obj)
+ * {
+ *    struct myobj *myobj = obj;
+ *
+ *    return -ast_tvdiff_us(myobj->when, ast_tv(0, 0));
+ * }
+ *
+ * ...
+ *
+ * struct ast_heap *h;
+ *
+ * h = ast_heap_create_keyed(8, myobj_key, NULL, offsetof(struct myobj, __heap_index));
+ *
+ * \endcode
+ *
+ * \return An instance of a max heap
+ * \since 15.0.0
+ */
+#ifdef __AST_DEBUG_MALLOC
+struct ast_heap *_ast_heap_create_keyed(unsigned int init_height, ast_heap_key_fn key_fn,
+		ast_heap_cmp_fn cmp_fn, ssize_t index_offset, const char *file, int lineno, const char *func);
+#define	ast_heap_create_keyed(a,b,c,d)	_ast_heap_create_keyed(a,b,c,d,__FILE__,__LINE__,__PRETTY_FUNCTION__)
+#else
+struct ast_heap *ast_heap_create_keyed(unsigned int init_height, ast_heap_key_fn key_fn,
+		ast_heap_cmp_fn cmp_fn, ssize_t index_offset);
+#endif
+
 /*!
  * \brief Destroy a max heap
  *
@@ -201,6 +201,69 @@ void ast_http_send(struct ast_tcptls_session_instance *ser, enum ast_http_method
 	int status_code, const char *status_title, struct ast_str *http_header,
 	struct ast_str *out, int fd, unsigned int static_content);
 
+/*!
+ * \brief HTTP response whose body is sent as it is produced.
+ * \since 15.0.0
+ */
+struct ast_http_chunked;
+
+/*!
+ * \brief Start an HTTP/1.1 response with a chunked body.
+ * \since 15.0.0
+ *
+ * For bodies too large to be built before being sent.  The headers are sent
+ * right away, the body follows with ast_http_chunked_write() and ends with
+ * ast_http_chunked_end().  Since the status is sent first, a failure while
+ * producing the body can only be reported by ending the body early.
+ *
+ * \param ser TCP/TLS session object
+ * \param method GET/POST/HEAD
+ * \param status_code HTTP response code (200/401/403/404/500)
+ * \param status_title English equivalent to the status_code parameter
+ * \param http_header An ast_str object containing all headers, freed by this
+ *   function.
+ *
+ * \return Response to write the body of.
+ * \return \c NULL on error.
+ */
+struct ast_http_chunked *ast_http_chunked_start(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header);
+
+/*!
+ * \brief Write part of the body of a chunked response.
+ * \since 15.0.0
+ *
+ * \param chunked Response from ast_http_chunked_start().
+ * \param buf Part of the body.
+ * \param len Length of \a buf.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the connection failed.
+ */
+int ast_http_chunked_write(struct ast_http_chunked *chunked, const char *buf, size_t len);
+
+/*!
+ * \brief End the body of a chunked response.
+ * \since 15.0.0
+ *
+ * \param chunked Response from ast_http_chunked_start(), which is freed.
+ *   May be \c NULL.
+ */
+void ast_http_chunked_end(struct ast_http_chunked *chunked);
+
+/*!
+ * \brief Give up on the body of a chunked response.
+ * \since 15.0.0
+ *
+ * The connection is closed without ending the body, so the client can tell
+ * that it is incomplete.
+ *
+ * \param chunked Response from ast_http_chunked_start(), which is freed.
+ *   May be \c NULL.
+ */
+void ast_http_chunked_abort(struct ast_http_chunked *chunked);
+
 /*!
  * \brief Creates and sends a formatted http response message.
  * \param ser                   TCP/TLS session object
@@ -56,6 +56,12 @@ enum ast_websocket_opcode {
 	AST_WEBSOCKET_OPCODE_CONTINUATION = 0x0, /*!< Continuation of a previous frame */
 };
 
+/*! \brief What happens to a frame written to a session whose send queue is full */
+enum ast_websocket_send_queue_policy {
+	AST_WEBSOCKET_SEND_QUEUE_DROP,       /*!< The frame is dropped */
+	AST_WEBSOCKET_SEND_QUEUE_DISCONNECT, /*!< The session is closed */
+};
+
 /*!
  * \brief Opaque structure for WebSocket server.
  * \since 12
@@ -434,4 +440,58 @@ AST_OPTIONAL_API(const char *, ast_websocket_client_accept_protocol,
  */
 AST_OPTIONAL_API(int, ast_websocket_set_timeout, (struct ast_websocket *session, int timeout), {return -1;});
 
+/*!
+ * \brief Queue the frames written to a WebSocket session instead of writing them in place.
+ *
+ * \since 15.0.0
+ *
+ * \param session Pointer to the WebSocket session
+ * \param high_water Most payload bytes queued before policy applies
+ * \param policy What happens to frames written once high_water is reached
+ *
+ * \details
+ * Once enabled, ast_websocket_write() and ast_websocket_write_payload()
+ * queue the frame and return without waiting for the client.  The queue is
+ * written to the socket by a worker thread, so a slow client no longer
+ * blocks the thread producing its frames.  Calling this again changes the
+ * high water mark and policy.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+AST_OPTIONAL_API(int, ast_websocket_set_send_queue, (struct ast_websocket *session, size_t high_water, enum ast_websocket_send_queue_policy policy), {return -1;});
+
+/*!
+ * \brief Allocate a reference counted payload buffer.
+ *
+ * \since 15.0.0
+ *
+ * \param size Size of the payload
+ *
+ * \details
+ * The buffer is an ao2 object.  Writing it with ast_websocket_write_payload()
+ * to any number of sessions shares it rather than copying it.
+ *
+ * \return Payload buffer, which must be unreffed with ao2_ref().
+ * \retval NULL on error
+ */
+AST_OPTIONAL_API(char *, ast_websocket_payload_alloc, (size_t size), {return NULL;});
+
+/*!
+ * \brief Construct and transmit a WebSocket frame from a reference counted payload buffer.
+ *
+ * \since 15.0.0
+ *
+ * \param session Pointer to the WebSocket session
+ * \param opcode WebSocket operation code to place in the frame
+ * \param payload Payload buffer from ast_websocket_payload_alloc()
+ * \param payload_size Length of the payload
+ *
+ * \note A session with a send queue keeps a reference to the payload until it is written.
+ *
+ * \retval 0 if successfully written or queued
+ * \retval -1 if error occurred
+ */
+AST_OPTIONAL_API(int, ast_websocket_write_payload, (struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size), { errno = ENOSYS; return -1;});
+
 #endif
@@ -39,6 +39,8 @@ typedef struct {} SSL;
 typedef struct {} SSL_CTX;
 #endif /* DO_SSL */
 
+#include <sys/uio.h>
+
 struct ast_iostream;
 
 /*!
@@ -103,12 +105,44 @@ void ast_iostream_set_exclusive_input(struct ast_iostream *stream, int exclusive
 int ast_iostream_get_fd(struct ast_iostream *stream);
 void ast_iostream_nonblock(struct ast_iostream *stream);
 
+/*!
+ * \brief Get the number of bytes already received but not read from a stream.
+ *
+ * \param stream iostream control data.
+ *
+ * \details
+ * Input that has been buffered by the stream, or decrypted by TLS, does
+ * not make its file descriptor readable, so it needs to be checked before
+ * waiting on the descriptor.
+ *
+ * \return Number of buffered bytes.
+ */
+size_t ast_iostream_pending(struct ast_iostream *stream);
+
 SSL* ast_iostream_get_ssl(struct ast_iostream *stream);
 
 ssize_t ast_iostream_read(struct ast_iostream *stream, void *buf, size_t count);
 ssize_t ast_iostream_gets(struct ast_iostream *stream, char *buf, size_t count);
 ssize_t ast_iostream_discard(struct ast_iostream *stream, size_t count);
 ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buf, size_t count);
+
+/*!
+ * \brief Write several buffers to a stream at once.
+ *
+ * \param stream iostream control data.
+ * \param iov Buffers to write, in order.
+ * \param iovcnt Number of buffers.
+ *
+ * \details
+ * Plain streams write the buffers with as few writev() calls as they can.
+ * TLS streams write them one after the other.  The stream timeouts apply
+ * as for ast_iostream_write().
+ *
+ * \return Number of bytes written, which is less than the total on a
+ * timeout or error after a partial write.
+ * \retval -1 on error.
+ */
+ssize_t ast_iostream_writev(struct ast_iostream *stream, const struct iovec *iov, int iovcnt);
 ssize_t ast_iostream_printf(struct ast_iostream *stream, const void *fmt, ...);
 
 struct ast_iostream* ast_iostream_from_fd(int *fd);
@@ -151,6 +151,39 @@ void *ast_json_malloc(size_t size);
  */
 void ast_json_free(void *p);
 
+/*!
+ * \brief Memory a whole JSON document is carved from.
+ * \since 15.0.0
+ */
+struct ast_json_arena;
+
+/*!
+ * \brief Carve the JSON the calling thread builds from a new arena.
+ * \since 15.0.0
+ *
+ * Until ast_json_arena_end() is called, the JSON built by the calling thread
+ * is carved from one arena instead of being allocated value by value, and
+ * all of its values share one lock.  The arena is freed at once when the
+ * last of its values is.  Meant for documents that are built, used and
+ * released as a whole, such as a list in an ARI response; a value of the
+ * document kept after the rest is released keeps the whole arena around.
+ *
+ * Arenas nest; the previous arena is used again once this one ends.
+ *
+ * \return Arena to pass to ast_json_arena_end().
+ * \return \c NULL on error, in which case values are allocated as usual.
+ */
+struct ast_json_arena *ast_json_arena_begin(void);
+
+/*!
+ * \brief Stop carving the JSON the calling thread builds from an arena.
+ * \since 15.0.0
+ *
+ * \param arena Arena from ast_json_arena_begin() on the same thread.  May
+ *   be \c NULL.
+ */
+void ast_json_arena_end(struct ast_json_arena *arena);
+
 /*!
  * \struct ast_json
  * \brief Abstract JSON element (object, array, string, int, ...).
@@ -832,6 +865,118 @@ int ast_json_dump_file_format(struct ast_json *root, FILE *output, enum ast_json
  */
 int ast_json_dump_new_file_format(struct ast_json *root, const char *path, enum ast_json_encoding_format format);
 
+/*!
+ * \brief Function a JSON stream writes its encoding with.
+ * \since 15.0.0
+ *
+ * \param buf Next part of the encoding, not NUL terminated.
+ * \param len Length of \a buf.
+ * \param data Data given to ast_json_stream_create().
+ * \return 0 on success.
+ * \return -1 on error, which fails the stream.
+ */
+typedef int (*ast_json_stream_write_fn)(const char *buf, size_t len, void *data);
+
+/*!
+ * \brief Encoder writing a JSON document as it is iterated.
+ * \since 15.0.0
+ *
+ * For documents too large to be built as a whole before being encoded,
+ * such as a list of thousands of channels.  Containers are opened and
+ * closed on the stream, and their members are encoded and written as they
+ * are added, so only one member needs to exist at a time.
+ */
+struct ast_json_stream;
+
+/*!
+ * \brief Create a JSON stream.
+ * \since 15.0.0
+ *
+ * \param format Encoding format.
+ * \param write Function the encoding is written with.
+ * \param data Passed to \a write.
+ * \return New stream, to be freed with ast_json_stream_free().
+ * \return \c NULL on error.
+ */
+struct ast_json_stream *ast_json_stream_create(enum ast_json_encoding_format format,
+	ast_json_stream_write_fn write, void *data);
+
+/*!
+ * \brief Free a JSON stream.
+ * \since 15.0.0
+ *
+ * \param stream Stream to free.  May be \c NULL.
+ */
+void ast_json_stream_free(struct ast_json_stream *stream);
+
+/*!
+ * \brief Open an array on a JSON stream.
+ * \since 15.0.0
+ *
+ * Each of the following functions fails once any write on the stream
+ * failed, or if it is used out of order, such as a value in an object
+ * without a key.
+ *
+ * \param stream JSON stream.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_array_start(struct ast_json_stream *stream);
+
+/*!
+ * \brief Close the innermost array of a JSON stream.
+ * \since 15.0.0
+ *
+ * \param stream JSON stream.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_array_end(struct ast_json_stream *stream);
+
+/*!
+ * \brief Open an object on a JSON stream.
+ * \since 15.0.0
+ *
+ * \param stream JSON stream.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_object_start(struct ast_json_stream *stream);
+
+/*!
+ * \brief Close the innermost object of a JSON stream.
+ * \since 15.0.0
+ *
+ * \param stream JSON stream.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_object_end(struct ast_json_stream *stream);
+
+/*!
+ * \brief Write the key of the next member of the innermost object.
+ * \since 15.0.0
+ *
+ * The value follows with ast_json_stream_value() or by opening a container.
+ *
+ * \param stream JSON stream.
+ * \param key Key of the member.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_key(struct ast_json_stream *stream, const char *key);
+
+/*!
+ * \brief Encode a value as the next member of the innermost container.
+ * \since 15.0.0
+ *
+ * \param stream JSON stream.
+ * \param value Value to encode.  The caller keeps its reference.
+ * \return 0 on success.
+ * \return -1 on error.
+ */
+int ast_json_stream_value(struct ast_json_stream *stream, struct ast_json *value);
+
 #define AST_JSON_ERROR_TEXT_LENGTH    160
 #define AST_JSON_ERROR_SOURCE_LENGTH   80
 
@@ -427,9 +427,59 @@ void ast_callid_strnprint(char *buffer, size_t buffer_size, ast_callid callid);
 
 #define ast_log_dynamic_level(level, ...) ast_log(level, __FILE__, __LINE__, __PRETTY_FUNCTION__, __VA_ARGS__)
 
+/*! \brief The highest debug level set for any module */
+extern int ast_debug_module_max;
+
+/*! \brief Changed whenever the debug level of a module changes */
+extern unsigned int ast_debug_module_generation;
+
+/*! \brief The highest debug level set for any call */
+extern int ast_debug_call_max;
+
+/*!
+ * \brief Get the debug level for a call
+ * \param callid The callid of the call
+ * \return the debug level set for the call with "core set debug call"
+ * \since 15.0.0
+ */
+unsigned int ast_debug_get_by_callid(ast_callid callid);
+
+/*!
+ * \internal
+ * \brief Get the debug level of the module a source file belongs to.
+ *
+ * The level is cached in each source file and only looked up again once
+ * ast_debug_module_generation changes.  The generation is kept in the upper
+ * bits of the same word as the level so that they are always read together.
+ */
+static inline unsigned int __attribute__((unused)) __ast_debug_module_level(const char *module)
+{
+	static unsigned int cache;
+	unsigned int cached = cache;
+	unsigned int generation = ast_debug_module_generation;
+	unsigned int level;
+
+	if ((cached >> 8) == generation) {
+		return cached & 0xff;
+	}
+
+	level = ast_debug_get_by_module(module);
+	cache = (generation << 8) | (level > 0xff ? 0xff : level);
+	return level;
+}
+
+/*!
+ * \brief Is debug output at this level wanted here?
+ *
+ * The global, module and call levels are checked in that order.  The module
+ * and call levels are only looked up when a module or a call has a debug
+ * level at least this high, so disabled debug costs a few integer compares.
+ */
 #define DEBUG_ATLEAST(level) \
 	(option_debug >= (level) \
-		|| (ast_opt_dbg_module && (int)ast_debug_get_by_module(AST_MODULE) >= (level)))
+		|| (ast_debug_module_max >= (level) && (int)__ast_debug_module_level(AST_MODULE) >= (level)) \
+		|| (ast_debug_call_max >= (level) \
+			&& (int)ast_debug_get_by_callid(ast_read_threadstorage_callid()) >= (level)))
 
 /*!
  * \brief Log a DEBUG message
@@ -176,6 +176,8 @@ struct manager_action {
 	 * function and unregestring the AMI action object.
 	 */
 	unsigned int registered:1;
+	/*! TRUE if the XML documentation is built when first shown rather than at registration. */
+	unsigned int docs_pending:1;
 };
 
 /*! \brief External routines may register/unregister manager callbacks this way 
@@ -63,11 +63,11 @@ int ast_media_cache_exists(const char *uri);
  * \endcode
  *
  * \details
- * Retrieving an item will cause the \ref bucket Bucket backend associated
- * with the URI scheme in \c uri to be queried. If the Bucket backend
- * does not require an update, the cached information is used to find the
- * file associated with \c uri, and \c file_path is populated with the
- * location of the media file associated with \c uri.
+ * If the item is in the cache, \c file_path is populated with the location
+ * of the media file associated with \c uri right away. The \ref bucket
+ * Bucket backend associated with the URI scheme in \c uri is then asked in
+ * the background whether the item needs an update, and if it does the new
+ * media replaces the old once it has been retrieved.
  *
  * If the item is not in the cache, the item will be retrieved using the
  * \ref bucket backend. When this occurs, if \c preferred_file_name is given,
@@ -78,6 +78,28 @@ int ast_media_cache_exists(const char *uri);
 int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	char *file_path, size_t len);
 
+/*!
+ * \brief Fetch an item into the cache in the background
+ *
+ * \param uri The unique URI for the media item
+ *
+ * \retval 0 The fetch was queued, or one is already queued for \c uri
+ * \retval -1 The fetch could not be queued
+ *
+ * Example Usage:
+ * \code
+ * ast_media_cache_prefetch("http://localhost/foo.wav");
+ * ast_media_cache_prefetch("http://localhost/bar.wav");
+ * \endcode
+ *
+ * \details
+ * Fetches run on a small pool of threads, so several items are retrieved
+ * at the same time. If the item is already in the cache, it is revalidated
+ * with its \ref bucket backend instead. A later \ref ast_media_cache_retrieve
+ * of a prefetched item does not wait for the remote server.
+ */
+int ast_media_cache_prefetch(const char *uri);
+
 /*!
  * \brief Retrieve metadata from an item in the cache
  *
@@ -0,0 +1,100 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Media forks
+ *
+ * A media fork hands the audio a channel thread reads to a consumer, such
+ * as a speech engine or a network stream, that runs on a thread of its
+ * own.  The channel thread translates each frame to the format of the
+ * consumer once and puts it in a ring without taking a lock.  The consumer
+ * is called with the frames in order on a serializer of a shared pool.
+ * When the consumer falls behind and the ring fills, frames are dropped
+ * and counted instead of holding up the channel.
+ *
+ * "core show media forks" shows how far behind each consumer is.
+ */
+
+#ifndef _ASTERISK_MEDIA_FORK_H
+#define _ASTERISK_MEDIA_FORK_H
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+struct ast_frame;
+struct ast_format;
+struct ast_media_fork;
+
+/*! \brief The consumer of a media fork */
+struct ast_media_fork_consumer {
+	/*!
+	 * \brief Take a frame, on the thread of the fork.
+	 *
+	 * \param data The data given to ast_media_fork_create()
+	 * \param frame The frame, in the format of the fork.  It is freed
+	 *   after the call.
+	 *
+	 * \retval 0 on success.
+	 * \retval -1 on failure, which is counted.
+	 */
+	int (*write)(void *data, struct ast_frame *frame);
+};
+
+/*!
+ * \brief Create a media fork.
+ * \since 15.0.0
+ *
+ * \param name Name shown by "core show media forks", such as the channel name
+ * \param format Format the consumer takes frames in
+ * \param depth Most frames waiting for the consumer, rounded up to a power of two
+ * \param consumer The consumer, which must stay valid until the fork is destroyed
+ * \param data Passed to the consumer
+ *
+ * \return The fork
+ * \retval NULL on failure
+ */
+struct ast_media_fork *ast_media_fork_create(const char *name, struct ast_format *format,
+	unsigned int depth, const struct ast_media_fork_consumer *consumer, void *data);
+
+/*!
+ * \brief Give a frame to the consumer of a media fork.
+ * \since 15.0.0
+ *
+ * Only audio frames are given to the consumer; anything else is ignored.
+ * Never waits for the consumer.  Must only be called by one thread at a
+ * time, normally the thread of the channel the audio is read from.
+ *
+ * \retval 0 if the frame was queued or ignored.
+ * \retval -1 if it was dropped because the consumer is behind or on failure.
+ */
+int ast_media_fork_write(struct ast_media_fork *fork, struct ast_frame *frame);
+
+/*!
+ * \brief Stop and destroy a media fork.
+ * \since 15.0.0
+ *
+ * Waits for a call to the consumer in progress to return.  Frames still
+ * waiting are dropped, and the consumer is not called again.
+ */
+void ast_media_fork_destroy(struct ast_media_fork *fork);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_MEDIA_FORK_H */
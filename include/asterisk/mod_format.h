@@ -89,9 +89,19 @@ struct ast_format_def {
 	int buf_size;			/*!< size of frame buffer, if any, aligned to 8 bytes. */
 	int desc_size;			/*!< size of private descriptor, if any */
 
+	/*!
+	 * If non-zero, files opened for reading in this format may be mapped
+	 * into memory.  The read, seek and tell callbacks must then use
+	 * ast_filestream_mapped_read(), ast_filestream_mapped_seek() and
+	 * map_pos instead of the FILE whenever map is set.
+	 */
+	int mmap_read;
+
 	struct ast_module *module;
 };
 
+struct prompt_cache_entry;
+
 /*! \brief
  * This structure is allocated by file.c in one chunk,
  * together with buf_size and desc_size bytes of memory
@@ -119,6 +129,18 @@ struct ast_filestream {
 	void *_private;	/*!< pointer to private buffer */
 	const char *orig_chan_name;
 	char *write_buffer;
+	/*! Prompt cache entry the stream is read from, if any */
+	struct prompt_cache_entry *cached_prompt;
+	/*! The file mapped into memory, if the stream reads a mapped file */
+	const char *map;
+	/*! Length of the mapped file */
+	size_t map_len;
+	/*! Read position in the mapped file */
+	size_t map_pos;
+	/*! Frames waiting to be written, if the stream writes behind */
+	struct filestream_write_behind *write_behind;
+	/*! Files to play after this one, if the stream plays a list */
+	struct filestream_sequence *sequence;
 };
 
 /*! 
@@ -139,6 +161,34 @@ int __ast_format_def_register(const struct ast_format_def *f, struct ast_module
  */
 int ast_format_def_unregister(const char *name);
 
+/*!
+ * \brief Read from a stream reading a mapped file
+ *
+ * \since 15.0.0
+ *
+ * The returned data points into the mapped file, so a frame built on it
+ * must not be marked as malloc'd and must not be written to.
+ *
+ * \param s The stream, which must have map set
+ * \param[in,out] len The number of bytes wanted; set to the number available,
+ * which is 0 at the end of the file
+ *
+ * \return The data at the read position, which then advances past it
+ */
+const void *ast_filestream_mapped_read(struct ast_filestream *s, size_t *len);
+
+/*!
+ * \brief Seek in a stream reading a mapped file
+ *
+ * \since 15.0.0
+ *
+ * \param s The stream, which must have map set
+ * \param offset Byte offset from the start of the file, limited to the file
+ *
+ * \retval 0 always
+ */
+int ast_filestream_mapped_seek(struct ast_filestream *s, off_t offset);
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
@@ -197,6 +197,21 @@ int ast_update_module_list_condition(int (*modentry)(const char *module, const c
                                                      void *data, const char *condition),
                                      const char *like, void *data, const char *condition);
 
+/*!
+ * \brief Ask for a list of modules and how long their load functions took.
+ * \param modentry A callback to an updater function
+ * \param data Data passed into the callback for manipulation
+ *
+ * For each of the modules, slowest first, modentry will be executed with the
+ * resource and the microseconds spent in its load function the last time
+ * it was loaded.
+ *
+ * \return the sum of the values returned by modentry
+ * \since 15.0.0
+ */
+int ast_update_module_list_load_times(int (*modentry)(const char *module, int64_t load_time, void *data),
+                                      void *data);
+
 /*!
  * \brief Check if module with the name given is loaded
  * \param name Module name, like "chan_sip.so"
@@ -55,4 +55,17 @@ void ast_multicast_rtp_free_options(struct ast_multicast_rtp_options *mcast_opti
  */
 struct ast_format *ast_multicast_rtp_options_get_format(struct ast_multicast_rtp_options *mcast_options);
 
+/*!
+ * \brief Add a destination to multicast RTP options
+ * Each packet written to the multicast RTP instance is sent to its remote
+ * address and then, unchanged, to every destination added here.  The audio
+ * is encoded once no matter how many destinations there are.
+ * \param mcast_options The options to add the destination to
+ * \param addr The multicast or unicast address to also send to
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_multicast_rtp_options_add_destination(struct ast_multicast_rtp_options *mcast_options,
+	const struct ast_sockaddr *addr);
+
 #endif /* MULTICAST_RTP_H_ */
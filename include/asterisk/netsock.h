@@ -48,6 +48,18 @@ struct ast_netsock *ast_netsock_bind(struct ast_netsock_list *list, struct io_co
 struct ast_netsock *ast_netsock_bindaddr(struct ast_netsock_list *list, struct io_context *ioc,
 					 struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data);
 
+/*!
+ * \brief Bind a socket to an address that other shared sockets are bound to as well
+ *
+ * Every socket bound to the address must be bound with this function.  The
+ * sockets are bound with SO_REUSEPORT, so the kernel spreads the datagrams of
+ * different senders across them.
+ *
+ * \return NULL if the socket could not be bound, or the platform lacks SO_REUSEPORT
+ */
+struct ast_netsock *ast_netsock_bindaddr_shared(struct ast_netsock_list *list, struct io_context *ioc,
+					 struct ast_sockaddr *bindaddr, int tos, int cos, ast_io_cb callback, void *data);
+
 int ast_netsock_release(struct ast_netsock_list *list);
 
 struct ast_netsock *ast_netsock_find(struct ast_netsock_list *list,
@@ -66,6 +66,8 @@ enum ast_option_flags {
 	AST_OPT_FLAG_CACHE_RECORD_FILES = (1 << 13),
 	/*! Display timestamp in CLI verbose output */
 	AST_OPT_FLAG_TIMESTAMP = (1 << 14),
+	/*! Read sound files in raw formats through memory maps */
+	AST_OPT_FLAG_MMAP_SOUND_FILES = (1 << 15),
 	/*! Reconnect */
 	AST_OPT_FLAG_RECONNECT = (1 << 16),
 	/*! Transmit Silence during Record() and DTMF Generation */
@@ -117,6 +119,7 @@ enum ast_option_flags {
 #define ast_opt_dump_core		ast_test_flag(&ast_options, AST_OPT_FLAG_DUMP_CORE)
 #define ast_opt_cache_record_files	ast_test_flag(&ast_options, AST_OPT_FLAG_CACHE_RECORD_FILES)
 #define ast_opt_timestamp		ast_test_flag(&ast_options, AST_OPT_FLAG_TIMESTAMP)
+#define ast_opt_mmap_sound_files	ast_test_flag(&ast_options, AST_OPT_FLAG_MMAP_SOUND_FILES)
 #define ast_opt_reconnect		ast_test_flag(&ast_options, AST_OPT_FLAG_RECONNECT)
 #define ast_opt_transmit_silence	ast_test_flag(&ast_options, AST_OPT_FLAG_TRANSMIT_SILENCE)
 #define ast_opt_dont_warn		ast_test_flag(&ast_options, AST_OPT_FLAG_DONT_WARN)
@@ -146,6 +149,15 @@ enum ast_option_flags {
 /*! Current pjproject logging level */
 extern int ast_option_pjproject_log_level;
 
+/*! Default most memory pjproject caching pools keep for reuse */
+#define DEFAULT_PJ_CACHE_POOL_MAX_CAPACITY	(1024 * 1024)
+
+/*! Non-zero if pjproject caching pools keep released pools for reuse */
+extern int ast_option_pjproject_cache_pools;
+
+/*! Most memory, in bytes, a pjproject caching pool keeps for reuse */
+extern unsigned int ast_option_pjproject_cache_pool_max_capacity;
+
 extern struct ast_flags ast_options;
 
 extern int option_verbose;
@@ -171,6 +183,39 @@ extern int ast_language_is_prefix;
 
 extern unsigned int ast_option_rtpptdynamic;
 
+/*! Maximum number of threads servicing idle bridged channels (0 disables them) */
+extern unsigned int ast_option_bridge_reactors;
+
+/*! Most frames of audio written to a bridged channel at a time */
+extern unsigned int ast_option_bridge_write_batch;
+
+/*! Maximum kilobytes of sound files kept in memory by the prompt cache (0 disables it) */
+extern unsigned int ast_option_prompt_cache_size;
+
+/*! Maximum kilobytes of media kept by the media cache (0 is unlimited) */
+extern unsigned int ast_option_media_cache_size;
+
+/*! Threads starting modules of the same load priority at startup (0 or 1 starts them one by one) */
+extern unsigned int ast_option_load_threads;
+
+/*! Milliseconds queued device state changes wait for more changes of the same devices (0 does not wait) */
+extern unsigned int ast_option_devstate_coalesce;
+
+/*! One in how many media frames read is traced for latency (0 disables tracing) */
+extern unsigned int ast_option_frame_latency_sample;
+
+/*! Most names the DNS cache keeps results for (0 disables the cache) */
+extern unsigned int ast_option_dns_cache_size;
+
+/*! Seconds the DNS cache keeps failed lookups for (0 does not keep them) */
+extern unsigned int ast_option_dns_cache_negative_ttl;
+
+/*! Milliseconds a smart bridge stays on a multimix technology after dropping to two channels (0 switches at once) */
+extern unsigned int ast_option_bridge_tech_hold;
+
+/*! Frames of a recording that may wait to be written, 0 to write them at once */
+extern unsigned int ast_option_file_write_behind;
+
 #if defined(__cplusplus) || defined(c_plusplus)
 }
 #endif
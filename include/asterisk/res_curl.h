@@ -0,0 +1,42 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+#ifndef _ASTERISK_RES_CURL_H
+#define _ASTERISK_RES_CURL_H
+
+/*! \file
+ *
+ * \brief Shared cURL state of res_curl
+ */
+
+#include <curl/curl.h>
+
+/*!
+ * \brief Let a cURL handle use the state shared by all of Asterisk
+ *
+ * The handle then uses the process wide DNS cache, TLS session cache and,
+ * where libcurl supports it, connection cache.  Requests made by short lived
+ * threads can therefore reuse the connections and TLS sessions set up by
+ * earlier requests to the same server.
+ *
+ * \param curl The handle, which must not be in use by another thread
+ *
+ * \retval 0 success
+ * \retval -1 failure, the handle keeps working with its own state
+ */
+int ast_curl_share(CURL *curl);
+
+#endif /* _ASTERISK_RES_CURL_H */
@@ -228,6 +228,18 @@ struct ast_fax_session {
 /* if this overlaps with any AST_FRFLAG_* values, problems will occur */
 #define AST_FAX_FRFLAG_GATEWAY (1 << 13)
 
+/*! \brief Processing time of a FAX session driven by its technology's own threads */
+struct ast_fax_session_timing {
+	/*! Number of 20ms ticks the session was processed in */
+	unsigned long ticks;
+	/*! Average microseconds spent processing a tick */
+	unsigned int avg_cpu_us;
+	/*! Most microseconds spent processing a tick */
+	unsigned int max_cpu_us;
+	/*! Most microseconds a tick was processed late */
+	unsigned int max_late_us;
+};
+
 /*! \brief used to register a FAX technology module with res_fax */
 struct ast_fax_tech {
 	/*! the type of fax session supported with this ast_fax_tech structure */
@@ -271,6 +283,12 @@ struct ast_fax_tech {
 	char * (* const cli_show_stats)(int);
 	/*! displays settings from the fax technology module */
 	char * (* const cli_show_settings)(int);
+	/*!
+	 * \brief gets the processing time of the fax session, optional
+	 * \retval 0 if \c timing was filled in
+	 * \retval -1 if the session is not timed
+	 */
+	int (* const session_timing)(struct ast_fax_session *, struct ast_fax_session_timing *);
 };
 
 /*! \brief register a fax technology */
@@ -118,6 +118,24 @@ int hepv3_send_packet(struct hepv3_capture_info *capture_info);
  */
 enum hep_uuid_type hepv3_get_uuid_type(void);
 
+/*!
+ * \brief Determine whether the packets of a call should be captured
+ *
+ * \since 15.0.0
+ *
+ * Calls are chosen by a hash of their Call-ID, so that either every
+ * packet of a call is captured or none is, in proportion to the
+ * configured sample_percent.  Packet sources should check this before
+ * building a \ref hepv3_capture_info.
+ *
+ * \param call_id The Call-ID of the call, which need not be terminated
+ * \param len     Length of \ref call_id
+ *
+ * \retval 1 The packets of the call should be captured
+ * \retval 0 The packets of the call should not be captured
+ */
+int hepv3_is_call_sampled(const char *call_id, size_t len);
+
 /*!
  * \brief Return whether or not we're currently loaded and active
  *
@@ -42,6 +42,8 @@ enum {
 	RES_ODBC_CONNECTED = (1 << 2),
 };
 
+struct odbc_cached_stmt;
+
 /*! \brief ODBC container */
 struct odbc_obj {
 	SQLHDBC  con;                   /*!< ODBC Connection Handle */
@@ -52,6 +54,10 @@ struct odbc_obj {
 	int lineno;
 #endif
 	AST_LIST_ENTRY(odbc_obj) list;
+	/*! Prepared statements on this connection, most recently used first */
+	AST_LIST_HEAD_NOLOCK(, odbc_cached_stmt) stmt_cache;
+	/*! The number of statements in the cache */
+	unsigned int stmt_cache_count;
 };
 
 /*!\brief These structures are used for adaptive capabilities */
@@ -160,6 +166,34 @@ SQLHSTMT ast_odbc_direct_execute(struct odbc_obj *obj, SQLHSTMT (*exec_cb)(struc
  */
 SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_cb)(struct odbc_obj *obj, void *data), void *data);
 
+/*!
+ * \brief Get a prepared statement handle for the given SQL text.
+ * \param obj The ODBC object
+ * \param sql The SQL text of the statement
+ * \retval a statement handle, prepared but with no parameters bound
+ * \retval NULL on error
+ *
+ * Statements are cached on the connection, keyed by their SQL text, so that
+ * repeated queries do not need to be prepared again.  The number of statements
+ * kept per connection is set by the statement_cache_size option of the class.
+ * The returned handle must be given back with ast_odbc_release_cached().
+ *
+ * \since 15.0.0
+ */
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql);
+
+/*!
+ * \brief Release a statement handle returned by ast_odbc_prepare_cached().
+ * \param obj The ODBC object the statement was prepared on
+ * \param stmt The statement handle
+ *
+ * A cached statement has its cursor closed and its bindings reset so that it
+ * can be reused.  Any other statement handle is freed.
+ *
+ * \since 15.0.0
+ */
+void ast_odbc_release_cached(struct odbc_obj *obj, SQLHSTMT stmt);
+
 /*!
  * \brief Find or create an entry describing the table specified.
  * \param database Name of an ODBC class on which to query the table
@@ -93,4 +93,42 @@ void ast_pjproject_ref(void);
  */
 void ast_pjproject_unref(void);
 
+struct pj_caching_pool;
+struct pj_pool_factory_policy;
+
+/*!
+ * \brief Register the calling thread with pjlib, once.
+ * \since 15.0.0
+ *
+ * The registration is kept in thread-local storage, so after the first
+ * call on a thread this only looks it up.
+ *
+ * \param name Name of the thread for pjlib
+ *
+ * \retval 0 if the thread is registered.
+ * \retval -1 on failure.
+ */
+int ast_pjproject_thread_register(const char *name);
+
+/*!
+ * \brief Initialize a pjproject caching pool as configured in pjproject.conf.
+ * \since 15.0.0
+ *
+ * Released pools are kept for reuse up to the cache_pool_max_capacity
+ * startup option, or not at all when cache_pools is off.  The pool is shown
+ * by "pjproject show pools" until ast_pjproject_caching_pool_destroy().
+ *
+ * \param cp The caching pool
+ * \param name Name shown by "pjproject show pools"
+ * \param policy Pool factory policy, or NULL for the pjlib default
+ */
+void ast_pjproject_caching_pool_init(struct pj_caching_pool *cp, const char *name,
+	const struct pj_pool_factory_policy *policy);
+
+/*!
+ * \brief Destroy a caching pool initialized by ast_pjproject_caching_pool_init().
+ * \since 15.0.0
+ */
+void ast_pjproject_caching_pool_destroy(struct pj_caching_pool *cp);
+
 #endif /* _RES_PJPROJECT_H */
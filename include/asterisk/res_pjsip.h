@@ -112,6 +112,16 @@ struct ast_sip_transport_state {
 	 * \since 13.8.0
 	 */
 	struct ast_sockaddr external_address;
+	/*!
+	 * Additional UDP transports bound to the same address using SO_REUSEPORT
+	 * \since 15.0.0
+	 */
+	struct pjsip_transport **reuseport_transports;
+	/*!
+	 * Number of additional UDP transports
+	 * \since 15.0.0
+	 */
+	unsigned int reuseport_transport_count;
 };
 
 /*
@@ -194,6 +204,27 @@ struct ast_sip_transport {
 	int write_timeout;
 	/*! Allow reload */
 	int allow_reload;
+	/*!
+	 * Number of UDP sockets bound to the address using SO_REUSEPORT
+	 * \since 15.0.0
+	 */
+	unsigned int udp_sockets;
+	/*!
+	 * Seconds an outbound connection may go without a SIP message before
+	 * it is shut down, 0 for no limit
+	 * \since 15.0.0
+	 */
+	unsigned int outbound_max_idle;
+	/*!
+	 * Seconds between keepalives on outbound connections, 0 for the global interval
+	 * \since 15.0.0
+	 */
+	unsigned int outbound_keep_alive_interval;
+	/*!
+	 * Destinations that outbound connections are opened to ahead of use
+	 * \since 15.0.0
+	 */
+	AST_STRING_FIELD_EXTENDED(outbound_prewarm);
 };
 
 #define SIP_SORCERY_DOMAIN_ALIAS_TYPE "domain_alias"
@@ -1103,6 +1134,15 @@ struct ao2_container *ast_sip_location_retrieve_contacts_from_aor_list(const cha
  */
 struct ast_sip_contact *ast_sip_location_retrieve_contact(const char *contact_name);
 
+/*!
+ * \brief Retrieve every dynamic contact which has expired
+ * \since 15.0.0
+ *
+ * \retval NULL on failure
+ * \retval non-NULL container of the expired contacts
+ */
+struct ao2_container *ast_sip_location_retrieve_expired_contacts(void);
+
 /*!
  * \brief Add a new contact to an AOR
  *
@@ -1157,6 +1197,21 @@ int ast_sip_location_add_contact_nolock(struct ast_sip_aor *aor, const char *uri
  */
 int ast_sip_location_update_contact(struct ast_sip_contact *contact);
 
+/*!
+ * \brief Update a contact refreshed by a registration
+ * \since 15.0.0
+ *
+ * \param contact New contact object with details
+ *
+ * Like ast_sip_location_update_contact() but only the expiration_time,
+ * qualify_frequency, authenticate_qualify, path, user_agent and reg_server
+ * fields may have changed, so wizards which support it only persist those.
+ *
+ * \retval -1 failure
+ * \retval 0 success
+ */
+int ast_sip_location_refresh_contact(struct ast_sip_contact *contact);
+
 /*!
 * \brief Delete a contact
 *
@@ -2432,6 +2487,52 @@ int ast_sip_register_supplement(struct ast_sip_supplement *supplement);
  */
 void ast_sip_unregister_supplement(struct ast_sip_supplement *supplement);
 
+/*!
+ * \brief A rewrite of outgoing SIP messages before they are printed
+ * \since 15.0.0
+ *
+ * All rewrites are applied together, from one PJSIP module just above the
+ * transaction layer, and the message is reprinted at most once after them.
+ * A message no rewrite changes keeps the bytes it was already printed to,
+ * as when it is retransmitted.
+ */
+struct ast_sip_tx_rewrite {
+	/*! Name shown in debug output */
+	const char *name;
+	/*! Lower numbers are applied before higher numbers */
+	int priority;
+	/*!
+	 * \brief Rewrite an outgoing request or response.
+	 *
+	 * Called on whichever thread sends the message.  Must not call
+	 * pjsip_tx_data_invalidate_msg(), but report a change instead.
+	 *
+	 * \retval 0 if the message was left as it was.
+	 * \retval non-zero if the message was changed.
+	 */
+	int (*rewrite)(pjsip_tx_data *tdata);
+	/*! Next item in the list */
+	AST_LIST_ENTRY(ast_sip_tx_rewrite) next;
+};
+
+/*!
+ * \brief Register a rewrite of outgoing SIP messages
+ * \since 15.0.0
+ *
+ * \param rewrite The rewrite to register
+ * \retval 0 Success
+ * \retval -1 Failure
+ */
+int ast_sip_register_tx_rewrite(struct ast_sip_tx_rewrite *rewrite);
+
+/*!
+ * \brief Unregister a rewrite of outgoing SIP messages
+ * \since 15.0.0
+ *
+ * \param rewrite The rewrite to unregister
+ */
+void ast_sip_unregister_tx_rewrite(struct ast_sip_tx_rewrite *rewrite);
+
 /*!
  * \brief Retrieve the global MWI taskprocessor high water alert trigger level.
  *
@@ -2458,6 +2559,14 @@ int ast_sip_get_mwi_tps_queue_low(void);
  */
 unsigned int ast_sip_get_mwi_disable_initial_unsolicited(void);
 
+/*!
+ * \brief Retrieve the number of endpoints sent unsolicited MWI per second
+ * \since 15.0.0
+ *
+ * \retval 0 if unsolicited MWI is sent as soon as the mailbox changes
+ */
+unsigned int ast_sip_get_mwi_unsolicited_rate(void);
+
 /*!
  * \brief Retrieve the global setting 'ignore_uri_user_options'.
  * \since 13.12.0
@@ -2654,6 +2763,19 @@ long ast_sip_threadpool_queue_size(void);
  */
 struct ast_sip_transport_state *ast_sip_get_transport_state(const char *transport_id);
 
+/*!
+ * \brief Determine whether a pjsip transport belongs to a transport state
+ * \since 15.0.0
+ *
+ * \param transport_state The transport state
+ * \param transport The pjsip transport
+ *
+ * \retval 1 The pjsip transport is one of the transports of the state
+ * \retval 0 The pjsip transport is not one of the transports of the state
+ */
+int ast_sip_transport_state_has_transport(const struct ast_sip_transport_state *transport_state,
+	const struct pjsip_transport *transport);
+
 /*!
  * \brief Retrieves all transport states
  * \since 13.7.1
@@ -2707,4 +2829,37 @@ void ast_sip_modify_id_header(pj_pool_t *pool, pjsip_fromto_hdr *id_hdr,
 void ast_sip_get_unidentified_request_thresholds(unsigned int *count, unsigned int *period,
 	unsigned int *prune_interval);
 
+/*!
+ * \brief Retrieve the request distributor settings
+ * \since 15.0.0
+ *
+ * \param pool_size The number of serializers requests without a dialog are distributed over
+ * \param queue_high The serializer queue depth at which new requests are rejected, 0 if never
+ */
+void ast_sip_get_distributor_settings(unsigned int *pool_size, unsigned int *queue_high);
+
+/*!
+ * \brief Retrieve the number of seconds an endpoint identification is cached for
+ * \since 15.0.0
+ *
+ * \retval 0 if identifications are not cached
+ */
+unsigned int ast_sip_get_endpoint_identifier_cache_ttl(void);
+
+/*!
+ * \brief Retrieve the number of milliseconds extension state changes are coalesced over
+ * \since 15.0.0
+ *
+ * \retval 0 if every extension state change is notified
+ */
+unsigned int ast_sip_get_exten_state_coalesce_interval(void);
+
+/*!
+ * \brief Retrieve the number of persisted subscriptions recreated per second at startup
+ * \since 15.0.0
+ *
+ * \retval 0 if they are recreated as fast as the serializers keep up
+ */
+unsigned int ast_sip_get_subscription_recreate_rate(void);
+
 #endif /* _RES_PJSIP_H */
@@ -41,6 +41,7 @@ struct pjsip_tx_data;
 struct pjsip_rx_data;
 struct ast_party_id;
 struct pjmedia_sdp_media;
+struct ast_sip_session_supplement_set;
 struct pjmedia_sdp_session;
 struct ast_dsp;
 struct ast_udptl;
@@ -117,8 +118,8 @@ struct ast_sip_session {
 	struct pjsip_inv_session *inv_session;
 	/*! The Asterisk channel associated with the session */
 	struct ast_channel *channel;
-	/*! Registered session supplements */
-	AST_LIST_HEAD(, ast_sip_session_supplement) supplements;
+	/*! Registered session supplements, shared with other sessions and never changed */
+	struct ast_sip_session_supplement_set *supplements;
 	/*! Datastores added to the session by supplements to the session */
 	struct ao2_container *datastores;
 	/*! Media streams */
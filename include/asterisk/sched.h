@@ -145,6 +145,23 @@ extern "C" {
 #define AST_SCHED_REPLACE_UNREF(id, sched, when, callback, data, unrefcall, addfailcall, refcall) \
 	AST_SCHED_REPLACE_VARIABLE_UNREF(id, sched, when, callback, data, 0, unrefcall, addfailcall, refcall)
 
+/*!
+ * \brief How a scheduler context keeps its pending tasks
+ */
+enum ast_sched_backend {
+	/*! A binary heap.  Adding and deleting a task costs O(log n). */
+	AST_SCHED_BACKEND_HEAP = 0,
+	/*!
+	 * \brief A hierarchical timer wheel with millisecond slots
+	 *
+	 * Adding and deleting a task costs O(1), and due tasks are collected a
+	 * slot at a time when the queue is run.  Best for contexts holding many
+	 * timers which are mostly deleted before they expire, such as
+	 * retransmission timers.
+	 */
+	AST_SCHED_BACKEND_WHEEL,
+};
+
 /*!
  * \brief Create a scheduler context
  *
@@ -152,6 +169,16 @@ extern "C" {
  */
 struct ast_sched_context *ast_sched_context_create(void);
 
+/*!
+ * \brief Create a scheduler context using a particular backend
+ * \since 15.0.0
+ *
+ * \param backend How the context keeps its pending tasks
+ *
+ * \return Returns a malloc'd sched_context structure, NULL on failure
+ */
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend);
+
 /*!
  * \brief destroys a schedule context
  *
@@ -30,15 +30,12 @@
 extern "C" {
 #endif
 
-#define AST_SLINFACTORY_MAX_HOLD 1280
-
 struct ast_slinfactory {
-	AST_LIST_HEAD_NOLOCK(, ast_frame) queue; /*!< A list of unaltered frames */
 	struct ast_trans_pvt *trans;             /*!< Translation path that converts fed frames into signed linear */
-	short hold[AST_SLINFACTORY_MAX_HOLD];    /*!< Hold for audio that no longer belongs to a frame (ie: if only some samples were taken from a frame) */
-	short *offset;                           /*!< Offset into the hold where audio begins */
-	size_t holdlen;                          /*!< Number of samples currently in the hold */
-	unsigned int size;                       /*!< Number of samples currently in the factory */
+	short *ring;                             /*!< Ring of samples fed in and not yet read, grown as needed */
+	unsigned int mask;                       /*!< Number of samples the ring holds less one, the ring being a power of two long */
+	unsigned int head;                       /*!< Position in the ring samples are fed in at */
+	unsigned int tail;                       /*!< Position in the ring samples are read from */
 	struct ast_format *format;               /*!< Current format the translation path is converting from */
 	struct ast_format *output_format;        /*!< The output format desired */
 };
@@ -81,7 +78,8 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf);
  * \param sf The slinfactory to feed into
  * \param f Frame containing audio to feed in
  *
- * \return Number of frames currently in factory
+ * \return Number of samples currently in factory
+ * \retval 0 if the audio could not be fed in
  */
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f);
 
@@ -105,6 +103,35 @@ int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples)
  */
 unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf);
 
+/*!
+ * \brief Get samples from the front of a slinfactory without copying them
+ * \since 15.0.0
+ *
+ * \param sf The slinfactory to peek into
+ * \param buf Set to the samples
+ * \param samples Number of samples wanted
+ *
+ * Only samples that are next to each other in the slinfactory are given, so
+ * fewer than wanted may be given even when more are available.  Consume
+ * them with ast_slinfactory_consume() and peek again for the rest.  The
+ * samples are only valid until the slinfactory is next fed, read, consumed
+ * or flushed.
+ *
+ * \return Number of samples given
+ */
+unsigned int ast_slinfactory_peek(const struct ast_slinfactory *sf, const short **buf, size_t samples);
+
+/*!
+ * \brief Drop samples from the front of a slinfactory
+ * \since 15.0.0
+ *
+ * \param sf The slinfactory to drop samples from
+ * \param samples Number of samples to drop, usually as given by ast_slinfactory_peek()
+ *
+ * \return Nothing
+ */
+void ast_slinfactory_consume(struct ast_slinfactory *sf, size_t samples);
+
 /*!
  * \brief Flush the contents of a slinfactory
  *
@@ -315,6 +315,37 @@ struct ast_sorcery_wizard {
 
 	/* \brief Callback for whether or not the wizard believes the object is stale */
 	int (*is_stale)(const struct ast_sorcery *sorcery, void *data, void *object);
+
+	/*! \brief Optional callback for whether a caching wizard knows that no object exists with an id */
+	int (*is_missing)(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
+
+	/*! \brief Optional callback for a caching wizard to remember that no object exists with an id */
+	void (*cache_missing)(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
+
+	/*!
+	 * \brief Optional callback for a caching wizard to remember the objects retrieved by fields or a regex
+	 *
+	 * \note The regex is NULL when the objects were retrieved by fields, and fields may be NULL when all
+	 * objects were retrieved.
+	 */
+	void (*cache_multiple)(const struct ast_sorcery *sorcery, void *data, const char *type,
+		struct ao2_container *objects, const struct ast_variable *fields, const char *regex);
+
+	/*!
+	 * \brief Optional callback for creating multiple objects of the same type at once
+	 *
+	 * \note Either every object is created and 0 is returned, or none of them are.
+	 */
+	int (*create_multiple)(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects);
+
+	/*!
+	 * \brief Optional callback for updating only the fields of an object that changed
+	 *
+	 * \note The object is the complete updated object, and fields holds the new values
+	 * of the fields that changed.  If not provided the update callback is used instead.
+	 */
+	int (*update_fields)(const struct ast_sorcery *sorcery, void *data, void *object,
+		const struct ast_variable *fields);
 };
 
 /*! \brief Interface for a sorcery object type observer */
@@ -330,6 +361,13 @@ struct ast_sorcery_observer {
 
 	/*! \brief Callback for when an object type is loaded/reloaded */
 	void (*loaded)(const char *object_type);
+
+	/*!
+	 * \brief Optional callback for when multiple objects are created at once
+	 *
+	 * \note If not provided the created callback is invoked for each object instead.
+	 */
+	void (*created_multiple)(struct ao2_container *objects);
 };
 
 /*! \brief Opaque structure for internal sorcery object */
@@ -1160,6 +1198,33 @@ int ast_sorcery_observer_add(const struct ast_sorcery *sorcery, const char *type
  */
 void ast_sorcery_observer_remove(const struct ast_sorcery *sorcery, const char *type, const struct ast_sorcery_observer *callbacks);
 
+/*!
+ * \brief Notify observers that a wizard created an object on its own
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param object Pointer to the object that was created
+ *
+ * \note This is for wizards that discover changes themselves, such as on reload,
+ *       rather than through \ref ast_sorcery_create.
+ */
+void ast_sorcery_notify_created(const struct ast_sorcery *sorcery, void *object);
+
+/*!
+ * \brief Notify observers that a wizard updated an object on its own
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param object Pointer to the new version of the object
+ */
+void ast_sorcery_notify_updated(const struct ast_sorcery *sorcery, void *object);
+
+/*!
+ * \brief Notify observers that a wizard deleted an object on its own
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param object Pointer to the object that was deleted
+ */
+void ast_sorcery_notify_deleted(const struct ast_sorcery *sorcery, void *object);
+
 /*!
  * \brief Create and potentially persist an object using an available wizard
  *
@@ -1171,6 +1236,21 @@ void ast_sorcery_observer_remove(const struct ast_sorcery *sorcery, const char *
  */
 int ast_sorcery_create(const struct ast_sorcery *sorcery, void *object);
 
+/*!
+ * \brief Create and potentially persist multiple objects of the same type at once
+ * \since 15.0.0
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param objects Container of sorcery objects, all of the same type
+ *
+ * Wizards which support it create all of the objects in one operation,
+ * and observers are notified once with the objects that were created.
+ *
+ * \retval 0 success, every object was created
+ * \retval -1 failure, some or all of the objects were not created
+ */
+int ast_sorcery_create_multiple(const struct ast_sorcery *sorcery, struct ao2_container *objects);
+
 /*!
  * \brief Retrieve an object using its unique identifier
  *
@@ -1251,6 +1331,22 @@ struct ao2_container *ast_sorcery_retrieve_by_regex(const struct ast_sorcery *so
  */
 int ast_sorcery_update(const struct ast_sorcery *sorcery, void *object);
 
+/*!
+ * \brief Update an object of which only some fields changed
+ * \since 15.0.0
+ *
+ * \param sorcery Pointer to a sorcery structure
+ * \param object Pointer to a sorcery object
+ * \param ... Names of the fields that changed, terminated by SENTINEL
+ *
+ * Wizards which implement update_fields only persist the fields that
+ * changed, the others persist the whole object as ast_sorcery_update() does.
+ *
+ * \retval 0 success
+ * \retval -1 failure
+ */
+int ast_sorcery_update_fields(const struct ast_sorcery *sorcery, void *object, ...) attribute_sentinel;
+
 /*!
  * \brief Delete an object
  *
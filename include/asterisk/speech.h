@@ -67,6 +67,8 @@ struct ast_speech {
 	enum ast_speech_results_type results_type;
 	/*! Pointer to the engine used by this speech structure */
 	struct ast_speech_engine *engine;
+	/*! Hands audio to an engine that writes on its own thread */
+	struct ast_media_fork *fork;
 };
   
 /* Speech recognition engine structure */
@@ -101,6 +103,13 @@ struct ast_speech_engine {
 	struct ast_speech_result *(*get)(struct ast_speech *speech);
 	/*! Accepted formats by the engine */
 	struct ast_format_cap *formats;
+	/*!
+	 * \brief Set if write may be called on a thread other than the channel's,
+	 * without the speech lock held, for audio to be handed to it through a
+	 * media fork rather than the channel waiting for each write.
+	 * \since 15.0.0
+	 */
+	unsigned int async_write;
 	AST_LIST_ENTRY(ast_speech_engine) list;
 };
 
@@ -318,6 +318,18 @@ enum stasis_message_type_result stasis_message_type_create(const char *name,
  */
 const char *stasis_message_type_name(const struct stasis_message_type *type);
 
+/*!
+ * \brief Gets the identifier of a given message type
+ *
+ * Identifiers are small integers handed out in order as types are created,
+ * so they can index tables of per type data.
+ *
+ * \param type The type to get.
+ * \return Identifier of the type.
+ * \since 15.0.0
+ */
+int stasis_message_type_id(const struct stasis_message_type *type);
+
 /*!
  * \brief Check whether a message type is declined
  *
@@ -414,6 +426,9 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
  * May return \c NULL, to indicate no representation. The returned object should
  * be ast_json_unref()'ed.
  *
+ * The representation is rendered once per message and sanitizer.  Every
+ * call returns a copy the caller may modify.
+ *
  * \param msg Message to convert to JSON string.
  * \param sanitize Snapshot sanitization callback.
  *
@@ -429,6 +444,8 @@ struct ast_json *stasis_message_to_json(struct stasis_message *msg, struct stasi
  * May return \c NULL, to indicate no representation. The returned object should
  * be ao2_cleanup()'ed.
  *
+ * The representation is rendered once per message and shared by every caller.
+ *
  * \param msg Message to convert to AMI.
  * \return \c NULL on error.
  * \return \c NULL if AMI format is not supported.
@@ -575,6 +592,67 @@ struct stasis_subscription *stasis_subscribe(struct stasis_topic *topic,
 struct stasis_subscription *stasis_subscribe_pool(struct stasis_topic *topic,
 	stasis_subscription_cb callback, void *data);
 
+/*!
+ * \brief Stasis subscription message filters
+ */
+enum stasis_subscription_message_filter {
+	STASIS_SUBSCRIPTION_FILTER_NONE = 0,	/*!< No filter is in place, all messages are delivered */
+	STASIS_SUBSCRIPTION_FILTER_FORCED_NONE,	/*!< No filter is in place or can be set */
+	STASIS_SUBSCRIPTION_FILTER_SELECTIVE,	/*!< Only accepted message types are delivered */
+};
+
+/*!
+ * \brief Indicate to a subscription that we are interested in a message type.
+ *
+ * This adds the message type to the set of types the subscription accepts.
+ * The set only takes effect once the subscription's filter is switched to
+ * \ref STASIS_SUBSCRIPTION_FILTER_SELECTIVE with stasis_subscription_set_filter().
+ *
+ * \param subscription Subscription to add the message type to.
+ * \param type The message type we wish to be interested in.
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ *
+ * \since 15.0.0
+ */
+int stasis_subscription_accept_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type);
+
+/*!
+ * \brief Indicate to a subscription that we are not interested in a message type.
+ *
+ * \param subscription Subscription to remove the message type from.
+ * \param type The message type we don't wish to be interested in.
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ *
+ * \since 15.0.0
+ */
+int stasis_subscription_decline_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type);
+
+/*!
+ * \brief Set the message type filtering level on a subscription
+ *
+ * With \ref STASIS_SUBSCRIPTION_FILTER_SELECTIVE, messages whose type has not
+ * been accepted are dropped by the publisher before they are queued to the
+ * subscription.  The final message of the subscription is always delivered.
+ * Once \ref STASIS_SUBSCRIPTION_FILTER_FORCED_NONE is set the filter can no
+ * longer be changed.
+ *
+ * \param subscription Subscription that should receive all messages.
+ * \param filter What filter to use
+ *
+ * \retval 0 on success
+ * \retval -1 failure
+ *
+ * \since 15.0.0
+ */
+int stasis_subscription_set_filter(struct stasis_subscription *subscription,
+	enum stasis_subscription_message_filter filter);
+
 /*!
  * \brief Cancel a subscription.
  *
@@ -604,6 +682,42 @@ struct stasis_subscription *stasis_unsubscribe(
 int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscription,
 	long low_water, long high_water);
 
+/*!
+ * \brief What happens to messages published while a subscription is congested.
+ * \since 15.0.0
+ */
+enum stasis_subscription_congestion_policy {
+	/*! Messages queue without bound. (default) */
+	STASIS_SUBSCRIPTION_CONGESTION_QUEUE = 0,
+	/*! Publishers wait for the subscription to catch up. */
+	STASIS_SUBSCRIPTION_CONGESTION_BLOCK,
+	/*! New messages are dropped. */
+	STASIS_SUBSCRIPTION_CONGESTION_DROP_NEWEST,
+	/*! The oldest queued message is dropped to make room for the new one. */
+	STASIS_SUBSCRIPTION_CONGESTION_DROP_OLDEST,
+};
+
+/*!
+ * \brief Set what happens to messages published while the subscription is congested.
+ * \since 15.0.0
+ *
+ * The subscription is congested once its queue reaches the high water
+ * mark set by stasis_subscription_set_congestion_limits().  Dropping is
+ * meant for subscribers that can tolerate gaps, such as monitoring
+ * consumers.  The final message of the subscription is never dropped.
+ *
+ * \param subscription Pointer to a stasis subscription
+ * \param policy New congestion policy.
+ * \param max_wait_ms With STASIS_SUBSCRIPTION_CONGESTION_BLOCK, the longest
+ * a publisher waits before queueing its message anyway.  0 to wait until the
+ * subscription catches up.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error (the subscription has no queue).
+ */
+int stasis_subscription_set_congestion_policy(struct stasis_subscription *subscription,
+	enum stasis_subscription_congestion_policy policy, unsigned int max_wait_ms);
+
 /*!
  * \brief Block until the last message is processed on a subscription.
  *
@@ -1107,6 +1221,61 @@ struct ao2_container *stasis_cache_dump_by_eid(struct stasis_cache *cache, struc
  */
 struct ao2_container *stasis_cache_dump_all(struct stasis_cache *cache, struct stasis_message_type *type);
 
+/*!
+ * \brief An immutable set of snapshots from a cache.
+ *
+ * Unlike a dump, the set is not copied for each caller.  It is built the
+ * first time it is asked for after snapshots of its type changed, and then
+ * shared until they change again.  It always reflects the cache at one
+ * point in time.
+ */
+struct stasis_cache_snapshots;
+
+/*!
+ * \brief Get the cached snapshots of a type for a specific entity.
+ * \since 15.0.0
+ *
+ * \param cache The cache to query.
+ * \param type Type of message to get.  Must not be \c NULL.
+ * \param eid Specific entity id to retrieve.  NULL for aggregate.
+ *
+ * \retval Snapshots (must be unreffed by caller)
+ * \retval \c NULL on allocation error
+ */
+struct stasis_cache_snapshots *stasis_cache_snapshots_by_eid(struct stasis_cache *cache, struct stasis_message_type *type, const struct ast_eid *eid);
+
+/*!
+ * \brief Get the cached snapshots of a type from the local entity.
+ * \since 15.0.0
+ *
+ * \param cache The cache to query.
+ * \param type Type of message to get.  Must not be \c NULL.
+ *
+ * \retval Snapshots (must be unreffed by caller)
+ * \retval \c NULL on allocation error
+ */
+struct stasis_cache_snapshots *stasis_cache_snapshots(struct stasis_cache *cache, struct stasis_message_type *type);
+
+/*!
+ * \brief Get the number of snapshots in a set.
+ * \since 15.0.0
+ */
+size_t stasis_cache_snapshots_count(const struct stasis_cache_snapshots *snapshots);
+
+/*!
+ * \brief Get a snapshot from a set.
+ * \since 15.0.0
+ *
+ * \param snapshots The set of snapshots.
+ * \param idx Index of the snapshot, less than stasis_cache_snapshots_count().
+ *
+ * \note The snapshot is only guaranteed to exist while the set does.
+ *
+ * \retval The snapshot.
+ * \retval \c NULL if \c idx is out of range.
+ */
+struct stasis_message *stasis_cache_snapshots_get(const struct stasis_cache_snapshots *snapshots, size_t idx);
+
 /*! \addtogroup StasisTopicsAndMessages
  * @{
  */
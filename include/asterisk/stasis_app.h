@@ -321,6 +321,35 @@ enum stasis_app_subscribe_res stasis_app_unsubscribe(const char *app_name,
 	const char **event_source_uris, int event_sources_count,
 	struct ast_json **json);
 
+/*! \brief Return code for stasis_app_event_filter_set */
+enum stasis_app_event_filter_res {
+	STASIS_AEF_OK,
+	STASIS_AEF_APP_NOT_FOUND,
+	STASIS_AEF_INVALID,
+	STASIS_AEF_INTERNAL_ERROR,
+};
+
+/*!
+ * \brief Set the event types an application is sent.
+ * \since 15.0.0
+ *
+ * An event the application is not sent is dropped before it is converted to
+ * JSON when its type is known up front, and otherwise before it is sent.
+ *
+ * \param app_name Name of the application.
+ * \param filter Object with optional "allowed" and "disallowed" arrays of
+ *        objects, each naming an event type such as
+ *        { "type": "ChannelVarset" }.  Only the allowed types are sent when
+ *        there are any, and never the disallowed ones.  Replaces the filter
+ *        the application had; \c NULL or an empty object sends every event.
+ * \param json Optional output pointer for JSON representation of the app
+ *             after setting the filter.
+ *
+ * \return \ref stasis_app_event_filter_res return code.
+ */
+enum stasis_app_event_filter_res stasis_app_event_filter_set(const char *app_name,
+	struct ast_json *filter, struct ast_json **json);
+
 /*!
  * \brief Directly subscribe an application to a channel
  *
@@ -470,6 +499,17 @@ void stasis_app_control_flush_queue(struct stasis_app_control *control);
 const char *stasis_app_control_get_channel_id(
 	const struct stasis_app_control *control);
 
+/*!
+ * \brief Returns the name of the application controlling the channel of this control
+ *
+ * \param control Control object.
+ *
+ * \return Name of the application.
+ * \return \c NULL if the control has no application.
+ */
+const char *stasis_app_control_get_app_name(
+	const struct stasis_app_control *control);
+
 /*!
  * \brief Apply a bridge role to a channel controlled by a stasis app control
  *
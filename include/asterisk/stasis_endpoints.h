@@ -37,6 +37,24 @@
  * @{
  */
 
+/*! \brief The channels on an endpoint, shared by the endpoint and its snapshots */
+struct ast_endpoint_channels;
+
+/*!
+ * \brief The ids of the channels on an endpoint.
+ *
+ * Never changed once handed out, so it may be shared by everyone asking for
+ * the channels of an endpoint until they change.
+ *
+ * \since 15.0.0
+ */
+struct ast_endpoint_channel_ids {
+	/*! Number of channel ids */
+	int num_channels;
+	/*! Channel ids */
+	char *channel_ids[];
+};
+
 /*!
  * \brief A snapshot of an endpoint's state.
  *
@@ -60,10 +78,10 @@ struct ast_endpoint_snapshot {
 	 * for an endpoint is unknown, this field is set to -1.
 	 */
 	int max_channels;
-	/*! Number of channels currently active on this endpoint */
+	/*! Number of channels active on this endpoint when the snapshot was taken */
 	int num_channels;
-	/*! Channel ids */
-	char *channel_ids[];
+	/*! Channels of the endpoint, see ast_endpoint_snapshot_channel_ids() */
+	struct ast_endpoint_channels *channels;
 };
 
 /*!
@@ -140,6 +158,23 @@ struct stasis_message_type *ast_endpoint_snapshot_type(void);
 struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	struct ast_endpoint *endpoint);
 
+/*!
+ * \brief Get the ids of the channels on the endpoint of a snapshot.
+ * \since 15.0.0
+ *
+ * Snapshots only carry the number of channels, so that adding or removing
+ * a channel does not copy the ids of all the others.  The ids are those of
+ * the channels on the endpoint now, which may differ from
+ * \ref ast_endpoint_snapshot.num_channels if channels came or went since the
+ * snapshot was taken.
+ *
+ * \param snapshot Snapshot of the endpoint.
+ * \return Channel ids, which must be released with ao2_ref().
+ * \return \c NULL on error.
+ */
+struct ast_endpoint_channel_ids *ast_endpoint_snapshot_channel_ids(
+	const struct ast_endpoint_snapshot *snapshot);
+
 /*!
  * \brief Returns the topic for a specific endpoint.
  *
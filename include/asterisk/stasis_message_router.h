@@ -140,6 +140,22 @@ void stasis_message_router_publish_sync(struct stasis_message_router *router,
 int stasis_message_router_set_congestion_limits(struct stasis_message_router *router,
 	long low_water, long high_water);
 
+/*!
+ * \brief Set what happens to messages published while the router is congested.
+ * \since 15.0.0
+ *
+ * See stasis_subscription_set_congestion_policy().
+ *
+ * \param router Pointer to a stasis message router
+ * \param policy New congestion policy.
+ * \param max_wait_ms Longest a blocked publisher waits, 0 for no limit.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int stasis_message_router_set_congestion_policy(struct stasis_message_router *router,
+	enum stasis_subscription_congestion_policy policy, unsigned int max_wait_ms);
+
 /*!
  * \brief Add a route to a message router.
  *
@@ -225,6 +241,10 @@ void stasis_message_router_remove_cache_update(
 /*!
  * \brief Sets the default route of a router.
  *
+ * A router without a default route only receives the message types it has
+ * routes for; the rest are dropped before they are queued to it.  Once a
+ * default route is set, every message published to the topic is delivered.
+ *
  * \param router Router to set the default route of.
  * \param callback Callback to forard messages which otherwise have no home.
  * \param data Data pointer to pass to \a callback.
@@ -199,6 +199,8 @@ typedef uint16_t ast_string_field_allocation;
 */
 extern const char *__ast_string_field_empty;
 
+struct ast_arena;
+
 /*!
   \internal
   \brief Structure used to hold a pool of space for string fields
@@ -207,6 +209,7 @@ extern const char *__ast_string_field_empty;
 */
 struct ast_string_field_pool {
 	struct ast_string_field_pool *prev;	/*!< pointer to the previous pool, if any */
+	struct ast_arena *arena;		/*!< arena the pool was carved from, if any */
 	size_t size;				/*!< the total size of the pool */
 	size_t used;				/*!< the space used in the pool */
 	size_t active;				/*!< the amount of space actively in use by fields */
@@ -228,6 +231,7 @@ struct ast_string_field_mgr {
 	ast_string_field last_alloc;			/*!< the last field allocated */
 	struct ast_string_field_pool *embedded_pool;	/*!< pointer to the embedded pool, if any */
 	struct ast_string_field_vector string_fields;	/*!< field vector for compare and copy */
+	struct ast_arena *arena;			/*!< arena to carve pools from, if any */
 #if defined(__AST_DEBUG_MALLOC)
 	const char *owner_file;				/*!< filename of owner */
 	const char *owner_func;				/*!< function name of owner */
@@ -362,6 +366,30 @@ enum ast_stringfield_cleanup_type {
 	__res__ ; \
 })
 
+/*!
+ * \brief Initialize a field pool carving its pools from an arena
+ * \since 15.0.0
+ *
+ * \param x Pointer to a structure containing fields
+ * \param size Amount of storage to allocate.
+ * \param arena Arena to carve the pools from.  It must outlive the structure.
+ *
+ * \note The structure's fields must still be freed with
+ * ast_string_field_free_memory() before it is destroyed.  The pools go
+ * back to the arena for reuse rather than to the system.
+ *
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+#define ast_string_field_init_arena(x, size, arena) \
+({ \
+	int __res__ = -1; \
+	if (((void *)(x)) != NULL) { \
+		__res__ = __ast_string_field_init_arena(&(x)->__field_mgr, &(x)->__field_mgr_pool, size, arena, __FILE__, __LINE__, __PRETTY_FUNCTION__); \
+	} \
+	__res__ ; \
+})
+
 /*!
  * \brief free all memory - to be called before destroying the object
  *
@@ -413,6 +441,13 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 int __ast_string_field_init(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head,
 			    int needed, const char *file, int lineno, const char *func);
 
+/*!
+ * \internal
+ * \brief internal version of ast_string_field_init_arena
+ */
+int __ast_string_field_init_arena(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head,
+			    int needed, struct ast_arena *arena, const char *file, int lineno, const char *func);
+
 /*!
  * \brief Allocate a structure with embedded stringfields in a single allocation
  * \param n Current imlementation only allows 1 structure to be allocated
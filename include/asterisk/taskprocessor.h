@@ -241,6 +241,78 @@ struct ast_taskprocessor_local {
 int ast_taskprocessor_push_local(struct ast_taskprocessor *tps,
 	int (*task_exe)(struct ast_taskprocessor_local *local), void *datap);
 
+/*!
+ * \brief Push a task that may be dropped while the queue is congested.
+ * \since 15.0.0
+ *
+ * Behaves like ast_taskprocessor_push() unless the taskprocessor's
+ * overload policy is to drop tasks.  A dropped task is never executed;
+ * \a release is called with its \a datap instead.
+ *
+ * \param tps The taskprocessor structure
+ * \param task_exe The task handling function to push into the taskprocessor queue
+ * \param datap The data to be used by the task handling function
+ * \param release Function to release \a datap if the task is dropped.
+ * \retval 0 success, including when the task was dropped
+ * \retval -1 failure
+ */
+int ast_taskprocessor_push_droppable(struct ast_taskprocessor *tps,
+	int (*task_exe)(void *datap), void *datap, void (*release)(void *datap));
+
+/*!
+ * \brief Push a task with local data that may be dropped while the queue is congested.
+ * \since 15.0.0
+ *
+ * See ast_taskprocessor_push_local() and ast_taskprocessor_push_droppable().
+ *
+ * \param tps The taskprocessor structure
+ * \param task_exe The task handling function to push into the taskprocessor queue
+ * \param datap The data to be used by the task handling function
+ * \param release Function to release \a datap if the task is dropped.
+ * \retval 0 success, including when the task was dropped
+ * \retval -1 failure
+ */
+int ast_taskprocessor_push_local_droppable(struct ast_taskprocessor *tps,
+	int (*task_exe)(struct ast_taskprocessor_local *local), void *datap,
+	void (*release)(void *datap));
+
+/*!
+ * \brief What a taskprocessor does with pushes once its queue reaches
+ * the high water mark.
+ * \since 15.0.0
+ */
+enum ast_taskprocessor_overload_policy {
+	/*! The queue grows without bound. (default) */
+	AST_TASKPROCESSOR_OVERLOAD_NONE = 0,
+	/*! Pushers wait for the queue to drain below its low water mark. */
+	AST_TASKPROCESSOR_OVERLOAD_BLOCK,
+	/*! New droppable tasks are dropped. */
+	AST_TASKPROCESSOR_OVERLOAD_DROP_NEWEST,
+	/*! The oldest queued droppable task is dropped to make room for the new one. */
+	AST_TASKPROCESSOR_OVERLOAD_DROP_OLDEST,
+};
+
+/*!
+ * \brief Set what the taskprocessor does with pushes while its queue is congested.
+ * \since 15.0.0
+ *
+ * The queue is congested once it reaches the high water mark set by
+ * ast_taskprocessor_alert_set_levels().  Only tasks pushed with
+ * ast_taskprocessor_push_droppable() or ast_taskprocessor_push_local_droppable()
+ * are ever dropped.  A task pushed by the taskprocessor's own thread
+ * never blocks.
+ *
+ * \param tps Taskprocessor to update.
+ * \param policy New overload policy.
+ * \param max_wait_ms With AST_TASKPROCESSOR_OVERLOAD_BLOCK, the longest a
+ * pusher waits before queueing its task anyway.  0 to wait until the queue drains.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int ast_taskprocessor_overload_policy_set(struct ast_taskprocessor *tps,
+	enum ast_taskprocessor_overload_policy policy, unsigned int max_wait_ms);
+
 /*!
  * \brief Indicate the taskprocessor is suspended.
  *
@@ -284,6 +356,22 @@ int ast_taskprocessor_is_suspended(struct ast_taskprocessor *tps);
  */
 int ast_taskprocessor_execute(struct ast_taskprocessor *tps);
 
+/*!
+ * \brief Pop tasks off the taskprocessor and execute them.
+ *
+ * \since 15.0.0
+ *
+ * Behaves like calling ast_taskprocessor_execute() until the queue is
+ * empty or \a max_tasks have been executed, but the taskprocessor lock
+ * is only taken once between tasks.
+ *
+ * \param tps The taskprocessor from which to execute.
+ * \param max_tasks The most tasks to execute, 0 for no limit.
+ * \retval 0 There is no further work to be done.
+ * \retval 1 Tasks still remain in the taskprocessor queue.
+ */
+int ast_taskprocessor_execute_batch(struct ast_taskprocessor *tps, unsigned int max_tasks);
+
 /*!
  * \brief Am I the given taskprocessor's current task.
  * \since 12.7.0
@@ -352,4 +440,61 @@ unsigned int ast_taskprocessor_alert_get(void);
  */
 int ast_taskprocessor_alert_set_levels(struct ast_taskprocessor *tps, long low_water, long high_water);
 
+/*! Number of buckets in the taskprocessor latency histograms. */
+#define AST_TASKPROCESSOR_LATENCY_BUCKETS 6
+
+/*!
+ * \brief Latency statistics of a taskprocessor.
+ * \since 15.0.0
+ *
+ * The histograms count tasks that took less than 100us, 1ms, 10ms,
+ * 100ms, 1s, and the rest.
+ */
+struct ast_taskprocessor_latency {
+	/*! Tasks executed */
+	unsigned long processed;
+	/*! Tasks currently queued */
+	long queued;
+	/*! Most tasks queued at any one time */
+	unsigned long max_qsize;
+	/*! Tasks dropped by the overload policy */
+	unsigned long dropped;
+	/*! Time tasks waited in the queue before executing */
+	unsigned long wait_histogram[AST_TASKPROCESSOR_LATENCY_BUCKETS];
+	/*! Time tasks took to execute */
+	unsigned long exec_histogram[AST_TASKPROCESSOR_LATENCY_BUCKETS];
+	/*! Total microseconds tasks waited in the queue */
+	uint64_t wait_total_us;
+	/*! Total microseconds tasks took to execute */
+	uint64_t exec_total_us;
+	/*! Longest a task waited in the queue in microseconds */
+	unsigned long wait_max_us;
+	/*! Longest a task took to execute in microseconds */
+	unsigned long exec_max_us;
+};
+
+/*!
+ * \brief Get the label of a latency histogram bucket.
+ * \since 15.0.0
+ *
+ * \param bucket Bucket index, less than AST_TASKPROCESSOR_LATENCY_BUCKETS.
+ *
+ * \return Label such as "lt_100us", suitable for a header or metric name.
+ */
+const char *ast_taskprocessor_latency_bucket_label(unsigned int bucket);
+
+/*!
+ * \brief Call a function with the latency statistics of every taskprocessor.
+ * \since 15.0.0
+ *
+ * \param cb Function to call, in taskprocessor name order.  Returning
+ * non-zero stops the iteration.
+ * \param arg Passed to \a cb.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+int ast_taskprocessor_latency_foreach(int (*cb)(const char *name,
+	const struct ast_taskprocessor_latency *latency, void *arg), void *arg);
+
 #endif /* __AST_TASKPROCESSOR_H__ */
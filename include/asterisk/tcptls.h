@@ -59,6 +59,8 @@
 #include "asterisk/utils.h"
 #include "asterisk/iostream.h"
 
+struct ast_threadpool;
+
 /*! SSL support */
 #define AST_CERTFILE "asterisk.pem"
 
@@ -83,6 +85,10 @@ enum ast_ssl_flags {
 	AST_SSL_DISABLE_TLSV11 = (1 << 8),
 	/*! Disable TLSv1.2 support */
 	AST_SSL_DISABLE_TLSV12 = (1 << 9),
+	/*! Don't keep a server side cache of sessions to resume */
+	AST_SSL_NO_SESSION_CACHE = (1 << 10),
+	/*! Don't issue or accept session tickets */
+	AST_SSL_NO_SESSION_TICKETS = (1 << 11),
 };
 
 struct ast_tls_config {
@@ -97,6 +103,26 @@ struct ast_tls_config {
 	char certhash[41];
 	char pvthash[41];
 	char cahash[41];
+	/*! Most sessions the server cache holds, 0 for the OpenSSL default */
+	int session_cache_size;
+	/*! Seconds a session can be resumed for, 0 for the OpenSSL default */
+	int session_timeout;
+};
+
+/*! \brief TLS handshake counters of a server or client */
+struct ast_tls_handshake_stats {
+	/*! Handshakes completed */
+	unsigned long completed;
+	/*! Handshakes completed by resuming an earlier session */
+	unsigned long resumed;
+	/*! Handshakes that failed, including certificate verification */
+	unsigned long failed;
+	/*! Connections closed unanswered because too many handshakes were waiting */
+	unsigned long dropped;
+	/*! Microseconds spent in completed handshakes */
+	unsigned long total_usec;
+	/*! Longest completed handshake in microseconds */
+	unsigned long max_usec;
 };
 
 /*! \page AstTlsOverview TLS Implementation Overview
@@ -122,6 +148,12 @@ struct ast_tls_config {
  * We have both because we want to support plain and SSL sockets, and
  * going through a FILE * lets us provide the encryption/decryption
  * on the stream without using an auxiliary thread.
+ *
+ * The TLS handshake of an accepted connection is done before worker_fn()
+ * is started, by a pool shared by all servers with a thread per processor.
+ * Clients reconnecting all at once then wait their turn for the CPU rather
+ * than each getting a thread, and once too many are waiting, further
+ * connections are closed right away so that they retry later.
  */
 
 /*! \brief
@@ -142,6 +174,10 @@ struct ast_tcptls_session_args {
 	void *(*worker_fn)(void *); /*!< the function in charge of doing the actual work */
 	const char *name;
 	struct ast_tls_config *old_tls_cfg; /*!< copy of the SSL configuration to determine whether changes have been made */
+	/*! If set, accepted connections are handled by this pool rather than by a new thread each */
+	struct ast_threadpool *pool;
+	/*! TLS handshakes of this server or client */
+	struct ast_tls_handshake_stats tls_stats;
 };
 
 /*! \brief
@@ -213,6 +249,15 @@ int ast_ssl_setup(struct ast_tls_config *cfg);
  */
 void ast_ssl_teardown(struct ast_tls_config *cfg);
 
+/*!
+ * \brief Get the TLS handshake counters of a server or client.
+ * \since 15.0.0
+ *
+ * \param desc The server or client
+ * \param stats Filled in with the counters
+ */
+void ast_tcptls_handshake_stats(const struct ast_tcptls_session_args *desc, struct ast_tls_handshake_stats *stats);
+
 /*!
  * \brief Used to parse conf files containing tls/ssl options.
  */
@@ -0,0 +1,94 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Processor and NUMA node placement of threads
+ *
+ * The [threads] section of asterisk.conf gives the processors that the
+ * threads of each role may run on.  With numa_local set, the threads that
+ * work on the same bridge are also kept on the NUMA node the bridge was
+ * created on, so the media they share stays in that node's memory.
+ *
+ * Placement is only supported on Linux.  Elsewhere the functions do
+ * nothing.
+ */
+
+#ifndef _ASTERISK_THREAD_PLACEMENT_H
+#define _ASTERISK_THREAD_PLACEMENT_H
+
+#if defined(__cplusplus) || defined(c_plusplus)
+extern "C" {
+#endif
+
+/*! \brief What a placed thread does */
+enum ast_thread_role {
+	/*! Mixes the audio of a bridge, such as softmix */
+	AST_THREAD_ROLE_MIXING,
+	/*! Services the channels in a bridge */
+	AST_THREAD_ROLE_BRIDGE,
+	/*! Runs taskprocessor and threadpool tasks */
+	AST_THREAD_ROLE_TASKPROCESSOR,
+	/*! Reads and sends RTP for other threads */
+	AST_THREAD_ROLE_RTP,
+	/*! Number of roles, not a role */
+	AST_THREAD_ROLE_MAX,
+};
+
+/*!
+ * \brief Get the NUMA node to keep a group of threads on.
+ * \since 15.0.0
+ *
+ * Meant to be called when the object the threads work on is created, so
+ * that its memory and its threads are on the same node.
+ *
+ * \retval node The caller is running on.
+ * \retval -1 numa_local is not set or the node is not known.
+ */
+int ast_thread_placement_node(void);
+
+/*!
+ * \brief Move the calling thread to the processors of its role.
+ * \since 15.0.0
+ *
+ * \param role What the thread does.
+ * \param node NUMA node to keep the thread on, from
+ *   ast_thread_placement_node().  -1 for any node.
+ *
+ * The placement is shown by "core show threads".
+ *
+ * \retval 0 The thread was placed.
+ * \retval -1 Nothing is configured for the role, or placing failed.
+ */
+int ast_thread_place(enum ast_thread_role role, int node);
+
+/*!
+ * \brief Let the calling thread run on any processor again.
+ * \since 15.0.0
+ *
+ * For threads that only have a role for a while, such as a channel's own
+ * thread while it is in a bridge.  Does nothing if the thread was not
+ * placed.
+ *
+ * \return Nothing
+ */
+void ast_thread_unplace(void);
+
+#if defined(__cplusplus) || defined(c_plusplus)
+}
+#endif
+
+#endif /* _ASTERISK_THREAD_PLACEMENT_H */
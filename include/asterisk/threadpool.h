@@ -122,6 +122,20 @@ struct ast_threadpool_options {
 	 * a thread completes
 	 */
 	void (*thread_end)(void);
+	/*!
+	 * \brief Keep tasks pushed by worker threads local to that worker
+	 *
+	 * When non-zero, a task pushed into the pool from one of the pool's
+	 * own worker threads is queued on that worker instead of on the shared
+	 * queue of the pool. A worker runs its own tasks first and, once it
+	 * has nothing else to do, steals tasks queued on other workers. Tasks
+	 * pushed from threads outside of the pool always use the shared queue.
+	 *
+	 * \note The listener's task_pushed callback is only invoked for a
+	 * worker-local push when the worker already had tasks waiting, since
+	 * the pushing worker will otherwise run the new task itself.
+	 */
+	int work_stealing;
 };
 
 /*!
@@ -34,10 +34,23 @@ extern "C" {
 #include "asterisk/linkedlists.h"
 #include "asterisk/format_cap.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
 #endif
 
 struct ast_trans_pvt;	/* declared below */
 
+/*!
+ * \brief How a translation path trades quality for speed
+ *
+ * \see ast_translate_path_set_quality
+ */
+enum ast_translate_quality {
+	/*! The quality translators normally produce */
+	AST_TRANSLATE_QUALITY_DEFAULT = 0,
+	/*! Cheaper translation, for audio such as a conference mix that does not need the default quality */
+	AST_TRANSLATE_QUALITY_FAST,
+};
+
 /*!
  * \brief Translator Cost Table definition.
  *
@@ -159,10 +172,20 @@ struct ast_translator {
 	                                       /*!< Output frame callback. Generate a frame 
 	                                        *   with outbuf content. */
 
+	struct ast_frame * (*translate_batch)(struct ast_trans_pvt *pvt, struct ast_frame *in);
+	                                       /*!< Optional batch callback. Translate every
+	                                        *   frame of the list in and return the list
+	                                        *   of frames produced.  Without it each frame
+	                                        *   goes through framein and frameout. */
+
 	void (*destroy)(struct ast_trans_pvt *pvt);
 	                                       /*!< cleanup private data, if needed 
 	                                        *   (often unnecessary). */
 
+	int (*set_quality)(struct ast_trans_pvt *pvt, enum ast_translate_quality quality);
+	                                       /*!< Optional. Change the quality of a step,
+	                                        *   see ast_translate_path_set_quality(). */
+
 	struct ast_frame * (*sample)(void);    /*!< Generate an example frame */
 
 	/*!\brief size of outbuf, in samples. Leave it 0 if you want the framein
@@ -238,6 +261,20 @@ struct ast_trans_pvt {
 struct ast_frame *ast_trans_frameout(struct ast_trans_pvt *pvt,
         int datalen, int samples);
 
+/*!
+ * \brief Carry the jitterbuffer timing of an input frame over to the next output frame
+ *
+ * The generic framein wrapper does this for every frame, so only translate_batch
+ * callbacks need to call it themselves.
+ */
+static inline void ast_trans_frame_timing(struct ast_trans_pvt *pvt, const struct ast_frame *f)
+{
+	ast_copy_flags(&pvt->f, f, AST_FRFLAG_HAS_TIMING_INFO);
+	pvt->f.ts = f->ts;
+	pvt->f.len = f->len;
+	pvt->f.seqno = f->seqno;
+}
+
 struct ast_trans_pvt;
 
 /*!
@@ -324,6 +361,35 @@ void ast_translator_free_path(struct ast_trans_pvt *tr);
  */
 struct ast_frame *ast_translate(struct ast_trans_pvt *tr, struct ast_frame *f, int consume);
 
+/*!
+ * \brief Translates a batch of frames, each on its own
+ *
+ * Unlike ast_translate(), which merges a list of frames into one translation,
+ * every frame of \a frames is translated as if it had been passed to
+ * ast_translate() by itself.  Each step of the path handles the whole batch
+ * before the next step starts, using the translator's translate_batch
+ * callback when it has one.
+ *
+ * \param tr translator structure to use for translation
+ * \param frames list of frames, linked through frame_list, in the source format of \a tr
+ * \param consume Whether or not to free the original frames
+ * \return the list of translated frames, or NULL if none were produced
+ */
+struct ast_frame *ast_translate_list(struct ast_trans_pvt *tr, struct ast_frame *frames, int consume);
+
+/*!
+ * \brief Changes how a translation path trades quality for speed
+ *
+ * \param tr translator path to change
+ * \param quality the quality wanted
+ *
+ * Every step of the path whose translator supports it is changed, the
+ * others are left alone.  A path is built with AST_TRANSLATE_QUALITY_DEFAULT,
+ * and goes back to it when it is freed.  This is best done before the first
+ * frame is translated, as a step may lose its history when it changes.
+ */
+void ast_translate_path_set_quality(struct ast_trans_pvt *tr, enum ast_translate_quality quality);
+
 /*!
  * \brief Returns the number of steps required to convert from 'src' to 'dest'.
  * \param dest destination format
@@ -32,6 +32,7 @@
 #include "asterisk/sched.h"
 #include "asterisk/channel.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/linkedlists.h"
 
 
 enum ast_t38_ec_modes {
@@ -126,6 +127,64 @@ void ast_udptl_setnat(struct ast_udptl *udptl, int nat);
 
 void ast_udptl_stop(struct ast_udptl *udptl);
 
+/*!
+ * \brief Relay the packets two UDPTL sessions receive to each other
+ * \since 15.0.0
+ *
+ * \param udptl The UDPTL session.
+ * \param peer The UDPTL session to relay with, NULL to stop relaying.
+ *
+ * While relayed, a packet received by one session is sent on by the other
+ * as it is, with only its sequence number rewritten, instead of being
+ * decoded into T.38 frames and encoded again.  Packets are only relayed
+ * while both sessions use the same error correction scheme; otherwise they
+ * are read as frames as usual.  Destroying either session stops the relay.
+ *
+ * \return Nothing
+ */
+void ast_udptl_set_relay(struct ast_udptl *udptl, struct ast_udptl *peer);
+
+/*! \brief Channel driver interface to the UDPTL session of a channel */
+struct ast_udptl_glue {
+	/*! Name of the channel driver, as in its channel technology */
+	const char *type;
+	/*!
+	 * \brief Get the UDPTL session of a channel
+	 *
+	 * \retval NULL if the channel has none.
+	 *
+	 * \note The session stays valid until the channel is hung up.
+	 */
+	struct ast_udptl *(*get_udptl)(struct ast_channel *chan);
+	AST_RWLIST_ENTRY(ast_udptl_glue) entry;
+};
+
+/*!
+ * \brief Register a channel driver's UDPTL glue
+ * \since 15.0.0
+ *
+ * \retval 0 success
+ * \retval -1 a glue is already registered for the channel driver
+ */
+int ast_udptl_glue_register(struct ast_udptl_glue *glue);
+
+/*!
+ * \brief Unregister a channel driver's UDPTL glue
+ * \since 15.0.0
+ *
+ * \retval 0 success
+ * \retval -1 the glue was not registered
+ */
+int ast_udptl_glue_unregister(struct ast_udptl_glue *glue);
+
+/*!
+ * \brief Get the UDPTL session of a channel through its channel driver's glue
+ * \since 15.0.0
+ *
+ * \retval NULL if the channel driver has no glue or the channel has no session.
+ */
+struct ast_udptl *ast_udptl_get_instance(struct ast_channel *chan);
+
 void ast_udptl_init(void);
 
 /*!
@@ -84,4 +84,22 @@ static inline unsigned char AST_LIN2MU(short sample)
 
 #define AST_MULAW(a) (__ast_mulaw[(a)])
 
+/*!
+ * \brief Decode a buffer of mu-law samples to signed linear
+ *
+ * Gives the same results as AST_MULAW() / AST_LIN2MU(), using the vector
+ * instructions of the running CPU when they are available.
+ */
+void ast_ulaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples);
+
+/*!
+ * \brief Encode a buffer of signed linear samples to mu-law
+ */
+void ast_ulaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples);
+
+/*!
+ * \brief Name of the conversion kernel ast_ulaw_decode() and ast_ulaw_encode() use
+ */
+const char *ast_ulaw_kernel_name(void);
+
 #endif /* _ASTERISK_ULAW_H */
@@ -49,6 +49,17 @@ int ast_xml_finish(void);
  */
 struct ast_xml_doc *ast_xml_open(char *filename);
 
+/*!
+ * \brief Open an XML document held in memory as if it had been read from a file.
+ * \param buffer The document text.
+ * \param size The number of bytes in buffer.
+ * \param filename The path the document came from.  Relative xinclude and
+ *        stylesheet references are resolved against it.
+ * \retval NULL on error.
+ * \retval The ast_xml_doc reference to the open document.
+ */
+struct ast_xml_doc *ast_xml_open_memory(const char *buffer, size_t size, const char *filename);
+
 /*!
  * \brief Create a XML document.
  * \retval NULL on error.
@@ -80,6 +80,16 @@ struct ast_xml_doc_item {
 	AST_LIST_ENTRY(ast_xml_doc_item) next;
 };
 
+/*!
+ * \brief Whether documentation is parsed only when it is asked for.
+ *
+ * When set, callers should build the documentation strings of the items they
+ * register when they are first shown instead of at registration time.
+ *
+ * \since 15.0.0
+ */
+int ast_xmldoc_lazy(void);
+
 /*! \brief Execute an XPath query on the loaded XML documentation
  * \param query The XPath query string to execute
  * \param ... Variable printf style format arguments
@@ -104,15 +104,21 @@ typedef struct jb_frame {
 	struct jb_frame *next, *prev;
 } jb_frame;
 
+/*! \brief node of the tree ordering the history by delay, one per history entry */
+typedef struct jb_hist_node {
+	int left;		/*!< subtree of lower delays, as history index + 1, 0 if empty */
+	int right;		/*!< subtree of higher delays, as history index + 1, 0 if empty */
+	int size;		/*!< number of entries in this subtree */
+} jb_hist_node;
+
 typedef struct jitterbuf {
 	jb_info info;
 
 	/* history */
 	long history[JB_HISTORY_SZ];   		/*!< history */
 	int  hist_ptr;				/*!< points to index in history for next entry */
-	long hist_maxbuf[JB_HISTORY_MAXBUF_SZ];	/*!< a sorted buffer of the max delays (highest first) */
-	long hist_minbuf[JB_HISTORY_MAXBUF_SZ];	/*!< a sorted buffer of the min delays (lowest first) */
-	int  hist_maxbuf_valid;			/*!< are the "maxbuf"/minbuf valid? */
+	jb_hist_node hist_tree[JB_HISTORY_SZ];	/*!< history ordered by delay, indexed like history */
+	int  hist_root;				/*!< root of hist_tree, as history index + 1, 0 if empty */
 	unsigned int dropem:1;                  /*!< flag to indicate dropping frames (overload) */
 
 	jb_frame *frames; 		/*!< queued frames */
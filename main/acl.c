@@ -44,6 +44,7 @@
 #endif
 
 #include "asterisk/acl.h"
+#include "asterisk/astobj2.h"
 #include "asterisk/channel.h"
 #include "asterisk/utils.h"
 #include "asterisk/lock.h"
@@ -224,6 +225,7 @@ void ast_free_ha(struct ast_ha *ha)
 	while (ha) {
 		hal = ha;
 		ha = ha->next;
+		ao2_cleanup(hal->trie);
 		ast_free(hal);
 	}
 }
@@ -292,6 +294,10 @@ struct ast_ha *ast_duplicate_ha_list(struct ast_ha *original)
 		start = start->next;                /* Go to next object */
 		prev = current;                     /* Save pointer to this object */
 	}
+
+	if (ret) {
+		ret->trie = ao2_bump(original->trie); /* Share the compiled form */
+	}
 	return ret;                             /* Return start of list */
 }
 
@@ -548,6 +554,11 @@ struct ast_ha *ast_append_ha(const char *sense, const char *stuff, struct ast_ha
 	const char *parsed_addr, *parsed_mask;
 
 	ret = path;
+	if (ret && ret->trie) {
+		/* The compiled form no longer matches the list */
+		ao2_ref(ret->trie, -1);
+		ret->trie = NULL;
+	}
 	while (path) {
 		prev = path;
 		path = path->next;
@@ -709,6 +720,10 @@ enum ast_acl_sense ast_apply_acl(struct ast_acl_list *acl_list, const struct ast
 		}
 
 		if (acl->acl) {
+			if (!acl->acl->trie) {
+				/* Compiled on first use, the list can't change while it is locked. */
+				ast_ha_compile(acl->acl);
+			}
 			if (ast_apply_ha(acl->acl, addr) == AST_SENSE_DENY) {
 				ast_log(LOG_NOTICE, "%sRejecting '%s' due to a failure to pass ACL '%s'\n", purpose ? purpose : "", ast_sockaddr_stringify_addr(addr),
 						ast_strlen_zero(acl->name) ? "(BASELINE)" : acl->name);
@@ -723,12 +738,317 @@ enum ast_acl_sense ast_apply_acl(struct ast_acl_list *acl_list, const struct ast
 	return AST_SENSE_ALLOW;
 }
 
+/*! Fewest rules worth compiling, shorter lists are walked */
+#define HA_TRIE_MIN_RULES 8
+
+/*! Index of the root node of the IPv4 rules */
+#define HA_TRIE_ROOT_V4 0
+/*! Index of the root node of the IPv6 rules */
+#define HA_TRIE_ROOT_V6 1
+
+/*! \brief A node of a compiled list of rules, for one prefix */
+struct ha_trie_node {
+	/*! Prefix in host order words, IPv4 uses the first */
+	uint32_t prefix[4];
+	/*! Bits in the prefix */
+	unsigned int bits;
+	/*! Position in the list of the last rule for exactly this prefix, -1 if none */
+	int rule;
+	/*! Sense of that rule */
+	enum ast_acl_sense sense;
+	/*! Nodes of longer prefixes by their next bit, 0 if none */
+	unsigned int child[2];
+};
+
+/*!
+ * \brief Compiled form of a list of rules
+ *
+ * A path compressed binary trie per address family, so a prefix only has a
+ * node where rules end or branch off.  Every node on the path of an address
+ * is a rule prefix matching it, and the one with the last rule wins.
+ */
+struct ast_ha_trie {
+	/*! Non-zero if the list is walked instead */
+	int walk;
+	/*! Nodes in use */
+	unsigned int used;
+	/*! The nodes, starting with the two roots */
+	struct ha_trie_node *nodes;
+};
+
+static void ha_trie_destroy(void *obj)
+{
+	struct ast_ha_trie *trie = obj;
+
+	ast_free(trie->nodes);
+}
+
+/*!
+ * \internal
+ * \brief Get an IPv4 or IPv6 address as host order words.
+ *
+ * \return Bits in the address, 0 if it is neither IPv4 nor IPv6.
+ */
+static unsigned int ha_addr_words(const struct ast_sockaddr *addr, uint32_t words[4])
+{
+	uint32_t v6[4];
+	int i;
+
+	memset(words, 0, sizeof(uint32_t) * 4);
+	if (ast_sockaddr_is_ipv4(addr)) {
+		words[0] = ntohl(((const struct sockaddr_in *) &addr->ss)->sin_addr.s_addr);
+		return 32;
+	}
+	if (ast_sockaddr_is_ipv6(addr)) {
+		memcpy(v6, &((const struct sockaddr_in6 *) &addr->ss)->sin6_addr, sizeof(v6));
+		for (i = 0; i < 4; ++i) {
+			words[i] = ntohl(v6[i]);
+		}
+		return 128;
+	}
+	return 0;
+}
+
+static unsigned int ha_bit(const uint32_t *words, unsigned int bit)
+{
+	return (words[bit / 32] >> (31 - bit % 32)) & 1;
+}
+
+/*!
+ * \internal
+ * \brief Clear the bits of an address after a prefix.
+ */
+static void ha_words_mask(uint32_t words[4], unsigned int bits)
+{
+	unsigned int i;
+
+	for (i = 0; i < 4; ++i, bits -= bits < 32 ? bits : 32) {
+		if (bits < 32) {
+			words[i] &= bits ? 0xFFFFFFFF << (32 - bits) : 0;
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the prefix length of a netmask.
+ *
+ * \return Bits set, -1 if they are not contiguous.
+ */
+static int ha_mask_bits(const uint32_t mask[4], unsigned int total)
+{
+	uint32_t expected[4] = { 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF, 0xFFFFFFFF };
+	unsigned int bits = 0;
+
+	while (bits < total && ha_bit(mask, bits)) {
+		++bits;
+	}
+	if (total == 32) {
+		expected[1] = expected[2] = expected[3] = 0;
+	}
+	ha_words_mask(expected, bits);
+
+	return memcmp(expected, mask, sizeof(expected)) ? -1 : bits;
+}
+
+/*!
+ * \internal
+ * \brief Check if an address starts with a prefix.
+ */
+static int ha_prefix_match(const uint32_t *prefix, const uint32_t *words, unsigned int bits)
+{
+	unsigned int i;
+
+	for (i = 0; bits >= 32; ++i, bits -= 32) {
+		if (prefix[i] != words[i]) {
+			return 0;
+		}
+	}
+	return !bits || !((prefix[i] ^ words[i]) >> (32 - bits));
+}
+
+static unsigned int ha_trie_node_add(struct ast_ha_trie *trie, const uint32_t *prefix, unsigned int bits)
+{
+	struct ha_trie_node *node = &trie->nodes[trie->used];
+
+	memcpy(node->prefix, prefix, sizeof(node->prefix));
+	ha_words_mask(node->prefix, bits);
+	node->bits = bits;
+	node->rule = -1;
+	node->child[0] = node->child[1] = 0;
+
+	return trie->used++;
+}
+
+/*!
+ * \internal
+ * \brief Add a rule to a compiled list.
+ *
+ * \note Each rule adds at most two nodes, one where it branches off and
+ * one where it ends.
+ */
+static void ha_trie_insert(struct ast_ha_trie *trie, unsigned int root,
+	const uint32_t *prefix, unsigned int bits, int rule, enum ast_acl_sense sense)
+{
+	unsigned int index = root;
+	unsigned int child;
+	unsigned int split;
+	unsigned int common;
+	unsigned int bit;
+
+	while (trie->nodes[index].bits < bits) {
+		bit = ha_bit(prefix, trie->nodes[index].bits);
+		child = trie->nodes[index].child[bit];
+		if (!child) {
+			child = ha_trie_node_add(trie, prefix, bits);
+			trie->nodes[index].child[bit] = child;
+			index = child;
+			break;
+		}
+
+		common = trie->nodes[index].bits;
+		while (common < bits && common < trie->nodes[child].bits
+			&& ha_bit(prefix, common) == ha_bit(trie->nodes[child].prefix, common)) {
+			++common;
+		}
+		if (common == trie->nodes[child].bits) {
+			index = child;
+			continue;
+		}
+
+		/* The rule ends or branches off within the prefix of the child. */
+		split = ha_trie_node_add(trie, prefix, common);
+		trie->nodes[split].child[ha_bit(trie->nodes[child].prefix, common)] = child;
+		trie->nodes[index].child[bit] = split;
+		index = split;
+	}
+
+	/* A later rule for the same prefix replaces an earlier one. */
+	trie->nodes[index].rule = rule;
+	trie->nodes[index].sense = sense;
+}
+
+static enum ast_acl_sense ha_trie_apply(const struct ast_ha_trie *trie, const struct ast_sockaddr *addr)
+{
+	enum ast_acl_sense res = AST_SENSE_ALLOW;
+	const struct ha_trie_node *node;
+	struct ast_sockaddr mapped_addr;
+	uint32_t words[4];
+	unsigned int index;
+	unsigned int bits;
+	int rule = -1;
+
+	if (ast_sockaddr_is_ipv4_mapped(addr)) {
+		/* IPv4 ACLs apply to IPv4-mapped addresses, IPv6 ACLs do not */
+		if (!ast_sockaddr_ipv4_mapped(addr, &mapped_addr)) {
+			return res;
+		}
+		addr = &mapped_addr;
+	}
+
+	if (!(bits = ha_addr_words(addr, words))) {
+		return res;
+	}
+
+	index = bits == 32 ? HA_TRIE_ROOT_V4 : HA_TRIE_ROOT_V6;
+	do {
+		node = &trie->nodes[index];
+		if (!ha_prefix_match(node->prefix, words, node->bits)) {
+			break;
+		}
+		if (node->rule > rule) {
+			rule = node->rule;
+			res = node->sense;
+		}
+		if (node->bits == bits) {
+			break;
+		}
+		index = node->child[ha_bit(words, node->bits)];
+	} while (index);
+
+	return res;
+}
+
+int ast_ha_compile(struct ast_ha *ha)
+{
+	struct ast_ha_trie *trie;
+	const struct ast_ha *current_ha;
+	uint32_t prefix[4];
+	uint32_t masked[4];
+	uint32_t mask[4];
+	unsigned int bits;
+	int prefix_bits;
+	int count = 0;
+	int rule;
+
+	if (!ha) {
+		return 0;
+	}
+
+	trie = ao2_alloc_options(sizeof(*trie), ha_trie_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!trie) {
+		return -1;
+	}
+
+	for (current_ha = ha; current_ha; current_ha = current_ha->next) {
+		++count;
+	}
+
+	if (count < HA_TRIE_MIN_RULES) {
+		trie->walk = 1;
+	} else if (!(trie->nodes = ast_malloc(sizeof(*trie->nodes) * (2 * count + 2)))) {
+		ao2_ref(trie, -1);
+		return -1;
+	} else {
+		memset(prefix, 0, sizeof(prefix));
+		ha_trie_node_add(trie, prefix, 0);
+		ha_trie_node_add(trie, prefix, 0);
+	}
+
+	for (current_ha = ha, rule = 0; !trie->walk && current_ha; current_ha = current_ha->next, ++rule) {
+		bits = ha_addr_words(&current_ha->addr, prefix);
+		if (!bits || ha_addr_words(&current_ha->netmask, mask) != bits) {
+			/* Never matches, ast_sockaddr_apply_netmask() would fail. */
+			continue;
+		}
+		if ((prefix_bits = ha_mask_bits(mask, bits)) < 0) {
+			ast_debug(3, "ACL has a non-contiguous netmask, it will not be compiled\n");
+			trie->walk = 1;
+			break;
+		}
+		memcpy(masked, prefix, sizeof(masked));
+		ha_words_mask(masked, prefix_bits);
+		if (memcmp(masked, prefix, sizeof(masked))) {
+			/* Never matches, the address has bits outside of the netmask. */
+			continue;
+		}
+		ha_trie_insert(trie, bits == 32 ? HA_TRIE_ROOT_V4 : HA_TRIE_ROOT_V6,
+			prefix, prefix_bits, rule, current_ha->sense);
+	}
+
+	if (trie->walk) {
+		ast_free(trie->nodes);
+		trie->nodes = NULL;
+	} else {
+		ast_debug(3, "Compiled ACL of %d rules into %u nodes\n", count, trie->used);
+	}
+
+	ao2_cleanup(ha->trie);
+	ha->trie = trie;
+
+	return 0;
+}
+
 enum ast_acl_sense ast_apply_ha(const struct ast_ha *ha, const struct ast_sockaddr *addr)
 {
 	/* Start optimistic */
 	enum ast_acl_sense res = AST_SENSE_ALLOW;
 	const struct ast_ha *current_ha;
 
+	if (ha && ha->trie && !ha->trie->walk) {
+		return ha_trie_apply(ha->trie, addr);
+	}
+
 	for (current_ha = ha; current_ha; current_ha = current_ha->next) {
 		struct ast_sockaddr result;
 		struct ast_sockaddr mapped_addr;
@@ -31,6 +31,20 @@
 
 #include "asterisk/alaw.h"
 #include "asterisk/logger.h"
+#include "asterisk/utils.h"
+
+/* The vector kernels implement the original coding tables only */
+#ifndef G711_NEW_ALGORITHM
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ALAW_HAVE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define ALAW_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
+#endif /* G711_NEW_ALGORITHM */
 
 #ifndef G711_NEW_ALGORITHM
 #define AMI_MASK 0x55
@@ -149,6 +163,291 @@ unsigned char __ast_lin2a[AST_ALAW_TAB_SIZE];
 #endif
 short __ast_alaw[256];
 
+/*
+ * Bulk conversion kernels.
+ *
+ * The vector kernels compute the same values as the lookup tables.
+ * AST_LIN2A() drops the three low bits of every sample, and the table
+ * entry for that index was written last by the sample with all three
+ * set, so encoding starts from sample | 7.  The segment is the bit length
+ * of the magnitude >> 8, and the variable shifts are done as multiplies
+ * by powers of two looked up from the segment.
+ */
+struct alaw_kernel {
+	const char *name;
+	int (*supported)(void);
+	void (*decode)(int16_t *dst, const unsigned char *src, unsigned int samples);
+	void (*encode)(unsigned char *dst, const int16_t *src, unsigned int samples);
+};
+
+static int scalar_supported(void)
+{
+	return 1;
+}
+
+static void scalar_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; i++) {
+		dst[i] = AST_ALAW(src[i]);
+	}
+}
+
+static void scalar_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i < samples; i++) {
+		dst[i] = AST_LIN2A(src[i]);
+	}
+}
+
+#ifdef ALAW_HAVE_X86
+static int sse41_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse4.1");
+}
+
+static void __attribute__((target("sse4.1"))) sse41_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	/* 1 << (segment - 1), and 1 for segment 0 */
+	const __m128i pow2 = _mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i zero = _mm_setzero_si128();
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		__m128i alaw = _mm_xor_si128(_mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *) &src[i])), _mm_set1_epi16(AMI_MASK));
+		__m128i seg = _mm_and_si128(_mm_srli_epi16(alaw, 4), _mm_set1_epi16(0x07));
+		__m128i mantissa = _mm_and_si128(alaw, _mm_set1_epi16(0x0f));
+		__m128i scale = _mm_and_si128(_mm_shuffle_epi8(pow2, seg), _mm_set1_epi16(0xff));
+		__m128i negative = _mm_cmpeq_epi16(_mm_and_si128(alaw, _mm_set1_epi16(0x80)), zero);
+		__m128i sample;
+
+		sample = _mm_add_epi16(_mm_slli_epi16(mantissa, 4), _mm_set1_epi16(8));
+		sample = _mm_add_epi16(sample, _mm_andnot_si128(_mm_cmpeq_epi16(seg, zero), _mm_set1_epi16(0x100)));
+		sample = _mm_mullo_epi16(sample, scale);
+		sample = _mm_sub_epi16(_mm_xor_si128(sample, negative), negative);
+		_mm_storeu_si128((__m128i *) &dst[i], sample);
+	}
+	scalar_decode(dst + i, src + i, samples - i);
+}
+
+/*! \brief Encode eight samples, leaving each a-law byte in the low half of its lane */
+static inline __m128i __attribute__((target("sse4.1"))) sse41_encode8(__m128i sample)
+{
+	/* Bit length of the high and the low nibble of a 7 bit value */
+	const __m128i bitlen_hi = _mm_setr_epi8(0, 5, 6, 6, 7, 7, 7, 7, 0, 0, 0, 0, 0, 0, 0, 0);
+	const __m128i bitlen_lo = _mm_setr_epi8(0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4);
+	/* 1 << (7 - max(segment, 1)), which shifted up by 6 divides by the segment's step in mulhi */
+	const __m128i shift = _mm_setr_epi8(64, 64, 32, 16, 8, 4, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0);
+	__m128i negative;
+	__m128i mag;
+	__m128i top;
+	__m128i seg;
+	__m128i scale;
+	__m128i mantissa;
+	__m128i alaw;
+
+	sample = _mm_or_si128(sample, _mm_set1_epi16(7));
+	negative = _mm_srai_epi16(sample, 15);
+	mag = _mm_abs_epi16(sample);
+
+	top = _mm_srli_epi16(mag, 8);
+	seg = _mm_max_epu8(_mm_shuffle_epi8(bitlen_hi, _mm_srli_epi16(top, 4)),
+		_mm_shuffle_epi8(bitlen_lo, _mm_and_si128(top, _mm_set1_epi16(0x0f))));
+	scale = _mm_slli_epi16(_mm_and_si128(_mm_shuffle_epi8(shift, seg), _mm_set1_epi16(0xff)), 6);
+	mantissa = _mm_and_si128(_mm_mulhi_epu16(mag, scale), _mm_set1_epi16(0x0f));
+
+	alaw = _mm_or_si128(_mm_slli_epi16(seg, 4), mantissa);
+	alaw = _mm_xor_si128(alaw, _mm_set1_epi16(AMI_MASK));
+
+	return _mm_xor_si128(alaw, _mm_andnot_si128(negative, _mm_set1_epi16(0x80)));
+}
+
+static void __attribute__((target("sse4.1"))) sse41_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m128i lo = sse41_encode8(_mm_loadu_si128((const __m128i *) &src[i]));
+		__m128i hi = sse41_encode8(_mm_loadu_si128((const __m128i *) &src[i + 8]));
+
+		_mm_storeu_si128((__m128i *) &dst[i], _mm_packus_epi16(lo, hi));
+	}
+	scalar_encode(dst + i, src + i, samples - i);
+}
+
+static int avx2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2");
+}
+
+static void __attribute__((target("avx2"))) avx2_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	const __m256i pow2 = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(1, 1, 2, 4, 8, 16, 32, 64, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m256i zero = _mm256_setzero_si256();
+	unsigned int i;
+
+	for (i = 0; i + 16 <= samples; i += 16) {
+		__m256i alaw = _mm256_xor_si256(_mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *) &src[i])), _mm256_set1_epi16(AMI_MASK));
+		__m256i seg = _mm256_and_si256(_mm256_srli_epi16(alaw, 4), _mm256_set1_epi16(0x07));
+		__m256i mantissa = _mm256_and_si256(alaw, _mm256_set1_epi16(0x0f));
+		__m256i scale = _mm256_and_si256(_mm256_shuffle_epi8(pow2, seg), _mm256_set1_epi16(0xff));
+		__m256i negative = _mm256_cmpeq_epi16(_mm256_and_si256(alaw, _mm256_set1_epi16(0x80)), zero);
+		__m256i sample;
+
+		sample = _mm256_add_epi16(_mm256_slli_epi16(mantissa, 4), _mm256_set1_epi16(8));
+		sample = _mm256_add_epi16(sample, _mm256_andnot_si256(_mm256_cmpeq_epi16(seg, zero), _mm256_set1_epi16(0x100)));
+		sample = _mm256_mullo_epi16(sample, scale);
+		sample = _mm256_sub_epi16(_mm256_xor_si256(sample, negative), negative);
+		_mm256_storeu_si256((__m256i *) &dst[i], sample);
+	}
+	scalar_decode(dst + i, src + i, samples - i);
+}
+
+/*! \brief Encode sixteen samples, leaving each a-law byte in the low half of its lane */
+static inline __m256i __attribute__((target("avx2"))) avx2_encode16(__m256i sample)
+{
+	const __m256i bitlen_hi = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(0, 5, 6, 6, 7, 7, 7, 7, 0, 0, 0, 0, 0, 0, 0, 0));
+	const __m256i bitlen_lo = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4));
+	const __m256i shift = _mm256_broadcastsi128_si256(
+		_mm_setr_epi8(64, 64, 32, 16, 8, 4, 2, 1, 0, 0, 0, 0, 0, 0, 0, 0));
+	__m256i negative;
+	__m256i mag;
+	__m256i top;
+	__m256i seg;
+	__m256i scale;
+	__m256i mantissa;
+	__m256i alaw;
+
+	sample = _mm256_or_si256(sample, _mm256_set1_epi16(7));
+	negative = _mm256_srai_epi16(sample, 15);
+	mag = _mm256_abs_epi16(sample);
+
+	top = _mm256_srli_epi16(mag, 8);
+	seg = _mm256_max_epu8(_mm256_shuffle_epi8(bitlen_hi, _mm256_srli_epi16(top, 4)),
+		_mm256_shuffle_epi8(bitlen_lo, _mm256_and_si256(top, _mm256_set1_epi16(0x0f))));
+	scale = _mm256_slli_epi16(_mm256_and_si256(_mm256_shuffle_epi8(shift, seg), _mm256_set1_epi16(0xff)), 6);
+	mantissa = _mm256_and_si256(_mm256_mulhi_epu16(mag, scale), _mm256_set1_epi16(0x0f));
+
+	alaw = _mm256_or_si256(_mm256_slli_epi16(seg, 4), mantissa);
+	alaw = _mm256_xor_si256(alaw, _mm256_set1_epi16(AMI_MASK));
+
+	return _mm256_xor_si256(alaw, _mm256_andnot_si256(negative, _mm256_set1_epi16(0x80)));
+}
+
+static void __attribute__((target("avx2"))) avx2_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 32 <= samples; i += 32) {
+		__m256i lo = avx2_encode16(_mm256_loadu_si256((const __m256i *) &src[i]));
+		__m256i hi = avx2_encode16(_mm256_loadu_si256((const __m256i *) &src[i + 16]));
+
+		/* packus works within each 128 bit lane, so put the quarters back in order */
+		_mm256_storeu_si256((__m256i *) &dst[i],
+			_mm256_permute4x64_epi64(_mm256_packus_epi16(lo, hi), 0xd8));
+	}
+	scalar_encode(dst + i, src + i, samples - i);
+}
+#endif /* ALAW_HAVE_X86 */
+
+#ifdef ALAW_HAVE_NEON
+/* NEON is part of the baseline when the compiler was told to use it. */
+static int neon_supported(void)
+{
+	return 1;
+}
+
+static void neon_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		uint16x8_t alaw = vmovl_u8(veor_u8(vld1_u8(&src[i]), vdup_n_u8(AMI_MASK)));
+		uint16x8_t seg = vandq_u16(vshrq_n_u16(alaw, 4), vdupq_n_u16(0x07));
+		uint16x8_t mantissa = vandq_u16(alaw, vdupq_n_u16(0x0f));
+		uint16x8_t positive = vtstq_u16(alaw, vdupq_n_u16(0x80));
+		uint16x8_t segmented = vtstq_u16(seg, seg);
+		int16x8_t sample;
+
+		sample = vreinterpretq_s16_u16(vaddq_u16(vshlq_n_u16(mantissa, 4), vdupq_n_u16(8)));
+		sample = vaddq_s16(sample, vreinterpretq_s16_u16(vandq_u16(segmented, vdupq_n_u16(0x100))));
+		sample = vshlq_s16(sample, vreinterpretq_s16_u16(vqsubq_u16(seg, vdupq_n_u16(1))));
+		vst1q_s16(&dst[i], vbslq_s16(positive, sample, vnegq_s16(sample)));
+	}
+	scalar_decode(dst + i, src + i, samples - i);
+}
+
+static void neon_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	unsigned int i;
+
+	for (i = 0; i + 8 <= samples; i += 8) {
+		int16x8_t sample = vorrq_s16(vld1q_s16(&src[i]), vdupq_n_s16(7));
+		uint16x8_t negative = vcltq_s16(sample, vdupq_n_s16(0));
+		uint16x8_t mag = vreinterpretq_u16_s16(vabsq_s16(sample));
+		uint16x8_t seg = vsubq_u16(vdupq_n_u16(16), vclzq_u16(vshrq_n_u16(mag, 8)));
+		int16x8_t shift = vreinterpretq_s16_u16(vaddq_u16(vmaxq_u16(seg, vdupq_n_u16(1)), vdupq_n_u16(3)));
+		uint16x8_t mantissa = vandq_u16(vshlq_u16(mag, vnegq_s16(shift)), vdupq_n_u16(0x0f));
+		uint16x8_t alaw;
+
+		alaw = vorrq_u16(vshlq_n_u16(seg, 4), mantissa);
+		alaw = veorq_u16(alaw, vdupq_n_u16(AMI_MASK));
+		alaw = veorq_u16(alaw, vbicq_u16(vdupq_n_u16(0x80), negative));
+		vst1_u8(&dst[i], vmovn_u16(alaw));
+	}
+	scalar_encode(dst + i, src + i, samples - i);
+}
+#endif /* ALAW_HAVE_NEON */
+
+/*! \brief Compiled in kernels, from least to most preferred */
+static const struct alaw_kernel kernels[] = {
+	{ "scalar", scalar_supported, scalar_decode, scalar_encode },
+#ifdef ALAW_HAVE_X86
+	{ "sse4.1", sse41_supported, sse41_decode, sse41_encode },
+	{ "avx2", avx2_supported, avx2_decode, avx2_encode },
+#endif
+#ifdef ALAW_HAVE_NEON
+	{ "neon", neon_supported, neon_decode, neon_encode },
+#endif
+};
+
+static const struct alaw_kernel *alaw_kernel = &kernels[0];
+
+static void alaw_kernel_init(void)
+{
+	int i;
+
+	for (i = ARRAY_LEN(kernels) - 1; i > 0; i--) {
+		if (kernels[i].supported()) {
+			break;
+		}
+	}
+	alaw_kernel = &kernels[i];
+}
+
+void ast_alaw_decode(int16_t *dst, const unsigned char *src, unsigned int samples)
+{
+	alaw_kernel->decode(dst, src, samples);
+}
+
+void ast_alaw_encode(unsigned char *dst, const int16_t *src, unsigned int samples)
+{
+	alaw_kernel->encode(dst, src, samples);
+}
+
+const char *ast_alaw_kernel_name(void)
+{
+	return alaw_kernel->name;
+}
+
 void ast_alaw_init(void)
 {
 	int i;
@@ -211,5 +510,7 @@ void ast_alaw_init(void)
 	ast_log(LOG_NOTICE, "a-Law tandem transcoding test complete.\n");
 #endif /* TEST_TANDEM_TRANSCODING */
 
+	alaw_kernel_init();
+
 }
 
@@ -0,0 +1,194 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Memory arenas
+ *
+ * Allocations are rounded up to a power of two size class.  Released
+ * memory is kept on a free list for its class and handed out again
+ * before carving anything new from the chunks.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/arena.h"
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+
+/*! Smallest size class, large enough to hold a free list link. */
+#define ARENA_MIN_CLASS	4
+/*! Number of size classes. */
+#define ARENA_CLASSES	(sizeof(size_t) * 8)
+
+/*! \brief A block of memory allocations are carved from. */
+struct arena_chunk {
+	struct arena_chunk *next;
+	/*! Bytes in data[]. */
+	size_t size;
+	/*! Bytes of data[] already carved. */
+	size_t used;
+	unsigned char data[0] __attribute__((aligned));
+};
+
+/*! \brief Memory given back to the arena. */
+struct arena_free {
+	struct arena_free *next;
+};
+
+struct ast_arena {
+	ast_mutex_t lock;
+	/*! Chunks to carve from.  Only the first one has room left. */
+	struct arena_chunk *chunks;
+	/*! Size of the chunks to add. */
+	size_t chunk_size;
+	/*! Released memory by size class. */
+	struct arena_free *free[ARENA_CLASSES];
+	/*! The first chunk.  Must be last. */
+	struct arena_chunk first;
+};
+
+/*!
+ * \internal
+ * \brief Get the size class of an allocation.
+ *
+ * \param size Bytes needed.
+ *
+ * \return Size class.  The class holds 1 << class bytes.
+ */
+static unsigned int arena_class(size_t size)
+{
+	unsigned int cls = ARENA_MIN_CLASS;
+
+	while (((size_t) 1 << cls) < size) {
+		++cls;
+	}
+	return cls;
+}
+
+struct ast_arena *__ast_arena_create(size_t chunk_size, const char *file, int lineno, const char *func)
+{
+	struct ast_arena *arena;
+
+	arena = __ast_malloc(sizeof(*arena) + chunk_size, file, lineno, func);
+	if (!arena) {
+		return NULL;
+	}
+
+	ast_mutex_init(&arena->lock);
+	arena->chunk_size = chunk_size;
+	memset(arena->free, 0, sizeof(arena->free));
+	arena->first.next = NULL;
+	arena->first.size = chunk_size;
+	arena->first.used = 0;
+	arena->chunks = &arena->first;
+
+	return arena;
+}
+
+void ast_arena_destroy(struct ast_arena *arena)
+{
+	struct arena_chunk *chunk;
+
+	if (!arena) {
+		return;
+	}
+
+	while ((chunk = arena->chunks) != &arena->first) {
+		arena->chunks = chunk->next;
+		ast_free(chunk);
+	}
+	ast_mutex_destroy(&arena->lock);
+	ast_free(arena);
+}
+
+void *ast_arena_calloc(struct ast_arena *arena, size_t size)
+{
+	unsigned int cls = arena_class(size);
+	size_t block_size = (size_t) 1 << cls;
+	struct arena_chunk *chunk;
+	void *ptr;
+
+	ast_mutex_lock(&arena->lock);
+	if (arena->free[cls]) {
+		ptr = arena->free[cls];
+		arena->free[cls] = arena->free[cls]->next;
+	} else {
+		chunk = arena->chunks;
+		if (chunk->size - chunk->used < block_size) {
+			size_t new_size = MAX(arena->chunk_size, block_size);
+
+			chunk = ast_malloc(sizeof(*chunk) + new_size);
+			if (!chunk) {
+				ast_mutex_unlock(&arena->lock);
+				return NULL;
+			}
+			chunk->size = new_size;
+			chunk->used = 0;
+			if (block_size < arena->chunk_size) {
+				chunk->next = arena->chunks;
+				arena->chunks = chunk;
+			} else {
+				/* An oversized block keeps the room left in the current chunk usable. */
+				chunk->next = arena->chunks->next;
+				arena->chunks->next = chunk;
+			}
+		}
+		ptr = chunk->data + chunk->used;
+		chunk->used += block_size;
+	}
+	ast_mutex_unlock(&arena->lock);
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+void ast_arena_release(struct ast_arena *arena, void *ptr, size_t size)
+{
+	unsigned int cls = arena_class(size);
+	struct arena_free *block = ptr;
+
+	if (!block) {
+		return;
+	}
+
+	ast_mutex_lock(&arena->lock);
+	block->next = arena->free[cls];
+	arena->free[cls] = block;
+	ast_mutex_unlock(&arena->lock);
+}
+
+void ast_arena_usage(struct ast_arena *arena, size_t *size, size_t *used)
+{
+	struct arena_chunk *chunk;
+
+	*size = sizeof(*arena);
+	*used = 0;
+
+	ast_mutex_lock(&arena->lock);
+	for (chunk = arena->chunks; chunk; chunk = chunk->next) {
+		if (chunk != &arena->first) {
+			*size += sizeof(*chunk);
+		}
+		*size += chunk->size;
+		*used += chunk->used;
+	}
+	ast_mutex_unlock(&arena->lock);
+}
@@ -331,6 +331,8 @@ int ast_verb_sys_level;
 int option_verbose;				/*!< Verbosity level */
 int option_debug;				/*!< Debug level */
 int ast_option_pjproject_log_level;
+int ast_option_pjproject_cache_pools;
+unsigned int ast_option_pjproject_cache_pool_max_capacity;
 double ast_option_maxload;			/*!< Max load avg on system */
 int ast_option_maxcalls;			/*!< Max number of active calls */
 int ast_option_maxfiles;			/*!< Max number of open file handles (files, sockets) */
@@ -339,6 +341,17 @@ unsigned int option_dtmfminduration;		/*!< Minimum duration of DTMF. */
 long option_minmemfree;				/*!< Minimum amount of free system memory - stop accepting calls if free memory falls below this watermark */
 #endif
 unsigned int ast_option_rtpptdynamic;
+unsigned int ast_option_bridge_reactors;
+unsigned int ast_option_bridge_write_batch = 1;
+unsigned int ast_option_prompt_cache_size;
+unsigned int ast_option_media_cache_size;
+unsigned int ast_option_load_threads;
+unsigned int ast_option_devstate_coalesce;
+unsigned int ast_option_frame_latency_sample;
+unsigned int ast_option_dns_cache_size;
+unsigned int ast_option_dns_cache_negative_ttl;
+unsigned int ast_option_bridge_tech_hold;
+unsigned int ast_option_file_write_behind;
 
 /*! @} */
 
@@ -492,6 +505,8 @@ static struct {
 struct thread_list_t {
 	AST_RWLIST_ENTRY(thread_list_t) list;
 	char *name;
+	/*! Role and processors the thread was placed on, NULL if not placed */
+	char *placement;
 	pthread_t id;
 	int lwp;
 };
@@ -529,10 +544,32 @@ void ast_unregister_thread(void *id)
 	AST_RWLIST_UNLOCK(&thread_list);
 	if (x) {
 		ast_free(x->name);
+		ast_free(x->placement);
 		ast_free(x);
 	}
 }
 
+void ast_thread_list_set_placement(char *placement)
+{
+	struct thread_list_t *cur;
+	pthread_t self = pthread_self();
+
+	AST_RWLIST_WRLOCK(&thread_list);
+	AST_RWLIST_TRAVERSE(&thread_list, cur, list) {
+		if (pthread_equal(cur->id, self)) {
+			/* steal the allocated memory for the placement */
+			ast_free(cur->placement);
+			cur->placement = placement;
+			placement = NULL;
+			break;
+		}
+	}
+	AST_RWLIST_UNLOCK(&thread_list);
+
+	/* Threads not started by ast_pthread_create() are not listed. */
+	ast_free(placement);
+}
+
 /*! \brief Give an overview of core settings */
 static char *handle_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
@@ -601,6 +638,18 @@ static char *handle_show_settings(struct ast_cli_entry *e, int cmd, struct ast_c
 	ast_cli(a->fd, "  Transmit silence during rec: %s\n", ast_test_flag(&ast_options, AST_OPT_FLAG_TRANSMIT_SILENCE) ? "Enabled" : "Disabled");
 	ast_cli(a->fd, "  Generic PLC:                 %s\n", ast_test_flag(&ast_options, AST_OPT_FLAG_GENERIC_PLC) ? "Enabled" : "Disabled");
 	ast_cli(a->fd, "  Min DTMF duration::          %u\n", option_dtmfminduration);
+	ast_cli(a->fd, "  Bridge reactor threads:      %u\n", ast_option_bridge_reactors);
+	ast_cli(a->fd, "  Bridge write batch:          %u\n", ast_option_bridge_write_batch);
+	ast_cli(a->fd, "  Prompt cache size:           %u KB\n", ast_option_prompt_cache_size);
+	ast_cli(a->fd, "  Media cache size:            %u KB\n", ast_option_media_cache_size);
+	ast_cli(a->fd, "  Memory mapped sound files:   %s\n", ast_opt_mmap_sound_files ? "Enabled" : "Disabled");
+	ast_cli(a->fd, "  Module loading threads:      %u\n", ast_option_load_threads);
+	ast_cli(a->fd, "  Device state coalescing:     %u ms\n", ast_option_devstate_coalesce);
+	ast_cli(a->fd, "  Frame latency sampling:      %u\n", ast_option_frame_latency_sample);
+	ast_cli(a->fd, "  DNS cache size:              %u\n", ast_option_dns_cache_size);
+	ast_cli(a->fd, "  DNS cache negative TTL:      %u s\n", ast_option_dns_cache_negative_ttl);
+	ast_cli(a->fd, "  Bridge technology hold:      %u ms\n", ast_option_bridge_tech_hold);
+	ast_cli(a->fd, "  File write behind:           %u frames\n", ast_option_file_write_behind);
 
 	if (ast_option_rtpptdynamic == AST_RTP_PT_LAST_REASSIGN) {
 		ast_cli(a->fd, "  RTP dynamic payload types:   %u,%u-%u\n",
@@ -651,7 +700,9 @@ static char *handle_show_threads(struct ast_cli_entry *e, int cmd, struct ast_cl
 		e->command = "core show threads";
 		e->usage =
 			"Usage: core show threads\n"
-			"       List threads currently active in the system.\n";
+			"       List threads currently active in the system.  Threads placed\n"
+			"       on processors by the [threads] section of asterisk.conf show\n"
+			"       their role and processors.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
@@ -659,7 +710,11 @@ static char *handle_show_threads(struct ast_cli_entry *e, int cmd, struct ast_cl
 
 	AST_RWLIST_RDLOCK(&thread_list);
 	AST_RWLIST_TRAVERSE(&thread_list, cur, list) {
-		ast_cli(a->fd, "%p %d %s\n", (void *)cur->id, cur->lwp, cur->name);
+		if (cur->placement) {
+			ast_cli(a->fd, "%p %d %s [%s]\n", (void *)cur->id, cur->lwp, cur->name, cur->placement);
+		} else {
+			ast_cli(a->fd, "%p %d %s\n", (void *)cur->id, cur->lwp, cur->name);
+		}
 		count++;
 	}
 	AST_RWLIST_UNLOCK(&thread_list);
@@ -3634,6 +3689,9 @@ static void ast_readconfig(void)
 		/* Cache recorded sound files to another directory during recording */
 		} else if (!strcasecmp(v->name, "cache_record_files")) {
 			ast_set2_flag(&ast_options, ast_true(v->value), AST_OPT_FLAG_CACHE_RECORD_FILES);
+		/* Read sound files in raw formats through memory maps */
+		} else if (!strcasecmp(v->name, "mmap_sound_files")) {
+			ast_set2_flag(&ast_options, ast_true(v->value), AST_OPT_FLAG_MMAP_SOUND_FILES);
 		/* Specify cache directory */
 		}  else if (!strcasecmp(v->name, "record_cache_dir")) {
 			ast_copy_string(record_cache_dir, v->value, AST_CACHE_DIR_LEN);
@@ -3659,6 +3717,39 @@ static void ast_readconfig(void)
 		} else if (!strcasecmp(v->name, "rtp_pt_dynamic")) {
 			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
 			              &ast_option_rtpptdynamic, 0, AST_RTP_PT_FIRST_DYNAMIC);
+		} else if (!strcasecmp(v->name, "bridge_reactors")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_bridge_reactors, 0, 1024);
+		} else if (!strcasecmp(v->name, "bridge_write_batch")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_bridge_write_batch, 1, 64);
+		} else if (!strcasecmp(v->name, "prompt_cache_size")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_prompt_cache_size, 0, 4 * 1024 * 1024);
+		} else if (!strcasecmp(v->name, "media_cache_size")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_media_cache_size, 0, 64 * 1024 * 1024);
+		} else if (!strcasecmp(v->name, "loadthreads")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_load_threads, 0, 64);
+		} else if (!strcasecmp(v->name, "devstate_coalesce")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_devstate_coalesce, 0, 10000);
+		} else if (!strcasecmp(v->name, "frame_latency_sample")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_frame_latency_sample, 0, 1000000);
+		} else if (!strcasecmp(v->name, "dns_cache_size")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_dns_cache_size, 0, 1000000);
+		} else if (!strcasecmp(v->name, "dns_cache_negative_ttl")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_dns_cache_negative_ttl, 0, 86400);
+		} else if (!strcasecmp(v->name, "bridge_tech_hold")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_bridge_tech_hold, 0, 60000);
+		} else if (!strcasecmp(v->name, "file_write_behind")) {
+			ast_parse_arg(v->value, PARSE_UINT32|PARSE_IN_RANGE,
+			              &ast_option_file_write_behind, 0, 10000);
 		} else if (!strcasecmp(v->name, "maxcalls")) {
 			if ((sscanf(v->value, "%30d", &ast_option_maxcalls) != 1) || (ast_option_maxcalls < 0)) {
 				ast_option_maxcalls = 0;
@@ -3765,6 +3856,8 @@ static void read_pjproject_startup_options(void)
 	struct ast_flags config_flags = { CONFIG_FLAG_NOCACHE | CONFIG_FLAG_NOREALTIME };
 
 	ast_option_pjproject_log_level = DEFAULT_PJ_LOG_MAX_LEVEL;
+	ast_option_pjproject_cache_pools = 1;
+	ast_option_pjproject_cache_pool_max_capacity = DEFAULT_PJ_CACHE_POOL_MAX_CAPACITY;
 
 	cfg = ast_config_load2("pjproject.conf", "" /* core, can't reload */, config_flags);
 	if (!cfg
@@ -3783,6 +3876,14 @@ static void read_pjproject_startup_options(void)
 			} else if (MAX_PJ_LOG_MAX_LEVEL < ast_option_pjproject_log_level) {
 				ast_option_pjproject_log_level = MAX_PJ_LOG_MAX_LEVEL;
 			}
+		} else if (!strcasecmp(v->name, "cache_pools")) {
+			ast_option_pjproject_cache_pools = !ast_false(v->value);
+		} else if (!strcasecmp(v->name, "cache_pool_max_capacity")) {
+			if (sscanf(v->value, "%30u", &ast_option_pjproject_cache_pool_max_capacity) != 1) {
+				ast_log(LOG_WARNING, "Invalid cache_pool_max_capacity '%s' in pjproject.conf, using %u\n",
+					v->value, DEFAULT_PJ_CACHE_POOL_MAX_CAPACITY);
+				ast_option_pjproject_cache_pool_max_capacity = DEFAULT_PJ_CACHE_POOL_MAX_CAPACITY;
+			}
 		}
 	}
 
@@ -4463,6 +4564,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 
 	check_init(astobj2_init(), "AO2");
 	check_init(ast_named_locks_init(), "Named Locks");
+	check_init(ast_lock_contention_init(), "Lock Contention");
 
 	if (ast_opt_console) {
 		if (el_hist == NULL || el == NULL)
@@ -4493,13 +4595,18 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	ast_builtins_init();
 
 	check_init(ast_utils_init(), "Utilities");
+	check_init(ast_thread_placement_init(), "Thread Placement");
+	check_init(ast_frame_init(), "Frame Core");
+	check_init(ast_frame_latency_init(), "Frame Latency Tracing");
 	check_init(ast_tps_init(), "Task Processor Core");
+	check_init(ast_threadpool_init(), "Thread Pool Core");
 	check_init(ast_fd_init(), "File Descriptor Debugging");
 	check_init(ast_pbx_init(), "ast_pbx_init");
 #ifdef TEST_FRAMEWORK
 	check_init(ast_test_init(), "Test Framework");
 #endif
 	check_init(ast_translate_init(), "Translator Core");
+	check_init(ast_media_fork_init(), "Media Forks");
 
 	ast_aoc_cli_init();
 
@@ -4545,6 +4652,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 
 	check_init(ast_timing_init(), "Timing");
 	check_init(ast_ssl_init(), "SSL");
+	check_init(ast_tcptls_init(), "TCP/TLS");
 	read_pjproject_startup_options();
 	check_init(ast_pj_init(), "Embedded PJProject");
 	check_init(app_init(), "App Core");
@@ -4558,6 +4666,7 @@ static void asterisk_daemon(int isroot, const char *runuser, const char *rungrou
 	check_init(ast_parking_stasis_init(), "Parking Core");
 	check_init(ast_device_state_engine_init(), "Device State Engine");
 	check_init(ast_presence_state_engine_init(), "Presence State Engine");
+	check_init(ast_dns_cache_init(), "DNS cache");
 	check_init(ast_dns_system_resolver_init(), "Default DNS resolver");
 	check_init(load_modules(1), "Module Preload");
 	check_init(ast_features_init(), "Call Features");
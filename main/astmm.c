@@ -28,6 +28,27 @@
 	<support_level>core</support_level>
  ***/
 
+/*** DOCUMENTATION
+	<manager name="MemorySampleList" language="en_US">
+		<synopsis>
+			List the sampled memory allocation sites.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="File">
+				<para>Only list the allocation sites in this source file.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Returns a <literal>MemorySampleSite</literal> event for each
+			allocation site seen by the malloc debug sampling mode, largest
+			estimated live usage first.  Only available when Asterisk is built
+			with MALLOC_DEBUG.  Sampling is enabled with the
+			<literal>memory sample</literal> CLI command.</para>
+		</description>
+	</manager>
+ ***/
+
 #define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 
@@ -39,6 +60,7 @@
 
 #include "asterisk/cli.h"
 #include "asterisk/lock.h"
+#include "asterisk/manager.h"
 #include "asterisk/strings.h"
 #include "asterisk/unaligned.h"
 #include "asterisk/backtrace.h"
@@ -63,12 +85,31 @@ enum func_type {
 #define FENCE_MAGIC		0xfeedbabe	/*!< Allocated memory high/low fence overwrite check. */
 #define FREED_MAGIC		0xdeaddead	/*!< Freed memory wipe filler. */
 #define MALLOC_FILLER	0x55		/*!< Malloced memory filler.  Must not be zero. */
+#define UNSAMPLED_MAGIC	0xfeedface	/*!< Lower fence of memory not picked by sampling. */
 
 static FILE *mmlog;
 
+/*! \brief Allocation counters of a sampled allocation site. */
+struct ast_mm_site {
+	struct ast_mm_site *next;
+	unsigned int lineno;
+	/*! Number of allocations ever sampled at the site. */
+	unsigned int sampled_count;
+	/*! Bytes ever sampled at the site. */
+	unsigned int sampled_len;
+	/*! Number of sampled allocations still allocated. */
+	unsigned int live_count;
+	/*! Bytes of sampled allocations still allocated. */
+	unsigned int live_len;
+	char file[64];
+	char func[40];
+};
+
 struct ast_region {
 	AST_LIST_ENTRY(ast_region) node;
 	struct ast_bt *bt;
+	/*! Allocation site counters if the region was sampled. */
+	struct ast_mm_site *site;
 	size_t len;
 	unsigned int cache;		/* region was allocated as part of a cache pool */
 	unsigned int lineno;
@@ -98,6 +139,32 @@ struct ast_region {
 /*! Hash table of lists of active allocated memory regions. */
 static struct ast_region *regions[SOME_PRIME];
 
+/*!
+ * \brief Header of an allocation not picked by sampling.
+ *
+ * \details
+ * These allocations are not put in regions[] so they need no
+ * lock.  Only the high fence is checked when they are freed.
+ */
+struct ast_region_unsampled {
+	size_t len;
+	/*! \brief Lower guard fence.  Holds UNSAMPLED_MAGIC instead of FENCE_MAGIC. */
+	unsigned int fence;
+	unsigned char data[0] __attribute__((aligned));
+};
+
+/*! Hash table of sampled allocation sites.  The sites are never freed. */
+static struct ast_mm_site *sites[SOME_PRIME];
+
+/*! Track one in this many allocations.  Zero tracks all allocations without site counters. */
+static unsigned int sample_rate;
+/*! Allocation counter used to pick the allocations to sample. */
+static int sample_counter;
+/*! Number of allocations not picked by sampling still allocated. */
+static int unsampled_count;
+/*! Bytes of allocations not picked by sampling still allocated. */
+static int unsampled_len;
+
 /*! Number of freed regions to keep around to delay actually freeing them. */
 #define FREED_MAX_COUNT		1500
 
@@ -135,6 +202,7 @@ static int atexit_list;
 static int backtrace_enabled;
 
 #define HASH(a)		(((unsigned long)(a)) % ARRAY_LEN(regions))
+#define SITE_HASH(file, lineno)	(((unsigned int) ast_str_hash(file) + (lineno)) % ARRAY_LEN(sites))
 
 /*! Tracking this mutex will cause infinite recursion, as the mutex tracking
  *  code allocates memory */
@@ -210,12 +278,135 @@ static void my_do_crash(void)
 	ast_do_crash();
 }
 
+/*!
+ * \internal
+ * \brief Find or create the counters of the region's allocation site.
+ *
+ * \param reg Region just allocated at the site.
+ *
+ * \note reglock must be locked before calling.
+ *
+ * \retval site on success.
+ * \retval NULL on error.
+ */
+static struct ast_mm_site *site_get(struct ast_region *reg)
+{
+	struct ast_mm_site *site;
+	int hash;
+
+	hash = SITE_HASH(reg->file, reg->lineno);
+	for (site = sites[hash]; site; site = site->next) {
+		if (site->lineno == reg->lineno && !strcmp(site->file, reg->file)) {
+			return site;
+		}
+	}
+
+	site = calloc(1, sizeof(*site));
+	if (!site) {
+		return NULL;
+	}
+	site->lineno = reg->lineno;
+	ast_copy_string(site->file, reg->file, sizeof(site->file));
+	ast_copy_string(site->func, reg->func, sizeof(site->func));
+	site->next = sites[hash];
+	sites[hash] = site;
+
+	return site;
+}
+
+/*!
+ * \internal
+ * \brief Get the header of an allocation not picked by sampling.
+ *
+ * \param ptr Allocation payload data pointer.
+ *
+ * \retval header if the allocation was not sampled.
+ * \retval NULL if the allocation is a region.
+ */
+static struct ast_region_unsampled *region_unsampled(void *ptr)
+{
+	unsigned char *data = ptr;
+
+	if (*(unsigned int *) (data - sizeof(unsigned int)) != UNSAMPLED_MAGIC) {
+		return NULL;
+	}
+	return (struct ast_region_unsampled *) (data - offsetof(struct ast_region_unsampled, data));
+}
+
+/*!
+ * \internal
+ * \brief Allocate memory not picked by sampling.
+ *
+ * \details
+ * Nothing but the length and fences is recorded so no lock is
+ * needed.
+ *
+ * \return Allocation payload data pointer or NULL on error.
+ */
+static void *unsampled_alloc(size_t size, const char *file, int lineno, const char *func)
+{
+	struct ast_region_unsampled *blk;
+	unsigned int *fence;
+
+	if (!(blk = malloc(size + sizeof(*blk) + sizeof(*fence)))) {
+		astmm_log("Memory Allocation Failure - '%d' bytes at %s %s() line %d\n",
+			(int) size, file, func, lineno);
+		return NULL;
+	}
+
+	blk->len = size;
+	fence = (unsigned int *) (blk->data - sizeof(*fence));
+	*fence = UNSAMPLED_MAGIC;
+	fence = (unsigned int *) (blk->data + blk->len);
+	put_unaligned_uint32(fence, FENCE_MAGIC);
+
+	ast_atomic_fetchadd_int(&unsampled_count, 1);
+	ast_atomic_fetchadd_int(&unsampled_len, size);
+
+	return blk->data;
+}
+
+/*!
+ * \internal
+ * \brief Free memory not picked by sampling.
+ *
+ * \param blk Allocation header.
+ *
+ * \return Nothing
+ */
+static void unsampled_free(struct ast_region_unsampled *blk, const char *file, int lineno, const char *func)
+{
+	unsigned int *fence;
+
+	fence = (unsigned int *) (blk->data + blk->len);
+	if (get_unaligned_uint32(fence) != FENCE_MAGIC) {
+		astmm_log("WARNING: High fence violation of %p freed by %s %s() line %d\n",
+			blk->data, file, func, lineno);
+		my_do_crash();
+	}
+
+	/* Make a double free look like freeing unregistered memory. */
+	fence = (unsigned int *) (blk->data - sizeof(*fence));
+	*fence = FREED_MAGIC;
+
+	ast_atomic_fetchadd_int(&unsampled_count, -1);
+	ast_atomic_fetchadd_int(&unsampled_len, -(int) blk->len);
+
+	free(blk);
+}
+
 static void *__ast_alloc_region(size_t size, const enum func_type which, const char *file, int lineno, const char *func, unsigned int cache)
 {
 	struct ast_region *reg;
 	unsigned int *fence;
+	unsigned int rate;
 	int hash;
 
+	rate = sample_rate;
+	if (rate && (unsigned int) ast_atomic_fetchadd_int(&sample_counter, 1) % rate) {
+		return unsampled_alloc(size, file, lineno, func);
+	}
+
 	if (!(reg = malloc(size + sizeof(*reg) + sizeof(*fence)))) {
 		astmm_log("Memory Allocation Failure - '%d' bytes at %s %s() line %d\n",
 			(int) size, file, func, lineno);
@@ -226,7 +417,8 @@ static void *__ast_alloc_region(size_t size, const enum func_type which, const c
 	reg->cache = cache;
 	reg->lineno = lineno;
 	reg->which = which;
-	reg->bt = backtrace_enabled ? ast_bt_create() : NULL;
+	reg->bt = (backtrace_enabled || rate) ? ast_bt_create() : NULL;
+	reg->site = NULL;
 	ast_copy_string(reg->file, file, sizeof(reg->file));
 	ast_copy_string(reg->func, func, sizeof(reg->func));
 
@@ -248,6 +440,12 @@ static void *__ast_alloc_region(size_t size, const enum func_type which, const c
 	ast_mutex_lock(&reglock);
 	AST_LIST_NEXT(reg, node) = regions[hash];
 	regions[hash] = reg;
+	if (rate && (reg->site = site_get(reg))) {
+		++reg->site->sampled_count;
+		reg->site->sampled_len += reg->len;
+		++reg->site->live_count;
+		reg->site->live_len += reg->len;
+	}
 	ast_mutex_unlock(&reglock);
 
 	return reg->data;
@@ -388,6 +586,10 @@ static struct ast_region *region_remove(void *ptr)
 			} else {
 				regions[hash] = AST_LIST_NEXT(reg, node);
 			}
+			if (reg->site) {
+				--reg->site->live_count;
+				reg->site->live_len -= reg->len;
+			}
 			break;
 		}
 		prev = reg;
@@ -452,12 +654,19 @@ static void regions_check_all_fences(void)
 
 static void __ast_free_region(void *ptr, const char *file, int lineno, const char *func)
 {
+	struct ast_region_unsampled *blk;
 	struct ast_region *reg;
 
 	if (!ptr) {
 		return;
 	}
 
+	blk = region_unsampled(ptr);
+	if (blk) {
+		unsampled_free(blk, file, lineno, func);
+		return;
+	}
+
 	reg = region_remove(ptr);
 	if (reg) {
 		region_check_fences(reg);
@@ -542,10 +751,15 @@ static struct ast_region *region_find(void *ptr)
 void *__ast_realloc(void *ptr, size_t size, const char *file, int lineno, const char *func)
 {
 	size_t len;
+	struct ast_region_unsampled *blk;
 	struct ast_region *found;
 	void *new_mem;
 
-	if (ptr) {
+	blk = ptr ? region_unsampled(ptr) : NULL;
+	if (blk) {
+		found = NULL;
+		len = blk->len;
+	} else if (ptr) {
 		ast_mutex_lock(&reglock);
 		found = region_find(ptr);
 		if (!found) {
@@ -569,7 +783,7 @@ void *__ast_realloc(void *ptr, size_t size, const char *file, int lineno, const
 
 	new_mem = __ast_alloc_region(size, FUNC_REALLOC, file, lineno, func, 0);
 	if (new_mem) {
-		if (found) {
+		if (found || blk) {
 			/* Copy the old data to the new malloced memory. */
 			if (size <= len) {
 				memcpy(new_mem, ptr, size);
@@ -828,6 +1042,114 @@ static void print_memory_show_common_stats(int fd,
 		total_len + whales_len + minnows_len);
 }
 
+/*!
+ * \internal
+ * \brief Sort sampled allocation sites by live bytes, largest first.
+ */
+static int mm_site_cmp(const void *left, const void *right)
+{
+	const struct ast_mm_site *site_left = left;
+	const struct ast_mm_site *site_right = right;
+
+	if (site_left->live_len != site_right->live_len) {
+		return site_left->live_len < site_right->live_len ? 1 : -1;
+	}
+	if (site_left->sampled_len != site_right->sampled_len) {
+		return site_left->sampled_len < site_right->sampled_len ? 1 : -1;
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Copy the sampled allocation site counters.
+ *
+ * \param fn Only copy the sites in this file if not NULL.
+ * \param count Set to the number of sites copied.
+ *
+ * \details
+ * The copy lets the caller output the counters without holding
+ * reglock since the output itself allocates memory.
+ *
+ * \return Sorted site array to free with ast_std_free().  NULL if none.
+ */
+static struct ast_mm_site *mm_sites_copy(const char *fn, size_t *count)
+{
+	struct ast_mm_site *site;
+	struct ast_mm_site *copy;
+	size_t num = 0;
+	int idx;
+
+	*count = 0;
+
+	ast_mutex_lock(&reglock);
+	for (idx = 0; idx < ARRAY_LEN(sites); ++idx) {
+		for (site = sites[idx]; site; site = site->next) {
+			if (!fn || !strcasecmp(fn, site->file)) {
+				++num;
+			}
+		}
+	}
+	copy = num ? ast_std_calloc(num, sizeof(*copy)) : NULL;
+	if (!copy) {
+		ast_mutex_unlock(&reglock);
+		return NULL;
+	}
+	for (idx = 0; idx < ARRAY_LEN(sites); ++idx) {
+		for (site = sites[idx]; site; site = site->next) {
+			if (!fn || !strcasecmp(fn, site->file)) {
+				copy[*count] = *site;
+				copy[*count].next = NULL;
+				++*count;
+			}
+		}
+	}
+	ast_mutex_unlock(&reglock);
+
+	qsort(copy, *count, sizeof(*copy), mm_site_cmp);
+
+	return copy;
+}
+
+/*!
+ * \internal
+ * \brief Sampling summary output at the end of the memory show summary command.
+ *
+ * \param fd CLI output file descriptor.
+ * \param fn Only show the sites in this file if not NULL.
+ *
+ * \return Nothing
+ */
+static void print_memory_show_sample_stats(int fd, const char *fn)
+{
+	struct ast_mm_site *copy;
+	size_t count;
+	size_t idx;
+	unsigned int rate = sample_rate;
+
+	copy = mm_sites_copy(fn, &count);
+	if (!rate && !copy && !unsampled_count) {
+		return;
+	}
+
+	if (rate) {
+		ast_cli(fd, "\nSampling 1 in %u allocations:\n", rate);
+	} else {
+		ast_cli(fd, "\nSampling is off:\n");
+	}
+	for (idx = 0; idx < count; ++idx) {
+		ast_cli(fd, "%10u bytes estimated (%10u in %10u live, %10u in %10u sampled) by %20s() line %5u of %s\n",
+			copy[idx].live_len * (rate ?: 1),
+			copy[idx].live_len, copy[idx].live_count,
+			copy[idx].sampled_len, copy[idx].sampled_count,
+			copy[idx].func, copy[idx].lineno, copy[idx].file);
+	}
+	ast_std_free(copy);
+
+	ast_cli(fd, "%10u bytes in %u allocations not sampled\n",
+		(unsigned int) unsampled_len, (unsigned int) unsampled_count);
+}
+
 static char *handle_memory_show_allocations(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	const char *fn = NULL;
@@ -929,7 +1251,8 @@ static char *handle_memory_show_summary(struct ast_cli_entry *e, int cmd, struct
 		e->usage =
 			"Usage: memory show summary [<file>]\n"
 			"       Summarizes heap memory allocations by file, or optionally\n"
-			"       by line if a file is specified.\n";
+			"       by line if a file is specified.\n"
+			"       When sampling, the sampled allocation sites follow.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
@@ -1036,6 +1359,8 @@ static char *handle_memory_show_summary(struct ast_cli_entry *e, int cmd, struct
 		whales_len, minnows_len, total_len,
 		selected_len, cache_len, count);
 
+	print_memory_show_sample_stats(a->fd, fn);
+
 	return CLI_SUCCESS;
 }
 
@@ -1076,14 +1401,110 @@ static char *handle_memory_backtrace(struct ast_cli_entry *e, int cmd, struct as
 	return CLI_SUCCESS;
 }
 
+static char *handle_memory_sample(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int rate;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "memory sample";
+		e->usage =
+			"Usage: memory sample {off|<rate>}\n"
+			"       Only track one in <rate> memory allocations.\n"
+			"       The sampled allocations record their file, line, function,\n"
+			"       and backtrace and are counted by allocation site.  The other\n"
+			"       allocations only get fences and are not listed by the memory\n"
+			"       show commands.\n"
+			"       off - Track every allocation without site counters.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 2) {
+			const char * const options[] = { "off", NULL };
+
+			return ast_cli_complete(a->word, options, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (ast_false(a->argv[2])) {
+		rate = 0;
+	} else if (sscanf(a->argv[2], "%30u", &rate) != 1 || !rate) {
+		return CLI_SHOWUSAGE;
+	}
+	sample_rate = rate;
+
+	if (sample_rate) {
+		ast_cli(a->fd, "Memory allocation sampling is: 1 in %u\n", sample_rate);
+	} else {
+		ast_cli(a->fd, "Memory allocation sampling is: Off\n");
+	}
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_memory[] = {
 	AST_CLI_DEFINE(handle_memory_atexit_list, "Enable memory allocations not freed at exit list."),
 	AST_CLI_DEFINE(handle_memory_atexit_summary, "Enable memory allocations not freed at exit summary."),
 	AST_CLI_DEFINE(handle_memory_show_allocations, "Display outstanding memory allocations"),
 	AST_CLI_DEFINE(handle_memory_show_summary, "Summarize outstanding memory allocations"),
 	AST_CLI_DEFINE(handle_memory_backtrace, "Enable dumping an allocation backtrace with memory diagnostics."),
+	AST_CLI_DEFINE(handle_memory_sample, "Set the memory allocation sampling rate."),
 };
 
+static int manager_memory_sample_list(struct mansession *s, const struct message *m)
+{
+	const char *id = astman_get_header(m, "ActionID");
+	const char *fn = astman_get_header(m, "File");
+	char id_text[256] = "";
+	struct ast_mm_site *copy;
+	size_t count;
+	size_t idx;
+	unsigned int rate = sample_rate;
+
+	if (!ast_strlen_zero(id)) {
+		snprintf(id_text, sizeof(id_text), "ActionID: %s\r\n", id);
+	}
+
+	copy = mm_sites_copy(S_OR(fn, NULL), &count);
+
+	astman_send_listack(s, m, "Memory sample site listing will follow", "start");
+
+	for (idx = 0; idx < count; ++idx) {
+		astman_append(s,
+			"Event: MemorySampleSite\r\n"
+			"File: %s\r\n"
+			"Function: %s\r\n"
+			"Line: %u\r\n"
+			"EstimatedBytes: %u\r\n"
+			"LiveBytes: %u\r\n"
+			"LiveAllocations: %u\r\n"
+			"SampledBytes: %u\r\n"
+			"SampledAllocations: %u\r\n"
+			"%s"
+			"\r\n",
+			copy[idx].file, copy[idx].func, copy[idx].lineno,
+			copy[idx].live_len * (rate ?: 1),
+			copy[idx].live_len, copy[idx].live_count,
+			copy[idx].sampled_len, copy[idx].sampled_count,
+			id_text);
+	}
+	ast_std_free(copy);
+
+	astman_send_list_complete_start(s, m, "MemorySampleListComplete", count);
+	astman_append(s,
+		"SampleRate: %u\r\n"
+		"UnsampledBytes: %u\r\n"
+		"UnsampledAllocations: %u\r\n",
+		rate, (unsigned int) unsampled_len, (unsigned int) unsampled_count);
+	astman_send_list_complete_end(s);
+
+	return 0;
+}
+
 AST_LIST_HEAD_NOLOCK(region_list, ast_region);
 
 /*!
@@ -1530,6 +1951,7 @@ void __ast_mm_init_phase_1(void)
 static void mm_atexit_ast(void)
 {
 	ast_cli_unregister_multiple(cli_memory, ARRAY_LEN(cli_memory));
+	ast_manager_unregister("MemorySampleList");
 }
 
 /*!
@@ -1542,6 +1964,7 @@ void __ast_mm_init_phase_2(void)
 	char filename[PATH_MAX];
 
 	ast_cli_register_multiple(cli_memory, ARRAY_LEN(cli_memory));
+	ast_manager_register_xml_core("MemorySampleList", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, manager_memory_sample_list);
 
 	snprintf(filename, sizeof(filename), "%s/mmlog", ast_config_AST_LOG_DIR);
 
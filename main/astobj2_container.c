@@ -45,7 +45,18 @@ int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flag
 		return 0;
 	}
 
-	if ((flags & AO2_UNLINK_NODE_UNLINK_OBJECT)
+	if (container && node->obj && CONTAINER_IS_RCU(container)) {
+		/*
+		 * A lock-free reader may still be looking at the object so a
+		 * reference must be held until it is done.
+		 */
+		if (!(flags & AO2_UNLINK_NODE_UNLINK_OBJECT)
+			|| (flags & AO2_UNLINK_NODE_NOUNREF_OBJECT)) {
+			/* The container's reference was transferred to the caller. */
+			__ao2_ref(node->obj, +1, tag ?: "Hold obj for RCU readers", file, line, func);
+		}
+		container_rcu_release(container, node->obj);
+	} else if ((flags & AO2_UNLINK_NODE_UNLINK_OBJECT)
 		&& !(flags & AO2_UNLINK_NODE_NOUNREF_OBJECT)) {
 		__ao2_ref(node->obj, -1, tag ?: "Remove obj from container", file, line, func);
 	}
@@ -295,6 +306,24 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 		}
 	}
 
+	if (CONTAINER_IS_RCU(self) && self->v_table->lookup
+		&& type == AO2_CALLBACK_DEFAULT
+		&& !(flags & (OBJ_MULTIPLE | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK))
+		&& ((flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_OBJECT
+			|| (flags & OBJ_SEARCH_MASK) == OBJ_SEARCH_KEY)
+		&& ((flags & OBJ_ORDER_MASK) == OBJ_ORDER_ASCENDING
+			|| (flags & OBJ_ORDER_MASK) == OBJ_ORDER_PRE)) {
+		struct ao2_rcu_reader *reader;
+
+		/* A plain search of a read-mostly container does not need the lock. */
+		reader = container_rcu_read_lock();
+		if (reader) {
+			ret = self->v_table->lookup(self, flags, cb_default, arg, tag, file, line, func);
+			container_rcu_read_unlock(reader);
+			return ret;
+		}
+	}
+
 	/* avoid modifications to the content */
 	if (flags & OBJ_NOLOCK) {
 		if (flags & OBJ_UNLINK) {
@@ -381,13 +410,14 @@ static void *internal_ao2_traverse(struct ao2_container *self, enum search_flags
 			break;
 		}
 	}
-	if (self->v_table->traverse_cleanup) {
-		self->v_table->traverse_cleanup(traversal_state);
-	}
 	if (node) {
 		/* Unref the node from self->v_table->traverse_first/traverse_next() */
 		ao2_t_ref(node, -1, NULL);
 	}
+	if (self->v_table->traverse_cleanup) {
+		/* Done after the node unref so the cleanup can reclaim the node. */
+		self->v_table->traverse_cleanup(traversal_state);
+	}
 
 	if (flags & OBJ_NOLOCK) {
 		__adjust_lock(self, orig_lock, 0);
@@ -477,6 +507,7 @@ void ao2_iterator_restart(struct ao2_iterator *iter)
 
 		ao2_t_ref(iter->last_node, -1, NULL);
 		iter->last_node = NULL;
+		ast_atomic_fetchadd_int(&iter->c->iterators, -1);
 
 		if (iter->flags & AO2_ITERATOR_DONTLOCK) {
 			__adjust_lock(iter->c, orig_lock, 0);
@@ -573,6 +604,11 @@ void *__ao2_iterator_next(struct ao2_iterator *iter,
 	/* Replace the iterator's node */
 	if (iter->last_node) {
 		ao2_t_ref(iter->last_node, -1, NULL);
+		if (!node) {
+			ast_atomic_fetchadd_int(&iter->c->iterators, -1);
+		}
+	} else if (node) {
+		ast_atomic_fetchadd_int(&iter->c->iterators, +1);
 	}
 	iter->last_node = node;
 
@@ -1091,6 +1127,10 @@ static void container_cleanup(void)
 
 int container_init(void)
 {
+	if (container_rcu_init()) {
+		return -1;
+	}
+
 #if defined(AO2_DEBUG)
 	reg_containers = ao2_t_container_alloc_list(AO2_ALLOC_OPT_LOCK_RWLOCK,
 		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, ao2_reg_sort_cb, NULL,
@@ -157,6 +157,27 @@ typedef struct ao2_container_node *(*ao2_container_find_next_fn)(struct ao2_cont
  */
 typedef void (*ao2_container_find_cleanup_fn)(void *v_state);
 
+/*!
+ * \brief Find an object in the container without locking it.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control the search.
+ * \param cb_fn Comparison callback.
+ * \param arg Comparison callback arg parameter.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \note Called inside a container_rcu_read_lock() section.
+ *
+ * \retval obj-ptr of found object (Reffed).
+ * \retval NULL when no object found.
+ */
+typedef void *(*ao2_container_lookup_fn)(struct ao2_container *self, enum search_flags flags,
+	ao2_callback_fn *cb_fn, void *arg, const char *tag, const char *file, int line, const char *func);
+
 /*!
  * \brief Find the next non-empty iteration node in the container.
  *
@@ -251,6 +272,8 @@ struct ao2_container_methods {
 	ao2_container_find_cleanup_fn traverse_cleanup;
 	/*! Find the next iteration element in the container. */
 	ao2_iterator_next_fn iterator_next;
+	/*! Find an object without locking the container. (Optional) */
+	ao2_container_lookup_fn lookup;
 #if defined(AO2_DEBUG)
 	/*! Increment the container linked object statistic. */
 	ao2_link_node_stat_fn link_stat;
@@ -290,6 +313,8 @@ struct ao2_container {
 	uint32_t options;
 	/*! Number of elements in the container. */
 	int elements;
+	/*! Number of iterators currently holding a node of the container. */
+	int iterators;
 #if defined(AO2_DEBUG)
 	/*! Number of nodes in the container. */
 	int nodes;
@@ -328,4 +353,67 @@ int __container_unlink_node_debug(struct ao2_container_node *node, uint32_t flag
 void container_destruct(void *_c);
 int container_init(void);
 
+/*!
+ * \brief TRUE if readers of the container may be walking it without the lock.
+ * \since 15.0.0
+ *
+ * \note Lock-free readers need the compiler's atomic builtins.  Without
+ * them RCU containers are searched with the lock like any other.
+ */
+#if defined(HAVE_GCC_ATOMICS)
+#define CONTAINER_IS_RCU(container) ((container)->options & AO2_CONTAINER_ALLOC_OPT_RCU)
+/*! \brief Store a pointer that lock-free readers may be loading. */
+#define CONTAINER_RCU_ASSIGN(ptr, val)	__atomic_store_n(&(ptr), (val), __ATOMIC_RELEASE)
+/*! \brief Load a pointer that a writer may be changing. */
+#define CONTAINER_RCU_DEREF(ptr)	__atomic_load_n(&(ptr), __ATOMIC_ACQUIRE)
+/*! \brief Make earlier stores visible before a following pointer store publishes them. */
+#define CONTAINER_RCU_FENCE()	__atomic_thread_fence(__ATOMIC_RELEASE)
+#else
+#define CONTAINER_IS_RCU(container) 0
+#define CONTAINER_RCU_ASSIGN(ptr, val)	((ptr) = (val))
+#define CONTAINER_RCU_DEREF(ptr)	(ptr)
+#define CONTAINER_RCU_FENCE()
+#endif	/* defined(HAVE_GCC_ATOMICS) */
+
+struct ao2_rcu_reader;
+
+/*!
+ * \brief Enter a lock-free read section.
+ * \since 15.0.0
+ *
+ * \details Nodes and objects of RCU containers seen inside the read
+ * section stay allocated until the section is left.  Read sections
+ * may nest.
+ *
+ * \retval reader to pass to container_rcu_read_unlock().
+ * \retval NULL if the caller must take the container lock instead.
+ */
+struct ao2_rcu_reader *container_rcu_read_lock(void);
+
+/*!
+ * \brief Leave a lock-free read section.
+ * \since 15.0.0
+ *
+ * \param reader Returned by container_rcu_read_lock().
+ *
+ * \return Nothing
+ */
+void container_rcu_read_unlock(struct ao2_rcu_reader *reader);
+
+/*!
+ * \brief Release a reference once no lock-free reader can still see it.
+ * \since 15.0.0
+ *
+ * \param self RCU container the node or object was taken out of.
+ * \param obj ao2 object whose reference is released.
+ *
+ * \note The reference is released right away if the container is
+ * being destroyed.
+ *
+ * \return Nothing
+ */
+void container_rcu_release(struct ao2_container *self, void *obj);
+
+int container_rcu_init(void);
+
 #endif /* ASTOBJ2_CONTAINER_PRIVATE_H_ */
@@ -44,6 +44,8 @@ struct hash_bucket_node {
 	AST_DLLIST_ENTRY(hash_bucket_node) links;
 	/*! Hash bucket holding the node. */
 	int my_bucket;
+	/*! Hash value of the object so a resizable container can split buckets. */
+	int hash;
 };
 
 struct hash_bucket {
@@ -57,10 +59,30 @@ struct hash_bucket {
 #endif	/* defined(AO2_DEBUG) */
 };
 
+/*!
+ * \brief Load factor above which a resizable hash container adds a bucket.
+ * \since 15.0.0
+ */
+#define HASH_RESIZE_LOAD	1
+
+/*!
+ * \brief Upper bound on the buckets of a resizable hash container.
+ * \since 15.0.0
+ */
+#define HASH_RESIZE_MAX_BUCKETS	(1 << 24)
+
 /*!
  * A hash container in addition to values common to all
  * container types, stores the hash callback function, the
  * number of hash buckets, and the hash bucket heads.
+ *
+ * \note A container created with AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE
+ * grows by linear hashing.  Each link that finds the load factor
+ * above HASH_RESIZE_LOAD splits one bucket of the current round
+ * into a new bucket at the end of the array.  Buckets before the
+ * split point are addressed modulo twice the round size, the rest
+ * modulo the round size.  No single link ever rehashes more than
+ * one bucket.
  */
 struct ao2_container_hash {
 	/*!
@@ -71,8 +93,16 @@ struct ao2_container_hash {
 	ao2_hash_fn *hash_fn;
 	/*! Number of hash buckets in this container. */
 	int n_buckets;
-	/*! Hash bucket array of n_buckets.  Variable size. */
-	struct hash_bucket buckets[0];
+	/*! Number of buckets at the start of the current split round. */
+	int round_buckets;
+	/*! Number of hash buckets allocated in the buckets array. */
+	int max_buckets;
+	/*! Number of traversals in progress on a resizable container. */
+	int traversals;
+	/*! Hash bucket array of max_buckets. */
+	struct hash_bucket *buckets;
+	/*! Hash bucket array allocated with the container.  Variable size. */
+	struct hash_bucket first_buckets[0];
 };
 
 /*! Traversal state to restart a hash container traversal. */
@@ -87,6 +117,8 @@ struct hash_traversal_state {
 	int bucket_last;
 	/*! Saved search flags to control traversing the container. */
 	enum search_flags flags;
+	/*! Container being traversed. */
+	struct ao2_container_hash *self;
 	/*! TRUE if it is a descending search */
 	unsigned int descending:1;
 };
@@ -99,6 +131,210 @@ struct hash_traversal_state_check {
 	char check[1 / (AO2_TRAVERSAL_STATE_SIZE / sizeof(struct hash_traversal_state))];
 };
 
+/*!
+ * \internal
+ * \brief Compute the bucket holding the given hash value.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param hash Hash value to locate.
+ *
+ * \return Bucket index.
+ */
+static int hash_ao2_bucket(struct ao2_container_hash *self, int hash)
+{
+	unsigned int bucket;
+
+	if (!(self->common.options & AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE)) {
+		return abs(hash % self->n_buckets);
+	}
+
+	bucket = (unsigned int) hash % self->round_buckets;
+	if (bucket < self->n_buckets - self->round_buckets) {
+		/* The bucket has already been split this round. */
+		bucket = (unsigned int) hash % (self->round_buckets * 2);
+	}
+	return bucket;
+}
+
+/*!
+ * \internal
+ * \brief Split one bucket of a resizable container if it is overloaded.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ *
+ * \note The container must be write locked.
+ *
+ * \note Nothing is moved while a traversal or an iterator has a
+ * position in the container.  Moving nodes behind their back
+ * would make them skip or revisit objects.  The split is simply
+ * retried by a later link.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_grow(struct ao2_container_hash *self)
+{
+	struct hash_bucket *old_bucket;
+	struct hash_bucket *new_bucket;
+	struct hash_bucket_node *node;
+	unsigned int next_round;
+	int old_idx;
+	int new_idx;
+
+	if (ao2_container_count(&self->common) < self->n_buckets * HASH_RESIZE_LOAD
+		|| HASH_RESIZE_MAX_BUCKETS <= self->n_buckets
+		|| self->traversals || self->common.iterators) {
+		return;
+	}
+
+	if (self->n_buckets == self->max_buckets) {
+		struct hash_bucket *buckets;
+		int max_buckets = self->max_buckets * 2;
+
+		/*
+		 * Only the list heads are copied.  The nodes do not point back
+		 * at their bucket head so they do not need to be touched.
+		 */
+		if (self->buckets == self->first_buckets) {
+			buckets = ast_malloc(max_buckets * sizeof(*buckets));
+			if (buckets) {
+				memcpy(buckets, self->buckets, self->n_buckets * sizeof(*buckets));
+			}
+		} else {
+			buckets = ast_realloc(self->buckets, max_buckets * sizeof(*buckets));
+		}
+		if (!buckets) {
+			return;
+		}
+		self->buckets = buckets;
+		self->max_buckets = max_buckets;
+	}
+
+	next_round = self->round_buckets * 2;
+	old_idx = self->n_buckets - self->round_buckets;
+	new_idx = self->n_buckets;
+	old_bucket = &self->buckets[old_idx];
+	new_bucket = &self->buckets[new_idx];
+	memset(new_bucket, 0, sizeof(*new_bucket));
+
+	/* Moving the nodes in order keeps a sorted bucket sorted. */
+	AST_DLLIST_TRAVERSE_SAFE_BEGIN(&old_bucket->list, node, links) {
+		if ((unsigned int) node->hash % next_round == old_idx) {
+			continue;
+		}
+		AST_DLLIST_MOVE_CURRENT(&new_bucket->list, links);
+		node->my_bucket = new_idx;
+#if defined(AO2_DEBUG)
+		if (node->common.obj) {
+			--old_bucket->elements;
+			++new_bucket->elements;
+		}
+#endif	/* defined(AO2_DEBUG) */
+	}
+	AST_DLLIST_TRAVERSE_SAFE_END;
+#if defined(AO2_DEBUG)
+	new_bucket->max_elements = new_bucket->elements;
+#endif	/* defined(AO2_DEBUG) */
+
+	if (++self->n_buckets == next_round) {
+		/* Every bucket of the round has been split.  Start the next round. */
+		self->round_buckets = next_round;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Take a node out of its bucket without disturbing lock-free readers.
+ * \since 15.0.0
+ *
+ * \param bucket Bucket holding the node.
+ * \param node Node to remove.
+ *
+ * \note The node keeps its own next link so a reader standing on it
+ * can still finish walking the bucket.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_rcu_remove(struct hash_bucket *bucket, struct hash_bucket_node *node)
+{
+	struct hash_bucket_node *next = AST_DLLIST_NEXT(node, links);
+	struct hash_bucket_node *prev = AST_DLLIST_PREV(node, links);
+
+	if (next) {
+		next->links.last = prev;
+	} else {
+		bucket->list.last = prev;
+	}
+	if (prev) {
+		CONTAINER_RCU_ASSIGN(prev->links.first, next);
+	} else {
+		CONTAINER_RCU_ASSIGN(bucket->list.first, next);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Reclaim the empty nodes of an RCU container bucket.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param idx Bucket to sweep.
+ *
+ * \details Lock-free readers may be standing on a node when it is
+ * released so the nodes of an RCU container are not taken out of
+ * their bucket by the node destructor.  The bucket holds a node
+ * reference of its own instead.  Once an emptied node has nothing but
+ * that reference left nobody can reach it through the container and
+ * it is removed here.  The bucket's reference is released after the
+ * readers have moved on.
+ *
+ * \note The container must be write locked.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_rcu_sweep(struct ao2_container_hash *self, int idx)
+{
+	struct hash_bucket *bucket = &self->buckets[idx];
+	struct hash_bucket_node *node;
+	struct hash_bucket_node *next;
+
+	for (node = AST_DLLIST_FIRST(&bucket->list); node; node = next) {
+		next = AST_DLLIST_NEXT(node, links);
+		if (node->common.obj || ao2_ref(node, 0) != 1) {
+			continue;
+		}
+		hash_ao2_rcu_remove(bucket, node);
+		node->common.is_linked = 0;
+		AO2_DEVMODE_STAT(--self->common.nodes);
+		container_rcu_release(&self->common, node);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Set the next link of a node about to be linked into an RCU container.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param node Node about to be linked.
+ * \param next Node that will follow it in the bucket.
+ *
+ * \details A lock-free reader may load the node as soon as its
+ * predecessor points at it.  Its contents and next link must be
+ * visible by then.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_rcu_prepare(struct ao2_container_hash *self,
+	struct hash_bucket_node *node, struct hash_bucket_node *next)
+{
+	if (CONTAINER_IS_RCU(&self->common)) {
+		node->links.first = next;
+		CONTAINER_RCU_FENCE();
+	}
+}
+
 /*!
  * \internal
  * \brief Create an empty copy of this container.
@@ -215,7 +451,12 @@ static struct hash_bucket_node *hash_ao2_new_node(struct ao2_container_hash *sel
 		return NULL;
 	}
 
-	i = abs(self->hash_fn(obj_new, OBJ_SEARCH_OBJECT) % self->n_buckets);
+	if (self->common.options & AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE) {
+		hash_ao2_grow(self);
+	}
+
+	node->hash = self->hash_fn(obj_new, OBJ_SEARCH_OBJECT);
+	i = hash_ao2_bucket(self, node->hash);
 
 	__ao2_ref(obj_new, +1, tag ?: "Container node creation", file, line, func);
 	node->common.obj = obj_new;
@@ -256,6 +497,7 @@ static enum ao2_container_insert hash_ao2_insert_node(struct ao2_container_hash
 					continue;
 				}
 				if (cmp < 0) {
+					hash_ao2_rcu_prepare(self, node, AST_DLLIST_NEXT(cur, links));
 					AST_DLLIST_INSERT_AFTER_CURRENT(node, links);
 					return AO2_CONTAINER_INSERT_NODE_INSERTED;
 				}
@@ -280,6 +522,7 @@ static enum ao2_container_insert hash_ao2_insert_node(struct ao2_container_hash
 			}
 			AST_DLLIST_TRAVERSE_BACKWARDS_SAFE_END;
 		}
+		hash_ao2_rcu_prepare(self, node, AST_DLLIST_FIRST(&bucket->list));
 		AST_DLLIST_INSERT_HEAD(&bucket->list, node, links);
 	} else {
 		if (sort_fn) {
@@ -289,6 +532,7 @@ static enum ao2_container_insert hash_ao2_insert_node(struct ao2_container_hash
 					continue;
 				}
 				if (cmp > 0) {
+					hash_ao2_rcu_prepare(self, node, cur);
 					AST_DLLIST_INSERT_BEFORE_CURRENT(node, links);
 					return AO2_CONTAINER_INSERT_NODE_INSERTED;
 				}
@@ -313,11 +557,108 @@ static enum ao2_container_insert hash_ao2_insert_node(struct ao2_container_hash
 			}
 			AST_DLLIST_TRAVERSE_SAFE_END;
 		}
+		hash_ao2_rcu_prepare(self, node, NULL);
 		AST_DLLIST_INSERT_TAIL(&bucket->list, node, links);
 	}
 	return AO2_CONTAINER_INSERT_NODE_INSERTED;
 }
 
+/*!
+ * \internal
+ * \brief Insert a node into this container.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param node Container node to insert into the container.
+ *
+ * \return enum ao2_container_insert value.
+ */
+static enum ao2_container_insert hash_ao2_insert(struct ao2_container_hash *self,
+	struct hash_bucket_node *node)
+{
+	enum ao2_container_insert res;
+
+	if (!CONTAINER_IS_RCU(&self->common)) {
+		return hash_ao2_insert_node(self, node);
+	}
+
+	hash_ao2_rcu_sweep(self, node->my_bucket);
+	res = hash_ao2_insert_node(self, node);
+	if (res == AO2_CONTAINER_INSERT_NODE_INSERTED) {
+		/* The bucket's own reference.  See hash_ao2_rcu_sweep(). */
+		ao2_t_ref(node, +1, NULL);
+	}
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Find an object in an RCU container without locking it.
+ * \since 15.0.0
+ *
+ * \param self Container to operate upon.
+ * \param flags search_flags to control the search.
+ * \param cb_fn Comparison callback.
+ * \param arg Comparison callback arg parameter.
+ * \param tag used for debugging.
+ * \param file Debug file name invoked from
+ * \param line Debug line invoked from
+ * \param func Debug function name invoked from
+ *
+ * \note Called inside a container_rcu_read_lock() section.
+ *
+ * \retval obj-ptr of found object (Reffed).
+ * \retval NULL when no object found.
+ */
+static void *hash_ao2_lookup(struct ao2_container_hash *self, enum search_flags flags,
+	ao2_callback_fn *cb_fn, void *arg, const char *tag, const char *file, int line, const char *func)
+{
+	struct hash_bucket_node *node;
+	ao2_sort_fn *sort_fn = self->common.sort_fn;
+	void *obj;
+	int bucket_cur;
+	int cmp;
+	int match;
+
+	bucket_cur = hash_ao2_bucket(self, self->hash_fn(arg, flags & OBJ_SEARCH_MASK));
+	for (node = CONTAINER_RCU_DEREF(self->buckets[bucket_cur].list.first);
+		node;
+		node = CONTAINER_RCU_DEREF(node->links.first)) {
+		obj = CONTAINER_RCU_DEREF(node->common.obj);
+		if (!obj) {
+			/* Node is empty */
+			continue;
+		}
+
+		if (sort_fn) {
+			/* Filter node through the sort_fn */
+			cmp = sort_fn(obj, arg, flags & OBJ_SEARCH_MASK);
+			if (cmp < 0) {
+				continue;
+			}
+			if (cmp > 0) {
+				/* No more nodes in this bucket are possible to match. */
+				break;
+			}
+		}
+
+		match = cb_fn(obj, arg, flags) & (CMP_MATCH | CMP_STOP);
+		if (!match) {
+			continue;
+		}
+		if (match == CMP_STOP) {
+			/* no match but stop, we are done */
+			break;
+		}
+
+		/* The container's deferred reference keeps the object alive. */
+		__ao2_ref(obj, +1, tag ?: "Lock-free lookup found object", file, line, func);
+		return obj;
+	}
+
+	return NULL;
+}
+
 /*!
  * \internal
  * \brief Find the first hash container node in a traversal.
@@ -338,9 +679,15 @@ static struct hash_bucket_node *hash_ao2_find_first(struct ao2_container_hash *s
 	int cmp;
 
 	memset(state, 0, sizeof(*state));
+	state->self = self;
 	state->arg = arg;
 	state->flags = flags;
 
+	if (self->common.options & AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE) {
+		/* Keep the buckets from being split under the traversal. */
+		ast_atomic_fetchadd_int(&self->traversals, +1);
+	}
+
 	/* Determine traversal order. */
 	switch (flags & OBJ_ORDER_MASK) {
 	case OBJ_ORDER_POST:
@@ -361,8 +708,7 @@ static struct hash_bucket_node *hash_ao2_find_first(struct ao2_container_hash *s
 	case OBJ_SEARCH_OBJECT:
 	case OBJ_SEARCH_KEY:
 		/* we know hash can handle this case */
-		bucket_cur = abs(self->hash_fn(arg, flags & OBJ_SEARCH_MASK)
-				% self->n_buckets);
+		bucket_cur = hash_ao2_bucket(self, self->hash_fn(arg, flags & OBJ_SEARCH_MASK));
 		state->sort_fn = self->common.sort_fn;
 		break;
 	case OBJ_SEARCH_PARTIAL_KEY:
@@ -594,6 +940,40 @@ hash_ascending_resume:;
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief Cleanup the hash container traversal state.
+ * \since 15.0.0
+ *
+ * \param state Traversal state to cleanup.
+ *
+ * \return Nothing
+ */
+static void hash_ao2_find_cleanup(struct hash_traversal_state *state)
+{
+	struct ao2_container_hash *self = state->self;
+	int bucket;
+	int last;
+
+	if (self->common.options & AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE) {
+		ast_atomic_fetchadd_int(&self->traversals, -1);
+	}
+
+	if (CONTAINER_IS_RCU(&self->common) && (state->flags & OBJ_UNLINK)) {
+		/* The unlinking traversal holds the write lock.  Reclaim what it emptied. */
+		if (state->descending) {
+			bucket = state->bucket_last;
+			last = state->bucket_start;
+		} else {
+			bucket = state->bucket_start;
+			last = state->bucket_last - 1;
+		}
+		for (; bucket <= last; ++bucket) {
+			hash_ao2_rcu_sweep(self, bucket);
+		}
+	}
+}
+
 /*!
  * \internal
  * \brief Find the next non-empty iteration node in the container.
@@ -739,6 +1119,13 @@ static void hash_ao2_destroy(struct ao2_container_hash *self)
 {
 	int idx;
 
+	if (CONTAINER_IS_RCU(&self->common)) {
+		/* Release the references the buckets still hold on emptied nodes. */
+		for (idx = self->n_buckets; idx--;) {
+			hash_ao2_rcu_sweep(self, idx);
+		}
+	}
+
 	/* Check that the container no longer has any nodes */
 	for (idx = self->n_buckets; idx--;) {
 		if (!AST_DLLIST_EMPTY(&self->buckets[idx].list)) {
@@ -747,6 +1134,10 @@ static void hash_ao2_destroy(struct ao2_container_hash *self)
 			break;
 		}
 	}
+
+	if (self->buckets != self->first_buckets) {
+		ast_free(self->buckets);
+	}
 }
 
 #if defined(AO2_DEBUG)
@@ -824,8 +1215,13 @@ static void hash_ao2_stats(struct ao2_container_hash *self, void *where, ao2_prn
 
 	int bucket;
 	int suppressed_buckets = 0;
+	int load;
 
-	prnt(where, "Number of buckets: %d\n\n", self->n_buckets);
+	load = ao2_container_count(&self->common) * 100 / self->n_buckets;
+
+	prnt(where, "Number of buckets: %d\n", self->n_buckets);
+	prnt(where, "Load factor: %d.%02d%s\n\n", load / 100, load % 100,
+		(self->common.options & AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE) ? " (resizable)" : "");
 
 	prnt(where, FORMAT, "Bucket", "Objects", "Max");
 	for (bucket = 0; bucket < self->n_buckets; ++bucket) {
@@ -959,8 +1355,8 @@ static int hash_ao2_integrity(struct ao2_container_hash *self)
 			++count_obj;
 
 			/* Check container hash key for expected bucket. */
-			bucket_exp = abs(self->hash_fn(node->common.obj, OBJ_SEARCH_OBJECT)
-					% self->n_buckets);
+			bucket_exp = hash_ao2_bucket(self,
+				self->hash_fn(node->common.obj, OBJ_SEARCH_OBJECT));
 			if (bucket != bucket_exp) {
 				ast_log(LOG_ERROR, "Bucket %d node hashes to bucket %d!\n",
 					bucket, bucket_exp);
@@ -1013,10 +1409,12 @@ static int hash_ao2_integrity(struct ao2_container_hash *self)
 static const struct ao2_container_methods v_table_hash = {
 	.alloc_empty_clone = (ao2_container_alloc_empty_clone_fn) hash_ao2_alloc_empty_clone,
 	.new_node = (ao2_container_new_node_fn) hash_ao2_new_node,
-	.insert = (ao2_container_insert_fn) hash_ao2_insert_node,
+	.insert = (ao2_container_insert_fn) hash_ao2_insert,
 	.traverse_first = (ao2_container_find_first_fn) hash_ao2_find_first,
 	.traverse_next = (ao2_container_find_next_fn) hash_ao2_find_next,
+	.traverse_cleanup = (ao2_container_find_cleanup_fn) hash_ao2_find_cleanup,
 	.iterator_next = (ao2_iterator_next_fn) hash_ao2_iterator_next,
+	.lookup = (ao2_container_lookup_fn) hash_ao2_lookup,
 	.destroy = (ao2_container_destroy_fn) hash_ao2_destroy,
 #if defined(AO2_DEBUG)
 	.link_stat = hash_ao2_link_node_stat,
@@ -1067,6 +1465,9 @@ static struct ao2_container *hash_ao2_container_init(
 	self->common.options = options;
 	self->hash_fn = hash_fn ? hash_fn : hash_zero;
 	self->n_buckets = n_buckets;
+	self->round_buckets = n_buckets;
+	self->max_buckets = n_buckets;
+	self->buckets = self->first_buckets;
 
 #ifdef AO2_DEBUG
 	ast_atomic_fetchadd_int(&ao2.total_containers, 1);
@@ -1085,6 +1486,13 @@ struct ao2_container *__ao2_container_alloc_hash(unsigned int ao2_options,
 	struct ao2_container_hash *self;
 
 	num_buckets = hash_fn ? n_buckets : 1;
+	if (!hash_fn || (container_options & AO2_CONTAINER_ALLOC_OPT_RCU)) {
+		/*
+		 * There is nothing to be gained by splitting a list, and lock-free
+		 * readers cannot cope with nodes moving between buckets.
+		 */
+		container_options &= ~AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE;
+	}
 	container_size = sizeof(struct ao2_container_hash) + num_buckets * sizeof(struct hash_bucket);
 
 	self = __ao2_alloc(container_size, container_destruct, ao2_options,
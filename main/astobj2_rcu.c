@@ -0,0 +1,341 @@
+/*
+ * astobj2_rcu - Deferred reference release for lock-free container readers.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Epoch based reclamation for AO2_CONTAINER_ALLOC_OPT_RCU containers.
+ *
+ * Readers of an RCU container walk its nodes without taking the
+ * container lock.  A writer that takes a node or an object out of
+ * such a container therefore cannot drop the container's reference
+ * right away.  The reference is handed to container_rcu_release()
+ * instead and only released once every reader that could still be
+ * looking at it has left its read section.
+ *
+ * Each thread that reads has a record announcing the global epoch it
+ * entered in.  The epoch may only advance once every reader inside a
+ * read section has seen the current epoch.  A reference deferred in
+ * epoch E is safe to release once the global epoch reaches E + 2.
+ * Records are never freed, a record whose thread has exited is reused
+ * by the next new reader thread.
+ */
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "astobj2_private.h"
+#include "astobj2_container_private.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/lock.h"
+#include "asterisk/utils.h"
+#include "asterisk/threadstorage.h"
+
+#if defined(HAVE_GCC_ATOMICS)
+
+/*! Microseconds the reclaim thread waits between attempts to advance the epoch. */
+#define RCU_RECLAIM_INTERVAL_US	1000
+
+/*! \brief A thread's read side record. */
+struct ao2_rcu_reader {
+	/*! Epoch the reader entered in shifted left one bit.  The low bit is set while reading. */
+	unsigned int state;
+	/*! Read section nesting depth.  Only used by the owning thread. */
+	unsigned int nesting;
+	/*! TRUE while a thread owns the record. */
+	int in_use;
+	/*! Next record in the list of all records. */
+	struct ao2_rcu_reader *next;
+};
+
+/*! \brief A reference waiting for the readers to move on. */
+struct rcu_deferred {
+	/*! ao2 object to unreference. */
+	void *obj;
+	/*! Global epoch when the reference was deferred. */
+	unsigned int epoch;
+	AST_LIST_ENTRY(rcu_deferred) list;
+};
+
+/*! \brief Per thread storage, points at the thread's read side record. */
+struct rcu_reader_ref {
+	struct ao2_rcu_reader *reader;
+};
+
+static void rcu_reader_cleanup(void *data);
+
+/*! \brief The read side record of each thread. */
+AST_THREADSTORAGE_CUSTOM(rcu_reader_ref, NULL, rcu_reader_cleanup);
+
+/*! All read side records ever created.  Records are only ever added. */
+static struct ao2_rcu_reader *rcu_readers;
+
+/*! Global epoch. */
+static unsigned int rcu_epoch;
+
+/*! Protects rcu_pending, rcu_reclaim_thread, and advancing rcu_epoch. */
+AST_MUTEX_DEFINE_STATIC(rcu_lock);
+
+/*! Signalled when a reference is deferred. */
+static ast_cond_t rcu_cond;
+
+/*! Deferred references in the order they were deferred. */
+static AST_LIST_HEAD_NOLOCK_STATIC(rcu_pending, rcu_deferred);
+
+/*! Thread releasing the deferred references. */
+static pthread_t rcu_reclaim_thread = AST_PTHREADT_NULL;
+
+/*!
+ * \internal
+ * \brief Give a thread's read side record back when the thread exits.
+ * \since 15.0.0
+ *
+ * \param data Thread's struct rcu_reader_ref.
+ *
+ * \return Nothing
+ */
+static void rcu_reader_cleanup(void *data)
+{
+	struct rcu_reader_ref *ref = data;
+
+	if (ref->reader) {
+		__atomic_store_n(&ref->reader->state, 0, __ATOMIC_RELEASE);
+		__atomic_store_n(&ref->reader->in_use, 0, __ATOMIC_RELEASE);
+	}
+	ast_free(ref);
+}
+
+/*!
+ * \internal
+ * \brief Claim an unused read side record or create a new one.
+ * \since 15.0.0
+ *
+ * \retval reader on success.
+ * \retval NULL on error.
+ */
+static struct ao2_rcu_reader *rcu_reader_claim(void)
+{
+	struct ao2_rcu_reader *reader;
+
+	for (reader = __atomic_load_n(&rcu_readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+		int unused = 0;
+
+		if (__atomic_compare_exchange_n(&reader->in_use, &unused, 1, 0,
+			__ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+			reader->nesting = 0;
+			return reader;
+		}
+	}
+
+	reader = ast_calloc(1, sizeof(*reader));
+	if (!reader) {
+		return NULL;
+	}
+	reader->in_use = 1;
+	reader->next = __atomic_load_n(&rcu_readers, __ATOMIC_RELAXED);
+	while (!__atomic_compare_exchange_n(&rcu_readers, &reader->next, reader, 0,
+		__ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+	}
+	return reader;
+}
+
+struct ao2_rcu_reader *container_rcu_read_lock(void)
+{
+	struct rcu_reader_ref *ref;
+	struct ao2_rcu_reader *reader;
+	unsigned int epoch;
+
+	ref = ast_threadstorage_get(&rcu_reader_ref, sizeof(*ref));
+	if (!ref) {
+		return NULL;
+	}
+	if (!ref->reader) {
+		ref->reader = rcu_reader_claim();
+		if (!ref->reader) {
+			return NULL;
+		}
+	}
+	reader = ref->reader;
+
+	if (reader->nesting++) {
+		return reader;
+	}
+
+	/*
+	 * Announce the epoch and make sure it is still current once the
+	 * announcement is visible.  Otherwise the reclaimer could have
+	 * advanced past us without noticing we are reading.
+	 */
+	do {
+		epoch = __atomic_load_n(&rcu_epoch, __ATOMIC_RELAXED);
+		__atomic_store_n(&reader->state, (epoch << 1) | 1, __ATOMIC_RELAXED);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	} while (epoch != __atomic_load_n(&rcu_epoch, __ATOMIC_RELAXED));
+
+	return reader;
+}
+
+void container_rcu_read_unlock(struct ao2_rcu_reader *reader)
+{
+	if (--reader->nesting) {
+		return;
+	}
+	__atomic_store_n(&reader->state, 0, __ATOMIC_RELEASE);
+}
+
+/*!
+ * \internal
+ * \brief Advance the global epoch if every reader has seen it.
+ * \since 15.0.0
+ *
+ * \note Must be called with rcu_lock held.
+ *
+ * \return Nothing
+ */
+static void rcu_try_advance(void)
+{
+	struct ao2_rcu_reader *reader;
+	unsigned int epoch = rcu_epoch;
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	for (reader = __atomic_load_n(&rcu_readers, __ATOMIC_ACQUIRE); reader; reader = reader->next) {
+		unsigned int state = __atomic_load_n(&reader->state, __ATOMIC_ACQUIRE);
+
+		if ((state & 1) && (state >> 1) != ((epoch << 1) >> 1)) {
+			/* This reader is still in an older epoch. */
+			return;
+		}
+	}
+	__atomic_store_n(&rcu_epoch, epoch + 1, __ATOMIC_SEQ_CST);
+}
+
+/*!
+ * \internal
+ * \brief Release deferred references once no reader can still see them.
+ * \since 15.0.0
+ *
+ * \param data Not used.
+ *
+ * \return Nothing
+ */
+static void *rcu_reclaim(void *data)
+{
+	for (;;) {
+		AST_LIST_HEAD_NOLOCK(, rcu_deferred) released;
+		struct rcu_deferred *deferred;
+
+		AST_LIST_HEAD_INIT_NOLOCK(&released);
+
+		ast_mutex_lock(&rcu_lock);
+		while (AST_LIST_EMPTY(&rcu_pending)) {
+			ast_cond_wait(&rcu_cond, &rcu_lock);
+		}
+		rcu_try_advance();
+		while ((deferred = AST_LIST_FIRST(&rcu_pending))
+			&& 2 <= rcu_epoch - deferred->epoch) {
+			AST_LIST_REMOVE_HEAD(&rcu_pending, list);
+			AST_LIST_INSERT_TAIL(&released, deferred, list);
+		}
+		ast_mutex_unlock(&rcu_lock);
+
+		if (AST_LIST_EMPTY(&released)) {
+			usleep(RCU_RECLAIM_INTERVAL_US);
+			continue;
+		}
+
+		/* Destructors may defer references of their own so the lock is not held. */
+		while ((deferred = AST_LIST_REMOVE_HEAD(&released, list))) {
+			ao2_t_ref(deferred->obj, -1, "Release deferred RCU container reference");
+			ast_free(deferred);
+		}
+	}
+
+	return NULL;
+}
+
+void container_rcu_release(struct ao2_container *self, void *obj)
+{
+	struct rcu_deferred *deferred;
+
+	if (self->destroying) {
+		/* Nobody can be reading a container that is being destroyed. */
+		ao2_t_ref(obj, -1, "Release RCU container reference");
+		return;
+	}
+
+	deferred = ast_calloc(1, sizeof(*deferred));
+
+	ast_mutex_lock(&rcu_lock);
+	if (!deferred) {
+		unsigned int epoch = rcu_epoch;
+
+		/* Fall back to waiting for the readers ourselves. */
+		while (rcu_epoch - epoch < 2) {
+			rcu_try_advance();
+			if (rcu_epoch - epoch < 2) {
+				ast_mutex_unlock(&rcu_lock);
+				sched_yield();
+				ast_mutex_lock(&rcu_lock);
+			}
+		}
+		ast_mutex_unlock(&rcu_lock);
+		ao2_t_ref(obj, -1, "Release RCU container reference");
+		return;
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	deferred->obj = obj;
+	deferred->epoch = rcu_epoch;
+	AST_LIST_INSERT_TAIL(&rcu_pending, deferred, list);
+
+	if (rcu_reclaim_thread == AST_PTHREADT_NULL
+		&& ast_pthread_create_detached_background(&rcu_reclaim_thread, NULL, rcu_reclaim, NULL)) {
+		ast_log(LOG_ERROR, "Unable to start the RCU container reclaim thread\n");
+		rcu_reclaim_thread = AST_PTHREADT_NULL;
+	}
+	ast_cond_signal(&rcu_cond);
+	ast_mutex_unlock(&rcu_lock);
+}
+
+int container_rcu_init(void)
+{
+	ast_cond_init(&rcu_cond, NULL);
+	return 0;
+}
+
+#else	/* !defined(HAVE_GCC_ATOMICS) */
+
+struct ao2_rcu_reader *container_rcu_read_lock(void)
+{
+	return NULL;
+}
+
+void container_rcu_read_unlock(struct ao2_rcu_reader *reader)
+{
+}
+
+void container_rcu_release(struct ao2_container *self, void *obj)
+{
+	/* Without atomics every reader takes the container lock. */
+	ao2_t_ref(obj, -1, "Release RCU container reference");
+}
+
+int container_rcu_init(void)
+{
+	return 0;
+}
+
+#endif	/* defined(HAVE_GCC_ATOMICS) */
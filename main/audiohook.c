@@ -47,6 +47,19 @@
 
 #define DEFAULT_INTERNAL_SAMPLE_RATE 8000
 
+/*! Most samples of silence fed to muted spies without translating the frame */
+#define AUDIOHOOK_SILENCE_MAX_SAMPLES 4096
+
+/*! \brief What the audiohooks of a list need from the frames of a direction */
+enum audiohook_list_needs {
+	/*! Audio has to be translated to signed linear for a spy, whisper or manipulate hook */
+	AUDIOHOOK_NEEDS_SLIN = (1 << 0),
+	/*! A spy is muted in the direction and is fed silence */
+	AUDIOHOOK_NEEDS_SILENCE = (1 << 1),
+	/*! A manipulate hook wants DTMF */
+	AUDIOHOOK_NEEDS_DTMF = (1 << 2),
+};
+
 struct ast_audiohook_translate {
 	struct ast_trans_pvt *trans_pvt;
 	struct ast_format *format;
@@ -59,6 +72,8 @@ struct ast_audiohook_list {
 	 * be preserved during ast_audiohook_write_list()*/
 	int native_slin_compatible;
 	int list_internal_samp_rate;/*!< Internal sample rate used when writing to the audiohook list */
+	/*! What the audiohooks need from the read and write directions, updated when the list changes */
+	unsigned int needs[2];
 
 	struct ast_audiohook_translate in_translate[2];
 	struct ast_audiohook_translate out_translate[2];
@@ -67,6 +82,14 @@ struct ast_audiohook_list {
 	AST_LIST_HEAD_NOLOCK(, ast_audiohook) manipulate_list;
 };
 
+/*! \brief Whether a spy is fed silence in a direction */
+static int audiohook_muted(struct ast_audiohook *audiohook, enum ast_audiohook_direction direction)
+{
+	return (ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ) && (direction == AST_AUDIOHOOK_DIRECTION_READ)) ||
+		(ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_WRITE) && (direction == AST_AUDIOHOOK_DIRECTION_WRITE)) ||
+		(ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ | AST_AUDIOHOOK_MUTE_WRITE) == (AST_AUDIOHOOK_MUTE_READ | AST_AUDIOHOOK_MUTE_WRITE));
+}
+
 static int audiohook_set_internal_rate(struct ast_audiohook *audiohook, int rate, int reset)
 {
 	struct ast_format *slin;
@@ -198,9 +221,7 @@ int ast_audiohook_write_frame(struct ast_audiohook *audiohook, enum ast_audiohoo
 	}
 
 	/* swap frame data for zeros if mute is required */
-	if ((ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ) && (direction == AST_AUDIOHOOK_DIRECTION_READ)) ||
-		(ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_WRITE) && (direction == AST_AUDIOHOOK_DIRECTION_WRITE)) ||
-		(ast_test_flag(audiohook, AST_AUDIOHOOK_MUTE_READ | AST_AUDIOHOOK_MUTE_WRITE) == (AST_AUDIOHOOK_MUTE_READ | AST_AUDIOHOOK_MUTE_WRITE))) {
+	if (audiohook_muted(audiohook, direction)) {
 			muteme = 1;
 	}
 
@@ -450,10 +471,40 @@ struct ast_frame *ast_audiohook_read_frame_all(struct ast_audiohook *audiohook,
 	return audiohook_read_frame_helper(audiohook, samples, AST_AUDIOHOOK_DIRECTION_BOTH, format, read_frame, write_frame);
 }
 
+/*!
+ * \brief Update what the audiohooks of a list need from each direction
+ *
+ * \note Hooks which are shutting down are still counted until they are
+ * removed from the list, so the summary never misses a hook.
+ */
+static void audiohook_list_update_needs(struct ast_audiohook_list *audiohook_list)
+{
+	struct ast_audiohook *ah;
+	int direction;
+	unsigned int needs;
+
+	for (direction = AST_AUDIOHOOK_DIRECTION_READ; direction <= AST_AUDIOHOOK_DIRECTION_WRITE; direction++) {
+		needs = AST_LIST_EMPTY(&audiohook_list->whisper_list) ? 0 : AUDIOHOOK_NEEDS_SLIN;
+		AST_LIST_TRAVERSE(&audiohook_list->spy_list, ah, list) {
+			needs |= audiohook_muted(ah, direction) ? AUDIOHOOK_NEEDS_SILENCE : AUDIOHOOK_NEEDS_SLIN;
+		}
+		AST_LIST_TRAVERSE(&audiohook_list->manipulate_list, ah, list) {
+			needs |= AUDIOHOOK_NEEDS_SLIN;
+			if (ast_test_flag(ah, AST_AUDIOHOOK_WANTS_DTMF)) {
+				needs |= AUDIOHOOK_NEEDS_DTMF;
+			}
+		}
+		audiohook_list->needs[direction] = needs;
+	}
+}
+
 static void audiohook_list_set_samplerate_compatibility(struct ast_audiohook_list *audiohook_list)
 {
 	struct ast_audiohook *ah = NULL;
 
+	/* The list changed, so what its hooks need may have too */
+	audiohook_list_update_needs(audiohook_list);
+
 	/*
 	 * Anytime the samplerate compatibility is set (attach/remove an audiohook) the
 	 * list's internal sample rate needs to be reset so that the next time processing
@@ -1005,14 +1056,16 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
 		/* We take all of the combined whisper sources and combine them into the audio being written out */
-		for (i = 0, data1 = middle_frame->data.ptr, data2 = combine_buf; i < samples; i++, data1++, data2++) {
-			ast_slinear_saturated_add(data1, data2);
+		if (!ast_frame_make_writable(middle_frame)) {
+			for (i = 0, data1 = middle_frame->data.ptr, data2 = combine_buf; i < samples; i++, data1++, data2++) {
+				ast_slinear_saturated_add(data1, data2);
+			}
+			middle_frame_manipulated = 1;
 		}
-		middle_frame_manipulated = 1;
 	}
 
-	/* Pass off frame to manipulate audiohooks */
-	if (!AST_LIST_EMPTY(&audiohook_list->manipulate_list)) {
+	/* Pass off frame to manipulate audiohooks, which change the audio in place */
+	if (!AST_LIST_EMPTY(&audiohook_list->manipulate_list) && !ast_frame_make_writable(middle_frame)) {
 		AST_LIST_TRAVERSE_SAFE_BEGIN(&audiohook_list->manipulate_list, audiohook, list) {
 			ast_audiohook_lock(audiohook);
 			if (audiohook->status != AST_AUDIOHOOK_STATUS_RUNNING) {
@@ -1074,6 +1127,44 @@ static struct ast_frame *audio_audiohook_write_list(struct ast_channel *chan, st
 	return end_frame;
 }
 
+/*!
+ * \brief Feed silence of the same duration as an AUDIO frame to muted spies
+ *
+ * \details
+ * When every hook wanting audio from the direction is a spy muted in it, the
+ * spies only need silence, so the frame does not have to be translated.
+ *
+ * \retval 0 the spies were fed
+ * \retval -1 the frame is too long, it has to go through audio_audiohook_write_list()
+ */
+static int audio_audiohook_write_silence(struct ast_channel *chan, struct ast_audiohook_list *audiohook_list,
+	enum ast_audiohook_direction direction, struct ast_frame *frame)
+{
+	int frame_rate = ast_format_get_sample_rate(frame->subclass.format);
+	int rate = MAX(frame_rate, audiohook_list->list_internal_samp_rate);
+	int samples = frame_rate ? (int) ((int64_t) frame->samples * rate / frame_rate) : 0;
+	short buf[samples > 0 && samples <= AUDIOHOOK_SILENCE_MAX_SAMPLES ? samples : 1];
+	struct ast_frame silence = {
+		.frametype = AST_FRAME_VOICE,
+		.src = "audiohook silence",
+	};
+
+	if (samples <= 0 || samples > AUDIOHOOK_SILENCE_MAX_SAMPLES) {
+		return -1;
+	}
+
+	memset(buf, 0, sizeof(buf));
+	silence.subclass.format = ast_format_cache_get_slin_by_rate(rate);
+	silence.data.ptr = buf;
+	silence.datalen = sizeof(buf);
+	silence.samples = samples;
+
+	/* Nothing manipulates the frame, so the silence itself comes back */
+	audio_audiohook_write_list(chan, audiohook_list, direction, &silence);
+
+	return 0;
+}
+
 int ast_audiohook_write_list_empty(struct ast_audiohook_list *audiohook_list)
 {
 	return !audiohook_list
@@ -1091,10 +1182,19 @@ int ast_audiohook_write_list_empty(struct ast_audiohook_list *audiohook_list)
  */
 struct ast_frame *ast_audiohook_write_list(struct ast_channel *chan, struct ast_audiohook_list *audiohook_list, enum ast_audiohook_direction direction, struct ast_frame *frame)
 {
+	unsigned int needs = audiohook_list->needs[direction == AST_AUDIOHOOK_DIRECTION_READ ? 0 : 1];
+
 	/* Pass off frame to it's respective list write function */
 	if (frame->frametype == AST_FRAME_VOICE) {
+		if (!(needs & AUDIOHOOK_NEEDS_SLIN) && (needs & AUDIOHOOK_NEEDS_SILENCE)
+			&& !audio_audiohook_write_silence(chan, audiohook_list, direction, frame)) {
+			return frame;
+		}
 		return audio_audiohook_write_list(chan, audiohook_list, direction, frame);
 	} else if (frame->frametype == AST_FRAME_DTMF) {
+		if (!(needs & AUDIOHOOK_NEEDS_DTMF)) {
+			return frame;
+		}
 		return dtmf_audiohook_write_list(chan, audiohook_list, direction, frame);
 	} else {
 		return frame;
@@ -1406,6 +1506,7 @@ int ast_audiohook_set_mute(struct ast_channel *chan, const char *source, enum as
 		} else {
 			ast_set_flag(audiohook, flag);
 		}
+		audiohook_list_update_needs(ast_channel_audiohooks(chan));
 	}
 
 	ast_channel_unlock(chan);
@@ -118,10 +118,79 @@
 #include "asterisk/core_local.h"
 #include "asterisk/core_unreal.h"
 #include "asterisk/causes.h"
+#include "asterisk/thread_placement.h"
+#include "asterisk/sched.h"
 
 /*! All bridges container. */
 static struct ao2_container *bridges;
 
+/*! Most technology compatibility results kept for each bridge */
+#define BRIDGE_TECH_COMPAT_MAX 8
+
+/*! \brief What the channels of a bridge look like to a technology's compatible callback */
+struct bridge_tech_signature {
+	/*! Number of channels in the bridge, only one or two are kept */
+	unsigned int num_channels;
+	struct {
+		struct ast_bridge_channel *bridge_channel;
+		const struct ast_channel_tech *tech;
+		struct ast_format_cap *nativeformats;
+		struct ast_format *readformat;
+		struct ast_format *writeformat;
+		int dtmf_hooks;
+	} chans[2];
+};
+
+/*! \brief A kept result of a technology's compatible callback */
+struct bridge_tech_compat {
+	/*! Technology the result is for, NULL if the entry is unused */
+	struct ast_bridge_technology *technology;
+	/*! Technology registration generation the result was found in */
+	unsigned int generation;
+	/*!
+	 * Channels the result was found for.  The formats are referenced and
+	 * results are forgotten when one of the channels leaves the bridge,
+	 * so the pointers cannot be reused by other objects.
+	 */
+	struct bridge_tech_signature signature;
+	/*! Result of the compatible callback */
+	int compatible;
+};
+
+/*! \brief How a smart bridge is holding on to a multimix technology */
+enum bridge_tech_hold_state {
+	/*! Not holding */
+	BRIDGE_TECH_HOLD_NONE,
+	/*! Staying on the multimix technology until the hold expires */
+	BRIDGE_TECH_HOLD_ACTIVE,
+	/*! The hold expired, the next smart bridge operation may switch */
+	BRIDGE_TECH_HOLD_EXPIRED,
+};
+
+/*! \brief Technology compatibility results and transition state of a bridge */
+struct bridge_tech_state {
+	/*! Kept compatibility results */
+	struct bridge_tech_compat compat[BRIDGE_TECH_COMPAT_MAX];
+	/*! Entry of compat replaced next */
+	unsigned int compat_next;
+	/*! Multimix technology hold */
+	enum bridge_tech_hold_state hold;
+	/*! Incremented each time a hold starts */
+	unsigned int hold_seq;
+};
+
+/*! \brief A scheduled end of a multimix technology hold */
+struct bridge_tech_hold_timer {
+	struct ast_bridge *bridge;
+	unsigned int hold_seq;
+};
+
+/*! Incremented whenever a bridge technology is registered or unregistered */
+static unsigned int bridge_tech_generation;
+
+/*! Scheduler ending multimix technology holds */
+static struct ast_sched_context *bridge_sched;
+
 static AST_RWLIST_HEAD_STATIC(bridge_technologies, ast_bridge_technology);
 
 static unsigned int optimization_id;
@@ -236,6 +305,7 @@ int __ast_bridge_technology_register(struct ast_bridge_technology *technology, s
 
 	/* Insert our new bridge technology into the list and print out a pretty message */
 	AST_RWLIST_INSERT_TAIL(&bridge_technologies, technology, entry);
+	++bridge_tech_generation;
 
 	AST_RWLIST_UNLOCK(&bridge_technologies);
 
@@ -254,6 +324,7 @@ int ast_bridge_technology_unregister(struct ast_bridge_technology *technology)
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&bridge_technologies, current, entry) {
 		if (current == technology) {
 			AST_RWLIST_REMOVE_CURRENT(entry);
+			++bridge_tech_generation;
 			ast_verb(2, "Unregistered bridge technology %s\n", technology->name);
 			break;
 		}
@@ -476,6 +547,135 @@ static void bridge_complete_join(struct ast_bridge *bridge)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Get what the channels of a bridge look like to technologies.
+ *
+ * \note The formats in the signature are referenced.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the results of compatible callbacks are not kept for the bridge.
+ */
+static int bridge_tech_signature_get(struct ast_bridge *bridge, struct bridge_tech_signature *signature)
+{
+	struct ast_bridge_channel *bridge_channel;
+	int idx = 0;
+
+	if (!bridge->tech_state || !bridge->num_channels || bridge->num_channels > 2) {
+		return -1;
+	}
+
+	memset(signature, 0, sizeof(*signature));
+	signature->num_channels = bridge->num_channels;
+	AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+		signature->chans[idx].bridge_channel = bridge_channel;
+		ast_channel_lock(bridge_channel->chan);
+		signature->chans[idx].tech = ast_channel_tech(bridge_channel->chan);
+		signature->chans[idx].nativeformats = ao2_bump(ast_channel_nativeformats(bridge_channel->chan));
+		signature->chans[idx].readformat = ao2_bump(ast_channel_rawreadformat(bridge_channel->chan));
+		signature->chans[idx].writeformat = ao2_bump(ast_channel_rawwriteformat(bridge_channel->chan));
+		ast_channel_unlock(bridge_channel->chan);
+		signature->chans[idx].dtmf_hooks = bridge_channel->features
+			? ao2_container_count(bridge_channel->features->dtmf_hooks) : 0;
+		++idx;
+	}
+
+	return 0;
+}
+
+/*! \internal \brief Release the formats referenced by a signature. */
+static void bridge_tech_signature_release(struct bridge_tech_signature *signature)
+{
+	int idx;
+
+	for (idx = 0; idx < signature->num_channels; ++idx) {
+		ao2_cleanup(signature->chans[idx].nativeformats);
+		ao2_cleanup(signature->chans[idx].readformat);
+		ao2_cleanup(signature->chans[idx].writeformat);
+	}
+}
+
+/*! \internal \brief Forget a kept compatibility result. */
+static void bridge_tech_compat_clear(struct bridge_tech_compat *compat)
+{
+	bridge_tech_signature_release(&compat->signature);
+	memset(compat, 0, sizeof(*compat));
+}
+
+void bridge_tech_compat_flush(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel)
+{
+	struct bridge_tech_compat *compat;
+	int idx;
+
+	if (!bridge->tech_state) {
+		return;
+	}
+
+	for (idx = 0; idx < BRIDGE_TECH_COMPAT_MAX; ++idx) {
+		compat = &bridge->tech_state->compat[idx];
+		if (!bridge_channel
+			|| compat->signature.chans[0].bridge_channel == bridge_channel
+			|| compat->signature.chans[1].bridge_channel == bridge_channel) {
+			bridge_tech_compat_clear(compat);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Check if a bridge is compatible with a technology.
+ *
+ * \details
+ * Results of the technology's compatible callback are kept for the
+ * channels of the bridge, so that a bridge going back to channels it
+ * already had, such as after a third party briefly joined, does not
+ * need to ask again.
+ *
+ * \retval 0 if not compatible.
+ * \retval non-zero if compatible.
+ */
+static int bridge_tech_compatible(struct ast_bridge *bridge, struct ast_bridge_technology *technology)
+{
+	struct bridge_tech_state *state = bridge->tech_state;
+	struct bridge_tech_signature signature;
+	struct bridge_tech_compat *compat;
+	int compatible;
+	int idx;
+
+	if (!technology->compatible) {
+		return 1;
+	}
+
+	if (bridge_tech_signature_get(bridge, &signature)) {
+		return technology->compatible(bridge);
+	}
+
+	for (idx = 0; idx < BRIDGE_TECH_COMPAT_MAX; ++idx) {
+		compat = &state->compat[idx];
+		if (compat->technology == technology
+			&& compat->generation == bridge_tech_generation
+			&& !memcmp(&compat->signature, &signature, sizeof(signature))) {
+			ast_debug(3, "Bridge %s: reusing %s technology compatibility\n",
+				bridge->uniqueid, technology->name);
+			bridge_tech_signature_release(&signature);
+			return compat->compatible;
+		}
+	}
+
+	compatible = technology->compatible(bridge);
+
+	compat = &state->compat[state->compat_next];
+	state->compat_next = (state->compat_next + 1) % BRIDGE_TECH_COMPAT_MAX;
+	bridge_tech_compat_clear(compat);
+	compat->technology = technology;
+	compat->generation = bridge_tech_generation;
+	/* The entry takes the references of the signature. */
+	memcpy(&compat->signature, &signature, sizeof(signature));
+	compat->compatible = compatible;
+
+	return compatible;
+}
+
 /*! \brief Helper function used to find the "best" bridge technology given specified capabilities */
 static struct ast_bridge_technology *find_best_technology(uint32_t capabilities, struct ast_bridge *bridge)
 {
@@ -499,7 +699,7 @@ static struct ast_bridge_technology *find_best_technology(uint32_t capabilities,
 				current->name, best->name, current->preference, best->preference);
 			continue;
 		}
-		if (current->compatible && !current->compatible(bridge)) {
+		if (!bridge_tech_compatible(bridge, current)) {
 			ast_debug(1, "Bridge technology %s is not compatible with properties of existing bridge.\n",
 				current->name);
 			continue;
@@ -693,6 +893,10 @@ static void destroy_bridge(void *obj)
 
 	cleanup_video_mode(bridge);
 
+	bridge_tech_compat_flush(bridge, NULL);
+	ast_free(bridge->tech_state);
+	bridge->tech_state = NULL;
+
 	stasis_cp_single_unsubscribe(bridge->topics);
 
 	ast_string_field_free_memory(bridge);
@@ -743,6 +947,14 @@ struct ast_bridge *bridge_alloc(size_t size, const struct ast_bridge_methods *v_
 	}
 
 	bridge->v_table = v_table;
+	/* The bridge's memory was just allocated on the creator's node. */
+	bridge->numa_node = ast_thread_placement_node();
+
+	bridge->tech_state = ast_calloc(1, sizeof(*bridge->tech_state));
+	if (!bridge->tech_state) {
+		ao2_cleanup(bridge);
+		return NULL;
+	}
 
 	return bridge;
 }
@@ -983,6 +1195,83 @@ int ast_bridge_destroy(struct ast_bridge *bridge, int cause)
  * \retval 0 on success.
  * \retval -1 on error.
  */
+static int bridge_tech_hold_expire(const void *data)
+{
+	struct bridge_tech_hold_timer *timer = (struct bridge_tech_hold_timer *) data;
+	struct ast_bridge *bridge = timer->bridge;
+
+	ast_bridge_lock(bridge);
+	if (bridge->tech_state->hold == BRIDGE_TECH_HOLD_ACTIVE
+		&& bridge->tech_state->hold_seq == timer->hold_seq) {
+		ast_debug(1, "Bridge %s: technology hold expired\n", bridge->uniqueid);
+		bridge->tech_state->hold = BRIDGE_TECH_HOLD_EXPIRED;
+		bridge->reconfigured = 1;
+		bridge_reconfigured(bridge, 0);
+	}
+	ast_bridge_unlock(bridge);
+
+	ao2_ref(bridge, -1);
+	ast_free(timer);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Determine if a smart bridge stays on its multimix technology for now.
+ *
+ * \details
+ * When a third party leaves a bridge that switched to a multimix
+ * technology for it, the bridge stays on that technology for
+ * bridge_tech_hold milliseconds.  A party joining in the meantime then
+ * does not cause two more technology switches.
+ *
+ * \note On entry, bridge is already locked.
+ *
+ * \retval 1 if the bridge stays on its technology.
+ * \retval 0 if the bridge technology may be selected again.
+ */
+static int bridge_tech_hold(struct ast_bridge *bridge, uint32_t new_capabilities)
+{
+	struct bridge_tech_state *state = bridge->tech_state;
+	struct bridge_tech_hold_timer *timer;
+
+	if (!ast_option_bridge_tech_hold
+		|| !bridge_sched
+		|| !bridge->num_channels
+		|| !(bridge->technology->capabilities & AST_BRIDGE_CAPABILITY_MULTIMIX)
+		|| (new_capabilities & AST_BRIDGE_CAPABILITY_MULTIMIX)) {
+		state->hold = BRIDGE_TECH_HOLD_NONE;
+		return 0;
+	}
+
+	switch (state->hold) {
+	case BRIDGE_TECH_HOLD_ACTIVE:
+		return 1;
+	case BRIDGE_TECH_HOLD_EXPIRED:
+		state->hold = BRIDGE_TECH_HOLD_NONE;
+		return 0;
+	case BRIDGE_TECH_HOLD_NONE:
+		break;
+	}
+
+	timer = ast_malloc(sizeof(*timer));
+	if (!timer) {
+		return 0;
+	}
+	timer->bridge = ao2_bump(bridge);
+	timer->hold_seq = ++state->hold_seq;
+	if (ast_sched_add(bridge_sched, ast_option_bridge_tech_hold, bridge_tech_hold_expire, timer) < 0) {
+		ao2_ref(bridge, -1);
+		ast_free(timer);
+		return 0;
+	}
+
+	ast_debug(1, "Bridge %s: staying with %s technology for %u ms\n",
+		bridge->uniqueid, bridge->technology->name, ast_option_bridge_tech_hold);
+	state->hold = BRIDGE_TECH_HOLD_ACTIVE;
+	return 1;
+}
+
 static int smart_bridge_operation(struct ast_bridge *bridge)
 {
 	uint32_t new_capabilities;
@@ -1018,13 +1307,17 @@ static int smart_bridge_operation(struct ast_bridge *bridge)
 		}
 	}
 
+	if (bridge_tech_hold(bridge, new_capabilities)) {
+		return 0;
+	}
+
 	/* Find a bridge technology to satisfy the new capabilities. */
 	new_technology = find_best_technology(new_capabilities, bridge);
 	if (!new_technology) {
 		int is_compatible = 0;
 
 		if (old_technology->compatible) {
-			is_compatible = old_technology->compatible(bridge);
+			is_compatible = bridge_tech_compatible(bridge, old_technology);
 		} else if (old_technology->capabilities & AST_BRIDGE_CAPABILITY_MULTIMIX) {
 			is_compatible = 1;
 		} else if (bridge->num_channels <= 2
@@ -1766,17 +2059,19 @@ static void *bridge_channel_depart_thread(void *data)
 	return NULL;
 }
 
-/*! \brief Thread responsible for independent imparted bridged channels */
-static void *bridge_channel_ind_thread(void *data)
+/*!
+ * \internal
+ * \brief Clean up an independent imparted bridged channel that left the bridge.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel that left the bridge.
+ *
+ * \return Nothing
+ */
+static void bridge_channel_ind_done(struct ast_bridge_channel *bridge_channel)
 {
-	struct ast_bridge_channel *bridge_channel = data;
 	struct ast_channel *chan;
 
-	if (bridge_channel->callid) {
-		ast_callid_threadassoc_add(bridge_channel->callid);
-	}
-
-	bridge_channel_internal_join(bridge_channel);
 	chan = bridge_channel->chan;
 
 	/* cleanup */
@@ -1796,6 +2091,39 @@ static void *bridge_channel_ind_thread(void *data)
 	/* If join failed there will be impart threads waiting. */
 	bridge_channel_impart_signal(chan);
 	ast_bridge_run_after_goto(chan);
+}
+
+/*! \brief Thread continuing an independent imparted bridged channel a reactor gave back */
+static void *bridge_channel_ind_resume_thread(void *data)
+{
+	struct ast_bridge_channel *bridge_channel = data;
+
+	if (bridge_channel->callid) {
+		ast_callid_threadassoc_add(bridge_channel->callid);
+	}
+
+	if (bridge_channel_internal_join_resume(bridge_channel, bridge_channel_ind_resume_thread) > 0) {
+		/* A reactor services the channel again. */
+		return NULL;
+	}
+	bridge_channel_ind_done(bridge_channel);
+	return NULL;
+}
+
+/*! \brief Thread responsible for independent imparted bridged channels */
+static void *bridge_channel_ind_thread(void *data)
+{
+	struct ast_bridge_channel *bridge_channel = data;
+
+	if (bridge_channel->callid) {
+		ast_callid_threadassoc_add(bridge_channel->callid);
+	}
+
+	if (bridge_channel_internal_join_reactor(bridge_channel, bridge_channel_ind_resume_thread) > 0) {
+		/* A reactor services the channel until it needs a thread again. */
+		return NULL;
+	}
+	bridge_channel_ind_done(bridge_channel);
 	return NULL;
 }
 
@@ -3231,6 +3559,7 @@ int ast_bridge_dtmf_hook(struct ast_bridge_features *features,
 
 	/* Once done we put it in the container. */
 	res = ao2_link(features->dtmf_hooks, hook) ? 0 : -1;
+	bridge_dtmf_hooks_changed(features);
 	if (res) {
 		/*
 		 * Could not link the hook into the container.
@@ -3536,6 +3865,7 @@ static void hooks_remove_heap(struct ast_heap *hooks, enum ast_bridge_hook_remov
 void ast_bridge_features_remove(struct ast_bridge_features *features, enum ast_bridge_hook_remove_flags remove_flags)
 {
 	hooks_remove_container(features->dtmf_hooks, remove_flags);
+	bridge_dtmf_hooks_changed(features);
 	hooks_remove_container(features->other_hooks, remove_flags);
 	hooks_remove_heap(features->interval_hooks, remove_flags);
 }
@@ -3593,6 +3923,161 @@ static int bridge_dtmf_hook_sort(const void *obj_left, const void *obj_right, in
 	return cmp;
 }
 
+/*! \brief Digits of DTMF feature codes, in trie branch order */
+static const char bridge_dtmf_digits[] = "0123456789*#ABCD";
+
+/*! \brief Number of branches of a DTMF trie node */
+#define BRIDGE_DTMF_TRIE_BRANCHES (sizeof(bridge_dtmf_digits) - 1)
+
+/*! \brief A node of a DTMF feature hook trie, reached by the digits leading to it */
+struct bridge_dtmf_trie_node {
+	/*! Index of the node after each digit, 0 if no hook continues with it */
+	unsigned short next[BRIDGE_DTMF_TRIE_BRANCHES];
+	/*! Hook whose code ends at this node, referenced */
+	struct ast_bridge_hook_dtmf *hook;
+};
+
+/*! \brief The DTMF feature hooks of a features structure compiled for matching */
+struct bridge_dtmf_trie {
+	/*! Non-zero if a hook code has a character that is not a digit, so the hooks are searched instead */
+	int unusable;
+	/*! Number of nodes used */
+	unsigned int count;
+	/*! Nodes, the first is the root */
+	struct bridge_dtmf_trie_node nodes[0];
+};
+
+static void bridge_dtmf_trie_destroy(void *obj)
+{
+	struct bridge_dtmf_trie *trie = obj;
+	unsigned int idx;
+
+	for (idx = 0; idx < trie->count; ++idx) {
+		ao2_cleanup(trie->nodes[idx].hook);
+	}
+}
+
+/*! \internal \brief Get the trie branch of a DTMF digit, -1 if it is not one */
+static int bridge_dtmf_trie_branch(char digit)
+{
+	const char *pos;
+
+	if (!digit || !(pos = strchr(bridge_dtmf_digits, toupper(digit)))) {
+		return -1;
+	}
+	return pos - bridge_dtmf_digits;
+}
+
+/*!
+ * \internal
+ * \brief Compile DTMF feature hooks into a trie.
+ *
+ * \note On entry, the hooks container is already locked.
+ */
+static struct bridge_dtmf_trie *bridge_dtmf_trie_build(struct ao2_container *hooks)
+{
+	struct bridge_dtmf_trie *trie;
+	struct ast_bridge_hook_dtmf *hook;
+	struct ao2_iterator iter;
+	size_t max_nodes = 1;
+	unsigned int node;
+	const char *code;
+	int branch;
+
+	iter = ao2_iterator_init(hooks, AO2_ITERATOR_DONTLOCK);
+	for (; (hook = ao2_iterator_next(&iter)); ao2_ref(hook, -1)) {
+		max_nodes += strlen(hook->dtmf.code);
+	}
+	ao2_iterator_destroy(&iter);
+
+	trie = ao2_alloc_options(sizeof(*trie) + max_nodes * sizeof(trie->nodes[0]),
+		bridge_dtmf_trie_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!trie) {
+		return NULL;
+	}
+	trie->count = 1;
+	/* Node indexes must fit the branches. */
+	trie->unusable = max_nodes > USHRT_MAX;
+
+	iter = ao2_iterator_init(hooks, AO2_ITERATOR_DONTLOCK);
+	for (; !trie->unusable && (hook = ao2_iterator_next(&iter)); ao2_ref(hook, -1)) {
+		node = 0;
+		for (code = hook->dtmf.code; *code; ++code) {
+			branch = bridge_dtmf_trie_branch(*code);
+			if (branch < 0) {
+				trie->unusable = 1;
+				break;
+			}
+			if (!trie->nodes[node].next[branch]) {
+				trie->nodes[node].next[branch] = trie->count++;
+			}
+			node = trie->nodes[node].next[branch];
+		}
+		if (!trie->unusable && node && !trie->nodes[node].hook) {
+			trie->nodes[node].hook = ao2_bump(hook);
+		}
+	}
+	ao2_iterator_destroy(&iter);
+
+	return trie;
+}
+
+struct ast_bridge_hook_dtmf *bridge_dtmf_hook_match(struct ast_bridge_features *features,
+	const char *dtmf, int *more)
+{
+	struct bridge_dtmf_trie *trie;
+	struct ast_bridge_hook_dtmf *hook = NULL;
+	unsigned int node = 0;
+	int branch;
+
+	*more = 0;
+
+	ao2_lock(features->dtmf_hooks);
+	if (!features->dtmf_trie) {
+		features->dtmf_trie = bridge_dtmf_trie_build(features->dtmf_hooks);
+	}
+	trie = ao2_bump(features->dtmf_trie);
+	ao2_unlock(features->dtmf_hooks);
+
+	if (!trie || trie->unusable) {
+		ao2_cleanup(trie);
+		hook = ao2_find(features->dtmf_hooks, dtmf, OBJ_SEARCH_PARTIAL_KEY);
+		if (hook && strlen(dtmf) != strlen(hook->dtmf.code)) {
+			ao2_ref(hook, -1);
+			hook = NULL;
+			*more = 1;
+		}
+		return hook;
+	}
+
+	for (; *dtmf; ++dtmf) {
+		branch = bridge_dtmf_trie_branch(*dtmf);
+		if (branch < 0 || !(node = trie->nodes[node].next[branch])) {
+			ao2_ref(trie, -1);
+			return NULL;
+		}
+	}
+
+	if (node) {
+		hook = ao2_bump(trie->nodes[node].hook);
+		if (!hook) {
+			/* A node without a hook of its own only exists if a longer code passes through it. */
+			*more = 1;
+		}
+	}
+	ao2_ref(trie, -1);
+
+	return hook;
+}
+
+void bridge_dtmf_hooks_changed(struct ast_bridge_features *features)
+{
+	ao2_lock(features->dtmf_hooks);
+	ao2_cleanup(features->dtmf_trie);
+	features->dtmf_trie = NULL;
+	ao2_unlock(features->dtmf_hooks);
+}
+
 /*! \brief Callback for merging hook ao2_containers */
 static int merge_container_cb(void *obj, void *data, int flags)
 {
@@ -3634,6 +4119,7 @@ void ast_bridge_features_merge(struct ast_bridge_features *into, const struct as
 
 	/* Merge hook containers */
 	ao2_callback(from->dtmf_hooks, 0, merge_container_cb, into->dtmf_hooks);
+	bridge_dtmf_hooks_changed(into);
 	ao2_callback(from->other_hooks, 0, merge_container_cb, into->other_hooks);
 
 	/* Merge hook heaps */
@@ -3701,6 +4187,8 @@ void ast_bridge_features_cleanup(struct ast_bridge_features *features)
 	features->other_hooks = NULL;
 
 	/* Destroy the DTMF hooks container. */
+	ao2_cleanup(features->dtmf_trie);
+	features->dtmf_trie = NULL;
 	ao2_cleanup(features->dtmf_hooks);
 	features->dtmf_hooks = NULL;
 }
@@ -3736,6 +4224,20 @@ void ast_bridge_set_mixing_interval(struct ast_bridge *bridge, unsigned int mixi
 	ast_bridge_unlock(bridge);
 }
 
+void ast_bridge_set_mixing_threads(struct ast_bridge *bridge, unsigned int mixing_threads)
+{
+	ast_bridge_lock(bridge);
+	bridge->softmix.mixing_threads = mixing_threads;
+	ast_bridge_unlock(bridge);
+}
+
+void ast_bridge_set_max_talkers(struct ast_bridge *bridge, unsigned int max_talkers)
+{
+	ast_bridge_lock(bridge);
+	bridge->softmix.max_talkers = max_talkers;
+	ast_bridge_unlock(bridge);
+}
+
 void ast_bridge_set_internal_sample_rate(struct ast_bridge *bridge, unsigned int sample_rate)
 {
 	ast_bridge_lock(bridge);
@@ -5087,13 +5589,17 @@ static char *handle_bridge_show_specific(struct ast_cli_entry *e, int cmd, struc
 {
 	RAII_VAR(struct stasis_message *, msg, NULL, ao2_cleanup);
 	struct ast_bridge_snapshot *snapshot;
+	struct ast_bridge *bridge;
+	struct ast_bridge_channel *bridge_channel;
 
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "bridge show";
 		e->usage =
 			"Usage: bridge show <bridge-id>\n"
-			"       Show information about the <bridge-id> bridge\n";
+			"       Show information about the <bridge-id> bridge, including\n"
+			"       the frames waiting to be written to each channel and how\n"
+			"       many were dropped because the channel fell behind.\n";
 		return NULL;
 	case CLI_GENERATE:
 		if (a->pos == 2) {
@@ -5119,6 +5625,19 @@ static char *handle_bridge_show_specific(struct ast_cli_entry *e, int cmd, struc
 	ast_cli(a->fd, "Num-Channels: %u\n", snapshot->num_channels);
 	ao2_callback(snapshot->channels, OBJ_NODATA, bridge_show_specific_print_channel, a);
 
+	bridge = ast_bridge_find_by_id(a->argv[2]);
+	if (bridge) {
+		ast_bridge_lock(bridge);
+		AST_LIST_TRAVERSE(&bridge->channels, bridge_channel, entry) {
+			ast_cli(a->fd, "Write-Queue: %s (%u waiting, %lu dropped)\n",
+				ast_channel_name(bridge_channel->chan),
+				bridge_channel_internal_queue_depth(bridge_channel),
+				__atomic_load_n(&bridge_channel->wr_dropped, __ATOMIC_RELAXED));
+		}
+		ast_bridge_unlock(bridge);
+		ao2_ref(bridge, -1);
+	}
+
 	return CLI_SUCCESS;
 }
 
@@ -5529,6 +6048,10 @@ static void bridge_cleanup(void)
 	bridges = NULL;
 	ao2_cleanup(bridge_manager);
 	bridge_manager = NULL;
+	if (bridge_sched) {
+		ast_sched_context_destroy(bridge_sched);
+		bridge_sched = NULL;
+	}
 }
 
 int ast_bridging_init(void)
@@ -5544,6 +6067,11 @@ int ast_bridging_init(void)
 		return -1;
 	}
 
+	bridge_sched = ast_sched_context_create();
+	if (!bridge_sched || ast_sched_start_thread(bridge_sched)) {
+		return -1;
+	}
+
 	bridges = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX,
 		AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, bridge_sort_cmp, NULL);
 	if (!bridges) {
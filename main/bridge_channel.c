@@ -33,9 +33,14 @@
 #include "asterisk.h"
 
 #include <signal.h>
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
 
 #include "asterisk/heap.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/options.h"
+#include "asterisk/vector.h"
 #include "asterisk/stringfields.h"
 #include "asterisk/app.h"
 #include "asterisk/pbx.h"
@@ -54,6 +59,8 @@
 #include "asterisk/causes.h"
 #include "asterisk/test.h"
 #include "asterisk/sem.h"
+#include "asterisk/frame_latency.h"
+#include "asterisk/thread_placement.h"
 
 /*!
  * \brief Used to queue an action frame onto a bridge channel and write an action frame into a bridge.
@@ -648,6 +655,8 @@ static int bridge_channel_write_frame(struct ast_bridge_channel *bridge_channel,
  * simple_bridge/native_bridge are likely the only techs that will do this.
  */
 	bridge_channel->bridge->technology->write(bridge_channel->bridge, bridge_channel, frame);
+	ast_frame_latency_record(AST_FRAME_LATENCY_BRIDGE, bridge_channel->bridge->technology->name,
+		frame->ingress);
 
 	/* Remember any owed events to the bridge. */
 	switch (frame->frametype) {
@@ -951,10 +960,143 @@ static void bridge_frame_free(struct ast_frame *frame)
 	ast_frfree(frame);
 }
 
+/*! Voice frames a bridge channel may have waiting in its ring, a power of two */
+#define BRIDGE_CHANNEL_WR_RING_SIZE 128
+
+/*!
+ * \internal
+ * \brief Voice frames waiting to be written to a bridge channel.
+ *
+ * Bridge technologies write audio to every participant each packetization
+ * interval, so it is queued by any number of threads without the bridge
+ * channel lock.  Only the bridge channel thread, or the reactor servicing
+ * it, takes frames out.  Each slot carries a sequence number telling
+ * whether it is free to fill or ready to take.
+ */
+struct bridge_channel_wr_ring {
+	/*! Next slot to fill, claimed by the producers */
+	unsigned int head;
+	/*! Next slot to take, only written by the consumer */
+	unsigned int tail;
+	struct {
+		unsigned int seq;
+		struct ast_frame *frame;
+	} slots[BRIDGE_CHANNEL_WR_RING_SIZE];
+};
+
+static struct bridge_channel_wr_ring *bridge_channel_wr_ring_alloc(void)
+{
+	struct bridge_channel_wr_ring *ring;
+	unsigned int idx;
+
+	ring = ast_calloc(1, sizeof(*ring));
+	if (!ring) {
+		return NULL;
+	}
+	for (idx = 0; idx < BRIDGE_CHANNEL_WR_RING_SIZE; ++idx) {
+		ring->slots[idx].seq = idx;
+	}
+
+	return ring;
+}
+
+/*!
+ * \internal
+ * \brief Put a frame in the ring of a bridge channel, from any thread.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the ring is full.
+ */
+static int bridge_channel_wr_ring_push(struct bridge_channel_wr_ring *ring, struct ast_frame *frame)
+{
+	unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+	unsigned int seq;
+	int diff;
+
+	for (;;) {
+		seq = __atomic_load_n(&ring->slots[head % BRIDGE_CHANNEL_WR_RING_SIZE].seq, __ATOMIC_ACQUIRE);
+		diff = (int) (seq - head);
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&ring->head, &head, head + 1, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return -1;
+		} else {
+			head = __atomic_load_n(&ring->head, __ATOMIC_RELAXED);
+		}
+	}
+
+	ring->slots[head % BRIDGE_CHANNEL_WR_RING_SIZE].frame = frame;
+	__atomic_store_n(&ring->slots[head % BRIDGE_CHANNEL_WR_RING_SIZE].seq, head + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Take the oldest frame out of the ring of a bridge channel.
+ *
+ * \note Only called by the one thread servicing the bridge channel.
+ *
+ * \return The frame
+ * \retval NULL if no frame is ready.
+ */
+static struct ast_frame *bridge_channel_wr_ring_pop(struct bridge_channel_wr_ring *ring)
+{
+	unsigned int tail = ring->tail;
+	struct ast_frame *frame;
+
+	if (__atomic_load_n(&ring->slots[tail % BRIDGE_CHANNEL_WR_RING_SIZE].seq, __ATOMIC_ACQUIRE) != tail + 1) {
+		return NULL;
+	}
+
+	frame = ring->slots[tail % BRIDGE_CHANNEL_WR_RING_SIZE].frame;
+	__atomic_store_n(&ring->slots[tail % BRIDGE_CHANNEL_WR_RING_SIZE].seq,
+		tail + BRIDGE_CHANNEL_WR_RING_SIZE, __ATOMIC_RELEASE);
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+	return frame;
+}
+
+/*!
+ * \internal
+ * \brief Signal the bridge channel thread that frames are waiting.
+ *
+ * The alert stays signalled until the thread reads it, so frames queued
+ * in the meantime cost no further write.
+ */
+static void bridge_channel_wr_alert(struct ast_bridge_channel *bridge_channel)
+{
+#ifndef HAVE_EVENTFD
+	char nudge = 0;
+#endif
+
+	if (__atomic_exchange_n(&bridge_channel->wr_alerted, 1, __ATOMIC_SEQ_CST)) {
+		return;
+	}
+#ifdef HAVE_EVENTFD
+	if (eventfd_write(bridge_channel->alert_pipe[1], 1)) {
+#else
+	if (write(bridge_channel->alert_pipe[1], &nudge, sizeof(nudge)) != sizeof(nudge)) {
+#endif
+		__atomic_store_n(&bridge_channel->wr_alerted, 0, __ATOMIC_SEQ_CST);
+		ast_log(LOG_ERROR, "We couldn't write alert pipe for %p(%s)... something is VERY wrong\n",
+			bridge_channel, ast_channel_name(bridge_channel->chan));
+	}
+}
+
+unsigned int bridge_channel_internal_queue_depth(struct ast_bridge_channel *bridge_channel)
+{
+	struct bridge_channel_wr_ring *ring = bridge_channel->wr_ring;
+
+	return __atomic_load_n(&ring->head, __ATOMIC_RELAXED)
+		- __atomic_load_n(&ring->tail, __ATOMIC_RELAXED)
+		+ __atomic_load_n(&bridge_channel->wr_queue_count, __ATOMIC_RELAXED);
+}
+
 int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, struct ast_frame *fr)
 {
 	struct ast_frame *dup;
-	char nudge = 0;
 
 	if (bridge_channel->suspended
 		/* Also defer DTMF frames. */
@@ -969,11 +1111,33 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 		return 0;
 	}
 
-	dup = ast_frdup(fr);
+	/* A shared payload is passed along by reference rather than copied. */
+	dup = (fr->mallocd & AST_MALLOCD_SHARED) ? ast_frdup_shared(fr) : ast_frdup(fr);
 	if (!dup) {
 		return -1;
 	}
 
+	/*
+	 * Audio skips the lock unless other frames are already waiting in
+	 * wr_queue, which it must not overtake.
+	 */
+	if (dup->frametype == AST_FRAME_VOICE
+		&& !__atomic_load_n(&bridge_channel->wr_queue_count, __ATOMIC_ACQUIRE)) {
+		if (__atomic_load_n(&bridge_channel->state, __ATOMIC_ACQUIRE) != BRIDGE_CHANNEL_STATE_WAIT) {
+			/* Drop frames on channels leaving the bridge. */
+			bridge_frame_free(dup);
+			return 0;
+		}
+		if (bridge_channel_wr_ring_push(bridge_channel->wr_ring, dup)) {
+			/* The channel is behind; audio is better lost than late. */
+			__atomic_add_fetch(&bridge_channel->wr_dropped, 1, __ATOMIC_RELAXED);
+			bridge_frame_free(dup);
+			return 0;
+		}
+		bridge_channel_wr_alert(bridge_channel);
+		return 0;
+	}
+
 	ast_bridge_channel_lock(bridge_channel);
 	if (bridge_channel->state != BRIDGE_CHANNEL_STATE_WAIT) {
 		/* Drop frames on channels leaving the bridge. */
@@ -983,10 +1147,8 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 	}
 
 	AST_LIST_INSERT_TAIL(&bridge_channel->wr_queue, dup, frame_list);
-	if (write(bridge_channel->alert_pipe[1], &nudge, sizeof(nudge)) != sizeof(nudge)) {
-		ast_log(LOG_ERROR, "We couldn't write alert pipe for %p(%s)... something is VERY wrong\n",
-			bridge_channel, ast_channel_name(bridge_channel->chan));
-	}
+	__atomic_add_fetch(&bridge_channel->wr_queue_count, 1, __ATOMIC_RELEASE);
+	bridge_channel_wr_alert(bridge_channel);
 	ast_bridge_channel_unlock(bridge_channel);
 	return 0;
 }
@@ -994,6 +1156,7 @@ int ast_bridge_channel_queue_frame(struct ast_bridge_channel *bridge_channel, st
 int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	struct ast_bridge_channel *cur;
+	struct ast_frame *shared = NULL;
 	int not_written = -1;
 
 	if (frame->frametype == AST_FRAME_NULL) {
@@ -1001,6 +1164,19 @@ int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_
 		return 0;
 	}
 
+	/*
+	 * When media goes to more than one channel copy the payload once
+	 * and let every queued frame reference it.
+	 */
+	if ((frame->frametype == AST_FRAME_VOICE || frame->frametype == AST_FRAME_VIDEO)
+		&& frame->datalen && !(frame->mallocd & AST_MALLOCD_SHARED)
+		&& bridge->num_channels > (bridge_channel ? 2 : 1)) {
+		shared = ast_frdup_shared(frame);
+		if (shared) {
+			frame = shared;
+		}
+	}
+
 	AST_LIST_TRAVERSE(&bridge->channels, cur, entry) {
 		if (cur == bridge_channel) {
 			continue;
@@ -1009,6 +1185,9 @@ int ast_bridge_queue_everyone_else(struct ast_bridge *bridge, struct ast_bridge_
 			not_written = 0;
 		}
 	}
+	if (shared) {
+		ast_frfree(shared);
+	}
 	return not_written;
 }
 
@@ -1645,18 +1824,18 @@ void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel,
 	}
 
 	while (digit) {
+		int more;
+
 		/* See if a DTMF feature hook matches or can match */
-		hook = ao2_find(features->dtmf_hooks, bridge_channel->dtmf_hook_state.collected,
-			OBJ_SEARCH_PARTIAL_KEY);
-		if (!hook) {
+		hook = bridge_dtmf_hook_match(features, bridge_channel->dtmf_hook_state.collected, &more);
+		if (!hook && !more) {
 			ast_debug(1, "No DTMF feature hooks on %p(%s) match '%s'\n",
 				bridge_channel, ast_channel_name(bridge_channel->chan),
 				bridge_channel->dtmf_hook_state.collected);
 			break;
-		} else if (dtmf_len != strlen(hook->dtmf.code)) {
+		} else if (!hook) {
 			unsigned int digit_timeout;
 			/* Need more digits to match */
-			ao2_ref(hook, -1);
 			digit_timeout = bridge_channel_feature_digit_timeout(bridge_channel);
 			bridge_channel->dtmf_hook_state.interdigit_timeout =
 				ast_tvadd(ast_tvnow(), ast_samp2tv(digit_timeout, 1000));
@@ -1689,6 +1868,7 @@ void ast_bridge_channel_feature_digit(struct ast_bridge_channel *bridge_channel,
 				ast_debug(1, "DTMF hook %p is being removed from %p(%s)\n",
 					hook, bridge_channel, ast_channel_name(bridge_channel->chan));
 				ao2_unlink(features->dtmf_hooks, hook);
+				bridge_dtmf_hooks_changed(features);
 			}
 			testsuite_notify_feature_success(bridge_channel->chan, hook->dtmf.code);
 			ao2_ref(hook, -1);
@@ -2077,6 +2257,7 @@ void bridge_channel_internal_pull(struct ast_bridge_channel *bridge_channel)
 	}
 	--bridge->num_channels;
 	AST_LIST_REMOVE(&bridge->channels, bridge_channel, entry);
+	bridge_tech_compat_flush(bridge, bridge_channel);
 
 	bridge_channel_dissolve_check(bridge_channel);
 	bridge->v_table->pull(bridge, bridge_channel);
@@ -2263,40 +2444,42 @@ static void bridge_channel_handle_control(struct ast_bridge_channel *bridge_chan
  */
 static void bridge_channel_read_wr_queue_alert(struct ast_bridge_channel *bridge_channel)
 {
+#ifdef HAVE_EVENTFD
+	eventfd_t value;
+
+	if (eventfd_read(bridge_channel->alert_pipe[0], &value)) {
+#else
 	char nudge;
 
 	if (read(bridge_channel->alert_pipe[0], &nudge, sizeof(nudge)) < 0) {
+#endif
 		if (errno != EINTR && errno != EAGAIN) {
 			ast_log(LOG_WARNING, "read() failed for alert pipe on %p(%s): %s\n",
 				bridge_channel, ast_channel_name(bridge_channel->chan),
 				strerror(errno));
 		}
 	}
+	/* Frames queued from now on signal the alert again. */
+	__atomic_store_n(&bridge_channel->wr_alerted, 0, __ATOMIC_SEQ_CST);
 }
 
 /*!
  * \internal
- * \brief Handle bridge channel write frame to channel.
+ * \brief Handle the next frame in the wr_queue of a bridge channel.
  * \since 12.0.0
  *
  * \param bridge_channel Channel to write outgoing frame.
  *
  * \return Nothing
  */
-static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channel)
+static void bridge_channel_handle_write_queued(struct ast_bridge_channel *bridge_channel)
 {
 	struct ast_frame *fr;
 	struct sync_payload *sync_payload;
 
 	ast_bridge_channel_lock(bridge_channel);
-
-	/* It's not good to have unbalanced frames and alert_pipe alerts. */
-	ast_assert(!AST_LIST_EMPTY(&bridge_channel->wr_queue));
 	if (AST_LIST_EMPTY(&bridge_channel->wr_queue)) {
-		/* No frame, flush the alert pipe of excess alerts. */
-		ast_log(LOG_WARNING, "Weird.  No frame from bridge for %s to process?\n",
-			ast_channel_name(bridge_channel->chan));
-		bridge_channel_read_wr_queue_alert(bridge_channel);
+		/* The frames the alert was for were taken on an earlier pass. */
 		ast_bridge_channel_unlock(bridge_channel);
 		return;
 	}
@@ -2312,8 +2495,8 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 				break;
 			}
 		}
-		bridge_channel_read_wr_queue_alert(bridge_channel);
 		AST_LIST_REMOVE_CURRENT(frame_list);
+		__atomic_sub_fetch(&bridge_channel->wr_queue_count, 1, __ATOMIC_RELEASE);
 		break;
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
@@ -2351,12 +2534,50 @@ static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channe
 	bridge_frame_free(fr);
 }
 
+/*!
+ * \internal
+ * \brief Handle bridge channel write frames to channel.
+ * \since 12.0.0
+ *
+ * Writes up to bridge_write_batch frames of audio from the ring at a time,
+ * or else the next frame in the wr_queue.  The alert is signalled again if
+ * more are left so other work of the thread is not starved.
+ *
+ * \param bridge_channel Channel to write outgoing frames.
+ *
+ * \return Nothing
+ */
+static void bridge_channel_handle_write(struct ast_bridge_channel *bridge_channel)
+{
+	unsigned int batch = MAX(ast_option_bridge_write_batch, 1);
+	unsigned int written = 0;
+	struct ast_frame *fr;
+
+	bridge_channel_read_wr_queue_alert(bridge_channel);
+
+	/* Audio in the ring was queued before anything now in wr_queue. */
+	while (written < batch && (fr = bridge_channel_wr_ring_pop(bridge_channel->wr_ring))) {
+		bridge_channel->activity = BRIDGE_CHANNEL_THREAD_SIMPLE;
+		ast_write(bridge_channel->chan, fr);
+		bridge_frame_free(fr);
+		++written;
+	}
+	if (!written) {
+		bridge_channel_handle_write_queued(bridge_channel);
+	}
+
+	if (bridge_channel_internal_queue_depth(bridge_channel)) {
+		bridge_channel_wr_alert(bridge_channel);
+	}
+}
+
 /*! \brief Internal function to handle DTMF from a channel */
 static struct ast_frame *bridge_handle_dtmf(struct ast_bridge_channel *bridge_channel, struct ast_frame *frame)
 {
 	struct ast_bridge_features *features = bridge_channel->features;
 	struct ast_bridge_hook_dtmf *hook = NULL;
 	char dtmf[2];
+	int more = 0;
 
 	/*
 	 * See if we are already matching a DTMF feature hook sequence or
@@ -2365,7 +2586,8 @@ static struct ast_frame *bridge_handle_dtmf(struct ast_bridge_channel *bridge_ch
 	dtmf[0] = frame->subclass.integer;
 	dtmf[1] = '\0';
 	if (bridge_channel->dtmf_hook_state.collected[0]
-		|| (hook = ao2_find(features->dtmf_hooks, dtmf, OBJ_SEARCH_PARTIAL_KEY))) {
+		|| (hook = bridge_dtmf_hook_match(features, dtmf, &more))
+		|| more) {
 		enum ast_frame_type frametype = frame->frametype;
 
 		bridge_frame_free(frame);
@@ -2600,6 +2822,7 @@ static void bridge_channel_wait(struct ast_bridge_channel *bridge_channel)
 		if (ast_channel_unbridged(bridge_channel->chan)) {
 			ast_channel_set_unbridged(bridge_channel->chan, 0);
 			ast_bridge_channel_lock_bridge(bridge_channel);
+			bridge_tech_compat_flush(bridge_channel->bridge, NULL);
 			bridge_channel->bridge->reconfigured = 1;
 			bridge_reconfigured(bridge_channel->bridge, 0);
 			ast_bridge_unlock(bridge_channel->bridge);
@@ -2670,7 +2893,152 @@ static void bridge_channel_event_join_leave(struct ast_bridge_channel *bridge_ch
 	ao2_iterator_destroy(&iter);
 }
 
-int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel)
+static int bridge_channel_reactor_adopt(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data));
+
+/*! Seconds a channel taken back from a reactor keeps its thread before it may return */
+#define BRIDGE_REACTOR_READOPT_DELAY 1
+
+/*!
+ * \internal
+ * \brief Service a bridge channel until it is to leave the bridge.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel to service.
+ * \param resume Thread function a reactor continues the channel on.
+ *   NULL if the channel must keep this thread.
+ * \param delay Non-zero to wait before handing the channel to a reactor.
+ *
+ * \retval 0 The channel is leaving the bridge and the bridge is locked.
+ * \retval 1 A reactor now services the channel.
+ */
+static int bridge_channel_join_wait(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data), int delay)
+{
+	struct timeval next_adopt = ast_tv(0, 0);
+
+	if (delay) {
+		next_adopt = ast_tvadd(ast_tvnow(), ast_tv(BRIDGE_REACTOR_READOPT_DELAY, 0));
+	}
+
+	ast_thread_place(AST_THREAD_ROLE_BRIDGE, bridge_channel->bridge->numa_node);
+
+	while (bridge_channel->state == BRIDGE_CHANNEL_STATE_WAIT) {
+		if (resume && ast_tvcmp(ast_tvnow(), next_adopt) >= 0) {
+			if (!bridge_channel_reactor_adopt(bridge_channel, resume)) {
+				ast_thread_unplace();
+				return 1;
+			}
+			/* Either no reactor has room or the channel needs a thread for now. */
+			next_adopt = ast_tvadd(ast_tvnow(), ast_tv(BRIDGE_REACTOR_READOPT_DELAY, 0));
+		}
+
+		/* Wait for something to do. */
+		bridge_channel_wait(bridge_channel);
+	}
+
+	/* The channel's own thread goes on with other things after the bridge. */
+	ast_thread_unplace();
+
+	/* Force a timeout on any accumulated DTMF hook digits. */
+	ast_bridge_channel_feature_digit(bridge_channel, 0);
+
+	bridge_channel_event_join_leave(bridge_channel, AST_BRIDGE_HOOK_TYPE_LEAVE);
+	ast_bridge_channel_lock_bridge(bridge_channel);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Pull a bridge channel out of the bridge it is leaving.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel leaving the bridge.
+ * \param swap Swap channel reference to release.  (NULL if none)
+ * \param res Result of the join to return.
+ *
+ * \note On entry, the bridge is locked.
+ *
+ * \return res
+ */
+static int bridge_channel_join_leave(struct ast_bridge_channel *bridge_channel,
+	struct ast_channel *swap, int res)
+{
+	bridge_channel_internal_pull(bridge_channel);
+	bridge_channel_settle_owed_events(bridge_channel->bridge, bridge_channel);
+	bridge_reconfigured(bridge_channel->bridge, 1);
+
+	/* Remove ourselves if we are the video source */
+	ast_bridge_remove_video_src(bridge_channel->bridge, bridge_channel->chan);
+
+	ast_bridge_unlock(bridge_channel->bridge);
+
+	/* Must release any swap ref after unlocking the bridge. */
+	ao2_t_cleanup(swap, "Bridge push with swap failed or exited immediately");
+
+	/* Complete any active hold before exiting the bridge. */
+	if (ast_channel_hold_state(bridge_channel->chan) == AST_CONTROL_HOLD) {
+		ast_debug(1, "Channel %s simulating UNHOLD for bridge end.\n",
+			ast_channel_name(bridge_channel->chan));
+		ast_indicate(bridge_channel->chan, AST_CONTROL_UNHOLD);
+	}
+
+	/* Complete any partial DTMF digit before exiting the bridge. */
+	if (ast_channel_sending_dtmf_digit(bridge_channel->chan)) {
+		ast_channel_end_dtmf(bridge_channel->chan,
+			ast_channel_sending_dtmf_digit(bridge_channel->chan),
+			ast_channel_sending_dtmf_tv(bridge_channel->chan), "bridge end");
+	}
+
+	/* Complete any T.38 session before exiting the bridge. */
+	if (ast_channel_is_t38_active(bridge_channel->chan)) {
+		struct ast_control_t38_parameters t38_parameters = {
+			.request_response = AST_T38_TERMINATED,
+		};
+
+		ast_debug(1, "Channel %s simulating T.38 terminate for bridge end.\n",
+			ast_channel_name(bridge_channel->chan));
+		ast_indicate_data(bridge_channel->chan, AST_CONTROL_T38_PARAMETERS,
+			&t38_parameters, sizeof(t38_parameters));
+	}
+
+	/* Indicate a source change since this channel is leaving the bridge system. */
+	ast_indicate(bridge_channel->chan, AST_CONTROL_SRCCHANGE);
+
+	/*
+	 * Wait for any dual redirect to complete.
+	 *
+	 * Must be done while "still in the bridge" for ast_async_goto()
+	 * to work right.
+	 */
+	while (ast_test_flag(ast_channel_flags(bridge_channel->chan), AST_FLAG_BRIDGE_DUAL_REDIRECT_WAIT)) {
+		sched_yield();
+	}
+	ast_channel_lock(bridge_channel->chan);
+	ast_channel_internal_bridge_set(bridge_channel->chan, NULL);
+	ast_channel_unlock(bridge_channel->chan);
+
+	ast_bridge_channel_restore_formats(bridge_channel);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Join the bridge channel to the bridge.
+ * \since 15.0.0
+ *
+ * \param bridge_channel The Channel in the bridge
+ * \param resume Thread function a reactor continues the channel on.
+ *   NULL if the channel must keep this thread.
+ *
+ * \retval 1 A reactor now services the channel.
+ * \retval 0 bridge channel successfully joined the bridge
+ * \retval -1 bridge channel failed to join the bridge
+ */
+static int bridge_channel_join(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data))
 {
 	int res = 0;
 	struct ast_bridge_features *channel_features;
@@ -2754,75 +3122,35 @@ int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel)
 
 		bridge_channel_event_join_leave(bridge_channel, AST_BRIDGE_HOOK_TYPE_JOIN);
 
-		while (bridge_channel->state == BRIDGE_CHANNEL_STATE_WAIT) {
-			/* Wait for something to do. */
-			bridge_channel_wait(bridge_channel);
+		if (bridge_channel_join_wait(bridge_channel, resume, 0)) {
+			return 1;
 		}
-
-		/* Force a timeout on any accumulated DTMF hook digits. */
-		ast_bridge_channel_feature_digit(bridge_channel, 0);
-
-		bridge_channel_event_join_leave(bridge_channel, AST_BRIDGE_HOOK_TYPE_LEAVE);
-		ast_bridge_channel_lock_bridge(bridge_channel);
 	}
 
-	bridge_channel_internal_pull(bridge_channel);
-	bridge_channel_settle_owed_events(bridge_channel->bridge, bridge_channel);
-	bridge_reconfigured(bridge_channel->bridge, 1);
-
-	/* Remove ourselves if we are the video source */
-	ast_bridge_remove_video_src(bridge_channel->bridge, bridge_channel->chan);
-
-	ast_bridge_unlock(bridge_channel->bridge);
-
-	/* Must release any swap ref after unlocking the bridge. */
-	ao2_t_cleanup(swap, "Bridge push with swap failed or exited immediately");
-
-	/* Complete any active hold before exiting the bridge. */
-	if (ast_channel_hold_state(bridge_channel->chan) == AST_CONTROL_HOLD) {
-		ast_debug(1, "Channel %s simulating UNHOLD for bridge end.\n",
-			ast_channel_name(bridge_channel->chan));
-		ast_indicate(bridge_channel->chan, AST_CONTROL_UNHOLD);
-	}
-
-	/* Complete any partial DTMF digit before exiting the bridge. */
-	if (ast_channel_sending_dtmf_digit(bridge_channel->chan)) {
-		ast_channel_end_dtmf(bridge_channel->chan,
-			ast_channel_sending_dtmf_digit(bridge_channel->chan),
-			ast_channel_sending_dtmf_tv(bridge_channel->chan), "bridge end");
-	}
+	return bridge_channel_join_leave(bridge_channel, swap, res);
+}
 
-	/* Complete any T.38 session before exiting the bridge. */
-	if (ast_channel_is_t38_active(bridge_channel->chan)) {
-		struct ast_control_t38_parameters t38_parameters = {
-			.request_response = AST_T38_TERMINATED,
-		};
+int bridge_channel_internal_join(struct ast_bridge_channel *bridge_channel)
+{
+	return bridge_channel_join(bridge_channel, NULL);
+}
 
-		ast_debug(1, "Channel %s simulating T.38 terminate for bridge end.\n",
-			ast_channel_name(bridge_channel->chan));
-		ast_indicate_data(bridge_channel->chan, AST_CONTROL_T38_PARAMETERS,
-			&t38_parameters, sizeof(t38_parameters));
-	}
+int bridge_channel_internal_join_reactor(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data))
+{
+	return bridge_channel_join(bridge_channel, ast_option_bridge_reactors ? resume : NULL);
+}
 
-	/* Indicate a source change since this channel is leaving the bridge system. */
-	ast_indicate(bridge_channel->chan, AST_CONTROL_SRCCHANGE);
+int bridge_channel_internal_join_resume(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data))
+{
+	bridge_channel->thread = pthread_self();
 
-	/*
-	 * Wait for any dual redirect to complete.
-	 *
-	 * Must be done while "still in the bridge" for ast_async_goto()
-	 * to work right.
-	 */
-	while (ast_test_flag(ast_channel_flags(bridge_channel->chan), AST_FLAG_BRIDGE_DUAL_REDIRECT_WAIT)) {
-		sched_yield();
+	if (bridge_channel_join_wait(bridge_channel, ast_option_bridge_reactors ? resume : NULL, 1)) {
+		return 1;
 	}
-	ast_channel_lock(bridge_channel->chan);
-	ast_channel_internal_bridge_set(bridge_channel->chan, NULL);
-	ast_channel_unlock(bridge_channel->chan);
 
-	ast_bridge_channel_restore_formats(bridge_channel);
-
-	return res;
+	return bridge_channel_join_leave(bridge_channel, NULL, 0);
 }
 
 int bridge_channel_internal_queue_blind_transfer(struct ast_channel *transferee,
@@ -2876,7 +3204,8 @@ int bridge_channel_internal_queue_attended_transfer(struct ast_channel *transfer
 int bridge_channel_internal_allows_optimization(struct ast_bridge_channel *bridge_channel)
 {
 	return bridge_channel->in_bridge
-		&& AST_LIST_EMPTY(&bridge_channel->wr_queue);
+		&& AST_LIST_EMPTY(&bridge_channel->wr_queue)
+		&& !bridge_channel_internal_queue_depth(bridge_channel);
 }
 
 /*!
@@ -2935,6 +3264,395 @@ static int pipe_init_nonblock(int *my_pipe)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Initialize the alert of a bridge channel.
+ *
+ * An eventfd where available, both ends being the same descriptor,
+ * or else a non-blocking pipe.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int bridge_channel_alert_init(struct ast_bridge_channel *bridge_channel)
+{
+#ifdef HAVE_EVENTFD
+	bridge_channel->alert_pipe[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	bridge_channel->alert_pipe[1] = bridge_channel->alert_pipe[0];
+	if (bridge_channel->alert_pipe[0] < 0) {
+		ast_log(LOG_WARNING, "Can't create eventfd! Try increasing max file descriptors with ulimit -n\n");
+		return -1;
+	}
+	return 0;
+#else
+	return pipe_init_nonblock(bridge_channel->alert_pipe);
+#endif
+}
+
+static void bridge_channel_alert_close(struct ast_bridge_channel *bridge_channel)
+{
+#ifdef HAVE_EVENTFD
+	if (bridge_channel->alert_pipe[0] > -1) {
+		close(bridge_channel->alert_pipe[0]);
+	}
+	bridge_channel->alert_pipe[0] = -1;
+	bridge_channel->alert_pipe[1] = -1;
+#else
+	pipe_close(bridge_channel->alert_pipe);
+#endif
+}
+
+/*! Maximum number of bridge channels a reactor services */
+#define BRIDGE_REACTOR_MAX_CHANNELS 64
+
+/*! Milliseconds before a reactor retries starting a thread for a channel */
+#define BRIDGE_REACTOR_RETRY_MS 100
+
+/*! \brief A bridge channel serviced by a reactor */
+struct bridge_reactor_entry {
+	/*! The bridge channel.  The reactor holds the reference its thread held. */
+	struct ast_bridge_channel *bridge_channel;
+	/*! Thread function to continue the channel on when it needs a thread again */
+	void *(*resume)(void *data);
+};
+
+/*!
+ * \brief A thread servicing bridge channels that do not need their own thread
+ *
+ * \details Idle bridged channels without DTMF or interval hooks only
+ * need something to read their frames into the bridge and write the
+ * frames the bridge queues for them.  A reactor waits on up to
+ * BRIDGE_REACTOR_MAX_CHANNELS such channels at once.  As soon as one
+ * needs more, such as running an action queued to it or leaving the
+ * bridge, the reactor starts a thread to continue the channel on.
+ */
+struct bridge_reactor {
+	/*! Thread servicing the channels */
+	pthread_t thread;
+	/*! Pipe to alert the thread when channels are handed to it */
+	int alert_pipe[2];
+	/*! Channels handed to the reactor but not yet adopted by its thread */
+	AST_VECTOR(, struct bridge_reactor_entry) pending;
+	/*! Number of channels pending or serviced by the reactor */
+	int count;
+};
+
+/*! Running reactors, protected by reactors_lock */
+static AST_VECTOR(, struct bridge_reactor *) reactors;
+
+/*! Protects the reactors and the pending channels and counts of each */
+AST_MUTEX_DEFINE_STATIC(reactors_lock);
+
+/*!
+ * \internal
+ * \brief Determine if a reactor can service a bridge channel.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel to check.
+ *
+ * \retval non-zero if a reactor can service the channel.
+ */
+static int bridge_channel_reactor_serviceable(struct ast_bridge_channel *bridge_channel)
+{
+	struct ast_bridge_features *features = bridge_channel->features;
+	struct ast_frame *fr;
+	int res;
+
+	if (ao2_container_count(features->dtmf_hooks)
+		|| ast_heap_size(features->interval_hooks)) {
+		return 0;
+	}
+
+	ast_bridge_channel_lock(bridge_channel);
+	res = bridge_channel->state == BRIDGE_CHANNEL_STATE_WAIT
+		&& !bridge_channel->suspended
+		&& !bridge_channel->dtmf_hook_state.collected[0];
+	if (res) {
+		/*
+		 * Actions and controls may run arbitrary code such as
+		 * playing files or interception routines.  They must not
+		 * hold up the other channels of the reactor.
+		 */
+		fr = AST_LIST_FIRST(&bridge_channel->wr_queue);
+		if (fr && fr->frametype != AST_FRAME_NULL
+			&& fr->frametype != AST_FRAME_VOICE
+			&& fr->frametype != AST_FRAME_VIDEO
+			&& fr->frametype != AST_FRAME_DTMF_BEGIN
+			&& fr->frametype != AST_FRAME_DTMF_END) {
+			res = 0;
+		}
+	}
+	ast_bridge_channel_unlock(bridge_channel);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Service a reactor channel that has something to do.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel to service.
+ * \param chan The channel if it has a frame to read.  NULL if not.
+ * \param outfd The fd that was ready if not the channel.
+ *
+ * \note This handles what bridge_channel_wait() handles after waiting.
+ *
+ * \return Nothing
+ */
+static void bridge_reactor_service(struct ast_bridge_channel *bridge_channel,
+	struct ast_channel *chan, int outfd)
+{
+	ast_callid_threadassoc_change(bridge_channel->callid);
+
+	if (ast_channel_unbridged(bridge_channel->chan)) {
+		ast_channel_set_unbridged(bridge_channel->chan, 0);
+		ast_bridge_channel_lock_bridge(bridge_channel);
+		bridge_tech_compat_flush(bridge_channel->bridge, NULL);
+		bridge_channel->bridge->reconfigured = 1;
+		bridge_reconfigured(bridge_channel->bridge, 0);
+		ast_bridge_unlock(bridge_channel->bridge);
+	}
+
+	/* Conditions may have changed since the channel was last checked. */
+	if (bridge_channel_reactor_serviceable(bridge_channel)) {
+		bridge_channel->activity = BRIDGE_CHANNEL_THREAD_FRAME;
+		if (chan) {
+			bridge_handle_trip(bridge_channel);
+		} else if (outfd == bridge_channel->alert_pipe[0]) {
+			bridge_channel_handle_write(bridge_channel);
+		}
+		bridge_channel->activity = BRIDGE_CHANNEL_THREAD_IDLE;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Destroy a reactor that has no thread.
+ * \since 15.0.0
+ *
+ * \param reactor Reactor to destroy.
+ *
+ * \return Nothing
+ */
+static void bridge_reactor_destroy(struct bridge_reactor *reactor)
+{
+	pipe_close(reactor->alert_pipe);
+	AST_VECTOR_FREE(&reactor->pending);
+	ast_free(reactor);
+}
+
+/*!
+ * \internal
+ * \brief Reactor thread servicing bridge channels.
+ * \since 15.0.0
+ *
+ * \note The thread exits once it has no channels left to service.
+ */
+static void *bridge_reactor_thread(void *data)
+{
+	struct bridge_reactor *reactor = data;
+	struct bridge_reactor_entry entries[BRIDGE_REACTOR_MAX_CHANNELS];
+	/*! Non-zero if the entry needs a thread that could not be started yet */
+	unsigned char stalled[BRIDGE_REACTOR_MAX_CHANNELS];
+	struct ast_channel *chans[BRIDGE_REACTOR_MAX_CHANNELS];
+	int fds[BRIDGE_REACTOR_MAX_CHANNELS + 1];
+	struct ast_channel *chan;
+	int check_pending = 1;
+	int count = 0;
+	int start = 0;
+	int released;
+	int retry;
+	int polled;
+	int outfd;
+	int ms;
+	int idx;
+	int x;
+
+	/* A reactor services the channels of many bridges, on any node. */
+	ast_thread_place(AST_THREAD_ROLE_BRIDGE, -1);
+
+	for (;;) {
+		if (check_pending) {
+			check_pending = 0;
+			ast_mutex_lock(&reactors_lock);
+			while (AST_VECTOR_SIZE(&reactor->pending)) {
+				entries[count] = AST_VECTOR_REMOVE_UNORDERED(&reactor->pending, 0);
+				entries[count].bridge_channel->thread = pthread_self();
+				++count;
+			}
+			if (!count) {
+				AST_VECTOR_REMOVE_ELEM_UNORDERED(&reactors, reactor, AST_VECTOR_ELEM_CLEANUP_NOOP);
+				ast_mutex_unlock(&reactors_lock);
+				break;
+			}
+			ast_mutex_unlock(&reactors_lock);
+		}
+
+		/* Give channels that now need their own thread one. */
+		released = 0;
+		retry = 0;
+		for (x = 0; x < count;) {
+			struct ast_bridge_channel *bridge_channel = entries[x].bridge_channel;
+			pthread_t thread;
+
+			stalled[x] = 0;
+			if (bridge_channel_reactor_serviceable(bridge_channel)) {
+				++x;
+				continue;
+			}
+			if (ast_pthread_create_detached(&thread, NULL, entries[x].resume, bridge_channel)) {
+				/* Keep the channel out of the wait and retry shortly. */
+				stalled[x] = 1;
+				retry = 1;
+				++x;
+				continue;
+			}
+			entries[x] = entries[--count];
+			++released;
+		}
+		if (released) {
+			ast_mutex_lock(&reactors_lock);
+			reactor->count -= released;
+			ast_mutex_unlock(&reactors_lock);
+			if (!count) {
+				check_pending = 1;
+				continue;
+			}
+		}
+
+		/* Rotate the channels each pass so none is always polled last. */
+		if (count <= start) {
+			start = 0;
+		}
+		polled = 0;
+		for (x = 0; x < count; ++x) {
+			idx = (start + x) % count;
+			if (stalled[idx]) {
+				continue;
+			}
+			chans[polled] = entries[idx].bridge_channel->chan;
+			fds[polled] = entries[idx].bridge_channel->alert_pipe[0];
+			++polled;
+		}
+		fds[polled] = reactor->alert_pipe[0];
+		++start;
+
+		outfd = -1;
+		ms = retry ? BRIDGE_REACTOR_RETRY_MS : -1;
+		chan = ast_waitfor_nandfds(chans, polled, fds, polled + 1, NULL, &outfd, &ms);
+		if (!chan && outfd == reactor->alert_pipe[0]) {
+			char nudge;
+
+			if (read(reactor->alert_pipe[0], &nudge, sizeof(nudge)) < 0
+				&& errno != EINTR && errno != EAGAIN) {
+				ast_log(LOG_WARNING, "read() failed for bridge reactor alert pipe: %s\n",
+					strerror(errno));
+			}
+			check_pending = 1;
+			continue;
+		}
+		if (!chan && outfd < 0) {
+			/* Timeout or interrupted */
+			continue;
+		}
+
+		for (x = 0; x < count; ++x) {
+			struct ast_bridge_channel *bridge_channel = entries[x].bridge_channel;
+
+			if (chan ? bridge_channel->chan == chan : bridge_channel->alert_pipe[0] == outfd) {
+				bridge_reactor_service(bridge_channel, chan, outfd);
+				break;
+			}
+		}
+	}
+
+	bridge_reactor_destroy(reactor);
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Hand a bridge channel to a reactor.
+ * \since 15.0.0
+ *
+ * \param bridge_channel Channel to hand over.
+ * \param resume Thread function to continue the channel on when it
+ *   needs a thread again.
+ *
+ * \retval 0 A reactor now services the channel.  The calling thread
+ *   must no longer touch it.
+ * \retval -1 The channel must stay on the calling thread for now.
+ */
+static int bridge_channel_reactor_adopt(struct ast_bridge_channel *bridge_channel,
+	void *(*resume)(void *data))
+{
+	struct bridge_reactor_entry entry = {
+		.bridge_channel = bridge_channel,
+		.resume = resume,
+	};
+	struct bridge_reactor *reactor = NULL;
+	char nudge = 0;
+	int idx;
+
+	if (!bridge_channel_reactor_serviceable(bridge_channel)) {
+		return -1;
+	}
+
+	ast_mutex_lock(&reactors_lock);
+
+	/* Use the least busy reactor with room for the channel. */
+	for (idx = 0; idx < AST_VECTOR_SIZE(&reactors); ++idx) {
+		struct bridge_reactor *candidate = AST_VECTOR_GET(&reactors, idx);
+
+		if (candidate->count < BRIDGE_REACTOR_MAX_CHANNELS
+			&& (!reactor || candidate->count < reactor->count)) {
+			reactor = candidate;
+		}
+	}
+
+	if (!reactor && AST_VECTOR_SIZE(&reactors) < ast_option_bridge_reactors) {
+		reactor = ast_calloc(1, sizeof(*reactor));
+		if (reactor) {
+			reactor->alert_pipe[0] = -1;
+			reactor->alert_pipe[1] = -1;
+		}
+		if (reactor && (AST_VECTOR_INIT(&reactor->pending, 8)
+			|| pipe_init_nonblock(reactor->alert_pipe)
+			|| AST_VECTOR_APPEND(&reactors, reactor))) {
+			bridge_reactor_destroy(reactor);
+			reactor = NULL;
+		}
+		if (reactor && ast_pthread_create_detached(&reactor->thread, NULL,
+			bridge_reactor_thread, reactor)) {
+			AST_VECTOR_REMOVE_ELEM_UNORDERED(&reactors, reactor, AST_VECTOR_ELEM_CLEANUP_NOOP);
+			bridge_reactor_destroy(reactor);
+			reactor = NULL;
+		}
+	}
+
+	if (!reactor || AST_VECTOR_APPEND(&reactor->pending, entry)) {
+		ast_mutex_unlock(&reactors_lock);
+		return -1;
+	}
+	++reactor->count;
+
+	ast_debug(3, "Bridge %s: %p(%s) is now serviced by a reactor\n",
+		bridge_channel->bridge->uniqueid, bridge_channel,
+		ast_channel_name(bridge_channel->chan));
+
+	if (write(reactor->alert_pipe[1], &nudge, sizeof(nudge)) != sizeof(nudge)
+		&& errno != EAGAIN) {
+		/* A full pipe already has the thread on its way to check. */
+		ast_log(LOG_ERROR, "Failed to alert bridge reactor of a new channel: %s\n",
+			strerror(errno));
+	}
+
+	ast_mutex_unlock(&reactors_lock);
+
+	return 0;
+}
+
 /* Destroy elements of the bridge channel structure and the bridge channel structure itself */
 static void bridge_channel_destroy(void *obj)
 {
@@ -2954,7 +3672,13 @@ static void bridge_channel_destroy(void *obj)
 	while ((fr = AST_LIST_REMOVE_HEAD(&bridge_channel->wr_queue, frame_list))) {
 		bridge_frame_free(fr);
 	}
-	pipe_close(bridge_channel->alert_pipe);
+	if (bridge_channel->wr_ring) {
+		while ((fr = bridge_channel_wr_ring_pop(bridge_channel->wr_ring))) {
+			bridge_frame_free(fr);
+		}
+		ast_free(bridge_channel->wr_ring);
+	}
+	bridge_channel_alert_close(bridge_channel);
 
 	ast_cond_destroy(&bridge_channel->cond);
 
@@ -2971,7 +3695,10 @@ struct ast_bridge_channel *bridge_channel_internal_alloc(struct ast_bridge *brid
 		return NULL;
 	}
 	ast_cond_init(&bridge_channel->cond, NULL);
-	if (pipe_init_nonblock(bridge_channel->alert_pipe)) {
+	bridge_channel->alert_pipe[0] = -1;
+	bridge_channel->alert_pipe[1] = -1;
+	bridge_channel->wr_ring = bridge_channel_wr_ring_alloc();
+	if (!bridge_channel->wr_ring || bridge_channel_alert_init(bridge_channel)) {
 		ao2_ref(bridge_channel, -1);
 		return NULL;
 	}
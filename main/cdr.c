@@ -70,6 +70,7 @@
 #include "asterisk/stasis_message_router.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 
 /*** DOCUMENTATION
 	<configInfo name="cdr" language="en_US">
@@ -289,6 +290,8 @@ struct cdr_beitem {
 	char name[20];
 	char desc[80];
 	ast_cdrbe be;
+	/*! Called with whole batches in batch mode, if set */
+	ast_cdrbe_batch batch_be;
 	AST_RWLIST_ENTRY(cdr_beitem) list;
 	int suspended:1;
 };
@@ -334,6 +337,29 @@ static struct ao2_container *active_cdrs_by_channel;
 /*! \brief Message router for stasis messages regarding channel state */
 static struct stasis_message_router *stasis_router;
 
+/*! \brief The number of serializers CDR messages are sharded across */
+#define CDR_SHARD_COUNT 16
+
+/*! \brief The threadpool backing the CDR shard serializers */
+static struct ast_threadpool *cdr_pool;
+
+/*!
+ * \brief The serializers that process CDR messages
+ *
+ * Every message affecting a CDR chain is processed on the serializer
+ * selected by the hash of the chain's Party A channel uniqueid, so the
+ * messages for any one channel are handled in order.
+ */
+static struct ast_taskprocessor *cdr_shards[CDR_SHARD_COUNT];
+
+/*!
+ * \brief Lock serializing bridge pairings
+ *
+ * Pairing a channel entering a bridge with the other participants locks
+ * CDR chains belonging to other shards while holding its own.
+ */
+AST_MUTEX_DEFINE_STATIC(cdr_bridge_pairing_lock);
+
 /*! \brief Our subscription for bridges */
 static struct stasis_forward *bridge_subscription;
 
@@ -1083,9 +1109,10 @@ static long cdr_object_get_billsec(struct cdr_object *cdr)
 static void set_variable(struct varshead *headp, const char *name, const char *value)
 {
 	struct ast_var_t *newvariable;
+	unsigned int hash = ast_var_hash(name);
 
 	AST_LIST_TRAVERSE_SAFE_BEGIN(headp, newvariable, entries) {
-		if (!strcasecmp(ast_var_name(newvariable), name)) {
+		if (newvariable->hash == hash && !strcasecmp(ast_var_name(newvariable), name)) {
 			AST_LIST_REMOVE_CURRENT(entries);
 			ast_var_delete(newvariable);
 			break;
@@ -2053,6 +2080,27 @@ static int cdr_object_update_party_b(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Run a Party B callback against every active CDR chain
+ *
+ * \note The chains may belong to other shards, so each one is locked while
+ * the callback runs. The container is never locked while holding a chain.
+ */
+static void cdr_object_party_b_foreach(ao2_callback_fn *callback, void *arg)
+{
+	struct ao2_iterator it_cdrs;
+	struct cdr_object *cdr;
+
+	it_cdrs = ao2_iterator_init(active_cdrs_by_channel, 0);
+	for (; (cdr = ao2_iterator_next(&it_cdrs)); ao2_ref(cdr, -1)) {
+		ao2_lock(cdr);
+		callback(cdr, arg, 0);
+		ao2_unlock(cdr);
+	}
+	ao2_iterator_destroy(&it_cdrs);
+}
+
 /*! \brief Determine if we need to add a new CDR based on snapshots */
 static int check_new_cdr_needed(struct ast_channel_snapshot *old_snapshot,
 		struct ast_channel_snapshot *new_snapshot)
@@ -2156,11 +2204,9 @@ static void handle_channel_cache_message(void *data, struct stasis_subscription
 
 	/* Handle Party B */
 	if (new_snapshot) {
-		ao2_callback(active_cdrs_by_channel, OBJ_NODATA, cdr_object_update_party_b,
-			new_snapshot);
+		cdr_object_party_b_foreach(cdr_object_update_party_b, new_snapshot);
 	} else {
-		ao2_callback(active_cdrs_by_channel, OBJ_NODATA, cdr_object_finalize_party_b,
-			old_snapshot);
+		cdr_object_party_b_foreach(cdr_object_finalize_party_b, old_snapshot);
 	}
 
 }
@@ -2274,9 +2320,7 @@ static void handle_bridge_leave_message(void *data, struct stasis_subscription *
 
 	if (strcmp(bridge->subclass, "parking")) {
 		/* Party B */
-		ao2_callback(active_cdrs_by_channel, OBJ_NODATA,
-				cdr_object_party_b_left_bridge_cb,
-				&leave_data);
+		cdr_object_party_b_foreach(cdr_object_party_b_left_bridge_cb, &leave_data);
 	}
 }
 
@@ -2556,7 +2600,9 @@ static void handle_bridge_enter_message(void *data, struct stasis_subscription *
 	if (!strcmp(bridge->subclass, "parking")) {
 		handle_parking_bridge_enter_message(cdr, bridge, channel);
 	} else {
+		ast_mutex_lock(&cdr_bridge_pairing_lock);
 		handle_standard_bridge_enter_message(cdr, bridge, channel);
+		ast_mutex_unlock(&cdr_bridge_pairing_lock);
 	}
 }
 
@@ -2627,6 +2673,75 @@ static void handle_parked_call_message(void *data, struct stasis_subscription *s
 
 }
 
+/*!
+ * \internal
+ * \brief Get the shard that processes the CDR chain for a channel
+ * \param uniqueid The uniqueid of the chain's Party A channel
+ */
+static struct ast_taskprocessor *cdr_shard_get(const char *uniqueid)
+{
+	return cdr_shards[ast_str_case_hash(S_OR(uniqueid, "")) % CDR_SHARD_COUNT];
+}
+
+/*! \brief Completion state for a shard synchronization */
+struct cdr_shard_sync_data {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	int complete;
+};
+
+static int cdr_shard_sync_task(void *data)
+{
+	struct cdr_shard_sync_data *sync_data = data;
+
+	ast_mutex_lock(&sync_data->lock);
+	sync_data->complete = 1;
+	ast_cond_signal(&sync_data->cond);
+	ast_mutex_unlock(&sync_data->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for a shard to process everything queued to it so far
+ */
+static void cdr_shard_sync(struct ast_taskprocessor *shard)
+{
+	struct cdr_shard_sync_data sync_data = { .complete = 0, };
+
+	if (!shard || ast_taskprocessor_is_task(shard)) {
+		return;
+	}
+
+	ast_mutex_init(&sync_data.lock);
+	ast_cond_init(&sync_data.cond, NULL);
+
+	if (!ast_taskprocessor_push(shard, cdr_shard_sync_task, &sync_data)) {
+		ast_mutex_lock(&sync_data.lock);
+		while (!sync_data.complete) {
+			ast_cond_wait(&sync_data.cond, &sync_data.lock);
+		}
+		ast_mutex_unlock(&sync_data.lock);
+	}
+
+	ast_mutex_destroy(&sync_data.lock);
+	ast_cond_destroy(&sync_data.cond);
+}
+
+/*!
+ * \internal
+ * \brief Wait for every shard to process everything queued to it so far
+ */
+static void cdr_shards_sync(void)
+{
+	int i;
+
+	for (i = 0; i < CDR_SHARD_COUNT; i++) {
+		cdr_shard_sync(cdr_shards[i]);
+	}
+}
+
 /*!
  * \brief Handler for a synchronization message
  * \param data Passed on
@@ -2637,7 +2752,120 @@ static void handle_parked_call_message(void *data, struct stasis_subscription *s
 static void handle_cdr_sync_message(void *data, struct stasis_subscription *sub,
 		struct stasis_message *message)
 {
-	return;
+	cdr_shards_sync();
+}
+
+/*! \brief A handler for a CDR message and how to pick the shard that runs it */
+struct cdr_shard_route {
+	/*! The handler run on the shard */
+	stasis_subscription_cb handler;
+	/*! Returns the uniqueid of the channel whose CDR chain the message affects */
+	const char *(*shard_key)(struct stasis_message *message);
+};
+
+static const char *channel_cache_shard_key(struct stasis_message *message)
+{
+	struct stasis_cache_update *update = stasis_message_data(message);
+	struct ast_channel_snapshot *snapshot;
+
+	snapshot = stasis_message_data(update->new_snapshot ? update->new_snapshot : update->old_snapshot);
+	return snapshot ? snapshot->uniqueid : NULL;
+}
+
+static const char *dial_shard_key(struct stasis_message *message)
+{
+	struct ast_multi_channel_blob *payload = stasis_message_data(message);
+	struct ast_channel_snapshot *snapshot;
+
+	/* The same party that handle_dial_message treats as running the show */
+	snapshot = ast_multi_channel_blob_get_channel(payload, "caller");
+	if (!snapshot) {
+		snapshot = ast_multi_channel_blob_get_channel(payload, "peer");
+	}
+	return snapshot ? snapshot->uniqueid : NULL;
+}
+
+static const char *bridge_shard_key(struct stasis_message *message)
+{
+	struct ast_bridge_blob *blob = stasis_message_data(message);
+
+	return blob->channel ? blob->channel->uniqueid : NULL;
+}
+
+static const char *parked_call_shard_key(struct stasis_message *message)
+{
+	struct ast_parked_call_payload *payload = stasis_message_data(message);
+
+	return payload->parkee ? payload->parkee->uniqueid : NULL;
+}
+
+static const struct cdr_shard_route channel_cache_route = {
+	.handler = handle_channel_cache_message,
+	.shard_key = channel_cache_shard_key,
+};
+
+static const struct cdr_shard_route dial_route = {
+	.handler = handle_dial_message,
+	.shard_key = dial_shard_key,
+};
+
+static const struct cdr_shard_route bridge_enter_route = {
+	.handler = handle_bridge_enter_message,
+	.shard_key = bridge_shard_key,
+};
+
+static const struct cdr_shard_route bridge_leave_route = {
+	.handler = handle_bridge_leave_message,
+	.shard_key = bridge_shard_key,
+};
+
+static const struct cdr_shard_route parked_call_route = {
+	.handler = handle_parked_call_message,
+	.shard_key = parked_call_shard_key,
+};
+
+/*! \brief A message queued to a shard */
+struct cdr_shard_task {
+	const struct cdr_shard_route *route;
+	struct stasis_message *message;
+};
+
+static int cdr_shard_task_exec(void *data)
+{
+	struct cdr_shard_task *task = data;
+
+	task->route->handler(NULL, NULL, task->message);
+	ao2_ref(task->message, -1);
+	ast_free(task);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Message router callback handing a message off to its shard
+ *
+ * \param data The \ref cdr_shard_route for the message type
+ */
+static void cdr_shard_dispatch(void *data, struct stasis_subscription *sub,
+		struct stasis_message *message)
+{
+	const struct cdr_shard_route *route = data;
+	struct cdr_shard_task *task;
+
+	task = ast_malloc(sizeof(*task));
+	if (!task) {
+		return;
+	}
+	task->route = route;
+	task->message = ao2_bump(message);
+
+	if (ast_taskprocessor_push(cdr_shard_get(route->shard_key(message)),
+			cdr_shard_task_exec, task)) {
+		ast_log(LOG_WARNING, "Unable to queue %s message to a CDR shard; processing inline\n",
+			stasis_message_type_name(stasis_message_type(message)));
+		cdr_shard_task_exec(task);
+	}
 }
 
 struct ast_cdr_config *ast_cdr_get_config(void)
@@ -2700,7 +2928,7 @@ int ast_cdr_backend_unsuspend(const char *name)
 	return success;
 }
 
-static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be)
+static int cdr_generic_register(struct be_list *generic_list, const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch batch_be)
 {
 	struct cdr_beitem *i = NULL;
 
@@ -2725,6 +2953,7 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 		return -1;
 
 	i->be = be;
+	i->batch_be = batch_be;
 	ast_copy_string(i->name, name, sizeof(i->name));
 	ast_copy_string(i->desc, desc, sizeof(i->desc));
 
@@ -2736,12 +2965,17 @@ static int cdr_generic_register(struct be_list *generic_list, const char *name,
 
 int ast_cdr_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register(&be_list, name, desc, be);
+	return cdr_generic_register(&be_list, name, desc, be, NULL);
+}
+
+int ast_cdr_register_batch(const char *name, const char *desc, ast_cdrbe be, ast_cdrbe_batch batch_be)
+{
+	return cdr_generic_register(&be_list, name, desc, be, batch_be);
 }
 
 int ast_cdr_modifier_register(const char *name, const char *desc, ast_cdrbe be)
 {
-	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be);
+	return cdr_generic_register((struct be_list *)&mo_list, name, desc, be, NULL);
 }
 
 static int ast_cdr_generic_unregister(struct be_list *generic_list, const char *name)
@@ -2812,13 +3046,15 @@ struct ast_cdr *ast_cdr_dup(struct ast_cdr *cdr)
 static const char *cdr_format_var_internal(struct ast_cdr *cdr, const char *name)
 {
 	struct ast_var_t *variables;
+	unsigned int hash;
 
 	if (ast_strlen_zero(name)) {
 		return NULL;
 	}
 
+	hash = ast_var_hash(name);
 	AST_LIST_TRAVERSE(&cdr->varshead, variables, entries) {
-		if (!strcasecmp(name, ast_var_name(variables))) {
+		if (variables->hash == hash && !strcasecmp(name, ast_var_name(variables))) {
 			return ast_var_value(variables);
 		}
 	}
@@ -2944,6 +3180,41 @@ static int cdr_object_get_by_name_cb(void *obj, void *arg, int flags)
 	return 0;
 }
 
+static struct cdr_object *cdr_object_get_by_name(const char *name);
+
+/*!
+ * \internal
+ * \brief Wait for the shard of a channel to catch up before touching its CDRs
+ *
+ * Used by the public API, which acts on a channel's CDRs by name and expects
+ * every message published for that channel beforehand to have been applied.
+ *
+ * \param channel_name The name (or uniqueid) of the channel
+ */
+static void cdr_channel_sync(const char *channel_name)
+{
+	struct ast_channel *chan;
+	struct cdr_object *cdr;
+
+	if (ast_strlen_zero(channel_name)) {
+		return;
+	}
+
+	chan = ast_channel_get_by_name(channel_name);
+	if (chan) {
+		cdr_shard_sync(cdr_shard_get(ast_channel_uniqueid(chan)));
+		ast_channel_unref(chan);
+		return;
+	}
+
+	/* The channel may already be gone while its CDRs are still active */
+	cdr = cdr_object_get_by_name(channel_name);
+	if (cdr) {
+		cdr_shard_sync(cdr_shard_get(cdr->uniqueid));
+		ao2_ref(cdr, -1);
+	}
+}
+
 /* Read Only CDR variables */
 static const char * const cdr_readonly_vars[] = {
 	"clid",
@@ -2984,6 +3255,7 @@ int ast_cdr_setvar(const char *channel_name, const char *name, const char *value
 		}
 	}
 
+	cdr_channel_sync(channel_name);
 	it_cdrs = ao2_callback(active_cdrs_by_channel, OBJ_MULTIPLE, cdr_object_select_all_by_name_cb, arg);
 	if (!it_cdrs) {
 		ast_log(AST_LOG_ERROR, "Unable to find CDR for channel %s\n", channel_name);
@@ -3020,9 +3292,10 @@ int ast_cdr_setvar(const char *channel_name, const char *name, const char *value
 static void cdr_object_format_var_internal(struct cdr_object *cdr, const char *name, char *value, size_t length)
 {
 	struct ast_var_t *variable;
+	unsigned int hash = ast_var_hash(name);
 
 	AST_LIST_TRAVERSE(&cdr->party_a.variables, variable, entries) {
-		if (!strcasecmp(name, ast_var_name(variable))) {
+		if (variable->hash == hash && !strcasecmp(name, ast_var_name(variable))) {
 			ast_copy_string(value, ast_var_value(variable), length);
 			return;
 		}
@@ -3117,9 +3390,11 @@ static struct cdr_object *cdr_object_get_by_name(const char *name)
 
 int ast_cdr_getvar(const char *channel_name, const char *name, char *value, size_t length)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct cdr_object *cdr_obj;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		ast_log(AST_LOG_ERROR, "Unable to find CDR for channel %s\n", channel_name);
 		return 1;
@@ -3144,13 +3419,15 @@ int ast_cdr_getvar(const char *channel_name, const char *name, char *value, size
 
 int ast_cdr_serialize_variables(const char *channel_name, struct ast_str **buf, char delim, char sep)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct cdr_object *it_cdr;
 	struct ast_var_t *variable;
 	const char *var;
 	char workspace[256];
 	int total = 0, x = 0, i;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		RAII_VAR(struct module_config *, mod_cfg,
 			 ao2_global_obj_ref(module_configs), ao2_cleanup);
@@ -3264,13 +3541,16 @@ static int cdr_object_update_party_b_userfield_cb(void *obj, void *arg, int flag
 
 void ast_cdr_setuserfield(const char *channel_name, const char *userfield)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct party_b_userfield_update party_b_info = {
 			.channel_name = channel_name,
 			.userfield = userfield,
 	};
 	struct cdr_object *it_cdr;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
+
 	/* Handle Party A */
 	if (cdr) {
 		ao2_lock(cdr);
@@ -3284,34 +3564,46 @@ void ast_cdr_setuserfield(const char *channel_name, const char *userfield)
 	}
 
 	/* Handle Party B */
-	ao2_callback(active_cdrs_by_channel, OBJ_NODATA,
-			cdr_object_update_party_b_userfield_cb,
-			&party_b_info);
+	cdr_object_party_b_foreach(cdr_object_update_party_b_userfield_cb, &party_b_info);
 
 }
 
+/*!
+ * \internal
+ * \brief Run the modifiers on a CDR and determine if the backends get it
+ *
+ * \retval 1 if the CDR should be posted
+ * \retval 0 if the CDR is skipped
+ */
+static int cdr_prepare_post(struct module_config *mod_cfg, struct ast_cdr *cdr)
+{
+	struct cdr_beitem *i;
+
+	/* For people, who don't want to see unanswered single-channel events */
+	if (!ast_test_flag(&mod_cfg->general->settings, CDR_UNANSWERED) &&
+			cdr->disposition < AST_CDR_ANSWERED &&
+			(ast_strlen_zero(cdr->channel) || ast_strlen_zero(cdr->dstchannel))) {
+		ast_debug(1, "Skipping CDR  for %s since we weren't answered\n", cdr->channel);
+		return 0;
+	}
+
+	/* Modify CDR's */
+	AST_RWLIST_RDLOCK(&mo_list);
+	AST_RWLIST_TRAVERSE(&mo_list, i, list) {
+		i->be(cdr);
+	}
+	AST_RWLIST_UNLOCK(&mo_list);
+
+	return !ast_test_flag(cdr, AST_CDR_FLAG_DISABLE);
+}
+
 static void post_cdr(struct ast_cdr *cdr)
 {
 	RAII_VAR(struct module_config *, mod_cfg, ao2_global_obj_ref(module_configs), ao2_cleanup);
 	struct cdr_beitem *i;
 
 	for (; cdr ; cdr = cdr->next) {
-		/* For people, who don't want to see unanswered single-channel events */
-		if (!ast_test_flag(&mod_cfg->general->settings, CDR_UNANSWERED) &&
-				cdr->disposition < AST_CDR_ANSWERED &&
-				(ast_strlen_zero(cdr->channel) || ast_strlen_zero(cdr->dstchannel))) {
-			ast_debug(1, "Skipping CDR  for %s since we weren't answered\n", cdr->channel);
-			continue;
-		}
-
-		/* Modify CDR's */
-		AST_RWLIST_RDLOCK(&mo_list);
-		AST_RWLIST_TRAVERSE(&mo_list, i, list) {
-			i->be(cdr);
-		}
-		AST_RWLIST_UNLOCK(&mo_list);
-
-		if (ast_test_flag(cdr, AST_CDR_FLAG_DISABLE)) {
+		if (!cdr_prepare_post(mod_cfg, cdr)) {
 			continue;
 		}
 		AST_RWLIST_RDLOCK(&be_list);
@@ -3326,9 +3618,11 @@ static void post_cdr(struct ast_cdr *cdr)
 
 int ast_cdr_set_property(const char *channel_name, enum ast_cdr_options option)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct cdr_object *it_cdr;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		return -1;
 	}
@@ -3351,9 +3645,11 @@ int ast_cdr_set_property(const char *channel_name, enum ast_cdr_options option)
 
 int ast_cdr_clear_property(const char *channel_name, enum ast_cdr_options option)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct cdr_object *it_cdr;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		return -1;
 	}
@@ -3372,10 +3668,12 @@ int ast_cdr_clear_property(const char *channel_name, enum ast_cdr_options option
 
 int ast_cdr_reset(const char *channel_name, int keep_variables)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct ast_var_t *vardata;
 	struct cdr_object *it_cdr;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		return -1;
 	}
@@ -3408,11 +3706,13 @@ int ast_cdr_reset(const char *channel_name, int keep_variables)
 
 int ast_cdr_fork(const char *channel_name, struct ast_flags *options)
 {
-	RAII_VAR(struct cdr_object *, cdr, cdr_object_get_by_name(channel_name), ao2_cleanup);
+	RAII_VAR(struct cdr_object *, cdr, NULL, ao2_cleanup);
 	struct cdr_object *new_cdr;
 	struct cdr_object *it_cdr;
 	struct cdr_object *cdr_obj;
 
+	cdr_channel_sync(channel_name);
+	cdr = cdr_object_get_by_name(channel_name);
 	if (!cdr) {
 		return -1;
 	}
@@ -3515,14 +3815,77 @@ static int init_batch(void)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Post a batch of CDRs
+ *
+ * Backends registered with \ref ast_cdr_register_batch get the whole batch
+ * in one call. Other backends get the records one at a time.
+ */
+static void post_cdr_batch(struct cdr_batch_item *batchitem)
+{
+	RAII_VAR(struct module_config *, mod_cfg, ao2_global_obj_ref(module_configs), ao2_cleanup);
+	struct cdr_batch_item *item;
+	struct ast_cdr **cdrs;
+	struct ast_cdr *cdr;
+	struct cdr_beitem *i;
+	size_t count = 0;
+	size_t x;
+
+	for (item = batchitem; item; item = item->next) {
+		for (cdr = item->cdr; cdr; cdr = cdr->next) {
+			count++;
+		}
+	}
+	if (!count) {
+		return;
+	}
+
+	cdrs = ast_malloc(count * sizeof(*cdrs));
+	if (!cdrs) {
+		for (item = batchitem; item; item = item->next) {
+			post_cdr(item->cdr);
+		}
+		return;
+	}
+
+	count = 0;
+	for (item = batchitem; item; item = item->next) {
+		for (cdr = item->cdr; cdr; cdr = cdr->next) {
+			if (cdr_prepare_post(mod_cfg, cdr)) {
+				cdrs[count++] = cdr;
+			}
+		}
+	}
+
+	if (count) {
+		AST_RWLIST_RDLOCK(&be_list);
+		AST_RWLIST_TRAVERSE(&be_list, i, list) {
+			if (i->suspended) {
+				continue;
+			}
+			if (i->batch_be) {
+				i->batch_be(cdrs, count);
+				continue;
+			}
+			for (x = 0; x < count; x++) {
+				i->be(cdrs[x]);
+			}
+		}
+		AST_RWLIST_UNLOCK(&be_list);
+	}
+
+	ast_free(cdrs);
+}
+
 static void *do_batch_backend_process(void *data)
 {
 	struct cdr_batch_item *processeditem;
 	struct cdr_batch_item *batchitem = data;
 
-	/* Push each CDR into storage mechanism(s) and free all the memory */
+	/* Push the CDRs into storage mechanism(s) and free all the memory */
+	post_cdr_batch(batchitem);
 	while (batchitem) {
-		post_cdr(batchitem->cdr);
 		ast_cdr_free(batchitem->cdr);
 		processeditem = batchitem;
 		batchitem = batchitem->next;
@@ -4115,6 +4478,61 @@ static int process_config(int reload)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Create the serializers CDR messages are sharded across
+ */
+static int cdr_shards_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = CDR_SHARD_COUNT,
+		.max_size = CDR_SHARD_COUNT,
+	};
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	int i;
+
+	cdr_pool = ast_threadpool_create("cdr", NULL, &options);
+	if (!cdr_pool) {
+		return -1;
+	}
+
+	for (i = 0; i < CDR_SHARD_COUNT; i++) {
+		ast_taskprocessor_build_name(name, sizeof(name), "cdr/shard-%02d", i);
+		cdr_shards[i] = ast_threadpool_serializer(name, cdr_pool);
+		if (!cdr_shards[i]) {
+			return -1;
+		}
+		ast_taskprocessor_alert_set_levels(cdr_shards[i], -1,
+			10 * AST_TASKPROCESSOR_HIGH_WATER_LEVEL);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Drain and destroy the CDR shards
+ *
+ * \note The message router must already be unsubscribed so nothing new
+ * is queued.
+ */
+static void cdr_shards_shutdown(void)
+{
+	int i;
+
+	cdr_shards_sync();
+	for (i = 0; i < CDR_SHARD_COUNT; i++) {
+		ast_taskprocessor_unreference(cdr_shards[i]);
+		cdr_shards[i] = NULL;
+	}
+
+	ast_threadpool_shutdown(cdr_pool);
+	cdr_pool = NULL;
+}
+
 static void cdr_engine_cleanup(void)
 {
 	destroy_subscriptions();
@@ -4125,6 +4543,8 @@ static void cdr_engine_shutdown(void)
 	stasis_message_router_unsubscribe_and_join(stasis_router);
 	stasis_router = NULL;
 
+	cdr_shards_shutdown();
+
 	ao2_cleanup(cdr_topic);
 	cdr_topic = NULL;
 
@@ -4240,11 +4660,15 @@ int ast_cdr_engine_init(void)
 		return -1;
 	}
 
-	stasis_message_router_add_cache_update(stasis_router, ast_channel_snapshot_type(), handle_channel_cache_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_dial_type(), handle_dial_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), handle_bridge_enter_message, NULL);
-	stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), handle_bridge_leave_message, NULL);
-	stasis_message_router_add(stasis_router, ast_parked_call_type(), handle_parked_call_message, NULL);
+	if (cdr_shards_init()) {
+		return -1;
+	}
+
+	stasis_message_router_add_cache_update(stasis_router, ast_channel_snapshot_type(), cdr_shard_dispatch, (void *) &channel_cache_route);
+	stasis_message_router_add(stasis_router, ast_channel_dial_type(), cdr_shard_dispatch, (void *) &dial_route);
+	stasis_message_router_add(stasis_router, ast_channel_entered_bridge_type(), cdr_shard_dispatch, (void *) &bridge_enter_route);
+	stasis_message_router_add(stasis_router, ast_channel_left_bridge_type(), cdr_shard_dispatch, (void *) &bridge_leave_route);
+	stasis_message_router_add(stasis_router, ast_parked_call_type(), cdr_shard_dispatch, (void *) &parked_call_route);
 	stasis_message_router_add(stasis_router, cdr_sync_message_type(), handle_cdr_sync_message, NULL);
 
 	active_cdrs_by_channel = ao2_container_alloc(NUM_CDR_BUCKETS,
@@ -57,7 +57,9 @@
 #include "asterisk/parking.h"
 #include "asterisk/pickup.h"
 #include "asterisk/core_local.h"
+#include "asterisk/paths.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 
 /*** DOCUMENTATION
 	<configInfo name="cel" language="en_US">
@@ -70,6 +72,29 @@
 				<configOption name="dateformat">
 					<synopsis>The format to be used for dates when logging</synopsis>
 				</configOption>
+				<configOption name="shards" default="1">
+					<synopsis>Number of threads CEL events are generated on</synopsis>
+					<description><para>The messages about a call are processed on the thread
+					picked by the linkedid of the channel, so the events of a call are
+					generated in order.  With more than one thread, events of different
+					calls may reach the backends in a different order than they happened.
+					Takes effect when CEL is enabled.</para></description>
+				</configOption>
+				<configOption name="backend_queue_size" default="1000">
+					<synopsis>Number of events held in memory for each backend</synopsis>
+					<description><para>Events are queued for each backend and handed to it
+					on a thread of its own.  Once this many events are waiting, later
+					events are spilled to disk until the backend catches up.</para></description>
+				</configOption>
+				<configOption name="backend_spill_size" default="10240">
+					<synopsis>Kilobytes of events spilled to disk for each backend</synopsis>
+					<description><para>Events that do not fit in the queue of a backend are
+					written to a file in the <literal>cel</literal> directory of the spool
+					directory, up to this many kilobytes.  Events beyond that are dropped.
+					The file is kept when the backend is unloaded, and its events are
+					delivered when the backend is loaded again.  Set to 0 to drop the
+					events instead.</para></description>
+				</configOption>
 				<configOption name="apps">
 					<synopsis>List of apps for CEL to track</synopsis>
 					<description><para>A case-insensitive, comma-separated list of applications
@@ -140,6 +165,33 @@ static AO2_GLOBAL_OBJ_STATIC(cel_backends);
 /*! The number of buckets into which backend names will be hashed */
 #define BACKEND_BUCKETS 13
 
+/*! The most serializers CEL events may be generated on */
+#define CEL_MAX_SHARDS 64
+
+/*! The default number of events held in memory for each backend */
+#define CEL_DEFAULT_BACKEND_QUEUE_SIZE 1000
+
+/*! The default kilobytes of events spilled to disk for each backend */
+#define CEL_DEFAULT_BACKEND_SPILL_SIZE 10240
+
+/*! The most events handed to a backend at once */
+#define CEL_BACKEND_BATCH_MAX 256
+
+/*! The threadpool backing the CEL shard serializers */
+static struct ast_threadpool *cel_pool;
+
+/*!
+ * \brief The serializers that generate CEL events
+ *
+ * Every message is processed on the serializer selected by the hash of
+ * the linkedid of the channel it is about, so the events of a call are
+ * generated in order.
+ */
+static struct ast_taskprocessor *cel_shards[CEL_MAX_SHARDS];
+
+/*! The number of serializers in use in \ref cel_shards */
+static unsigned int cel_shard_count;
+
 /*! Container for dial end multichannel blobs for holding on to dial statuses */
 static AO2_GLOBAL_OBJ_STATIC(cel_dialstatus_store);
 
@@ -201,6 +253,10 @@ void *ast_cel_general_config_alloc(void)
 		return NULL;
 	}
 
+	cfg->shards = 1;
+	cfg->backend_queue_size = CEL_DEFAULT_BACKEND_QUEUE_SIZE;
+	cfg->backend_spill_size = CEL_DEFAULT_BACKEND_SPILL_SIZE;
+
 	ao2_ref(cfg, +1);
 	return cfg;
 }
@@ -310,8 +366,41 @@ static const char * const cel_event_types[CEL_MAX_EVENT_IDS] = {
 	[AST_CEL_LOCAL_OPTIMIZE]   = "LOCAL_OPTIMIZE",
 };
 
+/*! \brief An event queued for a backend */
+struct cel_queued_event {
+	AST_LIST_ENTRY(cel_queued_event) list;
+	/*! A copy of the event */
+	unsigned char event[0];
+};
+
+AST_LIST_HEAD_NOLOCK(cel_event_queue, cel_queued_event);
+
+/*!
+ * \brief A registered backend and the events waiting for it
+ *
+ * The queue, the spill file and the flags are protected by the object's lock.
+ */
 struct cel_backend {
 	ast_cel_backend_cb callback; /*!< Callback for this backend */
+	ast_cel_backend_batch_cb batch_callback; /*!< Batch callback for this backend */
+	/*! Delivers the queued events to the backend */
+	struct ast_taskprocessor *tps;
+	/*! Events waiting to be delivered, oldest first */
+	struct cel_event_queue queue;
+	/*! Number of events in the queue */
+	unsigned int queued;
+	/*! Events that did not fit in the queue, oldest first */
+	FILE *spill;
+	/*! Bytes of events in the spill file */
+	long spill_size;
+	/*! Offset of the first event in the spill file not yet delivered */
+	long spill_read;
+	/*! Events dropped since the spill file filled up */
+	unsigned int dropped;
+	/*! Set while a delivery task is queued or running */
+	unsigned int delivering:1;
+	/*! Set once the backend is unregistered */
+	unsigned int unregistered:1;
 	char name[0];                /*!< Name of this backend */
 };
 
@@ -378,6 +467,383 @@ static int cel_backend_cmp(void *obj, void *arg, int flags)
 	return CMP_MATCH;
 }
 
+/*!
+ * \internal
+ * \brief Build the name of the file events for a backend are spilled to
+ */
+static void cel_backend_spill_path(const struct cel_backend *backend, char *path, size_t size)
+{
+	char *name = ast_strdupa(backend->name);
+	char *c;
+
+	/* Backend names such as "ODBC CEL backend" are not meant as file names. */
+	for (c = name; *c; ++c) {
+		if (*c == '/' || isspace(*c)) {
+			*c = '_';
+		}
+	}
+	snprintf(path, size, "%s/cel/%s.spill", ast_config_AST_SPOOL_DIR, name);
+}
+
+/*!
+ * \internal
+ * \brief Open the spill file of a backend if it is not open yet
+ * \note The backend must be locked.
+ */
+static int cel_backend_spill_open(struct cel_backend *backend)
+{
+	char path[PATH_MAX];
+
+	if (backend->spill) {
+		return 0;
+	}
+
+	snprintf(path, sizeof(path), "%s/cel", ast_config_AST_SPOOL_DIR);
+	ast_mkdir(path, 0777);
+
+	cel_backend_spill_path(backend, path, sizeof(path));
+	backend->spill = fopen(path, "a+b");
+	if (!backend->spill) {
+		ast_log(LOG_ERROR, "Unable to open CEL spill file '%s': %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fseek(backend->spill, 0, SEEK_END) || (backend->spill_size = ftell(backend->spill)) < 0) {
+		backend->spill_size = 0;
+	}
+	backend->spill_read = 0;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Write an event that does not fit in the queue of a backend to disk
+ * \note The backend must be locked.
+ */
+static void cel_backend_spill(struct cel_backend *backend, const struct ast_event *event,
+	unsigned int spill_kb)
+{
+	size_t len = ast_event_get_size(event);
+
+	if (!spill_kb || backend->spill_size + len > (size_t) spill_kb * 1024
+		|| cel_backend_spill_open(backend)) {
+		if (!backend->dropped++) {
+			ast_log(LOG_WARNING, "CEL backend '%s' is too far behind, dropping events\n",
+				backend->name);
+		}
+		return;
+	}
+
+	if (fseek(backend->spill, 0, SEEK_END)
+		|| fwrite(event, len, 1, backend->spill) != 1
+		|| fflush(backend->spill)) {
+		ast_log(LOG_ERROR, "Unable to spill an event for CEL backend '%s': %s\n",
+			backend->name, strerror(errno));
+		/* Cut off whatever part of the event made it, it could not be read back. */
+		if (ftruncate(fileno(backend->spill), backend->spill_size)) {
+			ast_log(LOG_ERROR, "Unable to truncate the spill file of CEL backend '%s': %s\n",
+				backend->name, strerror(errno));
+		}
+		return;
+	}
+	backend->spill_size += len;
+
+	if (backend->dropped) {
+		ast_log(LOG_NOTICE, "CEL backend '%s' dropped %u events\n",
+			backend->name, backend->dropped);
+		backend->dropped = 0;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Read a batch of spilled events back into the queue of a backend
+ * \note The backend must be locked.
+ */
+static void cel_backend_unspill(struct cel_backend *backend)
+{
+	size_t header_len = ast_event_minimum_length();
+	unsigned char header[header_len];
+	struct cel_queued_event *queued;
+	size_t len;
+
+	if (fseek(backend->spill, backend->spill_read, SEEK_SET)) {
+		goto corrupt;
+	}
+
+	while (backend->queued < CEL_BACKEND_BATCH_MAX && backend->spill_read < backend->spill_size) {
+		if (fread(header, header_len, 1, backend->spill) != 1) {
+			goto corrupt;
+		}
+		len = ast_event_get_size((struct ast_event *) header);
+		if (len < header_len || backend->spill_read + len > backend->spill_size) {
+			goto corrupt;
+		}
+
+		queued = ast_malloc(sizeof(*queued) + len);
+		if (!queued) {
+			/* Try again on the next delivery. */
+			return;
+		}
+		memcpy(queued->event, header, header_len);
+		if (fread(queued->event + header_len, len - header_len, 1, backend->spill) != 1) {
+			ast_free(queued);
+			goto corrupt;
+		}
+
+		AST_LIST_INSERT_TAIL(&backend->queue, queued, list);
+		++backend->queued;
+		backend->spill_read += len;
+	}
+
+	if (backend->spill_read < backend->spill_size) {
+		return;
+	}
+
+	/* Everything spilled has been read back, start the file over. */
+	if (ftruncate(fileno(backend->spill), 0)) {
+		ast_log(LOG_ERROR, "Unable to truncate the spill file of CEL backend '%s': %s\n",
+			backend->name, strerror(errno));
+	}
+	backend->spill_size = backend->spill_read = 0;
+	return;
+
+corrupt:
+	ast_log(LOG_ERROR, "Unable to read the spill file of CEL backend '%s', discarding %ld bytes of events\n",
+		backend->name, backend->spill_size - backend->spill_read);
+	if (ftruncate(fileno(backend->spill), 0)) {
+		ast_log(LOG_ERROR, "Unable to truncate the spill file of CEL backend '%s': %s\n",
+			backend->name, strerror(errno));
+	}
+	backend->spill_size = backend->spill_read = 0;
+}
+
+/*!
+ * \internal
+ * \brief Remove what was already delivered from the spill file of a backend
+ * \note The backend must be locked.
+ */
+static void cel_backend_spill_close(struct cel_backend *backend)
+{
+	char path[PATH_MAX];
+	char tmp[PATH_MAX];
+	char buf[4096];
+	FILE *out;
+	size_t len;
+
+	if (!backend->spill) {
+		return;
+	}
+
+	cel_backend_spill_path(backend, path, sizeof(path));
+	if (!backend->spill_read || backend->spill_read >= backend->spill_size) {
+		fclose(backend->spill);
+		backend->spill = NULL;
+		if (!backend->spill_size) {
+			unlink(path);
+		}
+		return;
+	}
+
+	/* Keep only the events not yet delivered for the next registration. */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	out = fopen(tmp, "wb");
+	if (out && !fseek(backend->spill, backend->spill_read, SEEK_SET)) {
+		while ((len = fread(buf, 1, sizeof(buf), backend->spill))) {
+			if (fwrite(buf, 1, len, out) != len) {
+				break;
+			}
+		}
+	}
+	if (!out || ferror(backend->spill) || fclose(out) || rename(tmp, path)) {
+		ast_log(LOG_WARNING, "Unable to compact the spill file of CEL backend '%s', "
+			"some events may be delivered again\n", backend->name);
+		unlink(tmp);
+	}
+	fclose(backend->spill);
+	backend->spill = NULL;
+}
+
+/*!
+ * \internal
+ * \brief Hand the queued events to a backend, a batch at a time
+ */
+static int cel_backend_deliver(void *data)
+{
+	struct cel_backend *backend = data;
+	struct cel_queued_event *batch[CEL_BACKEND_BATCH_MAX];
+	struct ast_event *events[CEL_BACKEND_BATCH_MAX];
+	size_t count;
+	size_t i;
+
+	for (;;) {
+		ao2_lock(backend);
+		if (!backend->queued && !backend->unregistered
+			&& backend->spill_read < backend->spill_size) {
+			cel_backend_unspill(backend);
+		}
+		for (count = 0; count < CEL_BACKEND_BATCH_MAX
+			&& (batch[count] = AST_LIST_REMOVE_HEAD(&backend->queue, list)); ++count) {
+			--backend->queued;
+		}
+		if (!count) {
+			backend->delivering = 0;
+			ao2_unlock(backend);
+			break;
+		}
+		ao2_unlock(backend);
+
+		for (i = 0; i < count; ++i) {
+			events[i] = (struct ast_event *) batch[i]->event;
+		}
+		if (backend->batch_callback) {
+			backend->batch_callback(events, count);
+		} else {
+			for (i = 0; i < count; ++i) {
+				backend->callback(events[i]);
+			}
+		}
+		for (i = 0; i < count; ++i) {
+			ast_free(batch[i]);
+		}
+	}
+
+	ao2_ref(backend, -1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Make sure a delivery task is queued for a backend
+ * \note The backend must be locked.
+ */
+static void cel_backend_schedule(struct cel_backend *backend)
+{
+	if (backend->delivering || backend->unregistered || !backend->tps) {
+		return;
+	}
+
+	backend->delivering = 1;
+	ao2_ref(backend, +1);
+	if (ast_taskprocessor_push(backend->tps, cel_backend_deliver, backend)) {
+		/* The events stay queued until the next event tries again. */
+		backend->delivering = 0;
+		ao2_ref(backend, -1);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Queue an event for a backend
+ */
+static void cel_backend_queue(struct cel_backend *backend, const struct ast_event *event,
+	const struct ast_cel_general_config *cfg)
+{
+	size_t len = ast_event_get_size(event);
+	struct cel_queued_event *queued;
+
+	ao2_lock(backend);
+	if (backend->unregistered || backend->spill_read < backend->spill_size
+		|| backend->queued >= cfg->backend_queue_size) {
+		/* Later events are spilled too until the spill file is caught up, to keep them in order. */
+		cel_backend_spill(backend, event, cfg->backend_spill_size);
+	} else if ((queued = ast_malloc(sizeof(*queued) + len))) {
+		memcpy(queued->event, event, len);
+		AST_LIST_INSERT_TAIL(&backend->queue, queued, list);
+		++backend->queued;
+	}
+	cel_backend_schedule(backend);
+	ao2_unlock(backend);
+}
+
+static void cel_backend_dtor(void *obj)
+{
+	struct cel_backend *backend = obj;
+	struct cel_queued_event *queued;
+
+	while ((queued = AST_LIST_REMOVE_HEAD(&backend->queue, list))) {
+		ast_free(queued);
+	}
+	cel_backend_spill_close(backend);
+	ast_taskprocessor_unreference(backend->tps);
+}
+
+/*! \brief Completion state for a taskprocessor synchronization */
+struct cel_sync_data {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	int complete;
+};
+
+static int cel_sync_task(void *data)
+{
+	struct cel_sync_data *sync_data = data;
+
+	ast_mutex_lock(&sync_data->lock);
+	sync_data->complete = 1;
+	ast_cond_signal(&sync_data->cond);
+	ast_mutex_unlock(&sync_data->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for a taskprocessor to run everything queued to it so far
+ */
+static void cel_taskprocessor_sync(struct ast_taskprocessor *tps)
+{
+	struct cel_sync_data sync_data = { .complete = 0, };
+
+	if (!tps || ast_taskprocessor_is_task(tps)) {
+		return;
+	}
+
+	ast_mutex_init(&sync_data.lock);
+	ast_cond_init(&sync_data.cond, NULL);
+
+	if (!ast_taskprocessor_push(tps, cel_sync_task, &sync_data)) {
+		ast_mutex_lock(&sync_data.lock);
+		while (!sync_data.complete) {
+			ast_cond_wait(&sync_data.cond, &sync_data.lock);
+		}
+		ast_mutex_unlock(&sync_data.lock);
+	}
+
+	ast_mutex_destroy(&sync_data.lock);
+	ast_cond_destroy(&sync_data.cond);
+}
+
+/*!
+ * \internal
+ * \brief Deliver what is queued for an unlinked backend and stop its thread
+ */
+static void cel_backend_close(struct cel_backend *backend)
+{
+	struct ast_taskprocessor *tps;
+
+	ao2_lock(backend);
+	backend->unregistered = 1;
+	tps = backend->tps;
+	ao2_unlock(backend);
+
+	/* Nothing new is queued once unregistered, so this waits for the last delivery. */
+	cel_taskprocessor_sync(tps);
+
+	ao2_lock(backend);
+	backend->tps = NULL;
+	cel_backend_spill_close(backend);
+	ao2_unlock(backend);
+
+	ast_taskprocessor_unreference(tps);
+}
+
+static int cel_backend_close_cb(void *obj, void *arg, int flags)
+{
+	cel_backend_close(obj);
+	return CMP_MATCH;
+}
+
 /*! \brief Hashing function for dialstatus container */
 static int dialstatus_hash(const void *obj, int flags)
 {
@@ -506,6 +972,12 @@ static char *handle_cli_status(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		iter = ao2_iterator_init(backends, 0);
 		for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
 			ast_cli(a->fd, "CEL Event Subscriber: %s\n", backend->name);
+			ao2_lock(backend);
+			if (backend->queued || backend->spill_read < backend->spill_size) {
+				ast_cli(a->fd, "CEL Event Subscriber Backlog: %u queued, %ld bytes spilled\n",
+					backend->queued, backend->spill_size - backend->spill_read);
+			}
+			ao2_unlock(backend);
 		}
 		ao2_iterator_destroy(&iter);
 	}
@@ -649,19 +1121,13 @@ struct ast_event *ast_cel_create_event(struct ast_channel_snapshot *snapshot,
 		AST_EVENT_IE_END);
 }
 
-static int cel_backend_send_cb(void *obj, void *arg, int flags)
-{
-	struct cel_backend *backend = obj;
-
-	backend->callback(arg);
-	return 0;
-}
-
 static int cel_report_event(struct ast_channel_snapshot *snapshot,
 		enum ast_cel_event_type event_type, const char *userdefevname,
 		struct ast_json *extra, const char *peer_str)
 {
 	struct ast_event *ev;
+	struct ao2_iterator iter;
+	struct cel_backend *backend;
 	RAII_VAR(struct cel_config *, cfg, ao2_global_obj_ref(cel_configs), ao2_cleanup);
 	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
 
@@ -692,8 +1158,12 @@ static int cel_report_event(struct ast_channel_snapshot *snapshot,
 		return -1;
 	}
 
-	/* Distribute event to backends */
-	ao2_callback(backends, OBJ_MULTIPLE | OBJ_NODATA, cel_backend_send_cb, ev);
+	/* Queue the event for each backend */
+	iter = ao2_iterator_init(backends, 0);
+	for (; (backend = ao2_iterator_next(&iter)); ao2_ref(backend, -1)) {
+		cel_backend_queue(backend, ev, cfg->general);
+	}
+	ao2_iterator_destroy(&iter);
 	ast_event_destroy(ev);
 
 	return 0;
@@ -1093,6 +1563,11 @@ static void cel_snapshot_update_cb(void *data, struct stasis_subscription *sub,
 		old_snapshot = stasis_message_data(update->old_snapshot);
 		new_snapshot = stasis_message_data(update->new_snapshot);
 
+		if (old_snapshot == new_snapshot) {
+			/* The snapshot was published again unchanged */
+			return;
+		}
+
 		if (cel_filter_channel_snapshot(old_snapshot) || cel_filter_channel_snapshot(new_snapshot)) {
 			return;
 		}
@@ -1502,10 +1977,261 @@ static void cel_local_cb(
 	ast_json_unref(extra);
 }
 
+/*!
+ * \internal
+ * \brief Get the shard that processes the messages of a call
+ * \param linkedid The linkedid of the call
+ */
+static struct ast_taskprocessor *cel_shard_get(const char *linkedid)
+{
+	return cel_shards[ast_str_hash(S_OR(linkedid, "")) % cel_shard_count];
+}
+
+/*! \brief A handler for a CEL message and how to pick the shard that runs it */
+struct cel_shard_route {
+	/*! The handler run on the shard */
+	stasis_subscription_cb handler;
+	/*! Returns the linkedid of the channel the message is about */
+	const char *(*shard_key)(struct stasis_message *message);
+};
+
+static const char *snapshot_shard_key(struct ast_channel_snapshot *snapshot)
+{
+	return snapshot ? snapshot->linkedid : NULL;
+}
+
+static const char *snapshot_update_shard_key(struct stasis_message *message)
+{
+	struct stasis_cache_update *update = stasis_message_data(message);
+
+	if (update->type != ast_channel_snapshot_type()) {
+		return NULL;
+	}
+	return snapshot_shard_key(stasis_message_data(update->new_snapshot
+		? update->new_snapshot : update->old_snapshot));
+}
+
+static const char *dial_shard_key(struct stasis_message *message)
+{
+	struct ast_multi_channel_blob *blob = stasis_message_data(message);
+	struct ast_channel_snapshot *snapshot;
+
+	snapshot = ast_multi_channel_blob_get_channel(blob, "caller");
+	if (!snapshot) {
+		snapshot = ast_multi_channel_blob_get_channel(blob, "peer");
+	}
+	return snapshot_shard_key(snapshot);
+}
+
+static const char *bridge_shard_key(struct stasis_message *message)
+{
+	struct ast_bridge_blob *blob = stasis_message_data(message);
+
+	return snapshot_shard_key(blob->channel);
+}
+
+static const char *parking_shard_key(struct stasis_message *message)
+{
+	struct ast_parked_call_payload *payload = stasis_message_data(message);
+
+	return snapshot_shard_key(payload->parkee);
+}
+
+static const char *generic_shard_key(struct stasis_message *message)
+{
+	struct ast_channel_blob *blob = stasis_message_data(message);
+
+	return snapshot_shard_key(blob->snapshot);
+}
+
+static const char *blind_transfer_shard_key(struct stasis_message *message)
+{
+	struct ast_blind_transfer_message *transfer_msg = stasis_message_data(message);
+
+	return snapshot_shard_key(transfer_msg->transferer);
+}
+
+static const char *attended_transfer_shard_key(struct stasis_message *message)
+{
+	struct ast_attended_transfer_message *xfer = stasis_message_data(message);
+
+	return snapshot_shard_key(xfer->to_transferee.channel_snapshot
+		? xfer->to_transferee.channel_snapshot : xfer->to_transfer_target.channel_snapshot);
+}
+
+static const char *pickup_shard_key(struct stasis_message *message)
+{
+	struct ast_multi_channel_blob *blob = stasis_message_data(message);
+
+	return snapshot_shard_key(ast_multi_channel_blob_get_channel(blob, "channel"));
+}
+
+static const char *local_shard_key(struct stasis_message *message)
+{
+	struct ast_multi_channel_blob *blob = stasis_message_data(message);
+
+	return snapshot_shard_key(ast_multi_channel_blob_get_channel(blob, "1"));
+}
+
+static const struct cel_shard_route snapshot_update_route = {
+	.handler = cel_snapshot_update_cb,
+	.shard_key = snapshot_update_shard_key,
+};
+
+static const struct cel_shard_route dial_route = {
+	.handler = cel_dial_cb,
+	.shard_key = dial_shard_key,
+};
+
+static const struct cel_shard_route bridge_enter_route = {
+	.handler = cel_bridge_enter_cb,
+	.shard_key = bridge_shard_key,
+};
+
+static const struct cel_shard_route bridge_leave_route = {
+	.handler = cel_bridge_leave_cb,
+	.shard_key = bridge_shard_key,
+};
+
+static const struct cel_shard_route parking_route = {
+	.handler = cel_parking_cb,
+	.shard_key = parking_shard_key,
+};
+
+static const struct cel_shard_route generic_route = {
+	.handler = cel_generic_cb,
+	.shard_key = generic_shard_key,
+};
+
+static const struct cel_shard_route blind_transfer_route = {
+	.handler = cel_blind_transfer_cb,
+	.shard_key = blind_transfer_shard_key,
+};
+
+static const struct cel_shard_route attended_transfer_route = {
+	.handler = cel_attended_transfer_cb,
+	.shard_key = attended_transfer_shard_key,
+};
+
+static const struct cel_shard_route pickup_route = {
+	.handler = cel_pickup_cb,
+	.shard_key = pickup_shard_key,
+};
+
+static const struct cel_shard_route local_route = {
+	.handler = cel_local_cb,
+	.shard_key = local_shard_key,
+};
+
+/*! \brief A message queued to a shard */
+struct cel_shard_task {
+	const struct cel_shard_route *route;
+	struct stasis_message *message;
+};
+
+static int cel_shard_task_exec(void *data)
+{
+	struct cel_shard_task *task = data;
+
+	task->route->handler(NULL, NULL, task->message);
+	ao2_ref(task->message, -1);
+	ast_free(task);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Message router callback handing a message off to its shard
+ *
+ * \param data The \ref cel_shard_route for the message type
+ */
+static void cel_shard_dispatch(void *data, struct stasis_subscription *sub,
+		struct stasis_message *message)
+{
+	const struct cel_shard_route *route = data;
+	struct cel_shard_task *task;
+
+	task = ast_malloc(sizeof(*task));
+	if (!task) {
+		return;
+	}
+	task->route = route;
+	task->message = ao2_bump(message);
+
+	if (ast_taskprocessor_push(cel_shard_get(route->shard_key(message)),
+			cel_shard_task_exec, task)) {
+		ast_log(LOG_WARNING, "Unable to queue %s message to a CEL shard; processing inline\n",
+			stasis_message_type_name(stasis_message_type(message)));
+		cel_shard_task_exec(task);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Create the serializers CEL messages are sharded across
+ */
+static int cel_shards_init(void)
+{
+	RAII_VAR(struct cel_config *, cfg, ao2_global_obj_ref(cel_configs), ao2_cleanup);
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+	};
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	unsigned int count;
+	unsigned int i;
+
+	count = cfg && cfg->general && cfg->general->shards ? cfg->general->shards : 1;
+	options.initial_size = options.max_size = MIN(count, CEL_MAX_SHARDS);
+
+	cel_pool = ast_threadpool_create("cel", NULL, &options);
+	if (!cel_pool) {
+		return -1;
+	}
+
+	for (i = 0; i < options.max_size; i++) {
+		ast_taskprocessor_build_name(name, sizeof(name), "cel/shard-%02u", i);
+		cel_shards[i] = ast_threadpool_serializer(name, cel_pool);
+		if (!cel_shards[i]) {
+			return -1;
+		}
+		ast_taskprocessor_alert_set_levels(cel_shards[i], -1,
+			6 * AST_TASKPROCESSOR_HIGH_WATER_LEVEL);
+	}
+	cel_shard_count = options.max_size;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Drain and destroy the CEL shards
+ *
+ * \note The message router must already be unsubscribed so nothing new
+ * is queued.
+ */
+static void cel_shards_shutdown(void)
+{
+	int i;
+
+	for (i = 0; i < CEL_MAX_SHARDS; i++) {
+		cel_taskprocessor_sync(cel_shards[i]);
+		ast_taskprocessor_unreference(cel_shards[i]);
+		cel_shards[i] = NULL;
+	}
+	cel_shard_count = 0;
+
+	ast_threadpool_shutdown(cel_pool);
+	cel_pool = NULL;
+}
+
 static void destroy_routes(void)
 {
 	stasis_message_router_unsubscribe_and_join(cel_state_router);
 	cel_state_router = NULL;
+	cel_shards_shutdown();
 }
 
 static void destroy_subscriptions(void)
@@ -1523,8 +2249,18 @@ static void destroy_subscriptions(void)
 
 static void cel_engine_cleanup(void)
 {
+	struct ao2_container *backends;
+
 	destroy_routes();
 	destroy_subscriptions();
+
+	/* Deliver what the backends still have queued. */
+	backends = ao2_global_obj_ref(cel_backends);
+	if (backends) {
+		ao2_callback(backends, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA, cel_backend_close_cb, NULL);
+		ao2_ref(backends, -1);
+	}
+
 	STASIS_MESSAGE_TYPE_CLEANUP(cel_generic_type);
 
 	ast_cli_unregister(&cli_status);
@@ -1588,6 +2324,11 @@ static int create_routes(void)
 {
 	int ret = 0;
 
+	if (cel_shards_init()) {
+		cel_shards_shutdown();
+		return -1;
+	}
+
 	cel_state_router = stasis_message_router_create(cel_aggregation_topic);
 	if (!cel_state_router) {
 		return -1;
@@ -1597,53 +2338,53 @@ static int create_routes(void)
 
 	ret |= stasis_message_router_add(cel_state_router,
 		stasis_cache_update_type(),
-		cel_snapshot_update_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &snapshot_update_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_channel_dial_type(),
-		cel_dial_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &dial_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_channel_entered_bridge_type(),
-		cel_bridge_enter_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &bridge_enter_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_channel_left_bridge_type(),
-		cel_bridge_leave_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &bridge_leave_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_parked_call_type(),
-		cel_parking_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &parking_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		cel_generic_type(),
-		cel_generic_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &generic_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_blind_transfer_type(),
-		cel_blind_transfer_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &blind_transfer_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_attended_transfer_type(),
-		cel_attended_transfer_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &attended_transfer_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_call_pickup_type(),
-		cel_pickup_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &pickup_route);
 
 	ret |= stasis_message_router_add(cel_state_router,
 		ast_local_optimization_end_type(),
-		cel_local_cb,
-		NULL);
+		cel_shard_dispatch,
+		(void *) &local_route);
 
 	if (ret) {
 		ast_log(AST_LOG_ERROR, "Failed to register for Stasis messages\n");
@@ -1760,6 +2501,9 @@ int ast_cel_engine_init(void)
 	aco_option_register(&cel_cfg_info, "dateformat", ACO_EXACT, general_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_cel_general_config, date_format));
 	aco_option_register_custom(&cel_cfg_info, "apps", ACO_EXACT, general_options, "", apps_handler, 0);
 	aco_option_register_custom(&cel_cfg_info, "events", ACO_EXACT, general_options, "", events_handler, 0);
+	aco_option_register(&cel_cfg_info, "shards", ACO_EXACT, general_options, "1", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, shards), 1, CEL_MAX_SHARDS);
+	aco_option_register(&cel_cfg_info, "backend_queue_size", ACO_EXACT, general_options, __stringify(CEL_DEFAULT_BACKEND_QUEUE_SIZE), OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_cel_general_config, backend_queue_size), 1, 1000000);
+	aco_option_register(&cel_cfg_info, "backend_spill_size", ACO_EXACT, general_options, __stringify(CEL_DEFAULT_BACKEND_SPILL_SIZE), OPT_UINT_T, 0, FLDSET(struct ast_cel_general_config, backend_spill_size));
 
 	if (aco_process_config(&cel_cfg_info, 0)) {
 		struct cel_config *cel_cfg = cel_config_alloc();
@@ -1880,34 +2624,69 @@ void ast_cel_set_config(struct ast_cel_general_config *config)
 int ast_cel_backend_unregister(const char *name)
 {
 	struct ao2_container *backends = ao2_global_obj_ref(cel_backends);
+	struct cel_backend *backend = NULL;
 
 	if (backends) {
-		ao2_find(backends, name, OBJ_SEARCH_KEY | OBJ_NODATA | OBJ_UNLINK);
+		backend = ao2_find(backends, name, OBJ_SEARCH_KEY | OBJ_UNLINK);
 		ao2_ref(backends, -1);
 	}
 
+	if (backend) {
+		cel_backend_close(backend);
+		ao2_ref(backend, -1);
+	}
+
 	return 0;
 }
 
-int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback)
+static int cel_backend_register(const char *name, ast_cel_backend_cb backend_callback,
+	ast_cel_backend_batch_cb batch_callback)
 {
 	RAII_VAR(struct ao2_container *, backends, ao2_global_obj_ref(cel_backends), ao2_cleanup);
 	struct cel_backend *backend;
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	char path[PATH_MAX];
 
-	if (!backends || ast_strlen_zero(name) || !backend_callback) {
+	if (!backends || ast_strlen_zero(name) || (!backend_callback && !batch_callback)) {
 		return -1;
 	}
 
-	/* The backend object is immutable so it doesn't need a lock of its own. */
-	backend = ao2_alloc_options(sizeof(*backend) + 1 + strlen(name), NULL,
-		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	backend = ao2_alloc(sizeof(*backend) + 1 + strlen(name), cel_backend_dtor);
 	if (!backend) {
 		return -1;
 	}
 	strcpy(backend->name, name);/* Safe */
 	backend->callback = backend_callback;
+	backend->batch_callback = batch_callback;
+
+	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "cel/backend/%s", name);
+	backend->tps = ast_taskprocessor_get(tps_name, TPS_REF_DEFAULT);
+	if (!backend->tps) {
+		ao2_ref(backend, -1);
+		return -1;
+	}
+
+	/* Deliver what was spilled before the backend was last unregistered. */
+	cel_backend_spill_path(backend, path, sizeof(path));
+	if (!access(path, F_OK)) {
+		ao2_lock(backend);
+		if (!cel_backend_spill_open(backend) && backend->spill_size) {
+			cel_backend_schedule(backend);
+		}
+		ao2_unlock(backend);
+	}
 
 	ao2_link(backends, backend);
 	ao2_ref(backend, -1);
 	return 0;
 }
+
+int ast_cel_backend_register(const char *name, ast_cel_backend_cb backend_callback)
+{
+	return cel_backend_register(name, backend_callback, NULL);
+}
+
+int ast_cel_backend_register_batch(const char *name, ast_cel_backend_batch_cb batch_callback)
+{
+	return cel_backend_register(name, NULL, batch_callback);
+}
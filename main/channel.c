@@ -68,11 +68,13 @@
 #include "asterisk/global_datastores.h"
 #include "asterisk/data.h"
 #include "asterisk/channel_internal.h"
+#include "asterisk/frame_latency.h"
 #include "asterisk/features.h"
 #include "asterisk/bridge.h"
 #include "asterisk/test.h"
 #include "asterisk/stasis_channels.h"
 #include "asterisk/max_forwards.h"
+#include "asterisk/taskprocessor.h"
 
 /*** DOCUMENTATION
  ***/
@@ -130,9 +132,50 @@ static AST_RWLIST_HEAD_STATIC(backends, chanlist);
 #define NUM_CHANNEL_BUCKETS 1567
 #endif
 
-/*! \brief All active channels on the system */
+/*!
+ * \brief All active channels on the system, hashed by name
+ *
+ * \note The container uses a rwlock so that the many lookups and
+ * iterations over it do not serialize each other.  Only linking,
+ * unlinking, and renaming channels need exclusive access.  The
+ * lock is not recursive: code holding the container write lock
+ * must use OBJ_NOLOCK for any further container operation.
+ */
 static struct ao2_container *channels;
 
+/*!
+ * \brief Index of all active channels, hashed by uniqueid
+ *
+ * \note A channel's uniqueid only changes during a masquerade,
+ * which unlinks and relinks both channels while holding the
+ * channels container write lock.  The index lock is always taken
+ * after the channels container lock and never while calling out of
+ * this index, so it is safe to take with channels locked.
+ */
+static struct ao2_container *channels_by_uniqueid;
+
+/*!
+ * \brief Index of the channels in each spy group, hashed by group
+ *
+ * \note Kept in step with the SPYGROUP variable of each channel by
+ * ast_channel_spygroup_index_update().  Entries hold a reference to
+ * their channel and are removed when it leaves the channels
+ * container.  The index lock is taken with the channel locked, so a
+ * channel is never locked while holding it.
+ */
+static struct ao2_container *channels_by_spygroup;
+
+/*! \brief Maximum number of spy groups a channel is indexed under */
+#define MAX_CHANNEL_SPYGROUPS 128
+
+/*! \brief A channel in a spy group */
+struct channel_spygroup {
+	/*! The channel, with a reference */
+	struct ast_channel *chan;
+	/*! The spy group */
+	char group[0];
+};
+
 /*! \brief map AST_CAUSE's to readable string representations
  *
  * \ref causes.h
@@ -399,9 +442,55 @@ static char *handle_cli_core_show_channeltype(struct ast_cli_entry *e, int cmd,
 	return CLI_SUCCESS;
 }
 
+/*! \brief Show memory used by channels - CLI command */
+static char *handle_cli_core_show_channel_memory(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_channel_memory mem = { 0, };
+	struct ast_channel_iterator *iter;
+	struct ast_channel *chan;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show channel memory";
+		e->usage =
+			"Usage: core show channel memory\n"
+			"       Shows a breakdown of the memory used by the active channels.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!(iter = ast_channel_iterator_all_new())) {
+		return CLI_FAILURE;
+	}
+	for (; (chan = ast_channel_iterator_next(iter)); ast_channel_unref(chan)) {
+		ast_channel_lock(chan);
+		ast_channel_internal_memory(chan, &mem);
+		ast_channel_unlock(chan);
+	}
+	ast_channel_iterator_destroy(iter);
+
+	ast_cli(a->fd, "Channels:                    %u\n", mem.channels);
+	ast_cli(a->fd, "Channel structures:          %zu bytes\n", mem.channel_size);
+	ast_cli(a->fd, "Rarely used members:         %u allocated\n", mem.cold);
+	ast_cli(a->fd, "Arenas:                      %zu bytes held, %zu bytes used\n",
+		mem.arena_size, mem.arena_used);
+	ast_cli(a->fd, "Datastores:                  %u\n", mem.datastores);
+	ast_cli(a->fd, "Queued frames:               %u\n", mem.readq_frames);
+	ast_cli(a->fd, "Channels with audiohooks:    %u\n", mem.audiohooks);
+	ast_cli(a->fd, "Channels with framehooks:    %u\n", mem.framehooks);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_channel[] = {
 	AST_CLI_DEFINE(handle_cli_core_show_channeltypes, "List available channel types"),
-	AST_CLI_DEFINE(handle_cli_core_show_channeltype,  "Give more details on that channel type")
+	AST_CLI_DEFINE(handle_cli_core_show_channeltype,  "Give more details on that channel type"),
+	AST_CLI_DEFINE(handle_cli_core_show_channel_memory, "Show memory used by channels")
 };
 
 static struct ast_frame *kill_read(struct ast_channel *chan)
@@ -768,18 +857,221 @@ static const struct ast_channel_tech null_tech = {
 
 static void ast_channel_destructor(void *obj);
 static void ast_dummy_channel_destructor(void *obj);
-static int ast_channel_by_uniqueid_cb(void *obj, void *arg, void *data, int flags);
+
+static void channel_spygroup_destroy(void *obj)
+{
+	struct channel_spygroup *entry = obj;
+
+	ast_channel_cleanup(entry->chan);
+}
+
+static int channel_spygroup_hash_cb(const void *obj, const int flags)
+{
+	const struct channel_spygroup *entry;
+	const char *group;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		group = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		group = entry->group;
+		break;
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_str_hash(group);
+}
+
+static int channel_spygroup_cmp_cb(void *obj, void *arg, int flags)
+{
+	struct channel_spygroup *entry = obj;
+	struct channel_spygroup *right = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		if (entry->chan != right->chan || strcmp(entry->group, right->group)) {
+			return 0;
+		}
+		break;
+	case OBJ_SEARCH_KEY:
+		if (strcmp(entry->group, arg)) {
+			return 0;
+		}
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Add a channel to, or remove it from, each of a list of spy groups.
+ *
+ * \param chan The channel
+ * \param groups The spy groups, separated by ':'
+ * \param add Non-zero to add the channel, zero to remove it
+ */
+static void channel_spygroups_index(struct ast_channel *chan, const char *groups, int add)
+{
+	char *parse;
+	char *group[MAX_CHANNEL_SPYGROUPS];
+	int num_groups;
+	int idx;
+
+	if (ast_strlen_zero(groups)) {
+		return;
+	}
+
+	/* Split them the same way ChanSpy does */
+	parse = ast_strdupa(groups);
+	num_groups = ast_app_separate_args(parse, ':', group, ARRAY_LEN(group));
+	for (idx = 0; idx < num_groups; ++idx) {
+		struct channel_spygroup *entry;
+
+		if (ast_strlen_zero(group[idx])) {
+			continue;
+		}
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(group[idx]) + 1,
+			channel_spygroup_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!entry) {
+			continue;
+		}
+		strcpy(entry->group, group[idx]); /* Safe */
+		entry->chan = ast_channel_ref(chan);
+		if (add) {
+			ao2_link(channels_by_spygroup, entry);
+		} else {
+			ao2_find(channels_by_spygroup, entry, OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NODATA);
+		}
+		ao2_ref(entry, -1);
+	}
+}
+
+void ast_channel_spygroup_index_update(struct ast_channel *chan)
+{
+	const char *indexed;
+	const char *groups;
+
+	ast_channel_lock(chan);
+	indexed = ast_channel_internal_spygroups(chan);
+	if (!indexed) {
+		/* Not in the channels container, so nothing would remove it again. */
+		ast_channel_unlock(chan);
+		return;
+	}
+	groups = S_OR(pbx_builtin_getvar_helper(chan, "SPYGROUP"), "");
+	if (strcmp(indexed, groups)) {
+		channel_spygroups_index(chan, indexed, 0);
+		channel_spygroups_index(chan, groups, 1);
+		ast_channel_internal_spygroups_set(chan, groups);
+	}
+	ast_channel_unlock(chan);
+}
+
+/*!
+ * \internal
+ * \brief Remove a channel from the channels container and its indexes.
+ *
+ * \note Safe, even if already unlinked.
+ */
+/*! \brief A channel waiting to be unlinked from the channels containers */
+struct channel_unlink_request {
+	struct ast_channel *chan;
+	/*! Set once the channel is unlinked, after which the request is gone */
+	int done;
+	AST_LIST_ENTRY(channel_unlink_request) next;
+};
+
+/*! \brief Channels waiting to be unlinked, protected by channel_unlink_lock */
+static AST_LIST_HEAD_NOLOCK_STATIC(channel_unlink_requests, channel_unlink_request);
+
+AST_MUTEX_DEFINE_STATIC(channel_unlink_lock);
+
+/*! \brief Signalled when a batch of channels has been unlinked */
+static ast_cond_t channel_unlink_cond;
+
+/*! \brief Non-zero while a thread is unlinking a batch */
+static int channel_unlink_busy;
+
+/*!
+ * \internal
+ * \brief Remove a channel from the channels container and the uniqueid index.
+ *
+ * Many channels hanging up at once would each take both write locks in
+ * turn.  Instead, the channel is queued and the first thread to find no
+ * batch in progress unlinks every channel queued so far under a single
+ * hold of each lock, while the others wait for it.  The channel is
+ * unlinked by the time this returns either way.
+ */
+static void channel_unlink_batched(struct ast_channel *chan)
+{
+	struct channel_unlink_request request = { .chan = chan, };
+	struct channel_unlink_request *cur;
+	struct channel_unlink_request *next;
+	AST_LIST_HEAD_NOLOCK(, channel_unlink_request) batch;
+
+	ast_mutex_lock(&channel_unlink_lock);
+	AST_LIST_INSERT_TAIL(&channel_unlink_requests, &request, next);
+	while (!request.done) {
+		if (channel_unlink_busy) {
+			ast_cond_wait(&channel_unlink_cond, &channel_unlink_lock);
+			continue;
+		}
+
+		channel_unlink_busy = 1;
+		AST_LIST_HEAD_INIT_NOLOCK(&batch);
+		AST_LIST_APPEND_LIST(&batch, &channel_unlink_requests, next);
+		ast_mutex_unlock(&channel_unlink_lock);
+
+		/* The uniqueid index is always locked after the channels container */
+		ao2_wrlock(channels);
+		ao2_wrlock(channels_by_uniqueid);
+		AST_LIST_TRAVERSE(&batch, cur, next) {
+			ao2_unlink_flags(channels, cur->chan, OBJ_NOLOCK);
+			ao2_unlink_flags(channels_by_uniqueid, cur->chan, OBJ_NOLOCK);
+		}
+		ao2_unlock(channels_by_uniqueid);
+		ao2_unlock(channels);
+
+		ast_mutex_lock(&channel_unlink_lock);
+		for (cur = AST_LIST_FIRST(&batch); cur; cur = next) {
+			/* The waiting thread may return as soon as done is set */
+			next = AST_LIST_NEXT(cur, next);
+			cur->done = 1;
+		}
+		channel_unlink_busy = 0;
+		ast_cond_broadcast(&channel_unlink_cond);
+	}
+	ast_mutex_unlock(&channel_unlink_lock);
+}
+
+static void channel_unlink(struct ast_channel *chan)
+{
+	channel_unlink_batched(chan);
+
+	ast_channel_lock(chan);
+	channel_spygroups_index(chan, ast_channel_internal_spygroups(chan), 0);
+	ast_channel_internal_spygroups_set(chan, NULL);
+	ast_channel_unlock(chan);
+}
 
 static int does_id_conflict(const char *uniqueid)
 {
 	struct ast_channel *conflict;
-	int length = 0;
 
 	if (ast_strlen_zero(uniqueid)) {
 		return 0;
 	}
 
-	conflict = ast_channel_callback(ast_channel_by_uniqueid_cb, (char *) uniqueid, &length, OBJ_NOLOCK);
+	conflict = ao2_find(channels_by_uniqueid, uniqueid, OBJ_SEARCH_KEY);
 	if (conflict) {
 		ast_log(LOG_ERROR, "Channel Unique ID '%s' already in use by channel %s(%p)\n",
 			uniqueid, ast_channel_name(conflict), conflict);
@@ -989,6 +1281,9 @@ __ast_channel_alloc_ap(int needqueue, int state, const char *cid_num, const char
 	ast_atomic_fetchadd_int(&chancount, +1);
 
 	ao2_link_flags(channels, tmp, OBJ_NOLOCK);
+	ao2_link(channels_by_uniqueid, tmp);
+	/* Ready to be indexed by spy group */
+	ast_channel_internal_spygroups_set(tmp, "");
 
 	ao2_unlock(channels);
 
@@ -1128,10 +1423,11 @@ static int __ast_queue_frame(struct ast_channel *chan, struct ast_frame *fin, in
 		}
 	}
 
-	/* Build copies of all the new frames and count them */
+	/* Build copies of all the new frames and count them, passing shared payloads by reference */
 	AST_LIST_HEAD_INIT_NOLOCK(&frames);
 	for (cur = fin; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-		if (!(f = ast_frdup(cur))) {
+		f = (cur->mallocd & AST_MALLOCD_SHARED) ? ast_frdup_shared(cur) : ast_frdup(cur);
+		if (!f) {
 			if (AST_LIST_FIRST(&frames)) {
 				ast_frfree(AST_LIST_FIRST(&frames));
 			}
@@ -1429,6 +1725,54 @@ struct ast_channel_iterator *ast_channel_iterator_by_exten_new(const char *exten
 	return i;
 }
 
+struct ast_channel_iterator *ast_channel_iterator_by_spygroup_new(const char *groups)
+{
+	struct ast_channel_iterator *i;
+	struct ao2_container *matches;
+	char *parse;
+	char *group[MAX_CHANNEL_SPYGROUPS];
+	int num_groups;
+	int idx;
+
+	matches = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
+	if (!matches) {
+		return NULL;
+	}
+
+	parse = ast_strdupa(S_OR(groups, ""));
+	num_groups = ast_app_separate_args(parse, ':', group, ARRAY_LEN(group));
+	for (idx = 0; idx < num_groups; ++idx) {
+		struct ao2_iterator *found;
+		struct channel_spygroup *entry;
+
+		if (ast_strlen_zero(group[idx])) {
+			continue;
+		}
+		found = ao2_find(channels_by_spygroup, group[idx], OBJ_SEARCH_KEY | OBJ_MULTIPLE);
+		if (!found) {
+			continue;
+		}
+		for (; (entry = ao2_iterator_next(found)); ao2_ref(entry, -1)) {
+			/* A channel in several of the groups is only returned once. */
+			if (!ao2_callback(matches, OBJ_NODATA, ao2_match_by_addr, entry->chan)) {
+				ao2_link(matches, entry->chan);
+			}
+		}
+		ao2_iterator_destroy(found);
+	}
+
+	if (!(i = ast_calloc(1, sizeof(*i)))) {
+		ao2_ref(matches, -1);
+		return NULL;
+	}
+
+	i->simple_iterator = ao2_iterator_init(matches, 0);
+	i->active_iterator = &i->simple_iterator;
+	ao2_ref(matches, -1);
+
+	return i;
+}
+
 struct ast_channel_iterator *ast_channel_iterator_by_name_new(const char *name, size_t name_len)
 {
 	struct ast_channel_iterator *i;
@@ -1492,6 +1836,10 @@ struct ast_channel *ast_channel_get_by_name_prefix(const char *name, size_t name
 	}
 
 	/* Now try a search for uniqueid. */
+	if (name_len == 0) {
+		/* A complete uniqueid match can use the index. */
+		return ao2_find(channels_by_uniqueid, l_name, OBJ_SEARCH_KEY);
+	}
 	return ast_channel_callback(ast_channel_by_uniqueid_cb, l_name, &name_len, 0);
 }
 
@@ -1595,7 +1943,7 @@ int ast_safe_sleep(struct ast_channel *chan, int ms)
 struct ast_channel *ast_channel_release(struct ast_channel *chan)
 {
 	/* Safe, even if already unlinked. */
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 	return ast_channel_unref(chan);
 }
 
@@ -2199,6 +2547,137 @@ void ast_party_redirecting_free(struct ast_party_redirecting *doomed)
 	ast_party_redirecting_reason_free(&doomed->orig_reason);
 }
 
+/*!
+ * \brief What is left of a destroyed channel to free.
+ *
+ * None of it is seen by anything else once the channel is gone, so it is
+ * freed by the reclaim thread rather than by the thread that dropped the
+ * last reference to the channel.
+ */
+struct channel_remains {
+	struct ast_trans_pvt *readtrans;
+	struct ast_trans_pvt *writetrans;
+	struct ast_party_dialed dialed;
+	struct ast_party_caller caller;
+	struct ast_party_connected_line connected;
+	struct ast_party_connected_line connected_indicated;
+	struct ast_party_redirecting redirecting;
+	struct ast_readq_list readq;
+	struct varshead varshead;
+	struct ast_cdr *cdr;
+	struct ast_timer *timer;
+	AST_LIST_ENTRY(channel_remains) next;
+};
+
+/*! \brief Remains waiting for the reclaim thread */
+static AST_LIST_HEAD_STATIC(channel_remains_list, channel_remains);
+
+/*! \brief Frees what is left of destroyed channels */
+static struct ast_taskprocessor *channel_reclaimer;
+
+/*!
+ * \internal
+ * \brief Take what the reclaim thread can free off a channel being destroyed.
+ */
+static void channel_remains_take(struct channel_remains *remains, struct ast_channel *chan)
+{
+	remains->readtrans = ast_channel_readtrans(chan);
+	remains->writetrans = ast_channel_writetrans(chan);
+	ast_channel_readtrans_set(chan, NULL);
+	ast_channel_writetrans_set(chan, NULL);
+
+	/* The parties and lists are moved as they are; the channel is not used again */
+	remains->dialed = *ast_channel_dialed(chan);
+	remains->caller = *ast_channel_caller(chan);
+	remains->connected = *ast_channel_connected(chan);
+	remains->connected_indicated = *ast_channel_connected_indicated(chan);
+	remains->redirecting = *ast_channel_redirecting(chan);
+	remains->readq = *ast_channel_readq(chan);
+	remains->varshead = *ast_channel_varshead(chan);
+
+	remains->cdr = ast_channel_cdr(chan);
+	ast_channel_cdr_set(chan, NULL);
+	remains->timer = ast_channel_timer(chan);
+	ast_channel_timer_set(chan, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Free what was taken off a channel.
+ */
+static void channel_remains_free(struct channel_remains *remains)
+{
+	struct ast_var_t *vardata;
+	struct ast_frame *f;
+
+	if (remains->readtrans) {
+		ast_translator_free_path(remains->readtrans);
+	}
+	if (remains->writetrans) {
+		ast_translator_free_path(remains->writetrans);
+	}
+
+	ast_party_dialed_free(&remains->dialed);
+	ast_party_caller_free(&remains->caller);
+	ast_party_connected_line_free(&remains->connected);
+	ast_party_connected_line_free(&remains->connected_indicated);
+	ast_party_redirecting_free(&remains->redirecting);
+
+	while ((f = AST_LIST_REMOVE_HEAD(&remains->readq, frame_list))) {
+		ast_frfree(f);
+	}
+	while ((vardata = AST_LIST_REMOVE_HEAD(&remains->varshead, entries))) {
+		ast_var_delete(vardata);
+	}
+
+	if (remains->cdr) {
+		ast_cdr_free(remains->cdr);
+	}
+	if (remains->timer) {
+		ast_timer_close(remains->timer);
+	}
+}
+
+/*! \brief Reclaim thread task freeing all the remains waiting */
+static int channel_reclaim(void *data)
+{
+	AST_LIST_HEAD_NOLOCK(, channel_remains) batch;
+	struct channel_remains *remains;
+
+	AST_LIST_HEAD_INIT_NOLOCK(&batch);
+	AST_LIST_LOCK(&channel_remains_list);
+	AST_LIST_APPEND_LIST(&batch, &channel_remains_list, next);
+	AST_LIST_UNLOCK(&channel_remains_list);
+
+	while ((remains = AST_LIST_REMOVE_HEAD(&batch, next))) {
+		channel_remains_free(remains);
+		ast_free(remains);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hand the remains of a channel to the reclaim thread.
+ *
+ * A task is only queued when the list was empty; a task already queued
+ * takes everything added before it runs.
+ */
+static void channel_remains_queue(struct channel_remains *remains)
+{
+	int first;
+
+	AST_LIST_LOCK(&channel_remains_list);
+	first = AST_LIST_EMPTY(&channel_remains_list);
+	AST_LIST_INSERT_TAIL(&channel_remains_list, remains, next);
+	AST_LIST_UNLOCK(&channel_remains_list);
+
+	if (first && ast_taskprocessor_push(channel_reclaimer, channel_reclaim, NULL)) {
+		channel_reclaim(NULL);
+	}
+}
+
 /*! \brief Free a channel structure */
 static void ast_channel_destructor(void *obj)
 {
@@ -2206,10 +2685,9 @@ static void ast_channel_destructor(void *obj)
 #ifdef HAVE_EPOLL
 	int i;
 #endif
-	struct ast_var_t *vardata;
-	struct ast_frame *f;
-	struct varshead *headp;
 	struct ast_datastore *datastore;
+	struct channel_remains local_remains;
+	struct channel_remains *remains;
 	char device_name[AST_CHANNEL_NAME];
 	ast_callid callid;
 
@@ -2276,11 +2754,13 @@ static void ast_channel_destructor(void *obj)
 		device_name[0] = '\0';
 	}
 
-	/* Free translators */
-	if (ast_channel_readtrans(chan))
-		ast_translator_free_path(ast_channel_readtrans(chan));
-	if (ast_channel_writetrans(chan))
-		ast_translator_free_path(ast_channel_writetrans(chan));
+	/*
+	 * Translators, parties, queued frames, variables, the CDR and the
+	 * timer are freed by the reclaim thread, or here if it cannot take them.
+	 */
+	remains = channel_reclaimer ? ast_malloc(sizeof(*remains)) : NULL;
+	channel_remains_take(remains ?: &local_remains, chan);
+
 	if (ast_channel_pbx(chan))
 		ast_log_callid(LOG_WARNING, callid, "PBX may not have been terminated properly on '%s'\n", ast_channel_name(chan));
 
@@ -2291,18 +2771,8 @@ static void ast_channel_destructor(void *obj)
 	ast_channel_set_readformat(chan, NULL);
 	ast_channel_set_writeformat(chan, NULL);
 
-	ast_party_dialed_free(ast_channel_dialed(chan));
-	ast_party_caller_free(ast_channel_caller(chan));
-	ast_party_connected_line_free(ast_channel_connected(chan));
-	ast_party_connected_line_free(ast_channel_connected_indicated(chan));
-	ast_party_redirecting_free(ast_channel_redirecting(chan));
-
 	/* Close pipes if appropriate */
 	ast_channel_internal_alertpipe_close(chan);
-	if (ast_channel_timer(chan)) {
-		ast_timer_close(ast_channel_timer(chan));
-		ast_channel_timer_set(chan, NULL);
-	}
 #ifdef HAVE_EPOLL
 	for (i = 0; i < AST_MAX_FDS; i++) {
 		if (ast_channel_internal_epfd_data(chan, i)) {
@@ -2311,25 +2781,12 @@ static void ast_channel_destructor(void *obj)
 	}
 	close(ast_channel_epfd(chan));
 #endif
-	while ((f = AST_LIST_REMOVE_HEAD(ast_channel_readq(chan), frame_list)))
-		ast_frfree(f);
-
-	/* loop over the variables list, freeing all data and deleting list items */
-	/* no need to lock the list, as the channel is already locked */
-	headp = ast_channel_varshead(chan);
-	while ((vardata = AST_LIST_REMOVE_HEAD(headp, entries)))
-		ast_var_delete(vardata);
 
 	ast_app_group_discard(chan);
 
 	/* Destroy the jitterbuffer */
 	ast_jb_destroy(chan);
 
-	if (ast_channel_cdr(chan)) {
-		ast_cdr_free(ast_channel_cdr(chan));
-		ast_channel_cdr_set(chan, NULL);
-	}
-
 	if (ast_channel_zone(chan)) {
 		ast_channel_zone_set(chan, ast_tone_zone_unref(ast_channel_zone(chan)));
 	}
@@ -2352,6 +2809,12 @@ static void ast_channel_destructor(void *obj)
 	ast_channel_named_callgroups_set(chan, NULL);
 	ast_channel_named_pickupgroups_set(chan, NULL);
 
+	if (remains) {
+		channel_remains_queue(remains);
+	} else {
+		channel_remains_free(&local_remains);
+	}
+
 	ast_atomic_fetchadd_int(&chancount, -1);
 }
 
@@ -2678,7 +3141,7 @@ void ast_hangup(struct ast_channel *chan)
 	 * longer be needed.
 	 */
 	ast_pbx_hangup_handler_run(chan);
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 	ast_channel_lock(chan);
 
 	destroy_hooks(chan);
@@ -3962,6 +4425,9 @@ static struct ast_frame *__ast_read(struct ast_channel *chan, int dropaudio)
 			f = ast_channel_tech(chan)->read(chan);
 		else
 			ast_log(LOG_WARNING, "No read routine on channel %s\n", ast_channel_name(chan));
+		if (f) {
+			ast_frame_latency_stamp(f);
+		}
 	}
 
 	/* Perform the framehook read event here. After the frame enters the framehook list
@@ -5030,6 +5496,9 @@ static const struct ast_datastore_info plc_ds_info = {
 	.destroy = plc_ds_destroy,
 };
 
+/*! \brief Only keep PLC history for a channel once a frame of it was lost */
+static int plc_on_loss;
+
 static void adjust_frame_for_plc(struct ast_channel *chan, struct ast_frame *frame, struct ast_datastore *datastore)
 {
 	int num_new_samples = frame->samples;
@@ -5078,7 +5547,8 @@ static void adjust_frame_for_plc(struct ast_channel *chan, struct ast_frame *fra
 		frame->data.ptr = plc->samples_buf + AST_FRIENDLY_OFFSET;
 		frame->datalen = num_new_samples * 2;
 		frame->offset = AST_FRIENDLY_OFFSET * 2;
-	} else {
+	} else if (!ast_frame_make_writable(frame)) {
+		/* plc_rx() may smooth the start of the frame in place */
 		plc_rx(&plc->plc_state, frame->data.ptr, frame->samples);
 	}
 }
@@ -5095,6 +5565,11 @@ static void apply_plc(struct ast_channel *chan, struct ast_frame *frame)
 		return;
 	}
 
+	if (plc_on_loss && frame->datalen) {
+		/* Nothing lost yet, so nothing to keep history for */
+		return;
+	}
+
 	datastore = ast_datastore_alloc(&plc_ds_info, NULL);
 	if (!datastore) {
 		return;
@@ -5115,6 +5590,7 @@ int ast_write(struct ast_channel *chan, struct ast_frame *fr)
 	struct ast_frame *f = NULL;
 	int count = 0;
 	int hooked = 0;
+	struct timeval ingress = fr->ingress;
 
 	/*Deadlock avoidance*/
 	while(ast_channel_trylock(chan)) {
@@ -5426,6 +5902,14 @@ int ast_write(struct ast_channel *chan, struct ast_frame *fr)
 		ast_channel_softhangup_internal_flag_add(chan, AST_SOFTHANGUP_DEV);
 	} else {
 		ast_channel_fout_set(chan, FRAMECOUNT_INC(ast_channel_fout(chan)));
+		if (!ast_tvzero(ingress)) {
+			struct ast_frame_latency *latency = ast_channel_internal_frame_latency(chan, 1);
+
+			if (latency) {
+				ast_frame_latency_add(latency, ingress);
+			}
+			ast_frame_latency_record(AST_FRAME_LATENCY_WRITE, ast_channel_tech(chan)->type, ingress);
+		}
 	}
 done:
 	if (ast_channel_audiohooks(chan) && ast_audiohook_write_list_empty(ast_channel_audiohooks(chan))) {
@@ -6268,6 +6752,135 @@ struct ast_channel *ast_request(const char *type, struct ast_format_cap *request
 	return NULL;
 }
 
+/*! \brief Most helper threads started for one set of requests or calls */
+#define MAX_MULTIPLE_HELPERS 16
+
+/*! \brief A set of requests or calls shared by the threads making them */
+struct channel_multiple {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! Makes one request or call of the set */
+	void (*run)(void *item, const void *data);
+	const void *data;
+	char *items;
+	size_t item_size;
+	ast_callid callid;
+	/*! Index of the next item to run */
+	size_t next;
+	size_t count;
+	/*! Helper threads still running items */
+	int helpers;
+};
+
+/*! \brief Run items of the set until none are left */
+static void channel_multiple_run(struct channel_multiple *multiple)
+{
+	void *item;
+
+	for (;;) {
+		ast_mutex_lock(&multiple->lock);
+		if (multiple->next == multiple->count) {
+			ast_mutex_unlock(&multiple->lock);
+			return;
+		}
+		item = multiple->items + multiple->next++ * multiple->item_size;
+		ast_mutex_unlock(&multiple->lock);
+
+		multiple->run(item, multiple->data);
+	}
+}
+
+static void *channel_multiple_helper(void *data)
+{
+	struct channel_multiple *multiple = data;
+
+	if (multiple->callid) {
+		ast_callid_threadassoc_add(multiple->callid);
+	}
+
+	channel_multiple_run(multiple);
+
+	/* Once unlocked the caller may return and release multiple */
+	ast_mutex_lock(&multiple->lock);
+	if (!--multiple->helpers) {
+		ast_cond_signal(&multiple->cond);
+	}
+	ast_mutex_unlock(&multiple->lock);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Run a set of requests or calls from this thread and helper threads
+ *
+ * \param items Array of the items
+ * \param item_size Size of one item
+ * \param count Number of items
+ * \param run Makes the request or call of one item
+ * \param data Passed to \a run with each item
+ *
+ * \return Nothing, once every item has been run
+ */
+static void channel_multiple(void *items, size_t item_size, size_t count,
+	void (*run)(void *item, const void *data), const void *data)
+{
+	struct channel_multiple multiple = {
+		.run = run,
+		.data = data,
+		.items = items,
+		.item_size = item_size,
+		.callid = ast_read_threadstorage_callid(),
+		.count = count,
+	};
+	pthread_t thread;
+	size_t i;
+
+	ast_mutex_init(&multiple.lock);
+	ast_cond_init(&multiple.cond, NULL);
+
+	/* The calling thread runs items too, so one helper fewer than items is enough */
+	ast_mutex_lock(&multiple.lock);
+	for (i = 0; i + 1 < count && i < MAX_MULTIPLE_HELPERS; i++) {
+		if (ast_pthread_create_detached(&thread, NULL, channel_multiple_helper, &multiple)) {
+			break;
+		}
+		multiple.helpers++;
+	}
+	ast_mutex_unlock(&multiple.lock);
+
+	channel_multiple_run(&multiple);
+
+	ast_mutex_lock(&multiple.lock);
+	while (multiple.helpers) {
+		ast_cond_wait(&multiple.cond, &multiple.lock);
+	}
+	ast_mutex_unlock(&multiple.lock);
+
+	ast_mutex_destroy(&multiple.lock);
+	ast_cond_destroy(&multiple.cond);
+}
+
+static void request_multiple_run(void *item, const void *data)
+{
+	struct ast_channel_request *request = item;
+
+	request->chan = ast_request(request->type, request->request_cap, request->assignedids,
+		data, request->addr, &request->cause);
+}
+
+void ast_request_multiple(struct ast_channel_request *requests, size_t count, const struct ast_channel *requestor)
+{
+	size_t i;
+
+	for (i = 0; i < count; i++) {
+		requests[i].chan = NULL;
+		requests[i].cause = AST_CAUSE_NOTDEFINED;
+	}
+
+	channel_multiple(requests, sizeof(*requests), count, request_multiple_run, requestor);
+}
+
 /*!
  * \internal
  * \brief Setup new channel accountcodes from the requestor channel after ast_request().
@@ -6384,6 +6997,18 @@ int ast_call(struct ast_channel *chan, const char *addr, int timeout)
 	return res;
 }
 
+static void call_multiple_run(void *item, const void *data)
+{
+	struct ast_channel_call *call = item;
+
+	call->res = ast_call(call->chan, call->addr, 0);
+}
+
+void ast_call_multiple(struct ast_channel_call *calls, size_t count)
+{
+	channel_multiple(calls, sizeof(*calls), count, call_multiple_run, NULL);
+}
+
 /*!
   \brief Transfer a call to dest, if the channel supports transfer
 
@@ -6640,9 +7265,9 @@ void ast_change_name(struct ast_channel *chan, const char *newname)
 	/* We must re-link, as the hash value will change here. */
 	ao2_lock(channels);
 	ast_channel_lock(chan);
-	ao2_unlink(channels, chan);
+	ao2_unlink_flags(channels, chan, OBJ_NOLOCK);
 	__ast_change_name_nolink(chan, newname);
-	ao2_link(channels, chan);
+	ao2_link_flags(channels, chan, OBJ_NOLOCK);
 	ast_channel_unlock(chan);
 	ao2_unlock(channels);
 }
@@ -6687,6 +7312,7 @@ void ast_channel_inherit_variables(const struct ast_channel *parent, struct ast_
 				ast_var_value(newvar));
 		}
 	}
+	ast_channel_spygroup_index_update(child);
 }
 
 /*!
@@ -6712,6 +7338,9 @@ static void clone_variables(struct ast_channel *original, struct ast_channel *cl
 		if (newvar)
 			AST_LIST_INSERT_TAIL(ast_channel_varshead(clonechan), newvar, entries);
 	}
+
+	ast_channel_spygroup_index_update(original);
+	ast_channel_spygroup_index_update(clonechan);
 }
 
 
@@ -6789,9 +7418,14 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_channel_ref(original);
 	ast_channel_ref(clonechan);
 
-	/* unlink from channels container as name (which is the hash value) will change */
-	ao2_unlink(channels, original);
-	ao2_unlink(channels, clonechan);
+	/*
+	 * Unlink from channels container as name (which is the hash value) will change.
+	 * The uniqueid index must be unlinked for the same reason.
+	 */
+	ao2_unlink_flags(channels, original, OBJ_NOLOCK);
+	ao2_unlink_flags(channels, clonechan, OBJ_NOLOCK);
+	ao2_unlink(channels_by_uniqueid, original);
+	ao2_unlink(channels_by_uniqueid, clonechan);
 
 	moh_is_playing = ast_test_flag(ast_channel_flags(original), AST_FLAG_MOH);
 	if (moh_is_playing) {
@@ -7181,8 +7815,10 @@ static void channel_do_masquerade(struct ast_channel *original, struct ast_chann
 	ast_channel_unlock(original);
 	ast_channel_unlock(clonechan);
 
-	ao2_link(channels, clonechan);
-	ao2_link(channels, original);
+	ao2_link_flags(channels, clonechan, OBJ_NOLOCK);
+	ao2_link_flags(channels, original, OBJ_NOLOCK);
+	ao2_link(channels_by_uniqueid, clonechan);
+	ao2_link(channels_by_uniqueid, original);
 	ao2_unlock(channels);
 
 	/* Release our held safety references. */
@@ -7655,7 +8291,58 @@ static int ast_channel_hash_cb(const void *obj, const int flags)
 		return 0;
 	}
 
-	return ast_str_case_hash(name);
+	return ast_str_case_hash_fast(name);
+}
+
+/*!
+ * \internal
+ * \brief Hash a channel by its uniqueid for the uniqueid index.
+ */
+static int channel_uniqueid_hash_cb(const void *obj, const int flags)
+{
+	const char *uniqueid;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		uniqueid = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		uniqueid = ast_channel_uniqueid((struct ast_channel *) obj);
+		break;
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_str_case_hash_fast(uniqueid);
+}
+
+/*!
+ * \internal
+ * \brief Compare channels by uniqueid for the uniqueid index.
+ */
+static int channel_uniqueid_cmp_cb(void *obj, void *arg, int flags)
+{
+	struct ast_channel *chan = obj;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = ast_channel_uniqueid(arg);
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (strcasecmp(ast_channel_uniqueid(chan), right_key)) {
+			return 0;
+		}
+		break;
+	default:
+		/* Partial key searches are done by scanning the channels container. */
+		ast_assert(0);
+		return 0;
+	}
+
+	return CMP_MATCH;
 }
 
 int ast_plc_reload(void)
@@ -7665,9 +8352,12 @@ int ast_plc_reload(void)
 	struct ast_config *cfg = ast_config_load("codecs.conf", config_flags);
 	if (cfg == CONFIG_STATUS_FILEMISSING || cfg == CONFIG_STATUS_FILEUNCHANGED || cfg == CONFIG_STATUS_FILEINVALID)
 		return 0;
+	plc_on_loss = 0;
 	for (var = ast_variable_browse(cfg, "plc"); var; var = var->next) {
 		if (!strcasecmp(var->name, "genericplc")) {
 			ast_set2_flag(&ast_options, ast_true(var->value), AST_OPT_FLAG_GENERIC_PLC);
+		} else if (!strcasecmp(var->name, "genericplc_on_loss")) {
+			plc_on_loss = ast_true(var->value);
 		}
 	}
 	ast_config_destroy(cfg);
@@ -7811,6 +8501,16 @@ static void prnt_channel_key(void *v_obj, void *where, ao2_prnt_fn *prnt)
 	prnt(where, "%s", ast_channel_name(chan));
 }
 
+static void prnt_channel_uniqueid_key(void *v_obj, void *where, ao2_prnt_fn *prnt)
+{
+	struct ast_channel *chan = v_obj;
+
+	if (!chan) {
+		return;
+	}
+	prnt(where, "%s", ast_channel_uniqueid(chan));
+}
+
 /*!
  * \brief List of channel variables to append to all channel-related events.
  */
@@ -7996,18 +8696,59 @@ static void channels_shutdown(void)
 		ao2_ref(channels, -1);
 		channels = NULL;
 	}
+	if (channels_by_uniqueid) {
+		ao2_container_unregister("channels_by_uniqueid");
+		ao2_ref(channels_by_uniqueid, -1);
+		channels_by_uniqueid = NULL;
+	}
+	ao2_cleanup(channels_by_spygroup);
+	channels_by_spygroup = NULL;
 	ast_channel_unregister(&surrogate_tech);
 }
 
 int ast_channels_init(void)
 {
-	channels = ao2_container_alloc(NUM_CHANNEL_BUCKETS,
-			ast_channel_hash_cb, ast_channel_cmp_cb);
+	ast_cond_init(&channel_unlink_cond, NULL);
+
+	/*
+	 * Never released: channels may be destroyed until the very end, so
+	 * the reclaim thread is left running rather than shut down under them.
+	 */
+	channel_reclaimer = ast_taskprocessor_get("channel-reclaim", TPS_REF_DEFAULT);
+	if (!channel_reclaimer) {
+		return -1;
+	}
+
+	channels = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		NUM_CHANNEL_BUCKETS, ast_channel_hash_cb, NULL, ast_channel_cmp_cb);
 	if (!channels) {
 		return -1;
 	}
 	ao2_container_register("channels", channels, prnt_channel_key);
 
+	channels_by_uniqueid = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		NUM_CHANNEL_BUCKETS, channel_uniqueid_hash_cb, NULL, channel_uniqueid_cmp_cb);
+	if (!channels_by_uniqueid) {
+		ao2_container_unregister("channels");
+		ao2_ref(channels, -1);
+		channels = NULL;
+		return -1;
+	}
+	ao2_container_register("channels_by_uniqueid", channels_by_uniqueid,
+		prnt_channel_uniqueid_key);
+
+	channels_by_spygroup = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		NUM_CHANNEL_BUCKETS, channel_spygroup_hash_cb, NULL, channel_spygroup_cmp_cb);
+	if (!channels_by_spygroup) {
+		ao2_container_unregister("channels_by_uniqueid");
+		ao2_ref(channels_by_uniqueid, -1);
+		channels_by_uniqueid = NULL;
+		ao2_container_unregister("channels");
+		ao2_ref(channels, -1);
+		channels = NULL;
+		return -1;
+	}
+
 	ast_channel_register(&surrogate_tech);
 
 	ast_stasis_channels_init();
@@ -10622,7 +11363,7 @@ int ast_channel_get_cc_agent_type(struct ast_channel *chan, char *agent_type, si
 
 void ast_channel_unlink(struct ast_channel *chan)
 {
-	ao2_unlink(channels, chan);
+	channel_unlink(chan);
 }
 
 struct ast_bridge *ast_channel_get_bridge(const struct ast_channel *chan)
@@ -35,12 +35,17 @@
 
 #include <unistd.h>
 #include <fcntl.h>
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
 
 #include "asterisk/paths.h"
+#include "asterisk/arena.h"
 #include "asterisk/channel.h"
 #include "asterisk/channel_internal.h"
 #include "asterisk/data.h"
 #include "asterisk/endpoints.h"
+#include "asterisk/frame_latency.h"
 #include "asterisk/indications.h"
 #include "asterisk/stasis_cache_pattern.h"
 #include "asterisk/stasis_channels.h"
@@ -58,6 +63,18 @@ struct ast_channel_id {
 	char unique_id[AST_MAX_UNIQUEID];	/*!< Unique Identifier */
 };
 
+/*!
+ * \brief Rarely used channel members.
+ *
+ * Allocated from the channel arena the first time one of them is set, so
+ * channels that never run a macro do not carry them.
+ */
+struct ast_channel_cold {
+	int macropriority;				/*!< Macro: Current non-macro priority. See app_macro.c */
+	char macrocontext[AST_MAX_CONTEXT];		/*!< Macro: Current non-macro context. See app_macro.c */
+	char macroexten[AST_MAX_EXTENSION];		/*!< Macro: Current non-macro extension. See app_macro.c */
+};
+
 /*!
  * \brief Main Channel structure associated with a channel.
  *
@@ -68,6 +85,11 @@ struct ast_channel_id {
  *       is especially important on 64-bit architectures, where mixing 4-byte
  *       and 8-byte fields causes 4 bytes of padding to be added before many
  *       8-byte fields.
+ *
+ * \note Members used for every frame are kept together at the start.  Members
+ *       that are rarely set and can be read as empty go in struct
+ *       ast_channel_cold instead, the large ones handed out by pointer stay
+ *       here but near the end.
  */
 struct ast_channel {
 	const struct ast_channel_tech *tech;		/*!< Technology (point to channel driver) */
@@ -99,6 +121,7 @@ struct ast_channel {
 	struct ast_epoll_data *epfd_data[AST_MAX_FDS];
 #endif
 	struct ao2_container *dialed_causes;		/*!< Contains tech-specific and Asterisk cause data from dialed channels */
+	struct ast_arena *arena;			/*!< Memory freed along with the channel, holds the string fields */
 
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(name);         /*!< ASCII unique channel name */
@@ -120,13 +143,6 @@ struct ast_channel {
 	struct timeval whentohangup; /*!< Non-zero, set to actual time when channel is to be hung up */
 	pthread_t blocker;           /*!< If anyone is blocking, this is them */
 
-	/*!
-	 * \brief Dialed/Called information.
-	 * \note Set on incoming channels to indicate the originally dialed party.
-	 * \note Dialed Number Identifier (DNID)
-	 */
-	struct ast_party_dialed dialed;
-
 	/*!
 	 * \brief Channel Caller ID information.
 	 * \note The caller id information is the caller id of this
@@ -141,15 +157,6 @@ struct ast_channel {
 	 */
 	struct ast_party_connected_line connected;
 
-	/*!
-	 * \brief Channel Connected Line ID information that was last indicated.
-	 */
-	struct ast_party_connected_line connected_indicated;
-
-	/*! \brief Redirecting/Diversion information */
-	struct ast_party_redirecting redirecting;
-
-	struct ast_frame dtmff;				/*!< DTMF frame */
 	struct varshead varshead;			/*!< A linked list for channel variables. See \ref AstChanVar */
 	ast_group_t callgroup;				/*!< Call group for call pickups */
 	ast_group_t pickupgroup;			/*!< Pickup group - which calls groups can be picked up? */
@@ -158,7 +165,6 @@ struct ast_channel {
 	struct timeval creationtime;			/*!< The time of channel creation */
 	struct timeval answertime;				/*!< The time the channel was answered */
 	struct ast_readq_list readq;
-	struct ast_jb jb;				/*!< The jitterbuffer state */
 	struct timeval dtmf_tv;				/*!< The time that an in process digit began, or the last digit ended */
 	struct ast_hangup_handler_list hangup_handlers;/*!< Hangup handlers on the channel. */
 	struct ast_datastore_list datastores; /*!< Data stores on the channel */
@@ -179,7 +185,6 @@ struct ast_channel {
 	enum ast_channel_state state;			/*!< State of line -- Don't write directly, use ast_setstate() */
 	int rings;					/*!< Number of rings so far */
 	int priority;					/*!< Dialplan: Current extension priority */
-	int macropriority;				/*!< Macro: Current non-macro priority. See app_macro.c */
 	int amaflags;					/*!< Set BEFORE PBX is started to determine AMA flags */
 	enum ast_channel_adsicpe adsicpe;		/*!< Whether or not ADSI is detected on CPE */
 	unsigned int fin;				/*!< Frames in counters. The high bit is a debug mask, so
@@ -189,7 +194,8 @@ struct ast_channel {
 	int hangupcause;				/*!< Why is the channel hanged up. See causes.h */
 	unsigned int finalized:1;       /*!< Whether or not the channel has been successfully allocated */
 	struct ast_flags flags;				/*!< channel flags of AST_FLAG_ type */
-	int alertpipe[2];
+	int alertpipe[2];				/*!< With eventfd both ends are the same descriptor */
+	int alertcount;					/*!< Alerts written and not read yet (eventfd only) */
 	struct ast_format_cap *nativeformats;         /*!< Kinds of data this channel can natively handle */
 	struct ast_format *readformat;            /*!< Requested read format (after translation) */
 	struct ast_format *writeformat;           /*!< Requested write format (before translation) */
@@ -210,8 +216,6 @@ struct ast_channel {
 
 	char context[AST_MAX_CONTEXT];			/*!< Dialplan: Current extension context */
 	char exten[AST_MAX_EXTENSION];			/*!< Dialplan: Current extension number */
-	char macrocontext[AST_MAX_CONTEXT];		/*!< Macro: Current non-macro context. See app_macro.c */
-	char macroexten[AST_MAX_EXTENSION];		/*!< Macro: Current non-macro extension. See app_macro.c */
 	char unbridged;							/*!< non-zero if the bridge core needs to re-evaluate the current
 											 bridging technology which is in use by this channel's bridge. */
 	char is_t38_active;						/*!< non-zero if T.38 is active on this channel. */
@@ -221,7 +225,29 @@ struct ast_channel {
 	struct stasis_cp_single *topics;		/*!< Topic for all channel's events */
 	struct stasis_forward *endpoint_forward;	/*!< Subscription for event forwarding to endpoint's topic */
 	struct stasis_forward *endpoint_cache_forward; /*!< Subscription for cache updates to endpoint's topic */
+	struct ast_channel_snapshot *snapshot;	/*!< Snapshot last published by ast_channel_publish_snapshot() */
+	char *spygroups;			/*!< Spy groups the channel is indexed under */
+	struct ast_channel_cold *cold;		/*!< Rarely used members, NULL until one is set */
+	struct ast_frame_latency *frame_latency;	/*!< Latency of the sampled frames written, NULL until one is */
 	struct ast_readq_list deferred_readq;
+
+	/*!
+	 * \brief Dialed/Called information.
+	 * \note Set on incoming channels to indicate the originally dialed party.
+	 * \note Dialed Number Identifier (DNID)
+	 */
+	struct ast_party_dialed dialed;
+
+	/*!
+	 * \brief Channel Connected Line ID information that was last indicated.
+	 */
+	struct ast_party_connected_line connected_indicated;
+
+	/*! \brief Redirecting/Diversion information */
+	struct ast_party_redirecting redirecting;
+
+	struct ast_frame dtmff;				/*!< DTMF frame */
+	struct ast_jb jb;				/*!< The jitterbuffer state */
 };
 
 /*! \brief The monotonically increasing integer counter for channel uniqueids */
@@ -258,16 +284,13 @@ AST_DATA_STRUCTURE(ast_callerid, DATA_EXPORT_CALLERID);
 	MEMBER(ast_channel, dialcontext, AST_DATA_STRING)			\
 	MEMBER(ast_channel, rings, AST_DATA_INTEGER)				\
 	MEMBER(ast_channel, priority, AST_DATA_INTEGER)				\
-	MEMBER(ast_channel, macropriority, AST_DATA_INTEGER)			\
 	MEMBER(ast_channel, adsicpe, AST_DATA_INTEGER)				\
 	MEMBER(ast_channel, fin, AST_DATA_UNSIGNED_INTEGER)			\
 	MEMBER(ast_channel, fout, AST_DATA_UNSIGNED_INTEGER)			\
 	MEMBER(ast_channel, emulate_dtmf_duration, AST_DATA_UNSIGNED_INTEGER)	\
 	MEMBER(ast_channel, visible_indication, AST_DATA_INTEGER)		\
 	MEMBER(ast_channel, context, AST_DATA_STRING)				\
-	MEMBER(ast_channel, exten, AST_DATA_STRING)				\
-	MEMBER(ast_channel, macrocontext, AST_DATA_STRING)			\
-	MEMBER(ast_channel, macroexten, AST_DATA_STRING)
+	MEMBER(ast_channel, exten, AST_DATA_STRING)
 
 AST_DATA_STRUCTURE(ast_channel, DATA_EXPORT_CHANNEL);
 
@@ -314,6 +337,9 @@ int ast_channel_data_add_structure(struct ast_data *tree,
 	}
 
 	ast_data_add_structure(ast_channel, tree, chan);
+	ast_data_add_int(tree, "macropriority", ast_channel_macropriority(chan));
+	ast_data_add_str(tree, "macrocontext", ast_channel_macrocontext(chan));
+	ast_data_add_str(tree, "macroexten", ast_channel_macroexten(chan));
 
 	if (add_bridged) {
 		RAII_VAR(struct ast_channel *, bc, ast_channel_bridge_peer(chan), ast_channel_cleanup);
@@ -538,21 +564,49 @@ void ast_channel_exten_set(struct ast_channel *chan, const char *value)
 {
 	ast_copy_string(chan->exten, value, sizeof(chan->exten));
 }
+/*!
+ * \internal
+ * \brief Get the rarely used members of a channel, allocating them if needed.
+ *
+ * \retval NULL on allocation failure.
+ */
+static struct ast_channel_cold *channel_cold(struct ast_channel *chan)
+{
+	if (!chan->cold) {
+		chan->cold = ast_arena_calloc(chan->arena, sizeof(*chan->cold));
+	}
+	return chan->cold;
+}
+
 const char *ast_channel_macrocontext(const struct ast_channel *chan)
 {
-	return chan->macrocontext;
+	return chan->cold ? chan->cold->macrocontext : "";
 }
 void ast_channel_macrocontext_set(struct ast_channel *chan, const char *value)
 {
-	ast_copy_string(chan->macrocontext, value, sizeof(chan->macrocontext));
+	struct ast_channel_cold *cold;
+
+	if (ast_strlen_zero(value) && !chan->cold) {
+		return;
+	}
+	if ((cold = channel_cold(chan))) {
+		ast_copy_string(cold->macrocontext, value, sizeof(cold->macrocontext));
+	}
 }
 const char *ast_channel_macroexten(const struct ast_channel *chan)
 {
-	return chan->macroexten;
+	return chan->cold ? chan->cold->macroexten : "";
 }
 void ast_channel_macroexten_set(struct ast_channel *chan, const char *value)
 {
-	ast_copy_string(chan->macroexten, value, sizeof(chan->macroexten));
+	struct ast_channel_cold *cold;
+
+	if (ast_strlen_zero(value) && !chan->cold) {
+		return;
+	}
+	if ((cold = channel_cold(chan))) {
+		ast_copy_string(cold->macroexten, value, sizeof(cold->macroexten));
+	}
 }
 
 char ast_channel_dtmf_digit_to_emulate(const struct ast_channel *chan)
@@ -624,11 +678,18 @@ void ast_channel_hangupcause_set(struct ast_channel *chan, int value)
 }
 int ast_channel_macropriority(const struct ast_channel *chan)
 {
-	return chan->macropriority;
+	return chan->cold ? chan->cold->macropriority : 0;
 }
 void ast_channel_macropriority_set(struct ast_channel *chan, int value)
 {
-	chan->macropriority = value;
+	struct ast_channel_cold *cold;
+
+	if (!value && !chan->cold) {
+		return;
+	}
+	if ((cold = channel_cold(chan))) {
+		cold->macropriority = value;
+	}
 }
 int ast_channel_priority(const struct ast_channel *chan)
 {
@@ -1225,29 +1286,68 @@ void ast_channel_named_pickupgroups_set(struct ast_channel *chan, struct ast_nam
 	chan->named_pickupgroups = ast_ref_namedgroups(value);
 }
 
-/* Alertpipe functions */
+/*
+ * Alertpipe functions
+ *
+ * With eventfd the alerts are counted in alertcount, under the channel
+ * lock, and the descriptor is only written when the count leaves zero
+ * and only read when it gets back to zero.  A burst of queued frames
+ * then costs one write and one read instead of one of each per frame.
+ */
 int ast_channel_alert_write(struct ast_channel *chan)
 {
+#ifndef HAVE_EVENTFD
 	char blah = 0x7F;
+#endif
 
 	if (!ast_channel_alert_writable(chan)) {
 		errno = EBADF;
 		return 0;
 	}
+#ifdef HAVE_EVENTFD
+	if (chan->alertcount++) {
+		/* Still signalled from an earlier alert */
+		return 0;
+	}
+	if (eventfd_write(chan->alertpipe[1], 1)) {
+		chan->alertcount = 0;
+		return -1;
+	}
+	return 0;
+#else
 	/* preset errno in case returned size does not match */
 	errno = EPIPE;
 	return write(chan->alertpipe[1], &blah, sizeof(blah)) != sizeof(blah);
+#endif
 }
 
 ast_alert_status_t ast_channel_internal_alert_read(struct ast_channel *chan)
 {
+#ifdef HAVE_EVENTFD
+	eventfd_t value;
+#else
 	int flags;
 	char blah;
+#endif
 
 	if (!ast_channel_internal_alert_readable(chan)) {
 		return AST_ALERT_NOT_READABLE;
 	}
 
+#ifdef HAVE_EVENTFD
+	if (!chan->alertcount || --chan->alertcount) {
+		/* Nothing to read, or the descriptor must stay signalled */
+		return AST_ALERT_READ_SUCCESS;
+	}
+	if (eventfd_read(chan->alertpipe[0], &value)) {
+		if (errno != EINTR && errno != EAGAIN) {
+			ast_log(LOG_WARNING, "read() failed: %s\n", strerror(errno));
+			return AST_ALERT_READ_FAIL;
+		}
+	}
+	return AST_ALERT_READ_SUCCESS;
+#else
+
 	flags = fcntl(chan->alertpipe[0], F_GETFL);
 	/* For some odd reason, the alertpipe occasionally loses nonblocking status,
 	 * which immediately causes a deadlock scenario.  Detect and prevent this. */
@@ -1266,6 +1366,7 @@ ast_alert_status_t ast_channel_internal_alert_read(struct ast_channel *chan)
 	}
 
 	return AST_ALERT_READ_SUCCESS;
+#endif
 }
 
 int ast_channel_alert_writable(struct ast_channel *chan)
@@ -1281,10 +1382,15 @@ int ast_channel_internal_alert_readable(struct ast_channel *chan)
 void ast_channel_internal_alertpipe_clear(struct ast_channel *chan)
 {
 	chan->alertpipe[0] = chan->alertpipe[1] = -1;
+	chan->alertcount = 0;
 }
 
 void ast_channel_internal_alertpipe_close(struct ast_channel *chan)
 {
+	if (chan->alertpipe[1] == chan->alertpipe[0]) {
+		/* An eventfd, the write end is the read end */
+		chan->alertpipe[1] = -1;
+	}
 	if (ast_channel_internal_alert_readable(chan)) {
 		close(chan->alertpipe[0]);
 		chan->alertpipe[0] = -1;
@@ -1293,10 +1399,21 @@ void ast_channel_internal_alertpipe_close(struct ast_channel *chan)
 		close(chan->alertpipe[1]);
 		chan->alertpipe[1] = -1;
 	}
+	chan->alertcount = 0;
 }
 
 int ast_channel_internal_alertpipe_init(struct ast_channel *chan)
 {
+#ifdef HAVE_EVENTFD
+	chan->alertpipe[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (chan->alertpipe[0] < 0) {
+		ast_log(LOG_WARNING, "Channel allocation failed: Can't create alert eventfd! Try increasing max file descriptors with ulimit -n\n");
+		return -1;
+	}
+	chan->alertpipe[1] = chan->alertpipe[0];
+	chan->alertcount = 0;
+	return 0;
+#else
 	if (pipe(chan->alertpipe)) {
 		ast_log(LOG_WARNING, "Channel allocation failed: Can't create alert pipe! Try increasing max file descriptors with ulimit -n\n");
 		return -1;
@@ -1313,6 +1430,7 @@ int ast_channel_internal_alertpipe_init(struct ast_channel *chan)
 		}
 	}
 	return 0;
+#endif
 }
 
 int ast_channel_internal_alert_readfd(struct ast_channel *chan)
@@ -1326,6 +1444,7 @@ void ast_channel_internal_alertpipe_swap(struct ast_channel *chan1, struct ast_c
 	for (i = 0; i < ARRAY_LEN(chan1->alertpipe); i++) {
 		SWAP(chan1->alertpipe[i], chan2->alertpipe[i]);
 	}
+	SWAP(chan1->alertcount, chan2->alertcount);
 }
 
 /* file descriptor array accessors */
@@ -1472,6 +1591,9 @@ static int pvt_cause_cmp_fn(void *obj, void *vstr, int flags)
 
 #define DIALED_CAUSES_BUCKETS 37
 
+/*! Bytes of the channel arena's first chunk, room for the string fields and some scratch data. */
+#define CHANNEL_ARENA_SIZE 1024
+
 struct ast_channel *__ast_channel_internal_alloc(void (*destructor)(void *obj), const struct ast_assigned_ids *assignedids, const struct ast_channel *requestor, const char *file, int line, const char *function)
 {
 	struct ast_channel *tmp;
@@ -1483,7 +1605,11 @@ struct ast_channel *__ast_channel_internal_alloc(void (*destructor)(void *obj),
 		return NULL;
 	}
 
-	if ((ast_string_field_init(tmp, 128))) {
+	if (!(tmp->arena = __ast_arena_create(CHANNEL_ARENA_SIZE, file, line, function))) {
+		return ast_channel_unref(tmp);
+	}
+
+	if ((ast_string_field_init_arena(tmp, 128, tmp->arena))) {
 		return ast_channel_unref(tmp);
 	}
 
@@ -1585,13 +1711,84 @@ void ast_channel_internal_cleanup(struct ast_channel *chan)
 
 	ast_string_field_free_memory(chan);
 
+	chan->cold = NULL;
+	chan->frame_latency = NULL;
+	ast_arena_destroy(chan->arena);
+	chan->arena = NULL;
+
 	chan->endpoint_forward = stasis_forward_cancel(chan->endpoint_forward);
 	chan->endpoint_cache_forward = stasis_forward_cancel(chan->endpoint_cache_forward);
 
+	ao2_cleanup(chan->snapshot);
+	chan->snapshot = NULL;
+
+	ast_free(chan->spygroups);
+	chan->spygroups = NULL;
+
 	stasis_cp_single_unsubscribe(chan->topics);
 	chan->topics = NULL;
 }
 
+struct ast_channel_snapshot *ast_channel_internal_snapshot(const struct ast_channel *chan)
+{
+	return chan->snapshot;
+}
+
+void ast_channel_internal_snapshot_set(struct ast_channel *chan, struct ast_channel_snapshot *snapshot)
+{
+	ao2_replace(chan->snapshot, snapshot);
+}
+
+const char *ast_channel_internal_spygroups(const struct ast_channel *chan)
+{
+	return chan->spygroups;
+}
+
+void ast_channel_internal_spygroups_set(struct ast_channel *chan, const char *spygroups)
+{
+	ast_free(chan->spygroups);
+	chan->spygroups = spygroups ? ast_strdup(spygroups) : NULL;
+}
+
+struct ast_frame_latency *ast_channel_internal_frame_latency(struct ast_channel *chan, int create)
+{
+	if (!chan->frame_latency && create) {
+		chan->frame_latency = ast_arena_calloc(chan->arena, sizeof(*chan->frame_latency));
+	}
+	return chan->frame_latency;
+}
+
+void ast_channel_internal_memory(struct ast_channel *chan, struct ast_channel_memory *mem)
+{
+	struct ast_datastore *datastore;
+	struct ast_frame *frame;
+	size_t size;
+	size_t used;
+
+	mem->channels++;
+	mem->channel_size += sizeof(*chan);
+	if (chan->cold) {
+		mem->cold++;
+	}
+	if (chan->arena) {
+		ast_arena_usage(chan->arena, &size, &used);
+		mem->arena_size += size;
+		mem->arena_used += used;
+	}
+	AST_LIST_TRAVERSE(&chan->datastores, datastore, entry) {
+		mem->datastores++;
+	}
+	AST_LIST_TRAVERSE(&chan->readq, frame, frame_list) {
+		mem->readq_frames++;
+	}
+	if (chan->audiohooks) {
+		mem->audiohooks++;
+	}
+	if (chan->framehooks) {
+		mem->framehooks++;
+	}
+}
+
 void ast_channel_internal_finalize(struct ast_channel *chan)
 {
 	chan->finalized = 1;
@@ -1602,6 +1799,11 @@ int ast_channel_internal_is_finalized(struct ast_channel *chan)
 	return chan->finalized;
 }
 
+struct ast_arena *ast_channel_arena(struct ast_channel *chan)
+{
+	return chan->arena;
+}
+
 struct stasis_topic *ast_channel_topic(struct ast_channel *chan)
 {
 	if (!chan) {
@@ -54,6 +54,7 @@ struct ast_var_t *ast_var_assign(const char *name, const char *value)
 	ast_copy_string(var->name, name, name_len);
 	var->value = var->name + name_len;
 	ast_copy_string(var->value, value, value_len);
+	var->hash = ast_var_hash(ast_var_name(var));
 
 	return var;
 }
@@ -78,6 +79,11 @@ const char *ast_var_name(const struct ast_var_t *var)
 	return name;
 }
 
+unsigned int ast_var_hash(const char *name)
+{
+	return ast_str_case_hash(name);
+}
+
 const char *ast_var_full_name(const struct ast_var_t *var)
 {
 	return (var ? var->name : NULL);
@@ -91,9 +97,19 @@ const char *ast_var_value(const struct ast_var_t *var)
 char *ast_var_find(const struct varshead *head, const char *name)
 {
 	struct ast_var_t *var;
+	const char *nametail = name;
+	unsigned int hash;
+
+	/* The hash is of the name without the initial underscores */
+	if (*nametail == '_') {
+		nametail++;
+		if (*nametail == '_')
+			nametail++;
+	}
+	hash = ast_var_hash(nametail);
 
 	AST_LIST_TRAVERSE(head, var, entries) {
-		if (!strcmp(name, var->name)) {
+		if (var->hash == hash && !strcmp(name, var->name)) {
 			return var->value;
 		}
 	}
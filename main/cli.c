@@ -105,6 +105,9 @@ AST_RWLIST_HEAD(module_level_list, module_level);
 /*! list of module names and their debug levels */
 static struct module_level_list debug_modules = AST_RWLIST_HEAD_INIT_VALUE;
 
+int ast_debug_module_max;
+unsigned int ast_debug_module_generation = 1;
+
 AST_THREADSTORAGE(ast_cli_buf);
 
 AST_RWLOCK_DEFINE_STATIC(shutdown_commands_lock);
@@ -131,6 +134,30 @@ void ast_cli(int fd, const char *fmt, ...)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Recalculate ast_debug_module_max and invalidate the cached module levels.
+ *
+ * \note Assumes debug_modules is write locked.
+ */
+static void debug_modules_update(void)
+{
+	struct module_level *ml;
+	unsigned int max = 0;
+	unsigned int generation;
+
+	AST_LIST_TRAVERSE(&debug_modules, ml, entry) {
+		if (ml->level > max) {
+			max = ml->level;
+		}
+	}
+
+	/* The generation shares a word with the level in __ast_debug_module_level() */
+	generation = (ast_debug_module_generation + 1) & 0xffffff;
+	ast_debug_module_generation = generation ? generation : 1;
+	ast_debug_module_max = max;
+}
+
 unsigned int ast_debug_get_by_module(const char *module)
 {
 	struct module_level *ml;
@@ -529,6 +556,7 @@ static char *handle_debug(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 				if (AST_RWLIST_EMPTY(&debug_modules)) {
 					ast_clear_flag(&ast_options, AST_OPT_FLAG_DEBUG_MODULE);
 				}
+				debug_modules_update();
 				AST_RWLIST_UNLOCK(&debug_modules);
 				ast_cli(a->fd, "Core debug was %u and has been set to 0 for '%s'.\n",
 					ml->level, mod);
@@ -556,6 +584,7 @@ static char *handle_debug(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 				AST_RWLIST_INSERT_TAIL(&debug_modules, ml, entry);
 			}
 			ast_set_flag(&ast_options, AST_OPT_FLAG_DEBUG_MODULE);
+			debug_modules_update();
 
 			ast_cli(a->fd, "Core debug was %d and has been set to %u for '%s'.\n",
 				oldval, ml->level, ml->module);
@@ -574,6 +603,7 @@ static char *handle_debug(struct ast_cli_entry *e, int cmd, struct ast_cli_args
 			ast_free(ml);
 		}
 		ast_clear_flag(&ast_options, AST_OPT_FLAG_DEBUG_MODULE);
+		debug_modules_update();
 		AST_RWLIST_UNLOCK(&debug_modules);
 	}
 	oldval = option_debug;
@@ -914,6 +944,58 @@ static char *handle_modlist(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 #undef MODLIST_FORMAT
 #undef MODLIST_FORMAT2
 
+#define MODLOADTIME_FORMAT  "%-30s %12.3f\n"
+#define MODLOADTIME_FORMAT2 "%-30s %12s\n"
+
+struct modloadtime_totals {
+	int fd;
+	int64_t total;
+};
+
+static int modloadtime_modentry(const char *module, int64_t load_time, void *data)
+{
+	struct modloadtime_totals *totals = data;
+
+	if (!load_time) {
+		return 0;
+	}
+	ast_cli(totals->fd, MODLOADTIME_FORMAT, module, load_time / 1000.0);
+	totals->total += load_time;
+	return 1;
+}
+
+static char *handle_modloadtimes(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct modloadtime_totals totals = { .fd = a->fd, };
+	int count;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "module show load-times";
+		e->usage =
+			"Usage: module show load-times\n"
+			"       Shows how long the load function of each module took the last\n"
+			"       time it was loaded, slowest first.  With modules loaded in\n"
+			"       parallel (loadthreads in asterisk.conf) the times overlap, so\n"
+			"       their sum is more than the time Asterisk took to start them.\n";
+		return NULL;
+
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, MODLOADTIME_FORMAT2, "Module", "Load (ms)");
+	count = ast_update_module_list_load_times(modloadtime_modentry, &totals);
+	ast_cli(a->fd, "%d modules took %.3f ms to load\n", count, totals.total / 1000.0);
+	return CLI_SUCCESS;
+}
+#undef MODLOADTIME_FORMAT
+#undef MODLOADTIME_FORMAT2
+
 static char *handle_showcalls(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	struct timeval curtime = ast_tvnow();
@@ -1825,6 +1907,8 @@ static struct ast_cli_entry cli_cli[] = {
 
 	AST_CLI_DEFINE(handle_modlist, "List modules and info"),
 
+	AST_CLI_DEFINE(handle_modloadtimes, "List how long modules took to load"),
+
 	AST_CLI_DEFINE(handle_load, "Load a module by name"),
 
 	AST_CLI_DEFINE(handle_reload, "Reload configuration for a module"),
@@ -207,6 +207,322 @@ static struct ast_config_map {
 	char stuff[0];
 } *config_maps = NULL;
 
+/*! \brief Cached realtime lookups of a family, from the [cache] section of extconfig.conf */
+struct realtime_cache {
+	/*! \brief Seconds a lookup that found something is cached */
+	unsigned int ttl;
+	/*! \brief Seconds a lookup that found nothing is cached, 0 to not cache those */
+	unsigned int negative_ttl;
+	/*! \brief Most lookups cached at once */
+	unsigned int max_entries;
+	/*! \brief Bumped on every flush, so lookups that raced one are not cached */
+	int generation;
+	/*! \brief The cached lookups */
+	struct ao2_container *entries;
+	/*! \brief Name of the family */
+	char family[0];
+};
+
+/*! \brief A cached realtime lookup */
+struct realtime_cache_entry {
+	/*! \brief When the entry stops being used */
+	struct timeval expires;
+	/*! \brief Result of a single row lookup, NULL if nothing was found */
+	struct ast_variable *row;
+	/*! \brief Result of a multiple row lookup, NULL if nothing was found */
+	struct ast_config *rows;
+	/*! \brief The type of lookup and its fields */
+	char key[0];
+};
+
+/*! \brief The container of struct realtime_cache */
+static AO2_GLOBAL_OBJ_STATIC(realtime_caches);
+
+static void realtime_cache_destroy(void *obj)
+{
+	struct realtime_cache *cache = obj;
+
+	ao2_cleanup(cache->entries);
+}
+
+static void realtime_cache_entry_destroy(void *obj)
+{
+	struct realtime_cache_entry *entry = obj;
+
+	ast_variables_destroy(entry->row);
+	if (entry->rows) {
+		ast_config_destroy(entry->rows);
+	}
+}
+
+static int realtime_cache_hash(const void *obj, const int flags)
+{
+	const char *family = obj;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		family = ((const struct realtime_cache *) obj)->family;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return ast_str_case_hash(family);
+}
+
+static int realtime_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct realtime_cache *cache = obj;
+	const char *family = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		family = ((const struct realtime_cache *) arg)->family;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		break;
+	default:
+		return 0;
+	}
+
+	return strcasecmp(cache->family, family) ? 0 : CMP_MATCH;
+}
+
+AO2_STRING_FIELD_HASH_FN(realtime_cache_entry, key)
+AO2_STRING_FIELD_CMP_FN(realtime_cache_entry, key)
+
+/*! \brief Create the cache of a family from its options in extconfig.conf */
+static struct realtime_cache *realtime_cache_alloc(const char *family, const char *options)
+{
+	struct realtime_cache *cache;
+	char *opts = ast_strdupa(options);
+	char *name;
+	char *value;
+	unsigned int number;
+
+	cache = ao2_alloc_options(sizeof(*cache) + strlen(family) + 1, realtime_cache_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!cache) {
+		return NULL;
+	}
+	strcpy(cache->family, family); /* Safe */
+	cache->ttl = 60;
+	cache->max_entries = 1000;
+
+	while ((value = strsep(&opts, ","))) {
+		name = ast_strip(strsep(&value, "="));
+		if (ast_strlen_zero(name)) {
+			continue;
+		}
+		if (!value || sscanf(value, "%30u", &number) != 1) {
+			ast_log(LOG_WARNING, "Invalid value for cache option '%s' of realtime family '%s'\n",
+				name, family);
+		} else if (!strcasecmp(name, "ttl")) {
+			cache->ttl = number;
+		} else if (!strcasecmp(name, "negative_ttl")) {
+			cache->negative_ttl = number;
+		} else if (!strcasecmp(name, "max_entries") && number) {
+			cache->max_entries = number;
+		} else {
+			ast_log(LOG_WARNING, "Unknown cache option '%s' for realtime family '%s'\n",
+				name, family);
+		}
+	}
+
+	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, 127,
+		realtime_cache_entry_hash_fn, NULL, realtime_cache_entry_cmp_fn);
+	if (!cache->entries) {
+		ao2_ref(cache, -1);
+		return NULL;
+	}
+
+	ast_verb(2, "Caching realtime family %s for %u seconds, %u seconds when nothing is found, at most %u lookups\n",
+		family, cache->ttl, cache->negative_ttl, cache->max_entries);
+
+	return cache;
+}
+
+/*! \brief Find the cache of a family, if it has one */
+static struct realtime_cache *realtime_cache_find(const char *family)
+{
+	struct ao2_container *caches = ao2_global_obj_ref(realtime_caches);
+	struct realtime_cache *cache = NULL;
+
+	if (caches) {
+		cache = ao2_find(caches, family, OBJ_SEARCH_KEY);
+		ao2_ref(caches, -1);
+	}
+
+	return cache;
+}
+
+/*! \brief Build the cache key of a lookup, \a type telling single and multiple row lookups apart */
+static struct ast_str *realtime_cache_key(char type, const struct ast_variable *fields)
+{
+	struct ast_str *key = ast_str_create(128);
+	const struct ast_variable *field;
+
+	if (!key) {
+		return NULL;
+	}
+
+	ast_str_set(&key, 0, "%c", type);
+	for (field = fields; field; field = field->next) {
+		/* Lengths keep names and values from running into each other */
+		ast_str_append(&key, 0, "%zu:%s%zu:%s", strlen(field->name), field->name,
+			strlen(field->value), field->value);
+	}
+
+	return key;
+}
+
+/*!
+ * \brief Get a copy of a cached lookup result
+ *
+ * \retval 0 The lookup was cached, \a row or \a rows is set and may be NULL
+ * \retval -1 The lookup was not cached
+ */
+static int realtime_cache_get(struct realtime_cache *cache, const char *key,
+	struct ast_variable **row, struct ast_config **rows)
+{
+	struct realtime_cache_entry *entry;
+	int found = -1;
+
+	if (!(entry = ao2_find(cache->entries, key, OBJ_SEARCH_KEY))) {
+		return -1;
+	}
+
+	if (ast_tvcmp(entry->expires, ast_tvnow()) <= 0) {
+		ao2_unlink(cache->entries, entry);
+	} else if (row) {
+		*row = entry->row ? ast_variables_dup(entry->row) : NULL;
+		found = entry->row && !*row ? -1 : 0;
+	} else {
+		*rows = entry->rows ? ast_config_copy(entry->rows) : NULL;
+		found = entry->rows && !*rows ? -1 : 0;
+	}
+	ao2_ref(entry, -1);
+
+	return found;
+}
+
+static int realtime_cache_expired_cb(void *obj, void *arg, int flags)
+{
+	struct realtime_cache_entry *entry = obj;
+	struct timeval *now = arg;
+
+	return ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \brief Cache a copy of a lookup result
+ *
+ * \param generation The generation of the cache when the lookup started
+ */
+static void realtime_cache_put(struct realtime_cache *cache, const char *key, int generation,
+	struct ast_variable *row, struct ast_config *rows)
+{
+	struct realtime_cache_entry *entry;
+	unsigned int ttl = row || rows ? cache->ttl : cache->negative_ttl;
+	struct timeval now = ast_tvnow();
+
+	if (!ttl) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(key) + 1, realtime_cache_entry_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	strcpy(entry->key, key); /* Safe */
+	entry->expires = ast_tvadd(now, ast_samp2tv(ttl, 1));
+	if ((row && !(entry->row = ast_variables_dup(row)))
+		|| (rows && !(entry->rows = ast_config_copy(rows)))) {
+		ao2_ref(entry, -1);
+		return;
+	}
+
+	ao2_lock(cache->entries);
+	if (generation == cache->generation) {
+		if (ao2_container_count(cache->entries) >= cache->max_entries) {
+			ao2_callback(cache->entries, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+				realtime_cache_expired_cb, &now);
+		}
+		if (ao2_container_count(cache->entries) >= cache->max_entries) {
+			/* Still full of live lookups, start over */
+			ao2_callback(cache->entries, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+				NULL, NULL);
+		}
+		ao2_find(cache->entries, key, OBJ_SEARCH_KEY | OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA);
+		ao2_link_flags(cache->entries, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(cache->entries);
+	ao2_ref(entry, -1);
+}
+
+/*! \brief Forget every lookup of a cache */
+static int realtime_cache_flush_cb(void *obj, void *arg, int flags)
+{
+	struct realtime_cache *cache = obj;
+
+	ao2_lock(cache->entries);
+	cache->generation++;
+	ao2_callback(cache->entries, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK, NULL, NULL);
+	ao2_unlock(cache->entries);
+
+	return 0;
+}
+
+int ast_realtime_cache_flush(const char *family)
+{
+	struct ao2_container *caches = ao2_global_obj_ref(realtime_caches);
+	struct realtime_cache *cache;
+	int res = 0;
+
+	if (!caches) {
+		return -1;
+	}
+
+	if (ast_strlen_zero(family)) {
+		ao2_callback(caches, OBJ_NODATA, realtime_cache_flush_cb, NULL);
+	} else if ((cache = ao2_find(caches, family, OBJ_SEARCH_KEY))) {
+		realtime_cache_flush_cb(cache, NULL, 0);
+		ao2_ref(cache, -1);
+	} else {
+		res = -1;
+	}
+	ao2_ref(caches, -1);
+
+	return res;
+}
+
+/*! \brief Get the generation of a cache, before looking something up to cache */
+static int realtime_cache_generation(struct realtime_cache *cache)
+{
+	int generation;
+
+	ao2_lock(cache->entries);
+	generation = cache->generation;
+	ao2_unlock(cache->entries);
+
+	return generation;
+}
+
+/*! \brief Forget the lookups of a family after writing to it */
+static void realtime_cache_invalidate(const char *family)
+{
+	struct realtime_cache *cache = realtime_cache_find(family);
+
+	if (cache) {
+		realtime_cache_flush_cb(cache, NULL, 0);
+		ao2_ref(cache, -1);
+	}
+}
+
 AST_MUTEX_DEFINE_STATIC(config_lock);
 static struct ast_config_engine *config_engine_list;
 
@@ -240,6 +556,25 @@ struct ast_category {
 	struct ast_category *prev;
 	/*! Next node in the list. */
 	struct ast_category *next;
+	/*! Next category in the same bucket of the load index. */
+	struct ast_category *index_next;
+};
+
+/*!
+ * \brief Categories of a config hashed by name while it is loaded from text.
+ *
+ * Inheriting from a template or appending to a category looks the category
+ * up by name, which would otherwise walk every category read so far.
+ */
+struct config_category_index {
+	/*! Number of buckets, a power of two. */
+	unsigned int buckets;
+	/*! Number of categories indexed. */
+	unsigned int count;
+	/*! First category of each bucket. */
+	struct ast_category **heads;
+	/*! Last category of each bucket.  Buckets keep config order. */
+	struct ast_category **tails;
 };
 
 struct ast_config {
@@ -252,6 +587,7 @@ struct ast_config {
 	int include_level;
 	int max_include_level;
 	struct ast_config_include *includes;  /*!< a list of inclusions, which should describe the entire tree */
+	struct config_category_index *index;  /*!< categories by name, only while loading from text */
 };
 
 struct ast_config_include {
@@ -1005,6 +1341,113 @@ static struct ast_category *category_get_sep(const struct ast_config *config,
 	return NULL;
 }
 
+static void category_index_add(struct config_category_index *index, struct ast_category *cat)
+{
+	unsigned int bucket = ast_str_case_hash(cat->name) & (index->buckets - 1);
+
+	cat->index_next = NULL;
+	if (index->tails[bucket]) {
+		index->tails[bucket]->index_next = cat;
+	} else {
+		index->heads[bucket] = cat;
+	}
+	index->tails[bucket] = cat;
+}
+
+static void category_index_destroy(struct ast_config *config)
+{
+	if (!config->index) {
+		return;
+	}
+	ast_free(config->index->heads);
+	ast_free(config->index->tails);
+	ast_free(config->index);
+	config->index = NULL;
+}
+
+/*! \brief (Re)build the load index of a config with the given number of buckets */
+static int category_index_fill(struct ast_config *config, unsigned int buckets)
+{
+	struct config_category_index *index = config->index;
+	struct ast_category **heads = ast_calloc(buckets, sizeof(*heads));
+	struct ast_category **tails = ast_calloc(buckets, sizeof(*tails));
+	struct ast_category *cat;
+
+	if (!heads || !tails) {
+		ast_free(heads);
+		ast_free(tails);
+		return -1;
+	}
+
+	ast_free(index->heads);
+	ast_free(index->tails);
+	index->heads = heads;
+	index->tails = tails;
+	index->buckets = buckets;
+	index->count = 0;
+	for (cat = config->root; cat; cat = cat->next) {
+		category_index_add(index, cat);
+		index->count++;
+	}
+
+	return 0;
+}
+
+/*!
+ * \brief Start indexing the categories of a config by name.
+ *
+ * \retval 0 if the caller now owns the index and must destroy it.
+ * \retval -1 if the config is already indexed or indexing failed.
+ */
+static int category_index_create(struct ast_config *config)
+{
+	if (config->index || !(config->index = ast_calloc(1, sizeof(*config->index)))) {
+		return -1;
+	}
+	if (category_index_fill(config, 1024)) {
+		category_index_destroy(config);
+		return -1;
+	}
+	return 0;
+}
+
+static void category_index_append(struct ast_config *config, struct ast_category *cat)
+{
+	struct config_category_index *index = config->index;
+
+	if (++index->count > index->buckets * 2) {
+		/* The category is already on the list, so rebuilding picks it up. */
+		if (category_index_fill(config, index->buckets * 4)) {
+			category_index_destroy(config);
+		}
+		return;
+	}
+	category_index_add(index, cat);
+}
+
+/*!
+ * \brief Find a category like category_get_sep(), using the load index if
+ *        the config has one.
+ */
+static struct ast_category *category_get_indexed(const struct ast_config *config,
+	const char *category_name, const char *filter, char sep)
+{
+	struct ast_category *cat;
+
+	if (!config->index || ast_strlen_zero(category_name)) {
+		return category_get_sep(config, category_name, filter, sep);
+	}
+
+	cat = config->index->heads[ast_str_case_hash(category_name) & (config->index->buckets - 1)];
+	for (; cat; cat = cat->index_next) {
+		if (does_category_match(cat, category_name, filter, sep)) {
+			return cat;
+		}
+	}
+
+	return NULL;
+}
+
 struct ast_category *ast_category_get(const struct ast_config *config,
 	const char *category_name, const char *filter)
 {
@@ -1064,6 +1507,10 @@ void ast_category_append(struct ast_config *config, struct ast_category *categor
 
 	config->last = category;
 	config->current = category;
+
+	if (config->index) {
+		category_index_append(config, category);
+	}
 }
 
 int ast_category_insert(struct ast_config *config, struct ast_category *cat, const char *match)
@@ -1074,6 +1521,9 @@ int ast_category_insert(struct ast_config *config, struct ast_category *cat, con
 		return -1;
 	}
 
+	/* Not expected while loading, but don't leave the index out of order. */
+	category_index_destroy(config);
+
 	if (!strcasecmp(config->root->name, match)) {
 		cat->next = config->root;
 		cat->prev = NULL;
@@ -1199,6 +1649,8 @@ void ast_config_sort_categories(struct ast_config *config, int descending,
 		return;
 	}
 
+	category_index_destroy(config);
+
 	while (1) {
 		p = config->root;
 		config->root = NULL;
@@ -1488,6 +1940,9 @@ struct ast_category *ast_category_delete(struct ast_config *config,
 		config->last_browse = prev;
 	}
 
+	/* Not expected while loading, but don't leave the index pointing at it. */
+	category_index_destroy(config);
+
 	ast_category_destroy(category);
 
 	return prev;
@@ -1513,6 +1968,7 @@ void ast_config_destroy(struct ast_config *cfg)
 	if (!cfg)
 		return;
 
+	category_index_destroy(cfg);
 	ast_includes_destroy(cfg->includes);
 
 	cat = cfg->root;
@@ -1792,7 +2248,7 @@ static int process_text_line(struct ast_config *cfg, struct ast_category **cat,
 					if (cur[1] != ',') {
 						filter = &cur[1];
 					}
-					*cat = category_get_sep(cfg, catname, filter, '&');
+					*cat = category_get_indexed(cfg, catname, filter, '&');
 					if (!(*cat)) {
 						if (newcat) {
 							ast_category_destroy(newcat);
@@ -1810,7 +2266,7 @@ static int process_text_line(struct ast_config *cfg, struct ast_category **cat,
 				} else {
 					struct ast_category *base;
 
-					base = ast_category_get(cfg, cur, "TEMPLATES=include");
+					base = category_get_indexed(cfg, cur, "TEMPLATES=include", ',');
 					if (!base) {
 						if (newcat) {
 							ast_category_destroy(newcat);
@@ -2019,6 +2475,76 @@ set_new_variable:
 	return 0;
 }
 
+/*! \brief The contents of a configuration file, read in one go */
+struct config_file_text {
+	char *data;
+	size_t len;
+	size_t pos;
+};
+
+/*!
+ * \brief Read a whole configuration file into memory.
+ *
+ * \note The file is read rather than mapped, so it being truncated while it
+ *       is parsed can't fault.
+ */
+static int config_file_text_read(struct config_file_text *text, const char *fn)
+{
+	struct stat st;
+	ssize_t res;
+	int fd;
+
+	memset(text, 0, sizeof(*text));
+	if ((fd = open(fn, O_RDONLY)) < 0) {
+		return -1;
+	}
+	if (fstat(fd, &st) || !(text->data = ast_malloc(st.st_size + 1))) {
+		close(fd);
+		return -1;
+	}
+	while (text->len < st.st_size) {
+		res = read(fd, text->data + text->len, st.st_size - text->len);
+		if (res < 0 && errno == EINTR) {
+			continue;
+		}
+		if (res < 0) {
+			ast_free(text->data);
+			text->data = NULL;
+			close(fd);
+			return -1;
+		}
+		if (!res) {
+			/* The file shrank since we looked at it. */
+			break;
+		}
+		text->len += res;
+	}
+	close(fd);
+
+	return 0;
+}
+
+/*! \brief fgets() on a configuration file read by config_file_text_read() */
+static char *config_file_text_gets(char *buf, size_t size, struct config_file_text *text)
+{
+	const char *start = text->data + text->pos;
+	const char *eol;
+	size_t len = MIN(text->len - text->pos, size - 1);
+
+	if (text->pos >= text->len) {
+		return NULL;
+	}
+
+	if ((eol = memchr(start, '\n', len))) {
+		len = eol - start + 1;
+	}
+	memcpy(buf, start, len);
+	buf[len] = '\0';
+	text->pos += len;
+
+	return buf;
+}
+
 static struct ast_config *config_text_file_load(const char *database, const char *table, const char *filename, struct ast_config *cfg, struct ast_flags flags, const char *suggested_include_file, const char *who_asked)
 {
 	char fn[256];
@@ -2028,7 +2554,8 @@ static struct ast_config *config_text_file_load(const char *database, const char
 	char buf[8192];
 #endif
 	char *new_buf, *comment_p, *process_buf;
-	FILE *f;
+	struct config_file_text text;
+	struct ast_config *indexed_cfg = NULL;
 	int lineno=0;
 	int comment = 0, nest[MAX_NESTED_COMMENTS];
 	struct ast_category *cat = NULL;
@@ -2067,6 +2594,11 @@ static struct ast_config *config_text_file_load(const char *database, const char
 			return NULL;
 		}
 	}
+
+	/* The outermost load indexes categories for its includes as well. */
+	if (cfg && !category_index_create(cfg)) {
+		indexed_cfg = cfg;
+	}
 #ifdef AST_INCLUDE_GLOB
 	globbuf.gl_offs = 0;	/* initialize it to silence gcc */
 	glob_ret = glob(fn, MY_GLOB_FLAGS, NULL, &globbuf);
@@ -2159,6 +2691,9 @@ static struct ast_config *config_text_file_load(const char *database, const char
 #endif
 						ast_free(comment_buffer);
 						ast_free(lline_buffer);
+						if (indexed_cfg) {
+							category_index_destroy(indexed_cfg);
+						}
 						return CONFIG_STATUS_FILEUNCHANGED;
 					}
 				}
@@ -2180,7 +2715,7 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					AST_LIST_UNLOCK(&cfmtime_head);
 				}
 
-				if (!(f = fopen(fn, "r"))) {
+				if (config_file_text_read(&text, fn)) {
 					ast_debug(1, "No file to parse: %s\n", fn);
 					ast_verb(2, "Parsing '%s': Not found (%s)\n", fn, strerror(errno));
 					continue;
@@ -2190,13 +2725,13 @@ static struct ast_config *config_text_file_load(const char *database, const char
 				ast_clear_flag(&flags, CONFIG_FLAG_FILEUNCHANGED);
 				ast_debug(1, "Parsing %s\n", fn);
 				ast_verb(2, "Parsing '%s': Found\n", fn);
-				while (!feof(f)) {
+				while (text.pos < text.len) {
 					lineno++;
-					if (fgets(buf, sizeof(buf), f)) {
+					if (config_file_text_gets(buf, sizeof(buf), &text)) {
 						/* Skip lines that are too long */
 						if (strlen(buf) == sizeof(buf) - 1 && buf[sizeof(buf) - 1] != '\n') {
 							ast_log(LOG_WARNING, "Line %d too long, skipping. It begins with: %.32s...\n", lineno, buf);
-							while (fgets(buf, sizeof(buf), f)) {
+							while (config_file_text_gets(buf, sizeof(buf), &text)) {
 								if (strlen(buf) != sizeof(buf) - 1 || buf[sizeof(buf) - 1] == '\n') {
 									break;
 								}
@@ -2326,7 +2861,7 @@ static struct ast_config *config_text_file_load(const char *database, const char
 					CB_RESET(comment_buffer, lline_buffer);
 				}
 
-				fclose(f);
+				ast_free(text.data);
 			} while (0);
 			if (comment) {
 				ast_log(LOG_WARNING,"Unterminated comment detected beginning on line %d\n", nest[comment - 1]);
@@ -2343,6 +2878,10 @@ static struct ast_config *config_text_file_load(const char *database, const char
 	ast_free(comment_buffer);
 	ast_free(lline_buffer);
 
+	if (indexed_cfg) {
+		category_index_destroy(indexed_cfg);
+	}
+
 	if (count == 0) {
 		return NULL;
 	}
@@ -2895,6 +3434,7 @@ int read_config_maps(void)
 	int pri;
 
 	clear_config_maps();
+	ao2_global_obj_release(realtime_caches);
 
 	configtmp = ast_config_new();
 	if (!configtmp) {
@@ -2962,6 +3502,25 @@ int read_config_maps(void)
 			ast_realtime_append_mapping(v->name, driver, database, table, pri);
 	}
 
+	if ((v = ast_variable_browse(config, "cache"))) {
+		struct ao2_container *caches;
+
+		caches = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, 17,
+			realtime_cache_hash, NULL, realtime_cache_cmp);
+		if (caches) {
+			for (; v; v = v->next) {
+				struct realtime_cache *cache = realtime_cache_alloc(v->name, v->value);
+
+				if (cache) {
+					ao2_link(caches, cache);
+					ao2_ref(cache, -1);
+				}
+			}
+			ao2_global_obj_replace_unref(realtime_caches, caches);
+			ao2_ref(caches, -1);
+		}
+	}
+
 	ast_config_destroy(config);
 	return 0;
 }
@@ -3076,7 +3635,10 @@ struct ast_config *ast_config_copy(const struct ast_config *old)
 			if (!new_cat->root) {
 				goto fail;
 			}
-			new_cat->last = cat_iter->last;
+			new_cat->last = new_cat->root;
+			while (new_cat->last->next) {
+				new_cat->last = new_cat->last->next;
+			}
 		}
 	}
 
@@ -3248,18 +3810,36 @@ struct ast_variable *ast_load_realtime_all_fields(const char *family, const stru
 	char db[256];
 	char table[256];
 	struct ast_variable *res=NULL;
+	struct realtime_cache *cache;
+	struct ast_str *key = NULL;
+	int generation = 0;
 	int i;
 
+	if ((cache = realtime_cache_find(family)) && (key = realtime_cache_key('s', fields))) {
+		if (!realtime_cache_get(cache, ast_str_buffer(key), &res, NULL)) {
+			ao2_ref(cache, -1);
+			ast_free(key);
+			return res;
+		}
+		generation = realtime_cache_generation(cache);
+	}
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_func && (res = eng->realtime_func(db, table, fields))) {
-				return res;
+				break;
 			}
 		} else {
-			return NULL;
+			break;
 		}
 	}
 
+	if (key) {
+		realtime_cache_put(cache, ast_str_buffer(key), generation, res, NULL);
+		ast_free(key);
+	}
+	ao2_cleanup(cache);
+
 	return res;
 }
 
@@ -3408,8 +3988,20 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
 	char db[256];
 	char table[256];
 	struct ast_config *res = NULL;
+	struct realtime_cache *cache;
+	struct ast_str *key = NULL;
+	int generation = 0;
 	int i;
 
+	if ((cache = realtime_cache_find(family)) && (key = realtime_cache_key('m', fields))) {
+		if (!realtime_cache_get(cache, ast_str_buffer(key), NULL, &res)) {
+			ao2_ref(cache, -1);
+			ast_free(key);
+			return res;
+		}
+		generation = realtime_cache_generation(cache);
+	}
+
 	for (i = 1; ; i++) {
 		if ((eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
 			if (eng->realtime_multi_func && (res = eng->realtime_multi_func(db, table, fields))) {
@@ -3425,6 +4017,12 @@ struct ast_config *ast_load_realtime_multientry_fields(const char *family, const
 		}
 	}
 
+	if (key) {
+		realtime_cache_put(cache, ast_str_buffer(key), generation, NULL, res);
+		ast_free(key);
+	}
+	ao2_cleanup(cache);
+
 	return res;
 }
 
@@ -3462,6 +4060,8 @@ int ast_update_realtime_fields(const char *family, const char *keyfield, const c
 		}
 	}
 
+	realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3498,6 +4098,8 @@ int ast_update2_realtime_fields(const char *family, const struct ast_variable *l
 		}
 	}
 
+	realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3543,6 +4145,46 @@ int ast_store_realtime_fields(const char *family, const struct ast_variable *fie
 		}
 	}
 
+	realtime_cache_invalidate(family);
+
+	return res;
+}
+
+int ast_store_realtime_multiple_fields(const char *family, const struct ast_variable **rows, size_t count)
+{
+	struct ast_config_engine *eng;
+	int res = -1, i;
+	size_t row;
+	char db[256];
+	char table[256];
+
+	for (i = 1; ; i++) {
+		if (!(eng = find_engine(family, i, db, sizeof(db), table, sizeof(table)))) {
+			break;
+		}
+
+		if (eng->store_multiple_func) {
+			/* If the store succeeds, it returns >= 0 */
+			if ((res = eng->store_multiple_func(db, table, rows, count)) >= 0) {
+				break;
+			}
+		} else if (eng->store_func) {
+			int stored = 0;
+
+			for (row = 0; row < count; row++) {
+				if (eng->store_func(db, table, rows[row]) >= 0) {
+					stored++;
+				}
+			}
+			if (stored) {
+				res = stored;
+				break;
+			}
+		}
+	}
+
+	realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3579,6 +4221,8 @@ int ast_destroy_realtime_fields(const char *family, const char *keyfield, const
 		}
 	}
 
+	realtime_cache_invalidate(family);
+
 	return res;
 }
 
@@ -3987,6 +4631,7 @@ static void config_shutdown(void)
 	ast_cli_unregister_multiple(cli_config, ARRAY_LEN(cli_config));
 
 	clear_config_maps();
+	ao2_global_obj_release(realtime_caches);
 
 	ao2_cleanup(cfg_hooks);
 	cfg_hooks = NULL;
@@ -722,6 +722,7 @@ void ast_unreal_call_setup(struct ast_channel *semi1, struct ast_channel *semi2)
 				ast_var_value(clone_var));
 		}
 	}
+	ast_channel_spygroup_index_update(semi2);
 	ast_channel_datastore_inherit(semi1, semi2);
 
 	ast_channel_stage_snapshot_done(semi2);
@@ -114,6 +114,39 @@ static int dosync;
 
 static void db_sync(void);
 
+/*! \brief The most entries db_cache holds before clean entries are forgotten */
+#define DB_CACHE_MAX 32768
+
+/*!
+ * \brief An astdb entry held in memory
+ *
+ * Gets are answered from these without taking dblock.  Puts only change them
+ * and leave the write to SQLite to the sync thread, so repeated puts to a key
+ * between syncs cost a single write.
+ */
+struct db_cache_entry {
+	/*! \brief The value of the entry */
+	char *value;
+	/*! \brief Set while the value still has to be written to SQLite */
+	unsigned int dirty:1;
+	/*! \brief The full key, /family/key */
+	char key[0];
+};
+
+AST_VECTOR(db_cache_entries, struct db_cache_entry *);
+
+/*!
+ * \brief Cached entries, sorted by key without regard to case
+ *
+ * The lock of the container also protects db_cache_families and
+ * db_cache_dirty.  When dblock is needed as well it is taken first.
+ */
+static struct ao2_container *db_cache;
+/*! \brief Lower case names of the families which have all their entries in db_cache */
+static struct ao2_container *db_cache_families;
+/*! \brief Entries whose values wait to be written to SQLite */
+static struct db_cache_entries db_cache_dirty;
+
 #define DEFINE_SQL_STATEMENT(stmt,sql) static sqlite3_stmt *stmt; \
 	const char stmt##_sql[] = sql;
 
@@ -306,21 +339,16 @@ static int ast_db_rollback_transaction(void)
 	return db_execute_sql("ROLLBACK", NULL, NULL);
 }
 
-int ast_db_put(const char *family, const char *key, const char *value)
+/*!
+ * \internal
+ * \brief Write an entry to SQLite
+ * \note dblock must be held.
+ */
+static int db_put_sql(const char *fullkey, const char *value)
 {
-	char fullkey[MAX_DB_FIELD];
-	size_t fullkey_len;
 	int res = 0;
 
-	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
-		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
-		return -1;
-	}
-
-	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
-
-	ast_mutex_lock(&dblock);
-	if (sqlite3_bind_text(put_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
+	if (sqlite3_bind_text(put_stmt, 1, fullkey, -1, SQLITE_STATIC) != SQLITE_OK) {
 		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
 		res = -1;
 	} else if (sqlite3_bind_text(put_stmt, 2, value, -1, SQLITE_STATIC) != SQLITE_OK) {
@@ -332,6 +360,454 @@ int ast_db_put(const char *family, const char *key, const char *value)
 	}
 
 	sqlite3_reset(put_stmt);
+
+	return res;
+}
+
+static void db_cache_entry_destroy(void *obj)
+{
+	struct db_cache_entry *entry = obj;
+
+	ast_free(entry->value);
+}
+
+/*!
+ * \internal
+ * \brief Sort db_cache entries by key
+ *
+ * Keys are ordered without regard to case first, so that everything the
+ * case insensitive LIKE of the SQL statements matches for a prefix is next
+ * to each other.
+ */
+static int db_cache_sort(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct db_cache_entry *left = obj_left;
+	const char *right_key = obj_right;
+	int cmp = 0;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = ((const struct db_cache_entry *) obj_right)->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (!(cmp = strcasecmp(left->key, right_key))) {
+			cmp = strcmp(left->key, right_key);
+		}
+		break;
+	case OBJ_SEARCH_PARTIAL_KEY:
+		cmp = strncasecmp(left->key, right_key, strlen(right_key));
+		break;
+	default:
+		ast_assert(0);
+		break;
+	}
+
+	return cmp;
+}
+
+/*! \internal \brief Whether \a key is \a prefix or below it, the way the tree statements match */
+static int db_key_in_tree(const char *key, const char *prefix)
+{
+	size_t len = strlen(prefix);
+
+	return !strncasecmp(key, prefix, len) && (key[len] == '/' || key[len] == '\0');
+}
+
+/*!
+ * \internal
+ * \brief Whether every entry of a family is in db_cache
+ * \note The db_cache lock must be held.
+ */
+static int db_cache_family_complete(const char *family)
+{
+	char lower[MAX_DB_FIELD];
+	char *found;
+
+	ast_copy_string(lower, family, sizeof(lower));
+	found = ao2_find(db_cache_families, ast_str_to_lower(lower), OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	ao2_cleanup(found);
+
+	return found ? 1 : 0;
+}
+
+static int db_cache_purge_cb(void *obj, void *arg, int flags)
+{
+	struct db_cache_entry *entry = obj;
+
+	if (entry->dirty || (arg && !db_key_in_tree(entry->key, arg))) {
+		return 0;
+	}
+
+	return CMP_MATCH;
+}
+
+/*!
+ * \internal
+ * \brief Forget the cached entries below a prefix, or everything
+ *
+ * Entries still waiting to be written are kept.  Forgetting everything also
+ * forgets which families are complete.
+ *
+ * \note The db_cache lock must be held for writing.
+ */
+static void db_cache_purge(const char *prefix)
+{
+	if (ast_strlen_zero(prefix)) {
+		ao2_callback(db_cache, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+			db_cache_purge_cb, NULL);
+		ao2_callback(db_cache_families, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK,
+			NULL, NULL);
+	} else {
+		ao2_callback(db_cache, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK | OBJ_SEARCH_PARTIAL_KEY,
+			db_cache_purge_cb, (char *) prefix);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Forget what the database has changed below a prefix outside of db_cache
+ */
+static void db_cache_forget(const char *prefix)
+{
+	if (!db_cache) {
+		return;
+	}
+
+	ao2_wrlock(db_cache);
+	/* LIKE wildcards in the prefix may have matched any family */
+	db_cache_purge(!prefix || strpbrk(prefix, "%_") ? NULL : prefix);
+	ao2_unlock(db_cache);
+}
+
+/*!
+ * \internal
+ * \brief Add a clean entry to db_cache
+ * \note The db_cache lock must be held for writing.
+ * \return The new entry, with a reference for the caller
+ */
+static struct db_cache_entry *db_cache_insert(const char *fullkey, const char *value)
+{
+	struct db_cache_entry *entry;
+
+	/* Only bother when enough of the cache is not waiting to be written */
+	if (ao2_container_count(db_cache) >= DB_CACHE_MAX
+		&& ao2_container_count(db_cache) - (int) AST_VECTOR_SIZE(&db_cache_dirty) >= DB_CACHE_MAX / 2) {
+		db_cache_purge(NULL);
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(fullkey) + 1, db_cache_entry_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return NULL;
+	}
+	strcpy(entry->key, fullkey); /* Safe */
+
+	if (!(entry->value = ast_strdup(value)) || !ao2_link_flags(db_cache, entry, OBJ_NOLOCK)) {
+		ao2_ref(entry, -1);
+		return NULL;
+	}
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Remember an entry read from SQLite, unless a newer value is already cached
+ * \note dblock must be held.
+ */
+static void db_cache_add(const char *fullkey, const char *value)
+{
+	struct db_cache_entry *entry;
+
+	if (!db_cache) {
+		return;
+	}
+
+	ao2_wrlock(db_cache);
+	if (!(entry = ao2_find(db_cache, fullkey, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+		entry = db_cache_insert(fullkey, value);
+	}
+	ao2_cleanup(entry);
+	ao2_unlock(db_cache);
+}
+
+/*!
+ * \internal
+ * \brief Look up an entry in db_cache
+ *
+ * \retval 0 The entry was found
+ * \retval -1 The family is complete and the entry does not exist
+ * \retval 1 Unknown, ask SQLite
+ */
+static int db_cache_get(const char *family, const char *fullkey, char **buffer, int bufferlen)
+{
+	struct db_cache_entry *entry;
+	int found = 1;
+
+	if (!db_cache) {
+		return 1;
+	}
+
+	ao2_rdlock(db_cache);
+	if ((entry = ao2_find(db_cache, fullkey, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+		if (bufferlen == -1) {
+			*buffer = ast_strdup(entry->value);
+		} else {
+			ast_copy_string(*buffer, entry->value, bufferlen);
+		}
+		ao2_ref(entry, -1);
+		found = 0;
+	} else if (db_cache_family_complete(family)) {
+		found = -1;
+	}
+	ao2_unlock(db_cache);
+
+	return found;
+}
+
+/*!
+ * \internal
+ * \brief Put an entry in db_cache, for the sync thread to write
+ *
+ * \retval 0 success
+ * \retval -1 failure, nothing is cached for the key anymore
+ */
+static int db_cache_put(const char *fullkey, const char *value)
+{
+	struct db_cache_entry *entry;
+	char *copy;
+	int first = 0;
+
+	if (!db_cache) {
+		return -1;
+	}
+
+	ao2_wrlock(db_cache);
+	if ((entry = ao2_find(db_cache, fullkey, OBJ_SEARCH_KEY | OBJ_NOLOCK))) {
+		if (!(copy = ast_strdup(value))) {
+			goto failed;
+		}
+		ast_free(entry->value);
+		entry->value = copy;
+	} else if (!(entry = db_cache_insert(fullkey, value))) {
+		goto failed;
+	}
+
+	if (!entry->dirty) {
+		if (AST_VECTOR_APPEND(&db_cache_dirty, entry)) {
+			goto failed;
+		}
+		ao2_ref(entry, +1);
+		entry->dirty = 1;
+		first = AST_VECTOR_SIZE(&db_cache_dirty) == 1;
+	}
+	ao2_unlock(db_cache);
+	ao2_ref(entry, -1);
+
+	if (first) {
+		ast_mutex_lock(&dblock);
+		db_sync();
+		ast_mutex_unlock(&dblock);
+	}
+
+	return 0;
+
+failed:
+	/* The caller writes the value itself, so nothing older may be written after it */
+	if (entry) {
+		entry->dirty = 0;
+		ao2_unlink_flags(db_cache, entry, OBJ_NOLOCK);
+		ao2_ref(entry, -1);
+	}
+	db_cache_purge(NULL);
+	ao2_unlock(db_cache);
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Forget an entry that is being deleted
+ * \note dblock must be held.
+ */
+static void db_cache_del(const char *fullkey)
+{
+	struct db_cache_entry *entry;
+
+	if (!db_cache) {
+		return;
+	}
+
+	ao2_wrlock(db_cache);
+	if ((entry = ao2_find(db_cache, fullkey, OBJ_SEARCH_KEY | OBJ_NOLOCK | OBJ_UNLINK))) {
+		entry->dirty = 0;
+		ao2_ref(entry, -1);
+	}
+	ao2_unlock(db_cache);
+}
+
+/*! \internal \brief Create an entry of an ast_db_gettree() result */
+static struct ast_db_entry *db_entry_alloc(const char *key, const char *value)
+{
+	struct ast_db_entry *entry;
+
+	if (!(entry = ast_malloc(sizeof(*entry) + strlen(key) + strlen(value) + 2))) {
+		return NULL;
+	}
+	entry->next = NULL;
+	entry->key = entry->data + strlen(value) + 1;
+	strcpy(entry->data, value);
+	strcpy(entry->key, key);
+
+	return entry;
+}
+
+/*! \brief An ast_db_gettree() result being built */
+struct db_tree {
+	struct ast_db_entry *head;
+	struct ast_db_entry *tail;
+};
+
+static void db_tree_append(struct db_tree *tree, struct ast_db_entry *entry)
+{
+	if (tree->tail) {
+		tree->tail->next = entry;
+	} else {
+		tree->head = entry;
+	}
+	tree->tail = entry;
+}
+
+static int db_cache_gettree_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct db_cache_entry *entry = obj;
+	struct db_tree *tree = data;
+	struct ast_db_entry *cur;
+
+	if (db_key_in_tree(entry->key, arg) && (cur = db_entry_alloc(entry->key, entry->value))) {
+		db_tree_append(tree, cur);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get the entries below a prefix of a complete family from db_cache
+ *
+ * \retval 0 The entries, if any, are in \a tree
+ * \retval -1 The family is not complete, ask SQLite
+ */
+static int db_cache_gettree(const char *family, const char *prefix, struct db_tree *tree)
+{
+	int res = -1;
+
+	if (!db_cache || strpbrk(prefix, "%_")) {
+		return -1;
+	}
+
+	ao2_rdlock(db_cache);
+	if (db_cache_family_complete(family)) {
+		ao2_callback_data(db_cache, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_SEARCH_PARTIAL_KEY,
+			db_cache_gettree_cb, (char *) prefix, tree);
+		res = 0;
+	}
+	ao2_unlock(db_cache);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Remember all the entries of a family read from SQLite
+ * \note dblock must be held, so nothing can be deleted meanwhile.
+ */
+static void db_cache_add_family(const char *family, struct ast_db_entry *entries)
+{
+	char lower[MAX_DB_FIELD];
+	struct ast_db_entry *cur;
+	struct db_cache_entry *entry;
+	int count = 0;
+
+	if (!db_cache) {
+		return;
+	}
+
+	for (cur = entries; cur; cur = cur->next) {
+		count++;
+	}
+
+	ao2_wrlock(db_cache);
+	if (ao2_container_count(db_cache) + count >= DB_CACHE_MAX
+		|| db_cache_family_complete(family)) {
+		ao2_unlock(db_cache);
+		return;
+	}
+
+	for (cur = entries; cur; cur = cur->next) {
+		/* Anything cached already is at least as new */
+		if (!(entry = ao2_find(db_cache, cur->key, OBJ_SEARCH_KEY | OBJ_NOLOCK))
+			&& !(entry = db_cache_insert(cur->key, cur->data))) {
+			ao2_unlock(db_cache);
+			return;
+		}
+		ao2_ref(entry, -1);
+	}
+
+	ast_copy_string(lower, family, sizeof(lower));
+	ast_str_container_add(db_cache_families, ast_str_to_lower(lower));
+	ao2_unlock(db_cache);
+}
+
+/*!
+ * \internal
+ * \brief Write the values waiting in db_cache to SQLite
+ * \note dblock must be held.
+ */
+static void db_flush(void)
+{
+	struct db_cache_entries dirty;
+	struct db_cache_entry *entry;
+	int i;
+
+	if (!db_cache) {
+		return;
+	}
+
+	ao2_wrlock(db_cache);
+	dirty = db_cache_dirty;
+	AST_VECTOR_INIT(&db_cache_dirty, 0);
+	for (i = 0; i < AST_VECTOR_SIZE(&dirty); i++) {
+		entry = AST_VECTOR_GET(&dirty, i);
+		if (entry->dirty) {
+			entry->dirty = 0;
+			db_put_sql(entry->key, entry->value);
+		}
+		ao2_ref(entry, -1);
+	}
+	ao2_unlock(db_cache);
+
+	AST_VECTOR_FREE(&dirty);
+}
+
+int ast_db_put(const char *family, const char *key, const char *value)
+{
+	char fullkey[MAX_DB_FIELD];
+	int res;
+
+	if (strlen(family) + strlen(key) + 2 > sizeof(fullkey) - 1) {
+		ast_log(LOG_WARNING, "Family and key length must be less than %zu bytes\n", sizeof(fullkey) - 3);
+		return -1;
+	}
+
+	snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
+
+	if (!db_cache_put(fullkey, value)) {
+		return 0;
+	}
+
+	ast_mutex_lock(&dblock);
+	res = db_put_sql(fullkey, value);
 	db_sync();
 	ast_mutex_unlock(&dblock);
 
@@ -366,6 +842,14 @@ static int db_get_common(const char *family, const char *key, char **buffer, int
 
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
+	if ((res = db_cache_get(family, fullkey, buffer, bufferlen)) <= 0) {
+		if (res) {
+			ast_debug(1, "Unable to find key '%s' in family '%s'\n", key, family);
+		}
+		return res;
+	}
+	res = 0;
+
 	ast_mutex_lock(&dblock);
 	if (sqlite3_bind_text(get_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
 		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
@@ -384,6 +868,7 @@ static int db_get_common(const char *family, const char *key, char **buffer, int
 		} else {
 			ast_copy_string(*buffer, value, bufferlen);
 		}
+		db_cache_add(fullkey, value);
 	}
 	sqlite3_reset(get_stmt);
 	ast_mutex_unlock(&dblock);
@@ -422,6 +907,7 @@ int ast_db_del(const char *family, const char *key)
 	fullkey_len = snprintf(fullkey, sizeof(fullkey), "/%s/%s", family, key);
 
 	ast_mutex_lock(&dblock);
+	db_cache_del(fullkey);
 	if (sqlite3_bind_text(del_stmt, 1, fullkey, fullkey_len, SQLITE_STATIC) != SQLITE_OK) {
 		ast_log(LOG_WARNING, "Couldn't bind key to stmt: %s\n", sqlite3_errmsg(astdb));
 		res = -1;
@@ -456,6 +942,7 @@ int ast_db_deltree(const char *family, const char *keytree)
 	}
 
 	ast_mutex_lock(&dblock);
+	db_flush();
 	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
 		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
 		res = -1;
@@ -465,6 +952,7 @@ int ast_db_deltree(const char *family, const char *keytree)
 	}
 	res = sqlite3_changes(astdb);
 	sqlite3_reset(stmt);
+	db_cache_forget(prefix);
 	db_sync();
 	ast_mutex_unlock(&dblock);
 
@@ -475,7 +963,8 @@ struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 {
 	char prefix[MAX_DB_FIELD];
 	sqlite3_stmt *stmt = gettree_stmt;
-	struct ast_db_entry *cur, *last = NULL, *ret = NULL;
+	struct db_tree tree = { NULL, };
+	struct ast_db_entry *cur;
 
 	if (!ast_strlen_zero(family)) {
 		if (!ast_strlen_zero(keytree)) {
@@ -485,12 +974,16 @@ struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 			/* Family only */
 			snprintf(prefix, sizeof(prefix), "/%s", family);
 		}
+		if (!db_cache_gettree(family, prefix, &tree)) {
+			return tree.head;
+		}
 	} else {
 		prefix[0] = '\0';
 		stmt = gettree_all_stmt;
 	}
 
 	ast_mutex_lock(&dblock);
+	db_flush();
 	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
 		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
 		sqlite3_reset(stmt);
@@ -506,24 +999,19 @@ struct ast_db_entry *ast_db_gettree(const char *family, const char *keytree)
 		if (!(value_s = (const char *) sqlite3_column_text(stmt, 1))) {
 			break;
 		}
-		if (!(cur = ast_malloc(sizeof(*cur) + strlen(key_s) + strlen(value_s) + 2))) {
+		if (!(cur = db_entry_alloc(key_s, value_s))) {
 			break;
 		}
-		cur->next = NULL;
-		cur->key = cur->data + strlen(value_s) + 1;
-		strcpy(cur->data, value_s);
-		strcpy(cur->key, key_s);
-		if (last) {
-			last->next = cur;
-		} else {
-			ret = cur;
-		}
-		last = cur;
+		db_tree_append(&tree, cur);
+	}
+	if (!ast_strlen_zero(family) && ast_strlen_zero(keytree)) {
+		/* The whole family is known now */
+		db_cache_add_family(family, tree.head);
 	}
 	sqlite3_reset(stmt);
 	ast_mutex_unlock(&dblock);
 
-	return ret;
+	return tree.head;
 }
 
 void ast_db_freetree(struct ast_db_entry *dbe)
@@ -689,6 +1177,7 @@ static char *handle_cli_database_show(struct ast_cli_entry *e, int cmd, struct a
 	}
 
 	ast_mutex_lock(&dblock);
+	db_flush();
 	if (!ast_strlen_zero(prefix) && (sqlite3_bind_text(stmt, 1, prefix, -1, SQLITE_STATIC) != SQLITE_OK)) {
 		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", prefix, sqlite3_errmsg(astdb));
 		sqlite3_reset(stmt);
@@ -737,6 +1226,7 @@ static char *handle_cli_database_showkey(struct ast_cli_entry *e, int cmd, struc
 	}
 
 	ast_mutex_lock(&dblock);
+	db_flush();
 	if (!ast_strlen_zero(a->argv[2]) && (sqlite3_bind_text(showkey_stmt, 1, a->argv[2], -1, SQLITE_STATIC) != SQLITE_OK)) {
 		ast_log(LOG_WARNING, "Could bind %s to stmt: %s\n", a->argv[2], sqlite3_errmsg(astdb));
 		sqlite3_reset(showkey_stmt);
@@ -794,7 +1284,9 @@ static char *handle_cli_database_query(struct ast_cli_entry *e, int cmd, struct
 	}
 
 	ast_mutex_lock(&dblock);
+	db_flush();
 	db_execute_sql(a->argv[2], display_results, a);
+	db_cache_forget(NULL); /* The query may have changed anything */
 	db_sync(); /* Go ahead and sync the db in case they write */
 	ast_mutex_unlock(&dblock);
 
@@ -966,6 +1458,7 @@ static void *db_sync_thread(void *data)
 			ast_cond_wait(&dbcond, &dblock);
 		}
 		dosync = 0;
+		db_flush();
 		if (ast_db_commit_transaction()) {
 			ast_db_rollback_transaction();
 		}
@@ -1012,6 +1505,17 @@ static void astdb_atexit(void)
 
 int astdb_init(void)
 {
+	db_cache = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT, db_cache_sort, NULL);
+	db_cache_families = ast_str_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 61);
+	if (!db_cache || !db_cache_families || AST_VECTOR_INIT(&db_cache_dirty, 0)) {
+		ao2_cleanup(db_cache);
+		db_cache = NULL;
+		ao2_cleanup(db_cache_families);
+		db_cache_families = NULL;
+		ast_log(LOG_WARNING, "Unable to create the astdb cache, all access goes to SQLite\n");
+	}
+
 	if (db_init()) {
 		return -1;
 	}
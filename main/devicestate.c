@@ -154,6 +154,7 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/stasis.h"
 #include "asterisk/devicestate.h"
+#include "asterisk/options.h"
 
 #define DEVSTATE_TOPIC_BUCKETS 57
 
@@ -207,6 +208,14 @@ struct state_change {
 	for processing by a separate thread */
 static AST_LIST_HEAD_STATIC(state_changes, state_change);
 
+/*! \brief The queued state changes by device, protected by the state_changes lock */
+static struct ao2_container *pending_changes;
+
+#define PENDING_CHANGES_BUCKETS 563
+
+AO2_STRING_FIELD_HASH_FN(state_change, device)
+AO2_STRING_FIELD_CMP_FN(state_change, device)
+
 /*! \brief The device state change notification thread */
 static pthread_t change_thread = AST_PTHREADT_NULL;
 
@@ -496,20 +505,47 @@ int ast_devstate_changed_literal(enum ast_device_state state, enum ast_devstate_
 
 	if (state != AST_DEVICE_UNKNOWN) {
 		ast_publish_device_state(device, state, cachable);
-	} else if (change_thread == AST_PTHREADT_NULL || !(change = ast_calloc(1, sizeof(*change) + strlen(device)))) {
-		/* we could not allocate a change struct, or */
+		return 0;
+	}
+
+	if (change_thread == AST_PTHREADT_NULL) {
 		/* there is no background thread, so process the change now */
 		do_state_change(device, cachable);
-	} else {
-		/* queue the change */
-		strcpy(change->device, device);
-		change->cachable = cachable;
-		AST_LIST_LOCK(&state_changes);
-		AST_LIST_INSERT_TAIL(&state_changes, change, list);
-		ast_cond_signal(&change_pending);
+		return 0;
+	}
+
+	AST_LIST_LOCK(&state_changes);
+	change = ao2_find(pending_changes, device, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (change) {
+		/*
+		 * The device is already waiting to be evaluated, which will
+		 * find this change too.  A cachable state is also published
+		 * to subscribers, so it covers both kinds of change.
+		 */
+		if (cachable == AST_DEVSTATE_CACHABLE) {
+			change->cachable = cachable;
+		}
 		AST_LIST_UNLOCK(&state_changes);
+		ao2_ref(change, -1);
+		return 0;
 	}
 
+	change = ao2_alloc_options(sizeof(*change) + strlen(device), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!change) {
+		/* we could not allocate a change struct, so process the change now */
+		AST_LIST_UNLOCK(&state_changes);
+		do_state_change(device, cachable);
+		return 0;
+	}
+
+	/* queue the change, the list keeps the allocation reference */
+	strcpy(change->device, device);
+	change->cachable = cachable;
+	ao2_link_flags(pending_changes, change, OBJ_NOLOCK);
+	AST_LIST_INSERT_TAIL(&state_changes, change, list);
+	ast_cond_signal(&change_pending);
+	AST_LIST_UNLOCK(&state_changes);
+
 	return 0;
 }
 
@@ -552,15 +588,29 @@ static void *do_devstate_changes(void *data)
 		AST_LIST_LOCK(&state_changes);
 		if (AST_LIST_EMPTY(&state_changes))
 			ast_cond_wait(&change_pending, &state_changes.lock);
+		if (ast_option_devstate_coalesce && !AST_LIST_EMPTY(&state_changes)) {
+			/*
+			 * Further changes of the queued devices that arrive within the
+			 * window are merged with them, so each device is evaluated
+			 * and published once.
+			 */
+			struct timeval wait = ast_tvadd(ast_tvnow(), ast_samp2tv(ast_option_devstate_coalesce, 1000));
+			struct timespec ts = { .tv_sec = wait.tv_sec, .tv_nsec = wait.tv_usec * 1000 };
+
+			while (!shuttingdown
+				&& ast_cond_timedwait(&change_pending, &state_changes.lock, &ts) != ETIMEDOUT) {
+			}
+		}
 		next = AST_LIST_FIRST(&state_changes);
 		AST_LIST_HEAD_INIT_NOLOCK(&state_changes);
+		ao2_callback(pending_changes, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK, NULL, NULL);
 		AST_LIST_UNLOCK(&state_changes);
 
 		/* Process each state change */
 		while ((current = next)) {
 			next = AST_LIST_NEXT(current, list);
 			do_state_change(current->device, current->cachable);
-			ast_free(current);
+			ao2_ref(current, -1);
 		}
 	}
 
@@ -635,12 +685,20 @@ static void device_state_engine_cleanup(void)
 	if (change_thread != AST_PTHREADT_NULL) {
 		pthread_join(change_thread, NULL);
 	}
+
+	ao2_cleanup(pending_changes);
+	pending_changes = NULL;
 }
 
 /*! \brief Initialize the device state engine in separate thread */
 int ast_device_state_engine_init(void)
 {
 	ast_cond_init(&change_pending, NULL);
+	pending_changes = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0,
+		PENDING_CHANGES_BUCKETS, state_change_hash_fn, NULL, state_change_cmp_fn);
+	if (!pending_changes) {
+		return -1;
+	}
 	if (ast_pthread_create_background(&change_thread, NULL, do_devstate_changes, NULL) < 0) {
 		ast_log(LOG_ERROR, "Unable to start device state change thread.\n");
 		return -1;
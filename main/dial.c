@@ -68,6 +68,7 @@ struct ast_dial_channel {
 	void *options[AST_DIAL_OPTION_MAX];	/*!< Channel specific options */
 	int cause;				/*!< Cause code in case of failure */
 	unsigned int is_running_app:1;		/*!< Is this running an application? */
+	unsigned int request_failed:1;		/*!< Did requesting it with the other channels fail? */
 	char *assignedid1;				/*!< UniqueID to assign channel */
 	char *assignedid2;				/*!< UniqueID to assign 2nd channel */
 	struct ast_channel *owner;		/*!< Asterisk channel */
@@ -328,13 +329,102 @@ int ast_dial_append_channel(struct ast_dial *dial, struct ast_channel *chan)
 	return dial_append_common(dial, channel, tech, device, NULL);
 }
 
+/*! \brief Helper function that picks the formats to request channels with */
+static struct ast_format_cap *dial_request_cap(struct ast_channel *chan, struct ast_format_cap *cap)
+{
+	struct ast_format_cap *cap_request = NULL;
+
+	if (cap && ast_format_cap_count(cap)) {
+		return ao2_bump(cap);
+	}
+
+	if (chan) {
+		ast_channel_lock(chan);
+		cap_request = ao2_bump(ast_channel_nativeformats(chan));
+		ast_channel_unlock(chan);
+	}
+
+	if (!cap_request) {
+		cap_request = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+		if (cap_request) {
+			ast_format_cap_append_by_type(cap_request, AST_MEDIA_TYPE_AUDIO);
+		}
+	}
+
+	return cap_request;
+}
+
+/*!
+ * \brief Helper function that requests the channels without an owner at the same time
+ *
+ * \note Only done when there are several, a lone channel is requested by begin_dial_prerun().
+ */
+static void begin_dial_request(struct ast_dial *dial, struct ast_channel *chan, struct ast_format_cap *cap)
+{
+	struct ast_dial_channel *channel;
+	struct ast_channel_request *requests;
+	struct ast_assigned_ids *assignedids;
+	struct ast_format_cap *cap_request;
+	size_t count = 0;
+	size_t i = 0;
+
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		channel->request_failed = 0;
+		if (!channel->owner) {
+			count++;
+		}
+	}
+
+	if (count < 2) {
+		return;
+	}
+
+	requests = ast_calloc(count, sizeof(*requests));
+	assignedids = ast_calloc(count, sizeof(*assignedids));
+	cap_request = dial_request_cap(chan, cap);
+	if (!requests || !assignedids || !cap_request) {
+		ast_free(requests);
+		ast_free(assignedids);
+		ao2_cleanup(cap_request);
+		return;
+	}
+
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (channel->owner) {
+			continue;
+		}
+		assignedids[i].uniqueid = channel->assignedid1;
+		assignedids[i].uniqueid2 = channel->assignedid2;
+		requests[i].type = channel->tech;
+		requests[i].request_cap = cap_request;
+		requests[i].assignedids = &assignedids[i];
+		requests[i].addr = channel->device;
+		i++;
+	}
+
+	ast_request_multiple(requests, count, chan);
+
+	i = 0;
+	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+		if (channel->owner) {
+			continue;
+		}
+		channel->owner = requests[i].chan;
+		channel->cause = requests[i].cause;
+		channel->request_failed = !channel->owner;
+		i++;
+	}
+
+	ao2_ref(cap_request, -1);
+	ast_free(assignedids);
+	ast_free(requests);
+}
+
 /*! \brief Helper function that requests all channels */
 static int begin_dial_prerun(struct ast_dial_channel *channel, struct ast_channel *chan, struct ast_format_cap *cap, const char *predial_string)
 {
 	char numsubst[AST_MAX_EXTENSION];
-	struct ast_format_cap *cap_all_audio = NULL;
 	struct ast_format_cap *cap_request;
-	struct ast_format_cap *requester_cap = NULL;
 	struct ast_assigned_ids assignedids = {
 		.uniqueid = channel->assignedid1,
 		.uniqueid2 = channel->assignedid2,
@@ -345,7 +435,6 @@ static int begin_dial_prerun(struct ast_dial_channel *channel, struct ast_channe
 
 		ast_channel_lock(chan);
 		max_forwards = ast_max_forwards_get(chan);
-		requester_cap = ao2_bump(ast_channel_nativeformats(chan));
 		ast_channel_unlock(chan);
 
 		if (max_forwards <= 0) {
@@ -355,27 +444,22 @@ static int begin_dial_prerun(struct ast_dial_channel *channel, struct ast_channe
 	}
 
 	if (!channel->owner) {
+		/* Requesting it along with the other channels already failed */
+		if (channel->request_failed) {
+			return -1;
+		}
+
 		/* Copy device string over */
 		ast_copy_string(numsubst, channel->device, sizeof(numsubst));
 
-		if (cap && ast_format_cap_count(cap)) {
-			cap_request = cap;
-		} else if (requester_cap) {
-			cap_request = requester_cap;
-		} else {
-			cap_all_audio = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
-			ast_format_cap_append_by_type(cap_all_audio, AST_MEDIA_TYPE_AUDIO);
-			cap_request = cap_all_audio;
-		}
+		cap_request = dial_request_cap(chan, cap);
 
 		/* If we fail to create our owner channel bail out */
 		if (!(channel->owner = ast_request(channel->tech, cap_request, &assignedids, chan, numsubst, &channel->cause))) {
-			ao2_cleanup(cap_all_audio);
+			ao2_cleanup(cap_request);
 			return -1;
 		}
-		cap_request = NULL;
-		ao2_cleanup(requester_cap);
-		ao2_cleanup(cap_all_audio);
+		ao2_cleanup(cap_request);
 	}
 
 	if (chan) {
@@ -441,6 +525,7 @@ int ast_dial_prerun(struct ast_dial *dial, struct ast_channel *chan, struct ast_
 	char *predial_string = dial->options[AST_DIAL_OPTION_PREDIAL];
 
 	AST_LIST_LOCK(&dial->channels);
+	begin_dial_request(dial, chan, cap);
 	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
 		if ((res = begin_dial_prerun(channel, chan, cap, predial_string))) {
 			break;
@@ -451,16 +536,14 @@ int ast_dial_prerun(struct ast_dial *dial, struct ast_channel *chan, struct ast_
 	return res;
 }
 
-/*! \brief Helper function that does the beginning dialing per-appended channel */
-static int begin_dial_channel(struct ast_dial_channel *channel, struct ast_channel *chan, int async, const char *predial_string, struct ast_channel *forwarder_chan)
+/*! \brief Helper function that readies a per-appended channel to be called */
+static int begin_dial_channel_prepare(struct ast_dial_channel *channel, struct ast_channel *chan, const char *predial_string, struct ast_channel *forwarder_chan)
 {
-	char numsubst[AST_MAX_EXTENSION];
-	int res = 1;
 	char forwarder[AST_CHANNEL_NAME];
 
 	/* If no owner channel exists yet execute pre-run */
 	if (!channel->owner && begin_dial_prerun(channel, chan, NULL, predial_string)) {
-		return 0;
+		return -1;
 	}
 
 	if (forwarder_chan) {
@@ -470,40 +553,91 @@ static int begin_dial_channel(struct ast_dial_channel *channel, struct ast_chann
 		ast_channel_unlock(channel->owner);
 	}
 
-	/* Copy device string over */
-	ast_copy_string(numsubst, channel->device, sizeof(numsubst));
+	return 0;
+}
 
-	/* Attempt to actually call this device */
-	if ((res = ast_call(channel->owner, numsubst, 0))) {
-		res = 0;
+/*! \brief Helper function that handles the result of calling a per-appended channel */
+static int begin_dial_channel_called(struct ast_dial_channel *channel, struct ast_channel *chan, int async, int res)
+{
+	if (res) {
 		ast_hangup(channel->owner);
 		channel->owner = NULL;
-	} else {
-		if (chan) {
-			ast_poll_channel_add(chan, channel->owner);
-		}
-		ast_channel_publish_dial(async ? NULL : chan, channel->owner, channel->device, NULL);
-		res = 1;
-		ast_verb(3, "Called %s\n", numsubst);
+		return 0;
 	}
 
-	return res;
+	if (chan) {
+		ast_poll_channel_add(chan, channel->owner);
+	}
+	ast_channel_publish_dial(async ? NULL : chan, channel->owner, channel->device, NULL);
+	ast_verb(3, "Called %s\n", channel->device);
+
+	return 1;
+}
+
+/*! \brief Helper function that does the beginning dialing per-appended channel */
+static int begin_dial_channel(struct ast_dial_channel *channel, struct ast_channel *chan, int async, const char *predial_string, struct ast_channel *forwarder_chan)
+{
+	char numsubst[AST_MAX_EXTENSION];
+
+	if (begin_dial_channel_prepare(channel, chan, predial_string, forwarder_chan)) {
+		return 0;
+	}
+
+	/* Copy device string over */
+	ast_copy_string(numsubst, channel->device, sizeof(numsubst));
+
+	/* Attempt to actually call this device */
+	return begin_dial_channel_called(channel, chan, async, ast_call(channel->owner, numsubst, 0));
 }
 
 /*! \brief Helper function that does the beginning dialing per dial structure */
 static int begin_dial(struct ast_dial *dial, struct ast_channel *chan, int async)
 {
 	struct ast_dial_channel *channel = NULL;
+	struct ast_dial_channel **called = NULL;
+	struct ast_channel_call *calls = NULL;
+	size_t count = 0;
+	size_t i;
 	int success = 0;
 	char *predial_string = dial->options[AST_DIAL_OPTION_PREDIAL];
 
-	/* Iterate through channel list, requesting and calling each one */
 	AST_LIST_LOCK(&dial->channels);
+	begin_dial_request(dial, chan, NULL);
+
 	AST_LIST_TRAVERSE(&dial->channels, channel, list) {
-		success += begin_dial_channel(channel, chan, async, predial_string, NULL);
+		count++;
+	}
+	if (count > 1) {
+		calls = ast_calloc(count, sizeof(*calls));
+		called = ast_calloc(count, sizeof(*called));
+	}
+
+	if (!calls || !called) {
+		/* Iterate through channel list, requesting and calling each one */
+		AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+			success += begin_dial_channel(channel, chan, async, predial_string, NULL);
+		}
+	} else {
+		/* Call the channels at the same time */
+		count = 0;
+		AST_LIST_TRAVERSE(&dial->channels, channel, list) {
+			if (begin_dial_channel_prepare(channel, chan, predial_string, NULL)) {
+				continue;
+			}
+			calls[count].chan = channel->owner;
+			calls[count].addr = channel->device;
+			called[count++] = channel;
+		}
+		ast_call_multiple(calls, count);
+		for (i = 0; i < count; i++) {
+			success += begin_dial_channel_called(called[i], chan, async, calls[i].res);
+		}
 	}
 	AST_LIST_UNLOCK(&dial->channels);
 
+	ast_free(calls);
+	ast_free(called);
+
 	/* If number of failures matches the number of channels, then this truly failed */
 	return success;
 }
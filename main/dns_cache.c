@@ -0,0 +1,570 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief DNS result cache shared by every DNS query
+ *
+ * Results are kept for the lowest TTL of their records, and failed
+ * lookups for the configured negative TTL.  Queries for a name that is
+ * already being resolved wait for that resolution instead of starting
+ * their own, and a cached name that is still being asked for is resolved
+ * again shortly before it expires.
+ *
+ * Queries answered by the cache are given to the cache's own resolver,
+ * which completes them from the DNS scheduler thread, so callers always
+ * see the same asynchronous behavior as with a real resolver.
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
+#include "asterisk/dns_core.h"
+#include "asterisk/dns_resolver.h"
+#include "asterisk/dns_internal.h"
+#include "asterisk/options.h"
+#include "asterisk/sched.h"
+#include "asterisk/strings.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
+
+#include <netinet/in.h>
+#include <arpa/nameser.h>
+
+/*! Buckets of the cache container */
+#define DNS_CACHE_BUCKETS 127
+
+/*! Hits a name needs since it was resolved to be resolved again before it expires */
+#define DNS_CACHE_PREFETCH_HITS 2
+
+/*! \brief A result shared by the queries it completes */
+struct dns_cache_result {
+	/*! The result, NULL if resolution failed */
+	struct ast_dns_result *result;
+	/*! When the result was resolved */
+	struct timeval resolved;
+};
+
+/*! \brief A cached name */
+struct dns_cache_entry {
+	/*! Latest result, NULL if there is none yet */
+	struct dns_cache_result *cached;
+	/*! When the latest result expires */
+	struct timeval expires;
+	/*! TTL the latest result was cached for, in seconds */
+	unsigned int ttl;
+	/*! Hits since the latest result was cached */
+	unsigned int hits;
+	/*! Query resolving the name, NULL if none */
+	struct ast_dns_query *flight;
+	/*! Scheduled completion of the waiting queries from the cache, -1 if none */
+	int deliver_id;
+	/*! Queries waiting for a result */
+	AST_VECTOR(, struct ast_dns_query *) waiters;
+	/*! Resource record type */
+	int rr_type;
+	/*! Resource record class */
+	int rr_class;
+	/*! Name, as first asked for */
+	char name[0];
+};
+
+/*! \brief Search key of a cached name */
+struct dns_cache_key {
+	const char *name;
+	int rr_type;
+	int rr_class;
+};
+
+/*! \brief Every cached name, also locking the entries */
+static struct ao2_container *cache;
+
+/*! Hits, misses, coalesced and prefetched queries, for the CLI */
+static unsigned int cache_hits;
+static unsigned int cache_misses;
+static unsigned int cache_coalesced;
+static unsigned int cache_prefetches;
+
+static int dns_cache_resolver_resolve(struct ast_dns_query *query);
+static int dns_cache_resolver_cancel(struct ast_dns_query *query);
+
+/*! \brief The resolver of queries completed by the cache, never registered */
+static struct ast_dns_resolver dns_cache_resolver = {
+	.name = "cache",
+	.resolve = dns_cache_resolver_resolve,
+	.cancel = dns_cache_resolver_cancel,
+};
+
+static void dns_cache_result_destroy(void *obj)
+{
+	struct dns_cache_result *cached = obj;
+
+	ast_dns_result_free(cached->result);
+}
+
+static void dns_cache_entry_destroy(void *obj)
+{
+	struct dns_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->cached);
+	ao2_cleanup(entry->flight);
+	AST_VECTOR_CALLBACK_VOID(&entry->waiters, ao2_cleanup);
+	AST_VECTOR_FREE(&entry->waiters);
+}
+
+static int dns_cache_hash(const void *obj, const int flags)
+{
+	const struct dns_cache_entry *entry;
+	const struct dns_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return ast_str_case_hash(key->name) + key->rr_type;
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		return ast_str_case_hash(entry->name) + entry->rr_type;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int dns_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct dns_cache_entry *entry = obj;
+	const struct dns_cache_entry *right;
+	struct dns_cache_key right_key;
+	const struct dns_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right = arg;
+		right_key.name = right->name;
+		right_key.rr_type = right->rr_type;
+		right_key.rr_class = right->rr_class;
+		key = &right_key;
+		break;
+	case OBJ_SEARCH_KEY:
+		key = arg;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	return entry->rr_type == key->rr_type && entry->rr_class == key->rr_class
+		&& !strcasecmp(entry->name, key->name) ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Unlink a name that has expired and that nobody is waiting for.
+ */
+static int dns_cache_expired(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+	const struct timeval *now = arg;
+
+	return !entry->flight && !AST_VECTOR_SIZE(&entry->waiters) && entry->deliver_id < 0
+		&& ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Complete a query with a result the cache has.
+ *
+ * The records are added again the way the resolver added them, so that
+ * records of every type are parsed and sorted again for the query, with
+ * their TTLs reduced by the time since the result was resolved.
+ */
+static void dns_cache_complete(struct ast_dns_query *query, struct dns_cache_result *cached)
+{
+	const struct ast_dns_result *result = cached ? cached->result : NULL;
+	const struct ast_dns_record *record;
+	int elapsed;
+	int ttl;
+
+	if (result && !ast_dns_resolver_set_result(query, result->secure, result->bogus,
+		result->rcode, result->canonical, result->answer, result->answer_size)) {
+		elapsed = ast_tvdiff_ms(ast_tvnow(), cached->resolved) / 1000;
+		for (record = ast_dns_result_get_records(result); record; record = ast_dns_record_get_next(record)) {
+			ttl = ast_dns_record_get_ttl(record) - elapsed;
+			ast_dns_resolver_add_record(query, ast_dns_record_get_rr_type(record),
+				ast_dns_record_get_rr_class(record), MAX(ttl, 0),
+				ast_dns_record_get_data(record), ast_dns_record_get_data_size(record));
+		}
+	}
+
+	ast_dns_resolver_completed(query);
+}
+
+/*!
+ * \internal
+ * \brief Complete the queries waiting on a name.
+ *
+ * \note On entry, the cache is locked.  It is unlocked on return.
+ */
+static void dns_cache_complete_waiters(struct dns_cache_entry *entry, struct dns_cache_result *cached)
+{
+	struct ast_dns_query *query;
+	size_t count = AST_VECTOR_SIZE(&entry->waiters);
+	struct ast_dns_query **waiters;
+	size_t i;
+
+	if (!count) {
+		ao2_unlock(cache);
+		return;
+	}
+
+	waiters = ast_alloca(sizeof(*waiters) * count);
+	for (i = 0; i < count; ++i) {
+		waiters[i] = AST_VECTOR_GET(&entry->waiters, i);
+	}
+	AST_VECTOR_RESET(&entry->waiters, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	ao2_bump(cached);
+	ao2_unlock(cache);
+
+	for (i = 0; i < count; ++i) {
+		query = waiters[i];
+		dns_cache_complete(query, cached);
+		ao2_ref(query, -1);
+	}
+	ao2_cleanup(cached);
+}
+
+/*!
+ * \internal
+ * \brief Complete the queries waiting on a name from its cached result.
+ */
+static int dns_cache_deliver(const void *data)
+{
+	struct dns_cache_entry *entry = (struct dns_cache_entry *) data;
+
+	ao2_lock(cache);
+	entry->deliver_id = -1;
+	dns_cache_complete_waiters(entry, entry->cached);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Cache the result of resolving a name and complete the queries waiting on it.
+ */
+static void dns_cache_flight_done(const struct ast_dns_query *flight)
+{
+	struct dns_cache_entry *entry = ast_dns_query_get_data(flight);
+	struct dns_cache_result *cached;
+	struct ast_dns_result *result = flight->result;
+	unsigned int ttl = 0;
+
+	cached = ao2_alloc_options(sizeof(*cached), dns_cache_result_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (cached) {
+		/* The result now belongs to the cache. */
+		cached->result = result;
+		cached->resolved = ast_tvnow();
+		((struct ast_dns_query *) flight)->result = NULL;
+
+		if (!result || result->bogus) {
+			/* Resolution failed, let the next query try again. */
+		} else if (result->rcode != NOERROR || !ast_dns_result_get_records(result)) {
+			ttl = ast_option_dns_cache_negative_ttl;
+		} else {
+			ttl = ast_dns_result_get_lowest_ttl(result);
+		}
+	}
+
+	ao2_lock(cache);
+	if (entry->flight == flight) {
+		ao2_ref(entry->flight, -1);
+		entry->flight = NULL;
+	}
+	if (ttl) {
+		ao2_replace(entry->cached, cached);
+		entry->expires = ast_tvadd(cached->resolved, ast_samp2tv(ttl, 1));
+		entry->ttl = ttl;
+		entry->hits = 0;
+	} else if (entry->cached && ast_tvcmp(entry->expires, ast_tvnow()) > 0) {
+		/* Resolving again early failed, the result still cached is good. */
+		ao2_replace(cached, entry->cached);
+	}
+	dns_cache_complete_waiters(entry, cached);
+	ao2_cleanup(cached);
+}
+
+/*!
+ * \internal
+ * \brief Start resolving a name with the real resolver.
+ *
+ * \note On entry, the cache is locked.
+ */
+static int dns_cache_flight_start(struct dns_cache_entry *entry)
+{
+	struct ast_dns_query *flight;
+
+	flight = dns_query_alloc(entry->name, entry->rr_type, entry->rr_class, dns_cache_flight_done, entry);
+	if (!flight) {
+		return -1;
+	}
+
+	entry->flight = flight;
+	if (flight->resolver->resolve(flight)) {
+		entry->flight = NULL;
+		ao2_ref(flight, -1);
+		return -1;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Have the cache complete a query, for a name it has a fresh result for.
+ *
+ * \note On entry, the cache is locked.
+ */
+static int dns_cache_hit(struct dns_cache_entry *entry, struct ast_dns_query *query)
+{
+	if (entry->deliver_id < 0) {
+		entry->deliver_id = ast_sched_add(ast_dns_get_sched(), 0, dns_cache_deliver, ao2_bump(entry));
+		if (entry->deliver_id < 0) {
+			ao2_ref(entry, -1);
+			return -1;
+		}
+	}
+
+	++cache_hits;
+	return 0;
+}
+
+static int dns_cache_resolver_resolve(struct ast_dns_query *query)
+{
+	/* Queries are only given to this resolver by dns_cache_resolve(). */
+	ast_assert(0);
+	return -1;
+}
+
+static int dns_cache_resolver_cancel(struct ast_dns_query *query)
+{
+	struct dns_cache_entry *entry = ast_dns_resolver_get_data(query);
+	int res = -1;
+	size_t i;
+
+	ao2_lock(cache);
+	for (i = 0; i < AST_VECTOR_SIZE(&entry->waiters); ++i) {
+		if (AST_VECTOR_GET(&entry->waiters, i) == query) {
+			AST_VECTOR_REMOVE_UNORDERED(&entry->waiters, i);
+			res = 0;
+			break;
+		}
+	}
+	ao2_unlock(cache);
+
+	if (!res) {
+		/* The resolution itself goes on, to cache its result. */
+		ao2_ref(query, -1);
+	}
+
+	return res;
+}
+
+int dns_cache_resolve(struct ast_dns_query *query)
+{
+	struct dns_cache_key key = {
+		.name = query->name,
+		.rr_type = query->rr_type,
+		.rr_class = query->rr_class,
+	};
+	struct dns_cache_entry *entry;
+	struct timeval now;
+	int64_t remaining;
+	int res = -1;
+
+	if (!ast_option_dns_cache_size || !cache) {
+		return query->resolver->resolve(query);
+	}
+
+	now = ast_tvnow();
+
+	ao2_lock(cache);
+	entry = ao2_find(cache, &key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry) {
+		if (ao2_container_count(cache) >= ast_option_dns_cache_size) {
+			ao2_callback(cache, OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
+				dns_cache_expired, &now);
+		}
+		if (ao2_container_count(cache) >= ast_option_dns_cache_size
+			|| !(entry = ao2_alloc_options(sizeof(*entry) + strlen(query->name) + 1,
+				dns_cache_entry_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
+			/* Too many names are being resolved, so this one is not cached. */
+			++cache_misses;
+			ao2_unlock(cache);
+			return query->resolver->resolve(query);
+		}
+		entry->deliver_id = -1;
+		entry->rr_type = query->rr_type;
+		entry->rr_class = query->rr_class;
+		strcpy(entry->name, query->name); /* SAFE */
+		if (AST_VECTOR_INIT(&entry->waiters, 1) || !ao2_link_flags(cache, entry, OBJ_NOLOCK)) {
+			ao2_unlock(cache);
+			ao2_ref(entry, -1);
+			return query->resolver->resolve(query);
+		}
+	}
+
+	if (AST_VECTOR_APPEND(&entry->waiters, query)) {
+		goto done;
+	}
+
+	remaining = entry->cached ? ast_tvdiff_ms(entry->expires, now) : 0;
+	if (remaining > 0) {
+		res = dns_cache_hit(entry, query);
+		/* Resolve a name still in demand again before it expires. */
+		if (!res && !entry->flight && ++entry->hits >= DNS_CACHE_PREFETCH_HITS
+			&& remaining <= entry->ttl * 100 && !dns_cache_flight_start(entry)) {
+			++cache_prefetches;
+		}
+	} else if (entry->flight) {
+		++cache_coalesced;
+		res = 0;
+	} else {
+		++cache_misses;
+		res = dns_cache_flight_start(entry);
+	}
+
+	if (res) {
+		AST_VECTOR_REMOVE_ELEM_UNORDERED(&entry->waiters, query, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	} else {
+		/* The waiter keeps the query, the entry is found again on cancel. */
+		ao2_ref(query, +1);
+		query->resolver = &dns_cache_resolver;
+		ast_dns_resolver_set_data(query, entry);
+	}
+
+done:
+	ao2_unlock(cache);
+	ao2_ref(entry, -1);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Expire a name, unlinking it unless it is still being resolved or waited for.
+ */
+static int dns_cache_flush_entry(void *obj, void *arg, int flags)
+{
+	struct dns_cache_entry *entry = obj;
+
+	entry->expires = ast_tv(0, 0);
+
+	return dns_cache_expired(obj, arg, flags);
+}
+
+void dns_cache_flush(void)
+{
+	struct timeval now = ast_tvnow();
+
+	if (!cache) {
+		return;
+	}
+
+	ao2_lock(cache);
+	ao2_callback(cache, OBJ_NOLOCK | OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, dns_cache_flush_entry, &now);
+	ao2_unlock(cache);
+}
+
+static char *handle_cli_dns_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ao2_iterator iter;
+	struct dns_cache_entry *entry;
+	struct timeval now;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "dns show cache";
+		e->usage =
+			"Usage: dns show cache\n"
+			"       Shows the DNS results that are cached and the hits and misses\n"
+			"       of the cache.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_option_dns_cache_size) {
+		ast_cli(a->fd, "The DNS cache is disabled.\n");
+		return CLI_SUCCESS;
+	}
+
+	now = ast_tvnow();
+	ast_cli(a->fd, "%-48s %-6s %-6s %8s %6s %s\n", "Name", "Type", "Class", "Expires", "Hits", "State");
+
+	ao2_lock(cache);
+	iter = ao2_iterator_init(cache, AO2_ITERATOR_DONTLOCK);
+	for (; (entry = ao2_iterator_next(&iter)); ao2_ref(entry, -1)) {
+		ast_cli(a->fd, "%-48.48s %-6d %-6d %8" PRId64 " %6u %s\n", entry->name, entry->rr_type,
+			entry->rr_class, entry->cached ? MAX(ast_tvdiff_ms(entry->expires, now) / 1000, 0) : 0,
+			entry->hits, entry->flight ? "resolving"
+				: !entry->cached || ast_tvcmp(entry->expires, now) <= 0 ? "expired"
+				: entry->cached->result->rcode != NOERROR
+					|| !ast_dns_result_get_records(entry->cached->result) ? "negative" : "cached");
+	}
+	ao2_iterator_destroy(&iter);
+	ast_cli(a->fd, "%d names of up to %u, %u hits, %u misses, %u coalesced, %u prefetched.\n",
+		ao2_container_count(cache), ast_option_dns_cache_size, cache_hits, cache_misses,
+		cache_coalesced, cache_prefetches);
+	ao2_unlock(cache);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry dns_cache_cli[] = {
+	AST_CLI_DEFINE(handle_cli_dns_cache, "Show the DNS cache"),
+};
+
+static void dns_cache_shutdown(void)
+{
+	ast_cli_unregister_multiple(dns_cache_cli, ARRAY_LEN(dns_cache_cli));
+	ao2_cleanup(cache);
+	cache = NULL;
+}
+
+int ast_dns_cache_init(void)
+{
+	cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, DNS_CACHE_BUCKETS,
+		dns_cache_hash, NULL, dns_cache_cmp);
+	if (!cache) {
+		return -1;
+	}
+
+	ast_cli_register_multiple(dns_cache_cli, ARRAY_LEN(dns_cache_cli));
+	ast_register_cleanup(dns_cache_shutdown);
+
+	return 0;
+}
@@ -257,7 +257,7 @@ struct ast_dns_query_active *ast_dns_resolve_async(const char *name, int rr_type
 		return NULL;
 	}
 
-	if (active->query->resolver->resolve(active->query)) {
+	if (dns_cache_resolve(active->query)) {
 		ast_log(LOG_ERROR, "Resolver '%s' returned an error when resolving '%s' of class '%d' and type '%d'\n",
 			active->query->resolver->name, name, rr_class, rr_type);
 		ao2_ref(active, -1);
@@ -449,7 +449,8 @@ static dns_alloc_fn dns_alloc_table [] = {
 
 static struct ast_dns_record *allocate_dns_record(int rr_type, struct ast_dns_query *query, const char *data, const size_t size)
 {
-	dns_alloc_fn allocator = dns_alloc_table[rr_type] ?: generic_record_alloc;
+	dns_alloc_fn allocator = rr_type < ARRAY_LEN(dns_alloc_table) && dns_alloc_table[rr_type]
+		? dns_alloc_table[rr_type] : generic_record_alloc;
 
 	return allocator(query, data, size);
 }
@@ -513,7 +514,7 @@ static dns_sort_fn dns_sort_table [] = {
 
 static void sort_result(int rr_type, struct ast_dns_result *result)
 {
-	if (dns_sort_table[rr_type]) {
+	if (result && rr_type < ARRAY_LEN(dns_sort_table) && dns_sort_table[rr_type]) {
 		dns_sort_table[rr_type](result);
 	}
 }
@@ -599,6 +600,9 @@ int ast_dns_resolver_register(struct ast_dns_resolver *resolver)
 
 	AST_RWLIST_UNLOCK(&resolvers);
 
+	/* Results of the previous resolver should not outlive it. */
+	dns_cache_flush();
+
 	ast_verb(2, "Registered DNS resolver '%s' with priority '%d'\n", resolver->name, resolver->priority);
 
 	return 0;
@@ -622,6 +626,8 @@ void ast_dns_resolver_unregister(struct ast_dns_resolver *resolver)
 	AST_RWLIST_TRAVERSE_SAFE_END;
 	AST_RWLIST_UNLOCK(&resolvers);
 
+	dns_cache_flush();
+
 	ast_verb(2, "Unregistered DNS resolver '%s'\n", resolver->name);
 }
 
@@ -186,7 +186,7 @@ void ast_dns_query_set_resolve_async(struct ast_dns_query_set *query_set, ast_dn
 
 		query->query->user_data = ao2_bump(query_set);
 
-		if (!query->query->resolver->resolve(query->query)) {
+		if (!dns_cache_resolve(query->query)) {
 			query->started = 1;
 			continue;
 		}
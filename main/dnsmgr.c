@@ -56,6 +56,11 @@
 #include "asterisk/sched.h"
 #include "asterisk/cli.h"
 #include "asterisk/manager.h"
+#include "asterisk/dns_core.h"
+#include "asterisk/dns_query_set.h"
+#include "asterisk/dns_srv.h"
+
+#include <arpa/nameser.h>
 #include "asterisk/acl.h"
 
 static struct ast_sched_context *sched;
@@ -87,6 +92,9 @@ AST_MUTEX_DEFINE_STATIC(refresh_lock);
 
 #define REFRESH_DEFAULT 300
 
+/*! Seconds a refresh waits for the lookups it started */
+#define REFRESH_LOOKUP_TIMEOUT 30
+
 static int enabled;
 static int refresh_interval;
 
@@ -197,6 +205,36 @@ int ast_dnsmgr_lookup_cb(const char *name, struct ast_sockaddr *result, struct a
 	return internal_dnsmgr_lookup(name, result, dnsmgr, service, func, data);
 }
 
+/*
+ * Update a dnsmgr entry with the address it was resolved to
+ *
+ * The entry must be locked.
+ */
+static int dnsmgr_update(struct ast_dnsmgr_entry *entry, struct ast_sockaddr *tmp)
+{
+	int changed = 0;
+
+	if (!ast_sockaddr_port(tmp)) {
+		ast_sockaddr_set_port(tmp, ast_sockaddr_port(entry->result));
+	}
+	if (ast_sockaddr_cmp(tmp, entry->result)) {
+		const char *old_addr = ast_strdupa(ast_sockaddr_stringify(entry->result));
+		const char *new_addr = ast_strdupa(ast_sockaddr_stringify(tmp));
+
+		if (entry->update_func) {
+			entry->update_func(entry->result, tmp, entry->data);
+		} else {
+			ast_log(LOG_NOTICE, "dnssrv: host '%s' changed from %s to %s\n",
+					entry->name, old_addr, new_addr);
+
+			ast_sockaddr_copy(entry->result, tmp);
+			changed = entry->changed = 1;
+		}
+	}
+
+	return changed;
+}
+
 /*
  * Refresh a dnsmgr entry
  */
@@ -211,23 +249,7 @@ static int dnsmgr_refresh(struct ast_dnsmgr_entry *entry, int verbose)
 
 	tmp.ss.ss_family = entry->family;
 	if (!ast_get_ip_or_srv(&tmp, entry->name, entry->service)) {
-		if (!ast_sockaddr_port(&tmp)) {
-			ast_sockaddr_set_port(&tmp, ast_sockaddr_port(entry->result));
-		}
-		if (ast_sockaddr_cmp(&tmp, entry->result)) {
-			const char *old_addr = ast_strdupa(ast_sockaddr_stringify(entry->result));
-			const char *new_addr = ast_strdupa(ast_sockaddr_stringify(&tmp));
-
-			if (entry->update_func) {
-				entry->update_func(entry->result, &tmp, entry->data);
-			} else {
-				ast_log(LOG_NOTICE, "dnssrv: host '%s' changed from %s to %s\n",
-						entry->name, old_addr, new_addr);
-
-				ast_sockaddr_copy(entry->result, &tmp);
-				changed = entry->changed = 1;
-			}
-		}
+		changed = dnsmgr_update(entry, &tmp);
 	}
 
 	ast_mutex_unlock(&entry->lock);
@@ -268,10 +290,293 @@ static void *do_refresh(void *data)
 	return NULL;
 }
 
+/*! \brief The lookups of one refresh of the entries */
+struct refresh_batch {
+	/*! Lookups not completed yet */
+	int pending;
+	ast_cond_t cond;
+};
+
+/*! \brief An asynchronous lookup of one entry */
+struct refresh_lookup {
+	/*! The refresh the lookup is part of */
+	struct refresh_batch *batch;
+	/*! Address found, if found is set */
+	struct ast_sockaddr addr;
+	/*! Address family to look up, 0 for either */
+	unsigned int family;
+	/*! Address family to prefer when looking up either */
+	unsigned int prefer;
+	/*! Port from the SRV record, 0 if none */
+	unsigned short port;
+	/*! Set once an address is found */
+	unsigned int found:1;
+	/*! Set once the lookup is complete */
+	unsigned int done:1;
+	/*! The SRV record to look up, if any, followed by the name */
+	char *srv;
+	char name[0];
+};
+
+static void refresh_batch_destroy(void *obj)
+{
+	struct refresh_batch *batch = obj;
+
+	ast_cond_destroy(&batch->cond);
+}
+
+static void refresh_lookup_destroy(void *obj)
+{
+	struct refresh_lookup *lookup = obj;
+
+	ao2_cleanup(lookup->batch);
+}
+
+/*!
+ * \internal
+ * \brief Mark a lookup complete and wake up the refresh if it was the last.
+ */
+static void refresh_lookup_done(struct refresh_lookup *lookup)
+{
+	struct refresh_batch *batch = lookup->batch;
+
+	ao2_lock(batch);
+	lookup->done = 1;
+	if (!--batch->pending) {
+		ast_cond_signal(&batch->cond);
+	}
+	ao2_unlock(batch);
+}
+
+/*!
+ * \internal
+ * \brief Take the address of the preferred family from the answers of a lookup.
+ */
+static void refresh_address_resolved(const struct ast_dns_query_set *query_set)
+{
+	struct refresh_lookup *lookup = ast_dns_query_set_get_data(query_set);
+	const struct ast_dns_record *record;
+	struct ast_dns_result *result;
+	struct ast_sockaddr addr;
+	size_t i;
+
+	for (i = 0; i < ast_dns_query_set_num_queries(query_set); ++i) {
+		result = ast_dns_query_get_result(ast_dns_query_set_get(query_set, i));
+		for (record = result ? ast_dns_result_get_records(result) : NULL; record;
+			record = ast_dns_record_get_next(record)) {
+			memset(&addr, 0, sizeof(addr));
+			if (ast_dns_record_get_rr_type(record) == T_A
+				&& ast_dns_record_get_data_size(record) == sizeof(struct in_addr)) {
+				struct sockaddr_in *sin = (struct sockaddr_in *) &addr.ss;
+
+				sin->sin_family = AF_INET;
+				memcpy(&sin->sin_addr, ast_dns_record_get_data(record), sizeof(sin->sin_addr));
+				addr.len = sizeof(*sin);
+			} else if (ast_dns_record_get_rr_type(record) == T_AAAA
+				&& ast_dns_record_get_data_size(record) == sizeof(struct in6_addr)) {
+				struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *) &addr.ss;
+
+				sin6->sin6_family = AF_INET6;
+				memcpy(&sin6->sin6_addr, ast_dns_record_get_data(record), sizeof(sin6->sin6_addr));
+				addr.len = sizeof(*sin6);
+			} else {
+				continue;
+			}
+
+			/* The first address, unless one of the preferred family follows. */
+			if (!lookup->found || (addr.ss.ss_family == lookup->prefer
+				&& lookup->addr.ss.ss_family != lookup->prefer)) {
+				ast_sockaddr_copy(&lookup->addr, &addr);
+				lookup->found = 1;
+			}
+			break;
+		}
+	}
+	if (lookup->found && lookup->port) {
+		ast_sockaddr_set_port(&lookup->addr, lookup->port);
+	}
+
+	refresh_lookup_done(lookup);
+}
+
+/*!
+ * \internal
+ * \brief Start looking up the addresses of a name.
+ */
+static void refresh_address_start(struct refresh_lookup *lookup, const char *host)
+{
+	struct ast_dns_query_set *query_set = ast_dns_query_set_create();
+
+	if (!query_set
+		|| (lookup->family != AF_INET6 && ast_dns_query_set_add(query_set, host, T_A, C_IN))
+		|| (lookup->family != AF_INET && ast_dns_query_set_add(query_set, host, T_AAAA, C_IN))) {
+		ao2_cleanup(query_set);
+		refresh_lookup_done(lookup);
+		return;
+	}
+
+	ast_dns_query_set_resolve_async(query_set, refresh_address_resolved, lookup);
+	ao2_ref(query_set, -1);
+}
+
+/*!
+ * \internal
+ * \brief Look up the addresses of the target of the SRV record, or of the name without one.
+ */
+static void refresh_srv_resolved(const struct ast_dns_query *query)
+{
+	struct refresh_lookup *lookup = ast_dns_query_get_data(query);
+	const struct ast_dns_result *result = ast_dns_query_get_result(query);
+	const struct ast_dns_record *record;
+	const char *host = lookup->name;
+
+	/* The records are sorted by priority and weight. */
+	for (record = result ? ast_dns_result_get_records(result) : NULL; record;
+		record = ast_dns_record_get_next(record)) {
+		if (ast_dns_record_get_rr_type(record) == T_SRV) {
+			if (!strcmp(ast_dns_srv_get_host(record), ".")) {
+				/* The service is not available, use the name itself. */
+				break;
+			}
+			host = ast_strdupa(ast_dns_srv_get_host(record));
+			lookup->port = ast_dns_srv_get_port(record);
+			break;
+		}
+	}
+
+	refresh_address_start(lookup, host);
+}
+
+/*!
+ * \internal
+ * \brief Start looking up an entry the way ast_get_ip_or_srv() does.
+ *
+ * \note The entry must be locked.
+ */
+static struct refresh_lookup *refresh_lookup_start(struct refresh_batch *batch,
+	struct ast_dnsmgr_entry *entry)
+{
+	struct refresh_lookup *lookup;
+	struct ast_dns_query_active *active;
+	size_t name_len = strlen(entry->name) + 1;
+
+	lookup = ao2_alloc(sizeof(*lookup) + name_len
+		+ (entry->service ? strlen(entry->service) + name_len + 1 : 0), refresh_lookup_destroy);
+	if (!lookup) {
+		return NULL;
+	}
+	lookup->batch = ao2_bump(batch);
+	lookup->family = entry->family;
+	lookup->prefer = entry->result->ss.ss_family == AF_INET6 ? AF_INET6 : AF_INET;
+	strcpy(lookup->name, entry->name); /* SAFE */
+
+	ao2_lock(batch);
+	++batch->pending;
+	ao2_unlock(batch);
+
+	if (entry->service) {
+		lookup->srv = lookup->name + name_len;
+		sprintf(lookup->srv, "%s.%s", entry->service, entry->name); /* SAFE */
+		active = ast_dns_resolve_async(lookup->srv, T_SRV, C_IN, refresh_srv_resolved, lookup);
+		if (!active) {
+			refresh_lookup_done(lookup);
+		}
+		ao2_cleanup(active);
+	} else {
+		refresh_address_start(lookup, lookup->name);
+	}
+
+	return lookup;
+}
+
+/*
+ * Refresh the entries of a refresh_info
+ *
+ * The lookups of every entry are started together through the DNS core, so
+ * they share its cache and run in parallel.  An entry whose lookup finds no
+ * address, such as a name only in the hosts file, is then looked up the old
+ * way.
+ */
+static void refresh_entries(struct refresh_info *info)
+{
+	struct ast_dnsmgr_entry *entry;
+	struct refresh_batch *batch;
+	struct refresh_lookup *lookup;
+	struct timespec timeout;
+	AST_VECTOR(, struct refresh_lookup *) lookups;
+	int i = 0;
+
+	batch = ao2_alloc(sizeof(*batch), refresh_batch_destroy);
+	if (!batch || AST_VECTOR_INIT(&lookups, 16)) {
+		ao2_cleanup(batch);
+		AST_RWLIST_TRAVERSE(info->entries, entry, list) {
+			if (info->regex_present && regexec(&info->filter, entry->name, 0, NULL, 0)) {
+				continue;
+			}
+			dnsmgr_refresh(entry, info->verbose);
+		}
+		return;
+	}
+	ast_cond_init(&batch->cond, NULL);
+
+	AST_RWLIST_TRAVERSE(info->entries, entry, list) {
+		if (info->regex_present && regexec(&info->filter, entry->name, 0, NULL, 0)) {
+			lookup = NULL;
+		} else {
+			ast_mutex_lock(&entry->lock);
+			lookup = refresh_lookup_start(batch, entry);
+			ast_mutex_unlock(&entry->lock);
+		}
+		if (AST_VECTOR_APPEND(&lookups, lookup)) {
+			ao2_cleanup(lookup);
+		}
+	}
+
+	timeout = ast_tsnow();
+	timeout.tv_sec += REFRESH_LOOKUP_TIMEOUT;
+	ao2_lock(batch);
+	while (batch->pending) {
+		if (ast_cond_timedwait(&batch->cond, ao2_object_get_lockaddr(batch), &timeout) == ETIMEDOUT) {
+			break;
+		}
+	}
+	ao2_unlock(batch);
+
+	/* The entry list is still locked, so the entries match the lookups. */
+	AST_RWLIST_TRAVERSE(info->entries, entry, list) {
+		if (i >= AST_VECTOR_SIZE(&lookups)) {
+			break;
+		}
+		lookup = AST_VECTOR_GET(&lookups, i++);
+		if (!lookup) {
+			if (!info->regex_present || !regexec(&info->filter, entry->name, 0, NULL, 0)) {
+				dnsmgr_refresh(entry, info->verbose);
+			}
+			continue;
+		}
+
+		ao2_lock(batch);
+		if (!lookup->done || !lookup->found) {
+			ao2_unlock(batch);
+			dnsmgr_refresh(entry, info->verbose);
+			continue;
+		}
+		ao2_unlock(batch);
+
+		ast_mutex_lock(&entry->lock);
+		ast_debug(6, "refreshing '%s'\n", entry->name);
+		dnsmgr_update(entry, &lookup->addr);
+		ast_mutex_unlock(&entry->lock);
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&lookups, ao2_cleanup);
+	AST_VECTOR_FREE(&lookups);
+	ao2_ref(batch, -1);
+}
+
 static int refresh_list(const void *data)
 {
 	struct refresh_info *info = (struct refresh_info *)data;
-	struct ast_dnsmgr_entry *entry;
 
 	/* if a refresh or reload is already in progress, exit now */
 	if (ast_mutex_trylock(&refresh_lock)) {
@@ -283,13 +588,7 @@ static int refresh_list(const void *data)
 
 	ast_debug(6, "Refreshing DNS lookups.\n");
 	AST_RWLIST_RDLOCK(info->entries);
-	AST_RWLIST_TRAVERSE(info->entries, entry, list) {
-		if (info->regex_present && regexec(&info->filter, entry->name, 0, NULL, 0)) {
-			continue;
-		}
-
-		dnsmgr_refresh(entry, info->verbose);
-	}
+	refresh_entries(info);
 	AST_RWLIST_UNLOCK(info->entries);
 
 	ast_mutex_unlock(&refresh_lock);
@@ -281,6 +281,7 @@ typedef struct
 	float energy;
 	int current_sample;
 	int mute_samples;
+	int16_t block[DTMF_GSIZE];	/* Samples of the current block, when it spans frames */
 } dtmf_detect_state_t;
 
 typedef struct
@@ -288,8 +289,10 @@ typedef struct
 	goertzel_state_t tone_out[6];
 	int current_hit;
 	int hits[5];
+	float energy;
 	int current_sample;
 	int mute_samples;
+	int16_t block[MF_GSIZE];	/* Samples of the current block, when it spans frames */
 } mf_detect_state_t;
 
 typedef struct
@@ -351,6 +354,55 @@ static inline void goertzel_sample(goertzel_state_t *s, short sample)
 	}
 }
 
+/*! Most goertzel filters run together by goertzel_block() */
+#define GOERTZEL_BANK_MAX	FREQ_ARRAY_SIZE
+
+/*!
+ * \brief Feed samples through a bank of goertzel filters
+ *
+ * Does what calling goertzel_sample() on each filter for each sample does,
+ * but steps all filters together over the whole block with their state in
+ * local arrays, so the compiler keeps it in registers and can vectorize
+ * the inner loop across the filters.
+ */
+static inline void goertzel_block(goertzel_state_t *s, int count, const int16_t *amp, int samples)
+{
+	int v1;
+	int v2[GOERTZEL_BANK_MAX];
+	int v3[GOERTZEL_BANK_MAX];
+	int chunky[GOERTZEL_BANK_MAX];
+	int fac[GOERTZEL_BANK_MAX];
+	int i;
+	int j;
+
+	for (i = 0; i < count; i++) {
+		v2[i] = s[i].v2;
+		v3[i] = s[i].v3;
+		chunky[i] = s[i].chunky;
+		fac[i] = s[i].fac;
+	}
+
+	for (j = 0; j < samples; j++) {
+		for (i = 0; i < count; i++) {
+			v1 = v2[i];
+			v2[i] = v3[i];
+			v3[i] = ((fac[i] * v2[i]) >> 15) - v1 + (amp[j] >> chunky[i]);
+			if (abs(v3[i]) > (1 << 15)) {
+				/* The result is now too large so increase the chunky power. */
+				chunky[i]++;
+				v3[i] = v3[i] >> 1;
+				v2[i] = v2[i] >> 1;
+			}
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		s[i].v2 = v2[i];
+		s[i].v3 = v3[i];
+		s[i].chunky = chunky[i];
+	}
+}
+
 static inline float goertzel_result(goertzel_state_t *s)
 {
 	goertzel_result_t r;
@@ -532,6 +584,7 @@ static void ast_mf_detect_init(mf_detect_state_t *s, unsigned int sample_rate)
 		goertzel_init(&s->tone_out[i], mf_tones[i], sample_rate);
 	}
 	s->hits[0] = s->hits[1] = s->hits[2] = s->hits[3] = s->hits[4] = 0;
+	s->energy = 0.0;
 	s->current_sample = 0;
 	s->current_hit = 0;
 }
@@ -670,18 +723,87 @@ static void store_digit(digit_detect_state_t *s, char digit)
 	}
 }
 
-static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[], int samples, int squelch, int relax)
+/*!
+ * \brief Look for a DTMF digit in a complete detection block
+ *
+ * \return The digit found, or 0 if there is none
+ */
+static int dtmf_block_hit(dtmf_detect_state_t *s, const int16_t *block, int relax)
 {
 	float row_energy[4];
 	float col_energy[4];
+	int i;
+	int best_row;
+	int best_col;
+	int hit;
+
+	/*
+	 * The energy a goertzel filter finds in a block is at most the block
+	 * size times the energy of the block, so a block too quiet for both
+	 * filters to reach DTMF_THRESHOLD is not looked at any closer.  This
+	 * leaves out the filters for the silence between and around digits.
+	 */
+	if (s->energy * DTMF_GSIZE * 2 < DTMF_THRESHOLD) {
+		return 0;
+	}
+
+	goertzel_block(s->row_out, 4, block, DTMF_GSIZE);
+	goertzel_block(s->col_out, 4, block, DTMF_GSIZE);
+
+	/* Find the peak row and the peak column */
+	row_energy[0] = goertzel_result(&s->row_out[0]);
+	col_energy[0] = goertzel_result(&s->col_out[0]);
+
+	for (best_row = best_col = 0, i = 1; i < 4; i++) {
+		row_energy[i] = goertzel_result(&s->row_out[i]);
+		if (row_energy[i] > row_energy[best_row]) {
+			best_row = i;
+		}
+		col_energy[i] = goertzel_result(&s->col_out[i]);
+		if (col_energy[i] > col_energy[best_col]) {
+			best_col = i;
+		}
+	}
+	ast_debug(10, "DTMF best '%c' Erow=%.4E Ecol=%.4E Erc=%.4E Et=%.4E\n",
+		dtmf_positions[(best_row << 2) + best_col],
+		row_energy[best_row], col_energy[best_col],
+		row_energy[best_row] + col_energy[best_col], s->energy);
+	hit = 0;
+	/* Basic signal level test and the twist test */
+	if (row_energy[best_row] >= DTMF_THRESHOLD &&
+	    col_energy[best_col] >= DTMF_THRESHOLD &&
+	    col_energy[best_col] < row_energy[best_row] * (relax ? relax_dtmf_reverse_twist : dtmf_reverse_twist) &&
+	    row_energy[best_row] < col_energy[best_col] * (relax ? relax_dtmf_normal_twist : dtmf_normal_twist)) {
+		/* Relative peak test */
+		for (i = 0; i < 4; i++) {
+			if ((i != best_col &&
+			    col_energy[i] * DTMF_RELATIVE_PEAK_COL > col_energy[best_col]) ||
+			    (i != best_row
+			     && row_energy[i] * DTMF_RELATIVE_PEAK_ROW > row_energy[best_row])) {
+				break;
+			}
+		}
+		/* ... and fraction of total energy test */
+		if (i >= 4 &&
+		    (row_energy[best_row] + col_energy[best_col]) > DTMF_TO_TOTAL_ENERGY * s->energy) {
+			/* Got a hit */
+			hit = dtmf_positions[(best_row << 2) + best_col];
+			ast_debug(10, "DTMF hit '%c'\n", hit);
+		}
+	}
+
+	return hit;
+}
+
+static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[], int samples, int squelch, int relax)
+{
 	int i;
 	int j;
 	int sample;
 	short samp;
-	int best_row;
-	int best_col;
 	int hit;
 	int limit;
+	const int16_t *block;
 	fragment_t mute = {0, 0};
 
 	if (squelch && s->td.dtmf.mute_samples > 0) {
@@ -697,68 +819,24 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
 		for (j = sample; j < limit; j++) {
 			samp = amp[j];
 			s->td.dtmf.energy += (int32_t) samp * (int32_t) samp;
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
-			goertzel_sample(s->td.dtmf.row_out, samp);
-			goertzel_sample(s->td.dtmf.col_out, samp);
-			goertzel_sample(s->td.dtmf.row_out + 1, samp);
-			goertzel_sample(s->td.dtmf.col_out + 1, samp);
-			goertzel_sample(s->td.dtmf.row_out + 2, samp);
-			goertzel_sample(s->td.dtmf.col_out + 2, samp);
-			goertzel_sample(s->td.dtmf.row_out + 3, samp);
-			goertzel_sample(s->td.dtmf.col_out + 3, samp);
+		}
+		if (!s->td.dtmf.current_sample && limit - sample == DTMF_GSIZE) {
+			/* The whole block is in this frame */
+			block = &amp[sample];
+		} else {
+			memcpy(&s->td.dtmf.block[s->td.dtmf.current_sample], &amp[sample],
+				(limit - sample) * sizeof(*amp));
+			block = s->td.dtmf.block;
 		}
 		s->td.dtmf.current_sample += (limit - sample);
 		if (s->td.dtmf.current_sample < DTMF_GSIZE) {
 			continue;
 		}
 		/* We are at the end of a DTMF detection block */
-		/* Find the peak row and the peak column */
-		row_energy[0] = goertzel_result(&s->td.dtmf.row_out[0]);
-		col_energy[0] = goertzel_result(&s->td.dtmf.col_out[0]);
-
-		for (best_row = best_col = 0, i = 1; i < 4; i++) {
-			row_energy[i] = goertzel_result(&s->td.dtmf.row_out[i]);
-			if (row_energy[i] > row_energy[best_row]) {
-				best_row = i;
-			}
-			col_energy[i] = goertzel_result(&s->td.dtmf.col_out[i]);
-			if (col_energy[i] > col_energy[best_col]) {
-				best_col = i;
-			}
-		}
-		ast_debug(10, "DTMF best '%c' Erow=%.4E Ecol=%.4E Erc=%.4E Et=%.4E\n",
-			dtmf_positions[(best_row << 2) + best_col],
-			row_energy[best_row], col_energy[best_col],
-			row_energy[best_row] + col_energy[best_col], s->td.dtmf.energy);
-		hit = 0;
-		/* Basic signal level test and the twist test */
-		if (row_energy[best_row] >= DTMF_THRESHOLD &&
-		    col_energy[best_col] >= DTMF_THRESHOLD &&
-		    col_energy[best_col] < row_energy[best_row] * (relax ? relax_dtmf_reverse_twist : dtmf_reverse_twist) &&
-		    row_energy[best_row] < col_energy[best_col] * (relax ? relax_dtmf_normal_twist : dtmf_normal_twist)) {
-			/* Relative peak test */
-			for (i = 0; i < 4; i++) {
-				if ((i != best_col &&
-				    col_energy[i] * DTMF_RELATIVE_PEAK_COL > col_energy[best_col]) ||
-				    (i != best_row
-				     && row_energy[i] * DTMF_RELATIVE_PEAK_ROW > row_energy[best_row])) {
-					break;
-				}
-			}
-			/* ... and fraction of total energy test */
-			if (i >= 4 &&
-			    (row_energy[best_row] + col_energy[best_col]) > DTMF_TO_TOTAL_ENERGY * s->td.dtmf.energy) {
-				/* Got a hit */
-				hit = dtmf_positions[(best_row << 2) + best_col];
-				ast_debug(10, "DTMF hit '%c'\n", hit);
-			}
-		}
+		hit = dtmf_block_hit(&s->td.dtmf, block, relax);
 
 /*
  * Adapted from ETSI ES 201 235-3 V1.3.1 (2006-03)
@@ -877,18 +955,86 @@ static int dtmf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp
 	return (s->td.dtmf.current_hit);	/* return the debounced hit */
 }
 
-static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[],
-		int samples, int squelch, int relax)
+/*!
+ * \brief Look for an MF digit in a complete detection block
+ *
+ * \return The digit found, or 0 if there is none
+ */
+static int mf_block_hit(mf_detect_state_t *s, const int16_t *block)
 {
 	float energy[6];
 	int best;
 	int second_best;
 	int i;
+
+	/* As for DTMF, a block too quiet for two filters to reach the
+	 * threshold cannot hold a digit. */
+	if (s->energy * MF_GSIZE * 2 < BELL_MF_THRESHOLD) {
+		return 0;
+	}
+
+	goertzel_block(s->tone_out, 6, block, MF_GSIZE);
+
+	/* Find the two highest energies. The spec says to look for
+	   two tones and two tones only. Taking this literally -ie
+	   only two tones pass the minimum threshold - doesn't work
+	   well. The sinc function mess, due to rectangular windowing
+	   ensure that! Find the two highest energies and ensure they
+	   are considerably stronger than any of the others. */
+	energy[0] = goertzel_result(&s->tone_out[0]);
+	energy[1] = goertzel_result(&s->tone_out[1]);
+	if (energy[0] > energy[1]) {
+		best = 0;
+		second_best = 1;
+	} else {
+		best = 1;
+		second_best = 0;
+	}
+	/*endif*/
+	for (i = 2; i < 6; i++) {
+		energy[i] = goertzel_result(&s->tone_out[i]);
+		if (energy[i] >= energy[best]) {
+			second_best = best;
+			best = i;
+		} else if (energy[i] >= energy[second_best]) {
+			second_best = i;
+		}
+	}
+	/* Basic signal level and twist tests */
+	if (energy[best] < BELL_MF_THRESHOLD || energy[second_best] < BELL_MF_THRESHOLD
+	    || energy[best] >= energy[second_best]*BELL_MF_TWIST
+	    || energy[best] * BELL_MF_TWIST <= energy[second_best]) {
+		return 0;
+	}
+	/* Relative peak test */
+	for (i = 0; i < 6; i++) {
+		if (i != best && i != second_best) {
+			if (energy[i]*BELL_MF_RELATIVE_PEAK >= energy[second_best]) {
+				/* The best two are not clearly the best */
+				return 0;
+			}
+		}
+	}
+	/* Get the values into ascending order */
+	if (second_best < best) {
+		i = best;
+		best = second_best;
+		second_best = i;
+	}
+	best = best * 5 + second_best - 1;
+	return bell_mf_positions[best];
+}
+
+static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[],
+		int samples, int squelch, int relax)
+{
+	int i;
 	int j;
 	int sample;
 	short samp;
 	int hit;
 	int limit;
+	const int16_t *block;
 	fragment_t mute = {0, 0};
 
 	if (squelch && s->td.mf.mute_samples > 0) {
@@ -905,75 +1051,25 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		} else {
 			limit = samples;
 		}
-		/* The following unrolled loop takes only 35% (rough estimate) of the
-		   time of a rolled loop on the machine on which it was developed */
 		for (j = sample; j < limit; j++) {
-			/* With GCC 2.95, the following unrolled code seems to take about 35%
-			   (rough estimate) as long as a neat little 0-3 loop */
 			samp = amp[j];
-			goertzel_sample(s->td.mf.tone_out, samp);
-			goertzel_sample(s->td.mf.tone_out + 1, samp);
-			goertzel_sample(s->td.mf.tone_out + 2, samp);
-			goertzel_sample(s->td.mf.tone_out + 3, samp);
-			goertzel_sample(s->td.mf.tone_out + 4, samp);
-			goertzel_sample(s->td.mf.tone_out + 5, samp);
+			s->td.mf.energy += (int32_t) samp * (int32_t) samp;
+		}
+		if (!s->td.mf.current_sample && limit - sample == MF_GSIZE) {
+			/* The whole block is in this frame */
+			block = &amp[sample];
+		} else {
+			memcpy(&s->td.mf.block[s->td.mf.current_sample], &amp[sample],
+				(limit - sample) * sizeof(*amp));
+			block = s->td.mf.block;
 		}
 		s->td.mf.current_sample += (limit - sample);
 		if (s->td.mf.current_sample < MF_GSIZE) {
 			continue;
 		}
 		/* We're at the end of an MF detection block.  */
-		/* Find the two highest energies. The spec says to look for
-		   two tones and two tones only. Taking this literally -ie
-		   only two tones pass the minimum threshold - doesn't work
-		   well. The sinc function mess, due to rectangular windowing
-		   ensure that! Find the two highest energies and ensure they
-		   are considerably stronger than any of the others. */
-		energy[0] = goertzel_result(&s->td.mf.tone_out[0]);
-		energy[1] = goertzel_result(&s->td.mf.tone_out[1]);
-		if (energy[0] > energy[1]) {
-			best = 0;
-			second_best = 1;
-		} else {
-			best = 1;
-			second_best = 0;
-		}
-		/*endif*/
-		for (i = 2; i < 6; i++) {
-			energy[i] = goertzel_result(&s->td.mf.tone_out[i]);
-			if (energy[i] >= energy[best]) {
-				second_best = best;
-				best = i;
-			} else if (energy[i] >= energy[second_best]) {
-				second_best = i;
-			}
-		}
-		/* Basic signal level and twist tests */
-		hit = 0;
-		if (energy[best] >= BELL_MF_THRESHOLD && energy[second_best] >= BELL_MF_THRESHOLD
-		    && energy[best] < energy[second_best]*BELL_MF_TWIST
-		    && energy[best] * BELL_MF_TWIST > energy[second_best]) {
-			/* Relative peak test */
-			hit = -1;
-			for (i = 0; i < 6; i++) {
-				if (i != best && i != second_best) {
-					if (energy[i]*BELL_MF_RELATIVE_PEAK >= energy[second_best]) {
-						/* The best two are not clearly the best */
-						hit = 0;
-						break;
-					}
-				}
-			}
-		}
+		hit = mf_block_hit(&s->td.mf, block);
 		if (hit) {
-			/* Get the values into ascending order */
-			if (second_best < best) {
-				i = best;
-				best = second_best;
-				second_best = i;
-			}
-			best = best * 5 + second_best - 1;
-			hit = bell_mf_positions[best];
 			/* Look for two successive similar results */
 			/* The logic in the next test is:
 			   For KP we need 4 successive identical clean detects, with
@@ -1014,6 +1110,7 @@ static int mf_detect(struct ast_dsp *dsp, digit_detect_state_t *s, int16_t amp[]
 		for (i = 0; i < 6; i++) {
 			goertzel_reset(&s->td.mf.tone_out[i]);
 		}
+		s->td.mf.energy = 0.0;
 		s->td.mf.current_sample = 0;
 	}
 
@@ -1070,10 +1167,8 @@ static int __ast_dsp_call_progress(struct ast_dsp *dsp, short *s, int len)
 		for (x = 0; x < pass; x++) {
 			samp = s[x];
 			dsp->genergy += (int32_t) samp * (int32_t) samp;
-			for (y = 0; y < freqcount; y++) {
-				goertzel_sample(&dsp->freqs[y], samp);
-			}
 		}
+		goertzel_block(dsp->freqs, freqcount, s, pass);
 		s += pass;
 		dsp->gsamps += pass;
 		len -= pass;
@@ -1206,20 +1301,92 @@ int ast_dsp_call_progress(struct ast_dsp *dsp, struct ast_frame *inf)
 	return __ast_dsp_call_progress(dsp, inf->data.ptr, inf->datalen / 2);
 }
 
-static int __ast_dsp_silence_noise(struct ast_dsp *dsp, short *s, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+/*!
+ * \brief Average absolute value of signed linear samples
+ *
+ * Kept to a plain loop into a single accumulator with no branches, which
+ * the compiler vectorizes.
+ */
+static int dsp_energy_slin(const int16_t *s, int len)
+{
+	int accum = 0;
+	int x;
+
+	for (x = 0; x < len; x++) {
+		accum += abs(s[x]);
+	}
+
+	return accum / len;
+}
+
+/*! \brief Average absolute value of ulaw samples, without decoding them into a buffer first */
+static int dsp_energy_ulaw(const unsigned char *s, int len)
 {
-	int accum;
+	int accum = 0;
 	int x;
+
+	for (x = 0; x < len; x++) {
+		accum += abs(AST_MULAW(s[x]));
+	}
+
+	return accum / len;
+}
+
+/*! \brief Average absolute value of alaw samples, without decoding them into a buffer first */
+static int dsp_energy_alaw(const unsigned char *s, int len)
+{
+	int accum = 0;
+	int x;
+
+	for (x = 0; x < len; x++) {
+		accum += abs(AST_ALAW(s[x]));
+	}
+
+	return accum / len;
+}
+
+int ast_dsp_frame_energy(const struct ast_frame *f, int *energy, int *samples)
+{
+	int len;
+
+	if (!f || f->frametype != AST_FRAME_VOICE) {
+		return -1;
+	}
+
+	if (ast_format_cache_is_slinear(f->subclass.format)) {
+		len = f->datalen / 2;
+		if (len) {
+			*energy = dsp_energy_slin(f->data.ptr, len);
+		}
+	} else if (ast_format_cmp(f->subclass.format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
+		len = f->datalen;
+		if (len) {
+			*energy = dsp_energy_ulaw(f->data.ptr, len);
+		}
+	} else if (ast_format_cmp(f->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
+		len = f->datalen;
+		if (len) {
+			*energy = dsp_energy_alaw(f->data.ptr, len);
+		}
+	} else {
+		return -1;
+	}
+
+	if (!len) {
+		*energy = 0;
+	}
+	*samples = len;
+
+	return 0;
+}
+
+static int __ast_dsp_silence_noise(struct ast_dsp *dsp, int accum, int len, int *totalsilence, int *totalnoise, int *frames_energy)
+{
 	int res = 0;
 
 	if (!len) {
 		return 0;
 	}
-	accum = 0;
-	for (x = 0; x < len; x++) {
-		accum += abs(s[x]);
-	}
-	accum /= len;
 	if (accum < dsp->threshold) {
 		/* Silent */
 		dsp->totalsilence += len / (dsp->sample_rate / 1000);
@@ -1411,10 +1578,8 @@ int ast_dsp_busydetect(struct ast_dsp *dsp)
 
 static int ast_dsp_silence_noise_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *total, int *frames_energy, int noise)
 {
-	short *s;
+	int energy;
 	int len;
-	int x;
-	unsigned char *odata;
 
 	if (!f) {
 		return 0;
@@ -1425,35 +1590,23 @@ static int ast_dsp_silence_noise_with_energy(struct ast_dsp *dsp, struct ast_fra
 		return 0;
 	}
 
-	if (ast_format_cache_is_slinear(f->subclass.format)) {
-		s = f->data.ptr;
-		len = f->datalen/2;
-	} else {
-		odata = f->data.ptr;
-		len = f->datalen;
-		if (ast_format_cmp(f->subclass.format, ast_format_ulaw)) {
-			s = ast_alloca(len * 2);
-			for (x = 0; x < len; x++) {
-				s[x] = AST_MULAW(odata[x]);
-			}
-		} else if (ast_format_cmp(f->subclass.format, ast_format_alaw)) {
-			s = ast_alloca(len * 2);
-			for (x = 0; x < len; x++) {
-				s[x] = AST_ALAW(odata[x]);
-			}
-		} else {
-			ast_log(LOG_WARNING, "Can only calculate silence on signed-linear, alaw or ulaw frames :(\n");
-			return 0;
-		}
+	if (ast_dsp_frame_energy(f, &energy, &len)) {
+		ast_log(LOG_WARNING, "Can only calculate silence on signed-linear, alaw or ulaw frames :(\n");
+		return 0;
 	}
 
 	if (noise) {
-		return __ast_dsp_silence_noise(dsp, s, len, NULL, total, frames_energy);
+		return __ast_dsp_silence_noise(dsp, energy, len, NULL, total, frames_energy);
 	} else {
-		return __ast_dsp_silence_noise(dsp, s, len, total, NULL, frames_energy);
+		return __ast_dsp_silence_noise(dsp, energy, len, total, NULL, frames_energy);
 	}
 }
 
+int ast_dsp_silence_from_energy(struct ast_dsp *dsp, int energy, int samples, int *totalsilence)
+{
+	return __ast_dsp_silence_noise(dsp, energy, samples, totalsilence, NULL, NULL);
+}
+
 int ast_dsp_silence_with_energy(struct ast_dsp *dsp, struct ast_frame *f, int *totalsilence, int *frames_energy)
 {
 	return ast_dsp_silence_noise_with_energy(dsp, f, totalsilence, frames_energy, 0);
@@ -1487,6 +1640,10 @@ struct ast_frame *ast_dsp_process(struct ast_channel *chan, struct ast_dsp *dsp,
 	if (af->frametype != AST_FRAME_VOICE) {
 		return af;
 	}
+	/* Muting detected digits and re-encoding change the payload in place */
+	if (ast_frame_make_writable(af)) {
+		return af;
+	}
 
 	odata = af->data.ptr;
 	len = af->datalen;
@@ -1496,14 +1653,10 @@ struct ast_frame *ast_dsp_process(struct ast_channel *chan, struct ast_dsp *dsp,
 		len = af->datalen / 2;
 	} else if (ast_format_cmp(af->subclass.format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
 		shortdata = ast_alloca(af->datalen * 2);
-		for (x = 0; x < len; x++) {
-			shortdata[x] = AST_MULAW(odata[x]);
-		}
+		ast_ulaw_decode(shortdata, odata, len);
 	} else if (ast_format_cmp(af->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
 		shortdata = ast_alloca(af->datalen * 2);
-		for (x = 0; x < len; x++) {
-			shortdata[x] = AST_ALAW(odata[x]);
-		}
+		ast_alaw_decode(shortdata, odata, len);
 	} else {
 		/*Display warning only once. Otherwise you would get hundreds of warnings every second */
 		if (dsp->display_inband_dtmf_warning) {
@@ -1518,7 +1671,7 @@ struct ast_frame *ast_dsp_process(struct ast_channel *chan, struct ast_dsp *dsp,
 
 	/* Need to run the silence detection stuff for silence suppression and busy detection */
 	if ((dsp->features & DSP_FEATURE_SILENCE_SUPPRESS) || (dsp->features & DSP_FEATURE_BUSY_DETECT)) {
-		res = __ast_dsp_silence_noise(dsp, shortdata, len, &silence, NULL, NULL);
+		res = __ast_dsp_silence_noise(dsp, len ? dsp_energy_slin(shortdata, len) : 0, len, &silence, NULL, NULL);
 	}
 
 	if ((dsp->features & DSP_FEATURE_SILENCE_SUPPRESS) && silence) {
@@ -1640,13 +1793,9 @@ done:
 	}
 
 	if (ast_format_cmp(af->subclass.format, ast_format_ulaw) == AST_FORMAT_CMP_EQUAL) {
-		for (x = 0; x < len; x++) {
-			odata[x] = AST_LIN2MU((unsigned short) shortdata[x]);
-		}
+		ast_ulaw_encode(odata, shortdata, len);
 	} else if (ast_format_cmp(af->subclass.format, ast_format_alaw) == AST_FORMAT_CMP_EQUAL) {
-		for (x = 0; x < len; x++) {
-			odata[x] = AST_LIN2A((unsigned short) shortdata[x]);
-		}
+		ast_alaw_encode(odata, shortdata, len);
 	}
 
 	if (outf) {
@@ -1770,6 +1919,7 @@ void ast_dsp_digitreset(struct ast_dsp *dsp)
 		}
 		s->hits[4] = s->hits[3] = s->hits[2] = s->hits[1] = s->hits[0] = 0;
 		s->current_hit = 0;
+		s->energy = 0.0;
 		s->current_sample = 0;
 	} else {
 		dtmf_detect_state_t *s = &dsp->digit_state.td.dtmf;
@@ -70,8 +70,8 @@ struct ast_endpoint {
 	struct stasis_cp_single *topics;
 	/*! Router for handling this endpoint's messages */
 	struct stasis_message_router *router;
-	/*! ast_str_container of channels associated with this endpoint */
-	struct ao2_container *channel_ids;
+	/*! Channels associated with this endpoint */
+	struct ast_endpoint_channels *channels;
 	/*! Forwarding subscription from an endpoint to its tech endpoint */
 	struct stasis_forward *tech_forward;
 };
@@ -164,6 +164,105 @@ const char *ast_endpoint_state_to_string(enum ast_endpoint_state state)
 	return "?";
 }
 
+struct ast_endpoint_channels {
+	/*! ast_str_container of the channel ids, covered by this object's lock */
+	struct ao2_container *ids;
+	/*! The ids as last handed out, \c NULL once the channels changed */
+	struct ast_endpoint_channel_ids *shared;
+};
+
+static void endpoint_channels_dtor(void *obj)
+{
+	struct ast_endpoint_channels *channels = obj;
+
+	ao2_cleanup(channels->shared);
+	ao2_cleanup(channels->ids);
+}
+
+static struct ast_endpoint_channels *endpoint_channels_alloc(void)
+{
+	struct ast_endpoint_channels *channels;
+
+	channels = ao2_alloc(sizeof(*channels), endpoint_channels_dtor);
+	if (!channels) {
+		return NULL;
+	}
+
+	/* All access to ids is covered by the lock of channels; no extra lock needed. */
+	channels->ids = ast_str_container_alloc_options(
+		AO2_ALLOC_OPT_LOCK_NOLOCK, ENDPOINT_CHANNEL_BUCKETS);
+	if (!channels->ids) {
+		ao2_ref(channels, -1);
+		return NULL;
+	}
+
+	return channels;
+}
+
+/*!
+ * \internal
+ * \brief Add or remove a channel id, dropping the shared ids.
+ */
+static void endpoint_channels_update(struct ast_endpoint_channels *channels,
+	const char *uniqueid, int add)
+{
+	ao2_lock(channels);
+	if (add) {
+		ast_str_container_add(channels->ids, uniqueid);
+	} else {
+		ast_str_container_remove(channels->ids, uniqueid);
+	}
+	ao2_cleanup(channels->shared);
+	channels->shared = NULL;
+	ao2_unlock(channels);
+}
+
+static void endpoint_channel_ids_dtor(void *obj)
+{
+	struct ast_endpoint_channel_ids *ids = obj;
+	int channel;
+
+	for (channel = 0; channel < ids->num_channels; channel++) {
+		ao2_ref(ids->channel_ids[channel], -1);
+	}
+}
+
+struct ast_endpoint_channel_ids *ast_endpoint_snapshot_channel_ids(
+	const struct ast_endpoint_snapshot *snapshot)
+{
+	struct ast_endpoint_channels *channels = snapshot->channels;
+	struct ast_endpoint_channel_ids *ids;
+	struct ao2_iterator i;
+	void *obj;
+
+	ast_assert(channels != NULL);
+
+	ao2_lock(channels);
+	ids = channels->shared;
+	if (!ids) {
+		ids = ao2_alloc_options(sizeof(*ids)
+			+ ao2_container_count(channels->ids) * sizeof(char *),
+			endpoint_channel_ids_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!ids) {
+			ao2_unlock(channels);
+			return NULL;
+		}
+
+		i = ao2_iterator_init(channels->ids, 0);
+		while ((obj = ao2_iterator_next(&i))) {
+			/* The reference is kept so the channel id does not go away until the ids are gone */
+			ids->channel_ids[ids->num_channels++] = obj;
+		}
+		ao2_iterator_destroy(&i);
+
+		channels->shared = ids;
+	}
+	ao2_ref(ids, +1);
+	ao2_unlock(channels);
+
+	return ids;
+}
+
 static void endpoint_publish_snapshot(struct ast_endpoint *endpoint)
 {
 	RAII_VAR(struct ast_endpoint_snapshot *, snapshot, NULL, ao2_cleanup);
@@ -199,8 +298,8 @@ static void endpoint_dtor(void *obj)
 	stasis_cp_single_unsubscribe(endpoint->topics);
 	endpoint->topics = NULL;
 
-	ao2_cleanup(endpoint->channel_ids);
-	endpoint->channel_ids = NULL;
+	ao2_cleanup(endpoint->channels);
+	endpoint->channels = NULL;
 
 	ast_string_field_free_memory(endpoint);
 }
@@ -215,9 +314,7 @@ int ast_endpoint_add_channel(struct ast_endpoint *endpoint,
 
 	ast_channel_forward_endpoint(chan, endpoint);
 
-	ao2_lock(endpoint);
-	ast_str_container_add(endpoint->channel_ids, ast_channel_uniqueid(chan));
-	ao2_unlock(endpoint);
+	endpoint_channels_update(endpoint->channels, ast_channel_uniqueid(chan), 1);
 
 	endpoint_publish_snapshot(endpoint);
 
@@ -241,9 +338,7 @@ static void endpoint_cache_clear(void *data,
 
 	ast_assert(endpoint != NULL);
 
-	ao2_lock(endpoint);
-	ast_str_container_remove(endpoint->channel_ids, clear_snapshot->uniqueid);
-	ao2_unlock(endpoint);
+	endpoint_channels_update(endpoint->channels, clear_snapshot->uniqueid, 0);
 	endpoint_publish_snapshot(endpoint);
 }
 
@@ -293,11 +388,8 @@ static struct ast_endpoint *endpoint_internal_create(const char *tech, const cha
 		!ast_strlen_zero(resource) ? "/" : "",
 		S_OR(resource, ""));
 
-	/* All access to channel_ids should be covered by the endpoint's
-	 * lock; no extra lock needed. */
-	endpoint->channel_ids = ast_str_container_alloc_options(
-		AO2_ALLOC_OPT_LOCK_NOLOCK, ENDPOINT_CHANNEL_BUCKETS);
-	if (!endpoint->channel_ids) {
+	endpoint->channels = endpoint_channels_alloc();
+	if (!endpoint->channels) {
 		return NULL;
 	}
 
@@ -456,14 +548,10 @@ void ast_endpoint_set_max_channels(struct ast_endpoint *endpoint,
 static void endpoint_snapshot_dtor(void *obj)
 {
 	struct ast_endpoint_snapshot *snapshot = obj;
-	int channel;
 
 	ast_assert(snapshot != NULL);
 
-	for (channel = 0; channel < snapshot->num_channels; channel++) {
-		ao2_ref(snapshot->channel_ids[channel], -1);
-	}
-
+	ao2_cleanup(snapshot->channels);
 	ast_string_field_free_memory(snapshot);
 }
 
@@ -471,18 +559,12 @@ struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	struct ast_endpoint *endpoint)
 {
 	struct ast_endpoint_snapshot *snapshot;
-	int channel_count;
-	struct ao2_iterator i;
-	void *obj;
 	SCOPED_AO2LOCK(lock, endpoint);
 
 	ast_assert(endpoint != NULL);
 	ast_assert(!ast_strlen_zero(endpoint->resource));
 
-	channel_count = ao2_container_count(endpoint->channel_ids);
-
-	snapshot = ao2_alloc_options(
-		sizeof(*snapshot) + channel_count * sizeof(char *),
+	snapshot = ao2_alloc_options(sizeof(*snapshot),
 		endpoint_snapshot_dtor,
 		AO2_ALLOC_OPT_LOCK_NOLOCK);
 
@@ -499,12 +581,11 @@ struct ast_endpoint_snapshot *ast_endpoint_snapshot_create(
 	snapshot->state = endpoint->state;
 	snapshot->max_channels = endpoint->max_channels;
 
-	i = ao2_iterator_init(endpoint->channel_ids, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		/* The reference is kept so the channel id does not go away until the snapshot is gone */
-		snapshot->channel_ids[snapshot->num_channels++] = obj;
-	}
-	ao2_iterator_destroy(&i);
+	/* Only the count is copied, the ids are built when asked for. */
+	ao2_lock(endpoint->channels);
+	snapshot->num_channels = ao2_container_count(endpoint->channels->ids);
+	ao2_unlock(endpoint->channels);
+	snapshot->channels = ao2_bump(endpoint->channels);
 
 	return snapshot;
 }
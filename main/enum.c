@@ -71,7 +71,8 @@
 #include <regex.h>
 
 #include "asterisk/enum.h"
-#include "asterisk/dns.h"
+#include "asterisk/dns_core.h"
+#include "asterisk/dns_internal.h"
 #include "asterisk/channel.h"
 #include "asterisk/config.h"
 #include "asterisk/utils.h"
@@ -99,6 +100,60 @@ static int ebl_alg = ENUMLOOKUP_BLR_CC;
 
 AST_MUTEX_DEFINE_STATIC(enumlock);
 
+/*!
+ * \brief Look up records of a type and pass each to a callback
+ *
+ * Resolves through the DNS core, and so its cache and the configured
+ * resolver, instead of a resolver call of our own.  The callback gets the
+ * record within the whole answer, so names in it can be expanded.
+ *
+ * \retval -1 on lookup or callback failure
+ * \retval 0 on no records found
+ * \retval 1 on success
+ */
+static int enum_search_dns(void *context, const char *dname, int rr_type,
+	int (*callback)(void *context, unsigned char *answer, int len, unsigned char *fullanswer))
+{
+	struct ast_dns_result *result;
+	const struct ast_dns_record *record;
+	const char *answer;
+	size_t answer_size;
+	char *rdata;
+	int ret = 0;
+
+	if (ast_dns_resolve(dname, rr_type, C_IN, &result)) {
+		return -1;
+	}
+
+	answer = ast_dns_result_get_answer(result);
+	answer_size = result->answer_size;
+	for (record = ast_dns_result_get_records(result); record; record = ast_dns_record_get_next(record)) {
+		if (ast_dns_record_get_rr_type(record) != rr_type
+			|| ast_dns_record_get_rr_class(record) != C_IN) {
+			continue;
+		}
+		rdata = dns_find_record(ast_dns_record_get_data(record), ast_dns_record_get_data_size(record),
+			answer, answer_size);
+		if (!rdata) {
+			continue;
+		}
+		if (callback(context, (unsigned char *) rdata, ast_dns_record_get_data_size(record),
+			(unsigned char *) answer) < 0) {
+			ast_log(LOG_WARNING, "Failed to parse result\n");
+			ret = -1;
+			break;
+		}
+		ret = 1;
+	}
+	if (!ret) {
+		ast_debug(1, "No matches found in DNS for %s\n", dname);
+	}
+
+	ast_dns_result_free(result);
+
+	return ret;
+}
+
 /*! \brief Determine the length of a country code when given an E.164 string */
 /*
  * Input: E.164 number w/o leading +
@@ -227,7 +282,7 @@ static int blr_txt(const char *cc, const char *suffix)
 
 	ast_verb(4, "blr_txt() FQDN for TXT record: %s, cc was %s\n", domain, cc);
 
-	ret = ast_search_dns(&context, domain, C_IN, T_TXT, txt_callback);
+	ret = enum_search_dns(&context, domain, T_TXT, txt_callback);
 
 	if (ret > 0) {
 		ret = atoi(context.txt);
@@ -356,7 +411,7 @@ static int blr_ebl(const char *cc, const char *suffix, char *separator, int sep_
 
 	ast_verb(4, "blr_ebl() FQDN for EBL record: %s, cc was %s\n", domain, cc);
 
-	ret = ast_search_dns(&context, domain, C_IN, T_EBL, ebl_callback);
+	ret = enum_search_dns(&context, domain, T_EBL, ebl_callback);
 	if (ret > 0) {
 		ret = context.pos;
 
@@ -860,7 +915,7 @@ int ast_get_enum(struct ast_channel *chan, const char *number, char *dst, int ds
 
 	strncat(tmp,apex,spaceleft);
 	time_start = ast_tvnow();
-	ret = ast_search_dns(context, tmp, C_IN, T_NAPTR, enum_callback);
+	ret = enum_search_dns(context, tmp, T_NAPTR, enum_callback);
 	time_end = ast_tvnow();
 
 	ast_debug(2, "profiling: %s, %s, %" PRIi64 " ms\n",
@@ -30,6 +30,7 @@
 #include "asterisk.h"
 
 #include <dirent.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
 #include <math.h>
@@ -46,6 +47,7 @@
 #include "asterisk/app.h"
 #include "asterisk/pbx.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/module.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/test.h"
@@ -53,6 +55,9 @@
 #include "asterisk/json.h"
 #include "asterisk/stasis_system.h"
 #include "asterisk/media_cache.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/vector.h"
 
 /*! \brief
  * The following variable controls the layout of localized sound files.
@@ -68,6 +73,77 @@ int ast_language_is_prefix = 1;
 
 static AST_RWLIST_HEAD_STATIC(formats, ast_format_def);
 
+/*! \brief Threads that write recordings behind the channels recording them */
+static struct ast_threadpool *write_behind_pool;
+
+/*! \brief Frames of a recording waiting to be written by the write-behind pool */
+struct filestream_write_behind {
+	/*! Serializer the frames are written on, in order */
+	struct ast_taskprocessor *serializer;
+	ast_mutex_t lock;
+	/*! Signalled each time a frame has been written */
+	ast_cond_t cond;
+	/*! Frames queued and not yet written */
+	unsigned int pending;
+	/*! Non-zero once a write has failed */
+	int failed;
+};
+
+/*! \brief A frame queued to be written to a recording */
+struct write_behind_task {
+	struct ast_filestream *fs;
+	struct ast_frame *frame;
+};
+
+/*! \brief Files a stream plays after its first, see ast_streamfile_list() */
+struct filestream_sequence {
+	/*! Names of the files, found in the format of the stream */
+	AST_VECTOR(, char *) files;
+	/*! Index of the next file to play */
+	size_t next;
+};
+
+/*! \brief Seconds before a file in the prompt cache is checked on disk again */
+#define PROMPT_CACHE_RECHECK 10
+
+/*!
+ * \brief A sound file in the prompt cache
+ *
+ * Only files below the sounds directory are cached.  An entry records
+ * whether the file exists, and once the file has been played, its
+ * contents.  The contents never change; when a file changes on disk a
+ * new entry replaces the old one, which streams still playing from it
+ * keep alive.
+ */
+struct prompt_cache_entry {
+	/*! When the file was last checked on disk */
+	time_t checked;
+	/*! Modification time of the file */
+	time_t mtime;
+	/*! Size of the file, or -1 if it does not exist */
+	off_t size;
+	/*! Contents of the file, if they are loaded */
+	char *data;
+	/*! Bytes charged against the size of the cache */
+	size_t cost;
+	/*! Position in the least recently used order */
+	AST_DLLIST_ENTRY(prompt_cache_entry) lru;
+	/*! Full path of the file */
+	char path[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(prompt_cache_entry, path)
+AO2_STRING_FIELD_CMP_FN(prompt_cache_entry, path)
+
+/*! \brief Protects prompt_cache, prompt_cache_lru and prompt_cache_bytes */
+AST_MUTEX_DEFINE_STATIC(prompt_cache_lock);
+static struct ao2_container *prompt_cache;
+/*! \brief Cached entries, most recently used first */
+static AST_DLLIST_HEAD_NOLOCK_STATIC(prompt_cache_lru, prompt_cache_entry);
+static size_t prompt_cache_bytes;
+static int prompt_cache_hits;
+static int prompt_cache_misses;
+
 STASIS_MESSAGE_TYPE_DEFN(ast_format_register_type);
 STASIS_MESSAGE_TYPE_DEFN(ast_format_unregister_type);
 
@@ -206,6 +282,142 @@ int ast_stopstream(struct ast_channel *tmp)
 	return 0;
 }
 
+static int write_behind_task(void *data)
+{
+	struct write_behind_task *task = data;
+	struct filestream_write_behind *wb = task->fs->write_behind;
+	int res;
+
+	res = task->fs->fmt->write(task->fs, task->frame);
+	ast_frfree(task->frame);
+	ast_free(task);
+
+	ast_mutex_lock(&wb->lock);
+	if (res && !wb->failed) {
+		ast_log(LOG_WARNING, "Write behind failed, further writes to the stream fail\n");
+		wb->failed = 1;
+	}
+	--wb->pending;
+	ast_cond_broadcast(&wb->cond);
+	ast_mutex_unlock(&wb->lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for the frames queued to be written to a stream.
+ *
+ * Must be called before anything but writing touches the file of a stream
+ * writing behind.
+ */
+static void write_behind_drain(struct ast_filestream *fs)
+{
+	struct filestream_write_behind *wb = fs->write_behind;
+
+	if (!wb) {
+		return;
+	}
+
+	ast_mutex_lock(&wb->lock);
+	while (wb->pending) {
+		ast_cond_wait(&wb->cond, &wb->lock);
+	}
+	ast_mutex_unlock(&wb->lock);
+}
+
+/*!
+ * \internal
+ * \brief Write a frame to a stream, or queue it if the stream writes behind.
+ *
+ * The caller only waits when file_write_behind frames are already queued,
+ * which means the disk has fallen that far behind.
+ */
+static int filestream_write(struct ast_filestream *fs, struct ast_frame *f)
+{
+	struct filestream_write_behind *wb = fs->write_behind;
+	struct write_behind_task *task;
+
+	if (!wb) {
+		return fs->fmt->write(fs, f);
+	}
+
+	ast_mutex_lock(&wb->lock);
+	while (!wb->failed && wb->pending >= ast_option_file_write_behind) {
+		ast_cond_wait(&wb->cond, &wb->lock);
+	}
+	if (wb->failed) {
+		ast_mutex_unlock(&wb->lock);
+		return -1;
+	}
+	++wb->pending;
+	ast_mutex_unlock(&wb->lock);
+
+	task = ast_malloc(sizeof(*task));
+	if (task && (task->frame = ast_frdup(f))) {
+		task->fs = fs;
+		if (!ast_taskprocessor_push(wb->serializer, write_behind_task, task)) {
+			return 0;
+		}
+		ast_frfree(task->frame);
+	}
+	ast_free(task);
+
+	/* Could not queue it, so write it here once the queue is empty. */
+	ast_mutex_lock(&wb->lock);
+	--wb->pending;
+	ast_mutex_unlock(&wb->lock);
+	write_behind_drain(fs);
+	return fs->fmt->write(fs, f);
+}
+
+/*!
+ * \internal
+ * \brief Make a stream opened for writing write behind, if configured.
+ *
+ * A stream that can not be made to write behind writes in the caller.
+ */
+static void write_behind_enable(struct ast_filestream *fs)
+{
+	struct filestream_write_behind *wb;
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+	if (!write_behind_pool || !ast_option_file_write_behind) {
+		return;
+	}
+
+	wb = ast_calloc(1, sizeof(*wb));
+	if (!wb) {
+		return;
+	}
+
+	ast_taskprocessor_build_name(name, sizeof(name), "file-write");
+	wb->serializer = ast_threadpool_serializer(name, write_behind_pool);
+	if (!wb->serializer) {
+		ast_free(wb);
+		return;
+	}
+	ast_mutex_init(&wb->lock);
+	ast_cond_init(&wb->cond, NULL);
+	fs->write_behind = wb;
+}
+
+static void write_behind_destroy(struct ast_filestream *fs)
+{
+	struct filestream_write_behind *wb = fs->write_behind;
+
+	if (!wb) {
+		return;
+	}
+
+	write_behind_drain(fs);
+	ast_taskprocessor_unreference(wb->serializer);
+	ast_mutex_destroy(&wb->lock);
+	ast_cond_destroy(&wb->cond);
+	ast_free(wb);
+	fs->write_behind = NULL;
+}
+
 int ast_writestream(struct ast_filestream *fs, struct ast_frame *f)
 {
 	int res = -1;
@@ -227,7 +439,7 @@ int ast_writestream(struct ast_filestream *fs, struct ast_frame *f)
 		return -1;
 	}
 	if (ast_format_cmp(f->subclass.format, fs->fmt->format) != AST_FORMAT_CMP_NOT_EQUAL) {
-		res =  fs->fmt->write(fs, f);
+		res = filestream_write(fs, f);
 		if (res < 0)
 			ast_log(LOG_WARNING, "Natural write failed\n");
 		else if (res > 0)
@@ -254,7 +466,7 @@ int ast_writestream(struct ast_filestream *fs, struct ast_frame *f)
 
 				/* the translator may have returned multiple frames, so process them */
 				for (cur = trf; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
-					if ((res = fs->fmt->write(fs, trf))) {
+					if ((res = filestream_write(fs, trf))) {
 						ast_log(LOG_WARNING, "Translated frame write failed\n");
 						break;
 					}
@@ -331,6 +543,207 @@ static char *build_filename(const char *filename, const char *ext)
 	return fn;
 }
 
+/*!
+ * \internal
+ * \brief Create a prompt cache entry for a file, loading its contents if asked.
+ *
+ * \param path Full path of the file
+ * \param st Result of stat() on the file, or NULL if it does not exist
+ * \param load Non-zero to load the contents of the file
+ */
+static struct prompt_cache_entry *prompt_cache_entry_alloc(const char *path,
+	const struct stat *st, int load)
+{
+	struct prompt_cache_entry *entry;
+	size_t path_len = strlen(path) + 1;
+	size_t data_len = 0;
+	FILE *f;
+
+	/* Files too large to share the cache with others are never loaded */
+	if (!st || !S_ISREG(st->st_mode) || st->st_size <= 0
+		|| st->st_size > (off_t) ast_option_prompt_cache_size * 1024 / 4) {
+		load = 0;
+	}
+	if (load) {
+		data_len = st->st_size;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + path_len + data_len, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return NULL;
+	}
+	memcpy(entry->path, path, path_len);
+	entry->checked = time(NULL);
+	entry->size = st ? st->st_size : -1;
+	entry->mtime = st ? st->st_mtime : 0;
+
+	if (load) {
+		entry->data = entry->path + path_len;
+		f = fopen(path, "r");
+		if (!f || fread(entry->data, 1, data_len, f) != data_len) {
+			/* Remember that the file exists; it is opened from disk instead */
+			entry->data = NULL;
+			data_len = 0;
+		}
+		if (f) {
+			fclose(f);
+		}
+	}
+	entry->cost = sizeof(*entry) + path_len + data_len;
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Add an entry to the prompt cache, replacing any entry for the same
+ * file and evicting the least recently used entries over the size limit.
+ */
+static void prompt_cache_insert(struct prompt_cache_entry *entry)
+{
+	size_t limit = (size_t) ast_option_prompt_cache_size * 1024;
+	struct prompt_cache_entry *old;
+
+	ast_mutex_lock(&prompt_cache_lock);
+	old = ao2_find(prompt_cache, entry->path, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (old) {
+		AST_DLLIST_REMOVE(&prompt_cache_lru, old, lru);
+		prompt_cache_bytes -= old->cost;
+		ao2_ref(old, -1);
+	}
+
+	if (!ao2_link_flags(prompt_cache, entry, OBJ_NOLOCK)) {
+		ast_mutex_unlock(&prompt_cache_lock);
+		return;
+	}
+	AST_DLLIST_INSERT_HEAD(&prompt_cache_lru, entry, lru);
+	prompt_cache_bytes += entry->cost;
+
+	while (prompt_cache_bytes > limit && AST_DLLIST_LAST(&prompt_cache_lru) != entry) {
+		old = AST_DLLIST_REMOVE_TAIL(&prompt_cache_lru, lru);
+		prompt_cache_bytes -= old->cost;
+		ao2_unlink_flags(prompt_cache, old, OBJ_NOLOCK);
+	}
+	ast_mutex_unlock(&prompt_cache_lock);
+}
+
+/*!
+ * \internal
+ * \brief Get the prompt cache entry for a file, creating it if needed.
+ *
+ * An entry is checked on disk again if it has not been for
+ * PROMPT_CACHE_RECHECK seconds, and replaced if the file changed.
+ *
+ * \param path Full path of the file
+ * \param load Non-zero if the contents of the file are wanted
+ *
+ * \return The entry, with a reference the caller must release
+ * \retval NULL on allocation failure
+ */
+static struct prompt_cache_entry *prompt_cache_get(const char *path, int load)
+{
+	struct prompt_cache_entry *entry;
+	struct prompt_cache_entry *fresh;
+	time_t now = time(NULL);
+	struct stat st;
+	int exists = -1;
+
+	ast_mutex_lock(&prompt_cache_lock);
+	entry = ao2_find(prompt_cache, path, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry) {
+		AST_DLLIST_REMOVE(&prompt_cache_lru, entry, lru);
+		AST_DLLIST_INSERT_HEAD(&prompt_cache_lru, entry, lru);
+	}
+	ast_mutex_unlock(&prompt_cache_lock);
+
+	if (entry && now - entry->checked >= PROMPT_CACHE_RECHECK) {
+		exists = !stat(path, &st);
+		if (exists ? (st.st_size == entry->size && st.st_mtime == entry->mtime) : entry->size < 0) {
+			entry->checked = now;
+		} else {
+			ao2_ref(entry, -1);
+			entry = NULL;
+		}
+	}
+
+	if (entry && (!load || entry->data || entry->size <= 0
+		|| entry->size > (off_t) ast_option_prompt_cache_size * 1024 / 4)) {
+		ast_atomic_fetchadd_int(&prompt_cache_hits, 1);
+		return entry;
+	}
+	ast_atomic_fetchadd_int(&prompt_cache_misses, 1);
+
+	if (exists < 0) {
+		exists = !stat(path, &st);
+	}
+	fresh = prompt_cache_entry_alloc(path, exists ? &st : NULL, load);
+	if (!fresh) {
+		return entry;
+	}
+	ao2_cleanup(entry);
+	prompt_cache_insert(fresh);
+
+	return fresh;
+}
+
+/*!
+ * \internal
+ * \brief stat() a sound file, through the prompt cache for files below the
+ * sounds directory.
+ */
+static int prompt_cache_stat(const char *filename, const char *fn, struct stat *st)
+{
+	struct prompt_cache_entry *entry;
+
+	if (!ast_option_prompt_cache_size || filename[0] == '/'
+		|| !(entry = prompt_cache_get(fn, 0))) {
+		return stat(fn, st);
+	}
+
+	if (entry->size < 0) {
+		ao2_ref(entry, -1);
+		errno = ENOENT;
+		return -1;
+	}
+
+	memset(st, 0, sizeof(*st));
+	st->st_mode = S_IFREG;
+	st->st_size = entry->size;
+	st->st_mtime = entry->mtime;
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Open a sound file for reading, from memory if it is in the prompt cache.
+ *
+ * \param filename The file name as given, without extension
+ * \param fn The full path of the file
+ * \param[out] cached The prompt cache entry the stream reads from, which
+ * must be kept until the stream is closed
+ */
+static FILE *prompt_cache_open(const char *filename, const char *fn, struct prompt_cache_entry **cached)
+{
+#ifdef HAVE_FMEMOPEN
+	struct prompt_cache_entry *entry;
+	FILE *f;
+
+	if (ast_option_prompt_cache_size && filename[0] != '/'
+		&& (entry = prompt_cache_get(fn, 1))) {
+		if (entry->data && (f = fmemopen(entry->data, entry->size, "r"))) {
+			*cached = entry;
+			return f;
+		}
+		ao2_ref(entry, -1);
+	}
+#endif
+
+	return fopen(fn, "r");
+}
+
 /* compare type against the list 'exts' */
 /* XXX need a better algorithm */
 static int exts_compare(const char *exts, const char *type)
@@ -377,6 +790,17 @@ static void filestream_close(struct ast_filestream *f)
 	}
 }
 
+static void filestream_sequence_destroy(struct filestream_sequence *sequence)
+{
+	if (!sequence) {
+		return;
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&sequence->files, ast_free);
+	AST_VECTOR_FREE(&sequence->files);
+	ast_free(sequence);
+}
+
 static void filestream_destructor(void *arg)
 {
 	struct ast_filestream *f = arg;
@@ -386,6 +810,9 @@ static void filestream_destructor(void *arg)
 	/* Stop a running stream if there is one */
 	filestream_close(f);
 
+	/* Everything queued has to be in the file before the format closes it */
+	write_behind_destroy(f);
+
 	/* destroy the translator on exit */
 	if (f->trans)
 		ast_translator_free_path(f->trans);
@@ -395,9 +822,14 @@ static void filestream_destructor(void *arg)
 		closefn(f);
 	}
 
+	if (f->map) {
+		munmap((void *) f->map, f->map_len);
+	}
 	if (f->f) {
 		fclose(f->f);
 	}
+	ao2_cleanup(f->cached_prompt);
+	filestream_sequence_destroy(f->sequence);
 
 	if (f->realfilename && f->filename) {
 		pid = ast_safe_fork(0);
@@ -450,6 +882,80 @@ static struct ast_filestream *get_filestream(struct ast_format_def *fmt, FILE *b
 	return s;
 }
 
+/*!
+ * \internal
+ * \brief Map the file of a stream opened for reading into memory, if its
+ * format reads mapped files.
+ *
+ * Streams which cannot be mapped, such as those reading from pipes or from
+ * the prompt cache, are left reading through stdio.
+ */
+static void filestream_map(struct ast_filestream *s)
+{
+	struct stat st;
+	void *map;
+	off_t pos;
+	int fd;
+
+	if (!ast_opt_mmap_sound_files || !s->fmt->mmap_read || !s->f || (fd = fileno(s->f)) < 0
+		|| fstat(fd, &st) || !S_ISREG(st.st_mode) || st.st_size <= 0
+		|| (pos = ftello(s->f)) < 0) {
+		return;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		return;
+	}
+#ifdef MADV_SEQUENTIAL
+	/* Let the kernel read ahead aggressively and drop pages behind us */
+	madvise(map, st.st_size, MADV_SEQUENTIAL);
+#endif
+
+	s->map = map;
+	s->map_len = st.st_size;
+	s->map_pos = MIN(pos, st.st_size);
+}
+
+const void *ast_filestream_mapped_read(struct ast_filestream *s, size_t *len)
+{
+	const char *data;
+	struct stat st;
+
+	if (s->map_pos + *len > s->map_len && !fstat(fileno(s->f), &st)
+		&& st.st_size > s->map_len) {
+		/* The file grew since it was mapped; map all of it */
+		void *map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fileno(s->f), 0);
+
+		if (map != MAP_FAILED) {
+			munmap((void *) s->map, s->map_len);
+			s->map = map;
+			s->map_len = st.st_size;
+		}
+	}
+
+	*len = MIN(*len, s->map_len - s->map_pos);
+	data = s->map + s->map_pos;
+	s->map_pos += *len;
+
+	return data;
+}
+
+int ast_filestream_mapped_seek(struct ast_filestream *s, off_t offset)
+{
+	s->map_pos = MIN(MAX(offset, 0), s->map_len);
+#ifdef MADV_WILLNEED
+	if (s->map_pos < s->map_len) {
+		/* Start reading ahead from the new position, from a page boundary */
+		size_t page = sysconf(_SC_PAGESIZE);
+		size_t start = s->map_pos - s->map_pos % page;
+
+		madvise((char *) s->map + start, s->map_len - start, MADV_WILLNEED);
+	}
+#endif
+	return 0;
+}
+
 /*
  * Default implementations of open and rewrite.
  * Only use them if you don't have expensive stuff to do.
@@ -523,11 +1029,17 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 		while ( (ext = strsep(&stringp, "|")) ) {
 			struct stat st;
 			char *fn = build_filename(filename, ext);
+			int missing;
 
 			if (fn == NULL)
 				continue;
 
-			if ( stat(fn, &st) ) { /* file not existent */
+			if (action == ACTION_EXISTS || action == ACTION_OPEN) {
+				missing = prompt_cache_stat(filename, fn, &st);
+			} else {
+				missing = stat(fn, &st);
+			}
+			if (missing) { /* file not existent */
 				ast_free(fn);
 				continue;
 			}
@@ -536,6 +1048,7 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 			 */
 			if (action == ACTION_OPEN) {
 				struct ast_channel *chan = (struct ast_channel *)arg2;
+				struct prompt_cache_entry *cached = NULL;
 				FILE *bfile;
 				struct ast_filestream *s;
 
@@ -545,16 +1058,18 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 					ast_free(fn);
 					continue;	/* not a supported format */
 				}
-				if ( (bfile = fopen(fn, "r")) == NULL) {
+				if ( (bfile = prompt_cache_open(filename, fn, &cached)) == NULL) {
 					ast_free(fn);
 					continue;	/* cannot open file */
 				}
 				s = get_filestream(f, bfile);
 				if (!s) {
 					fclose(bfile);
+					ao2_cleanup(cached);
 					ast_free(fn);	/* cannot allocate descriptor */
 					continue;
 				}
+				s->cached_prompt = cached;
 				if (open_wrapper(s)) {
 					ast_free(fn);
 					ast_closestream(s);
@@ -563,6 +1078,7 @@ static int filehelper(const char *filename, const void *arg2, const char *fmt, c
 				if (st.st_size == 0) {
 					ast_log(LOG_WARNING, "File %s detected to have zero size.\n", fn);
 				}
+				filestream_map(s);
 				/* ok this is good for OPEN */
 				res = 1;	/* found */
 				s->lasttimeout = -1;
@@ -854,6 +1370,83 @@ struct ast_filestream *ast_openvstream(struct ast_channel *chan, const char *fil
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief Make a stream read another file in its format from the start.
+ *
+ * The format is closed on the old file and opened on the new one, so the
+ * stream itself, and whatever plays it, carries on.
+ */
+static int filestream_reopen(struct ast_filestream *s, const char *filename)
+{
+	struct prompt_cache_entry *cached = NULL;
+	char *stringp = ast_strdupa(s->fmt->exts);
+	FILE *bfile = NULL;
+	struct stat st;
+	char *ext;
+	char *fn;
+
+	while (!bfile && (ext = strsep(&stringp, "|"))) {
+		if (!(fn = build_filename(filename, ext))) {
+			continue;
+		}
+		if (!prompt_cache_stat(filename, fn, &st)) {
+			bfile = prompt_cache_open(filename, fn, &cached);
+		}
+		ast_free(fn);
+	}
+	if (!bfile) {
+		return -1;
+	}
+
+	if (s->fmt->close) {
+		s->fmt->close(s);
+	}
+	if (s->map) {
+		munmap((void *) s->map, s->map_len);
+		s->map = NULL;
+		s->map_len = 0;
+		s->map_pos = 0;
+	}
+	fclose(s->f);
+	ao2_cleanup(s->cached_prompt);
+	s->f = bfile;
+	s->cached_prompt = cached;
+	if (s->fmt->desc_size) {
+		memset(s->_private, 0, s->fmt->desc_size);
+	}
+
+	if (open_wrapper(s)) {
+		return -1;
+	}
+	filestream_map(s);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Move a stream playing a list on to the next file of the list.
+ *
+ * \retval 0 if the stream reads the next file.
+ * \retval -1 if the list is done.
+ */
+static int filestream_sequence_next(struct ast_filestream *s)
+{
+	struct filestream_sequence *sequence = s->sequence;
+	const char *filename;
+
+	while (sequence && sequence->next < AST_VECTOR_SIZE(&sequence->files)) {
+		filename = AST_VECTOR_GET(&sequence->files, sequence->next++);
+		if (!filestream_reopen(s, filename)) {
+			return 0;
+		}
+		ast_log(LOG_WARNING, "Unable to open %s, skipping it\n", filename);
+	}
+
+	return -1;
+}
+
 static struct ast_frame *read_frame(struct ast_filestream *s, int *whennext)
 {
 	struct ast_frame *fr, *new_fr;
@@ -906,6 +1499,10 @@ static enum fsread_res ast_readaudio_callback(struct ast_filestream *s)
 		}
 
 		fr = read_frame(s, &whennext);
+		/* Go on to the next file of a list played as one stream */
+		while (!fr && !filestream_sequence_next(s)) {
+			fr = read_frame(s, &whennext);
+		}
 
 		if (!fr /* stream complete */ || ast_write(s->owner, fr) /* error writing */) {
 			if (fr) {
@@ -1020,16 +1617,19 @@ int ast_playstream(struct ast_filestream *s)
 
 int ast_seekstream(struct ast_filestream *fs, off_t sample_offset, int whence)
 {
+	write_behind_drain(fs);
 	return fs->fmt->seek(fs, sample_offset, whence);
 }
 
 int ast_truncstream(struct ast_filestream *fs)
 {
+	write_behind_drain(fs);
 	return fs->fmt->trunc(fs);
 }
 
 off_t ast_tellstream(struct ast_filestream *fs)
 {
+	write_behind_drain(fs);
 	return fs->fmt->tell(fs);
 }
 
@@ -1289,6 +1889,80 @@ int ast_streamfile(struct ast_channel *chan, const char *filename, const char *p
 	return res;
 }
 
+int ast_streamfile_list(struct ast_channel *chan, const char *files, const char *preflang)
+{
+	struct filestream_sequence *sequence;
+	struct ast_filestream *fs;
+	char *list = ast_strdupa(files);
+	char *first;
+	char *file;
+	char *exts;
+	char *ext;
+	char *buf;
+	int buflen;
+	int res;
+
+	if (preflang == NULL) {
+		preflang = "";
+	}
+
+	first = strsep(&list, "&");
+	if (ast_strlen_zero(first)) {
+		return -1;
+	}
+	if (!list) {
+		return ast_streamfile(chan, first, preflang);
+	}
+
+	if (!(sequence = ast_calloc(1, sizeof(*sequence)))) {
+		return -1;
+	}
+	if (AST_VECTOR_INIT(&sequence->files, 8)) {
+		ast_free(sequence);
+		return -1;
+	}
+
+	if (!(fs = ast_openstream(chan, first, preflang))) {
+		filestream_sequence_destroy(sequence);
+		return -1;
+	}
+
+	/* Every other file has to be there in the format the first is played in */
+	exts = ast_strdupa(fs->fmt->exts);
+	ext = strsep(&exts, "|");
+	while ((file = strsep(&list, "&"))) {
+		if (ast_strlen_zero(file)) {
+			continue;
+		}
+		buflen = strlen(preflang) + strlen(file) + 4;
+		buf = ast_malloc(buflen);
+		if (!buf || !fileexists_core(file, ext, preflang, buf, buflen, NULL)
+			|| AST_VECTOR_APPEND(&sequence->files, buf)) {
+			ast_debug(1, "Unable to play %s after %s in format %s\n", file, first, fs->fmt->name);
+			ast_free(buf);
+			filestream_sequence_destroy(sequence);
+			ast_stopstream(chan);
+			return -1;
+		}
+	}
+	fs->sequence = sequence;
+
+	if (ast_test_flag(ast_channel_flags(chan), AST_FLAG_MASQ_NOSTREAM))
+		fs->orig_chan_name = ast_strdup(ast_channel_name(chan));
+	if (ast_applystream(chan, fs))
+		return -1;
+	ast_test_suite_event_notify("PLAYBACK", "Message: %s\r\nChannel: %s", files, ast_channel_name(chan));
+	res = ast_playstream(fs);
+
+	if (VERBOSITY_ATLEAST(3)) {
+		ast_channel_lock(chan);
+		ast_verb(3, "<%s> Playing '%s' as one stream in %s (language '%s')\n", ast_channel_name(chan), files, ast_format_get_name(ast_channel_writeformat(chan)), preflang);
+		ast_channel_unlock(chan);
+	}
+
+	return res;
+}
+
 struct ast_filestream *ast_readfile(const char *filename, const char *type, const char *comment, int flags, int check, mode_t mode)
 {
 	FILE *bfile;
@@ -1324,6 +1998,16 @@ struct ast_filestream *ast_readfile(const char *filename, const char *type, cons
 			break;
 		}
 		/* found it */
+		filestream_map(fs);
+#ifdef POSIX_FADV_WILLNEED
+		if (!fs->map) {
+			/* Playback reads the file front to back, so have the kernel read ahead */
+			int fd = fileno(fs->f);
+
+			posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+			posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+		}
+#endif
 		fs->trans = NULL;
 		fs->fmt = f;
 		fs->flags = flags;
@@ -1461,6 +2145,7 @@ struct ast_filestream *ast_writefile(const char *filename, const char *type, con
 			fs->vfs = NULL;
 			/* If truncated, we'll be at the beginning; if not truncated, then append */
 			f->seek(fs, 0, SEEK_END);
+			write_behind_enable(fs);
 		} else if (errno != EEXIST) {
 			ast_log(LOG_WARNING, "Unable to open file %s: %s\n", fn, strerror(errno));
 			if (orig_fn)
@@ -1920,19 +2605,96 @@ struct ast_format *ast_get_format_for_file_ext(const char *file_ext)
 	return NULL;
 }
 
+static char *handle_cli_core_show_prompt_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int entries;
+	int loaded = 0;
+	size_t bytes;
+	struct prompt_cache_entry *entry;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show prompt cache";
+		e->usage =
+			"Usage: core show prompt cache\n"
+			"       Displays the use of the cache of sound files kept in memory.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4)
+		return CLI_SHOWUSAGE;
+
+	ast_mutex_lock(&prompt_cache_lock);
+	entries = ao2_container_count(prompt_cache);
+	bytes = prompt_cache_bytes;
+	AST_DLLIST_TRAVERSE(&prompt_cache_lru, entry, lru) {
+		if (entry->data) {
+			loaded++;
+		}
+	}
+	ast_mutex_unlock(&prompt_cache_lock);
+
+	ast_cli(a->fd, "Size limit:    %u KB%s\n", ast_option_prompt_cache_size,
+		ast_option_prompt_cache_size ? "" : " (disabled)");
+	ast_cli(a->fd, "Size used:     %zu KB\n", bytes / 1024);
+	ast_cli(a->fd, "Files known:   %d\n", entries);
+	ast_cli(a->fd, "Files loaded:  %d\n", loaded);
+	ast_cli(a->fd, "Hits:          %d\n", prompt_cache_hits);
+	ast_cli(a->fd, "Misses:        %d\n", prompt_cache_misses);
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_file[] = {
-	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats")
+	AST_CLI_DEFINE(handle_cli_core_show_file_formats, "Displays file formats"),
+	AST_CLI_DEFINE(handle_cli_core_show_prompt_cache, "Displays the use of the prompt cache"),
 };
 
 static void file_shutdown(void)
 {
+	struct prompt_cache_entry *entry;
+
 	ast_cli_unregister_multiple(cli_file, ARRAY_LEN(cli_file));
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_CLEANUP(ast_format_unregister_type);
+
+	ast_mutex_lock(&prompt_cache_lock);
+	while ((entry = AST_DLLIST_REMOVE_HEAD(&prompt_cache_lru, lru))) {
+		ao2_unlink_flags(prompt_cache, entry, OBJ_NOLOCK);
+	}
+	prompt_cache_bytes = 0;
+	ast_mutex_unlock(&prompt_cache_lock);
+	ao2_cleanup(prompt_cache);
+	prompt_cache = NULL;
+
+	ast_threadpool_shutdown(write_behind_pool);
+	write_behind_pool = NULL;
 }
 
 int ast_file_init(void)
 {
+	prompt_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 127,
+		prompt_cache_entry_hash_fn, NULL, prompt_cache_entry_cmp_fn);
+	if (!prompt_cache) {
+		return -1;
+	}
+
+	if (ast_option_file_write_behind) {
+		struct ast_threadpool_options options = {
+			.version = AST_THREADPOOL_OPTIONS_VERSION,
+			.idle_timeout = 60,
+			.auto_increment = 1,
+			.initial_size = 0,
+			.max_size = 16,
+		};
+
+		write_behind_pool = ast_threadpool_create("file-write", NULL, &options);
+		if (!write_behind_pool) {
+			ast_log(LOG_WARNING, "Unable to create the write behind threads, recordings are written by the channels\n");
+		}
+	}
+
 	STASIS_MESSAGE_TYPE_INIT(ast_format_register_type);
 	STASIS_MESSAGE_TYPE_INIT(ast_format_unregister_type);
 	ast_cli_register_multiple(cli_file, ARRAY_LEN(cli_file));
@@ -50,12 +50,33 @@ struct format_cap_framed {
 	AST_LIST_ENTRY(format_cap_framed) entry;
 };
 
+/*! \brief Number of codec identifiers tracked in the codec bitset of a capabilities structure */
+#define FORMAT_CAP_CODEC_BITS 256
+
+/*! \brief Number of bits in each word of the codec bitset */
+#define FORMAT_CAP_WORD_BITS 64
+
+/*! \brief Number of words in the codec bitset */
+#define FORMAT_CAP_CODEC_WORDS (FORMAT_CAP_CODEC_BITS / FORMAT_CAP_WORD_BITS)
+
 /*! \brief Format capabilities structure, holds formats + preference order + etc */
 struct ast_format_cap {
 	/*! \brief Vector of formats, indexed using the codec identifier */
 	AST_VECTOR(, struct format_cap_framed_list) formats;
 	/*! \brief Vector of formats, added in preference order */
 	AST_VECTOR(, struct format_cap_framed *) preference_order;
+	/*!
+	 * \brief Codec identifiers which have formats present
+	 *
+	 * Mirrors which lists of formats are not empty, so that membership and
+	 * intersection of codecs are word operations.  The preference order
+	 * vector remains the only source of order.
+	 */
+	uint64_t codecs[FORMAT_CAP_CODEC_WORDS];
+	/*! \brief Non-zero if a codec identifier beyond the bitset was ever added */
+	unsigned int codecs_overflow;
+	/*! \brief Number of formats present of each media type */
+	unsigned int type_count[AST_MEDIA_TYPE_TEXT + 1];
 	/*! \brief Global framing size, applies to all formats if no framing present on format */
 	unsigned int framing;
 };
@@ -66,6 +87,75 @@ AST_LIST_HEAD_NOLOCK(format_cap_framed_list, format_cap_framed);
 /*! \brief Dummy empty list for when we are inserting a new list */
 static const struct format_cap_framed_list format_cap_framed_list_empty = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
 
+/*! \internal \brief Mark a codec identifier as present in the codec bitset */
+static void format_cap_codec_set(struct ast_format_cap *cap, unsigned int id)
+{
+	if (id >= FORMAT_CAP_CODEC_BITS) {
+		cap->codecs_overflow = 1;
+		return;
+	}
+	cap->codecs[id / FORMAT_CAP_WORD_BITS] |= (uint64_t) 1 << (id % FORMAT_CAP_WORD_BITS);
+}
+
+/*! \internal \brief Update the codec bitset after formats of a codec identifier were removed */
+static void format_cap_codec_update(struct ast_format_cap *cap, unsigned int id,
+	const struct format_cap_framed_list *list)
+{
+	if (id < FORMAT_CAP_CODEC_BITS && AST_LIST_EMPTY(list)) {
+		cap->codecs[id / FORMAT_CAP_WORD_BITS] &= ~((uint64_t) 1 << (id % FORMAT_CAP_WORD_BITS));
+	}
+}
+
+/*!
+ * \internal
+ * \brief Determine if the codec bitset of \c cap has the codec identifier
+ *
+ * \retval 1 formats of the codec are present
+ * \retval 0 formats of the codec are not present
+ * \retval -1 the identifier is beyond the bitset
+ */
+static int format_cap_codec_test(const struct ast_format_cap *cap, unsigned int id)
+{
+	if (id >= FORMAT_CAP_CODEC_BITS) {
+		return -1;
+	}
+	return (cap->codecs[id / FORMAT_CAP_WORD_BITS] >> (id % FORMAT_CAP_WORD_BITS)) & 1;
+}
+
+/*!
+ * \internal
+ * \brief Determine if two capabilities structures have no codec in common
+ *
+ * \retval 1 there is no codec in common
+ * \retval 0 there may be a codec in common
+ */
+static int format_cap_codecs_disjoint(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2)
+{
+	int word;
+
+	if (cap1->codecs_overflow || cap2->codecs_overflow) {
+		return 0;
+	}
+
+	for (word = 0; word < FORMAT_CAP_CODEC_WORDS; ++word) {
+		if (cap1->codecs[word] & cap2->codecs[word]) {
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/*! \internal \brief Adjust the number of formats of the media type of \c format */
+static void format_cap_type_count(struct ast_format_cap *cap, const struct ast_format *format, int delta)
+{
+	enum ast_media_type type = ast_format_get_type(format);
+
+	if (type <= AST_MEDIA_TYPE_TEXT) {
+		cap->type_count[type] += delta;
+	}
+}
+
 /*! \brief Destructor for format capabilities structure */
 static void format_cap_destroy(void *obj)
 {
@@ -163,9 +253,11 @@ static inline int format_cap_framed_init(struct format_cap_framed *framed, struc
 	/* Order doesn't matter for formats, so insert at the head for performance reasons */
 	ao2_ref(framed, +1);
 	AST_LIST_INSERT_HEAD(list, framed, entry);
+	format_cap_codec_set(cap, ast_format_get_codec_id(format));
 
 	/* This takes the allocation reference */
 	AST_VECTOR_APPEND(&cap->preference_order, framed);
+	format_cap_type_count(cap, format, +1);
 
 	cap->framing = MIN(cap->framing, framing ? framing : ast_format_get_default_ms(format));
 
@@ -177,6 +269,11 @@ static int format_in_format_cap(struct ast_format_cap *cap, struct ast_format *f
 {
 	struct format_cap_framed *framed;
 	int i;
+	int present = format_cap_codec_test(cap, ast_format_get_codec_id(format));
+
+	if (present >= 0) {
+		return present;
+	}
 
 	for (i = 0; i < AST_VECTOR_SIZE(&cap->preference_order); i++) {
 		framed = AST_VECTOR_GET(&cap->preference_order, i);
@@ -286,6 +383,10 @@ static int format_cap_replace(struct ast_format_cap *cap, struct ast_format *for
 
 	ast_assert(format != NULL);
 
+	if (!format_cap_codec_test(cap, ast_format_get_codec_id(format))) {
+		return -1;
+	}
+
 	for (i = 0; i < AST_VECTOR_SIZE(&cap->preference_order); i++) {
 		framed = AST_VECTOR_GET(&cap->preference_order, i);
 
@@ -513,9 +614,15 @@ int ast_format_cap_remove(struct ast_format_cap *cap, struct ast_format *format)
 		break;
 	}
 	AST_LIST_TRAVERSE_SAFE_END;
+	format_cap_codec_update(cap, ast_format_get_codec_id(format), list);
 
-	return AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, format,
-		FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP);
+	if (AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, format,
+		FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP)) {
+		return -1;
+	}
+	format_cap_type_count(cap, format, -1);
+
+	return 0;
 }
 
 void ast_format_cap_remove_by_type(struct ast_format_cap *cap, enum ast_media_type type)
@@ -533,11 +640,14 @@ void ast_format_cap_remove_by_type(struct ast_format_cap *cap, enum ast_media_ty
 			}
 
 			AST_LIST_REMOVE_CURRENT(entry);
-			AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, framed->format,
-				FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP);
+			if (!AST_VECTOR_REMOVE_CMP_ORDERED(&cap->preference_order, framed->format,
+				FORMAT_CAP_FRAMED_ELEM_CMP, FORMAT_CAP_FRAMED_ELEM_CLEANUP)) {
+				format_cap_type_count(cap, framed->format, -1);
+			}
 			ao2_ref(framed, -1);
 		}
 		AST_LIST_TRAVERSE_SAFE_END;
+		format_cap_codec_update(cap, idx, list);
 	}
 }
 
@@ -610,17 +720,7 @@ enum ast_format_cmp_res ast_format_cap_iscompatible_format(const struct ast_form
 
 int ast_format_cap_has_type(const struct ast_format_cap *cap, enum ast_media_type type)
 {
-	int idx;
-
-	for (idx = 0; idx < AST_VECTOR_SIZE(&cap->preference_order); ++idx) {
-		struct format_cap_framed *framed = AST_VECTOR_GET(&cap->preference_order, idx);
-
-		if (ast_format_get_type(framed->format) == type) {
-			return 1;
-		}
-	}
-
-	return 0;
+	return type <= AST_MEDIA_TYPE_TEXT && cap->type_count[type] ? 1 : 0;
 }
 
 int ast_format_cap_get_compatible(const struct ast_format_cap *cap1, const struct ast_format_cap *cap2,
@@ -628,10 +728,18 @@ int ast_format_cap_get_compatible(const struct ast_format_cap *cap1, const struc
 {
 	int idx, res = 0;
 
+	if (format_cap_codecs_disjoint(cap1, cap2)) {
+		return 0;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 		struct ast_format *format;
 
+		if (!format_cap_codec_test(cap2, ast_format_get_codec_id(framed->format))) {
+			continue;
+		}
+
 		format = ast_format_cap_get_compatible_format(cap2, framed->format);
 		if (!format) {
 			continue;
@@ -652,9 +760,17 @@ int ast_format_cap_iscompatible(const struct ast_format_cap *cap1, const struct
 {
 	int idx;
 
+	if (format_cap_codecs_disjoint(cap1, cap2)) {
+		return 0;
+	}
+
 	for (idx = 0; idx < AST_VECTOR_SIZE(&cap1->preference_order); ++idx) {
 		struct format_cap_framed *framed = AST_VECTOR_GET(&cap1->preference_order, idx);
 
+		if (!format_cap_codec_test(cap2, ast_format_get_codec_id(framed->format))) {
+			continue;
+		}
+
 		if (ast_format_cap_iscompatible_format(cap2, framed->format) != AST_FORMAT_CMP_NOT_EQUAL) {
 			return 1;
 		}
@@ -688,6 +804,11 @@ int ast_format_cap_identical(const struct ast_format_cap *cap1, const struct ast
 		return 0; /* if they are not the same size, they are not identical */
 	}
 
+	if (!cap1->codecs_overflow && !cap2->codecs_overflow
+		&& memcmp(cap1->codecs, cap2->codecs, sizeof(cap1->codecs))) {
+		return 0; /* if they do not have the same codecs, they are not identical */
+	}
+
 	if (!internal_format_cap_identical(cap1, cap2)) {
 		return 0;
 	}
@@ -44,103 +44,364 @@
 #include "asterisk/file.h"
 
 #if !defined(LOW_MEMORY)
-static void frame_cache_cleanup(void *data);
+static void frame_slab_cleanup(void *data);
 
-/*! \brief A per-thread cache of frame headers */
-AST_THREADSTORAGE_CUSTOM(frame_cache, NULL, frame_cache_cleanup);
+/*! \brief The frame slab pool of each thread */
+AST_THREADSTORAGE_CUSTOM(frame_slab, NULL, frame_slab_cleanup);
+
+/*! \brief Number of frame slab size classes */
+#define FRAME_SLAB_CLASSES 5
 
 /*!
- * \brief Maximum ast_frame cache size
+ * \brief Maximum number of free blocks a pool keeps per size class
  *
- * In most cases where the frame header cache will be useful, the size
- * of the cache will stay very small.  However, it is not always the case that
- * the same thread that allocates the frame will be the one freeing them, so
- * sometimes a thread will never have any frames in its cache, or the cache
- * will never be pulled from.  For the latter case, we limit the maximum size.
+ * It is not always the case that the thread allocating a frame will be
+ * the one freeing it.  Freed blocks are returned to the pool of the
+ * thread that allocated them, so the pools of threads which mostly
+ * allocate still get their blocks back.  Each pool also limits how
+ * many blocks it holds on to so idle threads do not hoard memory.
  */
-#define FRAME_CACHE_MAX_SIZE	10
+#define FRAME_SLAB_MAX_FREE	16
 
-/*! \brief This is just so ast_frames, a list head struct for holding a list of
- *  ast_frame structures, is defined. */
-AST_LIST_HEAD_NOLOCK(ast_frames, ast_frame);
+/*! \brief Room reserved in each block for the frame's src string */
+#define FRAME_SLAB_SRC_LEN	32
 
-struct ast_frame_cache {
-	struct ast_frames list;
-	size_t size;
+/*!
+ * \brief Payload size of each slab size class
+ *
+ * Header only, 20ms of ulaw or alaw, 20ms of 8kHz slin, 20ms of 16kHz
+ * slin, and 20ms of 48kHz slin.
+ */
+static const size_t frame_slab_payloads[FRAME_SLAB_CLASSES] = { 0, 160, 320, 640, 1920 };
+
+/*! \brief Number of bytes in a block of the size class available to the frame */
+#define FRAME_SLAB_SIZE(size_class) \
+	(sizeof(struct ast_frame) + AST_FRIENDLY_OFFSET + frame_slab_payloads[size_class] + FRAME_SLAB_SRC_LEN)
+
+struct frame_slab_pool;
+
+/*! \brief A slab allocated frame with room for its payload and src */
+struct frame_slab_block {
+	/*! Pool of the thread that allocated the block */
+	struct frame_slab_pool *pool;
+	/*! Next block on a free list */
+	struct frame_slab_block *next;
+	/*! Size class of the block */
+	unsigned int size_class;
+	/*! The frame.  Its payload and src follow in the same allocation. */
+	struct ast_frame frame;
 };
-#endif
 
-struct ast_frame ast_null_frame = { AST_FRAME_NULL, };
+struct frame_slab_stats {
+	/*! Number of frames allocated from each size class */
+	uint64_t allocated[FRAME_SLAB_CLASSES];
+	/*! Number of those allocations that reused a free block */
+	uint64_t reused[FRAME_SLAB_CLASSES];
+	/*! Number of blocks freed by a thread other than the pool's owner */
+	uint64_t remote_freed;
+	/*! Number of frames too large for any size class */
+	uint64_t oversized;
+};
 
-static struct ast_frame *ast_frame_header_new(void)
+/*! \brief A thread's frame slab pool */
+struct frame_slab_pool {
+	/*! Free blocks for each size class, only used by the owning thread */
+	struct frame_slab_block *free[FRAME_SLAB_CLASSES];
+	/*! Number of blocks on each free list */
+	unsigned int free_count[FRAME_SLAB_CLASSES];
+	/*! Protects remote, remote_count, orphaned, and stats.remote_freed */
+	ast_mutex_t lock;
+	/*! Blocks freed by other threads, waiting to be reclaimed by the owner */
+	struct frame_slab_block *remote;
+	/*! Number of blocks on the remote list */
+	unsigned int remote_count;
+	/*! One for the owning thread plus one for every allocated block */
+	volatile int refcount;
+	/*! Statistics, written by the owning thread except for remote_freed */
+	struct frame_slab_stats stats;
+	/*! TRUE once the owning thread has exited */
+	unsigned int orphaned:1;
+	AST_LIST_ENTRY(frame_slab_pool) list;
+};
+
+/*! \brief Per thread storage, points at the thread's pool */
+struct frame_slab_ref {
+	struct frame_slab_pool *pool;
+};
+
+AST_MUTEX_DEFINE_STATIC(frame_slab_lock);
+
+/*! \brief Every pool still alive, protected by frame_slab_lock */
+static AST_LIST_HEAD_NOLOCK_STATIC(frame_slab_pools, frame_slab_pool);
+
+/*! \brief Statistics of pools already destroyed, protected by frame_slab_lock */
+static struct frame_slab_stats frame_slab_retired;
+
+static void frame_slab_stats_add(struct frame_slab_stats *total, const struct frame_slab_stats *stats)
 {
-	struct ast_frame *f;
+	int i;
 
-#if !defined(LOW_MEMORY)
-	struct ast_frame_cache *frames;
-
-	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
-		if ((f = AST_LIST_REMOVE_HEAD(&frames->list, frame_list))) {
-			size_t mallocd_len = f->mallocd_hdr_len;
-			memset(f, 0, sizeof(*f));
-			f->mallocd_hdr_len = mallocd_len;
-			f->mallocd = AST_MALLOCD_HDR;
-			frames->size--;
-			return f;
-		}
+	for (i = 0; i < FRAME_SLAB_CLASSES; i++) {
+		total->allocated[i] += stats->allocated[i];
+		total->reused[i] += stats->reused[i];
+	}
+	total->remote_freed += stats->remote_freed;
+	total->oversized += stats->oversized;
+}
+
+static void frame_slab_pool_unref(struct frame_slab_pool *pool)
+{
+	if (ast_atomic_fetchadd_int(&pool->refcount, -1) != 1) {
+		return;
+	}
+
+	ast_mutex_lock(&frame_slab_lock);
+	AST_LIST_REMOVE(&frame_slab_pools, pool, list);
+	frame_slab_stats_add(&frame_slab_retired, &pool->stats);
+	ast_mutex_unlock(&frame_slab_lock);
+
+	ast_mutex_destroy(&pool->lock);
+	ast_free(pool);
+}
+
+/*! \brief Free a list of blocks, dropping their pool references */
+static void frame_slab_free_list(struct frame_slab_block *block)
+{
+	while (block) {
+		struct frame_slab_block *next = block->next;
+		struct frame_slab_pool *pool = block->pool;
+
+		ast_free(block);
+		frame_slab_pool_unref(pool);
+		block = next;
 	}
-	if (!(f = ast_calloc_cache(1, sizeof(*f))))
+}
+
+static void frame_slab_cleanup(void *data)
+{
+	struct frame_slab_ref *ref = data;
+	struct frame_slab_pool *pool = ref->pool;
+	struct frame_slab_block *remote;
+	int i;
+
+	ast_free(ref);
+	if (!pool) {
+		return;
+	}
+
+	/* Blocks freed from now on by other threads go straight back to the heap. */
+	ast_mutex_lock(&pool->lock);
+	pool->orphaned = 1;
+	remote = pool->remote;
+	pool->remote = NULL;
+	pool->remote_count = 0;
+	ast_mutex_unlock(&pool->lock);
+
+	frame_slab_free_list(remote);
+	for (i = 0; i < FRAME_SLAB_CLASSES; i++) {
+		remote = pool->free[i];
+		pool->free[i] = NULL;
+		pool->free_count[i] = 0;
+		frame_slab_free_list(remote);
+	}
+
+	frame_slab_pool_unref(pool);
+}
+
+/*!
+ * \brief Get the calling thread's pool
+ *
+ * \param create Create the pool if the thread does not have one yet
+ */
+static struct frame_slab_pool *frame_slab_pool_get(int create)
+{
+	struct frame_slab_ref *ref;
+	struct frame_slab_pool *pool;
+
+	if (!(ref = ast_threadstorage_get(&frame_slab, sizeof(*ref)))) {
 		return NULL;
-#else
-	if (!(f = ast_calloc(1, sizeof(*f))))
+	}
+	if (ref->pool || !create) {
+		return ref->pool;
+	}
+
+	if (!(pool = ast_calloc(1, sizeof(*pool)))) {
 		return NULL;
-#endif
+	}
+	ast_mutex_init(&pool->lock);
+	pool->refcount = 1;
 
-	f->mallocd_hdr_len = sizeof(*f);
+	ast_mutex_lock(&frame_slab_lock);
+	AST_LIST_INSERT_TAIL(&frame_slab_pools, pool, list);
+	ast_mutex_unlock(&frame_slab_lock);
 
-	return f;
+	ref->pool = pool;
+	return pool;
 }
 
-#if !defined(LOW_MEMORY)
-static void frame_cache_cleanup(void *data)
+/*! \brief Move blocks freed by other threads onto the owner's free lists */
+static void frame_slab_pool_reclaim(struct frame_slab_pool *pool)
 {
-	struct ast_frame_cache *frames = data;
-	struct ast_frame *f;
+	struct frame_slab_block *block;
+
+	ast_mutex_lock(&pool->lock);
+	block = pool->remote;
+	pool->remote = NULL;
+	pool->remote_count = 0;
+	ast_mutex_unlock(&pool->lock);
+
+	while (block) {
+		struct frame_slab_block *next = block->next;
+		unsigned int size_class = block->size_class;
+
+		if (pool->free_count[size_class] < FRAME_SLAB_MAX_FREE) {
+			block->next = pool->free[size_class];
+			pool->free[size_class] = block;
+			pool->free_count[size_class]++;
+		} else {
+			ast_free(block);
+			frame_slab_pool_unref(pool);
+		}
+		block = next;
+	}
+}
+
+/*!
+ * \brief Allocate a frame and room for its payload from the calling thread's pool
+ *
+ * \param len Number of bytes needed for the frame, its payload, and its src
+ *
+ * \note Only the frame header is zeroed.
+ *
+ * \retval NULL if \a len is too large for the slab or on allocation failure
+ * \retval non-NULL The frame with mallocd and mallocd_hdr_len set
+ */
+static struct ast_frame *frame_slab_alloc(size_t len)
+{
+	struct frame_slab_pool *pool;
+	struct frame_slab_block *block;
+	unsigned int size_class;
 
-	while ((f = AST_LIST_REMOVE_HEAD(&frames->list, frame_list)))
-		ast_free(f);
+	if (!(pool = frame_slab_pool_get(1))) {
+		return NULL;
+	}
 
-	ast_free(frames);
+	for (size_class = 0; size_class < FRAME_SLAB_CLASSES; size_class++) {
+		if (FRAME_SLAB_SIZE(size_class) >= len) {
+			break;
+		}
+	}
+	if (size_class == FRAME_SLAB_CLASSES) {
+		pool->stats.oversized++;
+		return NULL;
+	}
+
+	if (!pool->free[size_class] && pool->remote_count) {
+		frame_slab_pool_reclaim(pool);
+	}
+
+	if ((block = pool->free[size_class])) {
+		pool->free[size_class] = block->next;
+		pool->free_count[size_class]--;
+		pool->stats.reused[size_class]++;
+	} else {
+		if (!(block = ast_malloc(offsetof(struct frame_slab_block, frame) + FRAME_SLAB_SIZE(size_class)))) {
+			return NULL;
+		}
+		block->pool = pool;
+		block->size_class = size_class;
+		ast_atomic_fetchadd_int(&pool->refcount, +1);
+	}
+	block->next = NULL;
+	pool->stats.allocated[size_class]++;
+
+	memset(&block->frame, 0, sizeof(block->frame));
+	block->frame.mallocd = AST_MALLOCD_HDR | AST_MALLOCD_SLAB;
+	block->frame.mallocd_hdr_len = FRAME_SLAB_SIZE(size_class);
+
+	return &block->frame;
+}
+
+/*!
+ * \brief Return a slab allocated frame to the pool it came from
+ *
+ * \param f The frame.  Its format, data, and src must already be released.
+ * \param cache Non-zero if the block may be kept for reuse
+ */
+static void frame_slab_free(struct ast_frame *f, int cache)
+{
+	struct frame_slab_block *block = (struct frame_slab_block *) ((char *) f - offsetof(struct frame_slab_block, frame));
+	struct frame_slab_pool *pool = block->pool;
+
+	if (cache) {
+		if (pool == frame_slab_pool_get(0)) {
+			if (pool->free_count[block->size_class] < FRAME_SLAB_MAX_FREE) {
+				block->next = pool->free[block->size_class];
+				pool->free[block->size_class] = block;
+				pool->free_count[block->size_class]++;
+				return;
+			}
+		} else {
+			ast_mutex_lock(&pool->lock);
+			if (!pool->orphaned && pool->remote_count < FRAME_SLAB_MAX_FREE * FRAME_SLAB_CLASSES) {
+				block->next = pool->remote;
+				pool->remote = block;
+				pool->remote_count++;
+				pool->stats.remote_freed++;
+				ast_mutex_unlock(&pool->lock);
+				return;
+			}
+			ast_mutex_unlock(&pool->lock);
+		}
+	}
+
+	ast_free(block);
+	frame_slab_pool_unref(pool);
 }
 #endif
 
-static void __frame_free(struct ast_frame *fr, int cache)
+struct ast_frame ast_null_frame = { AST_FRAME_NULL, };
+
+/*! \brief Free a frame header allocated by ast_frame_header_new() or ast_frdup() */
+static void frame_header_free(struct ast_frame *f)
 {
-	if (!fr->mallocd)
+#if !defined(LOW_MEMORY)
+	if (f->mallocd & AST_MALLOCD_SLAB) {
+		frame_slab_free(f, 1);
 		return;
+	}
+#endif
+	ast_free(f);
+}
 
-#if !defined(LOW_MEMORY)
-	if (cache && fr->mallocd == AST_MALLOCD_HDR) {
-		/* Cool, only the header is malloc'd, let's just cache those for now
-		 * to keep things simple... */
-		struct ast_frame_cache *frames;
-		if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames))) &&
-		    (frames->size < FRAME_CACHE_MAX_SIZE)) {
-			if ((fr->frametype == AST_FRAME_VOICE) || (fr->frametype == AST_FRAME_VIDEO) ||
-				(fr->frametype == AST_FRAME_IMAGE)) {
-				ao2_cleanup(fr->subclass.format);
-			}
+static struct ast_frame *ast_frame_header_new(void)
+{
+	struct ast_frame *f;
 
-			AST_LIST_INSERT_HEAD(&frames->list, fr, frame_list);
-			frames->size++;
-			return;
-		}
+#if !defined(LOW_MEMORY)
+	if ((f = frame_slab_alloc(sizeof(*f)))) {
+		return f;
 	}
 #endif
+	if (!(f = ast_calloc(1, sizeof(*f))))
+		return NULL;
+
+	f->mallocd = AST_MALLOCD_HDR;
+	f->mallocd_hdr_len = sizeof(*f);
+
+	return f;
+}
+
+static void __frame_free(struct ast_frame *fr, int cache)
+{
+	if (!fr->mallocd)
+		return;
 
 	if (fr->mallocd & AST_MALLOCD_DATA) {
 		if (fr->data.ptr)
 			ast_free(fr->data.ptr - fr->offset);
+	} else if (fr->mallocd & AST_MALLOCD_SHARED) {
+		ao2_cleanup(fr->data.ptr);
 	}
 	if (fr->mallocd & AST_MALLOCD_SRC) {
 		if (fr->src)
@@ -152,6 +413,12 @@ static void __frame_free(struct ast_frame *fr, int cache)
 			ao2_cleanup(fr->subclass.format);
 		}
 
+#if !defined(LOW_MEMORY)
+		if (fr->mallocd & AST_MALLOCD_SLAB) {
+			frame_slab_free(fr, cache);
+			return;
+		}
+#endif
 		ast_free(fr);
 	} else {
 		fr->mallocd = 0;
@@ -215,6 +482,7 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 		out->datalen = fr->datalen;
 		out->samples = fr->samples;
 		out->offset = fr->offset;
+		out->ingress = fr->ingress;
 		/* Copy the timing data */
 		ast_copy_flags(out, fr, AST_FLAGS_ALL);
 		if (ast_test_flag(fr, AST_FRFLAG_HAS_TIMING_INFO)) {
@@ -229,7 +497,7 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 	if (!(fr->mallocd & AST_MALLOCD_SRC) && fr->src) {
 		if (!(out->src = ast_strdup(fr->src))) {
 			if (out != fr) {
-				ast_free(out);
+				frame_header_free(out);
 			}
 			return NULL;
 		}
@@ -239,10 +507,21 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 		fr->mallocd &= ~AST_MALLOCD_SRC;
 	}
 
+	if (fr->mallocd & AST_MALLOCD_SHARED) {
+		/* The reference to a shared payload is already owned by the frame */
+		if (out != fr) {
+			out->data = fr->data;
+			memset(&fr->data, 0, sizeof(fr->data));
+			fr->mallocd &= ~AST_MALLOCD_SHARED;
+		}
+		out->mallocd = (out->mallocd & AST_MALLOCD_SLAB) | AST_MALLOCD_HDR | AST_MALLOCD_SRC | AST_MALLOCD_SHARED;
+		return out;
+	}
+
 	if (!(fr->mallocd & AST_MALLOCD_DATA))  {
 		if (!fr->datalen) {
 			out->data.uint32 = fr->data.uint32;
-			out->mallocd = AST_MALLOCD_HDR | AST_MALLOCD_SRC;
+			out->mallocd = (out->mallocd & AST_MALLOCD_SLAB) | AST_MALLOCD_HDR | AST_MALLOCD_SRC;
 			return out;
 		}
 		if (!(newdata = ast_malloc(fr->datalen + AST_FRIENDLY_OFFSET))) {
@@ -250,7 +529,7 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 				ast_free((void *) out->src);
 			}
 			if (out != fr) {
-				ast_free(out);
+				frame_header_free(out);
 			}
 			return NULL;
 		}
@@ -265,21 +544,36 @@ struct ast_frame *ast_frisolate(struct ast_frame *fr)
 		fr->mallocd &= ~AST_MALLOCD_DATA;
 	}
 
-	out->mallocd = AST_MALLOCD_HDR | AST_MALLOCD_SRC | AST_MALLOCD_DATA;
+	out->mallocd = (out->mallocd & AST_MALLOCD_SLAB) | AST_MALLOCD_HDR | AST_MALLOCD_SRC | AST_MALLOCD_DATA;
 
 	return out;
 }
 
+/*! \brief Copy everything but the payload, source and offset of a frame into a new header */
+static void frame_copy_header(struct ast_frame *out, const struct ast_frame *f)
+{
+	out->frametype = f->frametype;
+	out->subclass = f->subclass;
+	if ((f->frametype == AST_FRAME_VOICE) || (f->frametype == AST_FRAME_VIDEO) ||
+		(f->frametype == AST_FRAME_IMAGE)) {
+		ao2_bump(out->subclass.format);
+	}
+	out->datalen = f->datalen;
+	out->samples = f->samples;
+	out->delivery = f->delivery;
+	out->ingress = f->ingress;
+	ast_copy_flags(out, f, AST_FLAGS_ALL);
+	out->ts = f->ts;
+	out->len = f->len;
+	out->seqno = f->seqno;
+}
+
 struct ast_frame *ast_frdup(const struct ast_frame *f)
 {
 	struct ast_frame *out = NULL;
 	int len, srclen = 0;
 	void *buf = NULL;
 
-#if !defined(LOW_MEMORY)
-	struct ast_frame_cache *frames;
-#endif
-
 	/* Start with standard stuff */
 	len = sizeof(*out) + AST_FRIENDLY_OFFSET + f->datalen;
 	/* If we have a source, add space for it */
@@ -293,39 +587,9 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 		len += srclen + 1;
 
 #if !defined(LOW_MEMORY)
-	if ((frames = ast_threadstorage_get(&frame_cache, sizeof(*frames)))) {
-		AST_LIST_TRAVERSE_SAFE_BEGIN(&frames->list, out, frame_list) {
-			if (out->mallocd_hdr_len >= len) {
-				size_t mallocd_len = out->mallocd_hdr_len;
-
-				AST_LIST_REMOVE_CURRENT(frame_list);
-				memset(out, 0, sizeof(*out));
-				out->mallocd_hdr_len = mallocd_len;
-				buf = out;
-				frames->size--;
-				break;
-			}
-		}
-		AST_LIST_TRAVERSE_SAFE_END;
-	}
+	buf = out = frame_slab_alloc(len);
 #endif
 
-	if (!buf) {
-		if (!(buf = ast_calloc_cache(1, len)))
-			return NULL;
-		out = buf;
-		out->mallocd_hdr_len = len;
-	}
-
-	out->frametype = f->frametype;
-	out->subclass = f->subclass;
-	if ((f->frametype == AST_FRAME_VOICE) || (f->frametype == AST_FRAME_VIDEO) ||
-		(f->frametype == AST_FRAME_IMAGE)) {
-		ao2_bump(out->subclass.format);
-	}
-	out->datalen = f->datalen;
-	out->samples = f->samples;
-	out->delivery = f->delivery;
 	/* Even though this new frame was allocated from the heap, we can't mark it
 	 * with AST_MALLOCD_HDR, AST_MALLOCD_DATA and AST_MALLOCD_SRC, because that
 	 * would cause ast_frfree() to attempt to individually free each of those
@@ -333,7 +597,15 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 	 * was allocated in a single allocation, we'll only mark it as if the header
 	 * was heap-allocated; this will result in the entire frame being properly freed.
 	 */
-	out->mallocd = AST_MALLOCD_HDR;
+	if (!buf) {
+		if (!(buf = ast_calloc_cache(1, len)))
+			return NULL;
+		out = buf;
+		out->mallocd = AST_MALLOCD_HDR;
+		out->mallocd_hdr_len = len;
+	}
+
+	frame_copy_header(out, f);
 	out->offset = AST_FRIENDLY_OFFSET;
 	if (out->datalen) {
 		out->data.ptr = buf + sizeof(*out) + AST_FRIENDLY_OFFSET;
@@ -349,13 +621,84 @@ struct ast_frame *ast_frdup(const struct ast_frame *f)
 		/* Must have space since we allocated for it */
 		strcpy(src, f->src);
 	}
-	ast_copy_flags(out, f, AST_FLAGS_ALL);
-	out->ts = f->ts;
-	out->len = f->len;
-	out->seqno = f->seqno;
 	return out;
 }
 
+struct ast_frame *ast_frdup_shared(const struct ast_frame *f)
+{
+	struct ast_frame *out = NULL;
+	int len, srclen = 0;
+	void *payload;
+
+	if (!f->datalen) {
+		/* Nothing worth sharing */
+		return ast_frdup(f);
+	}
+
+	if (f->mallocd & AST_MALLOCD_SHARED) {
+		payload = ao2_bump(f->data.ptr);
+	} else {
+		payload = ao2_alloc_options(f->datalen, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!payload) {
+			return NULL;
+		}
+		memcpy(payload, f->data.ptr, f->datalen);
+	}
+
+	len = sizeof(*out);
+	if (f->src)
+		srclen = strlen(f->src);
+	if (srclen > 0)
+		len += srclen + 1;
+
+#if !defined(LOW_MEMORY)
+	out = frame_slab_alloc(len);
+#endif
+	if (!out) {
+		if (!(out = ast_calloc_cache(1, len))) {
+			ao2_ref(payload, -1);
+			return NULL;
+		}
+		out->mallocd = AST_MALLOCD_HDR;
+		out->mallocd_hdr_len = len;
+	}
+	out->mallocd |= AST_MALLOCD_SHARED;
+
+	frame_copy_header(out, f);
+	/* Nothing in front of a shared payload may be written to */
+	out->offset = 0;
+	out->data.ptr = payload;
+	if (srclen > 0) {
+		char *src = (char *) out + sizeof(*out);
+
+		strcpy(src, f->src);
+		out->src = src;
+	}
+	return out;
+}
+
+int ast_frame_make_writable(struct ast_frame *f)
+{
+	void *newdata;
+
+	if (!(f->mallocd & AST_MALLOCD_SHARED)) {
+		return 0;
+	}
+
+	if (!(newdata = ast_malloc(f->datalen + AST_FRIENDLY_OFFSET))) {
+		return -1;
+	}
+	newdata += AST_FRIENDLY_OFFSET;
+	memcpy(newdata, f->data.ptr, f->datalen);
+	ao2_ref(f->data.ptr, -1);
+
+	f->data.ptr = newdata;
+	f->offset = AST_FRIENDLY_OFFSET;
+	f->mallocd = (f->mallocd & ~AST_MALLOCD_SHARED) | AST_MALLOCD_DATA;
+
+	return 0;
+}
+
 void ast_swapcopy_samples(void *dst, const void *src, int samples)
 {
 	int i;
@@ -647,7 +990,7 @@ void ast_frame_dump(const char *name, struct ast_frame *f, char *prefix)
 int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 {
 	int count;
-	short *fdata = f->data.ptr;
+	short *fdata;
 	short adjust_value = abs(adjustment);
 
 	if ((f->frametype != AST_FRAME_VOICE) || !(ast_format_cache_is_slinear(f->subclass.format))) {
@@ -658,6 +1001,11 @@ int ast_frame_adjust_volume(struct ast_frame *f, int adjustment)
 		return 0;
 	}
 
+	if (ast_frame_make_writable(f)) {
+		return -1;
+	}
+	fdata = f->data.ptr;
+
 	for (count = 0; count < f->samples; count++) {
 		if (adjustment > 0) {
 			ast_slinear_saturated_multiply(&fdata[count], &adjust_value);
@@ -683,6 +1031,9 @@ int ast_frame_slinear_sum(struct ast_frame *f1, struct ast_frame *f2)
 	if (f1->samples != f2->samples)
 		return -1;
 
+	if (ast_frame_make_writable(f1))
+		return -1;
+
 	for (count = 0, data1 = f1->data.ptr, data2 = f2->data.ptr;
 	     count < f1->samples;
 	     count++, data1++, data2++)
@@ -698,7 +1049,86 @@ int ast_frame_clear(struct ast_frame *frame)
 	for (next = AST_LIST_NEXT(frame, frame_list);
 		 frame;
 		 frame = next, next = frame ? AST_LIST_NEXT(frame, frame_list) : NULL) {
+		if (ast_frame_make_writable(frame)) {
+			return -1;
+		}
 		memset(frame->data.ptr, 0, frame->datalen);
 	}
 	return 0;
 }
+
+#if !defined(LOW_MEMORY)
+static char *handle_cli_frame_slabs(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct frame_slab_stats stats;
+	struct frame_slab_pool *pool;
+	unsigned int cached[FRAME_SLAB_CLASSES] = { 0, };
+	int pools = 0;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show frame slabs";
+		e->usage =
+			"Usage: core show frame slabs\n"
+			"       Shows the size classes of the per-thread frame allocator along\n"
+			"       with how often allocations from each were served by a reused block.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	/* The counters of live pools are read without their threads' knowledge, so they are approximate. */
+	ast_mutex_lock(&frame_slab_lock);
+	stats = frame_slab_retired;
+	AST_LIST_TRAVERSE(&frame_slab_pools, pool, list) {
+		frame_slab_stats_add(&stats, &pool->stats);
+		for (i = 0; i < FRAME_SLAB_CLASSES; i++) {
+			cached[i] += pool->free_count[i];
+		}
+		pools++;
+	}
+	ast_mutex_unlock(&frame_slab_lock);
+
+#define FORMAT "%-10s %10s %20s %20s %8s %8s\n"
+#define FORMAT2 "%10zu %10zu %20" PRIu64 " %20" PRIu64 " %7.1f%% %8u\n"
+	ast_cli(a->fd, FORMAT, "Payload", "Block Size", "Allocations", "Reused", "Reuse %", "Cached");
+	for (i = 0; i < FRAME_SLAB_CLASSES; i++) {
+		ast_cli(a->fd, FORMAT2, frame_slab_payloads[i], FRAME_SLAB_SIZE(i),
+			stats.allocated[i], stats.reused[i],
+			stats.allocated[i] ? 100.0 * stats.reused[i] / stats.allocated[i] : 0.0,
+			cached[i]);
+	}
+#undef FORMAT
+#undef FORMAT2
+
+	ast_cli(a->fd, "\nOversized frames:   %" PRIu64 "\n", stats.oversized);
+	ast_cli(a->fd, "Cross-thread frees: %" PRIu64 "\n", stats.remote_freed);
+	ast_cli(a->fd, "Live pools:         %d\n", pools);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry frame_cli[] = {
+	AST_CLI_DEFINE(handle_cli_frame_slabs, "Show frame slab allocator statistics"),
+};
+
+static void frame_shutdown(void)
+{
+	ast_cli_unregister_multiple(frame_cli, ARRAY_LEN(frame_cli));
+}
+#endif
+
+int ast_frame_init(void)
+{
+#if !defined(LOW_MEMORY)
+	ast_cli_register_multiple(frame_cli, ARRAY_LEN(frame_cli));
+	ast_register_cleanup(frame_shutdown);
+#endif
+
+	return 0;
+}
@@ -0,0 +1,324 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Media frame latency tracing
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/channel.h"
+#include "asterisk/channel_internal.h"
+#include "asterisk/cli.h"
+#include "asterisk/frame_latency.h"
+#include "asterisk/options.h"
+#include "asterisk/time.h"
+#include "asterisk/utils.h"
+
+/*! \brief Labels of the latency histogram buckets */
+static const char * const frame_latency_labels[AST_FRAME_LATENCY_BUCKETS] = {
+	"lt_1ms", "lt_2ms", "lt_5ms", "lt_10ms", "lt_20ms", "lt_50ms", "lt_100ms", "ge_100ms",
+};
+
+/*! \brief Upper limits of the latency histogram buckets in microseconds, but the last */
+static const int64_t frame_latency_limits[AST_FRAME_LATENCY_BUCKETS - 1] = {
+	1000, 2000, 5000, 10000, 20000, 50000, 100000,
+};
+
+/*! \brief The latency of a named point */
+struct frame_latency_point {
+	struct ast_frame_latency latency;
+	/*! Name of the point, stored after the kind */
+	const char *name;
+	/*! Kind of point */
+	char point[0];
+};
+
+/*! \brief Search key of a named point */
+struct frame_latency_key {
+	const char *point;
+	const char *name;
+};
+
+/*! \brief Every named point, sorted by kind and name */
+static struct ao2_container *points;
+
+/*!
+ * \brief Frames read since the last one sampled.
+ *
+ * Shared by every thread without locking, a lost update only moves which
+ * frame gets sampled.
+ */
+static unsigned int frame_latency_counter;
+
+static int frame_latency_sort(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct frame_latency_point *left = obj_left;
+	const struct frame_latency_point *right;
+	struct frame_latency_key right_key;
+	const struct frame_latency_key *key;
+	int cmp;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right = obj_right;
+		right_key.point = right->point;
+		right_key.name = right->name;
+		key = &right_key;
+		break;
+	case OBJ_SEARCH_KEY:
+		key = obj_right;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+
+	cmp = strcmp(left->point, key->point);
+	return cmp ? cmp : strcmp(left->name, key->name);
+}
+
+void ast_frame_latency_stamp(struct ast_frame *f)
+{
+	unsigned int sample = ast_option_frame_latency_sample;
+
+	if (f->frametype != AST_FRAME_VOICE && f->frametype != AST_FRAME_VIDEO) {
+		return;
+	}
+
+	if (sample && ++frame_latency_counter >= sample) {
+		frame_latency_counter = 0;
+		f->ingress = ast_tvnow();
+	} else {
+		f->ingress = ast_tv(0, 0);
+	}
+}
+
+void ast_frame_latency_add(struct ast_frame_latency *latency, struct timeval ingress)
+{
+	unsigned int bucket = 0;
+	int64_t us;
+
+	if (ast_tvzero(ingress)) {
+		return;
+	}
+
+	us = ast_tvdiff_us(ast_tvnow(), ingress);
+	if (us < 0) {
+		/* The clock stepped back. */
+		us = 0;
+	}
+
+	while (bucket < AST_FRAME_LATENCY_BUCKETS - 1 && frame_latency_limits[bucket] <= us) {
+		++bucket;
+	}
+	++latency->histogram[bucket];
+	++latency->samples;
+	latency->total_us += us;
+	if (latency->max_us < us) {
+		latency->max_us = us;
+	}
+}
+
+static struct frame_latency_point *frame_latency_point_alloc(const char *point, const char *name)
+{
+	size_t point_len = strlen(point) + 1;
+	struct frame_latency_point *entry;
+
+	entry = ao2_alloc(sizeof(*entry) + point_len + strlen(name) + 1, NULL);
+	if (!entry) {
+		return NULL;
+	}
+	strcpy(entry->point, point); /* Safe */
+	entry->name = entry->point + point_len;
+	strcpy((char *) entry->name, name); /* Safe */
+
+	return entry;
+}
+
+void ast_frame_latency_record(const char *point, const char *name, struct timeval ingress)
+{
+	struct frame_latency_key key = { .point = point, .name = name, };
+	struct frame_latency_point *entry;
+
+	if (ast_tvzero(ingress) || !points) {
+		return;
+	}
+
+	ao2_lock(points);
+	entry = ao2_find(points, &key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry && (entry = frame_latency_point_alloc(point, name))) {
+		ao2_link_flags(points, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(points);
+	if (!entry) {
+		return;
+	}
+
+	ao2_lock(entry);
+	ast_frame_latency_add(&entry->latency, ingress);
+	ao2_unlock(entry);
+	ao2_ref(entry, -1);
+}
+
+const char *ast_frame_latency_bucket_label(unsigned int bucket)
+{
+	return bucket < AST_FRAME_LATENCY_BUCKETS ? frame_latency_labels[bucket] : "";
+}
+
+int ast_frame_latency_foreach(int (*cb)(const char *point, const char *name,
+	const struct ast_frame_latency *latency, void *arg), void *arg)
+{
+	struct ao2_iterator iter;
+	struct frame_latency_point *entry;
+	struct ast_frame_latency latency;
+	int res = 0;
+
+	if (!points) {
+		return -1;
+	}
+
+	iter = ao2_iterator_init(points, 0);
+	for (; !res && (entry = ao2_iterator_next(&iter)); ao2_ref(entry, -1)) {
+		ao2_lock(entry);
+		latency = entry->latency;
+		ao2_unlock(entry);
+
+		res = cb(entry->point, entry->name, &latency, arg);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return 0;
+}
+
+#define FORMAT "%-10s %-32.32s %9s %8s %8s"
+
+static void frame_latency_cli_line(int fd, const char *point, const char *name,
+	const struct ast_frame_latency *latency)
+{
+	int i;
+
+	ast_cli(fd, "%-10s %-32.32s %9lu %8lu %8lu", point, name, latency->samples,
+		latency->samples ? (unsigned long) (latency->total_us / latency->samples) : 0UL,
+		latency->max_us);
+	for (i = 0; i < AST_FRAME_LATENCY_BUCKETS; ++i) {
+		ast_cli(fd, " %8lu", latency->histogram[i]);
+	}
+	ast_cli(fd, "\n");
+}
+
+static int frame_latency_cli_point(const char *point, const char *name,
+	const struct ast_frame_latency *latency, void *arg)
+{
+	frame_latency_cli_line(*(int *) arg, point, name, latency);
+	return 0;
+}
+
+static char *handle_cli_frame_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_channel_iterator *iter;
+	struct ast_channel *chan;
+	struct ast_frame_latency *chan_latency;
+	struct ast_frame_latency latency;
+	int fd;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show channel latency";
+		e->usage =
+			"Usage: core show channel latency\n"
+			"       Shows how long the sampled audio and video frames took from being\n"
+			"       read to passing through each translation path and bridge technology\n"
+			"       and to being written to each channel type and each channel, in\n"
+			"       microseconds.  Frames are only sampled when frame_latency_sample is\n"
+			"       set in asterisk.conf.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!ast_option_frame_latency_sample) {
+		ast_cli(a->fd, "Frame latency sampling is disabled.\n\n");
+	} else {
+		ast_cli(a->fd, "Sampling one in %u frames.\n\n", ast_option_frame_latency_sample);
+	}
+
+	ast_cli(a->fd, FORMAT, "Point", "Name", "Frames", "Avg", "Max");
+	for (i = 0; i < AST_FRAME_LATENCY_BUCKETS; ++i) {
+		ast_cli(a->fd, " %8s", frame_latency_labels[i]);
+	}
+	ast_cli(a->fd, "\n");
+
+	fd = a->fd;
+	ast_frame_latency_foreach(frame_latency_cli_point, &fd);
+
+	if (!(iter = ast_channel_iterator_all_new())) {
+		return CLI_FAILURE;
+	}
+	for (; (chan = ast_channel_iterator_next(iter)); ast_channel_unref(chan)) {
+		ast_channel_lock(chan);
+		chan_latency = ast_channel_internal_frame_latency(chan, 0);
+		if (chan_latency) {
+			latency = *chan_latency;
+		}
+		ast_channel_unlock(chan);
+
+		if (chan_latency) {
+			frame_latency_cli_line(a->fd, "channel", ast_channel_name(chan), &latency);
+		}
+	}
+	ast_channel_iterator_destroy(iter);
+
+	return CLI_SUCCESS;
+}
+
+#undef FORMAT
+
+static struct ast_cli_entry frame_latency_cli[] = {
+	AST_CLI_DEFINE(handle_cli_frame_latency, "Show the latency of sampled media frames"),
+};
+
+static void frame_latency_shutdown(void)
+{
+	ast_cli_unregister_multiple(frame_latency_cli, ARRAY_LEN(frame_latency_cli));
+	ao2_cleanup(points);
+	points = NULL;
+}
+
+int ast_frame_latency_init(void)
+{
+	points = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, 0, frame_latency_sort, NULL);
+	if (!points) {
+		return -1;
+	}
+
+	ast_cli_register_multiple(frame_latency_cli, ARRAY_LEN(frame_latency_cli));
+	ast_register_cleanup(frame_latency_shutdown);
+
+	return 0;
+}
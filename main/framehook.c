@@ -51,6 +51,10 @@ struct ast_framehook_list {
 	unsigned int count;
 	/*! id for next framehook added */
 	unsigned int id_count;
+	/*! the number of hooks not signaled for destruction */
+	unsigned int active;
+	/*! the number of active hooks that consume every frame type */
+	unsigned int active_consume_all;
 	AST_LIST_HEAD_NOLOCK(, ast_framehook) list;
 };
 
@@ -80,6 +84,19 @@ static void framehook_detach(struct ast_framehook *framehook, enum framehook_det
 	ast_free(framehook);
 }
 
+/*! \brief Signal a framehook for destruction and take it out of the active counts */
+static void framehook_deactivate(struct ast_framehook_list *framehooks, struct ast_framehook *framehook)
+{
+	if (framehook->detach_and_destroy_me) {
+		return;
+	}
+	framehook->detach_and_destroy_me = 1;
+	framehooks->active--;
+	if (!framehook->i.consume_cb) {
+		framehooks->active_consume_all--;
+	}
+}
+
 static struct ast_frame *framehook_list_push_event(struct ast_framehook_list *framehooks, struct ast_frame *frame, enum ast_framehook_event event)
 {
 	struct ast_framehook *framehook;
@@ -87,7 +104,7 @@ static struct ast_frame *framehook_list_push_event(struct ast_framehook_list *fr
 	int *skip;
 	size_t skip_size;
 
-	if (!framehooks) {
+	if (!framehooks || AST_LIST_EMPTY(&framehooks->list)) {
 		return frame;
 	}
 
@@ -155,6 +172,10 @@ int ast_framehook_attach(struct ast_channel *chan, struct ast_framehook_interfac
 	}
 
 	ast_channel_framehooks(chan)->count++;
+	ast_channel_framehooks(chan)->active++;
+	if (!framehook->i.consume_cb) {
+		ast_channel_framehooks(chan)->active_consume_all++;
+	}
 	framehook->id = ++ast_channel_framehooks(chan)->id_count;
 	AST_LIST_INSERT_TAIL(&ast_channel_framehooks(chan)->list, framehook, list);
 
@@ -189,7 +210,7 @@ int ast_framehook_detach(struct ast_channel *chan, int id)
 			 * it needs to be safe for this function to be called within the
 			 * event callback.  If we allowed the hook to actually be destroyed
 			 * immediately here, the event callback would crash on exit. */
-			framehook->detach_and_destroy_me = 1;
+			framehook_deactivate(ast_channel_framehooks(chan), framehook);
 			res = 0;
 			break;
 		}
@@ -248,6 +269,8 @@ void ast_framehook_list_fixup(struct ast_channel *old_chan, struct ast_channel *
 		&& ast_channel_is_bridged(old_chan)) {
 		ast_channel_set_unbridged_nolock(old_chan, 1);
 	}
+	ast_channel_framehooks(old_chan)->active = 0;
+	ast_channel_framehooks(old_chan)->active_consume_all = 0;
 	while ((framehook = AST_LIST_REMOVE_HEAD(&ast_channel_framehooks(old_chan)->list, list))) {
 		/* If inheritance is not allowed for this framehook, just destroy it. */
 		if (framehook->i.disable_inheritance) {
@@ -289,19 +312,20 @@ int ast_framehook_list_contains_no_active_of_type(struct ast_framehook_list *fra
 {
 	struct ast_framehook *cur;
 
-	if (!framehooks) {
+	if (!framehooks || !framehooks->active) {
 		return 1;
 	}
 
-	if (AST_LIST_EMPTY(&framehooks->list)) {
-		return 1;
+	if (!type || framehooks->active_consume_all) {
+		return 0;
 	}
 
+	/* Only hooks which choose the frame types they consume are left to ask */
 	AST_LIST_TRAVERSE(&framehooks->list, cur, list) {
-		if (cur->detach_and_destroy_me) {
+		if (cur->detach_and_destroy_me || !cur->i.consume_cb) {
 			continue;
 		}
-		if (type && cur->i.consume_cb && !cur->i.consume_cb(cur->i.data, type)) {
+		if (!cur->i.consume_cb(cur->i.data, type)) {
 			continue;
 		}
 		return 0;
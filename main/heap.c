@@ -33,13 +33,36 @@
 #include "asterisk/utils.h"
 #include "asterisk/cli.h"
 
+/*! \brief Children of each element of a keyed heap */
+#define KEYED_ARITY 4
+
+/*! \brief Alignment of the storage of a keyed heap, one cache line */
+#define KEYED_ALIGN 64
+
+/*! \brief An element of a keyed heap and its key */
+struct heap_node {
+	int64_t key;
+	void *elm;
+};
+
 struct ast_heap {
 	ast_rwlock_t lock;
+	/*! Orders the elements, or breaks ties between keys of a keyed heap */
 	ast_heap_cmp_fn cmp_fn;
+	/*! Gets the key of an element of a keyed heap, NULL for a binary heap */
+	ast_heap_key_fn key_fn;
 	ssize_t index_offset;
 	size_t cur_len;
 	size_t avail_len;
+	/*! The elements of a binary heap */
 	void **heap;
+	/*!
+	 * The elements of a keyed heap, 0 based, with the children of each
+	 * element sharing a cache line.
+	 */
+	struct heap_node *nodes;
+	/*! The allocation nodes points into */
+	void *nodes_buf;
 };
 
 static inline int left_node(int i)
@@ -85,10 +108,60 @@ static inline void heap_set(struct ast_heap *h, int i, void *elm)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Compare two elements of a keyed heap.
+ *
+ * The keys are compared inline, and the elements themselves are only
+ * looked at to break a tie.
+ */
+static inline int keyed_cmp(struct ast_heap *h, const struct heap_node *n1,
+	const struct heap_node *n2)
+{
+	if (n1->key != n2->key) {
+		return n1->key < n2->key ? -1 : 1;
+	}
+
+	return h->cmp_fn ? h->cmp_fn(n1->elm, n2->elm) : 0;
+}
+
+/*!
+ * \internal
+ * \brief Put an element of a keyed heap at a 0 based position.
+ *
+ * The index kept in the element stays 1 based, as for a binary heap.
+ */
+static inline void keyed_set(struct ast_heap *h, size_t i, const struct heap_node *node)
+{
+	h->nodes[i] = *node;
+
+	if (h->index_offset >= 0) {
+		ssize_t *index = node->elm + h->index_offset;
+		*index = i + 1;
+	}
+}
+
+static int keyed_verify(struct ast_heap *h)
+{
+	size_t i;
+
+	for (i = 1; i < h->cur_len; i++) {
+		if (keyed_cmp(h, &h->nodes[(i - 1) / KEYED_ARITY], &h->nodes[i]) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 int ast_heap_verify(struct ast_heap *h)
 {
 	unsigned int i;
 
+	if (h->key_fn) {
+		return keyed_verify(h);
+	}
+
 	for (i = 1; i <= (h->cur_len / 2); i++) {
 		int l = left_node(i);
 		int r = right_node(i);
@@ -109,20 +182,53 @@ int ast_heap_verify(struct ast_heap *h)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Move the elements of a keyed heap to storage for len elements.
+ *
+ * The storage is aligned so that the children of an element, which start
+ * at 4i + 1, share a cache line.
+ */
+static int keyed_alloc(struct ast_heap *h, size_t len
 #ifdef __AST_DEBUG_MALLOC
-struct ast_heap *_ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_fn,
-		ssize_t index_offset, const char *file, int lineno, const char *func)
-#else
-struct ast_heap *ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_fn,
-		ssize_t index_offset)
+, const char *file, int lineno, const char *func
 #endif
+)
 {
-	struct ast_heap *h;
+	void *buf;
+	uintptr_t first_child;
 
-	if (!cmp_fn) {
-		ast_log(LOG_ERROR, "A comparison function must be provided\n");
-		return NULL;
+#ifdef __AST_DEBUG_MALLOC
+	buf = __ast_malloc(len * sizeof(struct heap_node) + KEYED_ALIGN, file, lineno, func);
+#else
+	buf = ast_malloc(len * sizeof(struct heap_node) + KEYED_ALIGN);
+#endif
+	if (!buf) {
+		return -1;
+	}
+
+	first_child = ((uintptr_t) buf + sizeof(struct heap_node) + KEYED_ALIGN - 1)
+		& ~(uintptr_t) (KEYED_ALIGN - 1);
+	if (h->cur_len) {
+		memcpy((struct heap_node *) first_child - 1, h->nodes,
+			h->cur_len * sizeof(struct heap_node));
 	}
+	ast_free(h->nodes_buf);
+	h->nodes_buf = buf;
+	h->nodes = (struct heap_node *) first_child - 1;
+	h->avail_len = len;
+
+	return 0;
+}
+
+static struct ast_heap *heap_alloc(unsigned int init_height, ast_heap_cmp_fn cmp_fn,
+	ast_heap_key_fn key_fn, ssize_t index_offset
+#ifdef __AST_DEBUG_MALLOC
+, const char *file, int lineno, const char *func
+#endif
+)
+{
+	struct ast_heap *h;
 
 	if (!init_height) {
 		init_height = 8;
@@ -139,18 +245,31 @@ struct ast_heap *ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_f
 	}
 
 	h->cmp_fn = cmp_fn;
+	h->key_fn = key_fn;
 	h->index_offset = index_offset;
-	h->avail_len = (1 << init_height) - 1;
 
-	if (!(h->heap =
+	if (key_fn) {
+		if (keyed_alloc(h, (1 << init_height) - 1
+#ifdef __AST_DEBUG_MALLOC
+			, file, lineno, func
+#endif
+			)) {
+			ast_free(h);
+			return NULL;
+		}
+	} else {
+		h->avail_len = (1 << init_height) - 1;
+
+		if (!(h->heap =
 #ifdef __AST_DEBUG_MALLOC
-			__ast_calloc(1, h->avail_len * sizeof(void *), file, lineno, func)
+				__ast_calloc(1, h->avail_len * sizeof(void *), file, lineno, func)
 #else
-			ast_calloc(1, h->avail_len * sizeof(void *))
+				ast_calloc(1, h->avail_len * sizeof(void *))
 #endif
-		)) {
-		ast_free(h);
-		return NULL;
+			)) {
+			ast_free(h);
+			return NULL;
+		}
 	}
 
 	ast_rwlock_init(&h->lock);
@@ -158,10 +277,53 @@ struct ast_heap *ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_f
 	return h;
 }
 
+#ifdef __AST_DEBUG_MALLOC
+struct ast_heap *_ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_fn,
+		ssize_t index_offset, const char *file, int lineno, const char *func)
+#else
+struct ast_heap *ast_heap_create(unsigned int init_height, ast_heap_cmp_fn cmp_fn,
+		ssize_t index_offset)
+#endif
+{
+	if (!cmp_fn) {
+		ast_log(LOG_ERROR, "A comparison function must be provided\n");
+		return NULL;
+	}
+
+	return heap_alloc(init_height, cmp_fn, NULL, index_offset
+#ifdef __AST_DEBUG_MALLOC
+		, file, lineno, func
+#endif
+		);
+}
+
+#ifdef __AST_DEBUG_MALLOC
+struct ast_heap *_ast_heap_create_keyed(unsigned int init_height, ast_heap_key_fn key_fn,
+		ast_heap_cmp_fn cmp_fn, ssize_t index_offset, const char *file, int lineno, const char *func)
+#else
+struct ast_heap *ast_heap_create_keyed(unsigned int init_height, ast_heap_key_fn key_fn,
+		ast_heap_cmp_fn cmp_fn, ssize_t index_offset)
+#endif
+{
+	if (!key_fn) {
+		ast_log(LOG_ERROR, "A key function must be provided\n");
+		return NULL;
+	}
+
+	return heap_alloc(init_height, cmp_fn, key_fn, index_offset
+#ifdef __AST_DEBUG_MALLOC
+		, file, lineno, func
+#endif
+		);
+}
+
 struct ast_heap *ast_heap_destroy(struct ast_heap *h)
 {
 	ast_free(h->heap);
 	h->heap = NULL;
+	ast_free(h->nodes_buf);
+	h->nodes_buf = NULL;
+	h->nodes = NULL;
 
 	ast_rwlock_destroy(&h->lock);
 
@@ -182,6 +344,14 @@ static int grow_heap(struct ast_heap *h
 	void **new_heap;
 	size_t new_len = h->avail_len * 2 + 1;
 
+	if (h->key_fn) {
+		return keyed_alloc(h, new_len
+#ifdef __AST_DEBUG_MALLOC
+			, file, lineno, func
+#endif
+			);
+	}
+
 #ifdef __AST_DEBUG_MALLOC
 	new_heap = __ast_realloc(h->heap, new_len * sizeof(void *), file, lineno, func);
 #else
@@ -242,6 +412,55 @@ static int bubble_up(struct ast_heap *h, int i)
 	return i;
 }
 
+/*!
+ * \internal
+ * \brief Move an element of a keyed heap up from a hole at i to where it belongs.
+ *
+ * \return Where the element was put
+ */
+static size_t keyed_sift_up(struct ast_heap *h, size_t i, const struct heap_node *node)
+{
+	size_t parent;
+
+	while (i) {
+		parent = (i - 1) / KEYED_ARITY;
+		if (keyed_cmp(h, &h->nodes[parent], node) >= 0) {
+			break;
+		}
+		keyed_set(h, i, &h->nodes[parent]);
+		i = parent;
+	}
+	keyed_set(h, i, node);
+
+	return i;
+}
+
+/*!
+ * \internal
+ * \brief Move an element of a keyed heap down from a hole at i to where it belongs.
+ */
+static void keyed_sift_down(struct ast_heap *h, size_t i, const struct heap_node *node)
+{
+	size_t child;
+	size_t last;
+	size_t max;
+
+	while ((child = i * KEYED_ARITY + 1) < h->cur_len) {
+		last = MIN(child + KEYED_ARITY, h->cur_len);
+		for (max = child++; child < last; child++) {
+			if (keyed_cmp(h, &h->nodes[child], &h->nodes[max]) > 0) {
+				max = child;
+			}
+		}
+		if (keyed_cmp(h, &h->nodes[max], node) <= 0) {
+			break;
+		}
+		keyed_set(h, i, &h->nodes[max]);
+		i = max;
+	}
+	keyed_set(h, i, node);
+}
+
 #ifdef __AST_DEBUG_MALLOC
 int _ast_heap_push(struct ast_heap *h, void *elm, const char *file, int lineno, const char *func)
 #else
@@ -256,6 +475,13 @@ int ast_heap_push(struct ast_heap *h, void *elm)
 		return -1;
 	}
 
+	if (h->key_fn) {
+		struct heap_node node = { .key = h->key_fn(elm), .elm = elm, };
+
+		keyed_sift_up(h, h->cur_len++, &node);
+		return 0;
+	}
+
 	heap_set(h, ++(h->cur_len), elm);
 
 	bubble_up(h, h->cur_len);
@@ -271,6 +497,18 @@ static void *_ast_heap_remove(struct ast_heap *h, unsigned int index)
 		return NULL;
 	}
 
+	if (h->key_fn) {
+		struct heap_node last;
+		size_t i = index - 1;
+
+		ret = h->nodes[i].elm;
+		last = h->nodes[--h->cur_len];
+		if (i != h->cur_len) {
+			keyed_sift_down(h, keyed_sift_up(h, i, &last), &last);
+		}
+		return ret;
+	}
+
 	ret = heap_get(h, index);
 	heap_set(h, index, heap_get(h, (h->cur_len)--));
 	index = bubble_up(h, index);
@@ -301,6 +539,10 @@ void *ast_heap_peek(struct ast_heap *h, unsigned int index)
 		return NULL;
 	}
 
+	if (h->key_fn) {
+		return h->nodes[index - 1].elm;
+	}
+
 	return heap_get(h, index);
 }
 
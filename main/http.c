@@ -64,6 +64,8 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/json.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/vector.h"
 
 #define MAX_PREFIX 80
 #define DEFAULT_PORT 8088
@@ -75,6 +77,10 @@
 #define MIN_INITIAL_REQUEST_TIMEOUT	10000
 /*! (ms) Idle time between HTTP requests */
 #define DEFAULT_SESSION_KEEP_ALIVE 15000
+/*! Worker threads started for HTTP connections, 0 for a thread per connection */
+#define DEFAULT_WORKER_POOL_SIZE 8
+/*! (s) Idle time before a worker thread above the pool size exits */
+#define WORKER_IDLE_TIMEOUT 60
 /*! Max size for the http server name */
 #define	MAX_SERVER_NAME_LENGTH 128
 /*! Max size for the http response header */
@@ -100,11 +106,41 @@ static int session_limit = DEFAULT_SESSION_LIMIT;
 static int session_inactivity = DEFAULT_SESSION_INACTIVITY;
 static int session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
 static int session_count = 0;
+static int worker_pool_size = DEFAULT_WORKER_POOL_SIZE;
 
 static struct ast_tls_config http_tls_cfg;
 
 static void *httpd_helper_thread(void *arg);
 
+/*!
+ * \brief Worker threads serving HTTP connections.
+ *
+ * Connections are served by the pool one request at a time.  A keep-alive
+ * connection waiting for its next request is handed to the idle thread
+ * instead of blocking a worker, so a worker is only busy while a request
+ * is being read or answered.  The number of busy workers is bounded by
+ * the session limit since each one serves a counted session.
+ */
+static struct ast_threadpool *http_pool;
+
+/*! A keep-alive connection waiting for its next request */
+struct http_idle_session {
+	struct ast_tcptls_session_instance *ser;
+	/*! When the connection is closed if no request has started */
+	struct timeval expires;
+};
+
+/*! Connections waiting for their next request */
+static AST_VECTOR(, struct http_idle_session) idle_sessions;
+/*! Protects idle_sessions and idle_stop */
+AST_MUTEX_DEFINE_STATIC(idle_lock);
+/*! Wakes the idle thread up after idle_sessions changed */
+static int idle_alert_pipe[2] = { -1, -1 };
+/*! Thread waiting for input on the idle connections */
+static pthread_t idle_thread = AST_PTHREADT_NULL;
+/*! Set to stop the idle thread */
+static int idle_stop;
+
 /*!
  * we have up to two accepting threads, one for http, one for https
  */
@@ -441,6 +477,30 @@ struct http_worker_private_data {
 	struct ast_flags flags;
 };
 
+/*!
+ * \internal
+ * \brief Decide whether the connection closes once the response is sent.
+ *
+ * \retval 1 if the connection closes.
+ * \retval 0 if it is kept alive.
+ */
+static int http_response_closes(struct ast_tcptls_session_instance *ser)
+{
+	struct http_worker_private_data *request;
+
+	if (session_keep_alive <= 0) {
+		return 1;
+	}
+
+	request = ser->private_data;
+	if (!request
+		|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)
+		|| ast_http_body_discard(ser)) {
+		return 1;
+	}
+	return 0;
+}
+
 void ast_http_send(struct ast_tcptls_session_instance *ser,
 	enum ast_http_method method, int status_code, const char *status_title,
 	struct ast_str *http_header, struct ast_str *out, int fd,
@@ -478,20 +538,7 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	 */
 	ast_assert(200 <= status_code);
 
-	if (session_keep_alive <= 0) {
-		close_connection = 1;
-	} else {
-		struct http_worker_private_data *request;
-
-		request = ser->private_data;
-		if (!request
-			|| ast_test_flag(&request->flags, HTTP_FLAG_CLOSE_ON_COMPLETION)
-			|| ast_http_body_discard(ser)) {
-			close_connection = 1;
-		} else {
-			close_connection = 0;
-		}
-	}
+	close_connection = http_response_closes(ser);
 
 	ast_strftime(timebuf, sizeof(timebuf), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&now, &tm, "GMT"));
 
@@ -551,6 +598,141 @@ void ast_http_send(struct ast_tcptls_session_instance *ser,
 	}
 }
 
+/*! \brief Size of the chunks of a chunked response */
+#define HTTP_CHUNK_SIZE 8192
+
+struct ast_http_chunked {
+	/*! TCP/TLS session the response is sent on */
+	struct ast_tcptls_session_instance *ser;
+	/*! Non-zero if the connection closes once the response is sent */
+	int close_connection;
+	/*! Non-zero if the body is sent, zero for a HEAD request */
+	int send_content;
+	/*! Bytes of the next chunk in buf */
+	size_t used;
+	/*! Next chunk */
+	char buf[HTTP_CHUNK_SIZE];
+};
+
+struct ast_http_chunked *ast_http_chunked_start(struct ast_tcptls_session_instance *ser,
+	enum ast_http_method method, int status_code, const char *status_title,
+	struct ast_str *http_header)
+{
+	struct ast_http_chunked *chunked;
+	struct timeval now = ast_tvnow();
+	struct ast_tm tm;
+	char timebuf[80];
+
+	ast_assert(200 <= status_code);
+
+	if (!ser || !(chunked = ast_calloc(1, sizeof(*chunked)))) {
+		ast_free(http_header);
+		return NULL;
+	}
+	chunked->ser = ser;
+	chunked->close_connection = http_response_closes(ser);
+	chunked->send_content = method != AST_HTTP_HEAD || status_code >= 400;
+
+	ast_strftime(timebuf, sizeof(timebuf), "%a, %d %b %Y %H:%M:%S GMT", ast_localtime(&now, &tm, "GMT"));
+
+	if (ast_iostream_printf(ser->stream,
+			"HTTP/1.1 %d %s\r\n"
+			"%s%s%s"
+			"Date: %s\r\n"
+			"%s"
+			"Cache-Control: no-cache, no-store\r\n"
+			"%s"
+			"Transfer-Encoding: chunked\r\n"
+			"\r\n",
+			status_code, status_title ? status_title : "OK",
+			!ast_strlen_zero(http_server_name) ? "Server: " : "",
+			S_OR(http_server_name, ""),
+			!ast_strlen_zero(http_server_name) ? "\r\n" : "",
+			timebuf,
+			chunked->close_connection ? "Connection: close\r\n" : "",
+			http_header ? ast_str_buffer(http_header) : "") < 0) {
+		chunked->close_connection = 1;
+		chunked->send_content = 0;
+	}
+	ast_free(http_header);
+
+	return chunked;
+}
+
+/*! \brief Send the buffered chunk of a chunked response */
+static int http_chunked_flush(struct ast_http_chunked *chunked)
+{
+	if (!chunked->used) {
+		return 0;
+	}
+
+	if (ast_iostream_printf(chunked->ser->stream, "%zx\r\n", chunked->used) < 0
+		|| ast_iostream_write(chunked->ser->stream, chunked->buf, chunked->used) != chunked->used
+		|| ast_iostream_write(chunked->ser->stream, "\r\n", 2) != 2) {
+		ast_log(LOG_WARNING, "HTTP chunk write failed: %s\n", strerror(errno));
+		/* Nothing more can be sent on the connection. */
+		chunked->close_connection = 1;
+		chunked->send_content = 0;
+		chunked->used = 0;
+		return -1;
+	}
+	chunked->used = 0;
+	return 0;
+}
+
+int ast_http_chunked_write(struct ast_http_chunked *chunked, const char *buf, size_t len)
+{
+	size_t part;
+
+	if (!chunked->send_content) {
+		return chunked->close_connection ? -1 : 0;
+	}
+
+	while (len) {
+		part = MIN(len, sizeof(chunked->buf) - chunked->used);
+		memcpy(chunked->buf + chunked->used, buf, part);
+		chunked->used += part;
+		buf += part;
+		len -= part;
+
+		if (chunked->used == sizeof(chunked->buf) && http_chunked_flush(chunked)) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+void ast_http_chunked_end(struct ast_http_chunked *chunked)
+{
+	if (!chunked) {
+		return;
+	}
+
+	if (chunked->send_content && !http_chunked_flush(chunked)
+		&& ast_iostream_write(chunked->ser->stream, "0\r\n\r\n", 5) != 5) {
+		chunked->close_connection = 1;
+	}
+
+	if (chunked->close_connection) {
+		ast_debug(1, "HTTP closing session after chunked response\n");
+		ast_tcptls_close_session_file(chunked->ser);
+	}
+	ast_free(chunked);
+}
+
+void ast_http_chunked_abort(struct ast_http_chunked *chunked)
+{
+	if (!chunked) {
+		return;
+	}
+
+	/* Without the last chunk, the client knows the body is incomplete. */
+	ast_debug(1, "HTTP closing session on incomplete chunked response\n");
+	ast_tcptls_close_session_file(chunked->ser);
+	ast_free(chunked);
+}
+
 void ast_http_create_response(struct ast_tcptls_session_instance *ser, int status_code,
 	const char *status_title, struct ast_str *http_header_data, const char *text)
 {
@@ -1894,6 +2076,198 @@ static int httpd_process_request(struct ast_tcptls_session_instance *ser)
 	return res;
 }
 
+/*!
+ * \internal
+ * \brief Close a HTTP connection and release its session slot.
+ *
+ * \param ser HTTP TCP/TLS session object, whose reference is released.
+ */
+static void http_session_close(struct ast_tcptls_session_instance *ser)
+{
+	ast_atomic_fetchadd_int(&session_count, -1);
+
+	ast_debug(1, "HTTP closing session.  Top level\n");
+	ast_tcptls_close_session_file(ser);
+
+	ao2_ref(ser, -1);
+}
+
+/*!
+ * \internal
+ * \brief Hand an idle keep-alive connection to the idle thread.
+ *
+ * \param ser HTTP TCP/TLS session object, whose reference is taken over.
+ *
+ * \retval 0 if the connection is waiting for its next request.
+ * \retval -1 if the idle thread is not running.
+ */
+static int http_session_park(struct ast_tcptls_session_instance *ser)
+{
+	struct http_idle_session idle = {
+		.ser = ser,
+		.expires = ast_tvadd(ast_tvnow(), ast_samp2tv(session_keep_alive, 1000)),
+	};
+	int res;
+
+	ast_mutex_lock(&idle_lock);
+	res = idle_stop || idle_thread == AST_PTHREADT_NULL
+		|| AST_VECTOR_APPEND(&idle_sessions, idle);
+	ast_mutex_unlock(&idle_lock);
+	if (res) {
+		return -1;
+	}
+
+	if (write(idle_alert_pipe[1], "", 1) < 0 && errno != EAGAIN) {
+		ast_log(LOG_WARNING, "Unable to wake up the HTTP idle thread: %s\n", strerror(errno));
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Serve the requests of a HTTP connection.
+ *
+ * \param ser HTTP TCP/TLS session object, whose reference is taken over.
+ * \param timeout (ms) Time to wait for the next request to start.
+ *
+ * \details
+ * Requests already received, such as pipelined ones, are served right
+ * away.  Once there is nothing left to read, a connection served by the
+ * worker pool is parked until its next request arrives.
+ */
+static void http_session_serve(struct ast_tcptls_session_instance *ser, int timeout)
+{
+	for (;;) {
+		/* Wait for next potential HTTP request message. */
+		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
+		if (httpd_process_request(ser)) {
+			/* Break the connection or the connection closed */
+			break;
+		}
+		if (!ser->stream) {
+			/* Web-socket or similar that took the connection */
+			break;
+		}
+
+		timeout = session_keep_alive;
+		if (timeout <= 0) {
+			/* Persistent connections not enabled. */
+			break;
+		}
+
+		if (ser->parent->pool && !ast_iostream_pending(ser->stream)
+			&& !http_session_park(ser)) {
+			/* The idle thread now owns the connection. */
+			return;
+		}
+	}
+
+	http_session_close(ser);
+}
+
+/*! \brief Threadpool task serving a parked connection whose next request arrived */
+static int http_session_resume(void *data)
+{
+	http_session_serve(data, session_keep_alive);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Wait for input on idle keep-alive connections.
+ *
+ * \details
+ * A connection that becomes readable is handed back to the worker pool,
+ * and one that stays idle past its keep-alive time is closed.
+ */
+static void *http_idle_thread_fn(void *data)
+{
+	struct pollfd *fds = NULL;
+	size_t fds_size = 0;
+	char drain[64];
+
+	for (;;) {
+		struct timeval now;
+		size_t count;
+		size_t i;
+		int timeout = -1;
+		int res;
+
+		ast_mutex_lock(&idle_lock);
+		if (idle_stop) {
+			ast_mutex_unlock(&idle_lock);
+			break;
+		}
+
+		count = AST_VECTOR_SIZE(&idle_sessions);
+		if (count + 1 > fds_size) {
+			struct pollfd *grown = ast_realloc(fds, (count + 1) * sizeof(*fds));
+
+			if (!grown) {
+				ast_mutex_unlock(&idle_lock);
+				usleep(100000);
+				continue;
+			}
+			fds = grown;
+			fds_size = count + 1;
+		}
+
+		fds[0].fd = idle_alert_pipe[0];
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		now = ast_tvnow();
+		for (i = 0; i < count; ++i) {
+			struct http_idle_session *idle = AST_VECTOR_GET_ADDR(&idle_sessions, i);
+			int remaining = MAX(ast_tvdiff_ms(idle->expires, now), 0);
+
+			fds[i + 1].fd = ast_iostream_get_fd(idle->ser->stream);
+			fds[i + 1].events = POLLIN;
+			fds[i + 1].revents = 0;
+			if (timeout < 0 || remaining < timeout) {
+				timeout = remaining;
+			}
+		}
+		ast_mutex_unlock(&idle_lock);
+
+		res = ast_poll(fds, count + 1, timeout);
+		if (res < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "HTTP idle connection poll failed: %s\n", strerror(errno));
+			}
+			continue;
+		}
+		if (fds[0].revents) {
+			while (read(idle_alert_pipe[0], drain, sizeof(drain)) > 0) {
+			}
+		}
+
+		/*
+		 * Connections are only appended while we are polling, so the
+		 * first count of them still match fds.  Walking backwards keeps
+		 * the unordered removal from moving an unchecked one.
+		 */
+		ast_mutex_lock(&idle_lock);
+		now = ast_tvnow();
+		for (i = count; i-- > 0;) {
+			struct http_idle_session idle = AST_VECTOR_GET(&idle_sessions, i);
+
+			if (fds[i + 1].revents) {
+				AST_VECTOR_REMOVE_UNORDERED(&idle_sessions, i);
+				if (ast_threadpool_push(http_pool, http_session_resume, idle.ser)) {
+					http_session_close(idle.ser);
+				}
+			} else if (ast_tvdiff_ms(idle.expires, now) <= 0) {
+				AST_VECTOR_REMOVE_UNORDERED(&idle_sessions, i);
+				http_session_close(idle.ser);
+			}
+		}
+		ast_mutex_unlock(&idle_lock);
+	}
+
+	ast_free(fds);
+	return NULL;
+}
+
 static void *httpd_helper_thread(void *data)
 {
 	struct ast_tcptls_session_instance *ser = data;
@@ -1946,32 +2320,11 @@ static void *httpd_helper_thread(void *data)
 	/* We can let the stream wait for data to arrive. */
 	ast_iostream_set_exclusive_input(ser->stream, 1);
 
-	for (;;) {
-		/* Wait for next potential HTTP request message. */
-		ast_iostream_set_timeout_idle_inactivity(ser->stream, timeout, session_inactivity);
-		if (httpd_process_request(ser)) {
-			/* Break the connection or the connection closed */
-			break;
-		}
-		if (!ser->stream) {
-			/* Web-socket or similar that took the connection */
-			break;
-		}
-
-		timeout = session_keep_alive;
-		if (timeout <= 0) {
-			/* Persistent connections not enabled. */
-			break;
-		}
-	}
+	http_session_serve(ser, timeout);
+	return NULL;
 
 done:
-	ast_atomic_fetchadd_int(&session_count, -1);
-
-	ast_debug(1, "HTTP closing session.  Top level\n");
-	ast_tcptls_close_session_file(ser);
-
-	ao2_ref(ser, -1);
+	http_session_close(ser);
 	return NULL;
 }
 
@@ -2056,6 +2409,9 @@ static int __ast_http_load(int reload)
 	http_tls_was_enabled = (reload && http_tls_cfg.enabled);
 
 	http_tls_cfg.enabled = 0;
+	http_tls_cfg.session_cache_size = 0;
+	http_tls_cfg.session_timeout = 0;
+	ast_clear_flag(&http_tls_cfg.flags, AST_SSL_NO_SESSION_CACHE | AST_SSL_NO_SESSION_TICKETS);
 	if (http_tls_cfg.certfile) {
 		ast_free(http_tls_cfg.certfile);
 	}
@@ -2085,6 +2441,7 @@ static int __ast_http_load(int reload)
 	session_limit = DEFAULT_SESSION_LIMIT;
 	session_inactivity = DEFAULT_SESSION_INACTIVITY;
 	session_keep_alive = DEFAULT_SESSION_KEEP_ALIVE;
+	worker_pool_size = DEFAULT_WORKER_POOL_SIZE;
 
 	snprintf(server_name, sizeof(server_name), "Asterisk/%s", ast_get_version());
 
@@ -2150,6 +2507,12 @@ static int __ast_http_load(int reload)
 				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
 					v->name, v->value, v->lineno);
 			}
+		} else if (!strcasecmp(v->name, "worker_pool_size")) {
+			if (ast_parse_arg(v->value, PARSE_INT32 | PARSE_DEFAULT | PARSE_IN_RANGE,
+				&worker_pool_size, DEFAULT_WORKER_POOL_SIZE, 0, INT_MAX)) {
+				ast_log(LOG_WARNING, "Invalid %s '%s' at line %d of http.conf\n",
+					v->name, v->value, v->lineno);
+			}
 		} else {
 			ast_log(LOG_WARNING, "Ignoring unknown option '%s' in http.conf\n", v->name);
 		}
@@ -2157,6 +2520,12 @@ static int __ast_http_load(int reload)
 
 	ast_config_destroy(cfg);
 
+	if (http_pool) {
+		ast_threadpool_set_size(http_pool, worker_pool_size);
+	}
+	http_desc.pool = worker_pool_size ? http_pool : NULL;
+	https_desc.pool = worker_pool_size ? http_pool : NULL;
+
 	if (strcmp(prefix, newprefix)) {
 		ast_copy_string(prefix, newprefix, sizeof(prefix));
 	}
@@ -2239,8 +2608,15 @@ static char *handle_show_http(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 		ast_cli(a->fd, "Server Enabled and Bound to %s\n\n",
 			ast_sockaddr_stringify(&http_desc.old_address));
 		if (http_tls_cfg.enabled) {
-			ast_cli(a->fd, "HTTPS Server Enabled and Bound to %s\n\n",
+			struct ast_tls_handshake_stats stats;
+
+			ast_tcptls_handshake_stats(&https_desc, &stats);
+			ast_cli(a->fd, "HTTPS Server Enabled and Bound to %s\n",
 				ast_sockaddr_stringify(&https_desc.old_address));
+			ast_cli(a->fd, "HTTPS Handshakes: %lu (%lu resumed), %lu failed, %lu dropped\n",
+				stats.completed, stats.resumed, stats.failed, stats.dropped);
+			ast_cli(a->fd, "HTTPS Handshake Time: %lu us average, %lu us longest\n\n",
+				stats.completed ? stats.total_usec / stats.completed : 0, stats.max_usec);
 		}
 	}
 
@@ -2275,6 +2651,83 @@ static struct ast_cli_entry cli_http[] = {
 	AST_CLI_DEFINE(handle_show_http, "Display HTTP server status"),
 };
 
+/*!
+ * \internal
+ * \brief Start the worker pool and the idle connection thread.
+ *
+ * \details
+ * Without them, connections fall back to a thread each.
+ */
+static void http_idle_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = WORKER_IDLE_TIMEOUT,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = 0,
+	};
+	int flags;
+
+	if (AST_VECTOR_INIT(&idle_sessions, 32)) {
+		return;
+	}
+
+	if (pipe(idle_alert_pipe)) {
+		ast_log(LOG_WARNING, "Unable to create HTTP idle alert pipe: %s\n", strerror(errno));
+		idle_alert_pipe[0] = idle_alert_pipe[1] = -1;
+		return;
+	}
+	flags = fcntl(idle_alert_pipe[0], F_GETFL);
+	fcntl(idle_alert_pipe[0], F_SETFL, flags | O_NONBLOCK);
+	flags = fcntl(idle_alert_pipe[1], F_GETFL);
+	fcntl(idle_alert_pipe[1], F_SETFL, flags | O_NONBLOCK);
+
+	http_pool = ast_threadpool_create("http", NULL, &options);
+	if (!http_pool) {
+		return;
+	}
+
+	if (ast_pthread_create_background(&idle_thread, NULL, http_idle_thread_fn, NULL)) {
+		ast_log(LOG_WARNING, "Unable to start HTTP idle thread: %s\n", strerror(errno));
+		idle_thread = AST_PTHREADT_NULL;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Stop the idle connection thread and close the connections it holds.
+ *
+ * \note The worker pool itself is left running as workers may still be
+ * serving connections that were upgraded, such as websockets.
+ */
+static void http_idle_shutdown(void)
+{
+	int i;
+
+	ast_mutex_lock(&idle_lock);
+	idle_stop = 1;
+	ast_mutex_unlock(&idle_lock);
+
+	http_desc.pool = NULL;
+	https_desc.pool = NULL;
+
+	if (idle_thread != AST_PTHREADT_NULL) {
+		if (write(idle_alert_pipe[1], "", 1) < 0) {
+			ast_log(LOG_WARNING, "Unable to wake up the HTTP idle thread: %s\n", strerror(errno));
+		}
+		pthread_join(idle_thread, NULL);
+		idle_thread = AST_PTHREADT_NULL;
+	}
+
+	ast_mutex_lock(&idle_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&idle_sessions); ++i) {
+		http_session_close(AST_VECTOR_GET_ADDR(&idle_sessions, i)->ser);
+	}
+	AST_VECTOR_RESET(&idle_sessions, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	ast_mutex_unlock(&idle_lock);
+}
+
 static void http_shutdown(void)
 {
 	struct http_uri_redirect *redirect;
@@ -2284,6 +2737,7 @@ static void http_shutdown(void)
 	if (http_tls_cfg.enabled) {
 		ast_tcptls_server_stop(&https_desc);
 	}
+	http_idle_shutdown();
 	ast_free(http_tls_cfg.certfile);
 	ast_free(http_tls_cfg.pvtfile);
 	ast_free(http_tls_cfg.cipher);
@@ -2300,6 +2754,7 @@ static void http_shutdown(void)
 
 int ast_http_init(void)
 {
+	http_idle_init();
 	ast_http_uri_link(&statusuri);
 	ast_http_uri_link(&staticuri);
 	ast_cli_register_multiple(cli_http, ARRAY_LEN(cli_http));
@@ -47,6 +47,19 @@ void ast_iostream_nonblock(struct ast_iostream *stream)
 	fcntl(stream->fd, F_SETFL, fcntl(stream->fd, F_GETFL) | O_NONBLOCK);
 }
 
+size_t ast_iostream_pending(struct ast_iostream *stream)
+{
+	size_t pending = stream->rbuflen;
+
+#if defined(DO_SSL)
+	if (stream->ssl) {
+		pending += SSL_pending(stream->ssl);
+	}
+#endif	/* defined(DO_SSL) */
+
+	return pending;
+}
+
 SSL *ast_iostream_get_ssl(struct ast_iostream *stream)
 {
 	return stream->ssl;
@@ -402,6 +415,90 @@ ssize_t ast_iostream_write(struct ast_iostream *stream, const void *buf, size_t
 	}
 }
 
+ssize_t ast_iostream_writev(struct ast_iostream *stream, const struct iovec *iov, int iovcnt)
+{
+	struct iovec *remaining;
+	struct timeval start;
+	size_t total = 0;
+	ssize_t written = 0;
+	ssize_t res;
+	int ms;
+	int i;
+
+	if (!stream || stream->fd == -1) {
+		errno = EBADF;
+		return -1;
+	}
+
+	for (i = 0; i < iovcnt; ++i) {
+		total += iov[i].iov_len;
+	}
+	if (!total) {
+		return 0;
+	}
+
+#if defined(DO_SSL)
+	if (stream->ssl) {
+		for (i = 0; i < iovcnt; ++i) {
+			res = ast_iostream_write(stream, iov[i].iov_base, iov[i].iov_len);
+			if (res < 0) {
+				return written ? written : -1;
+			}
+			written += res;
+			if (res != iov[i].iov_len) {
+				/* Report partial write. */
+				break;
+			}
+		}
+		return written;
+	}
+#endif	/* defined(DO_SSL) */
+
+	if (stream->start.tv_sec) {
+		start = stream->start;
+	} else {
+		start = ast_tvnow();
+	}
+
+	/* Our copy of the buffers is advanced past what has been written. */
+	remaining = ast_alloca(iovcnt * sizeof(*remaining));
+	memcpy(remaining, iov, iovcnt * sizeof(*remaining));
+
+	for (;;) {
+		res = writev(stream->fd, remaining, iovcnt);
+		if (0 < res) {
+			written += res;
+			if (written == total) {
+				return total;
+			}
+			/* Skip the buffers written and trim the one written in part. */
+			while (res >= remaining->iov_len) {
+				res -= remaining->iov_len;
+				++remaining;
+				--iovcnt;
+			}
+			remaining->iov_base = (char *) remaining->iov_base + res;
+			remaining->iov_len -= res;
+			continue;
+		}
+		if (errno != EINTR && errno != EAGAIN) {
+			/* Not a retryable error. */
+			ast_debug(1, "TCP socket error writing: %s\n", strerror(errno));
+			if (written) {
+				return written;
+			}
+			return -1;
+		}
+		ms = ast_remaining_ms(start, stream->timeout);
+		if (!ms) {
+			/* Report partial write. */
+			ast_debug(1, "TCP timeout writing data\n");
+			return written;
+		}
+		ast_wait_for_output(stream->fd, ms);
+	}
+}
+
 ssize_t ast_iostream_printf(struct ast_iostream *stream, const void *fmt, ...)
 {
 	char sbuf[512], *buf = sbuf;
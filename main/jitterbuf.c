@@ -144,7 +144,7 @@ static int check_resync(jitterbuf *jb, long ts, long now, long ms, const enum jb
 			if ((jb->info.cnt_delay_discont > 3) || (type == JB_TYPE_CONTROL)) {
 				jb->info.cnt_delay_discont = 0;
 				jb->hist_ptr = 0;
-				jb->hist_maxbuf_valid = 0;
+				jb->hist_root = 0;
 				jb_warn("Resyncing the jb. last_delay %ld, this delay %ld, threshold %ld, new offset %ld\n", jb->info.last_delay, *delay, threshold, ts - now);
 				jb->info.resync_offset = ts - now;
 				jb->info.last_delay = *delay = 0; /* after resync, frame is right on time */
@@ -160,136 +160,151 @@ static int check_resync(jitterbuf *jb, long ts, long now, long ms, const enum jb
 	return 0;
 }
 
-static int history_put(jitterbuf *jb, long ts, long now, long ms, long delay)
+/*
+ * The history is kept in a treap, ordered by delay and keyed by history
+ * index for equal delays, so the n'th highest and lowest delays can be found
+ * in O(log n) without sorting the history again.  Nodes are referred to by
+ * history index + 1, leaving 0 for the empty tree.
+ */
+
+/*! \brief treap priority of a history entry, fixed and well spread over the entries */
+static unsigned int history_priority(int node)
 {
-	long kicked;
+	return (unsigned int) node * 2654435761U;
+}
 
-	/* don't add special/negative times to history */
-	if (ts <= 0)
-		return 0;
+static int history_size(const jitterbuf *jb, int node)
+{
+	return node ? jb->hist_tree[node - 1].size : 0;
+}
 
-	kicked = jb->history[jb->hist_ptr % JB_HISTORY_SZ];
+static void history_update(jitterbuf *jb, int node)
+{
+	jb_hist_node *n = &jb->hist_tree[node - 1];
 
-	jb->history[(jb->hist_ptr++) % JB_HISTORY_SZ] = delay;
+	n->size = 1 + history_size(jb, n->left) + history_size(jb, n->right);
+}
 
-	/* optimization; the max/min buffers don't need to be recalculated, if this packet's
-	 * entry doesn't change them.  This happens if this packet is not involved, _and_ any packet
-	 * that got kicked out of the history is also not involved
-	 * We do a number of comparisons, but it's probably still worthwhile, because it will usually
-	 * succeed, and should be a lot faster than going through all 500 packets in history */
-	if (!jb->hist_maxbuf_valid)
-		return 0;
+/*! \brief does node a order before node b? */
+static int history_before(const jitterbuf *jb, int a, int b)
+{
+	long da = jb->history[a - 1];
+	long db = jb->history[b - 1];
 
-	/* don't do this until we've filled history
-	 * (reduces some edge cases below) */
-	if (jb->hist_ptr < JB_HISTORY_SZ)
-		goto invalidate;
+	return da < db || (da == db && a < b);
+}
 
-	/* if the new delay would go into min */
-	if (delay < jb->hist_minbuf[JB_HISTORY_MAXBUF_SZ-1])
-		goto invalidate;
+/*! \brief split tree into the nodes ordering before key and the rest */
+static void history_split(jitterbuf *jb, int tree, int key, int *before, int *rest)
+{
+	if (!tree) {
+		*before = *rest = 0;
+		return;
+	}
+
+	if (history_before(jb, tree, key)) {
+		history_split(jb, jb->hist_tree[tree - 1].right, key, &jb->hist_tree[tree - 1].right, rest);
+		*before = tree;
+	} else {
+		history_split(jb, jb->hist_tree[tree - 1].left, key, before, &jb->hist_tree[tree - 1].left);
+		*rest = tree;
+	}
+	history_update(jb, tree);
+}
 
-	/* or max.. */
-	if (delay > jb->hist_maxbuf[JB_HISTORY_MAXBUF_SZ-1])
-		goto invalidate;
+/*! \brief merge two trees, where every node of before orders before every node of after */
+static int history_merge(jitterbuf *jb, int before, int after)
+{
+	if (!before || !after) {
+		return before ? before : after;
+	}
 
-	/* or the kicked delay would be in min */
-	if (kicked <= jb->hist_minbuf[JB_HISTORY_MAXBUF_SZ-1])
-		goto invalidate;
+	if (history_priority(before) > history_priority(after)) {
+		jb->hist_tree[before - 1].right = history_merge(jb, jb->hist_tree[before - 1].right, after);
+		history_update(jb, before);
+		return before;
+	}
 
-	if (kicked >= jb->hist_maxbuf[JB_HISTORY_MAXBUF_SZ-1])
-		goto invalidate;
+	jb->hist_tree[after - 1].left = history_merge(jb, before, jb->hist_tree[after - 1].left);
+	history_update(jb, after);
+	return after;
+}
 
-	/* if we got here, we don't need to invalidate, 'cause this delay didn't
-	 * affect things */
-	return 0;
-	/* end optimization */
+static void history_insert(jitterbuf *jb, int node)
+{
+	int before, rest;
 
+	jb->hist_tree[node - 1].left = jb->hist_tree[node - 1].right = 0;
+	jb->hist_tree[node - 1].size = 1;
 
-invalidate:
-	jb->hist_maxbuf_valid = 0;
-	return 0;
+	history_split(jb, jb->hist_root, node, &before, &rest);
+	jb->hist_root = history_merge(jb, history_merge(jb, before, node), rest);
 }
 
-static void history_calc_maxbuf(jitterbuf *jb)
+/*! \brief remove node from tree, returning the new root of tree */
+static int history_remove(jitterbuf *jb, int tree, int node)
 {
-	int i,j;
+	jb_hist_node *n;
 
-	if (jb->hist_ptr == 0)
-		return;
+	if (!tree) {
+		return 0;
+	}
 
+	n = &jb->hist_tree[tree - 1];
+	if (tree == node) {
+		return history_merge(jb, n->left, n->right);
+	}
 
-	/* initialize maxbuf/minbuf to the latest value */
-	for (i=0;i<JB_HISTORY_MAXBUF_SZ;i++) {
-/*
- * jb->hist_maxbuf[i] = jb->history[(jb->hist_ptr-1) % JB_HISTORY_SZ];
- * jb->hist_minbuf[i] = jb->history[(jb->hist_ptr-1) % JB_HISTORY_SZ];
- */
-		jb->hist_maxbuf[i] = JB_LONGMIN;
-		jb->hist_minbuf[i] = JB_LONGMAX;
+	if (history_before(jb, node, tree)) {
+		n->left = history_remove(jb, n->left, node);
+	} else {
+		n->right = history_remove(jb, n->right, node);
 	}
+	history_update(jb, tree);
+	return tree;
+}
 
-	/* use insertion sort to populate maxbuf */
-	/* we want it to be the top "n" values, in order */
+/*! \brief the delay ranking rank'th lowest in the history, counting from 0 */
+static long history_select(const jitterbuf *jb, int rank)
+{
+	int node = jb->hist_root;
 
-	/* start at the beginning, or JB_HISTORY_SZ frames ago */
-	i = (jb->hist_ptr > JB_HISTORY_SZ) ? (jb->hist_ptr - JB_HISTORY_SZ) : 0;
+	while (node) {
+		const jb_hist_node *n = &jb->hist_tree[node - 1];
+		int left = history_size(jb, n->left);
 
-	for (;i<jb->hist_ptr;i++) {
-		long toins = jb->history[i % JB_HISTORY_SZ];
+		if (rank < left) {
+			node = n->left;
+		} else if (rank == left) {
+			break;
+		} else {
+			rank -= left + 1;
+			node = n->right;
+		}
+	}
 
-		/* if the maxbuf should get this */
-		if (toins > jb->hist_maxbuf[JB_HISTORY_MAXBUF_SZ-1])  {
+	return node ? jb->history[node - 1] : 0;
+}
 
-			/* insertion-sort it into the maxbuf */
-			for (j=0;j<JB_HISTORY_MAXBUF_SZ;j++) {
-				/* found where it fits */
-				if (toins > jb->hist_maxbuf[j]) {
-					/* move over */
-					if (j != JB_HISTORY_MAXBUF_SZ - 1) {
-						memmove(jb->hist_maxbuf + j + 1, jb->hist_maxbuf + j, (JB_HISTORY_MAXBUF_SZ - (j + 1)) * sizeof(jb->hist_maxbuf[0]));
-					}
-					/* insert */
-					jb->hist_maxbuf[j] = toins;
+static int history_put(jitterbuf *jb, long ts, long now, long ms, long delay)
+{
+	int node;
 
-					break;
-				}
-			}
-		}
+	/* don't add special/negative times to history */
+	if (ts <= 0)
+		return 0;
 
-		/* if the minbuf should get this */
-		if (toins < jb->hist_minbuf[JB_HISTORY_MAXBUF_SZ-1])  {
-
-			/* insertion-sort it into the maxbuf */
-			for (j=0;j<JB_HISTORY_MAXBUF_SZ;j++) {
-				/* found where it fits */
-				if (toins < jb->hist_minbuf[j]) {
-					/* move over */
-					if (j != JB_HISTORY_MAXBUF_SZ - 1) {
-						memmove(jb->hist_minbuf + j + 1, jb->hist_minbuf + j, (JB_HISTORY_MAXBUF_SZ - (j + 1)) * sizeof(jb->hist_minbuf[0]));
-					}
-					/* insert */
-					jb->hist_minbuf[j] = toins;
-
-					break;
-				}
-			}
-		}
+	node = jb->hist_ptr % JB_HISTORY_SZ + 1;
 
-		if (0) {
-			int k;
-			fprintf(stderr, "toins = %ld\n", toins);
-			fprintf(stderr, "maxbuf =");
-			for (k=0;k<JB_HISTORY_MAXBUF_SZ;k++)
-				fprintf(stderr, "%ld ", jb->hist_maxbuf[k]);
-			fprintf(stderr, "\nminbuf =");
-			for (k=0;k<JB_HISTORY_MAXBUF_SZ;k++)
-				fprintf(stderr, "%ld ", jb->hist_minbuf[k]);
-			fprintf(stderr, "\n");
-		}
-	}
+	/* kick the oldest delay out of the window once history is full */
+	if (jb->hist_ptr >= JB_HISTORY_SZ)
+		jb->hist_root = history_remove(jb, jb->hist_root, node);
 
-	jb->hist_maxbuf_valid = 1;
+	jb->history[node - 1] = delay;
+	jb->hist_ptr++;
+	history_insert(jb, node);
+
+	return 0;
 }
 
 static void history_get(jitterbuf *jb)
@@ -298,9 +313,6 @@ static void history_get(jitterbuf *jb)
 	int idx;
 	int count;
 
-	if (!jb->hist_maxbuf_valid)
-		history_calc_maxbuf(jb);
-
 	/* count is how many items in history we're examining */
 	count = (jb->hist_ptr < JB_HISTORY_SZ) ? jb->hist_ptr : JB_HISTORY_SZ;
 
@@ -311,24 +323,17 @@ static void history_get(jitterbuf *jb)
 	if (idx > (JB_HISTORY_MAXBUF_SZ - 1))
 		idx = JB_HISTORY_MAXBUF_SZ - 1;
 
-	if (idx < 0) {
+	if (idx < 0 || !count) {
 		jb->info.min = 0;
 		jb->info.jitter = 0;
 		return;
 	}
 
-	max = jb->hist_maxbuf[idx];
-	min = jb->hist_minbuf[idx];
+	max = history_select(jb, count - 1 - idx);
+	min = history_select(jb, idx);
 
 	jitter = max - min;
 
-	/* these debug stmts compare the difference between looking at the absolute jitter, and the
-	 * values we get by throwing away the outliers */
-	/*
-	fprintf(stderr, "[%d] min=%d, max=%d, jitter=%d\n", index, min, max, jitter);
-	fprintf(stderr, "[%d] min=%d, max=%d, jitter=%d\n", 0, jb->hist_minbuf[0], jb->hist_maxbuf[0], jb->hist_maxbuf[0]-jb->hist_minbuf[0]);
-	*/
-
 	jb->info.min = min;
 	jb->info.jitter = jitter;
 }
@@ -47,24 +47,150 @@
 /*! \brief Magic number, for safety checks. */
 #define JSON_MAGIC 0x1541992
 
+/*! \brief Size of the chunks arenas carve their blocks from */
+#define JSON_ARENA_CHUNK_SIZE 4096
+
+/*! \brief Allocations larger than this are not carved from an arena */
+#define JSON_ARENA_MAX_BLOCK (JSON_ARENA_CHUNK_SIZE / 4)
+
 /*! \brief Internal structure for allocated memory blocks */
 struct json_mem {
 	/*! Magic number, for safety checks */
 	uint32_t magic;
-	/*! Mutext for locking this memory block */
-	ast_mutex_t mutex;
+	/*! Mutex for locking this memory block, shared by the blocks of an arena */
+	ast_mutex_t *mutex;
+	/*! Arena the block was carved from, \c NULL if it was allocated on its own */
+	struct ast_json_arena *arena;
 	/*! Linked list pointer for the free list */
 	AST_LIST_ENTRY(json_mem) list;
 	/*! Data section of the allocation; void pointer for proper alignment */
 	void *data[];
 };
 
+/*! \brief A block allocated on its own, with its own mutex */
+struct json_mem_single {
+	/*! Mutex for locking this memory block */
+	ast_mutex_t mutex;
+	struct json_mem mem;
+};
+
+/*! \brief A chunk of memory blocks are carved from */
+struct json_arena_chunk {
+	AST_LIST_ENTRY(json_arena_chunk) list;
+	/*! Data section of the chunk; void pointer for proper alignment */
+	void *data[];
+};
+
+/*!
+ * \brief Memory the JSON built by a thread is carved from, freed at once.
+ *
+ * The blocks of an arena share its mutex.  It is freed once it has ended
+ * and every block carved from it has been freed, by whichever thread frees
+ * the last one.
+ */
+struct ast_json_arena {
+	/*! Mutex for locking all the blocks of the arena */
+	ast_mutex_t mutex;
+	/*! Blocks not freed yet, plus one until the arena ends */
+	unsigned int refs;
+	/*! Arena that was current on the thread before this one */
+	struct ast_json_arena *prev;
+	/*! Next free byte of the newest chunk */
+	char *next;
+	/*! Bytes left in the newest chunk */
+	size_t left;
+	/*! Chunks of the arena, newest first */
+	AST_LIST_HEAD_NOLOCK(, json_arena_chunk) chunks;
+};
+
+/*! \brief Thread local state of the allocator */
+struct json_thread_state {
+	/*! \ref json_mem blocks to free at the end of an unref */
+	AST_LIST_HEAD_NOLOCK(, json_mem) free_list;
+	/*! Arena blocks are carved from, \c NULL to allocate them on their own */
+	struct ast_json_arena *arena;
+};
+
+AST_THREADSTORAGE(json_thread_state_ts);
+
+/*! \brief Get the thread local state of the allocator */
+static struct json_thread_state *json_thread_state(void)
+{
+	return ast_threadstorage_get(&json_thread_state_ts,
+		sizeof(struct json_thread_state));
+}
+
+/*! \brief Free an arena and all of its chunks. */
+static void json_arena_destroy(struct ast_json_arena *arena)
+{
+	struct json_arena_chunk *chunk;
+
+	while ((chunk = AST_LIST_REMOVE_HEAD(&arena->chunks, list))) {
+		ast_free(chunk);
+	}
+	ast_mutex_destroy(&arena->mutex);
+	ast_free(arena);
+}
+
+/*! \brief Drop a reference to an arena, freeing it with the last one. */
+static void json_arena_release(struct ast_json_arena *arena)
+{
+	if (!__atomic_sub_fetch(&arena->refs, 1, __ATOMIC_ACQ_REL)) {
+		json_arena_destroy(arena);
+	}
+}
+
+/*!
+ * \brief Carve a block from an arena.
+ *
+ * Only the thread the arena is current on carves from it.
+ *
+ * \return \ref json_mem of the block.
+ * \return \c NULL on error.
+ */
+static struct json_mem *json_arena_carve(struct ast_json_arena *arena, size_t size)
+{
+	struct json_arena_chunk *chunk;
+	struct json_mem *mem;
+	size_t chunk_size;
+
+	/* Keep every block aligned like the data of the block before it. */
+	size = (sizeof(*mem) + size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+
+	if (arena->left < size) {
+		chunk_size = JSON_ARENA_CHUNK_SIZE - sizeof(*chunk);
+		chunk = ast_malloc(sizeof(*chunk) + chunk_size);
+		if (!chunk) {
+			return NULL;
+		}
+		AST_LIST_INSERT_HEAD(&arena->chunks, chunk, list);
+		arena->next = (char *) chunk->data;
+		arena->left = chunk_size;
+	}
+
+	mem = (struct json_mem *) arena->next;
+	arena->next += size;
+	arena->left -= size;
+
+	mem->magic = JSON_MAGIC;
+	mem->mutex = &arena->mutex;
+	mem->arena = arena;
+	__atomic_add_fetch(&arena->refs, 1, __ATOMIC_RELAXED);
+
+	return mem;
+}
+
 /*! \brief Free a \ref json_mem block. */
 static void json_mem_free(struct json_mem *mem)
 {
 	mem->magic = 0;
-	ast_mutex_destroy(&mem->mutex);
-	ast_free(mem);
+	if (mem->arena) {
+		json_arena_release(mem->arena);
+		return;
+	}
+
+	ast_mutex_destroy(mem->mutex);
+	ast_free((char *) mem - offsetof(struct json_mem_single, mem));
 }
 
 /*!
@@ -107,7 +233,7 @@ static struct json_mem *json_mem_lock(struct ast_json *json)
 	if (!mem) {
 		return NULL;
 	}
-	ast_mutex_lock(&mem->mutex);
+	ast_mutex_lock(mem->mutex);
 	return mem;
 }
 
@@ -121,7 +247,7 @@ static void json_mem_unlock(struct json_mem *mem)
 	if (!mem) {
 		return;
 	}
-	ast_mutex_unlock(&mem->mutex);
+	ast_mutex_unlock(mem->mutex);
 }
 
 /*!
@@ -135,36 +261,31 @@ static void json_mem_unlock(struct json_mem *mem)
 
 void *ast_json_malloc(size_t size)
 {
-	struct json_mem *mem = ast_malloc(size + sizeof(*mem));
-	if (!mem) {
+	struct json_thread_state *state;
+	struct json_mem_single *single;
+	struct json_mem *mem;
+
+	if (size <= JSON_ARENA_MAX_BLOCK && (state = json_thread_state()) && state->arena) {
+		mem = json_arena_carve(state->arena, size);
+		return mem ? mem->data : NULL;
+	}
+
+	single = ast_malloc(sizeof(*single) + size);
+	if (!single) {
 		return NULL;
 	}
+	mem = &single->mem;
 	mem->magic = JSON_MAGIC;
-	ast_mutex_init(&mem->mutex);
+	ast_mutex_init(&single->mutex);
+	mem->mutex = &single->mutex;
+	mem->arena = NULL;
 	return mem->data;
 }
 
-AST_THREADSTORAGE(json_free_list_ts);
-
-/*!
- * \brief Struct for a linked list of \ref json_mem.
- */
-AST_LIST_HEAD_NOLOCK(json_mem_list, json_mem);
-
-/*!
- * \brief Thread local list of \ref json_mem blocks to free at the end of an
- * unref.
- */
-static struct json_mem_list *json_free_list(void)
-{
-	return ast_threadstorage_get(&json_free_list_ts,
-		sizeof(struct json_mem_list));
-}
-
 void ast_json_free(void *p)
 {
 	struct json_mem *mem;
-	struct json_mem_list *free_list;
+	struct json_thread_state *state;
 	mem = to_json_mem(p);
 
 	if (!mem) {
@@ -175,8 +296,8 @@ void ast_json_free(void *p)
 	 * immediately. Store it off on a thread local list to be freed by
 	 * ast_json_unref().
 	 */
-	free_list = json_free_list();
-	if (!free_list) {
+	state = json_thread_state();
+	if (!state) {
 		ast_log(LOG_ERROR, "Error allocating free list\n");
 		ast_assert(0);
 		/* It's not ideal to free the memory immediately, but that's the
@@ -185,7 +306,46 @@ void ast_json_free(void *p)
 		return;
 	}
 
-	AST_LIST_INSERT_HEAD(free_list, mem, list);
+	AST_LIST_INSERT_HEAD(&state->free_list, mem, list);
+}
+
+struct ast_json_arena *ast_json_arena_begin(void)
+{
+	struct json_thread_state *state = json_thread_state();
+	struct ast_json_arena *arena;
+
+	if (!state) {
+		return NULL;
+	}
+
+	arena = ast_calloc(1, sizeof(*arena));
+	if (!arena) {
+		return NULL;
+	}
+	ast_mutex_init(&arena->mutex);
+	arena->refs = 1;
+
+	arena->prev = state->arena;
+	state->arena = arena;
+
+	return arena;
+}
+
+void ast_json_arena_end(struct ast_json_arena *arena)
+{
+	struct json_thread_state *state;
+
+	if (!arena) {
+		return;
+	}
+
+	state = json_thread_state();
+	ast_assert(state && state->arena == arena);
+	if (state) {
+		state->arena = arena->prev;
+	}
+
+	json_arena_release(arena);
 }
 
 void ast_json_set_alloc_funcs(void *(*malloc_fn)(size_t), void (*free_fn)(void*))
@@ -208,7 +368,7 @@ struct ast_json *ast_json_ref(struct ast_json *json)
 
 void ast_json_unref(struct ast_json *json)
 {
-	struct json_mem_list *free_list;
+	struct json_thread_state *state;
 	struct json_mem *mem;
 
 	if (!json) {
@@ -224,12 +384,12 @@ void ast_json_unref(struct ast_json *json)
 
 	/* Now free any objects that were ast_json_free()'s while the lock was
 	 * held */
-	free_list = json_free_list();
-	if (!free_list) {
+	state = json_thread_state();
+	if (!state) {
 		return;
 	}
 
-	while ((mem = AST_LIST_REMOVE_HEAD(free_list, list))) {
+	while ((mem = AST_LIST_REMOVE_HEAD(&state->free_list, list))) {
 		json_mem_free(mem);
 	}
 }
@@ -733,6 +893,315 @@ int ast_json_dump_new_file_format(struct ast_json *root, const char *path, enum
 	return json_dump_file((json_t *)root, path, dump_flags(format));
 }
 
+/*! \brief Deepest nesting of containers a JSON stream supports */
+#define JSON_STREAM_MAX_DEPTH 32
+
+struct ast_json_stream {
+	/*! Function the encoded JSON is written with */
+	ast_json_stream_write_fn write;
+	/*! Data passed to write */
+	void *data;
+	/*! Format of the encoded JSON */
+	enum ast_json_encoding_format format;
+	/*! Number of open containers */
+	int depth;
+	/*! Non-zero once a write failed or the stream was misused */
+	int error;
+	/*! Non-zero after a key, until its value */
+	int after_key;
+	/*! For each open container, non-zero once it has a member */
+	char started[JSON_STREAM_MAX_DEPTH];
+	/*! For each open container, non-zero if it is an object */
+	char is_object[JSON_STREAM_MAX_DEPTH];
+};
+
+struct ast_json_stream *ast_json_stream_create(enum ast_json_encoding_format format,
+	ast_json_stream_write_fn write, void *data)
+{
+	struct ast_json_stream *stream = ast_calloc(1, sizeof(*stream));
+
+	if (!stream) {
+		return NULL;
+	}
+	stream->write = write;
+	stream->data = data;
+	stream->format = format;
+
+	return stream;
+}
+
+void ast_json_stream_free(struct ast_json_stream *stream)
+{
+	ast_free(stream);
+}
+
+/*! \brief Write to a stream, remembering any failure */
+static int json_stream_put(struct ast_json_stream *stream, const char *buf, size_t len)
+{
+	if (stream->error) {
+		return -1;
+	}
+	if (len && stream->write(buf, len, stream->data)) {
+		stream->error = 1;
+		return -1;
+	}
+	return 0;
+}
+
+/*! \brief Start a new line at the indentation of the open containers */
+static int json_stream_indent(struct ast_json_stream *stream)
+{
+	static const char spaces[] = "                                ";
+	int width = stream->depth * 2;
+
+	if (stream->format != AST_JSON_PRETTY) {
+		return 0;
+	}
+	if (json_stream_put(stream, "\n", 1)) {
+		return -1;
+	}
+	while (width > 0) {
+		int len = MIN(width, sizeof(spaces) - 1);
+
+		if (json_stream_put(stream, spaces, len)) {
+			return -1;
+		}
+		width -= len;
+	}
+	return 0;
+}
+
+/*! \brief Write what separates a new member from the one before it */
+static int json_stream_member(struct ast_json_stream *stream)
+{
+	if (stream->error) {
+		return -1;
+	}
+	if (stream->after_key) {
+		stream->after_key = 0;
+		return 0;
+	}
+	if (!stream->depth) {
+		return 0;
+	}
+	if (stream->is_object[stream->depth - 1]) {
+		/* Members of objects need a key. */
+		ast_assert(0);
+		stream->error = 1;
+		return -1;
+	}
+	if (stream->started[stream->depth - 1] && json_stream_put(stream, ",", 1)) {
+		return -1;
+	}
+	stream->started[stream->depth - 1] = 1;
+	return json_stream_indent(stream);
+}
+
+/*! \brief Write a string, escaped and quoted */
+static int json_stream_string(struct ast_json_stream *stream, const char *str)
+{
+	const char *start = str;
+	char escape[8];
+
+	if (json_stream_put(stream, "\"", 1)) {
+		return -1;
+	}
+	for (; *str; ++str) {
+		unsigned char c = *str;
+
+		if (c >= 0x20 && c != '"' && c != '\\') {
+			continue;
+		}
+		if (json_stream_put(stream, start, str - start)) {
+			return -1;
+		}
+		switch (c) {
+		case '"':
+		case '\\':
+			snprintf(escape, sizeof(escape), "\\%c", c);
+			break;
+		case '\n':
+			strcpy(escape, "\\n");
+			break;
+		case '\r':
+			strcpy(escape, "\\r");
+			break;
+		case '\t':
+			strcpy(escape, "\\t");
+			break;
+		default:
+			snprintf(escape, sizeof(escape), "\\u%04X", c);
+			break;
+		}
+		if (json_stream_put(stream, escape, strlen(escape))) {
+			return -1;
+		}
+		start = str + 1;
+	}
+	if (json_stream_put(stream, start, str - start)) {
+		return -1;
+	}
+	return json_stream_put(stream, "\"", 1);
+}
+
+/*! \brief Open a container */
+static int json_stream_start(struct ast_json_stream *stream, int is_object)
+{
+	if (json_stream_member(stream)) {
+		return -1;
+	}
+	if (stream->depth == JSON_STREAM_MAX_DEPTH) {
+		ast_log(LOG_ERROR, "JSON stream nested too deep\n");
+		stream->error = 1;
+		return -1;
+	}
+	if (json_stream_put(stream, is_object ? "{" : "[", 1)) {
+		return -1;
+	}
+	stream->started[stream->depth] = 0;
+	stream->is_object[stream->depth] = is_object;
+	++stream->depth;
+	return 0;
+}
+
+/*! \brief Close a container */
+static int json_stream_end(struct ast_json_stream *stream, int is_object)
+{
+	if (stream->error) {
+		return -1;
+	}
+	if (!stream->depth || stream->after_key
+		|| stream->is_object[stream->depth - 1] != is_object) {
+		ast_assert(0);
+		stream->error = 1;
+		return -1;
+	}
+	--stream->depth;
+	if (stream->started[stream->depth] && json_stream_indent(stream)) {
+		return -1;
+	}
+	return json_stream_put(stream, is_object ? "}" : "]", 1);
+}
+
+int ast_json_stream_array_start(struct ast_json_stream *stream)
+{
+	return json_stream_start(stream, 0);
+}
+
+int ast_json_stream_array_end(struct ast_json_stream *stream)
+{
+	return json_stream_end(stream, 0);
+}
+
+int ast_json_stream_object_start(struct ast_json_stream *stream)
+{
+	return json_stream_start(stream, 1);
+}
+
+int ast_json_stream_object_end(struct ast_json_stream *stream)
+{
+	return json_stream_end(stream, 1);
+}
+
+int ast_json_stream_key(struct ast_json_stream *stream, const char *key)
+{
+	if (stream->error) {
+		return -1;
+	}
+	if (!stream->depth || !stream->is_object[stream->depth - 1] || stream->after_key) {
+		ast_assert(0);
+		stream->error = 1;
+		return -1;
+	}
+	if (stream->started[stream->depth - 1] && json_stream_put(stream, ",", 1)) {
+		return -1;
+	}
+	stream->started[stream->depth - 1] = 1;
+	if (json_stream_indent(stream) || json_stream_string(stream, key)) {
+		return -1;
+	}
+	if (json_stream_put(stream, stream->format == AST_JSON_PRETTY ? ": " : ":",
+			stream->format == AST_JSON_PRETTY ? 2 : 1)) {
+		return -1;
+	}
+	stream->after_key = 1;
+	return 0;
+}
+
+/*!
+ * \brief Write the encoding of a nested container, indented to its depth.
+ *
+ * Jansson indents as if the container was the whole document.
+ */
+static int json_stream_dump_cb(const char *buffer, size_t size, void *data)
+{
+	struct ast_json_stream *stream = data;
+	const char *newline;
+
+	if (stream->format != AST_JSON_PRETTY) {
+		return json_stream_put(stream, buffer, size);
+	}
+
+	while ((newline = memchr(buffer, '\n', size))) {
+		size_t len = newline - buffer;
+
+		if (json_stream_put(stream, buffer, len) || json_stream_indent(stream)) {
+			return -1;
+		}
+		buffer += len + 1;
+		size -= len + 1;
+	}
+	return json_stream_put(stream, buffer, size);
+}
+
+int ast_json_stream_value(struct ast_json_stream *stream, struct ast_json *value)
+{
+	char buf[64];
+
+	if (json_stream_member(stream)) {
+		return -1;
+	}
+
+	switch (ast_json_typeof(value)) {
+	case AST_JSON_OBJECT:
+	case AST_JSON_ARRAY:
+		{
+			/* Jansson's json_dump* is not thread safe for concurrent reads. */
+			SCOPED_JSON_LOCK(value);
+
+			if (json_dump_callback((json_t *) value, json_stream_dump_cb, stream,
+					dump_flags(stream->format))) {
+				stream->error = 1;
+				return -1;
+			}
+		}
+		return 0;
+	case AST_JSON_STRING:
+		return json_stream_string(stream, ast_json_string_get(value));
+	case AST_JSON_INTEGER:
+		snprintf(buf, sizeof(buf), "%jd", ast_json_integer_get(value));
+		break;
+	case AST_JSON_REAL:
+		snprintf(buf, sizeof(buf), "%.17g", ast_json_real_get(value));
+		if (!strpbrk(buf, ".eE")) {
+			/* Keep it a real when read back. */
+			strcat(buf, ".0");
+		}
+		break;
+	case AST_JSON_TRUE:
+		strcpy(buf, "true");
+		break;
+	case AST_JSON_FALSE:
+		strcpy(buf, "false");
+		break;
+	case AST_JSON_NULL:
+		strcpy(buf, "null");
+		break;
+	}
+
+	return json_stream_put(stream, buf, strlen(buf));
+}
+
 /*!
  * \brief Copy Jansson error struct to ours.
  */
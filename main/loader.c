@@ -130,6 +130,7 @@ struct ast_module {
 		unsigned int declined:1;
 		unsigned int keepuntilshutdown:1;
 	} flags;
+	int64_t load_time;				/* microseconds spent in the module's load() */
 	AST_LIST_ENTRY(ast_module) list_entry;
 	AST_DLLIST_ENTRY(ast_module) entry;
 	char resource[0];
@@ -1006,6 +1007,7 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 {
 	char tmp[256];
 	enum ast_module_load_result res;
+	struct timeval start;
 
 	if (mod->flags.running) {
 		return AST_MODULE_LOAD_SUCCESS;
@@ -1018,7 +1020,9 @@ static enum ast_module_load_result start_resource(struct ast_module *mod)
 	if (!ast_fully_booted) {
 		ast_verb(1, "Loading %s.\n", mod->resource);
 	}
+	start = ast_tvnow();
 	res = mod->info->load();
+	mod->load_time = ast_tvdiff_us(ast_tvnow(), start);
 
 	switch (res) {
 	case AST_MODULE_LOAD_SUCCESS:
@@ -1158,13 +1162,16 @@ static struct load_order_entry *add_to_load_order(const char *resource, struct l
 	return order;
 }
 
-static int mod_load_cmp(void *a, void *b)
+static int mod_load_pri(const struct ast_module *mod)
 {
-	struct ast_module *a_mod = (struct ast_module *) a;
-	struct ast_module *b_mod = (struct ast_module *) b;
 	/* if load_pri is not set, default is 128.  Lower is better */
-	int a_pri = ast_test_flag(a_mod->info, AST_MODFLAG_LOAD_ORDER) ? a_mod->info->load_pri : 128;
-	int b_pri = ast_test_flag(b_mod->info, AST_MODFLAG_LOAD_ORDER) ? b_mod->info->load_pri : 128;
+	return ast_test_flag(mod->info, AST_MODFLAG_LOAD_ORDER) ? mod->info->load_pri : 128;
+}
+
+static int mod_load_cmp(void *a, void *b)
+{
+	int a_pri = mod_load_pri(a);
+	int b_pri = mod_load_pri(b);
 
 	/*
 	 * Returns comparison values for a min-heap
@@ -1177,6 +1184,188 @@ static int mod_load_cmp(void *a, void *b)
 
 AST_LIST_HEAD_NOLOCK(load_retries, load_order_entry);
 
+/*!
+ * \internal
+ * \brief Start a module popped from the priority heap, counting it if it loaded.
+ *
+ * \retval 0 if the module loaded or declined to load.
+ * \retval -1 if the module failed to load.
+ */
+static int start_resource_counted(struct ast_module *mod, unsigned int global_symbols, int *count)
+{
+	enum ast_module_load_result lres;
+
+	lres = start_resource(mod);
+	ast_debug(3, "START: %-46s %d %d\n", mod->resource, lres, global_symbols);
+	switch (lres) {
+	case AST_MODULE_LOAD_SUCCESS:
+		(*count)++;
+	case AST_MODULE_LOAD_DECLINE:
+		break;
+	case AST_MODULE_LOAD_FAILURE:
+		return -1;
+	case AST_MODULE_LOAD_SKIP:
+	case AST_MODULE_LOAD_PRIORITY:
+		break;
+	}
+
+	return 0;
+}
+
+/*! Modules of one load priority started together by load_tier_parallel() */
+struct load_tier {
+	/*! Modules to start */
+	struct ast_module **mods;
+	/*! Result of starting each module */
+	enum ast_module_load_result *results;
+	/*! Number of modules */
+	int count;
+	/*! Next module for a worker to start */
+	int next;
+	/*! Modules not started yet */
+	int pending;
+	/*! Signalled when the last module has been started */
+	ast_cond_t done;
+};
+
+/*!
+ * \internal
+ * \brief Start the modules of a tier until there are none left.
+ *
+ * The module list lock is only held to claim a module and to report its
+ * result, so modules can use the loader from their load() function.
+ */
+static void *load_tier_worker(void *data)
+{
+	struct load_tier *tier = data;
+
+	for (;;) {
+		enum ast_module_load_result lres;
+		int index;
+
+		AST_DLLIST_LOCK(&module_list);
+		index = tier->next < tier->count ? tier->next++ : -1;
+		AST_DLLIST_UNLOCK(&module_list);
+		if (index < 0) {
+			break;
+		}
+
+		lres = start_resource(tier->mods[index]);
+
+		AST_DLLIST_LOCK(&module_list);
+		tier->results[index] = lres;
+		if (!--tier->pending) {
+			ast_cond_signal(&tier->done);
+		}
+		AST_DLLIST_UNLOCK(&module_list);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Start modules of the same load priority on several threads.
+ *
+ * \note The module list must be locked exactly once by the caller.  It is
+ * released while the workers run.
+ *
+ * \retval 0 on success.
+ * \retval -1 if a module failed to load.
+ */
+static int load_tier_parallel(struct ast_module **mods, int count, unsigned int global_symbols, int *loaded)
+{
+	struct load_tier tier = { .mods = mods, .count = count, .pending = count, };
+	pthread_t *threads;
+	int nthreads = MIN(count, (int) ast_option_load_threads);
+	int started = 0;
+	int res = 0;
+	int i;
+
+	tier.results = ast_calloc(count, sizeof(*tier.results));
+	threads = ast_calloc(nthreads, sizeof(*threads));
+	if (!tier.results || !threads) {
+		ast_free(tier.results);
+		ast_free(threads);
+		for (i = 0; i < count; i++) {
+			res |= start_resource_counted(mods[i], global_symbols, loaded);
+		}
+		return res;
+	}
+	ast_cond_init(&tier.done, NULL);
+
+	for (i = 0; i < nthreads; i++) {
+		if (ast_pthread_create(&threads[started], NULL, load_tier_worker, &tier)) {
+			ast_log(LOG_WARNING, "Unable to start a module loading thread.\n");
+			continue;
+		}
+		started++;
+	}
+
+	if (!started) {
+		/* Start them all from this thread instead */
+		load_tier_worker(&tier);
+	}
+
+	while (tier.pending) {
+		ast_cond_wait(&tier.done, &module_list.lock);
+	}
+
+	/* The workers still take the lock once more before they exit */
+	AST_DLLIST_UNLOCK(&module_list);
+	for (i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+	AST_DLLIST_LOCK(&module_list);
+
+	for (i = 0; i < count; i++) {
+		ast_debug(3, "START: %-46s %d %d\n", mods[i]->resource, tier.results[i], global_symbols);
+		if (tier.results[i] == AST_MODULE_LOAD_SUCCESS) {
+			(*loaded)++;
+		} else if (tier.results[i] == AST_MODULE_LOAD_FAILURE) {
+			res = -1;
+		}
+	}
+
+	ast_cond_destroy(&tier.done);
+	ast_free(tier.results);
+	ast_free(threads);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Pop the modules with the load priority of the next module off the heap.
+ *
+ * Modules that list other modules they need in nonoptreq, and modules that
+ * provide global symbols, are left for the caller to start one at a time
+ * after the others.
+ *
+ * \note parallel and serial must both have room for every module of the heap.
+ *
+ * \return The number of modules put in parallel.
+ */
+static int load_tier_split(struct ast_heap *resource_heap, struct ast_module **parallel, struct ast_module **serial, int *serial_count)
+{
+	struct ast_module *mod = ast_heap_peek(resource_heap, 1);
+	int pri = mod_load_pri(mod);
+	int count = 0;
+
+	*serial_count = 0;
+	while ((mod = ast_heap_peek(resource_heap, 1)) && mod_load_pri(mod) == pri) {
+		ast_heap_pop(resource_heap);
+		if (!ast_strlen_zero(mod->info->nonoptreq)
+			|| ast_test_flag(mod->info, AST_MODFLAG_GLOBAL_SYMBOLS)) {
+			serial[(*serial_count)++] = mod;
+		} else {
+			parallel[count++] = mod;
+		}
+	}
+
+	return count;
+}
+
 /*! loads modules in order by load_pri, updates mod_count
 	\return -1 on failure to load module, -2 on failure to load required module, otherwise 0
 */
@@ -1279,22 +1468,43 @@ static int load_resource_list(struct load_order *load_order, unsigned int global
 	}
 
 	/* second remove modules from heap sorted by priority */
-	while ((mod = ast_heap_pop(resource_heap))) {
-		enum ast_module_load_result lres;
+	if (ast_option_load_threads > 1 && ast_heap_size(resource_heap) > 1) {
+		size_t size = ast_heap_size(resource_heap);
+		struct ast_module **parallel = ast_calloc(size, sizeof(*parallel));
+		struct ast_module **serial = ast_calloc(size, sizeof(*serial));
+
+		/* Start each priority together, then the modules of it that had to wait */
+		while (parallel && serial && ast_heap_size(resource_heap)) {
+			int parallel_count;
+			int serial_count;
+
+			parallel_count = load_tier_split(resource_heap, parallel, serial, &serial_count);
+			if (parallel_count > 1) {
+				if (load_tier_parallel(parallel, parallel_count, global_symbols, &count)) {
+					res = -1;
+				}
+			} else if (parallel_count) {
+				res = start_resource_counted(parallel[0], global_symbols, &count);
+			}
+			for (i = 0; !res && i < serial_count; i++) {
+				res = start_resource_counted(serial[i], global_symbols, &count);
+			}
+			if (res) {
+				break;
+			}
+		}
 
-		lres = start_resource(mod);
-		ast_debug(3, "START: %-46s %d %d\n", mod->resource, lres, global_symbols);
-		switch (lres) {
-		case AST_MODULE_LOAD_SUCCESS:
-			count++;
-		case AST_MODULE_LOAD_DECLINE:
-			break;
-		case AST_MODULE_LOAD_FAILURE:
+		ast_free(parallel);
+		ast_free(serial);
+		if (res) {
+			goto done;
+		}
+	}
+
+	while ((mod = ast_heap_pop(resource_heap))) {
+		if (start_resource_counted(mod, global_symbols, &count)) {
 			res = -1;
 			goto done;
-		case AST_MODULE_LOAD_SKIP:
-		case AST_MODULE_LOAD_PRIORITY:
-			break;
 		}
 	}
 
@@ -1437,6 +1647,9 @@ int load_modules(unsigned int preload_only)
 	if (load_count)
 		ast_log(LOG_NOTICE, "%u modules will be loaded.\n", load_count);
 
+	/* every codec module registers several translators, build the matrix once */
+	ast_translate_defer_rebuild(1);
+
 	/* first, load only modules that provide global symbols */
 	if ((res = load_resource_list(&load_order, 1, &modulecount)) < 0) {
 		goto done;
@@ -1448,6 +1661,8 @@ int load_modules(unsigned int preload_only)
 	}
 
 done:
+	ast_translate_defer_rebuild(0);
+
 	while ((order = AST_LIST_REMOVE_HEAD(&load_order, entry))) {
 		ast_free(order->resource);
 		ast_free(order);
@@ -1553,6 +1768,48 @@ int ast_update_module_list_condition(int (*modentry)(const char *module, const c
 	return conditions_met;
 }
 
+static int module_load_time_cmp(const void *a, const void *b)
+{
+	const struct ast_module *a_mod = *(const struct ast_module **) a;
+	const struct ast_module *b_mod = *(const struct ast_module **) b;
+
+	/* Slowest first */
+	return (a_mod->load_time < b_mod->load_time) - (a_mod->load_time > b_mod->load_time);
+}
+
+int ast_update_module_list_load_times(int (*modentry)(const char *module, int64_t load_time, void *data),
+                                      void *data)
+{
+	struct ast_module *cur;
+	struct ast_module **mods;
+	int count = 0;
+	int total = 0;
+	int i;
+
+	AST_DLLIST_LOCK(&module_list);
+
+	AST_DLLIST_TRAVERSE(&module_list, cur, entry) {
+		count++;
+	}
+
+	if ((mods = ast_malloc(count * sizeof(*mods)))) {
+		i = 0;
+		AST_DLLIST_TRAVERSE(&module_list, cur, entry) {
+			mods[i++] = cur;
+		}
+		qsort(mods, count, sizeof(*mods), module_load_time_cmp);
+
+		for (i = 0; i < count; i++) {
+			total += modentry(mods[i]->resource, mods[i]->load_time, data);
+		}
+		ast_free(mods);
+	}
+
+	AST_DLLIST_UNLOCK(&module_list);
+
+	return total;
+}
+
 /*! \brief Check if module exists */
 int ast_module_check(const char *name)
 {
@@ -25,6 +25,24 @@
 	<support_level>core</support_level>
  ***/
 
+/*** DOCUMENTATION
+	<manager name="LockContentionList" language="en_US">
+		<synopsis>
+			List lock contention statistics.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+		</syntax>
+		<description>
+			<para>Returns a <literal>LockContention</literal> event for each lock
+			site counted since the statistics were last reset, longest total wait
+			first.  Times are in microseconds.  The statistics are gathered while
+			enabled with the <literal>core set lock contention</literal> CLI
+			command.</para>
+		</description>
+	</manager>
+ ***/
+
 #include "asterisk.h"
 
 #ifdef HAVE_MTX_PROFILE
@@ -36,8 +54,12 @@ static void __attribute__((constructor)) __mtx_init(void)
 }
 #endif
 
+#include "asterisk/_private.h"
 #include "asterisk/utils.h"
 #include "asterisk/lock.h"
+#include "asterisk/cli.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/manager.h"
 
 /* Allow direct use of pthread_mutex_* / pthread_cond_* */
 #undef pthread_mutex_init
@@ -129,6 +151,370 @@ static inline void delete_reentrancy_cs(struct ast_lock_track **plt)
 
 #endif /* DEBUG_THREADS */
 
+/*!
+ * \brief Lock contention statistics.
+ *
+ * \details
+ * While enabled with "core set lock contention on", every tracked
+ * lock operation is counted against the file and line that asked
+ * for it.  Each thread counts into its own table so no shared
+ * state is written on the lock path.  The tables are only merged
+ * when the statistics are shown.  Locks initialized without
+ * tracking are never counted.
+ */
+
+/*! Number of wait time histogram buckets.  Bucket n counts waits below 10^(n+1) microseconds. */
+#define LOCK_WAIT_BUCKETS	6
+/*! Microseconds a lock must be held to count as a hold time outlier. */
+#define LOCK_HOLD_OUTLIER_US	1000
+/*! Number of lock sites a thread can count.  Must be a power of two. */
+#define LOCK_THREAD_SITES	512
+/*! Number of slots probed before a thread gives up counting a lock site. */
+#define LOCK_SITE_PROBES	16
+/*! Number of locks a thread can time the hold of at once. */
+#define LOCK_HELD_MAX		16
+
+#if defined(HAVE_GCC_ATOMICS)
+/* Only the owning thread writes the counters.  Other threads just read them. */
+#define CONTENTION_GET(var)			__atomic_load_n(&(var), __ATOMIC_RELAXED)
+#define CONTENTION_SET(var, val)	__atomic_store_n(&(var), (val), __ATOMIC_RELAXED)
+#define CONTENTION_PUBLISH(var, val)	__atomic_store_n(&(var), (val), __ATOMIC_RELEASE)
+#define CONTENTION_CONSUME(var)		__atomic_load_n(&(var), __ATOMIC_ACQUIRE)
+#else
+#define CONTENTION_GET(var)			(var)
+#define CONTENTION_SET(var, val)	((var) = (val))
+#define CONTENTION_PUBLISH(var, val)	((var) = (val))
+#define CONTENTION_CONSUME(var)		(var)
+#endif
+#define CONTENTION_ADD(var, val)	CONTENTION_SET(var, CONTENTION_GET(var) + (val))
+
+/*! \brief Contention counters of a lock site. */
+struct lock_contention_counters {
+	/*! Number of times the lock was obtained. */
+	unsigned int acquired;
+	/*! Number of times the lock was busy and had to be waited for. */
+	unsigned int contended;
+	/*! Number of trylock and timed lock attempts that failed. */
+	unsigned int failed;
+	/*! Number of times the lock was held at least LOCK_HOLD_OUTLIER_US. */
+	unsigned int hold_outliers;
+	/*! Longest wait in microseconds. */
+	unsigned int wait_max_us;
+	/*! Longest hold in microseconds. */
+	unsigned int hold_max_us;
+	/*! Total wait in microseconds. */
+	uint64_t wait_total_us;
+	/*! Wait time histogram. */
+	unsigned int wait_hist[LOCK_WAIT_BUCKETS];
+};
+
+/*! \brief A lock site seen by any thread.  Sites are never freed. */
+struct lock_contention_site {
+	AST_LIST_ENTRY(lock_contention_site) list;
+	/*! Counters of the threads that have exited. */
+	struct lock_contention_counters retired;
+	/*! Position of the site in lock_contention_sites. */
+	unsigned int id;
+	int lineno;
+	char file[64];
+	char func[64];
+	char name[64];
+};
+
+/*! \brief A lock site counted by one thread. */
+struct lock_contention_slot {
+	/*! File name pointer given by the caller.  Identifies the slot together with lineno. */
+	const char *file;
+	int lineno;
+	/*! Site the slot counts for.  Set last so other threads only see complete slots. */
+	struct lock_contention_site *site;
+	struct lock_contention_counters counters;
+};
+
+/*! \brief A lock the thread holds whose hold time is being measured. */
+struct lock_contention_held {
+	const void *lock;
+	struct lock_contention_slot *slot;
+	struct timeval start;
+	/*! Statistics generation when the lock was obtained. */
+	unsigned int generation;
+};
+
+/*! \brief Lock contention statistics of one thread. */
+struct lock_contention_thread {
+	AST_LIST_ENTRY(lock_contention_thread) list;
+	unsigned int held_count;
+	struct lock_contention_held held[LOCK_HELD_MAX];
+	struct lock_contention_slot slots[LOCK_THREAD_SITES];
+};
+
+static int lock_contention_thread_init(void *data);
+static void lock_contention_thread_cleanup(void *data);
+
+AST_THREADSTORAGE_CUSTOM(lock_contention_buf, lock_contention_thread_init, lock_contention_thread_cleanup);
+
+/*! Nonzero while lock contention statistics are being gathered. */
+static int lock_contention_enabled;
+/*! Bumped whenever gathering starts or the statistics are reset. */
+static unsigned int lock_contention_generation;
+
+/*! Protects the thread and site lists.  Not tracked so it is never counted itself. */
+AST_MUTEX_DEFINE_STATIC_NOTRACKING(lock_contention_lock);
+static AST_LIST_HEAD_NOLOCK_STATIC(lock_contention_threads, lock_contention_thread);
+static AST_LIST_HEAD_NOLOCK_STATIC(lock_contention_sites, lock_contention_site);
+/*! Number of entries in lock_contention_sites. */
+static unsigned int lock_contention_site_count;
+
+static int lock_contention_thread_init(void *data)
+{
+	struct lock_contention_thread *thread = data;
+
+	ast_mutex_lock(&lock_contention_lock);
+	AST_LIST_INSERT_TAIL(&lock_contention_threads, thread, list);
+	ast_mutex_unlock(&lock_contention_lock);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Add a set of counters to another.
+ *
+ * \param sum Counters to add to.
+ * \param add Counters to add.
+ *
+ * \return Nothing
+ */
+static void lock_contention_counters_add(struct lock_contention_counters *sum,
+	struct lock_contention_counters *add)
+{
+	unsigned int value;
+	int idx;
+
+	sum->acquired += CONTENTION_GET(add->acquired);
+	sum->contended += CONTENTION_GET(add->contended);
+	sum->failed += CONTENTION_GET(add->failed);
+	sum->hold_outliers += CONTENTION_GET(add->hold_outliers);
+	sum->wait_total_us += CONTENTION_GET(add->wait_total_us);
+	value = CONTENTION_GET(add->wait_max_us);
+	if (sum->wait_max_us < value) {
+		sum->wait_max_us = value;
+	}
+	value = CONTENTION_GET(add->hold_max_us);
+	if (sum->hold_max_us < value) {
+		sum->hold_max_us = value;
+	}
+	for (idx = 0; idx < LOCK_WAIT_BUCKETS; ++idx) {
+		sum->wait_hist[idx] += CONTENTION_GET(add->wait_hist[idx]);
+	}
+}
+
+static void lock_contention_thread_cleanup(void *data)
+{
+	struct lock_contention_thread *thread = data;
+	struct lock_contention_site *site;
+	int idx;
+
+	ast_mutex_lock(&lock_contention_lock);
+	AST_LIST_REMOVE(&lock_contention_threads, thread, list);
+	for (idx = 0; idx < LOCK_THREAD_SITES; ++idx) {
+		site = thread->slots[idx].site;
+		if (site) {
+			lock_contention_counters_add(&site->retired, &thread->slots[idx].counters);
+		}
+	}
+	ast_mutex_unlock(&lock_contention_lock);
+
+	ast_free(thread);
+}
+
+/*!
+ * \internal
+ * \brief Find or create the shared record of a lock site.
+ *
+ * \retval site on success.
+ * \retval NULL on error.
+ */
+static struct lock_contention_site *lock_contention_site_get(const char *filename, int lineno,
+	const char *func, const char *lock_name)
+{
+	struct lock_contention_site *site;
+
+	ast_mutex_lock(&lock_contention_lock);
+	AST_LIST_TRAVERSE(&lock_contention_sites, site, list) {
+		if (site->lineno == lineno && !strncmp(site->file, filename, sizeof(site->file) - 1)) {
+			break;
+		}
+	}
+	if (!site) {
+		site = ast_std_calloc(1, sizeof(*site));
+		if (site) {
+			site->id = lock_contention_site_count++;
+			site->lineno = lineno;
+			ast_copy_string(site->file, filename, sizeof(site->file));
+			ast_copy_string(site->func, func, sizeof(site->func));
+			ast_copy_string(site->name, lock_name, sizeof(site->name));
+			AST_LIST_INSERT_TAIL(&lock_contention_sites, site, list);
+		}
+	}
+	ast_mutex_unlock(&lock_contention_lock);
+
+	return site;
+}
+
+/*!
+ * \internal
+ * \brief Get the calling thread's counters for a lock site.
+ *
+ * \param tracking Nonzero if the lock is tracked.
+ *
+ * \retval slot if the lock operation is to be counted.
+ * \retval NULL if not gathering statistics or on error.
+ */
+static inline struct lock_contention_slot *lock_contention_slot(int tracking, const char *filename,
+	int lineno, const char *func, const char *lock_name)
+{
+	struct lock_contention_thread *thread;
+	struct lock_contention_slot *slot;
+	unsigned int idx;
+	int probe;
+
+	if (!lock_contention_enabled || !tracking) {
+		return NULL;
+	}
+	thread = ast_threadstorage_get(&lock_contention_buf, sizeof(*thread));
+	if (!thread) {
+		return NULL;
+	}
+
+	idx = ((uintptr_t) filename >> 3) ^ ((unsigned int) lineno * 2654435761U);
+	for (probe = 0; probe < LOCK_SITE_PROBES; ++probe, ++idx) {
+		slot = &thread->slots[idx & (LOCK_THREAD_SITES - 1)];
+		if (!slot->site) {
+			struct lock_contention_site *site;
+
+			site = lock_contention_site_get(filename, lineno, func, lock_name);
+			if (!site) {
+				return NULL;
+			}
+			slot->file = filename;
+			slot->lineno = lineno;
+			CONTENTION_PUBLISH(slot->site, site);
+			return slot;
+		}
+		if (slot->file == filename && slot->lineno == lineno) {
+			return slot;
+		}
+	}
+
+	/* The thread's table is too crowded around this site. */
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Count a wait for a busy lock.
+ *
+ * \param slot Counters of the lock site.
+ * \param start When the wait started.
+ *
+ * \return Nothing
+ */
+static void lock_contention_waited(struct lock_contention_slot *slot, struct timeval start)
+{
+	int64_t waited = ast_tvdiff_us(ast_tvnow(), start);
+	int64_t limit = 10;
+	int bucket;
+
+	for (bucket = 0; bucket < LOCK_WAIT_BUCKETS - 1 && limit <= waited; ++bucket) {
+		limit *= 10;
+	}
+
+	CONTENTION_ADD(slot->counters.contended, 1);
+	CONTENTION_ADD(slot->counters.wait_hist[bucket], 1);
+	CONTENTION_ADD(slot->counters.wait_total_us, waited);
+	if (CONTENTION_GET(slot->counters.wait_max_us) < waited) {
+		CONTENTION_SET(slot->counters.wait_max_us, waited);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Count an obtained lock and start timing its hold.
+ *
+ * \param slot Counters of the lock site.
+ * \param lock The lock obtained.
+ *
+ * \return Nothing
+ */
+static void lock_contention_acquired(struct lock_contention_slot *slot, const void *lock)
+{
+	struct lock_contention_thread *thread;
+	struct lock_contention_held *held;
+
+	CONTENTION_ADD(slot->counters.acquired, 1);
+
+	thread = ast_threadstorage_get_ptr(&lock_contention_buf);
+	if (!thread) {
+		return;
+	}
+	if (LOCK_HELD_MAX <= thread->held_count) {
+		/* Forget the oldest, it was likely released by another thread. */
+		--thread->held_count;
+		memmove(&thread->held[0], &thread->held[1], thread->held_count * sizeof(thread->held[0]));
+	}
+	held = &thread->held[thread->held_count++];
+	held->lock = lock;
+	held->slot = slot;
+	held->generation = lock_contention_generation;
+	held->start = ast_tvnow();
+}
+
+/*!
+ * \internal
+ * \brief Stop timing the hold of a lock being released.
+ *
+ * \param lock The lock released.
+ *
+ * \return Nothing
+ */
+static void lock_contention_released(const void *lock)
+{
+	struct lock_contention_thread *thread;
+	struct lock_contention_held *held;
+	struct lock_contention_slot *slot;
+	unsigned int idx;
+	int64_t hold;
+
+	thread = ast_threadstorage_get_ptr(&lock_contention_buf);
+	if (!thread) {
+		return;
+	}
+
+	/* Locks are usually released in the reverse order they were obtained. */
+	for (idx = thread->held_count; idx--;) {
+		held = &thread->held[idx];
+		if (held->lock != lock) {
+			continue;
+		}
+
+		if (held->generation == lock_contention_generation) {
+			hold = ast_tvdiff_us(ast_tvnow(), held->start);
+			slot = held->slot;
+			if (LOCK_HOLD_OUTLIER_US <= hold) {
+				CONTENTION_ADD(slot->counters.hold_outliers, 1);
+			}
+			if (CONTENTION_GET(slot->counters.hold_max_us) < hold) {
+				CONTENTION_SET(slot->counters.hold_max_us, hold);
+			}
+		}
+
+		--thread->held_count;
+		memmove(held, held + 1, (thread->held_count - idx) * sizeof(*held));
+		break;
+	}
+}
+
 int __ast_pthread_mutex_init(int tracking, const char *filename, int lineno, const char *func,
 						const char *mutex_name, ast_mutex_t *t)
 {
@@ -148,8 +534,8 @@ int __ast_pthread_mutex_init(int tracking, const char *filename, int lineno, con
 #endif /* AST_MUTEX_INIT_W_CONSTRUCTORS */
 
 	t->track = NULL;
-	t->tracking = tracking;
 #endif /* DEBUG_THREADS */
+	t->tracking = tracking;
 
 	pthread_mutexattr_init(&attr);
 	pthread_mutexattr_settype(&attr, AST_MUTEX_KIND);
@@ -241,6 +627,7 @@ int __ast_pthread_mutex_lock(const char *filename, int lineno, const char *func,
 				const char* mutex_name, ast_mutex_t *t)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, lineno, func, mutex_name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -313,15 +700,29 @@ int __ast_pthread_mutex_lock(const char *filename, int lineno, const char *func,
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
+	if (slot) {
+		res = pthread_mutex_trylock(&t->mutex);
+		if (res == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_mutex_lock(&t->mutex);
+			lock_contention_waited(slot, start);
+		}
+	} else {
 #ifdef	HAVE_MTX_PROFILE
-	ast_mark(mtx_prof, 1);
-	res = pthread_mutex_trylock(&t->mutex);
-	ast_mark(mtx_prof, 0);
-	if (res)
+		ast_mark(mtx_prof, 1);
+		res = pthread_mutex_trylock(&t->mutex);
+		ast_mark(mtx_prof, 0);
+		if (res)
 #endif
-	res = pthread_mutex_lock(&t->mutex);
+		res = pthread_mutex_lock(&t->mutex);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
+	if (slot && !res) {
+		lock_contention_acquired(slot, t);
+	}
+
 #ifdef DEBUG_THREADS
 	if (lt && !res) {
 		ast_reentrancy_lock(lt);
@@ -365,6 +766,7 @@ int __ast_pthread_mutex_trylock(const char *filename, int lineno, const char *fu
 				const char* mutex_name, ast_mutex_t *t)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, lineno, func, mutex_name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -402,6 +804,14 @@ int __ast_pthread_mutex_trylock(const char *filename, int lineno, const char *fu
 
 	res = pthread_mutex_trylock(&t->mutex);
 
+	if (slot) {
+		if (res) {
+			CONTENTION_ADD(slot->counters.failed, 1);
+		} else {
+			lock_contention_acquired(slot, t);
+		}
+	}
+
 #ifdef DEBUG_THREADS
 	if (lt && !res) {
 		ast_reentrancy_lock(lt);
@@ -491,6 +901,10 @@ int __ast_pthread_mutex_unlock(const char *filename, int lineno, const char *fun
 	}
 #endif /* DEBUG_THREADS */
 
+	if (lock_contention_enabled && t->tracking) {
+		lock_contention_released(t);
+	}
+
 	res = pthread_mutex_unlock(&t->mutex);
 
 #ifdef DEBUG_THREADS
@@ -557,6 +971,7 @@ int __ast_cond_wait(const char *filename, int lineno, const char *func,
 				  ast_cond_t *cond, ast_mutex_t *t)
 {
 	int res;
+	struct lock_contention_slot *slot;
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -604,8 +1019,17 @@ int __ast_cond_wait(const char *filename, int lineno, const char *func,
 	}
 #endif /* DEBUG_THREADS */
 
+	if (lock_contention_enabled && t->tracking) {
+		lock_contention_released(t);
+	}
+
 	res = pthread_cond_wait(cond, &t->mutex);
 
+	slot = lock_contention_slot(t->tracking, filename, lineno, func, mutex_name);
+	if (slot) {
+		lock_contention_acquired(slot, t);
+	}
+
 #ifdef DEBUG_THREADS
 	if (res) {
 		__ast_mutex_logger("%s line %d (%s): Error waiting on condition mutex '%s'\n",
@@ -625,6 +1049,7 @@ int __ast_cond_timedwait(const char *filename, int lineno, const char *func,
 				       ast_mutex_t *t, const struct timespec *abstime)
 {
 	int res;
+	struct lock_contention_slot *slot;
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -672,8 +1097,17 @@ int __ast_cond_timedwait(const char *filename, int lineno, const char *func,
 	}
 #endif /* DEBUG_THREADS */
 
+	if (lock_contention_enabled && t->tracking) {
+		lock_contention_released(t);
+	}
+
 	res = pthread_cond_timedwait(cond, &t->mutex, abstime);
 
+	slot = lock_contention_slot(t->tracking, filename, lineno, func, mutex_name);
+	if (slot) {
+		lock_contention_acquired(slot, t);
+	}
+
 #ifdef DEBUG_THREADS
 	if (res && (res != ETIMEDOUT)) {
 		__ast_mutex_logger("%s line %d (%s): Error waiting on condition mutex '%s'\n",
@@ -706,8 +1140,8 @@ int __ast_rwlock_init(int tracking, const char *filename, int lineno, const char
 #endif /* AST_MUTEX_INIT_W_CONSTRUCTORS */
 
 	t->track = NULL;
-	t->tracking = tracking;
 #endif /* DEBUG_THREADS */
+	t->tracking = tracking;
 
 	pthread_rwlockattr_init(&attr);
 #ifdef HAVE_PTHREAD_RWLOCK_PREFER_WRITER_NP
@@ -833,6 +1267,10 @@ int __ast_rwlock_unlock(const char *filename, int line, const char *func, ast_rw
 	}
 #endif /* DEBUG_THREADS */
 
+	if (lock_contention_enabled && t->tracking) {
+		lock_contention_released(t);
+	}
+
 	res = pthread_rwlock_unlock(&t->lock);
 
 #ifdef DEBUG_THREADS
@@ -849,6 +1287,7 @@ int __ast_rwlock_unlock(const char *filename, int line, const char *func, ast_rw
 int __ast_rwlock_rdlock(const char *filename, int line, const char *func, ast_rwlock_t *t, const char *name)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -915,9 +1354,23 @@ int __ast_rwlock_rdlock(const char *filename, int line, const char *func, ast_rw
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
-	res = pthread_rwlock_rdlock(&t->lock);
+	if (slot) {
+		res = pthread_rwlock_tryrdlock(&t->lock);
+		if (res == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_rwlock_rdlock(&t->lock);
+			lock_contention_waited(slot, start);
+		}
+	} else {
+		res = pthread_rwlock_rdlock(&t->lock);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
+	if (slot && !res) {
+		lock_contention_acquired(slot, t);
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -958,6 +1411,7 @@ int __ast_rwlock_rdlock(const char *filename, int line, const char *func, ast_rw
 int __ast_rwlock_wrlock(const char *filename, int line, const char *func, ast_rwlock_t *t, const char *name)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -1024,9 +1478,23 @@ int __ast_rwlock_wrlock(const char *filename, int line, const char *func, ast_rw
 		} while (res == EBUSY);
 	}
 #else /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
-	res = pthread_rwlock_wrlock(&t->lock);
+	if (slot) {
+		res = pthread_rwlock_trywrlock(&t->lock);
+		if (res == EBUSY) {
+			struct timeval start = ast_tvnow();
+
+			res = pthread_rwlock_wrlock(&t->lock);
+			lock_contention_waited(slot, start);
+		}
+	} else {
+		res = pthread_rwlock_wrlock(&t->lock);
+	}
 #endif /* !DETECT_DEADLOCKS || !DEBUG_THREADS */
 
+	if (slot && !res) {
+		lock_contention_acquired(slot, t);
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -1067,6 +1535,7 @@ int __ast_rwlock_timedrdlock(const char *filename, int line, const char *func, a
 	const struct timespec *abs_timeout)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -1120,6 +1589,14 @@ int __ast_rwlock_timedrdlock(const char *filename, int line, const char *func, a
 	} while (0);
 #endif
 
+	if (slot) {
+		if (res) {
+			CONTENTION_ADD(slot->counters.failed, 1);
+		} else {
+			lock_contention_acquired(slot, t);
+		}
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -1160,6 +1637,7 @@ int __ast_rwlock_timedwrlock(const char *filename, int line, const char *func, a
 	const struct timespec *abs_timeout)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -1213,6 +1691,14 @@ int __ast_rwlock_timedwrlock(const char *filename, int line, const char *func, a
 	} while (0);
 #endif
 
+	if (slot) {
+		if (res) {
+			CONTENTION_ADD(slot->counters.failed, 1);
+		} else {
+			lock_contention_acquired(slot, t);
+		}
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -1252,6 +1738,7 @@ int __ast_rwlock_timedwrlock(const char *filename, int line, const char *func, a
 int __ast_rwlock_tryrdlock(const char *filename, int line, const char *func, ast_rwlock_t *t, const char *name)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -1288,6 +1775,14 @@ int __ast_rwlock_tryrdlock(const char *filename, int line, const char *func, ast
 
 	res = pthread_rwlock_tryrdlock(&t->lock);
 
+	if (slot) {
+		if (res) {
+			CONTENTION_ADD(slot->counters.failed, 1);
+		} else {
+			lock_contention_acquired(slot, t);
+		}
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -1311,6 +1806,7 @@ int __ast_rwlock_tryrdlock(const char *filename, int line, const char *func, ast
 int __ast_rwlock_trywrlock(const char *filename, int line, const char *func, ast_rwlock_t *t, const char *name)
 {
 	int res;
+	struct lock_contention_slot *slot = lock_contention_slot(t->tracking, filename, line, func, name);
 
 #ifdef DEBUG_THREADS
 	struct ast_lock_track *lt = NULL;
@@ -1347,6 +1843,14 @@ int __ast_rwlock_trywrlock(const char *filename, int line, const char *func, ast
 
 	res = pthread_rwlock_trywrlock(&t->lock);
 
+	if (slot) {
+		if (res) {
+			CONTENTION_ADD(slot->counters.failed, 1);
+		} else {
+			lock_contention_acquired(slot, t);
+		}
+	}
+
 #ifdef DEBUG_THREADS
 	if (!res && lt) {
 		ast_reentrancy_lock(lt);
@@ -1366,3 +1870,291 @@ int __ast_rwlock_trywrlock(const char *filename, int line, const char *func, ast
 
 	return res;
 }
+
+/*! \brief Merged contention counters of a lock site. */
+struct lock_contention_report {
+	struct lock_contention_site *site;
+	struct lock_contention_counters counters;
+};
+
+static int lock_contention_report_cmp(const void *left, const void *right)
+{
+	const struct lock_contention_counters *cnt_left = &((const struct lock_contention_report *) left)->counters;
+	const struct lock_contention_counters *cnt_right = &((const struct lock_contention_report *) right)->counters;
+
+	if (cnt_left->wait_total_us != cnt_right->wait_total_us) {
+		return cnt_left->wait_total_us < cnt_right->wait_total_us ? 1 : -1;
+	}
+	if (cnt_left->hold_outliers != cnt_right->hold_outliers) {
+		return cnt_left->hold_outliers < cnt_right->hold_outliers ? 1 : -1;
+	}
+	if (cnt_left->acquired != cnt_right->acquired) {
+		return cnt_left->acquired < cnt_right->acquired ? 1 : -1;
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Merge the counters of every thread by lock site.
+ *
+ * \param count Set to the number of sites in the report.
+ *
+ * \return Report sorted by total wait time to free with ast_std_free().  NULL if none.
+ */
+static struct lock_contention_report *lock_contention_collect(size_t *count)
+{
+	struct lock_contention_report *report;
+	struct lock_contention_thread *thread;
+	struct lock_contention_site *site;
+	int idx;
+
+	*count = 0;
+
+	ast_mutex_lock(&lock_contention_lock);
+	report = lock_contention_site_count
+		? ast_std_calloc(lock_contention_site_count, sizeof(*report)) : NULL;
+	if (!report) {
+		ast_mutex_unlock(&lock_contention_lock);
+		return NULL;
+	}
+	AST_LIST_TRAVERSE(&lock_contention_sites, site, list) {
+		report[site->id].site = site;
+		lock_contention_counters_add(&report[site->id].counters, &site->retired);
+	}
+	AST_LIST_TRAVERSE(&lock_contention_threads, thread, list) {
+		for (idx = 0; idx < LOCK_THREAD_SITES; ++idx) {
+			site = CONTENTION_CONSUME(thread->slots[idx].site);
+			if (site) {
+				lock_contention_counters_add(&report[site->id].counters,
+					&thread->slots[idx].counters);
+			}
+		}
+	}
+	*count = lock_contention_site_count;
+	ast_mutex_unlock(&lock_contention_lock);
+
+	qsort(report, *count, sizeof(*report), lock_contention_report_cmp);
+
+	return report;
+}
+
+/*!
+ * \internal
+ * \brief Zero the counters of every lock site.
+ *
+ * \note Counts made by other threads while resetting may survive.
+ *
+ * \return Nothing
+ */
+static void lock_contention_reset(void)
+{
+	struct lock_contention_thread *thread;
+	struct lock_contention_site *site;
+	int idx;
+
+	ast_mutex_lock(&lock_contention_lock);
+	++lock_contention_generation;
+	AST_LIST_TRAVERSE(&lock_contention_sites, site, list) {
+		memset(&site->retired, 0, sizeof(site->retired));
+	}
+	AST_LIST_TRAVERSE(&lock_contention_threads, thread, list) {
+		for (idx = 0; idx < LOCK_THREAD_SITES; ++idx) {
+			struct lock_contention_counters *counters = &thread->slots[idx].counters;
+			int bucket;
+
+			CONTENTION_SET(counters->acquired, 0);
+			CONTENTION_SET(counters->contended, 0);
+			CONTENTION_SET(counters->failed, 0);
+			CONTENTION_SET(counters->hold_outliers, 0);
+			CONTENTION_SET(counters->wait_max_us, 0);
+			CONTENTION_SET(counters->hold_max_us, 0);
+			CONTENTION_SET(counters->wait_total_us, 0);
+			for (bucket = 0; bucket < LOCK_WAIT_BUCKETS; ++bucket) {
+				CONTENTION_SET(counters->wait_hist[bucket], 0);
+			}
+		}
+	}
+	ast_mutex_unlock(&lock_contention_lock);
+}
+
+static char *handle_set_lock_contention(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set lock contention";
+		e->usage =
+			"Usage: core set lock contention {on|off|reset}\n"
+			"       Gather lock contention statistics by lock site.\n"
+			"       on - Start gathering.  Any previous statistics are reset.\n"
+			"       off - Stop gathering.  The statistics are kept.\n"
+			"       reset - Zero the statistics.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 4) {
+			const char * const options[] = { "on", "off", "reset", NULL };
+
+			return ast_cli_complete(a->word, options, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (ast_true(a->argv[4])) {
+		lock_contention_reset();
+		lock_contention_enabled = 1;
+	} else if (ast_false(a->argv[4])) {
+		lock_contention_enabled = 0;
+	} else if (!strcasecmp(a->argv[4], "reset")) {
+		lock_contention_reset();
+	} else {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "Lock contention statistics are: %s\n", lock_contention_enabled ? "On" : "Off");
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_show_locks_contention(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT_HEAD "%-40s %-20s %10s %10s %8s %10s %10s %8s %8s %8s %8s %8s %8s %8s %10s\n"
+#define FORMAT_DATA "%-40s %-20.20s %10u %10u %8u %10" PRIu64 " %10u %8u %8u %8u %8u %8u %8u %8u %10u\n"
+	struct lock_contention_report *report;
+	size_t count;
+	size_t idx;
+	unsigned int limit = 20;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show locks contention";
+		e->usage =
+			"Usage: core show locks contention [<count>|all]\n"
+			"       Shows the lock sites that waited the longest for their locks.\n"
+			"       The statistics are gathered with \"core set lock contention on\".\n"
+			"       Defaults to showing the top 20 lock sites.\n"
+			"       Waits are shown in microseconds followed by a histogram of\n"
+			"       the wait times.  Holds of at least a millisecond are counted\n"
+			"       as outliers.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc == 5) {
+		if (!strcasecmp(a->argv[4], "all")) {
+			limit = UINT_MAX;
+		} else if (sscanf(a->argv[4], "%30u", &limit) != 1) {
+			return CLI_SHOWUSAGE;
+		}
+	} else if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	report = lock_contention_collect(&count);
+
+	ast_cli(a->fd, "Lock contention statistics are: %s\n\n", lock_contention_enabled ? "On" : "Off");
+	ast_cli(a->fd, FORMAT_HEAD, "Site", "Lock", "Acquired", "Contended", "Failed",
+		"WaitTotal", "WaitMax", "<10us", "<100us", "<1ms", "<10ms", "<100ms", ">=100ms",
+		"HoldOut", "HoldMax");
+	for (idx = 0; idx < count && idx < limit; ++idx) {
+		struct lock_contention_counters *counters = &report[idx].counters;
+		char where[80];
+
+		snprintf(where, sizeof(where), "%s:%d %s", report[idx].site->file,
+			report[idx].site->lineno, report[idx].site->func);
+		ast_cli(a->fd, FORMAT_DATA, where, report[idx].site->name,
+			counters->acquired, counters->contended, counters->failed,
+			counters->wait_total_us, counters->wait_max_us,
+			counters->wait_hist[0], counters->wait_hist[1], counters->wait_hist[2],
+			counters->wait_hist[3], counters->wait_hist[4], counters->wait_hist[5],
+			counters->hold_outliers, counters->hold_max_us);
+	}
+	ast_cli(a->fd, "\n%d of %d lock sites shown\n", (int) idx, (int) count);
+	ast_std_free(report);
+
+	return CLI_SUCCESS;
+#undef FORMAT_HEAD
+#undef FORMAT_DATA
+}
+
+static struct ast_cli_entry cli_lock_contention[] = {
+	AST_CLI_DEFINE(handle_set_lock_contention, "Gather lock contention statistics"),
+	AST_CLI_DEFINE(handle_show_locks_contention, "Show lock contention statistics"),
+};
+
+static int manager_lock_contention_list(struct mansession *s, const struct message *m)
+{
+	const char *id = astman_get_header(m, "ActionID");
+	char id_text[256] = "";
+	struct lock_contention_report *report;
+	size_t count;
+	size_t idx;
+
+	if (!ast_strlen_zero(id)) {
+		snprintf(id_text, sizeof(id_text), "ActionID: %s\r\n", id);
+	}
+
+	report = lock_contention_collect(&count);
+
+	astman_send_listack(s, m, "Lock contention statistics will follow", "start");
+
+	for (idx = 0; idx < count; ++idx) {
+		struct lock_contention_counters *counters = &report[idx].counters;
+
+		astman_append(s,
+			"Event: LockContention\r\n"
+			"File: %s\r\n"
+			"Line: %d\r\n"
+			"Function: %s\r\n"
+			"LockName: %s\r\n"
+			"Acquired: %u\r\n"
+			"Contended: %u\r\n"
+			"Failed: %u\r\n"
+			"WaitTotal: %" PRIu64 "\r\n"
+			"WaitMax: %u\r\n"
+			"WaitUnder10us: %u\r\n"
+			"WaitUnder100us: %u\r\n"
+			"WaitUnder1ms: %u\r\n"
+			"WaitUnder10ms: %u\r\n"
+			"WaitUnder100ms: %u\r\n"
+			"WaitOver100ms: %u\r\n"
+			"HoldOutliers: %u\r\n"
+			"HoldMax: %u\r\n"
+			"%s"
+			"\r\n",
+			report[idx].site->file, report[idx].site->lineno,
+			report[idx].site->func, report[idx].site->name,
+			counters->acquired, counters->contended, counters->failed,
+			counters->wait_total_us, counters->wait_max_us,
+			counters->wait_hist[0], counters->wait_hist[1], counters->wait_hist[2],
+			counters->wait_hist[3], counters->wait_hist[4], counters->wait_hist[5],
+			counters->hold_outliers, counters->hold_max_us,
+			id_text);
+	}
+	ast_std_free(report);
+
+	astman_send_list_complete_start(s, m, "LockContentionComplete", count);
+	astman_append(s, "Enabled: %s\r\n", AST_YESNO(lock_contention_enabled));
+	astman_send_list_complete_end(s);
+
+	return 0;
+}
+
+static void lock_contention_shutdown(void)
+{
+	ast_cli_unregister_multiple(cli_lock_contention, ARRAY_LEN(cli_lock_contention));
+	ast_manager_unregister("LockContentionList");
+}
+
+int ast_lock_contention_init(void)
+{
+	ast_cli_register_multiple(cli_lock_contention, ARRAY_LEN(cli_lock_contention));
+	ast_manager_register_xml_core("LockContentionList", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, manager_lock_contention_list);
+	ast_register_cleanup(lock_contention_shutdown);
+
+	return 0;
+}
@@ -181,6 +181,49 @@ static pthread_t logthread = AST_PTHREADT_NULL;
 static ast_cond_t logcond;
 static int close_logger_thread = 0;
 
+/*! \brief Number of preallocated records in the log ring (must be a power of two) */
+#define LOG_RING_SIZE 1024
+/*! \brief Messages longer than this are copied to the heap instead of into the record */
+#define LOG_RING_MSG_SIZE 1024
+
+/*!
+ * \brief A log message queued in the log ring.
+ *
+ * Only the message text is formatted by the logging thread.  Building the
+ * date and the rest of the logmsg is left to the logger thread.
+ */
+struct logrecord {
+	/*! Position in the ring this record is ready for; see log_ring_push() */
+	unsigned int seq;
+	int level;
+	int sublevel;
+	int line;
+	int lwp;
+	ast_callid callid;
+	struct timeval when;
+	char file[64];
+	char function[128];
+	/*! The message, if it did not fit in message */
+	char *long_message;
+	char message[LOG_RING_MSG_SIZE];
+};
+
+/*!
+ * \brief Bounded multiple producer, single consumer ring of log records.
+ *
+ * Logging threads claim a record by advancing log_ring_head and publish it
+ * by setting its sequence number.  The logger thread is the only consumer.
+ * When the ring is full messages overflow to the logmsgs list, so they are
+ * never dropped, but they may then be printed out of order.
+ */
+static struct logrecord log_ring[LOG_RING_SIZE];
+static unsigned int log_ring_head;
+static unsigned int log_ring_tail;
+/*! Number of messages that did not fit in the ring */
+static int log_ring_overflows;
+/*! Set while the logger thread waits on logcond */
+static int logger_sleeping;
+
 static FILE *qlog;
 
 /*! \brief Logging channels used in the Asterisk logging system
@@ -640,6 +683,8 @@ static int init_logger_chain(const char *altconf)
 	display_callids = 1;
 	memset(&logfiles, 0, sizeof(logfiles));
 	logfiles.queue_log = 1;
+	queue_log_batch_size = 1;
+	queue_log_flush_interval = 1000;
 	ast_copy_string(dateformat, "%b %e %T", sizeof(dateformat));
 	ast_copy_string(queue_log_name, QUEUELOG, sizeof(queue_log_name));
 	exec_after_rotate[0] = '\0';
@@ -698,6 +743,18 @@ static int init_logger_chain(const char *altconf)
 	if ((s = ast_variable_retrieve(cfg, "general", "queue_log_realtime_use_gmt"))) {
 		logfiles.queue_log_realtime_use_gmt = ast_true(s);
 	}
+	if ((s = ast_variable_retrieve(cfg, "general", "queue_log_batch_size"))) {
+		if (sscanf(s, "%30u", &queue_log_batch_size) != 1 || !queue_log_batch_size) {
+			fprintf(stderr, "queue_log_batch_size must be a positive integer\n");
+			queue_log_batch_size = 1;
+		}
+	}
+	if ((s = ast_variable_retrieve(cfg, "general", "queue_log_flush_interval"))) {
+		if (sscanf(s, "%30u", &queue_log_flush_interval) != 1) {
+			fprintf(stderr, "queue_log_flush_interval must be a number of milliseconds\n");
+			queue_log_flush_interval = 1000;
+		}
+	}
 	if ((s = ast_variable_retrieve(cfg, "general", "exec_after_rotate"))) {
 		ast_copy_string(exec_after_rotate, s, sizeof(exec_after_rotate));
 	}
@@ -788,66 +845,152 @@ void ast_child_verbose(int level, const char *fmt, ...)
 	ast_free(emsg);
 }
 
-void ast_queue_log(const char *queuename, const char *callid, const char *agent, const char *event, const char *fmt, ...)
-{
-	va_list ap;
+/*! \brief A queue_log event waiting to be written */
+struct queue_log_entry {
+	AST_LIST_ENTRY(queue_log_entry) list;
 	struct timeval tv;
+	const char *callid;
+	const char *queuename;
+	const char *agent;
+	const char *event;
+	char data[0];
+};
+
+AST_LIST_HEAD_NOLOCK(queue_log_batch, queue_log_entry);
+
+/*! \brief Events waiting for the queue_log writer thread */
+static AST_LIST_HEAD_STATIC(queue_log_pending, queue_log_entry);
+static unsigned int queue_log_pending_count;
+static ast_cond_t queue_log_cond;
+static pthread_t queue_log_thread = AST_PTHREADT_NULL;
+static int queue_log_thread_stop;
+
+/*! \brief Write events in batches of this many; 1 writes each event as it happens */
+static unsigned int queue_log_batch_size = 1;
+/*! \brief Write a partial batch after this many milliseconds */
+static unsigned int queue_log_flush_interval = 1000;
+
+static struct queue_log_entry *queue_log_entry_alloc(const char *queuename, const char *callid, const char *agent, const char *event, const char *data)
+{
+	struct queue_log_entry *entry;
+	size_t data_len = strlen(data) + 1;
+	size_t callid_len = strlen(callid) + 1;
+	size_t queuename_len = strlen(queuename) + 1;
+	size_t agent_len = strlen(agent) + 1;
+	char *pos;
+
+	entry = ast_malloc(sizeof(*entry) + data_len + callid_len + queuename_len + agent_len + strlen(event) + 1);
+	if (!entry) {
+		return NULL;
+	}
+
+	entry->tv = ast_tvnow();
+	strcpy(entry->data, data); /* SAFE */
+	pos = entry->data + data_len;
+	entry->callid = strcpy(pos, callid); /* SAFE */
+	pos += callid_len;
+	entry->queuename = strcpy(pos, queuename); /* SAFE */
+	pos += queuename_len;
+	entry->agent = strcpy(pos, agent); /* SAFE */
+	pos += agent_len;
+	entry->event = strcpy(pos, event); /* SAFE */
+
+	return entry;
+}
+
+/*!
+ * \internal
+ * \brief Store queue_log events in realtime with a single bulk store.
+ */
+static void queue_log_store_realtime(struct queue_log_batch *batch, unsigned int count)
+{
+	struct queue_log_entry *entry;
+	const struct ast_variable **rows;
 	struct ast_tm tm;
-	char qlog_msg[8192];
-	int qlog_len;
 	char time_str[30];
+	size_t data_len[5] = { 0, };
+	unsigned int row = 0;
+	unsigned int i;
+	int adaptive = logfiles.queue_adaptive_realtime;
 
-	if (!logger_initialized) {
-		/* You are too early.  We are not open yet! */
+	if (!(rows = ast_calloc(count, sizeof(*rows)))) {
 		return;
 	}
-	if (!queuelog_init) {
-		/* We must initialize now since someone is trying to log something. */
-		logger_queue_start();
-	}
 
-	if (ast_check_realtime("queue_log")) {
-		tv = ast_tvnow();
-		ast_localtime(&tv, &tm, logfiles.queue_log_realtime_use_gmt ? "GMT" : NULL);
+	AST_LIST_TRAVERSE(batch, entry, list) {
+		struct ast_variable *fields = NULL;
+		struct ast_variable **tail = &fields;
+
+		ast_localtime(&entry->tv, &tm, logfiles.queue_log_realtime_use_gmt ? "GMT" : NULL);
 		ast_strftime(time_str, sizeof(time_str), "%F %T.%6q", &tm);
-		va_start(ap, fmt);
-		vsnprintf(qlog_msg, sizeof(qlog_msg), fmt, ap);
-		va_end(ap);
-		if (logfiles.queue_adaptive_realtime) {
+
+#define QUEUE_LOG_FIELD(name, value) \
+	do { \
+		if ((*tail = ast_variable_new(name, value, ""))) { \
+			tail = &(*tail)->next; \
+		} \
+	} while (0)
+
+		QUEUE_LOG_FIELD("time", time_str);
+		QUEUE_LOG_FIELD("callid", entry->callid);
+		QUEUE_LOG_FIELD("queuename", entry->queuename);
+		QUEUE_LOG_FIELD("agent", entry->agent);
+		QUEUE_LOG_FIELD("event", entry->event);
+		if (adaptive) {
+			static const char * const data_names[] = { "data1", "data2", "data3", "data4", "data5" };
+			char *data = ast_strdup(entry->data);
 			AST_DECLARE_APP_ARGS(args,
 				AST_APP_ARG(data)[5];
 			);
-			AST_NONSTANDARD_APP_ARGS(args, qlog_msg, '|');
-			/* Ensure fields are large enough to receive data */
-			ast_realtime_require_field("queue_log",
-				"data1", RQ_CHAR, strlen(S_OR(args.data[0], "")),
-				"data2", RQ_CHAR, strlen(S_OR(args.data[1], "")),
-				"data3", RQ_CHAR, strlen(S_OR(args.data[2], "")),
-				"data4", RQ_CHAR, strlen(S_OR(args.data[3], "")),
-				"data5", RQ_CHAR, strlen(S_OR(args.data[4], "")),
-				SENTINEL);
-
-			/* Store the log */
-			ast_store_realtime("queue_log", "time", time_str,
-				"callid", callid,
-				"queuename", queuename,
-				"agent", agent,
-				"event", event,
-				"data1", S_OR(args.data[0], ""),
-				"data2", S_OR(args.data[1], ""),
-				"data3", S_OR(args.data[2], ""),
-				"data4", S_OR(args.data[3], ""),
-				"data5", S_OR(args.data[4], ""),
-				SENTINEL);
+
+			if (data) {
+				AST_NONSTANDARD_APP_ARGS(args, data, '|');
+			} else {
+				memset(&args, 0, sizeof(args));
+			}
+			for (i = 0; i < ARRAY_LEN(data_names); i++) {
+				QUEUE_LOG_FIELD(data_names[i], S_OR(args.data[i], ""));
+				data_len[i] = MAX(data_len[i], strlen(S_OR(args.data[i], "")));
+			}
+			ast_free(data);
 		} else {
-			ast_store_realtime("queue_log", "time", time_str,
-				"callid", callid,
-				"queuename", queuename,
-				"agent", agent,
-				"event", event,
-				"data", qlog_msg,
-				SENTINEL);
+			QUEUE_LOG_FIELD("data", entry->data);
 		}
+#undef QUEUE_LOG_FIELD
+
+		rows[row++] = fields;
+	}
+
+	if (adaptive) {
+		/* Ensure fields are large enough to receive data */
+		ast_realtime_require_field("queue_log",
+			"data1", RQ_CHAR, data_len[0],
+			"data2", RQ_CHAR, data_len[1],
+			"data3", RQ_CHAR, data_len[2],
+			"data4", RQ_CHAR, data_len[3],
+			"data5", RQ_CHAR, data_len[4],
+			SENTINEL);
+	}
+
+	/* Store the log */
+	ast_store_realtime_multiple_fields("queue_log", rows, row);
+
+	for (i = 0; i < row; i++) {
+		ast_variables_destroy((struct ast_variable *) rows[i]);
+	}
+	ast_free(rows);
+}
+
+/*!
+ * \internal
+ * \brief Write queue_log events to realtime and/or the queue_log file.
+ */
+static void queue_log_write(struct queue_log_batch *batch, unsigned int count)
+{
+	struct queue_log_entry *entry;
+
+	if (ast_check_realtime("queue_log")) {
+		queue_log_store_realtime(batch, count);
 
 		if (!logfiles.queue_log_to_file) {
 			return;
@@ -855,19 +998,136 @@ void ast_queue_log(const char *queuename, const char *callid, const char *agent,
 	}
 
 	if (qlog) {
-		va_start(ap, fmt);
-		qlog_len = snprintf(qlog_msg, sizeof(qlog_msg), "%ld|%s|%s|%s|%s|", (long)time(NULL), callid, queuename, agent, event);
-		vsnprintf(qlog_msg + qlog_len, sizeof(qlog_msg) - qlog_len, fmt, ap);
-		va_end(ap);
 		AST_RWLIST_RDLOCK(&logchannels);
 		if (qlog) {
-			fprintf(qlog, "%s\n", qlog_msg);
+			AST_LIST_TRAVERSE(batch, entry, list) {
+				fprintf(qlog, "%ld|%s|%s|%s|%s|%s\n", (long)entry->tv.tv_sec,
+					entry->callid, entry->queuename, entry->agent, entry->event, entry->data);
+			}
 			fflush(qlog);
 		}
 		AST_RWLIST_UNLOCK(&logchannels);
 	}
 }
 
+/*! \brief The queue_log writer thread */
+static void *queue_log_writer(void *data)
+{
+	struct queue_log_batch batch = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct queue_log_entry *entry;
+	unsigned int count;
+	int stop;
+
+	for (;;) {
+		AST_LIST_LOCK(&queue_log_pending);
+		if (!queue_log_thread_stop && AST_LIST_EMPTY(&queue_log_pending)) {
+			ast_cond_wait(&queue_log_cond, &queue_log_pending.lock);
+		}
+		if (!queue_log_thread_stop && queue_log_pending_count < queue_log_batch_size) {
+			/* Give the batch until the flush interval to fill up */
+			struct timeval wait = ast_tvadd(ast_tvnow(), ast_samp2tv(queue_log_flush_interval, 1000));
+			struct timespec ts = {
+				.tv_sec = wait.tv_sec,
+				.tv_nsec = wait.tv_usec * 1000,
+			};
+
+			while (!queue_log_thread_stop && queue_log_pending_count < queue_log_batch_size) {
+				if (ast_cond_timedwait(&queue_log_cond, &queue_log_pending.lock, &ts) == ETIMEDOUT) {
+					break;
+				}
+			}
+		}
+		AST_LIST_APPEND_LIST(&batch, &queue_log_pending, list);
+		count = queue_log_pending_count;
+		queue_log_pending_count = 0;
+		stop = queue_log_thread_stop;
+		AST_LIST_UNLOCK(&queue_log_pending);
+
+		if (count) {
+			queue_log_write(&batch, count);
+			while ((entry = AST_LIST_REMOVE_HEAD(&batch, list))) {
+				ast_free(entry);
+			}
+		}
+
+		if (stop) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
+static void queue_log_writer_start(void)
+{
+	ast_cond_init(&queue_log_cond, NULL);
+	if (ast_pthread_create(&queue_log_thread, NULL, queue_log_writer, NULL)) {
+		ast_log(LOG_WARNING, "Unable to start the queue_log writer; queue_log events will not be batched\n");
+		queue_log_thread = AST_PTHREADT_NULL;
+	}
+}
+
+/*! \brief Stop the queue_log writer thread, writing out any pending events */
+static void queue_log_writer_stop(void)
+{
+	if (queue_log_thread == AST_PTHREADT_NULL) {
+		return;
+	}
+
+	AST_LIST_LOCK(&queue_log_pending);
+	queue_log_thread_stop = 1;
+	ast_cond_signal(&queue_log_cond);
+	AST_LIST_UNLOCK(&queue_log_pending);
+
+	pthread_join(queue_log_thread, NULL);
+	queue_log_thread = AST_PTHREADT_NULL;
+}
+
+void ast_queue_log(const char *queuename, const char *callid, const char *agent, const char *event, const char *fmt, ...)
+{
+	va_list ap;
+	char qlog_msg[8192];
+	struct queue_log_entry *entry;
+	struct queue_log_batch batch = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+
+	if (!logger_initialized) {
+		/* You are too early.  We are not open yet! */
+		return;
+	}
+	if (!queuelog_init) {
+		/* We must initialize now since someone is trying to log something. */
+		logger_queue_start();
+	}
+
+	va_start(ap, fmt);
+	vsnprintf(qlog_msg, sizeof(qlog_msg), fmt, ap);
+	va_end(ap);
+
+	if (!(entry = queue_log_entry_alloc(queuename, callid, agent, event, qlog_msg))) {
+		return;
+	}
+
+	if (queue_log_batch_size > 1 && queue_log_thread != AST_PTHREADT_NULL) {
+		AST_LIST_LOCK(&queue_log_pending);
+		if (!queue_log_thread_stop) {
+			AST_LIST_INSERT_TAIL(&queue_log_pending, entry, list);
+			/* Wake the writer to start the flush interval, or to write a full batch */
+			if (++queue_log_pending_count == 1 || queue_log_pending_count >= queue_log_batch_size) {
+				ast_cond_signal(&queue_log_cond);
+			}
+			entry = NULL;
+		}
+		AST_LIST_UNLOCK(&queue_log_pending);
+		if (!entry) {
+			return;
+		}
+	}
+
+	AST_LIST_INSERT_TAIL(&batch, entry, list);
+	queue_log_write(&batch, 1);
+	ast_free(entry);
+}
+
 static int rotate_file(const char *filename)
 {
 	char old[PATH_MAX];
@@ -1318,6 +1578,7 @@ static char *handle_logger_show_channels(struct ast_cli_entry *e, int cmd, struc
 	}
 	AST_RWLIST_UNLOCK(&logchannels);
 	ast_cli(a->fd, "\n");
+	ast_cli(a->fd, "Messages that overflowed the log queue: %d\n\n", log_ring_overflows);
 
 	return CLI_SUCCESS;
 }
@@ -1462,6 +1723,153 @@ static char *handle_logger_remove_channel(struct ast_cli_entry *e, int cmd, stru
 	}
 }
 
+/*! \brief Maximum number of calls that can have their own debug level */
+#define MAX_DEBUG_CALLIDS 16
+
+/*! \brief A call with its own debug level */
+struct debug_callid {
+	ast_callid callid;
+	unsigned int level;
+};
+
+/*! \brief Calls with their own debug level, set with "core set debug call" */
+static struct debug_callid debug_callids[MAX_DEBUG_CALLIDS];
+AST_RWLOCK_DEFINE_STATIC(debug_callids_lock);
+
+int ast_debug_call_max;
+
+unsigned int ast_debug_get_by_callid(ast_callid callid)
+{
+	unsigned int level = 0;
+	int i;
+
+	if (!callid) {
+		return 0;
+	}
+
+	ast_rwlock_rdlock(&debug_callids_lock);
+	for (i = 0; i < MAX_DEBUG_CALLIDS; i++) {
+		if (debug_callids[i].callid == callid) {
+			level = debug_callids[i].level;
+			break;
+		}
+	}
+	ast_rwlock_unlock(&debug_callids_lock);
+
+	return level;
+}
+
+/*!
+ * \internal
+ * \brief Set the debug level of a call.
+ *
+ * \param callid The callid of the call
+ * \param level The new level, or 0 to stop debugging the call
+ *
+ * \retval 0 on success
+ * \retval -1 if too many calls are already being debugged
+ */
+static int debug_callid_set(ast_callid callid, unsigned int level)
+{
+	struct debug_callid *slot = NULL;
+	unsigned int max = 0;
+	int i;
+
+	ast_rwlock_wrlock(&debug_callids_lock);
+	for (i = 0; i < MAX_DEBUG_CALLIDS; i++) {
+		if (debug_callids[i].callid == callid) {
+			slot = &debug_callids[i];
+			break;
+		}
+		if (!slot && !debug_callids[i].callid) {
+			slot = &debug_callids[i];
+		}
+	}
+	if (!slot) {
+		ast_rwlock_unlock(&debug_callids_lock);
+		return level ? -1 : 0;
+	}
+
+	slot->callid = level ? callid : 0;
+	slot->level = level;
+
+	for (i = 0; i < MAX_DEBUG_CALLIDS; i++) {
+		if (debug_callids[i].callid && debug_callids[i].level > max) {
+			max = debug_callids[i].level;
+		}
+	}
+	ast_debug_call_max = max;
+	ast_rwlock_unlock(&debug_callids_lock);
+
+	return 0;
+}
+
+static char *handle_debug_call(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	const char *id;
+	ast_callid callid;
+	unsigned int level;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set debug call";
+		e->usage =
+			"Usage: core set debug call [<callid> {<level>|off}]\n"
+			"       Sets the debug level for a single call, identified by the\n"
+			"       callid shown in its log messages, e.g. C-0000001a.  Debug\n"
+			"       messages logged for the call are shown as if the core debug\n"
+			"       level were at least this high.  Without arguments, lists the\n"
+			"       calls that have their own debug level.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc == e->args) {
+		ast_cli(a->fd, "%-12s %s\n", "Callid", "Level");
+		ast_rwlock_rdlock(&debug_callids_lock);
+		for (i = 0; i < MAX_DEBUG_CALLIDS; i++) {
+			if (debug_callids[i].callid) {
+				ast_cli(a->fd, "C-%08x   %u\n", debug_callids[i].callid, debug_callids[i].level);
+			}
+		}
+		ast_rwlock_unlock(&debug_callids_lock);
+		return CLI_SUCCESS;
+	}
+
+	if (a->argc != e->args + 2) {
+		return CLI_SHOWUSAGE;
+	}
+
+	id = a->argv[e->args];
+	if (*id == '[') {
+		id++;
+	}
+	if (!strncasecmp(id, "C-", 2)) {
+		id += 2;
+	}
+	if (sscanf(id, "%30x", &callid) != 1 || !callid) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!strcasecmp(a->argv[e->args + 1], "off")) {
+		level = 0;
+	} else if (sscanf(a->argv[e->args + 1], "%30u", &level) != 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (debug_callid_set(callid, level)) {
+		ast_cli(a->fd, "Unable to debug call C-%08x: already debugging %d calls.\n",
+			callid, MAX_DEBUG_CALLIDS);
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, "Debug level for call C-%08x has been set to %u.\n", callid, level);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_logger[] = {
 	AST_CLI_DEFINE(handle_logger_show_channels, "List configured log channels"),
 	AST_CLI_DEFINE(handle_logger_reload, "Reopens the log files"),
@@ -1469,6 +1877,7 @@ static struct ast_cli_entry cli_logger[] = {
 	AST_CLI_DEFINE(handle_logger_set_level, "Enables/Disables a specific logging level for this console"),
 	AST_CLI_DEFINE(handle_logger_add_channel, "Adds a new logging channel"),
 	AST_CLI_DEFINE(handle_logger_remove_channel, "Removes a logging channel"),
+	AST_CLI_DEFINE(handle_debug_call, "Set the debug level for a single call"),
 };
 
 static void _handle_SIGXFSZ(int sig)
@@ -1585,21 +1994,159 @@ static void logger_print_normal(struct logmsg *logmsg)
 	return;
 }
 
+static void log_ring_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < LOG_RING_SIZE; i++) {
+		log_ring[i].seq = i;
+	}
+	log_ring_head = log_ring_tail = 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue a message on the log ring.
+ *
+ * \retval 0 on success
+ * \retval -1 if the ring is full
+ */
+static int __attribute__((format(printf, 7, 0))) log_ring_push(int level, int sublevel, const char *file, int line, const char *function, ast_callid callid, const char *fmt, va_list ap)
+{
+	struct logrecord *rec;
+	unsigned int pos = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED);
+	va_list aq;
+	int res;
+
+	for (;;) {
+		int diff;
+
+		rec = &log_ring[pos & (LOG_RING_SIZE - 1)];
+		diff = (int) (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) - pos);
+		if (!diff) {
+			if (__atomic_compare_exchange_n(&log_ring_head, &pos, pos + 1, 1,
+				__ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+				break;
+			}
+		} else if (diff < 0) {
+			/* The logger thread has not yet consumed this record */
+			ast_atomic_fetchadd_int(&log_ring_overflows, +1);
+			return -1;
+		} else {
+			pos = __atomic_load_n(&log_ring_head, __ATOMIC_RELAXED);
+		}
+	}
+
+	va_copy(aq, ap);
+	res = vsnprintf(rec->message, sizeof(rec->message), fmt, aq);
+	va_end(aq);
+	rec->long_message = NULL;
+	if (res >= (int) sizeof(rec->message)) {
+		va_copy(aq, ap);
+		if (ast_vasprintf(&rec->long_message, fmt, aq) < 0) {
+			rec->long_message = NULL;
+		}
+		va_end(aq);
+	}
+
+	rec->level = level;
+	rec->sublevel = sublevel;
+	rec->line = line;
+	rec->lwp = ast_get_tid();
+	rec->callid = display_callids ? callid : 0;
+	rec->when = ast_tvnow();
+	ast_copy_string(rec->file, file, sizeof(rec->file));
+	ast_copy_string(rec->function, function, sizeof(rec->function));
+
+	__atomic_store_n(&rec->seq, pos + 1, __ATOMIC_RELEASE);
+
+	/* Pairs with the fence in logger_thread() so a sleeping logger thread is always woken */
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if (__atomic_load_n(&logger_sleeping, __ATOMIC_RELAXED)) {
+		AST_LIST_LOCK(&logmsgs);
+		ast_cond_signal(&logcond);
+		AST_LIST_UNLOCK(&logmsgs);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Get the next published record from the log ring, if any.
+ */
+static struct logrecord *log_ring_peek(void)
+{
+	struct logrecord *rec = &log_ring[log_ring_tail & (LOG_RING_SIZE - 1)];
+
+	if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != log_ring_tail + 1) {
+		return NULL;
+	}
+	return rec;
+}
+
+/*!
+ * \internal
+ * \brief Print every record queued on the log ring.
+ *
+ * \param msg A logmsg owned by the logger thread, reused for each record
+ */
+static void log_ring_drain(struct logmsg *msg)
+{
+	struct logrecord *rec;
+	struct ast_tm tm;
+	char datestring[256];
+
+	while ((rec = log_ring_peek())) {
+		ast_string_field_init(msg, 0);
+		ast_string_field_set(msg, message, rec->long_message ? rec->long_message : rec->message);
+		ast_localtime(&rec->when, &tm, NULL);
+		ast_strftime(datestring, sizeof(datestring), dateformat, &tm);
+		ast_string_field_set(msg, date, datestring);
+		ast_string_field_set(msg, level_name, S_OR(levels[rec->level], ""));
+		ast_string_field_set(msg, file, rec->file);
+		ast_string_field_set(msg, function, rec->function);
+		msg->type = rec->level == __LOG_VERBOSE ? LOGMSG_VERBOSE : LOGMSG_NORMAL;
+		msg->level = rec->level;
+		msg->sublevel = rec->sublevel;
+		msg->line = rec->line;
+		msg->lwp = rec->lwp;
+		msg->callid = rec->callid;
+
+		ast_free(rec->long_message);
+		rec->long_message = NULL;
+
+		/* Hand the record back to the producers for the next lap of the ring */
+		__atomic_store_n(&rec->seq, log_ring_tail + LOG_RING_SIZE, __ATOMIC_RELEASE);
+		log_ring_tail++;
+
+		logger_print_normal(msg);
+	}
+}
+
 /*! \brief Actual logging thread */
 static void *logger_thread(void *data)
 {
 	struct logmsg *next = NULL, *msg = NULL;
+	struct logmsg *ringmsg = data;
 
 	for (;;) {
+		log_ring_drain(ringmsg);
+
 		/* We lock the message list, and see if any message exists... if not we wait on the condition to be signalled */
 		AST_LIST_LOCK(&logmsgs);
 		if (AST_LIST_EMPTY(&logmsgs)) {
-			if (close_logger_thread) {
+			if (close_logger_thread && !log_ring_peek()) {
 				AST_LIST_UNLOCK(&logmsgs);
 				break;
-			} else {
+			}
+
+			__atomic_store_n(&logger_sleeping, 1, __ATOMIC_RELAXED);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (!close_logger_thread && !log_ring_peek()) {
 				ast_cond_wait(&logcond, &logmsgs.lock);
 			}
+			__atomic_store_n(&logger_sleeping, 0, __ATOMIC_RELAXED);
 		}
 		next = AST_LIST_FIRST(&logmsgs);
 		AST_LIST_HEAD_INIT_NOLOCK(&logmsgs);
@@ -1618,6 +2165,8 @@ static void *logger_thread(void *data)
 		}
 	}
 
+	logmsg_free(ringmsg);
+
 	return NULL;
 }
 
@@ -1679,6 +2228,7 @@ void logger_queue_start(void)
 
 int init_logger(void)
 {
+	struct logmsg *ringmsg;
 	int res;
 	/* auto rotate if sig SIGXFSZ comes a-knockin */
 	sigaction(SIGXFSZ, &handle_SIGXFSZ, NULL);
@@ -1692,13 +2242,23 @@ int init_logger(void)
 	ast_mutex_destroy(&logmsgs.lock);
 	ast_mutex_init(&logmsgs.lock);
 	ast_cond_init(&logcond, NULL);
+	log_ring_init();
+
+	/* The logger thread builds each message from the ring in this logmsg */
+	if (!(ringmsg = ast_calloc_with_stringfields(1, struct logmsg, 512))) {
+		ast_cond_destroy(&logcond);
+		return -1;
+	}
 
 	/* start logger thread */
-	if (ast_pthread_create(&logthread, NULL, logger_thread, NULL) < 0) {
+	if (ast_pthread_create(&logthread, NULL, logger_thread, ringmsg) < 0) {
+		logmsg_free(ringmsg);
 		ast_cond_destroy(&logcond);
 		return -1;
 	}
 
+	queue_log_writer_start();
+
 	/* register the logger cli commands */
 	ast_cli_register_multiple(cli_logger, ARRAY_LEN(cli_logger));
 
@@ -1735,6 +2295,8 @@ void close_logger(void)
 		pthread_join(logthread, NULL);
 	}
 
+	queue_log_writer_stop();
+
 	AST_RWLIST_WRLOCK(&logchannels);
 
 	if (qlog) {
@@ -1886,9 +2448,22 @@ static void __attribute__((format(printf, 7, 0))) ast_log_full(int level, int su
 		return;
 	}
 
-	/* Ignore anything that never gets logged anywhere */
-	if (level != __LOG_VERBOSE && !(global_logmask & (1 << level)))
+	/*
+	 * Ignore anything that never gets logged anywhere, before doing any
+	 * formatting.  Verbose messages above the highest verbosity of any
+	 * console or logger channel are not shown anywhere either.
+	 */
+	if (!AST_RWLIST_EMPTY(&logchannels)
+		&& (!(global_logmask & (1 << level))
+			|| (level == __LOG_VERBOSE && sublevel > ast_verb_sys_level))) {
 		return;
+	}
+
+	/* Hand it to the logger thread to format, unless the ring is full */
+	if (logthread != AST_PTHREADT_NULL && !close_logger_thread
+		&& !log_ring_push(level, sublevel, file, line, function, callid, fmt, ap)) {
+		return;
+	}
 
 	/* Build string */
 	res = ast_str_set_va(&buf, BUFSIZ, fmt, ap);
@@ -99,6 +99,7 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/translate.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/vector.h"
 
 /*** DOCUMENTATION
 	<manager name="Ping" language="en_US">
@@ -229,6 +230,11 @@
 					<enum name="false"/>
 				</enumlist>
 			</parameter>
+			<parameter name="Fields">
+				<para>Comma <literal>,</literal> separated list of the headers to include
+				in each Status event.  The Event and ActionID headers are always included.
+				If not given, every header is included.</para>
+			</parameter>
 		</syntax>
 		<description>
 			<para>Will return the status information of each channel along with the
@@ -945,6 +951,23 @@
 			<ref type="manager">ModuleLoad</ref>
 		</see-also>
 	</manager>
+	<manager name="RealtimeCacheFlush" language="en_US">
+		<synopsis>
+			Flush cached realtime lookups.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Family">
+				<para>Name of the realtime family to flush. If omitted, the
+				lookups of every cached family are flushed.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Forget the realtime lookups cached for the families listed in the
+			<literal>[cache]</literal> section of <filename>extconfig.conf</filename>.
+			Use this after changing a realtime backend from outside of Asterisk.</para>
+		</description>
+	</manager>
 	<managerEvent language="en_US" name="CoreShowChannel">
 		<managerEventInstance class="EVENT_FLAG_CALL">
 			<synopsis>Raised in response to a CoreShowChannels command.</synopsis>
@@ -994,6 +1017,11 @@
 		</synopsis>
 		<syntax>
 			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Fields">
+				<para>Comma <literal>,</literal> separated list of the headers to include
+				in each CoreShowChannel event.  The Event and ActionID headers are always
+				included.  If not given, every header is included.</para>
+			</parameter>
 		</syntax>
 		<description>
 			<para>List currently defined channels and some information about them.</para>
@@ -1228,6 +1256,7 @@
 				<para>Filters can be whitelist or blacklist</para>
 				<para>Example whitelist filter: "Event: Newchannel"</para>
 				<para>Example blacklist filter: "!Channel: DAHDI.*"</para>
+				<para>Example structured filter: "Event=Newstate&amp;ChannelState=6"</para>
 				<para>This filter option is used to whitelist or blacklist events per user to be
 				reported with regular expressions and are allowed if both the regex matches
 				and the user has read access as defined in manager.conf. Filters are assumed to be for whitelisting
@@ -1238,6 +1267,12 @@
 				<para>- If there are black filters only: implied white all filter processed first, then black filters.</para>
 				<para>- If there are both white and black filters: implied black all filter processed first, then white
 				filters, and lastly black filters.</para>
+				<para>A filter of the form "Event: Name" or "Event: Prefix.*" is compared
+				with the Event header of each event rather than being run as a regular
+				expression, so "Event: Name" only matches the event with exactly that name.
+				A filter made of header conditions joined by an ampersand, such as
+				"Event=Newstate&amp;ChannelState=6", matches events where every header has
+				exactly the given value.</para>
 			</parameter>
 		</syntax>
 		<description>
@@ -1363,6 +1398,21 @@
 			</see-also>
 		</managerEventInstance>
 	</managerEvent>
+	<managerEvent name="EventsDropped" language="en_US">
+		<managerEventInstance class="EVENT_FLAG_SYSTEM">
+			<synopsis>Raised before the next event sent to a session whose event queue was full.</synopsis>
+			<syntax>
+				<parameter name="Dropped">
+					<para>The number of events dropped since the session was last told.</para>
+				</parameter>
+			</syntax>
+			<description>
+				<para>Events are dropped when a session does not read them as fast
+				as they are raised.  The size of the event queue of each session and
+				which events are dropped are set in <filename>manager.conf</filename>.</para>
+			</description>
+		</managerEventInstance>
+	</managerEvent>
 	<managerEvent name="PresenceStatus" language="en_US">
 		<managerEventInstance class="EVENT_FLAG_CALL">
 			<synopsis>Raised when a hint changes due to a presence state change.</synopsis>
@@ -1408,34 +1458,111 @@ enum add_filter_result {
 };
 
 /*!
- * Linked list of events.
- * Global events are appended to the list by append_event().
- * The usecount is the number of stored pointers to the element,
- * excluding the list pointers. So an element that is only in
- * the list has a usecount of 0, not 1.
- *
- * Clients have a pointer to the last event processed, and for each
- * of these clients we track the usecount of the elements.
- * If we have a pointer to an entry in the list, it is safe to navigate
- * it forward because elements will not be deleted, but only appended.
- * The worst that can happen is seeing the pointer still NULL.
+ * A compiled manager event filter.
  *
- * When the usecount of an element drops to 0, and the element is the
- * first in the list, we can remove it. Removal is done within the
- * main thread, which is woken up for the purpose.
+ * Filters are parsed once when they are added so that matching an event
+ * runs as little as possible.  A regex filter that only names an event,
+ * such as "Event: Newchannel", is matched against the Event header
+ * without running the regex.  A structured filter, such as
+ * "Event=Newstate&ChannelState=6", compares header values without any
+ * regex at all.
+ */
+struct event_filter {
+	/*! Event the filter is limited to, NULL if it considers every event */
+	char *event_name;
+	/*! Header conditions of a structured filter, name is the header */
+	struct ast_variable *conditions;
+	/*! Regex run on the whole event, valid if has_regex is set */
+	regex_t regex;
+	/*! Length of event_name if it is a prefix rather than the whole name */
+	size_t event_prefix_len;
+	unsigned int has_regex:1;
+};
+
+/*! Compiled event filters of a user or session */
+struct event_filters {
+	/*! Whitelisted event names, checked before the white filters */
+	struct ao2_container *white_names;
+	/*! Blacklisted event names, checked before the black filters */
+	struct ao2_container *black_names;
+	/*! White filters that are not just an event name */
+	struct ao2_container *white;
+	/*! Black filters that are not just an event name */
+	struct ao2_container *black;
+};
+
+/*!
+ * A formatted event queued to the manager sessions.
  *
- * For simplicity of implementation, we make sure the list is never empty.
+ * Events are created by __manager_event_sessions_va() and pushed onto the
+ * event queue of every session that may want them.  They are ao2 objects
+ * shared by those queues, so an event is freed once every session has sent
+ * or dropped it, and a slow session only holds on to its own backlog.
  */
 struct eventqent {
-	int usecount;		/*!< # of clients who still need the event */
 	int category;
-	unsigned int seq;	/*!< sequence number */
-	struct timeval tv;  /*!< When event was allocated */
-	AST_RWLIST_ENTRY(eventqent) eq_next;
-	char eventdata[1];	/*!< really variable size, allocated by append_event() */
+	char eventdata[1];	/*!< really variable size, allocated by event_create() */
+};
+
+/*! What happens to an event for a session whose event queue is full */
+enum event_overflow_policy {
+	/*! The oldest queued event is dropped */
+	EVENT_OVERFLOW_DROP_OLDEST,
+	/*! The new event is dropped */
+	EVENT_OVERFLOW_DROP_NEWEST,
+	/*! The session is disconnected */
+	EVENT_OVERFLOW_DISCONNECT,
+};
+
+/*! Bounded ring of the events a session has not sent yet */
+struct event_ring {
+	/*! Queued events, starting at head */
+	struct eventqent **events;
+	/*! Number of slots in events, grown as needed up to event_queue_size */
+	unsigned int size;
+	/*! Slot of the oldest queued event */
+	unsigned int head;
+	/*! Number of queued events */
+	unsigned int count;
+	/*! Events dropped since the session was last told with EventsDropped */
+	unsigned int dropped;
+	/*! Events dropped during the life of the session */
+	unsigned long dropped_total;
+	/*! The ring overflowed with EVENT_OVERFLOW_DISCONNECT */
+	unsigned int overflowed:1;
 };
 
-static AST_RWLIST_HEAD_STATIC(all_events, eventqent);
+#define DEFAULT_EVENT_QUEUE_SIZE 10000
+
+/*! Most events queued to one session */
+static unsigned int event_queue_size = DEFAULT_EVENT_QUEUE_SIZE;
+/*! What happens to events for a session whose queue is full */
+static enum event_overflow_policy event_overflow = EVENT_OVERFLOW_DROP_OLDEST;
+
+/*!
+ * What the sessions want to receive, so that an event nobody wants is
+ * not formatted.  Built by event_interest_get() from the sessions and
+ * rebuilt once event_interest_changed() has been called.
+ */
+struct event_interest {
+	/*! Value of event_interest_generation the interest was built from */
+	int generation;
+	/*! Union of the event categories the sessions accept */
+	int categories;
+	/*! Union of the event names the sessions whitelist, NULL if any session accepts other events */
+	struct ao2_container *names;
+};
+
+/*! Bumped whenever what a session wants to receive changes */
+static int event_interest_generation;
+/*! Serializes replacing event_interest */
+AST_MUTEX_DEFINE_STATIC(event_interest_lock);
+
+/*! \brief Mark the event interest as stale after a session changed what it wants */
+static void event_interest_changed(void)
+{
+	ast_atomic_fetchadd_int(&event_interest_generation, 1);
+}
 
 static int displayconnects = 1;
 static int allowmultiplelogin = 1;
@@ -1506,6 +1633,8 @@ static void acl_change_stasis_subscribe(void)
 	if (!acl_change_sub) {
 		acl_change_sub = stasis_subscribe(ast_security_topic(),
 			acl_change_stasis_cb, NULL);
+		stasis_subscription_accept_message_type(acl_change_sub, ast_named_acl_change_type());
+		stasis_subscription_set_filter(acl_change_sub, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 	}
 }
 
@@ -1564,11 +1693,10 @@ struct mansession_session {
 	int writeperm;		/*!< Authorization for writing */
 	char inbuf[1025];	/*!< Buffer -  we use the extra byte to add a '\\0' and simplify parsing */
 	int inlen;		/*!< number of buffered bytes */
-	struct ao2_container *whitefilters;	/*!< Manager event filters - white list */
-	struct ao2_container *blackfilters;	/*!< Manager event filters - black list */
+	struct event_filters filters;	/*!< Manager event filters */
 	struct ast_variable *chanvars;  /*!< Channel variables to set for originate */
 	int send_events;	/*!<  XXX what ? */
-	struct eventqent *last_ev;	/*!< last event processed. */
+	struct event_ring events;	/*!< Events not sent yet */
 	int writetimeout;	/*!< Timeout for ast_carefulwrite() */
 	time_t authstart;
 	int pending_event;         /*!< Pending events indicator in case when waiting_thread is NULL */
@@ -1602,6 +1730,9 @@ struct mansession {
 /*! Active manager connection sessions container. */
 static AO2_GLOBAL_OBJ_STATIC(mgr_sessions);
 
+/*! \brief The current struct event_interest */
+static AO2_GLOBAL_OBJ_STATIC(event_interest);
+
 /*! \brief user descriptor, as read from the config file.
  *
  * \note It is still missing some fields -- e.g. we can have multiple permit and deny
@@ -1617,8 +1748,7 @@ struct ast_manager_user {
 	int displayconnects;		/*!< XXX unused */
 	int allowmultiplelogin; /*!< Per user option*/
 	int keep;			/*!< mark entries created on a reload */
-	struct ao2_container *whitefilters; /*!< Manager event filters - white list */
-	struct ao2_container *blackfilters; /*!< Manager event filters - black list */
+	struct event_filters filters; /*!< Manager event filters */
 	struct ast_acl_list *acl;       /*!< ACL setting */
 	char *a1_hash;			/*!< precalculated A1 for Digest auth */
 	struct ast_variable *chanvars;  /*!< Channel variables to set for originate */
@@ -1637,6 +1767,12 @@ static AST_RWLIST_HEAD_STATIC(manager_hooks, manager_custom_hook);
 /*! \brief A container of event documentation nodes */
 static AO2_GLOBAL_OBJ_STATIC(event_docs);
 
+#ifdef AST_XML_DOCS
+/*! \brief Serializes building action and event documentation on first use */
+AST_MUTEX_DEFINE_STATIC(action_docs_lock);
+AST_MUTEX_DEFINE_STATIC(event_docs_lock);
+#endif
+
 static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
 	struct ao2_container *sessions,
 	int category,
@@ -1648,7 +1784,7 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions(
 	const char *func,
 	const char *fmt,
 	...);
-static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters);
+static enum add_filter_result manager_add_filter(const char *filter_pattern, struct event_filters *filters);
 
 static int match_filter(struct mansession *s, char *eventdata);
 
@@ -1792,6 +1928,149 @@ struct ast_str *ast_manager_str_from_json_object(struct ast_json *blob, key_excl
 #define any_manager_listeners(sessions)	\
 	((sessions && ao2_container_count(sessions)) || !AST_RWLIST_EMPTY(&manager_hooks))
 
+static void event_interest_destructor(void *obj)
+{
+	struct event_interest *interest = obj;
+
+	ao2_cleanup(interest->names);
+}
+
+/*!
+ * \internal
+ * \brief Build what the sessions want to receive.
+ *
+ * \param sessions Manager sessions.
+ * \param generation Value of event_interest_generation read before looking at the sessions.
+ *
+ * \return New interest on success.
+ * \retval NULL on error.
+ */
+static struct event_interest *event_interest_build(struct ao2_container *sessions, int generation)
+{
+	struct event_interest *interest;
+	struct ao2_iterator iter;
+	struct mansession_session *session;
+	int accepted;
+
+	interest = ao2_alloc_options(sizeof(*interest), event_interest_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!interest) {
+		return NULL;
+	}
+	interest->generation = generation;
+	interest->names = ast_str_container_alloc(7);
+	if (!interest->names) {
+		ao2_ref(interest, -1);
+		return NULL;
+	}
+
+	iter = ao2_iterator_init(sessions, 0);
+	while ((session = ao2_iterator_next(&iter))) {
+		ao2_lock(session);
+		/* See event_wanted() */
+		accepted = session->managerid
+			? session->readperm : session->readperm & session->send_events;
+		ao2_unlock(session);
+
+		if (accepted) {
+			interest->categories |= accepted;
+			if (interest->names && !ao2_container_count(session->filters.white)
+				&& ao2_container_count(session->filters.white_names)) {
+				ao2_container_dup(interest->names, session->filters.white_names, 0);
+			} else {
+				/* The session is not limited to a set of event names */
+				ao2_cleanup(interest->names);
+				interest->names = NULL;
+			}
+		}
+		ao2_ref(session, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return interest;
+}
+
+/*!
+ * \internal
+ * \brief Get what the sessions want to receive, rebuilding it if it is stale.
+ *
+ * \param sessions Manager sessions.
+ *
+ * \return Current interest, which must be unreffed.
+ * \retval NULL on error.
+ */
+static struct event_interest *event_interest_get(struct ao2_container *sessions)
+{
+	int generation = ast_atomic_fetchadd_int(&event_interest_generation, 0);
+	struct event_interest *interest;
+	struct event_interest *current;
+
+	interest = ao2_global_obj_ref(event_interest);
+	if (interest && interest->generation == generation) {
+		return interest;
+	}
+	ao2_cleanup(interest);
+
+	interest = event_interest_build(sessions, generation);
+	if (!interest) {
+		return NULL;
+	}
+
+	/* Do not replace an interest built from a later generation by another thread. */
+	ast_mutex_lock(&event_interest_lock);
+	current = ao2_global_obj_ref(event_interest);
+	if (!current || current->generation - generation < 0) {
+		ao2_global_obj_replace_unref(event_interest, interest);
+	}
+	ast_mutex_unlock(&event_interest_lock);
+	ao2_cleanup(current);
+
+	return interest;
+}
+
+/*!
+ * \internal
+ * \brief Determine if an event may be wanted by anybody before formatting it.
+ *
+ * \param sessions Manager sessions.
+ * \param category Event category.
+ * \param event Event name.
+ *
+ * \retval 0 if no session or hook can want the event.
+ * \retval non-zero if the event needs to be formatted.
+ */
+static int manager_event_wanted(struct ao2_container *sessions, int category, const char *event)
+{
+	struct event_interest *interest;
+	int wanted;
+
+	if (!AST_RWLIST_EMPTY(&manager_hooks)) {
+		/* Hooks receive every event */
+		return 1;
+	}
+	if (!sessions || !ao2_container_count(sessions)) {
+		return 0;
+	}
+	if (!category || category == EVENT_FLAG_SHUTDOWN) {
+		return 1;
+	}
+
+	interest = event_interest_get(sessions);
+	if (!interest) {
+		return 1;
+	}
+	wanted = (interest->categories & category) == category;
+	if (wanted && interest->names && !ast_strlen_zero(event)) {
+		char *name = ao2_find(interest->names, event, OBJ_SEARCH_KEY);
+
+		wanted = name ? 1 : 0;
+		ao2_cleanup(name);
+	}
+	ao2_ref(interest, -1);
+
+	return wanted;
+}
+
 static void manager_default_msg_cb(void *data, struct stasis_subscription *sub,
 				    struct stasis_message *message)
 {
@@ -1817,8 +2096,10 @@ static void manager_default_msg_cb(void *data, struct stasis_subscription *sub,
 		return;
 	}
 
-	manager_event_sessions(sessions, ev->event_flags, ev->manager_event,
-		"%s", ev->extra_fields);
+	if (manager_event_wanted(sessions, ev->event_flags, ev->manager_event)) {
+		manager_event_sessions(sessions, ev->event_flags, ev->manager_event,
+			"%s", ev->extra_fields);
+	}
 	ao2_ref(ev, -1);
 	ao2_cleanup(sessions);
 }
@@ -1843,6 +2124,11 @@ static void manager_generic_msg_cb(void *data, struct stasis_subscription *sub,
 	payload = stasis_message_data(message);
 	class_type = ast_json_integer_get(ast_json_object_get(payload->json, "class_type"));
 	type = ast_json_string_get(ast_json_object_get(payload->json, "type"));
+	if (!manager_event_wanted(sessions, class_type, type)) {
+		/* Nobody wants this event */
+		ao2_cleanup(sessions);
+		return;
+	}
 	event = ast_json_object_get(payload->json, "event");
 
 	event_buffer = ast_manager_str_from_json_object(event, NULL);
@@ -1914,55 +2200,169 @@ int check_webmanager_enabled(void)
 }
 
 /*!
- * Grab a reference to the last event, update usecount as needed.
- * Can handle a NULL pointer.
+ * \internal
+ * \brief Create an event to queue to the sessions.
+ *
+ * \param str Formatted event.
+ * \param category Event category.
+ *
+ * \retval event on success.
+ * \retval NULL on error.
  */
-static struct eventqent *grab_last(void)
+static struct eventqent *event_create(const char *str, int category)
 {
-	struct eventqent *ret;
+	struct eventqent *eqe;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	ret = AST_RWLIST_LAST(&all_events);
-	/* the list is never empty now, but may become so when
-	 * we optimize it in the future, so be prepared.
-	 */
-	if (ret) {
-		ast_atomic_fetchadd_int(&ret->usecount, 1);
+	eqe = ao2_alloc_options(sizeof(*eqe) + strlen(str), NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!eqe) {
+		return NULL;
 	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return ret;
+	eqe->category = category;
+	strcpy(eqe->eventdata, str); /* Safe */
+
+	return eqe;
 }
 
 /*!
- * Purge unused events. Remove elements from the head
- * as long as their usecount is 0 and there is a next element.
+ * \internal
+ * \brief Remove the oldest event of an event ring.
+ *
+ * \param ring Event ring of a locked session.
+ *
+ * \retval event whose reference now belongs to the caller.
+ * \retval NULL if the ring is empty.
  */
-static void purge_events(void)
+static struct eventqent *event_ring_pop(struct event_ring *ring)
 {
-	struct eventqent *ev;
-	struct timeval now = ast_tvnow();
+	struct eventqent *eqe;
 
-	AST_RWLIST_WRLOCK(&all_events);
-	while ( (ev = AST_RWLIST_FIRST(&all_events)) &&
-	    ev->usecount == 0 && AST_RWLIST_NEXT(ev, eq_next)) {
-		AST_RWLIST_REMOVE_HEAD(&all_events, eq_next);
-		ast_free(ev);
+	if (!ring->count) {
+		return NULL;
 	}
+	eqe = ring->events[ring->head];
+	ring->events[ring->head] = NULL;
+	ring->head = (ring->head + 1) % ring->size;
+	--ring->count;
 
-	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&all_events, ev, eq_next) {
-		/* Never release the last event */
-		if (!AST_RWLIST_NEXT(ev, eq_next)) {
+	return eqe;
+}
+
+/*!
+ * \internal
+ * \brief Grow an event ring by doubling it, up to the event queue size.
+ *
+ * \param ring Event ring of a locked session.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int event_ring_grow(struct event_ring *ring)
+{
+	struct eventqent **events;
+	unsigned int size;
+	unsigned int i;
+
+	size = ring->size ? ring->size * 2 : 64;
+	if (size > event_queue_size) {
+		size = event_queue_size;
+	}
+	if (size <= ring->count) {
+		return -1;
+	}
+
+	events = ast_calloc(size, sizeof(*events));
+	if (!events) {
+		return -1;
+	}
+	for (i = 0; i < ring->count; ++i) {
+		events[i] = ring->events[(ring->head + i) % ring->size];
+	}
+	ast_free(ring->events);
+	ring->events = events;
+	ring->size = size;
+	ring->head = 0;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue an event to a session, applying the overflow policy if it is full.
+ *
+ * \param ring Event ring of a locked session.
+ * \param eqe Event to queue.  The ring takes its own reference.
+ *
+ * \return Nothing
+ */
+static void event_ring_push(struct event_ring *ring, struct eventqent *eqe)
+{
+	if (ring->count == ring->size
+		&& (ring->count >= event_queue_size || event_ring_grow(ring))) {
+		++ring->dropped;
+		++ring->dropped_total;
+		switch (event_overflow) {
+		case EVENT_OVERFLOW_DROP_OLDEST:
+			ao2_cleanup(event_ring_pop(ring));
 			break;
+		case EVENT_OVERFLOW_DROP_NEWEST:
+			return;
+		case EVENT_OVERFLOW_DISCONNECT:
+			ring->overflowed = 1;
+			return;
 		}
-
-		/* 2.5 times whatever the HTTP timeout is (maximum 2.5 hours) is the maximum time that we will definitely cache an event */
-		if (ev->usecount == 0 && ast_tvdiff_sec(now, ev->tv) > (httptimeout > 3600 ? 3600 : httptimeout) * 2.5) {
-			AST_RWLIST_REMOVE_CURRENT(eq_next);
-			ast_free(ev);
+		if (!ring->size) {
+			/* The ring could not even be allocated. */
+			return;
 		}
 	}
-	AST_RWLIST_TRAVERSE_SAFE_END;
-	AST_RWLIST_UNLOCK(&all_events);
+
+	ring->events[(ring->head + ring->count) % ring->size] = ao2_bump(eqe);
+	++ring->count;
+}
+
+/*!
+ * \internal
+ * \brief Release the events of an event ring.
+ *
+ * \param ring Event ring to empty.
+ *
+ * \return Nothing
+ */
+static void event_ring_destroy(struct event_ring *ring)
+{
+	struct eventqent *eqe;
+
+	while ((eqe = event_ring_pop(ring))) {
+		ao2_ref(eqe, -1);
+	}
+	ast_free(ring->events);
+	ring->events = NULL;
+	ring->size = 0;
+}
+
+/*!
+ * \internal
+ * \brief Format the event telling a session how many of its events were dropped.
+ *
+ * \param ring Event ring of a locked session.
+ * \param buf Where to format the event.
+ * \param size Size of \a buf.
+ *
+ * \retval 0 if no events were dropped since the session was last told.
+ * \retval 1 if an event was formatted into \a buf.
+ */
+static int event_ring_dropped(struct event_ring *ring, char *buf, size_t size)
+{
+	if (!ring->dropped) {
+		return 0;
+	}
+	snprintf(buf, size,
+		"Event: EventsDropped\r\n"
+		"Privilege: system,all\r\n"
+		"Dropped: %u\r\n"
+		"\r\n", ring->dropped);
+	ring->dropped = 0;
+	return 1;
 }
 
 /*!
@@ -2148,14 +2548,65 @@ static struct mansession_session *unref_mansession(struct mansession_session *s)
 
 static void event_filter_destructor(void *obj)
 {
-	regex_t *regex_filter = obj;
-	regfree(regex_filter);
+	struct event_filter *filter = obj;
+
+	ast_free(filter->event_name);
+	ast_variables_destroy(filter->conditions);
+	if (filter->has_regex) {
+		regfree(&filter->regex);
+	}
+}
+
+static int event_filters_init(struct event_filters *filters)
+{
+	filters->white_names = ast_str_container_alloc(7);
+	filters->black_names = ast_str_container_alloc(7);
+	filters->white = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	filters->black = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+
+	return filters->white_names && filters->black_names && filters->white && filters->black
+		? 0 : -1;
+}
+
+static void event_filters_destroy(struct event_filters *filters)
+{
+	ao2_cleanup(filters->white_names);
+	filters->white_names = NULL;
+	ao2_cleanup(filters->black_names);
+	filters->black_names = NULL;
+	ao2_cleanup(filters->white);
+	filters->white = NULL;
+	ao2_cleanup(filters->black);
+	filters->black = NULL;
+}
+
+static void event_filters_clear(struct event_filters *filters)
+{
+	ao2_callback(filters->white_names, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	ao2_callback(filters->black_names, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	ao2_callback(filters->white, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	ao2_callback(filters->black, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+}
+
+static int event_filters_count(struct event_filters *filters, int black)
+{
+	return black
+		? ao2_container_count(filters->black_names) + ao2_container_count(filters->black)
+		: ao2_container_count(filters->white_names) + ao2_container_count(filters->white);
+}
+
+/*! \brief Copy the filters of a user to a session.  Compiled filters are shared. */
+static void event_filters_copy(struct event_filters *dst, struct event_filters *src)
+{
+	ao2_container_dup(dst->white_names, src->white_names, 0);
+	ao2_container_dup(dst->black_names, src->black_names, 0);
+	ao2_container_dup(dst->white, src->white, 0);
+	ao2_container_dup(dst->black, src->black, 0);
 }
 
 static void session_destructor(void *obj)
 {
 	struct mansession_session *session = obj;
-	struct eventqent *eqe = session->last_ev;
 	struct ast_datastore *datastore;
 
 	/* Get rid of each of the data stores on the session */
@@ -2164,20 +2615,12 @@ static void session_destructor(void *obj)
 		ast_datastore_free(datastore);
 	}
 
-	if (eqe) {
-		ast_atomic_fetchadd_int(&eqe->usecount, -1);
-	}
+	event_ring_destroy(&session->events);
 	if (session->chanvars) {
 		ast_variables_destroy(session->chanvars);
 	}
 
-	if (session->whitefilters) {
-		ao2_t_ref(session->whitefilters, -1, "decrement ref for white container, should be last one");
-	}
-
-	if (session->blackfilters) {
-		ao2_t_ref(session->blackfilters, -1, "decrement ref for black container, should be last one");
-	}
+	event_filters_destroy(&session->filters);
 }
 
 /*! \brief Allocate manager session structure and add it to the list of sessions */
@@ -2191,9 +2634,7 @@ static struct mansession_session *build_mansession(const struct ast_sockaddr *ad
 		return NULL;
 	}
 
-	newsession->whitefilters = ao2_container_alloc(1, NULL, NULL);
-	newsession->blackfilters = ao2_container_alloc(1, NULL, NULL);
-	if (!newsession->whitefilters || !newsession->blackfilters) {
+	if (event_filters_init(&newsession->filters)) {
 		ao2_ref(newsession, -1);
 		return NULL;
 	}
@@ -2228,6 +2669,7 @@ static void session_destroy(struct mansession_session *s)
 		ao2_unlink(sessions, s);
 		ao2_ref(sessions, -1);
 	}
+	event_interest_changed();
 	unref_mansession(s);
 }
 
@@ -2287,6 +2729,28 @@ static int manager_displayconnects(struct mansession_session *session)
 }
 
 static void print_event_instance(struct ast_cli_args *a, struct ast_xml_doc_item *instance);
+#ifdef AST_XML_DOCS
+static void action_build_docs(struct manager_action *cur);
+#endif
+
+/*!
+ * \internal
+ * \brief Make sure an action's documentation has been built.
+ *
+ * With lazy XML documentation this is put off from registration until the
+ * documentation is first shown.
+ */
+static void action_load_docs(struct manager_action *cur)
+{
+#ifdef AST_XML_DOCS
+	ast_mutex_lock(&action_docs_lock);
+	if (cur->docs_pending) {
+		action_build_docs(cur);
+		cur->docs_pending = 0;
+	}
+	ast_mutex_unlock(&action_docs_lock);
+#endif
+}
 
 static char *handle_showmancmd(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
@@ -2342,6 +2806,7 @@ static char *handle_showmancmd(struct ast_cli_entry *e, int cmd, struct ast_cli_
 		for (num = 3; num < a->argc; num++) {
 			if (!strcasecmp(cur->action, a->argv[num])) {
 				auth_str = authority_to_str(cur->authority, &authority);
+				action_load_docs(cur);
 
 #ifdef AST_XML_DOCS
 				if (cur->docsrc == AST_XML_DOC) {
@@ -2568,6 +3033,7 @@ static char *handle_showmancmds(struct ast_cli_entry *e, int cmd, struct ast_cli
 	ast_cli(a->fd, HSMC_FORMAT, name_len, name_len, "------", space_remaining, "--------");
 
 	AST_RWLIST_TRAVERSE(&actions, cur, list) {
+		action_load_docs(cur);
 		ast_cli(a->fd, HSMC_FORMAT, name_len, name_len, cur->action, space_remaining, cur->synopsis);
 	}
 	AST_RWLIST_UNLOCK(&actions);
@@ -2626,28 +3092,43 @@ static char *handle_showmanconn(struct ast_cli_entry *e, int cmd, struct ast_cli
 }
 
 /*! \brief CLI command manager list eventq */
-/* Should change to "manager show connected" */
 static char *handle_showmaneventq(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
-	struct eventqent *s;
+	struct ao2_container *sessions;
+	struct mansession_session *session;
+	struct ao2_iterator i;
+#define HSMEQ_FORMAT "  %-15.15s  %-55.55s  %10s  %10s\n"
+#define HSMEQ_FORMAT2 "  %-15.15s  %-55.55s  %10u  %10lu\n"
+
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "manager show eventq";
 		e->usage =
 			"Usage: manager show eventq\n"
-			"	Prints a listing of all events pending in the Asterisk manger\n"
-			"event queue.\n";
+			"	Prints how many events are queued to each manager session\n"
+			"	and how many were dropped because its queue was full.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
 	}
-	AST_RWLIST_RDLOCK(&all_events);
-	AST_RWLIST_TRAVERSE(&all_events, s, eq_next) {
-		ast_cli(a->fd, "Usecount: %d\n", s->usecount);
-		ast_cli(a->fd, "Category: %d\n", s->category);
-		ast_cli(a->fd, "Event:\n%s", s->eventdata);
+
+	ast_cli(a->fd, HSMEQ_FORMAT, "Username", "IP Address", "Queued", "Dropped");
+	sessions = ao2_global_obj_ref(mgr_sessions);
+	if (sessions) {
+		i = ao2_iterator_init(sessions, 0);
+		ao2_ref(sessions, -1);
+		while ((session = ao2_iterator_next(&i))) {
+			ao2_lock(session);
+			ast_cli(a->fd, HSMEQ_FORMAT2, session->username,
+				ast_sockaddr_stringify_addr(&session->addr),
+				session->events.count, session->events.dropped_total);
+			ao2_unlock(session);
+			unref_mansession(session);
+		}
+		ao2_iterator_destroy(&i);
 	}
-	AST_RWLIST_UNLOCK(&all_events);
+#undef HSMEQ_FORMAT
+#undef HSMEQ_FORMAT2
 
 	return CLI_SUCCESS;
 }
@@ -2672,19 +3153,6 @@ static char *handle_manager_reload(struct ast_cli_entry *e, int cmd, struct ast_
 	return CLI_SUCCESS;
 }
 
-static struct eventqent *advance_event(struct eventqent *e)
-{
-	struct eventqent *next;
-
-	AST_RWLIST_RDLOCK(&all_events);
-	if ((next = AST_RWLIST_NEXT(e, eq_next))) {
-		ast_atomic_fetchadd_int(&next->usecount, 1);
-		ast_atomic_fetchadd_int(&e->usecount, -1);
-	}
-	AST_RWLIST_UNLOCK(&all_events);
-	return next;
-}
-
 #define	GET_HEADER_FIRST_MATCH	0
 #define	GET_HEADER_LAST_MATCH	1
 #define	GET_HEADER_SKIP_EMPTY	2
@@ -3061,31 +3529,191 @@ void astman_send_ack(struct mansession *s, const struct message *m, char *msg)
 
 static void astman_start_ack(struct mansession *s, const struct message *m)
 {
-	astman_send_response_full(s, m, "Success", MSG_MOREDATA, NULL);
+	astman_send_response_full(s, m, "Success", MSG_MOREDATA, NULL);
+}
+
+void astman_send_listack(struct mansession *s, const struct message *m, char *msg, char *listflag)
+{
+	astman_send_response_full(s, m, "Success", msg, listflag);
+}
+
+void astman_send_list_complete_start(struct mansession *s, const struct message *m, const char *event_name, int count)
+{
+	const char *id = astman_get_header(m, "ActionID");
+
+	astman_append(s, "Event: %s\r\n", event_name);
+	if (!ast_strlen_zero(id)) {
+		astman_append(s, "ActionID: %s\r\n", id);
+	}
+	astman_append(s,
+		"EventList: Complete\r\n"
+		"ListItems: %d\r\n",
+		count);
+}
+
+void astman_send_list_complete_end(struct mansession *s)
+{
+	astman_append(s, "\r\n");
+}
+
+/*! Events are written to the session once this much is buffered */
+#define LIST_STREAM_CHUNK_SIZE 16384
+
+/*!
+ * The events of a list action, written to the session in chunks.
+ *
+ * Each event is projected onto the headers the client asked for with the
+ * Fields header of the action and buffered until a chunk is ready, so a
+ * list of thousands of items is neither written one small write at a time
+ * nor held in memory as a whole.
+ */
+struct list_stream {
+	struct mansession *s;
+	/*! Projected events not written yet */
+	struct ast_str *buf;
+	/*! Scratch buffer an event is formatted in */
+	struct ast_str *event;
+	/*! Headers to keep, empty to keep them all */
+	AST_VECTOR(, char *) fields;
+	/*! Backing storage of fields */
+	char *fields_str;
+};
+
+/*!
+ * \internal
+ * \brief Start writing the events of a list action.
+ *
+ * \param stream List stream to initialize.
+ * \param s Session to write to.
+ * \param m Action, whose optional Fields header lists the headers to send.
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int list_stream_init(struct list_stream *stream, struct mansession *s, const struct message *m)
+{
+	const char *fields = astman_get_header(m, "Fields");
+	char *cur;
+	char *field;
+
+	memset(stream, 0, sizeof(*stream));
+	stream->s = s;
+	stream->buf = ast_str_create(LIST_STREAM_CHUNK_SIZE + 1024);
+	stream->event = ast_str_create(1024);
+	if (!stream->buf || !stream->event || AST_VECTOR_INIT(&stream->fields, 0)) {
+		ast_free(stream->buf);
+		ast_free(stream->event);
+		return -1;
+	}
+
+	if (ast_strlen_zero(fields)) {
+		return 0;
+	}
+	stream->fields_str = ast_strdup(fields);
+	if (!stream->fields_str) {
+		return 0;
+	}
+	cur = stream->fields_str;
+	while ((field = strsep(&cur, ","))) {
+		field = ast_strip(field);
+		if (!ast_strlen_zero(field)) {
+			AST_VECTOR_APPEND(&stream->fields, field);
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Determine if a header line of an event is sent.
+ */
+static int list_stream_keep(struct list_stream *stream, const char *line, size_t len)
+{
+	const char *colon = memchr(line, ':', len);
+	size_t name_len;
+	int i;
+
+	if (!AST_VECTOR_SIZE(&stream->fields) || !colon) {
+		return 1;
+	}
+	name_len = colon - line;
+	if ((name_len == 5 && !strncasecmp(line, "Event", 5))
+		|| (name_len == 8 && !strncasecmp(line, "ActionID", 8))) {
+		return 1;
+	}
+	for (i = 0; i < AST_VECTOR_SIZE(&stream->fields); ++i) {
+		const char *field = AST_VECTOR_GET(&stream->fields, i);
+
+		if (strlen(field) == name_len && !strncasecmp(line, field, name_len)) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Write out the buffered events of a list stream.
+ */
+static void list_stream_flush(struct list_stream *stream)
+{
+	if (ast_str_strlen(stream->buf)) {
+		astman_append(stream->s, "%s", ast_str_buffer(stream->buf));
+		ast_str_reset(stream->buf);
+	}
 }
 
-void astman_send_listack(struct mansession *s, const struct message *m, char *msg, char *listflag)
+/*!
+ * \internal
+ * \brief Add an event to a list stream.
+ *
+ * \param stream List stream.
+ * \param fmt Format of the whole event, including its terminating empty line.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the session can no longer be written to.
+ */
+static int __attribute__((format(printf, 2, 3))) list_stream_append(struct list_stream *stream, const char *fmt, ...)
 {
-	astman_send_response_full(s, m, "Success", msg, listflag);
-}
+	va_list ap;
+	const char *line;
+	const char *end;
 
-void astman_send_list_complete_start(struct mansession *s, const struct message *m, const char *event_name, int count)
-{
-	const char *id = astman_get_header(m, "ActionID");
+	va_start(ap, fmt);
+	ast_str_set_va(&stream->event, 0, fmt, ap);
+	va_end(ap);
 
-	astman_append(s, "Event: %s\r\n", event_name);
-	if (!ast_strlen_zero(id)) {
-		astman_append(s, "ActionID: %s\r\n", id);
+	if (!AST_VECTOR_SIZE(&stream->fields)) {
+		ast_str_append(&stream->buf, 0, "%s", ast_str_buffer(stream->event));
+	} else {
+		for (line = ast_str_buffer(stream->event); *line; line = end) {
+			end = strchr(line, '\n');
+			end = end ? end + 1 : line + strlen(line);
+			if (list_stream_keep(stream, line, end - line)) {
+				ast_str_append(&stream->buf, 0, "%.*s", (int) (end - line), line);
+			}
+		}
 	}
-	astman_append(s,
-		"EventList: Complete\r\n"
-		"ListItems: %d\r\n",
-		count);
+
+	/* Hooks get each event on its own */
+	if (stream->s->hook || ast_str_strlen(stream->buf) >= LIST_STREAM_CHUNK_SIZE) {
+		list_stream_flush(stream);
+	}
+
+	return stream->s->write_error ? -1 : 0;
 }
 
-void astman_send_list_complete_end(struct mansession *s)
+/*!
+ * \internal
+ * \brief Write out what is left of a list stream and free it.
+ */
+static void list_stream_end(struct list_stream *stream)
 {
-	astman_append(s, "\r\n");
+	list_stream_flush(stream);
+	ast_free(stream->buf);
+	ast_free(stream->event);
+	AST_VECTOR_FREE(&stream->fields);
+	ast_free(stream->fields_str);
 }
 
 /*! \brief Lock the 'mansession' structure. */
@@ -3113,6 +3741,7 @@ static int set_eventmask(struct mansession *s, const char *eventmask)
 		s->session->send_events = maskint;
 	}
 	ao2_unlock(s->session);
+	event_interest_changed();
 
 	return maskint;
 }
@@ -3349,8 +3978,6 @@ static int authenticate(struct mansession *s, const struct message *m)
 	const char *password = astman_get_header(m, "Secret");
 	int error = -1;
 	struct ast_manager_user *user = NULL;
-	regex_t *regex_filter;
-	struct ao2_iterator filter_iter;
 
 	if (ast_strlen_zero(username)) {	/* missing username */
 		return -1;
@@ -3416,19 +4043,7 @@ static int authenticate(struct mansession *s, const struct message *m)
 		s->session->chanvars = ast_variables_dup(user->chanvars);
 	}
 
-	filter_iter = ao2_iterator_init(user->whitefilters, 0);
-	while ((regex_filter = ao2_iterator_next(&filter_iter))) {
-		ao2_t_link(s->session->whitefilters, regex_filter, "add white user filter to session");
-		ao2_t_ref(regex_filter, -1, "remove iterator ref");
-	}
-	ao2_iterator_destroy(&filter_iter);
-
-	filter_iter = ao2_iterator_init(user->blackfilters, 0);
-	while ((regex_filter = ao2_iterator_next(&filter_iter))) {
-		ao2_t_link(s->session->blackfilters, regex_filter, "add black user filter to session");
-		ao2_t_ref(regex_filter, -1, "remove iterator ref");
-	}
-	ao2_iterator_destroy(&filter_iter);
+	event_filters_copy(&s->session->filters, &user->filters);
 
 	s->session->sessionstart = time(NULL);
 	s->session->sessionstart_tv = ast_tvnow();
@@ -4090,6 +4705,7 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 		}
 	}
 	ao2_unlock(s->session);
+	event_interest_changed();
 
 	/* XXX should this go inside the lock ? */
 	s->session->waiting_thread = pthread_self();	/* let new events wake up this thread */
@@ -4097,7 +4713,7 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	for (x = 0; x < timeout || timeout < 0; x++) {
 		ao2_lock(s->session);
-		if (AST_RWLIST_NEXT(s->session->last_ev, eq_next)) {
+		if (s->session->events.count) {
 			needexit = 1;
 		}
 		/* We can have multiple HTTP session point to the same mansession entry.
@@ -4126,15 +4742,20 @@ static int action_waitevent(struct mansession *s, const struct message *m)
 
 	ao2_lock(s->session);
 	if (s->session->waiting_thread == pthread_self()) {
-		struct eventqent *eqe = s->session->last_ev;
+		struct eventqent *eqe;
+		char dropped[128];
+
 		astman_send_response(s, m, "Success", "Waiting for Event completed.");
-		while ((eqe = advance_event(eqe))) {
+		if (event_ring_dropped(&s->session->events, dropped, sizeof(dropped))) {
+			astman_append(s, "%s", dropped);
+		}
+		while ((eqe = event_ring_pop(&s->session->events))) {
 			if (((s->session->readperm & eqe->category) == eqe->category)
 				&& ((s->session->send_events & eqe->category) == eqe->category)
 				&& match_filter(s, eqe->eventdata)) {
 				astman_append(s, "%s", eqe->eventdata);
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
 		}
 		astman_append(s,
 			"Event: WaitEventComplete\r\n"
@@ -4158,6 +4779,7 @@ static int action_listcommands(struct mansession *s, const struct message *m)
 	AST_RWLIST_RDLOCK(&actions);
 	AST_RWLIST_TRAVERSE(&actions, cur, list) {
 		if ((s->session->writeperm & cur->authority) || cur->authority == 0) {
+			action_load_docs(cur);
 			astman_append(s, "%s: %s (Priv: %s)\r\n",
 				cur->action, cur->synopsis, authority_to_str(cur->authority, &temp));
 		}
@@ -4488,7 +5110,9 @@ static int action_getvar(struct mansession *s, const struct message *m)
 	return 0;
 }
 
-static void generate_status(struct mansession *s, struct ast_channel *chan, char **vars, int varc, int all_variables, char *id_text, int *count)
+static int generate_status(struct list_stream *stream, struct ast_channel *chan,
+	struct ast_channel_snapshot *snapshot, char **vars, int varc, int all_variables,
+	char *id_text, int *count)
 {
 	struct timeval now;
 	long elapsed_seconds;
@@ -4499,18 +5123,12 @@ static void generate_status(struct mansession *s, struct ast_channel *chan, char
 	struct ast_str *codec_buf = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
 	struct ast_party_id effective_id;
 	int i;
-	RAII_VAR(struct ast_channel_snapshot *, snapshot,
-		ast_channel_snapshot_get_latest(ast_channel_uniqueid(chan)),
-		ao2_cleanup);
+	int res;
 	RAII_VAR(struct ast_str *, snapshot_str, NULL, ast_free);
 
-	if (!snapshot) {
-		return;
-	}
-
 	snapshot_str = ast_manager_build_channel_state_string(snapshot);
 	if (!snapshot_str) {
-		return;
+		return 0;
 	}
 
 	if (all_variables) {
@@ -4519,7 +5137,7 @@ static void generate_status(struct mansession *s, struct ast_channel *chan, char
 		variable_str = ast_str_create(1024);
 	}
 	if (!variable_str) {
-		return;
+		return 0;
 	}
 
 	now = ast_tvnow();
@@ -4555,7 +5173,7 @@ static void generate_status(struct mansession *s, struct ast_channel *chan, char
 	bridge = ast_channel_get_bridge(chan);
 	effective_id = ast_channel_connected_effective_id(chan);
 
-	astman_append(s,
+	res = list_stream_append(stream,
 		"Event: Status\r\n"
 		"Privilege: Call\r\n"
 		"%s"
@@ -4602,6 +5220,7 @@ static void generate_status(struct mansession *s, struct ast_channel *chan, char
 	++*count;
 
 	ao2_cleanup(bridge);
+	return res;
 }
 
 /*! \brief Manager "status" command to show channels */
@@ -4617,7 +5236,11 @@ static int action_status(struct mansession *s, const struct message *m)
 	int channels = 0;
 	int all = ast_strlen_zero(name); /* set if we want all channels */
 	char id_text[256];
-	struct ast_channel_iterator *it_chans = NULL;
+	struct ao2_container *snapshots = NULL;
+	struct ao2_iterator it_snapshots;
+	struct stasis_message *msg;
+	struct ast_channel_snapshot *snapshot;
+	struct list_stream stream;
 	AST_DECLARE_APP_ARGS(vars,
 		AST_APP_ARG(name)[100];
 	);
@@ -4632,11 +5255,13 @@ static int action_status(struct mansession *s, const struct message *m)
 	}
 
 	if (all) {
-		if (!(it_chans = ast_channel_iterator_all_new())) {
+		/* Walk a consistent dump of the channel cache rather than the live channels. */
+		snapshots = stasis_cache_dump(ast_channel_cache(), ast_channel_snapshot_type());
+		if (!snapshots) {
 			astman_send_error(s, m, "Memory Allocation Failure");
 			return 1;
 		}
-		chan = ast_channel_iterator_next(it_chans);
+		chan = NULL;
 	} else {
 		chan = ast_channel_get_by_name(name);
 		if (!chan) {
@@ -4645,6 +5270,13 @@ static int action_status(struct mansession *s, const struct message *m)
 		}
 	}
 
+	if (list_stream_init(&stream, s, m)) {
+		ao2_cleanup(snapshots);
+		ast_channel_cleanup(chan);
+		astman_send_error(s, m, "Memory Allocation Failure");
+		return 1;
+	}
+
 	astman_send_listack(s, m, "Channel status will follow", "start");
 
 	if (!ast_strlen_zero(id)) {
@@ -4657,19 +5289,43 @@ static int action_status(struct mansession *s, const struct message *m)
 		AST_STANDARD_APP_ARGS(vars, variables);
 	}
 
-	/* if we look by name, we break after the first iteration */
-	for (; chan; all ? chan = ast_channel_iterator_next(it_chans) : 0) {
-		ast_channel_lock(chan);
-
-		generate_status(s, chan, vars.name, vars.argc, all_variables, id_text, &channels);
+	if (!all) {
+		snapshot = ast_channel_snapshot_get_latest(ast_channel_uniqueid(chan));
+		if (snapshot) {
+			ast_channel_lock(chan);
+			generate_status(&stream, chan, snapshot, vars.name, vars.argc, all_variables, id_text, &channels);
+			ast_channel_unlock(chan);
+			ao2_ref(snapshot, -1);
+		}
+		ast_channel_unref(chan);
+	} else {
+		/* Each snapshot is released as soon as its channel has been written. */
+		it_snapshots = ao2_iterator_init(snapshots, AO2_ITERATOR_UNLINK);
+		for (; (msg = ao2_iterator_next(&it_snapshots)); ao2_ref(msg, -1)) {
+			int res;
+
+			snapshot = stasis_message_data(msg);
+			chan = ast_channel_get_by_name(snapshot->uniqueid);
+			if (!chan) {
+				/* Hung up since the dump */
+				continue;
+			}
 
-		ast_channel_unlock(chan);
-		chan = ast_channel_unref(chan);
+			ast_channel_lock(chan);
+			res = generate_status(&stream, chan, snapshot, vars.name, vars.argc, all_variables, id_text, &channels);
+			ast_channel_unlock(chan);
+			ast_channel_unref(chan);
+			if (res) {
+				/* The session went away, no point going on */
+				ao2_ref(msg, -1);
+				break;
+			}
+		}
+		ao2_iterator_destroy(&it_snapshots);
+		ao2_ref(snapshots, -1);
 	}
 
-	if (it_chans) {
-		ast_channel_iterator_destroy(it_chans);
-	}
+	list_stream_end(&stream);
 
 	astman_send_list_complete_start(s, m, "StatusComplete", channels);
 	astman_append(s, "Items: %d\r\n", channels);
@@ -5770,32 +6426,103 @@ static int action_timeout(struct mansession *s, const struct message *m)
 	return 0;
 }
 
-static int whitefilter_cmp_fn(void *obj, void *arg, void *data, int flags)
+/*!
+ * \internal
+ * \brief Determine if an event has a header with the given value.
+ *
+ * \param eventdata Formatted event.
+ * \param header Header name.
+ * \param value Header value.
+ *
+ * \retval non-zero if a header of the event matches.
+ */
+static int event_header_match(const char *eventdata, const char *header, const char *value)
+{
+	size_t header_len = strlen(header);
+	size_t value_len = strlen(value);
+	const char *line = eventdata;
+	const char *pos;
+
+	while (line && *line) {
+		if (!strncasecmp(line, header, header_len) && line[header_len] == ':') {
+			pos = ast_skip_blanks(line + header_len + 1);
+			if (!strncmp(pos, value, value_len)
+				&& (pos[value_len] == '\r' || pos[value_len] == '\n' || !pos[value_len])) {
+				return 1;
+			}
+		}
+		line = strchr(line, '\n');
+		if (line) {
+			++line;
+		}
+	}
+	return 0;
+}
+
+/*! \brief What an event filter is compared with */
+struct event_filter_arg {
+	/*! Value of the Event header */
+	const char *event_name;
+	/*! Formatted event */
+	const char *eventdata;
+};
+
+static int event_filter_cmp_fn(void *obj, void *arg, int flags)
 {
-	regex_t *regex_filter = obj;
-	const char *eventdata = arg;
-	int *result = data;
+	struct event_filter *filter = obj;
+	struct event_filter_arg *event = arg;
+	struct ast_variable *condition;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
-		*result = 1;
-		return (CMP_MATCH | CMP_STOP);
+	if (filter->event_name) {
+		if (filter->event_prefix_len
+			? strncmp(event->event_name, filter->event_name, filter->event_prefix_len)
+			: strcmp(event->event_name, filter->event_name)) {
+			return 0;
+		}
+	}
+	for (condition = filter->conditions; condition; condition = condition->next) {
+		if (!event_header_match(event->eventdata, condition->name, condition->value)) {
+			return 0;
+		}
+	}
+	if (filter->has_regex && regexec(&filter->regex, event->eventdata, 0, NULL, 0)) {
+		return 0;
 	}
 
-	return 0;
+	return CMP_MATCH | CMP_STOP;
 }
 
-static int blackfilter_cmp_fn(void *obj, void *arg, void *data, int flags)
+/*!
+ * \internal
+ * \brief Determine if any filter of a list matches an event.
+ *
+ * \param names Event names matching without further checks.
+ * \param filters Filters to run.
+ * \param event Event to match.
+ *
+ * \retval non-zero if a filter matches.
+ */
+static int event_filters_match(struct ao2_container *names, struct ao2_container *filters,
+	struct event_filter_arg *event)
 {
-	regex_t *regex_filter = obj;
-	const char *eventdata = arg;
-	int *result = data;
+	struct event_filter *filter;
 
-	if (!regexec(regex_filter, eventdata, 0, NULL, 0)) {
-		*result = 0;
-		return (CMP_MATCH | CMP_STOP);
-	}
+	if (ao2_container_count(names)) {
+		char *name = ao2_find(names, event->event_name, OBJ_SEARCH_KEY);
 
-	*result = 1;
+		if (name) {
+			ao2_ref(name, -1);
+			return 1;
+		}
+	}
+	if (!ao2_container_count(filters)) {
+		return 0;
+	}
+	filter = ao2_callback(filters, 0, event_filter_cmp_fn, event);
+	if (filter) {
+		ao2_ref(filter, -1);
+		return 1;
+	}
 	return 0;
 }
 
@@ -5810,7 +6537,7 @@ static int action_filter(struct mansession *s, const struct message *m)
 	int res;
 
 	if (!strcasecmp(operation, "Add")) {
-		res = manager_add_filter(filter, s->session->whitefilters, s->session->blackfilters);
+		res = manager_add_filter(filter, &s->session->filters);
 
 	        if (res != FILTER_SUCCESS) {
 		        if (res == FILTER_ALLOC_FAILED) {
@@ -5824,6 +6551,7 @@ static int action_filter(struct mansession *s, const struct message *m)
 		                return 0;
 	                }
 		}
+		event_interest_changed();
 
 		astman_send_ack(s, m, "Success");
 		return 0;
@@ -5833,10 +6561,88 @@ static int action_filter(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Parse a structured filter.
+ *
+ * \param filter Filter to fill in.
+ * \param pattern Header conditions, such as "Event=Newstate&ChannelState=6".
+ *
+ * \retval 0 on success.
+ * \retval -1 on error.
+ */
+static int event_filter_parse_conditions(struct event_filter *filter, const char *pattern)
+{
+	char *conditions = ast_strdupa(pattern);
+	char *condition;
+	char *value;
+	struct ast_variable *var;
+	struct ast_variable *tail = NULL;
+
+	while ((condition = strsep(&conditions, "&"))) {
+		value = strchr(condition, '=');
+		if (!value || value == condition) {
+			return -1;
+		}
+		*value++ = '\0';
+
+		if (!strcasecmp(condition, "Event") && !filter->event_name) {
+			filter->event_name = ast_strdup(value);
+			if (!filter->event_name) {
+				return -1;
+			}
+			continue;
+		}
+
+		var = ast_variable_new(condition, value, "");
+		if (!var) {
+			return -1;
+		}
+		tail = ast_variable_list_append_hint(&filter->conditions, tail, var);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Determine if a regex filter only names an event.
+ *
+ * \param filter Filter to fill in.
+ * \param pattern Regex, such as "Event: Newchannel" or "Event: New.*".
+ *
+ * \retval 0 if the regex needs to be run.
+ * \retval 1 if the event name is all that needs to be compared.
+ */
+static int event_filter_parse_event_name(struct event_filter *filter, const char *pattern)
+{
+	size_t len;
+
+	if (strncmp(pattern, "Event: ", 7)) {
+		return 0;
+	}
+	pattern += 7;
+
+	len = strspn(pattern, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-");
+	if (!len || (pattern[len] && strcmp(pattern + len, ".*"))) {
+		return 0;
+	}
+
+	filter->event_name = ast_strndup(pattern, len);
+	if (!filter->event_name) {
+		return 0;
+	}
+	if (pattern[len]) {
+		filter->event_prefix_len = len;
+	}
+	return 1;
+}
+
 /*!
  * \brief Add an event filter to a manager session
  *
  * \param filter_pattern  Filter syntax to add, see below for syntax
+ * \param filters Filters of the user or session to add to
  *
  * \return FILTER_ALLOC_FAILED   Memory allocation failure
  * \return FILTER_COMPILE_FAIL   If the filter did not compile
@@ -5845,22 +6651,21 @@ static int action_filter(struct mansession *s, const struct message *m)
  * Filter will be used to match against each line of a manager event
  * Filter can be any valid regular expression
  * Filter can be a valid regular expression prefixed with !, which will add the filter as a black filter
+ * Filter can also be header conditions joined by &, which must all match exactly
  *
  * Examples:
  * \code
  *   filter_pattern = "Event: Newchannel"
  *   filter_pattern = "Event: New.*"
  *   filter_pattern = "!Channel: DAHDI.*"
+ *   filter_pattern = "Event=Newstate&ChannelState=6"
  * \endcode
  *
  */
-static enum add_filter_result manager_add_filter(const char *filter_pattern, struct ao2_container *whitefilters, struct ao2_container *blackfilters) {
-	regex_t *new_filter = ao2_t_alloc(sizeof(*new_filter), event_filter_destructor, "event_filter allocation");
+static enum add_filter_result manager_add_filter(const char *filter_pattern, struct event_filters *filters) {
+	struct event_filter *new_filter;
 	int is_blackfilter;
-
-	if (!new_filter) {
-		return FILTER_ALLOC_FAILED;
-	}
+	size_t name_len;
 
 	if (filter_pattern[0] == '!') {
 		is_blackfilter = 1;
@@ -5869,15 +6674,39 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 		is_blackfilter = 0;
 	}
 
-	if (regcomp(new_filter, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
-		ao2_t_ref(new_filter, -1, "failed to make regex");
-		return FILTER_COMPILE_FAIL;
+	new_filter = ao2_t_alloc_options(sizeof(*new_filter), event_filter_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK, "event_filter allocation");
+	if (!new_filter) {
+		return FILTER_ALLOC_FAILED;
+	}
+
+	/* A header name followed by '=' starts a structured filter. */
+	name_len = strspn(filter_pattern, "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789_-");
+	if (name_len && filter_pattern[name_len] == '=') {
+		if (event_filter_parse_conditions(new_filter, filter_pattern)) {
+			ao2_t_ref(new_filter, -1, "failed to parse filter");
+			return FILTER_COMPILE_FAIL;
+		}
+	} else if (!event_filter_parse_event_name(new_filter, filter_pattern)) {
+		if (regcomp(&new_filter->regex, filter_pattern, REG_EXTENDED | REG_NOSUB)) {
+			ao2_t_ref(new_filter, -1, "failed to make regex");
+			return FILTER_COMPILE_FAIL;
+		}
+		new_filter->has_regex = 1;
 	}
 
-	if (is_blackfilter) {
-		ao2_t_link(blackfilters, new_filter, "link new filter into black user container");
+	if (new_filter->event_name && !new_filter->event_prefix_len
+		&& !new_filter->conditions && !new_filter->has_regex) {
+		/* Only the event name matters, so a lookup is enough. */
+		if (ast_str_container_add(is_blackfilter ? filters->black_names : filters->white_names,
+			new_filter->event_name)) {
+			ao2_ref(new_filter, -1);
+			return FILTER_ALLOC_FAILED;
+		}
+	} else if (is_blackfilter) {
+		ao2_t_link(filters->black, new_filter, "link new filter into black user container");
 	} else {
-		ao2_t_link(whitefilters, new_filter, "link new filter into white user container");
+		ao2_t_link(filters->white, new_filter, "link new filter into white user container");
 	}
 
 	ao2_ref(new_filter, -1);
@@ -5887,24 +6716,34 @@ static enum add_filter_result manager_add_filter(const char *filter_pattern, str
 
 static int match_filter(struct mansession *s, char *eventdata)
 {
-	int result = 0;
+	struct event_filters *filters = &s->session->filters;
+	struct event_filter_arg event = { .eventdata = eventdata, };
+	int has_white = event_filters_count(filters, 0);
+	int has_black = event_filters_count(filters, 1);
+	char *name;
+	size_t len;
+	int result;
 
 	ast_debug(3, "Examining AMI event:\n%s\n", eventdata);
-	if (!ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
+	if (!has_white && !has_black) {
 		return 1; /* no filtering means match all */
-	} else if (ao2_container_count(s->session->whitefilters) && !ao2_container_count(s->session->blackfilters)) {
-		/* white filters only: implied black all filter processed first, then white filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
-	} else if (!ao2_container_count(s->session->whitefilters) && ao2_container_count(s->session->blackfilters)) {
-		/* black filters only: implied white all filter processed first, then black filters */
-		ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
+	}
+
+	/* Events are formatted starting with their Event header. */
+	if (!strncmp(eventdata, "Event: ", 7)) {
+		len = strcspn(eventdata + 7, "\r\n");
+		name = ast_alloca(len + 1);
+		ast_copy_string(name, eventdata + 7, len + 1);
+		event.event_name = name;
 	} else {
-		/* white and black filters: implied black all filter processed first, then white filters, and lastly black filters */
-		ao2_t_callback_data(s->session->whitefilters, OBJ_NODATA, whitefilter_cmp_fn, eventdata, &result, "find filter in session filter container");
-		if (result) {
-			result = 0;
-			ao2_t_callback_data(s->session->blackfilters, OBJ_NODATA, blackfilter_cmp_fn, eventdata, &result, "find filter in session filter container");
-		}
+		event.event_name = "";
+	}
+
+	/* implied black all filter processed first if there are white filters, then white filters */
+	result = has_white ? event_filters_match(filters->white_names, filters->white, &event) : 1;
+	/* implied white all filter processed first if there are only black filters, then black filters */
+	if (result && has_black) {
+		result = !event_filters_match(filters->black_names, filters->black, &event);
 	}
 
 	return result;
@@ -5921,9 +6760,20 @@ static int process_events(struct mansession *s)
 
 	ao2_lock(s->session);
 	if (s->session->stream != NULL) {
-		struct eventqent *eqe = s->session->last_ev;
+		struct eventqent *eqe;
+		char dropped[128];
+
+		if (s->session->events.overflowed) {
+			ast_log(LOG_WARNING, "Disconnecting manager session '%s' from %s, its event queue is full\n",
+				s->session->username, ast_sockaddr_stringify_addr(&s->session->addr));
+			ret = -1;
+		} else if (s->session->authenticated
+			&& event_ring_dropped(&s->session->events, dropped, sizeof(dropped))
+			&& send_string(s, dropped) < 0) {
+			ret = -1;
+		}
 
-		while ((eqe = advance_event(eqe))) {
+		while ((eqe = event_ring_pop(&s->session->events))) {
 			if (eqe->category == EVENT_FLAG_SHUTDOWN) {
 				ast_debug(3, "Received CloseSession event\n");
 				ret = -1;
@@ -5936,7 +6786,7 @@ static int process_events(struct mansession *s)
 							ret = -1;	/* don't send more */
 					}
 			}
-			s->session->last_ev = eqe;
+			ao2_ref(eqe, -1);
 		}
 	}
 	ao2_unlock(s->session);
@@ -6076,6 +6926,20 @@ static int action_reload(struct mansession *s, const struct message *m)
 	return 0;
 }
 
+/*! \brief Flush cached realtime lookups */
+static int action_realtimecacheflush(struct mansession *s, const struct message *m)
+{
+	const char *family = astman_get_header(m, "Family");
+
+	if (ast_realtime_cache_flush(family)) {
+		astman_send_error(s, m, "Realtime family is not cached");
+		return 0;
+	}
+
+	astman_send_ack(s, m, "Realtime cache flushed");
+	return 0;
+}
+
 /*! \brief  Manager command "CoreShowChannels" - List currently defined channels
  *          and some information about them. */
 static int action_coreshowchannels(struct mansession *s, const struct message *m)
@@ -6083,9 +6947,10 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 	const char *actionid = astman_get_header(m, "ActionID");
 	char idText[256];
 	int numchans = 0;
-	struct ao2_container *channels;
-	struct ao2_iterator it_chans;
+	struct stasis_cache_snapshots *channels;
+	size_t idx;
 	struct stasis_message *msg;
+	struct list_stream stream;
 
 	if (!ast_strlen_zero(actionid)) {
 		snprintf(idText, sizeof(idText), "ActionID: %s\r\n", actionid);
@@ -6093,19 +6958,26 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 		idText[0] = '\0';
 	}
 
-	channels = stasis_cache_dump(ast_channel_cache_by_name(), ast_channel_snapshot_type());
+	channels = stasis_cache_snapshots(ast_channel_cache_by_name(), ast_channel_snapshot_type());
 	if (!channels) {
 		astman_send_error(s, m, "Could not get cached channels");
 		return 0;
 	}
 
+	if (list_stream_init(&stream, s, m)) {
+		ao2_ref(channels, -1);
+		astman_send_error(s, m, "Memory Allocation Failure");
+		return 0;
+	}
+
 	astman_send_listack(s, m, "Channels will follow", "start");
 
-	it_chans = ao2_iterator_init(channels, 0);
-	for (; (msg = ao2_iterator_next(&it_chans)); ao2_ref(msg, -1)) {
+	/* The snapshots are shared with other listings, not copied for this one. */
+	for (idx = 0; (msg = stasis_cache_snapshots_get(channels, idx)); ++idx) {
 		struct ast_channel_snapshot *cs = stasis_message_data(msg);
 		struct ast_str *built = ast_manager_build_channel_state_string_prefix(cs, "");
 		char durbuf[10] = "";
+		int res;
 
 		if (!built) {
 			continue;
@@ -6121,7 +6993,7 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 			snprintf(durbuf, sizeof(durbuf), "%02d:%02d:%02d", durh, durm, durs);
 		}
 
-		astman_append(s,
+		res = list_stream_append(&stream,
 			"Event: CoreShowChannel\r\n"
 			"%s"
 			"%s"
@@ -6140,8 +7012,12 @@ static int action_coreshowchannels(struct mansession *s, const struct message *m
 		numchans++;
 
 		ast_free(built);
+		if (res) {
+			/* The session went away, no point going on */
+			break;
+		}
 	}
-	ao2_iterator_destroy(&it_chans);
+	list_stream_end(&stream);
 
 	astman_send_list_complete_start(s, m, "CoreShowChannelsComplete", numchans);
 	astman_send_list_complete_end(s);
@@ -6641,8 +7517,6 @@ static void *session_do(void *data)
 	ast_iostream_nonblock(ser->stream);
 
 	ao2_lock(session);
-	/* Hook to the tail of the event queue */
-	session->last_ev = grab_last();
 
 	ast_mutex_init(&s.lock);
 
@@ -6735,32 +7609,25 @@ static void purge_sessions(int n_max)
 	ao2_iterator_destroy(&i);
 }
 
-/*! \brief
- * events are appended to a queue from where they
- * can be dispatched to clients.
+/*!
+ * \internal
+ * \brief Determine if an event should be queued to a session.
+ *
+ * \param session Locked session.
+ * \param category Event category.
+ *
+ * \retval non-zero if the session may send the event.
  */
-static int append_event(const char *str, int category)
+static int event_wanted(struct mansession_session *session, int category)
 {
-	struct eventqent *tmp = ast_malloc(sizeof(*tmp) + strlen(str));
-	static int seq;	/* sequence number */
-
-	if (!tmp) {
-		return -1;
+	if (category == EVENT_FLAG_SHUTDOWN) {
+		return 1;
 	}
-
-	/* need to init all fields, because ast_malloc() does not */
-	tmp->usecount = 0;
-	tmp->category = category;
-	tmp->seq = ast_atomic_fetchadd_int(&seq, 1);
-	tmp->tv = ast_tvnow();
-	AST_RWLIST_NEXT(tmp, eq_next) = NULL;
-	strcpy(tmp->eventdata, str);
-
-	AST_RWLIST_WRLOCK(&all_events);
-	AST_RWLIST_INSERT_TAIL(&all_events, tmp, eq_next);
-	AST_RWLIST_UNLOCK(&all_events);
-
-	return 0;
+	if ((session->readperm & category) != category) {
+		return 0;
+	}
+	/* HTTP sessions only turn events on when they wait for them. */
+	return session->managerid || (session->send_events & category) == category;
 }
 
 static void append_channel_vars(struct ast_str **pbuf, struct ast_channel *chan)
@@ -6799,6 +7666,7 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 	const char *cat_str;
 	struct timeval now;
 	struct ast_str *buf;
+	struct eventqent *eqe;
 	int i;
 
 	buf = ast_str_thread_get(&manager_event_buf, MANAGER_EVENT_BUF_INITSIZE);
@@ -6843,30 +7711,33 @@ static int __attribute__((format(printf, 9, 0))) __manager_event_sessions_va(
 
 	ast_str_append(&buf, 0, "\r\n");
 
-	append_event(ast_str_buffer(buf), category);
-
-	/* Wake up any sleeping sessions */
-	if (sessions) {
+	/* Queue the event to the sessions wanting it and wake them up */
+	eqe = sessions ? event_create(ast_str_buffer(buf), category) : NULL;
+	if (eqe) {
 		struct ao2_iterator iter;
 		struct mansession_session *session;
 
 		iter = ao2_iterator_init(sessions, 0);
 		while ((session = ao2_iterator_next(&iter))) {
 			ao2_lock(session);
-			if (session->waiting_thread != AST_PTHREADT_NULL) {
-				pthread_kill(session->waiting_thread, SIGURG);
-			} else {
-				/* We have an event to process, but the mansession is
-				 * not waiting for it. We still need to indicate that there
-				 * is an event waiting so that get_input processes the pending
-				 * event instead of polling.
-				 */
-				session->pending_event = 1;
+			if (event_wanted(session, category)) {
+				event_ring_push(&session->events, eqe);
+				if (session->waiting_thread != AST_PTHREADT_NULL) {
+					pthread_kill(session->waiting_thread, SIGURG);
+				} else {
+					/* We have an event to process, but the mansession is
+					 * not waiting for it. We still need to indicate that there
+					 * is an event waiting so that get_input processes the pending
+					 * event instead of polling.
+					 */
+					session->pending_event = 1;
+				}
 			}
 			ao2_unlock(session);
 			unref_mansession(session);
 		}
 		ao2_iterator_destroy(&iter);
+		ao2_ref(eqe, -1);
 	}
 
 	if (category != EVENT_FLAG_SHUTDOWN && !AST_RWLIST_EMPTY(&manager_hooks)) {
@@ -6912,8 +7783,8 @@ int __ast_manager_event_multichan(int category, const char *event, int chancount
 	va_list ap;
 	int res;
 
-	if (!any_manager_listeners(sessions)) {
-		/* Nobody is listening */
+	if (!manager_event_wanted(sessions, category, event)) {
+		/* Nobody wants this event */
 		ao2_cleanup(sessions);
 		return 0;
 	}
@@ -7054,6 +7925,37 @@ static void action_destroy(void *obj)
 	ao2_cleanup(doomed->list_responses);
 }
 
+#ifdef AST_XML_DOCS
+/*! \brief Fill in an action's documentation from the XML documentation */
+static void action_build_docs(struct manager_action *cur)
+{
+	char *tmpxml;
+
+	tmpxml = ast_xmldoc_build_synopsis("manager", cur->action, NULL);
+	ast_string_field_set(cur, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_syntax("manager", cur->action, NULL);
+	ast_string_field_set(cur, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_description("manager", cur->action, NULL);
+	ast_string_field_set(cur, description, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_seealso("manager", cur->action, NULL);
+	ast_string_field_set(cur, seealso, tmpxml);
+	ast_free(tmpxml);
+
+	tmpxml = ast_xmldoc_build_arguments("manager", cur->action, NULL);
+	ast_string_field_set(cur, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	cur->final_response = ast_xmldoc_build_final_response("manager", cur->action, NULL);
+	cur->list_responses = ast_xmldoc_build_list_responses("manager", cur->action, NULL);
+}
+#endif
+
 /*! \brief register a new command with manager, including online help. This is
 	the preferred way to register a manager command */
 int ast_manager_register2(const char *action, int auth, int (*func)(struct mansession *s, const struct message *m), struct ast_module *module, const char *synopsis, const char *description)
@@ -7075,31 +7977,11 @@ int ast_manager_register2(const char *action, int auth, int (*func)(struct manse
 	cur->module = module;
 #ifdef AST_XML_DOCS
 	if (ast_strlen_zero(synopsis) && ast_strlen_zero(description)) {
-		char *tmpxml;
-
-		tmpxml = ast_xmldoc_build_synopsis("manager", action, NULL);
-		ast_string_field_set(cur, synopsis, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_syntax("manager", action, NULL);
-		ast_string_field_set(cur, syntax, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_description("manager", action, NULL);
-		ast_string_field_set(cur, description, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_seealso("manager", action, NULL);
-		ast_string_field_set(cur, seealso, tmpxml);
-		ast_free(tmpxml);
-
-		tmpxml = ast_xmldoc_build_arguments("manager", action, NULL);
-		ast_string_field_set(cur, arguments, tmpxml);
-		ast_free(tmpxml);
-
-		cur->final_response = ast_xmldoc_build_final_response("manager", action, NULL);
-		cur->list_responses = ast_xmldoc_build_list_responses("manager", action, NULL);
-
+		if (ast_xmldoc_lazy()) {
+			cur->docs_pending = 1;
+		} else {
+			action_build_docs(cur);
+		}
 		cur->docsrc = AST_XML_DOC;
 	} else
 #endif
@@ -7626,7 +8508,6 @@ static int generic_http_callback(struct ast_tcptls_session_instance *ser,
 		 */
 		while ((session->managerid = ast_random() ^ (unsigned long) session) == 0) {
 		}
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 	}
 	ao2_unlock(session);
@@ -7941,12 +8822,12 @@ static int auth_http_callback(struct ast_tcptls_session_instance *ser,
 
 		ast_copy_string(session->username, u_username, sizeof(session->username));
 		session->managerid = nonce;
-		session->last_ev = grab_last();
 		AST_LIST_HEAD_INIT_NOLOCK(&session->datastores);
 
 		session->readperm = u_readperm;
 		session->writeperm = u_writeperm;
 		session->writetimeout = u_writetimeout;
+		event_interest_changed();
 
 		if (u_displayconnects) {
 			ast_verb(2, "HTTP Manager '%s' logged in from %s\n", session->username, ast_sockaddr_stringify_addr(&session->addr));
@@ -8331,7 +9212,6 @@ static int webregged = 0;
 static void purge_old_stuff(void *data)
 {
 	purge_sessions(1);
-	purge_events();
 }
 
 static struct ast_tls_config ami_tls_cfg;
@@ -8359,6 +9239,8 @@ static struct ast_tcptls_session_args amis_desc = {
 /*! \brief CLI command manager show settings */
 static char *handle_manager_show_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
+	struct ast_tls_handshake_stats stats;
+
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "manager show settings";
@@ -8371,6 +9253,7 @@ static char *handle_manager_show_settings(struct ast_cli_entry *e, int cmd, stru
 	}
 #define FORMAT "  %-25.25s  %-15.55s\n"
 #define FORMAT2 "  %-25.25s  %-15d\n"
+#define FORMAT3 "  %-25.25s  %-15lu\n"
 	if (a->argc != 3) {
 		return CLI_SHOWUSAGE;
 	}
@@ -8385,19 +9268,60 @@ static char *handle_manager_show_settings(struct ast_cli_entry *e, int cmd, stru
 	ast_cli(a->fd, FORMAT, "TLS Certfile:", ami_tls_cfg.certfile);
 	ast_cli(a->fd, FORMAT, "TLS Privatekey:", ami_tls_cfg.pvtfile);
 	ast_cli(a->fd, FORMAT, "TLS Cipher:", ami_tls_cfg.cipher);
+	ast_tcptls_handshake_stats(&amis_desc, &stats);
+	ast_cli(a->fd, FORMAT3, "TLS Handshakes:", stats.completed);
+	ast_cli(a->fd, FORMAT3, "TLS Handshakes resumed:", stats.resumed);
+	ast_cli(a->fd, FORMAT3, "TLS Handshakes failed:", stats.failed);
+	ast_cli(a->fd, FORMAT3, "TLS Handshakes dropped:", stats.dropped);
+	ast_cli(a->fd, FORMAT3, "TLS Handshake avg (us):", stats.completed ? stats.total_usec / stats.completed : 0);
+	ast_cli(a->fd, FORMAT3, "TLS Handshake max (us):", stats.max_usec);
 	ast_cli(a->fd, FORMAT, "Allow multiple login:", AST_CLI_YESNO(allowmultiplelogin));
 	ast_cli(a->fd, FORMAT, "Display connects:", AST_CLI_YESNO(displayconnects));
 	ast_cli(a->fd, FORMAT, "Timestamp events:", AST_CLI_YESNO(timestampevents));
+	ast_cli(a->fd, FORMAT2, "Event queue size:", event_queue_size);
+	ast_cli(a->fd, FORMAT, "Event queue overflow:",
+		event_overflow == EVENT_OVERFLOW_DISCONNECT ? "disconnect"
+		: event_overflow == EVENT_OVERFLOW_DROP_NEWEST ? "dropnewest" : "dropoldest");
 	ast_cli(a->fd, FORMAT, "Channel vars:", S_OR(manager_channelvars, ""));
 	ast_cli(a->fd, FORMAT, "Debug:", AST_CLI_YESNO(manager_debug));
 #undef FORMAT
 #undef FORMAT2
+#undef FORMAT3
 
 	return CLI_SUCCESS;
 }
 
 #ifdef AST_XML_DOCS
 
+/*!
+ * \internal
+ * \brief Get the manager event documentation.
+ *
+ * With lazy XML documentation it is built the first time it is asked for
+ * rather than at startup.
+ */
+static struct ao2_container *event_docs_ref(void)
+{
+	struct ao2_container *events;
+
+	events = ao2_global_obj_ref(event_docs);
+	if (events || !ast_xmldoc_lazy()) {
+		return events;
+	}
+
+	ast_mutex_lock(&event_docs_lock);
+	events = ao2_global_obj_ref(event_docs);
+	if (!events) {
+		events = ast_xmldoc_build_documentation("managerEvent");
+		if (events) {
+			ao2_global_obj_replace_unref(event_docs, events);
+		}
+	}
+	ast_mutex_unlock(&event_docs_lock);
+
+	return events;
+}
+
 static int ast_xml_doc_item_cmp_fn(const void *a, const void *b)
 {
 	struct ast_xml_doc_item **item_a = (struct ast_xml_doc_item **)a;
@@ -8433,7 +9357,7 @@ static char *handle_manager_show_events(struct ast_cli_entry *e, int cmd, struct
 		return CLI_SUCCESS;
 	}
 
-	events = ao2_global_obj_ref(event_docs);
+	events = event_docs_ref();
 	if (!events) {
 		ast_cli(a->fd, "No manager event documentation loaded\n");
 		ast_free(buffer);
@@ -8540,7 +9464,7 @@ static char *handle_manager_show_event(struct ast_cli_entry *e, int cmd, struct
 		return NULL;
 	}
 
-	events = ao2_global_obj_ref(event_docs);
+	events = event_docs_ref();
 	if (!events) {
 		ast_cli(a->fd, "No manager event documentation loaded\n");
 		return CLI_SUCCESS;
@@ -8631,12 +9555,7 @@ static void manager_free_user(struct ast_manager_user *user)
 {
 	ast_free(user->a1_hash);
 	ast_free(user->secret);
-	if (user->whitefilters) {
-		ao2_t_ref(user->whitefilters, -1, "decrement ref for white container, should be last one");
-	}
-	if (user->blackfilters) {
-		ao2_t_ref(user->blackfilters, -1, "decrement ref for black container, should be last one");
-	}
+	event_filters_destroy(&user->filters);
 	user->acl = ast_free_acl_list(user->acl);
 	ast_variables_destroy(user->chanvars);
 	ast_free(user);
@@ -8683,6 +9602,7 @@ static void manager_shutdown(void)
 	ast_manager_unregister("CoreSettings");
 	ast_manager_unregister("CoreStatus");
 	ast_manager_unregister("Reload");
+	ast_manager_unregister("RealtimeCacheFlush");
 	ast_manager_unregister("LoggerRotate");
 	ast_manager_unregister("CoreShowChannels");
 	ast_manager_unregister("ModuleLoad");
@@ -8725,6 +9645,7 @@ static void manager_shutdown(void)
 	ami_tls_cfg.cipher = NULL;
 
 	ao2_global_obj_release(mgr_sessions);
+	ao2_global_obj_release(event_interest);
 
 	while ((user = AST_LIST_REMOVE_HEAD(&users, list))) {
 		manager_free_user(user);
@@ -8809,6 +9730,8 @@ static void manager_set_defaults(void)
 	authtimeout = 30;
 	authlimit = 50;
 	manager_debug = 0;		/* Debug disabled by default */
+	event_queue_size = DEFAULT_EVENT_QUEUE_SIZE;
+	event_overflow = EVENT_OVERFLOW_DROP_OLDEST;
 
 	/* default values */
 	ast_copy_string(global_realm, S_OR(ast_config_AST_SYSTEM_NAME, DEFAULT_REALM),
@@ -8817,6 +9740,9 @@ static void manager_set_defaults(void)
 	ast_sockaddr_setnull(&amis_desc.local_address);
 
 	ami_tls_cfg.enabled = 0;
+	ami_tls_cfg.session_cache_size = 0;
+	ami_tls_cfg.session_timeout = 0;
+	ast_clear_flag(&ami_tls_cfg.flags, AST_SSL_NO_SESSION_CACHE | AST_SSL_NO_SESSION_TICKETS);
 	ast_free(ami_tls_cfg.certfile);
 	ami_tls_cfg.certfile = ast_strdup(AST_CERTFILE);
 	ast_free(ami_tls_cfg.pvtfile);
@@ -8890,6 +9816,7 @@ static int __init_manager(int reload, int by_external_config)
 		ast_manager_register_xml_core("CoreSettings", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, action_coresettings);
 		ast_manager_register_xml_core("CoreStatus", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, action_corestatus);
 		ast_manager_register_xml_core("Reload", EVENT_FLAG_CONFIG | EVENT_FLAG_SYSTEM, action_reload);
+		ast_manager_register_xml_core("RealtimeCacheFlush", EVENT_FLAG_CONFIG | EVENT_FLAG_SYSTEM, action_realtimecacheflush);
 		ast_manager_register_xml_core("LoggerRotate", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, action_loggerrotate);
 		ast_manager_register_xml_core("CoreShowChannels", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, action_coreshowchannels);
 		ast_manager_register_xml_core("ModuleLoad", EVENT_FLAG_SYSTEM, manager_moduleload);
@@ -8906,13 +9833,9 @@ static int __init_manager(int reload, int by_external_config)
 		__ast_custom_function_register(&managerclient_function, NULL);
 		ast_extension_state_add(NULL, NULL, manager_state_cb, NULL);
 
-		/* Append placeholder event so master_eventq never runs dry */
-		if (append_event("Event: Placeholder\r\n\r\n", 0)) {
-			return -1;
-		}
-
 #ifdef AST_XML_DOCS
-		temp_event_docs = ast_xmldoc_build_documentation("managerEvent");
+		/* With lazy documentation this waits until someone asks for it. */
+		temp_event_docs = ast_xmldoc_lazy() ? NULL : ast_xmldoc_build_documentation("managerEvent");
 		if (temp_event_docs) {
 			ao2_t_global_obj_replace_unref(event_docs, temp_event_docs, "Toss old event docs");
 			ao2_t_ref(temp_event_docs, -1, "Remove creation ref - container holds only ref now");
@@ -9021,6 +9944,24 @@ static int __init_manager(int reload, int by_external_config)
 			} else {
 				authlimit = limit;
 			}
+		} else if (!strcasecmp(var->name, "eventqueuesize")) {
+			unsigned int size;
+
+			if (sscanf(val, "%30u", &size) != 1 || !size) {
+				ast_log(LOG_WARNING, "Invalid eventqueuesize value '%s', using default value\n", val);
+			} else {
+				event_queue_size = size;
+			}
+		} else if (!strcasecmp(var->name, "eventqueueoverflow")) {
+			if (!strcasecmp(val, "dropoldest")) {
+				event_overflow = EVENT_OVERFLOW_DROP_OLDEST;
+			} else if (!strcasecmp(val, "dropnewest")) {
+				event_overflow = EVENT_OVERFLOW_DROP_NEWEST;
+			} else if (!strcasecmp(val, "disconnect")) {
+				event_overflow = EVENT_OVERFLOW_DISCONNECT;
+			} else {
+				ast_log(LOG_WARNING, "Invalid eventqueueoverflow value '%s', using default value\n", val);
+			}
 		} else if (!strcasecmp(var->name, "channelvars")) {
 			load_channelvars(var);
 		} else {
@@ -9176,9 +10117,7 @@ static int __init_manager(int reload, int by_external_config)
 			/* Default allowmultiplelogin from [general] */
 			user->allowmultiplelogin = allowmultiplelogin;
 			user->writetimeout = 100;
-			user->whitefilters = ao2_container_alloc(1, NULL, NULL);
-			user->blackfilters = ao2_container_alloc(1, NULL, NULL);
-			if (!user->whitefilters || !user->blackfilters) {
+			if (event_filters_init(&user->filters)) {
 				manager_free_user(user);
 				break;
 			}
@@ -9186,8 +10125,7 @@ static int __init_manager(int reload, int by_external_config)
 			/* Insert into list */
 			AST_RWLIST_INSERT_TAIL(&users, user, list);
 		} else {
-			ao2_t_callback(user->whitefilters, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL, "unlink all white filters");
-			ao2_t_callback(user->blackfilters, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL, "unlink all black filters");
+			event_filters_clear(&user->filters);
 		}
 
 		/* Make sure we keep this user and don't destroy it during cleanup */
@@ -9245,7 +10183,7 @@ static int __init_manager(int reload, int by_external_config)
 				}
 			} else if (!strcasecmp(var->name, "eventfilter")) {
 				const char *value = var->value;
-				manager_add_filter(value, user->whitefilters, user->blackfilters);
+				manager_add_filter(value, &user->filters);
 			} else {
 				ast_debug(1, "%s is an unknown option.\n", var->name);
 			}
@@ -737,6 +737,11 @@ static void channel_snapshot_update(void *data, struct stasis_subscription *sub,
 	old_snapshot = stasis_message_data(update->old_snapshot);
 	new_snapshot = stasis_message_data(update->new_snapshot);
 
+	if (old_snapshot == new_snapshot) {
+		/* The snapshot was published again unchanged */
+		return;
+	}
+
 	for (i = 0; i < ARRAY_LEN(channel_monitors); ++i) {
 		RAII_VAR(struct ast_manager_event_blob *, ev, NULL, ao2_cleanup);
 		ev = channel_monitors[i](old_snapshot, new_snapshot);
@@ -28,6 +28,28 @@
 	<support_level>core</support_level>
  ***/
 
+/*** DOCUMENTATION
+	<manager name="MediaCachePrefetch" language="en_US">
+		<synopsis>
+			Fetch items into the media cache in the background.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="URI" required="true">
+				<para>The URI of the media to fetch. This header may be
+				given more than once to fetch several items in parallel.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Queues a fetch of each URI into the media cache, so that a
+			later playback of it does not wait for the remote server. Items
+			already in the cache are revalidated with their backend instead.
+			The response is sent once the fetches are queued, not when they
+			are complete.</para>
+		</description>
+	</manager>
+ ***/
+
 #include "asterisk.h"
 
 #include <sys/stat.h>
@@ -35,6 +57,9 @@
 #include "asterisk/bucket.h"
 #include "asterisk/astdb.h"
 #include "asterisk/cli.h"
+#include "asterisk/manager.h"
+#include "asterisk/options.h"
+#include "asterisk/threadpool.h"
 #include "asterisk/media_cache.h"
 
 /*! The name of the AstDB family holding items in the cache. */
@@ -46,9 +71,18 @@
 /*! Number of buckets in the ao2 container holding our media items */
 #define AO2_BUCKETS 61
 
+/*! Number of threads fetching and revalidating items in the background */
+#define MEDIA_CACHE_FETCHERS 4
+
 /*! Our one and only container holding media items */
 static struct ao2_container *media_cache;
 
+/*! Threads fetching and revalidating items away from the play path */
+static struct ast_threadpool *media_cache_pool;
+
+/*! URIs with a background fetch or revalidation queued or running */
+static struct ao2_container *media_cache_pending;
+
 /*!
  * \internal
  * \brief Hashing function for file metadata
@@ -207,59 +241,276 @@ static void bucket_file_update_path(struct ast_bucket_file *bucket_file,
 	}
 }
 
-int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
+/*!
+ * \internal
+ * \brief Copy the path of a media item, without its extension, for playback
+ */
+static void media_cache_item_copy_path(struct ast_bucket_file *bucket_file,
 	char *file_path, size_t len)
 {
-	struct ast_bucket_file *bucket_file;
 	char *ext;
-	SCOPED_AO2LOCK(media_lock, media_cache);
 
-	if (ast_strlen_zero(uri)) {
-		return -1;
+	ast_copy_string(file_path, bucket_file->path, len);
+	if ((ext = strrchr(file_path, '.'))) {
+		*ext = '\0';
 	}
+}
 
-	/* First, retrieve from the ao2 cache here. If we find a bucket_file
-	 * matching the requested URI, ask the appropriate backend if it is
-	 * stale. If not; return it.
-	 */
-	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
-	if (bucket_file) {
-		if (!ast_bucket_file_is_stale(bucket_file)) {
-			ast_copy_string(file_path, bucket_file->path, len);
-			if ((ext = strrchr(file_path, '.'))) {
-				*ext = '\0';
-			}
-			ao2_ref(bucket_file, -1);
+/*!
+ * \internal
+ * \brief Mark a media item as just used, for the eviction of the least recently used
+ */
+static void media_cache_item_touch(struct ast_bucket_file *bucket_file)
+{
+	char tmp[32];
 
-			ast_debug(5, "Returning media at local file: %s\n", file_path);
-			return 0;
+	snprintf(tmp, sizeof(tmp), "%ld", (long)time(NULL));
+	ast_bucket_file_metadata_set(bucket_file, "accessed", tmp);
+}
+
+/*! \brief Usage of the media cache, gathered by \ref media_cache_usage_cb */
+struct media_cache_usage {
+	/*! The item that must not be evicted */
+	struct ast_bucket_file *keep;
+	/*! The least recently used item other than \c keep */
+	struct ast_bucket_file *oldest;
+	long oldest_accessed;
+	/*! Total size of the files of all items */
+	off_t bytes;
+};
+
+/*!
+ * \internal
+ * \brief ao2 callback function for \ref media_cache_evict
+ */
+static int media_cache_usage_cb(void *obj, void *arg, int flags)
+{
+	struct ast_bucket_file *bucket_file = obj;
+	struct media_cache_usage *usage = arg;
+	struct ast_bucket_metadata *metadata;
+	struct stat st;
+	long accessed = 0;
+
+	if (!stat(bucket_file->path, &st)) {
+		usage->bytes += st.st_size;
+	}
+
+	if (bucket_file == usage->keep) {
+		return 0;
+	}
+
+	metadata = ast_bucket_file_metadata_get(bucket_file, "accessed");
+	if (metadata) {
+		sscanf(metadata->value, "%30ld", &accessed);
+		ao2_ref(metadata, -1);
+	}
+
+	if (!usage->oldest || accessed < usage->oldest_accessed) {
+		usage->oldest = bucket_file;
+		usage->oldest_accessed = accessed;
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Evict the least recently used items until the cache fits in media_cache_size
+ * \param keep The item just added, which is never evicted
+ * \pre media_cache must be locked
+ */
+static void media_cache_evict(struct ast_bucket_file *keep)
+{
+	struct media_cache_usage usage;
+
+	if (!ast_option_media_cache_size) {
+		return;
+	}
+
+	for (;;) {
+		memset(&usage, 0, sizeof(usage));
+		usage.keep = keep;
+		ao2_callback(media_cache, OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
+			media_cache_usage_cb, &usage);
+
+		if (usage.bytes <= (off_t)ast_option_media_cache_size * 1024 || !usage.oldest) {
+			break;
 		}
 
-		/* Stale! Remove the item completely, as we're going to replace it next */
-		ao2_unlink_flags(media_cache, bucket_file, OBJ_NOLOCK);
-		ast_bucket_file_delete(bucket_file);
-		ao2_ref(bucket_file, -1);
+		ast_debug(3, "Evicting '%s' from the media cache\n",
+			ast_sorcery_object_get_id(usage.oldest));
+		ao2_ref(usage.oldest, +1);
+		ao2_unlink_flags(media_cache, usage.oldest, OBJ_NOLOCK);
+		ast_bucket_file_delete(usage.oldest);
+		media_cache_item_del_from_astdb(usage.oldest);
+		ao2_ref(usage.oldest, -1);
 	}
+}
+
+/*!
+ * \internal
+ * \brief Retrieve a media item from its bucket backend
+ * \param preferred_file_name The preferred name of the backing file
+ * \return The item, not yet in the cache, or NULL on failure
+ */
+static struct ast_bucket_file *media_cache_item_fetch(const char *uri,
+	const char *preferred_file_name)
+{
+	struct ast_bucket_file *bucket_file;
 
-	/* Either this is new or the resource is stale; do a full retrieve
-	 * from the appropriate bucket_file backend
-	 */
 	bucket_file = ast_bucket_file_retrieve(uri);
 	if (!bucket_file) {
 		ast_debug(2, "Failed to obtain media at '%s'\n", uri);
-		return -1;
+		return NULL;
 	}
 
 	/* We can manipulate the 'immutable' bucket_file here, as we haven't
 	 * let anyone know of its existence yet
 	 */
 	bucket_file_update_path(bucket_file, preferred_file_name);
-	media_cache_item_sync_to_astdb(bucket_file);
-	ast_copy_string(file_path, bucket_file->path, len);
-	if ((ext = strrchr(file_path, '.'))) {
-		*ext = '\0';
+
+	return bucket_file;
+}
+
+/*!
+ * \internal
+ * \brief Add a freshly retrieved media item to the cache
+ *
+ * \details
+ * Any item it supersedes is removed, along with its file unless the new
+ * item was retrieved over that file.
+ */
+static void media_cache_item_link(struct ast_bucket_file *bucket_file)
+{
+	struct ast_bucket_file *existing;
+	SCOPED_AO2LOCK(media_lock, media_cache);
+
+	existing = ao2_find(media_cache, ast_sorcery_object_get_id(bucket_file),
+		OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NOLOCK);
+	if (existing) {
+		if (strcmp(existing->path, bucket_file->path)) {
+			ast_bucket_file_delete(existing);
+		}
+		ao2_ref(existing, -1);
 	}
+
+	media_cache_item_touch(bucket_file);
+	media_cache_item_sync_to_astdb(bucket_file);
 	ao2_link_flags(media_cache, bucket_file, OBJ_NOLOCK);
+
+	media_cache_evict(bucket_file);
+}
+
+/*!
+ * \internal
+ * \brief Fetch or revalidate a media item on the media cache threadpool
+ */
+static int media_cache_background_task(void *data)
+{
+	char *uri = data;
+	struct ast_bucket_file *bucket_file;
+	struct ast_bucket_file *fresh = NULL;
+
+	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY);
+	if (!bucket_file) {
+		fresh = media_cache_item_fetch(uri, NULL);
+	} else if (ast_bucket_file_is_stale(bucket_file)) {
+		/* Retrieve the new media over the old file, so that anyone who
+		 * was handed its path plays the new media. If the retrieval
+		 * fails, the old media keeps being used.
+		 */
+		ast_debug(3, "Media at '%s' is stale, refreshing it\n", uri);
+		fresh = media_cache_item_fetch(uri, bucket_file->path);
+	}
+
+	if (fresh) {
+		media_cache_item_link(fresh);
+		ao2_ref(fresh, -1);
+	}
+	ao2_cleanup(bucket_file);
+
+	ast_str_container_remove(media_cache_pending, uri);
+	ast_free(uri);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue a background fetch or revalidation of a media item
+ *
+ * \retval 0 The task was queued, or one already is for \c uri
+ * \retval -1 error
+ */
+static int media_cache_queue(const char *uri)
+{
+	char *pending;
+	char *data;
+
+	if (!media_cache_pool) {
+		return -1;
+	}
+
+	ao2_lock(media_cache_pending);
+	pending = ao2_find(media_cache_pending, uri, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (pending) {
+		ao2_unlock(media_cache_pending);
+		ao2_ref(pending, -1);
+		return 0;
+	}
+	if (ast_str_container_add(media_cache_pending, uri)) {
+		ao2_unlock(media_cache_pending);
+		return -1;
+	}
+	ao2_unlock(media_cache_pending);
+
+	data = ast_strdup(uri);
+	if (!data || ast_threadpool_push(media_cache_pool, media_cache_background_task, data)) {
+		ast_free(data);
+		ast_str_container_remove(media_cache_pending, uri);
+		return -1;
+	}
+
+	return 0;
+}
+
+int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
+	char *file_path, size_t len)
+{
+	struct ast_bucket_file *bucket_file;
+
+	if (ast_strlen_zero(uri)) {
+		return -1;
+	}
+
+	/* First, retrieve from the ao2 cache here. If we find a bucket_file
+	 * matching the requested URI, return it right away and ask the
+	 * appropriate backend whether it is stale in the background, so the
+	 * caller never waits on the remote server for media it already has.
+	 */
+	bucket_file = ao2_find(media_cache, uri, OBJ_SEARCH_KEY);
+	if (bucket_file) {
+		media_cache_item_touch(bucket_file);
+		media_cache_item_copy_path(bucket_file, file_path, len);
+		ao2_ref(bucket_file, -1);
+
+		media_cache_queue(uri);
+
+		ast_debug(5, "Returning media at local file: %s\n", file_path);
+		return 0;
+	}
+
+	/* This is new; do a full retrieve from the appropriate bucket_file
+	 * backend. The cache is not locked meanwhile, so retrievals of other
+	 * items are not held up behind this one.
+	 */
+	bucket_file = media_cache_item_fetch(uri, preferred_file_name);
+	if (!bucket_file) {
+		return -1;
+	}
+
+	media_cache_item_copy_path(bucket_file, file_path, len);
+	media_cache_item_link(bucket_file);
 	ao2_ref(bucket_file, -1);
 
 	ast_debug(5, "Returning media at local file: %s\n", file_path);
@@ -267,6 +518,15 @@ int ast_media_cache_retrieve(const char *uri, const char *preferred_file_name,
 	return 0;
 }
 
+int ast_media_cache_prefetch(const char *uri)
+{
+	if (ast_strlen_zero(uri)) {
+		return -1;
+	}
+
+	return media_cache_queue(uri);
+}
+
 int ast_media_cache_retrieve_metadata(const char *uri, const char *key,
 	char *value, size_t len)
 {
@@ -657,6 +917,39 @@ static char *media_cache_handle_refresh_item(struct ast_cli_entry *e, int cmd, s
 	return CLI_SUCCESS;
 }
 
+static char *media_cache_handle_prefetch_items(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "media cache prefetch";
+		e->usage =
+			"Usage: media cache prefetch <uri> [<uri> ...]\n"
+			"       Fetch items into the media cache in the\n"
+			"       background, several at a time. Items that\n"
+			"       are already in the media cache are checked\n"
+			"       with the backend supporting the URI scheme.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return cli_complete_uri(a->word, a->n);
+	}
+
+	if (a->argc < 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	for (i = 3; i < a->argc; i++) {
+		if (ast_media_cache_prefetch(a->argv[i])) {
+			ast_cli(a->fd, "Unable to prefetch '%s'\n", a->argv[i]);
+		} else {
+			ast_cli(a->fd, "Prefetching '%s'\n", a->argv[i]);
+		}
+	}
+
+	return CLI_SUCCESS;
+}
+
 static char *media_cache_handle_create_item(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	switch (cmd) {
@@ -691,23 +984,67 @@ static struct ast_cli_entry cli_media_cache[] = {
 	AST_CLI_DEFINE(media_cache_handle_show_item, "Show a single item in the media cache"),
 	AST_CLI_DEFINE(media_cache_handle_delete_item, "Remove an item from the media cache"),
 	AST_CLI_DEFINE(media_cache_handle_refresh_item, "Refresh an item in the media cache"),
+	AST_CLI_DEFINE(media_cache_handle_prefetch_items, "Fetch items into the media cache in the background"),
 	AST_CLI_DEFINE(media_cache_handle_create_item, "Create an item in the media cache"),
 };
 
+static int manager_media_cache_prefetch(struct mansession *s, const struct message *m)
+{
+	const char *uri;
+	int queued = 0;
+	int i;
+
+	for (i = 0; i < m->hdrcount; i++) {
+		if (strncasecmp(m->headers[i], "URI:", 4)) {
+			continue;
+		}
+		uri = ast_skip_blanks(m->headers[i] + 4);
+		if (ast_media_cache_prefetch(uri)) {
+			astman_send_error_va(s, m, "Unable to prefetch '%s'", uri);
+			return 0;
+		}
+		queued++;
+	}
+
+	if (!queued) {
+		astman_send_error(s, m, "No URI specified");
+		return 0;
+	}
+
+	astman_send_ack(s, m, "Prefetch queued");
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Shutdown the media cache
  */
 static void media_cache_shutdown(void)
 {
+	ast_manager_unregister("MediaCachePrefetch");
+	ast_cli_unregister_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache));
+
+	ast_threadpool_shutdown(media_cache_pool);
+	media_cache_pool = NULL;
+
+	ao2_cleanup(media_cache_pending);
+	media_cache_pending = NULL;
+
 	ao2_ref(media_cache, -1);
 	media_cache = NULL;
-
-	ast_cli_unregister_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache));
 }
 
 int ast_media_cache_init(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = MEDIA_CACHE_FETCHERS,
+	};
+
 	ast_register_atexit(media_cache_shutdown);
 
 	media_cache = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_MUTEX, AO2_BUCKETS,
@@ -716,11 +1053,24 @@ int ast_media_cache_init(void)
 		return -1;
 	}
 
+	media_cache_pending = ast_str_container_alloc(AO2_BUCKETS);
+	if (!media_cache_pending) {
+		return -1;
+	}
+
+	media_cache_pool = ast_threadpool_create("media_cache", NULL, &options);
+	if (!media_cache_pool) {
+		return -1;
+	}
+
 	if (ast_cli_register_multiple(cli_media_cache, ARRAY_LEN(cli_media_cache))) {
 		ao2_ref(media_cache, -1);
 		return -1;
 	}
 
+	ast_manager_register_xml_core("MediaCachePrefetch", EVENT_FLAG_SYSTEM,
+		manager_media_cache_prefetch);
+
 	media_cache_populate_from_astdb();
 
 	return 0;
@@ -0,0 +1,363 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Media forks
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/_private.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
+#include "asterisk/format.h"
+#include "asterisk/frame.h"
+#include "asterisk/lock.h"
+#include "asterisk/media_fork.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
+#include "asterisk/translate.h"
+#include "asterisk/utils.h"
+
+/*! Most frames a fork may hold */
+#define MEDIA_FORK_MAX_DEPTH 4096
+
+struct ast_media_fork {
+	/*! Name shown by the CLI */
+	char *name;
+	const struct ast_media_fork_consumer *consumer;
+	/*! Passed to the consumer */
+	void *data;
+	/*! Format the consumer takes */
+	struct ast_format *format;
+	/*! Translation to the format of the consumer, used by the producer only */
+	struct ast_trans_pvt *trans;
+	/*! Format translated from */
+	struct ast_format *trans_from;
+	/*! Serializer the consumer is called on */
+	struct ast_taskprocessor *serializer;
+	/*! Protects clearing draining and waiting for it */
+	ast_mutex_t lock;
+	/*! Signalled when the consumer stops draining */
+	ast_cond_t cond;
+	/*! Non-zero while a drain is queued or running */
+	int draining;
+	/*! Non-zero once the fork is being destroyed */
+	int stopped;
+	/*! Next slot the producer fills, only written by the producer */
+	unsigned int head;
+	/*! Next slot the consumer empties, only written by the consumer */
+	unsigned int tail;
+	/*! Slots in the ring less one */
+	unsigned int mask;
+	/*! Frames queued, counted by the producer */
+	unsigned long pushed;
+	/*! Frames dropped because the ring was full, counted by the producer */
+	unsigned long dropped;
+	/*! Frames the consumer failed to take, counted by the consumer */
+	unsigned long failed;
+	/*! Most frames that were waiting at once */
+	unsigned int high_water;
+	/*! The frames waiting for the consumer */
+	struct ast_frame *ring[0];
+};
+
+/*! \brief Threads the consumers of every fork run on */
+static struct ast_threadpool *media_fork_pool;
+
+/*! \brief Every fork, for the CLI */
+static struct ao2_container *forks;
+
+static void media_fork_destructor(void *obj)
+{
+	struct ast_media_fork *fork = obj;
+
+	while (fork->tail != fork->head) {
+		ast_frfree(fork->ring[fork->tail++ & fork->mask]);
+	}
+	if (fork->trans) {
+		ast_translator_free_path(fork->trans);
+	}
+	ao2_cleanup(fork->trans_from);
+	ao2_cleanup(fork->format);
+	ast_taskprocessor_unreference(fork->serializer);
+	ast_mutex_destroy(&fork->lock);
+	ast_cond_destroy(&fork->cond);
+	ast_free(fork->name);
+}
+
+/*!
+ * \internal
+ * \brief Call the consumer with the frames waiting, on its serializer.
+ *
+ * Keeps going while the producer adds frames.  Once the ring is empty,
+ * draining is cleared, after which the fork must not be touched as it may
+ * be destroyed.
+ */
+static int media_fork_drain(void *data)
+{
+	struct ast_media_fork *fork = data;
+	unsigned int tail = fork->tail;
+	struct ast_frame *frame;
+
+	for (;;) {
+		while (tail != __atomic_load_n(&fork->head, __ATOMIC_ACQUIRE)) {
+			frame = fork->ring[tail & fork->mask];
+			if (!__atomic_load_n(&fork->stopped, __ATOMIC_RELAXED)
+				&& fork->consumer->write(fork->data, frame)) {
+				++fork->failed;
+			}
+			ast_frfree(frame);
+			__atomic_store_n(&fork->tail, ++tail, __ATOMIC_RELEASE);
+		}
+
+		ast_mutex_lock(&fork->lock);
+		__atomic_store_n(&fork->draining, 0, __ATOMIC_SEQ_CST);
+		/*
+		 * A frame queued after the ring was seen empty but before draining
+		 * was cleared did not queue a drain, so it is taken here unless a
+		 * drain has been queued since.
+		 */
+		if (tail == __atomic_load_n(&fork->head, __ATOMIC_SEQ_CST)
+			|| __atomic_exchange_n(&fork->draining, 1, __ATOMIC_SEQ_CST)) {
+			ast_cond_broadcast(&fork->cond);
+			ast_mutex_unlock(&fork->lock);
+			break;
+		}
+		ast_mutex_unlock(&fork->lock);
+	}
+
+	return 0;
+}
+
+struct ast_media_fork *ast_media_fork_create(const char *name, struct ast_format *format,
+	unsigned int depth, const struct ast_media_fork_consumer *consumer, void *data)
+{
+	struct ast_media_fork *fork;
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	unsigned int slots = 1;
+
+	if (!media_fork_pool || !consumer || !consumer->write) {
+		return NULL;
+	}
+
+	depth = MIN(depth, MEDIA_FORK_MAX_DEPTH);
+	while (slots < depth) {
+		slots <<= 1;
+	}
+
+	fork = ao2_alloc_options(sizeof(*fork) + slots * sizeof(fork->ring[0]),
+		media_fork_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!fork) {
+		return NULL;
+	}
+	ast_mutex_init(&fork->lock);
+	ast_cond_init(&fork->cond, NULL);
+	fork->mask = slots - 1;
+	fork->consumer = consumer;
+	fork->data = data;
+	fork->format = ao2_bump(format);
+
+	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "media-fork");
+	fork->serializer = ast_threadpool_serializer(tps_name, media_fork_pool);
+	fork->name = ast_strdup(name);
+	if (!fork->serializer || !fork->name) {
+		ao2_ref(fork, -1);
+		return NULL;
+	}
+
+	ao2_link(forks, fork);
+
+	return fork;
+}
+
+/*!
+ * \internal
+ * \brief Put a frame in the ring, if there is room.
+ */
+static int media_fork_queue(struct ast_media_fork *fork, struct ast_frame *frame)
+{
+	unsigned int head = fork->head;
+	unsigned int waiting = head - __atomic_load_n(&fork->tail, __ATOMIC_ACQUIRE);
+	struct ast_frame *dup;
+
+	if (waiting > fork->mask || !(dup = ast_frdup(frame))) {
+		++fork->dropped;
+		return -1;
+	}
+
+	fork->ring[head & fork->mask] = dup;
+	__atomic_store_n(&fork->head, head + 1, __ATOMIC_SEQ_CST);
+	++fork->pushed;
+	if (fork->high_water <= waiting) {
+		fork->high_water = waiting + 1;
+	}
+
+	return 0;
+}
+
+int ast_media_fork_write(struct ast_media_fork *fork, struct ast_frame *frame)
+{
+	struct ast_frame *out;
+	struct ast_frame *cur;
+	int res = 0;
+
+	if (frame->frametype != AST_FRAME_VOICE) {
+		return 0;
+	}
+
+	if (ast_format_cmp(frame->subclass.format, fork->format) != AST_FORMAT_CMP_NOT_EQUAL) {
+		res = media_fork_queue(fork, frame);
+	} else {
+		if (fork->trans && ast_format_cmp(frame->subclass.format, fork->trans_from) != AST_FORMAT_CMP_EQUAL) {
+			ast_translator_free_path(fork->trans);
+			fork->trans = NULL;
+		}
+		if (!fork->trans) {
+			fork->trans = ast_translator_build_path(fork->format, frame->subclass.format);
+			if (!fork->trans) {
+				++fork->dropped;
+				return -1;
+			}
+			ao2_replace(fork->trans_from, frame->subclass.format);
+		}
+		if (!(out = ast_translate(fork->trans, frame, 0))) {
+			/* The translator is holding on to the audio for now */
+			return 0;
+		}
+		for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			res |= media_fork_queue(fork, cur);
+		}
+		ast_frfree(out);
+	}
+
+	if (!__atomic_exchange_n(&fork->draining, 1, __ATOMIC_SEQ_CST)
+		&& ast_taskprocessor_push(fork->serializer, media_fork_drain, fork)) {
+		/* The frames stay in the ring for the next write to try again */
+		__atomic_store_n(&fork->draining, 0, __ATOMIC_SEQ_CST);
+	}
+
+	return res;
+}
+
+void ast_media_fork_destroy(struct ast_media_fork *fork)
+{
+	if (!fork) {
+		return;
+	}
+
+	ao2_unlink(forks, fork);
+	__atomic_store_n(&fork->stopped, 1, __ATOMIC_SEQ_CST);
+
+	ast_mutex_lock(&fork->lock);
+	while (__atomic_load_n(&fork->draining, __ATOMIC_SEQ_CST)) {
+		ast_cond_wait(&fork->cond, &fork->lock);
+	}
+	ast_mutex_unlock(&fork->lock);
+
+	ao2_ref(fork, -1);
+}
+
+#define FORMAT "%-40.40s %-10.10s %8s %8s %8s %10s %10s %10s\n"
+#define FORMAT2 "%-40.40s %-10.10s %8u %8u %8u %10lu %10lu %10lu\n"
+
+static char *handle_cli_media_forks(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ao2_iterator iter;
+	struct ast_media_fork *fork;
+	unsigned int waiting;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show media forks";
+		e->usage =
+			"Usage: core show media forks\n"
+			"       Shows the frames waiting for the consumer of each media fork,\n"
+			"       the most that ever waited, how many the fork can hold, and\n"
+			"       how many were queued, dropped because the consumer was behind\n"
+			"       and failed to be taken by the consumer.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, FORMAT, "Name", "Format", "Waiting", "Most", "Depth", "Queued", "Dropped", "Failed");
+	iter = ao2_iterator_init(forks, 0);
+	for (; (fork = ao2_iterator_next(&iter)); ao2_ref(fork, -1)) {
+		waiting = __atomic_load_n(&fork->head, __ATOMIC_RELAXED)
+			- __atomic_load_n(&fork->tail, __ATOMIC_RELAXED);
+		ast_cli(a->fd, FORMAT2, fork->name, ast_format_get_name(fork->format),
+			waiting, fork->high_water, fork->mask + 1,
+			fork->pushed, fork->dropped, fork->failed);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return CLI_SUCCESS;
+}
+
+#undef FORMAT
+#undef FORMAT2
+
+static struct ast_cli_entry media_fork_cli[] = {
+	AST_CLI_DEFINE(handle_cli_media_forks, "Show how far behind the consumers of media forks are"),
+};
+
+static void media_fork_shutdown(void)
+{
+	ast_cli_unregister_multiple(media_fork_cli, ARRAY_LEN(media_fork_cli));
+	ast_threadpool_shutdown(media_fork_pool);
+	media_fork_pool = NULL;
+	ao2_cleanup(forks);
+	forks = NULL;
+}
+
+int ast_media_fork_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		/* Consumers that block take a thread each rather than hold up others */
+		.max_size = 0,
+	};
+
+	forks = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	if (!forks) {
+		return -1;
+	}
+
+	media_fork_pool = ast_threadpool_create("media-fork", NULL, &options);
+	if (!media_fork_pool) {
+		ao2_ref(forks, -1);
+		forks = NULL;
+		return -1;
+	}
+
+	ast_cli_register_multiple(media_fork_cli, ARRAY_LEN(media_fork_cli));
+	ast_register_cleanup(media_fork_shutdown);
+
+	return 0;
+}
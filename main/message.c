@@ -233,7 +233,20 @@ static ast_rwlock_t msg_handlers_lock;
 /*! \brief Vector of received message handlers */
 AST_VECTOR(, const struct ast_msg_handler *) msg_handlers;
 
-static struct ast_taskprocessor *msg_q_tp;
+/*! \brief Most taskprocessors messages are routed by */
+#define MSG_Q_MAX_WORKERS 16
+
+/*!
+ * \brief Taskprocessors messages are routed by.
+ *
+ * Each has a thread, and so a Message/ast_msg_queue channel, of its own.
+ * The messages to one recipient always go to the same one, so they are
+ * routed in the order they were queued.
+ */
+static struct ast_taskprocessor *msg_q_tps[MSG_Q_MAX_WORKERS];
+
+/*! \brief Number of taskprocessors in msg_q_tps */
+static int msg_q_workers;
 
 static const char app_msg_send[] = "MessageSend";
 
@@ -906,7 +919,10 @@ int ast_msg_has_destination(const struct ast_msg *msg)
 int ast_msg_queue(struct ast_msg *msg)
 {
 	int res;
-	res = ast_taskprocessor_push(msg_q_tp, msg_q_cb, msg);
+	int worker;
+
+	worker = msg_q_workers > 1 ? ast_str_hash(msg->to) % msg_q_workers : 0;
+	res = ast_taskprocessor_push(msg_q_tps[worker], msg_q_cb, msg);
 	if (res == -1) {
 		ao2_ref(msg, -1);
 	}
@@ -1449,16 +1465,19 @@ int ast_msg_handler_unregister(const struct ast_msg_handler *handler)
 
 void ast_msg_shutdown(void)
 {
-	if (msg_q_tp) {
-		msg_q_tp = ast_taskprocessor_unreference(msg_q_tp);
+	int i;
+
+	for (i = 0; i < msg_q_workers; i++) {
+		msg_q_tps[i] = ast_taskprocessor_unreference(msg_q_tps[i]);
 	}
+	msg_q_workers = 0;
 }
 
 /*!
  * \internal
  * \brief Clean up other resources on Asterisk shutdown
  *
- * \note This does not include the msg_q_tp object, which must be disposed
+ * \note This does not include the msg_q_tps objects, which must be disposed
  * of prior to Asterisk checking for channel destruction in its shutdown
  * sequence.  The atexit handlers are executed after this occurs.
  */
@@ -1490,11 +1509,27 @@ static void message_shutdown(void)
  */
 int ast_msg_init(void)
 {
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	long cpus;
 	int res;
+	int i;
 
-	msg_q_tp = ast_taskprocessor_get("ast_msg_queue", TPS_REF_DEFAULT);
-	if (!msg_q_tp) {
-		return -1;
+	/* One taskprocessor per processor, so routing can use all of them. */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	msg_q_workers = MAX(1, MIN(cpus, MSG_Q_MAX_WORKERS));
+
+	for (i = 0; i < msg_q_workers; i++) {
+		/* The first keeps the name of the single queue this used to be. */
+		if (i) {
+			snprintf(name, sizeof(name), "ast_msg_queue-%d", i);
+		} else {
+			ast_copy_string(name, "ast_msg_queue", sizeof(name));
+		}
+		msg_q_tps[i] = ast_taskprocessor_get(name, TPS_REF_DEFAULT);
+		if (!msg_q_tps[i]) {
+			msg_q_workers = i;
+			return -1;
+		}
 	}
 
 	ast_rwlock_init(&msg_techs_lock);
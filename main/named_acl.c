@@ -75,6 +75,7 @@ static AO2_GLOBAL_OBJ_STATIC(globals);
 static void *named_acl_config_alloc(void);
 static void *named_acl_alloc(const char *cat);
 static void *named_acl_find(struct ao2_container *container, const char *cat);
+static int named_acl_prelink(void *obj);
 
 /* Config type for named ACL profiles (must not be named general) */
 static struct aco_type named_acl_type = {
@@ -84,6 +85,7 @@ static struct aco_type named_acl_type = {
 	.category = "^general$",           /*!< Match everything but "general" */
 	.item_alloc = named_acl_alloc,     /*!< A callback to allocate a new named_acl based on category */
 	.item_find = named_acl_find,       /*!< A callback to find a named_acl in some container of named_acls */
+	.item_prelink = named_acl_prelink, /*!< A callback to compile the rules of a named_acl once they are all read */
 	.item_offset = offsetof(struct named_acl_config, named_acl_list), /*!< Could leave this out since 0 */
 };
 
@@ -190,6 +192,21 @@ static void *named_acl_find(struct ao2_container *container, const char *cat)
 	return ao2_find(container, &tmp, OBJ_POINTER);
 }
 
+/*!
+ * \brief Compile the rules of a named ACL once they have all been read
+ *
+ * \note The copies handed out by ast_named_acl_find share the compiled rules.
+ */
+static int named_acl_prelink(void *obj)
+{
+	struct named_acl *named_acl = obj;
+
+	if (ast_ha_compile(named_acl->ha)) {
+		ast_log(LOG_WARNING, "Unable to compile named ACL '%s', its rules will be walked.\n", named_acl->name);
+	}
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Callback function to compare the ACL order of two given categories.
@@ -290,6 +307,7 @@ static struct named_acl *named_acl_find_realtime(const char *name)
 	}
 
 	acl->ha = built_ha;
+	ast_ha_compile(acl->ha);
 
 	return acl;
 }
@@ -27,29 +27,74 @@
 
 #include "asterisk/_private.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
 #include "asterisk/named_locks.h"
 #include "asterisk/utils.h"
+#include "asterisk/threadstorage.h"
 
-struct ao2_container *named_locks;
 #define NAMED_LOCKS_BUCKETS 101
+/*! Number of independently locked containers the named locks are spread across. */
+#define NAMED_LOCKS_SHARDS 16
+/*! Number of named locks each thread keeps a reference to for quick lookups. */
+#define NAMED_LOCKS_THREAD_CACHE 8
+
+/*! \brief A part of the named lock registry. */
+struct named_lock_shard {
+	/*! Proxies of the named locks whose key hashes to this shard. */
+	struct ao2_container *container;
+	/*! Lookups that had to go to the container. */
+	int lookups;
+	/*! Lookups that found the container locked by another thread. */
+	int contended;
+	/*! Named locks created. */
+	int created;
+};
+
+static struct named_lock_shard named_lock_shards[NAMED_LOCKS_SHARDS];
+
+/*! Lookups satisfied by a thread's own cache. */
+static int named_lock_cache_hits;
 
 struct named_lock_proxy {
 	AO2_WEAKPROXY();
+	struct named_lock_shard *shard;
 	char key[0];
 };
 
 struct ast_named_lock {
+	unsigned int hash;
+	char key[0];
 };
 
+/*! \brief Named locks recently obtained by a thread. */
+struct named_lock_cache {
+	struct ast_named_lock *locks[NAMED_LOCKS_THREAD_CACHE];
+	/*! Slot to replace next. */
+	unsigned int next;
+};
+
+static void named_lock_cache_cleanup(void *data)
+{
+	struct named_lock_cache *cache = data;
+	int i;
+
+	for (i = 0; i < NAMED_LOCKS_THREAD_CACHE; ++i) {
+		ao2_cleanup(cache->locks[i]);
+	}
+	ast_free(cache);
+}
+
+AST_THREADSTORAGE_CUSTOM(named_lock_cache, NULL, named_lock_cache_cleanup);
+
 static int named_locks_hash(const void *obj, const int flags)
 {
 	const struct named_lock_proxy *lock = obj;
 
 	switch (flags & OBJ_SEARCH_MASK) {
 	case OBJ_SEARCH_KEY:
-		return ast_str_hash(obj);
+		return ast_str_hash_fast(obj);
 	case OBJ_SEARCH_OBJECT:
-		return ast_str_hash(lock->key);
+		return ast_str_hash_fast(lock->key);
 	default:
 		/* Hash can only work on something with a full key. */
 		ast_assert(0);
@@ -82,19 +127,78 @@ static int named_locks_cmp(void *obj_left, void *obj_right, int flags)
 	return cmp ? 0 : CMP_MATCH;
 }
 
+static char *handle_show_named_locks(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#define FORMAT "%-6s %10s %12s %12s %12s\n"
+#define FORMAT2 "%-6d %10d %12d %12d %12d\n"
+	int lookups = 0;
+	int contended = 0;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show named locks";
+		e->usage =
+			"Usage: core show named locks\n"
+			"       Show the named locks in each part of the named lock\n"
+			"       registry and how often looking them up had to wait.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 4) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, FORMAT, "Shard", "Locks", "Lookups", "Contended", "Created");
+	for (i = 0; i < NAMED_LOCKS_SHARDS; ++i) {
+		struct named_lock_shard *shard = &named_lock_shards[i];
+
+		ast_cli(a->fd, FORMAT2, i, ao2_container_count(shard->container),
+			ast_atomic_fetchadd_int(&shard->lookups, 0),
+			ast_atomic_fetchadd_int(&shard->contended, 0),
+			ast_atomic_fetchadd_int(&shard->created, 0));
+		lookups += ast_atomic_fetchadd_int(&shard->lookups, 0);
+		contended += ast_atomic_fetchadd_int(&shard->contended, 0);
+	}
+	ast_cli(a->fd, "%d lookups, %d contended, %d satisfied by the thread caches\n",
+		lookups, contended, ast_atomic_fetchadd_int(&named_lock_cache_hits, 0));
+
+	return CLI_SUCCESS;
+#undef FORMAT
+#undef FORMAT2
+}
+
+static struct ast_cli_entry cli_named_locks[] = {
+	AST_CLI_DEFINE(handle_show_named_locks, "Show named lock registry statistics"),
+};
+
 static void named_locks_shutdown(void)
 {
-	ao2_cleanup(named_locks);
+	int i;
+
+	ast_cli_unregister_multiple(cli_named_locks, ARRAY_LEN(cli_named_locks));
+	for (i = 0; i < NAMED_LOCKS_SHARDS; ++i) {
+		ao2_cleanup(named_lock_shards[i].container);
+		named_lock_shards[i].container = NULL;
+	}
 }
 
 int ast_named_locks_init(void)
 {
-	named_locks = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
-		NAMED_LOCKS_BUCKETS, named_locks_hash, NULL, named_locks_cmp);
-	if (!named_locks) {
-		return -1;
+	int i;
+
+	for (i = 0; i < NAMED_LOCKS_SHARDS; ++i) {
+		named_lock_shards[i].container = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+			NAMED_LOCKS_BUCKETS, named_locks_hash, NULL, named_locks_cmp);
+		if (!named_lock_shards[i].container) {
+			named_locks_shutdown();
+			return -1;
+		}
 	}
 
+	ast_cli_register_multiple(cli_named_locks, ARRAY_LEN(cli_named_locks));
 	ast_register_cleanup(named_locks_shutdown);
 
 	return 0;
@@ -102,7 +206,95 @@ int ast_named_locks_init(void)
 
 static void named_lock_proxy_cb(void *weakproxy, void *data)
 {
-	ao2_unlink(named_locks, weakproxy);
+	struct named_lock_proxy *proxy = weakproxy;
+
+	if (proxy->shard->container) {
+		ao2_unlink(proxy->shard->container, weakproxy);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find a named lock among the ones the thread used recently.
+ *
+ * \param lock_type Type of lock requested.
+ * \param hash Hash of the full key.
+ * \param key Full key.
+ *
+ * \retval lock with a new reference if found.
+ * \retval NULL if not found.
+ */
+static struct ast_named_lock *named_lock_cache_find(enum ast_named_lock_type lock_type,
+	unsigned int hash, const char *key)
+{
+	struct named_lock_cache *cache;
+	int i;
+
+	cache = ast_threadstorage_get(&named_lock_cache, sizeof(*cache));
+	if (!cache) {
+		return NULL;
+	}
+
+	for (i = 0; i < NAMED_LOCKS_THREAD_CACHE; ++i) {
+		struct ast_named_lock *lock = cache->locks[i];
+
+		/*
+		 * The cache holds its own reference so the lock cannot have been
+		 * destroyed, and is still the one registered for the key.
+		 */
+		if (lock && lock->hash == hash && !strcmp(lock->key, key)
+			&& (ao2_options_get(lock) & AO2_ALLOC_OPT_LOCK_MASK) == lock_type) {
+			ao2_ref(lock, +1);
+			ast_atomic_fetchadd_int(&named_lock_cache_hits, 1);
+			return lock;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Remember a named lock for the thread's later lookups.
+ *
+ * \param lock Lock to remember.  The cache takes a reference of its own.
+ *
+ * \return Nothing
+ */
+static void named_lock_cache_add(struct ast_named_lock *lock)
+{
+	struct named_lock_cache *cache;
+	struct ast_named_lock *old;
+
+	cache = ast_threadstorage_get(&named_lock_cache, sizeof(*cache));
+	if (!cache) {
+		return;
+	}
+
+	old = cache->locks[cache->next];
+	ao2_ref(lock, +1);
+	cache->locks[cache->next] = lock;
+	cache->next = (cache->next + 1) % NAMED_LOCKS_THREAD_CACHE;
+
+	/* Dropping the old lock may unlink it from the registry, do it last. */
+	ao2_cleanup(old);
+}
+
+/*!
+ * \internal
+ * \brief Lock a registry shard, counting the times it was already locked.
+ *
+ * \param shard Shard to lock.
+ *
+ * \return Nothing
+ */
+static void named_lock_shard_lock(struct named_lock_shard *shard)
+{
+	ast_atomic_fetchadd_int(&shard->lookups, 1);
+	if (ao2_trylock(shard->container)) {
+		ast_atomic_fetchadd_int(&shard->contended, 1);
+		ao2_lock(shard->container);
+	}
 }
 
 struct ast_named_lock *__ast_named_lock_get(const char *filename, int lineno, const char *func,
@@ -110,28 +302,38 @@ struct ast_named_lock *__ast_named_lock_get(const char *filename, int lineno, co
 {
 	struct named_lock_proxy *proxy = NULL;
 	struct ast_named_lock *lock = NULL;
+	struct named_lock_shard *shard;
 	int keylen = strlen(keyspace) + strlen(key) + 2;
 	char *concat_key = ast_alloca(keylen);
+	unsigned int hash;
 
 	sprintf(concat_key, "%s-%s", keyspace, key); /* Safe */
+	hash = ast_str_hash_fast(concat_key);
+
+	lock = named_lock_cache_find(lock_type, hash, concat_key);
+	if (lock) {
+		return lock;
+	}
 
-	ao2_lock(named_locks);
-	proxy = ao2_find(named_locks, concat_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	shard = &named_lock_shards[hash % NAMED_LOCKS_SHARDS];
+	named_lock_shard_lock(shard);
+	proxy = ao2_find(shard->container, concat_key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
 	if (proxy) {
-		ao2_unlock(named_locks);
+		ao2_unlock(shard->container);
 		lock = __ao2_weakproxy_get_object(proxy, 0, __PRETTY_FUNCTION__, filename, lineno, func);
 
 		if (lock) {
 			/* We have an existing lock and it's not being destroyed. */
 			ao2_ref(proxy, -1);
 			ast_assert((ao2_options_get(lock) & AO2_ALLOC_OPT_LOCK_MASK) == lock_type);
+			named_lock_cache_add(lock);
 
 			return lock;
 		}
 
 		/* the old proxy is being destroyed, clean list before creating/adding new one */
-		ao2_lock(named_locks);
-		ao2_unlink_flags(named_locks, proxy, OBJ_NOLOCK);
+		named_lock_shard_lock(shard);
+		ao2_unlink_flags(shard->container, proxy, OBJ_NOLOCK);
 		ao2_ref(proxy, -1);
 	}
 
@@ -154,15 +356,20 @@ struct ast_named_lock *__ast_named_lock_get(const char *filename, int lineno, co
 		goto failure_cleanup;
 	}
 
+	lock->hash = hash;
+	strcpy(lock->key, concat_key); /* Safe */
+	proxy->shard = shard;
 	strcpy(proxy->key, concat_key); /* Safe */
-	ao2_link_flags(named_locks, proxy, OBJ_NOLOCK);
-	ao2_unlock(named_locks);
+	ao2_link_flags(shard->container, proxy, OBJ_NOLOCK);
+	ao2_unlock(shard->container);
 	ao2_t_ref(proxy, -1, "Release allocation reference");
+	ast_atomic_fetchadd_int(&shard->created, 1);
+	named_lock_cache_add(lock);
 
 	return lock;
 
 failure_cleanup:
-	ao2_unlock(named_locks);
+	ao2_unlock(shard->container);
 
 	ao2_cleanup(proxy);
 	ao2_cleanup(lock);
@@ -66,6 +66,7 @@
 #include "asterisk/module.h"
 #include "asterisk/indications.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 #include "asterisk/xmldoc.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/stasis_channels.h"
@@ -247,6 +248,7 @@ struct ast_exten {
 	struct ast_app *cached_app;     /*!< Cached location of application */
 	void *data;			/*!< Data to use (arguments) */
 	void (*datad)(void *);		/*!< Data destructor */
+	struct pbx_subst_template *subst;	/*!< Data split up for variable substitution (NULL if none) */
 	struct ast_exten *peer;		/*!< Next higher priority with our extension */
 	struct ast_hashtab *peer_table;    /*!< Priorities list in hashtab form -- only on the head of the peer list */
 	struct ast_hashtab *peer_label_table; /*!< labeled priorities in the peers -- only on the head of the peer list */
@@ -292,9 +294,32 @@ struct ast_context {
 	int refcount;                   /*!< each module that would have created this context should inc/dec this as appropriate */
 	int autohints;                  /*!< Whether autohints support is enabled or not */
 	ast_mutex_t macrolock;			/*!< A lock to implement "exclusive" macros - held whilst a call is executing in the macro */
+	struct ao2_container *exten_cache;	/*!< Memoized extension matches (NULL if unavailable) */
+	unsigned int exten_cache_gen;		/*!< Bumped before and after every extension change, odd during one.  Protected by the exten_cache lock. */
+	int exten_cache_by_cid;			/*!< Whether any extension ever added matches on caller ID, so cache keys include it */
+	int foreign_extens;			/*!< Whether any extension ever added has a registrar other than the context's */
 	char name[0];				/*!< Name of the context */
 };
 
+/*!
+ * \brief A memoized extension match in a context
+ *
+ * \details Matches for E_MATCH and E_SPAWN, and for E_FINDLABEL with
+ * the old pattern matcher, only depend on the dialed extension and the
+ * caller ID.  Every priority step of a call looks the same ones up again.
+ */
+struct exten_cache_entry {
+	/*! Extension the matcher found first.  NULL if none matched. */
+	struct ast_exten *eroot;
+	/*! Non-zero if found by the new pattern matcher */
+	int newmatcher;
+	/*! The dialed extension, followed by '/' and the caller ID if the context matches on it */
+	char key[0];
+};
+
+/*! Maximum number of matches memoized per context before the cache is emptied */
+#define EXTEN_CACHE_MAX 8192
+
 /*! \brief ast_state_cb: An extension state notify register item */
 struct ast_state_cb {
 	/*! Watcher ID returned when registered. */
@@ -307,10 +332,20 @@ struct ast_state_cb {
 	ast_state_cb_type change_cb;
 	/*! Callback when destroyed so any resources given by the registerer can be freed. */
 	ast_state_cb_destroy_type destroy_cb;
+	/*! Serializer the callback is called on */
+	unsigned int shard;
+	/*! Set once the callback is deleted so changes still queued for it are dropped */
+	int removed;
 	/*! \note Only used by ast_merge_contexts_and_delete */
 	AST_LIST_ENTRY(ast_state_cb) entry;
 };
 
+/*! \brief Last known state of a device of a hint */
+struct hint_device_state {
+	enum ast_device_state state;
+	char name[0];
+};
+
 /*!
  * \brief Structure for dial plan hints
  *
@@ -341,6 +376,13 @@ struct ast_hint {
 	char exten_name[AST_MAX_EXTENSION];/*!< Extension of destroyed hint extension. */
 
 	AST_VECTOR(, char *) devices; /*!< Devices associated with the hint */
+
+	/*! Serializer the device state of the hint is evaluated on */
+	unsigned int shard;
+	/*! Devices of the hint the cached states are for, only used on the serializer */
+	char *cached_devices;
+	/*! Last known state of each device of the hint, only used on the serializer */
+	AST_VECTOR(, struct hint_device_state *) device_states;
 };
 
 STASIS_MESSAGE_TYPE_DEFN_LOCAL(hint_change_message_type);
@@ -756,6 +798,125 @@ static unsigned int hashtab_hash_labels(const void *obj)
 	return ast_hashtab_hash_string(S_OR(ac->label, ""));
 }
 
+AO2_STRING_FIELD_SORT_FN(exten_cache_entry, key);
+
+/*!
+ * \internal
+ * \brief Look up a memoized extension match.
+ *
+ * \param con Context to look in.
+ * \param key Cache key of the lookup.
+ * \param newmatcher Non-zero if the new pattern matcher is in use.
+ * \param eroot Where to put the memoized extension.  (NULL if none matched)
+ * \param gen Where to put the cache generation to pass to exten_cache_add().
+ *
+ * \retval 0 if the match was memoized.
+ * \retval -1 if the matcher must be run.
+ */
+static int exten_cache_find(struct ast_context *con, const char *key, int newmatcher,
+	struct ast_exten **eroot, unsigned int *gen)
+{
+	struct exten_cache_entry *entry;
+	int res = -1;
+
+	ao2_rdlock(con->exten_cache);
+	*gen = con->exten_cache_gen;
+	entry = ao2_find(con->exten_cache, key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	ao2_unlock(con->exten_cache);
+
+	if (entry) {
+		if (entry->newmatcher == newmatcher) {
+			*eroot = entry->eroot;
+			res = 0;
+		}
+		ao2_ref(entry, -1);
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Memoize an extension match.
+ *
+ * \param con Context the matcher ran on.
+ * \param key Cache key of the lookup.
+ * \param newmatcher Non-zero if the new pattern matcher found it.
+ * \param eroot The extension found.  (NULL if none matched)
+ * \param gen Cache generation exten_cache_find() gave before the matcher ran.
+ *
+ * \note Nothing is memoized if the extensions changed since, or are
+ * changing, as the match may then be stale.
+ *
+ * \return Nothing
+ */
+static void exten_cache_add(struct ast_context *con, const char *key, int newmatcher,
+	struct ast_exten *eroot, unsigned int gen)
+{
+	struct exten_cache_entry *entry;
+	size_t key_len = strlen(key) + 1;
+
+	if (gen & 1) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->eroot = eroot;
+	entry->newmatcher = newmatcher;
+	memcpy(entry->key, key, key_len);
+
+	ao2_wrlock(con->exten_cache);
+	if (gen == con->exten_cache_gen) {
+		if (ao2_container_count(con->exten_cache) >= EXTEN_CACHE_MAX) {
+			ao2_callback(con->exten_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+				NULL, NULL);
+		}
+		ao2_link_flags(con->exten_cache, entry, OBJ_NOLOCK);
+	}
+	ao2_unlock(con->exten_cache);
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Forget memoized matches of a context whose extensions are about to change.
+ *
+ * \note Must be paired with exten_cache_change_end().  Until then,
+ * nothing is memoized.
+ *
+ * \return Nothing
+ */
+static void exten_cache_change_begin(struct ast_context *con)
+{
+	if (!con->exten_cache) {
+		return;
+	}
+	ao2_wrlock(con->exten_cache);
+	++con->exten_cache_gen;
+	ao2_callback(con->exten_cache, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE | OBJ_NOLOCK,
+		NULL, NULL);
+	ao2_unlock(con->exten_cache);
+}
+
+/*!
+ * \internal
+ * \brief Allow memoizing matches again after a change of a context's extensions.
+ *
+ * \return Nothing
+ */
+static void exten_cache_change_end(struct ast_context *con)
+{
+	if (!con->exten_cache) {
+		return;
+	}
+	ao2_wrlock(con->exten_cache);
+	++con->exten_cache_gen;
+	ao2_unlock(con->exten_cache);
+}
+
 static int autofallthrough = 1;
 static int extenpatternmatchnew = 0;
 static char *overrideswitch = NULL;
@@ -765,6 +926,20 @@ static struct stasis_subscription *device_state_sub;
 /*! \brief Subscription for presence state change events */
 static struct stasis_subscription *presence_state_sub;
 
+/*! Serializers hints are evaluated on, picked by hint */
+#define HINT_SHARDS 16
+/*! Serializers watchers are called on, picked by watcher */
+#define HINT_WATCHER_SHARDS 16
+
+/*! \brief Threads hints are evaluated and watchers are called on */
+static struct ast_threadpool *hint_pool;
+/*! \brief Serializers device state changes of hints are evaluated on */
+static struct ast_taskprocessor *hint_shards[HINT_SHARDS];
+/*! \brief Serializers watchers of hints are called on */
+static struct ast_taskprocessor *hint_watcher_shards[HINT_WATCHER_SHARDS];
+/*! \brief Serializer the next watcher added is called on */
+static int next_watcher_shard;
+
 AST_MUTEX_DEFINE_STATIC(maxcalllock);
 static int countcalls;
 static int totalcalls;
@@ -782,8 +957,10 @@ AST_MUTEX_DEFINE_STATIC(conlock);
 
 /*!
  * \brief Lock to hold off restructuring of hints by ast_merge_contexts_and_delete.
+ * \note Read locked while hints are evaluated, so the serializers of the hints
+ * do not hold each other up.
  */
-AST_MUTEX_DEFINE_STATIC(context_merge_lock);
+AST_RWLOCK_DEFINE_STATIC(context_merge_lock);
 
 static int stateid = 1;
 /*!
@@ -2418,6 +2595,10 @@ struct fake_context /* this struct is purely for matching in the hashtab */
 	int refcount;
 	int autohints;
 	ast_mutex_t macrolock;
+	struct ao2_container *exten_cache;
+	unsigned int exten_cache_gen;
+	int exten_cache_by_cid;
+	int foreign_extens;
 	char name[256];
 };
 
@@ -2475,6 +2656,9 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 	struct scoreboard score = {0, };
 	struct ast_str *tmpdata = NULL;
 	int idx;
+	char *cache_key = NULL;
+	unsigned int cache_gen = 0;
+	int cached = 0;
 
 	pattern.label = label;
 	pattern.priority = priority;
@@ -2588,9 +2772,29 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 		}
 	} while (0);
 
+	/* Matches for these actions only depend on the extension and the caller ID. */
+	if (tmp->exten_cache && exten
+		&& (action == E_MATCH || action == E_SPAWN
+			|| (action == E_FINDLABEL && !extenpatternmatchnew))) {
+		if (tmp->exten_cache_by_cid && !ast_strlen_zero(callerid)) {
+			cache_key = ast_alloca(strlen(exten) + strlen(callerid) + 2);
+			sprintf(cache_key, "%s/%s", exten, callerid); /* SAFE */
+		} else {
+			cache_key = (char *) exten;
+		}
+		cached = !exten_cache_find(tmp, cache_key, extenpatternmatchnew, &eroot, &cache_gen);
+	}
+
 	if (extenpatternmatchnew) {
-		new_find_extension(exten, &score, tmp->pattern_tree, 0, 0, callerid, label, action);
-		eroot = score.exten;
+		if (cached) {
+			score.exten = eroot;
+		} else {
+			new_find_extension(exten, &score, tmp->pattern_tree, 0, 0, callerid, label, action);
+			eroot = score.exten;
+			if (cache_key) {
+				exten_cache_add(tmp, cache_key, 1, eroot, cache_gen);
+			}
+		}
 
 		if (score.last_char == '!' && action == E_MATCHMORE) {
 			/* We match an extension ending in '!'.
@@ -2660,14 +2864,23 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 		}
 	} else {   /* the old/current default exten pattern match algorithm */
 
-		/* scan the list trying to match extension and CID */
-		eroot = NULL;
-		while ( (eroot = ast_walk_context_extensions(tmp, eroot)) ) {
+		/*
+		 * Scan the list trying to match extension and CID.  A memoized
+		 * match is the first extension that matches, so start there.
+		 */
+		if (!cached) {
+			eroot = ast_walk_context_extensions(tmp, NULL);
+		}
+		for (; eroot; eroot = ast_walk_context_extensions(tmp, eroot)) {
 			int match = extension_match_core(eroot->exten, exten, action);
 			/* 0 on fail, 1 on match, 2 on earlymatch */
 
 			if (!match || (eroot->matchcid && !matchcid(eroot->cidmatch, callerid)))
 				continue;	/* keep trying */
+			if (cache_key && !cached) {
+				exten_cache_add(tmp, cache_key, 0, eroot, cache_gen);
+				cached = 1;
+			}
 			if (match == 2 && action == E_MATCHMORE) {
 				/* We match an extension ending in '!'.
 				 * The decision in this case is final and is NULL (no match).
@@ -2691,6 +2904,10 @@ struct ast_exten *pbx_find_extension(struct ast_channel *chan,
 				return e;
 			}
 		}
+		if (cache_key && !cached) {
+			/* Nothing matched. */
+			exten_cache_add(tmp, cache_key, 0, NULL, cache_gen);
+		}
 	}
 
 	/* Check alternative switches */
@@ -2860,6 +3077,7 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 	struct ast_exten *e;
 	struct ast_app *app;
 	char *substitute = NULL;
+	struct pbx_subst_template *subst = NULL;
 	int res;
 	struct pbx_find_info q = { .stacklen = 0 }; /* the rest is reset in pbx_find_extension */
 	char passdata[EXT_DATA_SIZE];
@@ -2886,6 +3104,9 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 			app = e->cached_app;
 			if (ast_strlen_zero(e->data)) {
 				*passdata = '\0';
+			} else if (e->subst) {
+				/* already split up when the extension was added */
+				subst = ao2_bump(e->subst);
 			} else {
 				const char *tmp;
 				if ((!(tmp = strchr(e->data, '$'))) || (!strstr(tmp, "${") && !strstr(tmp, "$["))) {
@@ -2899,6 +3120,7 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 			ast_unlock_contexts();
 			if (!app) {
 				ast_log(LOG_WARNING, "No application '%s' for extension (%s, %s, %d)\n", e->app, context, exten, priority);
+				ao2_cleanup(subst);
 				return -1;
 			}
 			if (ast_channel_context(c) != context)
@@ -2906,7 +3128,10 @@ static int pbx_extension_helper(struct ast_channel *c, struct ast_context *con,
 			if (ast_channel_exten(c) != exten)
 				ast_channel_exten_set(c, exten);
 			ast_channel_priority_set(c, priority);
-			if (substitute) {
+			if (subst) {
+				pbx_subst_template_substitute(c, subst, passdata, sizeof(passdata)-1);
+				ao2_ref(subst, -1);
+			} else if (substitute) {
 				pbx_substitute_variables_helper(c, substitute, passdata, sizeof(passdata)-1);
 			}
 			ast_debug(1, "Launching '%s'\n", app_name(app));
@@ -3214,16 +3439,53 @@ int ast_hint_presence_state(struct ast_channel *c, const char *context, const ch
 	return extension_presence_state_helper(e, subtype, message);
 }
 
-static int execute_state_callback(ast_state_cb_type cb,
+/*! \brief A change to pass to a watcher on its serializer */
+struct state_cb_notify {
+	struct ast_state_cb *state_cb;
+	struct ast_state_cb_info info;
+	const char *context;
+	const char *exten;
+	char data[0];
+};
+
+static int state_cb_notify_task(void *data)
+{
+	struct state_cb_notify *notify = data;
+
+	if (!__atomic_load_n(&notify->state_cb->removed, __ATOMIC_ACQUIRE)) {
+		notify->state_cb->change_cb(notify->context, notify->exten, &notify->info,
+			notify->state_cb->data);
+	}
+
+	ao2_cleanup(notify->info.device_state_info);
+	ao2_ref(notify->state_cb, -1);
+	ast_free(notify);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Pass a change of a hint to a watcher.
+ *
+ * The state of the hint is taken now, and the watcher is called with it on
+ * the serializer of the watcher so a slow watcher does not hold up the
+ * others.  The watcher is called directly if there are no serializers.
+ */
+static void execute_state_callback(struct ast_state_cb *state_cb,
 	const char *context,
 	const char *exten,
-	void *data,
 	enum ast_state_cb_update_reason reason,
 	struct ast_hint *hint,
 	struct ao2_container *device_state_info)
 {
-	int res = 0;
+	struct ast_taskprocessor *serializer = hint_watcher_shards[state_cb->shard % HINT_WATCHER_SHARDS];
+	struct state_cb_notify *notify;
 	struct ast_state_cb_info info = { 0, };
+	size_t context_len;
+	size_t exten_len;
+	size_t subtype_len;
+	char *pos;
 
 	info.reason = reason;
 
@@ -3246,11 +3508,42 @@ static int execute_state_callback(ast_state_cb_type cb,
 		ao2_unlock(hint);
 	} else {
 		info.exten_state = AST_EXTENSION_REMOVED;
+		info.presence_subtype = "";
+		info.presence_message = "";
 	}
 
-	res = cb(context, exten, &info, data);
+	if (!serializer) {
+		state_cb->change_cb(context, exten, &info, state_cb->data);
+		return;
+	}
 
-	return res;
+	context_len = strlen(context) + 1;
+	exten_len = strlen(exten) + 1;
+	subtype_len = strlen(info.presence_subtype) + 1;
+	notify = ast_malloc(sizeof(*notify) + context_len + exten_len + subtype_len
+		+ strlen(info.presence_message) + 1);
+	if (!notify) {
+		return;
+	}
+
+	pos = notify->data;
+	notify->context = strcpy(pos, context);
+	pos += context_len;
+	notify->exten = strcpy(pos, exten);
+	pos += exten_len;
+	info.presence_subtype = strcpy(pos, info.presence_subtype);
+	pos += subtype_len;
+	info.presence_message = strcpy(pos, info.presence_message);
+	info.device_state_info = ao2_bump(device_state_info);
+	notify->info = info;
+	notify->state_cb = ao2_bump(state_cb);
+
+	if (ast_taskprocessor_push(serializer, state_cb_notify_task, notify)) {
+		ast_log(LOG_WARNING, "Could not pass the state of %s@%s to a watcher\n", exten, context);
+		ao2_cleanup(notify->info.device_state_info);
+		ao2_ref(notify->state_cb, -1);
+		ast_free(notify);
+	}
 }
 
 /*!
@@ -3334,16 +3627,133 @@ static void get_device_state_causing_channels(struct ao2_container *c)
 	ao2_iterator_destroy(&iter);
 }
 
-static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app)
+/*!
+ * \internal
+ * \brief Query the state of every device of a hint and cache it on the hint.
+ */
+static void hint_device_states_build(struct ast_hint *hint, const char *devices)
+{
+	struct hint_device_state *entry;
+	char *rest;
+	char *cur;
+
+	AST_VECTOR_RESET(&hint->device_states, ast_free);
+	ast_free(hint->cached_devices);
+	hint->cached_devices = ast_strdup(devices);
+
+	/* One or more devices separated with a & character */
+	rest = ast_strdupa(devices);
+	while ((cur = strsep(&rest, "&"))) {
+		entry = ast_malloc(sizeof(*entry) + strlen(cur) + 1);
+		if (!entry || AST_VECTOR_APPEND(&hint->device_states, entry)) {
+			ast_free(entry);
+			/* Query every device again next time */
+			ast_free(hint->cached_devices);
+			hint->cached_devices = NULL;
+			continue;
+		}
+		entry->state = ast_device_state(cur);
+		strcpy(entry->name, cur);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Update the cached state of a device of a hint.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the device is not cached on the hint.
+ */
+static int hint_device_states_update(struct ast_hint *hint, const char *device,
+	enum ast_device_state state)
+{
+	struct hint_device_state *entry;
+	int res = -1;
+	int i;
+
+	for (i = 0; i < AST_VECTOR_SIZE(&hint->device_states); ++i) {
+		entry = AST_VECTOR_GET(&hint->device_states, i);
+		if (!strcasecmp(entry->name, device)) {
+			entry->state = state;
+			res = 0;
+		}
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Get the extension state of a hint from the cached states of its devices.
+ */
+static int hint_device_states_aggregate(struct ast_hint *hint)
+{
+	struct ast_devstate_aggregate agg;
+	int i;
+
+	ast_devstate_aggregate_init(&agg);
+	for (i = 0; i < AST_VECTOR_SIZE(&hint->device_states); ++i) {
+		ast_devstate_aggregate_add(&agg, AST_VECTOR_GET(&hint->device_states, i)->state);
+	}
+
+	return ast_devstate_to_extenstate(ast_devstate_aggregate_result(&agg));
+}
+
+/*!
+ * \internal
+ * \brief Make the extended state info of a hint from the cached states of its devices.
+ */
+static struct ao2_container *hint_device_state_info(struct ast_hint *hint)
+{
+	struct ao2_container *device_state_info;
+	struct hint_device_state *entry;
+	struct ast_device_state_info *obj;
+	int i;
+
+	device_state_info = alloc_device_state_info();
+	if (!device_state_info) {
+		return NULL;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&hint->device_states); ++i) {
+		entry = AST_VECTOR_GET(&hint->device_states, i);
+		obj = ao2_alloc_options(sizeof(*obj) + strlen(entry->name), device_state_info_dt, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		/* if failed we cannot add this device */
+		if (obj) {
+			obj->device_state = entry->state;
+			strcpy(obj->device_name, entry->name);
+			ao2_link(device_state_info, obj);
+			ao2_ref(obj, -1);
+		}
+	}
+
+	return device_state_info;
+}
+
+/*!
+ * \internal
+ * \brief Evaluate a hint for a device state change and notify the watchers.
+ *
+ * \param hint The hint
+ * \param hint_app Buffer to use for the hint string
+ * \param device The device that changed, or NULL to query every device of the hint
+ * \param device_state The new state of the device
+ *
+ * \note Must only be called on the serializer of the hint, or from the device
+ * state subscription when there are no serializers, with context_merge_lock held.
+ */
+static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app,
+	const char *device, enum ast_device_state device_state)
 {
 	struct ao2_iterator cb_iter;
 	struct ast_state_cb *state_cb;
 	int state;
 	int same_state;
-	struct ao2_container *device_state_info;
+	struct ao2_container *device_state_info = NULL;
 	int first_extended_cb_call = 1;
 	char context_name[AST_MAX_CONTEXT];
 	char exten_name[AST_MAX_EXTENSION];
+	const char *devices;
 
 	ao2_lock(hint);
 	if (!hint->exten) {
@@ -3365,36 +3775,39 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 	ao2_unlock(hint);
 
 	/*
-	 * Get device state for this hint.
+	 * Get device state for this hint from the states cached on it.
+	 * Every device is only queried when the devices of the hint
+	 * changed or the device is not known.
 	 *
 	 * NOTE: We cannot hold any locks while determining the hint
 	 * device state or notifying the watchers without causing a
 	 * deadlock.  (conlock, hints, and hint)
 	 */
+	devices = parse_hint_device(*hint_app);
+	if (ast_strlen_zero(device) || !hint->cached_devices
+		|| strcmp(hint->cached_devices, devices)
+		|| hint_device_states_update(hint, device, device_state)) {
+		hint_device_states_build(hint, devices);
+	}
 
-	/* Make a container so state3 can fill it if we wish.
-	 * If that failed we simply do not provide the extended state info.
-	 */
-	device_state_info = alloc_device_state_info();
-
-	state = ast_extension_state3(*hint_app, device_state_info);
+	state = hint_device_states_aggregate(hint);
 	same_state = state == hint->laststate;
 	if (same_state && (~state & AST_EXTENSION_RINGING)) {
-		ao2_cleanup(device_state_info);
 		return;
 	}
 
 	/* Device state changed since last check - notify the watchers. */
+	ao2_lock(hint);
 	hint->laststate = state;	/* record we saw the change */
+	ao2_unlock(hint);
 
 	/* For general callbacks */
 	if (!same_state) {
 		cb_iter = ao2_iterator_init(statecbs, 0);
 		for (; (state_cb = ao2_iterator_next(&cb_iter)); ao2_ref(state_cb, -1)) {
-			execute_state_callback(state_cb->change_cb,
+			execute_state_callback(state_cb,
 				context_name,
 				exten_name,
-				state_cb->data,
 				AST_HINT_UPDATE_DEVICE,
 				hint,
 				NULL);
@@ -3411,13 +3824,13 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 		if (state_cb->extended && first_extended_cb_call) {
 			/* Fill detailed device_state_info now that we know it is used by extd. callback */
 			first_extended_cb_call = 0;
+			device_state_info = hint_device_state_info(hint);
 			get_device_state_causing_channels(device_state_info);
 		}
 		if (state_cb->extended || !same_state) {
-			execute_state_callback(state_cb->change_cb,
+			execute_state_callback(state_cb,
 				context_name,
 				exten_name,
-				state_cb->data,
 				AST_HINT_UPDATE_DEVICE,
 				hint,
 				state_cb->extended ? device_state_info : NULL);
@@ -3428,6 +3841,83 @@ static void device_state_notify_callbacks(struct ast_hint *hint, struct ast_str
 	ao2_cleanup(device_state_info);
 }
 
+/*! \brief A device state change to evaluate a hint for */
+struct hint_device_change {
+	struct ast_hint *hint;
+	enum ast_device_state state;
+	/*! The device that changed, or empty to query every device of the hint */
+	char device[0];
+};
+
+/*!
+ * \internal
+ * \brief Evaluate a hint for a device state change with context_merge_lock held.
+ */
+static void hint_device_change_evaluate(struct hint_device_change *change)
+{
+	struct ast_str *hint_app;
+
+	hint_app = ast_str_create(1024);
+	if (hint_app) {
+		device_state_notify_callbacks(change->hint, &hint_app, change->device, change->state);
+		ast_free(hint_app);
+	}
+}
+
+static void hint_device_change_destroy(struct hint_device_change *change)
+{
+	ao2_ref(change->hint, -1);
+	ast_free(change);
+}
+
+static int hint_device_change_task(void *data)
+{
+	struct hint_device_change *change = data;
+
+	ast_rwlock_rdlock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
+	hint_device_change_evaluate(change);
+	ast_rwlock_unlock(&context_merge_lock);
+
+	hint_device_change_destroy(change);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Evaluate a hint for a device state change on the serializer of the hint.
+ *
+ * \param hint The hint
+ * \param device The device that changed, or NULL to query every device of the hint
+ * \param state The new state of the device
+ *
+ * \note Must be called with context_merge_lock held.  The hint is evaluated
+ * right away if there are no serializers.
+ */
+static void hint_queue_device_change(struct ast_hint *hint, const char *device,
+	enum ast_device_state state)
+{
+	struct ast_taskprocessor *serializer = hint_shards[hint->shard];
+	struct hint_device_change *change;
+
+	device = S_OR(device, "");
+	change = ast_malloc(sizeof(*change) + strlen(device) + 1);
+	if (!change) {
+		return;
+	}
+	change->hint = ao2_bump(hint);
+	change->state = state;
+	strcpy(change->device, device);
+
+	if (!serializer) {
+		hint_device_change_evaluate(change);
+		hint_device_change_destroy(change);
+	} else if (ast_taskprocessor_push(serializer, hint_device_change_task, change)) {
+		ast_log(LOG_WARNING, "Could not queue the state of device '%s' for a hint\n", device);
+		hint_device_change_destroy(change);
+	}
+}
+
 static void presence_state_notify_callbacks(struct ast_hint *hint, struct ast_str **hint_app,
 					    struct ast_presence_state_message *presence_state)
 {
@@ -3468,19 +3958,20 @@ static void presence_state_notify_callbacks(struct ast_hint *hint, struct ast_st
 	}
 
 	/* update new values */
+	ao2_lock(hint);
 	ast_free(hint->last_presence_subtype);
 	ast_free(hint->last_presence_message);
 	hint->last_presence_state = presence_state->state;
 	hint->last_presence_subtype = presence_state->subtype ? ast_strdup(presence_state->subtype) : NULL;
 	hint->last_presence_message = presence_state->message ? ast_strdup(presence_state->message) : NULL;
+	ao2_unlock(hint);
 
 	/* For general callbacks */
 	cb_iter = ao2_iterator_init(statecbs, 0);
 	for (; (state_cb = ao2_iterator_next(&cb_iter)); ao2_ref(state_cb, -1)) {
-		execute_state_callback(state_cb->change_cb,
+		execute_state_callback(state_cb,
 			context_name,
 			exten_name,
-			state_cb->data,
 			AST_HINT_UPDATE_PRESENCE,
 			hint,
 			NULL);
@@ -3490,10 +3981,9 @@ static void presence_state_notify_callbacks(struct ast_hint *hint, struct ast_st
 	/* For extension callbacks */
 	cb_iter = ao2_iterator_init(hint->callbacks, 0);
 	for (; (state_cb = ao2_iterator_next(&cb_iter)); ao2_cleanup(state_cb)) {
-		execute_state_callback(state_cb->change_cb,
+		execute_state_callback(state_cb,
 			context_name,
 			exten_name,
-			state_cb->data,
 			AST_HINT_UPDATE_PRESENCE,
 			hint,
 			NULL);
@@ -3518,7 +4008,9 @@ static int handle_hint_change_message_type(struct stasis_message *msg, enum ast_
 
 	switch (reason) {
 	case AST_HINT_UPDATE_DEVICE:
-		device_state_notify_callbacks(hint, &hint_app);
+		ast_rwlock_rdlock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
+		hint_queue_device_change(hint, NULL, AST_DEVICE_UNKNOWN);
+		ast_rwlock_unlock(&context_merge_lock);
 		break;
 	case AST_HINT_UPDATE_PRESENCE:
 		{
@@ -3551,7 +4043,6 @@ static int handle_hint_change_message_type(struct stasis_message *msg, enum ast_
 static void device_state_cb(void *unused, struct stasis_subscription *sub, struct stasis_message *msg)
 {
 	struct ast_device_state_message *dev_state;
-	struct ast_str *hint_app;
 	struct ast_hintdevice *device;
 	struct ast_hintdevice *cmpdevice;
 	struct ao2_iterator *dev_iter;
@@ -3580,17 +4071,12 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	hint_app = ast_str_create(1024);
-	if (!hint_app) {
-		return;
-	}
-
 	cmpdevice = ast_alloca(sizeof(*cmpdevice) + strlen(dev_state->device));
 	strcpy(cmpdevice->hintdevice, dev_state->device);
 
-	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
+	ast_rwlock_rdlock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
 
-	/* Initially we find all hints for the device and notify them */
+	/* Initially we find all hints for the device and have them evaluated */
 	dev_iter = ao2_t_callback(hintdevices,
 		OBJ_SEARCH_OBJECT | OBJ_MULTIPLE,
 		hintdevice_cmp_multiple,
@@ -3599,7 +4085,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	if (dev_iter) {
 		for (; (device = ao2_iterator_next(dev_iter)); ao2_t_ref(device, -1, "Next device")) {
 			if (device->hint) {
-				device_state_notify_callbacks(device->hint, &hint_app);
+				hint_queue_device_change(device->hint, dev_state->device, dev_state->state);
 			}
 		}
 		ao2_iterator_destroy(dev_iter);
@@ -3643,8 +4129,7 @@ static void device_state_cb(void *unused, struct stasis_subscription *sub, struc
 	ao2_iterator_destroy(&auto_iter);
 
 end:
-	ast_mutex_unlock(&context_merge_lock);
-	ast_free(hint_app);
+	ast_rwlock_unlock(&context_merge_lock);
 	return;
 }
 
@@ -3691,6 +4176,7 @@ static int extension_state_add_destroy(const char *context, const char *exten,
 			return -1;
 		}
 		state_cb->id = 0;
+		state_cb->shard = ast_atomic_fetchadd_int(&next_watcher_shard, 1);
 		state_cb->change_cb = change_cb;
 		state_cb->destroy_cb = destroy_cb;
 		state_cb->data = data;
@@ -3744,6 +4230,7 @@ static int extension_state_add_destroy(const char *context, const char *exten,
 		/* Do not allow id to ever be -1 or 0. */
 	} while (id == -1 || id == 0);
 	state_cb->id = id;
+	state_cb->shard = ast_atomic_fetchadd_int(&next_watcher_shard, 1);
 	state_cb->change_cb = change_cb;	/* Pointer to callback routine */
 	state_cb->destroy_cb = destroy_cb;
 	state_cb->data = data;		/* Data for the callback */
@@ -3808,6 +4295,8 @@ int ast_extension_state_del(int id, ast_state_cb_type change_cb)
 		p_cur = ao2_find(statecbs, change_cb, OBJ_UNLINK);
 		if (p_cur) {
 			ret = 0;
+			/* Drop the changes still queued for it */
+			__atomic_store_n(&p_cur->removed, 1, __ATOMIC_RELEASE);
 			ao2_ref(p_cur, -1);
 		}
 	} else { /* callback with extension, find the callback based on ID */
@@ -3819,6 +4308,8 @@ int ast_extension_state_del(int id, ast_state_cb_type change_cb)
 			p_cur = ao2_find(hint->callbacks, &id, OBJ_UNLINK);
 			if (p_cur) {
 				ret = 0;
+				/* Drop the changes still queued for it */
+				__atomic_store_n(&p_cur->removed, 1, __ATOMIC_RELEASE);
 				ao2_ref(p_cur, -1);
 			}
 			ao2_ref(hint, -1);
@@ -3867,10 +4358,9 @@ static void destroy_hint(void *obj)
 		hint->laststate = AST_EXTENSION_DEACTIVATED;
 		while ((state_cb = ao2_callback(hint->callbacks, OBJ_UNLINK, NULL, NULL))) {
 			/* Notify with -1 and remove all callbacks */
-			execute_state_callback(state_cb->change_cb,
+			execute_state_callback(state_cb,
 				context_name,
 				exten_name,
-				state_cb->data,
 				AST_HINT_UPDATE_DEVICE,
 				hint,
 				NULL);
@@ -3884,6 +4374,9 @@ static void destroy_hint(void *obj)
 		ast_free(device);
 	}
 	AST_VECTOR_FREE(&hint->devices);
+	AST_VECTOR_RESET(&hint->device_states, ast_free);
+	AST_VECTOR_FREE(&hint->device_states);
+	ast_free(hint->cached_devices);
 	ast_free(hint->last_presence_subtype);
 	ast_free(hint->last_presence_message);
 }
@@ -3954,6 +4447,8 @@ static int ast_add_hint(struct ast_exten *e)
 		return -1;
 	}
 	hint_new->exten = e;
+	hint_new->shard = ((unsigned int) ast_str_hash_fast(ast_get_extension_name(e))
+		+ ast_str_hash_fast(ast_get_context_name(ast_get_extension_context(e)))) % HINT_SHARDS;
 	if (strstr(e->app, "${") && e->exten[0] == '_') {
 		/* The hint is dynamic and hasn't been evaluted yet */
 		hint_new->laststate = AST_DEVICE_INVALID;
@@ -4000,10 +4495,9 @@ static int ast_add_hint(struct ast_exten *e)
 		/* For general callbacks */
 		cb_iter = ao2_iterator_init(statecbs, 0);
 		for (; (state_cb = ao2_iterator_next(&cb_iter)); ao2_ref(state_cb, -1)) {
-			execute_state_callback(state_cb->change_cb,
+			execute_state_callback(state_cb,
 				ast_get_context_name(ast_get_extension_context(e)),
 				ast_get_extension_name(e),
-				state_cb->data,
 				AST_HINT_UPDATE_DEVICE,
 				hint_new,
 				NULL);
@@ -4057,7 +4551,6 @@ static int ast_change_hint(struct ast_exten *oe, struct ast_exten *ne)
 	hint = ao2_find(hints, oe, OBJ_UNLINK);
 	if (!hint) {
 		ao2_unlock(hints);
-		ast_mutex_unlock(&context_merge_lock);
 		return -1;
 	}
 
@@ -4627,6 +5120,7 @@ static void destroy_exten(struct ast_exten *e)
 		ast_hashtab_destroy(e->peer_label_table, 0);
 	if (e->datad)
 		e->datad(e->data);
+	ao2_cleanup(e->subst);
 	ast_free(e);
 }
 
@@ -4938,6 +5432,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 
 	if (!already_locked)
 		ast_wrlock_context(con);
+	exten_cache_change_begin(con);
 
 #ifdef NEED_DEBUG
 	ast_verb(3,"Removing %s/%s/%d%s%s from trees, registrar=%s\n", con->name, extension, priority, matchcallerid ? "/" : "", matchcallerid ? callerid : "", registrar);
@@ -5039,6 +5534,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 	}
 	if (!exten) {
 		/* we can't find right extension */
+		exten_cache_change_end(con);
 		if (!already_locked)
 			ast_unlock_context(con);
 		return -1;
@@ -5088,6 +5584,7 @@ int ast_context_remove_extension_callerid2(struct ast_context *con, const char *
 			previous_peer = peer;
 		}
 	}
+	exten_cache_change_end(con);
 	if (!already_locked)
 		ast_unlock_context(con);
 	return found ? 0 : -1;
@@ -6172,6 +6669,8 @@ struct ast_context *ast_context_find_or_create(struct ast_context **extcontexts,
 		AST_VECTOR_INIT(&tmp->includes, 0);
 		AST_VECTOR_INIT(&tmp->ignorepats, 0);
 		AST_VECTOR_INIT(&tmp->alts, 0);
+		tmp->exten_cache = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_RWLOCK,
+			AO2_CONTAINER_ALLOC_OPT_DUPS_REPLACE, exten_cache_entry_sort_fn, NULL);
 		tmp->refcount = 1;
 	} else {
 		ast_log(LOG_ERROR, "Danger! We failed to allocate a context for %s!\n", name);
@@ -6391,6 +6890,27 @@ static void context_merge(struct ast_context **extcontexts, struct ast_hashtab *
 	}
 }
 
+/*!
+ * \internal
+ * \brief Determine if context_merge() has anything to carry over from a context.
+ * \since 15.0.0
+ *
+ * \details A context that only ever held extensions of the registrar
+ * being reloaded, and that no other module holds a reference to, leaves
+ * nothing behind.  Skipping it spares walking every one of its
+ * priorities while the contexts lock is held.
+ *
+ * \param context Context of the old dialplan.
+ * \param registrar Registrar whose dialplan is being replaced.
+ *
+ * \retval 0 if the context can be skipped.
+ * \retval 1 if context_merge() must look at it.
+ */
+static int context_merge_needed(struct ast_context *context, const char *registrar)
+{
+	return !context->root_table || context->foreign_extens || context->refcount > 1
+		|| strcmp(context->registrar, registrar);
+}
 
 /* XXX this does not check that multiple contexts are merged */
 void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_hashtab *exttable, const char *registrar)
@@ -6426,7 +6946,7 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	 */
 
 	begintime = ast_tvnow();
-	ast_mutex_lock(&context_merge_lock);/* Serialize ast_merge_contexts_and_delete */
+	ast_rwlock_wrlock(&context_merge_lock);/* Serialize ast_merge_contexts_and_delete */
 	ast_wrlock_contexts();
 
 	if (!contexts_table) {
@@ -6437,12 +6957,15 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 		contexts_table = exttable;
 		contexts = *extcontexts;
 		ast_unlock_contexts();
-		ast_mutex_unlock(&context_merge_lock);
+		ast_rwlock_unlock(&context_merge_lock);
 		return;
 	}
 
 	iter = ast_hashtab_start_traversal(contexts_table);
 	while ((tmp = ast_hashtab_next(iter))) {
+		if (!context_merge_needed(tmp, registrar)) {
+			continue;
+		}
 		context_merge(extcontexts, exttable, tmp, registrar);
 	}
 	ast_hashtab_end_traversal(iter);
@@ -6546,6 +7069,13 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 			hint->last_presence_subtype = saved_hint->last_presence_subtype;
 			hint->last_presence_message = saved_hint->last_presence_message;
 			ao2_unlock(hint);
+			if (hint_pool) {
+				/*
+				 * Changes queued for the old hint are dropped, so query the
+				 * devices again after them on the same serializer.
+				 */
+				hint_queue_device_change(hint, NULL, AST_DEVICE_UNKNOWN);
+			}
 			ao2_ref(hint, -1);
 			/*
 			 * The free of saved_hint->last_presence_subtype and
@@ -6568,10 +7098,9 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 	while ((saved_hint = AST_LIST_REMOVE_HEAD(&hints_removed, list))) {
 		/* this hint has been removed, notify the watchers */
 		while ((thiscb = AST_LIST_REMOVE_HEAD(&saved_hint->callbacks, entry))) {
-			execute_state_callback(thiscb->change_cb,
+			execute_state_callback(thiscb,
 				saved_hint->context,
 				saved_hint->exten,
-				thiscb->data,
 				AST_HINT_UPDATE_DEVICE,
 				NULL,
 				NULL);
@@ -6583,7 +7112,7 @@ void ast_merge_contexts_and_delete(struct ast_context **extcontexts, struct ast_
 		ast_free(saved_hint);
 	}
 
-	ast_mutex_unlock(&context_merge_lock);
+	ast_rwlock_unlock(&context_merge_lock);
 	endlocktime = ast_tvnow();
 
 	/*
@@ -7127,6 +7656,7 @@ static int add_priority(struct ast_context *con, struct ast_exten *tmp,
 		/* Destroy the old one */
 		if (e->datad)
 			e->datad(e->data);
+		ao2_cleanup(e->subst);
 		ast_free(e);
 	} else {	/* Slip ourselves in just before e */
 		tmp->peer = e;
@@ -7331,11 +7861,21 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 	tmp->parent = con;
 	tmp->data = data;
 	tmp->datad = datad;
+	if (priority != PRIORITY_HINT) {
+		tmp->subst = pbx_subst_template_alloc(data);
+	}
 	tmp->registrar = registrar;
 
 	if (lock_context) {
 		ast_wrlock_context(con);
 	}
+	exten_cache_change_begin(con);
+	if (tmp->matchcid == AST_EXT_MATCHCID_ON) {
+		con->exten_cache_by_cid = 1;
+	}
+	if (!con->registrar || !registrar || strcmp(con->registrar, registrar)) {
+		con->foreign_extens = 1;
+	}
 
 	if (con->pattern_tree) { /* usually, on initial load, the pattern_tree isn't formed until the first find_exten; so if we are adding
 								an extension, and the trie exists, then we need to incrementally add this pattern to it. */
@@ -7385,9 +7925,11 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 				/* if you free this, null it out */
 				tmp->data = NULL;
 			}
+			ao2_cleanup(tmp->subst);
 
 			ast_free(tmp);
 		}
+		exten_cache_change_end(con);
 		if (lock_context) {
 			ast_unlock_context(con);
 		}
@@ -7433,6 +7975,7 @@ static int ast_add_extension2_lockopt(struct ast_context *con,
 		ast_hashtab_insert_safe(tmp->peer_table, tmp);
 		ast_hashtab_insert_safe(con->root_table, tmp);
 
+		exten_cache_change_end(con);
 		if (lock_context) {
 			ast_unlock_context(con);
 		}
@@ -7952,6 +8495,7 @@ static void __ast_internal_context_destroy( struct ast_context *con)
 		destroy_exten(el);
 	}
 	tmp->root = NULL;
+	ao2_cleanup(tmp->exten_cache);
 	ast_rwlock_destroy(&tmp->lock);
 	ast_mutex_destroy(&tmp->macrolock);
 	ast_free(tmp);
@@ -8223,14 +8767,14 @@ static void presence_state_cb(void *unused, struct stasis_subscription *sub, str
 	cmpdevice = ast_alloca(sizeof(*cmpdevice) + strlen(presence_state->provider));
 	strcpy(cmpdevice->hintdevice, presence_state->provider);
 
-	ast_mutex_lock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
+	ast_rwlock_rdlock(&context_merge_lock);/* Hold off ast_merge_contexts_and_delete */
 	dev_iter = ao2_t_callback(hintdevices,
 		OBJ_POINTER | OBJ_MULTIPLE,
 		hintdevice_cmp_multiple,
 		cmpdevice,
 		"find devices in container");
 	if (!dev_iter) {
-		ast_mutex_unlock(&context_merge_lock);
+		ast_rwlock_unlock(&context_merge_lock);
 		ast_free(hint_app);
 		return;
 	}
@@ -8241,7 +8785,7 @@ static void presence_state_cb(void *unused, struct stasis_subscription *sub, str
 		}
 	}
 	ao2_iterator_destroy(dev_iter);
-	ast_mutex_unlock(&context_merge_lock);
+	ast_rwlock_unlock(&context_merge_lock);
 
 	ast_free(hint_app);
 }
@@ -8355,6 +8899,60 @@ static int action_extensionstatelist(struct mansession *s, const struct message
 }
 
 
+static void hint_pool_shutdown(void)
+{
+	struct ast_taskprocessor *serializer;
+	int i;
+
+	for (i = 0; i < HINT_SHARDS; ++i) {
+		serializer = hint_shards[i];
+		hint_shards[i] = NULL;
+		ast_taskprocessor_unreference(serializer);
+	}
+	for (i = 0; i < HINT_WATCHER_SHARDS; ++i) {
+		serializer = hint_watcher_shards[i];
+		hint_watcher_shards[i] = NULL;
+		ast_taskprocessor_unreference(serializer);
+	}
+	ast_threadpool_shutdown(hint_pool);
+	hint_pool = NULL;
+}
+
+static int hint_pool_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = HINT_SHARDS + HINT_WATCHER_SHARDS,
+	};
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	int i;
+
+	hint_pool = ast_threadpool_create("pbx-hint", NULL, &options);
+	if (!hint_pool) {
+		return -1;
+	}
+
+	for (i = 0; i < HINT_SHARDS; ++i) {
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pbx-hint");
+		hint_shards[i] = ast_threadpool_serializer(tps_name, hint_pool);
+		if (!hint_shards[i]) {
+			return -1;
+		}
+	}
+	for (i = 0; i < HINT_WATCHER_SHARDS; ++i) {
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pbx-hint-watcher");
+		hint_watcher_shards[i] = ast_threadpool_serializer(tps_name, hint_pool);
+		if (!hint_watcher_shards[i]) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Clean up resources on Asterisk shutdown.
@@ -8365,6 +8963,7 @@ static void unload_pbx(void)
 {
 	presence_state_sub = stasis_unsubscribe_and_join(presence_state_sub);
 	device_state_sub = stasis_unsubscribe_and_join(device_state_sub);
+	hint_pool_shutdown();
 
 	ast_manager_unregister("ShowDialPlan");
 	ast_manager_unregister("ExtensionStateList");
@@ -8397,6 +8996,10 @@ int load_pbx(void)
 		return -1;
 	}
 
+	if (hint_pool_init()) {
+		return -1;
+	}
+
 	if (!(device_state_sub = stasis_subscribe(ast_device_state_topic_all(), device_state_cb, NULL))) {
 		return -1;
 	}
@@ -53,6 +53,7 @@ struct ast_app {
 	);
 #ifdef AST_XML_DOCS
 	enum ast_doc_src docsrc;		/*!< Where the documentation come from. */
+	unsigned int docs_pending:1;		/*!< XML documentation not built yet. */
 #endif
 	AST_RWLIST_ENTRY(ast_app) list;		/*!< Next app in list */
 	struct ast_module *module;		/*!< Module this app belongs to */
@@ -99,15 +100,66 @@ struct ast_app *pbx_findapp(const char *app)
 	return ret;
 }
 
+#ifdef AST_XML_DOCS
+/*! \brief Serializes building application documentation on first use. */
+AST_MUTEX_DEFINE_STATIC(app_docs_lock);
+
+/*! \brief Fill in an application's documentation from the XML documentation */
+static void app_build_docs(struct ast_app *app)
+{
+	char *tmpxml;
+
+	/* load synopsis */
+	tmpxml = ast_xmldoc_build_synopsis("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	/* load description */
+	tmpxml = ast_xmldoc_build_description("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, description, tmpxml);
+	ast_free(tmpxml);
+
+	/* load syntax */
+	tmpxml = ast_xmldoc_build_syntax("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	/* load arguments */
+	tmpxml = ast_xmldoc_build_arguments("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	/* load seealso */
+	tmpxml = ast_xmldoc_build_seealso("application", app->name, ast_module_name(app->module));
+	ast_string_field_set(app, seealso, tmpxml);
+	ast_free(tmpxml);
+}
+#endif
+
+/*!
+ * \brief Make sure an application's documentation has been built.
+ *
+ * With lazy XML documentation this is put off from registration until the
+ * documentation is first shown.
+ */
+static void app_load_docs(struct ast_app *app)
+{
+#ifdef AST_XML_DOCS
+	ast_mutex_lock(&app_docs_lock);
+	if (app->docs_pending) {
+		app_build_docs(app);
+		app->docs_pending = 0;
+	}
+	ast_mutex_unlock(&app_docs_lock);
+#endif
+}
+
 /*! \brief Dynamically register a new dial plan application */
 int ast_register_application2(const char *app, int (*execute)(struct ast_channel *, const char *), const char *synopsis, const char *description, void *mod)
 {
 	struct ast_app *tmp;
 	struct ast_app *cur;
 	int length;
-#ifdef AST_XML_DOCS
-	char *tmpxml;
-#endif
 
 	AST_RWLIST_WRLOCK(&apps);
 	cur = pbx_findapp_nolock(app);
@@ -137,30 +189,11 @@ int ast_register_application2(const char *app, int (*execute)(struct ast_channel
 #ifdef AST_XML_DOCS
 	/* Try to lookup the docs in our XML documentation database */
 	if (ast_strlen_zero(synopsis) && ast_strlen_zero(description)) {
-		/* load synopsis */
-		tmpxml = ast_xmldoc_build_synopsis("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, synopsis, tmpxml);
-		ast_free(tmpxml);
-
-		/* load description */
-		tmpxml = ast_xmldoc_build_description("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, description, tmpxml);
-		ast_free(tmpxml);
-
-		/* load syntax */
-		tmpxml = ast_xmldoc_build_syntax("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, syntax, tmpxml);
-		ast_free(tmpxml);
-
-		/* load arguments */
-		tmpxml = ast_xmldoc_build_arguments("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, arguments, tmpxml);
-		ast_free(tmpxml);
-
-		/* load seealso */
-		tmpxml = ast_xmldoc_build_seealso("application", app, ast_module_name(tmp->module));
-		ast_string_field_set(tmp, seealso, tmpxml);
-		ast_free(tmpxml);
+		if (ast_xmldoc_lazy()) {
+			tmp->docs_pending = 1;
+		} else {
+			app_build_docs(tmp);
+		}
 		tmp->docsrc = AST_XML_DOC;
 	} else {
 #endif
@@ -193,6 +226,8 @@ static void print_app_docs(struct ast_app *aa, int fd)
 {
 #ifdef AST_XML_DOCS
 	char *synopsis = NULL, *description = NULL, *arguments = NULL, *seealso = NULL;
+
+	app_load_docs(aa);
 	if (aa->docsrc == AST_XML_DOC) {
 		synopsis = ast_xmldoc_printable(S_OR(aa->synopsis, "Not available"), 1);
 		description = ast_xmldoc_printable(S_OR(aa->description, "Not available"), 1);
@@ -359,6 +394,7 @@ static char *handle_show_applications(struct ast_cli_entry *e, int cmd, struct a
 				total_match++;
 			}
 		} else if (describing) {
+			app_load_docs(aa);
 			if (aa->description) {
 				/* Match all words on command line */
 				int i;
@@ -376,6 +412,7 @@ static char *handle_show_applications(struct ast_cli_entry *e, int cmd, struct a
 		}
 
 		if (printapp) {
+			app_load_docs(aa);
 			ast_cli(a->fd,"  %20s: %s\n", aa->name, aa->synopsis ? aa->synopsis : "<Synopsis not available>");
 		}
 	}
@@ -58,6 +58,60 @@ static int live_dangerously;
  */
 static AST_RWLIST_HEAD_STATIC(acf_root, ast_custom_function);
 
+#ifdef AST_XML_DOCS
+/*! \brief Serializes building function documentation on first use. */
+AST_MUTEX_DEFINE_STATIC(acf_docs_lock);
+
+/*! \brief Fill in a function's documentation from the XML documentation */
+static void acf_build_docs(struct ast_custom_function *acf)
+{
+	char *tmpxml;
+
+	/* load synopsis */
+	tmpxml = ast_xmldoc_build_synopsis("function", acf->name, ast_module_name(acf->mod));
+	ast_string_field_set(acf, synopsis, tmpxml);
+	ast_free(tmpxml);
+
+	/* load description */
+	tmpxml = ast_xmldoc_build_description("function", acf->name, ast_module_name(acf->mod));
+	ast_string_field_set(acf, desc, tmpxml);
+	ast_free(tmpxml);
+
+	/* load syntax */
+	tmpxml = ast_xmldoc_build_syntax("function", acf->name, ast_module_name(acf->mod));
+	ast_string_field_set(acf, syntax, tmpxml);
+	ast_free(tmpxml);
+
+	/* load arguments */
+	tmpxml = ast_xmldoc_build_arguments("function", acf->name, ast_module_name(acf->mod));
+	ast_string_field_set(acf, arguments, tmpxml);
+	ast_free(tmpxml);
+
+	/* load seealso */
+	tmpxml = ast_xmldoc_build_seealso("function", acf->name, ast_module_name(acf->mod));
+	ast_string_field_set(acf, seealso, tmpxml);
+	ast_free(tmpxml);
+}
+#endif
+
+/*!
+ * \brief Make sure a function's documentation has been built.
+ *
+ * With lazy XML documentation this is put off from registration until the
+ * documentation is first shown.
+ */
+static void acf_load_docs(struct ast_custom_function *acf)
+{
+#ifdef AST_XML_DOCS
+	ast_mutex_lock(&acf_docs_lock);
+	if (acf->docs_pending) {
+		acf_build_docs(acf);
+		acf->docs_pending = 0;
+	}
+	ast_mutex_unlock(&acf_docs_lock);
+#endif
+}
+
 static char *handle_show_functions(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	struct ast_custom_function *acf;
@@ -89,6 +143,7 @@ static char *handle_show_functions(struct ast_cli_entry *e, int cmd, struct ast_
 	AST_RWLIST_TRAVERSE(&acf_root, acf, acflist) {
 		if (!like || strstr(acf->name, a->argv[4])) {
 			count_acf++;
+			acf_load_docs(acf);
 			ast_cli(a->fd, "%-20.20s  %-35.35s  %s\n",
 				S_OR(acf->name, ""),
 				S_OR(acf->syntax, ""),
@@ -170,6 +225,8 @@ static char *handle_show_function(struct ast_cli_entry *e, int cmd, struct ast_c
 		return CLI_FAILURE;
 	}
 
+	acf_load_docs(acf);
+
 	syntax_size = strlen(S_OR(acf->syntax, "Not Available")) + AST_TERM_MAX_ESCAPE_CHARS;
 	syntax = ast_malloc(syntax_size);
 	if (!syntax) {
@@ -326,8 +383,6 @@ static int write_escalates(const struct ast_custom_function *acf) {
 static int acf_retrieve_docs(struct ast_custom_function *acf)
 {
 #ifdef AST_XML_DOCS
-	char *tmpxml;
-
 	/* Let's try to find it in the Documentation XML */
 	if (!ast_strlen_zero(acf->desc) || !ast_strlen_zero(acf->synopsis)) {
 		return 0;
@@ -337,30 +392,11 @@ static int acf_retrieve_docs(struct ast_custom_function *acf)
 		return -1;
 	}
 
-	/* load synopsis */
-	tmpxml = ast_xmldoc_build_synopsis("function", acf->name, ast_module_name(acf->mod));
-	ast_string_field_set(acf, synopsis, tmpxml);
-	ast_free(tmpxml);
-
-	/* load description */
-	tmpxml = ast_xmldoc_build_description("function", acf->name, ast_module_name(acf->mod));
-	ast_string_field_set(acf, desc, tmpxml);
-	ast_free(tmpxml);
-
-	/* load syntax */
-	tmpxml = ast_xmldoc_build_syntax("function", acf->name, ast_module_name(acf->mod));
-	ast_string_field_set(acf, syntax, tmpxml);
-	ast_free(tmpxml);
-
-	/* load arguments */
-	tmpxml = ast_xmldoc_build_arguments("function", acf->name, ast_module_name(acf->mod));
-	ast_string_field_set(acf, arguments, tmpxml);
-	ast_free(tmpxml);
-
-	/* load seealso */
-	tmpxml = ast_xmldoc_build_seealso("function", acf->name, ast_module_name(acf->mod));
-	ast_string_field_set(acf, seealso, tmpxml);
-	ast_free(tmpxml);
+	if (ast_xmldoc_lazy()) {
+		acf->docs_pending = 1;
+	} else {
+		acf_build_docs(acf);
+	}
 
 	acf->docsrc = AST_XML_DOC;
 #endif
@@ -65,6 +65,25 @@ struct ast_switch *pbx_findswitch(const char *sw);
 /*! pbx_app.c functions needed by pbx.c */
 const char *app_name(struct ast_app *app);
 
+/*! pbx_variables.c functions needed by pbx.c */
+struct pbx_subst_template;
+
+/*!
+ * \brief Split a string into the parts variable substitution needs.
+ *
+ * \param templ String with ${variable} and $[expression] substitutions.
+ *
+ * \return ao2 object to pass to pbx_subst_template_substitute().
+ * \retval NULL if templ has nothing to substitute or cannot be split.
+ * Use pbx_substitute_variables_helper() on templ then.
+ */
+struct pbx_subst_template *pbx_subst_template_alloc(const char *templ);
+
+/*!
+ * \brief Substitute variables into cp2, same as pbx_substitute_variables_helper().
+ */
+void pbx_subst_template_substitute(struct ast_channel *c, struct pbx_subst_template *tmpl, char *cp2, int count);
+
 #define VAR_BUF_SIZE 4096
 
 #endif /* _PBX_PRIVATE_H */
@@ -255,6 +255,7 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 	const char *s;	/* the result */
 	int offset, length;
 	int i, need_substring;
+	unsigned int hash;
 	struct varshead *places[2] = { headp, &globals };	/* list of places where we may look */
 	char workspace[20];
 
@@ -357,6 +358,7 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 		}
 	}
 	/* if not found, look into chanvars or global vars */
+	hash = ast_var_hash(var);
 	for (i = 0; s == &not_found && i < ARRAY_LEN(places); i++) {
 		struct ast_var_t *variables;
 		if (!places[i])
@@ -364,7 +366,7 @@ const char *ast_str_retrieve_variable(struct ast_str **str, ssize_t maxlen, stru
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
 		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(ast_var_name(variables), var)) {
+			if (variables->hash == hash && !strcmp(ast_var_name(variables), var)) {
 				s = ast_var_value(variables);
 				break;
 			}
@@ -584,6 +586,58 @@ void ast_str_substitute_variables_varshead(struct ast_str **buf, ssize_t maxlen,
 	ast_str_substitute_variables_full(buf, maxlen, NULL, headp, templ, &used);
 }
 
+/*!
+ * \internal
+ * \brief Get the value of a variable or function being substituted.
+ *
+ * \param c Channel to get the value from.  (May be NULL)
+ * \param headp Variables to get the value from if there is no channel.
+ * \param name Variable name or function call, without the offset:length part.
+ * \param offset Offset of the substitution.
+ * \param length Length of the substitution.
+ * \param isfunction Non-zero if name is a function call.
+ * \param workspace Buffer of VAR_BUF_SIZE bytes to build the value in.
+ *
+ * \return The value to substitute.
+ * \retval NULL if there is none.
+ */
+static char *substitute_variable(struct ast_channel *c, struct varshead *headp,
+	const char *name, int offset, int length, int isfunction, char *workspace)
+{
+	char *cp4 = NULL;
+
+	workspace[0] = '\0';
+
+	if (isfunction) {
+		/* Evaluate function */
+		if (c || !headp)
+			cp4 = ast_func_read(c, name, workspace, VAR_BUF_SIZE) ? NULL : workspace;
+		else {
+			struct varshead old;
+			struct ast_channel *c = ast_dummy_channel_alloc();
+			if (c) {
+				memcpy(&old, ast_channel_varshead(c), sizeof(old));
+				memcpy(ast_channel_varshead(c), headp, sizeof(*ast_channel_varshead(c)));
+				cp4 = ast_func_read(c, name, workspace, VAR_BUF_SIZE) ? NULL : workspace;
+				/* Don't deallocate the varshead that was passed in */
+				memcpy(ast_channel_varshead(c), &old, sizeof(*ast_channel_varshead(c)));
+				c = ast_channel_unref(c);
+			} else {
+				ast_log(LOG_ERROR, "Unable to allocate bogus channel for variable substitution.  Function results may be blank.\n");
+			}
+		}
+		ast_debug(2, "Function %s result is '%s'\n", name, cp4 ? cp4 : "(null)");
+	} else {
+		/* Retrieve variable value */
+		pbx_retrieve_variable(c, name, &cp4, workspace, VAR_BUF_SIZE, headp);
+	}
+	if (cp4) {
+		cp4 = substring(cp4, offset, length, workspace, VAR_BUF_SIZE);
+	}
+
+	return cp4;
+}
+
 void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead *headp, const char *cp1, char *cp2, int count, size_t *used)
 {
 	/* Substitutes variables into cp2, based on string cp1, cp2 NO LONGER NEEDS TO BE ZEROED OUT!!!!  */
@@ -682,35 +736,9 @@ void pbx_substitute_variables_helper_full(struct ast_channel *c, struct varshead
 			if (!workspace)
 				workspace = ast_alloca(VAR_BUF_SIZE);
 
-			workspace[0] = '\0';
-
 			parse_variable_name(vars, &offset, &offset2, &isfunction);
-			if (isfunction) {
-				/* Evaluate function */
-				if (c || !headp)
-					cp4 = ast_func_read(c, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
-				else {
-					struct varshead old;
-					struct ast_channel *c = ast_dummy_channel_alloc();
-					if (c) {
-						memcpy(&old, ast_channel_varshead(c), sizeof(old));
-						memcpy(ast_channel_varshead(c), headp, sizeof(*ast_channel_varshead(c)));
-						cp4 = ast_func_read(c, vars, workspace, VAR_BUF_SIZE) ? NULL : workspace;
-						/* Don't deallocate the varshead that was passed in */
-						memcpy(ast_channel_varshead(c), &old, sizeof(*ast_channel_varshead(c)));
-						c = ast_channel_unref(c);
-					} else {
-						ast_log(LOG_ERROR, "Unable to allocate bogus channel for variable substitution.  Function results may be blank.\n");
-					}
-				}
-				ast_debug(2, "Function %s result is '%s'\n", vars, cp4 ? cp4 : "(null)");
-			} else {
-				/* Retrieve variable value */
-				pbx_retrieve_variable(c, vars, &cp4, workspace, VAR_BUF_SIZE, headp);
-			}
+			cp4 = substitute_variable(c, headp, vars, offset, offset2, isfunction, workspace);
 			if (cp4) {
-				cp4 = substring(cp4, offset, offset2, workspace, VAR_BUF_SIZE);
-
 				length = strlen(cp4);
 				if (length > count)
 					length = count;
@@ -794,6 +822,303 @@ void pbx_substitute_variables_varshead(struct varshead *headp, const char *cp1,
 	pbx_substitute_variables_helper_full(NULL, headp, cp1, cp2, count, &used);
 }
 
+/*! \brief What a substitution template segment substitutes after its literal text */
+enum subst_segment_type {
+	/*! Nothing, only the literal text */
+	SUBST_SEGMENT_LITERAL,
+	/*! A ${variable} or ${FUNCTION()} */
+	SUBST_SEGMENT_VARIABLE,
+	/*! A $[expression] */
+	SUBST_SEGMENT_EXPRESSION,
+};
+
+/*! \brief Literal text followed by a substitution, as found in a template */
+struct subst_segment {
+	/*! Literal text to copy first (not terminated) */
+	const char *literal;
+	/*! Length of the literal text */
+	size_t literal_len;
+	/*!
+	 * Length of the tail of the literal text that
+	 * pbx_substitute_variables_helper_full() copies in the same pass as
+	 * the substitution.  The substitution is only made if there is room
+	 * left before it.
+	 */
+	size_t lead;
+	enum subst_segment_type type;
+	/*! Variable name (without offset:length) or expression */
+	char *text;
+	/*! The text as a template if it itself has substitutions, else NULL */
+	struct pbx_subst_template *sub;
+	/*! Substring offset of a variable without nested substitutions */
+	int offset;
+	/*! Substring length of a variable without nested substitutions */
+	int length;
+	/*! Whether a variable without nested substitutions is a function call */
+	int isfunction;
+};
+
+struct pbx_subst_template {
+	/*! Number of segments */
+	size_t count;
+	/*! Copy of the template string, which the segments point into */
+	char *str;
+	struct subst_segment segments[0];
+};
+
+static void subst_template_destroy(void *obj)
+{
+	struct pbx_subst_template *tmpl = obj;
+	size_t idx;
+
+	for (idx = 0; idx < tmpl->count; idx++) {
+		ao2_cleanup(tmpl->segments[idx].sub);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Split a template string the way pbx_substitute_variables_helper_full() does.
+ *
+ * \param templ Template string.
+ * \param res Where to put the template.  Left NULL if templ cannot be
+ * split or has nothing to substitute.
+ *
+ * \retval 0 on success.
+ * \retval -1 if templ has an unterminated or overly long substitution or
+ * on allocation failure.
+ */
+static int subst_template_split(const char *templ, struct pbx_subst_template **res)
+{
+	struct pbx_subst_template *tmpl;
+	size_t templ_len = strlen(templ);
+	size_t max_segments = 1;
+	const char *whereweare;
+	const char *literal;
+	struct subst_segment *segment;
+	size_t substitutions = 0;
+
+	*res = NULL;
+
+	for (whereweare = templ; (whereweare = strchr(whereweare, '$')); whereweare++) {
+		max_segments++;
+	}
+
+	tmpl = ao2_alloc_options(sizeof(*tmpl) + max_segments * sizeof(tmpl->segments[0]) + templ_len + 1,
+		subst_template_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!tmpl) {
+		return -1;
+	}
+	tmpl->str = (char *) &tmpl->segments[max_segments];
+	memcpy(tmpl->str, templ, templ_len + 1);
+
+	literal = whereweare = tmpl->str;
+	while (*whereweare) {
+		const char *nextthing = strchr(whereweare, '$');
+		enum subst_segment_type type = SUBST_SEGMENT_LITERAL;
+		size_t pos = strlen(whereweare);
+		char *vars, *vare;
+		int brackets = 1, needsub = 0;
+		size_t len;
+
+		if (nextthing) {
+			switch (nextthing[1]) {
+			case '{':
+				type = SUBST_SEGMENT_VARIABLE;
+				pos = nextthing - whereweare;
+				break;
+			case '[':
+				type = SUBST_SEGMENT_EXPRESSION;
+				pos = nextthing - whereweare;
+				break;
+			default:
+				pos = 1;
+			}
+		}
+		whereweare += pos;
+		if (type == SUBST_SEGMENT_LITERAL) {
+			continue;
+		}
+
+		/* Find the end of it, exactly as pbx_substitute_variables_helper_full() does */
+		vars = vare = (char *) nextthing + 2;
+		if (type == SUBST_SEGMENT_VARIABLE) {
+			while (brackets && *vare) {
+				if ((vare[0] == '$') && (vare[1] == '{')) {
+					needsub++;
+				} else if (vare[0] == '{') {
+					brackets++;
+				} else if (vare[0] == '}') {
+					brackets--;
+				} else if ((vare[0] == '$') && (vare[1] == '['))
+					needsub++;
+				vare++;
+			}
+		} else {
+			while (brackets && *vare) {
+				if ((vare[0] == '$') && (vare[1] == '[')) {
+					needsub++;
+					brackets++;
+					vare++;
+				} else if (vare[0] == '[') {
+					brackets++;
+				} else if (vare[0] == ']') {
+					brackets--;
+				} else if ((vare[0] == '$') && (vare[1] == '{')) {
+					needsub++;
+					vare++;
+				}
+				vare++;
+			}
+		}
+		len = vare - vars - 1;
+		if (brackets || len >= VAR_BUF_SIZE) {
+			/* Leave the warnings and truncation to pbx_substitute_variables_helper_full() */
+			ao2_ref(tmpl, -1);
+			return -1;
+		}
+
+		segment = &tmpl->segments[tmpl->count++];
+		segment->literal = literal;
+		segment->literal_len = whereweare - literal;
+		segment->lead = pos;
+		segment->type = type;
+		segment->text = vars;
+		vars[len] = '\0';
+		whereweare = literal = vare;
+
+		if (needsub) {
+			if (subst_template_split(segment->text, &segment->sub) || !segment->sub) {
+				ao2_ref(tmpl, -1);
+				return -1;
+			}
+		} else if (type == SUBST_SEGMENT_VARIABLE) {
+			parse_variable_name(segment->text, &segment->offset, &segment->length,
+				&segment->isfunction);
+		}
+		substitutions++;
+	}
+
+	if (!substitutions) {
+		ao2_ref(tmpl, -1);
+		return 0;
+	}
+
+	if (*literal) {
+		segment = &tmpl->segments[tmpl->count++];
+		segment->literal = literal;
+		segment->literal_len = strlen(literal);
+		segment->type = SUBST_SEGMENT_LITERAL;
+	}
+
+	*res = tmpl;
+	return 0;
+}
+
+struct pbx_subst_template *pbx_subst_template_alloc(const char *templ)
+{
+	struct pbx_subst_template *tmpl;
+	const char *tmp;
+
+	if (ast_strlen_zero(templ)
+		|| !(tmp = strchr(templ, '$'))
+		|| (!strstr(tmp, "${") && !strstr(tmp, "$["))) {
+		return NULL;
+	}
+
+	subst_template_split(templ, &tmpl);
+	return tmpl;
+}
+
+/*!
+ * \internal
+ * \brief Copy up to count bytes of text to the end of a substitution.
+ */
+static void subst_template_copy(const char *text, size_t len, char **cp2, int *count)
+{
+	if (len > (size_t) *count) {
+		len = *count;
+	}
+	memcpy(*cp2, text, len);
+	*count -= len;
+	*cp2 += len;
+	**cp2 = '\0';
+}
+
+static void subst_template_substitute(struct ast_channel *c, struct varshead *headp,
+	struct pbx_subst_template *tmpl, char *cp2, int count, size_t *used)
+{
+	const char *orig_cp2 = cp2;
+	char *workspace = NULL;
+	char *ltmp = NULL;
+	char *cp4;
+	size_t idx;
+
+	*cp2 = '\0';
+	for (idx = 0; idx < tmpl->count && count; idx++) {
+		struct subst_segment *segment = &tmpl->segments[idx];
+		char *text = segment->text;
+		int offset, length, isfunction;
+
+		if (segment->type == SUBST_SEGMENT_LITERAL) {
+			subst_template_copy(segment->literal, segment->literal_len, &cp2, &count);
+			break;
+		}
+
+		if (segment->literal_len > segment->lead) {
+			subst_template_copy(segment->literal, segment->literal_len - segment->lead, &cp2, &count);
+			if (!count) {
+				break;
+			}
+		}
+		subst_template_copy(segment->literal + segment->literal_len - segment->lead,
+			segment->lead, &cp2, &count);
+
+		if (segment->sub) {
+			size_t my_used;
+
+			if (!ltmp) {
+				ltmp = ast_alloca(VAR_BUF_SIZE);
+			}
+			subst_template_substitute(c, headp, segment->sub, ltmp, VAR_BUF_SIZE - 1, &my_used);
+			text = ltmp;
+		}
+
+		if (segment->type == SUBST_SEGMENT_EXPRESSION) {
+			length = ast_expr(text, cp2, count, c);
+			if (length) {
+				ast_debug(1, "Expression result is '%s'\n", cp2);
+				count -= length;
+				cp2 += length;
+				*cp2 = '\0';
+			}
+			continue;
+		}
+
+		if (segment->sub) {
+			parse_variable_name(text, &offset, &length, &isfunction);
+		} else {
+			offset = segment->offset;
+			length = segment->length;
+			isfunction = segment->isfunction;
+		}
+		if (!workspace) {
+			workspace = ast_alloca(VAR_BUF_SIZE);
+		}
+		cp4 = substitute_variable(c, headp, text, offset, length, isfunction, workspace);
+		if (cp4) {
+			subst_template_copy(cp4, strlen(cp4), &cp2, &count);
+		}
+	}
+	*used = cp2 - orig_cp2;
+}
+
+void pbx_subst_template_substitute(struct ast_channel *c, struct pbx_subst_template *tmpl, char *cp2, int count)
+{
+	size_t used;
+	subst_template_substitute(c, (c) ? ast_channel_varshead(c) : NULL, tmpl, cp2, count, &used);
+}
+
 /*! \brief CLI support for listing global variables in a parseable way */
 static char *handle_show_globals(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
@@ -954,10 +1279,12 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 	struct ast_var_t *variables;
 	const char *ret = NULL;
 	int i;
+	unsigned int hash;
 	struct varshead *places[2] = { NULL, &globals };
 
 	if (!name)
 		return NULL;
+	hash = ast_var_hash(name);
 
 	if (chan) {
 		ast_channel_lock(chan);
@@ -970,7 +1297,7 @@ const char *pbx_builtin_getvar_helper(struct ast_channel *chan, const char *name
 		if (places[i] == &globals)
 			ast_rwlock_rdlock(&globalslock);
 		AST_LIST_TRAVERSE(places[i], variables, entries) {
-			if (!strcmp(name, ast_var_name(variables))) {
+			if (variables->hash == hash && !strcmp(name, ast_var_name(variables))) {
 				ret = ast_var_value(variables);
 				break;
 			}
@@ -1012,6 +1339,9 @@ void pbx_builtin_pushvar_helper(struct ast_channel *chan, const char *name, cons
 		if (headp == &globals)
 			ast_verb(2, "Setting global variable '%s' to '%s'\n", name, value);
 		AST_LIST_INSERT_HEAD(headp, newvariable, entries);
+		if (chan && !strcmp(ast_var_name(newvariable), "SPYGROUP")) {
+			ast_channel_spygroup_index_update(chan);
+		}
 	}
 
 	if (chan)
@@ -1025,6 +1355,7 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 	struct ast_var_t *newvariable;
 	struct varshead *headp;
 	const char *nametail = name;
+	unsigned int hash;
 	/*! True if the old value was not an empty string. */
 	int old_value_existed = 0;
 
@@ -1049,8 +1380,9 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 			nametail++;
 	}
 
+	hash = ast_var_hash(nametail);
 	AST_LIST_TRAVERSE_SAFE_BEGIN(headp, newvariable, entries) {
-		if (strcmp(ast_var_name(newvariable), nametail) == 0) {
+		if (newvariable->hash == hash && strcmp(ast_var_name(newvariable), nametail) == 0) {
 			/* there is already such a variable, delete it */
 			AST_LIST_REMOVE_CURRENT(entries);
 			old_value_existed = !ast_strlen_zero(ast_var_value(newvariable));
@@ -1070,6 +1402,9 @@ int pbx_builtin_setvar_helper(struct ast_channel *chan, const char *name, const
 		/* We just deleted a non-empty dialplan variable. */
 		ast_channel_publish_varset(chan, name, "");
 	}
+	if (chan && !strcmp(nametail, "SPYGROUP")) {
+		ast_channel_spygroup_index_update(chan);
+	}
 
 	if (chan)
 		ast_channel_unlock(chan);
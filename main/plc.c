@@ -39,6 +39,17 @@
 #include <math.h>
 
 #include "asterisk/plc.h"
+#include "asterisk/utils.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PLC_HAVE_X86 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PLC_HAVE_NEON 1
+#include <arm_neon.h>
+#endif
 
 #if !defined(FALSE)
 #define FALSE 0
@@ -103,20 +114,136 @@ static void normalise_history(plc_state_t *s)
 
 /*- End of function --------------------------------------------------------*/
 
+/*
+ * AMDF kernels.
+ *
+ * Each kernel returns the sum of the absolute differences between the len
+ * samples at amp and the len samples at amp + lag.  The difference of two
+ * 16 bit samples always fits in 16 bits unsigned, and the sum in an int, so
+ * every kernel gives exactly the same result as the scalar one.
+ */
+struct amdf_kernel {
+	const char *name;
+	int (*supported)(void);
+	int (*amdf)(const int16_t amp[], int lag, int len);
+};
+
+static int scalar_supported(void)
+{
+	return 1;
+}
+
+static int scalar_amdf(const int16_t amp[], int lag, int len)
+{
+	int acc = 0;
+	int j;
+
+	for (j = 0; j < len; j++)
+		acc += abs(amp[lag + j] - amp[j]);
+	return acc;
+}
+
+#ifdef PLC_HAVE_X86
+static int sse2_supported(void)
+{
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("sse2");
+}
+
+static int __attribute__((target("sse2"))) sse2_amdf(const int16_t amp[], int lag, int len)
+{
+	__m128i zero = _mm_setzero_si128();
+	__m128i sum = _mm_setzero_si128();
+	__m128i a;
+	__m128i b;
+	__m128i diff;
+	int acc;
+	int j;
+
+	for (j = 0; j + 8 <= len; j += 8) {
+		a = _mm_loadu_si128((const __m128i *) &amp[j]);
+		b = _mm_loadu_si128((const __m128i *) &amp[lag + j]);
+		/* max - min is the absolute difference, as 16 bits unsigned */
+		diff = _mm_sub_epi16(_mm_max_epi16(a, b), _mm_min_epi16(a, b));
+		sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(diff, zero));
+		sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(diff, zero));
+	}
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+	sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+	acc = _mm_cvtsi128_si32(sum);
+
+	return acc + scalar_amdf(amp + j, lag, len - j);
+}
+#endif /* PLC_HAVE_X86 */
+
+#ifdef PLC_HAVE_NEON
+/* NEON is part of the baseline when the compiler was told to use it. */
+static int neon_supported(void)
+{
+	return 1;
+}
+
+static int neon_amdf(const int16_t amp[], int lag, int len)
+{
+	int32x4_t sum = vdupq_n_s32(0);
+	int16x8_t a;
+	int16x8_t b;
+	int32x2_t half;
+	int j;
+
+	for (j = 0; j + 8 <= len; j += 8) {
+		a = vld1q_s16(&amp[j]);
+		b = vld1q_s16(&amp[lag + j]);
+		sum = vabal_s16(sum, vget_low_s16(a), vget_low_s16(b));
+		sum = vabal_s16(sum, vget_high_s16(a), vget_high_s16(b));
+	}
+	half = vadd_s32(vget_low_s32(sum), vget_high_s32(sum));
+
+	return vget_lane_s32(vpadd_s32(half, half), 0) + scalar_amdf(amp + j, lag, len - j);
+}
+#endif /* PLC_HAVE_NEON */
+
+/*! \brief Compiled in kernels, from least to most preferred */
+static const struct amdf_kernel kernels[] = {
+	{ "scalar", scalar_supported, scalar_amdf },
+#ifdef PLC_HAVE_X86
+	{ "sse2", sse2_supported, sse2_amdf },
+#endif
+#ifdef PLC_HAVE_NEON
+	{ "neon", neon_supported, neon_amdf },
+#endif
+};
+
+static const struct amdf_kernel *amdf_kernel = &kernels[0];
+
+static pthread_once_t amdf_kernel_once = PTHREAD_ONCE_INIT;
+
+static void amdf_kernel_init(void)
+{
+	int i;
+
+	for (i = ARRAY_LEN(kernels) - 1; i > 0; i--) {
+		if (kernels[i].supported()) {
+			break;
+		}
+	}
+	amdf_kernel = &kernels[i];
+}
+
 static int __inline__ amdf_pitch(int min_pitch, int max_pitch, int16_t amp[], int len)
 {
 	int i;
-	int j;
 	int acc;
 	int min_acc;
 	int pitch;
 
+	/* Only run when a gap starts, so the kernel is picked on first use */
+	pthread_once(&amdf_kernel_once, amdf_kernel_init);
+
 	pitch = min_pitch;
 	min_acc = INT_MAX;
 	for (i = max_pitch; i <= min_pitch; i++) {
-		acc = 0;
-		for (j = 0; j < len; j++)
-			acc += abs(amp[i + j] - amp[j]);
+		acc = amdf_kernel->amdf(amp, i, len);
 		if (acc < min_acc) {
 			min_acc = acc;
 			pitch = i;
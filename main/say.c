@@ -54,9 +54,191 @@
 #include "asterisk/utils.h"
 #include "asterisk/app.h"
 #include "asterisk/test.h"
+#include "asterisk/threadstorage.h"
 
 /* Forward declaration */
 static int wait_file(struct ast_channel *chan, const char *ints, const char *file, const char *lang);
+static int say_number_full(struct ast_channel *chan, int num, const char *ints, const char *language, const char *options, int audiofd, int ctrlfd);
+
+/*!
+ * \brief Prompts collected by the calling thread, separated by '&'
+ *
+ * Say functions that know all their prompts up front collect them between
+ * say_collect_begin() and say_collect_end(), and the outermost one plays
+ * them as one stream.  Anything that plays prompts itself while they are
+ * being collected has to say_collect_play() what is collected first.
+ */
+AST_THREADSTORAGE(say_collect_files);
+/*! \brief Nesting of say functions collecting prompts in the calling thread */
+AST_THREADSTORAGE(say_collect_depth);
+
+/*!
+ * \internal
+ * \brief Start collecting prompts, or nest in the collection running.
+ */
+static void say_collect_begin(void)
+{
+	unsigned int *depth = ast_threadstorage_get(&say_collect_depth, sizeof(*depth));
+	struct ast_str *files;
+
+	if (!depth) {
+		return;
+	}
+	if (!*depth) {
+		if (!(files = ast_str_thread_get(&say_collect_files, 256))) {
+			return;
+		}
+		ast_str_reset(files);
+	}
+	++*depth;
+}
+
+/*!
+ * \internal
+ * \brief Add a prompt to the collection.
+ *
+ * \retval 0 if it was added.
+ * \retval -1 if prompts are not being collected, so it has to be played.
+ */
+static int say_collect_add(const char *file)
+{
+	unsigned int *depth = ast_threadstorage_get(&say_collect_depth, sizeof(*depth));
+	struct ast_str *files;
+
+	if (!depth || !*depth || !(files = ast_str_thread_get(&say_collect_files, 256))) {
+		return -1;
+	}
+
+	return ast_str_append(&files, 0, "%s%s", ast_str_strlen(files) ? "&" : "", file) < 0 ? -1 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Play the prompts collected so far.
+ *
+ * The prompts are played as one stream if they are all available in one
+ * format, else one after another.
+ */
+static int say_collect_play(struct ast_channel *chan, const char *ints, const char *lang, int audiofd, int ctrlfd)
+{
+	struct ast_str *files = ast_str_thread_get(&say_collect_files, 256);
+	char *list;
+	char *file;
+	int res = 0;
+
+	if (!files || !ast_str_strlen(files)) {
+		return 0;
+	}
+	list = ast_strdupa(ast_str_buffer(files));
+	ast_str_reset(files);
+
+	if (!ast_streamfile_list(chan, list, lang)) {
+		if ((audiofd > -1) && (ctrlfd > -1))
+			res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+		else
+			res = ast_waitstream(chan, ints);
+		ast_stopstream(chan);
+		return res;
+	}
+
+	while (!res && (file = strsep(&list, "&"))) {
+		if (!ast_streamfile(chan, file, lang)) {
+			if ((audiofd > -1) && (ctrlfd > -1))
+				res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+			else
+				res = ast_waitstream(chan, ints);
+		}
+		ast_stopstream(chan);
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Stop collecting prompts, playing them if this is the outermost collection.
+ *
+ * \param res The result of the say function so far, nothing is played if it is not 0
+ */
+static int say_collect_end(struct ast_channel *chan, const char *ints, const char *lang, int audiofd, int ctrlfd, int res)
+{
+	unsigned int *depth = ast_threadstorage_get(&say_collect_depth, sizeof(*depth));
+	struct ast_str *files;
+
+	if (!depth || !*depth || --*depth) {
+		return res;
+	}
+
+	if (res) {
+		if ((files = ast_str_thread_get(&say_collect_files, 256))) {
+			ast_str_reset(files);
+		}
+		return res;
+	}
+
+	return say_collect_play(chan, ints, lang, audiofd, ctrlfd);
+}
+
+/*!
+ * \internal
+ * \brief Play a prompt, or collect it if prompts are being collected.
+ */
+static int say_file(struct ast_channel *chan, const char *file, const char *ints, const char *lang, int audiofd, int ctrlfd)
+{
+	int res = 0;
+
+	if (!say_collect_add(file)) {
+		return 0;
+	}
+
+	if (!ast_streamfile(chan, file, lang)) {
+		if ((audiofd > -1) && (ctrlfd > -1))
+			res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
+		else
+			res = ast_waitstream(chan, ints);
+	}
+	ast_stopstream(chan);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Say a number while prompts are being collected.
+ *
+ * Numbers in the English syntax of this file are collected too.  Any other
+ * number is said once the prompts collected so far have been played.
+ */
+static int say_collect_number(struct ast_channel *chan, int num, const char *ints, const char *lang, const char *options)
+{
+	int res;
+
+	if (ast_say_number_full == say_number_full
+		&& !strncasecmp(lang, "en", 2) && strncasecmp(lang, "en_GB", 5)) {
+		return say_number_full(chan, num, ints, lang, options, -1, -1);
+	}
+
+	if ((res = say_collect_play(chan, ints, lang, -1, -1))) {
+		return res;
+	}
+	return ast_say_number(chan, num, ints, lang, options);
+}
+
+/*!
+ * \internal
+ * \brief Say an enumeration while prompts are being collected.
+ *
+ * Enumerations are said once the prompts collected so far have been played.
+ */
+static int say_collect_enumeration(struct ast_channel *chan, int num, const char *ints, const char *lang, const char *options)
+{
+	int res;
+
+	if ((res = say_collect_play(chan, ints, lang, -1, -1))) {
+		return res;
+	}
+	return ast_say_enumeration(chan, num, ints, lang, options);
+}
 
 
 static int say_character_str_full(struct ast_channel *chan, const char *str, const char *ints, const char *lang, enum ast_say_case_sensitivity sensitivity, int audiofd, int ctrlfd)
@@ -259,6 +441,7 @@ static int say_digit_str_full(struct ast_channel *chan, const char *str, const c
 	int num = 0;
 	int res = 0;
 
+	say_collect_begin();
 	while (str[num] && !res) {
 		fn = NULL;
 		switch (str[num]) {
@@ -287,19 +470,12 @@ static int say_digit_str_full(struct ast_channel *chan, const char *str, const c
 			break;
 		}
 		if (fn && ast_fileexists(fn, NULL, lang) > 0) {
-			res = ast_streamfile(chan, fn, lang);
-			if (!res) {
-				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
-				else
-					res = ast_waitstream(chan, ints);
-			}
-			ast_stopstream(chan);
+			res = say_file(chan, fn, ints, lang, audiofd, ctrlfd);
 		}
 		num++;
 	}
 
-	return res;
+	return say_collect_end(chan, ints, lang, audiofd, ctrlfd, res);
 }
 
 /* Forward declarations */
@@ -466,6 +642,9 @@ static int ast_say_datetime_from_now_he(struct ast_channel *chan, time_t t, cons
 static int wait_file(struct ast_channel *chan, const char *ints, const char *file, const char *lang)
 {
 	int res;
+	if (!say_collect_add(file)) {
+		return 0;
+	}
 	if ((res = ast_streamfile(chan, file, lang))) {
 		ast_log(LOG_WARNING, "Unable to play message %s\n", file);
 	}
@@ -568,6 +747,7 @@ static int ast_say_number_full_en(struct ast_channel *chan, int num, const char
 	if (!num)
 		return ast_say_digits_full(chan, 0, ints, language, audiofd, ctrlfd);
 
+	say_collect_begin();
 	while (!res && (num || playh)) {
 		if (num < 0) {
 			ast_copy_string(fn, "digits/minus", sizeof(fn));
@@ -594,14 +774,14 @@ static int ast_say_number_full_en(struct ast_channel *chan, int num, const char
 				if (num < 1000000) { /* 1,000,000 */
 					res = ast_say_number_full_en(chan, num / 1000, ints, language, audiofd, ctrlfd);
 					if (res)
-						return res;
+						break;
 					num %= 1000;
 					snprintf(fn, sizeof(fn), "digits/thousand");
 				} else {
 					if (num < 1000000000) {	/* 1,000,000,000 */
 						res = ast_say_number_full_en(chan, num / 1000000, ints, language, audiofd, ctrlfd);
 						if (res)
-							return res;
+							break;
 						num %= 1000000;
 						ast_copy_string(fn, "digits/million", sizeof(fn));
 					} else {
@@ -612,16 +792,10 @@ static int ast_say_number_full_en(struct ast_channel *chan, int num, const char
 			}
 		}
 		if (!res) {
-			if (!ast_streamfile(chan, fn, language)) {
-				if ((audiofd  > -1) && (ctrlfd > -1))
-					res = ast_waitstream_full(chan, ints, audiofd, ctrlfd);
-				else
-					res = ast_waitstream(chan, ints);
-			}
-			ast_stopstream(chan);
+			res = say_file(chan, fn, ints, language, audiofd, ctrlfd);
 		}
 	}
-	return res;
+	return say_collect_end(chan, ints, language, audiofd, ctrlfd, res);
 }
 
 static int exp10_int(int power)
@@ -4104,6 +4278,7 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 
 	ast_localtime(&when, &tm, tzone);
 
+	say_collect_begin();
 	for (offset=0 ; format[offset] != '\0' ; offset++) {
 		ast_debug(1, "Parsing %c (offset %d) in %s\n", format[offset], offset, format);
 		switch (format[offset]) {
@@ -4131,17 +4306,17 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 				break;
 			case 'm':
 				/* Month enumerated */
-				res = ast_say_enumeration(chan, (tm.tm_mon + 1), ints, lang, (char *) NULL);
+				res = say_collect_enumeration(chan, (tm.tm_mon + 1), ints, lang, (char *) NULL);
 				break;
 			case 'd':
 			case 'e':
 				/* First - Thirtyfirst */
-				res = ast_say_enumeration(chan, tm.tm_mday, ints, lang, (char *) NULL);
+				res = say_collect_enumeration(chan, tm.tm_mday, ints, lang, (char *) NULL);
 				break;
 			case 'Y':
 				/* Year */
 				if (tm.tm_year > 99) {
-					res = ast_say_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
+					res = say_collect_number(chan, tm.tm_year + 1900, ints, lang, (char *) NULL);
 				} else if (tm.tm_year < 1) {
 					/* I'm not going to handle 1900 and prior */
 					/* We'll just be silent on the year, instead of bombing out. */
@@ -4153,7 +4328,7 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 							res = wait_file(chan, ints, "digits/oh", lang);
 						}
 
-						res |= ast_say_number(chan, tm.tm_year, ints, lang, (char *) NULL);
+						res |= say_collect_number(chan, tm.tm_year, ints, lang, (char *) NULL);
 					}
 				}
 				break;
@@ -4212,7 +4387,7 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 						res = wait_file(chan, ints, nextmsg, lang);
 					}
 				} else {
-					res = ast_say_number(chan, tm.tm_min, ints, lang, (char *) NULL);
+					res = say_collect_number(chan, tm.tm_min, ints, lang, (char *) NULL);
 				}
 				break;
 			case 'P':
@@ -4310,7 +4485,7 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 						res = wait_file(chan, ints, nextmsg, lang);
 					}
 				} else {
-					res = ast_say_number(chan, tm.tm_sec, ints, lang, (char *) NULL);
+					res = say_collect_number(chan, tm.tm_sec, ints, lang, (char *) NULL);
 				}
 				break;
 			case 'T':
@@ -4329,7 +4504,7 @@ int ast_say_date_with_format_en(struct ast_channel *chan, time_t t, const char *
 			break;
 		}
 	}
-	return res;
+	return say_collect_end(chan, ints, lang, -1, -1, res);
 }
 
 static char next_item(const char *format)
@@ -47,6 +47,7 @@
 #include "asterisk/utils.h"
 #include "asterisk/heap.h"
 #include "asterisk/threadstorage.h"
+#include "asterisk/dlinkedlists.h"
 
 /*!
  * \brief Max num of schedule structs
@@ -58,6 +59,15 @@
  */
 #define SCHED_MAX_CACHE 128
 
+/*! Levels of the timer wheel, each covering 256 times the span of the one below it */
+#define SCHED_WHEEL_LEVELS 4
+/*! Bits of the tick used to pick a slot on each level */
+#define SCHED_WHEEL_BITS 8
+/*! Slots on each level of the timer wheel */
+#define SCHED_WHEEL_SLOTS (1 << SCHED_WHEEL_BITS)
+/*! Furthest a task may be placed ahead of the wheel, about 49 days */
+#define SCHED_WHEEL_MAX_DELTA ((UINT64_C(1) << (SCHED_WHEEL_LEVELS * SCHED_WHEEL_BITS)) - 1)
+
 AST_THREADSTORAGE(last_del_id);
 
 /*!
@@ -76,6 +86,16 @@ struct sched_id {
 	AST_LIST_ENTRY(sched_id) list;
 };
 
+/*! \brief Where a scheduled task is waiting to run */
+enum sched_queue {
+	/*! Not queued: free, cached, or being run */
+	SCHED_QUEUE_NONE = 0,
+	/*! In the context's heap */
+	SCHED_QUEUE_HEAP,
+	/*! In a slot of the context's timer wheel */
+	SCHED_QUEUE_WHEEL,
+};
+
 struct sched {
 	AST_LIST_ENTRY(sched) list;
 	/*! The ID that has been popped off the scheduler context's queue */
@@ -94,6 +114,14 @@ struct sched {
 	const void *data;             /*!< Data */
 	ast_sched_cb callback;        /*!< Callback */
 	ssize_t __heap_index;
+	/*! Link to the other tasks in the same timer wheel slot */
+	AST_DLLIST_ENTRY(sched) wheel_list;
+	/*! Where the task is queued */
+	enum sched_queue queue;
+	/*! Timer wheel level the task is in */
+	unsigned char wheel_level;
+	/*! Timer wheel slot the task is in */
+	unsigned char wheel_slot;
 	/*!
 	 * Used to synchronize between thread running a task and thread
 	 * attempting to delete a task
@@ -103,6 +131,25 @@ struct sched {
 	unsigned int deleted:1;
 };
 
+/*!
+ * \brief Hierarchical timer wheel
+ *
+ * Ticks are milliseconds.  Level 0 has a slot for each of the next 256
+ * ticks, and every level above has a slot for each of the next 256 spans
+ * of the level below it.  When the wheel reaches the start of a span the
+ * tasks in that span's slot are moved down a level, and the tasks in the
+ * level 0 slot of each tick passed move to the context's heap, which then
+ * orders that small batch exactly as the heap backend would.
+ */
+struct sched_wheel {
+	/*! The last tick processed.  Tasks due at or before it are in the heap. */
+	uint64_t current;
+	/*! Number of tasks on each level */
+	unsigned int count[SCHED_WHEEL_LEVELS];
+	/*! The slots of each level */
+	AST_DLLIST_HEAD_NOLOCK(, sched) slots[SCHED_WHEEL_LEVELS][SCHED_WHEEL_SLOTS];
+};
+
 struct sched_thread {
 	pthread_t thread;
 	ast_cond_t cond;
@@ -116,6 +163,12 @@ struct ast_sched_context {
 	/*! Next tie breaker in case events expire at the same time. */
 	unsigned int tie_breaker;
 	struct ast_heap *sched_heap;
+	/*! Timer wheel holding tasks not yet due, NULL when the heap holds every task */
+	struct sched_wheel *wheel;
+	/*! Tasks indexed by ID, each entry non-NULL while its ID is assigned */
+	struct sched **tasks;
+	/*! Number of entries allocated in tasks */
+	int tasks_size;
 	struct sched_thread *sched_thread;
 	/*! The scheduled task that is currently executing */
 	struct sched *currently_executing;
@@ -234,7 +287,21 @@ static int sched_time_cmp(void *va, void *vb)
 	return cmp;
 }
 
-struct ast_sched_context *ast_sched_context_create(void)
+/*! \brief Key of a task on the heap, the soonest being the largest */
+static int64_t sched_time_key(void *obj)
+{
+	struct sched *s = obj;
+
+	return -((int64_t) s->when.tv_sec * 1000000 + s->when.tv_usec);
+}
+
+/*! \brief Convert a time to a timer wheel tick */
+static uint64_t sched_tick(struct timeval tv)
+{
+	return (uint64_t) tv.tv_sec * 1000 + tv.tv_usec / 1000;
+}
+
+struct ast_sched_context *ast_sched_context_create_backend(enum ast_sched_backend backend)
 {
 	struct ast_sched_context *tmp;
 
@@ -247,15 +314,28 @@ struct ast_sched_context *ast_sched_context_create(void)
 
 	AST_LIST_HEAD_INIT_NOLOCK(&tmp->id_queue);
 
-	if (!(tmp->sched_heap = ast_heap_create(8, sched_time_cmp,
+	if (!(tmp->sched_heap = ast_heap_create_keyed(8, sched_time_key, sched_time_cmp,
 			offsetof(struct sched, __heap_index)))) {
 		ast_sched_context_destroy(tmp);
 		return NULL;
 	}
 
+	if (backend == AST_SCHED_BACKEND_WHEEL) {
+		if (!(tmp->wheel = ast_calloc(1, sizeof(*tmp->wheel)))) {
+			ast_sched_context_destroy(tmp);
+			return NULL;
+		}
+		tmp->wheel->current = sched_tick(ast_tvnow());
+	}
+
 	return tmp;
 }
 
+struct ast_sched_context *ast_sched_context_create(void)
+{
+	return ast_sched_context_create_backend(AST_SCHED_BACKEND_HEAP);
+}
+
 static void sched_free(struct sched *task)
 {
 	/* task->sched_id will be NULL most of the time, but when the
@@ -291,6 +371,23 @@ void ast_sched_context_destroy(struct ast_sched_context *con)
 		con->sched_heap = NULL;
 	}
 
+	if (con->wheel) {
+		int level;
+		int slot;
+
+		for (level = 0; level < SCHED_WHEEL_LEVELS; level++) {
+			for (slot = 0; slot < SCHED_WHEEL_SLOTS; slot++) {
+				while ((s = AST_DLLIST_REMOVE_HEAD(&con->wheel->slots[level][slot], wheel_list))) {
+					sched_free(s);
+				}
+			}
+		}
+		ast_free(con->wheel);
+		con->wheel = NULL;
+	}
+
+	ast_free(con->tasks);
+
 	while ((sid = AST_LIST_REMOVE_HEAD(&con->id_queue, list))) {
 		ast_free(sid);
 	}
@@ -321,8 +418,25 @@ static int add_ids(struct ast_sched_context *con)
 	 */
 	new_size = original_size + ID_QUEUE_INCREMENT;
 	if (new_size < 0) {
-		/* Overflow. Cap it at INT_MAX. */
-		new_size = INT_MAX;
+		/* Overflow. Cap it at INT_MAX - 1 so the task table can be indexed by every ID. */
+		new_size = INT_MAX - 1;
+	}
+
+	/* Grow the task table first so every ID handed out has an entry in it. */
+	if (new_size >= con->tasks_size) {
+		struct sched **tasks;
+		int tasks_size = MAX(new_size + 1, con->tasks_size * 2);
+
+		if (tasks_size < 0) {
+			tasks_size = INT_MAX;
+		}
+		tasks = ast_realloc(con->tasks, tasks_size * sizeof(*tasks));
+		if (!tasks) {
+			return 0;
+		}
+		memset(tasks + con->tasks_size, 0, (tasks_size - con->tasks_size) * sizeof(*tasks));
+		con->tasks = tasks;
+		con->tasks_size = tasks_size;
 	}
 	for (i = original_size; i < new_size; ++i) {
 		struct sched_id *new_id;
@@ -353,12 +467,14 @@ static int set_sched_id(struct ast_sched_context *con, struct sched *new_sched)
 	}
 
 	new_sched->sched_id = AST_LIST_REMOVE_HEAD(&con->id_queue, list);
+	con->tasks[new_sched->sched_id->id] = new_sched;
 	return 0;
 }
 
 static void sched_release(struct ast_sched_context *con, struct sched *tmp)
 {
 	if (tmp->sched_id) {
+		con->tasks[tmp->sched_id->id] = NULL;
 		AST_LIST_INSERT_TAIL(&con->id_queue, tmp->sched_id, list);
 		tmp->sched_id = NULL;
 	}
@@ -405,19 +521,218 @@ static struct sched *sched_alloc(struct ast_sched_context *con)
 	return tmp;
 }
 
+/*!
+ * \internal
+ * \brief Put a task in the timer wheel slot for its tick, or the heap if it is due.
+ */
+static void wheel_insert(struct ast_sched_context *con, struct sched *s)
+{
+	struct sched_wheel *wheel = con->wheel;
+	uint64_t tick = sched_tick(s->when);
+	uint64_t delta;
+	int level;
+
+	if (tick <= wheel->current) {
+		s->queue = SCHED_QUEUE_HEAP;
+		ast_heap_push(con->sched_heap, s);
+		return;
+	}
+
+	delta = tick - wheel->current;
+	if (delta > SCHED_WHEEL_MAX_DELTA) {
+		/* Park it as far ahead as the wheel reaches, it moves back down from there. */
+		delta = SCHED_WHEEL_MAX_DELTA;
+		tick = wheel->current + delta;
+	}
+	for (level = 0; level < SCHED_WHEEL_LEVELS - 1; level++) {
+		if (delta < (UINT64_C(1) << ((level + 1) * SCHED_WHEEL_BITS))) {
+			break;
+		}
+	}
+
+	s->queue = SCHED_QUEUE_WHEEL;
+	s->wheel_level = level;
+	s->wheel_slot = (tick >> (level * SCHED_WHEEL_BITS)) & (SCHED_WHEEL_SLOTS - 1);
+	AST_DLLIST_INSERT_TAIL(&wheel->slots[level][s->wheel_slot], s, wheel_list);
+	wheel->count[level]++;
+}
+
+/*!
+ * \internal
+ * \brief Take a task out of the timer wheel.
+ */
+static void wheel_remove(struct ast_sched_context *con, struct sched *s)
+{
+	struct sched_wheel *wheel = con->wheel;
+
+	AST_DLLIST_REMOVE(&wheel->slots[s->wheel_level][s->wheel_slot], s, wheel_list);
+	wheel->count[s->wheel_level]--;
+	s->queue = SCHED_QUEUE_NONE;
+}
+
+/*!
+ * \internal
+ * \brief Move the tasks of the current span on a level down the wheel.
+ */
+static void wheel_cascade(struct ast_sched_context *con, int level)
+{
+	struct sched_wheel *wheel = con->wheel;
+	int slot = (wheel->current >> (level * SCHED_WHEEL_BITS)) & (SCHED_WHEEL_SLOTS - 1);
+	struct sched *s;
+
+	while ((s = AST_DLLIST_REMOVE_HEAD(&wheel->slots[level][slot], wheel_list))) {
+		wheel->count[level]--;
+		wheel_insert(con, s);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Turn the timer wheel up to a tick, moving every task due by then to the heap.
+ */
+static void wheel_advance(struct ast_sched_context *con, uint64_t target)
+{
+	struct sched_wheel *wheel = con->wheel;
+
+	while (wheel->current < target) {
+		int level;
+		int slot;
+		struct sched *s;
+
+		/* Skip straight to the next span holding anything. */
+		for (level = 0; level < SCHED_WHEEL_LEVELS && !wheel->count[level]; level++) {
+		}
+		if (level == SCHED_WHEEL_LEVELS) {
+			wheel->current = target;
+			break;
+		}
+		if (level) {
+			uint64_t last = wheel->current | ((UINT64_C(1) << (level * SCHED_WHEEL_BITS)) - 1);
+
+			if (last >= target) {
+				wheel->current = target;
+				break;
+			}
+			wheel->current = last;
+		}
+
+		wheel->current++;
+		for (level = 1; level < SCHED_WHEEL_LEVELS; level++) {
+			if (wheel->current & ((UINT64_C(1) << (level * SCHED_WHEEL_BITS)) - 1)) {
+				break;
+			}
+		}
+		/* Cascade from the highest level reaching a new span down. */
+		while (--level > 0) {
+			wheel_cascade(con, level);
+		}
+
+		slot = wheel->current & (SCHED_WHEEL_SLOTS - 1);
+		while ((s = AST_DLLIST_REMOVE_HEAD(&wheel->slots[0][slot], wheel_list))) {
+			wheel->count[0]--;
+			s->queue = SCHED_QUEUE_HEAP;
+			ast_heap_push(con->sched_heap, s);
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Find the earliest tick at which the timer wheel has work to do.
+ *
+ * \note For the upper levels this is the start of the span whose tasks are
+ * next moved down, which may be some time before any of them are due.
+ *
+ * \retval 0 if the wheel is empty
+ */
+static uint64_t wheel_next_tick(struct sched_wheel *wheel)
+{
+	uint64_t next = 0;
+	int level;
+
+	for (level = 0; level < SCHED_WHEEL_LEVELS; level++) {
+		int shift = level * SCHED_WHEEL_BITS;
+		uint64_t base = wheel->current >> shift;
+		int i;
+
+		if (!wheel->count[level]) {
+			continue;
+		}
+		for (i = 1; i <= SCHED_WHEEL_SLOTS; i++) {
+			if (!AST_DLLIST_EMPTY(&wheel->slots[level][(base + i) & (SCHED_WHEEL_SLOTS - 1)])) {
+				uint64_t tick = (base + i) << shift;
+
+				if (!next || tick < next) {
+					next = tick;
+				}
+				break;
+			}
+		}
+	}
+
+	return next;
+}
+
+/*! \brief Number of tasks waiting to run */
+static size_t sched_queued(struct ast_sched_context *con)
+{
+	size_t size = ast_heap_size(con->sched_heap);
+
+	if (con->wheel) {
+		int level;
+
+		for (level = 0; level < SCHED_WHEEL_LEVELS; level++) {
+			size += con->wheel->count[level];
+		}
+	}
+	return size;
+}
+
+/*!
+ * \internal
+ * \brief Take a queued task out of the queue.
+ */
+static void sched_dequeue(struct ast_sched_context *con, struct sched *s)
+{
+	if (s->queue == SCHED_QUEUE_WHEEL) {
+		wheel_remove(con, s);
+		return;
+	}
+	if (!ast_heap_remove(con->sched_heap, s)) {
+		ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
+	}
+	s->queue = SCHED_QUEUE_NONE;
+}
+
+/*!
+ * \internal
+ * \brief Find a queued task by ID.
+ */
+static struct sched *sched_find(struct ast_sched_context *con, int id)
+{
+	struct sched *s;
+
+	if (id <= 0 || id > con->id_queue_size) {
+		return NULL;
+	}
+	s = con->tasks[id];
+
+	return s && s->queue != SCHED_QUEUE_NONE ? s : NULL;
+}
+
 void ast_sched_clean_by_callback(struct ast_sched_context *con, ast_sched_cb match, ast_sched_cb cleanup_cb)
 {
-	int i = 1;
+	int i;
 	struct sched *current;
 
 	ast_mutex_lock(&con->lock);
-	while ((current = ast_heap_peek(con->sched_heap, i))) {
-		if (current->callback != match) {
-			i++;
+	for (i = 1; i <= con->id_queue_size; i++) {
+		current = sched_find(con, i);
+		if (!current || current->callback != match) {
 			continue;
 		}
 
-		ast_heap_remove(con->sched_heap, current);
+		sched_dequeue(con, current);
 
 		cleanup_cb(current->data);
 		sched_release(con, current);
@@ -433,18 +748,35 @@ int ast_sched_wait(struct ast_sched_context *con)
 {
 	int ms;
 	struct sched *s;
+	struct timeval now;
 
 	DEBUG(ast_debug(1, "ast_sched_wait()\n"));
 
 	ast_mutex_lock(&con->lock);
+	now = ast_tvnow();
 	if ((s = ast_heap_peek(con->sched_heap, 1))) {
-		ms = ast_tvdiff_ms(s->when, ast_tvnow());
+		ms = ast_tvdiff_ms(s->when, now);
 		if (ms < 0) {
 			ms = 0;
 		}
 	} else {
 		ms = -1;
 	}
+	if (con->wheel && ms != 0) {
+		uint64_t next = wheel_next_tick(con->wheel);
+
+		if (next) {
+			uint64_t tick = sched_tick(now);
+			int64_t wheel_ms = next > tick ? next - tick : 0;
+
+			if (wheel_ms > INT_MAX) {
+				wheel_ms = INT_MAX;
+			}
+			if (ms == -1 || wheel_ms < ms) {
+				ms = wheel_ms;
+			}
+		}
+	}
 	ast_mutex_unlock(&con->lock);
 
 	return ms;
@@ -460,7 +792,7 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 {
 	size_t size;
 
-	size = ast_heap_size(con->sched_heap);
+	size = sched_queued(con);
 
 	/* Record the largest the scheduler heap became for reporting purposes. */
 	if (con->highwater <= size) {
@@ -479,7 +811,12 @@ static void schedule(struct ast_sched_context *con, struct sched *s)
 	}
 	s->tie_breaker = con->tie_breaker;
 
-	ast_heap_push(con->sched_heap, s);
+	if (con->wheel) {
+		wheel_insert(con, s);
+	} else {
+		s->queue = SCHED_QUEUE_HEAP;
+		ast_heap_push(con->sched_heap, s);
+	}
 }
 
 /*! \brief
@@ -572,23 +909,6 @@ int ast_sched_add(struct ast_sched_context *con, int when, ast_sched_cb callback
 	return ast_sched_add_variable(con, when, callback, data, 0);
 }
 
-static struct sched *sched_find(struct ast_sched_context *con, int id)
-{
-	int x;
-	size_t heap_size;
-
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		struct sched *cur = ast_heap_peek(con->sched_heap, x);
-
-		if (cur->sched_id->id == id) {
-			return cur;
-		}
-	}
-
-	return NULL;
-}
-
 const void *ast_sched_find_data(struct ast_sched_context *con, int id)
 {
 	struct sched *s;
@@ -631,9 +951,7 @@ int _ast_sched_del(struct ast_sched_context *con, int id, const char *file, int
 
 	s = sched_find(con, id);
 	if (s) {
-		if (!ast_heap_remove(con->sched_heap, s)) {
-			ast_log(LOG_WARNING,"sched entry %d not in the sched heap?\n", s->sched_id->id);
-		}
+		sched_dequeue(con, s);
 		sched_release(con, s);
 	} else if (con->currently_executing && (id == con->currently_executing->sched_id->id)) {
 		s = con->currently_executing;
@@ -675,16 +993,17 @@ void ast_sched_report(struct ast_sched_context *con, struct ast_str **buf, struc
 	int i, x;
 	struct sched *cur;
 	int countlist[cbnames->numassocs + 1];
-	size_t heap_size;
 
 	memset(countlist, 0, sizeof(countlist));
-	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, ast_heap_size(con->sched_heap));
 
 	ast_mutex_lock(&con->lock);
 
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
-		cur = ast_heap_peek(con->sched_heap, x);
+	ast_str_set(buf, 0, " Highwater = %u\n schedcnt = %zu\n", con->highwater, sched_queued(con));
+
+	for (x = 1; x <= con->id_queue_size; x++) {
+		if (!(cur = sched_find(con, x))) {
+			continue;
+		}
 		/* match the callback to the cblist */
 		for (i = 0; i < cbnames->numassocs; i++) {
 			if (cur->callback == cbnames->cblist[i]) {
@@ -713,21 +1032,21 @@ void ast_sched_dump(struct ast_sched_context *con)
 	struct sched *q;
 	struct timeval when = ast_tvnow();
 	int x;
-	size_t heap_size;
 #ifdef SCHED_MAX_CACHE
-	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n", ast_heap_size(con->sched_heap), con->eventcnt - 1, con->schedccnt, con->highwater);
+	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u Cache, %u high-water)\n", sched_queued(con), con->eventcnt - 1, con->schedccnt, con->highwater);
 #else
-	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n", ast_heap_size(con->sched_heap), con->eventcnt - 1, con->highwater);
+	ast_debug(1, "Asterisk Schedule Dump (%zu in Q, %u Total, %u high-water)\n", sched_queued(con), con->eventcnt - 1, con->highwater);
 #endif
 
 	ast_debug(1, "=============================================================\n");
 	ast_debug(1, "|ID    Callback          Data              Time  (sec:ms)   |\n");
 	ast_debug(1, "+-----+-----------------+-----------------+-----------------+\n");
 	ast_mutex_lock(&con->lock);
-	heap_size = ast_heap_size(con->sched_heap);
-	for (x = 1; x <= heap_size; x++) {
+	for (x = 1; x <= con->id_queue_size; x++) {
 		struct timeval delta;
-		q = ast_heap_peek(con->sched_heap, x);
+		if (!(q = sched_find(con, x))) {
+			continue;
+		}
 		delta = ast_tvsub(q->when, when);
 		ast_debug(1, "|%.4d | %-15p | %-15p | %.6ld : %.6ld |\n",
 			q->sched_id->id,
@@ -755,6 +1074,10 @@ int ast_sched_runq(struct ast_sched_context *con)
 	ast_mutex_lock(&con->lock);
 
 	when = ast_tvadd(ast_tvnow(), ast_tv(0, 1000));
+	if (con->wheel) {
+		/* Everything due in the window is moved to the heap in one pass. */
+		wheel_advance(con, sched_tick(when));
+	}
 	for (numevents = 0; (current = ast_heap_peek(con->sched_heap, 1)); numevents++) {
 		/* schedule all events which are going to expire within 1ms.
 		 * We only care about millisecond accuracy anyway, so this will
@@ -766,6 +1089,7 @@ int ast_sched_runq(struct ast_sched_context *con)
 		}
 
 		current = ast_heap_pop(con->sched_heap);
+		current->queue = SCHED_QUEUE_NONE;
 
 		/*
 		 * At this point, the schedule queue is still intact.  We
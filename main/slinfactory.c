@@ -36,17 +36,18 @@
 #include "asterisk/translate.h"
 #include "asterisk/astobj2.h"
 
+/*! Fewest samples the ring holds once allocated */
+#define SLINFACTORY_MIN_RING 1024
+
 void ast_slinfactory_init(struct ast_slinfactory *sf)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	sf->output_format = ao2_bump(ast_format_slin);
 }
 
 int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_format *slin_out)
 {
 	memset(sf, 0, sizeof(*sf));
-	sf->offset = sf->hold;
 	if (!ast_format_cache_is_slinear(slin_out)) {
 		return -1;
 	}
@@ -57,16 +58,14 @@ int ast_slinfactory_init_with_format(struct ast_slinfactory *sf, struct ast_form
 
 void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 {
-	struct ast_frame *f;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((f = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-		ast_frfree(f);
-	}
+	ast_free(sf->ring);
+	sf->ring = NULL;
+	sf->mask = sf->head = sf->tail = 0;
 
 	ao2_cleanup(sf->output_format);
 	sf->output_format = NULL;
@@ -74,10 +73,85 @@ void ast_slinfactory_destroy(struct ast_slinfactory *sf)
 	sf->format = NULL;
 }
 
+/*!
+ * \internal
+ * \brief Copy samples out of the ring, from the front
+ */
+static void slinfactory_copy_out(const struct ast_slinfactory *sf, short *buf, unsigned int samples)
+{
+	unsigned int pos = sf->tail & sf->mask;
+	unsigned int first = MIN(samples, sf->mask + 1 - pos);
+
+	memcpy(buf, sf->ring + pos, first * sizeof(*buf));
+	memcpy(buf + first, sf->ring, (samples - first) * sizeof(*buf));
+}
+
+/*!
+ * \internal
+ * \brief Make room in the ring for more samples
+ */
+static int slinfactory_reserve(struct ast_slinfactory *sf, unsigned int samples)
+{
+	unsigned int used = sf->head - sf->tail;
+	unsigned int size = sf->ring ? sf->mask + 1 : SLINFACTORY_MIN_RING;
+	short *ring;
+
+	if (sf->ring && used + samples <= size) {
+		return 0;
+	}
+
+	while (size < used + samples) {
+		size <<= 1;
+	}
+
+	if (!(ring = ast_malloc(size * sizeof(*ring)))) {
+		return -1;
+	}
+
+	if (sf->ring) {
+		slinfactory_copy_out(sf, ring, used);
+		ast_free(sf->ring);
+	}
+
+	sf->ring = ring;
+	sf->mask = size - 1;
+	sf->tail = 0;
+	sf->head = used;
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Copy the samples of a frame into the ring
+ */
+static int slinfactory_copy_in(struct ast_slinfactory *sf, struct ast_frame *f)
+{
+	unsigned int samples = MIN(f->samples, f->datalen / sizeof(short));
+	unsigned int pos;
+	unsigned int first;
+
+	if (!samples) {
+		return 0;
+	}
+
+	if (slinfactory_reserve(sf, samples)) {
+		return -1;
+	}
+
+	pos = sf->head & sf->mask;
+	first = MIN(samples, sf->mask + 1 - pos);
+	memcpy(sf->ring + pos, f->data.ptr, first * sizeof(short));
+	memcpy(sf->ring, (short *) f->data.ptr + first, (samples - first) * sizeof(short));
+	sf->head += samples;
+
+	return 0;
+}
+
 int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 {
-	struct ast_frame *begin_frame = f, *duped_frame = NULL, *frame_ptr;
-	unsigned int x = 0;
+	struct ast_frame *begin_frame, *frame_ptr;
+	int res = 0;
 
 	/* In some cases, we can be passed a frame which has no data in it, but
 	 * which has a positive number of samples defined. Once such situation is
@@ -111,110 +185,70 @@ int ast_slinfactory_feed(struct ast_slinfactory *sf, struct ast_frame *f)
 			return 0;
 		}
 
-		if (!(duped_frame = ast_frisolate(begin_frame))) {
-			return 0;
-		}
-
-		if (duped_frame != begin_frame) {
-			ast_frfree(begin_frame);
+		/* if the frame was translated, the translator may have returned multiple
+		   frames, so copy in each of them
+		*/
+		for (frame_ptr = begin_frame; frame_ptr && !res; frame_ptr = AST_LIST_NEXT(frame_ptr, frame_list)) {
+			res = slinfactory_copy_in(sf, frame_ptr);
 		}
+		ast_frfree(begin_frame);
 	} else {
 		if (sf->trans) {
 			ast_translator_free_path(sf->trans);
 			sf->trans = NULL;
 		}
-		if (!(duped_frame = ast_frdup(f)))
-			return 0;
-	}
-
-	AST_LIST_TRAVERSE(&sf->queue, frame_ptr, frame_list) {
-		x++;
-	}
-
-	/* if the frame was translated, the translator may have returned multiple
-	   frames, so process each of them
-	*/
-	for (begin_frame = duped_frame; begin_frame; begin_frame = AST_LIST_NEXT(begin_frame, frame_list)) {
-		AST_LIST_INSERT_TAIL(&sf->queue, begin_frame, frame_list);
-		sf->size += begin_frame->samples;
+		res = slinfactory_copy_in(sf, f);
 	}
 
-	return x;
+	return res ? 0 : ast_slinfactory_available(sf);
 }
 
 int ast_slinfactory_read(struct ast_slinfactory *sf, short *buf, size_t samples)
 {
-	struct ast_frame *frame_ptr;
-	unsigned int sofar = 0, ineed, remain;
-	short *frame_data, *offset = buf;
-
-	while (sofar < samples) {
-		ineed = samples - sofar;
-
-		if (sf->holdlen) {
-			if (sf->holdlen <= ineed) {
-				memcpy(offset, sf->offset, sf->holdlen * sizeof(*offset));
-				sofar += sf->holdlen;
-				offset += sf->holdlen;
-				sf->holdlen = 0;
-				sf->offset = sf->hold;
-			} else {
-				remain = sf->holdlen - ineed;
-				memcpy(offset, sf->offset, ineed * sizeof(*offset));
-				sofar += ineed;
-				sf->offset += ineed;
-				sf->holdlen = remain;
-			}
-			continue;
-		}
+	unsigned int sofar = MIN(samples, ast_slinfactory_available(sf));
 
-		if ((frame_ptr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list))) {
-			frame_data = frame_ptr->data.ptr;
-
-			if (frame_ptr->samples <= ineed) {
-				memcpy(offset, frame_data, frame_ptr->samples * sizeof(*offset));
-				sofar += frame_ptr->samples;
-				offset += frame_ptr->samples;
-			} else {
-				remain = frame_ptr->samples - ineed;
-				memcpy(offset, frame_data, ineed * sizeof(*offset));
-				sofar += ineed;
-				frame_data += ineed;
-				if (remain > (AST_SLINFACTORY_MAX_HOLD - sf->holdlen)) {
-					remain = AST_SLINFACTORY_MAX_HOLD - sf->holdlen;
-				}
-				memcpy(sf->hold, frame_data, remain * sizeof(*offset));
-				sf->holdlen = remain;
-			}
-			ast_frfree(frame_ptr);
-		} else {
-			break;
-		}
+	if (sofar) {
+		slinfactory_copy_out(sf, buf, sofar);
+		ast_slinfactory_consume(sf, sofar);
 	}
 
-	sf->size -= sofar;
 	return sofar;
 }
 
+unsigned int ast_slinfactory_peek(const struct ast_slinfactory *sf, const short **buf, size_t samples)
+{
+	unsigned int pos = sf->tail & sf->mask;
+	unsigned int contiguous = MIN(ast_slinfactory_available(sf), sf->mask + 1 - pos);
+
+	*buf = sf->ring + pos;
+
+	return MIN(samples, contiguous);
+}
+
+void ast_slinfactory_consume(struct ast_slinfactory *sf, size_t samples)
+{
+	sf->tail += MIN(samples, ast_slinfactory_available(sf));
+
+	/* Start over at the beginning of the ring while it is empty, so later
+	 * reads are less likely to wrap around */
+	if (sf->head == sf->tail) {
+		sf->head = sf->tail = 0;
+	}
+}
+
 unsigned int ast_slinfactory_available(const struct ast_slinfactory *sf)
 {
-	return sf->size;
+	return sf->head - sf->tail;
 }
 
 void ast_slinfactory_flush(struct ast_slinfactory *sf)
 {
-	struct ast_frame *fr = NULL;
-
 	if (sf->trans) {
 		ast_translator_free_path(sf->trans);
 		sf->trans = NULL;
 	}
 
-	while ((fr = AST_LIST_REMOVE_HEAD(&sf->queue, frame_list)))
-		ast_frfree(fr);
-
-	sf->size = sf->holdlen = 0;
-	sf->offset = sf->hold;
+	sf->head = sf->tail = 0;
 
 	return;
 }
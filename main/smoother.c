@@ -38,7 +38,8 @@
 #include "asterisk/codec.h"
 #include "asterisk/smoother.h"
 
-#define SMOOTHER_SIZE 8000
+/*! Size of the ring data waits in, which must be a power of two */
+#define SMOOTHER_SIZE 8192
 
 struct ast_smoother {
 	int size;
@@ -48,14 +49,20 @@ struct ast_smoother {
 	unsigned int opt_needs_swap:1;
 	struct ast_frame f;
 	struct timeval delivery;
+	/*! Ring of data waiting to be read, so reads need not move what is left */
 	char data[SMOOTHER_SIZE];
 	char framedata[SMOOTHER_SIZE + AST_FRIENDLY_OFFSET];
 	struct ast_frame *opt;
+	/*! Position in data the next read starts at */
+	int tail;
 	int len;
 };
 
 static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int swap)
 {
+	int head = (s->tail + s->len) & (SMOOTHER_SIZE - 1);
+	int first = MIN(f->datalen, SMOOTHER_SIZE - head);
+
 	if (s->flags & AST_SMOOTHER_FLAG_G729) {
 		if (s->len % 10) {
 			ast_log(LOG_NOTICE, "Dropping extra frame of G.729 since we already have a VAD frame at the end\n");
@@ -63,9 +70,12 @@ static int smoother_frame_feed(struct ast_smoother *s, struct ast_frame *f, int
 		}
 	}
 	if (swap) {
-		ast_swapcopy_samples(s->data + s->len, f->data.ptr, f->samples);
+		/* Signed linear is fed in whole samples, so the ring wraps between samples */
+		ast_swapcopy_samples(s->data + head, f->data.ptr, first / 2);
+		ast_swapcopy_samples(s->data, (char *) f->data.ptr + first, (f->datalen - first) / 2);
 	} else {
-		memcpy(s->data + s->len, f->data.ptr, f->datalen);
+		memcpy(s->data + head, f->data.ptr, first);
+		memcpy(s->data, (char *) f->data.ptr + first, f->datalen - first);
 	}
 	/* If either side is empty, reset the delivery time */
 	if (!s->len || ast_tvzero(f->delivery) || ast_tvzero(s->delivery)) {	/* XXX really ? */
@@ -170,6 +180,7 @@ struct ast_frame *ast_smoother_read(struct ast_smoother *s)
 {
 	struct ast_frame *opt;
 	int len;
+	int first;
 
 	/* IF we have an optimization frame, send it */
 	if (s->opt) {
@@ -200,13 +211,14 @@ struct ast_frame *ast_smoother_read(struct ast_smoother *s)
 	s->f.samples = len * s->samplesperbyte;	/* XXX rounding */
 	s->f.delivery = s->delivery;
 	/* Fill Data */
-	memcpy(s->f.data.ptr, s->data, len);
+	first = MIN(len, SMOOTHER_SIZE - s->tail);
+	memcpy(s->f.data.ptr, s->data + s->tail, first);
+	memcpy((char *) s->f.data.ptr + first, s->data, len - first);
 	s->len -= len;
-	/* Move remaining data to the front if applicable */
+	s->tail = s->len ? (s->tail + len) & (SMOOTHER_SIZE - 1) : 0;
 	if (s->len) {
 		/* In principle this should all be fine because if we are sending
 		   G.729 VAD, the next timestamp will take over anyawy */
-		memmove(s->data, s->data + len, s->len);
 		if (!ast_tvzero(s->delivery)) {
 			/* If we have delivery time, increment it, otherwise, leave it at 0 */
 			s->delivery = ast_tvadd(s->delivery, ast_samp2tv(s->f.samples,
@@ -354,7 +354,7 @@ static int sorcery_wizard_hash(const void *obj, const int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash(key);
+	return ast_str_hash_fast(key);
 }
 
 /*! \brief Comparator function for sorcery wizards */
@@ -403,7 +403,7 @@ static int object_type_field_hash(const void *obj, const int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash(key);
+	return ast_str_hash_fast(key);
 }
 
 static int object_type_field_cmp(void *obj, void *arg, int flags)
@@ -492,7 +492,7 @@ static int sorcery_instance_hash(const void *obj, const int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash(key);
+	return ast_str_hash_fast(key);
 }
 
 int ast_sorcery_init(void)
@@ -721,7 +721,7 @@ static int sorcery_type_hash(const void *obj, const int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash(key);
+	return ast_str_hash_fast(key);
 }
 
 /*! \brief Comparator function for sorcery types */
@@ -1858,6 +1858,8 @@ struct sorcery_details {
 	const struct ast_sorcery *sorcery;
 	/*! \brief Pointer to the object itself */
 	void *obj;
+	/*! \brief Optional fields changed by an update */
+	const struct ast_variable *changes;
 };
 
 /*! \brief Internal function used to create an object in caching wizards */
@@ -1875,12 +1877,59 @@ static int sorcery_cache_create(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*! \brief Structure used when telling caching wizards about retrievals which found nothing or multiple objects */
+struct sorcery_retrieval_details {
+	/*! \brief Pointer to the sorcery instance */
+	const struct ast_sorcery *sorcery;
+	/*! \brief The type of object retrieved */
+	const char *type;
+	/*! \brief The id which no object was found for */
+	const char *id;
+	/*! \brief The objects retrieved */
+	struct ao2_container *objects;
+	/*! \brief The fields the objects were retrieved by */
+	const struct ast_variable *fields;
+	/*! \brief The regex the objects were retrieved by */
+	const char *regex;
+};
+
+static int sorcery_cache_missing(void *obj, void *arg, int flags)
+{
+	const struct ast_sorcery_object_wizard *object_wizard = obj;
+	const struct sorcery_retrieval_details *details = arg;
+
+	if (!object_wizard->caching || !object_wizard->wizard->callbacks.cache_missing) {
+		return 0;
+	}
+
+	object_wizard->wizard->callbacks.cache_missing(details->sorcery, object_wizard->data,
+		details->type, details->id);
+
+	return 0;
+}
+
+static int sorcery_cache_multiple(void *obj, void *arg, int flags)
+{
+	const struct ast_sorcery_object_wizard *object_wizard = obj;
+	const struct sorcery_retrieval_details *details = arg;
+
+	if (!object_wizard->caching || !object_wizard->wizard->callbacks.cache_multiple) {
+		return 0;
+	}
+
+	object_wizard->wizard->callbacks.cache_multiple(details->sorcery, object_wizard->data,
+		details->type, details->objects, details->fields, details->regex);
+
+	return 0;
+}
+
 void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *type, const char *id)
 {
 	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
 	void *object = NULL;
 	int i;
 	unsigned int cached = 0;
+	unsigned int missing = 0;
 
 	if (!object_type || ast_strlen_zero(id)) {
 		return NULL;
@@ -1893,6 +1942,12 @@ void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *
 
 		if (wizard->wizard->callbacks.retrieve_id &&
 			!(object = wizard->wizard->callbacks.retrieve_id(sorcery, wizard->data, object_type->name, id))) {
+			/* A caching wizard which knows there is no such object saves asking the rest */
+			if (wizard->caching && wizard->wizard->callbacks.is_missing &&
+				wizard->wizard->callbacks.is_missing(sorcery, wizard->data, object_type->name, id)) {
+				missing = 1;
+				break;
+			}
 			continue;
 		}
 
@@ -1907,6 +1962,14 @@ void *ast_sorcery_retrieve_by_id(const struct ast_sorcery *sorcery, const char *
 		};
 
 		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_create, NULL, &sdetails, 0);
+	} else if (!object && !missing) {
+		struct sorcery_retrieval_details rdetails = {
+			.sorcery = sorcery,
+			.type = object_type->name,
+			.id = id,
+		};
+
+		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_missing, NULL, &rdetails, 0);
 	}
 	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
 
@@ -1958,6 +2021,15 @@ void *ast_sorcery_retrieve_by_fields(const struct ast_sorcery *sorcery, const ch
 	/* If we are returning a single object and it came from a non-cache source create it in any caches */
 	if (!(flags & AST_RETRIEVE_FLAG_MULTIPLE) && !cached && object) {
 		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_create, NULL, object, 0);
+	} else if ((flags & AST_RETRIEVE_FLAG_MULTIPLE) && !cached && object) {
+		struct sorcery_retrieval_details rdetails = {
+			.sorcery = sorcery,
+			.type = object_type->name,
+			.objects = object,
+			.fields = fields,
+		};
+
+		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_multiple, NULL, &rdetails, 0);
 	}
 	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
 
@@ -1969,6 +2041,7 @@ struct ao2_container *ast_sorcery_retrieve_by_regex(const struct ast_sorcery *so
 	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, type, OBJ_KEY), ao2_cleanup);
 	struct ao2_container *objects;
 	int i;
+	unsigned int cached = 0;
 
 	if (!object_type || !(objects = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 1, NULL, NULL))) {
 		return NULL;
@@ -1986,9 +2059,21 @@ struct ao2_container *ast_sorcery_retrieve_by_regex(const struct ast_sorcery *so
 		wizard->wizard->callbacks.retrieve_regex(sorcery, wizard->data, object_type->name, objects, regex);
 
 		if (wizard->caching && ao2_container_count(objects)) {
+			cached = 1;
 			break;
 		}
 	}
+
+	if (!cached) {
+		struct sorcery_retrieval_details rdetails = {
+			.sorcery = sorcery,
+			.type = object_type->name,
+			.objects = objects,
+			.regex = regex,
+		};
+
+		AST_VECTOR_CALLBACK(&object_type->wizards, sorcery_cache_multiple, NULL, &rdetails, 0);
+	}
 	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
 
 	return objects;
@@ -2082,6 +2167,203 @@ int ast_sorcery_create(const struct ast_sorcery *sorcery, void *object)
 	return object_wizard ? 0 : -1;
 }
 
+/*!
+ * \internal
+ * \brief Create some objects with a wizard
+ *
+ * \param object_wizard The wizard
+ * \param sorcery The sorcery instance
+ * \param objects Objects to create
+ * \param count Number of objects
+ * \param created Set to non-zero for each object created
+ */
+static void sorcery_wizard_create_multiple(const struct ast_sorcery_object_wizard *object_wizard,
+	const struct ast_sorcery *sorcery, void **objects, size_t count, char *created)
+{
+	struct ao2_container *container;
+	struct sorcery_details sdetails = {
+		.sorcery = sorcery,
+	};
+	size_t i;
+
+	if (object_wizard->wizard->callbacks.create_multiple) {
+		container = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
+		if (container) {
+			for (i = 0; i < count; i++) {
+				if (ao2_link(container, objects[i])) {
+					break;
+				}
+			}
+			if (i == count && !object_wizard->wizard->callbacks.create_multiple(sorcery,
+				object_wizard->data, container)) {
+				memset(created, 1, count);
+			}
+			ao2_ref(container, -1);
+			return;
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		sdetails.obj = objects[i];
+		if (sorcery_wizard_create(object_wizard, &sdetails) == CMP_MATCH) {
+			created[i] = 1;
+		}
+	}
+}
+
+/*! \brief Internal callback function which notifies an individual observer that objects have been created */
+static int sorcery_observer_notify_create_multiple(void *obj, void *arg, int flags)
+{
+	const struct ast_sorcery_object_type_observer *observer = obj;
+	struct ao2_container *objects = arg;
+	struct ao2_iterator iter;
+	void *object;
+
+	if (observer->callbacks->created_multiple) {
+		observer->callbacks->created_multiple(objects);
+	} else if (observer->callbacks->created) {
+		iter = ao2_iterator_init(objects, 0);
+		for (; (object = ao2_iterator_next(&iter)); ao2_ref(object, -1)) {
+			observer->callbacks->created(object);
+		}
+		ao2_iterator_destroy(&iter);
+	}
+
+	return 0;
+}
+
+/*! \brief Internal callback function which notifies observers that objects have been created */
+static int sorcery_observers_notify_create_multiple(void *data)
+{
+	struct sorcery_observer_invocation *invocation = data;
+
+	ao2_callback(invocation->object_type->observers, OBJ_NODATA,
+		sorcery_observer_notify_create_multiple, invocation->object);
+	ao2_cleanup(invocation);
+
+	return 0;
+}
+
+int ast_sorcery_create_multiple(const struct ast_sorcery *sorcery, struct ao2_container *objects)
+{
+	struct ast_sorcery_object_type *object_type = NULL;
+	const struct ast_sorcery_object_details *details;
+	struct ast_sorcery_object_wizard *found_wizard;
+	struct ao2_container *notify;
+	struct ao2_iterator iter;
+	void **list;
+	char *created;
+	size_t total;
+	size_t count;
+	size_t i;
+	int res = -1;
+
+	total = ao2_container_count(objects);
+	if (!total) {
+		return 0;
+	}
+
+	list = ast_calloc(total, sizeof(*list));
+	created = ast_calloc(total, sizeof(*created));
+	if (!list || !created) {
+		ast_free(list);
+		ast_free(created);
+		return -1;
+	}
+
+	/* Every object has to be of the same type */
+	iter = ao2_iterator_init(objects, 0);
+	for (i = 0; i < total && (list[i] = ao2_iterator_next(&iter)); i++) {
+		details = list[i];
+		if (!object_type) {
+			object_type = ao2_find(sorcery->types, details->object->type, OBJ_KEY);
+			if (!object_type) {
+				i++;
+				break;
+			}
+		} else if (strcmp(object_type->name, details->object->type)) {
+			ast_log(LOG_ERROR, "Objects of types '%s' and '%s' cannot be created together\n",
+				object_type->name, details->object->type);
+			ao2_cleanup(object_type);
+			object_type = NULL;
+			i++;
+			break;
+		}
+	}
+	ao2_iterator_destroy(&iter);
+	count = i;
+
+	if (!object_type) {
+		goto done;
+	}
+
+	AST_VECTOR_RW_RDLOCK(&object_type->wizards);
+	for (i = 0; i < AST_VECTOR_SIZE(&object_type->wizards); i++) {
+		found_wizard = AST_VECTOR_GET(&object_type->wizards, i);
+		if (!found_wizard->caching) {
+			sorcery_wizard_create_multiple(found_wizard, sorcery, list, count, created);
+		}
+	}
+
+	/* Only the objects that were created are cached and notified */
+	notify = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
+	if (notify) {
+		for (i = 0; i < count; i++) {
+			if (created[i]) {
+				ao2_link(notify, list[i]);
+			}
+		}
+	}
+
+	if (notify && ao2_container_count(notify)) {
+		for (i = 0; i < AST_VECTOR_SIZE(&object_type->wizards); i++) {
+			found_wizard = AST_VECTOR_GET(&object_type->wizards, i);
+			if (found_wizard->caching) {
+				if (found_wizard->wizard->callbacks.create_multiple) {
+					found_wizard->wizard->callbacks.create_multiple(sorcery, found_wizard->data, notify);
+				} else {
+					struct sorcery_details sdetails = {
+						.sorcery = sorcery,
+					};
+					void *object;
+
+					iter = ao2_iterator_init(notify, 0);
+					for (; (object = ao2_iterator_next(&iter)); ao2_ref(object, -1)) {
+						sdetails.obj = object;
+						sorcery_wizard_create(found_wizard, &sdetails);
+					}
+					ao2_iterator_destroy(&iter);
+				}
+			}
+		}
+
+		if (ao2_container_count(object_type->observers)) {
+			struct sorcery_observer_invocation *invocation;
+
+			invocation = sorcery_observer_invocation_alloc(object_type, notify);
+			if (invocation
+				&& ast_taskprocessor_push(object_type->serializer,
+					sorcery_observers_notify_create_multiple, invocation)) {
+				ao2_cleanup(invocation);
+			}
+		}
+	}
+	AST_VECTOR_RW_UNLOCK(&object_type->wizards);
+
+	res = notify && ao2_container_count(notify) == total ? 0 : -1;
+	ao2_cleanup(notify);
+	ao2_ref(object_type, -1);
+
+done:
+	for (i = 0; i < count; i++) {
+		ao2_cleanup(list[i]);
+	}
+	ast_free(list);
+	ast_free(created);
+
+	return res;
+}
+
 /*! \brief Internal callback function which notifies an individual observer that an object has been updated */
 static int sorcery_observer_notify_update(void *obj, void *arg, int flags)
 {
@@ -2108,6 +2390,16 @@ static int sorcery_observers_notify_update(void *data)
 /*! \brief Internal function which returns if a wizard has updated the object */
 static int sorcery_wizard_update(const struct ast_sorcery_object_wizard *object_wizard, const struct sorcery_details *details)
 {
+	if (details->changes && object_wizard->wizard->callbacks.update_fields) {
+		/* Only the changed fields need to be persisted */
+		if (object_wizard->wizard->callbacks.update_fields(details->sorcery, object_wizard->data,
+			details->obj, details->changes)) {
+			return 0;
+		}
+
+		return CMP_MATCH;
+	}
+
 	if (!object_wizard->wizard->callbacks.update) {
 		ast_debug(5, "Sorcery wizard '%s' does not support updating\n", object_wizard->wizard->callbacks.name);
 		return 0;
@@ -2120,22 +2412,19 @@ static int sorcery_wizard_update(const struct ast_sorcery_object_wizard *object_
 	return CMP_MATCH;
 }
 
-int ast_sorcery_update(const struct ast_sorcery *sorcery, void *object)
+/*! \brief Internal function which updates an object, optionally with the fields that changed */
+static int sorcery_update(const struct ast_sorcery *sorcery, struct ast_sorcery_object_type *object_type,
+	void *object, const struct ast_variable *changes)
 {
-	const struct ast_sorcery_object_details *details = object;
-	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, details->object->type, OBJ_KEY), ao2_cleanup);
 	struct ast_sorcery_object_wizard *object_wizard = NULL;
 	struct ast_sorcery_object_wizard *found_wizard;
 	int i;
 	struct sorcery_details sdetails = {
 		.sorcery = sorcery,
 		.obj = object,
+		.changes = changes,
 	};
 
-	if (!object_type) {
-		return -1;
-	}
-
 	AST_VECTOR_RW_RDLOCK(&object_type->wizards);
 	for (i = 0; i < AST_VECTOR_SIZE(&object_type->wizards); i++) {
 		found_wizard = AST_VECTOR_GET(&object_type->wizards, i);
@@ -2170,6 +2459,59 @@ int ast_sorcery_update(const struct ast_sorcery *sorcery, void *object)
 	return object_wizard ? 0 : -1;
 }
 
+int ast_sorcery_update(const struct ast_sorcery *sorcery, void *object)
+{
+	const struct ast_sorcery_object_details *details = object;
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, details->object->type, OBJ_KEY), ao2_cleanup);
+
+	if (!object_type) {
+		return -1;
+	}
+
+	return sorcery_update(sorcery, object_type, object, NULL);
+}
+
+int ast_sorcery_update_fields(const struct ast_sorcery *sorcery, void *object, ...)
+{
+	const struct ast_sorcery_object_details *details = object;
+	RAII_VAR(struct ast_sorcery_object_type *, object_type, ao2_find(sorcery->types, details->object->type, OBJ_KEY), ao2_cleanup);
+	RAII_VAR(struct ast_variable *, changes, NULL, ast_variables_destroy);
+	struct ast_sorcery_object_field *object_field;
+	struct ast_variable *tail = NULL;
+	struct ast_variable *tmp;
+	const char *name;
+	va_list ap;
+	int res = 0;
+
+	if (!object_type) {
+		return -1;
+	}
+
+	/* Only the handlers of the changed fields are invoked */
+	va_start(ap, object);
+	while ((name = va_arg(ap, const char *))) {
+		object_field = ao2_find(object_type->fields, name, OBJ_SEARCH_KEY);
+		if (!object_field) {
+			ast_log(LOG_ERROR, "Sorcery object type '%s' has no field '%s' to update\n",
+				object_type->name, name);
+			res = -1;
+			break;
+		}
+		if ((tmp = get_single_field_as_var_list(object, object_field))
+			|| (tmp = get_multiple_fields_as_var_list(object, object_field))) {
+			tail = ast_variable_list_append_hint(&changes, tail, tmp);
+		}
+		ao2_ref(object_field, -1);
+	}
+	va_end(ap);
+
+	if (res) {
+		return -1;
+	}
+
+	return sorcery_update(sorcery, object_type, object, changes);
+}
+
 /*! \brief Internal callback function which notifies an individual observer that an object has been deleted */
 static int sorcery_observer_notify_delete(void *obj, void *arg, int flags)
 {
@@ -2258,6 +2600,44 @@ int ast_sorcery_delete(const struct ast_sorcery *sorcery, void *object)
 	return object_wizard ? 0 : -1;
 }
 
+/*! \brief Internal function which queues an observer notification for an object a wizard changed itself */
+static void sorcery_observers_notify(const struct ast_sorcery *sorcery, void *object, int (*notify)(void *data))
+{
+	const struct ast_sorcery_object_details *details = object;
+	struct ast_sorcery_object_type *object_type;
+	struct sorcery_observer_invocation *invocation;
+
+	object_type = ao2_find(sorcery->types, details->object->type, OBJ_KEY);
+	if (!object_type) {
+		return;
+	}
+
+	if (ao2_container_count(object_type->observers)) {
+		invocation = sorcery_observer_invocation_alloc(object_type, object);
+		if (invocation
+			&& ast_taskprocessor_push(object_type->serializer, notify, invocation)) {
+			ao2_cleanup(invocation);
+		}
+	}
+
+	ao2_ref(object_type, -1);
+}
+
+void ast_sorcery_notify_created(const struct ast_sorcery *sorcery, void *object)
+{
+	sorcery_observers_notify(sorcery, object, sorcery_observers_notify_create);
+}
+
+void ast_sorcery_notify_updated(const struct ast_sorcery *sorcery, void *object)
+{
+	sorcery_observers_notify(sorcery, object, sorcery_observers_notify_update);
+}
+
+void ast_sorcery_notify_deleted(const struct ast_sorcery *sorcery, void *object)
+{
+	sorcery_observers_notify(sorcery, object, sorcery_observers_notify_delete);
+}
+
 int ast_sorcery_is_stale(const struct ast_sorcery *sorcery, void *object)
 {
 	const struct ast_sorcery_object_details *details = object;
@@ -2459,7 +2839,7 @@ int ast_sorcery_object_id_hash(const void *obj, int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_hash(key);
+	return ast_str_hash_fast(key);
 }
 
 struct ast_sorcery_object_type *ast_sorcery_get_object_type(const struct ast_sorcery *sorcery,
@@ -312,6 +312,18 @@ struct stasis_topic {
 
 	/*! Topics forwarding into this topic */
 	AST_VECTOR(, struct stasis_topic *) upstream_topics;
+
+	/*!
+	 * \brief Guards \ref subscribers against modification while publishing.
+	 *
+	 * Publishing only reads the subscribers, so publishers hold this lock for
+	 * reading and never block one another. Changes to the subscribers are
+	 * serialized by the topic's ao2 lock and additionally hold this lock for
+	 * writing. This guarantees that once a subscription has been removed, no
+	 * publisher is still dispatching to it, keeping the unsubscribe the
+	 * final message the subscriber receives.
+	 */
+	ast_rwlock_t subscribers_lock;
 };
 
 /* Forward declarations for the tightly-coupled subscription object */
@@ -342,6 +354,7 @@ static void topic_dtor(void *obj)
 
 	AST_VECTOR_FREE(&topic->subscribers);
 	AST_VECTOR_FREE(&topic->upstream_topics);
+	ast_rwlock_destroy(&topic->subscribers_lock);
 }
 
 struct stasis_topic *stasis_topic_create(const char *name)
@@ -354,6 +367,7 @@ struct stasis_topic *stasis_topic_create(const char *name)
 		return NULL;
 	}
 
+	ast_rwlock_init(&topic->subscribers_lock);
 	topic->name = ast_strdup(name);
 	res |= AST_VECTOR_INIT(&topic->subscribers, INITIAL_SUBSCRIBERS_MAX);
 	res |= AST_VECTOR_INIT(&topic->upstream_topics, 0);
@@ -391,6 +405,11 @@ struct stasis_subscription {
 	/*! Flag set when final message for sub has been processed.
 	 *  Be sure join_lock is held before reading/setting. */
 	int final_message_processed;
+
+	/*! The message types this subscription is accepting, indexed by type id */
+	AST_VECTOR(, char) accepted_message_types;
+	/*! The message filter currently in use */
+	enum stasis_subscription_message_filter filter;
 };
 
 static void subscription_dtor(void *obj)
@@ -409,6 +428,8 @@ static void subscription_dtor(void *obj)
 	ast_taskprocessor_unreference(sub->mailbox);
 	sub->mailbox = NULL;
 	ast_cond_destroy(&sub->join_cond);
+
+	AST_VECTOR_FREE(&sub->accepted_message_types);
 }
 
 /*!
@@ -498,6 +519,8 @@ struct stasis_subscription *internal_stasis_subscribe(
 	sub->callback = callback;
 	sub->data = data;
 	ast_cond_init(&sub->join_cond, NULL);
+	sub->filter = STASIS_SUBSCRIPTION_FILTER_NONE;
+	AST_VECTOR_INIT(&sub->accepted_message_types, 0);
 
 	if (topic_add_subscription(topic, sub) != 0) {
 		return NULL;
@@ -563,6 +586,103 @@ struct stasis_subscription *stasis_unsubscribe(struct stasis_subscription *sub)
 	return NULL;
 }
 
+int stasis_subscription_accept_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type)
+{
+	int id;
+	int res;
+
+	if (!subscription) {
+		return -1;
+	}
+
+	if (!type) {
+		/* Filtering is unreliable as this message type is not yet initialized
+		 * so force all messages through.
+		 */
+		stasis_subscription_set_filter(subscription, STASIS_SUBSCRIPTION_FILTER_FORCED_NONE);
+		return 0;
+	}
+
+	id = stasis_message_type_id(type);
+	ao2_lock(subscription);
+	/* Growing the vector zero fills it, declining every type in between. */
+	res = AST_VECTOR_REPLACE(&subscription->accepted_message_types, id, 1);
+	ao2_unlock(subscription);
+
+	return res;
+}
+
+int stasis_subscription_decline_message_type(struct stasis_subscription *subscription,
+	const struct stasis_message_type *type)
+{
+	int id;
+
+	if (!subscription) {
+		return -1;
+	}
+
+	if (!type) {
+		return 0;
+	}
+
+	id = stasis_message_type_id(type);
+	ao2_lock(subscription);
+	if (id < AST_VECTOR_SIZE(&subscription->accepted_message_types)) {
+		AST_VECTOR_REPLACE(&subscription->accepted_message_types, id, 0);
+	}
+	ao2_unlock(subscription);
+
+	return 0;
+}
+
+int stasis_subscription_set_filter(struct stasis_subscription *subscription,
+	enum stasis_subscription_message_filter filter)
+{
+	if (!subscription) {
+		return -1;
+	}
+
+	ao2_lock(subscription);
+	if (subscription->filter != STASIS_SUBSCRIPTION_FILTER_FORCED_NONE) {
+		subscription->filter = filter;
+	}
+	ao2_unlock(subscription);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Check whether a subscription's filter lets a message through
+ *
+ * \param sub The subscriber to check
+ * \param message The message being published
+ *
+ * \retval 1 if the message should be dispatched
+ * \retval 0 if the subscriber is not interested in it
+ */
+static int subscription_accepts(struct stasis_subscription *sub,
+	struct stasis_message *message)
+{
+	int id;
+	int accepted;
+
+	if (sub->filter != STASIS_SUBSCRIPTION_FILTER_SELECTIVE) {
+		return 1;
+	}
+
+	id = stasis_message_type_id(stasis_message_type(message));
+	ao2_lock(sub);
+	accepted = sub->filter != STASIS_SUBSCRIPTION_FILTER_SELECTIVE
+		|| (id < AST_VECTOR_SIZE(&sub->accepted_message_types)
+			&& AST_VECTOR_GET(&sub->accepted_message_types, id));
+	ao2_unlock(sub);
+
+	/* The final message must get through so the subscription can be joined. */
+	return accepted || stasis_subscription_final_message(sub, message);
+}
+
 int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscription,
 	long low_water, long high_water)
 {
@@ -575,6 +695,35 @@ int stasis_subscription_set_congestion_limits(struct stasis_subscription *subscr
 	return res;
 }
 
+int stasis_subscription_set_congestion_policy(struct stasis_subscription *subscription,
+	enum stasis_subscription_congestion_policy policy, unsigned int max_wait_ms)
+{
+	enum ast_taskprocessor_overload_policy overload;
+
+	if (!subscription || !subscription->mailbox) {
+		return -1;
+	}
+
+	switch (policy) {
+	case STASIS_SUBSCRIPTION_CONGESTION_QUEUE:
+		overload = AST_TASKPROCESSOR_OVERLOAD_NONE;
+		break;
+	case STASIS_SUBSCRIPTION_CONGESTION_BLOCK:
+		overload = AST_TASKPROCESSOR_OVERLOAD_BLOCK;
+		break;
+	case STASIS_SUBSCRIPTION_CONGESTION_DROP_NEWEST:
+		overload = AST_TASKPROCESSOR_OVERLOAD_DROP_NEWEST;
+		break;
+	case STASIS_SUBSCRIPTION_CONGESTION_DROP_OLDEST:
+		overload = AST_TASKPROCESSOR_OVERLOAD_DROP_OLDEST;
+		break;
+	default:
+		return -1;
+	}
+
+	return ast_taskprocessor_overload_policy_set(subscription->mailbox, overload, max_wait_ms);
+}
+
 void stasis_subscription_join(struct stasis_subscription *subscription)
 {
 	if (subscription) {
@@ -621,7 +770,7 @@ int stasis_subscription_is_subscribed(const struct stasis_subscription *sub)
 	if (sub) {
 		size_t i;
 		struct stasis_topic *topic = sub->topic;
-		SCOPED_AO2LOCK(lock_topic, topic);
+		SCOPED_RDLOCK(lock_topic, &topic->subscribers_lock);
 
 		for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
 			if (AST_VECTOR_GET(&topic->subscribers, i) == sub) {
@@ -676,7 +825,9 @@ static int topic_add_subscription(struct stasis_topic *topic, struct stasis_subs
 	 *
 	 * If we bumped the refcount here, the owner would have to unsubscribe
 	 * and cleanup, which is a bit awkward. */
+	ast_rwlock_wrlock(&topic->subscribers_lock);
 	AST_VECTOR_APPEND(&topic->subscribers, sub);
+	ast_rwlock_unlock(&topic->subscribers_lock);
 
 	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->upstream_topics); ++idx) {
 		topic_add_subscription(
@@ -689,6 +840,7 @@ static int topic_add_subscription(struct stasis_topic *topic, struct stasis_subs
 static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_subscription *sub)
 {
 	size_t idx;
+	int res;
 	SCOPED_AO2LOCK(lock_topic, topic);
 
 	for (idx = 0; idx < AST_VECTOR_SIZE(&topic->upstream_topics); ++idx) {
@@ -696,8 +848,13 @@ static int topic_remove_subscription(struct stasis_topic *topic, struct stasis_s
 			AST_VECTOR_GET(&topic->upstream_topics, idx), sub);
 	}
 
-	return AST_VECTOR_REMOVE_ELEM_UNORDERED(&topic->subscribers, sub,
+	/* Waits for any publisher still dispatching to this subscription */
+	ast_rwlock_wrlock(&topic->subscribers_lock);
+	res = AST_VECTOR_REMOVE_ELEM_UNORDERED(&topic->subscribers, sub,
 		AST_VECTOR_ELEM_CLEANUP_NOOP);
+	ast_rwlock_unlock(&topic->subscribers_lock);
+
+	return res;
 }
 
 /*!
@@ -716,6 +873,15 @@ static int dispatch_exec_async(struct ast_taskprocessor_local *local)
 	return 0;
 }
 
+/*!
+ * \internal \brief Release a message dropped by a congested subscription
+ * \param data The dropped \ref stasis_message
+ */
+static void dispatch_drop_async(void *data)
+{
+	ao2_cleanup(data);
+}
+
 /*!
  * \internal \brief Data passed to \ref dispatch_exec_sync to synchronize
  * a published message to a subscriber
@@ -760,6 +926,10 @@ static void dispatch_message(struct stasis_subscription *sub,
 	struct stasis_message *message,
 	int synchronous)
 {
+	if (!subscription_accepts(sub, message)) {
+		return;
+	}
+
 	if (!sub->mailbox) {
 		/* Dispatch directly */
 		subscription_invoke(sub, message);
@@ -771,7 +941,16 @@ static void dispatch_message(struct stasis_subscription *sub,
 	 */
 	ao2_bump(message);
 	if (!synchronous) {
-		if (ast_taskprocessor_push_local(sub->mailbox, dispatch_exec_async, message)) {
+		int res;
+
+		/* The final message must get through so the subscription can be joined. */
+		if (stasis_subscription_final_message(sub, message)) {
+			res = ast_taskprocessor_push_local(sub->mailbox, dispatch_exec_async, message);
+		} else {
+			res = ast_taskprocessor_push_local_droppable(sub->mailbox, dispatch_exec_async,
+				message, dispatch_drop_async);
+		}
+		if (res) {
 			/* Push failed; ugh. */
 			ast_log(LOG_ERROR, "Dropping async dispatch\n");
 			ao2_cleanup(message);
@@ -824,7 +1003,11 @@ static void publish_msg(struct stasis_topic *topic,
 	 * Make sure we hold onto a reference while dispatching.
 	 */
 	ao2_ref(topic, +1);
-	ao2_lock(topic);
+	/*
+	 * Only a read lock is needed to walk the subscribers, so publishers
+	 * on the same topic do not serialize behind one another.
+	 */
+	ast_rwlock_rdlock(&topic->subscribers_lock);
 	for (i = 0; i < AST_VECTOR_SIZE(&topic->subscribers); ++i) {
 		struct stasis_subscription *sub = AST_VECTOR_GET(&topic->subscribers, i);
 
@@ -832,7 +1015,7 @@ static void publish_msg(struct stasis_topic *topic,
 
 		dispatch_message(sub, message, (sub == sync_sub));
 	}
-	ao2_unlock(topic);
+	ast_rwlock_unlock(&topic->subscribers_lock);
 	ao2_ref(topic, -1);
 }
 
@@ -1084,7 +1267,7 @@ static int topic_pool_entry_hash(const void *obj, const int flags)
 		ast_assert(0);
 		return 0;
 	}
-	return ast_str_case_hash(key);
+	return ast_str_case_hash_fast(key);
 }
 
 static int topic_pool_entry_cmp(void *obj, void *arg, int flags)
@@ -30,7 +30,7 @@
 #include "asterisk.h"
 
 #include "asterisk/astobj2.h"
-#include "asterisk/hashtab.h"
+#include "asterisk/dlinkedlists.h"
 #include "asterisk/stasis_internal.h"
 #include "asterisk/stasis.h"
 #include "asterisk/utils.h"
@@ -42,9 +42,13 @@
 #define NUM_CACHE_BUCKETS 563
 #endif
 
+struct cache_type_index;
+
 /*! \internal */
 struct stasis_cache {
 	struct ao2_container *entries;
+	/*! Entries of each type, protected by the lock of \c entries */
+	AST_VECTOR(, struct cache_type_index *) types;
 	snapshot_get_id id_fn;
 	cache_aggregate_calc_fn aggregate_calc_fn;
 	cache_aggregate_publish_fn aggregate_publish_fn;
@@ -140,6 +144,9 @@ struct cache_entry_key {
 
 struct stasis_cache_entry {
 	struct cache_entry_key key;
+	/*! Entries of the same type, while in the cache */
+	struct cache_type_index *index;
+	AST_DLLIST_ENTRY(stasis_cache_entry) type_list;
 	/*! Aggregate snapshot of the stasis cache. */
 	struct stasis_message *aggregate;
 	/*! Local entity snapshot of the stasis event. */
@@ -172,10 +179,102 @@ static void cache_entry_dtor(void *obj)
 	AST_VECTOR_FREE(&entry->remote);
 }
 
+/*!
+ * \brief An immutable set of snapshots of one type from a cache.
+ *
+ * Built the first time it is asked for after the entries of the type
+ * changed, and shared by everyone asking for it until they change again.
+ */
+struct stasis_cache_snapshots {
+	AST_VECTOR(, struct stasis_message *) snapshots;
+};
+
+/*!
+ * \internal
+ * \brief The entries of one type in a cache.
+ *
+ * Protected by the lock of the cache entries.  The shared snapshot sets
+ * are only dropped with the lock held for writing, so readers may fill an
+ * empty one in with the lock held for reading.
+ */
+struct cache_type_index {
+	struct stasis_message_type *type;
+	/*! Entries of the type, the cache entries container holds their reference */
+	AST_DLLIST_HEAD_NOLOCK(, stasis_cache_entry) entries;
+	/*! Local snapshots of the entries, NULL until asked for after a change */
+	struct stasis_cache_snapshots *local;
+	/*! Aggregate snapshots of the entries, NULL until asked for after a change */
+	struct stasis_cache_snapshots *aggregate;
+};
+
+static void cache_snapshots_dtor(void *obj)
+{
+	struct stasis_cache_snapshots *snapshots = obj;
+
+	AST_VECTOR_CALLBACK_VOID(&snapshots->snapshots, ao2_cleanup);
+	AST_VECTOR_FREE(&snapshots->snapshots);
+}
+
+static void cache_type_index_free(struct cache_type_index *index)
+{
+	ao2_cleanup(index->type);
+	ao2_cleanup(index->local);
+	ao2_cleanup(index->aggregate);
+	ast_free(index);
+}
+
+/*!
+ * \internal
+ * \brief Find the entries of a type.
+ *
+ * \note The entries container is already locked.
+ */
+static struct cache_type_index *cache_type_index_find(struct stasis_cache *cache, struct stasis_message_type *type)
+{
+	int idx;
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&cache->types); ++idx) {
+		if (AST_VECTOR_GET(&cache->types, idx)->type == type) {
+			return AST_VECTOR_GET(&cache->types, idx);
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Find the entries of a type, adding them if the type is new.
+ *
+ * \note The entries container is already locked for writing.
+ */
+static struct cache_type_index *cache_type_index_get(struct stasis_cache *cache, struct stasis_message_type *type)
+{
+	struct cache_type_index *index;
+
+	index = cache_type_index_find(cache, type);
+	if (index) {
+		return index;
+	}
+
+	index = ast_calloc(1, sizeof(*index));
+	if (!index) {
+		return NULL;
+	}
+	index->type = ao2_bump(type);
+
+	if (AST_VECTOR_APPEND(&cache->types, index)) {
+		cache_type_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
 static void cache_entry_compute_hash(struct cache_entry_key *key)
 {
-	key->hash = ast_hashtab_hash_string(stasis_message_type_name(key->type));
-	key->hash += ast_hashtab_hash_string(key->id);
+	key->hash = ast_str_hash_fast(stasis_message_type_name(key->type));
+	key->hash = ast_str_hash_fast_len(key->id, strlen(key->id), key->hash);
 }
 
 static struct stasis_cache_entry *cache_entry_create(struct stasis_message_type *type, const char *id, struct stasis_message *snapshot)
@@ -289,6 +388,9 @@ static void cache_dtor(void *obj)
 
 	ao2_cleanup(cache->entries);
 	cache->entries = NULL;
+
+	AST_VECTOR_CALLBACK_VOID(&cache->types, cache_type_index_free);
+	AST_VECTOR_FREE(&cache->types);
 }
 
 struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
@@ -305,7 +407,7 @@ struct stasis_cache *stasis_cache_create_full(snapshot_get_id id_fn,
 
 	cache->entries = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
 		NUM_CACHE_BUCKETS, cache_entry_hash, NULL, cache_entry_cmp);
-	if (!cache->entries) {
+	if (!cache->entries || AST_VECTOR_INIT(&cache->types, 4)) {
 		ao2_cleanup(cache);
 		return NULL;
 	}
@@ -407,6 +509,7 @@ static struct stasis_message *cache_remove(struct ao2_container *entries, struct
 	}
 
 	if (!cached_entry->local && !AST_VECTOR_SIZE(&cached_entry->remote)) {
+		AST_DLLIST_REMOVE(&cached_entry->index->entries, cached_entry, type_list);
 		ao2_unlink_flags(entries, cached_entry, OBJ_NOLOCK);
 	}
 
@@ -468,6 +571,9 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 {
 	struct stasis_cache_entry *cached_entry;
 	struct cache_put_snapshots snapshots;
+	struct cache_type_index *index = NULL;
+	struct stasis_cache_snapshots *stale_local = NULL;
+	struct stasis_cache_snapshots *stale_aggregate = NULL;
 
 	ast_assert(cache->entries != NULL);
 	ast_assert(eid != NULL);/* Aggregate snapshots not allowed to be put directly. */
@@ -489,14 +595,25 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 	} else if (cached_entry) {
 		/* Update snapshot in cache */
 		snapshots.old = cache_udpate(cached_entry, eid, new_snapshot);
-	} else {
+	} else if ((index = cache_type_index_get(cache, type))) {
 		/* Insert into the cache */
 		cached_entry = cache_entry_create(type, id, new_snapshot);
 		if (cached_entry) {
 			ao2_link_flags(cache->entries, cached_entry, OBJ_NOLOCK);
+			cached_entry->index = index;
+			AST_DLLIST_INSERT_TAIL(&index->entries, cached_entry, type_list);
 		}
 	}
 
+	/* The shared snapshots of the type no longer match the cache */
+	if (cached_entry) {
+		index = cached_entry->index;
+		stale_local = index->local;
+		index->local = NULL;
+		stale_aggregate = index->aggregate;
+		index->aggregate = NULL;
+	}
+
 	/* Update the aggregate snapshot. */
 	if (cache->aggregate_calc_fn && cached_entry) {
 		snapshots.aggregate_new = cache->aggregate_calc_fn(cached_entry, new_snapshot);
@@ -506,6 +623,8 @@ static struct cache_put_snapshots cache_put(struct stasis_cache *cache,
 
 	ao2_unlock(cache->entries);
 
+	ao2_cleanup(stale_local);
+	ao2_cleanup(stale_aggregate);
 	ao2_cleanup(cached_entry);
 	return snapshots;
 }
@@ -675,6 +794,27 @@ static int cache_dump_by_eid_cb(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Dump the entries of the type being dumped, without visiting the others.
+ */
+static void cache_dump_type(struct stasis_cache *cache, ao2_callback_fn *cb, struct cache_dump_data *cache_dump)
+{
+	struct cache_type_index *index;
+	struct stasis_cache_entry *entry;
+
+	ao2_rdlock(cache->entries);
+	index = cache_type_index_find(cache, cache_dump->type);
+	if (index) {
+		AST_DLLIST_TRAVERSE(&index->entries, entry, type_list) {
+			if (cb(entry, cache_dump, 0) & CMP_STOP) {
+				break;
+			}
+		}
+	}
+	ao2_unlock(cache->entries);
+}
+
 struct ao2_container *stasis_cache_dump_by_eid(struct stasis_cache *cache, struct stasis_message_type *type, const struct ast_eid *eid)
 {
 	struct cache_dump_data cache_dump;
@@ -689,7 +829,11 @@ struct ao2_container *stasis_cache_dump_by_eid(struct stasis_cache *cache, struc
 		return NULL;
 	}
 
-	ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_by_eid_cb, &cache_dump);
+	if (type) {
+		cache_dump_type(cache, cache_dump_by_eid_cb, &cache_dump);
+	} else {
+		ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_by_eid_cb, &cache_dump);
+	}
 	return cache_dump.container;
 }
 
@@ -728,10 +872,119 @@ struct ao2_container *stasis_cache_dump_all(struct stasis_cache *cache, struct s
 		return NULL;
 	}
 
-	ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_all_cb, &cache_dump);
+	if (type) {
+		cache_dump_type(cache, cache_dump_all_cb, &cache_dump);
+	} else {
+		ao2_callback(cache->entries, OBJ_MULTIPLE | OBJ_NODATA, cache_dump_all_cb, &cache_dump);
+	}
 	return cache_dump.container;
 }
 
+/*!
+ * \internal
+ * \brief Build the snapshots of the entries of a type for a specific entity.
+ *
+ * \note The entries container is already locked.
+ */
+static struct stasis_cache_snapshots *cache_snapshots_build(struct cache_type_index *index, const struct ast_eid *eid)
+{
+	struct stasis_cache_snapshots *snapshots;
+	struct stasis_cache_entry *entry;
+	struct stasis_message *snapshot;
+
+	snapshots = ao2_alloc_options(sizeof(*snapshots), cache_snapshots_dtor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!snapshots || AST_VECTOR_INIT(&snapshots->snapshots, 0)) {
+		ao2_cleanup(snapshots);
+		return NULL;
+	}
+
+	if (!index) {
+		return snapshots;
+	}
+
+	AST_DLLIST_TRAVERSE(&index->entries, entry, type_list) {
+		snapshot = cache_entry_by_eid(entry, eid);
+		if (!snapshot) {
+			continue;
+		}
+		if (AST_VECTOR_APPEND(&snapshots->snapshots, snapshot)) {
+			ao2_ref(snapshots, -1);
+			return NULL;
+		}
+		ao2_bump(snapshot);
+	}
+
+	return snapshots;
+}
+
+struct stasis_cache_snapshots *stasis_cache_snapshots_by_eid(struct stasis_cache *cache, struct stasis_message_type *type, const struct ast_eid *eid)
+{
+	struct cache_type_index *index;
+	struct stasis_cache_snapshots **shared = NULL;
+	struct stasis_cache_snapshots *snapshots;
+	struct stasis_cache_snapshots *expected = NULL;
+
+	ast_assert(cache != NULL);
+	ast_assert(cache->entries != NULL);
+
+	if (!type) {
+		return NULL;
+	}
+
+	ao2_rdlock(cache->entries);
+
+	index = cache_type_index_find(cache, type);
+	if (index) {
+		/* Only the local and aggregate snapshots, which everyone lists, are shared */
+		if (!eid) {
+			shared = &index->aggregate;
+		} else if (!ast_eid_cmp(eid, &ast_eid_default)) {
+			shared = &index->local;
+		}
+	}
+
+	if (shared && (snapshots = __atomic_load_n(shared, __ATOMIC_ACQUIRE))) {
+		ao2_ref(snapshots, +1);
+		ao2_unlock(cache->entries);
+		return snapshots;
+	}
+
+	snapshots = cache_snapshots_build(index, eid);
+	if (snapshots && shared) {
+		if (__atomic_compare_exchange_n(shared, &expected, snapshots, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+			ao2_ref(snapshots, +1);
+		} else {
+			/* Another reader built them at the same time, share theirs */
+			ao2_ref(snapshots, -1);
+			snapshots = ao2_bump(expected);
+		}
+	}
+
+	ao2_unlock(cache->entries);
+
+	return snapshots;
+}
+
+struct stasis_cache_snapshots *stasis_cache_snapshots(struct stasis_cache *cache, struct stasis_message_type *type)
+{
+	return stasis_cache_snapshots_by_eid(cache, type, &ast_eid_default);
+}
+
+size_t stasis_cache_snapshots_count(const struct stasis_cache_snapshots *snapshots)
+{
+	return AST_VECTOR_SIZE(&snapshots->snapshots);
+}
+
+struct stasis_message *stasis_cache_snapshots_get(const struct stasis_cache_snapshots *snapshots, size_t idx)
+{
+	if (idx < AST_VECTOR_SIZE(&snapshots->snapshots)) {
+		return AST_VECTOR_GET(&snapshots->snapshots, idx);
+	}
+	return NULL;
+}
+
 STASIS_MESSAGE_TYPE_DEFN(stasis_cache_clear_type);
 STASIS_MESSAGE_TYPE_DEFN(stasis_cache_update_type);
 
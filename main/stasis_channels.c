@@ -38,6 +38,7 @@
 #include "asterisk/stasis.h"
 #include "asterisk/stasis_cache_pattern.h"
 #include "asterisk/stasis_channels.h"
+#include "asterisk/channel_internal.h"
 #include "asterisk/dial.h"
 #include "asterisk/linkedlists.h"
 
@@ -195,6 +196,7 @@ static void channel_snapshot_dtor(void *obj)
 
 	ast_string_field_free_memory(snapshot);
 	ao2_cleanup(snapshot->manager_vars);
+	ao2_cleanup(snapshot->ari_vars);
 }
 
 struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *chan)
@@ -276,6 +278,84 @@ struct ast_channel_snapshot *ast_channel_snapshot_create(struct ast_channel *cha
 	return snapshot;
 }
 
+/*!
+ * \internal
+ * \brief Determine if a new snapshot of a channel would be the same as an old one.
+ * \since 15.0.0
+ *
+ * \pre chan is locked
+ *
+ * \param snapshot Old snapshot of the channel.
+ * \param chan Channel to compare with.
+ *
+ * \retval 1 if ast_channel_snapshot_create() would make an identical snapshot.
+ * \retval 0 otherwise.
+ */
+static int channel_snapshot_is_current(struct ast_channel_snapshot *snapshot, struct ast_channel *chan)
+{
+	struct ast_party_caller *caller = ast_channel_caller(chan);
+	struct ast_party_connected_line *connected = ast_channel_connected(chan);
+	struct ast_party_dialed *dialed = ast_channel_dialed(chan);
+	struct ast_bridge *bridge;
+	const char *bridgeid = "";
+	int res;
+
+	/* Variables are copied into every snapshot, so they cannot be compared cheaply. */
+	if (ast_channel_has_manager_vars() || ast_channel_has_ari_vars()) {
+		return 0;
+	}
+
+	if (snapshot->state != ast_channel_state(chan)
+		|| snapshot->priority != ast_channel_priority(chan)
+		|| snapshot->amaflags != ast_channel_amaflags(chan)
+		|| snapshot->hangupcause != ast_channel_hangupcause(chan)
+		|| snapshot->flags.flags != ast_channel_flags(chan)->flags
+		|| snapshot->softhangup_flags.flags != ast_channel_softhangup_internal_flag(chan)
+		|| snapshot->caller_pres != ast_party_id_presentation(&caller->id)
+		|| snapshot->tech_properties != ast_channel_tech(chan)->properties
+		|| ast_tvcmp(snapshot->creationtime, ast_channel_creationtime(chan))) {
+		return 0;
+	}
+
+	if (strcmp(snapshot->name, ast_channel_name(chan))
+		|| strcmp(snapshot->type, ast_channel_tech(chan)->type)
+		|| strcmp(snapshot->accountcode, ast_channel_accountcode(chan))
+		|| strcmp(snapshot->peeraccount, ast_channel_peeraccount(chan))
+		|| strcmp(snapshot->userfield, ast_channel_userfield(chan))
+		|| strcmp(snapshot->uniqueid, ast_channel_uniqueid(chan))
+		|| strcmp(snapshot->linkedid, ast_channel_linkedid(chan))
+		|| strcmp(snapshot->hangupsource, ast_channel_hangupsource(chan))
+		|| strcmp(snapshot->appl, S_OR(ast_channel_appl(chan), ""))
+		|| strcmp(snapshot->data, S_OR(ast_channel_data(chan), ""))
+		|| strcmp(snapshot->context, ast_channel_context(chan))
+		|| strcmp(snapshot->exten, ast_channel_exten(chan))
+		|| strcmp(snapshot->language, ast_channel_language(chan))) {
+		return 0;
+	}
+
+	if (strcmp(snapshot->caller_name, S_COR(caller->id.name.valid, caller->id.name.str, ""))
+		|| strcmp(snapshot->caller_number, S_COR(caller->id.number.valid, caller->id.number.str, ""))
+		|| strcmp(snapshot->caller_dnid, S_OR(dialed->number.str, ""))
+		|| strcmp(snapshot->caller_subaddr, S_COR(caller->id.subaddress.valid, caller->id.subaddress.str, ""))
+		|| strcmp(snapshot->dialed_subaddr, S_COR(dialed->subaddress.valid, dialed->subaddress.str, ""))
+		|| strcmp(snapshot->caller_ani, S_COR(caller->ani.number.valid, caller->ani.number.str, ""))
+		|| strcmp(snapshot->caller_rdnis, S_COR(ast_channel_redirecting(chan)->from.number.valid,
+			ast_channel_redirecting(chan)->from.number.str, ""))
+		|| strcmp(snapshot->connected_name, S_COR(connected->id.name.valid, connected->id.name.str, ""))
+		|| strcmp(snapshot->connected_number, S_COR(connected->id.number.valid, connected->id.number.str, ""))) {
+		return 0;
+	}
+
+	bridge = ast_channel_get_bridge(chan);
+	if (bridge && !ast_test_flag(&bridge->feature_flags, AST_BRIDGE_FLAG_INVISIBLE)) {
+		bridgeid = bridge->uniqueid;
+	}
+	res = !strcmp(snapshot->bridgeid, bridgeid);
+	ao2_cleanup(bridge);
+
+	return res;
+}
+
 static void publish_message_for_channel_topics(struct stasis_message *message, struct ast_channel *chan)
 {
 	if (chan) {
@@ -714,9 +794,20 @@ void ast_channel_publish_snapshot(struct ast_channel *chan)
 		return;
 	}
 
-	snapshot = ast_channel_snapshot_create(chan);
-	if (!snapshot) {
-		return;
+	/*
+	 * Much of what publishes a snapshot changes nothing in it.  If so,
+	 * publish the last one again rather than copying every field anew.
+	 * Subscribers get the same snapshot as both old and new.
+	 */
+	snapshot = ast_channel_internal_snapshot(chan);
+	if (snapshot && channel_snapshot_is_current(snapshot, chan)) {
+		ao2_ref(snapshot, +1);
+	} else {
+		snapshot = ast_channel_snapshot_create(chan);
+		if (!snapshot) {
+			return;
+		}
+		ast_channel_internal_snapshot_set(chan, snapshot);
 	}
 
 	message = stasis_message_create(ast_channel_snapshot_type(), snapshot);
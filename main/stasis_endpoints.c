@@ -407,6 +407,7 @@ struct ast_json *ast_endpoint_snapshot_to_json(
 	const struct stasis_message_sanitizer *sanitize)
 {
 	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	RAII_VAR(struct ast_endpoint_channel_ids *, channel_ids, NULL, ao2_cleanup);
 	struct ast_json *channel_array;
 	int i;
 
@@ -428,18 +429,23 @@ struct ast_json *ast_endpoint_snapshot_to_json(
 		}
 	}
 
+	channel_ids = ast_endpoint_snapshot_channel_ids(snapshot);
+	if (!channel_ids) {
+		return NULL;
+	}
+
 	channel_array = ast_json_object_get(json, "channel_ids");
 	ast_assert(channel_array != NULL);
-	for (i = 0; i < snapshot->num_channels; ++i) {
+	for (i = 0; i < channel_ids->num_channels; ++i) {
 		int res;
 
 		if (sanitize && sanitize->channel_id
-			&& sanitize->channel_id(snapshot->channel_ids[i])) {
+			&& sanitize->channel_id(channel_ids->channel_ids[i])) {
 			continue;
 		}
 
 		res = ast_json_array_append(channel_array,
-			ast_json_string_create(snapshot->channel_ids[i]));
+			ast_json_string_create(channel_ids->channel_ids[i]));
 		if (res != 0) {
 			return NULL;
 		}
@@ -30,6 +30,7 @@
 #include "asterisk.h"
 
 #include "asterisk/astobj2.h"
+#include "asterisk/json.h"
 #include "asterisk/stasis.h"
 #include "asterisk/utils.h"
 
@@ -37,9 +38,11 @@
 struct stasis_message_type {
 	struct stasis_message_vtable *vtable;
 	char *name;
+	int id;
 };
 
 static struct stasis_message_vtable null_vtable = {};
+static int message_type_id;
 
 static void message_type_dtor(void *obj)
 {
@@ -74,6 +77,7 @@ int stasis_message_type_create(const char *name,
 		return STASIS_MESSAGE_TYPE_ERROR;
 	}
 	type->vtable = vtable;
+	type->id = ast_atomic_fetchadd_int(&message_type_id, +1);
 	*result = type;
 
 	return STASIS_MESSAGE_TYPE_SUCCESS;
@@ -84,6 +88,11 @@ const char *stasis_message_type_name(const struct stasis_message_type *type)
 	return type->name;
 }
 
+int stasis_message_type_id(const struct stasis_message_type *type)
+{
+	return type->id;
+}
+
 /*! \internal */
 struct stasis_message {
 	/*! Time the message was created */
@@ -96,6 +105,17 @@ struct stasis_message {
 	void *data;
 	/*! Where this message originated. */
 	struct ast_eid eid;
+	/*! AMI representation, valid once ami_rendered is set */
+	struct ast_manager_event_blob *ami;
+	/*! JSON representation without a sanitizer, valid once json_rendered is set */
+	struct ast_json *json;
+	/*! JSON representation with json_sanitizer, valid once sanitized_rendered is set */
+	struct ast_json *sanitized_json;
+	/*! Sanitizer sanitized_json was rendered with */
+	struct stasis_message_sanitizer *json_sanitizer;
+	unsigned int ami_rendered:1;
+	unsigned int json_rendered:1;
+	unsigned int sanitized_rendered:1;
 };
 
 static void stasis_message_dtor(void *obj)
@@ -103,6 +123,9 @@ static void stasis_message_dtor(void *obj)
 	struct stasis_message *message = obj;
 	ao2_cleanup(message->type);
 	ao2_cleanup(message->data);
+	ao2_cleanup(message->ami);
+	ast_json_unref(message->json);
+	ast_json_unref(message->sanitized_json);
 }
 
 struct stasis_message *stasis_message_create_full(struct stasis_message_type *type, void *data, const struct ast_eid *eid)
@@ -181,16 +204,122 @@ const struct timeval *stasis_message_timestamp(const struct stasis_message *msg)
 		msg->type->vtable->fn(__VA_ARGS__);		\
 	})
 
+/*
+ * Messages are immutable, so the AMI and JSON representations are
+ * rendered once by the first consumer and kept on the message for the
+ * others.  Rendering happens without the message locked; should two
+ * consumers race, the first rendering stored wins.
+ */
+
 struct ast_manager_event_blob *stasis_message_to_ami(struct stasis_message *msg)
 {
-	return INVOKE_VIRTUAL(to_ami, msg);
+	struct ast_manager_event_blob *ami;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	ao2_lock(msg);
+	if (msg->ami_rendered) {
+		ami = ao2_bump(msg->ami);
+		ao2_unlock(msg);
+		return ami;
+	}
+	ao2_unlock(msg);
+
+	ami = INVOKE_VIRTUAL(to_ami, msg);
+
+	ao2_lock(msg);
+	if (msg->ami_rendered) {
+		ao2_cleanup(ami);
+		ami = msg->ami;
+	} else {
+		msg->ami = ami;
+		msg->ami_rendered = 1;
+	}
+	ao2_bump(ami);
+	ao2_unlock(msg);
+
+	return ami;
+}
+
+/*!
+ * \internal
+ * \brief Get where the JSON rendering of a message with a sanitizer is kept.
+ *
+ * \param msg Message being rendered.
+ * \param sanitize Sanitizer it is rendered with.
+ * \param[out] rendered Set to where the rendered flag lives.
+ *
+ * \note Must be called with the message locked.
+ *
+ * \retval Slot for the rendering.
+ * \retval NULL if the rendering cannot be kept.
+ */
+static struct ast_json **message_json_slot(struct stasis_message *msg,
+	struct stasis_message_sanitizer *sanitize, int *rendered)
+{
+	if (!sanitize) {
+		*rendered = msg->json_rendered;
+		return &msg->json;
+	}
+
+	/* Only one sanitizer is in use in practice, the one of ARI. */
+	if (!msg->json_sanitizer) {
+		msg->json_sanitizer = sanitize;
+	}
+	if (msg->json_sanitizer != sanitize) {
+		return NULL;
+	}
+	*rendered = msg->sanitized_rendered;
+	return &msg->sanitized_json;
 }
 
 struct ast_json *stasis_message_to_json(
 	struct stasis_message *msg,
 	struct stasis_message_sanitizer *sanitize)
 {
-	return INVOKE_VIRTUAL(to_json, msg, sanitize);
+	struct ast_json **slot;
+	struct ast_json *json;
+	int rendered = 0;
+
+	if (!msg) {
+		return NULL;
+	}
+
+	ao2_lock(msg);
+	slot = message_json_slot(msg, sanitize, &rendered);
+	if (slot && rendered) {
+		/*
+		 * Consumers add to the JSON they get and dump it concurrently,
+		 * so each gets a copy it does not share with the others.
+		 */
+		json = *slot ? ast_json_deep_copy(*slot) : NULL;
+		ao2_unlock(msg);
+		return json;
+	}
+	ao2_unlock(msg);
+
+	json = INVOKE_VIRTUAL(to_json, msg, sanitize);
+	if (!slot) {
+		return json;
+	}
+
+	ao2_lock(msg);
+	slot = message_json_slot(msg, sanitize, &rendered);
+	if (slot && !rendered) {
+		*slot = json ? ast_json_deep_copy(json) : NULL;
+		if (!json || *slot) {
+			if (sanitize) {
+				msg->sanitized_rendered = 1;
+			} else {
+				msg->json_rendered = 1;
+			}
+		}
+	}
+	ao2_unlock(msg);
+
+	return json;
 }
 
 struct ast_event *stasis_message_to_event(struct stasis_message *msg)
@@ -43,22 +43,48 @@ struct stasis_message_route {
 	void *data;
 };
 
-AST_VECTOR(route_table, struct stasis_message_route);
+/*!
+ * Message types with ids below this are routed through a table indexed by
+ * their id.  Types created later, such as by reloaded modules, are routed
+ * through a linear table instead.
+ */
+#define ROUTE_TABLE_INDEXED_MAX 1024
+
+/*! \internal */
+struct route_table {
+	/*! Routes indexed by message type id.  Unused entries have no message_type. */
+	AST_VECTOR(, struct stasis_message_route) indexed;
+	/*! Routes of message types with ids of ROUTE_TABLE_INDEXED_MAX or more. */
+	AST_VECTOR(, struct stasis_message_route) linear;
+};
+
+static int route_table_init(struct route_table *table)
+{
+	int res = 0;
+
+	res |= AST_VECTOR_INIT(&table->indexed, 0);
+	res |= AST_VECTOR_INIT(&table->linear, 0);
+	return res;
+}
 
 static struct stasis_message_route *route_table_find(struct route_table *table,
 	struct stasis_message_type *message_type)
 {
+	int id = stasis_message_type_id(message_type);
 	size_t idx;
 	struct stasis_message_route *route;
 
-	/* While a linear search for routes may seem very inefficient, most
-	 * route tables have six routes or less. For such small data, it's
-	 * hard to beat a linear search. If we start having larger route
-	 * tables, then we can look into containers with more efficient
-	 * lookups.
-	 */
-	for (idx = 0; idx < AST_VECTOR_SIZE(table); ++idx) {
-		route = AST_VECTOR_GET_ADDR(table, idx);
+	if (id < ROUTE_TABLE_INDEXED_MAX) {
+		if (id >= AST_VECTOR_SIZE(&table->indexed)) {
+			return NULL;
+		}
+		route = AST_VECTOR_GET_ADDR(&table->indexed, id);
+		return route->message_type ? route : NULL;
+	}
+
+	/* Few message types are created late enough to get here. */
+	for (idx = 0; idx < AST_VECTOR_SIZE(&table->linear); ++idx) {
+		route = AST_VECTOR_GET_ADDR(&table->linear, idx);
 		if (route->message_type == message_type) {
 			return route;
 		}
@@ -90,8 +116,20 @@ static struct stasis_message_route *route_table_find(struct route_table *table,
 static int route_table_remove(struct route_table *table,
 	struct stasis_message_type *message_type)
 {
-	return AST_VECTOR_REMOVE_CMP_UNORDERED(table, message_type, ROUTE_TABLE_ELEM_CMP,
-		ROUTE_TABLE_ELEM_CLEANUP);
+	struct stasis_message_route *route;
+
+	if (stasis_message_type_id(message_type) >= ROUTE_TABLE_INDEXED_MAX) {
+		return AST_VECTOR_REMOVE_CMP_UNORDERED(&table->linear, message_type,
+			ROUTE_TABLE_ELEM_CMP, ROUTE_TABLE_ELEM_CLEANUP);
+	}
+
+	route = route_table_find(table, message_type);
+	if (!route) {
+		return -1;
+	}
+	ROUTE_TABLE_ELEM_CLEANUP(*route);
+	memset(route, 0, sizeof(*route));
+	return 0;
 }
 
 static int route_table_add(struct route_table *table,
@@ -99,6 +137,7 @@ static int route_table_add(struct route_table *table,
 	stasis_subscription_cb callback, void *data)
 {
 	struct stasis_message_route route;
+	int id = stasis_message_type_id(message_type);
 	int res;
 
 	ast_assert(callback != NULL);
@@ -108,7 +147,12 @@ static int route_table_add(struct route_table *table,
 	route.callback = callback;
 	route.data = data;
 
-	res = AST_VECTOR_APPEND(table, route);
+	if (id < ROUTE_TABLE_INDEXED_MAX) {
+		/* Growing the vector zero fills it, leaving the types in between unrouted. */
+		res = AST_VECTOR_REPLACE(&table->indexed, id, route);
+	} else {
+		res = AST_VECTOR_APPEND(&table->linear, route);
+	}
 	if (res) {
 		ROUTE_TABLE_ELEM_CLEANUP(route);
 	}
@@ -120,11 +164,17 @@ static void route_table_dtor(struct route_table *table)
 	size_t idx;
 	struct stasis_message_route *route;
 
-	for (idx = 0; idx < AST_VECTOR_SIZE(table); ++idx) {
-		route = AST_VECTOR_GET_ADDR(table, idx);
+	for (idx = 0; idx < AST_VECTOR_SIZE(&table->indexed); ++idx) {
+		route = AST_VECTOR_GET_ADDR(&table->indexed, idx);
+		ROUTE_TABLE_ELEM_CLEANUP(*route);
+	}
+	AST_VECTOR_FREE(&table->indexed);
+
+	for (idx = 0; idx < AST_VECTOR_SIZE(&table->linear); ++idx) {
+		route = AST_VECTOR_GET_ADDR(&table->linear, idx);
 		ROUTE_TABLE_ELEM_CLEANUP(*route);
 	}
-	AST_VECTOR_FREE(table);
+	AST_VECTOR_FREE(&table->linear);
 }
 
 /*! \internal */
@@ -216,8 +266,8 @@ static struct stasis_message_router *stasis_message_router_create_internal(
 	}
 
 	res = 0;
-	res |= AST_VECTOR_INIT(&router->routes, 0);
-	res |= AST_VECTOR_INIT(&router->cache_routes, 0);
+	res |= route_table_init(&router->routes);
+	res |= route_table_init(&router->cache_routes);
 	if (res) {
 		return NULL;
 	}
@@ -299,6 +349,18 @@ int stasis_message_router_set_congestion_limits(struct stasis_message_router *ro
 	return res;
 }
 
+int stasis_message_router_set_congestion_policy(struct stasis_message_router *router,
+	enum stasis_subscription_congestion_policy policy, unsigned int max_wait_ms)
+{
+	int res = -1;
+
+	if (router) {
+		res = stasis_subscription_set_congestion_policy(router->subscription,
+			policy, max_wait_ms);
+	}
+	return res;
+}
+
 int stasis_message_router_add(struct stasis_message_router *router,
 	struct stasis_message_type *message_type,
 	stasis_subscription_cb callback, void *data)
@@ -313,6 +375,13 @@ int stasis_message_router_add(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->routes, message_type, callback, data);
+	if (!res) {
+		stasis_subscription_accept_message_type(router->subscription, message_type);
+		/* Until a default route is added we know we can be selective */
+		if (!router->default_route.callback) {
+			stasis_subscription_set_filter(router->subscription, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
+		}
+	}
 	ao2_unlock(router);
 	return res;
 }
@@ -331,6 +400,13 @@ int stasis_message_router_add_cache_update(struct stasis_message_router *router,
 	}
 	ao2_lock(router);
 	res = route_table_add(&router->cache_routes, message_type, callback, data);
+	if (!res) {
+		stasis_subscription_accept_message_type(router->subscription, stasis_cache_update_type());
+		/* Until a default route is added we know we can be selective */
+		if (!router->default_route.callback) {
+			stasis_subscription_set_filter(router->subscription, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
+		}
+	}
 	ao2_unlock(router);
 	return res;
 }
@@ -374,6 +450,8 @@ int stasis_message_router_set_default(struct stasis_message_router *router,
 	ao2_lock(router);
 	router->default_route.callback = callback;
 	router->default_route.data = data;
+	/* The default route wants every message, so nothing can be filtered */
+	stasis_subscription_set_filter(router->subscription, STASIS_SUBSCRIPTION_FILTER_FORCED_NONE);
 	ao2_unlock(router);
 	/* While this implementation can never fail, it used to be able to */
 	return 0;
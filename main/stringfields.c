@@ -25,6 +25,7 @@
 
 #include "asterisk.h"
 
+#include "asterisk/arena.h"
 #include "asterisk/stringfields.h"
 #include "asterisk/utils.h"
 
@@ -71,11 +72,19 @@ static int add_string_pool(struct ast_string_field_mgr *mgr, struct ast_string_f
 	struct ast_string_field_pool *pool;
 	size_t alloc_size = optimal_alloc_size(sizeof(*pool) + size);
 
-	if (!(pool = calloc_wrapper(1, alloc_size, file, lineno, func))) {
+	if (mgr->arena) {
+		/* Arena size classes are powers of two without allocator overhead. */
+		alloc_size += ALLOCATOR_OVERHEAD;
+		pool = ast_arena_calloc(mgr->arena, alloc_size);
+	} else {
+		pool = calloc_wrapper(1, alloc_size, file, lineno, func);
+	}
+	if (!pool) {
 		return -1;
 	}
 
 	pool->prev = *pool_head;
+	pool->arena = mgr->arena;
 	pool->size = alloc_size - sizeof(*pool);
 	*pool_head = pool;
 	mgr->last_alloc = NULL;
@@ -83,6 +92,16 @@ static int add_string_pool(struct ast_string_field_mgr *mgr, struct ast_string_f
 	return 0;
 }
 
+/*! \brief give a pool back to wherever it was allocated from */
+static void free_string_pool(struct ast_string_field_pool *pool)
+{
+	if (pool->arena) {
+		ast_arena_release(pool->arena, pool, sizeof(*pool) + pool->size);
+	} else {
+		ast_free(pool);
+	}
+}
+
 static void reset_field(const char **p)
 {
 	*p = __ast_string_field_empty;
@@ -147,7 +166,7 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
 		struct ast_string_field_pool *prev = cur->prev;
 
 		if (cur != preserve) {
-			ast_free(cur);
+			free_string_pool(cur);
 		}
 		cur = prev;
 	}
@@ -175,6 +194,12 @@ int __ast_string_field_free_memory(struct ast_string_field_mgr *mgr,
  */
 int __ast_string_field_init(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head,
 	int needed, const char *file, int lineno, const char *func)
+{
+	return __ast_string_field_init_arena(mgr, pool_head, needed, NULL, file, lineno, func);
+}
+
+int __ast_string_field_init_arena(struct ast_string_field_mgr *mgr, struct ast_string_field_pool **pool_head,
+	int needed, struct ast_arena *arena, const char *file, int lineno, const char *func)
 {
 	const char **p = (const char **) pool_head + 1;
 	size_t initial_vector_size = ((size_t) (((char *)mgr) - ((char *)p))) / sizeof(*p);
@@ -184,6 +209,7 @@ int __ast_string_field_init(struct ast_string_field_mgr *mgr, struct ast_string_
 	}
 
 	mgr->last_alloc = NULL;
+	mgr->arena = arena;
 #if defined(__AST_DEBUG_MALLOC)
 	mgr->owner_file = file;
 	mgr->owner_func = func;
@@ -286,7 +312,7 @@ void __ast_string_field_release_active(struct ast_string_field_pool *pool_head,
 			if (pool->active == 0) {
 				if (prev) {
 					prev->prev = pool->prev;
-					ast_free(pool);
+					free_string_pool(pool);
 				} else {
 					pool->used = 0;
 				}
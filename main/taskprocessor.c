@@ -27,15 +27,37 @@
 	<support_level>core</support_level>
  ***/
 
+/*** DOCUMENTATION
+	<manager name="TaskprocessorLatencyList" language="en_US">
+		<synopsis>
+			List the latency statistics of the taskprocessors.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+		</syntax>
+		<description>
+			<para>Lists how long the tasks of each taskprocessor waited in its
+			queue and took to execute, as histograms of counts of tasks taking
+			less than 100us, 1ms, 10ms, 100ms, 1s, and longer.  A
+			<literal>TaskprocessorLatency</literal> event is sent for each
+			taskprocessor followed by a <literal>TaskprocessorLatencyListComplete</literal>
+			event.</para>
+		</description>
+	</manager>
+ ***/
+
 #include "asterisk.h"
 
 #include "asterisk/_private.h"
 #include "asterisk/module.h"
 #include "asterisk/time.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/backtrace.h"
 #include "asterisk/cli.h"
+#include "asterisk/manager.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/sem.h"
+#include "asterisk/thread_placement.h"
 
 /*!
  * \brief tps_task structure is queued to a taskprocessor
@@ -52,19 +74,39 @@ struct tps_task {
 	} callback;
 	/*! \brief The data pointer for the task execute() function */
 	void *datap;
+	/*! \brief Releases datap if the task is dropped, NULL if it cannot be */
+	void (*release)(void *datap);
 	/*! \brief AST_LIST_ENTRY overhead */
 	AST_LIST_ENTRY(tps_task) list;
+	/*! \brief When the task was pushed */
+	struct timeval enqueued;
 	unsigned int wants_local:1;
 };
 
+/*! Most executed tasks a taskprocessor keeps for reuse by later pushes. */
+#define TPS_TASK_CACHE_MAX 32
+
+/*! Most tasks the default listener thread executes between checks for death. */
+#define TPS_DEFAULT_BATCH 64
+
 /*! \brief tps_taskprocessor_stats maintain statistics for a taskprocessor. */
 struct tps_taskprocessor_stats {
 	/*! \brief This is the maximum number of tasks queued at any one time */
 	unsigned long max_qsize;
 	/*! \brief This is the current number of tasks processed */
 	unsigned long _tasks_processed_count;
+	/*! \brief Queue wait and execution times */
+	struct ast_taskprocessor_latency latency;
+};
+
+/*! \brief Labels of the latency histogram buckets */
+static const char * const tps_latency_labels[AST_TASKPROCESSOR_LATENCY_BUCKETS] = {
+	"lt_100us", "lt_1ms", "lt_10ms", "lt_100ms", "lt_1s", "ge_1s",
 };
 
+/*! \brief Microseconds a task may execute before it is logged, 0 to not log. */
+static unsigned int tps_slow_task_us;
+
 /*! \brief A ast_taskprocessor structure is a singleton by name */
 struct ast_taskprocessor {
 	/*! \brief Friendly name of the taskprocessor */
@@ -78,8 +120,18 @@ struct ast_taskprocessor {
 	long tps_queue_low;
 	/*! \brief Taskprocessor high water alert trigger level */
 	long tps_queue_high;
+	/*! \brief What pushes do while the high water alert is active */
+	enum ast_taskprocessor_overload_policy overload_policy;
+	/*! \brief Longest a blocked pusher waits, 0 for no limit */
+	unsigned int overload_wait_ms;
+	/*! \brief Signaled when the high water alert clears */
+	ast_cond_t overload_cond;
 	/*! \brief Taskprocessor queue */
 	AST_LIST_HEAD_NOLOCK(tps_queue, tps_task) tps_queue;
+	/*! \brief Executed tasks kept for reuse */
+	AST_LIST_HEAD_NOLOCK(, tps_task) task_cache;
+	/*! \brief Number of tasks in task_cache */
+	unsigned int task_cache_size;
 	struct ast_taskprocessor_listener *listener;
 	/*! Current thread executing the tasks */
 	pthread_t thread;
@@ -89,6 +141,8 @@ struct ast_taskprocessor {
 	unsigned int high_water_warned:1;
 	/*! Indicates that a high water alert is active on this taskprocessor */
 	unsigned int high_water_alert:1;
+	/*! Indicates that dropped tasks have been logged during this high water alert */
+	unsigned int overload_warned:1;
 	/*! Indicates if the taskprocessor is currently suspended */
 	unsigned int suspended:1;
 };
@@ -132,10 +186,18 @@ static int tps_ping_handler(void *datap);
 
 static char *cli_tps_ping(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
 static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
+static char *cli_tps_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
+static char *cli_tps_latency_histogram(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
+static char *cli_tps_slow_task(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a);
+
+static int manager_tps_latency_list(struct mansession *s, const struct message *m);
 
 static struct ast_cli_entry taskprocessor_clis[] = {
 	AST_CLI_DEFINE(cli_tps_ping, "Ping a named task processor"),
 	AST_CLI_DEFINE(cli_tps_report, "List instantiated task processors and statistics"),
+	AST_CLI_DEFINE(cli_tps_latency, "List task processor queue wait and execution times"),
+	AST_CLI_DEFINE(cli_tps_latency_histogram, "Show the latency histograms of a task processor"),
+	AST_CLI_DEFINE(cli_tps_slow_task, "Log task processor tasks that take too long"),
 };
 
 struct default_taskprocessor_listener_pvt {
@@ -172,6 +234,8 @@ static void *default_tps_processing_function(void *data)
 	int sem_value;
 	int res;
 
+	ast_thread_place(AST_THREAD_ROLE_TASKPROCESSOR, -1);
+
 	while (!pvt->dead) {
 		res = ast_sem_wait(&pvt->sem);
 		if (res != 0 && errno != EINTR) {
@@ -180,7 +244,9 @@ static void *default_tps_processing_function(void *data)
 			/* Just give up */
 			break;
 		}
-		ast_taskprocessor_execute(tps);
+		/* We are only woken when the queue becomes non-empty so drain it. */
+		while (ast_taskprocessor_execute_batch(tps, TPS_DEFAULT_BATCH) && !pvt->dead) {
+		}
 	}
 
 	/* No posting to a dead taskprocessor! */
@@ -208,6 +274,11 @@ static void default_task_pushed(struct ast_taskprocessor_listener *listener, int
 {
 	struct default_taskprocessor_listener_pvt *pvt = listener->user_data;
 
+	if (!was_empty) {
+		/* The processing thread is already draining the queue. */
+		return;
+	}
+
 	if (ast_sem_post(&pvt->sem) != 0) {
 		ast_log(LOG_ERROR, "Failed to notify of enqueued task: %s\n",
 			strerror(errno));
@@ -260,6 +331,7 @@ static const struct ast_taskprocessor_listener_callbacks default_listener_callba
  */
 static void tps_shutdown(void)
 {
+	ast_manager_unregister("TaskprocessorLatencyList");
 	ast_cli_unregister_multiple(taskprocessor_clis, ARRAY_LEN(taskprocessor_clis));
 	ao2_t_ref(tps_singletons, -1, "Unref tps_singletons in shutdown");
 	tps_singletons = NULL;
@@ -276,52 +348,64 @@ int ast_tps_init(void)
 	ast_cond_init(&cli_ping_cond, NULL);
 
 	ast_cli_register_multiple(taskprocessor_clis, ARRAY_LEN(taskprocessor_clis));
+	ast_manager_register_xml_core("TaskprocessorLatencyList", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING,
+		manager_tps_latency_list);
 
 	ast_register_cleanup(tps_shutdown);
 
 	return 0;
 }
 
-/* allocate resources for the task */
-static struct tps_task *tps_task_alloc(int (*task_exe)(void *datap), void *datap)
+/*!
+ * \internal
+ * \brief Get a task for a push, reusing an executed one if possible.
+ *
+ * \param tps Taskprocessor the task will be pushed to.
+ *
+ * \note Must be called with the taskprocessor locked.  The lock may be
+ * released and obtained again while a new task is allocated.
+ *
+ * \retval task on success.
+ * \retval NULL on error.
+ */
+static struct tps_task *tps_task_get(struct ast_taskprocessor *tps)
 {
 	struct tps_task *t;
-	if (!task_exe) {
-		ast_log(LOG_ERROR, "task_exe is NULL!\n");
-		return NULL;
+
+	t = AST_LIST_REMOVE_HEAD(&tps->task_cache, list);
+	if (t) {
+		--tps->task_cache_size;
+		return t;
 	}
 
+	ao2_unlock(tps);
 	t = ast_calloc(1, sizeof(*t));
+	ao2_lock(tps);
 	if (!t) {
 		ast_log(LOG_ERROR, "failed to allocate task!\n");
-		return NULL;
 	}
-
-	t->callback.execute = task_exe;
-	t->datap = datap;
-
 	return t;
 }
 
-static struct tps_task *tps_task_alloc_local(int (*task_exe)(struct ast_taskprocessor_local *local), void *datap)
+/*!
+ * \internal
+ * \brief Keep an executed task for reuse or free it.
+ *
+ * \param tps Taskprocessor the task was executed by.
+ * \param task Task to put away.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \return Nothing
+ */
+static void tps_task_put(struct ast_taskprocessor *tps, struct tps_task *task)
 {
-	struct tps_task *t;
-	if (!task_exe) {
-		ast_log(LOG_ERROR, "task_exe is NULL!\n");
-		return NULL;
-	}
-
-	t = ast_calloc(1, sizeof(*t));
-	if (!t) {
-		ast_log(LOG_ERROR, "failed to allocate task!\n");
-		return NULL;
+	if (tps->task_cache_size < TPS_TASK_CACHE_MAX) {
+		AST_LIST_INSERT_HEAD(&tps->task_cache, task, list);
+		++tps->task_cache_size;
+		return;
 	}
-
-	t->callback.execute_local = task_exe;
-	t->datap = datap;
-	t->wants_local = 1;
-
-	return t;
+	ast_free(task);
 }
 
 /* release task resources */
@@ -522,6 +606,242 @@ static char *cli_tps_report(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	return CLI_SUCCESS;
 }
 
+const char *ast_taskprocessor_latency_bucket_label(unsigned int bucket)
+{
+	return bucket < AST_TASKPROCESSOR_LATENCY_BUCKETS ? tps_latency_labels[bucket] : "";
+}
+
+int ast_taskprocessor_latency_foreach(int (*cb)(const char *name,
+	const struct ast_taskprocessor_latency *latency, void *arg), void *arg)
+{
+	struct ao2_container *sorted_tps;
+	struct ast_taskprocessor *tps;
+	struct ao2_iterator iter;
+	struct ast_taskprocessor_latency latency;
+	char name[256];
+	int stop = 0;
+
+	sorted_tps = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, tps_sort_cb,
+		NULL);
+	if (!sorted_tps
+		|| ao2_container_dup(sorted_tps, tps_singletons, 0)) {
+		ao2_cleanup(sorted_tps);
+		return -1;
+	}
+
+	iter = ao2_iterator_init(sorted_tps, AO2_ITERATOR_UNLINK);
+	while ((tps = ao2_iterator_next(&iter))) {
+		if (!stop) {
+			ao2_lock(tps);
+			ast_copy_string(name, tps->name, sizeof(name));
+			if (tps->stats) {
+				latency = tps->stats->latency;
+				latency.processed = tps->stats->_tasks_processed_count;
+				latency.max_qsize = tps->stats->max_qsize;
+			} else {
+				memset(&latency, 0, sizeof(latency));
+			}
+			latency.queued = tps->tps_queue_size;
+			ao2_unlock(tps);
+
+			stop = cb(name, &latency, arg);
+		}
+		ast_taskprocessor_unreference(tps);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_ref(sorted_tps, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Print one row of "core show taskprocessors latency".
+ */
+static int tps_latency_cli_row(const char *name, const struct ast_taskprocessor_latency *latency, void *arg)
+{
+	struct ast_cli_args *a = arg;
+
+	ast_cli(a->fd, "%-45s %10lu %10lu %10lu %10lu %10lu\n", name, latency->processed,
+		latency->processed ? (unsigned long) (latency->wait_total_us / latency->processed) : 0UL,
+		latency->wait_max_us,
+		latency->processed ? (unsigned long) (latency->exec_total_us / latency->processed) : 0UL,
+		latency->exec_max_us);
+	return 0;
+}
+
+static char *cli_tps_latency(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show taskprocessors latency";
+		e->usage =
+			"Usage: core show taskprocessors latency\n"
+			"	Shows the average and longest times in microseconds the tasks\n"
+			"	of each task processor waited in its queue and took to execute\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "\n%-45s %10s %10s %10s %10s %10s\n", "Processor", "Processed",
+		"Avg wait", "Max wait", "Avg exec", "Max exec");
+	if (ast_taskprocessor_latency_foreach(tps_latency_cli_row, a)) {
+		return CLI_FAILURE;
+	}
+	ast_cli(a->fd, "\n");
+	return CLI_SUCCESS;
+}
+
+static char *cli_tps_latency_histogram(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct ast_taskprocessor *tps;
+	struct ast_taskprocessor_latency latency;
+	int i;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show taskprocessor latency";
+		e->usage =
+			"Usage: core show taskprocessor latency <taskprocessor>\n"
+			"	Shows how many tasks of a task processor waited in its queue\n"
+			"	and took to execute for less than each of the listed times\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 4) {
+			return tps_taskprocessor_tab_complete(a);
+		}
+		return NULL;
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	tps = ast_taskprocessor_get(a->argv[4], TPS_REF_IF_EXISTS);
+	if (!tps) {
+		ast_cli(a->fd, "\nThe task processor '%s' does not exist.\n\n", a->argv[4]);
+		return CLI_SUCCESS;
+	}
+	ao2_lock(tps);
+	if (tps->stats) {
+		latency = tps->stats->latency;
+	} else {
+		memset(&latency, 0, sizeof(latency));
+	}
+	ao2_unlock(tps);
+	ast_taskprocessor_unreference(tps);
+
+	ast_cli(a->fd, "\n%-10s %12s %12s\n", "Time", "Waited", "Executed");
+	for (i = 0; i < AST_TASKPROCESSOR_LATENCY_BUCKETS; ++i) {
+		ast_cli(a->fd, "%-10s %12lu %12lu\n", tps_latency_labels[i],
+			latency.wait_histogram[i], latency.exec_histogram[i]);
+	}
+	ast_cli(a->fd, "\n");
+	return CLI_SUCCESS;
+}
+
+static char *cli_tps_slow_task(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int ms;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core set taskprocessor slowtask";
+		e->usage =
+			"Usage: core set taskprocessor slowtask {<milliseconds>|off}\n"
+			"	Log a warning naming the task function whenever a task processor\n"
+			"	task takes at least the given time to execute\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 5) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (!strcasecmp(a->argv[4], "off")) {
+		tps_slow_task_us = 0;
+		ast_cli(a->fd, "Slow task processor task logging disabled\n");
+	} else if (sscanf(a->argv[4], "%30u", &ms) == 1 && ms) {
+		tps_slow_task_us = ms * 1000;
+		ast_cli(a->fd, "Logging task processor tasks taking %ums or more\n", ms);
+	} else {
+		return CLI_SHOWUSAGE;
+	}
+	return CLI_SUCCESS;
+}
+
+/*! \brief Where the AMI latency events go */
+struct tps_latency_ami {
+	struct mansession *s;
+	const char *id_text;
+	int count;
+};
+
+/*!
+ * \internal
+ * \brief Send the TaskprocessorLatency event of a taskprocessor.
+ */
+static int tps_latency_ami_event(const char *name, const struct ast_taskprocessor_latency *latency, void *arg)
+{
+	struct tps_latency_ami *ami = arg;
+	struct ast_str *buckets = ast_str_alloca(512);
+	int i;
+
+	for (i = 0; i < AST_TASKPROCESSOR_LATENCY_BUCKETS; ++i) {
+		ast_str_append(&buckets, 0, "Wait_%s: %lu\r\n", tps_latency_labels[i], latency->wait_histogram[i]);
+	}
+	for (i = 0; i < AST_TASKPROCESSOR_LATENCY_BUCKETS; ++i) {
+		ast_str_append(&buckets, 0, "Exec_%s: %lu\r\n", tps_latency_labels[i], latency->exec_histogram[i]);
+	}
+
+	astman_append(ami->s,
+		"Event: TaskprocessorLatency\r\n"
+		"%s"
+		"Name: %s\r\n"
+		"Processed: %lu\r\n"
+		"InQueue: %ld\r\n"
+		"MaxDepth: %lu\r\n"
+		"Dropped: %lu\r\n"
+		"WaitTotalUS: %" PRIu64 "\r\n"
+		"WaitMaxUS: %lu\r\n"
+		"ExecTotalUS: %" PRIu64 "\r\n"
+		"ExecMaxUS: %lu\r\n"
+		"%s"
+		"\r\n",
+		ami->id_text, name, latency->processed, latency->queued, latency->max_qsize,
+		latency->dropped,
+		latency->wait_total_us, latency->wait_max_us,
+		latency->exec_total_us, latency->exec_max_us,
+		ast_str_buffer(buckets));
+	++ami->count;
+	return 0;
+}
+
+static int manager_tps_latency_list(struct mansession *s, const struct message *m)
+{
+	const char *id = astman_get_header(m, "ActionID");
+	char id_text[256] = "";
+	struct tps_latency_ami ami = { .s = s, .id_text = id_text, };
+
+	if (!ast_strlen_zero(id)) {
+		snprintf(id_text, sizeof(id_text), "ActionID: %s\r\n", id);
+	}
+
+	astman_send_listack(s, m, "Taskprocessor latency will follow", "start");
+	ast_taskprocessor_latency_foreach(tps_latency_ami_event, &ami);
+	astman_send_list_complete_start(s, m, "TaskprocessorLatencyListComplete", ami.count);
+	astman_send_list_complete_end(s);
+
+	return 0;
+}
+
 /* hash callback for astobj2 */
 static int tps_hash_cb(const void *obj, const int flags)
 {
@@ -572,6 +892,26 @@ static void tps_alert_add(struct ast_taskprocessor *tps, int delta)
 	ast_rwlock_unlock(&tps_alert_lock);
 }
 
+/*!
+ * \internal
+ * \brief Clear the high water alert of a taskprocessor.
+ *
+ * \param tps Taskprocessor whose queue drained.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \return Nothing
+ */
+static void tps_alert_clear(struct ast_taskprocessor *tps)
+{
+	tps->high_water_alert = 0;
+	tps->overload_warned = 0;
+	tps_alert_add(tps, -1);
+
+	/* Wake any pushers waiting for the queue to drain. */
+	ast_cond_broadcast(&tps->overload_cond);
+}
+
 unsigned int ast_taskprocessor_alert_get(void)
 {
 	unsigned int count;
@@ -602,8 +942,7 @@ int ast_taskprocessor_alert_set_levels(struct ast_taskprocessor *tps, long low_w
 	if (tps->high_water_alert) {
 		if (!tps->tps_queue_size || tps->tps_queue_size < low_water) {
 			/* Update water mark alert immediately */
-			tps->high_water_alert = 0;
-			tps_alert_add(tps, -1);
+			tps_alert_clear(tps);
 		}
 	} else {
 		if (high_water < tps->tps_queue_size) {
@@ -628,12 +967,17 @@ static void tps_taskprocessor_dtor(void *tps)
 		tps_task_free(task);
 	}
 	t->tps_queue_size = 0;
+	while ((task = AST_LIST_REMOVE_HEAD(&t->task_cache, list))) {
+		tps_task_free(task);
+	}
+	t->task_cache_size = 0;
 
 	if (t->high_water_alert) {
 		t->high_water_alert = 0;
 		tps_alert_add(t, -1);
 	}
 
+	ast_cond_destroy(&t->overload_cond);
 	ast_free(t->stats);
 	t->stats = NULL;
 	ast_free((char *) t->name);
@@ -650,8 +994,7 @@ static struct tps_task *tps_taskprocessor_pop(struct ast_taskprocessor *tps)
 	if ((task = AST_LIST_REMOVE_HEAD(&tps->tps_queue, list))) {
 		--tps->tps_queue_size;
 		if (tps->high_water_alert && tps->tps_queue_size <= tps->tps_queue_low) {
-			tps->high_water_alert = 0;
-			tps_alert_add(tps, -1);
+			tps_alert_clear(tps);
 		}
 	}
 	return task;
@@ -742,6 +1085,7 @@ static struct ast_taskprocessor *__allocate_taskprocessor(const char *name, stru
 	/* Set default congestion water level alert triggers. */
 	p->tps_queue_low = (AST_TASKPROCESSOR_HIGH_WATER_LEVEL * 9) / 10;
 	p->tps_queue_high = AST_TASKPROCESSOR_HIGH_WATER_LEVEL;
+	ast_cond_init(&p->overload_cond, NULL);
 
 	p->stats = ast_calloc(1, sizeof(*p->stats));
 	p->name = ast_strdup(name);
@@ -861,9 +1205,95 @@ void *ast_taskprocessor_unreference(struct ast_taskprocessor *tps)
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief Wait for the high water alert of a taskprocessor to clear.
+ *
+ * \param tps Taskprocessor with the blocking overload policy.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \return Nothing
+ */
+static void tps_overload_wait(struct ast_taskprocessor *tps)
+{
+	struct timeval deadline;
+	struct timespec ts;
+
+	deadline = ast_tvadd(ast_tvnow(), ast_samp2tv(tps->overload_wait_ms, 1000));
+	ts.tv_sec = deadline.tv_sec;
+	ts.tv_nsec = deadline.tv_usec * 1000;
+
+	while (tps->high_water_alert && tps->overload_policy == AST_TASKPROCESSOR_OVERLOAD_BLOCK) {
+		if (!tps->overload_wait_ms) {
+			ast_cond_wait(&tps->overload_cond, ao2_object_get_lockaddr(tps));
+		} else if (ast_cond_timedwait(&tps->overload_cond, ao2_object_get_lockaddr(tps), &ts)
+			== ETIMEDOUT) {
+			break;
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Count a task dropped by the overload policy.
+ *
+ * \param tps Taskprocessor that dropped the task.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \return Nothing
+ */
+static void tps_overload_dropped(struct ast_taskprocessor *tps)
+{
+	if (tps->stats) {
+		++tps->stats->latency.dropped;
+	}
+	if (!tps->overload_warned) {
+		tps->overload_warned = 1;
+		ast_log(LOG_WARNING, "The '%s' task processor queue is congested, dropping tasks.\n",
+			tps->name);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Remove the oldest droppable task from a taskprocessor queue.
+ *
+ * \param tps Taskprocessor to remove the task from.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \retval task removed.
+ * \retval NULL if no queued task can be dropped.
+ */
+static struct tps_task *tps_overload_drop_oldest(struct ast_taskprocessor *tps)
+{
+	struct tps_task *t;
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&tps->tps_queue, t, list) {
+		if (t->release) {
+			AST_LIST_REMOVE_CURRENT(list);
+			--tps->tps_queue_size;
+			tps_overload_dropped(tps);
+			return t;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	return NULL;
+}
+
 /* push the task into the taskprocessor queue */
-static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
+static int taskprocessor_push(struct ast_taskprocessor *tps, int (*task_exe)(void *datap),
+	int (*task_exe_local)(struct ast_taskprocessor_local *local), void *datap,
+	void (*release)(void *datap))
 {
+	struct tps_task *t;
+	struct tps_task *dropped = NULL;
+	void (*dropped_release)(void *datap) = NULL;
+	void *dropped_datap = NULL;
+	struct timeval now;
 	int previous_size;
 	int was_empty;
 
@@ -872,12 +1302,61 @@ static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 		return -1;
 	}
 
-	if (!t) {
-		ast_log(LOG_ERROR, "t is NULL!\n");
+	if (!task_exe && !task_exe_local) {
+		ast_log(LOG_ERROR, "task_exe is NULL!\n");
 		return -1;
 	}
 
 	ao2_lock(tps);
+	switch (tps->overload_policy) {
+	case AST_TASKPROCESSOR_OVERLOAD_NONE:
+		break;
+	case AST_TASKPROCESSOR_OVERLOAD_BLOCK:
+		/* The taskprocessor's own thread would wait for itself. */
+		if (tps->high_water_alert && !pthread_equal(tps->thread, pthread_self())) {
+			tps_overload_wait(tps);
+		}
+		break;
+	case AST_TASKPROCESSOR_OVERLOAD_DROP_NEWEST:
+		if (release && tps->tps_queue_high <= tps->tps_queue_size) {
+			tps_overload_dropped(tps);
+			ao2_unlock(tps);
+			release(datap);
+			return 0;
+		}
+		break;
+	case AST_TASKPROCESSOR_OVERLOAD_DROP_OLDEST:
+		if (release && tps->tps_queue_high <= tps->tps_queue_size) {
+			dropped = tps_overload_drop_oldest(tps);
+			if (dropped) {
+				dropped_release = dropped->release;
+				dropped_datap = dropped->datap;
+				tps_task_put(tps, dropped);
+			}
+		}
+		break;
+	}
+
+	now = ast_tvnow();
+	t = tps_task_get(tps);
+	if (!t) {
+		ao2_unlock(tps);
+		if (dropped_release) {
+			dropped_release(dropped_datap);
+		}
+		return -1;
+	}
+	if (task_exe_local) {
+		t->callback.execute_local = task_exe_local;
+		t->wants_local = 1;
+	} else {
+		t->callback.execute = task_exe;
+		t->wants_local = 0;
+	}
+	t->datap = datap;
+	t->release = release;
+	t->enqueued = now;
+
 	AST_LIST_INSERT_TAIL(&tps->tps_queue, t, list);
 	previous_size = tps->tps_queue_size++;
 
@@ -896,18 +1375,51 @@ static int taskprocessor_push(struct ast_taskprocessor *tps, struct tps_task *t)
 	/* The currently executing task counts as still in queue */
 	was_empty = tps->executing ? 0 : previous_size == 0;
 	ao2_unlock(tps);
+	if (dropped_release) {
+		dropped_release(dropped_datap);
+	}
 	tps->listener->callbacks->task_pushed(tps->listener, was_empty);
 	return 0;
 }
 
 int ast_taskprocessor_push(struct ast_taskprocessor *tps, int (*task_exe)(void *datap), void *datap)
 {
-	return taskprocessor_push(tps, tps_task_alloc(task_exe, datap));
+	return taskprocessor_push(tps, task_exe, NULL, datap, NULL);
 }
 
 int ast_taskprocessor_push_local(struct ast_taskprocessor *tps, int (*task_exe)(struct ast_taskprocessor_local *datap), void *datap)
 {
-	return taskprocessor_push(tps, tps_task_alloc_local(task_exe, datap));
+	return taskprocessor_push(tps, NULL, task_exe, datap, NULL);
+}
+
+int ast_taskprocessor_push_droppable(struct ast_taskprocessor *tps,
+	int (*task_exe)(void *datap), void *datap, void (*release)(void *datap))
+{
+	return taskprocessor_push(tps, task_exe, NULL, datap, release);
+}
+
+int ast_taskprocessor_push_local_droppable(struct ast_taskprocessor *tps,
+	int (*task_exe)(struct ast_taskprocessor_local *local), void *datap,
+	void (*release)(void *datap))
+{
+	return taskprocessor_push(tps, NULL, task_exe, datap, release);
+}
+
+int ast_taskprocessor_overload_policy_set(struct ast_taskprocessor *tps,
+	enum ast_taskprocessor_overload_policy policy, unsigned int max_wait_ms)
+{
+	if (!tps) {
+		return -1;
+	}
+
+	ao2_lock(tps);
+	tps->overload_policy = policy;
+	tps->overload_wait_ms = max_wait_ms;
+	/* Let blocked pushers recheck the policy. */
+	ast_cond_broadcast(&tps->overload_cond);
+	ao2_unlock(tps);
+
+	return 0;
 }
 
 int ast_taskprocessor_suspend(struct ast_taskprocessor *tps)
@@ -937,10 +1449,111 @@ int ast_taskprocessor_is_suspended(struct ast_taskprocessor *tps)
 	return tps ? tps->suspended : -1;
 }
 
+/*!
+ * \internal
+ * \brief Get the histogram bucket of a duration.
+ *
+ * \param us Duration in microseconds.
+ *
+ * \return Bucket index.
+ */
+static unsigned int tps_latency_bucket(int64_t us)
+{
+	unsigned int bucket = 0;
+	int64_t limit = 100;
+
+	while (bucket < AST_TASKPROCESSOR_LATENCY_BUCKETS - 1 && limit <= us) {
+		++bucket;
+		limit *= 10;
+	}
+	return bucket;
+}
+
+/*!
+ * \internal
+ * \brief Count an executed task in the latency statistics.
+ *
+ * \param latency Statistics to update.
+ * \param wait_us Microseconds the task waited in the queue.
+ * \param exec_us Microseconds the task took to execute.
+ *
+ * \note Must be called with the taskprocessor locked.
+ *
+ * \return Nothing
+ */
+static void tps_latency_add(struct ast_taskprocessor_latency *latency, int64_t wait_us, int64_t exec_us)
+{
+	if (wait_us < 0) {
+		/* The clock stepped back. */
+		wait_us = 0;
+	}
+	if (exec_us < 0) {
+		exec_us = 0;
+	}
+
+	++latency->wait_histogram[tps_latency_bucket(wait_us)];
+	++latency->exec_histogram[tps_latency_bucket(exec_us)];
+	latency->wait_total_us += wait_us;
+	latency->exec_total_us += exec_us;
+	if (latency->wait_max_us < wait_us) {
+		latency->wait_max_us = wait_us;
+	}
+	if (latency->exec_max_us < exec_us) {
+		latency->exec_max_us = exec_us;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Log a task that took too long, naming its function if possible.
+ *
+ * \param tps Taskprocessor that executed the task.
+ * \param t Task that took too long.
+ * \param wait_us Microseconds the task waited in the queue.
+ * \param exec_us Microseconds the task took to execute.
+ *
+ * \return Nothing
+ */
+static void tps_slow_task_log(struct ast_taskprocessor *tps, struct tps_task *t,
+	int64_t wait_us, int64_t exec_us)
+{
+	void *address;
+	char **symbols;
+	char address_buf[32];
+	const char *function;
+
+	if (t->wants_local) {
+		memcpy(&address, &t->callback.execute_local, sizeof(address));
+	} else {
+		memcpy(&address, &t->callback.execute, sizeof(address));
+	}
+	symbols = ast_bt_get_symbols(&address, 1);
+
+	if (symbols) {
+		function = symbols[0];
+	} else {
+		snprintf(address_buf, sizeof(address_buf), "%p", address);
+		function = address_buf;
+	}
+
+	ast_log(LOG_WARNING, "Task %s on taskprocessor '%s' took %" PRId64 "us after waiting %" PRId64 "us in the queue\n",
+		function, tps->name, exec_us, wait_us);
+	ast_std_free(symbols);
+}
+
 int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
+{
+	return ast_taskprocessor_execute_batch(tps, 1);
+}
+
+int ast_taskprocessor_execute_batch(struct ast_taskprocessor *tps, unsigned int max_tasks)
 {
 	struct ast_taskprocessor_local local;
 	struct tps_task *t;
+	struct timeval start;
+	struct timeval end;
+	int64_t wait_us;
+	int64_t exec_us;
 	long size;
 
 	ao2_lock(tps);
@@ -952,21 +1565,49 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 
 	tps->thread = pthread_self();
 	tps->executing = 1;
+	start = ast_tvnow();
 
-	if (t->wants_local) {
-		local.local_data = tps->local_data;
-		local.data = t->datap;
-	}
-	ao2_unlock(tps);
+	do {
+		if (t->wants_local) {
+			local.local_data = tps->local_data;
+			local.data = t->datap;
+		}
+		ao2_unlock(tps);
 
-	if (t->wants_local) {
-		t->callback.execute_local(&local);
-	} else {
-		t->callback.execute(t->datap);
-	}
-	tps_task_free(t);
+		if (t->wants_local) {
+			t->callback.execute_local(&local);
+		} else {
+			t->callback.execute(t->datap);
+		}
+
+		end = ast_tvnow();
+		wait_us = ast_tvdiff_us(start, t->enqueued);
+		exec_us = ast_tvdiff_us(end, start);
+		if (tps_slow_task_us && exec_us >= tps_slow_task_us) {
+			tps_slow_task_log(tps, t, wait_us, exec_us);
+		}
+
+		ao2_lock(tps);
+		size = ast_taskprocessor_size(tps);
+
+		/* Update the stats */
+		if (tps->stats) {
+			++tps->stats->_tasks_processed_count;
+
+			/* Include the task we just executed as part of the queue size. */
+			if (size >= tps->stats->max_qsize) {
+				tps->stats->max_qsize = size + 1;
+			}
+			tps_latency_add(&tps->stats->latency, wait_us, exec_us);
+		}
+		tps_task_put(tps, t);
+
+		/* The next task starts where this one ended. */
+		start = end;
+
+		/* Stay executing while popping the next task so pushers don't see an empty queue. */
+	} while (--max_tasks && (t = tps_taskprocessor_pop(tps)));
 
-	ao2_lock(tps);
 	tps->thread = AST_PTHREADT_NULL;
 	/* We need to check size in the same critical section where we reset the
 	 * executing bit. Avoids a race condition where a task is pushed right
@@ -974,16 +1615,6 @@ int ast_taskprocessor_execute(struct ast_taskprocessor *tps)
 	 */
 	tps->executing = 0;
 	size = ast_taskprocessor_size(tps);
-
-	/* Update the stats */
-	if (tps->stats) {
-		++tps->stats->_tasks_processed_count;
-
-		/* Include the task we just executed as part of the queue size. */
-		if (size >= tps->stats->max_qsize) {
-			tps->stats->max_qsize = size + 1;
-		}
-	}
 	ao2_unlock(tps);
 
 	/* If we executed a task, check for the transition to empty */
@@ -38,6 +38,7 @@
 #include <signal.h>
 #include <sys/stat.h>
 
+#include "asterisk/_private.h"
 #include "asterisk/compat.h"
 #include "asterisk/tcptls.h"
 #include "asterisk/http.h"
@@ -48,6 +49,19 @@
 #include "asterisk/astobj2.h"
 #include "asterisk/pbx.h"
 #include "asterisk/app.h"
+#include "asterisk/threadpool.h"
+
+/*! Most TLS handshakes waiting for or on the handshake pool at once */
+#define TLS_HANDSHAKE_MAX_WAITING 2048
+
+/*! Seconds an accepted client may take to do its part of the TLS handshake */
+#define TLS_HANDSHAKE_TIMEOUT 10
+
+/*! \brief Threads doing the TLS handshakes of accepted connections */
+static struct ast_threadpool *tls_handshake_pool;
+
+/*! \brief TLS handshakes waiting for or on the handshake pool */
+static unsigned int tls_handshakes_waiting;
 
 static void session_instance_destructor(void *obj)
 {
@@ -89,120 +103,188 @@ static int check_tcptls_cert_name(ASN1_STRING *cert_str, const char *hostname, c
 }
 #endif
 
-/*! \brief
-* creates a FILE * from the fd passed by the accept thread.
-* This operation is potentially expensive (certificate verification),
-* so we do it in the child thread context.
-*
-* \note must decrement ref count before returning NULL on error
-*/
-static void *handle_tcptls_connection(void *data)
+/*!
+ * \internal
+ * \brief Start TLS on a session and check the certificate of the peer.
+ *
+ * \retval 0 on success.
+ * \retval -1 on failure.
+ */
+static int tcptls_start_tls(struct ast_tcptls_session_instance *tcptls_session)
 {
-	struct ast_tcptls_session_instance *tcptls_session = data;
 #ifdef DO_SSL
 	SSL *ssl;
-#endif
 
-	/* TCP/TLS connections are associated with external protocols, and
-	 * should not be allowed to execute 'dangerous' functions. This may
-	 * need to be pushed down into the individual protocol handlers, but
-	 * this seems like a good general policy.
-	 */
-	if (ast_thread_inhibit_escalations()) {
-		ast_log(LOG_ERROR, "Failed to inhibit privilege escalations; killing connection\n");
-		ast_tcptls_close_session_file(tcptls_session);
-		ao2_ref(tcptls_session, -1);
-		return NULL;
+	if (ast_iostream_start_tls(&tcptls_session->stream, tcptls_session->parent->tls_cfg->ssl_ctx, tcptls_session->client) < 0) {
+		return -1;
 	}
 
-	if (tcptls_session->parent->tls_cfg) {
-#ifdef DO_SSL
-		if (ast_iostream_start_tls(&tcptls_session->stream, tcptls_session->parent->tls_cfg->ssl_ctx, tcptls_session->client) < 0) {
-			ast_tcptls_close_session_file(tcptls_session);
-			ao2_ref(tcptls_session, -1);
-			return NULL;
+	ssl = ast_iostream_get_ssl(tcptls_session->stream);
+	if ((tcptls_session->client && !ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_DONT_VERIFY_SERVER))
+		|| (!tcptls_session->client && ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_VERIFY_CLIENT))) {
+		X509 *peer;
+		long res;
+		peer = SSL_get_peer_certificate(ssl);
+		if (!peer) {
+			ast_log(LOG_ERROR, "No peer SSL certificate to verify\n");
+			return -1;
 		}
 
-		ssl = ast_iostream_get_ssl(tcptls_session->stream);
-		if ((tcptls_session->client && !ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_DONT_VERIFY_SERVER))
-			|| (!tcptls_session->client && ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_VERIFY_CLIENT))) {
-			X509 *peer;
-			long res;
-			peer = SSL_get_peer_certificate(ssl);
-			if (!peer) {
-				ast_log(LOG_ERROR, "No peer SSL certificate to verify\n");
-				ast_tcptls_close_session_file(tcptls_session);
-				ao2_ref(tcptls_session, -1);
-				return NULL;
-			}
-
-			res = SSL_get_verify_result(ssl);
-			if (res != X509_V_OK) {
-				ast_log(LOG_ERROR, "Certificate did not verify: %s\n", X509_verify_cert_error_string(res));
-				X509_free(peer);
-				ast_tcptls_close_session_file(tcptls_session);
-				ao2_ref(tcptls_session, -1);
-				return NULL;
-			}
-			if (!ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_IGNORE_COMMON_NAME)) {
-				ASN1_STRING *str;
-				X509_NAME *name = X509_get_subject_name(peer);
-				STACK_OF(GENERAL_NAME) *alt_names;
-				int pos = -1;
-				int found = 0;
-
-				for (;;) {
-					/* Walk the certificate to check all available "Common Name" */
-					/* XXX Probably should do a gethostbyname on the hostname and compare that as well */
-					pos = X509_NAME_get_index_by_NID(name, NID_commonName, pos);
-					if (pos < 0) {
-						break;
-					}
-					str = X509_NAME_ENTRY_get_data(X509_NAME_get_entry(name, pos));
-					if (!check_tcptls_cert_name(str, tcptls_session->parent->hostname, "common name")) {
-						found = 1;
-						break;
-					}
+		res = SSL_get_verify_result(ssl);
+		if (res != X509_V_OK) {
+			ast_log(LOG_ERROR, "Certificate did not verify: %s\n", X509_verify_cert_error_string(res));
+			X509_free(peer);
+			return -1;
+		}
+		if (!ast_test_flag(&tcptls_session->parent->tls_cfg->flags, AST_SSL_IGNORE_COMMON_NAME)) {
+			ASN1_STRING *str;
+			X509_NAME *name = X509_get_subject_name(peer);
+			STACK_OF(GENERAL_NAME) *alt_names;
+			int pos = -1;
+			int found = 0;
+
+			for (;;) {
+				/* Walk the certificate to check all available "Common Name" */
+				/* XXX Probably should do a gethostbyname on the hostname and compare that as well */
+				pos = X509_NAME_get_index_by_NID(name, NID_commonName, pos);
+				if (pos < 0) {
+					break;
 				}
+				str = X509_NAME_ENTRY_get_data(X509_NAME_get_entry(name, pos));
+				if (!check_tcptls_cert_name(str, tcptls_session->parent->hostname, "common name")) {
+					found = 1;
+					break;
+				}
+			}
 
-				if (!found) {
-					alt_names = X509_get_ext_d2i(peer, NID_subject_alt_name, NULL, NULL);
-					if (alt_names != NULL) {
-						int alt_names_count = sk_GENERAL_NAME_num(alt_names);
-
-						for (pos = 0; pos < alt_names_count; pos++) {
-							const GENERAL_NAME *alt_name = sk_GENERAL_NAME_value(alt_names, pos);
+			if (!found) {
+				alt_names = X509_get_ext_d2i(peer, NID_subject_alt_name, NULL, NULL);
+				if (alt_names != NULL) {
+					int alt_names_count = sk_GENERAL_NAME_num(alt_names);
 
-							if (alt_name->type != GEN_DNS) {
-								continue;
-							}
+					for (pos = 0; pos < alt_names_count; pos++) {
+						const GENERAL_NAME *alt_name = sk_GENERAL_NAME_value(alt_names, pos);
 
-							if (!check_tcptls_cert_name(alt_name->d.dNSName, tcptls_session->parent->hostname, "alt name")) {
-								found = 1;
-								break;
-							}
+						if (alt_name->type != GEN_DNS) {
+							continue;
 						}
 
-						sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
+						if (!check_tcptls_cert_name(alt_name->d.dNSName, tcptls_session->parent->hostname, "alt name")) {
+							found = 1;
+							break;
+						}
 					}
-				}
 
-				if (!found) {
-					ast_log(LOG_ERROR, "Certificate common name did not match (%s)\n", tcptls_session->parent->hostname);
-					X509_free(peer);
-					ast_tcptls_close_session_file(tcptls_session);
-					ao2_ref(tcptls_session, -1);
-					return NULL;
+					sk_GENERAL_NAME_pop_free(alt_names, GENERAL_NAME_free);
 				}
 			}
-			X509_free(peer);
+
+			if (!found) {
+				ast_log(LOG_ERROR, "Certificate common name did not match (%s)\n", tcptls_session->parent->hostname);
+				X509_free(peer);
+				return -1;
+			}
 		}
+		X509_free(peer);
+	}
+
+	return 0;
 #else
-		ast_log(LOG_ERROR, "Attempted a TLS connection without OpenSSL support. This will not work!\n");
+	ast_log(LOG_ERROR, "Attempted a TLS connection without OpenSSL support. This will not work!\n");
+	return -1;
+#endif /* DO_SSL */
+}
+
+#ifdef DO_SSL
+/*!
+ * \internal
+ * \brief Limit how long reading or writing a socket may block, 0 for no limit.
+ */
+static void tcptls_set_socket_timeout(struct ast_tcptls_session_instance *tcptls_session, int seconds)
+{
+	struct timeval tv = { .tv_sec = seconds, };
+	int fd = ast_iostream_get_fd(tcptls_session->stream);
+
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+#endif
+
+/*!
+ * \internal
+ * \brief Do the TLS handshake of a session and count it.
+ *
+ * \note On failure the session is closed and its reference dropped.
+ *
+ * \retval 0 on success.
+ * \retval -1 on failure.
+ */
+static int tcptls_handshake(struct ast_tcptls_session_instance *tcptls_session)
+{
+	struct ast_tls_handshake_stats *stats = &tcptls_session->parent->tls_stats;
+	struct timeval start = ast_tvnow();
+	unsigned long usec;
+	unsigned long max;
+
+#ifdef DO_SSL
+	/* A client that stalls must not keep a handshake thread forever */
+	if (!tcptls_session->client) {
+		tcptls_set_socket_timeout(tcptls_session, TLS_HANDSHAKE_TIMEOUT);
+	}
+#endif
+
+	if (tcptls_start_tls(tcptls_session)) {
+		__atomic_add_fetch(&stats->failed, 1, __ATOMIC_RELAXED);
+		ast_tcptls_close_session_file(tcptls_session);
+		ao2_ref(tcptls_session, -1);
+		return -1;
+	}
+
+	usec = ast_tvdiff_us(ast_tvnow(), start);
+	__atomic_add_fetch(&stats->completed, 1, __ATOMIC_RELAXED);
+	__atomic_add_fetch(&stats->total_usec, usec, __ATOMIC_RELAXED);
+	max = __atomic_load_n(&stats->max_usec, __ATOMIC_RELAXED);
+	while (usec > max && !__atomic_compare_exchange_n(&stats->max_usec, &max, usec,
+		1, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+	}
+
+#ifdef DO_SSL
+	if (SSL_session_reused(ast_iostream_get_ssl(tcptls_session->stream))) {
+		__atomic_add_fetch(&stats->resumed, 1, __ATOMIC_RELAXED);
+	}
+	if (!tcptls_session->client) {
+		tcptls_set_socket_timeout(tcptls_session, 0);
+	}
+#endif
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Serve a session, on the thread it was handed to.
+ *
+ * \param tcptls_session The session
+ * \param handshake Non-zero if the TLS handshake, if any, is still to be done
+ *
+ * \note must decrement ref count before returning NULL on error
+ */
+static void *tcptls_session_run(struct ast_tcptls_session_instance *tcptls_session, int handshake)
+{
+	/* TCP/TLS connections are associated with external protocols, and
+	 * should not be allowed to execute 'dangerous' functions. This may
+	 * need to be pushed down into the individual protocol handlers, but
+	 * this seems like a good general policy.
+	 */
+	if (ast_thread_inhibit_escalations()) {
+		ast_log(LOG_ERROR, "Failed to inhibit privilege escalations; killing connection\n");
 		ast_tcptls_close_session_file(tcptls_session);
 		ao2_ref(tcptls_session, -1);
 		return NULL;
-#endif /* DO_SSL */
+	}
+
+	if (handshake && tcptls_session->parent->tls_cfg && tcptls_handshake(tcptls_session)) {
+		return NULL;
 	}
 
 	if (tcptls_session->parent->worker_fn) {
@@ -212,13 +294,113 @@ static void *handle_tcptls_connection(void *data)
 	}
 }
 
+/*! \brief
+* creates a FILE * from the fd passed by the accept thread.
+* This operation is potentially expensive (certificate verification),
+* so we do it in the child thread context.
+*
+* \note must decrement ref count before returning NULL on error
+*/
+static void *handle_tcptls_connection(void *data)
+{
+	return tcptls_session_run(data, 1);
+}
+
+/*! \brief Serve a session whose TLS handshake was done on the handshake pool */
+static void *handle_tcptls_handshaken(void *data)
+{
+	return tcptls_session_run(data, 0);
+}
+
+/*! \brief Threadpool task handling an accepted connection */
+static int tcptls_connection_task(void *data)
+{
+	handle_tcptls_connection(data);
+	return 0;
+}
+
+/*! \brief Threadpool task handling a connection whose TLS handshake is done */
+static int tcptls_handshaken_task(void *data)
+{
+	handle_tcptls_handshaken(data);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hand a session to the pool of its server or to a thread of its own.
+ *
+ * \note On failure the session is closed and its reference dropped.
+ */
+static void tcptls_session_dispatch(struct ast_tcptls_session_instance *tcptls_session,
+	void *(*fn)(void *), int (*task)(void *))
+{
+	struct ast_tcptls_session_args *desc = tcptls_session->parent;
+	pthread_t launched;
+
+	if (desc->pool) {
+		if (ast_threadpool_push(desc->pool, task, tcptls_session)) {
+			ast_log(LOG_ERROR, "Unable to queue connection to %s worker pool\n", desc->name);
+			ast_tcptls_close_session_file(tcptls_session);
+			ao2_ref(tcptls_session, -1);
+		}
+	} else if (ast_pthread_create_detached_background(&launched, NULL, fn, tcptls_session)) {
+		ast_log(LOG_ERROR, "Unable to launch helper thread: %s\n", strerror(errno));
+		ast_tcptls_close_session_file(tcptls_session);
+		ao2_ref(tcptls_session, -1);
+	}
+}
+
+/*! \brief Handshake pool task doing the TLS handshake of an accepted connection */
+static int tcptls_handshake_task(void *data)
+{
+	struct ast_tcptls_session_instance *tcptls_session = data;
+	int res;
+
+	res = tcptls_handshake(tcptls_session);
+	__atomic_sub_fetch(&tls_handshakes_waiting, 1, __ATOMIC_RELAXED);
+	if (!res) {
+		tcptls_session_dispatch(tcptls_session, handle_tcptls_handshaken, tcptls_handshaken_task);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue the TLS handshake of an accepted connection to the handshake pool.
+ *
+ * \note On failure the session is closed and its reference dropped.
+ */
+static void tcptls_handshake_queue(struct ast_tcptls_session_instance *tcptls_session)
+{
+	struct ast_tcptls_session_args *desc = tcptls_session->parent;
+
+	/* Better to turn a client away now than to answer it after it gave up */
+	if (__atomic_add_fetch(&tls_handshakes_waiting, 1, __ATOMIC_RELAXED) > TLS_HANDSHAKE_MAX_WAITING) {
+		__atomic_sub_fetch(&tls_handshakes_waiting, 1, __ATOMIC_RELAXED);
+		__atomic_add_fetch(&desc->tls_stats.dropped, 1, __ATOMIC_RELAXED);
+		ast_debug(1, "Too many TLS handshakes waiting, closing connection to %s from %s\n",
+			desc->name, ast_sockaddr_stringify(&tcptls_session->remote_address));
+		ast_tcptls_close_session_file(tcptls_session);
+		ao2_ref(tcptls_session, -1);
+		return;
+	}
+
+	if (ast_threadpool_push(tls_handshake_pool, tcptls_handshake_task, tcptls_session)) {
+		__atomic_sub_fetch(&tls_handshakes_waiting, 1, __ATOMIC_RELAXED);
+		ast_log(LOG_ERROR, "Unable to queue TLS handshake for %s\n", desc->name);
+		ast_tcptls_close_session_file(tcptls_session);
+		ao2_ref(tcptls_session, -1);
+	}
+}
+
 void *ast_tcptls_server_root(void *data)
 {
 	struct ast_tcptls_session_args *desc = data;
 	int fd;
 	struct ast_sockaddr addr;
 	struct ast_tcptls_session_instance *tcptls_session;
-	pthread_t launched;
 
 	for (;;) {
 		int i, flags;
@@ -263,10 +445,10 @@ void *ast_tcptls_server_root(void *data)
 		tcptls_session->client = 0;
 
 		/* This thread is now the only place that controls the single ref to tcptls_session */
-		if (ast_pthread_create_detached_background(&launched, NULL, handle_tcptls_connection, tcptls_session)) {
-			ast_log(LOG_ERROR, "Unable to launch helper thread: %s\n", strerror(errno));
-			ast_tcptls_close_session_file(tcptls_session);
-			ao2_ref(tcptls_session, -1);
+		if (desc->tls_cfg && tls_handshake_pool) {
+			tcptls_handshake_queue(tcptls_session);
+		} else {
+			tcptls_session_dispatch(tcptls_session, handle_tcptls_connection, tcptls_connection_task);
 		}
 	}
 	return NULL;
@@ -367,9 +549,31 @@ static int __ssl_setup(struct ast_tls_config *cfg, int client)
 	ast_log(LOG_WARNING, "Your version of OpenSSL leaves you potentially vulnerable "
 			"to the SSL BEAST attack. Please upgrade to OpenSSL 1.0.1 or later\n");
 #endif
+#ifdef SSL_OP_NO_TICKET
+	if (ast_test_flag(&cfg->flags, AST_SSL_NO_SESSION_TICKETS)) {
+		ssl_opts |= SSL_OP_NO_TICKET;
+	}
+#endif
 
 	SSL_CTX_set_options(cfg->ssl_ctx, ssl_opts);
 
+	if (!client) {
+		/* Sessions are not resumed without this once client certificates are verified */
+		SSL_CTX_set_session_id_context(cfg->ssl_ctx, (const unsigned char *) "asterisk", 8);
+		if (ast_test_flag(&cfg->flags, AST_SSL_NO_SESSION_CACHE)) {
+			SSL_CTX_set_session_cache_mode(cfg->ssl_ctx, SSL_SESS_CACHE_OFF);
+		} else {
+			SSL_CTX_set_session_cache_mode(cfg->ssl_ctx, SSL_SESS_CACHE_SERVER);
+			if (cfg->session_cache_size > 0) {
+				SSL_CTX_sess_set_cache_size(cfg->ssl_ctx, cfg->session_cache_size);
+			}
+		}
+		/* Applies to session tickets as well */
+		if (cfg->session_timeout > 0) {
+			SSL_CTX_set_timeout(cfg->ssl_ctx, cfg->session_timeout);
+		}
+	}
+
 	SSL_CTX_set_verify(cfg->ssl_ctx,
 		ast_test_flag(&cfg->flags, AST_SSL_VERIFY_CLIENT) ? SSL_VERIFY_PEER | SSL_VERIFY_FAIL_IF_NO_PEER_CERT : SSL_VERIFY_NONE,
 		NULL);
@@ -639,6 +843,10 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 			tls_changed = 1;
 		} else if (memcmp(&desc->tls_cfg->flags, &desc->old_tls_cfg->flags, sizeof(desc->tls_cfg->flags))) {
 			tls_changed = 1;
+		} else if (desc->tls_cfg->session_cache_size != desc->old_tls_cfg->session_cache_size) {
+			tls_changed = 1;
+		} else if (desc->tls_cfg->session_timeout != desc->old_tls_cfg->session_timeout) {
+			tls_changed = 1;
 		}
 
 		if (tls_changed) {
@@ -718,6 +926,8 @@ void ast_tcptls_server_start(struct ast_tcptls_session_args *desc)
 		memcpy(desc->old_tls_cfg->pvthash, desc->tls_cfg->pvthash, 41);
 		memcpy(desc->old_tls_cfg->cahash, desc->tls_cfg->cahash, 41);
 		memcpy(&desc->old_tls_cfg->flags, &desc->tls_cfg->flags, sizeof(desc->old_tls_cfg->flags));
+		desc->old_tls_cfg->session_cache_size = desc->tls_cfg->session_cache_size;
+		desc->old_tls_cfg->session_timeout = desc->tls_cfg->session_timeout;
 	}
 
 	return;
@@ -811,9 +1021,61 @@ int ast_tls_read_conf(struct ast_tls_config *tls_cfg, struct ast_tcptls_session_
 		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_DISABLE_TLSV11);
 	} else if (!strcasecmp(varname, "tlsdisablev12")) {
 		ast_set2_flag(&tls_cfg->flags, ast_true(value), AST_SSL_DISABLE_TLSV12);
+	} else if (!strcasecmp(varname, "tlssessioncache")) {
+		ast_set2_flag(&tls_cfg->flags, ast_false(value), AST_SSL_NO_SESSION_CACHE);
+	} else if (!strcasecmp(varname, "tlssessioncachesize")) {
+		if (ast_parse_arg(value, PARSE_INT32 | PARSE_IN_RANGE, &tls_cfg->session_cache_size, 0, INT_MAX)) {
+			ast_log(LOG_ERROR, "Invalid %s '%s'\n", varname, value);
+		}
+	} else if (!strcasecmp(varname, "tlssessiontimeout")) {
+		if (ast_parse_arg(value, PARSE_INT32 | PARSE_IN_RANGE, &tls_cfg->session_timeout, 0, INT_MAX)) {
+			ast_log(LOG_ERROR, "Invalid %s '%s'\n", varname, value);
+		}
+	} else if (!strcasecmp(varname, "tlssessiontickets")) {
+		ast_set2_flag(&tls_cfg->flags, ast_false(value), AST_SSL_NO_SESSION_TICKETS);
 	} else {
 		return -1;
 	}
 
 	return 0;
 }
+
+void ast_tcptls_handshake_stats(const struct ast_tcptls_session_args *desc, struct ast_tls_handshake_stats *stats)
+{
+	stats->completed = __atomic_load_n(&desc->tls_stats.completed, __ATOMIC_RELAXED);
+	stats->resumed = __atomic_load_n(&desc->tls_stats.resumed, __ATOMIC_RELAXED);
+	stats->failed = __atomic_load_n(&desc->tls_stats.failed, __ATOMIC_RELAXED);
+	stats->dropped = __atomic_load_n(&desc->tls_stats.dropped, __ATOMIC_RELAXED);
+	stats->total_usec = __atomic_load_n(&desc->tls_stats.total_usec, __ATOMIC_RELAXED);
+	stats->max_usec = __atomic_load_n(&desc->tls_stats.max_usec, __ATOMIC_RELAXED);
+}
+
+static void tcptls_shutdown(void)
+{
+	ast_threadpool_shutdown(tls_handshake_pool);
+	tls_handshake_pool = NULL;
+}
+
+int ast_tcptls_init(void)
+{
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+	};
+	long cpus;
+
+	/* Handshakes are bound by the CPU, so more threads than processors only add waiting */
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	options.max_size = MAX(1, cpus);
+
+	tls_handshake_pool = ast_threadpool_create("tls-handshake", NULL, &options);
+	if (!tls_handshake_pool) {
+		return -1;
+	}
+
+	ast_register_cleanup(tcptls_shutdown);
+
+	return 0;
+}
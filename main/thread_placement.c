@@ -0,0 +1,338 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*! \file
+ *
+ * \brief Processor and NUMA node placement of threads
+ */
+
+/*** MODULEINFO
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include "asterisk/_private.h"
+#include "asterisk/config.h"
+#include "asterisk/thread_placement.h"
+#include "asterisk/threadstorage.h"
+#include "asterisk/utils.h"
+
+#if defined(__linux__) && defined(CPU_SET)
+
+/*! Highest NUMA node number looked for */
+#define PLACEMENT_MAX_NODES 64
+
+/*! \brief Names of the roles, as configured in asterisk.conf */
+static const char * const role_names[AST_THREAD_ROLE_MAX] = {
+	[AST_THREAD_ROLE_MIXING] = "mixing",
+	[AST_THREAD_ROLE_BRIDGE] = "bridge",
+	[AST_THREAD_ROLE_TASKPROCESSOR] = "taskprocessor",
+	[AST_THREAD_ROLE_RTP] = "rtp",
+};
+
+/*! \brief Processors of each role, all of them if the role is not configured */
+static cpu_set_t role_cpus[AST_THREAD_ROLE_MAX];
+/*! \brief Non-zero if the processors of a role are configured */
+static int role_configured[AST_THREAD_ROLE_MAX];
+
+/*! \brief Processors of each NUMA node, indexed by node number */
+static cpu_set_t node_cpus[PLACEMENT_MAX_NODES];
+/*! \brief One more than the highest NUMA node number found */
+static int node_count;
+
+/*! \brief Processors Asterisk was started on */
+static cpu_set_t startup_cpus;
+
+/*! \brief Non-zero to keep the threads of a bridge on one NUMA node */
+static int numa_local;
+
+/*! \brief Non-zero if the calling thread was placed */
+AST_THREADSTORAGE(thread_placed);
+
+/*!
+ * \internal
+ * \brief Parse a list of processors such as "0-3,8".
+ *
+ * \retval 0 on success.
+ * \retval -1 if the list is not valid.
+ */
+static int cpulist_parse(const char *list, cpu_set_t *cpus)
+{
+	char *buf = ast_strdupa(list);
+	char *item;
+	unsigned int first;
+	unsigned int last;
+	unsigned int cpu;
+
+	CPU_ZERO(cpus);
+	while ((item = strsep(&buf, ","))) {
+		item = ast_strip(item);
+		if (ast_strlen_zero(item)) {
+			continue;
+		}
+		if (sscanf(item, "%30u-%30u", &first, &last) != 2) {
+			if (sscanf(item, "%30u", &first) != 1) {
+				return -1;
+			}
+			last = first;
+		}
+		if (first > last || last >= CPU_SETSIZE) {
+			return -1;
+		}
+		for (cpu = first; cpu <= last; ++cpu) {
+			CPU_SET(cpu, cpus);
+		}
+	}
+
+	return CPU_COUNT(cpus) ? 0 : -1;
+}
+
+/*!
+ * \internal
+ * \brief Write a set of processors as a list such as "0-3,8".
+ */
+static void cpulist_format(const cpu_set_t *cpus, char *buf, size_t size)
+{
+	size_t used = 0;
+	int cpu;
+	int last;
+	int len;
+
+	*buf = '\0';
+	for (cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+		if (!CPU_ISSET(cpu, cpus)) {
+			continue;
+		}
+		for (last = cpu; last + 1 < CPU_SETSIZE && CPU_ISSET(last + 1, cpus); ++last) {
+		}
+		if (last == cpu) {
+			len = snprintf(buf + used, size - used, "%s%d", used ? "," : "", cpu);
+		} else {
+			len = snprintf(buf + used, size - used, "%s%d-%d", used ? "," : "", cpu, last);
+		}
+		if (len < 0 || len >= size - used) {
+			break;
+		}
+		used += len;
+		cpu = last;
+	}
+}
+
+/*!
+ * \internal
+ * \brief Read the processors of every NUMA node from sysfs.
+ */
+static void nodes_load(void)
+{
+	char path[64];
+	char line[256];
+	FILE *file;
+	int node;
+
+	node_count = 0;
+	for (node = 0; node < PLACEMENT_MAX_NODES; ++node) {
+		CPU_ZERO(&node_cpus[node]);
+		snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+		if (!(file = fopen(path, "r"))) {
+			continue;
+		}
+		if (fgets(line, sizeof(line), file) && !cpulist_parse(line, &node_cpus[node])) {
+			node_count = node + 1;
+		}
+		fclose(file);
+	}
+}
+
+int ast_thread_placement_node(void)
+{
+	int cpu;
+	int node;
+
+	if (!numa_local || (cpu = sched_getcpu()) < 0) {
+		return -1;
+	}
+
+	for (node = 0; node < node_count; ++node) {
+		if (CPU_ISSET(cpu, &node_cpus[node])) {
+			return node;
+		}
+	}
+
+	return -1;
+}
+
+int ast_thread_place(enum ast_thread_role role, int node)
+{
+	cpu_set_t cpus;
+	cpu_set_t local;
+	int *placed;
+#if !defined(LOW_MEMORY)
+	char list[128];
+	char *placement = NULL;
+#endif
+
+	if (role >= AST_THREAD_ROLE_MAX) {
+		return -1;
+	}
+
+	cpus = role_cpus[role];
+	if (node >= node_count) {
+		node = -1;
+	}
+	if (node >= 0) {
+		CPU_AND(&local, &cpus, &node_cpus[node]);
+		if (CPU_COUNT(&local)) {
+			cpus = local;
+		} else {
+			/* None of the role's processors are on that node. */
+			node = -1;
+		}
+	}
+	if (!role_configured[role] && node < 0) {
+		return -1;
+	}
+
+	if ((errno = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus))) {
+		ast_log(LOG_WARNING, "Unable to place %s thread: %s\n", role_names[role], strerror(errno));
+		return -1;
+	}
+
+	if ((placed = ast_threadstorage_get(&thread_placed, sizeof(*placed)))) {
+		*placed = 1;
+	}
+
+#if !defined(LOW_MEMORY)
+	cpulist_format(&cpus, list, sizeof(list));
+	if ((node >= 0
+			? ast_asprintf(&placement, "%s node %d cpus %s", role_names[role], node, list)
+			: ast_asprintf(&placement, "%s cpus %s", role_names[role], list)) < 0) {
+		placement = NULL;
+	}
+	ast_thread_list_set_placement(placement);
+#endif
+
+	return 0;
+}
+
+void ast_thread_unplace(void)
+{
+	int *placed = ast_threadstorage_get(&thread_placed, sizeof(*placed));
+
+	if (!placed || !*placed) {
+		return;
+	}
+	*placed = 0;
+
+	if ((errno = pthread_setaffinity_np(pthread_self(), sizeof(startup_cpus), &startup_cpus))) {
+		ast_log(LOG_WARNING, "Unable to unplace thread: %s\n", strerror(errno));
+	}
+#if !defined(LOW_MEMORY)
+	ast_thread_list_set_placement(NULL);
+#endif
+}
+
+int ast_thread_placement_init(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+	struct ast_variable *v;
+	int role;
+
+	if (sched_getaffinity(0, sizeof(startup_cpus), &startup_cpus)) {
+		ast_log(LOG_WARNING, "Unable to get the processors Asterisk may run on: %s\n",
+			strerror(errno));
+		return 0;
+	}
+	for (role = 0; role < AST_THREAD_ROLE_MAX; ++role) {
+		role_cpus[role] = startup_cpus;
+	}
+
+	cfg = ast_config_load2("asterisk.conf", "" /* core can't reload */, config_flags);
+	if (!cfg || cfg == CONFIG_STATUS_FILEINVALID) {
+		return 0;
+	}
+
+	for (v = ast_variable_browse(cfg, "threads"); v; v = v->next) {
+		if (!strcasecmp(v->name, "numa_local")) {
+			numa_local = ast_true(v->value);
+			continue;
+		}
+		for (role = 0; role < AST_THREAD_ROLE_MAX; ++role) {
+			if (!strcasecmp(v->name, role_names[role])) {
+				break;
+			}
+		}
+		if (role == AST_THREAD_ROLE_MAX) {
+			ast_log(LOG_WARNING, "Unknown thread role '%s' in asterisk.conf\n", v->name);
+		} else if (cpulist_parse(v->value, &role_cpus[role])) {
+			ast_log(LOG_WARNING, "Invalid processor list '%s' for %s threads in asterisk.conf\n",
+				v->value, v->name);
+			role_cpus[role] = startup_cpus;
+		} else {
+			role_configured[role] = 1;
+		}
+	}
+	ast_config_destroy(cfg);
+
+	if (numa_local) {
+		nodes_load();
+		if (!node_count) {
+			ast_log(LOG_WARNING, "No NUMA nodes found, numa_local has no effect\n");
+			numa_local = 0;
+		}
+	}
+
+	return 0;
+}
+
+#else
+
+int ast_thread_placement_node(void)
+{
+	return -1;
+}
+
+int ast_thread_place(enum ast_thread_role role, int node)
+{
+	return -1;
+}
+
+void ast_thread_unplace(void)
+{
+}
+
+int ast_thread_placement_init(void)
+{
+	struct ast_flags config_flags = { 0 };
+	struct ast_config *cfg;
+
+	cfg = ast_config_load2("asterisk.conf", "" /* core can't reload */, config_flags);
+	if (cfg && cfg != CONFIG_STATUS_FILEINVALID) {
+		if (ast_variable_browse(cfg, "threads")) {
+			ast_log(LOG_WARNING, "Thread placement is not supported on this platform\n");
+		}
+		ast_config_destroy(cfg);
+	}
+
+	return 0;
+}
+
+#endif
@@ -19,14 +19,24 @@
 
 #include "asterisk.h"
 
+#include "asterisk/_private.h"
 #include "asterisk/threadpool.h"
 #include "asterisk/taskprocessor.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
+#include "asterisk/linkedlists.h"
+#include "asterisk/thread_placement.h"
 #include "asterisk/utils.h"
+#include "asterisk/vector.h"
 
 /* Needs to stay prime if increased */
 #define THREAD_BUCKETS 89
 
+struct worker_thread;
+
+/*! Container of all threadpools, used for CLI reporting */
+static struct ao2_container *threadpools;
+
 /*!
  * \brief An opaque threadpool structure
  *
@@ -98,6 +108,20 @@ struct ast_threadpool {
 	int shutting_down;
 	/*! Threadpool-specific options */
 	struct ast_threadpool_options options;
+	/*!
+	 * \brief Workers whose threads are currently running
+	 *
+	 * Unlike the active, idle, and zombie containers this may be accessed
+	 * from any thread. It is used by workers looking for tasks to steal
+	 * and for reporting worker statistics.
+	 *
+	 * The vector does not hold references. A worker adds itself when its
+	 * thread starts and removes itself before the thread exits, and a
+	 * worker is never destroyed before its thread has been joined.
+	 */
+	AST_VECTOR(, struct worker_thread *) workers;
+	/*! Lock protecting the workers vector */
+	ast_rwlock_t workers_lock;
 };
 
 /*!
@@ -137,6 +161,18 @@ enum worker_state {
 	DEAD,
 };
 
+/*!
+ * \brief A task queued on a specific worker when work stealing is enabled
+ */
+struct worker_task {
+	/*! The task to execute */
+	int (*task)(void *data);
+	/*! The parameter for the task */
+	void *data;
+	/*! Next task in the worker's queue */
+	AST_LIST_ENTRY(worker_task) next;
+};
+
 /*!
  * A thread that executes threadpool tasks
  */
@@ -157,8 +193,25 @@ struct worker_thread {
 	int wake_up;
 	/*! Options for this threadpool */
 	struct ast_threadpool_options options;
+	/*! Lock protecting the worker's task queue and its counters */
+	ast_mutex_t tasks_lock;
+	/*! Tasks pushed by this worker's own thread (work stealing only) */
+	AST_LIST_HEAD_NOLOCK(, worker_task) tasks;
+	/*! Number of tasks currently waiting in the worker's task queue */
+	unsigned int tasks_queued;
+	/*! Number of tasks pushed onto the worker's task queue */
+	unsigned int tasks_pushed;
+	/*! Number of tasks the worker ran from its own task queue */
+	unsigned int tasks_run;
+	/*! Number of tasks the worker stole from other workers and ran */
+	unsigned int tasks_stolen;
+	/*! Position in the pool's workers to start the next steal attempt from */
+	unsigned int steal_index;
 };
 
+/*! The worker whose thread is the current thread, if any */
+AST_THREADSTORAGE_RAW(current_worker);
+
 /* Worker thread forward declarations. See definitions for documentation */
 static int worker_thread_hash(const void *obj, int flags);
 static int worker_thread_cmp(void *obj, void *arg, int flags);
@@ -170,6 +223,7 @@ static int worker_thread_start(struct worker_thread *worker);
 static int worker_idle(struct worker_thread *worker);
 static int worker_set_state(struct worker_thread *worker, enum worker_state state);
 static void worker_shutdown(struct worker_thread *worker);
+static int worker_push(struct worker_thread *worker, int (*task)(void *data), void *data);
 
 /*!
  * \brief Notify the threadpool listener that the state has changed.
@@ -371,6 +425,8 @@ static void threadpool_destructor(void *obj)
 {
 	struct ast_threadpool *pool = obj;
 	ao2_cleanup(pool->listener);
+	AST_VECTOR_FREE(&pool->workers);
+	ast_rwlock_destroy(&pool->workers_lock);
 }
 
 /*
@@ -397,6 +453,12 @@ static struct ast_threadpool *threadpool_alloc(const char *name, const struct as
 		return NULL;
 	}
 
+	ast_rwlock_init(&pool->workers_lock);
+	if (AST_VECTOR_INIT(&pool->workers, 0)) {
+		ast_free(control_tps_name);
+		return NULL;
+	}
+
 	ast_str_set(&control_tps_name, 0, "%s-control", name);
 
 	pool->control_tps = ast_taskprocessor_get(ast_str_buffer(control_tps_name), TPS_REF_DEFAULT);
@@ -580,18 +642,13 @@ static int queued_task_pushed(void *data)
 }
 
 /*!
- * \brief Taskprocessor listener callback called when a task is added
+ * \brief Queue activation of idle threads after a task has been pushed
  *
- * The threadpool uses this opportunity to queue a task on its control taskprocessor
- * in order to activate idle threads and notify the threadpool listener that the
- * task has been pushed.
- * \param listener The taskprocessor listener. The threadpool is the listener's private data
- * \param was_empty True if the taskprocessor was empty prior to the task being pushed
+ * \param pool The pool into which a task was pushed
+ * \param was_empty True if the pool had no tasks prior to the push
  */
-static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listener,
-		int was_empty)
+static void threadpool_task_pushed(struct ast_threadpool *pool, int was_empty)
 {
-	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
 	struct task_pushed_data *tpd;
 	SCOPED_AO2LOCK(lock, pool);
 
@@ -606,6 +663,23 @@ static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listen
 	ast_taskprocessor_push(pool->control_tps, queued_task_pushed, tpd);
 }
 
+/*!
+ * \brief Taskprocessor listener callback called when a task is added
+ *
+ * The threadpool uses this opportunity to queue a task on its control taskprocessor
+ * in order to activate idle threads and notify the threadpool listener that the
+ * task has been pushed.
+ * \param listener The taskprocessor listener. The threadpool is the listener's private data
+ * \param was_empty True if the taskprocessor was empty prior to the task being pushed
+ */
+static void threadpool_tps_task_pushed(struct ast_taskprocessor_listener *listener,
+		int was_empty)
+{
+	struct ast_threadpool *pool = ast_taskprocessor_listener_get_user_data(listener);
+
+	threadpool_task_pushed(pool, was_empty);
+}
+
 /*!
  * \brief Queued task that handles the case where the threadpool's taskprocessor is emptied
  *
@@ -917,17 +991,29 @@ struct ast_threadpool *ast_threadpool_create(const char *name,
 		pool->listener = listener;
 	}
 	ast_threadpool_set_size(pool, pool->options.initial_size);
+	if (threadpools) {
+		ao2_link(threadpools, pool);
+	}
 	ao2_ref(pool, +1);
 	return pool;
 }
 
 int ast_threadpool_push(struct ast_threadpool *pool, int (*task)(void *data), void *data)
 {
-	SCOPED_AO2LOCK(lock, pool);
+	struct worker_thread *worker = ast_threadstorage_get_ptr(&current_worker);
+	int res = -1;
+
+	if (worker && worker->pool == pool && pool->options.work_stealing) {
+		/* Tasks pushed by one of our own workers stay with that worker */
+		return worker_push(worker, task, data);
+	}
+
+	ao2_lock(pool);
 	if (!pool->shutting_down) {
-		return ast_taskprocessor_push(pool->tps, task, data);
+		res = ast_taskprocessor_push(pool->tps, task, data);
 	}
-	return -1;
+	ao2_unlock(pool);
+	return res;
 }
 
 void ast_threadpool_shutdown(struct ast_threadpool *pool)
@@ -938,6 +1024,9 @@ void ast_threadpool_shutdown(struct ast_threadpool *pool)
 	/* Shut down the taskprocessors and everything else just
 	 * takes care of itself via the taskprocessor callbacks
 	 */
+	if (threadpools) {
+		ao2_unlink(threadpools, pool);
+	}
 	ao2_lock(pool);
 	pool->shutting_down = 1;
 	ao2_unlock(pool);
@@ -995,10 +1084,221 @@ static void worker_thread_destroy(void *obj)
 	struct worker_thread *worker = obj;
 	ast_debug(3, "Destroying worker thread %d\n", worker->id);
 	worker_shutdown(worker);
+	ast_mutex_destroy(&worker->tasks_lock);
 	ast_mutex_destroy(&worker->lock);
 	ast_cond_destroy(&worker->cond);
 }
 
+/*!
+ * \brief Make a worker visible to the rest of the pool
+ *
+ * Called from the worker's own thread when it starts.
+ *
+ * \param worker The worker to add
+ */
+static void worker_register(struct worker_thread *worker)
+{
+	struct ast_threadpool *pool = worker->pool;
+
+	ast_rwlock_wrlock(&pool->workers_lock);
+	if (AST_VECTOR_APPEND(&pool->workers, worker)) {
+		ast_log(LOG_WARNING, "Failed to register worker thread %d. Its tasks cannot be stolen\n",
+			worker->id);
+	}
+	ast_rwlock_unlock(&pool->workers_lock);
+}
+
+/*!
+ * \brief Remove a worker from the pool's view and hand off its remaining tasks
+ *
+ * Called from the worker's own thread right before it exits.
+ *
+ * \param worker The worker to remove
+ */
+static void worker_unregister(struct worker_thread *worker)
+{
+	struct ast_threadpool *pool = worker->pool;
+	struct worker_task *task;
+
+	ast_rwlock_wrlock(&pool->workers_lock);
+	AST_VECTOR_REMOVE_ELEM_UNORDERED(&pool->workers, worker, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	ast_rwlock_unlock(&pool->workers_lock);
+
+	ast_threadstorage_set_ptr(&current_worker, NULL);
+
+	/* No one else can reach our tasks now, move them to the shared queue */
+	ast_mutex_lock(&worker->tasks_lock);
+	while ((task = AST_LIST_REMOVE_HEAD(&worker->tasks, next))) {
+		--worker->tasks_queued;
+		ast_mutex_unlock(&worker->tasks_lock);
+		if (ast_threadpool_push(pool, task->task, task->data)) {
+			ast_debug(1, "Dropping task queued on exiting worker thread %d\n",
+				worker->id);
+		}
+		ast_free(task);
+		ast_mutex_lock(&worker->tasks_lock);
+	}
+	ast_mutex_unlock(&worker->tasks_lock);
+}
+
+/*!
+ * \brief Queue a task on a worker
+ *
+ * This is only called from the worker's own thread.
+ *
+ * \param worker The worker to queue the task on
+ * \param task The task to add
+ * \param data The parameter for the task
+ * \retval 0 success
+ * \retval -1 failure
+ */
+static int worker_push(struct worker_thread *worker, int (*task)(void *data), void *data)
+{
+	struct worker_task *local;
+	int was_empty;
+
+	if (worker->pool->shutting_down) {
+		return -1;
+	}
+
+	local = ast_calloc(1, sizeof(*local));
+	if (!local) {
+		return -1;
+	}
+	local->task = task;
+	local->data = data;
+
+	ast_mutex_lock(&worker->tasks_lock);
+	was_empty = AST_LIST_EMPTY(&worker->tasks);
+	AST_LIST_INSERT_TAIL(&worker->tasks, local, next);
+	++worker->tasks_queued;
+	++worker->tasks_pushed;
+	ast_mutex_unlock(&worker->tasks_lock);
+
+	/*
+	 * The worker will get to the task itself once its current task is
+	 * done. If it already has a backlog though, wake idle threads so they
+	 * can steal some of it.
+	 */
+	if (!was_empty) {
+		threadpool_task_pushed(worker->pool, 0);
+	}
+	return 0;
+}
+
+/*!
+ * \brief Take the oldest task queued on a worker
+ *
+ * \param worker The worker to take the task from
+ * \retval NULL The worker has no queued tasks
+ * \retval non-NULL The task. The caller is responsible for freeing it.
+ */
+static struct worker_task *worker_pop(struct worker_thread *worker)
+{
+	struct worker_task *task;
+
+	ast_mutex_lock(&worker->tasks_lock);
+	task = AST_LIST_REMOVE_HEAD(&worker->tasks, next);
+	if (task) {
+		--worker->tasks_queued;
+	}
+	ast_mutex_unlock(&worker->tasks_lock);
+
+	return task;
+}
+
+/*!
+ * \brief Take a task queued on some other worker in the pool
+ *
+ * \param thief The worker looking for a task
+ * \retval NULL No other worker has queued tasks
+ * \retval non-NULL The task. The caller is responsible for freeing it.
+ */
+static struct worker_task *worker_steal(struct worker_thread *thief)
+{
+	struct ast_threadpool *pool = thief->pool;
+	struct worker_task *task = NULL;
+	size_t count;
+	size_t i;
+
+	ast_rwlock_rdlock(&pool->workers_lock);
+	count = AST_VECTOR_SIZE(&pool->workers);
+	for (i = 0; i < count && !task; ++i) {
+		struct worker_thread *victim;
+
+		victim = AST_VECTOR_GET(&pool->workers, (thief->steal_index + i) % count);
+		if (victim != thief) {
+			task = worker_pop(victim);
+		}
+	}
+	ast_rwlock_unlock(&pool->workers_lock);
+
+	/* Spread the next attempt out so thieves don't all pick the same victim */
+	thief->steal_index += i;
+
+	return task;
+}
+
+/*!
+ * \brief Run a task that was queued on a worker
+ *
+ * \param task The task to run. It is freed afterward.
+ */
+static void worker_task_execute(struct worker_task *task)
+{
+	task->task(task->data);
+	ast_free(task);
+}
+
+/*!
+ * \brief Execute a task for a worker when work stealing is enabled
+ *
+ * The worker's own queue is served first, then the pool's shared queue,
+ * and finally other workers' queues.
+ *
+ * \param worker The worker executing tasks
+ * \retval 0 Either the pool has been shut down or there are no tasks.
+ * \retval 1 A task was run and there may be more to run.
+ */
+static int worker_execute(struct worker_thread *worker)
+{
+	struct worker_task *task;
+
+	/*
+	 * Unlike threadpool_execute() the pool is not locked to check this.
+	 * Avoiding the pool lock is the point of worker local tasks and at
+	 * worst one more task gets run while the pool shuts down.
+	 */
+	if (worker->pool->shutting_down) {
+		return 0;
+	}
+
+	task = worker_pop(worker);
+	if (task) {
+		++worker->tasks_run;
+		worker_task_execute(task);
+		return 1;
+	}
+
+	if (threadpool_execute(worker->pool)) {
+		return 1;
+	}
+
+	/* The shared task may have queued work on us before the queue emptied */
+	if (!AST_LIST_EMPTY(&worker->tasks)) {
+		return 1;
+	}
+
+	task = worker_steal(worker);
+	if (task) {
+		++worker->tasks_stolen;
+		worker_task_execute(task);
+		return 1;
+	}
+
+	return 0;
+}
+
 /*!
  * \brief start point for worker threads
  *
@@ -1014,10 +1314,15 @@ static void *worker_start(void *arg)
 	struct worker_thread *worker = arg;
 	enum worker_state saved_state;
 
+	ast_thread_place(AST_THREAD_ROLE_TASKPROCESSOR, -1);
+
 	if (worker->options.thread_start) {
 		worker->options.thread_start();
 	}
 
+	ast_threadstorage_set_ptr(&current_worker, worker);
+	worker_register(worker);
+
 	ast_mutex_lock(&worker->lock);
 	while (worker_idle(worker)) {
 		ast_mutex_unlock(&worker->lock);
@@ -1039,6 +1344,8 @@ static void *worker_start(void *arg)
 	 * that the thread can be removed from the
 	 * list of zombie threads.
 	 */
+	worker_unregister(worker);
+
 	if (saved_state == ZOMBIE) {
 		threadpool_zombie_thread_dead(worker->pool, worker);
 	}
@@ -1067,6 +1374,7 @@ static struct worker_thread *worker_thread_alloc(struct ast_threadpool *pool)
 	worker->id = ast_atomic_fetchadd_int(&worker_id_counter, 1);
 	ast_mutex_init(&worker->lock);
 	ast_cond_init(&worker->cond, NULL);
+	ast_mutex_init(&worker->tasks_lock);
 	worker->pool = pool;
 	worker->thread = AST_PTHREADT_NULL;
 	worker->state = ALIVE;
@@ -1102,7 +1410,11 @@ static void worker_active(struct worker_thread *worker)
 	 * optimize the code away.
 	 */
 	do {
-		alive = threadpool_execute(worker->pool);
+		if (worker->options.work_stealing) {
+			alive = worker_execute(worker);
+		} else {
+			alive = threadpool_execute(worker->pool);
+		}
 	} while (alive);
 }
 
@@ -1319,7 +1631,7 @@ static int execute_tasks(void *data)
 	struct ast_taskprocessor *tps = data;
 
 	ast_threadstorage_set_ptr(&current_serializer, tps);
-	while (ast_taskprocessor_execute(tps)) {
+	while (ast_taskprocessor_execute_batch(tps, 0)) {
 		/* No-op */
 	}
 	ast_threadstorage_set_ptr(&current_serializer, NULL);
@@ -1406,3 +1718,121 @@ long ast_threadpool_queue_size(struct ast_threadpool *pool)
 {
 	return ast_taskprocessor_size(pool->tps);
 }
+
+static int threadpool_sort_cb(const void *obj_left, const void *obj_right, int flags)
+{
+	const struct ast_threadpool *pool_left = obj_left;
+	const struct ast_threadpool *pool_right = obj_right;
+
+	return strcasecmp(ast_taskprocessor_name(pool_left->tps),
+		ast_taskprocessor_name(pool_right->tps));
+}
+
+/*! \brief ao2 callback to print a threadpool and its workers to the CLI */
+static int threadpool_report_cb(void *obj, void *arg, void *data, int flags)
+{
+	struct ast_threadpool *pool = obj;
+	struct ast_cli_args *a = arg;
+	int *count = data;
+	size_t i;
+
+#define FMT_HEADERS		"%-45s %8s %8s %8s %10s %8s\n"
+#define FMT_FIELDS		"%-45s %8d %8d %8d %10ld %8s\n"
+#define WORKER_FMT_HEADERS	"    %-10s %12s %12s %12s %10s\n"
+#define WORKER_FMT_FIELDS	"    %-10d %12u %12u %12u %10u\n"
+
+	if (*count) {
+		ast_cli(a->fd, "\n");
+	}
+	++*count;
+
+	ast_cli(a->fd, FMT_HEADERS, "Threadpool", "Active", "Idle", "Zombie", "In Queue", "Stealing");
+	ast_cli(a->fd, FMT_FIELDS, ast_taskprocessor_name(pool->tps),
+		ao2_container_count(pool->active_threads),
+		ao2_container_count(pool->idle_threads),
+		ao2_container_count(pool->zombie_threads),
+		ast_taskprocessor_size(pool->tps),
+		AST_CLI_YESNO(pool->options.work_stealing));
+
+	if (!pool->options.work_stealing) {
+		return 0;
+	}
+
+	ast_cli(a->fd, WORKER_FMT_HEADERS, "Worker", "Pushed", "Run", "Stolen", "In Queue");
+	ast_rwlock_rdlock(&pool->workers_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&pool->workers); ++i) {
+		struct worker_thread *worker = AST_VECTOR_GET(&pool->workers, i);
+
+		ast_cli(a->fd, WORKER_FMT_FIELDS, worker->id, worker->tasks_pushed,
+			worker->tasks_run, worker->tasks_stolen, worker->tasks_queued);
+	}
+	ast_rwlock_unlock(&pool->workers_lock);
+
+#undef FMT_HEADERS
+#undef FMT_FIELDS
+#undef WORKER_FMT_HEADERS
+#undef WORKER_FMT_FIELDS
+
+	return 0;
+}
+
+static char *cli_threadpool_report(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	int count = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "core show threadpools";
+		e->usage =
+			"Usage: core show threadpools\n"
+			"	Shows a list of threadpools and their statistics. For threadpools\n"
+			"	using work stealing the task counters of each worker are shown too.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != e->args) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "\n");
+	/*
+	 * The container stays locked while reporting, so a pool can not finish
+	 * shutting down and release its taskprocessor in the meantime.
+	 */
+	ao2_callback_data(threadpools, OBJ_NODATA, threadpool_report_cb, a, &count);
+	ast_cli(a->fd, "\n%d threadpools\n\n", count);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry threadpool_clis[] = {
+	AST_CLI_DEFINE(cli_threadpool_report, "List threadpools and statistics"),
+};
+
+/*!
+ * \internal
+ * \brief Clean up resources on Asterisk shutdown
+ */
+static void threadpool_shutdown(void)
+{
+	ast_cli_unregister_multiple(threadpool_clis, ARRAY_LEN(threadpool_clis));
+	ao2_cleanup(threadpools);
+	threadpools = NULL;
+}
+
+int ast_threadpool_init(void)
+{
+	threadpools = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		threadpool_sort_cb, NULL);
+	if (!threadpools) {
+		return -1;
+	}
+
+	ast_cli_register_multiple(threadpool_clis, ARRAY_LEN(threadpool_clis));
+
+	ast_register_cleanup(threadpool_shutdown);
+
+	return 0;
+}
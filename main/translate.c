@@ -31,7 +31,9 @@
 
 #include <sys/time.h>
 #include <sys/resource.h>
+#include <sys/stat.h>
 #include <math.h>
+#include <dlfcn.h>
 
 #include "asterisk/lock.h"
 #include "asterisk/channel.h"
@@ -43,6 +45,11 @@
 #include "asterisk/term.h"
 #include "asterisk/format.h"
 #include "asterisk/linkedlists.h"
+#include "asterisk/astdb.h"
+#include "asterisk/ast_version.h"
+#include "asterisk/buildinfo.h"
+#include "asterisk/_private.h"
+#include "asterisk/frame_latency.h"
 
 /*! \todo
  * TODO: sample frames for each supported input format.
@@ -53,6 +60,9 @@
 /*! max sample recalc */
 #define MAX_RECALC 1000
 
+/*! astdb family holding the measured computational costs */
+#define TRANSLATOR_COST_FAMILY "translator_cost"
+
 /*! \brief the list of translators */
 static AST_RWLIST_HEAD_STATIC(translators, ast_translator);
 
@@ -90,11 +100,22 @@ static ast_rwlock_t tablelock;
 /* index size grows by this as necessary */
 #define GROW_INDEX 16
 
+/*! Most idle paths kept for one pair of formats */
+#define TRANSLATOR_POOL_MAX_IDLE 32
+
 /*! the current largest index used by the __matrix and __indextable arrays*/
 static int cur_max_index;
 /*! the largest index that can be used in either the __indextable or __matrix before resize must occur */
 static int index_size;
 
+/*! Nonzero while matrix rebuilds for newly available translators are deferred */
+static int rebuild_deferred;
+/*! A translator became available while rebuilds were deferred */
+static int rebuild_pending;
+
+/*! CPU model name, part of the computational cost fingerprint */
+static char cpu_model[128] = "unknown";
+
 static void matrix_rebuild(int samples);
 
 /*!
@@ -288,7 +309,11 @@ static struct translator_path *matrix_get(unsigned int x, unsigned int y)
  * wrappers around the translator routines.
  */
 
-static void destroy(struct ast_trans_pvt *pvt)
+/*!
+ * \internal
+ * \brief Release everything a translator step holds except its memory.
+ */
+static void pvt_release(struct ast_trans_pvt *pvt)
 {
 	struct ast_translator *t = pvt->t;
 
@@ -296,44 +321,31 @@ static void destroy(struct ast_trans_pvt *pvt)
 		t->destroy(pvt);
 	}
 	ao2_cleanup(pvt->f.subclass.format);
+	pvt->f.subclass.format = NULL;
 	if (pvt->explicit_dst) {
 		ao2_ref(pvt->explicit_dst, -1);
 		pvt->explicit_dst = NULL;
 	}
-	ast_free(pvt);
 	ast_module_unref(t->module);
 }
 
+static void destroy(struct ast_trans_pvt *pvt)
+{
+	pvt_release(pvt);
+	ast_free(pvt);
+}
+
 /*!
- * \brief Allocate the descriptor, required outbuf space,
- * and possibly desc.
+ * \internal
+ * \brief Initialize the state of a translator step whose memory is laid out.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, in which case only the memory remains to be freed
  */
-static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format *explicit_dst)
+static int pvt_init(struct ast_trans_pvt *pvt, struct ast_format *explicit_dst)
 {
-	struct ast_trans_pvt *pvt;
-	int len;
-	char *ofs;
+	struct ast_translator *t = pvt->t;
 
-	/*
-	 * compute the required size adding private descriptor,
-	 * buffer, AST_FRIENDLY_OFFSET.
-	 */
-	len = sizeof(*pvt) + t->desc_size;
-	if (t->buf_size)
-		len += AST_FRIENDLY_OFFSET + t->buf_size;
-	pvt = ast_calloc(1, len);
-	if (!pvt) {
-		return NULL;
-	}
-	pvt->t = t;
-	ofs = (char *)(pvt + 1);	/* pointer to data space */
-	if (t->desc_size) {		/* first comes the descriptor */
-		pvt->pvt = ofs;
-		ofs += t->desc_size;
-	}
-	if (t->buf_size) {/* finally buffer and header */
-		pvt->outbuf.c = ofs + AST_FRIENDLY_OFFSET;
-	}
 	/*
 	 * If the format has an attribute module, explicit_dst includes the (joined)
 	 * result of the SDP negotiation. For example with the Opus Codec, the format
@@ -345,9 +357,10 @@ static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format
 
 	/* call local init routine, if present */
 	if (t->newpvt && t->newpvt(pvt)) {
-		ast_free(pvt);
+		ao2_cleanup(pvt->explicit_dst);
+		pvt->explicit_dst = NULL;
 		ast_module_unref(t->module);
-		return NULL;
+		return -1;
 	}
 
 	/* Setup normal static translation frame. */
@@ -375,8 +388,8 @@ static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format
 				t->dst_codec.type, t->dst_codec.sample_rate);
 			if (!codec) {
 				ast_log(LOG_ERROR, "Unable to get destination codec\n");
-				destroy(pvt);
-				return NULL;
+				pvt_release(pvt);
+				return -1;
 			}
 			pvt->f.subclass.format = ast_format_create(codec);
 			ao2_ref(codec, -1);
@@ -384,22 +397,270 @@ static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format
 
 		if (!pvt->f.subclass.format) {
 			ast_log(LOG_ERROR, "Unable to create format\n");
-			destroy(pvt);
-			return NULL;
+			pvt_release(pvt);
+			return -1;
 		}
 	}
 
+	return 0;
+}
+
+/*!
+ * \brief Allocate the descriptor, required outbuf space,
+ * and possibly desc.
+ */
+static struct ast_trans_pvt *newpvt(struct ast_translator *t, struct ast_format *explicit_dst)
+{
+	struct ast_trans_pvt *pvt;
+	int len;
+	char *ofs;
+
+	/*
+	 * compute the required size adding private descriptor,
+	 * buffer, AST_FRIENDLY_OFFSET.
+	 */
+	len = sizeof(*pvt) + t->desc_size;
+	if (t->buf_size)
+		len += AST_FRIENDLY_OFFSET + t->buf_size;
+	pvt = ast_calloc(1, len);
+	if (!pvt) {
+		return NULL;
+	}
+	pvt->t = t;
+	ofs = (char *)(pvt + 1);	/* pointer to data space */
+	if (t->desc_size) {		/* first comes the descriptor */
+		pvt->pvt = ofs;
+		ofs += t->desc_size;
+	}
+	if (t->buf_size) {/* finally buffer and header */
+		pvt->outbuf.c = ofs + AST_FRIENDLY_OFFSET;
+	}
+
+	if (pvt_init(pvt, explicit_dst)) {
+		ast_free(pvt);
+		return NULL;
+	}
+
 	return pvt;
 }
 
+/*!
+ * \internal
+ * \brief Return a translator step released by the path pool to the state newpvt() leaves it in.
+ */
+static int pvt_reinit(struct ast_trans_pvt *pvt, struct ast_format *explicit_dst)
+{
+	struct ast_translator *t = pvt->t;
+	void *desc = pvt->pvt;
+	char *outbuf = pvt->outbuf.c;
+	struct ast_trans_pvt *next = pvt->next;
+
+	memset(pvt, 0, sizeof(*pvt) + t->desc_size);
+	pvt->t = t;
+	pvt->pvt = desc;
+	pvt->outbuf.c = outbuf;
+	pvt->next = next;
+
+	return pvt_init(pvt, explicit_dst);
+}
+
+/*!
+ * \brief Idle translator paths for one source and destination format pair
+ *
+ * Building a path allocates every step and runs its translator's setup.
+ * When a path is freed its steps are released, but their memory is kept
+ * here so the next path between the same formats only has to run the
+ * translators' setup again.  The matrix indexes identify the codecs,
+ * including their sample rates.
+ */
+struct translator_pool {
+	/*! Matrix index of the source format */
+	int src_index;
+	/*! Matrix index of the destination format */
+	int dst_index;
+	/*! Number of paths in idle */
+	int num_idle;
+	/*! Released paths, still linked through their next pointers */
+	struct ast_trans_pvt *idle[TRANSLATOR_POOL_MAX_IDLE];
+};
+
+/*! \brief Pools of idle paths, emptied whenever the matrix is rebuilt */
+static struct ao2_container *translator_pools;
+
+static int translator_pool_hash_fn(const void *obj, const int flags)
+{
+	const struct translator_pool *pool = obj;
+
+	return pool->src_index * 31 + pool->dst_index;
+}
+
+static int translator_pool_cmp_fn(void *obj, void *arg, int flags)
+{
+	const struct translator_pool *left = obj;
+	const struct translator_pool *right = arg;
+
+	return (left->src_index == right->src_index && left->dst_index == right->dst_index)
+		? CMP_MATCH : 0;
+}
+
+static void chain_free(struct ast_trans_pvt *p)
+{
+	struct ast_trans_pvt *pn = p;
+
+	while ((p = pn)) {
+		pn = p->next;
+		ast_free(p);
+	}
+}
+
+static void translator_pool_destructor(void *obj)
+{
+	struct translator_pool *pool = obj;
+	int i;
+
+	for (i = 0; i < pool->num_idle; i++) {
+		chain_free(pool->idle[i]);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Throw away every idle path.
+ *
+ * \note Must be called with the translators list write locked.
+ */
+static void translator_pools_flush(void)
+{
+	if (translator_pools) {
+		ao2_callback(translator_pools, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Try to reuse an idle path.
+ *
+ * \note Must be called with the translators list locked.
+ *
+ * \return A path ready for use, or NULL if none is idle.
+ */
+static struct ast_trans_pvt *translator_pool_get(int src_index, int dst_index, struct ast_format *dst)
+{
+	struct translator_pool key = { .src_index = src_index, .dst_index = dst_index, };
+	struct translator_pool *pool;
+	struct ast_trans_pvt *head = NULL;
+	struct ast_trans_pvt *cur;
+
+	if (!translator_pools) {
+		return NULL;
+	}
+	pool = ao2_find(translator_pools, &key, OBJ_SEARCH_OBJECT);
+	if (!pool) {
+		return NULL;
+	}
+	ao2_lock(pool);
+	if (pool->num_idle) {
+		head = pool->idle[--pool->num_idle];
+	}
+	ao2_unlock(pool);
+	ao2_ref(pool, -1);
+
+	for (cur = head; cur; cur = cur->next) {
+		struct ast_format *explicit_dst = NULL;
+
+		if ((cur->t->dst_codec.sample_rate == ast_format_get_sample_rate(dst))
+			&& (cur->t->dst_codec.type == ast_format_get_type(dst))) {
+			explicit_dst = dst;
+		}
+		if (pvt_reinit(cur, explicit_dst)) {
+			struct ast_trans_pvt *done;
+
+			/* Release the steps already set up, then give up on the whole path. */
+			for (done = head; done != cur; done = done->next) {
+				pvt_release(done);
+			}
+			chain_free(head);
+			return NULL;
+		}
+		cur->nextin = cur->nextout = ast_tv(0, 0);
+	}
+
+	return head;
+}
+
+/*!
+ * \internal
+ * \brief Release a path and keep its memory for reuse.
+ *
+ * \retval 0 if the path was released, whether or not its pool had room for it
+ * \retval -1 if the path is stale and the caller must still destroy it
+ */
+static int translator_pool_put(struct ast_trans_pvt *head)
+{
+	struct translator_pool key;
+	struct translator_pool *pool;
+	struct ast_trans_pvt *cur;
+	int src_index;
+
+	key.src_index = src_index = head->t->src_fmt_index;
+	for (cur = head; cur->next; cur = cur->next) {
+	}
+	key.dst_index = cur->t->dst_fmt_index;
+
+	AST_RWLIST_RDLOCK(&translators);
+
+	if (!translator_pools) {
+		AST_RWLIST_UNLOCK(&translators);
+		return -1;
+	}
+
+	/* Only keep the path if it is still the one the matrix would build. */
+	for (cur = head; cur; cur = cur->next) {
+		if (matrix_get(src_index, key.dst_index)->step != cur->t) {
+			AST_RWLIST_UNLOCK(&translators);
+			return -1;
+		}
+		src_index = cur->t->dst_fmt_index;
+	}
+
+	ao2_lock(translator_pools);
+	pool = ao2_find(translator_pools, &key, OBJ_SEARCH_OBJECT | OBJ_NOLOCK);
+	if (!pool && (pool = ao2_alloc(sizeof(*pool), translator_pool_destructor))) {
+		pool->src_index = key.src_index;
+		pool->dst_index = key.dst_index;
+		ao2_link_flags(translator_pools, pool, OBJ_NOLOCK);
+	}
+	ao2_unlock(translator_pools);
+	if (!pool) {
+		AST_RWLIST_UNLOCK(&translators);
+		return -1;
+	}
+
+	for (cur = head; cur; cur = cur->next) {
+		pvt_release(cur);
+	}
+
+	ao2_lock(pool);
+	if (pool->num_idle < TRANSLATOR_POOL_MAX_IDLE) {
+		pool->idle[pool->num_idle++] = head;
+		head = NULL;
+	}
+	ao2_unlock(pool);
+	ao2_ref(pool, -1);
+
+	AST_RWLIST_UNLOCK(&translators);
+
+	/* The pool is full, but the path has already been released. */
+	chain_free(head);
+
+	return 0;
+}
+
 /*! \brief framein wrapper, deals with bound checks.  */
 static int framein(struct ast_trans_pvt *pvt, struct ast_frame *f)
 {
 	/* Copy the last in jb timing info to the pvt */
-	ast_copy_flags(&pvt->f, f, AST_FRFLAG_HAS_TIMING_INFO);
-	pvt->f.ts = f->ts;
-	pvt->f.len = f->len;
-	pvt->f.seqno = f->seqno;
+	ast_trans_frame_timing(pvt, f);
 
 	if (f->samples == 0) {
 		ast_log(LOG_WARNING, "no samples for %s\n", pvt->t->name);
@@ -457,7 +718,8 @@ static struct ast_frame *default_frameout(struct ast_trans_pvt *pvt)
 
 /* end of callback wrappers and helpers */
 
-void ast_translator_free_path(struct ast_trans_pvt *p)
+/*! \brief Destroy every step of a path */
+static void chain_destroy(struct ast_trans_pvt *p)
 {
 	struct ast_trans_pvt *pn = p;
 	while ( (p = pn) ) {
@@ -466,6 +728,14 @@ void ast_translator_free_path(struct ast_trans_pvt *p)
 	}
 }
 
+void ast_translator_free_path(struct ast_trans_pvt *p)
+{
+	if (p && !translator_pool_put(p)) {
+		return;
+	}
+	chain_destroy(p);
+}
+
 /*! \brief Build a chain of translators based upon the given source and dest formats */
 struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct ast_format *src)
 {
@@ -482,6 +752,11 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 
 	AST_RWLIST_RDLOCK(&translators);
 
+	if (src_index != dst_index && (head = translator_pool_get(src_index, dst_index, dst))) {
+		AST_RWLIST_UNLOCK(&translators);
+		return head;
+	}
+
 	while (src_index != dst_index) {
 		struct ast_trans_pvt *cur;
 		struct ast_format *explicit_dst = NULL;
@@ -499,7 +774,7 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 			ast_log(LOG_WARNING, "Failed to build translator step from %s to %s\n",
 				ast_format_get_name(src), ast_format_get_name(dst));
 			if (head) {
-				ast_translator_free_path(head);
+				chain_destroy(head);
 			}
 			AST_RWLIST_UNLOCK(&translators);
 			return NULL;
@@ -519,12 +794,42 @@ struct ast_trans_pvt *ast_translator_build_path(struct ast_format *dst, struct a
 	return head;
 }
 
+/*!
+ * \internal
+ * \brief Carry the ingress time of a translated frame over to the output.
+ *
+ * \param path Translation path used.
+ * \param out Frames the path produced.
+ * \param ingress Ingress time of the frame translated.
+ */
+static void translate_latency(struct ast_trans_pvt *path, struct ast_frame *out, struct timeval ingress)
+{
+	struct ast_trans_pvt *last;
+	struct ast_frame *cur;
+	char name[64];
+
+	for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		cur->ingress = ingress;
+	}
+	if (ast_tvzero(ingress)) {
+		return;
+	}
+
+	for (last = path; last->next; last = last->next) {
+	}
+	snprintf(name, sizeof(name), "%s/%u->%s/%u",
+		path->t->src_codec.name, path->t->src_codec.sample_rate,
+		last->t->dst_codec.name, last->t->dst_codec.sample_rate);
+	ast_frame_latency_record(AST_FRAME_LATENCY_TRANSLATE, name, ingress);
+}
+
 /*! \brief do the actual translation */
 struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f, int consume)
 {
 	struct ast_trans_pvt *p = path;
 	struct ast_frame *out;
 	struct timeval delivery;
+	struct timeval ingress = f->ingress;
 	int has_timing_info;
 	long ts;
 	long len;
@@ -571,6 +876,8 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 		out = p->t->frameout(p);
 	}
 	if (out) {
+		translate_latency(path, out, ingress);
+
 		/* we have a frame, play with times */
 		if (!ast_tvzero(delivery)) {
 			struct ast_frame *current = out;
@@ -620,6 +927,99 @@ struct ast_frame *ast_translate(struct ast_trans_pvt *path, struct ast_frame *f,
 	return out;
 }
 
+/*!
+ * \internal
+ * \brief Append a list of frames to another.
+ *
+ * \return The new tail of the list.
+ */
+static struct ast_frame *frame_list_append(struct ast_frame **head, struct ast_frame *tail, struct ast_frame *frames)
+{
+	if (!frames) {
+		return tail;
+	}
+	if (tail) {
+		AST_LIST_NEXT(tail, frame_list) = frames;
+	} else {
+		*head = frames;
+	}
+	for (tail = frames; AST_LIST_NEXT(tail, frame_list); tail = AST_LIST_NEXT(tail, frame_list)) {
+	}
+	return tail;
+}
+
+/*! \brief Run one translator step over every frame of a batch */
+static struct ast_frame *translate_batch_default(struct ast_trans_pvt *pvt, struct ast_frame *in)
+{
+	struct ast_frame *head = NULL;
+	struct ast_frame *tail = NULL;
+
+	for (; in; in = AST_LIST_NEXT(in, frame_list)) {
+		framein(pvt, in);
+		tail = frame_list_append(&head, tail, pvt->t->frameout(pvt));
+	}
+
+	return head;
+}
+
+struct ast_frame *ast_translate_list(struct ast_trans_pvt *path, struct ast_frame *frames, int consume)
+{
+	struct ast_trans_pvt *p;
+	struct ast_frame *out = frames;
+	struct ast_frame *cur;
+
+	for (cur = frames; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		if (!ast_tvzero(cur->delivery)) {
+			break;
+		}
+	}
+	if (cur) {
+		struct ast_frame *head = NULL;
+		struct ast_frame *tail = NULL;
+		struct ast_frame *next;
+
+		/* Delivery times are predicted frame by frame, so do exactly that. */
+		for (cur = frames; cur; cur = next) {
+			next = AST_LIST_NEXT(cur, frame_list);
+			AST_LIST_NEXT(cur, frame_list) = NULL;
+			tail = frame_list_append(&head, tail, ast_translate(path, cur, 0));
+			AST_LIST_NEXT(cur, frame_list) = next;
+		}
+		if (consume) {
+			ast_frfree(frames);
+		}
+		return head;
+	}
+
+	for (p = path; out && p; p = p->next) {
+		struct ast_frame *in = out;
+
+		if (p->t->translate_batch) {
+			out = p->t->translate_batch(p, in);
+		} else {
+			out = translate_batch_default(p, in);
+		}
+		if (in != frames) {
+			ast_frfree(in);
+		}
+	}
+
+	if (out) {
+		translate_latency(path, out, frames->ingress);
+	}
+	for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+		cur->delivery = ast_tv(0, 0);
+		/* Invalidate prediction if we're entering a silence period */
+		if (cur->frametype == AST_FRAME_CNG) {
+			path->nextout = ast_tv(0, 0);
+		}
+	}
+	if (consume) {
+		ast_frfree(frames);
+	}
+	return out;
+}
+
 /*!
  * \internal
  * \brief Compute the computational cost of a single translation step.
@@ -689,6 +1089,109 @@ static void generate_computational_cost(struct ast_translator *t, int seconds)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Read the CPU model name from /proc/cpuinfo, if there is one.
+ */
+static void cpu_model_load(void)
+{
+	FILE *fp;
+	char line[256];
+
+	if (!(fp = fopen("/proc/cpuinfo", "r"))) {
+		return;
+	}
+	while (fgets(line, sizeof(line), fp)) {
+		char *value;
+
+		if (strncmp(line, "model name", 10) || !(value = strchr(line, ':'))) {
+			continue;
+		}
+		ast_copy_string(cpu_model, ast_strip(value + 1), sizeof(cpu_model));
+		break;
+	}
+	fclose(fp);
+}
+
+/*!
+ * \internal
+ * \brief Fingerprint of everything a measured computational cost depends on.
+ *
+ * A stored cost is only reused when the Asterisk build, the file providing
+ * the translator and the CPU model are all unchanged.
+ */
+static unsigned int translator_cost_fingerprint(const struct ast_translator *t)
+{
+	char buf[512];
+	Dl_info info;
+	struct stat st;
+	time_t mtime = 0;
+	void *addr = t->framein ? (void *) t->framein : (void *) t->sample;
+
+	if (addr && dladdr(addr, &info) && info.dli_fname && !stat(info.dli_fname, &st)) {
+		mtime = st.st_mtime;
+	}
+
+	snprintf(buf, sizeof(buf), "%s|%s|%s|%ld|%s", ast_get_version(), ast_build_date,
+		ast_module_name(t->module), (long) mtime, cpu_model);
+
+	return (unsigned int) ast_str_hash(buf);
+}
+
+/*!
+ * \internal
+ * \brief Key a translator's stored computational cost is kept under.
+ */
+static void translator_cost_key(const struct ast_translator *t, char *key, size_t len)
+{
+	snprintf(key, len, "%s/%s", ast_module_name(t->module), t->name);
+}
+
+/*!
+ * \internal
+ * \brief Use a previously measured computational cost for a translator.
+ *
+ * \retval 0 if a valid stored cost was applied.
+ * \retval -1 if the cost needs to be measured.
+ */
+static int translator_cost_load(struct ast_translator *t)
+{
+	char key[256];
+	char value[64];
+	int cost;
+	unsigned int fingerprint;
+
+	translator_cost_key(t, key, sizeof(key));
+	if (ast_db_get(TRANSLATOR_COST_FAMILY, key, value, sizeof(value))) {
+		return -1;
+	}
+
+	if (sscanf(value, "%30d:%30x", &cost, &fingerprint) != 2 || cost <= 0
+		|| fingerprint != translator_cost_fingerprint(t)) {
+		ast_debug(3, "Stored computational cost for translator '%s' is stale.\n", t->name);
+		return -1;
+	}
+
+	t->comp_cost = cost;
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Remember a translator's measured computational cost.
+ */
+static void translator_cost_store(const struct ast_translator *t)
+{
+	char key[256];
+	char value[64];
+
+	translator_cost_key(t, key, sizeof(key));
+	snprintf(value, sizeof(value), "%d:%x", t->comp_cost, translator_cost_fingerprint(t));
+	if (ast_db_put(TRANSLATOR_COST_FAMILY, key, value)) {
+		ast_debug(1, "Unable to store computational cost for translator '%s'.\n", t->name);
+	}
+}
+
 /*!
  * \internal
  *
@@ -773,6 +1276,9 @@ static void matrix_rebuild(int samples)
 
 	ast_debug(1, "Resetting translation matrix\n");
 
+	/* Idle paths may no longer be the best, or may use a translator on its way out. */
+	translator_pools_flush();
+
 	matrix_clear();
 
 	/* first, compute all direct costs */
@@ -786,6 +1292,7 @@ static void matrix_rebuild(int samples)
 
 		if (samples) {
 			generate_computational_cost(t, samples);
+			translator_cost_store(t);
 		}
 
 		/* This new translator is the best choice if any of the below are true.
@@ -858,6 +1365,45 @@ static void matrix_rebuild(int samples)
 	}
 }
 
+/*!
+ * \internal
+ * \brief Rebuild the matrix because a translator became available.
+ *
+ * The current matrix only refers to translators that are still registered,
+ * so while modules are being loaded the rebuild is put off and done once
+ * when ast_translate_defer_rebuild() ends the deferral.
+ *
+ * \note This function expects the list of translators to be locked
+ */
+static void matrix_rebuild_added(void)
+{
+	if (rebuild_deferred) {
+		rebuild_pending = 1;
+		return;
+	}
+	matrix_rebuild(0);
+}
+
+void ast_translate_defer_rebuild(int defer)
+{
+	AST_RWLIST_WRLOCK(&translators);
+	rebuild_deferred = defer;
+	if (!defer && rebuild_pending) {
+		rebuild_pending = 0;
+		matrix_rebuild(0);
+	}
+	AST_RWLIST_UNLOCK(&translators);
+}
+
+void ast_translate_path_set_quality(struct ast_trans_pvt *p, enum ast_translate_quality quality)
+{
+	for (; p; p = p->next) {
+		if (p->t->set_quality && p->t->set_quality(p, quality)) {
+			ast_debug(1, "Unable to change the quality of translator '%s'\n", p->t->name);
+		}
+	}
+}
+
 static void codec_append_name(const struct ast_codec *codec, struct ast_str **buf)
 {
 	if (codec) {
@@ -1091,7 +1637,9 @@ static char *handle_cli_core_show_translation(struct ast_cli_entry *e, int cmd,
 			"          Displays known codec translators and the cost associated\n"
 			"          with each conversion.  If the argument 'recalc' is supplied along\n"
 			"          with optional number of seconds to test a new test will be performed\n"
-			"          as the chart is being displayed.\n"
+			"          as the chart is being displayed.  Measured costs are remembered\n"
+			"          across restarts until Asterisk, the module or the CPU changes,\n"
+			"          so 'recalc' is the way to refresh them.\n"
 			"       2. 'core show translation paths [codec [sample_rate]]'\n"
 			"           This will display all the translation paths associated with a codec.\n"
 			"           If a codec has multiple sample rates, the sample rate must be\n"
@@ -1212,7 +1760,10 @@ int __ast_register_translator(struct ast_translator *t, struct ast_module *mod)
 		t->frameout = default_frameout;
 	}
 
-	generate_computational_cost(t, 1);
+	if (translator_cost_load(t)) {
+		generate_computational_cost(t, 1);
+		translator_cost_store(t);
+	}
 
 	ast_verb(2, "Registered translator '%s' from codec %s to %s, table cost, %d, computational cost %d\n",
 		 term_color(tmp, t->name, COLOR_MAGENTA, COLOR_BLACK, sizeof(tmp)),
@@ -1239,7 +1790,7 @@ int __ast_register_translator(struct ast_translator *t, struct ast_module *mod)
 		AST_RWLIST_INSERT_HEAD(&translators, t, list);
 	}
 
-	matrix_rebuild(0);
+	matrix_rebuild_added();
 
 	AST_RWLIST_UNLOCK(&translators);
 
@@ -1279,7 +1830,7 @@ void ast_translator_activate(struct ast_translator *t)
 {
 	AST_RWLIST_WRLOCK(&translators);
 	t->active = 1;
-	matrix_rebuild(0);
+	matrix_rebuild_added();
 	AST_RWLIST_UNLOCK(&translators);
 }
 
@@ -1501,6 +2052,11 @@ static void translate_shutdown(void)
 	int x;
 	ast_cli_unregister_multiple(cli_translate, ARRAY_LEN(cli_translate));
 
+	AST_RWLIST_WRLOCK(&translators);
+	ao2_cleanup(translator_pools);
+	translator_pools = NULL;
+	AST_RWLIST_UNLOCK(&translators);
+
 	ast_rwlock_wrlock(&tablelock);
 	for (x = 0; x < index_size; x++) {
 		ast_free(__matrix[x]);
@@ -1517,6 +2073,11 @@ int ast_translate_init(void)
 {
 	int res = 0;
 	ast_rwlock_init(&tablelock);
+	translator_pools = ao2_container_alloc(61, translator_pool_hash_fn, translator_pool_cmp_fn);
+	if (!translator_pools) {
+		return -1;
+	}
+	cpu_model_load();
 	res = matrix_resize(1);
 	res |= ast_cli_register_multiple(cli_translate, ARRAY_LEN(cli_translate));
 	ast_register_cleanup(translate_shutdown);
@@ -212,6 +212,13 @@ struct ast_udptl {
 	unsigned int tx_seq_no;
 	unsigned int rx_seq_no;
 
+	/*! The session received packets are relayed to, protected by \ref relay_lock */
+	struct ast_udptl *relay;
+	/*! Added to the sequence number of a relayed packet */
+	unsigned int relay_offset;
+	/*! Non-zero once \c relay_offset is set by the first relayed packet */
+	int relay_mapped;
+
 	udptl_fec_tx_buffer_t tx[UDPTL_BUF_MASK + 1];
 	udptl_fec_rx_buffer_t rx[UDPTL_BUF_MASK + 1];
 };
@@ -227,6 +234,12 @@ struct udptl_global_options {
 
 static AO2_GLOBAL_OBJ_STATIC(globals);
 
+/*! \brief Lock that protects the relay of every session */
+AST_RWLOCK_DEFINE_STATIC(relay_lock);
+
+/*! \brief Registered channel driver glue */
+static AST_RWLIST_HEAD_STATIC(glues, ast_udptl_glue);
+
 struct udptl_config {
 	struct udptl_global_options *general;
 };
@@ -740,6 +753,80 @@ static int udptlread(int *id, int fd, short events, void *cbdata)
 	return 1;
 }
 
+/*!
+ * \internal
+ * \brief Send a received packet on from the session it is relayed to
+ *
+ * \note Only the sequence number is rewritten.  It is offset by a constant,
+ * so gaps are preserved and the far end can recover lost packets from the
+ * error correction the packet already carries.
+ *
+ * \retval 0 the packet was relayed
+ * \retval -1 the packet has to be read as frames
+ */
+static int udptl_relay_packet(struct ast_udptl *s, uint8_t *buf, unsigned int len)
+{
+	struct ast_udptl *peer;
+	unsigned int seq_no;
+	unsigned int out_seq_no;
+	unsigned int tx_seq_no;
+	unsigned int delta;
+	int res = -1;
+
+	if (len < 2) {
+		return -1;
+	}
+	seq_no = (buf[0] << 8) | buf[1];
+
+	ast_rwlock_rdlock(&relay_lock);
+	peer = s->relay;
+	if (!peer || peer->error_correction_scheme != s->error_correction_scheme
+		|| !peer->tag || ast_sockaddr_isnull(&peer->them)) {
+		ast_rwlock_unlock(&relay_lock);
+		return -1;
+	}
+
+	if (!s->relay_mapped) {
+		s->relay_offset = __atomic_load_n(&peer->tx_seq_no, __ATOMIC_RELAXED) - seq_no;
+		s->relay_mapped = 1;
+	}
+	out_seq_no = (seq_no + s->relay_offset) & 0xFFFF;
+
+	/* Move the peer's own sequence past the packet, so it carries on from here if the relay stops */
+	tx_seq_no = __atomic_load_n(&peer->tx_seq_no, __ATOMIC_RELAXED);
+	do {
+		delta = (out_seq_no - tx_seq_no) & 0xFFFF;
+		if (delta >= 0x8000) {
+			/* An older packet, received out of order */
+			break;
+		}
+	} while (!__atomic_compare_exchange_n(&peer->tx_seq_no, &tx_seq_no, tx_seq_no + delta + 1,
+		0, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+	/* Neither side may use the packet's slot for error correction of its own */
+	peer->tx[out_seq_no & UDPTL_BUF_MASK].buf_len = 0;
+	s->rx[seq_no & UDPTL_BUF_MASK].buf_len = -1;
+	if (seq_no >= s->rx_seq_no) {
+		s->rx_seq_no = seq_no + 1;
+	}
+
+	buf[0] = (out_seq_no >> 8) & 0xFF;
+	buf[1] = out_seq_no & 0xFF;
+	if (ast_sendto(peer->fd, buf, len, 0, &peer->them) < 0) {
+		ast_log(LOG_NOTICE, "UDPTL (%s): Relay error to %s: %s\n",
+			LOG_TAG(peer), ast_sockaddr_stringify(&peer->them), strerror(errno));
+	} else {
+		res = 0;
+	}
+	if (udptl_debug_test_addr(&peer->them)) {
+		ast_verb(1, "UDPTL (%s): relayed packet to %s (seq %u, len %u)\n",
+			LOG_TAG(peer), ast_sockaddr_stringify(&peer->them), out_seq_no, len);
+	}
+	ast_rwlock_unlock(&relay_lock);
+
+	return res;
+}
+
 struct ast_frame *ast_udptl_read(struct ast_udptl *udptl)
 {
 	int res;
@@ -802,6 +889,9 @@ struct ast_frame *ast_udptl_read(struct ast_udptl *udptl)
 		ast_verb(1, "UDPTL (%s): packet from %s (seq %d, len %d)\n",
 			LOG_TAG(udptl), ast_sockaddr_stringify(&addr), seq_no, res);
 	}
+	if (__atomic_load_n(&udptl->relay, __ATOMIC_RELAXED) && !udptl_relay_packet(udptl, buf, res)) {
+		return &ast_null_frame;
+	}
 	if (udptl_rx_packet(udptl, buf, res) < 1) {
 		return &ast_null_frame;
 	}
@@ -1131,8 +1221,90 @@ void ast_udptl_stop(struct ast_udptl *udptl)
 	ast_sockaddr_setnull(&udptl->them);
 }
 
+/*!
+ * \internal
+ * \brief Stop relaying a session and its peer
+ *
+ * \note Must be called with \ref relay_lock write locked
+ */
+static void udptl_relay_clear(struct ast_udptl *udptl)
+{
+	if (!udptl->relay) {
+		return;
+	}
+
+	udptl->relay->relay = NULL;
+	udptl->relay->relay_mapped = 0;
+	udptl->relay = NULL;
+	udptl->relay_mapped = 0;
+}
+
+void ast_udptl_set_relay(struct ast_udptl *udptl, struct ast_udptl *peer)
+{
+	ast_rwlock_wrlock(&relay_lock);
+	udptl_relay_clear(udptl);
+	if (peer && peer != udptl) {
+		udptl_relay_clear(peer);
+		udptl->relay = peer;
+		peer->relay = udptl;
+	}
+	ast_rwlock_unlock(&relay_lock);
+
+	ast_debug(1, "UDPTL (%s): %s\n", LOG_TAG(udptl), peer ? "Relaying" : "No longer relaying");
+}
+
+int ast_udptl_glue_register(struct ast_udptl_glue *glue)
+{
+	struct ast_udptl_glue *cur;
+
+	AST_RWLIST_WRLOCK(&glues);
+	AST_RWLIST_TRAVERSE(&glues, cur, entry) {
+		if (!strcasecmp(cur->type, glue->type)) {
+			ast_log(LOG_WARNING, "UDPTL glue for '%s' is already registered\n", glue->type);
+			AST_RWLIST_UNLOCK(&glues);
+			return -1;
+		}
+	}
+	AST_RWLIST_INSERT_TAIL(&glues, glue, entry);
+	AST_RWLIST_UNLOCK(&glues);
+
+	return 0;
+}
+
+int ast_udptl_glue_unregister(struct ast_udptl_glue *glue)
+{
+	struct ast_udptl_glue *cur;
+
+	AST_RWLIST_WRLOCK(&glues);
+	cur = AST_RWLIST_REMOVE(&glues, glue, entry);
+	AST_RWLIST_UNLOCK(&glues);
+
+	return cur ? 0 : -1;
+}
+
+struct ast_udptl *ast_udptl_get_instance(struct ast_channel *chan)
+{
+	struct ast_udptl_glue *glue;
+	struct ast_udptl *udptl = NULL;
+
+	AST_RWLIST_RDLOCK(&glues);
+	AST_RWLIST_TRAVERSE(&glues, glue, entry) {
+		if (!strcasecmp(glue->type, ast_channel_tech(chan)->type)) {
+			udptl = glue->get_udptl(chan);
+			break;
+		}
+	}
+	AST_RWLIST_UNLOCK(&glues);
+
+	return udptl;
+}
+
 void ast_udptl_destroy(struct ast_udptl *udptl)
 {
+	ast_rwlock_wrlock(&relay_lock);
+	udptl_relay_clear(udptl);
+	ast_rwlock_unlock(&relay_lock);
+
 	if (udptl->ioid)
 		ast_io_remove(udptl->io, udptl->ioid);
 	if (udptl->fd > -1)
@@ -31,15 +31,87 @@
 #include "asterisk/strings.h"
 #include "asterisk/logger.h"
 #include "asterisk/lock.h"
+#include "asterisk/threadstorage.h"
 
 AST_MUTEX_DEFINE_STATIC(uuid_lock);
 
 static int has_dev_urandom;
 
+/*! \brief Number of UUIDs worth of random bytes a thread reads at once */
+#define UUID_BATCH 64
+
+/*! \brief /dev/urandom, kept open for the batches, or -1 */
+static int uuid_random_fd = -1;
+
+/*! \brief Bumped in forked children so they do not reuse their parent's batches */
+static unsigned int uuid_fork_generation;
+
 struct ast_uuid {
 	uuid_t uu;
 };
 
+/*! \brief Random bytes of a thread that UUIDs are made from */
+struct uuid_batch {
+	/*! uuid_fork_generation the bytes were read in */
+	unsigned int generation;
+	/*! Bytes not used yet, at the end of bytes */
+	unsigned int left;
+	unsigned char bytes[UUID_BATCH * sizeof(uuid_t)];
+};
+
+AST_THREADSTORAGE(uuid_batch_ts);
+
+static void uuid_atfork_child(void)
+{
+	++uuid_fork_generation;
+}
+
+/*!
+ * \internal
+ * \brief Make a random (version 4) UUID from the calling thread's batch.
+ *
+ * The batch is read from /dev/urandom when it is used up, so the kernel is
+ * only asked for random bytes once every \ref UUID_BATCH UUIDs.
+ *
+ * \retval 0 on success.
+ * \retval -1 if no random bytes could be read.
+ */
+static int generate_uuid_batched(struct ast_uuid *uuid)
+{
+	struct uuid_batch *batch;
+	size_t got;
+	ssize_t res;
+
+	if (uuid_random_fd < 0 || !(batch = ast_threadstorage_get(&uuid_batch_ts, sizeof(*batch)))) {
+		return -1;
+	}
+
+	if (!batch->left || batch->generation != uuid_fork_generation) {
+		batch->left = 0;
+		for (got = 0; got < sizeof(batch->bytes); got += res) {
+			res = read(uuid_random_fd, batch->bytes + got, sizeof(batch->bytes) - got);
+			if (res <= 0) {
+				if (res < 0 && errno == EINTR) {
+					res = 0;
+					continue;
+				}
+				return -1;
+			}
+		}
+		batch->generation = uuid_fork_generation;
+		batch->left = sizeof(batch->bytes);
+	}
+
+	memcpy(uuid->uu, batch->bytes + sizeof(batch->bytes) - batch->left, sizeof(uuid->uu));
+	batch->left -= sizeof(uuid->uu);
+
+	/* RFC 4122 section 4.4: version 4, variant 10x. */
+	uuid->uu[6] = (uuid->uu[6] & 0x0f) | 0x40;
+	uuid->uu[8] = (uuid->uu[8] & 0x3f) | 0x80;
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Generate a UUID.
@@ -107,7 +179,14 @@ static void generate_uuid(struct ast_uuid *uuid)
 	 *
 	 * Given these drawbacks, we stick to only using random UUIDs. The chance of /dev/random
 	 * or /dev/urandom not existing on systems in this age is next to none.
+	 *
+	 * uuid_generate_random() reads /dev/urandom for every UUID, so we make the
+	 * same random UUIDs from a batch of bytes read for many at once, and only
+	 * fall back to libuuid if that fails.
 	 */
+	if (!generate_uuid_batched(uuid)) {
+		return;
+	}
 
 	/* XXX Currently, we only protect this call if the user has no /dev/urandom on their system.
 	 * If it turns out that there are issues with UUID generation despite the presence of
@@ -223,7 +302,10 @@ void ast_uuid_init(void)
 				"system to have /dev/urandom\n");
 	} else {
 		has_dev_urandom = 1;
-		close(dev_urandom_fd);
+		/* Kept open for the batches of random bytes. */
+		fcntl(dev_urandom_fd, F_SETFD, FD_CLOEXEC);
+		uuid_random_fd = dev_urandom_fd;
+		pthread_atfork(NULL, NULL, uuid_atfork_child);
 	}
 	uuid_generate_random(uu);
 
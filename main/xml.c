@@ -60,19 +60,14 @@ int ast_xml_finish(void)
 	return 0;
 }
 
-struct ast_xml_doc *ast_xml_open(char *filename)
+/*!
+ * \internal
+ * \brief Expand the xinclude elements of a freshly parsed document and apply
+ *        its stylesheet processing instruction, if any.
+ * \note Takes ownership of doc.
+ */
+static xmlDoc *xml_doc_postprocess(xmlDoc *doc)
 {
-	xmlDoc *doc;
-
-	if (!filename) {
-		return NULL;
-	}
-
-	doc = xmlReadFile(filename, NULL, XML_PARSE_RECOVER);
-	if (!doc) {
-		return NULL;
-	}
-
 	/* process xinclude elements. */
 	if (xmlXIncludeProcess(doc) < 0) {
 		xmlFreeDoc(doc);
@@ -96,7 +91,39 @@ struct ast_xml_doc *ast_xml_open(char *filename)
 	ast_log(LOG_NOTICE, "XSLT support not found. XML documentation may be incomplete.\n");
 #endif /* HAVE_LIBXSLT */
 
-	return (struct ast_xml_doc *) doc;
+	return doc;
+}
+
+struct ast_xml_doc *ast_xml_open(char *filename)
+{
+	xmlDoc *doc;
+
+	if (!filename) {
+		return NULL;
+	}
+
+	doc = xmlReadFile(filename, NULL, XML_PARSE_RECOVER);
+	if (!doc) {
+		return NULL;
+	}
+
+	return (struct ast_xml_doc *) xml_doc_postprocess(doc);
+}
+
+struct ast_xml_doc *ast_xml_open_memory(const char *buffer, size_t size, const char *filename)
+{
+	xmlDoc *doc;
+
+	if (!buffer || !filename) {
+		return NULL;
+	}
+
+	doc = xmlReadMemory(buffer, (int) size, filename, NULL, XML_PARSE_RECOVER);
+	if (!doc) {
+		return NULL;
+	}
+
+	return (struct ast_xml_doc *) xml_doc_postprocess(doc);
 }
 
 struct ast_xml_doc *ast_xml_new(void)
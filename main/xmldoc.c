@@ -29,12 +29,15 @@
 
 #include "asterisk.h"
 
+#include <sys/stat.h>
+
 #include "asterisk/_private.h"
 #include "asterisk/paths.h"
 #include "asterisk/linkedlists.h"
 #include "asterisk/config.h"
 #include "asterisk/term.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/vector.h"
 #include "asterisk/xmldoc.h"
 #include "asterisk/cli.h"
 
@@ -50,13 +53,48 @@ static const int xmldoc_text_columns = 79;
 /*! \brief XML documentation language. */
 static char documentation_language[6];
 
+/*! \brief Index the documentation files at startup and parse items on first use. */
+static int documentation_lazy;
+
 /*! \brief XML documentation tree */
 struct documentation_tree {
 	char *filename;					/*!< XML document filename. */
-	struct ast_xml_doc *doc;			/*!< Open document pointer. */
+	struct ast_xml_doc *doc;			/*!< Open document pointer, NULL until needed when lazy. */
+	struct ao2_container *index;			/*!< Top level elements by type and name, when lazy. */
+	char *prolog;					/*!< Text through the root start tag, when lazy. */
+	off_t size;					/*!< File size when it was indexed. */
+	time_t mtime;					/*!< File modification time when it was indexed. */
+	unsigned int failed:1;				/*!< The whole document could not be parsed. */
 	AST_RWLIST_ENTRY(documentation_tree) entry;
 };
 
+/*! \brief Where one top level element sits in a documentation file */
+struct xmldoc_span {
+	off_t offset;					/*!< Offset of the start tag. */
+	size_t len;					/*!< Length through the end tag. */
+};
+
+/*! \brief The top level elements sharing a type and name in a documentation file */
+struct xmldoc_index_item {
+	AST_VECTOR(, struct xmldoc_span) spans;		/*!< The elements, in file order. */
+	struct ast_xml_doc *doc;			/*!< The elements and what they include, parsed on first use. */
+	unsigned int failed:1;				/*!< Parsing failed, don't try again. */
+	const char *name;				/*!< The name attribute, stored after type. */
+	char type[0];					/*!< The element name. */
+};
+
+/*! \brief Search key for an xmldoc_index_item */
+struct xmldoc_index_key {
+	const char *type;
+	const char *name;
+};
+
+/*! \brief Index items already copied into a fragment */
+AST_VECTOR(xmldoc_seen, struct xmldoc_index_item *);
+
+/*! \brief Serializes parsing whole documents on demand. */
+AST_MUTEX_DEFINE_STATIC(xmldoc_doc_lock);
+
 static char *xmldoc_get_syntax_cmd(struct ast_xml_node *fixnode, const char *name, int printname);
 static int xmldoc_parse_enumlist(struct ast_xml_node *fixnode, const char *tabs, struct ast_str **buffer);
 static void xmldoc_parse_parameter(struct ast_xml_node *fixnode, const char *tabs, struct ast_str **buffer);
@@ -417,6 +455,507 @@ static int xmldoc_attribute_match(struct ast_xml_node *node, const char *attr, c
 	return match;
 }
 
+int ast_xmldoc_lazy(void)
+{
+	return documentation_lazy;
+}
+
+static int xmldoc_index_item_hash(const void *obj, const int flags)
+{
+	const struct xmldoc_index_item *item;
+	const struct xmldoc_index_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		item = obj;
+		return ast_str_hash_add(item->name, ast_str_hash(item->type));
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_hash_add(key->name, ast_str_hash(key->type));
+}
+
+static int xmldoc_index_item_cmp(void *obj, void *arg, int flags)
+{
+	struct xmldoc_index_item *left = obj;
+	struct xmldoc_index_item *right = arg;
+	const struct xmldoc_index_key *key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		break;
+	case OBJ_SEARCH_OBJECT:
+		if (!strcmp(left->type, right->type) && !strcmp(left->name, right->name)) {
+			return CMP_MATCH;
+		}
+		return 0;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	if (!strcmp(left->type, key->type) && !strcmp(left->name, key->name)) {
+		return CMP_MATCH;
+	}
+	return 0;
+}
+
+static void xmldoc_index_item_destructor(void *obj)
+{
+	struct xmldoc_index_item *item = obj;
+
+	AST_VECTOR_FREE(&item->spans);
+	if (item->doc) {
+		ast_xml_close(item->doc);
+	}
+}
+
+static struct xmldoc_index_item *xmldoc_index_find(struct documentation_tree *doctree, const char *type, const char *name)
+{
+	struct xmldoc_index_key key = {
+		.type = type,
+		.name = name,
+	};
+
+	return ao2_find(doctree->index, &key, OBJ_SEARCH_KEY);
+}
+
+/*!
+ * \internal
+ * \brief Record where an element of a given type and name sits in a documentation file.
+ */
+static int xmldoc_index_add(struct documentation_tree *doctree, const char *type, const char *name, off_t offset, size_t len)
+{
+	struct xmldoc_index_item *item;
+	struct xmldoc_span span = {
+		.offset = offset,
+		.len = len,
+	};
+	size_t type_len = strlen(type) + 1;
+
+	item = xmldoc_index_find(doctree, type, name);
+	if (!item) {
+		item = ao2_alloc_options(sizeof(*item) + type_len + strlen(name) + 1,
+			xmldoc_index_item_destructor, AO2_ALLOC_OPT_LOCK_MUTEX);
+		if (!item) {
+			return -1;
+		}
+		strcpy(item->type, type); /* Safe */
+		item->name = strcpy(item->type + type_len, name); /* Safe */
+		if (AST_VECTOR_INIT(&item->spans, 1)) {
+			ao2_ref(item, -1);
+			return -1;
+		}
+		ao2_link(doctree->index, item);
+	}
+
+	if (AST_VECTOR_APPEND(&item->spans, span)) {
+		ao2_ref(item, -1);
+		return -1;
+	}
+	ao2_ref(item, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Find the end of the markup starting at p.
+ *
+ * \retval Pointer just past the closing '>'.
+ * \retval NULL if the markup isn't terminated.
+ */
+static const char *xmldoc_markup_end(const char *p)
+{
+	const char *close;
+	char quote = 0;
+	int brackets = 0;
+
+	if (!strncmp(p, "<!--", 4)) {
+		close = strstr(p + 4, "-->");
+		return close ? close + 3 : NULL;
+	} else if (!strncmp(p, "<![CDATA[", 9)) {
+		close = strstr(p + 9, "]]>");
+		return close ? close + 3 : NULL;
+	} else if (p[1] == '?') {
+		close = strstr(p + 2, "?>");
+		return close ? close + 2 : NULL;
+	}
+
+	/* Tags and the DOCTYPE, whose internal subset may hold '>' */
+	for (p++; *p; p++) {
+		if (quote) {
+			if (*p == quote) {
+				quote = 0;
+			}
+		} else if (*p == '"' || *p == '\'') {
+			quote = *p;
+		} else if (*p == '[') {
+			brackets++;
+		} else if (*p == ']') {
+			brackets--;
+		} else if (*p == '>' && brackets <= 0) {
+			return p + 1;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Copy the element name of the start tag at p.
+ */
+static void xmldoc_tag_name(const char *p, char *buf, size_t size)
+{
+	size_t len = strcspn(++p, " \t\r\n/>");
+
+	ast_copy_string(buf, p, MIN(len + 1, size));
+}
+
+/*!
+ * \internal
+ * \brief Copy the value of one attribute of the start tag between p and end.
+ *
+ * \retval 0 if the attribute was found.
+ * \retval -1 if it wasn't.
+ */
+static int xmldoc_tag_attribute(const char *p, const char *end, const char *attr, char *buf, size_t size)
+{
+	size_t attr_len = strlen(attr);
+	const char *value;
+	char quote;
+
+	p += strcspn(p, " \t\r\n/>");
+	while (p < end) {
+		p += strspn(p, " \t\r\n");
+		if (*p == '/' || *p == '>') {
+			break;
+		}
+		value = p + strcspn(p, " \t\r\n=");
+		if (*value != '=') {
+			value += strspn(value, " \t\r\n");
+		}
+		if (*value != '=') {
+			break;
+		}
+		value++;
+		value += strspn(value, " \t\r\n");
+		quote = *value;
+		if (quote != '"' && quote != '\'') {
+			break;
+		}
+		if (!strncmp(p, attr, attr_len) && strchr(" \t\r\n=", p[attr_len])) {
+			p = value + 1;
+			value = strchr(p, quote);
+			if (!value || value >= end) {
+				break;
+			}
+			ast_copy_string(buf, p, MIN(value - p + 1, size));
+			return 0;
+		}
+		p = strchr(value + 1, quote);
+		if (!p) {
+			break;
+		}
+		p++;
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Index the top level elements of a documentation file by type and name.
+ *
+ * \note This only scans for markup.  The file is still parsed properly when
+ *       an item is first asked for.
+ */
+static int xmldoc_index_build(struct documentation_tree *doctree, const char *text)
+{
+	const char *p = text;
+	const char *next;
+	const char *start = NULL;
+	char type[64];
+	char name[256];
+	int depth = 0;
+	int empty;
+
+	while ((p = strchr(p, '<'))) {
+		if (!(next = xmldoc_markup_end(p))) {
+			return -1;
+		}
+
+		if (p[1] == '!' || p[1] == '?') {
+			/* Comments, CDATA, processing instructions and the DOCTYPE */
+		} else if (p[1] == '/') {
+			if (--depth == 1 && start) {
+				if (xmldoc_index_add(doctree, type, name, start - text, next - start)) {
+					return -1;
+				}
+				start = NULL;
+			} else if (!depth) {
+				/* The end of the root element. */
+				return 0;
+			}
+		} else {
+			empty = next[-2] == '/';
+			if (!depth) {
+				xmldoc_tag_name(p, type, sizeof(type));
+				if (empty || strcmp(type, "docs")) {
+					return -1;
+				}
+				doctree->prolog = ast_strndup(text, next - text);
+				if (!doctree->prolog) {
+					return -1;
+				}
+			} else if (depth == 1) {
+				xmldoc_tag_name(p, type, sizeof(type));
+				if (!xmldoc_tag_attribute(p, next, "name", name, sizeof(name))) {
+					start = p;
+				}
+				if (empty && start) {
+					if (xmldoc_index_add(doctree, type, name, start - text, next - start)) {
+						return -1;
+					}
+					start = NULL;
+				}
+			}
+			if (!empty) {
+				depth++;
+			}
+		}
+		p = next;
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Read a documentation file and index it.
+ */
+static int xmldoc_index_file(struct documentation_tree *doctree)
+{
+	struct stat st;
+	char *text;
+	FILE *f;
+	int res;
+
+	if (!(f = fopen(doctree->filename, "r"))) {
+		return -1;
+	}
+	if (fstat(fileno(f), &st) || !(text = ast_malloc(st.st_size + 1))) {
+		fclose(f);
+		return -1;
+	}
+	res = fread(text, 1, st.st_size, f) == st.st_size ? 0 : -1;
+	fclose(f);
+	text[st.st_size] = '\0';
+
+	doctree->size = st.st_size;
+	doctree->mtime = st.st_mtime;
+	doctree->index = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 127,
+		xmldoc_index_item_hash, xmldoc_index_item_cmp);
+	if (!res && doctree->index) {
+		res = xmldoc_index_build(doctree, text);
+	} else {
+		res = -1;
+	}
+	ast_free(text);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Append an index item's elements to a fragment, followed by the
+ *        elements they xinclude from the same file.
+ */
+static int xmldoc_fragment_append(struct documentation_tree *doctree, FILE *f,
+	struct xmldoc_index_item *item, struct ast_str **fragment, struct xmldoc_seen *seen)
+{
+	struct xmldoc_index_item *ref;
+	const char *p;
+	const char *type_end;
+	const char *name_end;
+	char type[64];
+	char name[256];
+	char *text;
+	int error = 0;
+	int i;
+
+	if (AST_VECTOR_APPEND(seen, item)) {
+		return -1;
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&item->spans) && !error; i++) {
+		struct xmldoc_span *span = AST_VECTOR_GET_ADDR(&item->spans, i);
+
+		if (!(text = ast_malloc(span->len + 1))) {
+			return -1;
+		}
+		if (fseeko(f, span->offset, SEEK_SET) || fread(text, 1, span->len, f) != span->len) {
+			ast_free(text);
+			return -1;
+		}
+		text[span->len] = '\0';
+		ast_str_append(fragment, 0, "%s\n", text);
+
+		/* Pull in what this element includes, e.g. xpointer(/docs/managerEvent[@name='X']/...) */
+		for (p = text; !error && (p = strstr(p, "xpointer(")); p = name_end) {
+			p += strlen("xpointer(");
+			p += *p == '/';
+			name_end = p;
+			if (strncmp(p, "docs/", 5)) {
+				continue;
+			}
+			p += 5;
+			type_end = p + strcspn(p, "[/)");
+			name_end = type_end;
+			if (strncmp(type_end, "[@name='", 8)) {
+				continue;
+			}
+			name_end = strchr(type_end + 8, '\'');
+			if (!name_end) {
+				break;
+			}
+			ast_copy_string(type, p, MIN(type_end - p + 1, sizeof(type)));
+			ast_copy_string(name, type_end + 8, MIN(name_end - type_end - 8 + 1, sizeof(name)));
+
+			ref = xmldoc_index_find(doctree, type, name);
+			if (ref && !AST_VECTOR_GET_CMP(seen, ref, AST_VECTOR_ELEM_DEFAULT_CMP)) {
+				error = xmldoc_fragment_append(doctree, f, ref, fragment, seen);
+			}
+			ao2_cleanup(ref);
+		}
+		ast_free(text);
+	}
+
+	return error;
+}
+
+/*!
+ * \internal
+ * \brief Parse the elements of one index item into a document of their own.
+ */
+static struct ast_xml_doc *xmldoc_index_parse(struct documentation_tree *doctree, struct xmldoc_index_item *item)
+{
+	RAII_VAR(struct ast_str *, fragment, ast_str_create(4096), ast_free);
+	struct xmldoc_seen seen;
+	struct ast_xml_doc *doc;
+	struct ast_xml_node *root;
+	struct stat st;
+	FILE *f;
+	int error;
+
+	if (stat(doctree->filename, &st) || st.st_size != doctree->size || st.st_mtime != doctree->mtime) {
+		ast_log(LOG_ERROR, "Documentation file '%s' changed since it was indexed\n", doctree->filename);
+		return NULL;
+	}
+
+	if (!fragment || !(f = fopen(doctree->filename, "r"))) {
+		return NULL;
+	}
+	if (AST_VECTOR_INIT(&seen, 4)) {
+		fclose(f);
+		return NULL;
+	}
+	ast_str_set(&fragment, 0, "%s\n", doctree->prolog);
+	error = xmldoc_fragment_append(doctree, f, item, &fragment, &seen);
+	AST_VECTOR_FREE(&seen);
+	fclose(f);
+	if (error) {
+		ast_log(LOG_ERROR, "Could not read documentation for %s '%s' from '%s'\n",
+			item->type, item->name, doctree->filename);
+		return NULL;
+	}
+	ast_str_append(&fragment, 0, "</docs>\n");
+
+	doc = ast_xml_open_memory(ast_str_buffer(fragment), ast_str_strlen(fragment), doctree->filename);
+	if (!doc) {
+		ast_log(LOG_ERROR, "Could not parse documentation for %s '%s' from '%s'\n",
+			item->type, item->name, doctree->filename);
+		return NULL;
+	}
+	root = ast_xml_get_root(doc);
+	if (!root || strcmp(ast_xml_node_get_name(root), "docs")) {
+		ast_xml_close(doc);
+		return NULL;
+	}
+
+	return doc;
+}
+
+/*!
+ * \internal
+ * \brief Get the document holding an index item, parsing it on first use.
+ */
+static struct ast_xml_doc *xmldoc_index_item_doc(struct documentation_tree *doctree, struct xmldoc_index_item *item)
+{
+	struct ast_xml_doc *doc;
+
+	ao2_lock(item);
+	if (!item->doc && !item->failed) {
+		item->doc = xmldoc_index_parse(doctree, item);
+		item->failed = !item->doc;
+	}
+	doc = item->doc;
+	ao2_unlock(item);
+
+	return doc;
+}
+
+/*!
+ * \internal
+ * \brief Get the document that documents a type and name in a documentation tree.
+ *
+ * \retval NULL if the tree doesn't document it.
+ */
+static struct ast_xml_doc *xmldoc_tree_item_doc(struct documentation_tree *doctree, const char *type, const char *name)
+{
+	struct xmldoc_index_item *item;
+	struct ast_xml_doc *doc;
+
+	if (!documentation_lazy) {
+		return doctree->doc;
+	}
+
+	if (!(item = xmldoc_index_find(doctree, type, name))) {
+		return NULL;
+	}
+	doc = xmldoc_index_item_doc(doctree, item);
+	ao2_ref(item, -1);
+
+	return doc;
+}
+
+/*!
+ * \internal
+ * \brief Get the whole document of a documentation tree, parsing it on first use.
+ */
+static struct ast_xml_doc *xmldoc_tree_doc(struct documentation_tree *doctree)
+{
+	struct ast_xml_doc *doc;
+
+	if (!documentation_lazy) {
+		return doctree->doc;
+	}
+
+	ast_mutex_lock(&xmldoc_doc_lock);
+	if (!doctree->doc && !doctree->failed) {
+		doctree->doc = ast_xml_open(doctree->filename);
+		doctree->failed = !doctree->doc;
+	}
+	doc = doctree->doc;
+	ast_mutex_unlock(&xmldoc_doc_lock);
+
+	return doc;
+}
+
 /*!
  * \internal
  * \brief Get the application/function node for 'name' application/function with language 'language'
@@ -440,10 +979,12 @@ static struct ast_xml_node *xmldoc_get_node(const char *type, const char *name,
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		struct ast_xml_doc *doc = xmldoc_tree_item_doc(doctree, type, name);
+
 		/* the core xml documents have priority over thirdparty document. */
-		node = ast_xml_get_root(doctree->doc);
+		node = doc ? ast_xml_get_root(doc) : NULL;
 		if (!node) {
-			break;
+			continue;
 		}
 
 		node = ast_xml_node_get_children(node);
@@ -2540,11 +3081,72 @@ struct ast_xml_doc_item *ast_xmldoc_build_final_response(const char *type, const
 	return xmldoc_build_final_response(node);
 }
 
+/*!
+ * \internal
+ * \brief Get the top level type and name an XPath query starts from.
+ *
+ * Understands queries starting with //type[@name='name'] or /docs/type[@name='name'],
+ * which is how every caller finds its documentation.
+ *
+ * \retval 0 if the query is limited to one type and name.
+ * \retval -1 if it may look anywhere.
+ */
+static int xmldoc_xpath_key(const char *xpath, char *type, size_t type_size, char *name, size_t name_size)
+{
+	const char *type_end;
+	const char *name_end;
+
+	if (!strncmp(xpath, "//", 2)) {
+		xpath += 2;
+	} else if (!strncmp(xpath, "/docs/", 6)) {
+		xpath += 6;
+	} else {
+		return -1;
+	}
+
+	type_end = xpath + strcspn(xpath, "[/");
+	if (type_end == xpath || strncmp(type_end, "[@name='", 8)) {
+		return -1;
+	}
+	name_end = strchr(type_end + 8, '\'');
+	if (!name_end) {
+		return -1;
+	}
+
+	ast_copy_string(type, xpath, MIN(type_end - xpath + 1, type_size));
+	ast_copy_string(name, type_end + 8, MIN(name_end - type_end - 8 + 1, name_size));
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Whether any documentation tree has a top level type and name.
+ * \note The xmldoc_tree list must be locked.
+ */
+static int xmldoc_indexed(const char *type, const char *name)
+{
+	struct documentation_tree *doctree;
+	struct xmldoc_index_item *item;
+
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		if ((item = xmldoc_index_find(doctree, type, name))) {
+			ao2_ref(item, -1);
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 struct ast_xml_xpath_results *__attribute__((format(printf, 1, 2))) ast_xmldoc_query(const char *fmt, ...)
 {
 	struct ast_xml_xpath_results *results = NULL;
 	struct documentation_tree *doctree;
 	RAII_VAR(struct ast_str *, xpath_str, ast_str_create(128), ast_free);
+	char type[64];
+	char name[256];
+	int keyed;
 	va_list ap;
 	int res;
 
@@ -2560,8 +3162,13 @@ struct ast_xml_xpath_results *__attribute__((format(printf, 1, 2))) ast_xmldoc_q
 	}
 
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
+	/* When lazy, only the documents of the item the query starts from need parsing. */
+	keyed = documentation_lazy && !xmldoc_xpath_key(ast_str_buffer(xpath_str), type, sizeof(type), name, sizeof(name))
+		&& xmldoc_indexed(type, name);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
-		if (!(results = ast_xml_query(doctree->doc, ast_str_buffer(xpath_str)))) {
+		struct ast_xml_doc *doc = keyed ? xmldoc_tree_item_doc(doctree, type, name) : xmldoc_tree_doc(doctree);
+
+		if (!doc || !(results = ast_xml_query(doc, ast_str_buffer(xpath_str)))) {
 			continue;
 		}
 		break;
@@ -2648,86 +3255,135 @@ int ast_xmldoc_regenerate_doc_item(struct ast_xml_doc_item *item)
 	return 0;
 }
 
-struct ao2_container *ast_xmldoc_build_documentation(const char *type)
+/*!
+ * \internal
+ * \brief Add documentation items for the children of a root node of a given type.
+ *
+ * \param docs Container the items are added to.
+ * \param root_node The documentation root node.
+ * \param type The type of item to add.
+ * \param only_name If not NULL, only add items with this name.
+ */
+static void xmldoc_build_documentation_root(struct ao2_container *docs, struct ast_xml_node *root_node, const char *type, const char *only_name)
 {
-	struct ao2_container *docs;
-	struct ast_xml_node *node = NULL, *instance = NULL;
-	struct documentation_tree *doctree;
+	struct ast_xml_node *node, *instance = NULL;
 	const char *name;
 
-	if (!(docs = ao2_container_alloc(127, ast_xml_doc_item_hash, ast_xml_doc_item_cmp))) {
-		ast_log(AST_LOG_ERROR, "Failed to create container for xml document item instances\n");
-		return NULL;
-	}
+	for (node = ast_xml_node_get_children(root_node); node; node = ast_xml_node_get_next(node)) {
+		struct ast_xml_doc_item *item = NULL;
 
-	AST_RWLIST_RDLOCK(&xmldoc_tree);
-	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
-		/* the core xml documents have priority over thirdparty document. */
-		node = ast_xml_get_root(doctree->doc);
-		if (!node) {
-			break;
+		/* Ignore empty nodes or nodes that aren't of the type requested */
+		if (!ast_xml_node_get_children(node) || strcasecmp(ast_xml_node_get_name(node), type)) {
+			continue;
+		}
+		name = ast_xml_get_attribute(node, "name");
+		if (!name) {
+			continue;
+		}
+		if (only_name && strcmp(name, only_name)) {
+			ast_xml_free_attr(name);
+			continue;
 		}
 
-		for (node = ast_xml_node_get_children(node); node; node = ast_xml_node_get_next(node)) {
-			struct ast_xml_doc_item *item = NULL;
+		switch (xmldoc_get_syntax_type(type)) {
+		case MANAGER_EVENT_SYNTAX:
+		{
+			struct ast_xml_doc_item_list root;
 
-			/* Ignore empty nodes or nodes that aren't of the type requested */
-			if (!ast_xml_node_get_children(node) || strcasecmp(ast_xml_node_get_name(node), type)) {
-				continue;
+			AST_LIST_HEAD_INIT(&root);
+			for (instance = ast_xml_node_get_children(node); instance; instance = ast_xml_node_get_next(instance)) {
+				struct ast_xml_doc_item *temp;
+				if (!ast_xml_node_get_children(instance) || strcasecmp(ast_xml_node_get_name(instance), "managerEventInstance")) {
+					continue;
+				}
+				temp = xmldoc_build_documentation_item(instance, name, type);
+				if (!temp) {
+					break;
+				}
+				AST_LIST_INSERT_TAIL(&root, temp, next);
 			}
-			name = ast_xml_get_attribute(node, "name");
-			if (!name) {
-				continue;
+			item = AST_LIST_FIRST(&root);
+			break;
+		}
+		case CONFIG_INFO_SYNTAX:
+		{
+			RAII_VAR(const char *, name, ast_xml_get_attribute(node, "name"), ast_xml_free_attr);
+
+			if (!ast_xml_node_get_children(node) || strcasecmp(ast_xml_node_get_name(node), "configInfo")) {
+				break;
 			}
 
-			switch (xmldoc_get_syntax_type(type)) {
-			case MANAGER_EVENT_SYNTAX:
-			{
+			item = xmldoc_build_documentation_item(node, name, "configInfo");
+			if (item) {
 				struct ast_xml_doc_item_list root;
 
 				AST_LIST_HEAD_INIT(&root);
-				for (instance = ast_xml_node_get_children(node); instance; instance = ast_xml_node_get_next(instance)) {
-					struct ast_xml_doc_item *temp;
-					if (!ast_xml_node_get_children(instance) || strcasecmp(ast_xml_node_get_name(instance), "managerEventInstance")) {
-						continue;
-					}
-					temp = xmldoc_build_documentation_item(instance, name, type);
-					if (!temp) {
-						break;
-					}
-					AST_LIST_INSERT_TAIL(&root, temp, next);
-				}
-				item = AST_LIST_FIRST(&root);
-				break;
+				AST_LIST_INSERT_TAIL(&root, item, next);
+				build_config_docs(node, &root);
 			}
-			case CONFIG_INFO_SYNTAX:
-			{
-				RAII_VAR(const char *, name, ast_xml_get_attribute(node, "name"), ast_xml_free_attr);
+			break;
+		}
+		default:
+			item = xmldoc_build_documentation_item(node, name, type);
+		}
+		ast_xml_free_attr(name);
 
-				if (!ast_xml_node_get_children(node) || strcasecmp(ast_xml_node_get_name(node), "configInfo")) {
-					break;
-				}
+		if (item) {
+			ao2_link(docs, item);
+			ao2_t_ref(item, -1, "Dispose of creation ref");
+		}
+	}
+}
+
+/*!
+ * \internal
+ * \brief Add documentation items of a given type from an indexed tree,
+ *        parsing the ones not yet asked for.
+ */
+static void xmldoc_build_documentation_index(struct ao2_container *docs, struct documentation_tree *doctree, const char *type)
+{
+	struct xmldoc_index_item *item;
+	struct ao2_iterator iter;
+	struct ast_xml_doc *doc;
 
-				item = xmldoc_build_documentation_item(node, name, "configInfo");
-				if (item) {
-					struct ast_xml_doc_item_list root;
+	iter = ao2_iterator_init(doctree->index, 0);
+	for (; (item = ao2_iterator_next(&iter)); ao2_ref(item, -1)) {
+		if (strcasecmp(item->type, type)) {
+			continue;
+		}
+		doc = xmldoc_index_item_doc(doctree, item);
+		if (doc) {
+			xmldoc_build_documentation_root(docs, ast_xml_get_root(doc), type, item->name);
+		}
+	}
+	ao2_iterator_destroy(&iter);
+}
 
-					AST_LIST_HEAD_INIT(&root);
-					AST_LIST_INSERT_TAIL(&root, item, next);
-					build_config_docs(node, &root);
-				}
-				break;
-			}
-			default:
-				item = xmldoc_build_documentation_item(node, name, type);
-			}
-			ast_xml_free_attr(name);
+struct ao2_container *ast_xmldoc_build_documentation(const char *type)
+{
+	struct ao2_container *docs;
+	struct ast_xml_node *node = NULL;
+	struct documentation_tree *doctree;
 
-			if (item) {
-				ao2_link(docs, item);
-				ao2_t_ref(item, -1, "Dispose of creation ref");
-			}
+	if (!(docs = ao2_container_alloc(127, ast_xml_doc_item_hash, ast_xml_doc_item_cmp))) {
+		ast_log(AST_LOG_ERROR, "Failed to create container for xml document item instances\n");
+		return NULL;
+	}
+
+	AST_RWLIST_RDLOCK(&xmldoc_tree);
+	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
+		if (documentation_lazy) {
+			xmldoc_build_documentation_index(docs, doctree, type);
+			continue;
+		}
+
+		/* the core xml documents have priority over thirdparty document. */
+		node = ast_xml_get_root(doctree->doc);
+		if (!node) {
+			break;
 		}
+
+		xmldoc_build_documentation_root(docs, node, type, NULL);
 	}
 	AST_RWLIST_UNLOCK(&xmldoc_tree);
 
@@ -2805,7 +3461,13 @@ static char *handle_dump_docs(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	}
 	AST_RWLIST_RDLOCK(&xmldoc_tree);
 	AST_LIST_TRAVERSE(&xmldoc_tree, doctree, entry) {
-		ast_xml_doc_dump_file(f, doctree->doc);
+		/* When lazy this parses the whole file, so it won't show what
+		 * registrations have added to the items parsed so far. */
+		struct ast_xml_doc *doc = xmldoc_tree_doc(doctree);
+
+		if (doc) {
+			ast_xml_doc_dump_file(f, doc);
+		}
 	}
 	AST_RWLIST_UNLOCK(&xmldoc_tree);
 	fclose(f);
@@ -2824,7 +3486,11 @@ static void xmldoc_unload_documentation(void)
 	AST_RWLIST_WRLOCK(&xmldoc_tree);
 	while ((doctree = AST_RWLIST_REMOVE_HEAD(&xmldoc_tree, entry))) {
 		ast_free(doctree->filename);
-		ast_xml_close(doctree->doc);
+		if (doctree->doc) {
+			ast_xml_close(doctree->doc);
+		}
+		ao2_cleanup(doctree->index);
+		ast_free(doctree->prolog);
 		ast_free(doctree);
 	}
 	AST_RWLIST_UNLOCK(&xmldoc_tree);
@@ -2856,6 +3522,8 @@ int ast_xmldoc_load_documentation(void)
 				if (!ast_strlen_zero(var->value)) {
 					snprintf(documentation_language, sizeof(documentation_language), "%s", var->value);
 				}
+			} else if (!strcasecmp(var->name, "documentation_lazy")) {
+				documentation_lazy = ast_true(var->value);
 			}
 		}
 		ast_config_destroy(cfg);
@@ -2911,6 +3579,26 @@ int ast_xmldoc_load_documentation(void)
 		 * (due to use of GLOB_NOCHECK in xml_pathmatch) */
 			continue;
 		}
+		if (documentation_lazy) {
+			doc_tree = ast_calloc(1, sizeof(*doc_tree));
+			if (!doc_tree || !(doc_tree->filename = ast_strdup(globbuf.gl_pathv[i]))) {
+				ast_log(LOG_ERROR, "Unable to allocate documentation_tree structure!\n");
+				ast_free(doc_tree);
+				continue;
+			}
+			if (xmldoc_index_file(doc_tree)) {
+				ast_log(LOG_ERROR, "Could not index XML documentation at '%s'\n", globbuf.gl_pathv[i]);
+				ao2_cleanup(doc_tree->index);
+				ast_free(doc_tree->prolog);
+				ast_free(doc_tree->filename);
+				ast_free(doc_tree);
+				continue;
+			}
+			ast_debug(3, "Indexed %d documentation items in '%s'\n",
+				ao2_container_count(doc_tree->index), doc_tree->filename);
+			AST_RWLIST_INSERT_TAIL(&xmldoc_tree, doc_tree, entry);
+			continue;
+		}
 		tmpdoc = NULL;
 		tmpdoc = ast_xml_open(globbuf.gl_pathv[i]);
 		if (!tmpdoc) {
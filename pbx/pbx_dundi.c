@@ -70,6 +70,7 @@
 #include "asterisk/astdb.h"
 #include "asterisk/acl.h"
 #include "asterisk/app.h"
+#include "asterisk/astobj2.h"
 
 #include "dundi-parser.h"
 
@@ -192,6 +193,10 @@ static int authdebug = 0;
 static int dundi_ttl = DUNDI_DEFAULT_TTL;
 static int dundi_key_ttl = DUNDI_DEFAULT_KEY_EXPIRE;
 static int dundi_cache_time = DUNDI_DEFAULT_CACHE_TIME;
+/*! Peers with answers a lookup may stop waiting after, 0 to wait for every peer */
+static int dundi_quorum = 0;
+/*! File the cache is kept in across restarts, empty for none */
+static char cachefile[256];
 static int global_autokilltimeout = 0;
 static dundi_eid global_eid;
 static int default_expiration = 60;
@@ -281,6 +286,7 @@ struct dundi_request {
 	int expiration;
 	int cbypass;
 	int pfds[2];
+	int answered;                                /*!< Peers that have answered */
 	uint32_t crc32;                              /*!< CRC-32 of all but root EID's in avoid list */
 	AST_LIST_HEAD_NOLOCK(, dundi_transaction) trans;  /*!< Transactions */
 	AST_LIST_ENTRY(dundi_request) list;
@@ -857,6 +863,178 @@ static int dundi_answer_entity(struct dundi_transaction *trans, struct dundi_ies
 	return 0;
 }
 
+/*!
+ * \brief An answer or hint in the cache
+ *
+ * The key and data are those the cache was kept under in the astdb, the key
+ * made of the peer EID, the number or hint and the context.
+ */
+struct dundi_cache_entry {
+	/*! When the entry expires */
+	time_t expiration;
+	/*! "<expiration>|<answers>" */
+	char *data;
+	char key[0];
+};
+
+#define DUNDI_CACHE_BUCKETS 4099
+
+/*! \brief Answers and hints from peers */
+static struct ao2_container *dundi_cache;
+
+/*! \brief Non-zero if the cache has changed since it was last written to cachefile */
+static int dundi_cache_dirty;
+
+AO2_STRING_FIELD_HASH_FN(dundi_cache_entry, key)
+AO2_STRING_FIELD_CMP_FN(dundi_cache_entry, key)
+
+static void cache_put(const char *key, const char *data)
+{
+	struct dundi_cache_entry *entry;
+	size_t key_len = strlen(key) + 1;
+	time_t expiration;
+
+	if (ast_get_time_t(data, &expiration, 0, NULL)) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len + strlen(data) + 1, NULL,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->expiration = expiration;
+	strcpy(entry->key, key); /* SAFE */
+	entry->data = entry->key + key_len;
+	strcpy(entry->data, data); /* SAFE */
+
+	ao2_lock(dundi_cache);
+	ao2_find(dundi_cache, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(dundi_cache, entry, OBJ_NOLOCK);
+	ao2_unlock(dundi_cache);
+	ao2_ref(entry, -1);
+	dundi_cache_dirty = 1;
+}
+
+static int cache_get(const char *key, char *data, size_t len)
+{
+	struct dundi_cache_entry *entry;
+
+	entry = ao2_find(dundi_cache, key, OBJ_SEARCH_KEY);
+	if (!entry) {
+		return -1;
+	}
+	ast_copy_string(data, entry->data, len);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+static void cache_del(const char *key)
+{
+	ao2_find(dundi_cache, key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	dundi_cache_dirty = 1;
+}
+
+static int cache_expired_cb(void *obj, void *arg, int flags)
+{
+	struct dundi_cache_entry *entry = obj;
+	time_t *now = arg;
+
+	return entry->expiration < *now ? CMP_MATCH : 0;
+}
+
+/*!
+ * \brief Write the cache to cachefile, if it has changed.
+ */
+static void cache_write(void)
+{
+	char tmpfile[sizeof(cachefile) + 4];
+	struct ao2_iterator iter;
+	struct dundi_cache_entry *entry;
+	time_t now;
+	FILE *f;
+
+	if (ast_strlen_zero(cachefile) || !dundi_cache_dirty) {
+		return;
+	}
+	dundi_cache_dirty = 0;
+
+	snprintf(tmpfile, sizeof(tmpfile), "%s.tmp", cachefile);
+	if (!(f = fopen(tmpfile, "w"))) {
+		ast_log(LOG_WARNING, "Unable to write DUNDi cache to '%s': %s\n", tmpfile, strerror(errno));
+		return;
+	}
+
+	time(&now);
+	iter = ao2_iterator_init(dundi_cache, 0);
+	for (; (entry = ao2_iterator_next(&iter)); ao2_ref(entry, -1)) {
+		if (entry->expiration > now) {
+			fprintf(f, "%s\t%s\n", entry->key, entry->data);
+		}
+	}
+	ao2_iterator_destroy(&iter);
+
+	if (fclose(f) || rename(tmpfile, cachefile)) {
+		ast_log(LOG_WARNING, "Unable to write DUNDi cache to '%s': %s\n", cachefile, strerror(errno));
+		unlink(tmpfile);
+	}
+}
+
+/*!
+ * \brief Load the answers that have not expired from cachefile, and from
+ * the astdb where the cache used to be kept.
+ */
+static void cache_read(void)
+{
+	struct ast_db_entry *db_tree, *db_entry;
+	char buf[1536];
+	char *data;
+	time_t expiration;
+	time_t now;
+	FILE *f;
+	int count = 0;
+
+	time(&now);
+
+	if (!ast_strlen_zero(cachefile) && (f = fopen(cachefile, "r"))) {
+		while (fgets(buf, sizeof(buf), f)) {
+			ast_trim_blanks(buf);
+			if (!(data = strchr(buf, '\t'))) {
+				continue;
+			}
+			*data++ = '\0';
+			if (!ast_get_time_t(data, &expiration, 0, NULL) && expiration > now) {
+				cache_put(buf, data);
+				count++;
+			}
+		}
+		fclose(f);
+	}
+
+	db_tree = ast_db_gettree("dundi/cache", NULL);
+	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
+		if (!ast_get_time_t(db_entry->data, &expiration, 0, NULL) && expiration > now) {
+			cache_put(db_entry->key + sizeof("/dundi/cache"), db_entry->data);
+			count++;
+		}
+	}
+	if (db_tree) {
+		ast_db_freetree(db_tree);
+		ast_db_deltree("dundi/cache", NULL);
+	}
+
+	ast_debug(1, "Loaded %d DUNDi cache entries\n", count);
+}
+
+/*!
+ * \brief Non-zero once enough peers have answered a lookup to stop waiting for the rest.
+ */
+static int quorum_reached(struct dundi_request *dr)
+{
+	return dundi_quorum > 0 && dr->respcount && dr->answered >= dundi_quorum;
+}
+
 static int cache_save_hint(dundi_eid *eidpeer, struct dundi_request *req, struct dundi_hint *hint, int expiration)
 {
 	int unaffected;
@@ -885,9 +1063,9 @@ static int cache_save_hint(dundi_eid *eidpeer, struct dundi_request *req, struct
 	timeout += expiration;
 	snprintf(data, sizeof(data), "%ld|", (long)(timeout));
 
-	ast_db_put("dundi/cache", key1, data);
+	cache_put(key1, data);
 	ast_debug(1, "Caching hint at '%s'\n", key1);
-	ast_db_put("dundi/cache", key2, data);
+	cache_put(key2, data);
 	ast_debug(1, "Caching hint at '%s'\n", key2);
 	return 0;
 }
@@ -928,8 +1106,8 @@ static int cache_save(dundi_eid *eidpeer, struct dundi_request *req, int start,
 			req->dr[x].flags, req->dr[x].weight, req->dr[x].techint, req->dr[x].dest,
 			dundi_eid_to_str_short(eidpeer_str, sizeof(eidpeer_str), &req->dr[x].eid));
 	}
-	ast_db_put("dundi/cache", key1, data);
-	ast_db_put("dundi/cache", key2, data);
+	cache_put(key1, data);
+	cache_put(key2, data);
 	return 0;
 }
 
@@ -1175,7 +1353,7 @@ static int cache_lookup_internal(time_t now, struct dundi_request *req, char *ke
 	char fs[256];
 
 	/* Build request string */
-	if (!ast_db_get("dundi/cache", key, data, sizeof(data))) {
+	if (!cache_get(key, data, sizeof(data))) {
 		time_t timeout;
 		ptr = data;
 		if (!ast_get_time_t(ptr, &timeout, 0, &length)) {
@@ -1227,9 +1405,9 @@ static int cache_lookup_internal(time_t now, struct dundi_request *req, char *ke
 					*lowexpiration = expiration;
 				return 1;
 			} else
-				ast_db_del("dundi/cache", key);
+				cache_del(key);
 		} else
-			ast_db_del("dundi/cache", key);
+			cache_del(key);
 	}
 
 	return 0;
@@ -1792,6 +1970,13 @@ static int handle_command_response(struct dundi_transaction *trans, struct dundi
 							trans->parent->expiration = ies.expiration;
 						}
 					}
+					trans->parent->answered++;
+					if (quorum_reached(trans->parent) && trans->parent->pfds[1] > -1) {
+						/* Wake up sleeper, the rest are cancelled */
+						if (write(trans->parent->pfds[1], "killa!", 6) < 0) {
+							ast_log(LOG_WARNING, "write() failed: %s\n", strerror(errno));
+						}
+					}
 				}
 				/* Close connection if not final */
 				if (!final)
@@ -2203,8 +2388,6 @@ static void *network_thread(void *ignore)
 
 static void *process_clearcache(void *ignore)
 {
-	struct ast_db_entry *db_entry, *db_tree;
-	int striplen = sizeof("/dundi/cache");
 	time_t now;
 
 	while (!dundi_shutdown) {
@@ -2212,18 +2395,8 @@ static void *process_clearcache(void *ignore)
 
 		time(&now);
 
-		db_entry = db_tree = ast_db_gettree("dundi/cache", NULL);
-		for (; db_entry; db_entry = db_entry->next) {
-			time_t expiry;
-
-			if (!ast_get_time_t(db_entry->data, &expiry, 0, NULL)) {
-				if (expiry < now) {
-					ast_debug(1, "clearing expired DUNDI cache entry: %s\n", db_entry->key);
-					ast_db_del("dundi/cache", db_entry->key + striplen);
-				}
-			}
-		}
-		ast_db_freetree(db_tree);
+		ao2_callback(dundi_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, cache_expired_cb, &now);
+		cache_write();
 
 		pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 		pthread_testcancel();
@@ -2374,7 +2547,8 @@ static char *dundi_flush(struct ast_cli_entry *e, int cmd, struct ast_cli_args *
 		}
 		AST_LIST_UNLOCK(&peers);
 	} else {
-		ast_db_deltree("dundi/cache", NULL);
+		ao2_callback(dundi_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, NULL, NULL);
+		dundi_cache_dirty = 1;
 		ast_cli(a->fd, "DUNDi Cache Flushed\n");
 	}
 	return CLI_SUCCESS;
@@ -2913,7 +3087,10 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 {
 #define FORMAT2 "%-12.12s %-16.16s %-10.10s  %-18s %-7s %s\n"
 #define FORMAT "%-12.12s %-16.16s %6d sec  %-18s %-7d %s/%s (%s)\n"
-        struct ast_db_entry *db_tree, *db_entry;
+	struct ao2_iterator iter;
+	struct dundi_cache_entry *entry;
+	char key[256];
+	char data[1024];
 	int cnt = 0;
 	time_t ts, now;
 	dundi_eid src_eid;
@@ -2940,10 +3117,12 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	}
 
 	time(&now);
-	db_tree = ast_db_gettree("dundi/cache", NULL);
 	ast_cli(a->fd, FORMAT2, "Number", "Context", "Expiration", "From", "Weight", "Destination (Flags)");
-	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
-		if ((strncmp(db_entry->key, "/dundi/cache/hint/", 18) == 0) || ast_get_time_t(db_entry->data, &ts, 0, &length)) {
+	iter = ao2_iterator_init(dundi_cache, 0);
+	for (; (entry = ao2_iterator_next(&iter)); ao2_ref(entry, -1)) {
+		ast_copy_string(key, entry->key, sizeof(key));
+		ast_copy_string(data, entry->data, sizeof(data));
+		if ((strncmp(key, "hint/", 5) == 0) || ast_get_time_t(data, &ts, 0, &length)) {
 			continue;
 		}
 
@@ -2953,7 +3132,7 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 			continue;
 		}
 
-		ptr = db_entry->key + sizeof("/dundi/cache");
+		ptr = key;
 		strtok(ptr, "/");
 		number = strtok(NULL, "/");
 		context = strtok(NULL, "/");
@@ -2963,7 +3142,7 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 			continue;
 		}
 
-		ptr = db_entry->data + length + 1;
+		ptr = data + length + 1;
 
 		if ((sscanf(ptr, "%30u/%30d/%30d/%n", &(flags.flags), &weight, &tech, &length) != 3)) {
 			continue;
@@ -2993,9 +3172,9 @@ static char *dundi_show_cache(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 
 		ast_cli(a->fd, FORMAT, number, context, expiry, src_eid_str, weight, tech2str(tech), dst, dundi_flags2str(fs, sizeof(fs), flags.flags));
 	}
+	ao2_iterator_destroy(&iter);
 
 	ast_cli(a->fd, "Number of entries: %d\n", cnt);
-	ast_db_freetree(db_tree);
 
 	return CLI_SUCCESS;
 #undef FORMAT
@@ -3006,7 +3185,9 @@ static char *dundi_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 {
 #define FORMAT2 "%-12.12s %-16.16s %-10.10s  %-18s\n"
 #define FORMAT "%-12.12s %-16.16s %6d sec  %-18s\n"
-	struct ast_db_entry *db_tree, *db_entry;
+	struct ao2_iterator iter;
+	struct dundi_cache_entry *entry;
+	char key[256];
 	int cnt = 0;
 	time_t ts, now;
 	dundi_eid src_eid;
@@ -3031,11 +3212,11 @@ static char *dundi_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 	}
 
 	time(&now);
-	db_tree = ast_db_gettree("dundi/cache/hint", NULL);
 	ast_cli(a->fd, FORMAT2, "Prefix", "Context", "Expiration", "From");
 
-	for (db_entry = db_tree; db_entry; db_entry = db_entry->next) {
-		if (ast_get_time_t(db_entry->data, &ts, 0, &length)) {
+	iter = ao2_iterator_init(dundi_cache, 0);
+	for (; (entry = ao2_iterator_next(&iter)); ao2_ref(entry, -1)) {
+		if (strncmp(entry->key, "hint/", 5) || ast_get_time_t(entry->data, &ts, 0, &length)) {
 			continue;
 		}
 
@@ -3045,7 +3226,8 @@ static char *dundi_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 			continue;
 		}
 
-		ptr = db_entry->key + sizeof("/dundi/cache/hint");
+		ast_copy_string(key, entry->key, sizeof(key));
+		ptr = key + sizeof("hint");
 		src = strtok(ptr, "/");
 		number = strtok(NULL, "/");
 		context = strtok(NULL, "/");
@@ -3060,9 +3242,9 @@ static char *dundi_show_hints(struct ast_cli_entry *e, int cmd, struct ast_cli_a
 		ast_eid_to_str(src_eid_str, sizeof(src_eid_str), &src_eid);
 		ast_cli(a->fd, FORMAT, number, context, expiry, src_eid_str);
 	}
+	ao2_iterator_destroy(&iter);
 
 	ast_cli(a->fd, "Number of entries: %d\n", cnt);
-	ast_db_freetree(db_tree);
 
 	return CLI_SUCCESS;
 #undef FORMAT
@@ -3851,7 +4033,7 @@ static int dundi_lookup_internal(struct dundi_result *result, int maxret, struct
 	discover_transactions(&dr);
 	/* Wait for transaction to come back */
 	start = ast_tvnow();
-	while (!AST_LIST_EMPTY(&dr.trans) && (ast_tvdiff_ms(ast_tvnow(), start) < ttlms) && (!chan || !ast_check_hangup(chan))) {
+	while (!AST_LIST_EMPTY(&dr.trans) && !quorum_reached(&dr) && (ast_tvdiff_ms(ast_tvnow(), start) < ttlms) && (!chan || !ast_check_hangup(chan))) {
 		ms = 100;
 		ast_waitfor_n_fd(dr.pfds, 1, &ms, NULL);
 	}
@@ -4831,6 +5013,8 @@ static int set_config(char *config_file, struct sockaddr_in* sin, int reload)
 
 	dundi_ttl = DUNDI_DEFAULT_TTL;
 	dundi_cache_time = DUNDI_DEFAULT_CACHE_TIME;
+	dundi_quorum = 0;
+	cachefile[0] = '\0';
 	any_peer = NULL;
 
 	ipaddr[0] = '\0';
@@ -4919,6 +5103,15 @@ static int set_config(char *config_file, struct sockaddr_in* sin, int reload)
 				ast_log(LOG_WARNING, "'%s' is not a valid cache time at line %d. Using default value '%d'.\n",
 					v->value, v->lineno, DUNDI_DEFAULT_CACHE_TIME);
 			}
+		} else if (!strcasecmp(v->name, "quorum")) {
+			if ((sscanf(v->value, "%30d", &x) == 1) && (x >= 0)) {
+				dundi_quorum = x;
+			} else {
+				ast_log(LOG_WARNING, "'%s' is not a valid quorum at line %d. Waiting for every peer.\n",
+					v->value, v->lineno);
+			}
+		} else if (!strcasecmp(v->name, "cachefile")) {
+			ast_copy_string(cachefile, v->value, sizeof(cachefile));
 		}
 		v = v->next;
 	}
@@ -4982,6 +5175,12 @@ static int unload_module(void)
 	io_context_destroy(io);
 	ast_sched_context_destroy(sched);
 
+	if (dundi_cache) {
+		cache_write();
+		ao2_ref(dundi_cache, -1);
+		dundi_cache = NULL;
+	}
+
 	mark_mappings();
 	prune_mappings();
 	mark_peers();
@@ -5014,8 +5213,10 @@ static int load_module(void)
 	/* Make a UDP socket */
 	io = io_context_create();
 	sched = ast_sched_context_create();
+	dundi_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, DUNDI_CACHE_BUCKETS,
+		dundi_cache_entry_hash_fn, NULL, dundi_cache_entry_cmp_fn);
 
-	if (!io || !sched) {
+	if (!io || !sched || !dundi_cache) {
 		goto declined;
 	}
 
@@ -5023,6 +5224,8 @@ static int load_module(void)
 		goto declined;
 	}
 
+	cache_read();
+
 	netsocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
 
 	if (netsocket < 0) {
@@ -40,6 +40,7 @@
 #include "asterisk/term.h"
 #include "asterisk/paths.h"
 #include "asterisk/hashtab.h"
+#include "asterisk/vector.h"
 
 #include <lua.h>
 #include <lauxlib.h>
@@ -60,6 +61,15 @@ static char *registrar = "pbx_lua";
  * applications might return */
 #define LUA_GOTO_DETECTED 5
 
+/*! Most idle lua_States kept in the pool */
+#define LUA_POOL_MAX 1024
+
+#if LUA_VERSION_NUM < 502
+#define lua_push_globals(L) lua_pushvalue(L, LUA_GLOBALSINDEX)
+#else
+#define lua_push_globals(L) lua_pushglobaltable(L)
+#endif
+
 static char *lua_read_extensions_file(lua_State *L, long *size, int *file_not_openable);
 static int lua_load_extensions(lua_State *L, struct ast_channel *chan);
 static int lua_reload_extensions(lua_State *L);
@@ -97,6 +107,7 @@ static void lua_concat_args(lua_State *L, int start, int nargs);
 static void lua_state_destroy(void *data);
 static void lua_datastore_fixup(void *data, struct ast_channel *old_chan, struct ast_channel *new_chan);
 static lua_State *lua_get_state(struct ast_channel *chan);
+static void lua_put_state(lua_State *L);
 
 static int exists(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
 static int canmatch(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data);
@@ -110,6 +121,29 @@ static long config_file_size = 0;
 static struct ast_context *local_contexts = NULL;
 static struct ast_hashtab *local_table = NULL;
 
+/*!
+ * \brief Idle lua_States with extensions.lua loaded, ready for a channel.
+ *
+ * Lock order is config_file_lock, then lua_pool_lock.
+ */
+AST_MUTEX_DEFINE_STATIC(lua_pool_lock);
+AST_VECTOR(lua_states, lua_State *);
+static struct lua_states lua_pool;
+/*! \brief Most idle states kept, set by lua_state_pool_size in extensions.lua */
+static unsigned int lua_pool_size;
+/*! \brief Bumped on reload so states loaded from an older extensions.lua are not reused */
+static unsigned int lua_pool_generation;
+static struct {
+	/*! States loaded from extensions.lua */
+	unsigned long created;
+	/*! States taken from the pool */
+	unsigned long reused;
+	/*! States reset and put back in the pool */
+	unsigned long recycled;
+	/*! States closed because the pool was full or they were stale */
+	unsigned long closed;
+} lua_pool_stats;
+
 static const struct ast_datastore_info lua_datastore = {
 	.type = "lua",
 	.destroy = lua_state_destroy,
@@ -122,8 +156,7 @@ static const struct ast_datastore_info lua_datastore = {
  */
 static void lua_state_destroy(void *data)
 {
-	if (data)
-		lua_close(data);
+	lua_put_state(data);
 }
 
 /*!
@@ -1143,6 +1176,57 @@ static char *lua_read_extensions_file(lua_State *L, long *size, int *file_not_op
 	return data;
 }
 
+/*!
+ * \brief Push a shallow copy of the table on the top of the stack
+ *
+ * \param L the lua_State to use
+ */
+static void lua_save_table(lua_State *L)
+{
+	lua_newtable(L);
+	lua_pushnil(L);
+	while (lua_next(L, -3)) {
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, -4);
+	}
+}
+
+/*!
+ * \brief Make a table the same as a copy saved with lua_save_table()
+ *
+ * \param L the lua_State to use
+ *
+ * The saved copy is expected on the top of the stack and the table to
+ * restore below it.  Entries added since the copy was saved are removed
+ * and entries that were replaced or removed are put back.  Changes made
+ * inside tables the entries refer to are not undone.  Both tables are
+ * left on the stack.
+ */
+static void lua_restore_table(lua_State *L)
+{
+	lua_pushnil(L);
+	while (lua_next(L, -3)) {
+		lua_pop(L, 1);
+		lua_pushvalue(L, -1);
+		lua_rawget(L, -3);
+		if (lua_isnil(L, -1)) {
+			/* clearing an existing field is allowed while traversing */
+			lua_pushvalue(L, -2);
+			lua_pushnil(L);
+			lua_rawset(L, -6);
+		}
+		lua_pop(L, 1);
+	}
+
+	lua_pushnil(L);
+	while (lua_next(L, -2)) {
+		lua_pushvalue(L, -2);
+		lua_insert(L, -2);
+		lua_rawset(L, -5);
+	}
+}
+
 /*!
  * \brief Load the extensions.lua file from the internal buffer
  *
@@ -1157,7 +1241,8 @@ static char *lua_read_extensions_file(lua_State *L, long *size, int *file_not_op
  */
 static int lua_load_extensions(lua_State *L, struct ast_channel *chan)
 {
-	
+	unsigned int generation;
+
 	/* store a pointer to this channel */
 	lua_pushlightuserdata(L, chan);
 	lua_setfield(L, LUA_REGISTRYINDEX, "channel");
@@ -1166,6 +1251,9 @@ static int lua_load_extensions(lua_State *L, struct ast_channel *chan)
 
 	/* load and sort extensions */
 	ast_mutex_lock(&config_file_lock);
+	ast_mutex_lock(&lua_pool_lock);
+	generation = lua_pool_generation;
+	ast_mutex_unlock(&lua_pool_lock);
 	if (luaL_loadbuffer(L, config_file_data, config_file_size, "extensions.lua")
 			|| lua_pcall(L, 0, LUA_MULTRET, 0)
 			|| lua_sort_extensions(L)) {
@@ -1185,6 +1273,26 @@ static int lua_load_extensions(lua_State *L, struct ast_channel *chan)
 	lua_create_autoservice_functions(L);
 	lua_create_hangup_function(L);
 
+	/* remember what was loaded so the state can be reset for another channel */
+	lua_pushinteger(L, generation);
+	lua_setfield(L, LUA_REGISTRYINDEX, "generation");
+
+	lua_push_globals(L);
+	lua_save_table(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "globals");
+	lua_pop(L, 1);
+
+	lua_getglobal(L, "package");
+	if (lua_istable(L, -1)) {
+		lua_getfield(L, -1, "loaded");
+		if (lua_istable(L, -1)) {
+			lua_save_table(L);
+			lua_setfield(L, LUA_REGISTRYINDEX, "loaded");
+		}
+		lua_pop(L, 1);
+	}
+	lua_pop(L, 1);
+
 	return 0;
 }
 
@@ -1203,6 +1311,8 @@ static int lua_reload_extensions(lua_State *L)
 	long size = 0;
 	char *data = NULL;
 	int file_not_openable = 0;
+	int pool_size = 0;
+	struct lua_states stale;
 
 	luaL_openlibs(L);
 
@@ -1213,6 +1323,17 @@ static int lua_reload_extensions(lua_State *L)
 		return 1;
 	}
 
+	lua_getglobal(L, "lua_state_pool_size");
+	if (lua_isnumber(L, -1)) {
+		pool_size = lua_tointeger(L, -1);
+	}
+	lua_pop(L, 1);
+	if (pool_size < 0 || pool_size > LUA_POOL_MAX) {
+		ast_log(LOG_WARNING, "lua_state_pool_size must be between 0 and %d, using %d\n",
+			LUA_POOL_MAX, LUA_POOL_MAX);
+		pool_size = LUA_POOL_MAX;
+	}
+
 	ast_mutex_lock(&config_file_lock);
 
 	if (config_file_data)
@@ -1230,7 +1351,20 @@ static int lua_reload_extensions(lua_State *L)
 	local_table = NULL;
 	local_contexts = NULL;
 
+	/* states loaded from the old file must not be used again */
+	ast_mutex_lock(&lua_pool_lock);
+	lua_pool_generation++;
+	lua_pool_size = pool_size;
+	stale = lua_pool;
+	AST_VECTOR_INIT(&lua_pool, 0);
+	lua_pool_stats.closed += AST_VECTOR_SIZE(&stale);
+	ast_mutex_unlock(&lua_pool_lock);
+
 	ast_mutex_unlock(&config_file_lock);
+
+	AST_VECTOR_CALLBACK_VOID(&stale, lua_close);
+	AST_VECTOR_FREE(&stale);
+
 	return 0;
 }
 
@@ -1243,81 +1377,218 @@ static void lua_free_extensions()
 	config_file_size = 0;
 	ast_free(config_file_data);
 	ast_mutex_unlock(&config_file_lock);
+
+	ast_mutex_lock(&lua_pool_lock);
+	lua_pool_size = 0;
+	AST_VECTOR_CALLBACK_VOID(&lua_pool, lua_close);
+	AST_VECTOR_FREE(&lua_pool);
+	ast_mutex_unlock(&lua_pool_lock);
 }
 
 /*!
- * \brief Get the lua_State for this channel
+ * \brief Reset a lua_State to how it was after extensions.lua was loaded
  *
- * If no channel is passed then a new state is allocated.  States with no
- * channel assocatied with them should only be used for matching extensions.
- * If the channel does not yet have a lua state associated with it, one will be
- * created.
+ * \param L the lua_State to use
  *
- * \note If no channel was passed then the caller is expected to free the state
- * using lua_close().
+ * Globals and modules added by the extensions that ran are removed, and
+ * globals they replaced are put back.
+ */
+static void lua_reset_state(lua_State *L)
+{
+	lua_settop(L, 0);
+
+	lua_push_globals(L);
+	lua_getfield(L, LUA_REGISTRYINDEX, "globals");
+	lua_restore_table(L);
+	lua_pop(L, 2);
+
+	lua_getglobal(L, "package");
+	if (lua_istable(L, -1)) {
+		lua_getfield(L, -1, "loaded");
+		lua_getfield(L, LUA_REGISTRYINDEX, "loaded");
+		if (lua_istable(L, -2) && lua_istable(L, -1)) {
+			lua_restore_table(L);
+		}
+		lua_pop(L, 2);
+	}
+	lua_pop(L, 1);
+
+	lua_pushnil(L);
+	lua_setfield(L, LUA_REGISTRYINDEX, "channel");
+	lua_pushboolean(L, 1);
+	lua_setfield(L, LUA_REGISTRYINDEX, "autoservice");
+}
+
+/*!
+ * \brief Get a lua_State with extensions.lua loaded
  *
- * \return a lua_State
+ * \param chan channel the state is for, may be NULL
+ *
+ * An idle state is taken from the pool if there is one, otherwise a new
+ * state is allocated and extensions.lua loaded into it.
+ *
+ * \return a lua_State, which should be given back with lua_put_state()
+ * \retval NULL on error
  */
-static lua_State *lua_get_state(struct ast_channel *chan)
+static lua_State *lua_new_state(struct ast_channel *chan)
 {
-	struct ast_datastore *datastore = NULL;
-	lua_State *L;
+	lua_State *L = NULL;
 
-	if (!chan) {
-		L = luaL_newstate();
-		if (!L) {
-			ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
-			return NULL;
+	ast_mutex_lock(&lua_pool_lock);
+	if (AST_VECTOR_SIZE(&lua_pool)) {
+		L = AST_VECTOR_REMOVE(&lua_pool, AST_VECTOR_SIZE(&lua_pool) - 1, 0);
+		lua_pool_stats.reused++;
+	} else {
+		lua_pool_stats.created++;
+	}
+	ast_mutex_unlock(&lua_pool_lock);
+
+	if (L) {
+		lua_pushlightuserdata(L, chan);
+		lua_setfield(L, LUA_REGISTRYINDEX, "channel");
+		return L;
+	}
+
+	L = luaL_newstate();
+	if (!L) {
+		ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
+		return NULL;
+	}
+
+	if (lua_load_extensions(L, chan)) {
+		const char *error = lua_tostring(L, -1);
+		if (chan) {
+			ast_log(LOG_ERROR, "Error loading extensions.lua for %s: %s\n", ast_channel_name(chan), error);
+		} else {
+			ast_log(LOG_ERROR, "Error loading extensions.lua: %s\n", error);
+		}
+		lua_close(L);
+		return NULL;
+	}
+
+	return L;
+}
+
+/*!
+ * \brief Give back a lua_State from lua_get_state() or lua_new_state()
+ *
+ * \param L the lua_State, may be NULL
+ *
+ * The state is reset and kept in the pool for another channel if there is
+ * room and extensions.lua has not been reloaded since it was loaded,
+ * otherwise it is closed.
+ */
+static void lua_put_state(lua_State *L)
+{
+	unsigned int generation;
+	int keep;
+
+	if (!L) {
+		return;
+	}
+
+	lua_getfield(L, LUA_REGISTRYINDEX, "generation");
+	generation = lua_tointeger(L, -1);
+	lua_pop(L, 1);
+
+	ast_mutex_lock(&lua_pool_lock);
+	keep = generation == lua_pool_generation && AST_VECTOR_SIZE(&lua_pool) < lua_pool_size;
+	ast_mutex_unlock(&lua_pool_lock);
+
+	if (keep) {
+		lua_reset_state(L);
+
+		ast_mutex_lock(&lua_pool_lock);
+		keep = generation == lua_pool_generation && AST_VECTOR_SIZE(&lua_pool) < lua_pool_size
+			&& !AST_VECTOR_APPEND(&lua_pool, L);
+		if (keep) {
+			lua_pool_stats.recycled++;
 		}
+		ast_mutex_unlock(&lua_pool_lock);
+	}
+
+	if (!keep) {
+		ast_mutex_lock(&lua_pool_lock);
+		lua_pool_stats.closed++;
+		ast_mutex_unlock(&lua_pool_lock);
+		lua_close(L);
+	}
+}
+
+/*!
+ * \brief Fill the pool with states loaded from extensions.lua
+ */
+static void lua_fill_pool(void)
+{
+	int count;
+
+	ast_mutex_lock(&lua_pool_lock);
+	count = lua_pool_size - AST_VECTOR_SIZE(&lua_pool);
+	ast_mutex_unlock(&lua_pool_lock);
+
+	while (count-- > 0) {
+		lua_State *L = luaL_newstate();
 
+		if (!L) {
+			break;
+		}
 		if (lua_load_extensions(L, NULL)) {
-			const char *error = lua_tostring(L, -1);
-			ast_log(LOG_ERROR, "Error loading extensions.lua: %s\n", error);
 			lua_close(L);
-			return NULL;
+			break;
 		}
-		return L;
-	} else {
-		ast_channel_lock(chan);
-		datastore = ast_channel_datastore_find(chan, &lua_datastore, NULL);
-		ast_channel_unlock(chan);
 
-		if (!datastore) {
-			/* nothing found, allocate a new lua state */
-			datastore = ast_datastore_alloc(&lua_datastore, NULL);
-			if (!datastore) {
-				ast_log(LOG_ERROR, "Error allocation channel datastore for lua_State\n");
-				return NULL;
-			}
-
-			datastore->data = luaL_newstate();
-			if (!datastore->data) {
-				ast_datastore_free(datastore);
-				ast_log(LOG_ERROR, "Error allocating lua_State, no memory\n");
-				return NULL;
-			}
+		ast_mutex_lock(&lua_pool_lock);
+		lua_pool_stats.created++;
+		ast_mutex_unlock(&lua_pool_lock);
+		lua_put_state(L);
+	}
+}
 
-			ast_channel_lock(chan);
-			ast_channel_datastore_add(chan, datastore);
-			ast_channel_unlock(chan);
+/*!
+ * \brief Get the lua_State for this channel
+ *
+ * If no channel is passed then a state not associated with a channel is
+ * returned.  States with no channel assocatied with them should only be used
+ * for matching extensions.  If the channel does not yet have a lua state
+ * associated with it, one will be taken from the pool or created.
+ *
+ * \note If no channel was passed then the caller is expected to give the
+ * state back using lua_put_state().
+ *
+ * \return a lua_State
+ */
+static lua_State *lua_get_state(struct ast_channel *chan)
+{
+	struct ast_datastore *datastore = NULL;
 
-			L = datastore->data;
+	if (!chan) {
+		return lua_new_state(NULL);
+	}
 
-			if (lua_load_extensions(L, chan)) {
-				const char *error = lua_tostring(L, -1);
-				ast_log(LOG_ERROR, "Error loading extensions.lua for %s: %s\n", ast_channel_name(chan), error);
+	ast_channel_lock(chan);
+	datastore = ast_channel_datastore_find(chan, &lua_datastore, NULL);
+	ast_channel_unlock(chan);
 
-				ast_channel_lock(chan);
-				ast_channel_datastore_remove(chan, datastore);
-				ast_channel_unlock(chan);
+	if (!datastore) {
+		/* nothing found, get a lua state */
+		datastore = ast_datastore_alloc(&lua_datastore, NULL);
+		if (!datastore) {
+			ast_log(LOG_ERROR, "Error allocation channel datastore for lua_State\n");
+			return NULL;
+		}
 
-				ast_datastore_free(datastore);
-				return NULL;
-			}
+		datastore->data = lua_new_state(chan);
+		if (!datastore->data) {
+			ast_datastore_free(datastore);
+			return NULL;
 		}
 
-		return datastore->data;
+		ast_channel_lock(chan);
+		ast_channel_datastore_add(chan, datastore);
+		ast_channel_unlock(chan);
 	}
+
+	return datastore->data;
 }
 
 static int exists(struct ast_channel *chan, const char *context, const char *exten, int priority, const char *callerid, const char *data)
@@ -1338,7 +1609,7 @@ static int exists(struct ast_channel *chan, const char *context, const char *ext
 
 	res = lua_find_extension(L, context, exten, priority, &exists, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_put_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1361,7 +1632,7 @@ static int canmatch(struct ast_channel *chan, const char *context, const char *e
 
 	res = lua_find_extension(L, context, exten, priority, &canmatch, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_put_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1384,7 +1655,7 @@ static int matchmore(struct ast_channel *chan, const char *context, const char *
 	
 	res = lua_find_extension(L, context, exten, priority, &matchmore, 0);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_put_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1413,7 +1684,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	if (!lua_find_extension(L, context, exten, priority, &exists, 1)) {
 		lua_pop(L, 1); /* pop the debug function */
 		ast_log(LOG_ERROR, "Could not find extension %s in context %s\n", exten, context);
-		if (!chan) lua_close(L);
+		if (!chan) lua_put_state(L);
 		ast_module_user_remove(u);
 		return -1;
 	}
@@ -1460,7 +1731,7 @@ static int exec(struct ast_channel *chan, const char *context, const char *exten
 	}
 	lua_pop(L, 1);
 
-	if (!chan) lua_close(L);
+	if (!chan) lua_put_state(L);
 	ast_module_user_remove(u);
 	return res;
 }
@@ -1652,11 +1923,51 @@ static int load_or_reload_lua_stuff(void)
 		ast_log(LOG_NOTICE, "Lua PBX Switch loaded.\n");
 	}
 	lua_close(L);
+
+	if (!res) {
+		lua_fill_pool();
+	}
 	return res;
 }
 
+static char *handle_cli_lua_show_pool(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "lua show pool";
+		e->usage =
+			"Usage: lua show pool\n"
+			"       Shows the lua states with extensions.lua loaded that are kept\n"
+			"       for channels to use, and how often states were created, reused\n"
+			"       from the pool, put back in it and closed.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&lua_pool_lock);
+	ast_cli(a->fd, "Pool size:   %u\n", lua_pool_size);
+	ast_cli(a->fd, "Idle states: %zu\n", AST_VECTOR_SIZE(&lua_pool));
+	ast_cli(a->fd, "Created:     %lu\n", lua_pool_stats.created);
+	ast_cli(a->fd, "Reused:      %lu\n", lua_pool_stats.reused);
+	ast_cli(a->fd, "Recycled:    %lu\n", lua_pool_stats.recycled);
+	ast_cli(a->fd, "Closed:      %lu\n", lua_pool_stats.closed);
+	ast_mutex_unlock(&lua_pool_lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_lua[] = {
+	AST_CLI_DEFINE(handle_cli_lua_show_pool, "Show the pool of lua states"),
+};
+
 static int unload_module(void)
 {
+	ast_cli_unregister_multiple(cli_lua, ARRAY_LEN(cli_lua));
 	ast_context_destroy(NULL, registrar);
 	ast_unregister_switch(&lua_switch);
 	lua_free_extensions();
@@ -1681,6 +1992,8 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	ast_cli_register_multiple(cli_lua, ARRAY_LEN(cli_lua));
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
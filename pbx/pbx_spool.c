@@ -26,6 +26,23 @@
 	<support_level>core</support_level>
  ***/
 
+/*** DOCUMENTATION
+	<manager name="SpoolStatus" language="en_US">
+		<synopsis>
+			Show the status of the outgoing call spool.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+		</syntax>
+		<description>
+			<para>Shows the limits on the calls placed from call files, how many
+			calls are waiting to be placed or retried and how many are being
+			placed, and how many were started, completed, are to be retried,
+			expired or were not valid since the module was loaded.</para>
+		</description>
+	</manager>
+ ***/
+
 #include "asterisk.h"
 
 #include <sys/stat.h>
@@ -53,6 +70,11 @@
 #include "asterisk/options.h"
 #include "asterisk/format.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
+#include "asterisk/config.h"
+#include "asterisk/heap.h"
+#include "asterisk/manager.h"
 
 /*
  * pbx_spool is similar in spirit to qcall, but with substantially enhanced functionality...
@@ -97,8 +119,52 @@ struct outgoing {
 	struct ast_variable *vars;                /*!< Variables and Functions */
 	int maxlen;                               /*!< Maximum length of call */
 	struct ast_flags options;                 /*!< options */
+	struct timeval due;                       /*!< When the next attempt may be started */
+	unsigned int seq;                         /*!< Order queued in, for attempts due at once */
+	ssize_t __heap_index;
 };
 
+/*! \brief Most calls placed at once, 0 for no limit */
+static unsigned int spool_maxcalls;
+
+/*! \brief Most calls started a second, 0 for no limit */
+static double spool_maxcps;
+
+/*!
+ * \brief Protects the dial queue, the limits and the counters and is used
+ * with dial_cond to wake the dialer.
+ */
+AST_MUTEX_DEFINE_STATIC(dial_lock);
+static ast_cond_t dial_cond;
+
+/*! \brief Calls waiting to be placed or retried, soonest first */
+static struct ast_heap *dial_queue;
+
+/*! \brief Order of the last call queued */
+static unsigned int dial_seq;
+
+/*! \brief Earliest a call may be started without going over spool_maxcps */
+static struct timeval dial_next_start;
+
+/*! \brief Names of the call files waiting in the dial queue or being called */
+static struct ao2_container *spool_files;
+
+/*! \brief What the dialer has done since the module was loaded */
+static struct {
+	/*! Calls being placed */
+	unsigned int active;
+	/*! Attempts started */
+	unsigned long started;
+	/*! Calls that completed */
+	unsigned long completed;
+	/*! Attempts that failed and are to be retried */
+	unsigned long retried;
+	/*! Calls that failed on their last attempt */
+	unsigned long expired;
+	/*! Call files that could not be read */
+	unsigned long invalid;
+} dial_stats;
+
 #if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
 struct direntry {
 	AST_LIST_ENTRY(direntry) list;
@@ -391,6 +457,46 @@ static int remove_from_queue(struct outgoing *o, const char *status)
 	return 0;
 }
 
+/*!
+ * \brief Add a call to the dial queue, with dial_lock held.
+ */
+static int dial_queue_push(struct outgoing *o)
+{
+	o->seq = dial_seq++;
+	if (ast_heap_push(dial_queue, o)) {
+		return -1;
+	}
+	ast_cond_signal(&dial_cond);
+
+	return 0;
+}
+
+/*!
+ * \brief Count the end of an attempt and queue the retry, if there is one.
+ *
+ * \param o The call, which is freed unless it is retried
+ * \param counter What to count the end of the attempt as, or NULL
+ * \param retry Non-zero to queue the call again for when it is due
+ */
+static void dial_done(struct outgoing *o, unsigned long *counter, int retry)
+{
+	ast_mutex_lock(&dial_lock);
+	--dial_stats.active;
+	if (counter) {
+		++*counter;
+	}
+	if (retry && dial_queue_push(o)) {
+		retry = 0;
+	}
+	ast_cond_signal(&dial_cond);
+	ast_mutex_unlock(&dial_lock);
+
+	if (!retry) {
+		ast_str_container_remove(spool_files, o->fn);
+		free_outgoing(o);
+	}
+}
+
 static void *attempt_thread(void *data)
 {
 	struct outgoing *o = data;
@@ -413,30 +519,120 @@ static void *attempt_thread(void *data)
 			/* Max retries exceeded */
 			ast_log(LOG_NOTICE, "Queued call to %s/%s expired without completion after %d attempt%s\n", o->tech, o->dest, o->retries - 1, ((o->retries - 1) != 1) ? "s" : "");
 			remove_from_queue(o, "Expired");
+			dial_done(o, &dial_stats.expired, 0);
 		} else {
 			/* Notate that the call is still active */
 			safe_append(o, time(NULL), "EndRetry");
-#if defined(HAVE_INOTIFY) || defined(HAVE_KQUEUE)
-			queue_file(o->fn, time(NULL) + o->retrytime);
-#endif
+			/* The call stays parsed and waits in the dial queue for the retry */
+			o->due = ast_tvadd(ast_tvnow(), ast_tv(o->retrytime, 0));
+			dial_done(o, &dial_stats.retried, 1);
 		}
 	} else {
 		ast_log(LOG_NOTICE, "Call completed to %s/%s\n", o->tech, o->dest);
 		remove_from_queue(o, "Completed");
+		dial_done(o, &dial_stats.completed, 0);
 	}
-	free_outgoing(o);
 	return NULL;
 }
 
+/*! \brief Start an attempt at a call taken off the dial queue */
 static void launch_service(struct outgoing *o)
 {
 	pthread_t t;
 	int ret;
 
+	/* Increment retries */
+	o->retries++;
+	safe_append(o, time(NULL) + o->retrytime, "StartRetry");
+
 	if ((ret = ast_pthread_create_detached(&t, NULL, attempt_thread, o))) {
 		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
-		free_outgoing(o);
+		dial_done(o, NULL, 0);
+	}
+}
+
+/*!
+ * \brief Add a call read from a call file to the dial queue, to be called now.
+ */
+static int queue_service(struct outgoing *o)
+{
+	int res;
+
+	if (ast_str_container_add(spool_files, o->fn)) {
+		return -1;
+	}
+
+	o->due = ast_tvnow();
+	ast_mutex_lock(&dial_lock);
+	res = dial_queue_push(o);
+	ast_mutex_unlock(&dial_lock);
+	if (res) {
+		ast_str_container_remove(spool_files, o->fn);
+	}
+
+	return res;
+}
+
+/*!
+ * \brief Count a call file that could not be read.
+ */
+static void count_invalid(void)
+{
+	ast_mutex_lock(&dial_lock);
+	++dial_stats.invalid;
+	ast_mutex_unlock(&dial_lock);
+}
+
+/*!
+ * \brief Place the calls in the dial queue as they come due, within the limits.
+ */
+static void *dial_thread(void *unused)
+{
+	struct outgoing *o;
+	struct timeval now;
+	struct timeval wake;
+	struct timespec ts;
+	int64_t interval;
+
+	ast_mutex_lock(&dial_lock);
+	for (;;) {
+		o = ast_heap_peek(dial_queue, 1);
+		if (!o || (spool_maxcalls && dial_stats.active >= spool_maxcalls)) {
+			ast_cond_wait(&dial_cond, &dial_lock);
+			continue;
+		}
+
+		now = ast_tvnow();
+		wake = o->due;
+		if (spool_maxcps > 0 && ast_tvcmp(dial_next_start, wake) > 0) {
+			wake = dial_next_start;
+		}
+		if (ast_tvcmp(wake, now) > 0) {
+			ts.tv_sec = wake.tv_sec;
+			ts.tv_nsec = wake.tv_usec * 1000;
+			ast_cond_timedwait(&dial_cond, &dial_lock, &ts);
+			continue;
+		}
+
+		ast_heap_pop(dial_queue);
+		if (spool_maxcps > 0) {
+			interval = 1000000 / spool_maxcps;
+			if (ast_tvcmp(dial_next_start, now) < 0) {
+				dial_next_start = now;
+			}
+			dial_next_start = ast_tvadd(dial_next_start,
+				ast_tv(interval / 1000000, interval % 1000000));
+		}
+		++dial_stats.active;
+		++dial_stats.started;
+
+		ast_mutex_unlock(&dial_lock);
+		launch_service(o);
+		ast_mutex_lock(&dial_lock);
 	}
+	ast_mutex_unlock(&dial_lock);
+
+	return NULL;
 }
 
 /* Called from scan_thread or queue_file */
@@ -445,6 +641,13 @@ static int scan_service(const char *fn, time_t now)
 	struct outgoing *o;
 	FILE *f;
 	int res;
+	char *queued;
+
+	/* A call file that is waiting or being called is left to the dialer */
+	if ((queued = ao2_find(spool_files, fn, OBJ_SEARCH_KEY))) {
+		ao2_ref(queued, -1);
+		return 0;
+	}
 
 	o = new_outgoing(fn);
 	if (!o) {
@@ -468,6 +671,7 @@ static int scan_service(const char *fn, time_t now)
 		}
 		remove_from_queue(o, "Failed");
 		free_outgoing(o);
+		count_invalid();
 		return -1;
 	}
 
@@ -478,6 +682,7 @@ static int scan_service(const char *fn, time_t now)
 		ast_log(LOG_WARNING, "Invalid file contents in %s, deleting\n", o->fn);
 		remove_from_queue(o, "Failed");
 		free_outgoing(o);
+		count_invalid();
 		return -1;
 	}
 
@@ -489,15 +694,15 @@ static int scan_service(const char *fn, time_t now)
 			ast_debug(1, "Delaying retry since we're currently running '%s'\n", o->fn);
 			free_outgoing(o);
 		} else {
-			/* Increment retries */
-			o->retries++;
 			/* If someone else was calling, they're presumably gone now
 			   so abort their retry and continue as we were... */
 			if (o->callingpid)
 				safe_append(o, time(NULL), "AbortRetry");
 
-			safe_append(o, now, "StartRetry");
-			launch_service(o);
+			if (queue_service(o)) {
+				free_outgoing(o);
+				return -1;
+			}
 		}
 		return now;
 	}
@@ -899,6 +1104,146 @@ static void *scan_thread(void *unused)
 }
 #endif
 
+static char *handle_cli_spool_status(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "spool show status";
+		e->usage =
+			"Usage: spool show status\n"
+			"       Shows the limits on the calls placed from call files, how many\n"
+			"       calls are waiting to be placed or retried and how many are being\n"
+			"       placed, and what has been done since the module was loaded.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&dial_lock);
+	ast_cli(a->fd, "Max calls:              %u%s\n", spool_maxcalls, spool_maxcalls ? "" : " (no limit)");
+	ast_cli(a->fd, "Max calls a second:     %.2f%s\n", spool_maxcps, spool_maxcps > 0 ? "" : " (no limit)");
+	ast_cli(a->fd, "Waiting:                %zu\n", ast_heap_size(dial_queue));
+	ast_cli(a->fd, "Calling:                %u\n", dial_stats.active);
+	ast_cli(a->fd, "Started:                %lu\n", dial_stats.started);
+	ast_cli(a->fd, "Completed:              %lu\n", dial_stats.completed);
+	ast_cli(a->fd, "Retried:                %lu\n", dial_stats.retried);
+	ast_cli(a->fd, "Expired:                %lu\n", dial_stats.expired);
+	ast_cli(a->fd, "Invalid:                %lu\n", dial_stats.invalid);
+	ast_mutex_unlock(&dial_lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry spool_cli[] = {
+	AST_CLI_DEFINE(handle_cli_spool_status, "Show the status of the outgoing call spool"),
+};
+
+static int manager_spool_status(struct mansession *s, const struct message *m)
+{
+	const char *actionid = astman_get_header(m, "ActionID");
+	char idText[150];
+
+	if (!ast_strlen_zero(actionid)) {
+		snprintf(idText, sizeof(idText), "ActionID: %s\r\n", actionid);
+	} else {
+		idText[0] = '\0';
+	}
+
+	ast_mutex_lock(&dial_lock);
+	astman_append(s, "Response: Success\r\n"
+		"%s"
+		"MaxCalls: %u\r\n"
+		"MaxCallsPerSecond: %.2f\r\n"
+		"Waiting: %zu\r\n"
+		"Calling: %u\r\n"
+		"Started: %lu\r\n"
+		"Completed: %lu\r\n"
+		"Retried: %lu\r\n"
+		"Expired: %lu\r\n"
+		"Invalid: %lu\r\n"
+		"\r\n",
+		idText,
+		spool_maxcalls,
+		spool_maxcps,
+		ast_heap_size(dial_queue),
+		dial_stats.active,
+		dial_stats.started,
+		dial_stats.completed,
+		dial_stats.retried,
+		dial_stats.expired,
+		dial_stats.invalid);
+	ast_mutex_unlock(&dial_lock);
+
+	return 0;
+}
+
+/*! \brief Key of a call in the dial queue, the soonest due being the largest */
+static int64_t dial_queue_key(void *obj)
+{
+	struct outgoing *o = obj;
+
+	return -((int64_t) o->due.tv_sec * 1000000 + o->due.tv_usec);
+}
+
+static int dial_queue_cmp(void *obj1, void *obj2)
+{
+	struct outgoing *o1 = obj1;
+	struct outgoing *o2 = obj2;
+
+	return (int) (o2->seq - o1->seq);
+}
+
+static int load_config(int reload)
+{
+	struct ast_config *cfg;
+	struct ast_flags config_flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
+	struct ast_variable *v;
+	unsigned int maxcalls = 0;
+	double maxcps = 0;
+
+	cfg = ast_config_load("pbx_spool.conf", config_flags);
+	if (cfg == CONFIG_STATUS_FILEUNCHANGED) {
+		return 0;
+	} else if (cfg == CONFIG_STATUS_FILEINVALID) {
+		ast_log(LOG_ERROR, "Config file pbx_spool.conf is in an invalid format.  Aborting.\n");
+		return -1;
+	}
+
+	for (v = cfg ? ast_variable_browse(cfg, "general") : NULL; v; v = v->next) {
+		if (!strcasecmp(v->name, "maxcalls")) {
+			if (sscanf(v->value, "%30u", &maxcalls) != 1) {
+				ast_log(LOG_WARNING, "Invalid maxcalls '%s' at line %d of pbx_spool.conf\n", v->value, v->lineno);
+				maxcalls = 0;
+			}
+		} else if (!strcasecmp(v->name, "maxcps")) {
+			if (sscanf(v->value, "%30lf", &maxcps) != 1 || maxcps < 0) {
+				ast_log(LOG_WARNING, "Invalid maxcps '%s' at line %d of pbx_spool.conf\n", v->value, v->lineno);
+				maxcps = 0;
+			}
+		} else {
+			ast_log(LOG_WARNING, "Unknown option '%s' at line %d of pbx_spool.conf\n", v->name, v->lineno);
+		}
+	}
+	ast_config_destroy(cfg);
+
+	ast_mutex_lock(&dial_lock);
+	spool_maxcalls = maxcalls;
+	spool_maxcps = maxcps;
+	ast_cond_signal(&dial_cond);
+	ast_mutex_unlock(&dial_lock);
+
+	return 0;
+}
+
+static int reload_module(void)
+{
+	return load_config(1) ? AST_MODULE_LOAD_DECLINE : AST_MODULE_LOAD_SUCCESS;
+}
+
 static int unload_module(void)
 {
 	return -1;
@@ -908,6 +1253,11 @@ static int load_module(void)
 {
 	pthread_t thread;
 	int ret;
+
+	if (load_config(0)) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	snprintf(qdir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing");
 	if (ast_mkdir(qdir, 0777)) {
 		ast_log(LOG_WARNING, "Unable to create queue directory %s -- outgoing spool disabled\n", qdir);
@@ -915,12 +1265,33 @@ static int load_module(void)
 	}
 	snprintf(qdonedir, sizeof(qdir), "%s/%s", ast_config_AST_SPOOL_DIR, "outgoing_done");
 
+	spool_files = ast_str_container_alloc(1567);
+	dial_queue = ast_heap_create_keyed(8, dial_queue_key, dial_queue_cmp,
+		offsetof(struct outgoing, __heap_index));
+	if (!spool_files || !dial_queue) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+	ast_cond_init(&dial_cond, NULL);
+
+	if ((ret = ast_pthread_create_detached_background(&thread, NULL, dial_thread, NULL))) {
+		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	if ((ret = ast_pthread_create_detached_background(&thread, NULL, scan_thread, NULL))) {
 		ast_log(LOG_WARNING, "Unable to create thread :( (returned error: %d)\n", ret);
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	ast_cli_register_multiple(spool_cli, ARRAY_LEN(spool_cli));
+	ast_manager_register_xml("SpoolStatus", EVENT_FLAG_SYSTEM | EVENT_FLAG_REPORTING, manager_spool_status);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
-AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Outgoing Spool Support");
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Outgoing Spool Support",
+	.support_level = AST_MODULE_SUPPORT_CORE,
+	.load = load_module,
+	.unload = unload_module,
+	.reload = reload_module,
+);
@@ -21,6 +21,7 @@
 #include "asterisk/ari.h"
 #include "asterisk/astobj2.h"
 #include "asterisk/http_websocket.h"
+#include "asterisk/threadstorage.h"
 #include "internal.h"
 
 /*! \file
@@ -32,8 +33,19 @@
 struct ast_ari_websocket_session {
 	struct ast_websocket *ws_session;
 	int (*validator)(struct ast_json *);
+	/*! JSON format of the messages written, from ari.conf when the session was created */
+	enum ast_json_encoding_format format;
 };
 
+/*! \brief Buffer messages are encoded in before being written */
+AST_THREADSTORAGE(websocket_write_buf);
+
+/*! \brief Initial size of websocket_write_buf */
+#define WEBSOCKET_WRITE_BUF_INITSIZE 1024
+
+/*! \brief Most bytes of events waiting to be sent before a client is disconnected */
+#define WEBSOCKET_SEND_QUEUE_SIZE (4 * 1024 * 1024)
+
 static void websocket_session_dtor(void *obj)
 {
 	struct ast_ari_websocket_session *session = obj;
@@ -80,6 +92,12 @@ struct ast_ari_websocket_session *ast_ari_websocket_session_create(
 			config->general->write_timeout);
 	}
 
+	/* Events are queued so a slow client does not hold up the Stasis application. */
+	if (ast_websocket_set_send_queue(ws_session, WEBSOCKET_SEND_QUEUE_SIZE,
+		AST_WEBSOCKET_SEND_QUEUE_DISCONNECT)) {
+		ast_log(LOG_WARNING, "Failed to set up send queue on ARI web socket\n");
+	}
+
 	session = ao2_alloc(sizeof(*session), websocket_session_dtor);
 	if (!session) {
 		return NULL;
@@ -88,6 +106,7 @@ struct ast_ari_websocket_session *ast_ari_websocket_session_create(
 	ao2_ref(ws_session, +1);
 	session->ws_session = ws_session;
 	session->validator = validator;
+	session->format = config->general->format;
 
 	ao2_ref(session, +1);
 	return session;
@@ -156,26 +175,32 @@ struct ast_json *ast_ari_websocket_session_read(
 int ast_ari_websocket_session_write(struct ast_ari_websocket_session *session,
 	struct ast_json *message)
 {
-	RAII_VAR(char *, str, NULL, ast_json_free);
+	struct ast_str *buf;
 
 #ifdef AST_DEVMODE
-	if (!session->validator(message)) {
+	if (session->validator != null_validator && ast_ari_validate_sample()
+		&& !session->validator(message)) {
 		ast_log(LOG_ERROR, "Outgoing message failed validation\n");
 		return ast_websocket_write_string(session->ws_session, VALIDATION_FAILED);
 	}
 #endif
 
-	str = ast_json_dump_string_format(message, ast_ari_json_format());
-
-	if (str == NULL) {
+	/*
+	 * Encode into a buffer kept by the thread, so that writing an event
+	 * does not allocate, and hand it to the websocket as is.
+	 */
+	buf = ast_str_thread_get(&websocket_write_buf, WEBSOCKET_WRITE_BUF_INITSIZE);
+	if (!buf || ast_json_dump_str_format(message, &buf, session->format)) {
 		ast_log(LOG_ERROR, "Failed to encode JSON object\n");
 		return -1;
 	}
 
 #ifdef AST_DEVMODE
-	ast_debug(3, "Examining ARI event (length %u): \n%s\n", (unsigned int) strlen(str), str);
+	ast_debug(3, "Examining ARI event (length %u): \n%s\n",
+		(unsigned int) ast_str_strlen(buf), ast_str_buffer(buf));
 #endif
-	if (ast_websocket_write_string(session->ws_session, str)) {
+	if (ast_websocket_write(session->ws_session, AST_WEBSOCKET_OPCODE_TEXT,
+		ast_str_buffer(buf), ast_str_strlen(buf))) {
 		ast_log(LOG_NOTICE, "Problem occurred during websocket write, websocket closed\n");
 		return -1;
 	}
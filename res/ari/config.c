@@ -33,6 +33,12 @@
 /*! \brief Locking container for safe configuration access. */
 static AO2_GLOBAL_OBJ_STATIC(confs);
 
+/*! \brief Outgoing messages validated, one of this many (0 for none) */
+static unsigned int validation_sample_rate = 1;
+
+/*! \brief Outgoing messages considered for validation */
+static int validation_count;
+
 /*! \brief Mapping of the ARI conf struct's globals to the
  *         general context in the config file. */
 static struct aco_type general_option = {
@@ -307,6 +313,8 @@ static int process_config(int reload)
 		return -1;
 	}
 
+	validation_sample_rate = conf->general->validation_sample_rate;
+
 	if (conf->general->enabled) {
 		if (ao2_container_count(conf->users) == 0) {
 			ast_log(LOG_ERROR, "No configured users for ARI\n");
@@ -318,6 +326,17 @@ static int process_config(int reload)
 	return 0;
 }
 
+int ast_ari_validate_sample(void)
+{
+	unsigned int rate = validation_sample_rate;
+
+	if (rate <= 1) {
+		return rate;
+	}
+
+	return (unsigned int) ast_atomic_fetchadd_int(&validation_count, +1) % rate == 0;
+}
+
 #define MAX_VARS 128
 
 static int channelvars_handler(const struct aco_option *opt, struct ast_variable *var, void *obj)
@@ -357,6 +376,9 @@ int ast_ari_config_init(void)
 	aco_option_register(&cfg_info, "websocket_write_timeout", ACO_EXACT, general_options,
 		AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT_STR, OPT_INT_T, PARSE_IN_RANGE,
 		FLDSET(struct ast_ari_conf_general, write_timeout), 1, INT_MAX);
+	aco_option_register(&cfg_info, "validation_sample_rate", ACO_EXACT, general_options,
+		"1", OPT_UINT_T, 0,
+		FLDSET(struct ast_ari_conf_general, validation_sample_rate));
 	aco_option_register_custom(&cfg_info, "channelvars", ACO_EXACT, general_options,
 		"", channelvars_handler, 0);
 
@@ -67,6 +67,8 @@ struct ast_ari_conf_general {
 	int enabled;
 	/*! Write timeout for websocket connections */
 	int write_timeout;
+	/*! Outgoing messages validated, one of this many (0 for none) */
+	unsigned int validation_sample_rate;
 	/*! Encoding format used during output (default compact). */
 	enum ast_json_encoding_format format;
 	/*! Authentication realm */
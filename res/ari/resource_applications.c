@@ -168,3 +168,28 @@ void ast_ari_applications_unsubscribe(struct ast_variable *headers,
 			"Error processing request");
 	}
 }
+
+void ast_ari_applications_filter(struct ast_variable *headers,
+	struct ast_ari_applications_filter_args *args,
+	struct ast_ari_response *response)
+{
+	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+
+	switch (stasis_app_event_filter_set(args->application_name, args->filter, &json)) {
+	case STASIS_AEF_OK:
+		ast_ari_response_ok(response, ast_json_ref(json));
+		break;
+	case STASIS_AEF_APP_NOT_FOUND:
+		ast_ari_response_error(response, 404, "Not Found",
+			"Application not found");
+		break;
+	case STASIS_AEF_INVALID:
+		ast_ari_response_error(response, 400, "Bad Request",
+			"Invalid event filter");
+		break;
+	case STASIS_AEF_INTERNAL_ERROR:
+		ast_ari_response_error(response, 500, "Internal Server Error",
+			"Error processing request");
+		break;
+	}
+}
@@ -877,15 +877,23 @@ void ast_ari_bridges_destroy(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+/*! \brief Fields always listed for a bridge */
+static const char * const bridge_key_fields[] = { "id", NULL };
+
+/*! \brief Convert a listed bridge snapshot to JSON */
+static struct ast_json *bridge_list_item_to_json(void *obj)
+{
+	return ast_bridge_snapshot_to_json(obj, stasis_app_get_sanitizer());
+}
+
 void ast_ari_bridges_list(struct ast_variable *headers,
 	struct ast_ari_bridges_list_args *args,
 	struct ast_ari_response *response)
 {
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
-	struct ao2_iterator i;
-	void *obj;
+	RAII_VAR(struct stasis_cache_snapshots *, snapshots, NULL, ao2_cleanup);
+	struct ast_ari_list_items items;
+	size_t idx;
 
 	cache = ast_bridge_cache();
 	if (!cache) {
@@ -896,33 +904,45 @@ void ast_ari_bridges_list(struct ast_variable *headers,
 	}
 	ao2_ref(cache, +1);
 
-	snapshots = stasis_cache_dump(cache, ast_bridge_snapshot_type());
+	snapshots = stasis_cache_snapshots(cache, ast_bridge_snapshot_type());
 	if (!snapshots) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	json = ast_json_array_create();
-	if (!json) {
+	if (AST_VECTOR_INIT(&items, stasis_cache_snapshots_count(snapshots))) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_bridge_snapshot *snapshot = stasis_message_data(msg);
-		struct ast_json *json_bridge = ast_bridge_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	/* The shared snapshots are kept alive until the page is built. */
+	for (idx = 0; idx < stasis_cache_snapshots_count(snapshots); ++idx) {
+		struct ast_bridge_snapshot *snapshot = stasis_message_data(
+			stasis_cache_snapshots_get(snapshots, idx));
+		struct ast_ari_list_item item = {
+			.id = snapshot->uniqueid,
+			.obj = snapshot,
+		};
+		const char *type;
+
+		type = (snapshot->capabilities & AST_BRIDGE_CAPABILITY_HOLDING) ? "holding" : "mixing";
+		if ((!ast_strlen_zero(args->technology)
+				&& strcmp(snapshot->technology, args->technology))
+			|| (!ast_strlen_zero(args->type) && strcmp(type, args->type))) {
+			continue;
+		}
 
-		if (!json_bridge || ast_json_array_append(json, json_bridge)) {
-			ao2_iterator_destroy(&i);
+		if (AST_VECTOR_APPEND(&items, item)) {
+			AST_VECTOR_FREE(&items);
 			ast_ari_response_alloc_failed(response);
 			return;
 		}
 	}
-	ao2_iterator_destroy(&i);
 
-	ast_ari_response_ok(response, ast_json_ref(json));
+	ast_ari_response_list_page(response, &items, args->after, args->limit,
+		args->fields, args->fields_count, bridge_key_fields,
+		bridge_list_item_to_json);
+	AST_VECTOR_FREE(&items);
 }
 
 void ast_ari_bridges_create(struct ast_variable *headers,
@@ -41,10 +41,37 @@
 
 /*! Argument struct for ast_ari_bridges_list() */
 struct ast_ari_bridges_list_args {
+	/*! Only list bridges whose id sorts after this one. To get the next page, pass the id of the last bridge of the previous page. */
+	const char *after;
+	/*! Most bridges to list, or 0 to list all of them. */
+	int limit;
+	/*! Array of Fields of each bridge to list, or all of them if not given. The id is always listed. */
+	const char **fields;
+	/*! Length of fields array. */
+	size_t fields_count;
+	/*! Parsing context for fields. */
+	char *fields_parse;
+	/*! Only list bridges using this bridging technology (simple_bridge, softmix, holding_bridge, ...). */
+	const char *technology;
+	/*! Only list bridges of this type. */
+	const char *type;
 };
+/*!
+ * \brief Body parsing function for /bridges.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_bridges_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_bridges_list_args *args);
+
 /*!
  * \brief List all active bridges in Asterisk.
  *
+ * Bridges are listed in order of their id. The list can be read a page at a time with the after and limit parameters.
+ *
  * \param headers HTTP headers
  * \param args Swagger parameters
  * \param[out] response HTTP response
@@ -279,6 +279,78 @@ void ast_ari_channels_redirect(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+void ast_ari_channels_redirect_list(struct ast_variable *headers,
+	struct ast_ari_channels_redirect_list_args *args,
+	struct ast_ari_response *response)
+{
+	char *tech;
+	char *resource;
+	int tech_len;
+	int found = 0;
+	size_t i;
+
+	if (ast_strlen_zero(args->endpoint)) {
+		ast_ari_response_error(response, 400, "Bad Request",
+			"Required parameter 'endpoint' not provided.");
+		return;
+	}
+
+	tech = ast_strdupa(args->endpoint);
+	if (!(resource = strchr(tech, '/')) || !(tech_len = resource - tech)) {
+		ast_ari_response_error(response, 422, "Unprocessable Entity",
+			"Endpoint parameter '%s' does not contain tech/resource", args->endpoint);
+		return;
+	}
+
+	*resource++ = '\0';
+	if (ast_strlen_zero(resource)) {
+		ast_ari_response_error(response, 422, "Unprocessable Entity",
+			"No resource provided in endpoint parameter '%s'", args->endpoint);
+		return;
+	}
+
+	/*
+	 * The redirect is queued to the control of each channel, so the
+	 * channels are redirected in parallel by their own threads.
+	 */
+	for (i = 0; i < args->channel_ids_count; ++i) {
+		RAII_VAR(struct stasis_app_control *, control, NULL, ao2_cleanup);
+		RAII_VAR(struct ast_channel_snapshot *, chan_snapshot, NULL, ao2_cleanup);
+
+		control = stasis_app_control_find_by_channel_id(args->channel_ids[i]);
+		if (!control) {
+			RAII_VAR(struct ast_channel *, chan, NULL, ao2_cleanup);
+
+			chan = ast_channel_get_by_name(args->channel_ids[i]);
+			found += chan ? 1 : 0;
+			continue;
+		}
+		++found;
+
+		chan_snapshot = stasis_app_control_get_snapshot(control);
+		if (!chan_snapshot
+			|| chan_snapshot->state == AST_STATE_DOWN
+			|| chan_snapshot->state == AST_STATE_RESERVED
+			|| chan_snapshot->state == AST_STATE_RINGING
+			|| strncasecmp(chan_snapshot->type, tech, tech_len)) {
+			continue;
+		}
+
+		if (stasis_app_control_redirect(control, resource)) {
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+	}
+
+	if (!found) {
+		ast_ari_response_error(response, 404, "Not Found",
+			"None of the channels found");
+		return;
+	}
+
+	ast_ari_response_no_content(response);
+}
+
 void ast_ari_channels_answer(struct ast_variable *headers,
 	struct ast_ari_channels_answer_args *args,
 	struct ast_ari_response *response)
@@ -861,6 +933,31 @@ void ast_ari_channels_get(struct ast_variable *headers,
 				ast_channel_snapshot_to_json(snapshot, NULL));
 }
 
+/*!
+ * \brief Convert the reason given for a hangup to a hangup cause.
+ *
+ * \param reason Reason from the request, or \c NULL for the default.
+ *
+ * \return Hangup cause.
+ * \return -1 if the reason is invalid.
+ */
+static int hangup_reason_to_cause(const char *reason)
+{
+	if (ast_strlen_zero(reason) || !strcmp(reason, "normal")) {
+		return AST_CAUSE_NORMAL;
+	} else if (!strcmp(reason, "busy")) {
+		return AST_CAUSE_BUSY;
+	} else if (!strcmp(reason, "congestion")) {
+		return AST_CAUSE_CONGESTION;
+	} else if (!strcmp(reason, "no_answer")) {
+		return AST_CAUSE_NOANSWER;
+	} else if(!strcmp(reason, "answered_elsewhere")) {
+		return AST_CAUSE_ANSWERED_ELSEWHERE;
+	}
+
+	return -1;
+}
+
 void ast_ari_channels_hangup(struct ast_variable *headers,
 	struct ast_ari_channels_hangup_args *args,
 	struct ast_ari_response *response)
@@ -876,17 +973,8 @@ void ast_ari_channels_hangup(struct ast_variable *headers,
 		return;
 	}
 
-	if (ast_strlen_zero(args->reason) || !strcmp(args->reason, "normal")) {
-		cause = AST_CAUSE_NORMAL;
-	} else if (!strcmp(args->reason, "busy")) {
-		cause = AST_CAUSE_BUSY;
-	} else if (!strcmp(args->reason, "congestion")) {
-		cause = AST_CAUSE_CONGESTION;
-	} else if (!strcmp(args->reason, "no_answer")) {
-		cause = AST_CAUSE_NOANSWER;
-	} else if(!strcmp(args->reason, "answered_elsewhere")) {
-		cause = AST_CAUSE_ANSWERED_ELSEWHERE;
-	} else {
+	cause = hangup_reason_to_cause(args->reason);
+	if (cause < 0) {
 		ast_ari_response_error(
 			response, 400, "Invalid Reason",
 			"Invalid reason for hangup provided");
@@ -899,15 +987,83 @@ void ast_ari_channels_hangup(struct ast_variable *headers,
 	ast_ari_response_no_content(response);
 }
 
+void ast_ari_channels_hangup_list(struct ast_variable *headers,
+	struct ast_ari_channels_hangup_list_args *args,
+	struct ast_ari_response *response)
+{
+	int found = 0;
+	int cause;
+	size_t i;
+
+	cause = hangup_reason_to_cause(args->reason);
+	if (cause < 0) {
+		ast_ari_response_error(
+			response, 400, "Invalid Reason",
+			"Invalid reason for hangup provided");
+		return;
+	}
+
+	for (i = 0; i < args->channel_ids_count; ++i) {
+		struct ast_channel *chan;
+
+		chan = ast_channel_get_by_name(args->channel_ids[i]);
+		if (!chan) {
+			continue;
+		}
+
+		/* A soft hangup only flags the channel, its own thread hangs it up. */
+		ast_channel_hangupcause_set(chan, cause);
+		ast_softhangup(chan, AST_SOFTHANGUP_EXPLICIT);
+		ast_channel_unref(chan);
+		++found;
+	}
+
+	if (!found) {
+		ast_ari_response_error(
+			response, 404, "Not Found",
+			"None of the channels found");
+		return;
+	}
+
+	ast_ari_response_no_content(response);
+}
+
+/*! \brief Fields always listed for a channel */
+static const char * const channel_key_fields[] = { "id", NULL };
+
+/*! \brief Convert a listed channel snapshot to JSON */
+static struct ast_json *channel_list_item_to_json(void *obj)
+{
+	return ast_channel_snapshot_to_json(obj, NULL);
+}
+
+/*! \brief Determine whether a channel is controlled by the named Stasis application */
+static int channel_in_app(const char *channel_id, const char *app)
+{
+	struct stasis_app_control *control;
+	const char *name;
+	int res;
+
+	control = stasis_app_control_find_by_channel_id(channel_id);
+	if (!control) {
+		return 0;
+	}
+
+	name = stasis_app_control_get_app_name(control);
+	res = name && !strcmp(name, app);
+	ao2_ref(control, -1);
+
+	return res;
+}
+
 void ast_ari_channels_list(struct ast_variable *headers,
 	struct ast_ari_channels_list_args *args,
 	struct ast_ari_response *response)
 {
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
-	struct ao2_iterator i;
-	void *obj;
+	RAII_VAR(struct stasis_cache_snapshots *, snapshots, NULL, ao2_cleanup);
+	struct ast_ari_list_items items;
+	size_t idx;
 	struct stasis_message_sanitizer *sanitize = stasis_app_get_sanitizer();
 
 	cache = ast_channel_cache();
@@ -919,40 +1075,51 @@ void ast_ari_channels_list(struct ast_variable *headers,
 	}
 	ao2_ref(cache, +1);
 
-	snapshots = stasis_cache_dump(cache, ast_channel_snapshot_type());
+	snapshots = stasis_cache_snapshots(cache, ast_channel_snapshot_type());
 	if (!snapshots) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	json = ast_json_array_create();
-	if (!json) {
+	if (AST_VECTOR_INIT(&items, stasis_cache_snapshots_count(snapshots))) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_channel_snapshot *snapshot = stasis_message_data(msg);
-		int r;
+	/* The shared snapshots are kept alive until the page is built. */
+	for (idx = 0; idx < stasis_cache_snapshots_count(snapshots); ++idx) {
+		struct ast_channel_snapshot *snapshot = stasis_message_data(
+			stasis_cache_snapshots_get(snapshots, idx));
+		struct ast_ari_list_item item = {
+			.id = snapshot->uniqueid,
+			.obj = snapshot,
+		};
 
 		if (sanitize && sanitize->channel_snapshot
 			&& sanitize->channel_snapshot(snapshot)) {
 			continue;
 		}
 
-		r = ast_json_array_append(
-			json, ast_channel_snapshot_to_json(snapshot, NULL));
-		if (r != 0) {
+		if ((!ast_strlen_zero(args->state)
+				&& strcmp(ast_state2str(snapshot->state), args->state))
+			|| (!ast_strlen_zero(args->technology)
+				&& strcasecmp(snapshot->type, args->technology))
+			|| (!ast_strlen_zero(args->app)
+				&& !channel_in_app(snapshot->uniqueid, args->app))) {
+			continue;
+		}
+
+		if (AST_VECTOR_APPEND(&items, item)) {
+			AST_VECTOR_FREE(&items);
 			ast_ari_response_alloc_failed(response);
-			ao2_iterator_destroy(&i);
 			return;
 		}
 	}
-	ao2_iterator_destroy(&i);
 
-	ast_ari_response_ok(response, ast_json_ref(json));
+	ast_ari_response_list_page(response, &items, args->after, args->limit,
+		args->fields, args->fields_count, channel_key_fields,
+		channel_list_item_to_json);
+	AST_VECTOR_FREE(&items);
 }
 
 /*! \brief Structure used for origination */
@@ -41,15 +41,76 @@
 
 /*! Argument struct for ast_ari_channels_list() */
 struct ast_ari_channels_list_args {
+	/*! Only list channels whose id sorts after this one. To get the next page, pass the id of the last channel of the previous page. */
+	const char *after;
+	/*! Most channels to list, or 0 to list all of them. */
+	int limit;
+	/*! Array of Fields of each channel to list, or all of them if not given. The id is always listed. */
+	const char **fields;
+	/*! Length of fields array. */
+	size_t fields_count;
+	/*! Parsing context for fields. */
+	char *fields_parse;
+	/*! Only list channels in this state. */
+	const char *state;
+	/*! Only list channels of this technology (PJSIP, SIP, IAX2, ...). */
+	const char *technology;
+	/*! Only list channels controlled by this Stasis application. */
+	const char *app;
 };
+/*!
+ * \brief Body parsing function for /channels.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_channels_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_list_args *args);
+
 /*!
  * \brief List all active channels in Asterisk.
  *
+ * Channels are listed in order of their id. The list can be read a page at a time with the after and limit parameters.
+ *
  * \param headers HTTP headers
  * \param args Swagger parameters
  * \param[out] response HTTP response
  */
 void ast_ari_channels_list(struct ast_variable *headers, struct ast_ari_channels_list_args *args, struct ast_ari_response *response);
+/*! Argument struct for ast_ari_channels_hangup_list() */
+struct ast_ari_channels_hangup_list_args {
+	/*! Array of Ids of the channels to hang up */
+	const char **channel_ids;
+	/*! Length of channel_ids array. */
+	size_t channel_ids_count;
+	/*! Parsing context for channel_ids. */
+	char *channel_ids_parse;
+	/*! Reason for hanging up the channels */
+	const char *reason;
+};
+/*!
+ * \brief Body parsing function for /channels.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_channels_hangup_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_hangup_list_args *args);
+
+/*!
+ * \brief Delete (i.e. hangup) several channels.
+ *
+ * Channels which do not exist are skipped.
+ *
+ * \param headers HTTP headers
+ * \param args Swagger parameters
+ * \param[out] response HTTP response
+ */
+void ast_ari_channels_hangup_list(struct ast_variable *headers, struct ast_ari_channels_hangup_list_args *args, struct ast_ari_response *response);
 /*! Argument struct for ast_ari_channels_originate() */
 struct ast_ari_channels_originate_args {
 	/*! Endpoint to call. */
@@ -78,7 +139,7 @@ struct ast_ari_channels_originate_args {
 	const char *other_channel_id;
 	/*! The unique id of the channel which is originating this one. */
 	const char *originator;
-	/*! The format name capability list to use if originator is not specified. Ex. "ulaw,slin16".  Format names an be found with "core show codecs". */
+	/*! The format name capability list to use if originator is not specified. Ex. "ulaw,slin16".  Format names can be found with "core show codecs". */
 	const char *formats;
 };
 /*!
@@ -138,6 +199,38 @@ int ast_ari_channels_create_parse_body(
  * \param[out] response HTTP response
  */
 void ast_ari_channels_create(struct ast_variable *headers, struct ast_ari_channels_create_args *args, struct ast_ari_response *response);
+/*! Argument struct for ast_ari_channels_redirect_list() */
+struct ast_ari_channels_redirect_list_args {
+	/*! Array of Ids of the channels to redirect */
+	const char **channel_ids;
+	/*! Length of channel_ids array. */
+	size_t channel_ids_count;
+	/*! Parsing context for channel_ids. */
+	char *channel_ids_parse;
+	/*! The endpoint to redirect the channels to */
+	const char *endpoint;
+};
+/*!
+ * \brief Body parsing function for /channels/redirect.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_channels_redirect_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_redirect_list_args *args);
+
+/*!
+ * \brief Redirect several channels to a different location.
+ *
+ * Each channel is redirected by its own Stasis control, so the channels are redirected in parallel. Channels which do not exist, are not in a Stasis application, are in an invalid state or are not the same type as the endpoint are skipped.
+ *
+ * \param headers HTTP headers
+ * \param args Swagger parameters
+ * \param[out] response HTTP response
+ */
+void ast_ari_channels_redirect_list(struct ast_variable *headers, struct ast_ari_channels_redirect_list_args *args, struct ast_ari_response *response);
 /*! Argument struct for ast_ari_channels_get() */
 struct ast_ari_channels_get_args {
 	/*! Channel's id */
@@ -179,7 +272,7 @@ struct ast_ari_channels_originate_with_id_args {
 	const char *other_channel_id;
 	/*! The unique id of the channel which is originating this one. */
 	const char *originator;
-	/*! The format name capability list to use if originator is not specified. Ex. "ulaw,slin16".  Format names an be found with "core show codecs". */
+	/*! The format name capability list to use if originator is not specified. Ex. "ulaw,slin16".  Format names can be found with "core show codecs". */
 	const char *formats;
 };
 /*!
@@ -34,15 +34,34 @@
 #include "asterisk/channel.h"
 #include "asterisk/message.h"
 
-void ast_ari_endpoints_list(struct ast_variable *headers,
-	struct ast_ari_endpoints_list_args *args,
-	struct ast_ari_response *response)
+/*! \brief Fields always listed for an endpoint */
+static const char * const endpoint_key_fields[] = { "technology", "resource", NULL };
+
+/*! \brief Convert a listed endpoint snapshot to JSON */
+static struct ast_json *endpoint_list_item_to_json(void *obj)
+{
+	return ast_endpoint_snapshot_to_json(obj, stasis_app_get_sanitizer());
+}
+
+/*!
+ * \brief Fill in \a response with one page of the cached endpoints.
+ *
+ * \param response Response to fill in.
+ * \param tech Technology of the endpoints listed, or \c NULL for all of them.
+ * \param state State of the endpoints listed, or \c NULL for all of them.
+ * \param after Id the page starts after.
+ * \param limit Most endpoints listed, or 0 for all of them.
+ * \param fields Fields listed of each endpoint.
+ * \param fields_count Length of \a fields.
+ */
+static void endpoints_list_page(struct ast_ari_response *response,
+	const char *tech, const char *state, const char *after, int limit,
+	const char **fields, size_t fields_count)
 {
 	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
-	struct ao2_iterator i;
-	void *obj;
+	RAII_VAR(struct stasis_cache_snapshots *, snapshots, NULL, ao2_cleanup);
+	struct ast_ari_list_items items;
+	size_t idx;
 
 	cache = ast_endpoint_cache();
 	if (!cache) {
@@ -53,45 +72,58 @@ void ast_ari_endpoints_list(struct ast_variable *headers,
 	}
 	ao2_ref(cache, +1);
 
-	snapshots = stasis_cache_dump(cache, ast_endpoint_snapshot_type());
+	snapshots = stasis_cache_snapshots(cache, ast_endpoint_snapshot_type());
 	if (!snapshots) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	json = ast_json_array_create();
-	if (!json) {
+	if (AST_VECTOR_INIT(&items, stasis_cache_snapshots_count(snapshots))) {
 		ast_ari_response_alloc_failed(response);
 		return;
 	}
 
-	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_endpoint_snapshot *snapshot = stasis_message_data(msg);
-		struct ast_json *json_endpoint = ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
+	/* The shared snapshots are kept alive until the page is built. */
+	for (idx = 0; idx < stasis_cache_snapshots_count(snapshots); ++idx) {
+		struct ast_endpoint_snapshot *snapshot = stasis_message_data(
+			stasis_cache_snapshots_get(snapshots, idx));
+		struct ast_ari_list_item item = {
+			.id = snapshot->id,
+			.obj = snapshot,
+		};
+
+		if ((tech && strcasecmp(tech, snapshot->tech))
+			|| (!ast_strlen_zero(state)
+				&& strcmp(ast_endpoint_state_to_string(snapshot->state), state))) {
+			continue;
+		}
 
-		if (!json_endpoint || ast_json_array_append(json, json_endpoint)) {
-			ao2_iterator_destroy(&i);
+		if (AST_VECTOR_APPEND(&items, item)) {
+			AST_VECTOR_FREE(&items);
 			ast_ari_response_alloc_failed(response);
 			return;
 		}
 	}
-	ao2_iterator_destroy(&i);
 
-	ast_ari_response_ok(response, ast_json_ref(json));
+	ast_ari_response_list_page(response, &items, after, limit,
+		fields, fields_count, endpoint_key_fields,
+		endpoint_list_item_to_json);
+	AST_VECTOR_FREE(&items);
+}
+
+void ast_ari_endpoints_list(struct ast_variable *headers,
+	struct ast_ari_endpoints_list_args *args,
+	struct ast_ari_response *response)
+{
+	endpoints_list_page(response, NULL, args->state, args->after, args->limit,
+		args->fields, args->fields_count);
 }
 
 void ast_ari_endpoints_list_by_tech(struct ast_variable *headers,
 	struct ast_ari_endpoints_list_by_tech_args *args,
 	struct ast_ari_response *response)
 {
-	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
-	RAII_VAR(struct ao2_container *, snapshots, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
 	struct ast_endpoint *tech_endpoint;
-	struct ao2_iterator i;
-	void *obj;
 
 	tech_endpoint = ast_endpoint_find_by_id(args->tech);
 	if (!tech_endpoint) {
@@ -101,53 +133,8 @@ void ast_ari_endpoints_list_by_tech(struct ast_variable *headers,
 	}
 	ao2_ref(tech_endpoint, -1);
 
-	cache = ast_endpoint_cache();
-	if (!cache) {
-		ast_ari_response_error(
-			response, 500, "Internal Server Error",
-			"Message bus not initialized");
-		return;
-	}
-	ao2_ref(cache, +1);
-
-	snapshots = stasis_cache_dump(cache, ast_endpoint_snapshot_type());
-	if (!snapshots) {
-		ast_ari_response_alloc_failed(response);
-		return;
-	}
-
-	json = ast_json_array_create();
-	if (!json) {
-		ast_ari_response_alloc_failed(response);
-		return;
-	}
-
-	i = ao2_iterator_init(snapshots, 0);
-	while ((obj = ao2_iterator_next(&i))) {
-		RAII_VAR(struct stasis_message *, msg, obj, ao2_cleanup);
-		struct ast_endpoint_snapshot *snapshot = stasis_message_data(msg);
-		struct ast_json *json_endpoint;
-		int r;
-
-		if (strcasecmp(args->tech, snapshot->tech) != 0) {
-			continue;
-		}
-
-		json_endpoint = ast_endpoint_snapshot_to_json(snapshot, stasis_app_get_sanitizer());
-		if (!json_endpoint) {
-			continue;
-		}
-
-		r = ast_json_array_append(
-			json, json_endpoint);
-		if (r != 0) {
-			ao2_iterator_destroy(&i);
-			ast_ari_response_alloc_failed(response);
-			return;
-		}
-	}
-	ao2_iterator_destroy(&i);
-	ast_ari_response_ok(response, ast_json_ref(json));
+	endpoints_list_page(response, args->tech, args->state, args->after, args->limit,
+		args->fields, args->fields_count);
 }
 
 void ast_ari_endpoints_get(struct ast_variable *headers,
@@ -41,10 +41,35 @@
 
 /*! Argument struct for ast_ari_endpoints_list() */
 struct ast_ari_endpoints_list_args {
+	/*! Only list endpoints whose technology/resource sorts after this one. To get the next page, pass the technology/resource of the last endpoint of the previous page. */
+	const char *after;
+	/*! Most endpoints to list, or 0 to list all of them. */
+	int limit;
+	/*! Array of Fields of each endpoint to list, or all of them if not given. The technology and resource are always listed. */
+	const char **fields;
+	/*! Length of fields array. */
+	size_t fields_count;
+	/*! Parsing context for fields. */
+	char *fields_parse;
+	/*! Only list endpoints in this state. */
+	const char *state;
 };
+/*!
+ * \brief Body parsing function for /endpoints.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_endpoints_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_endpoints_list_args *args);
+
 /*!
  * \brief List all endpoints.
  *
+ * Endpoints are listed in order of their technology and resource. The list can be read a page at a time with the after and limit parameters.
+ *
  * \param headers HTTP headers
  * \param args Swagger parameters
  * \param[out] response HTTP response
@@ -83,7 +108,30 @@ void ast_ari_endpoints_send_message(struct ast_variable *headers, struct ast_ari
 struct ast_ari_endpoints_list_by_tech_args {
 	/*! Technology of the endpoints (sip,iax2,...) */
 	const char *tech;
+	/*! Only list endpoints whose technology/resource sorts after this one. To get the next page, pass the technology/resource of the last endpoint of the previous page. */
+	const char *after;
+	/*! Most endpoints to list, or 0 to list all of them. */
+	int limit;
+	/*! Array of Fields of each endpoint to list, or all of them if not given. The technology and resource are always listed. */
+	const char **fields;
+	/*! Length of fields array. */
+	size_t fields_count;
+	/*! Parsing context for fields. */
+	char *fields_parse;
+	/*! Only list endpoints in this state. */
+	const char *state;
 };
+/*!
+ * \brief Body parsing function for /endpoints/{tech}.
+ * \param body The JSON body from which to parse parameters.
+ * \param[out] args The args structure to parse into.
+ * \retval zero on success
+ * \retval non-zero on failure
+ */
+int ast_ari_endpoints_list_by_tech_parse_body(
+	struct ast_json *body,
+	struct ast_ari_endpoints_list_by_tech_args *args);
+
 /*!
  * \brief List available endoints for a given endpoint technology.
  *
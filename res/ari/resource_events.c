@@ -57,6 +57,9 @@ enum event_session_error_type {
 	ERROR_TYPE_MISSING_APP_PARAM = 3,    /*!< HTTP request was missing an [app] parameter. */
 	ERROR_TYPE_INVALID_APP_PARAM = 4,    /*!< HTTP request contained an invalid [app]
 	                                          parameter. */
+	ERROR_TYPE_INVALID_EVENT_FILTER = 5, /*!< HTTP request contained an invalid
+	                                          [allowedEvents] or [disallowedEvents]
+	                                          parameter. */
 };
 
 /*! \brief Local registry for created \ref event_session objects. */
@@ -340,6 +343,11 @@ static int event_session_allocation_error_handler(
 			"Invalid application provided in param [app].");
 		break;
 
+	case ERROR_TYPE_INVALID_EVENT_FILTER:
+		ast_http_error(ser, 400, "Bad Request",
+			"Invalid event type provided in param [allowedEvents] or [disallowedEvents].");
+		break;
+
 	default:
 		break;
 	}
@@ -349,6 +357,32 @@ static int event_session_allocation_error_handler(
 	return -1;
 }
 
+/*!
+ * \brief Makes a list of event types for an event filter.
+ *
+ * \internal
+ *
+ * \param types  The event types.
+ * \param count  The number of event types.
+ *
+ * \retval The list, as stasis_app_event_filter_set() takes it.
+ * \retval NULL on failure.
+ */
+static struct ast_json *event_filter_list(const char **types, size_t count)
+{
+	struct ast_json *list = ast_json_array_create();
+	size_t i;
+
+	for (i = 0; list && i < count; ++i) {
+		if (ast_json_array_append(list, ast_json_pack("{s: s}", "type", types[i]))) {
+			ast_json_unref(list);
+			list = NULL;
+		}
+	}
+
+	return list;
+}
+
 /*!
  * \brief Creates an \ref event_session object and registers its apps with Stasis.
  *
@@ -367,6 +401,7 @@ static int event_session_alloc(struct ast_tcptls_session_instance *ser,
 		struct ast_ari_events_event_websocket_args *args, const char *session_id)
 {
 	RAII_VAR(struct event_session *, session, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_json *, filter, NULL, ast_json_unref);
 	int (* register_handler)(const char *, stasis_app_cb handler, void *data);
 	size_t size, i;
 
@@ -399,6 +434,16 @@ static int event_session_alloc(struct ast_tcptls_session_instance *ser,
 		return event_session_allocation_error_handler(session, ERROR_TYPE_OOM, ser);
 	}
 
+	/* Events the apps are sent, if given */
+	if (args->allowed_events_count || args->disallowed_events_count) {
+		filter = ast_json_pack("{s: o, s: o}",
+			"allowed", event_filter_list(args->allowed_events, args->allowed_events_count),
+			"disallowed", event_filter_list(args->disallowed_events, args->disallowed_events_count));
+		if (!filter) {
+			return event_session_allocation_error_handler(session, ERROR_TYPE_OOM, ser);
+		}
+	}
+
 	/* Register the apps with Stasis */
 	if (args->subscribe_all) {
 		register_handler = &stasis_app_register_all;
@@ -423,6 +468,18 @@ static int event_session_alloc(struct ast_tcptls_session_instance *ser,
 			return event_session_allocation_error_handler(
 				session, ERROR_TYPE_STASIS_REGISTRATION, ser);			
 		}
+
+		if (filter) {
+			switch (stasis_app_event_filter_set(app, filter, NULL)) {
+			case STASIS_AEF_OK:
+				break;
+			case STASIS_AEF_INVALID:
+				return event_session_allocation_error_handler(
+					session, ERROR_TYPE_INVALID_EVENT_FILTER, ser);
+			default:
+				return event_session_allocation_error_handler(session, ERROR_TYPE_OOM, ser);
+			}
+		}
 	}
 
 	/* Add the event session to the local registry */
@@ -49,6 +49,18 @@ struct ast_ari_events_event_websocket_args {
 	char *app_parse;
 	/*! Subscribe to all Asterisk events. If provided, the applications listed will be subscribed to all events, effectively disabling the application specific subscriptions. Default is 'false'. */
 	int subscribe_all;
+	/*! Array of Event types to send to the applications, such as ChannelVarset. If given, only these are sent. Replaces the event filter of the applications, as set by POST /applications/{applicationName}/eventFilter, when either this or disallowedEvents is given. */
+	const char **allowed_events;
+	/*! Length of allowed_events array. */
+	size_t allowed_events_count;
+	/*! Parsing context for allowed_events. */
+	char *allowed_events_parse;
+	/*! Array of Event types not to send to the applications. */
+	const char **disallowed_events;
+	/*! Length of disallowed_events array. */
+	size_t disallowed_events_count;
+	/*! Parsing context for disallowed_events. */
+	char *disallowed_events_parse;
 };
 
 /*!
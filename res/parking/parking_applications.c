@@ -953,6 +953,8 @@ static int park_and_announce_app_exec(struct ast_channel *chan, const char *data
 		park_announce_subscription_data_destroy(pa_data);
 		return -1;
 	}
+	stasis_subscription_accept_message_type(parking_subscription, ast_parked_call_type());
+	stasis_subscription_set_filter(parking_subscription, STASIS_SUBSCRIPTION_FILTER_SELECTIVE);
 
 	/* Now for the fun part... park it! */
 	ast_bridge_join(parking_bridge, chan, NULL, &chan_features, NULL, 0);
@@ -182,6 +182,7 @@ static struct parked_user *generate_parked_user(struct parking_lot *lot, struct
 
 	/* Insert into the parking lot's parked user list. We can unlock the lot now. */
 	ao2_link(lot->parked_users, new_parked_user);
+	parking_lot_space_take(lot, new_parked_user);
 	ao2_unlock(lot);
 
 	return new_parked_user;
@@ -82,10 +82,119 @@ struct parking_limits_pvt {
 	struct parked_user *user;
 };
 
+/*! \brief Bits in each word of the bitmap of spaces taken */
+#define SPACES_WORD_BITS (sizeof(unsigned long) * 8)
+
+int parking_lot_spaces_rebuild(struct parking_lot *lot)
+{
+	int count = lot->cfg->parking_stop - lot->cfg->parking_start + 1;
+	struct ao2_iterator iter;
+	struct parked_user *user;
+
+	ast_free(lot->spaces);
+	ast_free(lot->spaces_used);
+	lot->spaces = NULL;
+	lot->spaces_used = NULL;
+	lot->spaces_count = 0;
+	lot->spaces_start = lot->cfg->parking_start;
+
+	if (count <= 0) {
+		return 0;
+	}
+
+	lot->spaces = ast_calloc(count, sizeof(*lot->spaces));
+	lot->spaces_used = ast_calloc((count + SPACES_WORD_BITS - 1) / SPACES_WORD_BITS, sizeof(*lot->spaces_used));
+	if (!lot->spaces || !lot->spaces_used) {
+		ast_free(lot->spaces);
+		ast_free(lot->spaces_used);
+		lot->spaces = NULL;
+		lot->spaces_used = NULL;
+		return -1;
+	}
+	lot->spaces_count = count;
+
+	iter = ao2_iterator_init(lot->parked_users, 0);
+	for (; (user = ao2_iterator_next(&iter)); ao2_ref(user, -1)) {
+		parking_lot_space_take(lot, user);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return 0;
+}
+
+void parking_lot_space_take(struct parking_lot *lot, struct parked_user *user)
+{
+	int index = user->parking_space - lot->spaces_start;
+
+	if (index < 0 || index >= lot->spaces_count) {
+		return;
+	}
+
+	lot->spaces[index] = user;
+	lot->spaces_used[index / SPACES_WORD_BITS] |= 1UL << (index % SPACES_WORD_BITS);
+}
+
+/*!
+ * \internal
+ * \brief Mark the space of a parked user as free, if it still has it.
+ *
+ * \note lot must be locked.
+ */
+static void parking_lot_space_release(struct parking_lot *lot, struct parked_user *user)
+{
+	int index = user->parking_space - lot->spaces_start;
+
+	if (index < 0 || index >= lot->spaces_count || lot->spaces[index] != user) {
+		return;
+	}
+
+	lot->spaces[index] = NULL;
+	lot->spaces_used[index / SPACES_WORD_BITS] &= ~(1UL << (index % SPACES_WORD_BITS));
+}
+
+/*!
+ * \internal
+ * \brief Find the first free space from one index of the spaces of a lot up to another.
+ *
+ * \return index of the free space
+ * \retval -1 if all spaces from first up to but not including last are taken
+ */
+static int parking_lot_spaces_next_free(struct parking_lot *lot, int first, int last)
+{
+	unsigned long free_bits;
+	int index = first;
+	int found;
+
+	while (index < last) {
+		free_bits = ~lot->spaces_used[index / SPACES_WORD_BITS] >> (index % SPACES_WORD_BITS);
+		if (!free_bits) {
+			/* Skip the rest of a word with every space taken */
+			index += SPACES_WORD_BITS - index % SPACES_WORD_BITS;
+			continue;
+		}
+		found = index + __builtin_ctzl(free_bits);
+		return found < last ? found : -1;
+	}
+
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Unlink a parked user from its parking lot and free its space.
+ */
+static void parking_lot_unlink_parked_user(struct parking_lot *lot, struct parked_user *user)
+{
+	ao2_lock(lot);
+	ao2_unlink(lot->parked_users, user);
+	parking_lot_space_release(lot, user);
+	ao2_unlock(lot);
+}
+
 int unpark_parked_user(struct parked_user *pu)
 {
 	if (pu->lot) {
-		ao2_unlink(pu->lot->parked_users, pu);
+		parking_lot_unlink_parked_user(pu->lot, pu);
 		parking_lot_remove_if_unused(pu->lot);
 		return 0;
 	}
@@ -96,10 +205,11 @@ int unpark_parked_user(struct parked_user *pu)
 int parking_lot_get_space(struct parking_lot *lot, int target_override)
 {
 	int original_target;
-	int current_target;
-	struct ao2_iterator i;
-	struct parked_user *user;
-	int wrap;
+	int index;
+
+	if (!lot->spaces_count) {
+		return -1;
+	}
 
 	if (lot->cfg->parkfindnext) {
 		/* Use next_space if the lot already has next_space set; otherwise use lot start. */
@@ -112,44 +222,18 @@ int parking_lot_get_space(struct parking_lot *lot, int target_override)
 		original_target = target_override;
 	}
 
-	current_target = original_target;
-
-	wrap = lot->cfg->parking_start;
-
-	i = ao2_iterator_init(lot->parked_users, 0);
-	while ((user = ao2_iterator_next(&i))) {
-		/* Increment the wrap on each pass until we find an empty space */
-		if (wrap == user->parking_space) {
-			wrap += 1;
-		}
-
-		if (user->parking_space < current_target) {
-			/* It's lower than the anticipated target, so we haven't reached the target yet. */
-			ao2_ref(user, -1);
-			continue;
-		}
-
-		if (user->parking_space > current_target) {
-			/* The current target is usable because all items below have been read and the next target is higher than the one we want. */
-			ao2_ref(user, -1);
-			break;
-		}
-
-		/* We found one already parked here. */
-		current_target += 1;
-		ao2_ref(user, -1);
+	index = original_target - lot->spaces_start;
+	if (index < 0 || index >= lot->spaces_count) {
+		index = 0;
 	}
-	ao2_iterator_destroy(&i);
 
-	if (current_target <= lot->cfg->parking_stop) {
-		return current_target;
-	}
-
-	if (wrap <= lot->cfg->parking_stop) {
-		return wrap;
+	/* Take the first free space from the target on, or else the first free space of the lot. */
+	if ((original_target = parking_lot_spaces_next_free(lot, index, lot->spaces_count)) < 0
+		&& (original_target = parking_lot_spaces_next_free(lot, 0, index)) < 0) {
+		return -1;
 	}
 
-	return -1;
+	return lot->spaces_start + original_target;
 }
 
 static int retrieve_parked_user_targeted(void *obj, void *arg, int flags)
@@ -163,6 +247,31 @@ static int retrieve_parked_user_targeted(void *obj, void *arg, int flags)
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Find the parked user in a parking space of a lot.
+ *
+ * \return A reference to the parked user
+ * \retval NULL if nobody is parked there
+ */
+static struct parked_user *parking_lot_find_parked_user(struct parking_lot *lot, int target)
+{
+	struct parked_user *user;
+	int index;
+
+	ao2_lock(lot);
+	index = target - lot->spaces_start;
+	if (index >= 0 && index < lot->spaces_count) {
+		user = ao2_bump(lot->spaces[index]);
+		ao2_unlock(lot);
+		return user;
+	}
+	ao2_unlock(lot);
+
+	/* Users parked before the lot was reconfigured may be outside its spaces */
+	return ao2_callback(lot->parked_users, 0, retrieve_parked_user_targeted, &target);
+}
+
 struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, int target)
 {
 	RAII_VAR(struct parked_user *, user, NULL, ao2_cleanup);
@@ -170,7 +279,7 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 	if (target < 0) {
 		user = ao2_callback(lot->parked_users, 0, NULL, NULL);
 	} else {
-		user = ao2_callback(lot->parked_users, 0, retrieve_parked_user_targeted, &target);
+		user = parking_lot_find_parked_user(lot, target);
 	}
 
 	if (!user) {
@@ -184,7 +293,7 @@ struct parked_user *parking_lot_retrieve_parked_user(struct parking_lot *lot, in
 		return NULL;
 	}
 
-	ao2_unlink(lot->parked_users, user);
+	parking_lot_unlink_parked_user(lot, user);
 	user->resolution = PARK_ANSWERED;
 	ao2_unlock(user);
 
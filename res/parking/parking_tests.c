@@ -521,6 +521,115 @@ static int check_retrieve_call_extensions(struct ast_test *test, int expected)
 
 }
 
+/*!
+ * \internal
+ * \brief Take the next space of a test lot with a parked user that has no channel.
+ *
+ * \return The space taken
+ * \retval -1 if the lot is full or on failure
+ */
+static int take_test_space(struct parking_lot *test_lot)
+{
+	struct parked_user *user;
+	int space;
+
+	user = ao2_alloc(sizeof(*user), NULL);
+	if (!user) {
+		return -1;
+	}
+
+	ao2_lock(test_lot);
+	space = parking_lot_get_space(test_lot, -1);
+	if (space != -1) {
+		test_lot->next_space = space + 1;
+		user->parking_space = space;
+		user->lot = test_lot;
+		ao2_link(test_lot->parked_users, user);
+		parking_lot_space_take(test_lot, user);
+	}
+	ao2_unlock(test_lot);
+	ao2_ref(user, -1);
+
+	return space;
+}
+
+AST_TEST_DEFINE(park_spaces)
+{
+	RAII_VAR(struct parking_lot *, test_lot, NULL, ao2_cleanup);
+	struct parked_user *user;
+	int space;
+	int res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "park_spaces";
+		info->category = TEST_CATEGORY;
+		info->summary = "Parking space allocation";
+		info->description =
+			"Fills a parking lot, frees some of its spaces and checks that the next\n"
+			"space after the last one taken is found, wrapping around the lot.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* More spaces than fit in one word of the bitmap */
+	test_lot = generate_test_parking_lot(TEST_LOT_NAME, 701, 770, NULL, "unit_test_res_parking_create_lot_con", test);
+	if (!test_lot) {
+		ast_test_status_update(test, "Failed to create test parking lot. Test failed.\n");
+		return AST_TEST_FAIL;
+	}
+
+	for (space = 701; space <= 770; space++) {
+		if (take_test_space(test_lot) != space) {
+			ast_test_status_update(test, "Failed to take space %d in an emptying lot.\n", space);
+			res = AST_TEST_FAIL;
+			goto test_cleanup;
+		}
+	}
+
+	if (take_test_space(test_lot) != -1) {
+		ast_test_status_update(test, "Took a space in a full lot.\n");
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+
+	ao2_cleanup(parking_lot_retrieve_parked_user(test_lot, 705));
+	ao2_cleanup(parking_lot_retrieve_parked_user(test_lot, 766));
+	user = parking_lot_retrieve_parked_user(test_lot, 766);
+	if (user) {
+		ast_test_status_update(test, "Retrieved space 766 twice.\n");
+		ao2_ref(user, -1);
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+
+	/* Next fit past a word of taken spaces, then wrap around to the start */
+	test_lot->next_space = 720;
+	if ((space = take_test_space(test_lot)) != 766) {
+		ast_test_status_update(test, "Expected space 766 after 720, got %d.\n", space);
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+	if ((space = take_test_space(test_lot)) != 705) {
+		ast_test_status_update(test, "Expected space 705 after wrapping, got %d.\n", space);
+		res = AST_TEST_FAIL;
+		goto test_cleanup;
+	}
+
+test_cleanup:
+	while ((user = parking_lot_retrieve_parked_user(test_lot, -1))) {
+		ao2_ref(user, -1);
+	}
+
+	if (dispose_test_lot(test_lot, 1)) {
+		ast_test_status_update(test, "Found parking lot in container after attempted removal. Test failed.\n");
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 AST_TEST_DEFINE(park_extensions)
 {
 	RAII_VAR(struct parking_lot *, test_lot, NULL, ao2_cleanup);
@@ -842,6 +951,7 @@ void unload_parking_tests(void)
 	AST_TEST_UNREGISTER(create_lot);
 	AST_TEST_UNREGISTER(park_call);
 	AST_TEST_UNREGISTER(retrieve_call);
+	AST_TEST_UNREGISTER(park_spaces);
 	AST_TEST_UNREGISTER(park_extensions);
 	AST_TEST_UNREGISTER(extension_conflicts);
 	AST_TEST_UNREGISTER(dynamic_parking_variables);
@@ -857,6 +967,7 @@ int load_parking_tests(void)
 	res |= AST_TEST_REGISTER(create_lot);
 	res |= AST_TEST_REGISTER(park_call);
 	res |= AST_TEST_REGISTER(retrieve_call);
+	res |= AST_TEST_REGISTER(park_spaces);
 	res |= AST_TEST_REGISTER(park_extensions);
 	res |= AST_TEST_REGISTER(extension_conflicts);
 	res |= AST_TEST_REGISTER(dynamic_parking_variables);
@@ -93,6 +93,10 @@ struct parking_lot {
 	struct parking_lot_cfg *cfg;              /*!< Reference to configuration object for the parking lot */
 	enum parking_lot_modes mode;              /*!< Whether a parking lot is operational, being reconfigured, primed for deletion, or dynamically created. */
 	int disable_mark;                         /*!< On reload, disable this parking lot if it doesn't receive a new configuration. */
+	int spaces_start;                         /*!< First parking space in spaces, protected by the lot lock */
+	int spaces_count;                         /*!< How many parking spaces are in spaces, protected by the lot lock */
+	struct parked_user **spaces;              /*!< The parked user in each space from spaces_start, protected by the lot lock */
+	unsigned long *spaces_used;               /*!< Bitmap of the spaces taken in spaces, protected by the lot lock */
 
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(name);               /*!< Name of the parking lot object */
@@ -195,6 +199,31 @@ struct ast_bridge *parking_lot_get_bridge(struct parking_lot *lot);
  */
 int parking_lot_get_space(struct parking_lot *lot, int target_override);
 
+/*!
+ * \since 15.0.0
+ * \brief Index the parked users of a parking lot by the spaces of its current configuration.
+ *
+ * \param lot Parking lot whose configuration was set or changed
+ *
+ * \retval 0 on success
+ * \retval -1 on failure, in which case no space can be taken in the lot
+ *
+ * \note lot must be locked before this is called.  Parked users outside the
+ *       spaces of the configuration are left out of the index.
+ */
+int parking_lot_spaces_rebuild(struct parking_lot *lot);
+
+/*!
+ * \since 15.0.0
+ * \brief Mark the space of a parked user just linked to a parking lot as taken.
+ *
+ * \param lot Parking lot the user was linked to
+ * \param user The parked user
+ *
+ * \note lot must be locked, and kept locked since parking_lot_get_space() was called.
+ */
+void parking_lot_space_take(struct parking_lot *lot, struct parked_user *user);
+
 /*!
  * \since 12.0.0
  * \brief Determine if there is a parked user in a parking space and pull it from the parking lot if there is.
@@ -697,6 +697,22 @@
 			<ref type="application">AGI</ref>
 		</see-also>
 	</agi>
+	<agi name="session end" language="en_US">
+		<synopsis>
+			Ends a FastAGI session and keeps its connection.
+		</synopsis>
+		<syntax />
+		<description>
+			<para>Ends the session and returns control to the dialplan, like closing the
+			connection does, but keeps the connection for another session. The next
+			session on the connection starts with its AGI environment, as a new
+			connection does. Returns <literal>-1</literal> if the session is not on a
+			FastAGI connection.</para>
+		</description>
+		<see-also>
+			<ref type="application">AGI</ref>
+		</see-also>
+	</agi>
 	<agi name="set autohangup" language="en_US">
 		<synopsis>
 			Autohangup channel in some time.
@@ -1130,6 +1146,12 @@
 					example, if you specify the URI <literal>hagi://agi.example.com/foo.agi</literal>
 					the DNS query would be for <literal>_agi._tcp.agi.example.com</literal>. You
 					will need to make sure this resolves correctly.</para>
+					<para>A FastAGI server that ends a session with the <literal>SESSION END</literal>
+					AGI command instead of closing the connection gets the connection back for
+					a later session to the same server, saving a TCP connection per call. A
+					server may also send several commands before reading their responses, which
+					are sent in the same order. Both are announced in the AGI environment by
+					<literal>agi_network_reuse</literal> and <literal>agi_network_pipeline</literal>.</para>
 				</enum>
 				<enum name="AsyncAGI">
 					<para>Use AMI to control the channel in AGI. AGI commands can be invoked
@@ -1376,6 +1398,12 @@ static int agidebug = 0;
 
 #define AGI_PORT 4573
 
+/* Most idle FastAGI connections kept for reuse */
+#define AGI_POOL_MAX_IDLE 64
+
+/* Seconds an idle FastAGI connection is kept for reuse */
+#define AGI_POOL_IDLE_TIMEOUT 30
+
 /*! Special return code for "asyncagi break" command. */
 #define ASYNC_AGI_BREAK	3
 
@@ -1968,6 +1996,196 @@ async_agi_abort:
 #undef AMI_BUF_SIZE
 }
 
+/*!
+ * \brief A FastAGI connection
+ *
+ * Commands are read through its buffer, so that commands a server sends
+ * before reading the responses to earlier ones are not left waiting.
+ */
+struct agi_connection {
+	/*! Socket to the server */
+	int fd;
+	/*! Bytes read but not yet handled */
+	size_t buflen;
+	/*! When it was put in the pool */
+	struct timeval idle;
+	AST_LIST_ENTRY(agi_connection) list;
+	char buf[AGI_BUF_LEN];
+	/*! Server as given in the URL, connections are only reused for the same one */
+	char server[0];
+};
+
+/*! \brief Idle FastAGI connections, oldest first */
+static AST_LIST_HEAD_STATIC(agi_pool, agi_connection);
+
+/*! \brief Number of connections in agi_pool */
+static int agi_pool_idle;
+
+static struct agi_connection *agi_connection_alloc(const char *server, int fd)
+{
+	struct agi_connection *conn;
+
+	if (!(conn = ast_calloc(1, sizeof(*conn) + strlen(server) + 1))) {
+		return NULL;
+	}
+	conn->fd = fd;
+	strcpy(conn->server, server); /* Safe */
+
+	return conn;
+}
+
+static void agi_connection_close(struct agi_connection *conn)
+{
+	close(conn->fd);
+	ast_free(conn);
+}
+
+/*!
+ * \internal
+ * \brief Check that the server of an idle connection has not closed it.
+ *
+ * \note Nothing is expected from an idle connection, so anything to read
+ * means it was closed or can't be trusted.
+ */
+static int agi_connection_idle_ok(struct agi_connection *conn)
+{
+	struct pollfd pfd = { .fd = conn->fd, .events = POLLIN, };
+
+	return ast_poll(&pfd, 1, 0) == 0;
+}
+
+/*!
+ * \internal
+ * \brief Take an idle connection to a server from the pool.
+ *
+ * \return The connection, NULL if there is none.
+ */
+static struct agi_connection *agi_pool_get(const char *server)
+{
+	struct agi_connection *conn;
+	struct timeval now = ast_tvnow();
+
+	AST_LIST_LOCK(&agi_pool);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&agi_pool, conn, list) {
+		if (ast_tvdiff_ms(now, conn->idle) >= AGI_POOL_IDLE_TIMEOUT * 1000
+			|| (!strcasecmp(conn->server, server) && !agi_connection_idle_ok(conn))) {
+			AST_LIST_REMOVE_CURRENT(list);
+			--agi_pool_idle;
+			agi_connection_close(conn);
+			continue;
+		}
+		if (!strcasecmp(conn->server, server)) {
+			AST_LIST_REMOVE_CURRENT(list);
+			--agi_pool_idle;
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+	AST_LIST_UNLOCK(&agi_pool);
+
+	return conn;
+}
+
+/*!
+ * \internal
+ * \brief Done with a connection.
+ *
+ * \param conn The connection.
+ * \param reuse Non-zero if the server ended the session to keep the connection.
+ */
+static void agi_connection_release(struct agi_connection *conn, int reuse)
+{
+	struct agi_connection *oldest = NULL;
+
+	if (!reuse || conn->buflen) {
+		/* Anything left over belongs to no session. */
+		agi_connection_close(conn);
+		return;
+	}
+
+	conn->idle = ast_tvnow();
+	AST_LIST_LOCK(&agi_pool);
+	if (agi_pool_idle >= AGI_POOL_MAX_IDLE) {
+		oldest = AST_LIST_REMOVE_HEAD(&agi_pool, list);
+		--agi_pool_idle;
+	}
+	AST_LIST_INSERT_TAIL(&agi_pool, conn, list);
+	++agi_pool_idle;
+	AST_LIST_UNLOCK(&agi_pool);
+
+	if (oldest) {
+		agi_connection_close(oldest);
+	}
+}
+
+static void agi_pool_destroy(void)
+{
+	struct agi_connection *conn;
+
+	AST_LIST_LOCK(&agi_pool);
+	while ((conn = AST_LIST_REMOVE_HEAD(&agi_pool, list))) {
+		agi_connection_close(conn);
+	}
+	agi_pool_idle = 0;
+	AST_LIST_UNLOCK(&agi_pool);
+}
+
+/*!
+ * \internal
+ * \brief Get the next command line from a connection.
+ *
+ * Reads from the socket only if no whole line is buffered yet.
+ *
+ * \param conn The connection.
+ * \param line Filled with the line and its newline, if any.
+ * \param size Size of \a line.
+ *
+ * \retval 1 A line was read.
+ * \retval 0 The line is not complete yet.
+ * \retval -1 The connection was closed or failed.
+ */
+static int agi_connection_gets(struct agi_connection *conn, char *line, size_t size)
+{
+	char *end;
+	size_t len;
+	ssize_t res;
+	int eof = 0;
+
+	if (!(end = memchr(conn->buf, '\n', conn->buflen)) && conn->buflen < sizeof(conn->buf)) {
+		res = read(conn->fd, conn->buf + conn->buflen, sizeof(conn->buf) - conn->buflen);
+		if (res < 0) {
+			return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+		}
+		if (!res) {
+			if (!conn->buflen) {
+				return -1;
+			}
+			/* The last line was not terminated. */
+			eof = 1;
+		}
+		conn->buflen += res;
+		end = memchr(conn->buf, '\n', conn->buflen);
+	}
+
+	if (end) {
+		len = end - conn->buf + 1;
+	} else if (eof || conn->buflen == sizeof(conn->buf)) {
+		len = conn->buflen;
+	} else {
+		return 0;
+	}
+	if (len > size - 1) {
+		len = size - 1;
+	}
+
+	memcpy(line, conn->buf, len);
+	line[len] = '\0';
+	conn->buflen -= len;
+	memmove(conn->buf, conn->buf + len, conn->buflen);
+
+	return 1;
+}
+
 /*!
  * \internal
  * \brief Handle the connection that was started by launch_netscript.
@@ -2020,7 +2238,7 @@ static int handle_connection(const char *agiurl, const struct ast_sockaddr addr,
 
 /* launch_netscript: The fastagi handler.
 	FastAGI defaults to port 4573 */
-static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
+static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds, struct agi_connection **conn)
 {
 	int s = 0, flags;
 	char *host, *script;
@@ -2037,6 +2255,12 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 		script = "";
 	}
 
+	if ((*conn = agi_pool_get(host))) {
+		s = (*conn)->fd;
+		ast_debug(4, "Reusing FastAGI connection to '%s'\n", host);
+		goto connected;
+	}
+
 	if (!(num_addrs = ast_sockaddr_resolve(&addrs, host, 0, AST_AF_UNSPEC))) {
 		ast_log(LOG_WARNING, "Unable to locate host '%s'\n", host);
 		return AGI_RESULT_FAILURE;
@@ -2086,14 +2310,26 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
 		return AGI_RESULT_FAILURE;
 	}
 
+	if (!(*conn = agi_connection_alloc(host, s))) {
+		close(s);
+		return AGI_RESULT_FAILURE;
+	}
+
+connected:
 	if (ast_agi_send(s, NULL, "agi_network: yes\n") < 0) {
 		if (errno != EINTR) {
 			ast_log(LOG_WARNING, "Connect to '%s' failed: %s\n", agiurl, strerror(errno));
-			close(s);
+			agi_connection_release(*conn, 0);
+			*conn = NULL;
 			return AGI_RESULT_FAILURE;
 		}
 	}
 
+	/* The server may end the session with SESSION END to keep the connection,
+	 * and may send commands before reading the responses to earlier ones. */
+	ast_agi_send(s, NULL, "agi_network_reuse: yes\n");
+	ast_agi_send(s, NULL, "agi_network_pipeline: yes\n");
+
 	/* If we have a script parameter, relay it to the fastagi server */
 	/* Script parameters take the form of: AGI(agi://my.example.com/?extension=${EXTEN}) */
 	if (!ast_strlen_zero(script)) {
@@ -2112,6 +2348,7 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
  * \param agiurl The request URL as passed to Agi() in the dial plan
  * \param argv The parameters after the URL passed to Agi() in the dial plan
  * \param fds Input/output file descriptors
+ * \param conn Set to the connection used
  *
  * Uses SRV lookups to try to connect to a list of FastAGI servers. The hostname in
  * the URI is prefixed with _agi._tcp. prior to the DNS resolution. For
@@ -2125,7 +2362,7 @@ static enum agi_result launch_netscript(char *agiurl, char *argv[], int *fds)
  *
  * \return the result of the AGI operation.
  */
-static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
+static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds, struct agi_connection **conn)
 {
 	char *host, *script;
 	enum agi_result result;
@@ -2152,14 +2389,14 @@ static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
 
 	if (strchr(host, ':')) {
 		ast_log(LOG_WARNING, "Specifying a port number disables SRV lookups: %s\n", agiurl);
-		return launch_netscript(agiurl + 1, argv, fds); /* +1 to strip off leading h from hagi:// */
+		return launch_netscript(agiurl + 1, argv, fds, conn); /* +1 to strip off leading h from hagi:// */
 	}
 
 	snprintf(service, sizeof(service), "%s%s", SRV_PREFIX, host);
 
 	while (!(srv_ret = ast_srv_lookup(&context, service, &srvhost, &srvport))) {
 		snprintf(resolved_uri, sizeof(resolved_uri), "agi://%s:%d/%s", srvhost, srvport, script);
-		result = launch_netscript(resolved_uri, argv, fds);
+		result = launch_netscript(resolved_uri, argv, fds, conn);
 		if (result == AGI_RESULT_FAILURE || result == AGI_RESULT_NOTFOUND) {
 			ast_log(LOG_WARNING, "AGI request failed for host '%s' (%s:%d)\n", host, srvhost, srvport);
 		} else {
@@ -2179,17 +2416,17 @@ static enum agi_result launch_ha_netscript(char *agiurl, char *argv[], int *fds)
 	return AGI_RESULT_FAILURE;
 }
 
-static enum agi_result launch_script(struct ast_channel *chan, char *script, int argc, char *argv[], int *fds, int *efd, int *opid)
+static enum agi_result launch_script(struct ast_channel *chan, char *script, int argc, char *argv[], int *fds, int *efd, int *opid, struct agi_connection **conn)
 {
 	char tmp[256];
 	int pid, toast[2], fromast[2], audio[2], res;
 	struct stat st;
 
 	if (!strncasecmp(script, "agi://", 6)) {
-		return (efd == NULL) ? launch_netscript(script, argv, fds) : AGI_RESULT_FAILURE;
+		return (efd == NULL) ? launch_netscript(script, argv, fds, conn) : AGI_RESULT_FAILURE;
 	}
 	if (!strncasecmp(script, "hagi://", 7)) {
-		return (efd == NULL) ? launch_ha_netscript(script, argv, fds) : AGI_RESULT_FAILURE;
+		return (efd == NULL) ? launch_ha_netscript(script, argv, fds, conn) : AGI_RESULT_FAILURE;
 	}
 	if (!strncasecmp(script, "agi:async", sizeof("agi:async") - 1)) {
 		return launch_asyncagi(chan, argc, argv, efd);
@@ -2362,6 +2599,23 @@ static int handle_asyncagi_break(struct ast_channel *chan, AGI *agi, int argc, c
 	return ASYNC_AGI_BREAK;
 }
 
+static int handle_sessionend(struct ast_channel *chan, AGI *agi, int argc, const char * const argv[])
+{
+	if (argc != 2) {
+		return RESULT_SHOWUSAGE;
+	}
+
+	if (!agi->fast) {
+		/* Only a FastAGI connection outlives its session. */
+		ast_agi_send(agi->fd, chan, "200 result=-1\n");
+		return RESULT_SUCCESS;
+	}
+
+	agi->ended = 1;
+	ast_agi_send(agi->fd, chan, "200 result=0\n");
+	return RESULT_SUCCESS;
+}
+
 static int handle_waitfordigit(struct ast_channel *chan, AGI *agi, int argc, const char * const argv[])
 {
 	int res, to;
@@ -3707,6 +3961,7 @@ static struct agi_command commands[] = {
 	{ { "say", "datetime", NULL }, handle_saydatetime, NULL, NULL, 0},
 	{ { "send", "image", NULL }, handle_sendimage, NULL, NULL, 0},
 	{ { "send", "text", NULL }, handle_sendtext, NULL, NULL, 0},
+	{ { "session", "end", NULL }, handle_sessionend, NULL, NULL, 1 },
 	{ { "set", "autohangup", NULL }, handle_autohangup, NULL, NULL, 0},
 	{ { "set", "callerid", NULL }, handle_setcallerid, NULL, NULL, 0},
 	{ { "set", "context", NULL }, handle_setcontext, NULL, NULL, 0},
@@ -4091,7 +4346,7 @@ static enum agi_result agi_handle_command(struct ast_channel *chan, AGI *agi, ch
 	return AGI_RESULT_SUCCESS;
 }
 
-static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi, int pid, int *status, int dead, int argc, char *argv[])
+static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi, int pid, int *status, int dead, int argc, char *argv[], struct agi_connection *conn)
 {
 	struct ast_channel *c;
 	int outfd;
@@ -4101,7 +4356,7 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 	struct ast_frame *f;
 	char buf[AGI_BUF_LEN];
 	char *res = NULL;
-	FILE *readf;
+	FILE *readf = NULL;
 	/* how many times we'll retry if ast_waitfor_nandfs will return without either
 	  channel or file descriptor in case select is interrupted by a system call (EINTR) */
 	int retry = AGI_NANDFS_RETRY;
@@ -4117,15 +4372,18 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 	exit_on_hangup = ast_true(exit_on_hangup_str);
 	ast_channel_unlock(chan);
 
-	if (!(readf = fdopen(agi->ctrl, "r"))) {
-		ast_log(LOG_WARNING, "Unable to fdopen file descriptor\n");
-		if (send_sighup && pid > -1)
-			kill(pid, SIGHUP);
-		close(agi->ctrl);
-		return AGI_RESULT_FAILURE;
-	}
+	/* FastAGI commands are read through the buffer of the connection. */
+	if (!conn) {
+		if (!(readf = fdopen(agi->ctrl, "r"))) {
+			ast_log(LOG_WARNING, "Unable to fdopen file descriptor\n");
+			if (send_sighup && pid > -1)
+				kill(pid, SIGHUP);
+			close(agi->ctrl);
+			return AGI_RESULT_FAILURE;
+		}
 
-	setlinebuf(readf);
+		setlinebuf(readf);
+	}
 	setup_env(chan, request, agi->fd, (agi->audio > -1), argc, argv);
 	for (;;) {
 		if (needhup) {
@@ -4143,7 +4401,11 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			}
 		}
 		ms = -1;
-		if (dead) {
+		if (conn && memchr(conn->buf, '\n', conn->buflen) && (dead || !ast_check_hangup(chan))) {
+			/* A pipelined command is already buffered. */
+			c = NULL;
+			outfd = agi->ctrl;
+		} else if (dead) {
 			c = ast_waitfor_nandfds(&chan, 0, &agi->ctrl, 1, NULL, &outfd, &ms);
 		} else if (!ast_check_hangup(chan)) {
 			c = ast_waitfor_nandfds(&chan, 1, &agi->ctrl, 1, NULL, &outfd, &ms);
@@ -4181,7 +4443,12 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			retry = AGI_NANDFS_RETRY;
 			buf[0] = '\0';
 
-			while (len > 1) {
+			if (conn && !agi_connection_gets(conn, buf, sizeof(buf))) {
+				/* Wait for the rest of the line. */
+				continue;
+			}
+
+			while (!conn && len > 1) {
 				res = fgets(buf + buflen, len, readf);
 				if (feof(readf))
 					break;
@@ -4232,6 +4499,10 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 			default:
 				break;
 			}
+			if (agi->ended) {
+				ast_verb(3, "<%s>AGI Script %s ended its session, returning %d\n", ast_channel_name(chan), request, returnstatus);
+				break;
+			}
 		} else {
 			if (--retry <= 0) {
 				ast_log(LOG_WARNING, "No channel, no fd?\n");
@@ -4253,11 +4524,13 @@ static enum agi_result run_agi(struct ast_channel *chan, char *request, AGI *agi
 				usleep(1);
 			}
 			waitpid(pid, status, WNOHANG);
-		} else if (agi->fast) {
+		} else if (agi->fast && !agi->ended) {
 			ast_agi_send(agi->fd, chan, "HANGUP\n");
 		}
 	}
-	fclose(readf);
+	if (readf) {
+		fclose(readf);
+	}
 	return returnstatus;
 }
 
@@ -4476,6 +4749,7 @@ static int agi_exec_full(struct ast_channel *chan, const char *data, int enhance
 	enum agi_result res;
 	char *buf;
 	int fds[2], efd = -1, pid = -1;
+	struct agi_connection *conn = NULL;
 	AST_DECLARE_APP_ARGS(args,
 		AST_APP_ARG(arg)[MAX_ARGS];
 	);
@@ -4498,7 +4772,7 @@ static int agi_exec_full(struct ast_channel *chan, const char *data, int enhance
 			return -1;
 	}
 #endif
-	res = launch_script(chan, args.argv[0], args.argc, args.argv, fds, enhanced ? &efd : NULL, &pid);
+	res = launch_script(chan, args.argv[0], args.argc, args.argv, fds, enhanced ? &efd : NULL, &pid, &conn);
 	/* Async AGI do not require run_agi(), so just proceed if normal AGI
 	   or Fast AGI are setup with success. */
 	if (res == AGI_RESULT_SUCCESS || res == AGI_RESULT_SUCCESS_FAST) {
@@ -4507,7 +4781,7 @@ static int agi_exec_full(struct ast_channel *chan, const char *data, int enhance
 		agi.ctrl = fds[0];
 		agi.audio = efd;
 		agi.fast = (res == AGI_RESULT_SUCCESS_FAST) ? 1 : 0;
-		res = run_agi(chan, args.argv[0], &agi, pid, &status, dead, args.argc, args.argv);
+		res = run_agi(chan, args.argv[0], &agi, pid, &status, dead, args.argc, args.argv, conn);
 		/* If the fork'd process returns non-zero, set AGISTATUS to FAILURE */
 		if ((res == AGI_RESULT_SUCCESS || res == AGI_RESULT_SUCCESS_FAST) && status)
 			res = AGI_RESULT_FAILURE;
@@ -4515,6 +4789,9 @@ static int agi_exec_full(struct ast_channel *chan, const char *data, int enhance
 			close(fds[1]);
 		if (efd > -1)
 			close(efd);
+		if (conn) {
+			agi_connection_release(conn, agi.ended && res != AGI_RESULT_FAILURE);
+		}
 	}
 	ast_safe_fork_cleanup();
 
@@ -4640,6 +4917,7 @@ static int unload_module(void)
 	ast_manager_unregister("AGI");
 	ast_unregister_application(app);
 	AST_TEST_UNREGISTER(test_agi_null_docs);
+	agi_pool_destroy();
 	return 0;
 }
 
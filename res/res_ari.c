@@ -106,6 +106,17 @@
 				<configOption name="pretty">
 					<synopsis>Responses from ARI are formatted to be human readable</synopsis>
 				</configOption>
+				<configOption name="validation_sample_rate" default="1">
+					<synopsis>Validate one of every this many outgoing ARI messages</synopsis>
+					<description>
+						<para>Developer mode builds validate outgoing responses and
+						events against the ARI models.  Validation walks the whole
+						message, so on busy systems only one of every this many
+						messages can be validated instead.  Set to 0 to turn
+						validation off.  Builds without developer mode never
+						validate, whatever this is set to.</para>
+					</description>
+				</configOption>
 				<configOption name="auth_realm">
 					<synopsis>Realm to use for authentication. Defaults to Asterisk REST Interface.</synopsis>
 				</configOption>
@@ -302,6 +313,231 @@ void ast_ari_response_alloc_failed(struct ast_ari_response *response)
 	response->response_text = "Internal Server Error";
 }
 
+/*! \brief Pages of lists with more items than this are streamed */
+#define LIST_STREAM_MIN_ITEMS 100
+
+/*! \brief Order list items by id */
+static int list_item_cmp(const void *a, const void *b)
+{
+	const struct ast_ari_list_item *item_a = a;
+	const struct ast_ari_list_item *item_b = b;
+
+	return strcmp(item_a->id, item_b->id);
+}
+
+/*! \brief Copy a field of a listed object, if it has it, to its projection */
+static int list_field_copy(struct ast_json *projection, struct ast_json *object,
+	const char *field)
+{
+	struct ast_json *value = ast_json_object_get(object, field);
+
+	if (!value) {
+		return 0;
+	}
+	return ast_json_object_set(projection, field, ast_json_ref(value));
+}
+
+/*! \brief Make an object of only the requested fields of a listed object */
+static struct ast_json *list_item_project(struct ast_json *object,
+	const char **fields, size_t fields_count, const char * const *key_fields)
+{
+	struct ast_json *projection = ast_json_object_create();
+	size_t i;
+
+	if (!projection) {
+		return NULL;
+	}
+
+	for (; *key_fields; ++key_fields) {
+		if (list_field_copy(projection, object, *key_fields)) {
+			ast_json_unref(projection);
+			return NULL;
+		}
+	}
+	for (i = 0; i < fields_count; ++i) {
+		if (list_field_copy(projection, object, fields[i])) {
+			ast_json_unref(projection);
+			return NULL;
+		}
+	}
+
+	return projection;
+}
+
+/*! \brief Make the JSON of a listed object, with only the requested fields if any */
+static struct ast_json *list_item_to_json(struct ast_ari_list_item *item,
+	const char **fields, size_t fields_count, const char * const *key_fields,
+	struct ast_json *(*to_json)(void *obj), int *failed)
+{
+	struct ast_json *object = to_json(item->obj);
+	struct ast_json *projection;
+
+	*failed = 0;
+	if (!object || !fields_count) {
+		return object;
+	}
+
+	projection = list_item_project(object, fields, fields_count, key_fields);
+	ast_json_unref(object);
+	if (!projection) {
+		*failed = 1;
+	}
+	return projection;
+}
+
+/*! \brief Build a page of a list as a whole */
+static void list_page_build(struct ast_ari_response *response,
+	struct ast_ari_list_items *items, size_t first, int limit,
+	const char **fields, size_t fields_count, const char * const *key_fields,
+	struct ast_json *(*to_json)(void *obj))
+{
+	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	size_t count = AST_VECTOR_SIZE(items);
+	size_t i;
+	int listed = 0;
+	int failed;
+
+	json = ast_json_array_create();
+	if (!json) {
+		ast_ari_response_alloc_failed(response);
+		return;
+	}
+
+	for (i = first; i < count && (!limit || listed < limit); ++i) {
+		struct ast_json *object = list_item_to_json(AST_VECTOR_GET_ADDR(items, i),
+			fields, fields_count, key_fields, to_json, &failed);
+
+		if (failed) {
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+		if (!object) {
+			continue;
+		}
+
+		if (ast_json_array_append(json, object)) {
+			ast_ari_response_alloc_failed(response);
+			return;
+		}
+		++listed;
+	}
+
+	response->projected = fields_count ? 1 : 0;
+	ast_ari_response_ok(response, ast_json_ref(json));
+}
+
+static int list_page_write(const char *buf, size_t len, void *data)
+{
+	return ast_http_chunked_write(data, buf, len);
+}
+
+/*! \brief Send a page of a list as its items are encoded */
+static void list_page_stream(struct ast_ari_response *response,
+	struct ast_ari_list_items *items, size_t first, int limit,
+	const char **fields, size_t fields_count, const char * const *key_fields,
+	struct ast_json *(*to_json)(void *obj))
+{
+	struct ast_http_chunked *chunked;
+	struct ast_json_stream *stream;
+	size_t count = AST_VECTOR_SIZE(items);
+	size_t i;
+	int listed = 0;
+	int failed = 0;
+
+	/* Whatever happens from here on is the response. */
+	response->no_response = 1;
+	ast_str_append(&response->headers, 0, "Content-type: application/json\r\n");
+	chunked = ast_http_chunked_start(response->ser, response->method, 200, "OK",
+		response->headers);
+	response->headers = NULL;
+	if (!chunked) {
+		return;
+	}
+
+	stream = ast_json_stream_create(ast_ari_json_format(), list_page_write, chunked);
+	if (!stream || ast_json_stream_array_start(stream)) {
+		ast_json_stream_free(stream);
+		ast_http_chunked_abort(chunked);
+		return;
+	}
+
+	for (i = first; i < count && (!limit || listed < limit); ++i) {
+		struct ast_json *object = list_item_to_json(AST_VECTOR_GET_ADDR(items, i),
+			fields, fields_count, key_fields, to_json, &failed);
+
+		if (failed) {
+			break;
+		}
+		if (!object) {
+			continue;
+		}
+
+		failed = ast_json_stream_value(stream, object);
+		ast_json_unref(object);
+		if (failed) {
+			break;
+		}
+		++listed;
+	}
+
+	if (failed || ast_json_stream_array_end(stream)) {
+		/* The client has to see that the page is not complete. */
+		ast_json_stream_free(stream);
+		ast_http_chunked_abort(chunked);
+		return;
+	}
+	ast_json_stream_free(stream);
+	ast_http_chunked_end(chunked);
+}
+
+void ast_ari_response_list_page(struct ast_ari_response *response,
+	struct ast_ari_list_items *items, const char *after, int limit,
+	const char **fields, size_t fields_count, const char * const *key_fields,
+	struct ast_json *(*to_json)(void *obj))
+{
+	struct ast_json_arena *arena;
+	size_t count = AST_VECTOR_SIZE(items);
+	size_t first = 0;
+
+	if (limit < 0) {
+		ast_ari_response_error(response, 400, "Bad Request",
+			"Invalid limit provided");
+		return;
+	}
+
+	if (count) {
+		qsort(items->elems, count, sizeof(*items->elems), list_item_cmp);
+	}
+
+	/* The page starts at the first id after the cursor. */
+	if (!ast_strlen_zero(after)) {
+		size_t last = count;
+
+		while (first < last) {
+			size_t middle = first + (last - first) / 2;
+
+			if (strcmp(AST_VECTOR_GET_ADDR(items, middle)->id, after) <= 0) {
+				first = middle + 1;
+			} else {
+				last = middle;
+			}
+		}
+	}
+
+	/* Large pages are sent as they are encoded instead of being built first. */
+	if (response->ser && (limit ? MIN(limit, count - first) : count - first) > LIST_STREAM_MIN_ITEMS) {
+		list_page_stream(response, items, first, limit, fields, fields_count,
+			key_fields, to_json);
+		return;
+	}
+
+	/* The page is only ever released as a whole, once it has been sent. */
+	arena = ast_json_arena_begin();
+	list_page_build(response, items, first, limit, fields, fields_count,
+		key_fields, to_json);
+	ast_json_arena_end(arena);
+}
+
 void ast_ari_response_created(struct ast_ari_response *response,
 	const char *url, struct ast_json *message)
 {
@@ -887,6 +1123,8 @@ static int ast_ari_callback(struct ast_tcptls_session_instance *ser,
 	}
 
 	response.headers = ast_str_create(40);
+	response.ser = ser;
+	response.method = method;
 	if (!response.headers) {
 		ast_http_request_close_on_completion(ser);
 		ast_http_error(ser, 500, "Server Error", "Out of memory");
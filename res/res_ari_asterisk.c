@@ -84,6 +84,10 @@ static void ast_ari_asterisk_get_object_cb(
 	}
 	ast_ari_asterisk_get_object(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -173,6 +177,10 @@ static void ast_ari_asterisk_update_object_cb(
 	args.fields = body;
 	ast_ari_asterisk_update_object(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -240,6 +248,10 @@ static void ast_ari_asterisk_delete_object_cb(
 	}
 	ast_ari_asterisk_delete_object(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -397,6 +409,10 @@ static void ast_ari_asterisk_get_info_cb(
 	}
 	ast_ari_asterisk_get_info(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -450,6 +466,10 @@ static void ast_ari_asterisk_list_modules_cb(
 
 	ast_ari_asterisk_list_modules(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -508,6 +528,10 @@ static void ast_ari_asterisk_get_module_cb(
 	}
 	ast_ari_asterisk_get_module(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -568,6 +592,10 @@ static void ast_ari_asterisk_load_module_cb(
 	}
 	ast_ari_asterisk_load_module(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -627,6 +655,10 @@ static void ast_ari_asterisk_unload_module_cb(
 	}
 	ast_ari_asterisk_unload_module(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -687,6 +719,10 @@ static void ast_ari_asterisk_reload_module_cb(
 	}
 	ast_ari_asterisk_reload_module(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -740,6 +776,10 @@ static void ast_ari_asterisk_list_log_channels_cb(
 
 	ast_ari_asterisk_list_log_channels(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -836,6 +876,10 @@ static void ast_ari_asterisk_add_log_cb(
 	}
 	ast_ari_asterisk_add_log(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -896,6 +940,10 @@ static void ast_ari_asterisk_delete_log_cb(
 	}
 	ast_ari_asterisk_delete_log(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -955,6 +1003,10 @@ static void ast_ari_asterisk_rotate_log_cb(
 	}
 	ast_ari_asterisk_rotate_log(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1046,6 +1098,10 @@ static void ast_ari_asterisk_get_global_var_cb(
 	}
 	ast_ari_asterisk_get_global_var(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1144,6 +1200,10 @@ static void ast_ari_asterisk_set_global_var_cb(
 	}
 	ast_ari_asterisk_set_global_var(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
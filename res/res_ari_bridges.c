@@ -50,6 +50,60 @@
 
 #define MAX_VALS 128
 
+int ast_ari_bridges_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_bridges_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "after");
+	if (field) {
+		args->after = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "limit");
+	if (field) {
+		args->limit = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "fields");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->fields);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->fields_count = ast_json_array_size(field);
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+
+			if (!args->fields) {
+				return -1;
+			}
+
+			for (i = 0; i < args->fields_count; ++i) {
+				args->fields[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->fields_count = 1;
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+			if (!args->fields) {
+				return -1;
+			}
+			args->fields[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "technology");
+	if (field) {
+		args->technology = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "type");
+	if (field) {
+		args->type = ast_json_string_get(field);
+	}
+	return 0;
+}
+
 /*!
  * \brief Parameter parsing callback for /bridges.
  * \param get_params GET parameters in the HTTP request.
@@ -63,14 +117,96 @@ static void ast_ari_bridges_list_cb(
 	struct ast_variable *headers, struct ast_ari_response *response)
 {
 	struct ast_ari_bridges_list_args args = {};
+	struct ast_variable *i;
 	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
 #if defined(AST_DEVMODE)
 	int is_valid;
 	int code;
 #endif /* AST_DEVMODE */
 
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "after") == 0) {
+			args.after = (i->value);
+		} else
+		if (strcmp(i->name, "limit") == 0) {
+			args.limit = atoi(i->value);
+		} else
+		if (strcmp(i->name, "fields") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.fields_parse = ast_strdup(i->value);
+			if (!args.fields_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.fields_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.fields_count = 1;
+				vals[0] = args.fields_parse;
+			} else {
+				args.fields_count = ast_app_separate_args(
+					args.fields_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.fields_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.fields_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for fields");
+				goto fin;
+			}
+
+			args.fields = ast_malloc(sizeof(*args.fields) * args.fields_count);
+			if (!args.fields) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.fields_count; ++j) {
+				args.fields[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "technology") == 0) {
+			args.technology = (i->value);
+		} else
+		if (strcmp(i->name, "type") == 0) {
+			args.type = (i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_bridges_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
 	ast_ari_bridges_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -79,6 +215,7 @@ static void ast_ari_bridges_list_cb(
 		break;
 	case 500: /* Internal Server Error */
 	case 501: /* Not Implemented */
+	case 400: /* Invalid limit provided */
 		is_valid = 1;
 		break;
 	default:
@@ -99,6 +236,8 @@ static void ast_ari_bridges_list_cb(
 #endif /* AST_DEVMODE */
 
 fin: __attribute__((unused))
+	ast_free(args.fields_parse);
+	ast_free(args.fields);
 	return;
 }
 int ast_ari_bridges_create_parse_body(
@@ -175,6 +314,10 @@ static void ast_ari_bridges_create_cb(
 	}
 	ast_ari_bridges_create(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -278,6 +421,10 @@ static void ast_ari_bridges_create_with_id_cb(
 	}
 	ast_ari_bridges_create_with_id(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -336,6 +483,10 @@ static void ast_ari_bridges_get_cb(
 	}
 	ast_ari_bridges_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -395,6 +546,10 @@ static void ast_ari_bridges_destroy_cb(
 	}
 	ast_ari_bridges_destroy(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -564,6 +719,10 @@ static void ast_ari_bridges_add_channel_cb(
 	}
 	ast_ari_bridges_add_channel(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -731,6 +890,10 @@ static void ast_ari_bridges_remove_channel_cb(
 	}
 	ast_ari_bridges_remove_channel(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -798,6 +961,10 @@ static void ast_ari_bridges_set_video_source_cb(
 	}
 	ast_ari_bridges_set_video_source(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -859,6 +1026,10 @@ static void ast_ari_bridges_clear_video_source_cb(
 	}
 	ast_ari_bridges_clear_video_source(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -956,6 +1127,10 @@ static void ast_ari_bridges_start_moh_cb(
 	}
 	ast_ari_bridges_start_moh(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1016,6 +1191,10 @@ static void ast_ari_bridges_stop_moh_cb(
 	}
 	ast_ari_bridges_stop_moh(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1207,6 +1386,10 @@ static void ast_ari_bridges_play_cb(
 	}
 	ast_ari_bridges_play(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1396,6 +1579,10 @@ static void ast_ari_bridges_play_with_id_cb(
 	}
 	ast_ari_bridges_play_with_id(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1538,6 +1725,10 @@ static void ast_ari_bridges_record_cb(
 	}
 	ast_ari_bridges_record(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -50,6 +50,64 @@
 
 #define MAX_VALS 128
 
+int ast_ari_channels_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "after");
+	if (field) {
+		args->after = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "limit");
+	if (field) {
+		args->limit = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "fields");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->fields);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->fields_count = ast_json_array_size(field);
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+
+			if (!args->fields) {
+				return -1;
+			}
+
+			for (i = 0; i < args->fields_count; ++i) {
+				args->fields[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->fields_count = 1;
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+			if (!args->fields) {
+				return -1;
+			}
+			args->fields[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "state");
+	if (field) {
+		args->state = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "technology");
+	if (field) {
+		args->technology = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "app");
+	if (field) {
+		args->app = ast_json_string_get(field);
+	}
+	return 0;
+}
+
 /*!
  * \brief Parameter parsing callback for /channels.
  * \param get_params GET parameters in the HTTP request.
@@ -63,14 +121,99 @@ static void ast_ari_channels_list_cb(
 	struct ast_variable *headers, struct ast_ari_response *response)
 {
 	struct ast_ari_channels_list_args args = {};
+	struct ast_variable *i;
 	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
 #if defined(AST_DEVMODE)
 	int is_valid;
 	int code;
 #endif /* AST_DEVMODE */
 
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "after") == 0) {
+			args.after = (i->value);
+		} else
+		if (strcmp(i->name, "limit") == 0) {
+			args.limit = atoi(i->value);
+		} else
+		if (strcmp(i->name, "fields") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.fields_parse = ast_strdup(i->value);
+			if (!args.fields_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.fields_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.fields_count = 1;
+				vals[0] = args.fields_parse;
+			} else {
+				args.fields_count = ast_app_separate_args(
+					args.fields_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.fields_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.fields_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for fields");
+				goto fin;
+			}
+
+			args.fields = ast_malloc(sizeof(*args.fields) * args.fields_count);
+			if (!args.fields) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.fields_count; ++j) {
+				args.fields[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "state") == 0) {
+			args.state = (i->value);
+		} else
+		if (strcmp(i->name, "technology") == 0) {
+			args.technology = (i->value);
+		} else
+		if (strcmp(i->name, "app") == 0) {
+			args.app = (i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_channels_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
 	ast_ari_channels_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -79,6 +222,7 @@ static void ast_ari_channels_list_cb(
 		break;
 	case 500: /* Internal Server Error */
 	case 501: /* Not Implemented */
+	case 400: /* Invalid limit provided */
 		is_valid = 1;
 		break;
 	default:
@@ -99,6 +243,178 @@ static void ast_ari_channels_list_cb(
 #endif /* AST_DEVMODE */
 
 fin: __attribute__((unused))
+	ast_free(args.fields_parse);
+	ast_free(args.fields);
+	return;
+}
+int ast_ari_channels_hangup_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_hangup_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "channelIds");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->channel_ids);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->channel_ids_count = ast_json_array_size(field);
+			args->channel_ids = ast_malloc(sizeof(*args->channel_ids) * args->channel_ids_count);
+
+			if (!args->channel_ids) {
+				return -1;
+			}
+
+			for (i = 0; i < args->channel_ids_count; ++i) {
+				args->channel_ids[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->channel_ids_count = 1;
+			args->channel_ids = ast_malloc(sizeof(*args->channel_ids) * args->channel_ids_count);
+			if (!args->channel_ids) {
+				return -1;
+			}
+			args->channel_ids[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "reason");
+	if (field) {
+		args->reason = ast_json_string_get(field);
+	}
+	return 0;
+}
+
+/*!
+ * \brief Parameter parsing callback for /channels.
+ * \param get_params GET parameters in the HTTP request.
+ * \param path_vars Path variables extracted from the request.
+ * \param headers HTTP headers.
+ * \param[out] response Response to the HTTP request.
+ */
+static void ast_ari_channels_hangup_list_cb(
+	struct ast_tcptls_session_instance *ser,
+	struct ast_variable *get_params, struct ast_variable *path_vars,
+	struct ast_variable *headers, struct ast_ari_response *response)
+{
+	struct ast_ari_channels_hangup_list_args args = {};
+	struct ast_variable *i;
+	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
+#if defined(AST_DEVMODE)
+	int is_valid;
+	int code;
+#endif /* AST_DEVMODE */
+
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "channelIds") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.channel_ids_parse = ast_strdup(i->value);
+			if (!args.channel_ids_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.channel_ids_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.channel_ids_count = 1;
+				vals[0] = args.channel_ids_parse;
+			} else {
+				args.channel_ids_count = ast_app_separate_args(
+					args.channel_ids_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.channel_ids_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.channel_ids_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for channel_ids");
+				goto fin;
+			}
+
+			args.channel_ids = ast_malloc(sizeof(*args.channel_ids) * args.channel_ids_count);
+			if (!args.channel_ids) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.channel_ids_count; ++j) {
+				args.channel_ids[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "reason") == 0) {
+			args.reason = (i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_channels_hangup_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
+	ast_ari_channels_hangup_list(headers, &args, response);
+#if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
+	code = response->response_code;
+
+	switch (code) {
+	case 0: /* Implementation is still a stub, or the code wasn't set */
+		is_valid = response->message == NULL;
+		break;
+	case 500: /* Internal Server Error */
+	case 501: /* Not Implemented */
+	case 400: /* Invalid reason for hangup provided */
+	case 404: /* None of the channels found */
+		is_valid = 1;
+		break;
+	default:
+		if (200 <= code && code <= 299) {
+			is_valid = ast_ari_validate_void(
+				response->message);
+		} else {
+			ast_log(LOG_ERROR, "Invalid error response %d for /channels\n", code);
+			is_valid = 0;
+		}
+	}
+
+	if (!is_valid) {
+		ast_log(LOG_ERROR, "Response validation failed for /channels\n");
+		ast_ari_response_error(response, 500,
+			"Internal Server Error", "Response validation failed");
+	}
+#endif /* AST_DEVMODE */
+
+fin: __attribute__((unused))
+	ast_free(args.channel_ids_parse);
+	ast_free(args.channel_ids);
 	return;
 }
 int ast_ari_channels_originate_parse_body(
@@ -242,6 +558,10 @@ static void ast_ari_channels_originate_cb(
 	args.variables = body;
 	ast_ari_channels_originate(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -376,6 +696,10 @@ static void ast_ari_channels_create_cb(
 	}
 	ast_ari_channels_create(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -407,6 +731,177 @@ static void ast_ari_channels_create_cb(
 fin: __attribute__((unused))
 	return;
 }
+int ast_ari_channels_redirect_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_channels_redirect_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "channelIds");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->channel_ids);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->channel_ids_count = ast_json_array_size(field);
+			args->channel_ids = ast_malloc(sizeof(*args->channel_ids) * args->channel_ids_count);
+
+			if (!args->channel_ids) {
+				return -1;
+			}
+
+			for (i = 0; i < args->channel_ids_count; ++i) {
+				args->channel_ids[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->channel_ids_count = 1;
+			args->channel_ids = ast_malloc(sizeof(*args->channel_ids) * args->channel_ids_count);
+			if (!args->channel_ids) {
+				return -1;
+			}
+			args->channel_ids[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "endpoint");
+	if (field) {
+		args->endpoint = ast_json_string_get(field);
+	}
+	return 0;
+}
+
+/*!
+ * \brief Parameter parsing callback for /channels/redirect.
+ * \param get_params GET parameters in the HTTP request.
+ * \param path_vars Path variables extracted from the request.
+ * \param headers HTTP headers.
+ * \param[out] response Response to the HTTP request.
+ */
+static void ast_ari_channels_redirect_list_cb(
+	struct ast_tcptls_session_instance *ser,
+	struct ast_variable *get_params, struct ast_variable *path_vars,
+	struct ast_variable *headers, struct ast_ari_response *response)
+{
+	struct ast_ari_channels_redirect_list_args args = {};
+	struct ast_variable *i;
+	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
+#if defined(AST_DEVMODE)
+	int is_valid;
+	int code;
+#endif /* AST_DEVMODE */
+
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "channelIds") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.channel_ids_parse = ast_strdup(i->value);
+			if (!args.channel_ids_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.channel_ids_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.channel_ids_count = 1;
+				vals[0] = args.channel_ids_parse;
+			} else {
+				args.channel_ids_count = ast_app_separate_args(
+					args.channel_ids_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.channel_ids_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.channel_ids_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for channel_ids");
+				goto fin;
+			}
+
+			args.channel_ids = ast_malloc(sizeof(*args.channel_ids) * args.channel_ids_count);
+			if (!args.channel_ids) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.channel_ids_count; ++j) {
+				args.channel_ids[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "endpoint") == 0) {
+			args.endpoint = (i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_channels_redirect_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
+	ast_ari_channels_redirect_list(headers, &args, response);
+#if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
+	code = response->response_code;
+
+	switch (code) {
+	case 0: /* Implementation is still a stub, or the code wasn't set */
+		is_valid = response->message == NULL;
+		break;
+	case 500: /* Internal Server Error */
+	case 501: /* Not Implemented */
+	case 400: /* Endpoint parameter not provided */
+	case 404: /* None of the channels found */
+	case 422: /* Endpoint does not name a resource */
+		is_valid = 1;
+		break;
+	default:
+		if (200 <= code && code <= 299) {
+			is_valid = ast_ari_validate_void(
+				response->message);
+		} else {
+			ast_log(LOG_ERROR, "Invalid error response %d for /channels/redirect\n", code);
+			is_valid = 0;
+		}
+	}
+
+	if (!is_valid) {
+		ast_log(LOG_ERROR, "Response validation failed for /channels/redirect\n");
+		ast_ari_response_error(response, 500,
+			"Internal Server Error", "Response validation failed");
+	}
+#endif /* AST_DEVMODE */
+
+fin: __attribute__((unused))
+	ast_free(args.channel_ids_parse);
+	ast_free(args.channel_ids);
+	return;
+}
 /*!
  * \brief Parameter parsing callback for /channels/{channelId}.
  * \param get_params GET parameters in the HTTP request.
@@ -435,6 +930,10 @@ static void ast_ari_channels_get_cb(
 	}
 	ast_ari_channels_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -606,6 +1105,10 @@ static void ast_ari_channels_originate_with_id_cb(
 	args.variables = body;
 	ast_ari_channels_originate_with_id(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -704,6 +1207,10 @@ static void ast_ari_channels_hangup_cb(
 	}
 	ast_ari_channels_hangup(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -823,6 +1330,10 @@ static void ast_ari_channels_continue_in_dialplan_cb(
 	}
 	ast_ari_channels_continue_in_dialplan(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -922,6 +1433,10 @@ static void ast_ari_channels_redirect_cb(
 	}
 	ast_ari_channels_redirect(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -985,6 +1500,10 @@ static void ast_ari_channels_answer_cb(
 	}
 	ast_ari_channels_answer(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1046,6 +1565,10 @@ static void ast_ari_channels_ring_cb(
 	}
 	ast_ari_channels_ring(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1107,6 +1630,10 @@ static void ast_ari_channels_ring_stop_cb(
 	}
 	ast_ari_channels_ring_stop(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1234,6 +1761,10 @@ static void ast_ari_channels_send_dtmf_cb(
 	}
 	ast_ari_channels_send_dtmf(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1334,6 +1865,10 @@ static void ast_ari_channels_mute_cb(
 	}
 	ast_ari_channels_mute(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1433,6 +1968,10 @@ static void ast_ari_channels_unmute_cb(
 	}
 	ast_ari_channels_unmute(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1494,6 +2033,10 @@ static void ast_ari_channels_hold_cb(
 	}
 	ast_ari_channels_hold(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1555,6 +2098,10 @@ static void ast_ari_channels_unhold_cb(
 	}
 	ast_ari_channels_unhold(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1654,6 +2201,10 @@ static void ast_ari_channels_start_moh_cb(
 	}
 	ast_ari_channels_start_moh(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1715,6 +2266,10 @@ static void ast_ari_channels_stop_moh_cb(
 	}
 	ast_ari_channels_stop_moh(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1776,6 +2331,10 @@ static void ast_ari_channels_start_silence_cb(
 	}
 	ast_ari_channels_start_silence(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -1837,6 +2396,10 @@ static void ast_ari_channels_stop_silence_cb(
 	}
 	ast_ari_channels_stop_silence(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2029,6 +2592,10 @@ static void ast_ari_channels_play_cb(
 	}
 	ast_ari_channels_play(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2219,6 +2786,10 @@ static void ast_ari_channels_play_with_id_cb(
 	}
 	ast_ari_channels_play_with_id(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2362,6 +2933,10 @@ static void ast_ari_channels_record_cb(
 	}
 	ast_ari_channels_record(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2462,6 +3037,10 @@ static void ast_ari_channels_get_channel_var_cb(
 	}
 	ast_ari_channels_get_channel_var(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2568,6 +3147,10 @@ static void ast_ari_channels_set_channel_var_cb(
 	}
 	ast_ari_channels_set_channel_var(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2695,6 +3278,10 @@ static void ast_ari_channels_snoop_channel_cb(
 	}
 	ast_ari_channels_snoop_channel(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2817,6 +3404,10 @@ static void ast_ari_channels_snoop_channel_with_id_cb(
 	}
 	ast_ari_channels_snoop_channel_with_id(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2922,6 +3513,10 @@ static void ast_ari_channels_dial_cb(
 	}
 	ast_ari_channels_dial(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -2965,6 +3560,15 @@ static struct stasis_rest_handlers channels_create = {
 	.children = {  }
 };
 /*! \brief REST handler for /api-docs/channels.json */
+static struct stasis_rest_handlers channels_redirect = {
+	.path_segment = "redirect",
+	.callbacks = {
+		[AST_HTTP_POST] = ast_ari_channels_redirect_list_cb,
+	},
+	.num_children = 0,
+	.children = {  }
+};
+/*! \brief REST handler for /api-docs/channels.json */
 static struct stasis_rest_handlers channels_channelId_continue = {
 	.path_segment = "continue",
 	.callbacks = {
@@ -3133,10 +3737,11 @@ static struct stasis_rest_handlers channels = {
 	.path_segment = "channels",
 	.callbacks = {
 		[AST_HTTP_GET] = ast_ari_channels_list_cb,
+		[AST_HTTP_DELETE] = ast_ari_channels_hangup_list_cb,
 		[AST_HTTP_POST] = ast_ari_channels_originate_cb,
 	},
-	.num_children = 2,
-	.children = { &channels_create,&channels_channelId, }
+	.num_children = 3,
+	.children = { &channels_create,&channels_redirect,&channels_channelId, }
 };
 
 static int load_module(void)
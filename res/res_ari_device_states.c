@@ -71,6 +71,10 @@ static void ast_ari_device_states_list_cb(
 
 	ast_ari_device_states_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -129,6 +133,10 @@ static void ast_ari_device_states_get_cb(
 	}
 	ast_ari_device_states_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -225,6 +233,10 @@ static void ast_ari_device_states_update_cb(
 	}
 	ast_ari_device_states_update(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -285,6 +297,10 @@ static void ast_ari_device_states_delete_cb(
 	}
 	ast_ari_device_states_delete(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
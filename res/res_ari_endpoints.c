@@ -50,6 +50,56 @@
 
 #define MAX_VALS 128
 
+int ast_ari_endpoints_list_parse_body(
+	struct ast_json *body,
+	struct ast_ari_endpoints_list_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "after");
+	if (field) {
+		args->after = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "limit");
+	if (field) {
+		args->limit = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "fields");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->fields);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->fields_count = ast_json_array_size(field);
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+
+			if (!args->fields) {
+				return -1;
+			}
+
+			for (i = 0; i < args->fields_count; ++i) {
+				args->fields[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->fields_count = 1;
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+			if (!args->fields) {
+				return -1;
+			}
+			args->fields[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "state");
+	if (field) {
+		args->state = ast_json_string_get(field);
+	}
+	return 0;
+}
+
 /*!
  * \brief Parameter parsing callback for /endpoints.
  * \param get_params GET parameters in the HTTP request.
@@ -63,14 +113,93 @@ static void ast_ari_endpoints_list_cb(
 	struct ast_variable *headers, struct ast_ari_response *response)
 {
 	struct ast_ari_endpoints_list_args args = {};
+	struct ast_variable *i;
 	RAII_VAR(struct ast_json *, body, NULL, ast_json_unref);
 #if defined(AST_DEVMODE)
 	int is_valid;
 	int code;
 #endif /* AST_DEVMODE */
 
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "after") == 0) {
+			args.after = (i->value);
+		} else
+		if (strcmp(i->name, "limit") == 0) {
+			args.limit = atoi(i->value);
+		} else
+		if (strcmp(i->name, "fields") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.fields_parse = ast_strdup(i->value);
+			if (!args.fields_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.fields_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.fields_count = 1;
+				vals[0] = args.fields_parse;
+			} else {
+				args.fields_count = ast_app_separate_args(
+					args.fields_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.fields_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.fields_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for fields");
+				goto fin;
+			}
+
+			args.fields = ast_malloc(sizeof(*args.fields) * args.fields_count);
+			if (!args.fields) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.fields_count; ++j) {
+				args.fields[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "state") == 0) {
+			args.state = (i->value);
+		} else
+		{}
+	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_endpoints_list_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
 	ast_ari_endpoints_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -79,6 +208,7 @@ static void ast_ari_endpoints_list_cb(
 		break;
 	case 500: /* Internal Server Error */
 	case 501: /* Not Implemented */
+	case 400: /* Invalid limit provided */
 		is_valid = 1;
 		break;
 	default:
@@ -99,6 +229,8 @@ static void ast_ari_endpoints_list_cb(
 #endif /* AST_DEVMODE */
 
 fin: __attribute__((unused))
+	ast_free(args.fields_parse);
+	ast_free(args.fields);
 	return;
 }
 int ast_ari_endpoints_send_message_parse_body(
@@ -172,6 +304,10 @@ static void ast_ari_endpoints_send_message_cb(
 	args.variables = body;
 	ast_ari_endpoints_send_message(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -204,6 +340,56 @@ static void ast_ari_endpoints_send_message_cb(
 fin: __attribute__((unused))
 	return;
 }
+int ast_ari_endpoints_list_by_tech_parse_body(
+	struct ast_json *body,
+	struct ast_ari_endpoints_list_by_tech_args *args)
+{
+	struct ast_json *field;
+	/* Parse query parameters out of it */
+	field = ast_json_object_get(body, "after");
+	if (field) {
+		args->after = ast_json_string_get(field);
+	}
+	field = ast_json_object_get(body, "limit");
+	if (field) {
+		args->limit = ast_json_integer_get(field);
+	}
+	field = ast_json_object_get(body, "fields");
+	if (field) {
+		/* If they were silly enough to both pass in a query param and a
+		 * JSON body, free up the query value.
+		 */
+		ast_free(args->fields);
+		if (ast_json_typeof(field) == AST_JSON_ARRAY) {
+			/* Multiple param passed as array */
+			size_t i;
+			args->fields_count = ast_json_array_size(field);
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+
+			if (!args->fields) {
+				return -1;
+			}
+
+			for (i = 0; i < args->fields_count; ++i) {
+				args->fields[i] = ast_json_string_get(ast_json_array_get(field, i));
+			}
+		} else {
+			/* Multiple param passed as single value */
+			args->fields_count = 1;
+			args->fields = ast_malloc(sizeof(*args->fields) * args->fields_count);
+			if (!args->fields) {
+				return -1;
+			}
+			args->fields[0] = ast_json_string_get(field);
+		}
+	}
+	field = ast_json_object_get(body, "state");
+	if (field) {
+		args->state = ast_json_string_get(field);
+	}
+	return 0;
+}
+
 /*!
  * \brief Parameter parsing callback for /endpoints/{tech}.
  * \param get_params GET parameters in the HTTP request.
@@ -224,14 +410,92 @@ static void ast_ari_endpoints_list_by_tech_cb(
 	int code;
 #endif /* AST_DEVMODE */
 
+	for (i = get_params; i; i = i->next) {
+		if (strcmp(i->name, "after") == 0) {
+			args.after = (i->value);
+		} else
+		if (strcmp(i->name, "limit") == 0) {
+			args.limit = atoi(i->value);
+		} else
+		if (strcmp(i->name, "fields") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.fields_parse = ast_strdup(i->value);
+			if (!args.fields_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.fields_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.fields_count = 1;
+				vals[0] = args.fields_parse;
+			} else {
+				args.fields_count = ast_app_separate_args(
+					args.fields_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.fields_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.fields_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for fields");
+				goto fin;
+			}
+
+			args.fields = ast_malloc(sizeof(*args.fields) * args.fields_count);
+			if (!args.fields) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.fields_count; ++j) {
+				args.fields[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "state") == 0) {
+			args.state = (i->value);
+		} else
+		{}
+	}
 	for (i = path_vars; i; i = i->next) {
 		if (strcmp(i->name, "tech") == 0) {
 			args.tech = (i->value);
 		} else
 		{}
 	}
+	/* Look for a JSON request entity */
+	body = ast_http_get_json(ser, headers);
+	if (!body) {
+		switch (errno) {
+		case EFBIG:
+			ast_ari_response_error(response, 413, "Request Entity Too Large", "Request body too large");
+			goto fin;
+		case ENOMEM:
+			ast_ari_response_error(response, 500, "Internal Server Error", "Error processing request");
+			goto fin;
+		case EIO:
+			ast_ari_response_error(response, 400, "Bad Request", "Error parsing request body");
+			goto fin;
+		}
+	}
+	if (ast_ari_endpoints_list_by_tech_parse_body(body, &args)) {
+		ast_ari_response_alloc_failed(response);
+		goto fin;
+	}
 	ast_ari_endpoints_list_by_tech(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -240,6 +504,7 @@ static void ast_ari_endpoints_list_by_tech_cb(
 		break;
 	case 500: /* Internal Server Error */
 	case 501: /* Not Implemented */
+	case 400: /* Invalid limit provided */
 	case 404: /* Endpoints not found */
 		is_valid = 1;
 		break;
@@ -261,6 +526,8 @@ static void ast_ari_endpoints_list_by_tech_cb(
 #endif /* AST_DEVMODE */
 
 fin: __attribute__((unused))
+	ast_free(args.fields_parse);
+	ast_free(args.fields);
 	return;
 }
 /*!
@@ -294,6 +561,10 @@ static void ast_ari_endpoints_get_cb(
 	}
 	ast_ari_endpoints_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -399,6 +670,10 @@ static void ast_ari_endpoints_send_message_to_endpoint_cb(
 	args.variables = body;
 	ast_ari_endpoints_send_message_to_endpoint(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
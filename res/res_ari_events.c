@@ -112,6 +112,92 @@ static int ast_ari_events_event_websocket_ws_attempted_cb(struct ast_tcptls_sess
 		if (strcmp(i->name, "subscribeAll") == 0) {
 			args.subscribe_all = ast_true(i->value);
 		} else
+		if (strcmp(i->name, "allowedEvents") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.allowed_events_parse = ast_strdup(i->value);
+			if (!args.allowed_events_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.allowed_events_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.allowed_events_count = 1;
+				vals[0] = args.allowed_events_parse;
+			} else {
+				args.allowed_events_count = ast_app_separate_args(
+					args.allowed_events_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.allowed_events_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.allowed_events_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for allowed_events");
+				goto fin;
+			}
+
+			args.allowed_events = ast_malloc(sizeof(*args.allowed_events) * args.allowed_events_count);
+			if (!args.allowed_events) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.allowed_events_count; ++j) {
+				args.allowed_events[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "disallowedEvents") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.disallowed_events_parse = ast_strdup(i->value);
+			if (!args.disallowed_events_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.disallowed_events_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.disallowed_events_count = 1;
+				vals[0] = args.disallowed_events_parse;
+			} else {
+				args.disallowed_events_count = ast_app_separate_args(
+					args.disallowed_events_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.disallowed_events_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.disallowed_events_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for disallowed_events");
+				goto fin;
+			}
+
+			args.disallowed_events = ast_malloc(sizeof(*args.disallowed_events) * args.disallowed_events_count);
+			if (!args.disallowed_events) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.disallowed_events_count; ++j) {
+				args.disallowed_events[j] = (vals[j]);
+			}
+		} else
 		{}
 	}
 
@@ -137,6 +223,10 @@ fin: __attribute__((unused))
 	}
 	ast_free(args.app_parse);
 	ast_free(args.app);
+	ast_free(args.allowed_events_parse);
+	ast_free(args.allowed_events);
+	ast_free(args.disallowed_events_parse);
+	ast_free(args.disallowed_events);
 	return res;
 }
 
@@ -213,6 +303,92 @@ static void ast_ari_events_event_websocket_ws_established_cb(struct ast_websocke
 		if (strcmp(i->name, "subscribeAll") == 0) {
 			args.subscribe_all = ast_true(i->value);
 		} else
+		if (strcmp(i->name, "allowedEvents") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.allowed_events_parse = ast_strdup(i->value);
+			if (!args.allowed_events_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.allowed_events_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.allowed_events_count = 1;
+				vals[0] = args.allowed_events_parse;
+			} else {
+				args.allowed_events_count = ast_app_separate_args(
+					args.allowed_events_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.allowed_events_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.allowed_events_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for allowed_events");
+				goto fin;
+			}
+
+			args.allowed_events = ast_malloc(sizeof(*args.allowed_events) * args.allowed_events_count);
+			if (!args.allowed_events) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.allowed_events_count; ++j) {
+				args.allowed_events[j] = (vals[j]);
+			}
+		} else
+		if (strcmp(i->name, "disallowedEvents") == 0) {
+			/* Parse comma separated list */
+			char *vals[MAX_VALS];
+			size_t j;
+
+			args.disallowed_events_parse = ast_strdup(i->value);
+			if (!args.disallowed_events_parse) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (strlen(args.disallowed_events_parse) == 0) {
+				/* ast_app_separate_args can't handle "" */
+				args.disallowed_events_count = 1;
+				vals[0] = args.disallowed_events_parse;
+			} else {
+				args.disallowed_events_count = ast_app_separate_args(
+					args.disallowed_events_parse, ',', vals,
+					ARRAY_LEN(vals));
+			}
+
+			if (args.disallowed_events_count == 0) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			if (args.disallowed_events_count >= MAX_VALS) {
+				ast_ari_response_error(response, 400,
+					"Bad Request",
+					"Too many values for disallowed_events");
+				goto fin;
+			}
+
+			args.disallowed_events = ast_malloc(sizeof(*args.disallowed_events) * args.disallowed_events_count);
+			if (!args.disallowed_events) {
+				ast_ari_response_alloc_failed(response);
+				goto fin;
+			}
+
+			for (j = 0; j < args.disallowed_events_count; ++j) {
+				args.disallowed_events[j] = (vals[j]);
+			}
+		} else
 		{}
 	}
 
@@ -234,6 +410,10 @@ fin: __attribute__((unused))
 	}
 	ast_free(args.app_parse);
 	ast_free(args.app);
+	ast_free(args.allowed_events_parse);
+	ast_free(args.allowed_events);
+	ast_free(args.disallowed_events_parse);
+	ast_free(args.disallowed_events);
 }
 int ast_ari_events_user_event_parse_body(
 	struct ast_json *body,
@@ -370,6 +550,10 @@ static void ast_ari_events_user_event_cb(
 	args.variables = body;
 	ast_ari_events_user_event(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -71,6 +71,10 @@ static void ast_ari_mailboxes_list_cb(
 
 	ast_ari_mailboxes_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -129,6 +133,10 @@ static void ast_ari_mailboxes_get_cb(
 	}
 	ast_ari_mailboxes_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -233,6 +241,10 @@ static void ast_ari_mailboxes_update_cb(
 	}
 	ast_ari_mailboxes_update(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -292,6 +304,10 @@ static void ast_ari_mailboxes_delete_cb(
 	}
 	ast_ari_mailboxes_delete(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -78,6 +78,10 @@ static void ast_ari_playbacks_get_cb(
 	}
 	ast_ari_playbacks_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -137,6 +141,10 @@ static void ast_ari_playbacks_stop_cb(
 	}
 	ast_ari_playbacks_stop(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -234,6 +242,10 @@ static void ast_ari_playbacks_control_cb(
 	}
 	ast_ari_playbacks_control(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
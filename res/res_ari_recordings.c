@@ -71,6 +71,10 @@ static void ast_ari_recordings_list_stored_cb(
 
 	ast_ari_recordings_list_stored(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -129,6 +133,10 @@ static void ast_ari_recordings_get_stored_cb(
 	}
 	ast_ari_recordings_get_stored(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -188,6 +196,10 @@ static void ast_ari_recordings_delete_stored_cb(
 	}
 	ast_ari_recordings_delete_stored(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -247,6 +259,10 @@ static void ast_ari_recordings_get_stored_file_cb(
 	}
 	ast_ari_recordings_get_stored_file(ser, headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -345,6 +361,10 @@ static void ast_ari_recordings_copy_stored_cb(
 	}
 	ast_ari_recordings_copy_stored(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -405,6 +425,10 @@ static void ast_ari_recordings_get_live_cb(
 	}
 	ast_ari_recordings_get_live(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -464,6 +488,10 @@ static void ast_ari_recordings_cancel_cb(
 	}
 	ast_ari_recordings_cancel(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -523,6 +551,10 @@ static void ast_ari_recordings_stop_cb(
 	}
 	ast_ari_recordings_stop(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -582,6 +614,10 @@ static void ast_ari_recordings_pause_cb(
 	}
 	ast_ari_recordings_pause(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -642,6 +678,10 @@ static void ast_ari_recordings_unpause_cb(
 	}
 	ast_ari_recordings_unpause(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -702,6 +742,10 @@ static void ast_ari_recordings_mute_cb(
 	}
 	ast_ari_recordings_mute(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -762,6 +806,10 @@ static void ast_ari_recordings_unmute_cb(
 	}
 	ast_ari_recordings_unmute(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -117,6 +117,10 @@ static void ast_ari_sounds_list_cb(
 	}
 	ast_ari_sounds_list(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
@@ -175,6 +179,10 @@ static void ast_ari_sounds_get_cb(
 	}
 	ast_ari_sounds_get(headers, &args, response);
 #if defined(AST_DEVMODE)
+	if (response->projected || !ast_ari_validate_sample()) {
+		goto fin;
+	}
+
 	code = response->response_code;
 
 	switch (code) {
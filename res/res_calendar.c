@@ -217,7 +217,11 @@
 	</function>
 
 ***/
-#define CALENDAR_BUCKETS 19
+#define CALENDAR_BUCKETS 563
+#define CALENDAR_EVENT_BUCKETS 127
+
+/*! Most calendars fetched from their servers at once by default */
+#define DEFAULT_MAX_FETCHES 8
 
 static struct ao2_container *calendars;
 static struct ast_sched_context *sched;
@@ -227,6 +231,15 @@ static ast_cond_t refresh_condition;
 static ast_mutex_t reloadlock;
 static int module_unloading;
 
+/*! Protects fetches_running */
+AST_MUTEX_DEFINE_STATIC(fetch_lock);
+/*! Signalled when a fetch is done */
+static ast_cond_t fetch_cond;
+/*! Calendars being fetched now */
+static int fetches_running;
+/*! Most calendars fetched at once, from maxfetches */
+static int max_fetches = DEFAULT_MAX_FETCHES;
+
 static void event_notification_destroy(void *data);
 static void *event_notification_duplicate(void *data);
 static void eventlist_destroy(void *data);
@@ -412,8 +425,9 @@ static struct ast_calendar *build_calendar(struct ast_config *cfg, const char *c
 			ast_log(LOG_ERROR, "Could not allocate calendar structure. Stopping.\n");
 			return NULL;
 		}
+		cal->devstate_sched = -1;
 
-		if (!(cal->events = ao2_container_alloc(CALENDAR_BUCKETS, event_hash_fn, event_cmp_fn))) {
+		if (!(cal->events = ao2_container_alloc(CALENDAR_EVENT_BUCKETS, event_hash_fn, event_cmp_fn))) {
 			ast_log(LOG_ERROR, "Could not allocate events container for %s\n", cat);
 			cal = unref_calendar(cal);
 			return NULL;
@@ -677,7 +691,35 @@ struct ast_calendar_event *ast_calendar_event_alloc(struct ast_calendar *cal)
 
 struct ao2_container *ast_calendar_event_container_alloc(void)
 {
-	return ao2_container_alloc(CALENDAR_BUCKETS, event_hash_fn, event_cmp_fn);
+	return ao2_container_alloc(CALENDAR_EVENT_BUCKETS, event_hash_fn, event_cmp_fn);
+}
+
+int ast_calendar_fetch_begin(struct ast_calendar *cal)
+{
+	struct timespec ts = {0,};
+
+	ast_mutex_lock(&fetch_lock);
+	while (fetches_running >= max_fetches) {
+		/* Look for the calendar being unloaded every second */
+		ts.tv_sec = ast_tvnow().tv_sec + 1;
+		ast_cond_timedwait(&fetch_cond, &fetch_lock, &ts);
+		if (cal->unloading) {
+			ast_mutex_unlock(&fetch_lock);
+			return -1;
+		}
+	}
+	++fetches_running;
+	ast_mutex_unlock(&fetch_lock);
+
+	return 0;
+}
+
+void ast_calendar_fetch_end(void)
+{
+	ast_mutex_lock(&fetch_lock);
+	--fetches_running;
+	ast_cond_signal(&fetch_cond);
+	ast_mutex_unlock(&fetch_lock);
 }
 
 static void event_notification_destroy(void *data)
@@ -877,6 +919,40 @@ static int calendar_event_notify(const void *data)
 	return res;
 }
 
+/*!
+ * \internal
+ * \brief Publish the device state of a calendar, once for all its events changing at once.
+ *
+ * \note Only called by the scheduler.
+ */
+static int calendar_devstate_publish(const void *data)
+{
+	struct ast_calendar *cal = (struct ast_calendar *) data;
+
+	cal->devstate_sched = -1;
+
+	/* We can have overlapping events, so ignore the event->busy_state and check busy state
+	 * based on all events in the calendar */
+	if (!calendar_is_busy(cal)) {
+		ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Calendar:%s", cal->name);
+	} else {
+		ast_devstate_changed(AST_DEVICE_BUSY, AST_DEVSTATE_CACHABLE, "Calendar:%s", cal->name);
+	}
+
+	cal = unref_calendar(cal);
+
+	return 0;
+}
+
+static int calendar_devstate_cleanup(const void *data)
+{
+	struct ast_calendar *cal = (struct ast_calendar *) data;
+
+	unref_calendar(cal);
+
+	return 0;
+}
+
 static int calendar_devstate_change(const void *data)
 {
 	struct ast_calendar_event *event = (struct ast_calendar_event *)data;
@@ -898,12 +974,14 @@ static int calendar_devstate_change(const void *data)
 		event->bs_start_sched = -1;
 	}
 
-	/* We can have overlapping events, so ignore the event->busy_state and check busy state
-	 * based on all events in the calendar */
-	if (!calendar_is_busy(event->owner)) {
-		ast_devstate_changed(AST_DEVICE_NOT_INUSE, AST_DEVSTATE_CACHABLE, "Calendar:%s", event->owner->name);
-	} else {
-		ast_devstate_changed(AST_DEVICE_BUSY, AST_DEVSTATE_CACHABLE, "Calendar:%s", event->owner->name);
+	/* Events starting or ending together, such as all those under way when a
+	 * calendar is first loaded, look at the calendar once between them. */
+	if (event->owner->devstate_sched < 0) {
+		ao2_ref(event->owner, +1);
+		event->owner->devstate_sched = ast_sched_add(sched, 1, calendar_devstate_publish, event->owner);
+		if (event->owner->devstate_sched < 0) {
+			calendar_devstate_publish(event->owner);
+		}
 	}
 
 	event = ast_calendar_unref_event(event);
@@ -939,6 +1017,13 @@ static void copy_event_data(struct ast_calendar_event *dst, struct ast_calendar_
 	}
 }
 
+/*!
+ * \internal
+ * \brief Schedule what has changed of an event.
+ *
+ * \retval 1 if anything was scheduled, and the refresh thread must be woken
+ * \retval 0 if nothing changed
+ */
 static int schedule_calendar_event(struct ast_calendar *cal, struct ast_calendar_event *old_event, struct ast_calendar_event *cmp_event)
 {
 	struct timeval now = ast_tvnow();
@@ -949,6 +1034,7 @@ static int schedule_calendar_event(struct ast_calendar *cal, struct ast_calendar
 	event = cmp_event ? cmp_event : old_event;
 
 	ao2_lock(event);
+	ast_mutex_lock(&refreshlock);
 	if (!cmp_event || old_event->alarm != event->alarm) {
 		changed = 1;
 		if (cal->autoreminder) {
@@ -962,9 +1048,7 @@ static int schedule_calendar_event(struct ast_calendar *cal, struct ast_calendar
 			if (alarm_notify_sched <= 0) {
 				alarm_notify_sched = 1;
 			}
-			ast_mutex_lock(&refreshlock);
 			AST_SCHED_REPLACE(old_event->notify_sched, sched, alarm_notify_sched, calendar_event_notify, old_event);
-			ast_mutex_unlock(&refreshlock);
 			ast_debug(3, "Calendar alarm event notification scheduled to happen in %ld ms\n", (long) alarm_notify_sched);
 		}
 	}
@@ -977,34 +1061,35 @@ static int schedule_calendar_event(struct ast_calendar *cal, struct ast_calendar
 			devstate_sched_start = 1;
 		}
 
-		ast_mutex_lock(&refreshlock);
 		AST_SCHED_REPLACE(old_event->bs_start_sched, sched, devstate_sched_start, calendar_devstate_change, old_event);
-		ast_mutex_unlock(&refreshlock);
 		ast_debug(3, "Calendar bs_start event notification scheduled to happen in %ld ms\n", (long) devstate_sched_start);
 	}
 
 	if (!cmp_event || old_event->end != event->end) {
 		changed = 1;
 		devstate_sched_end = (event->end - now.tv_sec) * 1000;
-		ast_mutex_lock(&refreshlock);
 		AST_SCHED_REPLACE(old_event->bs_end_sched, sched, devstate_sched_end, calendar_devstate_change, old_event);
-		ast_mutex_unlock(&refreshlock);
 		ast_debug(3, "Calendar bs_end event notification scheduled to happen in %ld ms\n", (long) devstate_sched_end);
 	}
 
-	if (changed) {
-		ast_cond_signal(&refresh_condition);
-	}
-
+	ast_mutex_unlock(&refreshlock);
 	ao2_unlock(event);
 
-	return 0;
+	return changed;
 }
 
+struct merge_events_state {
+	/*! The events fetched, which are left with only those not known before */
+	struct ao2_container *new_events;
+	/*! Non-zero if any event known before was scheduled again */
+	int changed;
+};
+
 static int merge_events_cb(void *obj, void *arg, int flags)
 {
 	struct ast_calendar_event *old_event = obj, *new_event;
-	struct ao2_container *new_events = arg;
+	struct merge_events_state *state = arg;
+	struct ao2_container *new_events = state->new_events;
 
 	/* If we don't find the old_event in new_events, then we can safely delete the old_event */
 	if (!(new_event = find_event(new_events, old_event->uid))) {
@@ -1014,7 +1099,7 @@ static int merge_events_cb(void *obj, void *arg, int flags)
 
 	/* We have events to merge.  If any data that will affect a scheduler event has changed,
 	 * then we need to replace the scheduler event */
-	schedule_calendar_event(old_event->owner, old_event, new_event);
+	state->changed |= schedule_calendar_event(old_event->owner, old_event, new_event);
 
 	/* Since we don't want to mess with cancelling sched events and adding new ones, just
 	 * copy the internals of the new_event to the old_event */
@@ -1040,13 +1125,27 @@ static int add_new_event_cb(void *obj, void *arg, int flags)
 
 void ast_calendar_merge_events(struct ast_calendar *cal, struct ao2_container *new_events)
 {
+	struct merge_events_state state = {
+		.new_events = new_events,
+	};
+
 	/* Loop through all events attached to the calendar.  If there is a matching new event
 	 * merge its data over and handle any schedule changes that need to be made.  Then remove
 	 * the new_event from new_events so that we are left with only new_events that we can add later. */
-	ao2_callback(cal->events, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, merge_events_cb, new_events);
+	ao2_callback(cal->events, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, merge_events_cb, &state);
 
 	/* Now, we should only have completely new events in new_events.  Loop through and add them */
-	ao2_callback(new_events, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, add_new_event_cb, cal->events);
+	if (ao2_container_count(new_events)) {
+		state.changed = 1;
+		ao2_callback(new_events, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, add_new_event_cb, cal->events);
+	}
+
+	/* Wake the refresh thread once for the whole calendar rather than for every event */
+	if (state.changed) {
+		ast_mutex_lock(&refreshlock);
+		ast_cond_signal(&refresh_condition);
+		ast_mutex_unlock(&refreshlock);
+	}
 }
 
 
@@ -1054,6 +1153,7 @@ static int load_config(int reload)
 {
 	struct ast_flags config_flags = { reload ? CONFIG_FLAG_FILEUNCHANGED : 0 };
 	struct ast_config *tmpcfg;
+	const char *val;
 
 	if (!(tmpcfg = ast_config_load2("calendar.conf", "calendar", config_flags)) ||
 		tmpcfg == CONFIG_STATUS_FILEINVALID) {
@@ -1071,6 +1171,18 @@ static int load_config(int reload)
 	}
 
 	calendar_config = tmpcfg;
+
+	ast_mutex_lock(&fetch_lock);
+	max_fetches = DEFAULT_MAX_FETCHES;
+	if ((val = ast_variable_retrieve(calendar_config, "general", "maxfetches"))
+		&& (sscanf(val, "%30d", &max_fetches) != 1 || max_fetches < 1)) {
+		ast_log(LOG_WARNING, "Invalid maxfetches '%s', using %d\n", val, DEFAULT_MAX_FETCHES);
+		max_fetches = DEFAULT_MAX_FETCHES;
+	}
+	/* More may be fetched now */
+	ast_cond_broadcast(&fetch_cond);
+	ast_mutex_unlock(&fetch_lock);
+
 	ast_rwlock_unlock(&config_lock);
 
 	return 0;
@@ -1854,6 +1966,7 @@ static int unload_module(void)
 	ast_mutex_unlock(&refreshlock);
 	pthread_join(refresh_thread, NULL);
 
+	ast_sched_clean_by_callback(sched, calendar_devstate_publish, calendar_devstate_cleanup);
 	ast_sched_context_destroy(sched);
 
 	AST_LIST_LOCK(&techs);
@@ -1886,6 +1999,8 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	ast_cond_init(&fetch_cond, NULL);
+
 	if (load_config(0)) {
 		/* We don't have calendar support enabled */
 		return AST_MODULE_LOAD_DECLINE;
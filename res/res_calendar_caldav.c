@@ -545,7 +545,12 @@ static int update_caldav(struct caldav_pvt *pvt)
 
 	start = now.tv_sec;
 	end = now.tv_sec + 60 * pvt->owner->timeframe;
-	if (!(response = caldav_get_events_between(pvt, start, end))) {
+	if (ast_calendar_fetch_begin(pvt->owner)) {
+		return -1;
+	}
+	response = caldav_get_events_between(pvt, start, end);
+	ast_calendar_fetch_end();
+	if (!response) {
 		return -1;
 	}
 
@@ -752,7 +752,12 @@ static int update_ewscal(struct ewscal_pvt *pvt)
 	struct calendar_id *id_head;
 	struct calendar_id *iter;
 
+	if (ast_calendar_fetch_begin(pvt->owner)) {
+		return 0;
+	}
+
 	if (!(id_head = get_ewscal_ids_for(pvt))) {
+		ast_calendar_fetch_end();
 		return 0;
 	}
 
@@ -761,6 +766,7 @@ static int update_ewscal(struct ewscal_pvt *pvt)
 		ast_free(iter->id);
 		ast_free(iter);
 	}
+	ast_calendar_fetch_end();
 
 	return 0;
 }
@@ -583,7 +583,12 @@ static int update_exchangecal(struct exchangecal_pvt *pvt)
 	state.pvt = pvt;
 	start = now.tv_sec;
 	end = now.tv_sec + 60 * pvt->owner->timeframe;
-	if (!(response = exchangecal_get_events_between(pvt, start, end))) {
+	if (ast_calendar_fetch_begin(pvt->owner)) {
+		return -1;
+	}
+	response = exchangecal_get_events_between(pvt, start, end);
+	ast_calendar_fetch_end();
+	if (!response) {
 		return -1;
 	}
 
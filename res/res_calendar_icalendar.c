@@ -58,6 +58,8 @@ struct icalendar_pvt {
 		AST_STRING_FIELD(url);
 		AST_STRING_FIELD(user);
 		AST_STRING_FIELD(secret);
+		AST_STRING_FIELD(etag);          /*!< ETag of the calendar last fetched */
+		AST_STRING_FIELD(last_modified); /*!< Last-Modified of the calendar last fetched */
 	);
 	struct ast_calendar *owner;
 	ne_uri uri;
@@ -123,40 +125,80 @@ static int auth_credentials(void *userdata, const char *realm, int attempts, cha
 	return 0;
 }
 
-static icalcomponent *fetch_icalendar(struct icalendar_pvt *pvt)
+/*!
+ * \internal
+ * \brief Fetch the calendar into pvt->data, unless it has not changed since last fetched.
+ *
+ * \retval 0 if pvt->data is the calendar as it is now
+ * \retval -1 on failure, leaving pvt->data empty
+ */
+static int fetch_icalendar(struct icalendar_pvt *pvt)
 {
 	int ret;
+	int not_modified;
 	struct ast_str *response;
 	ne_request *req;
-	icalcomponent *comp = NULL;
 
 	if (!pvt) {
 		ast_log(LOG_ERROR, "There is no private!\n");
-		return NULL;
+		return -1;
 	}
 
 	if (!(response = ast_str_create(512))) {
 		ast_log(LOG_ERROR, "Could not allocate memory for response.\n");
-		return NULL;
+		return -1;
+	}
+
+	if (ast_calendar_fetch_begin(pvt->owner)) {
+		ast_free(response);
+		return -1;
 	}
 
 	req = ne_request_create(pvt->session, "GET", pvt->uri.path);
 	ne_add_response_body_reader(req, ne_accept_2xx, fetch_response_reader, &response);
 
+	/* Only download and parse the calendar again if the server says it changed */
+	if (pvt->data) {
+		if (!ast_strlen_zero(pvt->etag)) {
+			ne_add_request_header(req, "If-None-Match", pvt->etag);
+		}
+		if (!ast_strlen_zero(pvt->last_modified)) {
+			ne_add_request_header(req, "If-Modified-Since", pvt->last_modified);
+		}
+	}
+
 	ret = ne_request_dispatch(req);
+	not_modified = ret == NE_OK && ne_get_status(req)->code == 304;
+	if (ret == NE_OK && !not_modified) {
+		ast_string_field_set(pvt, etag, ne_get_response_header(req, "ETag"));
+		ast_string_field_set(pvt, last_modified, ne_get_response_header(req, "Last-Modified"));
+	}
 	ne_request_destroy(req);
+	ast_calendar_fetch_end();
+
+	if (not_modified && pvt->data) {
+		ast_debug(3, "iCalendar '%s' has not changed\n", pvt->owner->name);
+		ast_free(response);
+		return 0;
+	}
+
+	if (pvt->data) {
+		icalcomponent_free(pvt->data);
+		pvt->data = NULL;
+	}
+
 	if (ret != NE_OK || !ast_str_strlen(response)) {
 		ast_log(LOG_WARNING, "Unable to retrieve iCalendar '%s' from '%s': %s\n", pvt->owner->name, pvt->url, ne_get_error(pvt->session));
 		ast_free(response);
-		return NULL;
+		return -1;
 	}
 
 	if (!ast_strlen_zero(ast_str_buffer(response))) {
-		comp = icalparser_parse_string(ast_str_buffer(response));
+		pvt->data = icalparser_parse_string(ast_str_buffer(response));
 	}
 	ast_free(response);
 
-	return comp;
+	return pvt->data ? 0 : -1;
 }
 
 static time_t icalfloat_to_timet(icaltimetype time) 
@@ -437,7 +479,7 @@ static void *ical_load_calendar(void *void_data)
 	ast_mutex_init(&refreshlock);
 
 	/* Load it the first time */
-	if (!(pvt->data = fetch_icalendar(pvt))) {
+	if (fetch_icalendar(pvt)) {
 		ast_log(LOG_WARNING, "Unable to parse iCalendar '%s'\n", cal->name);
 	}
 
@@ -467,12 +509,9 @@ static void *ical_load_calendar(void *void_data)
 
 		ast_debug(10, "Refreshing after %d minute timeout\n", pvt->owner->refresh);
 
-		/* Free the old calendar data */
-		if (pvt->data) {
-			icalcomponent_free(pvt->data);
-			pvt->data = NULL;
-		}
-		if (!(pvt->data = fetch_icalendar(pvt))) {
+		/* The old calendar data is kept if it has not changed, as the events
+		 * of the new timeframe are still taken from it */
+		if (fetch_icalendar(pvt)) {
 			ast_log(LOG_WARNING, "Unable to parse iCalendar '%s'\n", pvt->owner->name);
 			continue;
 		}
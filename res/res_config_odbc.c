@@ -99,24 +99,17 @@ static inline int is_text(const struct odbc_cache_columns *column)
 
 static SQLHSTMT custom_prepare(struct odbc_obj *obj, void *data)
 {
-	int res, x = 1, count = 0;
+	int x = 1, count = 0;
 	struct custom_prepare_struct *cps = data;
 	const struct ast_variable *field;
 	char encodebuf[1024];
 	SQLHSTMT stmt;
 
-	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		ast_log(LOG_WARNING, "SQL Alloc Handle failed!\n");
-		return NULL;
-	}
-
 	ast_debug(1, "Skip: %llu; SQL: %s\n", cps->skip, cps->sql);
 
-	res = SQLPrepare(stmt, (unsigned char *)cps->sql, SQL_NTS);
-	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
-		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", cps->sql);
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	/* Statements are cached on the connection by SQL text, so only the
+	 * parameters need to be bound again on a cache hit. */
+	if (!(stmt = ast_odbc_prepare_cached(obj, cps->sql))) {
 		return NULL;
 	}
 
@@ -223,20 +216,20 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_cached(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 
 	res = SQLFetch(stmt);
 	if (res == SQL_NO_DATA) {
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_cached(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Fetch error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_cached(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -301,7 +294,7 @@ static struct ast_variable *realtime_odbc(const char *database, const char *tabl
 		}
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_cached(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return var;
 }
@@ -388,7 +381,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	res = SQLNumResultCols(stmt, &colcount);
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
 		ast_log(LOG_WARNING, "SQL Column Count error! [%s]\n", ast_str_buffer(sql));
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_cached(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -396,7 +389,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 	cfg = ast_config_new();
 	if (!cfg) {
 		ast_log(LOG_WARNING, "Out of memory!\n");
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		ast_odbc_release_cached(obj, stmt);
 		ast_odbc_release_obj(obj);
 		return NULL;
 	}
@@ -466,7 +459,7 @@ static struct ast_config *realtime_multi_odbc(const char *database, const char *
 next_sql_fetch:;
 	}
 
-	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_cached(obj, stmt);
 	ast_odbc_release_obj(obj);
 	return cfg;
 }
@@ -551,7 +544,7 @@ static int update_odbc(const char *database, const char *table, const char *keyf
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_cached(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -757,7 +750,7 @@ static int store_odbc(const char *database, const char *table, const struct ast_
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_cached(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -771,6 +764,158 @@ static int store_odbc(const char *database, const char *table, const struct ast_
 	return -1;
 }
 
+/*! \brief Maximum number of rows inserted by one statement in store_multiple_odbc() */
+#define MAX_STORE_ROWS 100
+/*! \brief Maximum number of parameters bound to one statement in store_multiple_odbc() */
+#define MAX_STORE_PARAMS 1000
+
+struct store_multiple_prepare_struct {
+	const char *sql;
+	const char **values;
+	size_t count;
+};
+
+static SQLHSTMT store_multiple_prepare(struct odbc_obj *obj, void *data)
+{
+	struct store_multiple_prepare_struct *smps = data;
+	SQLHSTMT stmt;
+	size_t x;
+
+	ast_debug(1, "SQL: %s\n", smps->sql);
+
+	if (!(stmt = ast_odbc_prepare_cached(obj, smps->sql))) {
+		return NULL;
+	}
+
+	for (x = 0; x < smps->count; x++) {
+		SQLBindParameter(stmt, x + 1, SQL_PARAM_INPUT, SQL_C_CHAR, SQL_CHAR, strlen(smps->values[x]), 0, (void *)smps->values[x], 0, NULL);
+	}
+
+	return stmt;
+}
+
+static int same_columns(const struct ast_variable *a, const struct ast_variable *b)
+{
+	for (; a && b; a = a->next, b = b->next) {
+		if (strcmp(a->name, b->name)) {
+			return 0;
+		}
+	}
+	return !a && !b;
+}
+
+/*!
+ * \brief Excute multi-row INSERT queries
+ * \param database
+ * \param table
+ * \param rows the fields of each row
+ * \param count the number of rows
+ *
+ * Consecutive rows which set the same columns are inserted with a single
+ * prepared statement, up to MAX_STORE_ROWS rows at a time.
+ *
+ * \retval number of rows stored
+ * \retval -1 on failure
+ */
+static int store_multiple_odbc(const char *database, const char *table, const struct ast_variable **rows, size_t count)
+{
+	struct odbc_obj *obj;
+	SQLHSTMT stmt;
+	SQLLEN rowcount;
+	const struct ast_variable *field;
+	struct ast_str *sql = ast_str_thread_get(&sql_buf, SQL_BUF_SIZE);
+	struct store_multiple_prepare_struct smps;
+	struct ast_flags connected_flag = { RES_ODBC_CONNECTED };
+	char encodebuf[1024];
+	const char **values;
+	char **encoded;
+	size_t start, end, row, x, columns;
+	int stored = 0;
+
+	if (!table || !count || !sql) {
+		return -1;
+	}
+
+	obj = ast_odbc_request_obj2(database, connected_flag);
+	if (!obj) {
+		return -1;
+	}
+
+	for (start = 0; start < count; start = end) {
+		columns = 0;
+		for (field = rows[start]; field; field = field->next) {
+			columns++;
+		}
+		end = start + 1;
+		if (!columns) {
+			continue;
+		}
+
+		while (end < count && end - start < MAX_STORE_ROWS
+			&& (end - start + 1) * columns <= MAX_STORE_PARAMS
+			&& same_columns(rows[start], rows[end])) {
+			end++;
+		}
+
+		ast_str_set(&sql, 0, "INSERT INTO %s (", table);
+		for (field = rows[start]; field; field = field->next) {
+			ast_str_append(&sql, 0, "%s%s", field == rows[start] ? "" : ", ", field->name);
+		}
+		ast_str_append(&sql, 0, ") VALUES ");
+		for (row = start; row < end; row++) {
+			for (x = 0; x < columns; x++) {
+				ast_str_append(&sql, 0, "%s", !x ? (row == start ? "(?" : ", (?") : ", ?");
+			}
+			ast_str_append(&sql, 0, ")");
+		}
+
+		values = ast_calloc((end - start) * columns, sizeof(*values));
+		encoded = ast_calloc((end - start) * columns, sizeof(*encoded));
+		if (!values || !encoded) {
+			ast_free(values);
+			ast_free(encoded);
+			break;
+		}
+
+		x = 0;
+		for (row = start; row < end; row++) {
+			for (field = rows[row]; field; field = field->next, x++) {
+				values[x] = field->value;
+				if (strchr(field->value, ';') || strchr(field->value, '^')) {
+					ENCODE_CHUNK(encodebuf, field->value);
+					encoded[x] = ast_strdup(encodebuf);
+					values[x] = S_OR(encoded[x], "");
+				}
+			}
+		}
+
+		smps.sql = ast_str_buffer(sql);
+		smps.values = values;
+		smps.count = x;
+		stmt = ast_odbc_prepare_and_execute(obj, store_multiple_prepare, &smps);
+		if (stmt) {
+			if (SQL_SUCCEEDED(SQLRowCount(stmt, &rowcount)) && rowcount >= 0) {
+				stored += rowcount;
+			} else {
+				stored += end - start;
+			}
+			ast_odbc_release_cached(obj, stmt);
+		} else {
+			ast_log(LOG_WARNING, "Failed to insert %d rows into '%s'\n", (int)(end - start), table);
+		}
+
+		for (x = 0; x < (end - start) * columns; x++) {
+			ast_free(encoded[x]);
+		}
+		ast_free(encoded);
+		ast_free(values);
+	}
+
+	ast_odbc_release_obj(obj);
+
+	return stored ? stored : -1;
+}
+
 /*!
  * \brief Excute an DELETE query
  * \param database
@@ -827,7 +972,7 @@ static int destroy_odbc(const char *database, const char *table, const char *key
 	}
 
 	res = SQLRowCount(stmt, &rowcount);
-	SQLFreeHandle (SQL_HANDLE_STMT, stmt);
+	ast_odbc_release_cached(obj, stmt);
 	ast_odbc_release_obj(obj);
 
 	if ((res != SQL_SUCCESS) && (res != SQL_SUCCESS_WITH_INFO)) {
@@ -1207,6 +1352,7 @@ static struct ast_config_engine odbc_engine = {
 	.realtime_func = realtime_odbc,
 	.realtime_multi_func = realtime_multi_odbc,
 	.store_func = store_odbc,
+	.store_multiple_func = store_multiple_odbc,
 	.destroy_func = destroy_odbc,
 	.update_func = update_odbc,
 	.update2_func = update2_odbc,
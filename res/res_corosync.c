@@ -262,6 +262,39 @@ static struct {
 static cpg_handle_t cpg_handle;
 static corosync_cfg_handle_t cfg_handle;
 
+/*! \brief The largest CPG message a batch of events is sent in */
+#define BATCH_MAX_SIZE (64 * 1024)
+
+/*! \brief Milliseconds published events wait to be sent together (0 sends each at once) */
+static unsigned int batch_interval;
+
+/*! \brief Published events waiting to be sent to the cluster in one message */
+static struct {
+	ast_mutex_t lock;
+	/*! When the first event of the batch was queued */
+	struct timeval started;
+	/*! The number of bytes of events in buf */
+	size_t len;
+	/*! The events of the batch, one after the other */
+	unsigned char buf[BATCH_MAX_SIZE];
+} batch = {
+	.lock = AST_MUTEX_INIT_VALUE,
+};
+
+/*! \brief The last state of each local device sent to the cluster */
+struct sent_device_state {
+	enum ast_device_state state;
+	char device[0];
+};
+
+/*! \brief The sent_device_state of each device, so only changes are sent */
+static struct ao2_container *sent_device_states;
+
+#define SENT_DEVICE_STATES_BUCKETS 1567
+
+AO2_STRING_FIELD_HASH_FN(sent_device_state, device)
+AO2_STRING_FIELD_CMP_FN(sent_device_state, device)
+
 #ifdef HAVE_COROSYNC_CFG_STATE_TRACK
 static void cfg_state_track_cb(
 		corosync_cfg_state_notification_buffer_t *notification_buffer,
@@ -460,20 +493,13 @@ static void cfg_shutdown_cb(corosync_cfg_handle_t cfg_handle,
 {
 }
 
-static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_name,
-		uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
+/*! \brief Publish one event of a received CPG message to \ref stasis */
+static void deliver_event(const void *msg, size_t msg_len)
 {
 	struct ast_event *event;
 	void (*publish_handler)(struct ast_event *) = NULL;
 	enum ast_event_type event_type;
 
-	if (msg_len < ast_event_minimum_length()) {
-		ast_debug(1, "Ignoring event that's too small. %u < %u\n",
-			(unsigned int) msg_len,
-			(unsigned int) ast_event_minimum_length());
-		return;
-	}
-
 	if (!ast_eid_cmp(&ast_eid_default, ast_event_get_ie_raw(msg, AST_EVENT_IE_EID))) {
 		/* Don't feed events back in that originated locally. */
 		return;
@@ -514,6 +540,36 @@ static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 	publish_handler(event);
 }
 
+static void cpg_deliver_cb(cpg_handle_t handle, const struct cpg_name *group_name,
+		uint32_t nodeid, uint32_t pid, void *msg, size_t msg_len)
+{
+	const unsigned char *pos = msg;
+
+	if (msg_len < ast_event_minimum_length()) {
+		ast_debug(1, "Ignoring event that's too small. %u < %u\n",
+			(unsigned int) msg_len,
+			(unsigned int) ast_event_minimum_length());
+		return;
+	}
+
+	/* A message holds one event, or a batch of them one after the other */
+	while (msg_len >= ast_event_minimum_length()) {
+		size_t event_len = ast_event_get_size((const struct ast_event *) pos);
+
+		if (event_len < ast_event_minimum_length() || event_len > msg_len) {
+			ast_debug(1, "Ignoring the rest of a message with a bad event length. %u of %u\n",
+				(unsigned int) event_len,
+				(unsigned int) msg_len);
+			return;
+		}
+
+		deliver_event(pos, event_len);
+
+		pos += event_len;
+		msg_len -= event_len;
+	}
+}
+
 static void publish_event_to_corosync(struct ast_event *event)
 {
 	cs_error_t cs_err;
@@ -533,7 +589,124 @@ static void publish_event_to_corosync(struct ast_event *event)
 	}
 }
 
-static void publish_to_corosync(struct stasis_message *message)
+/*! \brief Send the batch of events to the cluster, with the batch locked */
+static void batch_flush(void)
+{
+	cs_error_t cs_err;
+	struct iovec iov;
+
+	if (!batch.len) {
+		return;
+	}
+
+	iov.iov_base = batch.buf;
+	iov.iov_len = batch.len;
+
+	ast_debug(5, "Publishing a batch of %u bytes of events to corosync\n",
+		(unsigned int) batch.len);
+
+	if ((cs_err = cpg_mcast_joined(cpg_handle, CPG_TYPE_FIFO, &iov, 1)) != CS_OK) {
+		ast_log(LOG_WARNING, "CPG mcast failed (%u) for a batch of events\n", cs_err);
+	}
+	batch.len = 0;
+}
+
+/*! \brief Ask the dispatch thread to look at the batch again */
+static void batch_alert(void)
+{
+	char meepmeep = 'x';
+
+	if (dispatch_thread.alert_pipe[1] == -1) {
+		/* The dispatch thread sends the batch when it starts */
+		return;
+	}
+
+	if (ast_carefulwrite(dispatch_thread.alert_pipe[1], &meepmeep, 1, 5000) == -1) {
+		ast_log(LOG_ERROR, "Failed to write to pipe: %s (%d)\n",
+				strerror(errno), errno);
+	}
+}
+
+/*!
+ * \brief Add an event to the batch sent to the cluster
+ *
+ * The dispatch thread sends the batch batch_interval milliseconds after its
+ * first event was added.  A batch that has no room left is sent at once.
+ */
+static void batch_event(struct ast_event *event)
+{
+	size_t event_len = ast_event_get_size(event);
+	int first;
+
+	ast_mutex_lock(&batch.lock);
+	if (batch.len + event_len > sizeof(batch.buf)) {
+		batch_flush();
+	}
+	first = !batch.len;
+	if (first) {
+		batch.started = ast_tvnow();
+	}
+	memcpy(batch.buf + batch.len, event, event_len);
+	batch.len += event_len;
+	ast_mutex_unlock(&batch.lock);
+
+	if (first) {
+		batch_alert();
+	}
+}
+
+/*!
+ * \brief Check whether a local device state differs from the one last sent
+ *
+ * \param event The device state event about to be sent
+ * \param force Send it even if it has not changed, and remember it
+ *
+ * \retval 0 the state was already sent
+ * \retval 1 the state must be sent
+ */
+static int device_state_changed(struct ast_event *event, int force)
+{
+	struct sent_device_state *sent;
+	const char *device = ast_event_get_ie_str(event, AST_EVENT_IE_DEVICE);
+	enum ast_device_state state = ast_event_get_ie_uint(event, AST_EVENT_IE_STATE);
+
+	if (ast_strlen_zero(device)
+		|| ast_event_get_ie_uint(event, AST_EVENT_IE_CACHABLE) != AST_DEVSTATE_CACHABLE) {
+		/* Changes which are not cached are sent every time */
+		return 1;
+	}
+
+	ao2_lock(sent_device_states);
+	sent = ao2_find(sent_device_states, device, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (sent && sent->state == state && !force) {
+		ao2_unlock(sent_device_states);
+		ao2_ref(sent, -1);
+		return 0;
+	}
+	if (!sent) {
+		sent = ao2_alloc_options(sizeof(*sent) + strlen(device) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!sent) {
+			ao2_unlock(sent_device_states);
+			return 1;
+		}
+		strcpy(sent->device, device); /* Safe */
+		ao2_link_flags(sent_device_states, sent, OBJ_NOLOCK);
+	}
+	sent->state = state;
+	ao2_unlock(sent_device_states);
+	ao2_ref(sent, -1);
+
+	return 1;
+}
+
+/*!
+ * \brief Send a locally published \ref stasis message to the cluster
+ *
+ * \param message The message
+ * \param force Send device states even if they have not changed
+ */
+static void publish_to_corosync(struct stasis_message *message, int force)
 {
 	struct ast_event *event;
 
@@ -548,6 +721,12 @@ static void publish_to_corosync(struct stasis_message *message)
 		return;
 	}
 
+	if (ast_event_get_type(event) == AST_EVENT_DEVICE_STATE_CHANGE
+		&& !device_state_changed(event, force)) {
+		ast_event_destroy(event);
+		return;
+	}
+
 	if (ast_event_get_type(event) == AST_EVENT_PING) {
 		const struct ast_eid *eid;
 		char buf[128] = "";
@@ -555,9 +734,14 @@ static void publish_to_corosync(struct stasis_message *message)
 		eid = ast_event_get_ie_raw(event, AST_EVENT_IE_EID);
 		ast_eid_to_str(buf, sizeof(buf), (struct ast_eid *) eid);
 		ast_log(LOG_NOTICE, "Sending event PING from this server with EID: '%s'\n", buf);
+	} else if (batch_interval) {
+		batch_event(event);
+		ast_event_destroy(event);
+		return;
 	}
 
 	publish_event_to_corosync(event);
+	ast_event_destroy(event);
 }
 
 static void stasis_message_cb(void *data, struct stasis_subscription *sub, struct stasis_message *message)
@@ -566,7 +750,7 @@ static void stasis_message_cb(void *data, struct stasis_subscription *sub, struc
 		return;
 	}
 
-	publish_to_corosync(message);
+	publish_to_corosync(message, 0);
 }
 
 static int dump_cache_cb(void *obj, void *arg, int flags)
@@ -577,7 +761,7 @@ static int dump_cache_cb(void *obj, void *arg, int flags)
 		return 0;
 	}
 
-	publish_to_corosync(message);
+	publish_to_corosync(message, 1);
 
 	return 0;
 }
@@ -632,6 +816,11 @@ static void cpg_confchg_cb(cpg_handle_t handle, const struct cpg_name *group_nam
 
 		ao2_t_ref(messages, -1, "Dispose of dumped cache");
 	}
+
+	/* Don't keep the joined nodes waiting for the rest of our state */
+	ast_mutex_lock(&batch.lock);
+	batch_flush();
+	ast_mutex_unlock(&batch.lock);
 }
 
 /*! \brief Informs the cluster of our EID and our IP addresses */
@@ -697,6 +886,7 @@ static void *dispatch_thread_handler(void *data)
 	send_cluster_notify();
 	while (!dispatch_thread.stop) {
 		int res;
+		int timeout = -1;
 
 		cs_err = CS_OK;
 
@@ -704,12 +894,31 @@ static void *dispatch_thread_handler(void *data)
 		pfd[1].revents = 0;
 		pfd[2].revents = 0;
 
-		res = ast_poll(pfd, ARRAY_LEN(pfd), -1);
+		/* Send the batch of events once it has waited long enough */
+		ast_mutex_lock(&batch.lock);
+		if (batch.len) {
+			timeout = batch_interval - ast_tvdiff_ms(ast_tvnow(), batch.started);
+			if (timeout <= 0) {
+				batch_flush();
+				timeout = -1;
+			}
+		}
+		ast_mutex_unlock(&batch.lock);
+
+		res = ast_poll(pfd, ARRAY_LEN(pfd), timeout);
 		if (res == -1 && errno != EINTR && errno != EAGAIN) {
 			ast_log(LOG_ERROR, "poll() error: %s (%d)\n", strerror(errno), errno);
 			continue;
 		}
 
+		if (pfd[2].revents & POLLIN) {
+			char alerts[32];
+
+			if (read(pfd[2].fd, alerts, sizeof(alerts)) < 0) {
+				ast_debug(1, "Failed to read from alert pipe: %s\n", strerror(errno));
+			}
+		}
+
 		if (pfd[0].revents & POLLIN) {
 			if ((cs_err = cpg_dispatch(cpg_handle, CS_DISPATCH_ALL)) != CS_OK) {
 				ast_log(LOG_WARNING, "Failed CPG dispatch: %u\n", cs_err);
@@ -766,6 +975,10 @@ static void *dispatch_thread_handler(void *data)
 		}
 	}
 
+	ast_mutex_lock(&batch.lock);
+	batch_flush();
+	ast_mutex_unlock(&batch.lock);
+
 	return NULL;
 }
 
@@ -918,6 +1131,10 @@ static char *corosync_show_config(struct ast_cli_entry *e, int cmd, struct ast_c
 	}
 	ast_rwlock_unlock(&event_types_lock);
 
+	if (batch_interval) {
+		ast_cli(a->fd, "=== ==> Sending events in batches every %u ms\n", batch_interval);
+	}
+
 	ast_cli(a->fd, "===\n"
 	               "=============================================================\n"
 	               "\n");
@@ -972,12 +1189,16 @@ static int load_general_config(struct ast_config *cfg)
 		event_types[i].publish = event_types[i].publish_default;
 		event_types[i].subscribe = event_types[i].subscribe_default;
 	}
+	batch_interval = 0;
 
 	for (v = ast_variable_browse(cfg, "general"); v && !res; v = v->next) {
 		if (!strcasecmp(v->name, "publish_event")) {
 			res = set_event(v->value, PUBLISH);
 		} else if (!strcasecmp(v->name, "subscribe_event")) {
 			res = set_event(v->value, SUBSCRIBE);
+		} else if (!strcasecmp(v->name, "batch_interval")) {
+			res = ast_parse_arg(v->value, PARSE_UINT32 | PARSE_IN_RANGE,
+				&batch_interval, 0, 1000);
 		} else {
 			ast_log(LOG_WARNING, "Unknown option '%s'\n", v->name);
 		}
@@ -1094,6 +1315,9 @@ static void cleanup_module(void)
 
 	ao2_cleanup(nodes);
 	nodes = NULL;
+
+	ao2_cleanup(sent_device_states);
+	sent_device_states = NULL;
 }
 
 static int load_module(void)
@@ -1111,6 +1335,12 @@ static int load_module(void)
 		goto failed;
 	}
 
+	sent_device_states = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0,
+		SENT_DEVICE_STATES_BUCKETS, sent_device_state_hash_fn, NULL, sent_device_state_cmp_fn);
+	if (!sent_device_states) {
+		goto failed;
+	}
+
 	corosync_aggregate_topic = stasis_topic_create("corosync_aggregate_topic");
 	if (!corosync_aggregate_topic) {
 		ast_log(AST_LOG_ERROR, "Failed to create stasis topic for corosync\n");
@@ -45,6 +45,8 @@
 #include <curl/curl.h>
 
 #include "asterisk/module.h"
+#include "asterisk/lock.h"
+#include "asterisk/res_curl.h"
 
 static const char *dependents[] = {
 	"func_curl.so",
@@ -52,6 +54,70 @@ static const char *dependents[] = {
 	"res_http_media_cache.so",
 };
 
+/*! \brief The DNS, TLS session and connection caches used by all handles */
+static CURLSH *share;
+
+/*! \brief One lock for each kind of data in the share */
+static ast_mutex_t share_locks[CURL_LOCK_DATA_LAST];
+
+static void share_lock(CURL *curl, curl_lock_data data, curl_lock_access access, void *userptr)
+{
+	ast_mutex_lock(&share_locks[data]);
+}
+
+static void share_unlock(CURL *curl, curl_lock_data data, void *userptr)
+{
+	ast_mutex_unlock(&share_locks[data]);
+}
+
+int ast_curl_share(CURL *curl)
+{
+	if (!share) {
+		return -1;
+	}
+
+	return curl_easy_setopt(curl, CURLOPT_SHARE, share) == CURLE_OK ? 0 : -1;
+}
+
+static void share_destroy(void)
+{
+	size_t i;
+
+	if (share) {
+		curl_share_cleanup(share);
+		share = NULL;
+	}
+
+	for (i = 0; i < ARRAY_LEN(share_locks); i++) {
+		ast_mutex_destroy(&share_locks[i]);
+	}
+}
+
+static int share_create(void)
+{
+	size_t i;
+
+	for (i = 0; i < ARRAY_LEN(share_locks); i++) {
+		ast_mutex_init(&share_locks[i]);
+	}
+
+	share = curl_share_init();
+	if (!share) {
+		return -1;
+	}
+
+	curl_share_setopt(share, CURLSHOPT_LOCKFUNC, share_lock);
+	curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, share_unlock);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+#if LIBCURL_VERSION_NUM >= 0x073900
+	/* Connections can only be shared since libcurl 7.57.0 */
+	curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+#endif
+
+	return 0;
+}
+
 static int unload_module(void)
 {
 	int res = 0;
@@ -68,6 +134,7 @@ static int unload_module(void)
 	if (res)
 		return -1;
 
+	share_destroy();
 	curl_global_cleanup();
 
 	return res;
@@ -92,6 +159,11 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	if (share_create()) {
+		ast_log(LOG_WARNING, "Unable to share cURL caches, every handle keeps its own\n");
+		share_destroy();
+	}
+
 	return res;
 }
 
@@ -4205,32 +4205,46 @@ static char *cli_fax_show_sessions(struct ast_cli_entry *e, int cmd, struct ast_
 	struct ao2_iterator i;
 	int session_count;
 	char *filenames;
+	struct ast_fax_session_timing timing;
+	char cpu[24];
+	char late[12];
 
 	switch (cmd) {
 	case CLI_INIT:
 		e->command = "fax show sessions";
 		e->usage =
 			"Usage: fax show sessions\n"
-			"       Shows the current FAX sessions\n";
+			"       Shows the current FAX sessions.  For technologies that\n"
+			"       time their sessions, the average and most microseconds\n"
+			"       spent processing 20ms of a session, and the most it was\n"
+			"       processed late, are also shown.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
 	}
 
 	ast_cli(a->fd, "\nCurrent FAX Sessions:\n\n");
-	ast_cli(a->fd, "%-20.20s %-10.10s %-10.10s %-5.5s %-10.10s %-15.15s %-30.30s\n",
-		"Channel", "Tech", "FAXID", "Type", "Operation", "State", "File(s)");
+	ast_cli(a->fd, "%-20.20s %-10.10s %-10.10s %-5.5s %-10.10s %-15.15s %-13.13s %-8.8s %-30.30s\n",
+		"Channel", "Tech", "FAXID", "Type", "Operation", "State", "CPU(us)", "Late(us)", "File(s)");
 	i = ao2_iterator_init(faxregistry.container, 0);
 	while ((s = ao2_iterator_next(&i))) {
 		ao2_lock(s);
 
 		filenames = generate_filenames_string(s->details, "", ", ");
 
-		ast_cli(a->fd, "%-20.20s %-10.10s %-10u %-5.5s %-10.10s %-15.15s %-30s\n",
+		if (s->tech->session_timing && !s->tech->session_timing(s, &timing)) {
+			snprintf(cpu, sizeof(cpu), "%u/%u", timing.avg_cpu_us, timing.max_cpu_us);
+			snprintf(late, sizeof(late), "%u", timing.max_late_us);
+		} else {
+			ast_copy_string(cpu, "-", sizeof(cpu));
+			ast_copy_string(late, "-", sizeof(late));
+		}
+
+		ast_cli(a->fd, "%-20.20s %-10.10s %-10u %-5.5s %-10.10s %-15.15s %-13.13s %-8.8s %-30s\n",
 			s->channame, s->tech->type, s->id,
 			fax_session_type(s),
 			ast_fax_session_operation_str(s),
-			ast_fax_state_to_str(s->state), S_OR(filenames, ""));
+			ast_fax_state_to_str(s->state), cpu, late, S_OR(filenames, ""));
 
 		ast_free(filenames);
 		ao2_unlock(s);
@@ -52,6 +52,9 @@
 #define ASTMM_LIBC ASTMM_IGNORE
 #include "asterisk.h"
 
+#include <fcntl.h>
+#include <time.h>
+
 #include "asterisk/logger.h"
 #include "asterisk/module.h"
 #include "asterisk/strings.h"
@@ -62,6 +65,7 @@
 #include "asterisk/res_fax.h"
 #include "asterisk/channel.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/vector.h"
 
 #define SPANDSP_EXPOSE_INTERNAL_STRUCTURES
 #include <spandsp.h>
@@ -70,6 +74,8 @@
 #define SPANDSP_FAX_SAMPLES 160
 #define SPANDSP_FAX_TIMER_RATE 8000 / SPANDSP_FAX_SAMPLES	/* 50 ticks per second, 20ms, 160 samples per second */
 #define SPANDSP_ENGAGE_UDPTL_NAT_RETRY 3
+#define SPANDSP_FAX_POOL_THREADS 4	/* threads driving every session in 20ms ticks */
+#define SPANDSP_FAX_POOL_BACKLOG 50	/* 1 second of frames waiting for a slow channel */
 
 static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_token *token);
 static void spandsp_fax_destroy(struct ast_fax_session *s);
@@ -91,6 +97,7 @@ static void spandsp_manager_fax_session(struct mansession *s,
 	const char *id_text, struct ast_fax_session *session);
 static char *spandsp_fax_cli_show_stats(int fd);
 static char *spandsp_fax_cli_show_settings(int fd);
+static int spandsp_fax_session_timing(struct ast_fax_session *s, struct ast_fax_session_timing *timing);
 
 static struct ast_fax_tech spandsp_fax_tech = {
 	.type = "Spandsp",
@@ -119,6 +126,7 @@ static struct ast_fax_tech spandsp_fax_tech = {
 	.manager_fax_session = spandsp_manager_fax_session,
 	.cli_show_stats = spandsp_fax_cli_show_stats,
 	.cli_show_settings = spandsp_fax_cli_show_settings,
+	.session_timing = spandsp_fax_session_timing,
 };
 
 struct spandsp_fax_stats {
@@ -143,9 +151,19 @@ static struct {
 	struct spandsp_fax_stats t38;
 } spandsp_global_stats;
 
+struct spandsp_pool_thread;
+
+/*!
+ * \brief The state of a session, locked while the spandsp stack is used
+ *
+ * The processing pool drives the session from its own thread, so the
+ * spandsp stack is shared with the channel thread writing frames to it.
+ */
 struct spandsp_pvt {
 	unsigned int ist38:1;
 	unsigned int isdone:1;
+	/*! The session was destroyed, the pool must not touch it anymore */
+	unsigned int detached:1;
 	enum ast_t38_state ast_t38_state;
 	fax_state_t fax_state;
 	t38_terminal_state_t t38_state;
@@ -157,13 +175,46 @@ struct spandsp_pvt {
 	struct spandsp_fax_gw_stats *t38stats;
 	t38_gateway_state_t t38_gw_state;
 
-	struct ast_timer *timer;
-	AST_LIST_HEAD(frame_queue, ast_frame) read_frames;
+	/*! Pool thread driving the session, NULL if not started */
+	struct spandsp_pool_thread *pool;
+	/*! Written by the pool every tick, the read end is the session's fd */
+	int alert_pipe[2];
+	/*! Frames for the channel thread to read */
+	AST_LIST_HEAD_NOLOCK(frame_queue, ast_frame) read_frames;
+	/*! Number of frames in read_frames */
+	unsigned int read_count;
+
+	/*! Gateway: the channel of the session, T.38 packets are sent on it */
+	struct ast_channel *chan;
+	/*! Gateway: the T.30 leg, generated audio is written to it */
+	struct ast_channel *t30_chan;
+	/*! Gateway: T.38 packets to send once the session is unlocked */
+	struct frame_queue t38_frames;
+
+	/*! Processing time of the session in the pool */
+	struct ast_fax_session_timing timing;
+	/*! Total microseconds of processor time spent in the pool */
+	uint64_t cpu_total_us;
 
 	int v21_detected;
 	modem_connect_tones_rx_state_t *tone_state;
 };
 
+/*! \brief A thread of the processing pool, driving its sessions in 20ms ticks */
+struct spandsp_pool_thread {
+	pthread_t thread;
+	/*! Protects sessions */
+	ast_mutex_t lock;
+	/*! Wakes the thread every 20ms */
+	struct ast_timer *timer;
+	/*! Sessions processed every tick, each holding a reference */
+	AST_VECTOR(, struct spandsp_pvt *) sessions;
+	/*! Set to make the thread exit */
+	int stop;
+};
+
+static struct spandsp_pool_thread spandsp_pool[SPANDSP_FAX_POOL_THREADS];
+
 static int spandsp_v21_new(struct spandsp_pvt *p);
 static void session_destroy(struct spandsp_pvt *p);
 static int t38_tx_packet_handler(t38_core_state_t *t38_core_state, void *data, const uint8_t *buf, int len, int count);
@@ -201,14 +252,13 @@ static void session_destroy(struct spandsp_pvt *p)
 	t30_terminate(t30_to_terminate);
 	p->isdone = 1;
 
-	ast_timer_close(p->timer);
-	p->timer = NULL;
 	fax_release(&p->fax_state);
 	t38_terminal_release(&p->t38_state);
 
 	while ((f = AST_LIST_REMOVE_HEAD(&p->read_frames, frame_list))) {
 		ast_frfree(f);
 	}
+	p->read_count = 0;
 }
 
 /*! \brief
@@ -237,19 +287,15 @@ static int t38_tx_packet_handler(t38_core_state_t *t38_core_state, void *data, c
 		return res;
 	}
 
+	/* The session is locked, the frames are sent or read once it is not */
 	if (s->details->caps & AST_FAX_TECH_GATEWAY) {
 		ast_set_flag(f, AST_FAX_FRFLAG_GATEWAY);
-		if (p->ast_t38_state == T38_STATE_NEGOTIATED) {
-			res = ast_write(s->chan, f);
-		} else {
-			res = ast_queue_frame(s->chan, f);
-		}
-		ast_frfree(f);
+		AST_LIST_INSERT_TAIL(&p->t38_frames, f, frame_list);
 	} else {
-		/* no need to lock, this all runs in the same thread */
 		AST_LIST_INSERT_TAIL(&p->read_frames, f, frame_list);
-		res = 0;
+		++p->read_count;
 	}
+	res = 0;
 
 	return res;
 }
@@ -521,16 +567,354 @@ static int spandsp_modems(struct ast_fax_session_details *details)
 	return modems;
 }
 
+static void spandsp_pvt_destructor(void *obj)
+{
+	struct spandsp_pvt *p = obj;
+	struct ast_frame *f;
+
+	while ((f = AST_LIST_REMOVE_HEAD(&p->read_frames, frame_list))) {
+		ast_frfree(f);
+	}
+	while ((f = AST_LIST_REMOVE_HEAD(&p->t38_frames, frame_list))) {
+		ast_frfree(f);
+	}
+
+	if (p->alert_pipe[0] > -1) {
+		close(p->alert_pipe[0]);
+	}
+	if (p->alert_pipe[1] > -1) {
+		close(p->alert_pipe[1]);
+	}
+
+	ast_channel_cleanup(p->chan);
+	ast_channel_cleanup(p->t30_chan);
+}
+
+/*! \brief create the pipe the pool wakes the channel thread with */
+static int spandsp_alert_pipe_init(struct spandsp_pvt *p)
+{
+	int flags;
+	int i;
+
+	if (pipe(p->alert_pipe)) {
+		p->alert_pipe[0] = p->alert_pipe[1] = -1;
+		return -1;
+	}
+
+	for (i = 0; i < 2; i++) {
+		flags = fcntl(p->alert_pipe[i], F_GETFL);
+		if (fcntl(p->alert_pipe[i], F_SETFL, flags | O_NONBLOCK) < 0) {
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief wake the channel thread to read a frame or notice the session is done */
+static void spandsp_alert(struct spandsp_pvt *p)
+{
+	/* A full pipe wakes the channel thread anyway */
+	if (write(p->alert_pipe[1], "", 1) < 0 && errno != EAGAIN) {
+		ast_log(LOG_WARNING, "Failed to alert FAX session: %s\n", strerror(errno));
+	}
+}
+
+/*! \brief send the T.38 packets the gateway generated while it was locked */
+static void spandsp_gateway_flush(struct spandsp_pvt *p)
+{
+	struct frame_queue frames = AST_LIST_HEAD_NOLOCK_INIT_VALUE;
+	struct ast_frame *f;
+	int negotiated;
+
+	ao2_lock(p);
+	AST_LIST_APPEND_LIST(&frames, &p->t38_frames, frame_list);
+	negotiated = p->ast_t38_state == T38_STATE_NEGOTIATED;
+	ao2_unlock(p);
+
+	/* Only a gateway queues packets, so its channel is set */
+	while ((f = AST_LIST_REMOVE_HEAD(&frames, frame_list))) {
+		if (negotiated) {
+			ast_write(p->chan, f);
+		} else {
+			ast_queue_frame(p->chan, f);
+		}
+		ast_frfree(f);
+	}
+}
+
+/*! \brief generate the next 20ms of a terminal session, the session is locked */
+static void spandsp_pool_terminal_tick(struct spandsp_pvt *p)
+{
+	uint8_t buffer[AST_FRIENDLY_OFFSET + SPANDSP_FAX_SAMPLES * sizeof(uint16_t)];
+	int16_t *buf = (int16_t *) (buffer + AST_FRIENDLY_OFFSET);
+	int samples;
+	struct ast_frame fax_frame = {
+		.frametype = AST_FRAME_VOICE,
+		.src = "res_fax_spandsp_g711",
+		.subclass.format = ast_format_slin,
+	};
+	struct ast_frame *f;
+
+	if (p->isdone || p->read_count >= SPANDSP_FAX_POOL_BACKLOG) {
+		/* Nothing more to generate, or the channel is not keeping up */
+	} else if (p->ist38) {
+		t38_terminal_send_timeout(&p->t38_state, SPANDSP_FAX_SAMPLES);
+	} else if ((samples = fax_tx(&p->fax_state, buf, SPANDSP_FAX_SAMPLES)) > 0) {
+		fax_frame.samples = samples;
+		AST_FRAME_SET_BUFFER(&fax_frame, buffer, AST_FRIENDLY_OFFSET, samples * sizeof(int16_t));
+		if ((f = ast_frisolate(&fax_frame))) {
+			AST_LIST_INSERT_TAIL(&p->read_frames, f, frame_list);
+			++p->read_count;
+		}
+	}
+
+	/* The channel thread reads a frame, or nothing, every tick like it did off its own timer */
+	spandsp_alert(p);
+}
+
+/*! \brief generate the next 20ms of a session */
+static void spandsp_pool_session_tick(struct spandsp_pvt *p)
+{
+	uint8_t buffer[AST_FRIENDLY_OFFSET + SPANDSP_FAX_SAMPLES * sizeof(uint16_t)];
+	int16_t *buf = (int16_t *) (buffer + AST_FRIENDLY_OFFSET);
+	struct ast_channel *t30_chan = NULL;
+	struct ast_frame t30_frame = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = ast_format_slin,
+		.src = "res_fax_spandsp_g711",
+		.flags = AST_FAX_FRFLAG_GATEWAY,
+	};
+
+	ao2_lock(p);
+	if (p->detached) {
+		ao2_unlock(p);
+		return;
+	}
+
+	if (!p->chan) {
+		spandsp_pool_terminal_tick(p);
+		ao2_unlock(p);
+		return;
+	}
+
+	/* generate audio for the T.30 leg of the gateway */
+	if (!p->isdone
+		&& (t30_frame.samples = t38_gateway_tx(&p->t38_gw_state, buf, SPANDSP_FAX_SAMPLES)) > 0) {
+		AST_FRAME_SET_BUFFER(&t30_frame, buffer, AST_FRIENDLY_OFFSET, t30_frame.samples * sizeof(int16_t));
+		t30_chan = ast_channel_ref(p->t30_chan);
+	}
+	ao2_unlock(p);
+
+	if (t30_chan) {
+		ast_write(t30_chan, &t30_frame);
+		ast_channel_unref(t30_chan);
+	}
+	spandsp_gateway_flush(p);
+}
+
+/*! \brief processor time used by the calling thread in microseconds */
+static int64_t spandsp_thread_cpu_us(void)
+{
+	struct timespec ts;
+
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts)) {
+		return 0;
+	}
+
+	return (int64_t) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/*!
+ * \brief drive the sessions of a pool thread in lockstep
+ *
+ * Every 20ms tick the sessions are processed one after the other. How late
+ * each one was processed is measured from when the tick was due, so a
+ * session waiting behind a slow batch shows the jitter its channel sees.
+ */
+static void *spandsp_pool_run(void *data)
+{
+	struct spandsp_pool_thread *pool = data;
+	AST_VECTOR(, struct spandsp_pvt *) batch;
+	struct spandsp_pvt *p;
+	struct timeval due;
+	struct timeval start;
+	int64_t cpu_us;
+	int64_t late_us;
+	int i;
+
+	if (AST_VECTOR_INIT(&batch, 8)) {
+		return NULL;
+	}
+
+	due = ast_tvnow();
+	while (!pool->stop) {
+		if (ast_wait_for_input(ast_timer_fd(pool->timer), 1000) <= 0) {
+			continue;
+		}
+		if (ast_timer_ack(pool->timer, 1) < 0) {
+			ast_log(LOG_ERROR, "Failed to acknowledge timer for FAX processing\n");
+			continue;
+		}
+
+		due = ast_tvadd(due, ast_samp2tv(SPANDSP_FAX_SAMPLES, 8000));
+		start = ast_tvnow();
+		if (ast_tvcmp(start, due) < 0 || ast_tvdiff_ms(start, due) > 1000) {
+			/* Woken early, or asleep for long, measure from this tick on */
+			due = start;
+		}
+
+		ast_mutex_lock(&pool->lock);
+		for (i = 0; i < AST_VECTOR_SIZE(&pool->sessions); i++) {
+			p = AST_VECTOR_GET(&pool->sessions, i);
+			if (!AST_VECTOR_APPEND(&batch, p)) {
+				ao2_ref(p, +1);
+			}
+		}
+		ast_mutex_unlock(&pool->lock);
+
+		for (i = 0; i < AST_VECTOR_SIZE(&batch); i++) {
+			p = AST_VECTOR_GET(&batch, i);
+
+			late_us = ast_tvdiff_us(ast_tvnow(), due);
+			cpu_us = spandsp_thread_cpu_us();
+			spandsp_pool_session_tick(p);
+			cpu_us = spandsp_thread_cpu_us() - cpu_us;
+
+			ao2_lock(p);
+			p->timing.ticks++;
+			p->cpu_total_us += cpu_us;
+			if (p->timing.max_cpu_us < cpu_us) {
+				p->timing.max_cpu_us = cpu_us;
+			}
+			if (p->timing.max_late_us < late_us) {
+				p->timing.max_late_us = late_us;
+			}
+			ao2_unlock(p);
+		}
+		AST_VECTOR_RESET(&batch, ao2_cleanup);
+	}
+
+	AST_VECTOR_FREE(&batch);
+
+	return NULL;
+}
+
+/*! \brief have the least busy pool thread drive a session */
+static int spandsp_pool_add(struct spandsp_pvt *p)
+{
+	struct spandsp_pool_thread *pool = NULL;
+	size_t least = SIZE_MAX;
+	int i;
+
+	if (p->pool) {
+		return 0;
+	}
+
+	for (i = 0; i < SPANDSP_FAX_POOL_THREADS; i++) {
+		ast_mutex_lock(&spandsp_pool[i].lock);
+		if (AST_VECTOR_SIZE(&spandsp_pool[i].sessions) < least) {
+			least = AST_VECTOR_SIZE(&spandsp_pool[i].sessions);
+			pool = &spandsp_pool[i];
+		}
+		ast_mutex_unlock(&spandsp_pool[i].lock);
+	}
+
+	ast_mutex_lock(&pool->lock);
+	if (AST_VECTOR_APPEND(&pool->sessions, p)) {
+		ast_mutex_unlock(&pool->lock);
+		return -1;
+	}
+	ao2_ref(p, +1);
+	p->pool = pool;
+	ast_mutex_unlock(&pool->lock);
+
+	return 0;
+}
+
+/*! \brief stop driving a session, the pool may still hold it for the current tick */
+static void spandsp_pool_remove(struct spandsp_pvt *p)
+{
+	if (!p->pool) {
+		return;
+	}
+
+	ast_mutex_lock(&p->pool->lock);
+	AST_VECTOR_REMOVE_CMP_UNORDERED(&p->pool->sessions, p, AST_VECTOR_ELEM_DEFAULT_CMP, ao2_cleanup);
+	ast_mutex_unlock(&p->pool->lock);
+	p->pool = NULL;
+}
+
+static void spandsp_pool_stop(void)
+{
+	struct spandsp_pool_thread *pool;
+	int i;
+
+	for (i = 0; i < SPANDSP_FAX_POOL_THREADS; i++) {
+		pool = &spandsp_pool[i];
+
+		pool->stop = 1;
+		if (pool->thread != AST_PTHREADT_NULL) {
+			pthread_join(pool->thread, NULL);
+			pool->thread = AST_PTHREADT_NULL;
+		}
+		if (pool->timer) {
+			ast_timer_close(pool->timer);
+			pool->timer = NULL;
+		}
+		AST_VECTOR_RESET(&pool->sessions, ao2_cleanup);
+		AST_VECTOR_FREE(&pool->sessions);
+		ast_mutex_destroy(&pool->lock);
+	}
+}
+
+static int spandsp_pool_start(void)
+{
+	struct spandsp_pool_thread *pool;
+	int i;
+
+	for (i = 0; i < SPANDSP_FAX_POOL_THREADS; i++) {
+		pool = &spandsp_pool[i];
+
+		ast_mutex_init(&pool->lock);
+		AST_VECTOR_INIT(&pool->sessions, 0);
+		pool->thread = AST_PTHREADT_NULL;
+		pool->timer = NULL;
+		pool->stop = 0;
+	}
+
+	for (i = 0; i < SPANDSP_FAX_POOL_THREADS; i++) {
+		pool = &spandsp_pool[i];
+
+		if (!(pool->timer = ast_timer_open())) {
+			ast_log(LOG_ERROR, "Failed to create timing source for FAX processing.\n");
+			return -1;
+		}
+		if (ast_timer_set_rate(pool->timer, SPANDSP_FAX_TIMER_RATE)) {
+			ast_log(LOG_ERROR, "Error setting rate on timing source for FAX processing.\n");
+			return -1;
+		}
+		if (ast_pthread_create(&pool->thread, NULL, spandsp_pool_run, pool)) {
+			pool->thread = AST_PTHREADT_NULL;
+			ast_log(LOG_ERROR, "Failed to start FAX processing thread.\n");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 /*! \brief create an instance of the spandsp tech_pvt for a fax session */
 static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_token *token)
 {
 	struct spandsp_pvt *p;
 	int caller_mode;
 
-	if ((!(p = ast_calloc(1, sizeof(*p))))) {
+	if (!(p = ao2_alloc(sizeof(*p), spandsp_pvt_destructor))) {
 		ast_log(LOG_ERROR, "Cannot initialize the spandsp private FAX technology structure.\n");
 		goto e_return;
 	}
+	p->alert_pipe[0] = p->alert_pipe[1] = -1;
 
 	if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
 		if (spandsp_v21_new(p)) {
@@ -546,8 +930,6 @@ static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_toke
 		return p;
 	}
 
-	AST_LIST_HEAD_INIT(&p->read_frames);
-
 	if (s->details->caps & AST_FAX_TECH_RECEIVE) {
 		caller_mode = 0;
 	} else if (s->details->caps & AST_FAX_TECH_SEND) {
@@ -557,12 +939,12 @@ static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_toke
 		goto e_free;
 	}
 
-	if (!(p->timer = ast_timer_open())) {
-		ast_log(LOG_ERROR, "Channel '%s' FAX session '%u' failed to create timing source.\n", s->channame, s->id);
+	if (spandsp_alert_pipe_init(p)) {
+		ast_log(LOG_ERROR, "Channel '%s' FAX session '%u' failed to create alert pipe.\n", s->channame, s->id);
 		goto e_free;
 	}
 
-	s->fd = ast_timer_fd(p->timer);
+	s->fd = p->alert_pipe[0];
 
 	p->stats = &spandsp_global_stats.g711;
 
@@ -586,7 +968,7 @@ static void *spandsp_fax_new(struct ast_fax_session *s, struct ast_fax_tech_toke
 	return p;
 
 e_free:
-	ast_free(p);
+	ao2_ref(p, -1);
 e_return:
 	return NULL;
 }
@@ -604,6 +986,11 @@ static void spandsp_fax_destroy(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
 
+	spandsp_pool_remove(p);
+
+	/* the pool may be processing the session, it stops once detached */
+	ao2_lock(p);
+	p->detached = 1;
 	if (s->details->caps & AST_FAX_TECH_GATEWAY) {
 		spandsp_fax_gateway_cleanup(s);
 	} else if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
@@ -611,8 +998,9 @@ static void spandsp_fax_destroy(struct ast_fax_session *s)
 	} else {
 		session_destroy(p);
 	}
+	ao2_unlock(p);
 
-	ast_free(p);
+	ao2_ref(p, -1);
 	s->tech_pvt = NULL;
 	s->fd = -1;
 }
@@ -622,43 +1010,29 @@ static void spandsp_fax_destroy(struct ast_fax_session *s)
 static struct ast_frame *spandsp_fax_read(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
-	uint8_t buffer[AST_FRIENDLY_OFFSET + SPANDSP_FAX_SAMPLES * sizeof(uint16_t)];
-	int16_t *buf = (int16_t *) (buffer + AST_FRIENDLY_OFFSET);
-	int samples;
-
-	struct ast_frame fax_frame = {
-		.frametype = AST_FRAME_VOICE,
-		.src = "res_fax_spandsp_g711",
-		.subclass.format = ast_format_slin,
-	};
-	struct ast_frame *f = &fax_frame;
+	struct ast_frame *f;
+	char alert;
 
-	if (ast_timer_ack(p->timer, 1) < 0) {
-		ast_log(LOG_ERROR, "Failed to acknowledge timer for FAX session '%u'\n", s->id);
+	/* the pool generates the frames, one alert is written every tick */
+	if (read(p->alert_pipe[0], &alert, 1) < 0 && errno != EAGAIN && errno != EINTR) {
+		ast_log(LOG_ERROR, "Failed to read alert for FAX session '%u'\n", s->id);
 		return NULL;
 	}
 
-	/* XXX do we need to lock here? */
+	ao2_lock(p);
 	if (p->isdone) {
+		ao2_unlock(p);
 		s->state = AST_FAX_STATE_COMPLETE;
 		ast_debug(5, "FAX session '%u' is complete.\n", s->id);
 		return NULL;
 	}
 
-	if (p->ist38) {
-		t38_terminal_send_timeout(&p->t38_state, SPANDSP_FAX_SAMPLES);
-		if ((f = AST_LIST_REMOVE_HEAD(&p->read_frames, frame_list))) {
-			return f;
-		}
-	} else {
-		if ((samples = fax_tx(&p->fax_state, buf, SPANDSP_FAX_SAMPLES)) > 0) {
-			f->samples = samples;
-			AST_FRAME_SET_BUFFER(f, buffer, AST_FRIENDLY_OFFSET, samples * sizeof(int16_t));
-			return ast_frisolate(f);
-		}
+	if ((f = AST_LIST_REMOVE_HEAD(&p->read_frames, frame_list))) {
+		--p->read_count;
 	}
+	ao2_unlock(p);
 
-	return &ast_null_frame;
+	return f ? f : &ast_null_frame;
 }
 
 static void spandsp_v21_tone(void *data, int code, int level, int delay)
@@ -734,6 +1108,7 @@ static int spandsp_v21_detect(struct ast_fax_session *s, const struct ast_frame
 static int spandsp_fax_write(struct ast_fax_session *s, const struct ast_frame *f)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
+	int res;
 
 	if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
 		return spandsp_v21_detect(s, f);
@@ -749,62 +1124,15 @@ static int spandsp_fax_write(struct ast_fax_session *s, const struct ast_frame *
 		return -1;
 	}
 
+	ao2_lock(p);
 	if (p->ist38) {
-		return t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
+		res = t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
 	} else {
-		return fax_rx(&p->fax_state, f->data.ptr, f->samples);
+		res = fax_rx(&p->fax_state, f->data.ptr, f->samples);
 	}
-}
+	ao2_unlock(p);
 
-/*! \brief generate T.30 packets sent to the T.30 leg of gateway
- * \param chan T.30 channel
- * \param data fax session structure
- * \param len not used
- * \param samples no of samples generated
- * \return -1 on failure or 0 on sucess*/
-static int spandsp_fax_gw_t30_gen(struct ast_channel *chan, void *data, int len, int samples)
-{
-	int res = -1;
-	struct ast_fax_session *s = data;
-	struct spandsp_pvt *p = s->tech_pvt;
-	uint8_t buffer[AST_FRIENDLY_OFFSET + samples * sizeof(uint16_t)];
-	struct ast_frame *f;
-	struct ast_frame t30_frame = {
-		.frametype = AST_FRAME_VOICE,
-		.subclass.format = ast_format_slin,
-		.src = "res_fax_spandsp_g711",
-		.samples = samples,
-		.flags = AST_FAX_FRFLAG_GATEWAY,
-	};
-
-	AST_FRAME_SET_BUFFER(&t30_frame, buffer, AST_FRIENDLY_OFFSET, t30_frame.samples * sizeof(int16_t));
-
-	if (!(f = ast_frisolate(&t30_frame))) {
-		return p->isdone ? -1 : res;
-	}
-
-	/* generate a T.30 packet */
-	if ((f->samples = t38_gateway_tx(&p->t38_gw_state, f->data.ptr, f->samples))) {
-		f->datalen = f->samples * sizeof(int16_t);
-		res = ast_write(chan, f);
-	}
-	ast_frfree(f);
-	return p->isdone ? -1 : res;
-}
-
-/*! \brief simple routine to allocate data to generator
- * \param chan channel
- * \param params generator data
- * \return data to use in generator call*/
-static void *spandsp_fax_gw_gen_alloc(struct ast_channel *chan, void *params)
-{
-	ao2_ref(params, +1);
-	return params;
-}
-
-static void spandsp_fax_gw_gen_release(struct ast_channel *chan, void *data)
-{
-	ao2_ref(data, -1);
+	return res;
 }
 
 /*! \brief activate a spandsp gateway based on the information in the given fax session
@@ -814,14 +1142,18 @@ static int spandsp_fax_gateway_start(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
 	struct ast_fax_t38_parameters *t38_param;
+	enum ast_t38_state t38_state;
 	int i;
 	RAII_VAR(struct ast_channel *, peer, NULL, ao2_cleanup);
-	static struct ast_generator t30_gen = {
-		.alloc = spandsp_fax_gw_gen_alloc,
-		.release = spandsp_fax_gw_gen_release,
-		.generate = spandsp_fax_gw_t30_gen,
-	};
 
+	/* query the channels before the session is locked */
+	t38_state = ast_channel_get_t38_state(s->chan);
+	peer = ast_channel_bridge_peer(s->chan);
+	if (!peer) {
+		return -1;
+	}
+
+	ao2_lock(p);
 #if SPANDSP_RELEASE_DATE >= 20081012
 	/* for spandsp shaphots 0.0.6 and higher */
 	p->t38_core_state=&p->t38_gw_state.t38x.t38;
@@ -831,15 +1163,12 @@ static int spandsp_fax_gateway_start(struct ast_fax_session *s)
 #endif
 
 	if (!t38_gateway_init(&p->t38_gw_state, t38_tx_packet_handler, s)) {
+		ao2_unlock(p);
 		return -1;
 	}
 
 	p->ist38 = 1;
-	p->ast_t38_state = ast_channel_get_t38_state(s->chan);
-	peer = ast_channel_bridge_peer(s->chan);
-	if (!peer) {
-		return -1;
-	}
+	p->ast_t38_state = t38_state;
 
 	/* we can be in T38_STATE_NEGOTIATING or T38_STATE_NEGOTIATED when the
 	 * gateway is started. We treat both states the same. */
@@ -847,7 +1176,9 @@ static int spandsp_fax_gateway_start(struct ast_fax_session *s)
 		p->ast_t38_state = T38_STATE_NEGOTIATED;
 	}
 
-	ast_activate_generator(p->ast_t38_state == T38_STATE_NEGOTIATED ? peer : s->chan, &t30_gen , s);
+	/* the pool writes the audio generated for the T.30 leg */
+	p->chan = ast_channel_ref(s->chan);
+	p->t30_chan = ast_channel_ref(p->ast_t38_state == T38_STATE_NEGOTIATED ? peer : s->chan);
 
 	set_logging(&p->t38_gw_state.logging, s->details);
 	set_logging(&p->t38_core_state->logging, s->details);
@@ -881,6 +1212,14 @@ static int spandsp_fax_gateway_start(struct ast_fax_session *s)
 		t38_core_send_indicator(&p->t38_gw_state.t38, T38_IND_NO_SIGNAL, p->t38_gw_state.t38.indicator_tx_count);
 #endif
 	}
+	ao2_unlock(p);
+
+	spandsp_gateway_flush(p);
+
+	if (spandsp_pool_add(p)) {
+		ast_log(LOG_ERROR, "FAX session '%u' failed to join the processing pool.\n", s->id);
+		return -1;
+	}
 
 	s->state = AST_FAX_STATE_ACTIVE;
 
@@ -894,21 +1233,26 @@ static int spandsp_fax_gateway_start(struct ast_fax_session *s)
 static int spandsp_fax_gateway_process(struct ast_fax_session *s, const struct ast_frame *f)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
+	int res = -1;
 
 	/*invalid frame*/
 	if (!f->data.ptr || !f->datalen) {
 		return -1;
 	}
 
+	ao2_lock(p);
 	/* Process a IFP packet */
 	if ((f->frametype == AST_FRAME_MODEM) && (f->subclass.integer == AST_MODEM_T38)) {
-		return t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
+		res = t38_core_rx_ifp_packet(p->t38_core_state, f->data.ptr, f->datalen, f->seqno);
 	} else if ((f->frametype == AST_FRAME_VOICE) &&
 		(ast_format_cmp(f->subclass.format, ast_format_slin) == AST_FORMAT_CMP_EQUAL)) {
-		return t38_gateway_rx(&p->t38_gw_state, f->data.ptr, f->samples);
+		res = t38_gateway_rx(&p->t38_gw_state, f->data.ptr, f->samples);
 	}
+	ao2_unlock(p);
 
-	return -1;
+	spandsp_gateway_flush(p);
+
+	return res;
 }
 
 /*! \brief gather data and clean up after gateway ends
@@ -936,6 +1280,7 @@ static int spandsp_fax_start(struct ast_fax_session *s)
 		return spandsp_fax_gateway_start(s);
 	}
 
+	ao2_lock(p);
 	if (p->ist38) {
 #if SPANDSP_RELEASE_DATE >= 20080725
 		/* for spandsp shaphots 0.0.6 and higher */
@@ -989,11 +1334,11 @@ static int spandsp_fax_start(struct ast_fax_session *s)
 		/* have the fax stack generate silence if it has no data to send */
 		fax_set_transmit_on_idle(&p->fax_state, 1);
 	}
+	ao2_unlock(p);
 
-
-	/* start the timer */
-	if (ast_timer_set_rate(p->timer, SPANDSP_FAX_TIMER_RATE)) {
-		ast_log(LOG_ERROR, "FAX session '%u' error setting rate on timing source.\n", s->id);
+	/* have the pool generate the frames, it already does after a switch to T.38 */
+	if (spandsp_pool_add(p)) {
+		ast_log(LOG_ERROR, "FAX session '%u' failed to join the processing pool.\n", s->id);
 		return -1;
 	}
 
@@ -1007,13 +1352,13 @@ static int spandsp_fax_cancel(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
 
-	if (s->details->caps & AST_FAX_TECH_GATEWAY) {
-		p->isdone = 1;
-		return 0;
+	ao2_lock(p);
+	if (!(s->details->caps & AST_FAX_TECH_GATEWAY)) {
+		t30_terminate(p->t30_state);
 	}
-
-	t30_terminate(p->t30_state);
 	p->isdone = 1;
+	ao2_unlock(p);
+
 	return 0;
 }
 
@@ -1022,6 +1367,9 @@ static int spandsp_fax_switch_to_t38(struct ast_fax_session *s)
 {
 	struct spandsp_pvt *p = s->tech_pvt;
 
+	/* the pool must not generate frames half way through the switch */
+	ao2_lock(p);
+
 	/* prevent the phase E handler from running, this is not a real termination */
 	t30_set_phase_e_handler(p->t30_state, NULL, NULL);
 
@@ -1034,6 +1382,8 @@ static int spandsp_fax_switch_to_t38(struct ast_fax_session *s)
 	p->stats = &spandsp_global_stats.t38;
 	spandsp_fax_start(s);
 
+	ao2_unlock(p);
+
 	return 0;
 }
 
@@ -1044,6 +1394,20 @@ static char *spandsp_fax_cli_show_capabilities(int fd)
 	return  CLI_SUCCESS;
 }
 
+/*! \brief show the processing time of a session in the pool */
+static void spandsp_fax_cli_show_timing(struct spandsp_pvt *p, int fd)
+{
+	if (!p->timing.ticks) {
+		return;
+	}
+
+	ast_cli(fd, "\nProcessing Statistics:\n");
+	ast_cli(fd, "%-22s : %lu\n", "Ticks", p->timing.ticks);
+	ast_cli(fd, "%-22s : %lu\n", "Avg CPU (us)", (unsigned long) (p->cpu_total_us / p->timing.ticks));
+	ast_cli(fd, "%-22s : %u\n", "Max CPU (us)", p->timing.max_cpu_us);
+	ast_cli(fd, "%-22s : %u\n", "Max Late (us)", p->timing.max_late_us);
+}
+
 /*! \brief */
 static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 {
@@ -1051,6 +1415,8 @@ static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 	if (s->details->caps & AST_FAX_TECH_GATEWAY) {
 		struct spandsp_pvt *p = s->tech_pvt;
 
+		ao2_lock(p);
+
 		ast_cli(fd, "%-22s : %u\n", "session", s->id);
 		ast_cli(fd, "%-22s : %s\n", "operation", "Gateway");
 		ast_cli(fd, "%-22s : %s\n", "state", ast_fax_state_to_str(s->state));
@@ -1061,6 +1427,8 @@ static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 			ast_cli(fd, "%-22s : %d\n", "Data Rate", stats.bit_rate);
 			ast_cli(fd, "%-22s : %d\n", "Page Number", stats.pages_transferred + 1);
 		}
+		spandsp_fax_cli_show_timing(p, fd);
+		ao2_unlock(p);
 	} else if (s->details->caps & AST_FAX_TECH_V21_DETECT) {
 		ast_cli(fd, "%-22s : %u\n", "session", s->id);
 		ast_cli(fd, "%-22s : %s\n", "operation", "V.21 Detect");
@@ -1068,6 +1436,7 @@ static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 	} else {
 		struct spandsp_pvt *p = s->tech_pvt;
 
+		ao2_lock(p);
 		ast_cli(fd, "%-22s : %u\n", "session", s->id);
 		ast_cli(fd, "%-22s : %s\n", "operation", (s->details->caps & AST_FAX_TECH_RECEIVE) ? "Receive" : "Transmit");
 		ast_cli(fd, "%-22s : %s\n", "state", ast_fax_state_to_str(s->state));
@@ -1096,6 +1465,8 @@ static char *spandsp_fax_cli_show_session(struct ast_fax_session *s, int fd)
 			ast_cli(fd, "%-22s : %d\n", "Longest Bad Line Run", stats.longest_bad_row_run);
 			ast_cli(fd, "%-22s : %d\n", "Total Bad Lines", stats.bad_rows);
 		}
+		spandsp_fax_cli_show_timing(p, fd);
+		ao2_unlock(p);
 	}
 	ao2_unlock(s);
 	ast_cli(fd, "\n\n");
@@ -1116,6 +1487,7 @@ static void spandsp_manager_fax_session(struct mansession *s,
 	}
 
 	ao2_lock(session);
+	ao2_lock(span_pvt);
 	res = ast_str_append(&message_string, 0, "SessionNumber: %u\r\n", session->id);
 	res |= ast_str_append(&message_string, 0, "Operation: %s\r\n", ast_fax_session_operation_str(session));
 	res |= ast_str_append(&message_string, 0, "State: %s\r\n", ast_fax_state_to_str(session->state));
@@ -1175,6 +1547,7 @@ static void spandsp_manager_fax_session(struct mansession *s,
 
 skip_cap_additions:
 
+	ao2_unlock(span_pvt);
 	ao2_unlock(session);
 
 	if (res < 0) {
@@ -1237,10 +1610,28 @@ static char *spandsp_fax_cli_show_settings(int fd)
 	return CLI_SUCCESS;
 }
 
+/*! \brief */
+static int spandsp_fax_session_timing(struct ast_fax_session *s, struct ast_fax_session_timing *timing)
+{
+	struct spandsp_pvt *p = s->tech_pvt;
+
+	ao2_lock(p);
+	if (!p->timing.ticks) {
+		ao2_unlock(p);
+		return -1;
+	}
+	*timing = p->timing;
+	timing->avg_cpu_us = p->cpu_total_us / p->timing.ticks;
+	ao2_unlock(p);
+
+	return 0;
+}
+
 /*! \brief unload res_fax_spandsp */
 static int unload_module(void)
 {
 	ast_fax_tech_unregister(&spandsp_fax_tech);
+	spandsp_pool_stop();
 	ast_mutex_destroy(&spandsp_global_stats.lock);
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -1249,9 +1640,17 @@ static int unload_module(void)
 static int load_module(void)
 {
 	ast_mutex_init(&spandsp_global_stats.lock);
+	if (spandsp_pool_start()) {
+		spandsp_pool_stop();
+		ast_mutex_destroy(&spandsp_global_stats.lock);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	spandsp_fax_tech.module = ast_module_info->self;
 	if (ast_fax_tech_register(&spandsp_fax_tech) < 0) {
 		ast_log(LOG_ERROR, "failed to register FAX technology\n");
+		spandsp_pool_stop();
+		ast_mutex_destroy(&spandsp_global_stats.lock);
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
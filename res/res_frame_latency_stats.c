@@ -0,0 +1,116 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \brief Statsd frame latency stats.
+ *
+ * This module periodically sends the latency of the media frames sampled
+ * at every translation path, bridge technology and channel type.
+ *
+ * \since 15.0.0
+ */
+
+/*** MODULEINFO
+	<depend>res_statsd</depend>
+	<defaultenabled>no</defaultenabled>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/frame_latency.h"
+#include "asterisk/module.h"
+#include "asterisk/sched.h"
+#include "asterisk/statsd.h"
+
+/*! Milliseconds between reports */
+#define FRAME_LATENCY_STATS_INTERVAL 10000
+
+/*! Scheduler sending the reports */
+static struct ast_sched_context *sched;
+
+/*!
+ * \internal
+ * \brief Send the latency of one point.
+ */
+static int send_point_stats(const char *point, const char *name,
+	const struct ast_frame_latency *latency, void *arg)
+{
+	char *metric = ast_strdupa(name);
+	char *pos;
+	int i;
+
+	/* Translation paths and technology names may contain characters that mean something to statsd. */
+	for (pos = metric; *pos; ++pos) {
+		if (strchr(".:|@/ ", *pos)) {
+			*pos = '_';
+		}
+	}
+
+	ast_statsd_log_full_va("frame_latency.%s.%s.samples", AST_STATSD_GAUGE, latency->samples, 1.0,
+		point, metric);
+	if (latency->samples) {
+		ast_statsd_log_full_va("frame_latency.%s.%s.avg_us", AST_STATSD_GAUGE,
+			latency->total_us / latency->samples, 1.0, point, metric);
+	}
+	ast_statsd_log_full_va("frame_latency.%s.%s.max_us", AST_STATSD_GAUGE, latency->max_us, 1.0,
+		point, metric);
+	for (i = 0; i < AST_FRAME_LATENCY_BUCKETS; ++i) {
+		ast_statsd_log_full_va("frame_latency.%s.%s.%s", AST_STATSD_GAUGE, latency->histogram[i], 1.0,
+			point, metric, ast_frame_latency_bucket_label(i));
+	}
+
+	return 0;
+}
+
+static int send_all_point_stats(const void *data)
+{
+	ast_frame_latency_foreach(send_point_stats, NULL);
+
+	/* Run again after the same interval. */
+	return 1;
+}
+
+static int unload_module(void)
+{
+	ast_sched_context_destroy(sched);
+	sched = NULL;
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	sched = ast_sched_context_create();
+	if (!sched) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if (ast_sched_start_thread(sched)
+		|| ast_sched_add(sched, FRAME_LATENCY_STATS_INTERVAL, send_all_point_stats, NULL) < 0) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Frame latency statistics",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.nonoptreq = "res_statsd"
+	);
@@ -78,6 +78,19 @@
 				<configOption name="capture_id" default="0">
 					<synopsis>The ID for this capture agent.</synopsis>
 				</configOption>
+				<configOption name="queue_size" default="2000">
+					<synopsis>The most packets waiting to be sent to Homer.</synopsis>
+					<description><para>Packets captured while this many are already
+					waiting to be sent are dropped and counted in
+					<literal>hep show status</literal>.</para>
+					</description>
+				</configOption>
+				<configOption name="sample_percent" default="100">
+					<synopsis>The percentage of calls to capture.</synopsis>
+					<description><para>Calls are chosen by a hash of their SIP Call-ID,
+					so either every packet of a call is captured or none is.</para>
+					</description>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -87,8 +100,11 @@
 
 #include "asterisk/module.h"
 #include "asterisk/astobj2.h"
+#include "asterisk/cli.h"
 #include "asterisk/config_options.h"
+#include "asterisk/lock.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/vector.h"
 #include "asterisk/res_hep.h"
 
 #include <netinet/ip.h>
@@ -98,6 +114,9 @@
 
 #define DEFAULT_HEP_SERVER ""
 
+/*! Most packets handed to the kernel by one system call */
+#define HEP_SEND_BATCH 32
+
 /*! Generic vendor ID. Used for HEPv3 standard packets */
 #define GENERIC_VENDOR_ID 0x0000
 
@@ -238,6 +257,8 @@ struct hep_generic {
 struct hepv3_global_config {
 	unsigned int enabled;                    /*!< Whether or not sending is enabled */
 	unsigned int capture_id;                 /*!< Capture ID for this agent */
+	unsigned int queue_size;                 /*!< Most packets waiting to be sent */
+	unsigned int sample_percent;             /*!< Percentage of calls to capture */
 	enum hep_uuid_type uuid_type;            /*!< The preferred type of the UUID */
 	AST_DECLARE_STRING_FIELDS(
 		AST_STRING_FIELD(capture_address);   /*!< Address to send to */
@@ -279,6 +300,22 @@ static AO2_GLOBAL_OBJ_STATIC(global_data);
 
 static struct ast_taskprocessor *hep_queue_tp;
 
+/*! \brief Protects the packets waiting to be sent */
+AST_MUTEX_DEFINE_STATIC(hep_pending_lock);
+/*! \brief Packets waiting to be sent by \ref hep_queue_cb */
+static AST_VECTOR(hep_pending_packets, struct hepv3_capture_info *) hep_pending;
+/*! \brief Has a \ref hep_queue_cb been pushed that has not yet taken the pending packets? */
+static int hep_drain_scheduled;
+
+/*! \brief Settings copied from the configuration for the capture paths */
+static unsigned int hep_queue_size = 2000;
+static unsigned int hep_sample_percent = 100;
+
+/*! \brief Statistics shown by 'hep show status' */
+static int hep_sent;
+static int hep_dropped;
+static int hep_sampled_out;
+
 static void *module_config_alloc(void);
 static void hepv3_config_post_apply(void);
 
@@ -442,27 +479,53 @@ struct hepv3_capture_info *hepv3_create_capture_info(const void *payload, size_t
 	return info;
 }
 
-/*! \brief Callback function for the \ref hep_queue_tp taskprocessor */
-static int hep_queue_cb(void *data)
+int hepv3_is_call_sampled(const char *call_id, size_t len)
+{
+	unsigned int percent = hep_sample_percent;
+	unsigned int hash = 0;
+	size_t i;
+
+	if (percent >= 100) {
+		return 1;
+	}
+
+	/* The same hash as ast_str_hash(), over a string which need not be terminated */
+	for (i = 0; i < len && call_id[i]; i++) {
+		hash = hash * 33 ^ (unsigned char) call_id[i];
+	}
+
+	if (hash % 100 < percent) {
+		return 1;
+	}
+
+	ast_atomic_fetchadd_int(&hep_sampled_out, 1);
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Build the HEPv3 packet for a capture
+ *
+ * \param config The module configuration
+ * \param capture_info The captured packet
+ * \param[out] packet_len_out Length of the returned packet
+ *
+ * \return The packet, which the caller must ast_free
+ * \retval NULL on error
+ */
+static void *hep_build_packet(struct module_config *config,
+	struct hepv3_capture_info *capture_info, unsigned int *packet_len_out)
 {
-	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
-	RAII_VAR(struct hepv3_capture_info *, capture_info, data, ao2_cleanup);
 	struct hep_generic hg_pkt;
 	unsigned int packet_len = 0, sock_buffer_len;
 	struct hep_chunk_ip4 ipv4_src, ipv4_dst;
 	struct hep_chunk_ip6 ipv6_src, ipv6_dst;
 	struct hep_chunk auth_key, payload, uuid;
 	void *sock_buffer;
-	int res;
-
-	if (!capture_info || !config || !hepv3_data) {
-		return 0;
-	}
 
 	if (ast_sockaddr_is_ipv4(&capture_info->src_addr) != ast_sockaddr_is_ipv4(&capture_info->dst_addr)) {
 		ast_log(AST_LOG_NOTICE, "Unable to send packet: Address Family mismatch between source/destination\n");
-		return -1;
+		return NULL;
 	}
 
 	packet_len = sizeof(hg_pkt);
@@ -516,7 +579,7 @@ static int hep_queue_cb(void *data)
 	/* Build the buffer to send */
 	sock_buffer = ast_malloc(packet_len);
 	if (!sock_buffer) {
-		return -1;
+		return NULL;
 	}
 
 	/* Copy in the header */
@@ -558,38 +621,196 @@ static int hep_queue_cb(void *data)
 
 	ast_assert(sock_buffer_len == packet_len);
 
-	res = ast_sendto(hepv3_data->sockfd, sock_buffer, sock_buffer_len, 0, &hepv3_data->remote_addr);
-	if (res < 0) {
-		ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
-			errno, strerror(errno));
-	} else if (res != sock_buffer_len) {
-		ast_log(AST_LOG_WARNING, "Failed to send complete packet to HEPv3 server: %d of %u sent\n",
-			res, sock_buffer_len);
-		res = -1;
+	*packet_len_out = packet_len;
+	return sock_buffer;
+}
+
+/*!
+ * \internal
+ * \brief Send built packets to the HEPv3 server
+ *
+ * \note On systems with sendmmsg(2) all of the packets are handed to the
+ * kernel with one system call.
+ */
+static void hep_send_packets(struct hepv3_runtime_data *hepv3_data, void **packets,
+	unsigned int *lens, int count)
+{
+#ifdef MSG_WAITFORONE
+	/* sendmmsg(2) is available */
+	struct mmsghdr msgs[HEP_SEND_BATCH];
+	struct iovec iov[HEP_SEND_BATCH];
+	int sent = 0;
+	int res;
+	int i;
+
+	memset(msgs, 0, sizeof(msgs));
+	for (i = 0; i < count; i++) {
+		iov[i].iov_base = packets[i];
+		iov[i].iov_len = lens[i];
+		msgs[i].msg_hdr.msg_name = &hepv3_data->remote_addr.ss;
+		msgs[i].msg_hdr.msg_namelen = hepv3_data->remote_addr.len;
+		msgs[i].msg_hdr.msg_iov = &iov[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+	}
+
+	while (sent < count) {
+		res = sendmmsg(hepv3_data->sockfd, msgs + sent, count - sent, 0);
+		if (res < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			ast_log(AST_LOG_ERROR, "Error [%d] while sending packets to HEPv3 server: %s\n",
+				errno, strerror(errno));
+			break;
+		}
+		sent += res;
+	}
+	ast_atomic_fetchadd_int(&hep_sent, sent);
+#else
+	int res;
+	int i;
+
+	for (i = 0; i < count; i++) {
+		res = ast_sendto(hepv3_data->sockfd, packets[i], lens[i], 0, &hepv3_data->remote_addr);
+		if (res < 0) {
+			ast_log(AST_LOG_ERROR, "Error [%d] while sending packet to HEPv3 server: %s\n",
+				errno, strerror(errno));
+		} else if (res != lens[i]) {
+			ast_log(AST_LOG_WARNING, "Failed to send complete packet to HEPv3 server: %d of %u sent\n",
+				res, lens[i]);
+		} else {
+			ast_atomic_fetchadd_int(&hep_sent, 1);
+		}
+	}
+#endif
+}
+
+/*!
+ * \brief Callback function for the \ref hep_queue_tp taskprocessor
+ *
+ * Sends every packet queued since the callback was pushed.
+ */
+static int hep_queue_cb(void *data)
+{
+	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
+	RAII_VAR(struct hepv3_runtime_data *, hepv3_data, ao2_global_obj_ref(global_data), ao2_cleanup);
+	struct hep_pending_packets captures;
+	void *packets[HEP_SEND_BATCH];
+	unsigned int lens[HEP_SEND_BATCH];
+	int count = 0;
+	size_t i;
+
+	ast_mutex_lock(&hep_pending_lock);
+	captures = hep_pending;
+	AST_VECTOR_INIT(&hep_pending, 0);
+	hep_drain_scheduled = 0;
+	ast_mutex_unlock(&hep_pending_lock);
+
+	for (i = 0; i < AST_VECTOR_SIZE(&captures); i++) {
+		struct hepv3_capture_info *capture_info = AST_VECTOR_GET(&captures, i);
+
+		if (config && hepv3_data) {
+			packets[count] = hep_build_packet(config, capture_info, &lens[count]);
+			if (packets[count]) {
+				count++;
+			}
+		}
+		ao2_ref(capture_info, -1);
+
+		if (count == HEP_SEND_BATCH) {
+			hep_send_packets(hepv3_data, packets, lens, count);
+			while (count) {
+				ast_free(packets[--count]);
+			}
+		}
 	}
 
-	ast_free(sock_buffer);
-	return res;
+	if (count) {
+		hep_send_packets(hepv3_data, packets, lens, count);
+		while (count) {
+			ast_free(packets[--count]);
+		}
+	}
+
+	AST_VECTOR_FREE(&captures);
+	return 0;
 }
 
 int hepv3_send_packet(struct hepv3_capture_info *capture_info)
 {
 	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
-	int res;
+	int schedule;
 
 	if (!config || !config->general->enabled) {
 		ao2_ref(capture_info, -1);
 		return 0;
 	}
 
-	res = ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, capture_info);
-	if (res == -1) {
+	ast_mutex_lock(&hep_pending_lock);
+	if (AST_VECTOR_SIZE(&hep_pending) >= hep_queue_size
+		|| AST_VECTOR_APPEND(&hep_pending, capture_info)) {
+		ast_mutex_unlock(&hep_pending_lock);
+		ast_atomic_fetchadd_int(&hep_dropped, 1);
 		ao2_ref(capture_info, -1);
+		return -1;
+	}
+	/* One pushed callback sends everything queued before it runs */
+	schedule = !hep_drain_scheduled;
+	hep_drain_scheduled = 1;
+	ast_mutex_unlock(&hep_pending_lock);
+
+	if (schedule && ast_taskprocessor_push(hep_queue_tp, hep_queue_cb, NULL)) {
+		/* The packet stays queued for the next successful push */
+		ast_mutex_lock(&hep_pending_lock);
+		hep_drain_scheduled = 0;
+		ast_mutex_unlock(&hep_pending_lock);
+		return -1;
+	}
+
+	return 0;
+}
+
+static char *handle_hep_show_status(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	RAII_VAR(struct module_config *, config, ao2_global_obj_ref(global_config), ao2_cleanup);
+	size_t queued;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "hep show status";
+		e->usage =
+			"Usage: hep show status\n"
+			"       Show the state of packet capturing to Homer.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
 	}
 
-	return res;
+	ast_mutex_lock(&hep_pending_lock);
+	queued = AST_VECTOR_SIZE(&hep_pending);
+	ast_mutex_unlock(&hep_pending_lock);
+
+	ast_cli(a->fd, "Enabled:          %s\n",
+		config && config->general->enabled ? "Yes" : "No");
+	ast_cli(a->fd, "Capture address:  %s\n",
+		config ? config->general->capture_address : "");
+	ast_cli(a->fd, "Calls captured:   %u%%\n", hep_sample_percent);
+	ast_cli(a->fd, "Packets queued:   %zu of %u\n", queued, hep_queue_size);
+	ast_cli(a->fd, "Packets sent:     %d\n", hep_sent);
+	ast_cli(a->fd, "Packets dropped:  %d\n", hep_dropped);
+	ast_cli(a->fd, "Packets skipped:  %d\n", hep_sampled_out);
+
+	return CLI_SUCCESS;
 }
 
+static struct ast_cli_entry cli_hep[] = {
+	AST_CLI_DEFINE(handle_hep_show_status, "Show the state of packet capturing to Homer"),
+};
+
 /*!
  * \brief Post-apply callback for the config framework.
  *
@@ -601,6 +822,9 @@ static void hepv3_config_post_apply(void)
 	RAII_VAR(struct module_config *, mod_cfg, ao2_global_obj_ref(global_config), ao2_cleanup);
 	struct hepv3_runtime_data *data;
 
+	hep_queue_size = mod_cfg->general->queue_size;
+	hep_sample_percent = mod_cfg->general->sample_percent;
+
 	data = hepv3_data_alloc(mod_cfg->general);
 	if (!data) {
 		return;
@@ -626,8 +850,12 @@ static int reload_module(void)
  */
 static int unload_module(void)
 {
+	ast_cli_unregister_multiple(cli_hep, ARRAY_LEN(cli_hep));
 	hep_queue_tp = ast_taskprocessor_unreference(hep_queue_tp);
 
+	AST_VECTOR_CALLBACK_VOID(&hep_pending, ao2_cleanup);
+	AST_VECTOR_FREE(&hep_pending);
+
 	ao2_global_obj_release(global_config);
 	ao2_global_obj_release(global_data);
 	aco_info_destroy(&cfg_info);
@@ -654,11 +882,15 @@ static int load_module(void)
 	aco_option_register(&cfg_info, "capture_password", ACO_EXACT, global_options, "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct hepv3_global_config, capture_password));
 	aco_option_register(&cfg_info, "capture_id", ACO_EXACT, global_options, "0", OPT_UINT_T, 0, STRFLDSET(struct hepv3_global_config, capture_id));
 	aco_option_register_custom(&cfg_info, "uuid_type", ACO_EXACT, global_options, "call-id", uuid_type_handler, 0);
+	aco_option_register(&cfg_info, "queue_size", ACO_EXACT, global_options, "2000", OPT_UINT_T, 0, FLDSET(struct hepv3_global_config, queue_size));
+	aco_option_register(&cfg_info, "sample_percent", ACO_EXACT, global_options, "100", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct hepv3_global_config, sample_percent), 0, 100);
 
 	if (aco_process_config(&cfg_info, 0) == ACO_PROCESS_ERROR) {
 		goto error;
 	}
 
+	ast_cli_register_multiple(cli_hep, ARRAY_LEN(cli_hep));
+
 	return AST_MODULE_LOAD_SUCCESS;
 
 error:
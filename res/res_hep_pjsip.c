@@ -82,6 +82,11 @@ static pj_status_t logging_on_tx_msg(pjsip_tx_data *tdata)
 	pjsip_to_hdr *to_hdr;
 	pjsip_tpmgr_fla2_param prm;
 
+	cid_hdr = PJSIP_MSG_CID_HDR(tdata->msg);
+	if (!cid_hdr || !hepv3_is_call_sampled(pj_strbuf(&cid_hdr->id), pj_strlen(&cid_hdr->id))) {
+		return PJ_SUCCESS;
+	}
+
 	capture_info = hepv3_create_capture_info(tdata->buf.start, (size_t)(tdata->buf.cur - tdata->buf.start));
 	if (!capture_info) {
 		return PJ_SUCCESS;
@@ -111,7 +116,6 @@ static pj_status_t logging_on_tx_msg(pjsip_tx_data *tdata)
 	}
 	pj_sockaddr_print(&tdata->tp_info.dst_addr, remote_buf, sizeof(remote_buf), 3);
 
-	cid_hdr = PJSIP_MSG_CID_HDR(tdata->msg);
 	from_hdr = PJSIP_MSG_FROM_HDR(tdata->msg);
 	to_hdr = PJSIP_MSG_TO_HDR(tdata->msg);
 
@@ -142,6 +146,11 @@ static pj_bool_t logging_on_rx_msg(pjsip_rx_data *rdata)
 	struct hepv3_capture_info *capture_info;
 	pjsip_tpmgr_fla2_param prm;
 
+	if (!rdata->msg_info.cid
+		|| !hepv3_is_call_sampled(pj_strbuf(&rdata->msg_info.cid->id), pj_strlen(&rdata->msg_info.cid->id))) {
+		return PJ_FALSE;
+	}
+
 	capture_info = hepv3_create_capture_info(&rdata->pkt_info.packet, rdata->pkt_info.len);
 	if (!capture_info) {
 		return PJ_SUCCESS;
@@ -43,25 +43,58 @@
 
 static struct stasis_subscription *stasis_rtp_subscription;
 
+/*!
+ * \internal
+ * \brief Get the SIP Call-ID of a PJSIP channel
+ *
+ * \return The Call-ID, which the caller must ast_free
+ * \retval NULL if the channel is not a PJSIP channel or has no Call-ID
+ */
+static char *get_call_id(const char *channel_name)
+{
+	struct ast_channel *chan;
+	char buf[128];
+	char *call_id = NULL;
+
+	if (!ast_begins_with(channel_name, "PJSIP")) {
+		return NULL;
+	}
+
+	chan = ast_channel_get_by_name(channel_name);
+	if (chan && !ast_func_read(chan, "CHANNEL(pjsip,call-id)", buf, sizeof(buf))) {
+		call_id = ast_strdup(buf);
+	}
+	ast_channel_cleanup(chan);
+
+	return call_id;
+}
+
 static char *assign_uuid(struct ast_json *json_channel)
 {
 	const char *channel_name = ast_json_string_get(ast_json_object_get(json_channel, "name"));
 	enum hep_uuid_type uuid_type = hepv3_get_uuid_type();
+	char *call_id;
 	char *uuid = NULL;
 
 	if (!channel_name) {
 		return NULL;
 	}
 
-	if (uuid_type == HEP_UUID_TYPE_CALL_ID && ast_begins_with(channel_name, "PJSIP")) {
-		struct ast_channel *chan = ast_channel_get_by_name(channel_name);
-		char buf[128];
-
-		if (chan && !ast_func_read(chan, "CHANNEL(pjsip,call-id)", buf, sizeof(buf))) {
-			uuid = ast_strdup(buf);
-		}
+	/*
+	 * Calls are sampled by their SIP Call-ID, so that RTCP is captured for
+	 * the same calls as their signalling.  Other channels go by name.
+	 */
+	call_id = get_call_id(channel_name);
+	if (!hepv3_is_call_sampled(call_id ? call_id : channel_name,
+		strlen(call_id ? call_id : channel_name))) {
+		ast_free(call_id);
+		return NULL;
+	}
 
-		ast_channel_cleanup(chan);
+	if (uuid_type == HEP_UUID_TYPE_CALL_ID && call_id) {
+		uuid = call_id;
+	} else {
+		ast_free(call_id);
 	}
 
 	/* If we couldn't get the call-id or didn't want it, just use the channel name */
@@ -81,6 +114,7 @@ static void rtcp_message_handler(struct stasis_message *message)
 	struct ast_json *json_channel;
 	struct ast_json *json_rtcp;
 	struct hepv3_capture_info *capture_info;
+	char *uuid;
 	struct ast_json *from;
 	struct ast_json *to;
 	struct timeval current_time = ast_tvnow();
@@ -111,23 +145,26 @@ static void rtcp_message_handler(struct stasis_message *message)
 		return;
 	}
 
+	uuid = assign_uuid(json_channel);
+	if (!uuid) {
+		return;
+	}
+
 	payload = ast_json_dump_string(json_rtcp);
 	if (ast_strlen_zero(payload)) {
+		ast_free(uuid);
 		return;
 	}
 
 	capture_info = hepv3_create_capture_info(payload, strlen(payload));
 	if (!capture_info) {
+		ast_free(uuid);
 		return;
 	}
 	ast_sockaddr_parse(&capture_info->src_addr, ast_json_string_get(from), PARSE_PORT_REQUIRE);
 	ast_sockaddr_parse(&capture_info->dst_addr, ast_json_string_get(to), PARSE_PORT_REQUIRE);
 
-	capture_info->uuid = assign_uuid(json_channel);
-	if (!capture_info->uuid) {
-		ao2_ref(capture_info, -1);
-		return;
-	}
+	capture_info->uuid = uuid;
 	capture_info->capture_time = current_time;
 	capture_info->capture_type = HEPV3_CAPTURE_TYPE_RTCP;
 	capture_info->zipped = 0;
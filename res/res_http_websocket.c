@@ -37,6 +37,8 @@
 #include "asterisk/unaligned.h"
 #include "asterisk/uri.h"
 #include "asterisk/uuid.h"
+#include "asterisk/taskprocessor.h"
+#include "asterisk/threadpool.h"
 
 #define AST_API_MODULE
 #include "asterisk/http_websocket.h"
@@ -97,9 +99,33 @@ struct ast_websocket {
 	unsigned int closing:1;            /*!< Bit to indicate that the session is in the process of being closed */
 	unsigned int close_sent:1;         /*!< Bit to indicate that the session close opcode has been sent and no further data will be sent */
 	struct websocket_client *client;   /*!< Client object when connected as a client websocket */
+	struct websocket_send_queue *send_queue; /*!< Frames waiting to be written, if frames are queued */
 	char session_id[AST_UUID_STR_LEN]; /*!< The identifier for the websocket session */
 };
 
+/*! \brief A frame waiting in a send queue */
+struct websocket_send_frame {
+	AST_LIST_ENTRY(websocket_send_frame) list;
+	char *payload;                     /*!< Payload buffer from ast_websocket_payload_alloc() */
+	uint64_t payload_size;             /*!< Length of the payload */
+	enum ast_websocket_opcode opcode;  /*!< Opcode of the frame */
+};
+
+/*! \brief Frames of a session waiting to be written by its sender */
+struct websocket_send_queue {
+	AST_LIST_HEAD_NOLOCK(, websocket_send_frame) frames; /*!< Queued frames, oldest first */
+	uint64_t queued;                   /*!< Payload bytes queued */
+	size_t high_water;                 /*!< Most payload bytes queued before policy applies */
+	enum ast_websocket_send_queue_policy policy; /*!< What happens to frames above high_water */
+	struct ast_taskprocessor *sender;  /*!< Serializer writing the queued frames */
+	unsigned long dropped;             /*!< Frames dropped by policy */
+	unsigned int scheduled:1;          /*!< The sender has been asked to write the queue */
+	unsigned int overflowed:1;         /*!< The queue overflowed with the disconnect policy */
+};
+
+/*! \brief Threads writing the send queues of the sessions */
+static struct ast_threadpool *send_pool;
+
 /*! \brief Hashing function for protocols */
 static int protocol_hash_fn(const void *obj, const int flags)
 {
@@ -188,6 +214,7 @@ static void session_destroy_fn(void *obj)
 	}
 
 	ao2_cleanup(session->client);
+	ao2_cleanup(session->send_queue);
 	ast_free(session->payload);
 }
 
@@ -344,13 +371,13 @@ static const char *websocket_opcode2str(enum ast_websocket_opcode opcode)
 	}
 }
 
-/*! \brief Write function for websocket traffic */
-int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
+/*! \brief Write a frame to the socket of a session */
+static int websocket_write_frame(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
 {
 	size_t header_size = 2; /* The minimum size of a websocket frame is 2 bytes */
-	char *frame;
+	char header[MAX_WS_HDR_SZ];
+	struct iovec iov[2];
 	uint64_t length;
-	uint64_t frame_size;
 
 	ast_debug(3, "Writing websocket %s frame, length %" PRIu64 "\n",
 			websocket_opcode2str(opcode), payload_size);
@@ -367,22 +394,21 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 		header_size += 8;
 	}
 
-	frame_size = header_size + payload_size;
-
-	frame = ast_alloca(frame_size + 1);
-	memset(frame, 0, frame_size + 1);
-
-	frame[0] = opcode | 0x80;
-	frame[1] = length;
+	header[0] = opcode | 0x80;
+	header[1] = length;
 
 	/* Use the additional available bytes to store the length */
 	if (length == 126) {
-		put_unaligned_uint16(&frame[2], htons(payload_size));
+		put_unaligned_uint16(&header[2], htons(payload_size));
 	} else if (length == 127) {
-		put_unaligned_uint64(&frame[2], htonll(payload_size));
+		put_unaligned_uint64(&header[2], htonll(payload_size));
 	}
 
-	memcpy(&frame[header_size], payload, payload_size);
+	/* The header and the payload go out together without copying the payload. */
+	iov[0].iov_base = header;
+	iov[0].iov_len = header_size;
+	iov[1].iov_base = payload;
+	iov[1].iov_len = payload_size;
 
 	ao2_lock(session);
 	if (session->closing) {
@@ -391,7 +417,7 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 	}
 
 	ast_iostream_set_timeout_sequence(session->stream, ast_tvnow(), session->timeout);
-	if (ast_iostream_write(session->stream, frame, frame_size) != frame_size) {
+	if (ast_iostream_writev(session->stream, iov, payload_size ? 2 : 1) != header_size + payload_size) {
 		ao2_unlock(session);
 		/* 1011 - server terminating connection due to not being able to fulfill the request */
 		ast_debug(1, "Closing WS with 1011 because we can't fulfill a write request\n");
@@ -405,6 +431,209 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, en
 	return 0;
 }
 
+static void websocket_send_frame_free(struct websocket_send_frame *frame)
+{
+	ao2_cleanup(frame->payload);
+	ast_free(frame);
+}
+
+static void websocket_send_queue_flush(struct websocket_send_queue *queue)
+{
+	struct websocket_send_frame *frame;
+
+	while ((frame = AST_LIST_REMOVE_HEAD(&queue->frames, list))) {
+		websocket_send_frame_free(frame);
+	}
+	queue->queued = 0;
+}
+
+static void websocket_send_queue_dtor(void *obj)
+{
+	struct websocket_send_queue *queue = obj;
+
+	websocket_send_queue_flush(queue);
+	ast_taskprocessor_unreference(queue->sender);
+}
+
+/*! \brief Sender task writing the queued frames of a session */
+static int websocket_send_queue_drain(void *data)
+{
+	struct ast_websocket *session = data;
+	struct websocket_send_queue *queue = session->send_queue;
+	struct websocket_send_frame *frame;
+	int overflowed;
+
+	for (;;) {
+		ao2_lock(queue);
+		frame = AST_LIST_REMOVE_HEAD(&queue->frames, list);
+		if (frame) {
+			queue->queued -= frame->payload_size;
+		} else {
+			queue->scheduled = 0;
+		}
+		overflowed = queue->overflowed;
+		ao2_unlock(queue);
+
+		if (!frame) {
+			break;
+		}
+		websocket_write_frame(session, frame->opcode, frame->payload, frame->payload_size);
+		websocket_send_frame_free(frame);
+	}
+
+	if (overflowed) {
+		/* 1008 - policy violation, the client did not keep up */
+		ast_websocket_close(session, 1008);
+	}
+
+	ao2_ref(session, -1);
+	return 0;
+}
+
+/*!
+ * \brief Queue a frame to be written by the sender of a session
+ *
+ * \param session Pointer to the WebSocket session, which has a send queue
+ * \param opcode WebSocket operation code to place in the frame
+ * \param payload Payload buffer from ast_websocket_payload_alloc(), a reference is taken
+ * \param payload_size Length of the payload
+ *
+ * \retval 0 if queued or dropped by policy
+ * \retval -1 if the session is closing or was disconnected by policy
+ */
+static int websocket_queue_frame(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
+{
+	struct websocket_send_queue *queue = session->send_queue;
+	struct websocket_send_frame *frame;
+
+	ao2_lock(queue);
+	if (session->closing || queue->overflowed) {
+		ao2_unlock(queue);
+		return -1;
+	}
+
+	/* A frame larger than the high water mark still goes out on an empty queue. */
+	if (queue->queued && queue->queued + payload_size > queue->high_water) {
+		if (queue->policy == AST_WEBSOCKET_SEND_QUEUE_DROP) {
+			if (!queue->dropped++) {
+				ast_log(LOG_WARNING, "WebSocket %s send queue is full, dropping frames\n",
+					session->session_id);
+			}
+			ao2_unlock(queue);
+			return 0;
+		}
+
+		ast_log(LOG_WARNING, "WebSocket %s send queue is full, disconnecting\n",
+			session->session_id);
+		queue->overflowed = 1;
+		websocket_send_queue_flush(queue);
+		ao2_unlock(queue);
+		return -1;
+	}
+
+	frame = ast_calloc(1, sizeof(*frame));
+	if (!frame) {
+		ao2_unlock(queue);
+		return -1;
+	}
+	ao2_ref(payload, +1);
+	frame->payload = payload;
+	frame->payload_size = payload_size;
+	frame->opcode = opcode;
+	AST_LIST_INSERT_TAIL(&queue->frames, frame, list);
+	queue->queued += payload_size;
+
+	if (!queue->scheduled) {
+		ao2_ref(session, +1);
+		if (ast_taskprocessor_push(queue->sender, websocket_send_queue_drain, session)) {
+			ao2_ref(session, -1);
+			AST_LIST_REMOVE(&queue->frames, frame, list);
+			queue->queued -= payload_size;
+			websocket_send_frame_free(frame);
+			ao2_unlock(queue);
+			return -1;
+		}
+		queue->scheduled = 1;
+	}
+	ao2_unlock(queue);
+
+	return 0;
+}
+
+char *AST_OPTIONAL_API_NAME(ast_websocket_payload_alloc)(size_t size)
+{
+	return ao2_alloc_options(size ? size : 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+}
+
+int AST_OPTIONAL_API_NAME(ast_websocket_write_payload)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
+{
+	if (session->send_queue) {
+		return websocket_queue_frame(session, opcode, payload, payload_size);
+	}
+	return websocket_write_frame(session, opcode, payload, payload_size);
+}
+
+/*! \brief Write function for websocket traffic */
+int AST_OPTIONAL_API_NAME(ast_websocket_write)(struct ast_websocket *session, enum ast_websocket_opcode opcode, char *payload, uint64_t payload_size)
+{
+	char *buf;
+	int res;
+
+	if (!session->send_queue) {
+		return websocket_write_frame(session, opcode, payload, payload_size);
+	}
+
+	/* The caller's buffer is not ours to keep, so queue a copy. */
+	buf = ast_websocket_payload_alloc(payload_size);
+	if (!buf) {
+		return -1;
+	}
+	memcpy(buf, payload, payload_size);
+	res = websocket_queue_frame(session, opcode, buf, payload_size);
+	ao2_ref(buf, -1);
+
+	return res;
+}
+
+int AST_OPTIONAL_API_NAME(ast_websocket_set_send_queue)(struct ast_websocket *session, size_t high_water, enum ast_websocket_send_queue_policy policy)
+{
+	static int seq;
+	struct websocket_send_queue *queue;
+	char name[AST_TASKPROCESSOR_MAX_NAME + 1];
+
+	ao2_lock(session);
+	queue = session->send_queue;
+	if (!queue) {
+		if (!send_pool) {
+			ao2_unlock(session);
+			return -1;
+		}
+
+		queue = ao2_alloc(sizeof(*queue), websocket_send_queue_dtor);
+		if (!queue) {
+			ao2_unlock(session);
+			return -1;
+		}
+		ast_taskprocessor_build_name(name, sizeof(name), "websocket/send-%08x",
+			(unsigned int) ast_atomic_fetchadd_int(&seq, +1));
+		queue->sender = ast_threadpool_serializer(name, send_pool);
+		if (!queue->sender) {
+			ao2_ref(queue, -1);
+			ao2_unlock(session);
+			return -1;
+		}
+		session->send_queue = queue;
+	}
+
+	ao2_lock(queue);
+	queue->high_water = high_water;
+	queue->policy = policy;
+	ao2_unlock(queue);
+	ao2_unlock(session);
+
+	return 0;
+}
+
 void AST_OPTIONAL_API_NAME(ast_websocket_reconstruct_enable)(struct ast_websocket *session, size_t bytes)
 {
 	session->reconstruct = MIN(bytes, MAXIMUM_RECONSTRUCTION_CEILING);
@@ -1437,10 +1666,24 @@ int AST_OPTIONAL_API_NAME(ast_websocket_write_string)
 
 static int load_module(void)
 {
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 60,
+		.auto_increment = 1,
+		.initial_size = 0,
+		.max_size = 0,
+	};
+
 	websocketuri.data = websocket_server_internal_create();
 	if (!websocketuri.data) {
 		return AST_MODULE_LOAD_FAILURE;
 	}
+	send_pool = ast_threadpool_create("websocket-send", NULL, &options);
+	if (!send_pool) {
+		ao2_ref(websocketuri.data, -1);
+		websocketuri.data = NULL;
+		return AST_MODULE_LOAD_FAILURE;
+	}
 	ast_http_uri_link(&websocketuri);
 	websocket_add_protocol_internal("echo", websocket_echo_callback);
 
@@ -1453,6 +1696,8 @@ static int unload_module(void)
 	ast_http_uri_unlink(&websocketuri);
 	ao2_ref(websocketuri.data, -1);
 	websocketuri.data = NULL;
+	ast_threadpool_shutdown(send_pool);
+	send_pool = NULL;
 
 	return 0;
 }
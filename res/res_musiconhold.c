@@ -46,6 +46,7 @@
 #include <netinet/in.h>
 #include <sys/stat.h>
 #include <dirent.h>
+#include <glob.h>
 
 #ifdef SOLARIS
 #include <thread.h>
@@ -152,6 +153,7 @@ struct moh_files_state {
 #define MOH_CACHERTCLASSES	(1 << 5)	/*!< Should we use a separate instance of MOH for each user or not */
 #define MOH_ANNOUNCEMENT	(1 << 6)	/*!< Do we play announcement files between songs on this channel? */
 #define MOH_PREFERCHANNELCLASS	(1 << 7)	/*!< Should queue moh override channel moh */
+#define MOH_BROADCAST		(1 << 8)	/*!< Should one reader play a "files" class to all of its listeners */
 
 /* Custom astobj2 flag */
 #define MOH_NOTDELETED          (1 << 30)       /*!< Find only records that aren't deleted? */
@@ -172,7 +174,7 @@ struct mohclass {
 	/*! The current number of files loaded into the filearray */
 	int total_files;
 	unsigned int flags;
-	/*! The format from the MOH source, not applicable to "files" mode */
+	/*! The format from the MOH source, not applicable to "files" mode unless broadcast */
 	struct ast_format *format;
 	/*! The pid of the external application delivering MOH */
 	int pid;
@@ -182,6 +184,14 @@ struct mohclass {
 	int srcfd;
 	/*! Generic timer */
 	struct ast_timer *timer;
+	/*! The file being played to all listeners of a broadcast class */
+	struct ast_filestream *bcast_stream;
+	/*! Translation from the file being broadcast to the class format */
+	struct ast_trans_pvt *bcast_trans;
+	/*! The source format of bcast_trans */
+	struct ast_format *bcast_format;
+	/*! Index in the filearray of the next file to broadcast */
+	int bcast_pos;
 	/*! Created on the fly, from RT engine */
 	unsigned int realtime:1;
 	unsigned int delete:1;
@@ -798,6 +808,156 @@ static void *monmp3thread(void *data)
 	return NULL;
 }
 
+/*!
+ * \internal
+ * \brief Open a file of a broadcast class, preferring one in the class format
+ *
+ * \param class The broadcast class
+ * \param filename The file name, without an extension, from the filearray
+ *
+ * \return The opened stream, or NULL if no format of the file could be read
+ */
+static struct ast_filestream *moh_broadcast_open(struct mohclass *class, const char *filename)
+{
+	char pattern[PATH_MAX];
+	glob_t globbuf;
+	struct ast_filestream *fs = NULL;
+	struct ast_format *format;
+	const char *ext;
+	int pass;
+	size_t i;
+
+	snprintf(pattern, sizeof(pattern), "%s.*", filename);
+	if (glob(pattern, 0, NULL, &globbuf)) {
+		return NULL;
+	}
+
+	/* Take a file already in the class format first, so nothing is transcoded */
+	for (pass = 0; pass < 2 && !fs; pass++) {
+		for (i = 0; i < globbuf.gl_pathc && !fs; i++) {
+			ext = strrchr(globbuf.gl_pathv[i], '.') + 1;
+			format = ast_get_format_for_file_ext(ext);
+			if (!format || (!pass && ast_format_cmp(format, class->format) != AST_FORMAT_CMP_EQUAL)) {
+				continue;
+			}
+			fs = ast_readfile(filename, ext, NULL, O_RDONLY, 0, 0);
+		}
+	}
+
+	globfree(&globbuf);
+
+	return fs;
+}
+
+/*!
+ * \internal
+ * \brief Play the files of a broadcast class to all of its listeners
+ *
+ * A single stream is read and translated to the class format once, and each
+ * frame is written to the pipe of every member, as monmp3thread does for the
+ * output of an external application.  Listeners join the class at whatever
+ * point it is playing.
+ */
+static void *moh_broadcast_thread(void *data)
+{
+	struct mohclass *class = data;
+	struct mohdata *moh;
+	struct ast_frame *f;
+	struct ast_frame *out;
+	struct ast_frame *cur;
+	char filename[PATH_MAX];
+	struct timeval deadline = ast_tvnow();
+	long delay;
+	int res;
+
+	if (ast_test_flag(class, MOH_SORTMODE) == MOH_RANDSTART && class->total_files) {
+		class->bcast_pos = ast_random() % class->total_files;
+	}
+
+	for (;/* ever */;) {
+		pthread_testcancel();
+
+		/* Nobody is listening, so hold the current position until somebody is */
+		if (AST_LIST_EMPTY(&class->members)) {
+			usleep(100000);
+			deadline = ast_tvnow();
+			continue;
+		}
+
+		if (!class->bcast_stream) {
+			filename[0] = '\0';
+			ao2_lock(class);
+			if (class->total_files) {
+				if (ast_test_flag(class, MOH_SORTMODE) == MOH_RANDOMIZE) {
+					class->bcast_pos = ast_random() % class->total_files;
+				}
+				class->bcast_pos %= class->total_files;
+				ast_copy_string(filename, class->filearray[class->bcast_pos++], sizeof(filename));
+			}
+			ao2_unlock(class);
+
+			if (ast_strlen_zero(filename) || !(class->bcast_stream = moh_broadcast_open(class, filename))) {
+				ast_log(LOG_WARNING, "Unable to open file '%s' for music on hold class '%s'\n",
+					filename, class->name);
+				sleep(1);
+				continue;
+			}
+			ast_debug(1, "Broadcasting file '%s' to music on hold class '%s'\n", filename, class->name);
+		}
+
+		if (!(f = ast_readframe(class->bcast_stream))) {
+			ast_closestream(class->bcast_stream);
+			class->bcast_stream = NULL;
+			continue;
+		}
+
+		if (ast_format_cmp(f->subclass.format, class->format) == AST_FORMAT_CMP_EQUAL) {
+			out = f;
+		} else {
+			if (!class->bcast_trans || class->bcast_format != f->subclass.format) {
+				if (class->bcast_trans) {
+					ast_translator_free_path(class->bcast_trans);
+				}
+				ao2_replace(class->bcast_format, f->subclass.format);
+				class->bcast_trans = ast_translator_build_path(class->format, f->subclass.format);
+				if (!class->bcast_trans) {
+					ast_log(LOG_WARNING, "Unable to translate %s to %s for music on hold class '%s'\n",
+						ast_format_get_name(f->subclass.format), ast_format_get_name(class->format), class->name);
+					ast_closestream(class->bcast_stream);
+					class->bcast_stream = NULL;
+					continue;
+				}
+			}
+			out = ast_translate(class->bcast_trans, f, 0);
+		}
+
+		ao2_lock(class);
+		for (cur = out; cur; cur = AST_LIST_NEXT(cur, frame_list)) {
+			AST_LIST_TRAVERSE(&class->members, moh, list) {
+				if ((res = write(moh->pipe[1], cur->data.ptr, cur->datalen)) != cur->datalen) {
+					ast_debug(1, "Only wrote %d of %d bytes to pipe\n", res, cur->datalen);
+				}
+			}
+		}
+		ao2_unlock(class);
+
+		/* Pace the reader to the audio it has sent */
+		deadline = ast_tvadd(deadline, ast_samp2tv(f->samples, ast_format_get_sample_rate(f->subclass.format)));
+		if (out != f) {
+			ast_frfree(out);
+		}
+		delay = ast_tvdiff_ms(deadline, ast_tvnow());
+		if (delay > 0) {
+			usleep(delay * 1000);
+		} else if (delay < -1000) {
+			/* Too far behind to catch up, so start over from now */
+			deadline = ast_tvnow();
+		}
+	}
+
+	return NULL;
+}
+
 static int play_moh_exec(struct ast_channel *chan, const char *data)
 {
 	char *parse;
@@ -1057,6 +1217,8 @@ static void moh_parse_options(struct ast_variable *var, struct mohclass *mohclas
 			} else if (!strcasecmp(var->value, "randstart")) {
 				ast_set_flag(mohclass, MOH_RANDSTART);
 			}
+		} else if (!strcasecmp(var->name, "broadcast")) {
+			ast_set2_flag(mohclass, ast_true(var->value), MOH_BROADCAST);
 		} else if (!strcasecmp(var->name, "format")) {
 			mohclass->format = ast_format_cache_get(var->value);
 			if (!mohclass->format) {
@@ -1131,6 +1293,8 @@ static int moh_scan_files(struct mohclass *class) {
 		return -1;
 	}
 
+	/* A broadcast class reads the filearray from its own thread */
+	ao2_lock(class);
 	for (i = 0; i < class->total_files; i++) {
 		ast_free(class->filearray[i]);
 	}
@@ -1138,11 +1302,13 @@ static int moh_scan_files(struct mohclass *class) {
 
 	if (!getcwd(path, sizeof(path))) {
 		ast_log(LOG_WARNING, "getcwd() failed: %s\n", strerror(errno));
+		ao2_unlock(class);
 		closedir(files_DIR);
 		return -1;
 	}
 	if (chdir(dir_path) < 0) {
 		ast_log(LOG_WARNING, "chdir() failed: %s\n", strerror(errno));
+		ao2_unlock(class);
 		closedir(files_DIR);
 		return -1;
 	}
@@ -1184,10 +1350,12 @@ static int moh_scan_files(struct mohclass *class) {
 	closedir(files_DIR);
 	if (chdir(path) < 0) {
 		ast_log(LOG_WARNING, "chdir() failed: %s\n", strerror(errno));
+		ao2_unlock(class);
 		return -1;
 	}
 	if (ast_test_flag(class, MOH_SORTALPHA))
 		qsort(&class->filearray[0], class->total_files, sizeof(char *), moh_sort_compare);
+	ao2_unlock(class);
 	return class->total_files;
 }
 
@@ -1207,6 +1375,12 @@ static int init_files_class(struct mohclass *class)
 		return -1;
 	}
 
+	if (ast_test_flag(class, MOH_BROADCAST)
+		&& ast_pthread_create_background(&class->thread, NULL, moh_broadcast_thread, class)) {
+		ast_log(LOG_WARNING, "Unable to create moh broadcast thread...\n");
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -1492,6 +1666,8 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 						mohclass = mohclass_unref(mohclass, "unreffing potential mohclass (moh_scan_files failed)");
 						return -1;
 					}
+					/* An unregistered class has only this channel to play to */
+					ast_clear_flag(mohclass, MOH_BROADCAST);
 					if (strchr(mohclass->args, 'r')) {
 						static int deprecation_warning = 0;
 						if (!deprecation_warning) {
@@ -1566,7 +1742,7 @@ static int local_ast_moh_start(struct ast_channel *chan, const char *mclass, con
 	}
 
 	if (!state || !state->class || strcmp(mohclass->name, state->class->name)) {
-		if (mohclass->total_files) {
+		if (mohclass->total_files && !ast_test_flag(mohclass, MOH_BROADCAST)) {
 			res = ast_activate_generator(chan, &moh_file_stream, mohclass);
 		} else {
 			res = ast_activate_generator(chan, &mohgen, mohclass);
@@ -1679,13 +1855,22 @@ static void moh_class_destructor(void *obj)
 		class->timer = NULL;
 	}
 
-	ao2_cleanup(class->format);
-
 	/* Finally, collect the exit status of the monitor thread */
 	if (tid > 0) {
 		pthread_join(tid, NULL);
 	}
 
+	if (class->bcast_stream) {
+		ast_closestream(class->bcast_stream);
+		class->bcast_stream = NULL;
+	}
+	if (class->bcast_trans) {
+		ast_translator_free_path(class->bcast_trans);
+		class->bcast_trans = NULL;
+	}
+	ao2_cleanup(class->bcast_format);
+	ao2_cleanup(class->format);
+
 }
 
 static int moh_class_mark(void *obj, void *arg, int flags)
@@ -1890,9 +2075,12 @@ static char *handle_cli_moh_show_classes(struct ast_cli_entry *e, int cmd, struc
 		if (ast_test_flag(class, MOH_CUSTOM)) {
 			ast_cli(a->fd, "\tApplication: %s\n", S_OR(class->args, "<none>"));
 		}
-		if (strcasecmp(class->mode, "files")) {
+		if (strcasecmp(class->mode, "files") || ast_test_flag(class, MOH_BROADCAST)) {
 			ast_cli(a->fd, "\tFormat: %s\n", ast_format_get_name(class->format));
 		}
+		if (ast_test_flag(class, MOH_BROADCAST)) {
+			ast_cli(a->fd, "\tBroadcast: yes\n");
+		}
 	}
 	ao2_iterator_destroy(&i);
 
@@ -78,6 +78,8 @@ struct odbc_class
 	unsigned int isolation;              /*!< Flags for how the DB should deal with data in other, uncommitted transactions */
 	unsigned int conntimeout;            /*!< Maximum time the connection process should take */
 	unsigned int maxconnections;         /*!< Maximum number of allowed connections */
+	unsigned int stmt_cache_size;        /*!< Maximum number of prepared statements cached per connection */
+	unsigned int thread_affinity:1;      /*!< Should released connections be pinned to the releasing thread? */
 	/*! When a connection fails, cache that failure for how long? */
 	struct timeval negative_connection_cache;
 	/*! When a connection fails, when did that last occur? */
@@ -90,6 +92,44 @@ struct odbc_class
 	ast_cond_t cond;
 	/*! The total number of current connections */
 	size_t connection_cnt;
+	/*! The number of connections currently pinned to a thread */
+	size_t pinned_cnt;
+	/*! Requests served from the pool (protected by lock) */
+	unsigned int requests;
+	/*! Requests served from a connection pinned to the requesting thread */
+	int pinned_requests;
+	/*! Requests which had to wait for a connection (protected by lock) */
+	unsigned int waits;
+	/*! Total and longest time spent waiting for a connection (protected by lock) */
+	int64_t wait_total_us;
+	int64_t wait_max_us;
+	/*! Prepared statement cache hits and misses */
+	int stmt_cache_hits;
+	int stmt_cache_misses;
+};
+
+/*! \brief A prepared statement cached on a connection */
+struct odbc_cached_stmt {
+	AST_LIST_ENTRY(odbc_cached_stmt) list;
+	SQLHSTMT stmt;
+	/*! Has the statement been handed out and not yet released? */
+	unsigned int in_use:1;
+	char sql[0];
+};
+
+/*! \brief The maximum number of classes a single thread may hold a pinned connection to */
+#define ODBC_MAX_THREAD_PINS 4
+
+/*! \brief A connection pinned to a thread */
+struct odbc_thread_pin {
+	/*! The connection, which holds a reference to its class while pinned */
+	struct odbc_obj *obj;
+	/*! Has the thread requested the connection and not yet released it? */
+	unsigned int in_use:1;
+};
+
+struct odbc_thread_pins {
+	struct odbc_thread_pin pins[ODBC_MAX_THREAD_PINS];
 };
 
 static struct ao2_container *class_container;
@@ -99,9 +139,14 @@ static AST_RWLIST_HEAD_STATIC(odbc_tables, odbc_cache_tables);
 static odbc_status odbc_obj_connect(struct odbc_obj *obj);
 static odbc_status odbc_obj_disconnect(struct odbc_obj *obj);
 static void odbc_register_class(struct odbc_class *class, int connect);
+static int connection_dead(struct odbc_obj *connection, struct odbc_class *class);
 
 AST_THREADSTORAGE(errors_buf);
 
+static void odbc_thread_pins_destroy(void *data);
+
+AST_THREADSTORAGE_CUSTOM(thread_pins, NULL, odbc_thread_pins_destroy);
+
 struct odbc_txn_frame {
 	AST_LIST_ENTRY(odbc_txn_frame) list;
 	struct ast_channel *owner;
@@ -189,9 +234,35 @@ static void odbc_class_destructor(void *data)
 	ast_cond_destroy(&class->cond);
 }
 
-static int null_hash_fn(const void *obj, const int flags)
+static int odbc_class_hash_fn(const void *obj, const int flags)
 {
-	return 0;
+	const struct odbc_class *class;
+	const char *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		break;
+	case OBJ_SEARCH_OBJECT:
+		class = obj;
+		key = class->name;
+		break;
+	default:
+		ast_assert(0);
+		return 0;
+	}
+	return ast_str_hash(key);
+}
+
+static void odbc_stmt_cache_flush(struct odbc_obj *obj)
+{
+	struct odbc_cached_stmt *cached;
+
+	while ((cached = AST_LIST_REMOVE_HEAD(&obj->stmt_cache, list))) {
+		SQLFreeHandle(SQL_HANDLE_STMT, cached->stmt);
+		ast_free(cached);
+	}
+	obj->stmt_cache_count = 0;
 }
 
 static void odbc_obj_destructor(void *data)
@@ -378,6 +449,112 @@ SQLHSTMT ast_odbc_direct_execute(struct odbc_obj *obj, SQLHSTMT (*exec_cb)(struc
 	return stmt;
 }
 
+/*!
+ * \internal
+ * \brief Free a statement handle, removing it from the statement cache first if it is cached.
+ */
+static void odbc_stmt_discard(struct odbc_obj *obj, SQLHSTMT stmt)
+{
+	struct odbc_cached_stmt *cached;
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&obj->stmt_cache, cached, list) {
+		if (cached->stmt == stmt) {
+			AST_LIST_REMOVE_CURRENT(list);
+			obj->stmt_cache_count--;
+			ast_free(cached);
+			break;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+}
+
+SQLHSTMT ast_odbc_prepare_cached(struct odbc_obj *obj, const char *sql)
+{
+	struct odbc_class *class = obj->parent;
+	struct odbc_cached_stmt *cached, *victim = NULL;
+	SQLHSTMT stmt;
+	SQLRETURN res;
+
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&obj->stmt_cache, cached, list) {
+		if (!cached->in_use && !strcmp(cached->sql, sql)) {
+			/* Move it to the front so the least recently used statement is evicted first */
+			AST_LIST_REMOVE_CURRENT(list);
+			AST_LIST_INSERT_HEAD(&obj->stmt_cache, cached, list);
+			cached->in_use = 1;
+			ast_atomic_fetchadd_int(&class->stmt_cache_hits, +1);
+			return cached->stmt;
+		}
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
+	ast_atomic_fetchadd_int(&class->stmt_cache_misses, +1);
+
+	res = SQLAllocHandle(SQL_HANDLE_STMT, obj->con, &stmt);
+	if (!SQL_SUCCEEDED(res)) {
+		ast_log(LOG_WARNING, "SQL Alloc Handle failed on connection '%s'!\n", class->name);
+		return NULL;
+	}
+
+	res = SQLPrepare(stmt, (unsigned char *) sql, SQL_NTS);
+	if (!SQL_SUCCEEDED(res)) {
+		ast_odbc_print_errors(SQL_HANDLE_STMT, stmt, "SQL Prepare");
+		ast_log(LOG_WARNING, "SQL Prepare failed! [%s]\n", sql);
+		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		return NULL;
+	}
+
+	if (!class->stmt_cache_size) {
+		return stmt;
+	}
+
+	if (obj->stmt_cache_count >= class->stmt_cache_size) {
+		/* Evict the least recently used statement that is not handed out */
+		AST_LIST_TRAVERSE(&obj->stmt_cache, cached, list) {
+			if (!cached->in_use) {
+				victim = cached;
+			}
+		}
+		if (!victim) {
+			return stmt;
+		}
+		AST_LIST_REMOVE(&obj->stmt_cache, victim, list);
+		obj->stmt_cache_count--;
+		SQLFreeHandle(SQL_HANDLE_STMT, victim->stmt);
+		ast_free(victim);
+	}
+
+	cached = ast_calloc(1, sizeof(*cached) + strlen(sql) + 1);
+	if (!cached) {
+		return stmt;
+	}
+	cached->stmt = stmt;
+	cached->in_use = 1;
+	strcpy(cached->sql, sql); /* SAFE */
+	AST_LIST_INSERT_HEAD(&obj->stmt_cache, cached, list);
+	obj->stmt_cache_count++;
+
+	return stmt;
+}
+
+void ast_odbc_release_cached(struct odbc_obj *obj, SQLHSTMT stmt)
+{
+	struct odbc_cached_stmt *cached;
+
+	AST_LIST_TRAVERSE(&obj->stmt_cache, cached, list) {
+		if (cached->stmt == stmt) {
+			SQLFreeStmt(stmt, SQL_CLOSE);
+			SQLFreeStmt(stmt, SQL_UNBIND);
+			SQLFreeStmt(stmt, SQL_RESET_PARAMS);
+			cached->in_use = 0;
+			return;
+		}
+	}
+
+	SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+}
+
 SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_cb)(struct odbc_obj *obj, void *data), void *data)
 {
 	int res = 0;
@@ -400,7 +577,7 @@ SQLHSTMT ast_odbc_prepare_and_execute(struct odbc_obj *obj, SQLHSTMT (*prepare_c
 		}
 
 		ast_log(LOG_WARNING, "SQL Execute error %d!\n", res);
-		SQLFreeHandle(SQL_HANDLE_STMT, stmt);
+		odbc_stmt_discard(obj, stmt);
 		stmt = NULL;
 	}
 
@@ -488,7 +665,7 @@ static int load_odbc_config(void)
 	struct ast_variable *v;
 	char *cat;
 	const char *dsn, *username, *password, *sanitysql;
-	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections;
+	int enabled, bse, conntimeout, forcecommit, isolation, maxconnections, stmtcachesize, affinity;
 	struct timeval ncache = { 0, 0 };
 	int preconnect = 0, res = 0;
 	struct ast_flags config_flags = { 0 };
@@ -516,6 +693,8 @@ static int load_odbc_config(void)
 			forcecommit = 0;
 			isolation = SQL_TXN_READ_COMMITTED;
 			maxconnections = 1;
+			stmtcachesize = 16;
+			affinity = 0;
 			for (v = ast_variable_browse(config, cat); v; v = v->next) {
 				if (!strcasecmp(v->name, "pooling") ||
 						!strncasecmp(v->name, "share", 5) ||
@@ -564,6 +743,13 @@ static int load_odbc_config(void)
 						ast_log(LOG_WARNING, "max_connections must be a positive integer\n");
 						maxconnections = 1;
                                         }
+				} else if (!strcasecmp(v->name, "statement_cache_size")) {
+					if (sscanf(v->value, "%30d", &stmtcachesize) != 1 || stmtcachesize < 0) {
+						ast_log(LOG_WARNING, "statement_cache_size must be a non-negative integer\n");
+						stmtcachesize = 16;
+					}
+				} else if (!strcasecmp(v->name, "thread_affinity")) {
+					affinity = ast_true(v->value);
 				}
 			}
 
@@ -590,6 +776,8 @@ static int load_odbc_config(void)
 				new->conntimeout = conntimeout;
 				new->negative_connection_cache = ncache;
 				new->maxconnections = maxconnections;
+				new->stmt_cache_size = stmtcachesize;
+				new->thread_affinity = affinity ? 1 : 0;
 
 				if (cat)
 					ast_copy_string(new->name, cat, sizeof(new->name));
@@ -676,6 +864,24 @@ static char *handle_cli_odbc_show(struct ast_cli_entry *e, int cmd, struct ast_c
 			}
 
 			ast_cli(a->fd, "    Number of active connections: %zd (out of %d)\n", class->connection_cnt, class->maxconnections);
+			if (class->thread_affinity) {
+				ast_cli(a->fd, "    Number of pinned connections: %zd\n", class->pinned_cnt);
+			}
+
+			ast_mutex_lock(&class->lock);
+			ast_cli(a->fd, "    Connection requests: %u (%d from pinned connections)\n",
+				class->requests + class->pinned_requests, class->pinned_requests);
+			if (class->waits) {
+				ast_cli(a->fd, "    Requests that waited: %u (average %.3f ms, longest %.3f ms)\n",
+					class->waits, class->wait_total_us / (double) class->waits / 1000.0,
+					class->wait_max_us / 1000.0);
+			} else {
+				ast_cli(a->fd, "    Requests that waited: 0\n");
+			}
+			ast_mutex_unlock(&class->lock);
+
+			ast_cli(a->fd, "    Statement cache: %d hits, %d misses (up to %u per connection)\n",
+				class->stmt_cache_hits, class->stmt_cache_misses, class->stmt_cache_size);
 			ast_cli(a->fd, "\n");
 		}
 		ao2_ref(class, -1);
@@ -709,10 +915,156 @@ static void odbc_register_class(struct odbc_class *class, int preconnect)
 	return;
 }
 
+/*!
+ * \internal
+ * \brief Give a pinned connection back to the pool of its class.
+ *
+ * \param pin The pin to clear
+ * \param dead Non-zero if the connection has died and should be destroyed instead
+ */
+static void odbc_thread_pin_release(struct odbc_thread_pin *pin, int dead)
+{
+	struct odbc_obj *obj = pin->obj;
+	struct odbc_class *class = obj->parent;
+
+	ast_debug(2, "Unpinning ODBC handle %p from class '%s'\n", obj, class->name);
+
+	pin->obj = NULL;
+	pin->in_use = 0;
+	obj->parent = NULL;
+
+	ast_mutex_lock(&class->lock);
+	class->pinned_cnt--;
+	if (dead) {
+		ao2_ref(obj, -1);
+		class->connection_cnt--;
+	} else {
+		AST_LIST_INSERT_HEAD(&class->connections, obj, list);
+	}
+	ast_cond_signal(&class->cond);
+	ast_mutex_unlock(&class->lock);
+
+	ao2_ref(class, -1);
+}
+
+static void odbc_thread_pins_destroy(void *data)
+{
+	struct odbc_thread_pins *pins = data;
+	int i;
+
+	for (i = 0; i < ODBC_MAX_THREAD_PINS; i++) {
+		if (pins->pins[i].obj) {
+			odbc_thread_pin_release(&pins->pins[i], 0);
+		}
+	}
+	ast_free(pins);
+}
+
+/*!
+ * \internal
+ * \brief Take the connection pinned to this thread for a class, if there is a usable one.
+ */
+static struct odbc_obj *odbc_thread_pin_get(const char *name)
+{
+	struct odbc_thread_pins *pins;
+	struct odbc_thread_pin *pin;
+	struct odbc_class *class;
+	int i;
+
+	if (!(pins = ast_threadstorage_get(&thread_pins, sizeof(*pins)))) {
+		return NULL;
+	}
+
+	for (i = 0; i < ODBC_MAX_THREAD_PINS; i++) {
+		pin = &pins->pins[i];
+		if (!pin->obj || pin->in_use || strcmp(pin->obj->parent->name, name)) {
+			continue;
+		}
+
+		class = pin->obj->parent;
+		if (class->delme) {
+			/* The class was reloaded; let the pool hand out a connection from its replacement. */
+			odbc_thread_pin_release(pin, 0);
+			return NULL;
+		}
+		if (connection_dead(pin->obj, class)) {
+			odbc_thread_pin_release(pin, 1);
+			return NULL;
+		}
+
+		pin->in_use = 1;
+		ast_atomic_fetchadd_int(&class->pinned_requests, +1);
+		ast_debug(2, "Reusing pinned ODBC handle %p from class '%s'\n", pin->obj, name);
+		return pin->obj;
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Release a connection which may be pinned to this thread.
+ *
+ * \retval 1 if the connection is (now) pinned to this thread and needs no further handling
+ * \retval 0 if it should be returned to the pool
+ */
+static int odbc_thread_pin_put(struct odbc_obj *obj)
+{
+	struct odbc_class *class = obj->parent;
+	struct odbc_thread_pins *pins;
+	struct odbc_thread_pin *free_pin = NULL;
+	int i;
+
+	if (!(pins = ast_threadstorage_get(&thread_pins, sizeof(*pins)))) {
+		return 0;
+	}
+
+	for (i = 0; i < ODBC_MAX_THREAD_PINS; i++) {
+		struct odbc_thread_pin *pin = &pins->pins[i];
+
+		if (pin->obj == obj) {
+			pin->in_use = 0;
+			return 1;
+		}
+		if (!pin->obj) {
+			if (!free_pin) {
+				free_pin = pin;
+			}
+		} else if (!strcmp(pin->obj->parent->name, class->name)) {
+			/* Only one connection per class is pinned to a thread */
+			return 0;
+		}
+	}
+
+	if (!free_pin || !class->thread_affinity || class->delme) {
+		return 0;
+	}
+
+	/* Always leave at least one connection for threads without a pin */
+	ast_mutex_lock(&class->lock);
+	if (class->pinned_cnt + 1 >= class->maxconnections) {
+		ast_mutex_unlock(&class->lock);
+		return 0;
+	}
+	class->pinned_cnt++;
+	ast_mutex_unlock(&class->lock);
+
+	/* The pinned connection keeps its class reference until it is unpinned. */
+	free_pin->obj = obj;
+	free_pin->in_use = 0;
+	ast_debug(2, "Pinned ODBC handle %p from class '%s' to thread\n", obj, class->name);
+
+	return 1;
+}
+
 void ast_odbc_release_obj(struct odbc_obj *obj)
 {
 	struct odbc_class *class = obj->parent;
 
+	if (odbc_thread_pin_put(obj)) {
+		return;
+	}
+
 	ast_debug(2, "Releasing ODBC handle %p into pool\n", obj);
 
 	/* The odbc_obj only holds a reference to the class when it is
@@ -752,7 +1104,7 @@ unsigned int ast_odbc_get_max_connections(const char *name)
 	struct odbc_class *class;
 	unsigned int max_connections;
 
-	class = ao2_callback(class_container, 0, aoro2_class_cb, (char *) name);
+	class = ao2_callback(class_container, OBJ_SEARCH_KEY, aoro2_class_cb, (char *) name);
 	if (!class) {
 		return 0;
 	}
@@ -811,8 +1163,13 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 {
 	struct odbc_obj *obj = NULL;
 	struct odbc_class *class;
+	struct timeval wait_start = { 0, };
 
-	if (!(class = ao2_callback(class_container, 0, aoro2_class_cb, (char *) name))) {
+	if ((obj = odbc_thread_pin_get(name))) {
+		return obj;
+	}
+
+	if (!(class = ao2_callback(class_container, OBJ_SEARCH_KEY, aoro2_class_cb, (char *) name))) {
 		ast_debug(1, "Class '%s' not found!\n", name);
 		return NULL;
 	}
@@ -849,6 +1206,9 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 				 * wait for another thread to give up the connection they
 				 * own.
 				 */
+				if (ast_tvzero(wait_start)) {
+					wait_start = ast_tvnow();
+				}
 				ast_cond_wait(&class->cond, &class->lock);
 			}
 		} else if (connection_dead(obj, class)) {
@@ -868,6 +1228,17 @@ struct odbc_obj *_ast_odbc_request_obj2(const char *name, struct ast_flags flags
 		}
 	}
 
+	class->requests++;
+	if (!ast_tvzero(wait_start)) {
+		int64_t waited = ast_tvdiff_us(ast_tvnow(), wait_start);
+
+		class->waits++;
+		class->wait_total_us += waited;
+		if (waited > class->wait_max_us) {
+			class->wait_max_us = waited;
+		}
+	}
+
 	ast_mutex_unlock(&class->lock);
 	ao2_ref(class, -1);
 
@@ -898,6 +1269,9 @@ static odbc_status odbc_obj_disconnect(struct odbc_obj *obj)
 		return ODBC_SUCCESS;
 	}
 
+	/* Statement handles do not survive their connection */
+	odbc_stmt_cache_flush(obj);
+
 	con = obj->con;
 	obj->con = NULL;
 	res = SQLDisconnect(con);
@@ -1082,7 +1456,8 @@ static int unload_module(void)
  */
 static int load_module(void)
 {
-	if (!(class_container = ao2_container_alloc(1, null_hash_fn, ao2_match_by_addr)))
+	if (!(class_container = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0, 37,
+		odbc_class_hash_fn, NULL, ao2_match_by_addr)))
 		return AST_MODULE_LOAD_DECLINE;
 	if (load_odbc_config() == -1)
 		return AST_MODULE_LOAD_DECLINE;
@@ -632,6 +632,8 @@ static void parking_lot_destructor(void *obj)
 	}
 	ao2_cleanup(lot->parked_users);
 	ao2_cleanup(lot->cfg);
+	ast_free(lot->spaces);
+	ast_free(lot->spaces_used);
 	ast_string_field_free_memory(lot);
 }
 
@@ -646,8 +648,8 @@ static struct parking_lot *alloc_new_parking_lot(struct parking_lot_cfg *lot_cfg
 		return NULL;
 	}
 
-	/* Create parked user ordered list */
-	lot->parked_users = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_RWLOCK,
+	/* Create parked user ordered tree */
+	lot->parked_users = ao2_container_alloc_rbtree(AO2_ALLOC_OPT_LOCK_RWLOCK,
 		AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT,
 		parked_user_sort_fn,
 		parked_user_cmp_fn);
@@ -898,7 +900,12 @@ struct parking_lot *parking_lot_build_or_update(struct parking_lot_cfg *lot_cfg,
 	}
 
 	ao2_ref(lot_cfg, +1);
+	ao2_lock(lot);
 	lot->cfg = lot_cfg;
+	if (parking_lot_spaces_rebuild(lot)) {
+		ast_log(LOG_ERROR, "Failed to index the parking spaces of parking lot '%s'. No calls can be parked there.\n", lot_cfg->name);
+	}
+	ao2_unlock(lot);
 
 	ao2_cleanup(replaced_cfg);
 
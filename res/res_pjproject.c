@@ -61,6 +61,25 @@
 					</para></note>
 					</description>
 				</configOption>
+				<configOption name="cache_pools" default="yes">
+					<synopsis>Keep released pjproject memory pools for reuse.</synopsis>
+					<description>
+						<para>Creating and releasing pools, such as the one of each SIP
+						transaction, is a large share of the work pjproject does at high
+						call rates.  Turning this off releases the memory of each pool
+						at once, which can help when tracking down memory problems.</para>
+						<para>Applied to caching pools created after this is read, so it
+						takes a restart to change.</para>
+					</description>
+				</configOption>
+				<configOption name="cache_pool_max_capacity" default="1048576">
+					<synopsis>Most memory, in bytes, each caching pool keeps in released pools for reuse.</synopsis>
+					<description>
+						<para>"pjproject show pools" shows how much each caching pool keeps
+						and uses.  Raise this when the pools used at peak hold more than
+						it.</para>
+					</description>
+				</configOption>
 			</configObject>
 			<configObject name="log_mappings">
 				<synopsis>PJPROJECT to Asterisk Log Level Mapping</synopsis>
@@ -117,6 +136,23 @@ static unsigned decor_orig;
 
 static AST_VECTOR(buildopts, char *) buildopts;
 
+/*! \brief A caching pool shown by "pjproject show pools" */
+struct caching_pool_entry {
+	pj_caching_pool *cp;
+	char name[0];
+};
+
+static AST_VECTOR(caching_pools, struct caching_pool_entry *) caching_pools;
+AST_MUTEX_DEFINE_STATIC(caching_pools_lock);
+
+/*! \brief How the calling thread is registered with pjlib */
+struct thread_registration {
+	pj_thread_desc desc;
+	pj_thread_t *thread;
+};
+
+AST_THREADSTORAGE(thread_registration_storage);
+
 /*! Protection from other log intercept instances.  There can be only one at a time. */
 AST_MUTEX_DEFINE_STATIC(pjproject_log_intercept_lock);
 
@@ -285,6 +321,67 @@ void ast_pjproject_unref(void)
 	ast_module_unref(ast_module_info->self);
 }
 
+int ast_pjproject_thread_register(const char *name)
+{
+	struct thread_registration *reg;
+
+	reg = ast_threadstorage_get(&thread_registration_storage, sizeof(*reg));
+	if (!reg) {
+		ast_log(LOG_ERROR, "Could not get thread desc from thread-local storage.\n");
+		return -1;
+	}
+	if (reg->thread) {
+		return 0;
+	}
+
+	if (pj_thread_is_registered()) {
+		/* Registered by pjproject itself, or before this was first called */
+		reg->thread = pj_thread_this();
+		return 0;
+	}
+
+	if (pj_thread_register(name, reg->desc, &reg->thread) != PJ_SUCCESS) {
+		reg->thread = NULL;
+		ast_log(LOG_ERROR, "Couldn't register thread '%s' with PJLIB.\n", name);
+		return -1;
+	}
+
+	return 0;
+}
+
+void ast_pjproject_caching_pool_init(pj_caching_pool *cp, const char *name,
+	const pj_pool_factory_policy *policy)
+{
+	struct caching_pool_entry *entry;
+
+	pj_caching_pool_init(cp, policy,
+		ast_option_pjproject_cache_pools ? ast_option_pjproject_cache_pool_max_capacity : 0);
+
+	entry = ast_malloc(sizeof(*entry) + strlen(name) + 1);
+	if (!entry) {
+		return;
+	}
+	entry->cp = cp;
+	strcpy(entry->name, name); /* Safe */
+
+	ast_mutex_lock(&caching_pools_lock);
+	if (AST_VECTOR_APPEND(&caching_pools, entry)) {
+		ast_free(entry);
+	}
+	ast_mutex_unlock(&caching_pools_lock);
+}
+
+#define CACHING_POOL_CMP(elem, value) ((elem)->cp == (value))
+
+void ast_pjproject_caching_pool_destroy(pj_caching_pool *cp)
+{
+	ast_mutex_lock(&caching_pools_lock);
+	AST_VECTOR_REMOVE_CMP_UNORDERED(&caching_pools, cp, CACHING_POOL_CMP, ast_free);
+	ast_mutex_unlock(&caching_pools_lock);
+
+	pj_caching_pool_destroy(cp);
+}
+
 static char *handle_pjproject_show_buildopts(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	int i;
@@ -453,11 +550,68 @@ static char *handle_pjproject_show_log_level(struct ast_cli_entry *e, int cmd, s
 	return CLI_SUCCESS;
 }
 
+#define FORMAT "%-20.20s %8s %12s %12s %8s %12s %12s\n"
+#define FORMAT2 "%-20.20s %8lu %12lu %12lu %8lu %12lu %12lu\n"
+
+static char *handle_pjproject_show_pools(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct caching_pool_entry *entry;
+	pj_caching_pool *cp;
+	unsigned long cached;
+	int i;
+	int j;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjproject show pools";
+		e->usage =
+			"Usage: pjproject show pools\n"
+			"       Show the pools in use from each caching pool, the bytes they\n"
+			"       hold now and at most, and the released pools kept for reuse\n"
+			"       with the bytes they hold and the most that may be kept.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (ast_pjproject_thread_register("Asterisk CLI")) {
+		return CLI_FAILURE;
+	}
+
+	ast_cli(a->fd, FORMAT, "Name", "Used", "UsedBytes", "PeakBytes", "Cached", "CachedBytes", "MaxCached");
+	ast_mutex_lock(&caching_pools_lock);
+	for (i = 0; i < AST_VECTOR_SIZE(&caching_pools); i++) {
+		entry = AST_VECTOR_GET(&caching_pools, i);
+		cp = entry->cp;
+
+		pj_lock_acquire(cp->lock);
+		for (cached = 0, j = 0; j < PJ_CACHING_POOL_ARRAY_SIZE; j++) {
+			cached += pj_list_size(&cp->free_list[j]);
+		}
+		ast_cli(a->fd, FORMAT2, entry->name,
+			(unsigned long) cp->used_count, (unsigned long) cp->used_size,
+			(unsigned long) cp->peak_used_size, cached,
+			(unsigned long) cp->capacity, (unsigned long) cp->max_capacity);
+		pj_lock_release(cp->lock);
+	}
+	ast_mutex_unlock(&caching_pools_lock);
+
+	return CLI_SUCCESS;
+}
+
+#undef FORMAT
+#undef FORMAT2
+
 static struct ast_cli_entry pjproject_cli[] = {
 	AST_CLI_DEFINE(handle_pjproject_set_log_level, "Set the maximum active pjproject logging level"),
 	AST_CLI_DEFINE(handle_pjproject_show_buildopts, "Show the compiled config of the pjproject in use"),
 	AST_CLI_DEFINE(handle_pjproject_show_log_mappings, "Show pjproject to Asterisk log mappings"),
 	AST_CLI_DEFINE(handle_pjproject_show_log_level, "Show the maximum active pjproject logging level"),
+	AST_CLI_DEFINE(handle_pjproject_show_pools, "Show the memory pools in use and kept for reuse"),
 };
 
 static int load_module(void)
@@ -501,7 +655,7 @@ static int load_module(void)
 	decor_orig = pj_log_get_decor();
 	log_cb_orig = pj_log_get_log_func();
 
-	if (AST_VECTOR_INIT(&buildopts, 64)) {
+	if (AST_VECTOR_INIT(&buildopts, 64) || AST_VECTOR_INIT(&caching_pools, 4)) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -535,6 +689,8 @@ static int unload_module(void)
 
 	AST_VECTOR_REMOVE_CMP_UNORDERED(&buildopts, NULL, NOT_EQUALS, ast_free);
 	AST_VECTOR_FREE(&buildopts);
+	AST_VECTOR_RESET(&caching_pools, ast_free);
+	AST_VECTOR_FREE(&caching_pools);
 
 	ast_debug(3, "Stopped PJPROJECT logging to Asterisk logger\n");
 
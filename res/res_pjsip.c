@@ -1144,6 +1144,58 @@
 						in-progress calls.</para>
 					</description>
 				</configOption>
+				<configOption name="udp_sockets" default="1">
+					<synopsis>Number of UDP sockets to bind to the address (UDP ONLY)</synopsis>
+					<description>
+						<para>When greater than 1 this many UDP sockets are bound to the
+						same address and port using SO_REUSEPORT, and the kernel spreads
+						received packets over them.  As many threads poll the sockets for
+						SIP events, so receiving is no longer limited to one thread.
+						Packets from the same source address and port always arrive on the
+						same socket.  Responses are sent from the socket a request arrived
+						on, and new requests from the last socket bound.  The maximum is 32.</para>
+						<note><para>This option requires SO_REUSEPORT, which is available
+						on Linux 3.9 and later.</para></note>
+					</description>
+				</configOption>
+				<configOption name="outbound_max_idle" default="0">
+					<synopsis>Seconds an outbound connection is kept open without SIP traffic (TCP and TLS ONLY)</synopsis>
+					<description>
+						<para>When non-zero, outbound connections made from this transport are
+						held open, rather than closed by PJSIP shortly after their last
+						transaction, until no SIP message has been sent or received on them
+						for this many seconds.  Later requests to the same destination reuse
+						the open connection instead of connecting, and for TLS going through
+						a handshake, again.  Keepalives do not count as SIP messages.</para>
+						<note><para>This option requires <literal>res_pjsip_transport_management</literal>.</para></note>
+					</description>
+				</configOption>
+				<configOption name="outbound_keep_alive_interval" default="0">
+					<synopsis>Interval at which keepalives are sent on outbound connections (TCP and TLS ONLY)</synopsis>
+					<description>
+						<para>When non-zero, a CRLF keepalive is sent every this many seconds on
+						each outbound connection made from this transport, in place of the
+						global <replaceable>keep_alive_interval</replaceable>.  Outbound
+						connections are held open as for <replaceable>outbound_max_idle</replaceable>.</para>
+						<note><para>This option requires <literal>res_pjsip_transport_management</literal>.</para></note>
+					</description>
+				</configOption>
+				<configOption name="outbound_prewarm" default="">
+					<synopsis>Destinations to open outbound connections to ahead of use (TCP and TLS ONLY)</synopsis>
+					<description>
+						<para>A comma separated list of host[:port] destinations, such as the
+						proxies of trunks, that this transport connects to when it is loaded,
+						so the first request to them does not wait for the connection or the
+						TLS handshake.  Every 30 seconds a destination that is no longer
+						connected is connected to again.  Combine with
+						<replaceable>outbound_keep_alive_interval</replaceable> or
+						<replaceable>outbound_max_idle</replaceable> to keep the connections
+						open between requests.  The port defaults to 5060, or 5061 for TLS.</para>
+						<note><para>The certificate of a TLS destination is verified against
+						its address rather than the name given here.</para></note>
+						<note><para>This option requires <literal>res_pjsip_transport_management</literal>.</para></note>
+					</description>
+				</configOption>
 			</configObject>
 			<configObject name="contact">
 				<synopsis>A way of creating an aliased name to a SIP URI</synopsis>
@@ -1464,6 +1516,64 @@
 					<synopsis>The interval at which unidentified requests are older than
 					twice the unidentified_request_period are pruned.</synopsis>
 				</configOption>
+				<configOption name="distributor_pool_size" default="31">
+					<synopsis>Number of serializers used for requests outside of a dialog.</synopsis>
+					<description><para>
+						Requests and responses which do not belong to a dialog are hashed on
+						their Call-ID and remote tag onto one of this many serializers.  A
+						prime number spreads them best.  The pool is resized on reload.
+						Valid values are 1 through 1024.
+					</para></description>
+				</configOption>
+				<configOption name="distributor_queue_high" default="0">
+					<synopsis>Queue depth at which a distributor serializer rejects new requests.</synopsis>
+					<description><para>
+						When a request outside of a dialog hashes onto a distributor
+						serializer which already has this many tasks queued, it is
+						answered with a 503 response instead of being queued.  The
+						<literal>pjsip show distributor</literal> CLI command shows the
+						depth and latency of each serializer.  A value of 0 never rejects
+						requests.
+					</para></description>
+				</configOption>
+				<configOption name="endpoint_identifier_cache_ttl" default="0">
+					<synopsis>Seconds the endpoint identified for a request is remembered.</synopsis>
+					<description><para>
+						When set, the endpoint identified for a request outside of a dialog
+						is remembered for this many seconds, keyed on the source address and
+						port and the user and host of the From header.  Later requests with
+						the same key skip the identifiers in
+						<replaceable>endpoint_identifier_order</replaceable>.  Requests which
+						identify no endpoint are not remembered, and neither is anything
+						when <literal>auth_username</literal> identification is in use.
+						Everything remembered is forgotten whenever PJSIP configuration is
+						reloaded.  A value of 0 identifies every request.
+					</para></description>
+				</configOption>
+				<configOption name="exten_state_coalesce_interval" default="0">
+					<synopsis>Milliseconds extension state changes are coalesced over.</synopsis>
+					<description><para>
+						When set, the NOTIFY sent to a presence or dialog subscription when
+						the state of its extension changes is held back for this many
+						milliseconds.  Further changes within that window replace the held
+						back state, so a subscriber receives only the latest one.  No NOTIFY
+						is sent at all if the state is back to the one last sent to the
+						subscriber.  A value of 0 notifies every change as it happens.
+					</para></description>
+				</configOption>
+				<configOption name="subscription_recreate_rate" default="0">
+					<synopsis>Persisted subscriptions recreated per second at startup.</synopsis>
+					<description><para>
+						Subscriptions persisted by <literal>persistent</literal> subscription
+						handlers are recreated once Asterisk is fully booted, spread over the
+						distributor serializers.  A subscription is not handed to a serializer
+						while that serializer has requests waiting, so REGISTERs and other
+						requests arriving at the same time go first.  When set, at most this
+						many subscriptions are recreated per second.  A value of 0 recreates
+						them as fast as the serializers keep up.  Progress is shown by
+						<literal>pjsip show subscriptions</literal>.
+					</para></description>
+				</configOption>
 				<configOption name="type">
 					<synopsis>Must be of type 'global'.</synopsis>
 				</configOption>
@@ -1558,6 +1668,23 @@
 						</para>
 					</description>
 				</configOption>
+				<configOption name="mwi_unsolicited_rate" default="0">
+					<synopsis>Endpoints sent unsolicited MWI per second.</synopsis>
+					<description>
+						<para>When set, the unsolicited MWI NOTIFYs waiting to be
+						sent are queued, and the contacts of at most this many
+						endpoints are notified per second, spread over the MWI
+						serializers.  An endpoint whose mailboxes change again
+						while it is queued is notified once.  This keeps a
+						voicemail server that republishes every mailbox, or the
+						initial notifications at startup, from flooding the
+						serializers.
+						</para>
+						<para>A value of 0 sends unsolicited MWI as soon as the
+						mailbox changes.
+						</para>
+					</description>
+				</configOption>
 				<configOption name="ignore_uri_user_options">
 					<synopsis>Enable/Disable ignoring SIP URI user field options.</synopsis>
 					<description>
@@ -3331,6 +3458,78 @@ void ast_sip_unregister_supplement(struct ast_sip_supplement *supplement)
 	AST_RWLIST_TRAVERSE_SAFE_END;
 }
 
+AST_RWLIST_HEAD_STATIC(tx_rewrites, ast_sip_tx_rewrite);
+
+int ast_sip_register_tx_rewrite(struct ast_sip_tx_rewrite *rewrite)
+{
+	struct ast_sip_tx_rewrite *iter;
+	int inserted = 0;
+	SCOPED_LOCK(lock, &tx_rewrites, AST_RWLIST_WRLOCK, AST_RWLIST_UNLOCK);
+
+	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&tx_rewrites, iter, next) {
+		if (iter->priority > rewrite->priority) {
+			AST_RWLIST_INSERT_BEFORE_CURRENT(rewrite, next);
+			inserted = 1;
+			break;
+		}
+	}
+	AST_RWLIST_TRAVERSE_SAFE_END;
+
+	if (!inserted) {
+		AST_RWLIST_INSERT_TAIL(&tx_rewrites, rewrite, next);
+	}
+	ast_module_ref(ast_module_info->self);
+	return 0;
+}
+
+void ast_sip_unregister_tx_rewrite(struct ast_sip_tx_rewrite *rewrite)
+{
+	struct ast_sip_tx_rewrite *iter;
+	SCOPED_LOCK(lock, &tx_rewrites, AST_RWLIST_WRLOCK, AST_RWLIST_UNLOCK);
+	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&tx_rewrites, iter, next) {
+		if (rewrite == iter) {
+			AST_RWLIST_REMOVE_CURRENT(next);
+			ast_module_unref(ast_module_info->self);
+			break;
+		}
+	}
+	AST_RWLIST_TRAVERSE_SAFE_END;
+}
+
+/*!
+ * \internal
+ * \brief Apply every rewrite to an outgoing message, then reprint it once if needed.
+ */
+static pj_status_t tx_rewrite_on_tx_message(pjsip_tx_data *tdata)
+{
+	struct ast_sip_tx_rewrite *rewrite;
+	int changed = 0;
+
+	AST_RWLIST_RDLOCK(&tx_rewrites);
+	AST_RWLIST_TRAVERSE(&tx_rewrites, rewrite, next) {
+		if (rewrite->rewrite(tdata)) {
+			ast_debug(4, "Outgoing message %s changed by rewrite '%s'\n",
+				pjsip_tx_data_get_info(tdata), rewrite->name);
+			changed = 1;
+		}
+	}
+	AST_RWLIST_UNLOCK(&tx_rewrites);
+
+	if (changed) {
+		pjsip_tx_data_invalidate_msg(tdata);
+	}
+
+	return PJ_SUCCESS;
+}
+
+static pjsip_module tx_rewrite_module = {
+	.name = { "Outgoing message rewrites", 25 },
+	.id = -1,
+	.priority = PJSIP_MOD_PRIORITY_TSX_LAYER - 1,
+	.on_tx_request = tx_rewrite_on_tx_message,
+	.on_tx_response = tx_rewrite_on_tx_message,
+};
+
 static int send_in_dialog_request(pjsip_tx_data *tdata, struct pjsip_dialog *dlg)
 {
 	if (pjsip_dlg_send_request(dlg, tdata, -1, NULL) != PJ_SUCCESS) {
@@ -4062,6 +4261,10 @@ pj_caching_pool caching_pool;
 pj_pool_t *memory_pool;
 pj_thread_t *monitor_thread;
 static int monitor_continue;
+/*! Threads polling for SIP events in addition to the monitor thread */
+static pj_thread_t *monitor_threads_extra[SIP_MAX_MONITOR_THREADS - 1];
+static unsigned int monitor_threads_extra_count;
+AST_MUTEX_DEFINE_STATIC(monitor_threads_lock);
 
 static void *monitor_thread_exec(void *endpt)
 {
@@ -4074,18 +4277,25 @@ static void *monitor_thread_exec(void *endpt)
 
 static void stop_monitor_thread(void)
 {
+	unsigned int i;
+
 	monitor_continue = 0;
 	pj_thread_join(monitor_thread);
+
+	ast_mutex_lock(&monitor_threads_lock);
+	for (i = 0; i < monitor_threads_extra_count; i++) {
+		pj_thread_join(monitor_threads_extra[i]);
+		pj_thread_destroy(monitor_threads_extra[i]);
+	}
+	monitor_threads_extra_count = 0;
+	ast_mutex_unlock(&monitor_threads_lock);
 }
 
-AST_THREADSTORAGE(pj_thread_storage);
 AST_THREADSTORAGE(servant_id_storage);
 #define SIP_SERVANT_ID 0x5E2F1D
 
 static void sip_thread_start(void)
 {
-	pj_thread_desc *desc;
-	pj_thread_t *thread;
 	uint32_t *servant_id;
 
 	servant_id = ast_threadstorage_get(&servant_id_storage, sizeof(*servant_id));
@@ -4095,16 +4305,47 @@ static void sip_thread_start(void)
 	}
 	*servant_id = SIP_SERVANT_ID;
 
-	desc = ast_threadstorage_get(&pj_thread_storage, sizeof(pj_thread_desc));
-	if (!desc) {
-		ast_log(LOG_ERROR, "Could not get thread desc from thread-local storage. Expect awful things to occur\n");
-		return;
+	ast_pjproject_thread_register("Asterisk Thread");
+}
+
+/*! \internal \brief Poll for SIP events alongside the monitor thread, as a servant thread */
+static void *monitor_thread_extra_exec(void *data)
+{
+	uint32_t *servant_id;
+
+	servant_id = ast_threadstorage_get(&servant_id_storage, sizeof(*servant_id));
+	if (servant_id) {
+		*servant_id = SIP_SERVANT_ID;
+	}
+
+	return monitor_thread_exec(data);
+}
+
+int ast_sip_ensure_monitor_threads(unsigned int count)
+{
+	int res = 0;
+
+	if (count > SIP_MAX_MONITOR_THREADS) {
+		count = SIP_MAX_MONITOR_THREADS;
 	}
-	pj_bzero(*desc, sizeof(*desc));
 
-	if (pj_thread_register("Asterisk Thread", *desc, &thread) != PJ_SUCCESS) {
-		ast_log(LOG_ERROR, "Couldn't register thread with PJLIB.\n");
+	/* The ioqueue of the endpoint is polled from every thread, each handling whichever
+	 * sockets have events, so the extra threads are shared by all transports.
+	 */
+	ast_mutex_lock(&monitor_threads_lock);
+	while (monitor_continue && monitor_threads_extra_count + 1 < count) {
+		if (pj_thread_create(memory_pool, "SIP", (pj_thread_proc *) &monitor_thread_extra_exec,
+				NULL, PJ_THREAD_DEFAULT_STACK_SIZE * 2, 0,
+				&monitor_threads_extra[monitor_threads_extra_count]) != PJ_SUCCESS) {
+			ast_log(LOG_ERROR, "Failed to start additional SIP monitor thread\n");
+			res = -1;
+			break;
+		}
+		++monitor_threads_extra_count;
 	}
+	ast_mutex_unlock(&monitor_threads_lock);
+
+	return res;
 }
 
 int ast_sip_thread_is_servant(void)
@@ -4385,6 +4626,7 @@ static int unload_pjsip(void *data)
 		ast_sip_destroy_system();
 		ast_sip_destroy_global_headers();
 		internal_sip_unregister_service(&supplement_module);
+		internal_sip_unregister_service(&tx_rewrite_module);
 	}
 
 	if (monitor_thread) {
@@ -4400,7 +4642,7 @@ static int unload_pjsip(void *data)
 	ast_pjsip_endpoint = NULL;
 
 	if (caching_pool.lock) {
-		pj_caching_pool_destroy(&caching_pool);
+		ast_pjproject_caching_pool_destroy(&caching_pool);
 	}
 
 	pj_shutdown();
@@ -4413,11 +4655,10 @@ static int load_pjsip(void)
 	const unsigned int flags = 0; /* no port, no brackets */
 	pj_status_t status;
 
-	/* The third parameter is just copied from
-	 * example code from PJLIB. This can be adjusted
-	 * if necessary.
+	/* Transaction and dialog pools come from here, so how much it keeps for
+	 * reuse is configured in pjproject.conf.
 	 */
-	pj_caching_pool_init(&caching_pool, NULL, 1024 * 1024);
+	ast_pjproject_caching_pool_init(&caching_pool, "SIP", NULL);
 	if (pjsip_endpt_create(&caching_pool.factory, "SIP", &ast_pjsip_endpoint) != PJ_SUCCESS) {
 		ast_log(LOG_ERROR, "Failed to create PJSIP endpoint structure. Aborting load\n");
 		goto error;
@@ -4546,6 +4787,11 @@ static int load_module(void)
 		goto error;
 	}
 
+	if (internal_sip_register_service(&tx_rewrite_module)) {
+		ast_log(LOG_ERROR, "Failed to initialize outgoing message rewrites. Aborting load\n");
+		goto error;
+	}
+
 	ast_res_pjsip_init_options_handling(0);
 
 	if (ast_res_pjsip_init_message_ip_updater()) {
@@ -47,7 +47,13 @@
 #define DEFAULT_MWI_TPS_QUEUE_HIGH AST_TASKPROCESSOR_HIGH_WATER_LEVEL
 #define DEFAULT_MWI_TPS_QUEUE_LOW -1
 #define DEFAULT_MWI_DISABLE_INITIAL_UNSOLICITED 0
+#define DEFAULT_MWI_UNSOLICITED_RATE 0
 #define DEFAULT_IGNORE_URI_USER_OPTIONS 0
+#define DEFAULT_DISTRIBUTOR_POOL_SIZE 31
+#define DEFAULT_DISTRIBUTOR_QUEUE_HIGH 0
+#define DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL 0
+#define DEFAULT_EXTEN_STATE_COALESCE_INTERVAL 0
+#define DEFAULT_SUBSCRIPTION_RECREATE_RATE 0
 
 /*!
  * \brief Cached global config object
@@ -100,9 +106,23 @@ struct global_config {
 		int tps_queue_low;
 		/*! Nonzero to disable sending unsolicited mwi to all endpoints on startup */
 		unsigned int disable_initial_unsolicited;
+		/*! Endpoints sent unsolicited mwi per second, 0 for no limit */
+		unsigned int unsolicited_rate;
 	} mwi;
 	/*! Nonzero if URI user field options are ignored. */
 	unsigned int ignore_uri_user_options;
+	struct {
+		/*! Number of serializers requests without a dialog are distributed over */
+		unsigned int pool_size;
+		/*! Serializer queue depth at which new requests are rejected, 0 to never reject */
+		unsigned int queue_high;
+	} distributor;
+	/*! Seconds an endpoint identification is cached for, 0 to not cache */
+	unsigned int endpoint_identifier_cache_ttl;
+	/*! Milliseconds extension state changes are coalesced over, 0 to not coalesce */
+	unsigned int exten_state_coalesce_interval;
+	/*! Persisted subscriptions recreated per second at startup, 0 for no limit */
+	unsigned int subscription_recreate_rate;
 };
 
 static void global_destructor(void *obj)
@@ -315,6 +335,68 @@ void ast_sip_get_unidentified_request_thresholds(unsigned int *count, unsigned i
 	return;
 }
 
+void ast_sip_get_distributor_settings(unsigned int *pool_size, unsigned int *queue_high)
+{
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		*pool_size = DEFAULT_DISTRIBUTOR_POOL_SIZE;
+		*queue_high = DEFAULT_DISTRIBUTOR_QUEUE_HIGH;
+		return;
+	}
+
+	*pool_size = cfg->distributor.pool_size;
+	*queue_high = cfg->distributor.queue_high;
+
+	ao2_ref(cfg, -1);
+}
+
+unsigned int ast_sip_get_endpoint_identifier_cache_ttl(void)
+{
+	unsigned int ttl;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL;
+	}
+
+	ttl = cfg->endpoint_identifier_cache_ttl;
+	ao2_ref(cfg, -1);
+	return ttl;
+}
+
+unsigned int ast_sip_get_exten_state_coalesce_interval(void)
+{
+	unsigned int interval;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_EXTEN_STATE_COALESCE_INTERVAL;
+	}
+
+	interval = cfg->exten_state_coalesce_interval;
+	ao2_ref(cfg, -1);
+	return interval;
+}
+
+unsigned int ast_sip_get_subscription_recreate_rate(void)
+{
+	unsigned int rate;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_SUBSCRIPTION_RECREATE_RATE;
+	}
+
+	rate = cfg->subscription_recreate_rate;
+	ao2_ref(cfg, -1);
+	return rate;
+}
+
 void ast_sip_get_default_realm(char *realm, size_t size)
 {
 	struct global_config *cfg;
@@ -387,6 +469,21 @@ unsigned int ast_sip_get_mwi_disable_initial_unsolicited(void)
 	return disable_initial_unsolicited;
 }
 
+unsigned int ast_sip_get_mwi_unsolicited_rate(void)
+{
+	unsigned int unsolicited_rate;
+	struct global_config *cfg;
+
+	cfg = get_global_cfg();
+	if (!cfg) {
+		return DEFAULT_MWI_UNSOLICITED_RATE;
+	}
+
+	unsolicited_rate = cfg->mwi.unsolicited_rate;
+	ao2_ref(cfg, -1);
+	return unsolicited_rate;
+}
+
 unsigned int ast_sip_get_ignore_uri_user_options(void)
 {
 	unsigned int ignore_uri_user_options;
@@ -550,9 +647,27 @@ int ast_sip_initialize_sorcery_global(void)
 	ast_sorcery_object_field_register(sorcery, "global", "mwi_disable_initial_unsolicited",
 		DEFAULT_MWI_DISABLE_INITIAL_UNSOLICITED ? "yes" : "no",
 		OPT_BOOL_T, 1, FLDSET(struct global_config, mwi.disable_initial_unsolicited));
+	ast_sorcery_object_field_register(sorcery, "global", "mwi_unsolicited_rate",
+		__stringify(DEFAULT_MWI_UNSOLICITED_RATE),
+		OPT_UINT_T, 0, FLDSET(struct global_config, mwi.unsolicited_rate));
 	ast_sorcery_object_field_register(sorcery, "global", "ignore_uri_user_options",
 		DEFAULT_IGNORE_URI_USER_OPTIONS ? "yes" : "no",
 		OPT_BOOL_T, 1, FLDSET(struct global_config, ignore_uri_user_options));
+	ast_sorcery_object_field_register(sorcery, "global", "distributor_pool_size",
+		__stringify(DEFAULT_DISTRIBUTOR_POOL_SIZE),
+		OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct global_config, distributor.pool_size), 1, 1024);
+	ast_sorcery_object_field_register(sorcery, "global", "distributor_queue_high",
+		__stringify(DEFAULT_DISTRIBUTOR_QUEUE_HIGH),
+		OPT_UINT_T, 0, FLDSET(struct global_config, distributor.queue_high));
+	ast_sorcery_object_field_register(sorcery, "global", "endpoint_identifier_cache_ttl",
+		__stringify(DEFAULT_ENDPOINT_IDENTIFIER_CACHE_TTL),
+		OPT_UINT_T, 0, FLDSET(struct global_config, endpoint_identifier_cache_ttl));
+	ast_sorcery_object_field_register(sorcery, "global", "exten_state_coalesce_interval",
+		__stringify(DEFAULT_EXTEN_STATE_COALESCE_INTERVAL),
+		OPT_UINT_T, 0, FLDSET(struct global_config, exten_state_coalesce_interval));
+	ast_sorcery_object_field_register(sorcery, "global", "subscription_recreate_rate",
+		__stringify(DEFAULT_SUBSCRIPTION_RECREATE_RATE),
+		OPT_UINT_T, 0, FLDSET(struct global_config, subscription_recreate_rate));
 
 	if (ast_sorcery_instance_observer_add(sorcery, &observer_callbacks_global)) {
 		return -1;
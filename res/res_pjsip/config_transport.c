@@ -237,6 +237,7 @@ static void *sip_transport_alloc(const char *name)
 		ao2_cleanup(transport);
 		return NULL;
 	}
+	ast_string_field_init_extended(transport, outbound_prewarm);
 
 	return transport;
 }
@@ -254,6 +255,10 @@ static int destroy_sip_transport_state(void *data)
 	if (transport_state->transport) {
 		pjsip_transport_shutdown(transport_state->transport);
 	}
+	while (transport_state->reuseport_transport_count) {
+		pjsip_transport_shutdown(transport_state->reuseport_transports[--transport_state->reuseport_transport_count]);
+	}
+	ast_free(transport_state->reuseport_transports);
 
 	return 0;
 }
@@ -442,6 +447,135 @@ static int has_state_changed(struct ast_sip_transport_state *a, struct ast_sip_t
 	return 0;
 }
 
+/*! \brief Pause the UDP transports of a state, destroying their sockets */
+static void udp_transports_pause(struct ast_sip_transport_state *state)
+{
+	unsigned int i;
+
+	pjsip_udp_transport_pause(state->transport, PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
+	for (i = 0; i < state->reuseport_transport_count; i++) {
+		pjsip_udp_transport_pause(state->reuseport_transports[i], PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
+	}
+}
+
+/*! \brief Shut down the UDP transports of a state which did not all start */
+static void udp_transports_shutdown(struct ast_sip_transport_state *state)
+{
+	if (state->transport) {
+		pjsip_transport_shutdown(state->transport);
+		state->transport = NULL;
+	}
+	while (state->reuseport_transport_count) {
+		pjsip_transport_shutdown(state->reuseport_transports[--state->reuseport_transport_count]);
+	}
+}
+
+/*!
+ * \brief Start UDP transports on sockets sharing the bound address using SO_REUSEPORT
+ *
+ * The first transport becomes the transport of the state, the rest are additional transports.
+ */
+static pj_status_t udp_transports_start_reuseport(struct ast_sip_transport *transport,
+	struct ast_sip_transport_state *state)
+{
+#ifdef SO_REUSEPORT
+	pjsip_transport_type_e type = state->host.addr.sa_family == pj_AF_INET6() ?
+		PJSIP_TRANSPORT_UDP6 : PJSIP_TRANSPORT_UDP;
+	char host[PJ_INET6_ADDRSTRLEN];
+	pjsip_host_port published;
+	pj_sockaddr published_addr;
+	pj_status_t res = PJ_SUCCESS;
+	unsigned int i;
+	int on = 1;
+
+	if (!state->reuseport_transports) {
+		state->reuseport_transports = ast_calloc(transport->udp_sockets - 1,
+			sizeof(*state->reuseport_transports));
+		if (!state->reuseport_transports) {
+			return PJ_ENOMEM;
+		}
+	}
+
+	/* Advertise the bound address, or the address of the host when bound to any */
+	if (pj_sockaddr_has_addr(&state->host)) {
+		pj_sockaddr_cp(&published_addr, &state->host);
+	} else if ((res = pj_gethostip(state->host.addr.sa_family, &published_addr)) != PJ_SUCCESS) {
+		return res;
+	}
+	pj_sockaddr_print(&published_addr, host, sizeof(host), 0);
+	published.host = pj_str(host);
+	published.port = pj_sockaddr_get_port(&state->host);
+
+	for (i = 0; i < transport->udp_sockets; i++) {
+		pj_sock_t sock;
+		pjsip_transport *udp;
+
+		res = pj_sock_socket(state->host.addr.sa_family, pj_SOCK_DGRAM(), 0, &sock);
+		if (res != PJ_SUCCESS) {
+			break;
+		}
+
+		res = pj_sock_setsockopt(sock, pj_SOL_SOCKET(), SO_REUSEPORT, &on, sizeof(on));
+		if (res == PJ_SUCCESS) {
+			res = pj_sock_bind(sock, &state->host, pj_sockaddr_get_len(&state->host));
+		}
+		if (res != PJ_SUCCESS) {
+			pj_sock_close(sock);
+			break;
+		}
+
+		/* Once attaching starts pjsip owns the socket, closing it if the transport can not be created */
+		res = pjsip_udp_transport_attach2(ast_sip_get_pjsip_endpoint(), type, sock, &published,
+			transport->async_operations, &udp);
+		if (res != PJ_SUCCESS) {
+			break;
+		}
+
+		if (!state->transport) {
+			state->transport = udp;
+		} else {
+			state->reuseport_transports[state->reuseport_transport_count++] = udp;
+		}
+	}
+
+	if (res != PJ_SUCCESS) {
+		udp_transports_shutdown(state);
+		return res;
+	}
+
+	if (ast_sip_ensure_monitor_threads(transport->udp_sockets)) {
+		ast_log(LOG_WARNING, "Transport '%s' has %u sockets but fewer threads are polling them\n",
+			ast_sorcery_object_get_id(transport), transport->udp_sockets);
+	}
+
+	return PJ_SUCCESS;
+#else
+	return PJ_ENOTSUP;
+#endif
+}
+
+int ast_sip_transport_state_has_transport(const struct ast_sip_transport_state *transport_state,
+	const struct pjsip_transport *transport)
+{
+	unsigned int i;
+
+	if (!transport) {
+		return 0;
+	}
+
+	if (transport_state->transport == transport) {
+		return 1;
+	}
+
+	for (i = 0; i < transport_state->reuseport_transport_count; i++) {
+		if (transport_state->reuseport_transports[i] == transport) {
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
 static void states_cleanup(void *states)
 {
 	if (states) {
@@ -536,12 +670,18 @@ static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 
 		for (i = 0; i < BIND_TRIES && res != PJ_SUCCESS; i++) {
 			if (perm_state && perm_state->state && perm_state->state->transport) {
-				pjsip_udp_transport_pause(perm_state->state->transport,
-					PJSIP_UDP_TRANSPORT_DESTROY_SOCKET);
+				udp_transports_pause(perm_state->state);
 				usleep(BIND_DELAY_US);
 			}
 
-			if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
+			if (transport->udp_sockets > 1) {
+				res = udp_transports_start_reuseport(transport, temp_state->state);
+				if (res == PJ_ENOTSUP) {
+					ast_log(LOG_ERROR, "Transport '%s' can not bind more than one UDP socket as SO_REUSEPORT is not supported\n",
+						transport_id);
+					break;
+				}
+			} else if (temp_state->state->host.addr.sa_family == pj_AF_INET()) {
 				res = pjsip_udp_transport_start(ast_sip_get_pjsip_endpoint(),
 					&temp_state->state->host.ipv4, NULL, transport->async_operations,
 					&temp_state->state->transport);
@@ -555,10 +695,17 @@ static int transport_apply(const struct ast_sorcery *sorcery, void *obj)
 		if (res == PJ_SUCCESS && (transport->tos || transport->cos)) {
 			pj_sock_t sock;
 			pj_qos_params qos_params;
+			unsigned int j;
+
 			sock = pjsip_udp_transport_get_socket(temp_state->state->transport);
 			pj_sock_get_qos_params(sock, &qos_params);
 			set_qos(transport, &qos_params);
 			pj_sock_set_qos_params(sock, &qos_params);
+			for (j = 0; j < temp_state->state->reuseport_transport_count; j++) {
+				pj_sock_set_qos_params(
+					pjsip_udp_transport_get_socket(temp_state->state->reuseport_transports[j]),
+					&qos_params);
+			}
 		}
 	} else if (transport->type == AST_TRANSPORT_TCP) {
 		pjsip_tcp_transport_cfg cfg;
@@ -1375,6 +1522,10 @@ int ast_sip_initialize_sorcery_transport(void)
 	ast_sorcery_object_field_register(sorcery, "transport", "cos", "0", OPT_UINT_T, 0, FLDSET(struct ast_sip_transport, cos));
 	ast_sorcery_object_field_register(sorcery, "transport", "websocket_write_timeout", AST_DEFAULT_WEBSOCKET_WRITE_TIMEOUT_STR, OPT_INT_T, PARSE_IN_RANGE, FLDSET(struct ast_sip_transport, write_timeout), 1, INT_MAX);
 	ast_sorcery_object_field_register(sorcery, "transport", "allow_reload", "no", OPT_BOOL_T, 1, FLDSET(struct ast_sip_transport, allow_reload));
+	ast_sorcery_object_field_register(sorcery, "transport", "udp_sockets", "1", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct ast_sip_transport, udp_sockets), 1, SIP_MAX_MONITOR_THREADS);
+	ast_sorcery_object_field_register(sorcery, "transport", "outbound_max_idle", "0", OPT_UINT_T, 0, FLDSET(struct ast_sip_transport, outbound_max_idle));
+	ast_sorcery_object_field_register(sorcery, "transport", "outbound_keep_alive_interval", "0", OPT_UINT_T, 0, FLDSET(struct ast_sip_transport, outbound_keep_alive_interval));
+	ast_sorcery_object_field_register(sorcery, "transport", "outbound_prewarm", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_sip_transport, outbound_prewarm));
 
 	internal_sip_register_endpoint_formatter(&endpoint_transport_formatter);
 
@@ -346,4 +346,19 @@ int ast_sip_initialize_scheduler(void);
  */
 int ast_sip_destroy_scheduler(void);
 
+/*! \brief The most threads polling for SIP events, and so UDP sockets sharing a transport address */
+#define SIP_MAX_MONITOR_THREADS 32
+
+/*!
+ * \internal
+ * \brief Make sure at least a number of threads are polling for SIP events
+ * \since 15.0.0
+ *
+ * \param count The number of polling threads wanted
+ *
+ * \retval -1 failure
+ * \retval 0 success
+ */
+int ast_sip_ensure_monitor_threads(unsigned int count);
+
 #endif /* RES_PJSIP_PRIVATE_H_ */
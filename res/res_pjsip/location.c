@@ -36,6 +36,35 @@
 static int pj_max_hostname = PJ_MAX_HOSTNAME;
 static int pjsip_max_url_size = PJSIP_MAX_URL_SIZE;
 
+#define CONTACT_INDEX_BUCKETS 4093
+#define CONTACT_INDEX_PENDING_BUCKETS 61
+
+/*! \brief Dynamic contacts of an AOR held in the contact index */
+struct contact_index_aor {
+	/*! \brief The contacts, in the order they were added */
+	struct ao2_container *contacts;
+	/*! \brief Name of the AOR */
+	char name[];
+};
+
+/*!
+ * \brief Dynamic contacts of every AOR by AOR name
+ *
+ * \details
+ * Only used when contacts are stored in astdb alone, since then every change
+ * to them is made by this process.  Lookups are answered from here instead of
+ * scanning astdb.  NULL if not in use.
+ */
+static struct ao2_container *contact_index;
+
+/*!
+ * \brief Contacts written through the location API whose sorcery observer
+ * notification has not been seen yet
+ */
+static struct ao2_container *contact_index_pending;
+
+static struct ao2_container *contact_index_retrieve(const char *aor_name);
+
 /*! \brief Destructor for AOR */
 static void aor_destroy(void *obj)
 {
@@ -90,8 +119,13 @@ static void aor_deleted_observer(const void *object)
 		ao2_callback(aor->permanent_contacts, OBJ_NODATA | OBJ_MULTIPLE | OBJ_UNLINK, destroy_contact, NULL);
 	}
 
-	snprintf(regex, sizeof(regex), "^%s;@", aor_id);
-	if (!(contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex))) {
+	if (contact_index) {
+		contacts = contact_index_retrieve(aor_id);
+	} else {
+		snprintf(regex, sizeof(regex), "^%s;@", aor_id);
+		contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex);
+	}
+	if (!contacts) {
 		return;
 	}
 	/* Destroy any contacts that may still exist that were made for this AoR */
@@ -115,6 +149,25 @@ static void contact_destroy(void *obj)
 	ao2_cleanup(contact->endpoint);
 }
 
+/*! \brief Copy handler for contact, so copies do not go through an objectset */
+static int contact_copy(const void *src, void *dst)
+{
+	const struct ast_sip_contact *original = src;
+	struct ast_sip_contact *copy = dst;
+
+	if (ast_string_fields_copy(copy, original)) {
+		return -1;
+	}
+
+	copy->expiration_time = original->expiration_time;
+	copy->qualify_frequency = original->qualify_frequency;
+	copy->authenticate_qualify = original->authenticate_qualify;
+	copy->qualify_timeout = original->qualify_timeout;
+	copy->via_port = original->via_port;
+
+	return 0;
+}
+
 /*! \brief Allocator for contact */
 static void *contact_alloc(const char *name)
 {
@@ -148,6 +201,231 @@ static void *contact_alloc(const char *name)
 	return contact;
 }
 
+AO2_STRING_FIELD_HASH_FN(contact_index_aor, name);
+AO2_STRING_FIELD_CMP_FN(contact_index_aor, name);
+
+static void contact_index_aor_destroy(void *obj)
+{
+	struct contact_index_aor *entry = obj;
+
+	ao2_cleanup(entry->contacts);
+}
+
+static int contact_index_pending_hash(const void *obj, int flags)
+{
+	return (int) ((uintptr_t) obj >> 4);
+}
+
+static int contact_index_pending_cmp(void *obj, void *arg, int flags)
+{
+	return obj == arg ? CMP_MATCH | CMP_STOP : 0;
+}
+
+/*!
+ * \internal
+ * \brief Add or replace a contact in the index
+ *
+ * \param contact The contact, as written to sorcery
+ */
+static void contact_index_link(struct ast_sip_contact *contact)
+{
+	struct contact_index_aor *entry;
+
+	ao2_wrlock(contact_index);
+	entry = ao2_find(contact_index, contact->aor, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!entry) {
+		entry = ao2_alloc_options(sizeof(*entry) + strlen(contact->aor) + 1,
+			contact_index_aor_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!entry) {
+			ao2_unlock(contact_index);
+			return;
+		}
+		strcpy(entry->name, contact->aor); /* Safe */
+		entry->contacts = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+			NULL, ast_sorcery_object_id_compare);
+		if (!entry->contacts) {
+			ao2_ref(entry, -1);
+			ao2_unlock(contact_index);
+			return;
+		}
+		ao2_link_flags(contact_index, entry, OBJ_NOLOCK);
+	}
+
+	ao2_wrlock(entry->contacts);
+	ao2_find(entry->contacts, ast_sorcery_object_get_id(contact),
+		OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+	ao2_link_flags(entry->contacts, contact, OBJ_NOLOCK);
+	ao2_unlock(entry->contacts);
+
+	ao2_ref(entry, -1);
+	ao2_unlock(contact_index);
+}
+
+/*!
+ * \internal
+ * \brief Remove a contact from the index
+ *
+ * \param contact The contact, or any object with its name
+ */
+static void contact_index_unlink(const struct ast_sip_contact *contact)
+{
+	struct contact_index_aor *entry;
+
+	ao2_wrlock(contact_index);
+	entry = ao2_find(contact_index, contact->aor, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (entry) {
+		ao2_find(entry->contacts, ast_sorcery_object_get_id(contact),
+			OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+		if (!ao2_container_count(entry->contacts)) {
+			ao2_unlink_flags(contact_index, entry, OBJ_NOLOCK);
+		}
+		ao2_ref(entry, -1);
+	}
+	ao2_unlock(contact_index);
+}
+
+/*!
+ * \internal
+ * \brief Copy the indexed contacts of an AOR
+ *
+ * \param aor_name Name of the AOR
+ *
+ * \retval NULL on failure
+ * \return A container of the contacts, like one sorcery would return
+ */
+static struct ao2_container *contact_index_retrieve(const char *aor_name)
+{
+	struct contact_index_aor *entry;
+	struct ao2_container *contacts;
+
+	contacts = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 1, NULL, NULL);
+	if (!contacts) {
+		return NULL;
+	}
+
+	entry = ao2_find(contact_index, aor_name, OBJ_SEARCH_KEY);
+	if (entry) {
+		ao2_container_dup(contacts, entry->contacts, 0);
+		ao2_ref(entry, -1);
+	}
+
+	return contacts;
+}
+
+/*!
+ * \internal
+ * \brief Note a contact written through the location API
+ *
+ * \details
+ * The sorcery observer skips it, since the index was already updated.
+ */
+static void contact_index_pending_add(struct ast_sip_contact *contact)
+{
+	ao2_link(contact_index_pending, contact);
+}
+
+/*!
+ * \internal
+ * \brief Determine if a contact seen by the sorcery observer was written through the location API
+ *
+ * \retval 1 if it was, forgetting it
+ * \retval 0 if it was written by something else
+ */
+static int contact_index_pending_remove(const void *contact)
+{
+	return ao2_find(contact_index_pending, (void *) contact,
+		OBJ_SEARCH_OBJECT | OBJ_UNLINK | OBJ_NODATA) ? 1 : 0;
+}
+
+static void contact_index_changed(const void *object)
+{
+	if (!contact_index_pending_remove(object)) {
+		contact_index_link((struct ast_sip_contact *) object);
+	}
+}
+
+static void contact_index_deleted(const void *object)
+{
+	if (!contact_index_pending_remove(object)) {
+		contact_index_unlink(object);
+	}
+}
+
+/*! \brief Observer which keeps the index up to date with contacts not written through the location API */
+static const struct ast_sorcery_observer contact_index_observer = {
+	.created = contact_index_changed,
+	.updated = contact_index_changed,
+	.deleted = contact_index_deleted,
+};
+
+/*!
+ * \internal
+ * \brief Load the index from astdb if contacts are only stored there
+ *
+ * \retval 0 on success, or if the index is not used
+ * \retval -1 on failure
+ */
+static int contact_index_setup(struct ast_sorcery *sorcery)
+{
+	struct ast_sorcery_wizard *wizard;
+	void *data;
+	struct ao2_container *contacts;
+	struct ao2_iterator iter;
+	struct ast_sip_contact *contact;
+	int astdb;
+
+	if (ast_sorcery_get_wizard_mapping_count(sorcery, "contact") != 1
+		|| ast_sorcery_get_wizard_mapping(sorcery, "contact", 0, &wizard, &data)) {
+		return 0;
+	}
+	astdb = !strcmp(wizard->name, "astdb");
+	ao2_ref(wizard, -1);
+	if (!astdb) {
+		return 0;
+	}
+
+	contact_index = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		CONTACT_INDEX_BUCKETS, contact_index_aor_hash_fn, NULL, contact_index_aor_cmp_fn);
+	contact_index_pending = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_DUPS_OBJ_REJECT, CONTACT_INDEX_PENDING_BUCKETS,
+		contact_index_pending_hash, NULL, contact_index_pending_cmp);
+	if (!contact_index || !contact_index_pending
+		|| ast_sorcery_observer_add(sorcery, "contact", &contact_index_observer)) {
+		ao2_cleanup(contact_index);
+		contact_index = NULL;
+		ao2_cleanup(contact_index_pending);
+		contact_index_pending = NULL;
+		return -1;
+	}
+
+	contacts = ast_sorcery_retrieve_by_fields(sorcery, "contact",
+		AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (contacts) {
+		iter = ao2_iterator_init(contacts, 0);
+		for (; (contact = ao2_iterator_next(&iter)); ao2_ref(contact, -1)) {
+			contact_index_link(contact);
+		}
+		ao2_iterator_destroy(&iter);
+		ast_debug(1, "Indexed %d contacts stored in astdb\n", ao2_container_count(contacts));
+		ao2_ref(contacts, -1);
+	}
+
+	return 0;
+}
+
+static void contact_index_destroy(void)
+{
+	if (!contact_index) {
+		return;
+	}
+
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "contact", &contact_index_observer);
+	ao2_cleanup(contact_index);
+	contact_index = NULL;
+	ao2_cleanup(contact_index_pending);
+	contact_index_pending = NULL;
+}
+
 struct ast_sip_aor *ast_sip_location_retrieve_aor(const char *aor_name)
 {
 	return ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "aor", aor_name);
@@ -197,9 +475,13 @@ struct ao2_container *ast_sip_location_retrieve_aor_contacts_nolock(const struct
 	char regex[strlen(ast_sorcery_object_get_id(aor)) + 4];
 	struct ao2_container *contacts;
 
-	snprintf(regex, sizeof(regex), "^%s;@", ast_sorcery_object_get_id(aor));
-
-	if (!(contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex))) {
+	if (contact_index) {
+		contacts = contact_index_retrieve(ast_sorcery_object_get_id(aor));
+	} else {
+		snprintf(regex, sizeof(regex), "^%s;@", ast_sorcery_object_get_id(aor));
+		contacts = ast_sorcery_retrieve_by_regex(ast_sip_get_sorcery(), "contact", regex);
+	}
+	if (!contacts) {
 		return NULL;
 	}
 
@@ -306,7 +588,74 @@ struct ao2_container *ast_sip_location_retrieve_contacts_from_aor_list(const cha
 
 struct ast_sip_contact *ast_sip_location_retrieve_contact(const char *contact_name)
 {
-	return ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "contact", contact_name);
+	char *aor_name;
+	char *separator;
+	struct contact_index_aor *entry;
+	struct ast_sip_contact *contact = NULL;
+
+	if (!contact_index) {
+		return ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "contact", contact_name);
+	}
+
+	aor_name = ast_strdupa(contact_name);
+	if ((separator = strstr(aor_name, ";@"))) {
+		*separator = '\0';
+	}
+
+	entry = ao2_find(contact_index, aor_name, OBJ_SEARCH_KEY);
+	if (entry) {
+		contact = ao2_find(entry->contacts, contact_name, OBJ_SEARCH_KEY);
+		ao2_ref(entry, -1);
+	}
+
+	return contact;
+}
+
+/*! \brief Internal callback function which links the expired contacts of an AOR into another container */
+static int contact_index_gather_expired(void *obj, void *arg, int flags)
+{
+	struct contact_index_aor *entry = obj;
+	struct ao2_container *expired = arg;
+	struct ao2_iterator iter;
+	struct ast_sip_contact *contact;
+	struct timeval now = ast_tvnow();
+
+	iter = ao2_iterator_init(entry->contacts, 0);
+	for (; (contact = ao2_iterator_next(&iter)); ao2_ref(contact, -1)) {
+		if (ast_tvdiff_ms(contact->expiration_time, now) <= 0) {
+			ao2_link(expired, contact);
+		}
+	}
+	ao2_iterator_destroy(&iter);
+
+	return 0;
+}
+
+struct ao2_container *ast_sip_location_retrieve_expired_contacts(void)
+{
+	struct ao2_container *expired;
+	struct ast_variable *var;
+	char time[64];
+
+	if (contact_index) {
+		expired = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 1, NULL, NULL);
+		if (expired) {
+			ao2_callback(contact_index, OBJ_NODATA, contact_index_gather_expired, expired);
+		}
+		return expired;
+	}
+
+	snprintf(time, sizeof(time), "%ld", ast_tvnow().tv_sec);
+	var = ast_variable_new("expiration_time <=", time, "");
+	if (!var) {
+		return NULL;
+	}
+
+	expired = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "contact",
+		AST_RETRIEVE_FLAG_MULTIPLE, var);
+	ast_variables_destroy(var);
+
+	return expired;
 }
 
 int ast_sip_location_add_contact_nolock(struct ast_sip_aor *aor, const char *uri,
@@ -363,7 +712,17 @@ int ast_sip_location_add_contact_nolock(struct ast_sip_aor *aor, const char *uri
 		ast_string_field_set(contact, endpoint_name, ast_sorcery_object_get_id(endpoint));
 	}
 
-	res = ast_sorcery_create(ast_sip_get_sorcery(), contact);
+	if (!contact_index) {
+		res = ast_sorcery_create(ast_sip_get_sorcery(), contact);
+	} else {
+		contact_index_pending_add(contact);
+		res = ast_sorcery_create(ast_sip_get_sorcery(), contact);
+		if (!res) {
+			contact_index_link(contact);
+		} else {
+			contact_index_pending_remove(contact);
+		}
+	}
 	ao2_ref(contact, -1);
 	return res;
 }
@@ -384,14 +743,62 @@ int ast_sip_location_add_contact(struct ast_sip_aor *aor, const char *uri,
 	return res;
 }
 
-int ast_sip_location_update_contact(struct ast_sip_contact *contact)
+/*! \brief Internal function which updates all or only the refreshed fields of a contact */
+static int contact_update(struct ast_sip_contact *contact, int refresh)
 {
+	if (refresh) {
+		return ast_sorcery_update_fields(ast_sip_get_sorcery(), contact, "expiration_time",
+			"qualify_frequency", "authenticate_qualify", "path", "user_agent", "reg_server",
+			SENTINEL);
+	}
+
 	return ast_sorcery_update(ast_sip_get_sorcery(), contact);
 }
 
+static int location_update_contact(struct ast_sip_contact *contact, int refresh)
+{
+	int res;
+
+	if (!contact_index) {
+		return contact_update(contact, refresh);
+	}
+
+	contact_index_pending_add(contact);
+	res = contact_update(contact, refresh);
+	if (!res) {
+		contact_index_link(contact);
+	} else {
+		contact_index_pending_remove(contact);
+	}
+	return res;
+}
+
+int ast_sip_location_update_contact(struct ast_sip_contact *contact)
+{
+	return location_update_contact(contact, 0);
+}
+
+int ast_sip_location_refresh_contact(struct ast_sip_contact *contact)
+{
+	return location_update_contact(contact, 1);
+}
+
 int ast_sip_location_delete_contact(struct ast_sip_contact *contact)
 {
-	return ast_sorcery_delete(ast_sip_get_sorcery(), contact);
+	int res;
+
+	if (!contact_index) {
+		return ast_sorcery_delete(ast_sip_get_sorcery(), contact);
+	}
+
+	contact_index_pending_add(contact);
+	res = ast_sorcery_delete(ast_sip_get_sorcery(), contact);
+	if (res) {
+		contact_index_pending_remove(contact);
+	}
+	/* A contact which could not be deleted from astdb was not there to begin with. */
+	contact_index_unlink(contact);
+	return res;
 }
 
 /*! \brief Custom handler for translating from a string timeval to actual structure */
@@ -1157,8 +1564,14 @@ int ast_sip_initialize_sorcery_location(void)
 		return -1;
 	}
 
+	ast_sorcery_object_set_copy_handler(sorcery, "contact", contact_copy);
+
 	ast_sorcery_observer_add(sorcery, "aor", &aor_observer);
 
+	if (contact_index_setup(sorcery)) {
+		return -1;
+	}
+
 	ast_sorcery_object_field_register(sorcery, "contact", "type", "", OPT_NOOP_T, 0, 0);
 	ast_sorcery_object_field_register(sorcery, "contact", "uri", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_sip_contact, uri));
 	ast_sorcery_object_field_register(sorcery, "contact", "path", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ast_sip_contact, path));
@@ -1237,6 +1650,7 @@ int ast_sip_initialize_sorcery_location(void)
 int ast_sip_destroy_sorcery_location(void)
 {
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "aor", &aor_observer);
+	contact_index_destroy();
 	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
 	ast_sip_unregister_cli_formatter(contact_formatter);
 	ast_sip_unregister_cli_formatter(aor_formatter);
@@ -1344,17 +1344,23 @@ int ast_sip_for_each_channel_snapshot(
 	const struct ast_endpoint_snapshot *endpoint_snapshot,
 	ao2_callback_fn on_channel_snapshot, void *arg)
 {
-	int num, num_channels = endpoint_snapshot->num_channels;
+	RAII_VAR(struct ast_endpoint_channel_ids *, channel_ids, NULL, ao2_cleanup);
+	int num;
+
+	if (!on_channel_snapshot || !endpoint_snapshot->num_channels) {
+		return 0;
+	}
 
-	if (!on_channel_snapshot || !num_channels) {
+	channel_ids = ast_endpoint_snapshot_channel_ids(endpoint_snapshot);
+	if (!channel_ids) {
 		return 0;
 	}
 
-	for (num = 0; num < num_channels; ++num) {
+	for (num = 0; num < channel_ids->num_channels; ++num) {
 		RAII_VAR(struct ast_channel_snapshot *, snapshot, NULL, ao2_cleanup);
 		int res;
 
-		snapshot = ast_channel_snapshot_get_latest(endpoint_snapshot->channel_ids[num]);
+		snapshot = ast_channel_snapshot_get_latest(channel_ids->channel_ids[num]);
 		if (!snapshot) {
 			continue;
 		}
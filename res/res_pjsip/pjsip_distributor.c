@@ -59,11 +59,58 @@ struct unidentified_request{
 	char src_name[];
 };
 
+#define ENDPOINT_CACHE_BUCKETS 257
+
+/*! Most endpoint identifications remembered at once */
+#define ENDPOINT_CACHE_MAX 8192
+
+/*! Endpoint identified for a source address and From user */
+struct endpoint_cache_entry {
+	/*! When the identification is forgotten */
+	struct timeval expires;
+	/*! The endpoint identified */
+	struct ast_sip_endpoint *endpoint;
+	/*! Source address, port and From user and host */
+	char key[];
+};
+
+static struct ao2_container *endpoint_cache;
+static unsigned int endpoint_cache_ttl;
+
 /*! Number of serializers in pool if one not otherwise known.  (Best if prime number) */
 #define DISTRIBUTOR_POOL_SIZE		31
 
+/*! A serializer in the distributor pool and what it has been handed */
+struct distributor_serializer {
+	/*! The serializer tasks are pushed to */
+	struct ast_taskprocessor *serializer;
+	/*! Number of messages queued on the serializer */
+	int queued;
+	/*! Number of requests rejected because the serializer was backed up */
+	int rejected;
+	/*! Deepest the queue has been when a message was queued */
+	long max_depth;
+	/*! Number of messages processed, only updated by the serializer */
+	unsigned int processed;
+	/*! Milliseconds the processed messages waited between receipt and processing */
+	int64_t latency_total;
+	/*! Longest any processed message waited */
+	int64_t latency_max;
+};
+
 /*! Pool of serializers to use if not supplied. */
-static struct ast_taskprocessor *distributor_pool[DISTRIBUTOR_POOL_SIZE];
+struct distributor_pool {
+	/*! Number of serializers in the pool */
+	int size;
+	/*! The serializers */
+	struct distributor_serializer *serializers[];
+};
+
+/*! The current distributor pool, replaced when its configured size changes */
+static AO2_GLOBAL_OBJ_STATIC(distributor_pool);
+
+/*! Serializer queue depth at which requests outside of a dialog are rejected, 0 if never */
+static unsigned int distributor_queue_high;
 
 /*!
  * \internal
@@ -290,53 +337,28 @@ static pjsip_dialog *find_dialog(pjsip_rx_data *rdata)
  * \since 13.10.0
  *
  * \param[in] str The pjlib string to add to the hash
- * \param[in] hash The hash value to add to
- *
- * \details
- * This version of the function is for when you need to compute a
- * string hash of more than one string.
- *
- * This famous hash algorithm was written by Dan Bernstein and is
- * commonly used.
- *
- * \sa http://www.cse.yorku.ca/~oz/hash.html
+ * \param[in] hash The hash value to add to, or 0 for the first string
  */
 static int pjstr_hash_add(pj_str_t *str, int hash)
 {
-	size_t len;
-	const char *pos;
-
-	len = pj_strlen(str);
-	pos = pj_strbuf(str);
-	while (len--) {
-		hash = hash * 33 ^ *pos++;
-	}
-
-	return hash;
+	return ast_str_hash_fast_len(pj_strbuf(str), pj_strlen(str), hash);
 }
 
 /*!
  * \internal
- * \brief Compute a hash value on a pjlib string
- * \since 13.10.0
+ * \brief Pick the pool serializer for a message outside of a dialog.
  *
- * \param[in] str The pjlib string to hash
+ * \param rdata The message.
  *
- * This famous hash algorithm was written by Dan Bernstein and is
- * commonly used.
- *
- * http://www.cse.yorku.ca/~oz/hash.html
+ * \retval NULL on error.
+ * \return the serializer picked, with a reference the caller must release.
  */
-static int pjstr_hash(pj_str_t *str)
-{
-	return pjstr_hash_add(str, 5381);
-}
-
-struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata)
+static struct distributor_serializer *distributor_pool_pick(pjsip_rx_data *rdata)
 {
 	int hash;
 	pj_str_t *remote_tag;
-	struct ast_taskprocessor *serializer;
+	struct distributor_pool *pool;
+	struct distributor_serializer *picked;
 
 	if (!rdata->msg_info.msg) {
 		return NULL;
@@ -349,18 +371,65 @@ struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdat
 	}
 
 	/* Compute the hash from the SIP message call-id and remote-tag */
-	hash = pjstr_hash(&rdata->msg_info.cid->id);
+	hash = pjstr_hash_add(&rdata->msg_info.cid->id, 0);
 	hash = pjstr_hash_add(remote_tag, hash);
-	hash = abs(hash);
 
-	serializer = ao2_bump(distributor_pool[hash % ARRAY_LEN(distributor_pool)]);
-	if (serializer) {
-		ast_debug(3, "Calculated serializer %s to use for %s\n",
-			ast_taskprocessor_name(serializer), pjsip_rx_data_get_info(rdata));
+	pool = ao2_global_obj_ref(distributor_pool);
+	if (!pool) {
+		return NULL;
 	}
+	picked = ao2_bump(pool->serializers[hash % pool->size]);
+	ao2_ref(pool, -1);
+
+	ast_debug(3, "Calculated serializer %s to use for %s\n",
+		ast_taskprocessor_name(picked->serializer), pjsip_rx_data_get_info(rdata));
+	return picked;
+}
+
+struct ast_taskprocessor *ast_sip_get_distributor_serializer(pjsip_rx_data *rdata)
+{
+	struct distributor_serializer *picked;
+	struct ast_taskprocessor *serializer;
+
+	picked = distributor_pool_pick(rdata);
+	if (!picked) {
+		return NULL;
+	}
+	serializer = ao2_bump(picked->serializer);
+	ao2_ref(picked, -1);
 	return serializer;
 }
 
+/*!
+ * \internal
+ * \brief Determine if a request must be rejected because its pool serializer is backed up.
+ *
+ * \param picked The pool serializer picked for the request.
+ * \param rdata The request.
+ *
+ * \retval 0 if the request can be queued.
+ * \retval 1 if the request must be rejected.
+ */
+static int distributor_pool_overloaded(struct distributor_serializer *picked, pjsip_rx_data *rdata)
+{
+	long depth;
+
+	if (!distributor_queue_high
+		|| rdata->msg_info.msg->line.req.method.id == PJSIP_ACK_METHOD) {
+		return 0;
+	}
+
+	depth = ast_taskprocessor_size(picked->serializer);
+	if (depth < distributor_queue_high) {
+		return 0;
+	}
+
+	ast_atomic_fetchadd_int(&picked->rejected, +1);
+	ast_debug(3, "Serializer %s has %ld tasks queued: Rejecting '%s'.\n",
+		ast_taskprocessor_name(picked->serializer), depth, pjsip_rx_data_get_info(rdata));
+	return 1;
+}
+
 static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata);
 
 static pjsip_module endpoint_mod = {
@@ -373,6 +442,7 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 {
 	pjsip_dialog *dlg;
 	struct distributor_dialog_data *dist = NULL;
+	struct distributor_serializer *picked = NULL;
 	struct ast_taskprocessor *serializer = NULL;
 	pjsip_rx_data *clone;
 
@@ -418,7 +488,7 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 			 * the stack can figure out what it is for, or we really
 			 * should just toss it regardless.
 			 */
-			serializer = ast_sip_get_distributor_serializer(rdata);
+			picked = distributor_pool_pick(rdata);
 		}
 	} else if (!pjsip_method_cmp(&rdata->msg_info.msg->line.req.method, &pjsip_cancel_method)
 		|| !pjsip_method_cmp(&rdata->msg_info.msg->line.req.method, &pjsip_bye_method)) {
@@ -443,7 +513,24 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 		}
 
 		/* Pick a serializer for the out-of-dialog request. */
-		serializer = ast_sip_get_distributor_serializer(rdata);
+		picked = distributor_pool_pick(rdata);
+		if (picked && distributor_pool_overloaded(picked, rdata)) {
+			pjsip_endpt_respond_stateless(ast_sip_get_pjsip_endpoint(), rdata,
+				PJSIP_SC_SERVICE_UNAVAILABLE, NULL, NULL, NULL);
+			ao2_ref(picked, -1);
+			return PJ_TRUE;
+		}
+	}
+
+	if (picked) {
+		long depth = ast_taskprocessor_size(picked->serializer) + 1;
+
+		/* Racing updates of the deepest queue seen only lose a statistic. */
+		if (depth > picked->max_depth) {
+			picked->max_depth = depth;
+		}
+		ast_atomic_fetchadd_int(&picked->queued, +1);
+		serializer = ao2_bump(picked->serializer);
 	}
 
 	pjsip_rx_data_clone(rdata, 0, &clone);
@@ -451,9 +538,12 @@ static pj_bool_t distributor(pjsip_rx_data *rdata)
 	if (dist) {
 		clone->endpt_info.mod_data[endpoint_mod.id] = ao2_bump(dist->endpoint);
 	}
+	/* The pool serializer reference is released by distribute(). */
+	clone->endpt_info.mod_data[distributor_mod.id] = picked;
 
 	if (ast_sip_push_task(serializer, distribute, clone)) {
 		ao2_cleanup(clone->endpt_info.mod_data[endpoint_mod.id]);
+		ao2_cleanup(picked);
 		pjsip_rx_data_free_cloned(clone);
 	}
 
@@ -542,6 +632,147 @@ static void check_endpoint(pjsip_rx_data *rdata, struct unidentified_request *un
 	ao2_unlock(unid);
 }
 
+static void endpoint_cache_entry_destroy(void *obj)
+{
+	struct endpoint_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->endpoint);
+}
+
+static int endpoint_cache_hash(const void *obj, int flags)
+{
+	const struct endpoint_cache_entry *entry = obj;
+
+	if (flags & OBJ_SEARCH_OBJECT) {
+		return ast_str_hash(entry->key);
+	} else if (flags & OBJ_SEARCH_KEY) {
+		return ast_str_hash(obj);
+	}
+	return -1;
+}
+
+static int endpoint_cache_compare(void *obj, void *arg, int flags)
+{
+	const struct endpoint_cache_entry *entry = obj;
+	const struct endpoint_cache_entry *entry_right = arg;
+	const char *right_key = arg;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right_key = entry_right->key;
+		/* Fall through */
+	case OBJ_SEARCH_KEY:
+		if (!strcmp(entry->key, right_key)) {
+			return CMP_MATCH | CMP_STOP;
+		}
+		break;
+	default:
+		break;
+	}
+	return 0;
+}
+
+static int endpoint_cache_expired(void *obj, void *arg, int flags)
+{
+	struct endpoint_cache_entry *entry = obj;
+	struct timeval *now = arg;
+
+	return ast_tvcmp(entry->expires, *now) <= 0 ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief Forget every endpoint identification.
+ *
+ * \return Nothing
+ */
+static void endpoint_cache_flush(void)
+{
+	ao2_callback(endpoint_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, NULL, NULL);
+}
+
+/*!
+ * \internal
+ * \brief Build the key an endpoint identification is remembered under.
+ *
+ * \param rdata The request.
+ * \param key Buffer for the key.
+ * \param size Size of the buffer.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the identification of this request must not be remembered.
+ */
+static int endpoint_cache_key(pjsip_rx_data *rdata, char *key, size_t size)
+{
+	pjsip_uri *from = rdata->msg_info.from->uri;
+	pjsip_sip_uri *sip_from;
+	int len;
+
+	/* Identifying by the authorization header depends on more than the key. */
+	if (!endpoint_cache_ttl || using_auth_username
+		|| !(PJSIP_URI_SCHEME_IS_SIP(from) || PJSIP_URI_SCHEME_IS_SIPS(from))) {
+		return -1;
+	}
+
+	sip_from = pjsip_uri_get_uri(from);
+	len = snprintf(key, size, "%s:%d/%.*s@%.*s",
+		rdata->pkt_info.src_name, rdata->pkt_info.src_port,
+		(int) pj_strlen(&sip_from->user), pj_strbuf(&sip_from->user),
+		(int) pj_strlen(&sip_from->host), pj_strbuf(&sip_from->host));
+
+	return len < 0 || (size_t) len >= size ? -1 : 0;
+}
+
+/*!
+ * \internal
+ * \brief Identify the endpoint of a request, remembering the result for a while.
+ *
+ * \param rdata The request.
+ *
+ * \retval NULL if no endpoint is identified.
+ * \return the endpoint, with a reference the caller must release.
+ */
+static struct ast_sip_endpoint *identify_endpoint_cached(pjsip_rx_data *rdata)
+{
+	char key[512];
+	struct endpoint_cache_entry *entry;
+	struct ast_sip_endpoint *endpoint;
+
+	if (endpoint_cache_key(rdata, key, sizeof(key))) {
+		return ast_sip_identify_endpoint(rdata);
+	}
+
+	entry = ao2_find(endpoint_cache, key, OBJ_SEARCH_KEY);
+	if (entry) {
+		if (ast_tvcmp(entry->expires, ast_tvnow()) > 0) {
+			endpoint = ao2_bump(entry->endpoint);
+			ao2_ref(entry, -1);
+			ast_debug(3, "Remembered endpoint %s for '%s'\n",
+				ast_sorcery_object_get_id(endpoint), key);
+			return endpoint;
+		}
+		ao2_unlink(endpoint_cache, entry);
+		ao2_ref(entry, -1);
+	}
+
+	endpoint = ast_sip_identify_endpoint(rdata);
+	if (!endpoint || ao2_container_count(endpoint_cache) >= ENDPOINT_CACHE_MAX) {
+		return endpoint;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(key) + 1, endpoint_cache_entry_destroy,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (entry) {
+		strcpy(entry->key, key); /* Safe */
+		entry->endpoint = ao2_bump(endpoint);
+		entry->expires = ast_tvadd(ast_tvnow(), ast_samp2tv(endpoint_cache_ttl, 1));
+		ao2_link(endpoint_cache, entry);
+		ao2_ref(entry, -1);
+	}
+
+	return endpoint;
+}
+
 static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 {
 	struct ast_sip_endpoint *endpoint;
@@ -563,7 +794,7 @@ static pj_bool_t endpoint_lookup(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	endpoint = ast_sip_identify_endpoint(rdata);
+	endpoint = identify_endpoint_cached(rdata);
 	if (endpoint) {
 		if ((unid = ao2_find(unidentified_requests, rdata->pkt_info.src_name, OBJ_SEARCH_KEY))) {
 			ao2_unlink(unidentified_requests, unid);
@@ -765,6 +996,24 @@ static int distribute(void *data)
 	int is_request = rdata->msg_info.msg->type == PJSIP_REQUEST_MSG;
 	int is_ack = is_request ? rdata->msg_info.msg->line.req.method.id == PJSIP_ACK_METHOD : 0;
 	struct ast_sip_endpoint *endpoint;
+	struct distributor_serializer *picked = rdata->endpt_info.mod_data[distributor_mod.id];
+
+	if (picked) {
+		struct timeval received = {
+			.tv_sec = rdata->pkt_info.timestamp.sec,
+			.tv_usec = rdata->pkt_info.timestamp.msec * 1000,
+		};
+		int64_t latency = MAX(ast_tvdiff_ms(ast_tvnow(), received), 0);
+
+		/* Only this serializer updates its latency statistics. */
+		++picked->processed;
+		picked->latency_total += latency;
+		if (latency > picked->latency_max) {
+			picked->latency_max = latency;
+		}
+		rdata->endpt_info.mod_data[distributor_mod.id] = NULL;
+		ao2_ref(picked, -1);
+	}
 
 	pjsip_endpt_process_rx_data(ast_sip_get_pjsip_endpoint(), rdata, &param, &handled);
 	if (!handled && is_request && !is_ack) {
@@ -928,11 +1177,64 @@ static int cli_unid_print_body(void *obj, void *arg, int flags)
 	return 0;
 }
 
+static char *cli_show_distributor(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct distributor_pool *pool;
+	int idx;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show distributor";
+		e->usage =
+			"Usage: pjsip show distributor\n"
+			"       Show the queue depth and latency of the serializers in the\n"
+			"       PJSIP request distributor pool\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	pool = ao2_global_obj_ref(distributor_pool);
+	if (!pool) {
+		ast_cli(a->fd, "No PJSIP distributor pool\n");
+		return CLI_SUCCESS;
+	}
+
+	ast_cli(a->fd, "Distributor pool of %d serializers, ", pool->size);
+	if (distributor_queue_high) {
+		ast_cli(a->fd, "rejecting requests at a depth of %u\n\n", distributor_queue_high);
+	} else {
+		ast_cli(a->fd, "never rejecting requests\n\n");
+	}
+
+	ast_cli(a->fd, "%-32s %8s %8s %10s %10s %10s %10s\n",
+		"Serializer", "Depth", "Max", "Queued", "Rejected", "Avg(ms)", "Max(ms)");
+	for (idx = 0; idx < pool->size; ++idx) {
+		struct distributor_serializer *pooled = pool->serializers[idx];
+		unsigned int processed = pooled->processed;
+
+		ast_cli(a->fd, "%-32s %8ld %8ld %10d %10d %10.1f %10" PRId64 "\n",
+			ast_taskprocessor_name(pooled->serializer),
+			ast_taskprocessor_size(pooled->serializer), pooled->max_depth,
+			pooled->queued, pooled->rejected,
+			processed ? (double) pooled->latency_total / processed : 0.0,
+			pooled->latency_max);
+	}
+
+	ao2_ref(pool, -1);
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_commands[] = {
 	AST_CLI_DEFINE(ast_sip_cli_traverse_objects, "Show PJSIP Unidentified Requests",
 		.command = "pjsip show unidentified_requests",
 		.usage = "Usage: pjsip show unidentified_requests\n"
 				"       Show the PJSIP Unidentified Requests\n"),
+	AST_CLI_DEFINE(cli_show_distributor, "Show PJSIP request distributor serializers"),
 };
 
 struct ast_sip_cli_formatter_entry *unid_formatter;
@@ -953,11 +1255,15 @@ static int expire_requests(void *object, void *arg, int flags)
 static int prune_task(const void *data)
 {
 	unsigned int maxage;
+	struct timeval now;
 
 	ast_sip_get_unidentified_request_thresholds(&unidentified_count, &unidentified_period, &unidentified_prune_interval);
 	maxage = unidentified_period * 2;
 	ao2_callback(unidentified_requests, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, expire_requests, &maxage);
 
+	now = ast_tvnow();
+	ao2_callback(endpoint_cache, OBJ_MULTIPLE | OBJ_NODATA | OBJ_UNLINK, endpoint_cache_expired, &now);
+
 	return unidentified_prune_interval * 1000;
 }
 
@@ -983,6 +1289,8 @@ static void global_loaded(const char *object_type)
 
 	ast_sip_get_default_realm(default_realm, sizeof(default_realm));
 	ast_sip_get_unidentified_request_thresholds(&unidentified_count, &unidentified_period, &unidentified_prune_interval);
+	distributor_pool_resize();
+	endpoint_cache_ttl = ast_sip_get_endpoint_identifier_cache_ttl();
 
 	/* Clean out the old task, if any */
 	ast_sched_clean_by_callback(prune_context, prune_task, clean_task);
@@ -997,6 +1305,31 @@ static struct ast_sorcery_observer global_observer = {
 	.loaded = global_loaded,
 };
 
+static void endpoint_changed(const void *object)
+{
+	endpoint_cache_flush();
+}
+
+/*! \brief Observer which forgets endpoint identifications when an endpoint changes */
+static struct ast_sorcery_observer endpoint_observer = {
+	.created = endpoint_changed,
+	.updated = endpoint_changed,
+	.deleted = endpoint_changed,
+};
+
+static void object_type_loaded(const char *name, const struct ast_sorcery *sorcery,
+	const char *object_type, int reloaded)
+{
+	if (reloaded) {
+		endpoint_cache_flush();
+	}
+}
+
+/*! \brief Observer which forgets endpoint identifications when any PJSIP configuration is reloaded */
+static const struct ast_sorcery_instance_observer reload_observer = {
+	.object_type_loaded = object_type_loaded,
+};
+
 /*!
  * \internal
  * \brief Shutdown the serializers in the distributor pool.
@@ -1006,11 +1339,23 @@ static struct ast_sorcery_observer global_observer = {
  */
 static void distributor_pool_shutdown(void)
 {
+	ao2_global_obj_release(distributor_pool);
+}
+
+static void distributor_serializer_destroy(void *obj)
+{
+	struct distributor_serializer *pooled = obj;
+
+	ast_taskprocessor_unreference(pooled->serializer);
+}
+
+static void distributor_pool_destroy(void *obj)
+{
+	struct distributor_pool *pool = obj;
 	int idx;
 
-	for (idx = 0; idx < ARRAY_LEN(distributor_pool); ++idx) {
-		ast_taskprocessor_unreference(distributor_pool[idx]);
-		distributor_pool[idx] = NULL;
+	for (idx = 0; idx < pool->size; ++idx) {
+		ao2_cleanup(pool->serializers[idx]);
 	}
 }
 
@@ -1019,26 +1364,80 @@ static void distributor_pool_shutdown(void)
  * \brief Setup the serializers in the distributor pool.
  * \since 13.10.0
  *
+ * \param size Number of serializers in the pool.
+ *
+ * \note Messages already queued on a replaced pool are still processed by
+ * its serializers.
+ *
  * \retval 0 on success.
  * \retval -1 on error.
  */
-static int distributor_pool_setup(void)
+static int distributor_pool_setup(int size)
 {
 	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	struct distributor_pool *pool;
 	int idx;
 
-	for (idx = 0; idx < ARRAY_LEN(distributor_pool); ++idx) {
+	pool = ao2_alloc_options(sizeof(*pool) + size * sizeof(pool->serializers[0]),
+		distributor_pool_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!pool) {
+		return -1;
+	}
+
+	for (idx = 0; idx < size; ++idx) {
+		struct distributor_serializer *pooled;
+
+		pooled = ao2_alloc_options(sizeof(*pooled), distributor_serializer_destroy,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!pooled) {
+			ao2_ref(pool, -1);
+			return -1;
+		}
+		pool->serializers[pool->size++] = pooled;
+
 		/* Create name with seq number appended. */
 		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/distributor");
 
-		distributor_pool[idx] = ast_sip_create_serializer(tps_name);
-		if (!distributor_pool[idx]) {
+		pooled->serializer = ast_sip_create_serializer(tps_name);
+		if (!pooled->serializer) {
+			ao2_ref(pool, -1);
 			return -1;
 		}
 	}
+
+	ao2_global_obj_replace_unref(distributor_pool, pool);
+	ao2_ref(pool, -1);
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Replace the distributor pool if its configured size changed.
+ *
+ * \return Nothing
+ */
+static void distributor_pool_resize(void)
+{
+	struct distributor_pool *pool;
+	unsigned int size;
+	int current;
+
+	ast_sip_get_distributor_settings(&size, &distributor_queue_high);
+
+	pool = ao2_global_obj_ref(distributor_pool);
+	current = pool ? pool->size : 0;
+	ao2_cleanup(pool);
+
+	if (current != size) {
+		if (distributor_pool_setup(size)) {
+			ast_log(LOG_ERROR, "Unable to resize the PJSIP distributor pool to %u serializers\n", size);
+		} else {
+			ast_debug(1, "Resized the PJSIP distributor pool from %d to %u serializers\n",
+				current, size);
+		}
+	}
+}
+
 int ast_sip_initialize_distributor(void)
 {
 	unidentified_requests = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
@@ -1047,7 +1446,14 @@ int ast_sip_initialize_distributor(void)
 		return -1;
 	}
 
-	if (distributor_pool_setup()) {
+	endpoint_cache = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, 0,
+		ENDPOINT_CACHE_BUCKETS, endpoint_cache_hash, NULL, endpoint_cache_compare);
+	if (!endpoint_cache) {
+		ast_sip_destroy_distributor();
+		return -1;
+	}
+
+	if (distributor_pool_setup(DISTRIBUTOR_POOL_SIZE)) {
 		ast_sip_destroy_distributor();
 		return -1;
 	}
@@ -1064,6 +1470,8 @@ int ast_sip_initialize_distributor(void)
 	}
 
 	ast_sorcery_observer_add(ast_sip_get_sorcery(), "global", &global_observer);
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "endpoint", &endpoint_observer);
+	ast_sorcery_instance_observer_add(ast_sip_get_sorcery(), &reload_observer);
 	ast_sorcery_reload_object(ast_sip_get_sorcery(), "global");
 
 	if (create_artificial_endpoint() || create_artificial_auth()) {
@@ -1117,6 +1525,8 @@ void ast_sip_destroy_distributor(void)
 	ao2_cleanup(artificial_auth);
 	ao2_cleanup(artificial_endpoint);
 
+	ast_sorcery_instance_observer_remove(ast_sip_get_sorcery(), &reload_observer);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "endpoint", &endpoint_observer);
 	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "global", &global_observer);
 
 	if (prune_context) {
@@ -1125,5 +1535,6 @@ void ast_sip_destroy_distributor(void)
 
 	distributor_pool_shutdown();
 
+	ao2_cleanup(endpoint_cache);
 	ao2_cleanup(unidentified_requests);
 }
@@ -27,20 +27,17 @@
 
 #define MOD_DATA_RESTRICTIONS "restrictions"
 
-static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata);
-
 /*! \brief Outgoing message modification restrictions */
 struct multihomed_message_restrictions {
 	/*! \brief Disallow modification of the From domain */
 	unsigned int disallow_from_domain_modification;
 };
 
+/*! \brief Module which only provides the mod_data slot for restrictions */
 static pjsip_module multihomed_module = {
 	.name = { "Multihomed Routing", 18 },
 	.id = -1,
 	.priority = PJSIP_MOD_PRIORITY_TSX_LAYER - 1,
-	.on_tx_request = multihomed_on_tx_message,
-	.on_tx_response = multihomed_on_tx_message,
 };
 
 /*! \brief Helper function to get (or allocate if not already present) restrictions on a message */
@@ -151,13 +148,27 @@ static int multihomed_rewrite_sdp(struct pjmedia_sdp_session *sdp)
 	return 0;
 }
 
-static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata)
+/*! \brief Helper function which sets a host and port, returning non-zero if they changed */
+static int multihomed_set_host_port(pj_str_t *host, int *port, pj_str_t *new_host, int new_port)
+{
+	if (!pj_strcmp(host, new_host) && *port == new_port) {
+		return 0;
+	}
+
+	/* new_host is allocated from the tdata pool OR the transport so it is perfectly fine to just do an assignment like this */
+	pj_strassign(host, new_host);
+	*port = new_port;
+	return 1;
+}
+
+static int multihomed_rewrite(pjsip_tx_data *tdata)
 {
 	struct multihomed_message_restrictions *restrictions = ast_sip_mod_data_get(tdata->mod_data, multihomed_module.id, MOD_DATA_RESTRICTIONS);
 	pjsip_tpmgr_fla2_param prm;
 	pjsip_cseq_hdr *cseq;
 	pjsip_via_hdr *via;
 	pjsip_fromto_hdr *from;
+	int changed = 0;
 
 	/* Use the destination information to determine what local interface this message will go out on */
 	pjsip_tpmgr_fla2_param_default(&prm);
@@ -167,7 +178,7 @@ static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata)
 
 	/* If we can't get the local address use best effort and let it pass */
 	if (pjsip_tpmgr_find_local_addr2(pjsip_endpt_get_tpmgr(ast_sip_get_pjsip_endpoint()), tdata->pool, &prm) != PJ_SUCCESS) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	/* For UDP we can have multiple transports so the port needs to be maintained */
@@ -208,28 +219,31 @@ static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata)
 			&& !(tdata->msg->type == PJSIP_RESPONSE_MSG && tdata->msg->line.status.code / 100 == 3)) {
 			pjsip_sip_uri *uri = pjsip_uri_get_uri(contact->uri);
 
-			/* prm.ret_addr is allocated from the tdata pool OR the transport so it is perfectly fine to just do an assignment like this */
-			pj_strassign(&uri->host, &prm.ret_addr);
-			uri->port = prm.ret_port;
-			ast_debug(4, "Re-wrote Contact URI host/port to %.*s:%d\n",
-				(int)pj_strlen(&uri->host), pj_strbuf(&uri->host), uri->port);
+			if (multihomed_set_host_port(&uri->host, &uri->port, &prm.ret_addr, prm.ret_port)) {
+				ast_debug(4, "Re-wrote Contact URI host/port to %.*s:%d\n",
+					(int)pj_strlen(&uri->host), pj_strbuf(&uri->host), uri->port);
+				changed = 1;
+			}
 
 			if (tdata->tp_info.transport->key.type == PJSIP_TRANSPORT_UDP ||
 				tdata->tp_info.transport->key.type == PJSIP_TRANSPORT_UDP6) {
-				uri->transport_param.slen = 0;
+				if (uri->transport_param.slen) {
+					uri->transport_param.slen = 0;
+					changed = 1;
+				}
 			} else {
-				pj_strdup2(tdata->pool, &uri->transport_param, pjsip_transport_get_type_name(tdata->tp_info.transport->key.type));
-			}
+				const char *type_name = pjsip_transport_get_type_name(tdata->tp_info.transport->key.type);
 
-			pjsip_tx_data_invalidate_msg(tdata);
+				if (pj_stricmp2(&uri->transport_param, type_name)) {
+					pj_strdup2(tdata->pool, &uri->transport_param, type_name);
+					changed = 1;
+				}
+			}
 		}
 	}
 
 	if (tdata->msg->type == PJSIP_REQUEST_MSG && (via = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_VIA, NULL))) {
-		pj_strassign(&via->sent_by.host, &prm.ret_addr);
-		via->sent_by.port = prm.ret_port;
-
-		pjsip_tx_data_invalidate_msg(tdata);
+		changed |= multihomed_set_host_port(&via->sent_by.host, &via->sent_by.port, &prm.ret_addr, prm.ret_port);
 	}
 
 	if (tdata->msg->type == PJSIP_REQUEST_MSG && (from = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_FROM, NULL)) &&
@@ -238,9 +252,10 @@ static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata)
 		pjsip_sip_uri *uri = pjsip_uri_get_uri(id_name_addr);
 		pj_sockaddr ip;
 
-		if (pj_strcmp2(&uri->host, "localhost") && pj_sockaddr_parse(pj_AF_UNSPEC(), 0, &uri->host, &ip) == PJ_SUCCESS) {
+		if (pj_strcmp2(&uri->host, "localhost") && pj_strcmp(&uri->host, &prm.ret_addr)
+			&& pj_sockaddr_parse(pj_AF_UNSPEC(), 0, &uri->host, &ip) == PJ_SUCCESS) {
 			pj_strassign(&uri->host, &prm.ret_addr);
-			pjsip_tx_data_invalidate_msg(tdata);
+			changed = 1;
 		}
 	}
 
@@ -267,14 +282,22 @@ static pj_status_t multihomed_on_tx_message(pjsip_tx_data *tdata)
 			}
 		}
 
-		pjsip_tx_data_invalidate_msg(tdata);
+		changed = 1;
 	}
 
-	return PJ_SUCCESS;
+	return changed;
 }
 
+/*! \brief Rewrite of outgoing messages to the address they go out on */
+static struct ast_sip_tx_rewrite multihomed_tx_rewrite = {
+	.name = "Multihomed Routing",
+	.priority = 0,
+	.rewrite = multihomed_rewrite,
+};
+
 void ast_res_pjsip_cleanup_message_ip_updater(void)
 {
+	ast_sip_unregister_tx_rewrite(&multihomed_tx_rewrite);
 	ast_sip_unregister_service(&multihomed_module);
 	ast_sip_unregister_supplement(&multihomed_supplement);
 	ast_sip_session_unregister_supplement(&multihomed_session_supplement);
@@ -299,5 +322,11 @@ int ast_res_pjsip_init_message_ip_updater(void)
 		return -1;
 	}
 
+	if (ast_sip_register_tx_rewrite(&multihomed_tx_rewrite)) {
+		ast_log(LOG_ERROR, "Could not register multihomed rewrite for outgoing requests\n");
+		ast_res_pjsip_cleanup_message_ip_updater();
+		return -1;
+	}
+
 	return 0;
 }
@@ -37,6 +37,9 @@
 #define DEFAULT_ENCODING "text/plain"
 #define QUALIFIED_BUCKETS 211
 
+/*! Number of serializers qualify requests are sent from */
+#define QUALIFY_SERIALIZER_POOL_SIZE 8
+
 static const char *status_map [] = {
 	[UNAVAILABLE] = "Unreachable",
 	[AVAILABLE] = "Reachable",
@@ -193,7 +196,7 @@ struct ast_sip_contact_status *ast_res_pjsip_find_or_create_contact_status(const
  * \brief Update an ast_sip_contact_status's elements.
  */
 static void update_contact_status(const struct ast_sip_contact *contact,
-	enum ast_sip_contact_status_type value, int is_contact_refresh)
+	enum ast_sip_contact_status_type value, int is_contact_refresh, int64_t rtt)
 {
 	RAII_VAR(struct ast_sip_contact_status *, status, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_sip_contact_status *, update, NULL, ao2_cleanup);
@@ -246,13 +249,7 @@ static void update_contact_status(const struct ast_sip_contact *contact,
 		update->last_status = status->status;
 		update->status = value;
 
-		/*
-		 * if the contact is available calculate the rtt as
-		 * the diff between the last start time and "now"
-		 */
-		update->rtt = update->status == AVAILABLE && status->rtt_start.tv_sec > 0
-			? ast_tvdiff_us(ast_tvnow(), status->rtt_start)
-			: 0;
+		update->rtt = update->status == AVAILABLE ? rtt : 0;
 		update->rtt_start = ast_tv(0, 0);
 
 		ast_test_suite_event_notify("AOR_CONTACT_QUALIFY_RESULT",
@@ -270,43 +267,6 @@ static void update_contact_status(const struct ast_sip_contact *contact,
 	}
 }
 
-/*!
- * \internal
- * \brief Initialize the start time on a contact status so the round
- *        trip time can be calculated upon a valid response.
- */
-static void init_start_time(const struct ast_sip_contact *contact)
-{
-	RAII_VAR(struct ast_sip_contact_status *, status, NULL, ao2_cleanup);
-	RAII_VAR(struct ast_sip_contact_status *, update, NULL, ao2_cleanup);
-
-	status = ast_res_pjsip_find_or_create_contact_status(contact);
-	if (!status) {
-		ast_log(LOG_ERROR, "Unable to find ast_sip_contact_status for contact %s\n",
-			contact->uri);
-		return;
-	}
-
-	update = ast_sorcery_alloc(ast_sip_get_sorcery(), CONTACT_STATUS,
-		ast_sorcery_object_get_id(status));
-	if (!update) {
-		ast_log(LOG_ERROR, "Unable to copy ast_sip_contact_status for contact %s\n",
-			contact->uri);
-		return;
-	}
-
-	ast_string_field_set(status, uri, contact->uri);
-	update->status = status->status;
-	update->last_status = status->last_status;
-	update->rtt = status->rtt;
-	update->rtt_start = ast_tvnow();
-
-	if (ast_sorcery_update(ast_sip_get_sorcery(), update)) {
-		ast_log(LOG_ERROR, "Unable to update ast_sip_contact_status for contact %s\n",
-			contact->uri);
-	}
-}
-
 /*!
  * \internal
  * \brief For an endpoint try to match the given contact->aor.
@@ -361,13 +321,161 @@ static struct ast_sip_endpoint *find_an_endpoint(struct ast_sip_contact *contact
 	return endpoint;
 }
 
+/*!
+ * \internal
+ * \brief Structure to hold an outstanding qualify request and then its result.
+ */
+struct qualify_result {
+	/*! The contact being qualified */
+	struct ast_sip_contact *contact;
+	/*! When the request was sent */
+	struct timeval start;
+	/*! The status determined from the response */
+	enum ast_sip_contact_status_type status;
+	/*! The round trip time in microseconds */
+	int64_t rtt;
+	AST_LIST_ENTRY(qualify_result) next;
+};
+
+/*!
+ * \internal
+ * \brief Results waiting to be applied to their contact status.
+ */
+static AST_LIST_HEAD_STATIC(qualify_results, qualify_result);
+
+/*!
+ * \internal
+ * \brief Serializer applying qualify results.
+ */
+static struct ast_taskprocessor *qualify_result_serializer;
+
+/*!
+ * \internal
+ * \brief Pool of serializers sending qualify requests.
+ */
+static struct ast_taskprocessor *qualify_serializers[QUALIFY_SERIALIZER_POOL_SIZE];
+
+static struct qualify_result *qualify_result_alloc(struct ast_sip_contact *contact)
+{
+	struct qualify_result *result;
+
+	result = ast_calloc(1, sizeof(*result));
+	if (!result) {
+		return NULL;
+	}
+
+	result->contact = ao2_bump(contact);
+	return result;
+}
+
+static void qualify_result_destroy(struct qualify_result *result)
+{
+	ao2_cleanup(result->contact);
+	ast_free(result);
+}
+
+/*!
+ * \internal
+ * \brief Apply every queued qualify result to its contact status.
+ */
+static int qualify_results_task(void *data)
+{
+	AST_LIST_HEAD_NOLOCK(, qualify_result) batch;
+	struct qualify_result *result;
+
+	AST_LIST_HEAD_INIT_NOLOCK(&batch);
+
+	AST_LIST_LOCK(&qualify_results);
+	AST_LIST_APPEND_LIST(&batch, &qualify_results, next);
+	AST_LIST_UNLOCK(&qualify_results);
+
+	while ((result = AST_LIST_REMOVE_HEAD(&batch, next))) {
+		update_contact_status(result->contact, result->status, 0, result->rtt);
+		qualify_result_destroy(result);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Queue a qualify result to be applied off of the PJSIP thread.
+ *
+ * \details Results arriving while a batch is already waiting to be applied
+ * are added to it rather than each needing a task of their own.
+ */
+static void queue_qualify_result(struct qualify_result *result)
+{
+	int first;
+
+	AST_LIST_LOCK(&qualify_results);
+	first = AST_LIST_EMPTY(&qualify_results);
+	AST_LIST_INSERT_TAIL(&qualify_results, result, next);
+	AST_LIST_UNLOCK(&qualify_results);
+
+	if (first && (!qualify_result_serializer
+		|| ast_sip_push_task(qualify_result_serializer, qualify_results_task, NULL))) {
+		qualify_results_task(NULL);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Pick the serializer to send qualify requests to a contact from.
+ *
+ * \retval NULL to use the default serializer pool.
+ */
+static struct ast_taskprocessor *qualify_serializer(const struct ast_sip_contact *contact)
+{
+	return qualify_serializers[ast_str_hash(ast_sorcery_object_get_id(contact))
+		% QUALIFY_SERIALIZER_POOL_SIZE];
+}
+
+static void qualify_serializers_shutdown(void)
+{
+	int idx;
+
+	for (idx = 0; idx < QUALIFY_SERIALIZER_POOL_SIZE; ++idx) {
+		ast_taskprocessor_unreference(qualify_serializers[idx]);
+		qualify_serializers[idx] = NULL;
+	}
+	ast_taskprocessor_unreference(qualify_result_serializer);
+	qualify_result_serializer = NULL;
+}
+
+static int qualify_serializers_setup(void)
+{
+	char tps_name[AST_TASKPROCESSOR_MAX_NAME + 1];
+	int idx;
+
+	for (idx = 0; idx < QUALIFY_SERIALIZER_POOL_SIZE; ++idx) {
+		/* Create name with seq number appended. */
+		ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/options");
+
+		qualify_serializers[idx] = ast_sip_create_serializer(tps_name);
+		if (!qualify_serializers[idx]) {
+			qualify_serializers_shutdown();
+			return -1;
+		}
+	}
+
+	ast_taskprocessor_build_name(tps_name, sizeof(tps_name), "pjsip/options/results");
+	qualify_result_serializer = ast_sip_create_serializer(tps_name);
+	if (!qualify_result_serializer) {
+		qualify_serializers_shutdown();
+		return -1;
+	}
+
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Receive a response to the qualify contact request.
  */
 static void qualify_contact_cb(void *token, pjsip_event *e)
 {
-	struct ast_sip_contact *contact = token;
+	struct qualify_result *result = token;
 
 	switch(e->body.tsx_state.type) {
 	default:
@@ -375,13 +483,16 @@ static void qualify_contact_cb(void *token, pjsip_event *e)
 		/* Fall through */
 	case PJSIP_EVENT_TRANSPORT_ERROR:
 	case PJSIP_EVENT_TIMER:
-		update_contact_status(contact, UNAVAILABLE, 0);
+		result->status = UNAVAILABLE;
 		break;
 	case PJSIP_EVENT_RX_MSG:
-		update_contact_status(contact, AVAILABLE, 0);
+		result->status = AVAILABLE;
+		result->rtt = ast_tvdiff_us(ast_tvnow(), result->start);
 		break;
 	}
-	ao2_cleanup(contact);
+
+	/* The transaction callback runs on a PJSIP thread so leave the status update to a serializer */
+	queue_qualify_result(result);
 }
 
 /*!
@@ -394,6 +505,7 @@ static void qualify_contact_cb(void *token, pjsip_event *e)
 static int qualify_contact(struct ast_sip_endpoint *endpoint, struct ast_sip_contact *contact)
 {
 	pjsip_tx_data *tdata;
+	struct qualify_result *result;
 	RAII_VAR(struct ast_sip_endpoint *, endpoint_local, NULL, ao2_cleanup);
 
 	if (endpoint) {
@@ -428,15 +540,19 @@ static int qualify_contact(struct ast_sip_endpoint *endpoint, struct ast_sip_con
 		return -1;
 	}
 
-	init_start_time(contact);
+	result = qualify_result_alloc(contact);
+	if (!result) {
+		pjsip_tx_data_dec_ref(tdata);
+		return -1;
+	}
 
-	ao2_ref(contact, +1);
-	if (ast_sip_send_out_of_dialog_request(tdata, endpoint_local, (int)(contact->qualify_timeout * 1000), contact, qualify_contact_cb)
+	result->start = ast_tvnow();
+	if (ast_sip_send_out_of_dialog_request(tdata, endpoint_local, (int)(contact->qualify_timeout * 1000), result, qualify_contact_cb)
 		!= PJ_SUCCESS) {
 		ast_log(LOG_ERROR, "Unable to send request to qualify contact %s\n",
 			contact->uri);
-		update_contact_status(contact, UNAVAILABLE, 0);
-		ao2_ref(contact, -1);
+		update_contact_status(contact, UNAVAILABLE, 0, 0);
+		qualify_result_destroy(result);
 		return -1;
 	}
 
@@ -520,7 +636,7 @@ static int qualify_contact_sched(const void *obj)
 	struct sched_data *data = (struct sched_data *) obj;
 
 	ao2_ref(data->contact, +1);
-	if (ast_sip_push_task(NULL, qualify_contact_task, data->contact)) {
+	if (ast_sip_push_task(qualify_serializer(data->contact), qualify_contact_task, data->contact)) {
 		ao2_ref(data->contact, -1);
 	}
 
@@ -589,13 +705,13 @@ static void qualify_and_schedule(struct ast_sip_contact *contact)
 
 	if (contact->qualify_frequency) {
 		ao2_ref(contact, +1);
-		if (ast_sip_push_task(NULL, qualify_contact_task, contact)) {
+		if (ast_sip_push_task(qualify_serializer(contact), qualify_contact_task, contact)) {
 			ao2_ref(contact, -1);
 		}
 
 		schedule_qualify(contact, contact->qualify_frequency * 1000);
 	} else {
-		update_contact_status(contact, UNKNOWN, 0);
+		update_contact_status(contact, UNKNOWN, 0, 0);
 	}
 }
 
@@ -614,7 +730,7 @@ static void contact_created(const void *obj)
  */
 static void contact_updated(const void *obj)
 {
-	update_contact_status(obj, AVAILABLE, 1);
+	update_contact_status(obj, AVAILABLE, 1, 0);
 }
 
 /*!
@@ -649,13 +765,20 @@ static const struct ast_sorcery_observer contact_observer = {
 
 static pj_bool_t options_start(void)
 {
-	sched = ast_sched_context_create();
+	if (qualify_serializers_setup()) {
+		return -1;
+	}
+
+	/* Every contact is rescheduled each interval so keep insertion constant time */
+	sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL);
 	if (!sched) {
+		qualify_serializers_shutdown();
 		return -1;
 	}
 	if (ast_sched_start_thread(sched)) {
 		ast_sched_context_destroy(sched);
 		sched = NULL;
+		qualify_serializers_shutdown();
 		return -1;
 	}
 
@@ -663,6 +786,7 @@ static pj_bool_t options_start(void)
 		ast_log(LOG_WARNING, "Unable to add contact observer\n");
 		ast_sched_context_destroy(sched);
 		sched = NULL;
+		qualify_serializers_shutdown();
 		return -1;
 	}
 
@@ -688,6 +812,8 @@ static pj_bool_t options_stop(void)
 	ao2_callback(sched_qualifies, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE,
 		sched_qualifies_empty, NULL);
 
+	qualify_serializers_shutdown();
+
 	return PJ_SUCCESS;
 }
 
@@ -1127,7 +1253,7 @@ static void qualify_and_schedule_contact(struct ast_sip_contact *contact)
 	if (contact->qualify_frequency) {
 		schedule_qualify(contact, initial_interval);
 	} else {
-		update_contact_status(contact, UNKNOWN, 0);
+		update_contact_status(contact, UNKNOWN, 0, 0);
 	}
 }
 
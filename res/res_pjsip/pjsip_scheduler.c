@@ -31,6 +31,9 @@
 
 #define TASK_BUCKETS 53
 
+/*! Most tasks without a serializer of their own run in one batch */
+#define BATCH_MAX 32
+
 static struct ast_sched_context *scheduler_context;
 static struct ao2_container *tasks;
 static int task_count;
@@ -50,6 +53,8 @@ struct ast_sip_sched_task {
 	int interval;
 	/*! the time the task was queued */
 	struct timeval when_queued;
+	/*! the time the next run is due */
+	struct timeval due;
 	/*! the last time the task was started */
 	struct timeval last_start;
 	/*! the last time the task was ended */
@@ -68,8 +73,62 @@ AO2_STRING_FIELD_HASH_FN(ast_sip_sched_task, name);
 AO2_STRING_FIELD_CMP_FN(ast_sip_sched_task, name);
 AO2_STRING_FIELD_SORT_FN(ast_sip_sched_task, name);
 
+/*! \brief Tasks run one after another on a serializer */
+struct sched_batch {
+	/*! Number of tasks */
+	size_t count;
+	/*! The tasks, each with a reference */
+	struct ast_sip_sched_task *tasks[0];
+};
+
+/*!
+ * \brief Tasks that are due but not yet pushed to their serializers
+ *
+ * Only touched by the scheduler thread.
+ */
+static AST_VECTOR(pending_tasks, struct ast_sip_sched_task *) pending;
+
+/*! \brief Scheduler id of the flush of the pending tasks, only touched by the scheduler thread */
+static int flush_id = -1;
+
+/*! \brief How late and how long the runs of tasks were */
+static struct {
+	/*! Runs of tasks */
+	unsigned long runs;
+	/*! Batches pushed to serializers */
+	unsigned long batches;
+	/*! Milliseconds runs started after they were due, in total and at most */
+	int64_t late_total;
+	int64_t late_max;
+	/*! Milliseconds runs took, in total and at most */
+	int64_t run_total;
+	int64_t run_max;
+} run_stats;
+
+AST_MUTEX_DEFINE_STATIC(run_stats_lock);
+
 static int push_to_serializer(const void *data);
 
+/*!
+ * \internal
+ * \brief Add the time a task started late and took to run to the statistics.
+ */
+static void run_stats_add(struct ast_sip_sched_task *schtd)
+{
+	int64_t late = ast_tvdiff_ms(schtd->last_start, schtd->due);
+	int64_t run = ast_tvdiff_ms(schtd->last_end, schtd->last_start);
+
+	late = late < 0 ? 0 : late;
+
+	ast_mutex_lock(&run_stats_lock);
+	run_stats.runs++;
+	run_stats.late_total += late;
+	run_stats.late_max = MAX(run_stats.late_max, late);
+	run_stats.run_total += run;
+	run_stats.run_max = MAX(run_stats.run_max, run);
+	ast_mutex_unlock(&run_stats_lock);
+}
+
 /*
  * This function is run in the context of the serializer.
  * It runs the task with a simple call and reschedules based on the result.
@@ -91,6 +150,7 @@ static int run_task(void *data)
 	ao2_lock(schtd);
 	schtd->is_running = 0;
 	schtd->last_end = ast_tvnow();
+	run_stats_add(schtd);
 
 	/*
 	 * Don't restart if the task returned 0 or if the interval
@@ -113,6 +173,7 @@ static int run_task(void *data)
 		delay = schtd->interval - (ast_tvdiff_ms(schtd->last_end, schtd->last_start) % schtd->interval);
 	}
 
+	schtd->due = ast_tvadd(schtd->last_end, ast_samp2tv(delay, 1000));
 	schtd->current_scheduler_id = ast_sched_add(scheduler_context, delay, push_to_serializer, (const void *)schtd);
 	if (schtd->current_scheduler_id < 0) {
 		schtd->interval = 0;
@@ -127,15 +188,122 @@ static int run_task(void *data)
 }
 
 /*
- * This function is run by the scheduler thread.  Its only job is to push the task
- * to the serialize and return.  It returns 0 so it's not rescheduled.
+ * This function is run in the context of the serializer.
+ * It runs each task of a batch in turn.
+ */
+static int run_batch(void *data)
+{
+	struct sched_batch *batch = data;
+	size_t i;
+
+	for (i = 0; i < batch->count; i++) {
+		run_task(batch->tasks[i]);
+		ao2_ref(batch->tasks[i], -1);
+	}
+	ast_free(batch);
+
+	return 0;
+}
+
+static int pending_cmp(const void *a, const void *b)
+{
+	const struct ast_sip_sched_task *task_a = *(struct ast_sip_sched_task * const *)a;
+	const struct ast_sip_sched_task *task_b = *(struct ast_sip_sched_task * const *)b;
+
+	if (task_a->serializer == task_b->serializer) {
+		return 0;
+	}
+	return (uintptr_t)task_a->serializer < (uintptr_t)task_b->serializer ? -1 : 1;
+}
+
+/*!
+ * \internal
+ * \brief Push a batch of pending tasks to their serializer.
+ */
+static void push_batch(struct ast_sip_sched_task **tasks_due, size_t count)
+{
+	struct sched_batch *batch;
+	size_t i;
+
+	batch = ast_malloc(sizeof(*batch) + count * sizeof(batch->tasks[0]));
+	if (batch) {
+		batch->count = count;
+		memcpy(batch->tasks, tasks_due, count * sizeof(batch->tasks[0]));
+		if (!ast_sip_push_task(tasks_due[0]->serializer, run_batch, batch)) {
+			ast_mutex_lock(&run_stats_lock);
+			run_stats.batches++;
+			ast_mutex_unlock(&run_stats_lock);
+			return;
+		}
+		ast_free(batch);
+	}
+
+	for (i = 0; i < count; i++) {
+		/* The reference taken by push_to_serializer */
+		ao2_ref(tasks_due[i], -1);
+		ao2_ref(tasks_due[i], -1);
+	}
+}
+
+/*
+ * This function is run by the scheduler thread once the tasks due at about
+ * the same time have been gathered.  It pushes them to their serializers
+ * with one push per serializer rather than one per task.
+ */
+static int flush_pending(const void *data)
+{
+	struct ast_sip_sched_task **tasks_due;
+	size_t count = AST_VECTOR_SIZE(&pending);
+	size_t start;
+	size_t end;
+
+	flush_id = -1;
+	if (!count) {
+		return 0;
+	}
+
+	tasks_due = AST_VECTOR_GET_ADDR(&pending, 0);
+	qsort(tasks_due, count, sizeof(*tasks_due), pending_cmp);
+
+	for (start = 0; start < count; start = end) {
+		for (end = start + 1; end < count
+			&& tasks_due[end]->serializer == tasks_due[start]->serializer; end++) {
+			/* Tasks without a serializer are spread over the pool a batch at a time */
+			if (!tasks_due[start]->serializer && end - start == BATCH_MAX) {
+				break;
+			}
+		}
+		push_batch(&tasks_due[start], end - start);
+	}
+
+	AST_VECTOR_RESET(&pending, AST_VECTOR_ELEM_CLEANUP_NOOP);
+
+	return 0;
+}
+
+/*
+ * This function is run by the scheduler thread.  Its only job is to hand the
+ * task to its serializer and return.  It returns 0 so it's not rescheduled.
  */
 static int push_to_serializer(const void *data)
 {
 	struct ast_sip_sched_task *schtd = (struct ast_sip_sched_task *)data;
 
-	if (ast_sip_push_task(schtd->serializer, run_task, schtd)) {
+	ao2_ref(schtd, +1);
+	if (AST_VECTOR_APPEND(&pending, schtd)) {
 		ao2_ref(schtd, -1);
+		if (ast_sip_push_task(schtd->serializer, run_task, schtd)) {
+			ao2_ref(schtd, -1);
+		}
+		return 0;
+	}
+
+	/* Everything else due now runs before the flush, so it joins the batch */
+	if (flush_id < 0) {
+		flush_id = ast_sched_add(scheduler_context, 0, flush_pending, NULL);
+		if (flush_id < 0) {
+			flush_pending(NULL);
+		}
 	}
 
 	return 0;
@@ -348,6 +516,7 @@ struct ast_sip_sched_task *ast_sip_schedule_task(struct ast_taskprocessor *seria
 	schtd->flags = flags;
 	schtd->interval = interval;
 	schtd->when_queued = ast_tvnow();
+	schtd->due = ast_tvadd(schtd->when_queued, ast_samp2tv(interval, 1000));
 
 	if (flags & AST_SIP_SCHED_TASK_DATA_AO2) {
 		ao2_ref(task_data, +1);
@@ -382,7 +551,9 @@ static char *cli_show_tasks(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	case CLI_INIT:
 		e->command = "pjsip show scheduled_tasks";
 		e->usage = "Usage: pjsip show scheduled_tasks\n"
-		            "      Show all scheduled tasks\n";
+		            "      Show all scheduled tasks, then how many times they ran, in\n"
+		            "      how many batches, and how late they started and how long\n"
+		            "      they took on average and at most.\n";
 		return NULL;
 	case CLI_GENERATE:
 		return NULL;
@@ -445,6 +616,15 @@ static char *cli_show_tasks(struct ast_cli_entry *e, int cmd, struct ast_cli_arg
 	ao2_ref(tasks, -1);
 	ast_cli(a->fd, "\n");
 
+	ast_mutex_lock(&run_stats_lock);
+	ast_cli(a->fd, "Runs: %lu in %lu batches\n", run_stats.runs, run_stats.batches);
+	ast_cli(a->fd, "Started late (ms): avg %.1f, max %" PRId64 "\n",
+		run_stats.runs ? (double) run_stats.late_total / run_stats.runs : 0.0, run_stats.late_max);
+	ast_cli(a->fd, "Run time (ms): avg %.1f, max %" PRId64 "\n",
+		run_stats.runs ? (double) run_stats.run_total / run_stats.runs : 0.0, run_stats.run_max);
+	ast_mutex_unlock(&run_stats_lock);
+	ast_cli(a->fd, "\n");
+
 	return CLI_SUCCESS;
 }
 
@@ -454,7 +634,8 @@ static struct ast_cli_entry cli_commands[] = {
 
 int ast_sip_initialize_scheduler(void)
 {
-	if (!(scheduler_context = ast_sched_context_create())) {
+	/* Tasks are added and deleted far more often than they come due */
+	if (!(scheduler_context = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))) {
 		ast_log(LOG_ERROR, "Failed to create scheduler. Aborting load\n");
 		return -1;
 	}
@@ -465,10 +646,17 @@ int ast_sip_initialize_scheduler(void)
 		return -1;
 	}
 
+	if (AST_VECTOR_INIT(&pending, BATCH_MAX)) {
+		ast_log(LOG_ERROR, "Failed to allocate pending tasks. Aborting load\n");
+		ast_sched_context_destroy(scheduler_context);
+		return -1;
+	}
+
 	tasks = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK, AO2_CONTAINER_ALLOC_OPT_DUPS_REJECT,
 		TASK_BUCKETS, ast_sip_sched_task_hash_fn, ast_sip_sched_task_sort_fn, ast_sip_sched_task_cmp_fn);
 	if (!tasks) {
 		ast_log(LOG_ERROR, "Failed to allocate task container. Aborting load\n");
+		AST_VECTOR_FREE(&pending);
 		ast_sched_context_destroy(scheduler_context);
 		return -1;
 	}
@@ -484,8 +672,14 @@ int ast_sip_destroy_scheduler(void)
 
 	if (scheduler_context) {
 		ast_sched_context_destroy(scheduler_context);
+		scheduler_context = NULL;
 	}
 
+	/* Due tasks never pushed to their serializers */
+	AST_VECTOR_RESET(&pending, ao2_cleanup);
+	AST_VECTOR_FREE(&pending);
+	flush_id = -1;
+
 	ao2_cleanup(tasks);
 	tasks = NULL;
 
@@ -49,7 +49,10 @@
 						have a subnet mask appended. The subnet mask may be written in either
 						CIDR or dot-decimal notation. Separate the IP address and subnet
 						mask with a slash ('/')
-					</para></description>
+					</para>
+					<para>If the source address of a request is in the networks of more
+						than one identify, the one with the longest network prefix is
+						used.</para></description>
 				</configOption>
 				<configOption name="type">
 					<synopsis>Must be of type 'identify'.</synopsis>
@@ -115,28 +118,386 @@ static int ip_identify_match_check(void *obj, void *arg, int flags)
 	}
 }
 
-static struct ast_sip_endpoint *ip_identify(pjsip_rx_data *rdata)
+/*! \brief Node of a prefix tree over the networks of every identify */
+struct ip_identify_node {
+	/*! \brief Network address, only the first prefix bits of which are set */
+	unsigned char addr[16];
+	/*! \brief Length of the network prefix in bits */
+	int prefix;
+	/*! \brief Identify matching this network, NULL if the node only joins others */
+	struct ip_identify_match *identify;
+	/*! \brief Longer networks continuing with a 0 or a 1 bit */
+	struct ip_identify_node *child[2];
+};
+
+/*! \brief Prefix trees over the networks of every identify */
+struct ip_identify_tree {
+	/*! \brief Tree of the IPv4 networks */
+	struct ip_identify_node *ipv4;
+	/*! \brief Tree of the IPv6 networks */
+	struct ip_identify_node *ipv6;
+	/*! \brief Nonzero if the identifies cannot be put in a tree and are checked one by one */
+	int linear;
+};
+
+/*! \brief The current tree, built on first use after identify configuration changes */
+static AO2_GLOBAL_OBJ_STATIC(identify_tree);
+
+/*! \brief Protects replacing the current tree */
+AST_MUTEX_DEFINE_STATIC(identify_tree_lock);
+
+/*! \brief Incremented whenever identify configuration changes */
+static unsigned int identify_tree_generation;
+
+static int ip_identify_bit(const unsigned char *addr, int bit)
 {
-	struct ast_sockaddr addr = { { 0, } };
-	RAII_VAR(struct ao2_container *, candidates, NULL, ao2_cleanup);
-	RAII_VAR(struct ip_identify_match *, match, NULL, ao2_cleanup);
-	struct ast_sip_endpoint *endpoint;
+	return (addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+/*! \brief Number of leading bits, up to max, which two addresses share */
+static int ip_identify_common(const unsigned char *left, const unsigned char *right, int max)
+{
+	int bits;
+
+	for (bits = 0; bits < max; bits += 8) {
+		unsigned char diff = left[bits / 8] ^ right[bits / 8];
+
+		if (diff) {
+			while (!(diff & 0x80)) {
+				diff <<= 1;
+				++bits;
+			}
+			break;
+		}
+	}
+
+	return MIN(bits, max);
+}
+
+/*!
+ * \brief Get the raw bytes of an address
+ *
+ * \param addr The address, IPv4 mapped IPv6 addresses are treated as IPv4
+ * \param bytes Receives the address in network order
+ *
+ * \retval 32 for an IPv4 address
+ * \retval 128 for an IPv6 address
+ * \retval -1 for anything else
+ */
+static int ip_identify_addr_bytes(const struct ast_sockaddr *addr, unsigned char *bytes)
+{
+	struct ast_sockaddr mapped;
+
+	if (ast_sockaddr_is_ipv4_mapped(addr) && ast_sockaddr_ipv4_mapped(addr, &mapped)) {
+		addr = &mapped;
+	}
+
+	if (ast_sockaddr_is_ipv4(addr)) {
+		memcpy(bytes, &((const struct sockaddr_in *) &addr->ss)->sin_addr, 4);
+		return 32;
+	} else if (ast_sockaddr_is_ipv6(addr)) {
+		memcpy(bytes, &((const struct sockaddr_in6 *) &addr->ss)->sin6_addr, 16);
+		return 128;
+	}
+	return -1;
+}
+
+/*! \brief Length of the prefix a netmask selects, -1 if it is not contiguous */
+static int ip_identify_prefix(const unsigned char *mask, int bits)
+{
+	int prefix = 0;
+	int bit;
+
+	while (prefix < bits && ip_identify_bit(mask, prefix)) {
+		++prefix;
+	}
+	for (bit = prefix; bit < bits; ++bit) {
+		if (ip_identify_bit(mask, bit)) {
+			return -1;
+		}
+	}
+	return prefix;
+}
+
+static struct ip_identify_node *ip_identify_node_alloc(const unsigned char *addr, int prefix,
+	struct ip_identify_match *identify)
+{
+	struct ip_identify_node *node = ast_calloc(1, sizeof(*node));
+	int bit;
+
+	if (!node) {
+		return NULL;
+	}
+	for (bit = 0; bit < prefix; ++bit) {
+		node->addr[bit / 8] |= addr[bit / 8] & (0x80 >> (bit % 8));
+	}
+	node->prefix = prefix;
+	node->identify = ao2_bump(identify);
+	return node;
+}
+
+static void ip_identify_node_free(struct ip_identify_node *node)
+{
+	if (!node) {
+		return;
+	}
+	ip_identify_node_free(node->child[0]);
+	ip_identify_node_free(node->child[1]);
+	ao2_cleanup(node->identify);
+	ast_free(node);
+}
+
+/*!
+ * \brief Add the network of an identify to a tree
+ *
+ * \note When two identifies have the same network, the one whose name sorts
+ * first is kept so the choice does not depend on the order they are added in.
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int ip_identify_node_insert(struct ip_identify_node **link, const unsigned char *addr,
+	int prefix, struct ip_identify_match *identify)
+{
+	struct ip_identify_node *node;
+	struct ip_identify_node *split;
+	int common;
+
+	while ((node = *link)) {
+		common = ip_identify_common(node->addr, addr, MIN(node->prefix, prefix));
+		if (common < node->prefix) {
+			/* The network branches off above this node, so a node is needed where it does. */
+			split = ip_identify_node_alloc(addr, common, common == prefix ? identify : NULL);
+			if (!split) {
+				return -1;
+			}
+			split->child[ip_identify_bit(node->addr, common)] = node;
+			if (common < prefix) {
+				split->child[ip_identify_bit(addr, common)] = ip_identify_node_alloc(addr, prefix, identify);
+				if (!split->child[ip_identify_bit(addr, common)]) {
+					split->child[ip_identify_bit(node->addr, common)] = NULL;
+					ip_identify_node_free(split);
+					return -1;
+				}
+			}
+			*link = split;
+			return 0;
+		}
+		if (node->prefix == prefix) {
+			if (!node->identify || strcmp(ast_sorcery_object_get_id(identify),
+				ast_sorcery_object_get_id(node->identify)) < 0) {
+				ao2_replace(node->identify, identify);
+			}
+			return 0;
+		}
+		link = &node->child[ip_identify_bit(addr, node->prefix)];
+	}
+
+	*link = ip_identify_node_alloc(addr, prefix, identify);
+	return *link ? 0 : -1;
+}
+
+/*! \brief Find the identify with the longest network containing an address */
+static struct ip_identify_match *ip_identify_node_find(const struct ip_identify_node *node,
+	const unsigned char *addr, int bits)
+{
+	struct ip_identify_match *found = NULL;
+
+	while (node && ip_identify_common(node->addr, addr, node->prefix) == node->prefix) {
+		if (node->identify) {
+			found = node->identify;
+		}
+		if (node->prefix == bits) {
+			break;
+		}
+		node = node->child[ip_identify_bit(addr, node->prefix)];
+	}
+
+	return found;
+}
+
+static void ip_identify_tree_destroy(void *obj)
+{
+	struct ip_identify_tree *tree = obj;
+
+	ip_identify_node_free(tree->ipv4);
+	ip_identify_node_free(tree->ipv6);
+}
+
+/*! \brief Whether identifies only come from configuration files, so a tree cannot go stale */
+static int ip_identify_config_only(void)
+{
+	int count = ast_sorcery_get_wizard_mapping_count(ast_sip_get_sorcery(), "identify");
+	int idx;
+
+	for (idx = 0; idx < count; ++idx) {
+		struct ast_sorcery_wizard *wizard;
+		void *data;
+		int config;
+
+		if (ast_sorcery_get_wizard_mapping(ast_sip_get_sorcery(), "identify", idx, &wizard, &data)) {
+			return 0;
+		}
+		config = !strcmp(wizard->name, "config");
+		ao2_cleanup(wizard);
+		if (!config) {
+			return 0;
+		}
+	}
+
+	return count > 0;
+}
+
+/*! \brief Add every network of an identify to the tree */
+static int ip_identify_tree_add(void *obj, void *arg, int flags)
+{
+	struct ip_identify_match *identify = obj;
+	struct ip_identify_tree *tree = arg;
+	struct ast_ha *ha;
+
+	for (ha = identify->matches; ha; ha = ha->next) {
+		unsigned char addr[16];
+		unsigned char mask[16];
+		int bits = ip_identify_addr_bytes(&ha->addr, addr);
+		int prefix;
+
+		if (bits < 0 || ip_identify_addr_bytes(&ha->netmask, mask) != bits
+			|| (prefix = ip_identify_prefix(mask, bits)) < 0
+			|| ip_identify_node_insert(bits == 32 ? &tree->ipv4 : &tree->ipv6, addr, prefix, identify)) {
+			ast_debug(3, "Identify '%s' cannot be put in a tree, checking identifies one by one\n",
+				ast_sorcery_object_get_id(identify));
+			tree->linear = 1;
+			return CMP_STOP;
+		}
+	}
+
+	return 0;
+}
+
+/*! \brief Get the current tree, building it if configuration changed since it was */
+static struct ip_identify_tree *ip_identify_tree_get(void)
+{
+	struct ip_identify_tree *tree;
+	struct ao2_container *candidates;
+	unsigned int generation;
+
+	tree = ao2_global_obj_ref(identify_tree);
+	if (tree) {
+		return tree;
+	}
+
+	ast_mutex_lock(&identify_tree_lock);
+	generation = identify_tree_generation;
+	ast_mutex_unlock(&identify_tree_lock);
+
+	tree = ao2_alloc_options(sizeof(*tree), ip_identify_tree_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!tree) {
+		return NULL;
+	}
+
+	if (!ip_identify_config_only()) {
+		tree->linear = 1;
+	} else {
+		candidates = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "identify",
+			AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+		if (!candidates) {
+			ao2_ref(tree, -1);
+			return NULL;
+		}
+		ao2_callback(candidates, OBJ_NODATA, ip_identify_tree_add, tree);
+		ao2_ref(candidates, -1);
+	}
+
+	if (tree->linear) {
+		ip_identify_node_free(tree->ipv4);
+		ip_identify_node_free(tree->ipv6);
+		tree->ipv4 = tree->ipv6 = NULL;
+	}
+
+	/* Configuration that changed while building makes this tree stale already. */
+	ast_mutex_lock(&identify_tree_lock);
+	if (generation == identify_tree_generation) {
+		ao2_global_obj_replace_unref(identify_tree, tree);
+	}
+	ast_mutex_unlock(&identify_tree_lock);
+
+	return tree;
+}
+
+static void ip_identify_tree_invalidate(void)
+{
+	ast_mutex_lock(&identify_tree_lock);
+	++identify_tree_generation;
+	ao2_global_obj_release(identify_tree);
+	ast_mutex_unlock(&identify_tree_lock);
+}
+
+static void ip_identify_changed(const void *object)
+{
+	ip_identify_tree_invalidate();
+}
+
+static void ip_identify_loaded(const char *object_type)
+{
+	ip_identify_tree_invalidate();
+}
+
+/*! \brief Observer which throws the tree away whenever an identify changes */
+static const struct ast_sorcery_observer ip_identify_observer = {
+	.created = ip_identify_changed,
+	.updated = ip_identify_changed,
+	.deleted = ip_identify_changed,
+	.loaded = ip_identify_loaded,
+};
+
+/*! \brief Find the identify matching an address by checking every identify */
+static struct ip_identify_match *ip_identify_linear(struct ast_sockaddr *addr)
+{
+	struct ao2_container *candidates;
+	struct ip_identify_match *match;
 
 	/* If no possibilities exist return early to save some time */
 	if (!(candidates = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "identify", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL)) ||
 		!ao2_container_count(candidates)) {
 		ast_debug(3, "No identify sections to match against\n");
+		ao2_cleanup(candidates);
 		return NULL;
 	}
 
+	match = ao2_callback(candidates, 0, ip_identify_match_check, addr);
+	ao2_ref(candidates, -1);
+	return match;
+}
+
+static struct ast_sip_endpoint *ip_identify(pjsip_rx_data *rdata)
+{
+	struct ast_sockaddr addr = { { 0, } };
+	RAII_VAR(struct ip_identify_tree *, tree, NULL, ao2_cleanup);
+	RAII_VAR(struct ip_identify_match *, match, NULL, ao2_cleanup);
+	struct ast_sip_endpoint *endpoint;
+
 	ast_sockaddr_parse(&addr, rdata->pkt_info.src_name, PARSE_PORT_FORBID);
 	ast_sockaddr_set_port(&addr, rdata->pkt_info.src_port);
 
-	if (!(match = ao2_callback(candidates, 0, ip_identify_match_check, &addr))) {
+	tree = ip_identify_tree_get();
+	if (!tree || tree->linear) {
+		match = ip_identify_linear(&addr);
+	} else {
+		unsigned char bytes[16];
+		int bits = ip_identify_addr_bytes(&addr, bytes);
+
+		if (bits > 0) {
+			match = ao2_bump(ip_identify_node_find(bits == 32 ? tree->ipv4 : tree->ipv6, bytes, bits));
+		}
+	}
+
+	if (!match) {
 		ast_debug(3, "'%s' did not match any identify section rules\n",
 				ast_sockaddr_stringify(&addr));
 		return NULL;
 	}
+	ast_debug(3, "Source address %s matches identify '%s'\n",
+		ast_sockaddr_stringify(&addr), ast_sorcery_object_get_id(match));
 
 	endpoint = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "endpoint", match->endpoint_name);
 	if (endpoint) {
@@ -469,6 +830,7 @@ static int load_module(void)
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "type", "", OPT_NOOP_T, 0, 0);
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "identify", "endpoint", "", OPT_STRINGFIELD_T, 0, STRFLDSET(struct ip_identify_match, endpoint_name));
 	ast_sorcery_object_field_register_custom(ast_sip_get_sorcery(), "identify", "match", "", ip_identify_match_handler, match_to_str, match_to_var_list, 0, 0);
+	ast_sorcery_observer_add(ast_sip_get_sorcery(), "identify", &ip_identify_observer);
 	ast_sorcery_load_object(ast_sip_get_sorcery(), "identify");
 
 	ast_sip_register_endpoint_identifier_with_name(&ip_identifier, "ip");
@@ -506,6 +868,8 @@ static int unload_module(void)
 	ast_sip_unregister_cli_formatter(cli_formatter);
 	ast_sip_unregister_endpoint_formatter(&endpoint_identify_formatter);
 	ast_sip_unregister_endpoint_identifier(&ip_identifier);
+	ast_sorcery_observer_remove(ast_sip_get_sorcery(), "identify", &ip_identify_observer);
+	ao2_global_obj_release(identify_tree);
 
 	return 0;
 }
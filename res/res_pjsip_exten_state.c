@@ -42,6 +42,7 @@
 #include "asterisk/sorcery.h"
 #include "asterisk/app.h"
 #include "asterisk/taskprocessor.h"
+#include "asterisk/sched.h"
 
 #define BODY_SIZE 1024
 #define EVENT_TYPE_SIZE 50
@@ -59,6 +60,13 @@ static struct ao2_container *publishers;
 /*! Serializer for outbound extension state publishing. */
 static struct ast_taskprocessor *publish_exten_state_serializer;
 
+/*!
+ * \brief Scheduler for sending coalesced extension state notifications
+ */
+static struct ast_sched_context *coalesce_sched;
+
+struct notify_task_data;
+
 /*!
  * \brief A subscription for extension state
  *
@@ -83,6 +91,16 @@ struct exten_state_subscription {
 	enum ast_extension_states last_exten_state;
 	/*! The last known presence state */
 	enum ast_presence_state last_presence_state;
+	/*! Latest state change waiting out the coalescing interval, protected by the object lock */
+	struct notify_task_data *pending;
+	/*! The extension state last sent to the subscriber, protected by the object lock */
+	enum ast_extension_states notified_exten_state;
+	/*! The presence state last sent to the subscriber */
+	enum ast_presence_state notified_presence_state;
+	/*! The presence subtype last sent to the subscriber */
+	char *notified_presence_subtype;
+	/*! The presence message last sent to the subscriber */
+	char *notified_presence_message;
 };
 
 /*!
@@ -172,6 +190,8 @@ static void exten_state_subscription_destructor(void *obj)
 	struct exten_state_subscription *sub = obj;
 
 	ast_free(sub->user_agent);
+	ast_free(sub->notified_presence_subtype);
+	ast_free(sub->notified_presence_message);
 	ast_sip_subscription_destroy(sub->sip_sub);
 	ast_taskprocessor_unreference(sub->serializer);
 }
@@ -227,6 +247,8 @@ static struct exten_state_subscription *exten_state_subscription_alloc(
 	exten_state_sub->serializer = ao2_bump(ast_sip_subscription_get_serializer(sip_sub));
 	exten_state_sub->last_exten_state = INITIAL_LAST_EXTEN_STATE;
 	exten_state_sub->last_presence_state = AST_PRESENCE_NOT_SET;
+	exten_state_sub->notified_exten_state = INITIAL_LAST_EXTEN_STATE;
+	exten_state_sub->notified_presence_state = AST_PRESENCE_NOT_SET;
 	exten_state_sub->user_agent = get_user_agent(sip_sub);
 	return exten_state_sub;
 }
@@ -285,6 +307,48 @@ static struct notify_task_data *alloc_notify_task_data(const char *exten,
 	return task_data;
 }
 
+/*!
+ * \internal
+ * \brief Determine if state data matches what was last sent to the subscriber.
+ *
+ * The body generators only use the extension and presence state out of the
+ * state data that differs between notifications, so if those are unchanged
+ * the subscriber already has the body that would be generated.
+ */
+static int exten_state_notified(struct exten_state_subscription *exten_state_sub,
+	const struct ast_sip_exten_state_data *exten_state_data)
+{
+	int res;
+
+	ao2_lock(exten_state_sub);
+	res = exten_state_sub->notified_exten_state == exten_state_data->exten_state
+		&& exten_state_sub->notified_presence_state == exten_state_data->presence_state
+		&& !strcmp(S_OR(exten_state_sub->notified_presence_subtype, ""),
+			S_OR(exten_state_data->presence_subtype, ""))
+		&& !strcmp(S_OR(exten_state_sub->notified_presence_message, ""),
+			S_OR(exten_state_data->presence_message, ""));
+	ao2_unlock(exten_state_sub);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Remember the state data sent to the subscriber.
+ */
+static void exten_state_set_notified(struct exten_state_subscription *exten_state_sub,
+	const struct ast_sip_exten_state_data *exten_state_data)
+{
+	ao2_lock(exten_state_sub);
+	exten_state_sub->notified_exten_state = exten_state_data->exten_state;
+	exten_state_sub->notified_presence_state = exten_state_data->presence_state;
+	ast_free(exten_state_sub->notified_presence_subtype);
+	exten_state_sub->notified_presence_subtype = ast_strdup(exten_state_data->presence_subtype);
+	ast_free(exten_state_sub->notified_presence_message);
+	exten_state_sub->notified_presence_message = ast_strdup(exten_state_data->presence_message);
+	ao2_unlock(exten_state_sub);
+}
+
 static int notify_task(void *obj)
 {
 	RAII_VAR(struct notify_task_data *, task_data, obj, ao2_cleanup);
@@ -300,6 +364,14 @@ static int notify_task(void *obj)
 		return 0;
 	}
 
+	/* Don't regenerate and resend a body the subscriber already has, as happens when
+	 * the state flaps back within the coalescing interval.
+	 */
+	if (!task_data->terminate
+		&& exten_state_notified(task_data->exten_state_sub, &task_data->exten_state_data)) {
+		return 0;
+	}
+
 	/* All access to the subscription must occur within a task executed within its serializer */
 	ast_sip_subscription_get_local_uri(task_data->exten_state_sub->sip_sub,
 			task_data->exten_state_data.local, sizeof(task_data->exten_state_data.local));
@@ -316,14 +388,97 @@ static int notify_task(void *obj)
 	task_data->exten_state_data.sub = task_data->exten_state_sub->sip_sub;
 	task_data->exten_state_data.datastores = ast_sip_subscription_get_datastores(task_data->exten_state_sub->sip_sub);
 
-	ast_sip_subscription_notify(task_data->exten_state_sub->sip_sub, &data,
-			task_data->terminate);
+	if (!ast_sip_subscription_notify(task_data->exten_state_sub->sip_sub, &data,
+			task_data->terminate)) {
+		exten_state_set_notified(task_data->exten_state_sub, &task_data->exten_state_data);
+	}
 
 	pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(),
 			task_data->exten_state_data.pool);
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Send the latest state change held back by the coalescing interval.
+ *
+ * Executed in the subscription serializer.
+ */
+static int coalesced_notify_task(void *obj)
+{
+	struct exten_state_subscription *exten_state_sub = obj;
+	struct notify_task_data *task_data;
+
+	ao2_lock(exten_state_sub);
+	task_data = exten_state_sub->pending;
+	exten_state_sub->pending = NULL;
+	ao2_unlock(exten_state_sub);
+
+	if (task_data) {
+		notify_task(task_data);
+	}
+
+	ao2_ref(exten_state_sub, -1);
+	return 0;
+}
+
+static int coalesce_sched_cleanup(const void *data)
+{
+	struct exten_state_subscription *exten_state_sub = (struct exten_state_subscription *) data;
+	struct notify_task_data *task_data;
+
+	ao2_lock(exten_state_sub);
+	task_data = exten_state_sub->pending;
+	exten_state_sub->pending = NULL;
+	ao2_unlock(exten_state_sub);
+
+	ao2_cleanup(task_data);
+	ao2_ref(exten_state_sub, -1);
+	return 0;
+}
+
+static int coalesce_sched_cb(const void *data)
+{
+	struct exten_state_subscription *exten_state_sub = (struct exten_state_subscription *) data;
+
+	/* The reference held for the scheduler entry passes to the task */
+	if (ast_sip_push_task(exten_state_sub->serializer, coalesced_notify_task, exten_state_sub)) {
+		coalesce_sched_cleanup(exten_state_sub);
+	}
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hold a state change back for the coalescing interval.
+ *
+ * If a change is already held back it is replaced, so only the latest state
+ * is sent once the interval expires.
+ *
+ * \note Steals the reference to task_data on success.
+ */
+static int coalesce_state_change(struct exten_state_subscription *exten_state_sub,
+	struct notify_task_data *task_data, unsigned int interval)
+{
+	struct notify_task_data *replaced;
+
+	ao2_lock(exten_state_sub);
+	replaced = exten_state_sub->pending;
+	exten_state_sub->pending = task_data;
+	if (!replaced && ast_sched_add(coalesce_sched, interval, coalesce_sched_cb,
+		ao2_bump(exten_state_sub)) < 0) {
+		exten_state_sub->pending = NULL;
+		ao2_unlock(exten_state_sub);
+		ao2_ref(exten_state_sub, -1);
+		return -1;
+	}
+	ao2_unlock(exten_state_sub);
+
+	ao2_cleanup(replaced);
+	return 0;
+}
+
 /*!
  * \internal
  * \brief Callback for exten/device state changes.
@@ -335,11 +490,22 @@ static int state_changed(const char *context, const char *exten,
 {
 	struct notify_task_data *task_data;
 	struct exten_state_subscription *exten_state_sub = data;
+	unsigned int interval;
 
 	if (!(task_data = alloc_notify_task_data(exten, exten_state_sub, info))) {
 		return -1;
 	}
 
+	/* A subscription being terminated is never held back */
+	interval = ast_sip_get_exten_state_coalesce_interval();
+	if (interval && !task_data->terminate) {
+		if (coalesce_state_change(exten_state_sub, task_data, interval)) {
+			ao2_cleanup(task_data);
+			return -1;
+		}
+		return 0;
+	}
+
 	/* safe to push this async since we copy the data from info and
 	   add a ref for the device state info */
 	if (ast_sip_push_task(task_data->exten_state_sub->serializer, notify_task,
@@ -523,6 +689,9 @@ static struct ast_sip_exten_state_data *exten_state_data_alloc(struct ast_sip_su
 		return NULL;
 	}
 
+	/* The full state NOTIFY built from this is what the subscriber has now */
+	exten_state_set_notified(exten_state_sub, exten_state_data);
+
 	return exten_state_data;
 }
 
@@ -944,6 +1113,12 @@ static int unload_module(void)
 
 	ast_extension_state_del(0, exten_state_publisher_state_cb);
 
+	if (coalesce_sched) {
+		ast_sched_clean_by_callback(coalesce_sched, coalesce_sched_cb, coalesce_sched_cleanup);
+		ast_sched_context_destroy(coalesce_sched);
+		coalesce_sched = NULL;
+	}
+
 	ast_taskprocessor_unreference(publish_exten_state_serializer);
 	publish_exten_state_serializer = NULL;
 
@@ -975,6 +1150,13 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	coalesce_sched = ast_sched_context_create();
+	if (!coalesce_sched || ast_sched_start_thread(coalesce_sched)) {
+		ast_log(LOG_WARNING, "Unable to create scheduler for coalescing extension state notifications\n");
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (ast_sip_register_subscription_handler(&presence_handler)) {
 		ast_log(LOG_WARNING, "Unable to register subscription handler %s\n",
 			presence_handler.event_name);
@@ -45,9 +45,6 @@
 
 #define HISTORY_INITIAL_SIZE 256
 
-/*! \brief Pool factory used by pjlib to allocate memory. */
-static pj_caching_pool cachingpool;
-
 /*! \brief Whether or not we are storing history */
 static int enabled;
 
@@ -63,13 +60,21 @@ struct pjsip_history_entry {
 	/*! \brief Time the packet was transmitted/received */
 	struct timeval timestamp;
 	/*! \brief Source address */
-	pj_sockaddr_in src;
+	pj_sockaddr src;
 	/*! \brief Destination address */
-	pj_sockaddr_in dst;
-	/*! \brief Memory pool used to allocate \c msg */
-	pj_pool_t *pool;
-	/*! \brief The actual SIP message */
-	pjsip_msg *msg;
+	pj_sockaddr dst;
+	/*! \brief Whether or not the packet is a request */
+	int request;
+	/*! \brief Request method, empty for responses */
+	pj_str_t method;
+	/*! \brief Call-ID header */
+	pj_str_t call_id;
+	/*! \brief Bytes of memory used by the entry */
+	size_t size;
+	/*! \brief Length of the packet */
+	size_t len;
+	/*! \brief The packet as transmitted/received, followed by \c method and \c call_id */
+	char data[];
 };
 
 /*! \brief Mutex that protects \ref vector_history */
@@ -78,6 +83,15 @@ AST_MUTEX_DEFINE_STATIC(history_lock);
 /*! \brief The one and only history that we've captured */
 static AST_VECTOR(vector_history_t, struct pjsip_history_entry *) vector_history;
 
+/*! \brief Bytes of memory used by the entries in \ref vector_history */
+static size_t history_bytes;
+
+/*! \brief Most bytes of memory the history may use, 0 if unlimited */
+static size_t history_limit;
+
+/*! \brief Lock that protects \ref capture_filter */
+AST_RWLOCK_DEFINE_STATIC(capture_filter_lock);
+
 struct expression_token;
 
 /*! \brief An operator that we understand in an expression */
@@ -414,7 +428,7 @@ static int evaluate_like(struct operator *op, enum aco_option_type type, void *o
 		regex_t regexbuf;
 		char buf[pj_strlen(op_left) + 1];
 
-		ast_copy_pj_str(buf, op_left, pj_strlen(op_left));
+		ast_copy_pj_str(buf, op_left, sizeof(buf));
 		if (regcomp(&regexbuf, op_right->field, REG_EXTENDED | REG_NOSUB)) {
 			ast_log(LOG_WARNING, "Failed to compile '%s' into a regular expression\n", op_right->field);
 			return -1;
@@ -488,21 +502,17 @@ static void *entry_get_addr(struct pjsip_history_entry *entry)
 /*! \brief Callback to retrieve the entry's SIP request method type */
 static void *entry_get_sip_msg_request_method(struct pjsip_history_entry *entry)
 {
-	if (entry->msg->type != PJSIP_REQUEST_MSG) {
+	if (!entry->request) {
 		return NULL;
 	}
 
-	return &entry->msg->line.req.method.name;
+	return &entry->method;
 }
 
 /*! \brief Callback to retrieve the entry's SIP Call-ID header */
 static void *entry_get_sip_msg_call_id(struct pjsip_history_entry *entry)
 {
-	pjsip_cid_hdr *cid_hdr;
-
-	cid_hdr = PJSIP_MSG_CID_HDR(entry->msg);
-
-	return &cid_hdr->id;
+	return &entry->call_id;
 }
 
 /*! \brief The fields we allow */
@@ -597,73 +607,160 @@ static struct allowed_field *get_allowed_field(struct expression_token *token)
 	return NULL;
 }
 
-/*! \brief AO2 destructor for \c pjsip_history_entry */
-static void pjsip_history_entry_dtor(void *obj)
+/*! \brief Expression a packet must match to be stored, NULL to store every packet */
+static struct expression_token *capture_filter;
+
+/*!
+ * \brief Fill in the fields of an entry that describe a SIP message
+ *
+ * \param entry The entry to fill in
+ * \param msg The PJSIP message
+ *
+ * \note The strings of \c entry point into \c msg until the entry is stored
+ */
+static void pjsip_history_entry_index(struct pjsip_history_entry *entry, pjsip_msg *msg)
 {
-	struct pjsip_history_entry *entry = obj;
+	pjsip_cid_hdr *cid_hdr;
 
-	if (entry->pool) {
-		pj_pool_release(entry->pool);
-		entry->pool = NULL;
+	entry->request = msg->type == PJSIP_REQUEST_MSG;
+	if (entry->request) {
+		entry->method = msg->line.req.method.name;
+	}
+
+	cid_hdr = PJSIP_MSG_CID_HDR(msg);
+	if (cid_hdr) {
+		entry->call_id = cid_hdr->id;
 	}
 }
 
 /*!
  * \brief Create a \c pjsip_history_entry AO2 object
  *
- * \param msg The PJSIP message that this history entry wraps
+ * \param probe The entry describing the packet, whose strings are copied
+ * \param packet The packet as transmitted/received
+ * \param len Length of \c packet
  *
  * \retval An AO2 \c pjsip_history_entry object on success
  * \retval NULL on failure
  */
-static struct pjsip_history_entry *pjsip_history_entry_alloc(pjsip_msg *msg)
+static struct pjsip_history_entry *pjsip_history_entry_alloc(const struct pjsip_history_entry *probe,
+	const char *packet, size_t len)
 {
 	struct pjsip_history_entry *entry;
+	size_t size;
 
-	entry = ao2_alloc_options(sizeof(*entry), pjsip_history_entry_dtor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	size = sizeof(*entry) + len + pj_strlen(&probe->method) + pj_strlen(&probe->call_id);
+	entry = ao2_alloc_options(size, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
 	if (!entry) {
 		return NULL;
 	}
-	entry->number = ast_atomic_fetchadd_int(&packet_number, 1);
-	entry->timestamp = ast_tvnow();
-	entry->timestamp.tv_usec = 0;
+	*entry = *probe;
+	entry->size = size;
 
-	entry->pool = pj_pool_create(&cachingpool.factory, NULL, PJSIP_POOL_RDATA_LEN,
-	                             PJSIP_POOL_RDATA_INC, NULL);
-	if (!entry->pool) {
-		ao2_ref(entry, -1);
-		return NULL;
-	}
+	entry->len = len;
+	memcpy(entry->data, packet, len);
+
+	entry->method.ptr = entry->data + len;
+	memcpy(entry->method.ptr, pj_strbuf(&probe->method), pj_strlen(&probe->method));
+
+	entry->call_id.ptr = entry->method.ptr + pj_strlen(&entry->method);
+	memcpy(entry->call_id.ptr, pj_strbuf(&probe->call_id), pj_strlen(&probe->call_id));
 
-	entry->msg = pjsip_msg_clone(entry->pool, msg);
-	if (!entry->msg) {
+	return entry;
+}
+
+static int evaluate_history_entry(struct pjsip_history_entry *entry, struct expression_token *queue);
+
+/*!
+ * \brief Drop the oldest entries from \ref vector_history
+ *
+ * \param target Bytes of memory the remaining entries may use
+ *
+ * \note Must be called with \ref history_lock held
+ */
+static void history_trim(size_t target)
+{
+	size_t count = 0;
+
+	while (count < AST_VECTOR_SIZE(&vector_history) && history_bytes > target) {
+		struct pjsip_history_entry *entry = AST_VECTOR_GET(&vector_history, count++);
+
+		history_bytes -= entry->size;
 		ao2_ref(entry, -1);
-		return NULL;
+	}
+	if (!count) {
+		return;
 	}
 
-	return entry;
+	memmove(vector_history.elems, vector_history.elems + count,
+		(AST_VECTOR_SIZE(&vector_history) - count) * sizeof(*vector_history.elems));
+	vector_history.current -= count;
 }
 
-/*! \brief PJSIP callback when a SIP message is transmitted */
-static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
+/*!
+ * \brief Store a transmitted/received packet in the history
+ *
+ * \param probe The entry describing the packet, filled in by the caller
+ * \param msg The PJSIP message
+ * \param packet The packet as transmitted/received
+ * \param len Length of \c packet
+ *
+ * The capture filter is evaluated on \c probe, so packets that are not
+ * stored are never copied.
+ */
+static void history_capture(struct pjsip_history_entry *probe, pjsip_msg *msg,
+	const char *packet, size_t len)
 {
 	struct pjsip_history_entry *entry;
+	int res = 1;
 
-	if (!enabled) {
-		return PJ_SUCCESS;
+	probe->number = packet_number;
+	probe->timestamp = ast_tvnow();
+	probe->timestamp.tv_usec = 0;
+	pjsip_history_entry_index(probe, msg);
+
+	ast_rwlock_rdlock(&capture_filter_lock);
+	if (capture_filter) {
+		res = evaluate_history_entry(probe, capture_filter);
+	}
+	ast_rwlock_unlock(&capture_filter_lock);
+	if (res != 1) {
+		return;
 	}
 
-	entry = pjsip_history_entry_alloc(tdata->msg);
+	entry = pjsip_history_entry_alloc(probe, packet, len);
 	if (!entry) {
-		return PJ_SUCCESS;
+		return;
 	}
-	entry->transmitted = 1;
-	pj_sockaddr_cp(&entry->src, &tdata->tp_info.transport->local_addr);
-	pj_sockaddr_cp(&entry->dst, &tdata->tp_info.dst_addr);
 
 	ast_mutex_lock(&history_lock);
-	AST_VECTOR_APPEND(&vector_history, entry);
+	entry->number = packet_number++;
+	if (AST_VECTOR_APPEND(&vector_history, entry)) {
+		ast_mutex_unlock(&history_lock);
+		ao2_ref(entry, -1);
+		return;
+	}
+	history_bytes += entry->size;
+	if (history_limit && history_bytes > history_limit) {
+		/* Drop an eighth of the limit at once, so the vector is not shifted for every packet */
+		history_trim(history_limit - history_limit / 8);
+	}
 	ast_mutex_unlock(&history_lock);
+}
+
+/*! \brief PJSIP callback when a SIP message is transmitted */
+static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
+{
+	struct pjsip_history_entry probe = { .transmitted = 1, };
+
+	if (!enabled) {
+		return PJ_SUCCESS;
+	}
+
+	pj_sockaddr_cp(&probe.src, &tdata->tp_info.transport->local_addr);
+	pj_sockaddr_cp(&probe.dst, &tdata->tp_info.dst_addr);
+
+	history_capture(&probe, tdata->msg, tdata->buf.start, tdata->buf.cur - tdata->buf.start);
 
 	return PJ_SUCCESS;
 }
@@ -671,7 +768,7 @@ static pj_status_t history_on_tx_msg(pjsip_tx_data *tdata)
 /*! \brief PJSIP callback when a SIP message is received */
 static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 {
-	struct pjsip_history_entry *entry;
+	struct pjsip_history_entry probe = { .transmitted = 0, };
 
 	if (!enabled) {
 		return PJ_FALSE;
@@ -681,22 +778,15 @@ static pj_bool_t history_on_rx_msg(pjsip_rx_data *rdata)
 		return PJ_FALSE;
 	}
 
-	entry = pjsip_history_entry_alloc(rdata->msg_info.msg);
-	if (!entry) {
-		return PJ_FALSE;
-	}
-
 	if (rdata->tp_info.transport->addr_len) {
-		pj_sockaddr_cp(&entry->dst, &rdata->tp_info.transport->local_addr);
+		pj_sockaddr_cp(&probe.dst, &rdata->tp_info.transport->local_addr);
 	}
 
 	if (rdata->pkt_info.src_addr_len) {
-		pj_sockaddr_cp(&entry->src, &rdata->pkt_info.src_addr);
+		pj_sockaddr_cp(&probe.src, &rdata->pkt_info.src_addr);
 	}
 
-	ast_mutex_lock(&history_lock);
-	AST_VECTOR_APPEND(&vector_history, entry);
-	ast_mutex_unlock(&history_lock);
+	history_capture(&probe, rdata->msg_info.msg, rdata->pkt_info.packet, rdata->msg_info.len);
 
 	return PJ_FALSE;
 }
@@ -716,6 +806,7 @@ static int clear_history_entries(void *obj)
 {
 	ast_mutex_lock(&history_lock);
 	AST_VECTOR_RESET(&vector_history, clear_history_entry_cb);
+	history_bytes = 0;
 	packet_number = 0;
 	ast_mutex_unlock(&history_lock);
 
@@ -999,6 +1090,7 @@ static int evaluate_history_entry(struct pjsip_history_entry *entry, struct expr
 	}
 	result = final->result;
 	ast_free(final);
+	AST_VECTOR_FREE(&stack);
 
 	return result;
 
@@ -1075,18 +1167,6 @@ static struct vector_history_t *filter_history(struct ast_cli_args *a)
 static void display_single_entry(struct ast_cli_args *a, struct pjsip_history_entry *entry)
 {
 	char addr[64];
-	char *buf;
-
-	buf = ast_calloc(1, PJSIP_MAX_PKT_LEN * sizeof(char));
-	if (!buf) {
-		return;
-	}
-
-	if (pjsip_msg_print(entry->msg, buf, PJSIP_MAX_PKT_LEN) == -1) {
-		ast_log(LOG_WARNING, "Unable to print SIP message %d: packet too large!\n", entry->number);
-		ast_free(buf);
-		return;
-	}
 
 	if (entry->transmitted) {
 		pj_sockaddr_print(&entry->dst, addr, sizeof(addr), 3);
@@ -1099,9 +1179,7 @@ static void display_single_entry(struct ast_cli_args *a, struct pjsip_history_en
 		entry->transmitted ? "Sent to" : "Received from",
 		addr,
 		entry->timestamp.tv_sec);
-	ast_cli(a->fd, "%s\n", buf);
-
-	ast_free(buf);
+	ast_cli(a->fd, "%.*s\n", (int) entry->len, entry->data);
 }
 
 /*! \brief Print a list of the entries to the CLI */
@@ -1119,7 +1197,7 @@ static void display_entry_list(struct ast_cli_args *a, struct vector_history_t *
 	for (i = 0; i < AST_VECTOR_SIZE(vec); i++) {
 		struct pjsip_history_entry *entry;
 		char addr[64];
-		char line[256];
+		size_t line_len;
 
 		entry = AST_VECTOR_GET(vec, i);
 
@@ -1129,27 +1207,19 @@ static void display_entry_list(struct ast_cli_args *a, struct vector_history_t *
 			pj_sockaddr_print(&entry->src, addr, sizeof(addr), 3);
 		}
 
-		if (entry->msg->type == PJSIP_REQUEST_MSG) {
-			char uri[128];
-
-			pjsip_uri_print(PJSIP_URI_IN_REQ_URI, entry->msg->line.req.uri, uri, sizeof(uri));
-			snprintf(line, sizeof(line), "%.*s %s SIP/2.0",
-				(int)pj_strlen(&entry->msg->line.req.method.name),
-				pj_strbuf(&entry->msg->line.req.method.name),
-				uri);
-		} else {
-			snprintf(line, sizeof(line), "SIP/2.0 %u %.*s",
-				entry->msg->line.status.code,
-				(int)pj_strlen(&entry->msg->line.status.reason),
-				pj_strbuf(&entry->msg->line.status.reason));
+		/* The request or status line */
+		for (line_len = 0; line_len < entry->len; line_len++) {
+			if (entry->data[line_len] == '\r' || entry->data[line_len] == '\n') {
+				break;
+			}
 		}
 
-		ast_cli(a->fd, "%-5.5d %-10.10ld %-5.5s %-24.24s %s\n",
+		ast_cli(a->fd, "%-5.5d %-10.10ld %-5.5s %-24.24s %.*s\n",
 			entry->number,
 			entry->timestamp.tv_sec,
 			entry->transmitted ? "* ==>" : "* <==",
 			addr,
-			line);
+			(int) line_len, entry->data);
 	}
 }
 
@@ -1202,6 +1272,7 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 	if (a->argc > 3) {
 		if (!strcasecmp(a->argv[3], "entry") && a->argc == 5) {
 			int num;
+			int first;
 
 			if (sscanf(a->argv[4], "%30d", &num) != 1) {
 				ast_cli(a->fd, "'%s' is not a valid entry number\n", a->argv[4]);
@@ -1210,12 +1281,13 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 
 			/* Get the entry at the provided position */
 			ast_mutex_lock(&history_lock);
-			if (num >= AST_VECTOR_SIZE(&vector_history) || num < 0) {
+			first = AST_VECTOR_SIZE(&vector_history) ? AST_VECTOR_GET(&vector_history, 0)->number : 0;
+			if (num < first || num - first >= AST_VECTOR_SIZE(&vector_history)) {
 				ast_cli(a->fd, "Entry '%d' does not exist\n", num);
 				ast_mutex_unlock(&history_lock);
 				return CLI_FAILURE;
 			}
-			entry = ao2_bump(AST_VECTOR_GET(&vector_history, num));
+			entry = ao2_bump(AST_VECTOR_GET(&vector_history, num - first));
 			ast_mutex_unlock(&history_lock);
 		} else if (!strcasecmp(a->argv[3], "where")) {
 			vec = filter_history(a);
@@ -1233,7 +1305,7 @@ static char *pjsip_show_history(struct ast_cli_entry *e, int cmd, struct ast_cli
 		}
 		entry = ao2_bump(AST_VECTOR_GET(vec, 0));
 		if (vec == &vector_history) {
-			ast_mutex_lock(&history_lock);
+			ast_mutex_unlock(&history_lock);
 		}
 	}
 
@@ -1274,7 +1346,9 @@ static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_
 			"       the received packets from memory.\n\n"
 			"       As the PJSIP history is maintained in memory, and includes\n"
 			"       all received/transmitted requests and responses, it should\n"
-			"       only be enabled for debugging purposes, and cleared when done.\n";
+			"       only be enabled for debugging purposes, and cleared when done,\n"
+			"       unless it is bounded with 'pjsip set history limit' or only\n"
+			"       stores the packets matching 'pjsip set history filter'.\n";
 		return NULL;
 	} else if (cmd == CLI_GENERATE) {
 		return NULL;
@@ -1301,6 +1375,108 @@ static char *pjsip_set_history(struct ast_cli_entry *e, int cmd, struct ast_cli_
 	return CLI_SHOWUSAGE;
 }
 
+static char *pjsip_set_history_limit(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned long limit;
+	char unit = '\0';
+
+	if (cmd == CLI_INIT) {
+		e->command = "pjsip set history limit";
+		e->usage =
+			"Usage: pjsip set history limit <bytes>[K|M]\n"
+			"       Bounds the memory used by the PJSIP history. When the\n"
+			"       limit is reached the oldest packets are dropped, so the\n"
+			"       history can be left enabled. A limit of 0 removes the\n"
+			"       bound.\n";
+		return NULL;
+	} else if (cmd == CLI_GENERATE) {
+		return NULL;
+	}
+
+	if (a->argc != e->args + 1) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (sscanf(a->argv[e->args], "%30lu%c", &limit, &unit) < 1) {
+		return CLI_SHOWUSAGE;
+	}
+	switch (unit) {
+	case '\0':
+		break;
+	case 'k':
+	case 'K':
+		limit *= 1024;
+		break;
+	case 'm':
+	case 'M':
+		limit *= 1024 * 1024;
+		break;
+	default:
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&history_lock);
+	history_limit = limit;
+	if (history_limit) {
+		history_trim(history_limit);
+	}
+	ast_mutex_unlock(&history_lock);
+
+	if (limit) {
+		ast_cli(a->fd, "PJSIP History limited to %lu bytes\n", limit);
+	} else {
+		ast_cli(a->fd, "PJSIP History is unlimited\n");
+	}
+
+	return CLI_SUCCESS;
+}
+
+static char *pjsip_set_history_filter(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct pjsip_history_entry probe = { .request = 1, };
+	struct expression_token *queue = NULL;
+
+	if (cmd == CLI_INIT) {
+		e->command = "pjsip set history filter";
+		e->usage =
+			"Usage: pjsip set history filter [...]\n"
+			"       Only stores the packets that match an expression in the\n"
+			"       PJSIP history, using the same fields and operators as\n"
+			"       'pjsip show history where'. The expression is parsed\n"
+			"       once, and packets that do not match are not copied.\n"
+			"       Without an expression, every packet is stored.\n"
+			"\n"
+			"         Example:\n"
+			"         'pjsip set history filter sip.msg.request.method = REGISTER'\n";
+		return NULL;
+	} else if (cmd == CLI_GENERATE) {
+		return NULL;
+	}
+
+	if (a->argc > e->args) {
+		queue = build_expression_queue(a);
+		if (!queue) {
+			return CLI_FAILURE;
+		}
+
+		/* Evaluate every field once, so a bad expression is reported now rather than per packet */
+		if (evaluate_history_entry(&probe, queue) == -1) {
+			ast_cli(a->fd, "Unable to use the expression as a filter\n");
+			expression_token_free(queue);
+			return CLI_FAILURE;
+		}
+	}
+
+	ast_rwlock_wrlock(&capture_filter_lock);
+	expression_token_free(capture_filter);
+	capture_filter = queue;
+	ast_rwlock_unlock(&capture_filter_lock);
+
+	ast_cli(a->fd, "PJSIP History %s\n", queue ? "filter set" : "filter cleared");
+
+	return CLI_SUCCESS;
+}
+
 static pjsip_module logging_module = {
 	.name = { "History Module", 14 },
 	.priority = 0,
@@ -1312,6 +1488,8 @@ static pjsip_module logging_module = {
 
 static struct ast_cli_entry cli_pjsip[] = {
 	AST_CLI_DEFINE(pjsip_set_history, "Enable/Disable PJSIP History"),
+	AST_CLI_DEFINE(pjsip_set_history_limit, "Limit the memory used by PJSIP History"),
+	AST_CLI_DEFINE(pjsip_set_history_filter, "Filter the packets stored in PJSIP History"),
 	AST_CLI_DEFINE(pjsip_show_history, "Display PJSIP History"),
 };
 
@@ -1319,8 +1497,6 @@ static int load_module(void)
 {
 	CHECK_PJSIP_MODULE_LOADED();
 
-	pj_caching_pool_init(&cachingpool, &pj_pool_factory_default_policy, 0);
-
 	AST_VECTOR_INIT(&vector_history, HISTORY_INITIAL_SIZE);
 
 	ast_sip_register_service(&logging_module);
@@ -1337,7 +1513,9 @@ static int unload_module(void)
 	ast_sip_push_task_synchronous(NULL, clear_history_entries, NULL);
 	AST_VECTOR_FREE(&vector_history);
 
-	pj_caching_pool_destroy(&cachingpool);
+	ast_rwlock_wrlock(&capture_filter_lock);
+	capture_filter = expression_token_free(capture_filter);
+	ast_rwlock_unlock(&capture_filter_lock);
 
 	return 0;
 }
@@ -39,6 +39,8 @@
 #include "asterisk/sorcery.h"
 #include "asterisk/stasis.h"
 #include "asterisk/app.h"
+#include "asterisk/sched.h"
+#include "asterisk/linkedlists.h"
 
 struct mwi_subscription;
 static struct ao2_container *unsolicited_mwi;
@@ -59,6 +61,15 @@ static char *default_voicemail_extension;
 /*! Pool of serializers to use if not supplied. */
 static struct ast_taskprocessor *mwi_serializer_pool[MWI_SERIALIZER_POOL_SIZE];
 
+/*! Milliseconds between the batches of queued unsolicited MWI sent. */
+#define MWI_QUEUE_INTERVAL 100
+
+/*! Endpoints sent unsolicited MWI per second, 0 to send without queueing. */
+static unsigned int mwi_unsolicited_rate;
+
+/*! Scheduler sending the queued unsolicited MWI. */
+static struct ast_sched_context *mwi_sched;
+
 static void mwi_subscription_shutdown(struct ast_sip_subscription *sub);
 static void mwi_to_ami(struct ast_sip_subscription *sub, struct ast_str **buf);
 static int mwi_new_subscribe(struct ast_sip_endpoint *endpoint,
@@ -119,6 +130,16 @@ struct mwi_subscription {
 	char *aors;
 	/*! Is the MWI solicited (i.e. Initiated with an external SUBSCRIBE) ? */
 	unsigned int is_solicited;
+	/*! New and old messages last sent, valid if notified is set.  Guarded by the object lock. */
+	int last_new_msgs;
+	int last_old_msgs;
+	unsigned int notified:1;
+	/*! Set while queued for unsolicited MWI.  Guarded by the mwi_queue lock. */
+	unsigned int queued:1;
+	/*! Set if queued to be sent even if the counts are unchanged.  Guarded by the mwi_queue lock. */
+	unsigned int queued_always:1;
+	/*! Next in the unsolicited MWI queue */
+	AST_LIST_ENTRY(mwi_subscription) queue_entry;
 	/*! Identifier for the subscription.
 	 * The identifier is the same as the corresponding endpoint's stasis ID.
 	 * Used as a hash key
@@ -194,6 +215,13 @@ static struct ast_taskprocessor *get_mwi_serializer(void)
 	return mwi_serializer_pool[pos];
 }
 
+/*! \brief Unsolicited MWI subscriptions waiting to be sent, each holding a reference */
+static AST_LIST_HEAD_STATIC(mwi_queue, mwi_subscription);
+/*! Scheduler id of the next batch of the queue, -1 if not scheduled.  Guarded by the mwi_queue lock. */
+static int mwi_queue_sched_id = -1;
+/*! Thousandths of an endpoint the next batch may send.  Guarded by the mwi_queue lock. */
+static unsigned int mwi_queue_credit;
+
 /*!
  * \internal
  * \brief Set taskprocessor alert levels for the serializers in the mwi pool.
@@ -470,6 +498,10 @@ struct unsolicited_mwi_data {
 	struct ast_sip_endpoint *endpoint;
 	pjsip_evsub_state state;
 	struct ast_sip_message_accumulator *counter;
+	/*! Body generated for the first contact, reused while the message account is the same */
+	struct ast_str *body_text;
+	/*! Message account body_text was generated for */
+	char body_account[PJSIP_MAX_URL_SIZE];
 };
 
 static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flags)
@@ -487,7 +519,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 	pjsip_sip_uri *from_uri;
 	const pjsip_hdr *allow_events = pjsip_evsub_get_allow_events_hdr(NULL);
 	struct ast_sip_body body;
-	struct ast_str *body_text;
 	struct ast_sip_body_data body_data = {
 		.body_type = AST_SIP_MESSAGE_ACCUMULATOR,
 		.body_data = mwi_data->counter,
@@ -500,10 +531,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 
 	body.type = MWI_TYPE;
 	body.subtype = MWI_SUBTYPE;
-	body_text = ast_str_create(64);
-	if (!body_text) {
-		return 0;
-	}
 
 	from = PJSIP_MSG_FROM_HDR(tdata->msg);
 	from_uri = pjsip_uri_get_uri(from->uri);
@@ -514,13 +541,25 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 
 	set_voicemail_extension(tdata->pool, from_uri, mwi_data->counter, endpoint->subscription.mwi.voicemail_extension);
 
-	if (ast_sip_pubsub_generate_body_content(body.type, body.subtype, &body_data, &body_text)) {
-		ast_log(LOG_WARNING, "Unable to generate SIP MWI NOTIFY body.\n");
-		ast_free(body_text);
-		return 0;
+	/* The body only depends on the counts and the message account, the same for most contacts. */
+	if (!mwi_data->body_text || strcmp(mwi_data->body_account, mwi_data->counter->message_account)) {
+		if (!mwi_data->body_text && !(mwi_data->body_text = ast_str_create(64))) {
+			pjsip_tx_data_dec_ref(tdata);
+			return 0;
+		}
+		ast_str_reset(mwi_data->body_text);
+		if (ast_sip_pubsub_generate_body_content(body.type, body.subtype, &body_data, &mwi_data->body_text)) {
+			ast_log(LOG_WARNING, "Unable to generate SIP MWI NOTIFY body.\n");
+			ast_free(mwi_data->body_text);
+			mwi_data->body_text = NULL;
+			pjsip_tx_data_dec_ref(tdata);
+			return 0;
+		}
+		ast_copy_string(mwi_data->body_account, mwi_data->counter->message_account,
+			sizeof(mwi_data->body_account));
 	}
 
-	body.body_text = ast_str_buffer(body_text);
+	body.body_text = ast_str_buffer(mwi_data->body_text);
 
 	switch (state) {
 	case PJSIP_EVSUB_STATE_ACTIVE:
@@ -544,8 +583,6 @@ static int send_unsolicited_mwi_notify_to_contact(void *obj, void *arg, int flag
 	ast_sip_add_body(tdata, &body);
 	ast_sip_send_request(tdata, NULL, endpoint, NULL, NULL);
 
-	ast_free(body_text);
-
 	return 0;
 }
 
@@ -594,6 +631,10 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 {
 	RAII_VAR(struct ast_sip_endpoint *, endpoint, ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(),
 				"endpoint", sub->id), ao2_cleanup);
+	struct unsolicited_mwi_data mwi_data = {
+		.sub = sub,
+		.counter = counter,
+	};
 	char *endpoint_aors;
 	char *aor_name;
 
@@ -609,6 +650,7 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 	}
 
 	endpoint_aors = ast_strdupa(endpoint->aors);
+	mwi_data.endpoint = endpoint;
 
 	ast_debug(5, "Sending unsolicited MWI NOTIFY to endpoint %s, new messages: %d, old messages: %d\n",
 			sub->id, counter->new_msgs, counter->old_msgs);
@@ -616,11 +658,6 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 	while ((aor_name = ast_strip(strsep(&endpoint_aors, ",")))) {
 		RAII_VAR(struct ast_sip_aor *, aor, ast_sip_location_retrieve_aor(aor_name), ao2_cleanup);
 		RAII_VAR(struct ao2_container *, contacts, NULL, ao2_cleanup);
-		struct unsolicited_mwi_data mwi_data = {
-			.sub = sub,
-			.endpoint = endpoint,
-			.counter = counter,
-		};
 
 		if (!aor) {
 			ast_log(LOG_WARNING, "Unable to locate AOR %s for unsolicited MWI\n", aor_name);
@@ -635,9 +672,19 @@ static void send_unsolicited_mwi_notify(struct mwi_subscription *sub,
 
 		ao2_callback(contacts, OBJ_NODATA, send_unsolicited_mwi_notify_to_contact, &mwi_data);
 	}
+
+	ast_free(mwi_data.body_text);
 }
 
-static void send_mwi_notify(struct mwi_subscription *sub)
+/*!
+ * \internal
+ * \brief Send the message counts of a subscription.
+ *
+ * \param sub The subscription.
+ * \param always Non-zero to send even if the counts are the ones last sent,
+ * such as to a contact that just registered.
+ */
+static void send_mwi_notify(struct mwi_subscription *sub, int always)
 {
 	struct ast_sip_message_accumulator counter = {
 		.old_msgs = 0,
@@ -652,6 +699,19 @@ static void send_mwi_notify(struct mwi_subscription *sub)
 
 	ao2_callback(sub->stasis_subs, OBJ_NODATA, get_message_count, &counter);
 
+	/* A republished mailbox state, or a change to another mailbox, leaves the counts the same. */
+	ao2_lock(sub);
+	if (!always && sub->notified
+		&& sub->last_new_msgs == counter.new_msgs && sub->last_old_msgs == counter.old_msgs) {
+		ao2_unlock(sub);
+		ast_debug(5, "MWI for endpoint %s is unchanged, not notifying\n", sub->id);
+		return;
+	}
+	sub->last_new_msgs = counter.new_msgs;
+	sub->last_old_msgs = counter.old_msgs;
+	sub->notified = 1;
+	ao2_unlock(sub);
+
 	if (sub->is_solicited) {
 		struct ast_sip_endpoint *endpoint = ast_sip_subscription_get_endpoint(sub->sip_sub);
 		struct ast_sip_aor *aor = find_aor_for_resource(endpoint, resource);
@@ -989,6 +1049,13 @@ static void *mwi_get_notify_data(struct ast_sip_subscription *sub)
 	ao2_cleanup(endpoint);
 
 	ao2_callback(mwi_sub->stasis_subs, OBJ_NODATA, get_message_count, counter);
+
+	ao2_lock(mwi_sub);
+	mwi_sub->last_new_msgs = counter->new_msgs;
+	mwi_sub->last_old_msgs = counter->old_msgs;
+	mwi_sub->notified = 1;
+	ao2_unlock(mwi_sub);
+
 	ao2_cleanup(mwi_datastore);
 	return counter;
 }
@@ -1037,11 +1104,108 @@ static int serialized_notify(void *userdata)
 {
 	struct mwi_subscription *mwi_sub = userdata;
 
-	send_mwi_notify(mwi_sub);
+	send_mwi_notify(mwi_sub, 1);
+	ao2_ref(mwi_sub, -1);
+	return 0;
+}
+
+static int serialized_notify_changed(void *userdata)
+{
+	struct mwi_subscription *mwi_sub = userdata;
+
+	send_mwi_notify(mwi_sub, 0);
 	ao2_ref(mwi_sub, -1);
 	return 0;
 }
 
+/*!
+ * \internal
+ * \brief Send the next batch of queued unsolicited MWI.
+ *
+ * Sends as many endpoints as mwi_unsolicited_rate allows for the interval,
+ * each to the least busy serializer of the pool.
+ */
+static int mwi_queue_send(const void *data)
+{
+	struct mwi_subscription *mwi_sub;
+	unsigned int rate = mwi_unsolicited_rate;
+	int res = MWI_QUEUE_INTERVAL;
+
+	AST_LIST_LOCK(&mwi_queue);
+	mwi_queue_credit += rate * MWI_QUEUE_INTERVAL;
+	while ((!rate || mwi_queue_credit >= 1000)
+		&& (mwi_sub = AST_LIST_REMOVE_HEAD(&mwi_queue, queue_entry))) {
+		mwi_queue_credit -= rate ? 1000 : 0;
+		mwi_sub->queued = 0;
+
+		/* The reference held by the queue goes to the task. */
+		if (ast_sip_push_task(get_mwi_serializer(),
+			mwi_sub->queued_always ? serialized_notify : serialized_notify_changed, mwi_sub)) {
+			ao2_ref(mwi_sub, -1);
+		}
+		mwi_sub->queued_always = 0;
+	}
+	if (AST_LIST_EMPTY(&mwi_queue)) {
+		mwi_queue_credit = 0;
+		mwi_queue_sched_id = -1;
+		res = 0;
+	}
+	AST_LIST_UNLOCK(&mwi_queue);
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Send the unsolicited MWI of a subscription, at the configured rate.
+ *
+ * \param mwi_sub The unsolicited subscription.
+ * \param always Non-zero to send even if the counts are the ones last sent.
+ */
+static void mwi_queue_notify(struct mwi_subscription *mwi_sub, int always)
+{
+	if (!mwi_unsolicited_rate || !mwi_sched) {
+		if (ast_sip_push_task(get_mwi_serializer(),
+			always ? serialized_notify : serialized_notify_changed, ao2_bump(mwi_sub))) {
+			ao2_ref(mwi_sub, -1);
+		}
+		return;
+	}
+
+	AST_LIST_LOCK(&mwi_queue);
+	if (always) {
+		mwi_sub->queued_always = 1;
+	}
+	if (!mwi_sub->queued) {
+		mwi_sub->queued = 1;
+		ao2_ref(mwi_sub, +1);
+		AST_LIST_INSERT_TAIL(&mwi_queue, mwi_sub, queue_entry);
+	}
+	if (mwi_queue_sched_id < 0) {
+		mwi_queue_sched_id = ast_sched_add(mwi_sched, MWI_QUEUE_INTERVAL, mwi_queue_send, NULL);
+	}
+	AST_LIST_UNLOCK(&mwi_queue);
+}
+
+/*!
+ * \internal
+ * \brief Drop the queued unsolicited MWI.
+ */
+static void mwi_queue_flush(void)
+{
+	struct mwi_subscription *mwi_sub;
+
+	AST_LIST_LOCK(&mwi_queue);
+	while ((mwi_sub = AST_LIST_REMOVE_HEAD(&mwi_queue, queue_entry))) {
+		mwi_sub->queued = 0;
+		mwi_sub->queued_always = 0;
+		ao2_ref(mwi_sub, -1);
+	}
+	mwi_queue_sched_id = -1;
+	mwi_queue_credit = 0;
+	AST_LIST_UNLOCK(&mwi_queue);
+}
+
 static int serialized_cleanup(void *userdata)
 {
 	struct mwi_subscription *mwi_sub = userdata;
@@ -1060,11 +1224,15 @@ static int serialized_cleanup(void *userdata)
 static int send_notify(void *obj, void *arg, int flags)
 {
 	struct mwi_subscription *mwi_sub = obj;
-	struct ast_taskprocessor *serializer = mwi_sub->is_solicited
-		? ast_sip_subscription_get_serializer(mwi_sub->sip_sub)
-		: get_mwi_serializer();
+	int always = arg ? 1 : 0;
+
+	if (!mwi_sub->is_solicited) {
+		mwi_queue_notify(mwi_sub, always);
+		return 0;
+	}
 
-	if (ast_sip_push_task(serializer, serialized_notify, ao2_bump(mwi_sub))) {
+	if (ast_sip_push_task(ast_sip_subscription_get_serializer(mwi_sub->sip_sub),
+		always ? serialized_notify : serialized_notify_changed, ao2_bump(mwi_sub))) {
 		ao2_ref(mwi_sub, -1);
 	}
 
@@ -1180,9 +1348,7 @@ static int send_contact_notify(void *obj, void *arg, int flags)
 		return 0;
 	}
 
-	if (ast_sip_push_task(get_mwi_serializer(), serialized_notify, ao2_bump(mwi_sub))) {
-		ao2_ref(mwi_sub, -1);
-	}
+	mwi_queue_notify(mwi_sub, 1);
 
 	return 0;
 }
@@ -1236,7 +1402,8 @@ static const struct ast_sorcery_observer mwi_contact_observer = {
 /*! \brief Task invoked to send initial MWI NOTIFY for unsolicited */
 static int send_initial_notify_all(void *obj)
 {
-	ao2_callback(unsolicited_mwi, OBJ_NODATA, send_notify, NULL);
+	/* Any non-NULL argument sends the counts even if they were sent before. */
+	ao2_callback(unsolicited_mwi, OBJ_NODATA, send_notify, "always");
 
 	return 0;
 }
@@ -1268,6 +1435,7 @@ static void global_loaded(const char *object_type)
 	ast_free(default_voicemail_extension);
 	default_voicemail_extension = ast_sip_get_default_voicemail_extension();
 	mwi_serializer_set_alert_levels();
+	mwi_unsolicited_rate = ast_sip_get_mwi_unsolicited_rate();
 }
 
 static struct ast_sorcery_observer global_observer = {
@@ -1292,9 +1460,22 @@ static int load_module(void)
 		ast_log(AST_LOG_WARNING, "Failed to create MWI serializer pool. The default SIP pool will be used for MWI\n");
 	}
 
+	mwi_sched = ast_sched_context_create();
+	if (!mwi_sched || ast_sched_start_thread(mwi_sched)) {
+		ast_log(AST_LOG_WARNING, "Failed to start the MWI scheduler. Unsolicited MWI will not be rate limited\n");
+		if (mwi_sched) {
+			ast_sched_context_destroy(mwi_sched);
+			mwi_sched = NULL;
+		}
+	}
+
 	unsolicited_mwi = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX, 0, MWI_BUCKETS,
 		mwi_sub_hash, NULL, mwi_sub_cmp);
 	if (!unsolicited_mwi) {
+		if (mwi_sched) {
+			ast_sched_context_destroy(mwi_sched);
+			mwi_sched = NULL;
+		}
 		mwi_serializer_pool_shutdown();
 		ast_sip_unregister_subscription_handler(&mwi_handler);
 		return AST_MODULE_LOAD_DECLINE;
@@ -1325,6 +1506,12 @@ static int unload_module(void)
 	ao2_ref(unsolicited_mwi, -1);
 	unsolicited_mwi = NULL;
 
+	if (mwi_sched) {
+		ast_sched_context_destroy(mwi_sched);
+		mwi_sched = NULL;
+	}
+	mwi_queue_flush();
+
 	mwi_serializer_pool_shutdown();
 
 	ast_sip_unregister_subscription_handler(&mwi_handler);
@@ -158,7 +158,7 @@ static int find_transport_state_in_use(void *obj, void *arg, int flags)
 	/* If an explicit transport or factory matches then this is what is in use, if we are unavailable
 	 * to compare based on that we make sure that the type is the same and the source IP address/port are the same
 	 */
-	if (transport_state && ((details->transport && details->transport == transport_state->transport) ||
+	if (transport_state && (ast_sip_transport_state_has_transport(transport_state, details->transport) ||
 		(details->factory && details->factory == transport_state->factory) ||
 		((details->type == transport_state->type) && (transport_state->factory) &&
 			!pj_strcmp(&transport_state->factory->addr_name.host, &details->local_address) &&
@@ -202,7 +202,7 @@ static int nat_invoke_hook(void *obj, void *arg, int flags)
 	return 0;
 }
 
-static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
+static int nat_rewrite(pjsip_tx_data *tdata)
 {
 	RAII_VAR(struct ao2_container *, transport_states, NULL, ao2_cleanup);
 	RAII_VAR(struct ast_sip_transport *, transport, NULL, ao2_cleanup);
@@ -212,6 +212,8 @@ static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
 	struct ast_sockaddr addr = { { 0, } };
 	pjsip_sip_uri *uri = NULL;
 	RAII_VAR(struct ao2_container *, hooks, NULL, ao2_cleanup);
+	const char *external_host;
+	int changed = 0;
 
 	/* If a transport selector is in use we know the transport or factory, so explicitly find it */
 	if (tdata->tp_sel.type == PJSIP_TPSELECTOR_TRANSPORT) {
@@ -229,7 +231,7 @@ static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
 			details.type = AST_TRANSPORT_TLS;
 		} else {
 			/* Unknown transport type, we can't map and thus can't apply NAT changes */
-			return PJ_SUCCESS;
+			return 0;
 		}
 
 		if ((uri = nat_get_contact_sip_uri(tdata))) {
@@ -240,7 +242,7 @@ static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
 			details.local_address = via->sent_by.host;
 			details.local_port = via->sent_by.port;
 		} else {
-			return PJ_SUCCESS;
+			return 0;
 		}
 
 		if (!details.local_port) {
@@ -249,19 +251,19 @@ static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
 	}
 
 	if (!(transport_states = ast_sip_get_transport_states())) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	if (!(transport_state = ao2_callback(transport_states, 0, find_transport_state_in_use, &details))) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	if (!(transport = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "transport", transport_state->id))) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	if ( !transport_state->localnet || 	ast_sockaddr_isnull(&transport_state->external_address)) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	ast_sockaddr_parse(&addr, tdata->tp_info.dst_name, PARSE_PORT_FORBID);
@@ -269,46 +271,63 @@ static pj_status_t nat_on_tx_message(pjsip_tx_data *tdata)
 
 	/* See if where we are sending this request is local or not, and if not that we can get a Contact URI to modify */
 	if (ast_apply_ha(transport_state->localnet, &addr) != AST_SENSE_ALLOW) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
+	external_host = ast_sockaddr_stringify_host(&transport_state->external_address);
+
 	/* Update the contact header with the external address */
 	if (uri || (uri = nat_get_contact_sip_uri(tdata))) {
-		pj_strdup2(tdata->pool, &uri->host, ast_sockaddr_stringify_host(&transport_state->external_address));
-		if (transport->external_signaling_port) {
+		if (pj_strcmp2(&uri->host, external_host)) {
+			pj_strdup2(tdata->pool, &uri->host, external_host);
+			changed = 1;
+		}
+		if (transport->external_signaling_port && uri->port != transport->external_signaling_port) {
 			uri->port = transport->external_signaling_port;
 			ast_debug(4, "Re-wrote Contact URI port to %d\n", uri->port);
+			changed = 1;
 		}
 	}
 
 	/* Update the via header if relevant */
 	if ((tdata->msg->type == PJSIP_REQUEST_MSG) && (via || (via = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_VIA, NULL)))) {
-		pj_strdup2(tdata->pool, &via->sent_by.host, ast_sockaddr_stringify_host(&transport_state->external_address));
-		if (transport->external_signaling_port) {
+		if (pj_strcmp2(&via->sent_by.host, external_host)) {
+			pj_strdup2(tdata->pool, &via->sent_by.host, external_host);
+			changed = 1;
+		}
+		if (transport->external_signaling_port && via->sent_by.port != transport->external_signaling_port) {
 			via->sent_by.port = transport->external_signaling_port;
+			changed = 1;
 		}
 	}
 
-	/* Invoke any additional hooks that may be registered */
-	if ((hooks = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "nat_hook", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL))) {
+	/* Invoke any additional hooks that may be registered, which may change anything */
+	if ((hooks = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "nat_hook", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL))
+		&& ao2_container_count(hooks)) {
 		struct nat_hook_details hook_details = {
 			.tdata = tdata,
 			.transport = transport,
 		};
 		ao2_callback(hooks, 0, nat_invoke_hook, &hook_details);
+		changed = 1;
 	}
 
-	return PJ_SUCCESS;
+	return changed;
 }
 
+/*! \brief Rewrite of outgoing messages to the external address */
+static struct ast_sip_tx_rewrite nat_tx_rewrite = {
+	.name = "NAT",
+	.priority = 10,
+	.rewrite = nat_rewrite,
+};
+
 static pjsip_module nat_module = {
 	.name = { "NAT", 3 },
 	.id = -1,
 	.priority = PJSIP_MOD_PRIORITY_TSX_LAYER - 2,
 	.on_rx_request = nat_on_rx_message,
 	.on_rx_response = nat_on_rx_message,
-	.on_tx_request = nat_on_tx_message,
-	.on_tx_response = nat_on_tx_message,
 };
 
 /*! \brief Function called when an INVITE goes out */
@@ -348,6 +367,7 @@ static struct ast_sip_session_supplement nat_supplement = {
 static int unload_module(void)
 {
 	ast_sip_session_unregister_supplement(&nat_supplement);
+	ast_sip_unregister_tx_rewrite(&nat_tx_rewrite);
 	ast_sip_unregister_service(&nat_module);
 	return 0;
 }
@@ -361,6 +381,12 @@ static int load_module(void)
 		return AST_MODULE_LOAD_FAILURE;
 	}
 
+	if (ast_sip_register_tx_rewrite(&nat_tx_rewrite)) {
+		ast_log(LOG_ERROR, "Could not register NAT rewrite for outgoing requests\n");
+		unload_module();
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	if (ast_sip_session_register_supplement(&nat_supplement)) {
 		ast_log(LOG_ERROR, "Could not register NAT session supplement for incoming and outgoing INVITE requests\n");
 		unload_module();
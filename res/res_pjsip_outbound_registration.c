@@ -81,6 +81,49 @@
 				<configOption name="max_retries" default="10">
 					<synopsis>Maximum number of registration attempts.</synopsis>
 				</configOption>
+				<configOption name="max_retry_interval" default="0">
+					<synopsis>Largest interval in seconds that retries back off to</synopsis>
+					<description><para>
+						If non-zero, the interval before each retry after a temporal or fatal
+						response is double the one before it, starting at
+						<replaceable>retry_interval</replaceable>,
+						<replaceable>forbidden_retry_interval</replaceable> or
+						<replaceable>fatal_retry_interval</replaceable>, up to this many seconds.
+						A random point in the upper half of the interval is used so that
+						registrations which failed together do not retry together.
+						A Retry-After header received from the server is followed as it is.
+						If 0, retries are made at the configured interval.
+					</para></description>
+				</configOption>
+				<configOption name="refresh_spread" default="0">
+					<synopsis>Percentage of the expiration time that refreshes are spread over</synopsis>
+					<description><para>
+						A registration is normally refreshed 10 seconds before it expires.
+						If non-zero, it is refreshed at a random point in the last
+						<replaceable>refresh_spread</replaceable> percent of that time instead,
+						so that many registrations made at once are not all refreshed at once.
+						Must be from 0 to 100.
+					</para></description>
+				</configOption>
+				<configOption name="server_max_in_flight" default="0">
+					<synopsis>Most REGISTER requests outstanding at once to the server host</synopsis>
+					<description><para>
+						Registrations whose <replaceable>server_uri</replaceable> has the same
+						host and port share a queue.  Once this many of their REGISTER requests
+						are awaiting a final response, the rest wait in the queue and are sent
+						in turn as responses arrive.  If 0, there is no limit.  Registrations to
+						the same server should use the same value; the one applied last is used.
+						The queue of each server is shown by <literal>pjsip show registrations</literal>.
+					</para></description>
+				</configOption>
+				<configOption name="server_max_rate" default="0">
+					<synopsis>Most REGISTER requests sent per second to the server host</synopsis>
+					<description><para>
+						As <replaceable>server_max_in_flight</replaceable>, but limits how many
+						REGISTER requests of the registrations to the same server host and port
+						are sent in each second.  If 0, there is no limit.
+					</para></description>
+				</configOption>
 				<configOption name="outbound_auth" default="">
 					<synopsis>Authentication object to be used for outbound registrations.</synopsis>
 				</configOption>
@@ -222,6 +265,19 @@ AST_THREADSTORAGE(register_callback_invoked);
 /*! \brief Size of the buffer for creating a unique string for the line */
 #define LINE_PARAMETER_SIZE 8
 
+/*! \brief Number of buckets for the server hosts container */
+#define DEFAULT_HOST_BUCKETS 17
+
+/*! \brief Where a registration is in the queue of its server host */
+enum registration_gate_state {
+	/*! \brief Not waiting for a REGISTER to be sent or answered */
+	REGISTRATION_GATE_IDLE = 0,
+	/*! \brief Waiting in the queue of the server host */
+	REGISTRATION_GATE_QUEUED,
+	/*! \brief REGISTER sent and awaiting a final response */
+	REGISTRATION_GATE_IN_FLIGHT,
+};
+
 /*! \brief Various states that an outbound registration may be in */
 enum sip_outbound_registration_status {
 	/*! \brief Currently unregistered */
@@ -299,6 +355,14 @@ struct sip_outbound_registration {
 	unsigned int auth_rejection_permanent;
 	/*! \brief Maximum number of retries permitted */
 	unsigned int max_retries;
+	/*! \brief Largest interval retries back off to, 0 to not back off */
+	unsigned int max_retry_interval;
+	/*! \brief Percentage of the expiration time refreshes are spread over */
+	unsigned int refresh_spread;
+	/*! \brief Most REGISTERs outstanding at once to the server host, 0 for no limit */
+	unsigned int server_max_in_flight;
+	/*! \brief Most REGISTERs sent per second to the server host, 0 for no limit */
+	unsigned int server_max_rate;
 	/*! \brief Whether to add a line parameter to the outbound Contact or not */
 	unsigned int line;
 	/*! \brief Configured authentication credentials */
@@ -307,6 +371,8 @@ struct sip_outbound_registration {
 	unsigned int support_path;
 };
 
+struct registration_host;
+
 /*! \brief Outbound registration client state information (persists for lifetime of regc) */
 struct sip_outbound_registration_client_state {
 	/*! \brief Current state of this registration */
@@ -332,6 +398,10 @@ struct sip_outbound_registration_client_state {
 	unsigned int forbidden_retry_interval;
 	/*! \brief Interval at which retries should occur for all permanent responses */
 	unsigned int fatal_retry_interval;
+	/*! \brief Largest interval retries back off to, 0 to not back off */
+	unsigned int max_retry_interval;
+	/*! \brief Percentage of the expiration time refreshes are spread over */
+	unsigned int refresh_spread;
 	/*! \brief Treat authentication challenges that we cannot handle as permanent failures */
 	unsigned int auth_rejection_permanent;
 	/*! \brief Determines whether SIP Path support should be advertised */
@@ -348,6 +418,43 @@ struct sip_outbound_registration_client_state {
 	unsigned int auth_attempted:1;
 	/*! \brief The name of the transport to be used for the registration */
 	char *transport_name;
+	/*! \brief Server host whose queue REGISTERs are sent through */
+	struct registration_host *host;
+	/*! \brief Where the registration is in the queue, protected by the host lock */
+	enum registration_gate_state gate_state;
+	/*! \brief Next registration in the queue of the host */
+	AST_LIST_ENTRY(sip_outbound_registration_client_state) gate_next;
+};
+
+/*!
+ * \brief REGISTER requests sent to one server host and port
+ *
+ * Timers that are due put their registration at the tail of the queue.
+ * Registrations are taken from the head and their REGISTER sent while the
+ * host is under its limits, and the next ones are taken when a final
+ * response arrives or, when the rate was the limit, a second later.
+ */
+struct registration_host {
+	/*! \brief Registrations waiting for their REGISTER to be sent, holding a reference */
+	AST_LIST_HEAD_NOLOCK(, sip_outbound_registration_client_state) queue;
+	/*! \brief Timer to take from the queue again once the rate allows it */
+	pj_timer_entry timer;
+	/*! \brief Non-zero while the timer is scheduled */
+	unsigned int timer_scheduled;
+	/*! \brief Most REGISTERs outstanding at once, 0 for no limit */
+	unsigned int max_in_flight;
+	/*! \brief Most REGISTERs sent per second, 0 for no limit */
+	unsigned int max_rate;
+	/*! \brief REGISTERs awaiting a final response */
+	unsigned int in_flight;
+	/*! \brief Registrations in the queue */
+	unsigned int queued;
+	/*! \brief REGISTERs sent in the current second */
+	unsigned int sent;
+	/*! \brief The current second */
+	time_t second;
+	/*! \brief Host and port of the server */
+	char name[0];
 };
 
 /*! \brief Outbound registration state information (persists for lifetime that registration should exist) */
@@ -368,6 +475,12 @@ static struct ast_serializer_shutdown_group *shutdown_group;
 #define DEFAULT_STATE_BUCKETS 53
 static AO2_GLOBAL_OBJ_STATIC(current_states);
 
+/*! \brief Server hosts that registrations are sent to, by name */
+static struct ao2_container *registration_hosts;
+
+AO2_STRING_FIELD_HASH_FN(registration_host, name);
+AO2_STRING_FIELD_CMP_FN(registration_host, name);
+
 /*! \brief hashing function for state objects */
 static int registration_state_hash(const void *obj, const int flags)
 {
@@ -493,13 +606,211 @@ static struct ast_sip_endpoint_identifier line_identifier = {
 	.identify_endpoint = line_identify,
 };
 
-/*! \brief Helper function which cancels the timer on a client */
+static int handle_client_registration(void *data);
+
+/*!
+ * \internal
+ * \brief Count a REGISTER as sent if the host is under its limits.
+ *
+ * \note The host must be locked.
+ *
+ * \retval 1 if the REGISTER may be sent now.
+ * \retval 0 if it has to wait.
+ */
+static int registration_host_admit(struct registration_host *host, time_t now)
+{
+	if (host->max_in_flight && host->in_flight >= host->max_in_flight) {
+		return 0;
+	}
+	if (host->max_rate) {
+		if (host->second != now) {
+			host->second = now;
+			host->sent = 0;
+		}
+		if (host->sent >= host->max_rate) {
+			return 0;
+		}
+		++host->sent;
+	}
+	++host->in_flight;
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Send the REGISTERs of as many queued registrations as the host allows.
+ */
+static void registration_host_run(struct registration_host *host)
+{
+	AST_LIST_HEAD_NOLOCK(, sip_outbound_registration_client_state) admitted;
+	struct sip_outbound_registration_client_state *client_state;
+	time_t now = time(NULL);
+
+	AST_LIST_HEAD_INIT_NOLOCK(&admitted);
+
+	ao2_lock(host);
+	while (!AST_LIST_EMPTY(&host->queue) && registration_host_admit(host, now)) {
+		client_state = AST_LIST_REMOVE_HEAD(&host->queue, gate_next);
+		--host->queued;
+		client_state->gate_state = REGISTRATION_GATE_IN_FLIGHT;
+		AST_LIST_INSERT_TAIL(&admitted, client_state, gate_next);
+	}
+	if (!AST_LIST_EMPTY(&host->queue) && host->max_rate && host->sent >= host->max_rate
+		&& !host->timer_scheduled) {
+		pj_time_val delay = { .sec = 1, };
+
+		ao2_ref(host, +1);
+		if (pjsip_endpt_schedule_timer(ast_sip_get_pjsip_endpoint(), &host->timer, &delay) == PJ_SUCCESS) {
+			host->timer_scheduled = 1;
+		} else {
+			ast_log(LOG_WARNING, "Failed to schedule queued registrations to server '%s'\n",
+				host->name);
+			ao2_ref(host, -1);
+		}
+	}
+	ao2_unlock(host);
+
+	while ((client_state = AST_LIST_REMOVE_HEAD(&admitted, gate_next))) {
+		/* The reference held by the queue is transferred to the task. */
+		if (ast_sip_push_task(client_state->serializer, handle_client_registration, client_state)) {
+			ast_log(LOG_WARNING, "Scheduled outbound registration could not be executed.\n");
+			ao2_lock(host);
+			client_state->gate_state = REGISTRATION_GATE_IDLE;
+			--host->in_flight;
+			ao2_unlock(host);
+			ao2_ref(client_state, -1);
+		}
+	}
+}
+
+/*! \brief Timer callback function, used to take from a host queue once the rate allows it */
+static void registration_host_timer_cb(pj_timer_heap_t *timer_heap, struct pj_timer_entry *entry)
+{
+	struct registration_host *host = entry->user_data;
+
+	ao2_lock(host);
+	host->timer_scheduled = 0;
+	ao2_unlock(host);
+
+	registration_host_run(host);
+	ao2_ref(host, -1);
+}
+
+/*! \brief Destructor function for server hosts */
+static void registration_host_destroy(void *obj)
+{
+	struct registration_host *host = obj;
+
+	/* The queue holds references to its registrations, so it is empty here. */
+	ast_assert(AST_LIST_EMPTY(&host->queue));
+}
+
+/*!
+ * \internal
+ * \brief Find or create the server host of the given name.
+ *
+ * \return The host with a reference, NULL on failure.
+ */
+static struct registration_host *registration_host_get(const char *name)
+{
+	struct registration_host *host;
+
+	ao2_lock(registration_hosts);
+	host = ao2_find(registration_hosts, name, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!host) {
+		host = ao2_alloc(sizeof(*host) + strlen(name) + 1, registration_host_destroy);
+		if (host) {
+			strcpy(host->name, name); /* Safe */
+			AST_LIST_HEAD_INIT_NOLOCK(&host->queue);
+			pj_timer_entry_init(&host->timer, 0, host, registration_host_timer_cb);
+			ao2_link_flags(registration_hosts, host, OBJ_NOLOCK);
+		}
+	}
+	ao2_unlock(registration_hosts);
+
+	return host;
+}
+
+/*!
+ * \internal
+ * \brief Queue a registration whose timer is due to have its REGISTER sent.
+ *
+ * The reference of the timer is transferred to the queue.
+ */
+static void registration_gate_enter(struct sip_outbound_registration_client_state *client_state)
+{
+	struct registration_host *host = client_state->host;
+
+	ao2_lock(host);
+	if (client_state->gate_state != REGISTRATION_GATE_IDLE) {
+		/* A REGISTER is already waiting or outstanding. */
+		ao2_unlock(host);
+		ao2_ref(client_state, -1);
+		return;
+	}
+	client_state->gate_state = REGISTRATION_GATE_QUEUED;
+	AST_LIST_INSERT_TAIL(&host->queue, client_state, gate_next);
+	++host->queued;
+	ao2_unlock(host);
+
+	registration_host_run(host);
+}
+
+/*!
+ * \internal
+ * \brief Let the next queued registration through once a REGISTER is done with.
+ *
+ * Does nothing if the registration did not have a REGISTER outstanding
+ * through the queue, such as for an unregistration.
+ */
+static void registration_gate_leave(struct sip_outbound_registration_client_state *client_state)
+{
+	struct registration_host *host = client_state->host;
+
+	if (!host) {
+		return;
+	}
+
+	ao2_lock(host);
+	if (client_state->gate_state != REGISTRATION_GATE_IN_FLIGHT) {
+		ao2_unlock(host);
+		return;
+	}
+	client_state->gate_state = REGISTRATION_GATE_IDLE;
+	--host->in_flight;
+	ao2_unlock(host);
+
+	registration_host_run(host);
+}
+
+/*! \brief Helper function which cancels the timer on a client, and takes it out of the queue */
 static void cancel_registration(struct sip_outbound_registration_client_state *client_state)
 {
+	struct registration_host *host = client_state->host;
+	int dequeued = 0;
+
 	if (pj_timer_heap_cancel(pjsip_endpt_get_timer_heap(ast_sip_get_pjsip_endpoint()), &client_state->timer)) {
 		/* The timer was successfully cancelled, drop the refcount of client_state */
 		ao2_ref(client_state, -1);
 	}
+
+	if (!host) {
+		return;
+	}
+
+	ao2_lock(host);
+	if (client_state->gate_state == REGISTRATION_GATE_QUEUED) {
+		AST_LIST_REMOVE(&host->queue, client_state, gate_next);
+		--host->queued;
+		client_state->gate_state = REGISTRATION_GATE_IDLE;
+		dequeued = 1;
+	}
+	ao2_unlock(host);
+
+	if (dequeued) {
+		/* Drop the reference held by the queue */
+		ao2_ref(client_state, -1);
+	}
 }
 
 static pj_str_t PATH_NAME = { "path", 4 };
@@ -551,6 +862,7 @@ static int handle_client_registration(void *data)
 
 	if (client_state->status == SIP_REGISTRATION_STOPPED
 		|| pjsip_regc_register(client_state->client, PJ_FALSE, &tdata) != PJ_SUCCESS) {
+		registration_gate_leave(client_state);
 		return 0;
 	}
 
@@ -569,6 +881,7 @@ static int handle_client_registration(void *data)
 			hdr = pjsip_supported_hdr_create(tdata->pool);
 			if (!hdr) {
 				pjsip_tx_data_dec_ref(tdata);
+				registration_gate_leave(client_state);
 				return -1;
 			}
 
@@ -579,7 +892,13 @@ static int handle_client_registration(void *data)
 		pj_strassign(&hdr->values[hdr->count++], &PATH_NAME);
 	}
 
-	registration_client_send(client_state, tdata);
+	if (registration_client_send(client_state, tdata) != PJ_SUCCESS) {
+		/*
+		 * Any response callback made for the failure is handled after
+		 * this, and finds the registration already out of the queue.
+		 */
+		registration_gate_leave(client_state);
+	}
 
 	return 0;
 }
@@ -592,14 +911,11 @@ static void sip_outbound_registration_timer_cb(pj_timer_heap_t *timer_heap, stru
 	entry->id = 0;
 
 	/*
-	 * Transfer client_state reference to serializer task so the
-	 * nominal path will not dec the client_state ref in this
-	 * pjproject callback thread.
+	 * Transfer client_state reference to the queue of the server host,
+	 * and from there to the serializer task, so the nominal path will
+	 * not dec the client_state ref in this pjproject callback thread.
 	 */
-	if (ast_sip_push_task(client_state->serializer, handle_client_registration, client_state)) {
-		ast_log(LOG_WARNING, "Scheduled outbound registration could not be executed.\n");
-		ao2_ref(client_state, -1);
-	}
+	registration_gate_enter(client_state);
 }
 
 /*! \brief Helper function which sets up the timer to re-register in a specific amount of time */
@@ -764,6 +1080,38 @@ static int sip_outbound_registration_is_temporal(unsigned int code,
 	}
 }
 
+/*!
+ * \internal
+ * \brief Back off the interval before a retry.
+ *
+ * The interval doubles for each retry made before this one, up to
+ * max_retry_interval, and a random point in its upper half is used.
+ *
+ * \param client_state Registration being retried, with retries already counted.
+ * \param interval Configured interval of the retry.
+ *
+ * \return Seconds to wait before the retry.
+ */
+static unsigned int retry_interval_backoff(struct sip_outbound_registration_client_state *client_state,
+	unsigned int interval)
+{
+	unsigned int max = client_state->max_retry_interval;
+	unsigned int retries;
+
+	if (!max) {
+		return interval;
+	}
+
+	for (retries = client_state->retries; retries > 1 && interval < max; --retries) {
+		interval = interval > max / 2 ? max : interval * 2;
+	}
+	if (interval > max) {
+		interval = max;
+	}
+
+	return interval / 2 + ast_random() % (interval - interval / 2 + 1);
+}
+
 static void schedule_retry(struct registration_response *response, unsigned int interval,
 			   const char *server_uri, const char *client_uri)
 {
@@ -790,6 +1138,7 @@ static int handle_registration_response(void *data)
 	char client_uri[PJSIP_MAX_URL_SIZE];
 
 	if (response->client_state->status == SIP_REGISTRATION_STOPPED) {
+		registration_gate_leave(response->client_state);
 		ao2_ref(response, -1);
 		return 0;
 	}
@@ -834,6 +1183,9 @@ static int handle_registration_response(void *data)
 
 	response->client_state->auth_attempted = 0;
 
+	/* The REGISTER is done with, let the next one to the server through. */
+	registration_gate_leave(response->client_state);
+
 	if (PJSIP_IS_STATUS_IN_CLASS(response->code, 200)) {
 		/* Check if this is in regards to registering or unregistering */
 		if (response->expiration) {
@@ -847,6 +1199,12 @@ static int handle_registration_response(void *data)
 			if (next_registration_round < 0) {
 				/* Re-register immediately. */
 				next_registration_round = 0;
+			} else if (response->client_state->refresh_spread) {
+				/* Re-register at a random point in the last part of the interval. */
+				int spread = (long long) next_registration_round
+					* response->client_state->refresh_spread / 100;
+
+				next_registration_round -= ast_random() % (spread + 1);
 			}
 			schedule_registration(response->client_state, next_registration_round);
 		} else {
@@ -868,26 +1226,36 @@ static int handle_registration_response(void *data)
 		} else {
 			/* On the other hand if we can still try some more do so */
 			response->client_state->retries++;
-			schedule_retry(response, response->client_state->retry_interval, server_uri, client_uri);
+			schedule_retry(response,
+				retry_interval_backoff(response->client_state, response->client_state->retry_interval),
+				server_uri, client_uri);
 		}
 	} else {
 		if (response->code == 403
 			&& response->client_state->forbidden_retry_interval
 			&& response->client_state->retries < response->client_state->max_retries) {
 			/* A forbidden response retry interval is configured and there are retries remaining */
+			unsigned int interval;
+
 			update_client_state_status(response->client_state, SIP_REGISTRATION_REJECTED_TEMPORARY);
 			response->client_state->retries++;
-			schedule_registration(response->client_state, response->client_state->forbidden_retry_interval);
+			interval = retry_interval_backoff(response->client_state,
+				response->client_state->forbidden_retry_interval);
+			schedule_registration(response->client_state, interval);
 			ast_log(LOG_WARNING, "403 Forbidden fatal response received from '%s' on registration attempt to '%s', retrying in '%u' seconds\n",
-				server_uri, client_uri, response->client_state->forbidden_retry_interval);
+				server_uri, client_uri, interval);
 		} else if (response->client_state->fatal_retry_interval
 			   && response->client_state->retries < response->client_state->max_retries) {
 			/* Some kind of fatal failure response received, so retry according to configured interval */
+			unsigned int interval;
+
 			update_client_state_status(response->client_state, SIP_REGISTRATION_REJECTED_TEMPORARY);
 			response->client_state->retries++;
-			schedule_registration(response->client_state, response->client_state->fatal_retry_interval);
+			interval = retry_interval_backoff(response->client_state,
+				response->client_state->fatal_retry_interval);
+			schedule_registration(response->client_state, interval);
 			ast_log(LOG_WARNING, "'%d' fatal response received from '%s' on registration attempt to '%s', retrying in '%u' seconds\n",
-				response->code, server_uri, client_uri, response->client_state->fatal_retry_interval);
+				response->code, server_uri, client_uri, interval);
 		} else {
 			/* Finally if there's no hope of registering give up */
 			update_client_state_status(response->client_state, SIP_REGISTRATION_REJECTED_PERMANENT);
@@ -994,6 +1362,7 @@ static void sip_outbound_registration_client_state_destroy(void *obj)
 	struct sip_outbound_registration_client_state *client_state = obj;
 
 	ast_free(client_state->transport_name);
+	ao2_cleanup(client_state->host);
 	ast_statsd_log_string("PJSIP.registrations.count", AST_STATSD_GAUGE, "-1", 1.0);
 	ast_statsd_log_string_va("PJSIP.registrations.state.%s", AST_STATSD_GAUGE, "-1", 1.0,
 		sip_outbound_registration_status_str(client_state->status));
@@ -1172,6 +1541,7 @@ static int sip_outbound_registration_regc_alloc(void *data)
 	pjsip_uri *uri;
 	pj_str_t server_uri, client_uri, contact_uri;
 	pjsip_tpselector selector = { .type = PJSIP_TPSELECTOR_NONE, };
+	char host_name[PJSIP_MAX_URL_SIZE];
 
 	pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "URI Validation", 256, 256);
 	if (!pool) {
@@ -1189,6 +1559,19 @@ static int sip_outbound_registration_regc_alloc(void *data)
 		return -1;
 	}
 
+	if (PJSIP_URI_SCHEME_IS_SIP(uri) || PJSIP_URI_SCHEME_IS_SIPS(uri)) {
+		pjsip_sip_uri *sip_uri = pjsip_uri_get_uri(uri);
+
+		if (sip_uri->port) {
+			snprintf(host_name, sizeof(host_name), "%.*s:%d",
+				(int) sip_uri->host.slen, sip_uri->host.ptr, sip_uri->port);
+		} else {
+			ast_copy_pj_str(host_name, &sip_uri->host, sizeof(host_name));
+		}
+	} else {
+		ast_copy_string(host_name, registration->server_uri, sizeof(host_name));
+	}
+
 	pj_strdup2_with_null(pool, &tmp, registration->client_uri);
 	uri = pjsip_parse_uri(pool, tmp.ptr, tmp.slen, 0);
 	if (!uri) {
@@ -1200,6 +1583,11 @@ static int sip_outbound_registration_regc_alloc(void *data)
 
 	pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), pool);
 
+	ast_assert(state->client_state->host == NULL);
+	state->client_state->host = registration_host_get(host_name);
+	if (!state->client_state->host) {
+		return -1;
+	}
 
 	ast_assert(state->client_state->client == NULL);
 	if (pjsip_regc_create(ast_sip_get_pjsip_endpoint(), state->client_state,
@@ -1274,12 +1662,19 @@ static int sip_outbound_registration_perform(void *data)
 	state->client_state->forbidden_retry_interval = registration->forbidden_retry_interval;
 	state->client_state->fatal_retry_interval = registration->fatal_retry_interval;
 	state->client_state->max_retries = registration->max_retries;
+	state->client_state->max_retry_interval = registration->max_retry_interval;
+	state->client_state->refresh_spread = registration->refresh_spread;
 	state->client_state->retries = 0;
 	state->client_state->support_path = registration->support_path;
 	state->client_state->auth_rejection_permanent = registration->auth_rejection_permanent;
 
 	pjsip_regc_update_expires(state->client_state->client, registration->expiration);
 
+	ao2_lock(state->client_state->host);
+	state->client_state->host->max_in_flight = registration->server_max_in_flight;
+	state->client_state->host->max_rate = registration->server_max_rate;
+	ao2_unlock(state->client_state->host);
+
 	schedule_registration(state->client_state, (ast_random() % 10) + 1);
 
 	ao2_ref(registration, -1);
@@ -1807,7 +2202,40 @@ static int cli_print_body(void *obj, void *arg, int flags)
  */
 static char *my_cli_traverse_objects(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
-	return ast_sip_cli_traverse_objects(e, cmd, a);
+	char *res = ast_sip_cli_traverse_objects(e, cmd, a);
+	struct ao2_iterator iter;
+	struct registration_host *host;
+
+	if (cmd == CLI_INIT || cmd == CLI_GENERATE || res != CLI_SUCCESS
+		|| strcmp(e->command, "pjsip show registrations")
+		|| !registration_hosts || !ao2_container_count(registration_hosts)) {
+		return res;
+	}
+
+	/* Show the queue of each server host after the registrations. */
+	ast_cli(a->fd, "\n %-53.53s  %8s  %8s  %11s  %8s\n",
+		"<Server Host.......................................>",
+		"InFlight", "Queued", "MaxInFlight", "MaxRate");
+	iter = ao2_iterator_init(registration_hosts, 0);
+	for (; (host = ao2_iterator_next(&iter)); ao2_ref(host, -1)) {
+		unsigned int in_flight;
+		unsigned int queued;
+		unsigned int max_in_flight;
+		unsigned int max_rate;
+
+		ao2_lock(host);
+		in_flight = host->in_flight;
+		queued = host->queued;
+		max_in_flight = host->max_in_flight;
+		max_rate = host->max_rate;
+		ao2_unlock(host);
+
+		ast_cli(a->fd, " %-53.53s  %8u  %8u  %11u  %8u\n",
+			host->name, in_flight, queued, max_in_flight, max_rate);
+	}
+	ao2_iterator_destroy(&iter);
+
+	return res;
 }
 
 static struct ast_cli_entry cli_outbound_registration[] = {
@@ -1821,7 +2249,8 @@ static struct ast_cli_entry cli_outbound_registration[] = {
 	AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Registrations",
 		.command = "pjsip show registrations",
 		.usage = "Usage: pjsip show registrations [ like <pattern> ]\n"
-				"       Show the configured PJSIP Registrations\n"
+				"       Show the configured PJSIP Registrations, followed by how many\n"
+				"       REGISTERs to each server host are outstanding and queued.\n"
 				"       Optional regular expression pattern is used to filter the list.\n"),
 	AST_CLI_DEFINE(my_cli_traverse_objects, "Show PJSIP Registration",
 		.command = "pjsip show registration",
@@ -1949,6 +2378,21 @@ static const struct ast_sorcery_observer registration_observer = {
 	.deleted = registration_deleted_observer,
 };
 
+/*! \brief Callback function to cancel the timer of a server host */
+static int registration_host_cancel_timer(void *obj, void *arg, int flags)
+{
+	struct registration_host *host = obj;
+
+	if (pj_timer_heap_cancel(pjsip_endpt_get_timer_heap(ast_sip_get_pjsip_endpoint()), &host->timer)) {
+		ao2_lock(host);
+		host->timer_scheduled = 0;
+		ao2_unlock(host);
+		ao2_ref(host, -1);
+	}
+
+	return 0;
+}
+
 static int unload_module(void)
 {
 	int remaining;
@@ -1989,6 +2433,12 @@ static int unload_module(void)
 	ao2_cleanup(shutdown_group);
 	shutdown_group = NULL;
 
+	if (registration_hosts) {
+		ao2_callback(registration_hosts, OBJ_NODATA, registration_host_cancel_timer, NULL);
+		ao2_ref(registration_hosts, -1);
+		registration_hosts = NULL;
+	}
+
 	return 0;
 }
 
@@ -2014,6 +2464,14 @@ static int load_module(void)
 	ao2_global_obj_replace_unref(current_states, new_states);
 	ao2_ref(new_states, -1);
 
+	registration_hosts = ao2_container_alloc(DEFAULT_HOST_BUCKETS,
+		registration_host_hash_fn, registration_host_cmp_fn);
+	if (!registration_hosts) {
+		ast_log(LOG_ERROR, "Unable to allocate registration server hosts container\n");
+		unload_module();
+		return AST_MODULE_LOAD_FAILURE;
+	}
+
 	/*
 	 * Register sorcery object descriptions.
 	 */
@@ -2036,6 +2494,10 @@ static int load_module(void)
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "forbidden_retry_interval", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, forbidden_retry_interval));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "fatal_retry_interval", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, fatal_retry_interval));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "max_retries", "10", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, max_retries));
+	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "max_retry_interval", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, max_retry_interval));
+	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "refresh_spread", "0", OPT_UINT_T, PARSE_IN_RANGE, FLDSET(struct sip_outbound_registration, refresh_spread), 0, 100);
+	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "server_max_in_flight", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, server_max_in_flight));
+	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "server_max_rate", "0", OPT_UINT_T, 0, FLDSET(struct sip_outbound_registration, server_max_rate));
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "auth_rejection_permanent", "yes", OPT_BOOL_T, 1, FLDSET(struct sip_outbound_registration, auth_rejection_permanent));
 	ast_sorcery_object_field_register_custom(ast_sip_get_sorcery(), "registration", "outbound_auth", "", outbound_auth_handler, outbound_auths_to_str, outbound_auths_to_var_list, 0, 0);
 	ast_sorcery_object_field_register(ast_sip_get_sorcery(), "registration", "support_path", "no", OPT_BOOL_T, 1, FLDSET(struct sip_outbound_registration, support_path));
@@ -41,6 +41,7 @@
 #include "asterisk/sched.h"
 #include "asterisk/res_pjsip.h"
 #include "asterisk/callerid.h"
+#include "asterisk/cli.h"
 #include "asterisk/manager.h"
 #include "asterisk/test.h"
 #include "res_pjsip/include/res_pjsip_private.h"
@@ -1346,9 +1347,48 @@ static int send_notify(struct sip_subscription_tree *sub_tree, unsigned int forc
 /*! Persistent subscription recreation continuation under distributor serializer data */
 struct persistence_recreate_data {
 	struct subscription_persistence *persistence;
-	pjsip_rx_data *rdata;
+	/*! Distributor serializer the subscription is recreated on */
+	struct ast_taskprocessor *serializer;
+	/*! Pool the fake request was parsed into */
+	pj_pool_t *pool;
+	pjsip_rx_data rdata;
 };
 
+/*! Milliseconds between the batches of persisted subscriptions recreated */
+#define RECREATE_INTERVAL 100
+
+/*!
+ * Tasks a distributor serializer may have waiting before recreation stops
+ * handing it subscriptions, so requests arriving meanwhile are not held up.
+ */
+#define RECREATE_QUEUE_HIGH 8
+
+/*! \brief Progress of recreating the persisted subscriptions at startup */
+static struct {
+	/*! The persisted subscriptions, while they are being recreated */
+	struct ao2_container *persisted;
+	/*! Position in persisted */
+	struct ao2_iterator iter;
+	/*! Next subscription, held back while its serializer is busy */
+	struct persistence_recreate_data *pending;
+	/*! Subscriptions earned by the rate times 1000 */
+	unsigned int credit;
+	/*! Subscriptions persisted */
+	unsigned int total;
+	/*! Subscriptions dropped unrecreated as they or their endpoint registration expired */
+	unsigned int skipped;
+	/*! Subscriptions that could not be recreated */
+	int failed;
+	/*! Subscriptions recreated */
+	int recreated;
+	/*! When recreation started */
+	struct timeval started;
+	/*! When the last subscription was handed to a serializer */
+	struct timeval finished;
+} recreate;
+
+AST_MUTEX_DEFINE_STATIC(recreate_lock);
+
 /*!
  * \internal
  * \brief subscription_persistence_recreate continuation under distributor serializer.
@@ -1357,11 +1397,8 @@ struct persistence_recreate_data {
  * \retval 0 on success.
  * \retval -1 on error.
  */
-static int sub_persistence_recreate(void *obj)
+static int sub_persistence_recreate(struct subscription_persistence *persistence, pjsip_rx_data *rdata)
 {
-	struct persistence_recreate_data *recreate_data = obj;
-	struct subscription_persistence *persistence = recreate_data->persistence;
-	pjsip_rx_data *rdata = recreate_data->rdata;
 	struct ast_sip_endpoint *endpoint;
 	struct sip_subscription_tree *sub_tree;
 	struct ast_sip_pubsub_body_generator *generator;
@@ -1372,6 +1409,7 @@ static int sub_persistence_recreate(void *obj)
 	int resp;
 	struct resource_tree tree;
 	pjsip_expires_hdr *expires_header;
+	int res = 0;
 
 	request_uri = pjsip_uri_get_uri(rdata->msg_info.msg->line.req.uri);
 	resource_size = pj_strlen(&request_uri->user) + 1;
@@ -1389,7 +1427,7 @@ static int sub_persistence_recreate(void *obj)
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not get subscription handler.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		return 0;
+		return -1;
 	}
 
 	generator = subscription_get_generator_from_rdata(rdata, handler);
@@ -1397,7 +1435,7 @@ static int sub_persistence_recreate(void *obj)
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Body generator not available.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		return 0;
+		return -1;
 	}
 
 	ast_sip_mod_data_set(rdata->tp_info.pool, rdata->endpt_info.mod_data,
@@ -1410,8 +1448,7 @@ static int sub_persistence_recreate(void *obj)
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: The endpoint was not found\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		ao2_ref(endpoint, -1);
-		return 0;
+		return -1;
 	}
 
 	/* Update the expiration header with the new expiration */
@@ -1424,7 +1461,7 @@ static int sub_persistence_recreate(void *obj)
 				persistence->endpoint);
 			ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
 			ao2_ref(endpoint, -1);
-			return 0;
+			return -1;
 		}
 		pjsip_msg_add_hdr(rdata->msg_info.msg, (pjsip_hdr *) expires_header);
 	}
@@ -1433,7 +1470,7 @@ static int sub_persistence_recreate(void *obj)
 		/* The subscription expired since we started recreating the subscription. */
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
 		ao2_ref(endpoint, -1);
-		return 0;
+		return -1;
 	}
 
 	memset(&tree, 0, sizeof(tree));
@@ -1449,6 +1486,7 @@ static int sub_persistence_recreate(void *obj)
 				ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not create subscription tree.\n",
 					persistence->endpoint);
 				ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+				res = -1;
 			}
 		} else {
 			sub_tree->persistence = ao2_bump(persistence);
@@ -1462,63 +1500,228 @@ static int sub_persistence_recreate(void *obj)
 		}
 	} else {
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		res = -1;
 	}
 	resource_tree_destroy(&tree);
 	ao2_ref(endpoint, -1);
 
+	return res;
+}
+
+static void persistence_recreate_data_free(struct persistence_recreate_data *recreate_data)
+{
+	ast_taskprocessor_unreference(recreate_data->serializer);
+	if (recreate_data->pool) {
+		pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), recreate_data->pool);
+	}
+	ao2_cleanup(recreate_data->persistence);
+	ast_free(recreate_data);
+}
+
+/*! \brief Task recreating a subscription under its distributor serializer */
+static int sub_persistence_recreate_task(void *obj)
+{
+	struct persistence_recreate_data *recreate_data = obj;
+
+	if (sub_persistence_recreate(recreate_data->persistence, &recreate_data->rdata)) {
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+	} else {
+		ast_atomic_fetchadd_int(&recreate.recreated, +1);
+	}
+	persistence_recreate_data_free(recreate_data);
+
 	return 0;
 }
 
-/*! \brief Callback function to perform the actual recreation of a subscription */
-static int subscription_persistence_recreate(void *obj, void *arg, int flags)
+/*!
+ * \internal
+ * \brief Parse a persisted subscription and find the serializer to recreate it on.
+ *
+ * Subscriptions that expired, or whose endpoint has no contact left because
+ * its registration expired, are deleted without parsing them.
+ *
+ * \note Called with recreate_lock held.
+ *
+ * \return The subscription ready to recreate
+ * \retval NULL if it is not to be recreated
+ */
+static struct persistence_recreate_data *subscription_persistence_prepare(
+	struct subscription_persistence *persistence)
 {
-	struct subscription_persistence *persistence = obj;
-	pj_pool_t *pool = arg;
-	struct ast_taskprocessor *serializer;
-	pjsip_rx_data rdata;
-	struct persistence_recreate_data recreate_data;
+	struct persistence_recreate_data *recreate_data;
+	struct ast_sip_endpoint *endpoint;
+	struct ast_sip_contact *contact = NULL;
 
 	/* If this subscription has already expired remove it */
 	if (ast_tvdiff_ms(persistence->expires, ast_tvnow()) <= 0) {
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		return 0;
+		++recreate.skipped;
+		return NULL;
+	}
+
+	endpoint = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "endpoint",
+		persistence->endpoint);
+	if (!endpoint) {
+		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: The endpoint was not found\n",
+			persistence->endpoint);
+		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
+	}
+	if (!ast_strlen_zero(endpoint->aors)) {
+		contact = ast_sip_location_retrieve_contact_from_aor_list(endpoint->aors);
+		if (!contact) {
+			/* The subscriber will subscribe again when it registers. */
+			ast_debug(3, "Not recreating '%s' subscription: The endpoint has no contact\n",
+				persistence->endpoint);
+			ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+			ao2_ref(endpoint, -1);
+			++recreate.skipped;
+			return NULL;
+		}
+		ao2_ref(contact, -1);
+	}
+	ao2_ref(endpoint, -1);
+
+	recreate_data = ast_calloc(1, sizeof(*recreate_data));
+	if (!recreate_data) {
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
 	}
+	recreate_data->persistence = ao2_bump(persistence);
 
-	memset(&rdata, 0, sizeof(rdata));
-	pj_pool_reset(pool);
-	rdata.tp_info.pool = pool;
+	recreate_data->pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "rtd%p",
+		PJSIP_POOL_RDATA_LEN, PJSIP_POOL_RDATA_INC);
+	if (!recreate_data->pool) {
+		ast_log(LOG_WARNING, "Could not create a memory pool for recreating SIP subscriptions\n");
+		persistence_recreate_data_free(recreate_data);
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
+	}
+	recreate_data->rdata.tp_info.pool = recreate_data->pool;
 
-	if (ast_sip_create_rdata(&rdata, persistence->packet, persistence->src_name, persistence->src_port,
-		persistence->transport_key, persistence->local_name, persistence->local_port)) {
+	if (ast_sip_create_rdata(&recreate_data->rdata, persistence->packet, persistence->src_name,
+		persistence->src_port, persistence->transport_key, persistence->local_name,
+		persistence->local_port)) {
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: The message could not be parsed\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		return 0;
+		persistence_recreate_data_free(recreate_data);
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
 	}
 
-	if (rdata.msg_info.msg->type != PJSIP_REQUEST_MSG) {
+	if (recreate_data->rdata.msg_info.msg->type != PJSIP_REQUEST_MSG) {
 		ast_log(LOG_NOTICE, "Failed recreating '%s' subscription: Stored a SIP response instead of a request.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
-		return 0;
+		persistence_recreate_data_free(recreate_data);
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
 	}
 
 	/* Continue the remainder in the distributor serializer */
-	serializer = ast_sip_get_distributor_serializer(&rdata);
-	if (!serializer) {
+	recreate_data->serializer = ast_sip_get_distributor_serializer(&recreate_data->rdata);
+	if (!recreate_data->serializer) {
 		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not get distributor serializer.\n",
 			persistence->endpoint);
 		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+		persistence_recreate_data_free(recreate_data);
+		ast_atomic_fetchadd_int(&recreate.failed, +1);
+		return NULL;
+	}
+
+	return recreate_data;
+}
+
+/*!
+ * \internal
+ * \brief Stop recreating persisted subscriptions and drop the ones left.
+ *
+ * \note Called with recreate_lock held.
+ */
+static void subscription_persistence_recreate_done(void)
+{
+	if (!recreate.persisted) {
+		return;
+	}
+
+	if (recreate.pending) {
+		persistence_recreate_data_free(recreate.pending);
+		recreate.pending = NULL;
+	}
+	ao2_iterator_destroy(&recreate.iter);
+	ao2_ref(recreate.persisted, -1);
+	recreate.persisted = NULL;
+	recreate.finished = ast_tvnow();
+}
+
+static int subscription_persistence_recreate_batch(void *data);
+
+/*! \brief Scheduler callback pushing the next batch of recreations to a SIP thread */
+static int subscription_persistence_recreate_sched(const void *data)
+{
+	if (ast_sip_push_task(NULL, subscription_persistence_recreate_batch, NULL)) {
+		return RECREATE_INTERVAL;
+	}
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Hand the next batch of persisted subscriptions to the distributor serializers.
+ *
+ * Hands out as many as subscription_recreate_rate allows for the interval.
+ * The batch ends early at a serializer with requests waiting, and the
+ * subscription for it is held back for the next batch.
+ */
+static int subscription_persistence_recreate_batch(void *data)
+{
+	struct subscription_persistence *persistence;
+	struct persistence_recreate_data *recreate_data;
+	unsigned int rate = ast_sip_get_subscription_recreate_rate();
+
+	ast_mutex_lock(&recreate_lock);
+	if (!recreate.persisted) {
+		ast_mutex_unlock(&recreate_lock);
 		return 0;
 	}
-	recreate_data.persistence = persistence;
-	recreate_data.rdata = &rdata;
-	if (ast_sip_push_task_synchronous(serializer, sub_persistence_recreate, &recreate_data)) {
-		ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not continue under distributor serializer.\n",
-			persistence->endpoint);
-		ast_sorcery_delete(ast_sip_get_sorcery(), persistence);
+
+	/* A second's worth of credit at most, so a busy spell is not made up in a burst. */
+	recreate.credit = MIN(recreate.credit + rate * RECREATE_INTERVAL, rate * 1000);
+	while (!rate || recreate.credit >= 1000) {
+		recreate_data = recreate.pending;
+		recreate.pending = NULL;
+		while (!recreate_data && (persistence = ao2_iterator_next(&recreate.iter))) {
+			recreate_data = subscription_persistence_prepare(persistence);
+			ao2_ref(persistence, -1);
+		}
+		if (!recreate_data) {
+			subscription_persistence_recreate_done();
+			ast_mutex_unlock(&recreate_lock);
+			return 0;
+		}
+
+		if (ast_taskprocessor_size(recreate_data->serializer) >= RECREATE_QUEUE_HIGH) {
+			recreate.pending = recreate_data;
+			break;
+		}
+
+		recreate.credit -= rate ? 1000 : 0;
+		if (ast_sip_push_task(recreate_data->serializer, sub_persistence_recreate_task, recreate_data)) {
+			ast_log(LOG_WARNING, "Failed recreating '%s' subscription: Could not continue under distributor serializer.\n",
+				recreate_data->persistence->endpoint);
+			ast_sorcery_delete(ast_sip_get_sorcery(), recreate_data->persistence);
+			persistence_recreate_data_free(recreate_data);
+			ast_atomic_fetchadd_int(&recreate.failed, +1);
+		}
+	}
+
+	if (ast_sched_add(sched, RECREATE_INTERVAL, subscription_persistence_recreate_sched, NULL) < 0) {
+		ast_log(LOG_WARNING, "Could not schedule recreating the remaining SIP subscriptions\n");
+		subscription_persistence_recreate_done();
 	}
-	ast_taskprocessor_unreference(serializer);
+	ast_mutex_unlock(&recreate_lock);
 
 	return 0;
 }
@@ -1528,21 +1731,30 @@ static int subscription_persistence_load(void *data)
 {
 	struct ao2_container *persisted_subscriptions = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(),
 		"subscription_persistence", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
-	pj_pool_t *pool;
 
-	pool = pjsip_endpt_create_pool(ast_sip_get_pjsip_endpoint(), "rtd%p", PJSIP_POOL_RDATA_LEN,
-		PJSIP_POOL_RDATA_INC);
-	if (!pool) {
-		ast_log(LOG_WARNING, "Could not create a memory pool for recreating SIP subscriptions\n");
+	if (!persisted_subscriptions) {
 		return 0;
 	}
 
-	ao2_callback(persisted_subscriptions, OBJ_NODATA, subscription_persistence_recreate, pool);
-
-	pjsip_endpt_release_pool(ast_sip_get_pjsip_endpoint(), pool);
+	ast_mutex_lock(&recreate_lock);
+	if (recreate.persisted) {
+		/* Already being recreated */
+		ast_mutex_unlock(&recreate_lock);
+		ao2_ref(persisted_subscriptions, -1);
+		return 0;
+	}
+	recreate.persisted = persisted_subscriptions;
+	recreate.iter = ao2_iterator_init(persisted_subscriptions, 0);
+	recreate.total = ao2_container_count(persisted_subscriptions);
+	recreate.credit = 0;
+	recreate.skipped = 0;
+	recreate.failed = 0;
+	recreate.recreated = 0;
+	recreate.started = ast_tvnow();
+	recreate.finished = ast_tv(0, 0);
+	ast_mutex_unlock(&recreate_lock);
 
-	ao2_ref(persisted_subscriptions, -1);
-	return 0;
+	return subscription_persistence_recreate_batch(NULL);
 }
 
 /*! \brief Event callback which fires subscription persistence recreation when the system is fully booted */
@@ -3631,6 +3843,68 @@ static int ami_show_subscriptions_outbound(struct mansession *s, const struct me
 	return 0;
 }
 
+static int count_subscription(struct sip_subscription_tree *sub_tree, void *arg)
+{
+	unsigned int *inbound = arg;
+
+	if (sub_tree->role == AST_SIP_NOTIFIER) {
+		++*inbound;
+	}
+	return 0;
+}
+
+static char *cli_show_subscriptions(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int inbound = 0;
+	int num;
+	int recreated;
+	int failed;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "pjsip show subscriptions";
+		e->usage =
+			"Usage: pjsip show subscriptions\n"
+			"       Shows how many inbound and outbound subscriptions there are,\n"
+			"       and the progress of recreating the persisted subscriptions\n"
+			"       at startup.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	num = for_each_subscription(count_subscription, &inbound);
+	ast_cli(a->fd, "Subscriptions: %u inbound, %u outbound\n", inbound, num - inbound);
+
+	ast_mutex_lock(&recreate_lock);
+	if (ast_tvzero(recreate.started)) {
+		ast_mutex_unlock(&recreate_lock);
+		ast_cli(a->fd, "Persisted subscriptions: Not recreated yet\n");
+		return CLI_SUCCESS;
+	}
+	recreated = ast_atomic_fetchadd_int(&recreate.recreated, 0);
+	failed = ast_atomic_fetchadd_int(&recreate.failed, 0);
+	ast_cli(a->fd, "Persisted subscriptions: %u, %s\n", recreate.total,
+		recreate.persisted ? "recreating" : "all handed out");
+	ast_cli(a->fd, "  Recreated: %d\n", recreated);
+	ast_cli(a->fd, "  Failed:    %d\n", failed);
+	ast_cli(a->fd, "  Skipped:   %u\n", recreate.skipped);
+	ast_cli(a->fd, "  Waiting:   %d\n", (int) recreate.total - recreated - failed - (int) recreate.skipped);
+	ast_cli(a->fd, "  Seconds:   %" PRId64 "\n", ast_tvdiff_sec(
+		recreate.persisted ? ast_tvnow() : recreate.finished, recreate.started));
+	ast_mutex_unlock(&recreate_lock);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_commands[] = {
+	AST_CLI_DEFINE(cli_show_subscriptions, "Show subscription counts and recreation progress"),
+};
+
 static int format_ami_resource_lists(void *obj, void *arg, int flags)
 {
 	struct resource_list *list = obj;
@@ -4619,6 +4893,7 @@ static int load_module(void)
 				 ami_show_subscriptions_outbound);
 	ast_manager_register_xml("PJSIPShowResourceLists", EVENT_FLAG_SYSTEM,
 			ami_show_resource_lists);
+	ast_cli_register_multiple(cli_commands, ARRAY_LEN(cli_commands));
 
 	AST_TEST_REGISTER(resource_tree);
 	AST_TEST_REGISTER(complex_resource_tree);
@@ -4636,12 +4911,17 @@ static int unload_module(void)
 	ast_manager_unregister(AMI_SHOW_SUBSCRIPTIONS_OUTBOUND);
 	ast_manager_unregister(AMI_SHOW_SUBSCRIPTIONS_INBOUND);
 	ast_manager_unregister("PJSIPShowResourceLists");
+	ast_cli_unregister_multiple(cli_commands, ARRAY_LEN(cli_commands));
 
 	ast_sip_unregister_service(&pubsub_module);
 	if (sched) {
 		ast_sched_context_destroy(sched);
 	}
 
+	ast_mutex_lock(&recreate_lock);
+	subscription_persistence_recreate_done();
+	ast_mutex_unlock(&recreate_lock);
+
 	AST_TEST_UNREGISTER(resource_tree);
 	AST_TEST_UNREGISTER(complex_resource_tree);
 	AST_TEST_UNREGISTER(bad_resource);
@@ -468,7 +468,7 @@ static int register_aor_core(pjsip_rx_data *rdata,
 				ast_string_field_set(contact_update, reg_server, ast_config_AST_SYSTEM_NAME);
 			}
 
-			if (ast_sip_location_update_contact(contact_update)) {
+			if (ast_sip_location_refresh_contact(contact_update)) {
 				ast_log(LOG_ERROR, "Failed to update contact '%s' expiration time to %d seconds.\n",
 					contact->uri, expiration);
 				ast_sip_location_delete_contact(contact);
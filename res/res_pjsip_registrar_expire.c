@@ -66,21 +66,13 @@ static int expire_contact(void *obj, void *arg, int flags)
 static void *check_expiration_thread(void *data)
 {
 	struct ao2_container *contacts;
-	struct ast_variable *var;
-	char *time = alloca(64);
 
 	while (check_interval) {
 		sleep(check_interval);
 
-		sprintf(time, "%ld", ast_tvnow().tv_sec);
-		var = ast_variable_new("expiration_time <=", time, "");
+		ast_debug(4, "Woke up at %ld  Interval: %d\n", (long) ast_tvnow().tv_sec, check_interval);
 
-		ast_debug(4, "Woke up at %s  Interval: %d\n", time, check_interval);
-
-		contacts = ast_sorcery_retrieve_by_fields(ast_sip_get_sorcery(), "contact",
-			AST_RETRIEVE_FLAG_MULTIPLE, var);
-
-		ast_variables_destroy(var);
+		contacts = ast_sip_location_retrieve_expired_contacts();
 		if (contacts) {
 			ast_debug(3, "Expiring %d contacts\n", ao2_container_count(contacts));
 			ao2_callback(contacts, OBJ_NODATA, expire_contact, NULL);
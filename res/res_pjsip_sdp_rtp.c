@@ -67,6 +67,49 @@ static const int FD_AUDIO = 0;
 static const char STR_VIDEO[] = "video";
 static const int FD_VIDEO = 2;
 
+/*! \brief Number of buckets in each of the SDP caches */
+#define SDP_CACHE_BUCKETS 61
+
+/*! \brief Most entries kept in each SDP cache, it is emptied when reached */
+#define SDP_CACHE_MAX 1024
+
+/*!
+ * \brief An entry in one of the SDP caches
+ *
+ * Entries are keyed on an ao2 object, two integers and a string.  The
+ * object is referenced so that its address stays unique while the entry
+ * exists.  Entries are immutable once linked.
+ */
+struct sdp_cache_entry {
+	/*! Object the entry was generated for */
+	void *object;
+	int arg1;
+	int arg2;
+	/*! Cached object, referenced */
+	void *result;
+	/*! Cached strings, stored after the key */
+	const char *text[2];
+	/*! Rest of the key */
+	char key[0];
+};
+
+/*! \brief Search key of an SDP cache */
+struct sdp_cache_key {
+	const void *object;
+	int arg1;
+	int arg2;
+	const char *key;
+};
+
+/*! \brief rtpmap and fmtp attribute values of our formats, keyed on format, payload and options */
+static struct ao2_container *sdp_attrs_cache;
+
+/*! \brief Formats with the parameters of a remote fmtp attribute, keyed on format and parameters */
+static struct ao2_container *sdp_fmtp_cache;
+
+/*! \brief Joint capabilities, keyed on endpoint codecs, media type and remote stream fingerprint */
+static struct ao2_container *sdp_joint_cache;
+
 /*! \brief Retrieves an ast_format_type based on the given stream_type */
 static enum ast_media_type stream_to_media_type(const char *stream_type)
 {
@@ -104,6 +147,183 @@ static void format_cap_only_type(struct ast_format_cap *caps, enum ast_media_typ
 	}
 }
 
+static int sdp_cache_hash(const void *obj, const int flags)
+{
+	const struct sdp_cache_entry *entry;
+	const struct sdp_cache_key *key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_KEY:
+		key = obj;
+		return ast_str_hash_add(key->key, (int) (intptr_t) key->object ^ (key->arg1 * 31 + key->arg2));
+	case OBJ_SEARCH_OBJECT:
+		entry = obj;
+		return ast_str_hash_add(entry->key, (int) (intptr_t) entry->object ^ (entry->arg1 * 31 + entry->arg2));
+	default:
+		/* Hash can only work on something with a full key. */
+		ast_assert(0);
+		return 0;
+	}
+}
+
+static int sdp_cache_cmp(void *obj, void *arg, int flags)
+{
+	const struct sdp_cache_entry *left = obj;
+	const struct sdp_cache_entry *right;
+	const struct sdp_cache_key *key;
+	struct sdp_cache_key right_key;
+
+	switch (flags & OBJ_SEARCH_MASK) {
+	case OBJ_SEARCH_OBJECT:
+		right = arg;
+		right_key.object = right->object;
+		right_key.arg1 = right->arg1;
+		right_key.arg2 = right->arg2;
+		right_key.key = right->key;
+		key = &right_key;
+		break;
+	case OBJ_SEARCH_KEY:
+		key = arg;
+		break;
+	default:
+		return 0;
+	}
+
+	return left->object == key->object && left->arg1 == key->arg1 && left->arg2 == key->arg2
+		&& !strcmp(left->key, key->key) ? CMP_MATCH : 0;
+}
+
+static void sdp_cache_entry_destroy(void *obj)
+{
+	struct sdp_cache_entry *entry = obj;
+
+	ao2_cleanup(entry->object);
+	ao2_cleanup(entry->result);
+}
+
+/*!
+ * \internal
+ * \brief Find an entry in an SDP cache
+ *
+ * \return The entry, which must be unreferenced, or NULL if not cached.
+ */
+static struct sdp_cache_entry *sdp_cache_find(struct ao2_container *cache, const void *object,
+	int arg1, int arg2, const char *key)
+{
+	struct sdp_cache_key search = {
+		.object = object,
+		.arg1 = arg1,
+		.arg2 = arg2,
+		.key = key,
+	};
+
+	return cache ? ao2_find(cache, &search, OBJ_SEARCH_KEY) : NULL;
+}
+
+/*!
+ * \internal
+ * \brief Add an entry to an SDP cache
+ *
+ * \param cache The cache to add to
+ * \param object The ao2 object the entry is for
+ * \param arg1 First integer of the key
+ * \param arg2 Second integer of the key
+ * \param key String of the key
+ * \param result The ao2 object to cache, or NULL
+ * \param text0 The first string to cache, or NULL
+ * \param text1 The second string to cache, or NULL
+ */
+static void sdp_cache_add(struct ao2_container *cache, void *object, int arg1, int arg2,
+	const char *key, void *result, const char *text0, const char *text1)
+{
+	size_t key_len = strlen(key) + 1;
+	size_t text0_len = text0 ? strlen(text0) + 1 : 0;
+	size_t text1_len = text1 ? strlen(text1) + 1 : 0;
+	struct sdp_cache_entry *entry;
+
+	if (!cache) {
+		return;
+	}
+
+	entry = ao2_alloc_options(sizeof(*entry) + key_len + text0_len + text1_len,
+		sdp_cache_entry_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return;
+	}
+	entry->object = ao2_bump(object);
+	entry->arg1 = arg1;
+	entry->arg2 = arg2;
+	entry->result = ao2_bump(result);
+	memcpy(entry->key, key, key_len);
+	if (text0) {
+		entry->text[0] = memcpy(entry->key + key_len, text0, text0_len);
+	}
+	if (text1) {
+		entry->text[1] = memcpy(entry->key + key_len + text0_len, text1, text1_len);
+	}
+
+	ao2_lock(cache);
+	if (ao2_container_count(cache) >= SDP_CACHE_MAX) {
+		/* Simpler than aging entries, and only reached with many endpoints or codecs. */
+		ao2_callback(cache, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NODATA | OBJ_NOLOCK, NULL, NULL);
+	}
+	ao2_link_flags(cache, entry, OBJ_NOLOCK);
+	ao2_unlock(cache);
+	ao2_ref(entry, -1);
+}
+
+/*!
+ * \internal
+ * \brief Apply the parameters of a remote fmtp attribute to a format
+ *
+ * The formats are cached since the same parameters are offered again and
+ * again.
+ *
+ * \return The format with the parameters applied, which must be
+ * unreferenced, or NULL if they could not be parsed.
+ */
+static struct ast_format *sdp_parse_fmtp(struct ast_format *format, const char *fmt_param)
+{
+	struct sdp_cache_entry *entry;
+	struct ast_format *format_parsed;
+
+	if ((entry = sdp_cache_find(sdp_fmtp_cache, format, 0, 0, fmt_param))) {
+		format_parsed = ao2_bump(entry->result);
+		ao2_ref(entry, -1);
+		return format_parsed;
+	}
+
+	format_parsed = ast_format_parse_sdp_fmtp(format, fmt_param);
+	if (format_parsed) {
+		sdp_cache_add(sdp_fmtp_cache, format, 0, 0, fmt_param, format_parsed, NULL, NULL);
+	}
+
+	return format_parsed;
+}
+
+/*!
+ * \internal
+ * \brief Build a string identifying the codecs offered in a remote stream
+ */
+static void sdp_stream_fingerprint(const struct pjmedia_sdp_media *stream, struct ast_str **buf)
+{
+	unsigned int i;
+
+	ast_str_set(buf, 0, "%.*s", (int) stream->desc.media.slen, stream->desc.media.ptr);
+	for (i = 0; i < stream->desc.fmt_count; ++i) {
+		ast_str_append(buf, 0, " %.*s", (int) stream->desc.fmt[i].slen, stream->desc.fmt[i].ptr);
+	}
+	for (i = 0; i < stream->attr_count; ++i) {
+		const pjmedia_sdp_attr *attr = stream->attr[i];
+
+		if (!pj_stricmp2(&attr->name, "rtpmap") || !pj_stricmp2(&attr->name, "fmtp")
+			|| !pj_stricmp2(&attr->name, "ptime")) {
+			ast_str_append(buf, 0, "|%.*s:%.*s", (int) attr->name.slen, attr->name.ptr,
+				(int) attr->value.slen, attr->value.ptr);
+		}
+	}
+}
+
 static int send_keepalive(const void *data)
 {
 	struct ast_sip_session_media *session_media = (struct ast_sip_session_media *) data;
@@ -268,7 +488,7 @@ static void get_codecs(struct ast_sip_session *session, const struct pjmedia_sdp
 
 				ast_copy_pj_str(fmt_param, &fmtp.fmt_param, sizeof(fmt_param));
 
-				format_parsed = ast_format_parse_sdp_fmtp(format, fmt_param);
+				format_parsed = sdp_parse_fmtp(format, fmt_param);
 				if (format_parsed) {
 					ast_rtp_codecs_payload_replace_format(codecs, num, format_parsed);
 					ao2_ref(format_parsed, -1);
@@ -325,7 +545,33 @@ static int set_caps(struct ast_sip_session *session,
 	ast_rtp_codecs_payload_formats(&codecs, peer, &fmts);
 
 	/* get the joint capabilities between peer and endpoint */
-	ast_format_cap_get_compatible(caps, peer, joint);
+	if (direct_media_enabled) {
+		ast_format_cap_get_compatible(caps, peer, joint);
+	} else {
+		struct ast_str *fingerprint = ast_str_create(256);
+		struct sdp_cache_entry *entry = NULL;
+		struct ast_format_cap *cached;
+
+		if (fingerprint) {
+			sdp_stream_fingerprint(stream, &fingerprint);
+			entry = sdp_cache_find(sdp_joint_cache, session->endpoint->media.codecs,
+				media_type, 0, ast_str_buffer(fingerprint));
+		}
+		if (entry) {
+			ast_format_cap_append_from_cap(joint, entry->result, AST_MEDIA_TYPE_UNKNOWN);
+			ao2_ref(entry, -1);
+		} else {
+			ast_format_cap_get_compatible(caps, peer, joint);
+			if (fingerprint && ast_format_cap_count(joint)
+				&& (cached = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT))) {
+				ast_format_cap_append_from_cap(cached, joint, AST_MEDIA_TYPE_UNKNOWN);
+				sdp_cache_add(sdp_joint_cache, session->endpoint->media.codecs, media_type, 0,
+					ast_str_buffer(fingerprint), cached, NULL, NULL);
+				ao2_ref(cached, -1);
+			}
+		}
+		ast_free(fingerprint);
+	}
 	if (!ast_format_cap_count(joint)) {
 		struct ast_str *usbuf = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
 		struct ast_str *thembuf = ast_str_alloca(AST_FORMAT_CAP_NAMES_LEN);
@@ -421,29 +667,85 @@ static pjmedia_sdp_attr* generate_rtpmap_attr(struct ast_sip_session *session, p
 	return attr;
 }
 
-static pjmedia_sdp_attr* generate_fmtp_attr(pj_pool_t *pool, struct ast_format *format, int rtp_code)
+/*!
+ * \internal
+ * \brief Generate the value of the fmtp attribute for a format
+ *
+ * \return The value, empty if the format has no fmtp attribute.
+ */
+static const char *generate_fmtp_value(struct ast_format *format, int rtp_code, struct ast_str **fmtp0)
 {
-	struct ast_str *fmtp0 = ast_str_alloca(256);
-	pj_str_t fmtp1;
-	pjmedia_sdp_attr *attr = NULL;
 	char *tmp;
 
-	ast_format_generate_sdp_fmtp(format, rtp_code, &fmtp0);
-	if (ast_str_strlen(fmtp0)) {
-		tmp = ast_str_buffer(fmtp0) + ast_str_strlen(fmtp0) - 1;
-		/* remove any carriage return line feeds */
-		while (*tmp == '\r' || *tmp == '\n') --tmp;
-		*++tmp = '\0';
-		/* ast...generate gives us everything, just need value */
-		tmp = strchr(ast_str_buffer(fmtp0), ':');
-		if (tmp && tmp[1] != '\0') {
-			fmtp1 = pj_str(tmp + 1);
-		} else {
-			fmtp1 = pj_str(ast_str_buffer(fmtp0));
+	ast_format_generate_sdp_fmtp(format, rtp_code, fmtp0);
+	if (!ast_str_strlen(*fmtp0)) {
+		return "";
+	}
+
+	tmp = ast_str_buffer(*fmtp0) + ast_str_strlen(*fmtp0) - 1;
+	/* remove any carriage return line feeds */
+	while (*tmp == '\r' || *tmp == '\n') --tmp;
+	*++tmp = '\0';
+	/* ast...generate gives us everything, just need value */
+	tmp = strchr(ast_str_buffer(*fmtp0), ':');
+	if (tmp && tmp[1] != '\0') {
+		return tmp + 1;
+	}
+	return ast_str_buffer(*fmtp0);
+}
+
+/*!
+ * \internal
+ * \brief Add a format with its rtpmap and fmtp attributes to a media stream
+ *
+ * The attribute values of a format are cached, so the streams offered for
+ * the same codecs are built without looking the format up again.
+ *
+ * \retval 0 on success
+ * \retval -1 if the format has no rtpmap
+ */
+static int add_format_to_stream(struct ast_sip_session *session, pjmedia_sdp_media *media,
+	pj_pool_t *pool, int rtp_code, struct ast_format *format)
+{
+	enum ast_rtp_options options = session->endpoint->media.g726_non_standard ?
+		AST_RTP_OPT_G726_NONSTANDARD : 0;
+	struct sdp_cache_entry *entry;
+	struct ast_str *fmtp0 = NULL;
+	const char *rtpmap_value;
+	const char *fmtp_value;
+	char rtpmap[128];
+	char tmp[64];
+	pj_str_t stmp;
+
+	entry = sdp_cache_find(sdp_attrs_cache, format, rtp_code, options, "");
+	if (entry) {
+		rtpmap_value = entry->text[0];
+		fmtp_value = entry->text[1];
+	} else {
+		const char *name = ast_rtp_lookup_mime_subtype2(1, format, 0, options);
+		unsigned int rate = ast_rtp_lookup_sample_rate2(1, format, 0);
+
+		if (ast_strlen_zero(name) || !rate) {
+			return -1;
 		}
-		attr = pjmedia_sdp_attr_create(pool, "fmtp", &fmtp1);
+		snprintf(rtpmap, sizeof(rtpmap), "%d %s/%u%s", rtp_code, name, rate,
+			!strcasecmp(name, "opus") ? "/2" : "");
+		rtpmap_value = rtpmap;
+		fmtp0 = ast_str_alloca(256);
+		fmtp_value = generate_fmtp_value(format, rtp_code, &fmtp0);
+		sdp_cache_add(sdp_attrs_cache, format, rtp_code, options, "", NULL,
+			rtpmap_value, fmtp_value);
 	}
-	return attr;
+
+	snprintf(tmp, sizeof(tmp), "%d", rtp_code);
+	pj_strdup2(pool, &media->desc.fmt[media->desc.fmt_count++], tmp);
+	media->attr[media->attr_count++] = pjmedia_sdp_attr_create(pool, "rtpmap", pj_cstr(&stmp, rtpmap_value));
+	if (!ast_strlen_zero(fmtp_value)) {
+		media->attr[media->attr_count++] = pjmedia_sdp_attr_create(pool, "fmtp", pj_cstr(&stmp, fmtp_value));
+	}
+	ao2_cleanup(entry);
+
+	return 0;
 }
 
 /*! \brief Function which adds ICE attributes to a media stream */
@@ -1171,15 +1473,10 @@ static int create_outgoing_sdp_stream(struct ast_sip_session *session, struct as
 			continue;
 		}
 
-		if (!(attr = generate_rtpmap_attr(session, media, pool, rtp_code, 1, format, 0))) {
+		if (add_format_to_stream(session, media, pool, rtp_code, format)) {
 			ao2_ref(format, -1);
 			continue;
 		}
-		media->attr[media->attr_count++] = attr;
-
-		if ((attr = generate_fmtp_attr(pool, format, rtp_code))) {
-			media->attr[media->attr_count++] = attr;
-		}
 
 		if (ast_format_get_maximum_ms(format) &&
 			((ast_format_get_maximum_ms(format) < max_packet_size) || !max_packet_size)) {
@@ -1498,6 +1795,13 @@ static int unload_module(void)
 		ast_sched_context_destroy(sched);
 	}
 
+	ao2_cleanup(sdp_attrs_cache);
+	sdp_attrs_cache = NULL;
+	ao2_cleanup(sdp_fmtp_cache);
+	sdp_fmtp_cache = NULL;
+	ao2_cleanup(sdp_joint_cache);
+	sdp_joint_cache = NULL;
+
 	return 0;
 }
 
@@ -1531,6 +1835,14 @@ static int load_module(void)
 		goto end;
 	}
 
+	sdp_attrs_cache = ao2_container_alloc(SDP_CACHE_BUCKETS, sdp_cache_hash, sdp_cache_cmp);
+	sdp_fmtp_cache = ao2_container_alloc(SDP_CACHE_BUCKETS, sdp_cache_hash, sdp_cache_cmp);
+	sdp_joint_cache = ao2_container_alloc(SDP_CACHE_BUCKETS, sdp_cache_hash, sdp_cache_cmp);
+	if (!sdp_attrs_cache || !sdp_fmtp_cache || !sdp_joint_cache) {
+		ast_log(LOG_ERROR, "Unable to create SDP caches.\n");
+		goto end;
+	}
+
 	if (ast_sip_session_register_sdp_handler(&audio_sdp_handler, STR_AUDIO)) {
 		ast_log(LOG_ERROR, "Unable to register SDP handler for %s stream type\n", STR_AUDIO);
 		goto end;
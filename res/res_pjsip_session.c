@@ -398,6 +398,150 @@ static int handle_negotiated_sdp(struct ast_sip_session *session, const pjmedia_
 
 AST_RWLIST_HEAD_STATIC(session_supplements, ast_sip_session_supplement);
 
+/*! \brief Methods the supplements to call are worked out for in advance */
+static const char *dispatch_methods[] = {
+	"INVITE", "ACK", "BYE", "CANCEL", "OPTIONS", "UPDATE", "PRACK", "INFO",
+	"REFER", "NOTIFY", "MESSAGE", "SUBSCRIBE", "PUBLISH", "REGISTER",
+};
+
+/*! \brief The supplements to call for messages of one method */
+struct supplement_dispatch {
+	pj_str_t method;
+	/*! Non-zero if any supplement is for the method */
+	int has_supplement;
+	/*! Supplements with each callback, in priority order and NULL terminated */
+	struct ast_sip_session_supplement **incoming_request;
+	struct ast_sip_session_supplement **incoming_response;
+	struct ast_sip_session_supplement **outgoing_request;
+	struct ast_sip_session_supplement **outgoing_response;
+};
+
+/*!
+ * \brief The supplements registered at some point
+ *
+ * A set is never changed once built.  Registering or unregistering a
+ * supplement builds a new set, and each session keeps the set that was
+ * current when it was created.
+ */
+struct ast_sip_session_supplement_set {
+	/*! Number of supplements */
+	size_t count;
+	/*! Copies of the supplements, in priority order */
+	struct ast_sip_session_supplement *all;
+	/*! Supplements for each of dispatch_methods */
+	struct supplement_dispatch dispatch[ARRAY_LEN(dispatch_methods)];
+	/*! Storage for the arrays in dispatch */
+	struct ast_sip_session_supplement **slots;
+};
+
+/*! \brief The set new sessions are given */
+static AO2_GLOBAL_OBJ_STATIC(current_supplements);
+
+static pj_bool_t does_method_match(const pj_str_t *message_method, const char *supplement_method);
+
+static void supplement_set_destructor(void *obj)
+{
+	struct ast_sip_session_supplement_set *set = obj;
+
+	ast_free(set->all);
+	ast_free(set->slots);
+}
+
+/*!
+ * \internal
+ * \brief Build a set from the registered supplements and make it current.
+ *
+ * \note session_supplements must be write locked.
+ */
+static int supplement_set_update(void)
+{
+	struct ast_sip_session_supplement_set *set;
+	struct ast_sip_session_supplement *iter;
+	struct ast_sip_session_supplement *supplement;
+	struct ast_sip_session_supplement **slot;
+	struct supplement_dispatch *dispatch;
+	size_t i;
+	size_t m;
+
+	set = ao2_alloc_options(sizeof(*set), supplement_set_destructor, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!set) {
+		return -1;
+	}
+
+	AST_RWLIST_TRAVERSE(&session_supplements, iter, next) {
+		++set->count;
+	}
+
+	set->all = ast_calloc(set->count + 1, sizeof(*set->all));
+	set->slots = ast_calloc(ARRAY_LEN(dispatch_methods) * 4 * (set->count + 1), sizeof(*set->slots));
+	if (!set->all || !set->slots) {
+		ao2_ref(set, -1);
+		return -1;
+	}
+
+	i = 0;
+	AST_RWLIST_TRAVERSE(&session_supplements, iter, next) {
+		set->all[i] = *iter;
+		AST_LIST_NEXT(&set->all[i], next) = NULL;
+		++i;
+	}
+
+	slot = set->slots;
+	for (m = 0; m < ARRAY_LEN(dispatch_methods); ++m) {
+		dispatch = &set->dispatch[m];
+		pj_cstr(&dispatch->method, dispatch_methods[m]);
+
+#define BUILD_DISPATCH(callback) \
+		dispatch->callback = slot; \
+		for (i = 0; i < set->count; ++i) { \
+			supplement = &set->all[i]; \
+			if (supplement->callback && does_method_match(&dispatch->method, supplement->method)) { \
+				*slot++ = supplement; \
+			} \
+		} \
+		*slot++ = NULL;
+
+		BUILD_DISPATCH(incoming_request);
+		BUILD_DISPATCH(incoming_response);
+		BUILD_DISPATCH(outgoing_request);
+		BUILD_DISPATCH(outgoing_response);
+#undef BUILD_DISPATCH
+
+		for (i = 0; i < set->count; ++i) {
+			if (does_method_match(&dispatch->method, set->all[i].method)) {
+				dispatch->has_supplement = 1;
+				break;
+			}
+		}
+	}
+
+	ao2_global_obj_replace_unref(current_supplements, set);
+	ao2_ref(set, -1);
+
+	return 0;
+}
+
+/*!
+ * \internal
+ * \brief Find the supplements worked out in advance for a method.
+ *
+ * \retval NULL if the method is not one of dispatch_methods
+ */
+static const struct supplement_dispatch *supplement_dispatch_find(
+	const struct ast_sip_session_supplement_set *set, const pj_str_t *method)
+{
+	size_t m;
+
+	for (m = 0; m < ARRAY_LEN(dispatch_methods); ++m) {
+		if (pj_strlen(&set->dispatch[m].method) == pj_strlen(method)
+			&& !pj_stricmp(&set->dispatch[m].method, method)) {
+			return &set->dispatch[m];
+		}
+	}
+
+	return NULL;
+}
+
 int ast_sip_session_register_supplement(struct ast_sip_session_supplement *supplement)
 {
 	struct ast_sip_session_supplement *iter;
@@ -420,6 +564,13 @@ int ast_sip_session_register_supplement(struct ast_sip_session_supplement *suppl
 	if (!inserted) {
 		AST_RWLIST_INSERT_TAIL(&session_supplements, supplement, next);
 	}
+
+	if (supplement_set_update()) {
+		ast_log(LOG_ERROR, "Unable to register session supplement\n");
+		AST_RWLIST_REMOVE(&session_supplements, supplement, next);
+		return -1;
+	}
+
 	ast_module_ref(ast_module_info->self);
 	return 0;
 }
@@ -431,6 +582,10 @@ void ast_sip_session_unregister_supplement(struct ast_sip_session_supplement *su
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(&session_supplements, iter, next) {
 		if (supplement == iter) {
 			AST_RWLIST_REMOVE_CURRENT(next);
+			if (supplement_set_update()) {
+				/* Sessions keep getting a copy of it, which is harmless */
+				ast_log(LOG_WARNING, "Unable to update session supplements\n");
+			}
 			ast_module_unref(ast_module_info->self);
 			break;
 		}
@@ -438,17 +593,6 @@ void ast_sip_session_unregister_supplement(struct ast_sip_session_supplement *su
 	AST_RWLIST_TRAVERSE_SAFE_END;
 }
 
-static struct ast_sip_session_supplement *supplement_dup(const struct ast_sip_session_supplement *src)
-{
-	struct ast_sip_session_supplement *dst = ast_calloc(1, sizeof(*dst));
-	if (!dst) {
-		return NULL;
-	}
-	/* Will need to revisit if shallow copy becomes an issue */
-	*dst = *src;
-	return dst;
-}
-
 #define DATASTORE_BUCKETS 53
 #define MEDIA_BUCKETS 7
 
@@ -1317,24 +1461,23 @@ static void session_media_dtor(void *obj)
 static void session_destructor(void *obj)
 {
 	struct ast_sip_session *session = obj;
-	struct ast_sip_session_supplement *supplement;
 	struct ast_sip_session_delayed_request *delay;
+	size_t i;
 
 	ast_debug(3, "Destroying SIP session with endpoint %s\n",
 		session->endpoint ? ast_sorcery_object_get_id(session->endpoint) : "<none>");
 
-	while ((supplement = AST_LIST_REMOVE_HEAD(&session->supplements, next))) {
-		if (supplement->session_destroy) {
-			supplement->session_destroy(session);
+	for (i = 0; session->supplements && i < session->supplements->count; ++i) {
+		if (session->supplements->all[i].session_destroy) {
+			session->supplements->all[i].session_destroy(session);
 		}
-		ast_free(supplement);
 	}
+	ao2_cleanup(session->supplements);
 
 	ast_taskprocessor_unreference(session->serializer);
 	ao2_cleanup(session->datastores);
 	ao2_cleanup(session->media);
 
-	AST_LIST_HEAD_DESTROY(&session->supplements);
 	while ((delay = AST_LIST_REMOVE_HEAD(&session->delayed_requests, next))) {
 		ast_free(delay);
 	}
@@ -1356,17 +1499,9 @@ static void session_destructor(void *obj)
 
 static int add_supplements(struct ast_sip_session *session)
 {
-	struct ast_sip_session_supplement *iter;
-	SCOPED_LOCK(lock, &session_supplements, AST_RWLIST_RDLOCK, AST_RWLIST_UNLOCK);
+	session->supplements = ao2_global_obj_ref(current_supplements);
 
-	AST_RWLIST_TRAVERSE(&session_supplements, iter, next) {
-		struct ast_sip_session_supplement *copy = supplement_dup(iter);
-		if (!copy) {
-			return -1;
-		}
-		AST_LIST_INSERT_TAIL(&session->supplements, copy, next);
-	}
-	return 0;
+	return session->supplements ? 0 : -1;
 }
 
 static int add_session_media(void *obj, void *arg, int flags)
@@ -1417,14 +1552,13 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 	struct ast_sip_contact *contact, pjsip_inv_session *inv_session, pjsip_rx_data *rdata)
 {
 	RAII_VAR(struct ast_sip_session *, session, NULL, ao2_cleanup);
-	struct ast_sip_session_supplement *iter;
+	size_t i;
 	int dsp_features = 0;
 
 	session = ao2_alloc(sizeof(*session), session_destructor);
 	if (!session) {
 		return NULL;
 	}
-	AST_LIST_HEAD_INIT(&session->supplements);
 	session->datastores = ao2_container_alloc(DATASTORE_BUCKETS, datastore_hash, datastore_cmp);
 	if (!session->datastores) {
 		return NULL;
@@ -1496,9 +1630,9 @@ struct ast_sip_session *ast_sip_session_alloc(struct ast_sip_endpoint *endpoint,
 		ao2_ref(session, -1);
 		return NULL;
 	}
-	AST_LIST_TRAVERSE(&session->supplements, iter, next) {
-		if (iter->session_begin) {
-			iter->session_begin(session);
+	for (i = 0; i < session->supplements->count; ++i) {
+		if (session->supplements->all[i].session_begin) {
+			session->supplements->all[i].session_begin(session);
 		}
 	}
 	session->direct_media_cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
@@ -2264,15 +2398,20 @@ static pj_bool_t does_method_match(const pj_str_t *message_method, const char *s
 
 static pj_bool_t has_supplement(const struct ast_sip_session *session, const pjsip_rx_data *rdata)
 {
-	struct ast_sip_session_supplement *supplement;
+	const struct supplement_dispatch *dispatch;
 	struct pjsip_method *method = &rdata->msg_info.msg->line.req.method;
+	size_t i;
 
 	if (!session) {
 		return PJ_FALSE;
 	}
 
-	AST_LIST_TRAVERSE(&session->supplements, supplement, next) {
-		if (does_method_match(&method->name, supplement->method)) {
+	if ((dispatch = supplement_dispatch_find(session->supplements, &method->name))) {
+		return dispatch->has_supplement ? PJ_TRUE : PJ_FALSE;
+	}
+
+	for (i = 0; i < session->supplements->count; ++i) {
+		if (does_method_match(&method->name, session->supplements->all[i].method)) {
 			return PJ_TRUE;
 		}
 	}
@@ -2428,11 +2567,24 @@ static void __print_debug_details(const char *function, pjsip_inv_session *inv,
 
 static void handle_incoming_request(struct ast_sip_session *session, pjsip_rx_data *rdata)
 {
+	const struct supplement_dispatch *dispatch;
+	struct ast_sip_session_supplement **iter;
 	struct ast_sip_session_supplement *supplement;
 	struct pjsip_request_line req = rdata->msg_info.msg->line.req;
+	size_t i;
 
 	ast_debug(3, "Method is %.*s\n", (int) pj_strlen(&req.method.name), pj_strbuf(&req.method.name));
-	AST_LIST_TRAVERSE(&session->supplements, supplement, next) {
+	if ((dispatch = supplement_dispatch_find(session->supplements, &req.method.name))) {
+		for (iter = dispatch->incoming_request; *iter; ++iter) {
+			if ((*iter)->incoming_request(session, rdata)) {
+				break;
+			}
+		}
+		return;
+	}
+
+	for (i = 0; i < session->supplements->count; ++i) {
+		supplement = &session->supplements->all[i];
 		if (supplement->incoming_request && does_method_match(&req.method.name, supplement->method)) {
 			if (supplement->incoming_request(session, rdata)) {
 				break;
@@ -2444,13 +2596,26 @@ static void handle_incoming_request(struct ast_sip_session *session, pjsip_rx_da
 static void handle_incoming_response(struct ast_sip_session *session, pjsip_rx_data *rdata,
 		enum ast_sip_session_response_priority response_priority)
 {
+	const struct supplement_dispatch *dispatch;
+	struct ast_sip_session_supplement **iter;
 	struct ast_sip_session_supplement *supplement;
 	struct pjsip_status_line status = rdata->msg_info.msg->line.status;
+	size_t i;
 
 	ast_debug(3, "Response is %d %.*s\n", status.code, (int) pj_strlen(&status.reason),
 			pj_strbuf(&status.reason));
 
-	AST_LIST_TRAVERSE(&session->supplements, supplement, next) {
+	if ((dispatch = supplement_dispatch_find(session->supplements, &rdata->msg_info.cseq->method.name))) {
+		for (iter = dispatch->incoming_response; *iter; ++iter) {
+			if ((*iter)->response_priority & response_priority) {
+				(*iter)->incoming_response(session, rdata);
+			}
+		}
+		return;
+	}
+
+	for (i = 0; i < session->supplements->count; ++i) {
+		supplement = &session->supplements->all[i];
 		if (!(supplement->response_priority & response_priority)) {
 			continue;
 		}
@@ -2477,11 +2642,22 @@ static int handle_incoming(struct ast_sip_session *session, pjsip_rx_data *rdata
 
 static void handle_outgoing_request(struct ast_sip_session *session, pjsip_tx_data *tdata)
 {
+	const struct supplement_dispatch *dispatch;
+	struct ast_sip_session_supplement **iter;
 	struct ast_sip_session_supplement *supplement;
 	struct pjsip_request_line req = tdata->msg->line.req;
+	size_t i;
 
 	ast_debug(3, "Method is %.*s\n", (int) pj_strlen(&req.method.name), pj_strbuf(&req.method.name));
-	AST_LIST_TRAVERSE(&session->supplements, supplement, next) {
+	if ((dispatch = supplement_dispatch_find(session->supplements, &req.method.name))) {
+		for (iter = dispatch->outgoing_request; *iter; ++iter) {
+			(*iter)->outgoing_request(session, tdata);
+		}
+		return;
+	}
+
+	for (i = 0; i < session->supplements->count; ++i) {
+		supplement = &session->supplements->all[i];
 		if (supplement->outgoing_request && does_method_match(&req.method.name, supplement->method)) {
 			supplement->outgoing_request(session, tdata);
 		}
@@ -2490,14 +2666,26 @@ static void handle_outgoing_request(struct ast_sip_session *session, pjsip_tx_da
 
 static void handle_outgoing_response(struct ast_sip_session *session, pjsip_tx_data *tdata)
 {
+	const struct supplement_dispatch *dispatch;
+	struct ast_sip_session_supplement **iter;
 	struct ast_sip_session_supplement *supplement;
 	struct pjsip_status_line status = tdata->msg->line.status;
 	pjsip_cseq_hdr *cseq = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_CSEQ, NULL);
+	size_t i;
+
 	ast_debug(3, "Method is %.*s, Response is %d %.*s\n", (int) pj_strlen(&cseq->method.name),
 		pj_strbuf(&cseq->method.name), status.code, (int) pj_strlen(&status.reason),
 		pj_strbuf(&status.reason));
 
-	AST_LIST_TRAVERSE(&session->supplements, supplement, next) {
+	if ((dispatch = supplement_dispatch_find(session->supplements, &cseq->method.name))) {
+		for (iter = dispatch->outgoing_response; *iter; ++iter) {
+			(*iter)->outgoing_response(session, tdata);
+		}
+		return;
+	}
+
+	for (i = 0; i < session->supplements->count; ++i) {
+		supplement = &session->supplements->all[i];
 		if (supplement->outgoing_response && does_method_match(&cseq->method.name, supplement->method)) {
 			supplement->outgoing_response(session, tdata);
 		}
@@ -2507,15 +2695,15 @@ static void handle_outgoing_response(struct ast_sip_session *session, pjsip_tx_d
 static int session_end(void *vsession)
 {
 	struct ast_sip_session *session = vsession;
-	struct ast_sip_session_supplement *iter;
+	size_t i;
 
 	/* Stop the scheduled termination */
 	sip_session_defer_termination_stop_timer(session);
 
 	/* Session is dead.  Notify the supplements. */
-	AST_LIST_TRAVERSE(&session->supplements, iter, next) {
-		if (iter->session_end) {
-			iter->session_end(session);
+	for (i = 0; i < session->supplements->count; ++i) {
+		if (session->supplements->all[i].session_end) {
+			session->supplements->all[i].session_end(session);
 		}
 	}
 	return 0;
@@ -3199,6 +3387,13 @@ static int load_module(void)
 	ast_sip_register_service(&session_reinvite_module);
 	ast_sip_register_service(&outbound_invite_auth_module);
 
+	AST_RWLIST_WRLOCK(&session_supplements);
+	if (supplement_set_update()) {
+		AST_RWLIST_UNLOCK(&session_supplements);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	AST_RWLIST_UNLOCK(&session_supplements);
+
 	ast_module_shutdown_ref(ast_module_info->self);
 
 	return AST_MODULE_LOAD_SUCCESS;
@@ -3212,6 +3407,7 @@ static int unload_module(void)
 	ast_sorcery_delete(ast_sip_get_sorcery(), nat_hook);
 	ao2_cleanup(nat_hook);
 	ao2_cleanup(sdp_handlers);
+	ao2_global_obj_release(current_supplements);
 	return 0;
 }
 
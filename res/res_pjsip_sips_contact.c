@@ -36,55 +36,58 @@
  * brief, if the request URI is SIPS or the topmost Route header is SIPS,
  * then the Contact header we send must also be SIPS.
  */
-static pj_status_t sips_contact_on_tx_request(pjsip_tx_data *tdata)
+static int sips_contact_rewrite(pjsip_tx_data *tdata)
 {
 	pjsip_contact_hdr *contact;
 	pjsip_route_hdr *route;
 	pjsip_sip_uri *contact_uri;
 
+	if (tdata->msg->type != PJSIP_REQUEST_MSG) {
+		return 0;
+	}
+
 	contact = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_CONTACT, NULL);
 	if (!contact) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	contact_uri = pjsip_uri_get_uri(contact->uri);
 	if (PJSIP_URI_SCHEME_IS_SIPS(contact_uri)) {
 		/* If the Contact header is already SIPS, then we don't need to do anything */
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	if (PJSIP_URI_SCHEME_IS_SIPS(tdata->msg->line.req.uri)) {
 		ast_debug(1, "Upgrading contact URI on outgoing SIP request to SIPS due to SIPS Request URI\n");
 		pjsip_sip_uri_set_secure(contact_uri, PJ_TRUE);
-		return PJ_SUCCESS;
+		return 1;
 	}
 
 	route = pjsip_msg_find_hdr(tdata->msg, PJSIP_H_ROUTE, NULL);
 	if (!route) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	if (!PJSIP_URI_SCHEME_IS_SIPS(&route->name_addr)) {
-		return PJ_SUCCESS;
+		return 0;
 	}
 
 	/* Our Contact header is not a SIPS URI, but our topmost Route header is. */
 	ast_debug(1, "Upgrading contact URI on outgoing SIP request to SIPS due to SIPS Route header\n");
 	pjsip_sip_uri_set_secure(contact_uri, PJ_TRUE);
 
-	return PJ_SUCCESS;
+	return 1;
 }
 
-static pjsip_module sips_contact_module = {
-	.name = {"SIPS Contact", 12 },
-	.id = -1,
-	.priority = PJSIP_MOD_PRIORITY_TSX_LAYER - 2,
-	.on_tx_request = sips_contact_on_tx_request,
+static struct ast_sip_tx_rewrite sips_contact_tx_rewrite = {
+	.name = "SIPS Contact",
+	.priority = 20,
+	.rewrite = sips_contact_rewrite,
 };
 
 static int unload_module(void)
 {
-	ast_sip_unregister_service(&sips_contact_module);
+	ast_sip_unregister_tx_rewrite(&sips_contact_tx_rewrite);
 	return 0;
 }
 
@@ -92,7 +95,7 @@ static int load_module(void)
 {
 	CHECK_PJSIP_MODULE_LOADED();
 
-	if (ast_sip_register_service(&sips_contact_module)) {
+	if (ast_sip_register_tx_rewrite(&sips_contact_tx_rewrite)) {
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -166,11 +166,15 @@ static void t38_change_state(struct ast_sip_session *session, struct ast_sip_ses
 		parameters.max_ifp = ast_udptl_get_far_max_ifp(session_media->udptl);
 		parameters.request_response = AST_T38_NEGOTIATED;
 		ast_udptl_set_tag(session_media->udptl, "%s", ast_channel_name(session->channel));
+
+		/* The bridge may now relay UDPTL natively */
+		ast_channel_set_unbridged(session->channel, 1);
 		break;
 	case T38_REJECTED:
 	case T38_DISABLED:
 		if (old_state == T38_ENABLED) {
 			parameters.request_response = AST_T38_TERMINATED;
+			ast_channel_set_unbridged(session->channel, 1);
 		} else if (old_state == T38_LOCAL_REINVITE) {
 			parameters.request_response = AST_T38_REFUSED;
 		}
@@ -883,6 +887,32 @@ static void stream_destroy(struct ast_sip_session_media *session_media)
 	session_media->udptl = NULL;
 }
 
+/*! \brief Get the UDPTL session of a PJSIP channel */
+static struct ast_udptl *t38_get_udptl(struct ast_channel *chan)
+{
+	struct ast_sip_channel_pvt *channel = ast_channel_tech_pvt(chan);
+	struct ast_sip_session_media *session_media;
+	struct ast_udptl *udptl = NULL;
+
+	if (!channel || !channel->session) {
+		return NULL;
+	}
+
+	session_media = ao2_find(channel->session->media, "image", OBJ_KEY);
+	if (session_media) {
+		udptl = session_media->udptl;
+		ao2_ref(session_media, -1);
+	}
+
+	return udptl;
+}
+
+/*! \brief UDPTL glue for PJSIP channels */
+static struct ast_udptl_glue t38_udptl_glue = {
+	.type = "PJSIP",
+	.get_udptl = t38_get_udptl,
+};
+
 /*! \brief SDP handler for 'image' media stream */
 static struct ast_sip_session_sdp_handler image_sdp_handler = {
 	.id = "image",
@@ -897,6 +927,7 @@ static struct ast_sip_session_sdp_handler image_sdp_handler = {
 /*! \brief Unloads the SIP T.38 module from Asterisk */
 static int unload_module(void)
 {
+	ast_udptl_glue_unregister(&t38_udptl_glue);
 	ast_sip_session_unregister_sdp_handler(&image_sdp_handler, "image");
 	ast_sip_session_unregister_supplement(&t38_supplement);
 
@@ -933,6 +964,11 @@ static int load_module(void)
 		goto end;
 	}
 
+	if (ast_udptl_glue_register(&t38_udptl_glue)) {
+		ast_log(LOG_ERROR, "Unable to register UDPTL glue\n");
+		goto end;
+	}
+
 	return AST_MODULE_LOAD_SUCCESS;
 end:
 	unload_module();
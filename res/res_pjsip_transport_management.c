@@ -19,6 +19,7 @@
 /*** MODULEINFO
 	<depend>pjproject</depend>
 	<depend>res_pjsip</depend>
+	<depend>res_pjproject</depend>
 	<support_level>core</support_level>
  ***/
 
@@ -30,6 +31,7 @@
 #include <pjsip_ua.h>
 
 #include "asterisk/res_pjsip.h"
+#include "asterisk/res_pjproject.h"
 #include "asterisk/module.h"
 #include "asterisk/astobj2.h"
 
@@ -38,6 +40,12 @@
 
 #define IDLE_TIMEOUT (pjsip_cfg()->tsx.td)
 
+/*! \brief Milliseconds between checks of outbound connection keepalives and idleness */
+#define OUTBOUND_SWEEP_INTERVAL 1000
+
+/*! \brief Milliseconds between connecting to the outbound_prewarm destinations of transports */
+#define PREWARM_INTERVAL 30000
+
 /*! \brief The keep alive packet to send */
 static const pj_str_t keepalive_packet = { "\r\n\r\n", 4 };
 
@@ -56,18 +64,28 @@ static unsigned int keepalive_interval;
 /*! \brief Existing transport manager callback that we need to invoke */
 static pjsip_tp_state_callback tpmgr_state_callback;
 
+/*! \brief Number of monitored outbound connections with a maximum idle time */
+static int outbound_idle_monitored;
+
 /*! \brief Structure for transport to be monitored */
 struct monitored_transport {
 	/*! \brief The underlying PJSIP transport */
 	pjsip_transport *transport;
 	/*! \brief Non-zero if a PJSIP request was received */
 	int sip_received;
+	/*! \brief Seconds an outbound connection may go without a SIP message, 0 for no limit */
+	unsigned int max_idle;
+	/*! \brief Seconds between keepalives on an outbound connection, 0 for the global interval */
+	unsigned int keep_alive_interval;
+	/*! \brief When a SIP message was last sent or received on an outbound connection */
+	time_t last_activity;
+	/*! \brief When a keepalive was last sent on an outbound connection */
+	time_t last_keep_alive;
 };
 
-/*! \brief Callback function to send keepalive */
-static int keepalive_transport_cb(void *obj, void *arg, int flags)
+/*! \brief Send a keepalive on a transport */
+static void keepalive_transport_send(struct monitored_transport *monitored)
 {
-	struct monitored_transport *monitored = obj;
 	pjsip_tpselector selector = {
 		.type = PJSIP_TPSELECTOR_TRANSPORT,
 		.u.transport = monitored->transport,
@@ -77,6 +95,17 @@ static int keepalive_transport_cb(void *obj, void *arg, int flags)
 		monitored->transport->key.type, &selector, NULL, keepalive_packet.ptr, keepalive_packet.slen,
 		&monitored->transport->key.rem_addr, pj_sockaddr_get_len(&monitored->transport->key.rem_addr),
 		NULL, NULL);
+}
+
+/*! \brief Callback function to send keepalive */
+static int keepalive_transport_cb(void *obj, void *arg, int flags)
+{
+	struct monitored_transport *monitored = obj;
+
+	if (!monitored->keep_alive_interval) {
+		/* Connections with an interval of their own are sent keepalives by the sweep */
+		keepalive_transport_send(monitored);
+	}
 
 	return 0;
 }
@@ -85,10 +114,8 @@ static int keepalive_transport_cb(void *obj, void *arg, int flags)
 static void *keepalive_transport_thread(void *data)
 {
 	struct ao2_container *transports;
-	pj_thread_desc desc;
-	pj_thread_t *thread;
 
-	if (pj_thread_register("Asterisk Keepalive Thread", desc, &thread) != PJ_SUCCESS) {
+	if (ast_pjproject_thread_register("Asterisk Keepalive Thread")) {
 		ast_log(LOG_ERROR, "Could not register keepalive thread with PJLIB, keepalives will not occur.\n");
 		return NULL;
 	}
@@ -110,26 +137,19 @@ static void *keepalive_transport_thread(void *data)
 	return NULL;
 }
 
-AST_THREADSTORAGE(desc_storage);
+/*! \brief Register the scheduler thread with PJLIB if it is not already */
+static int sched_thread_register(void)
+{
+	return ast_pjproject_thread_register("Transport Monitor");
+}
 
 static int idle_sched_cb(const void *data)
 {
 	struct monitored_transport *keepalive = (struct monitored_transport *) data;
 
-	if (!pj_thread_is_registered()) {
-		pj_thread_t *thread;
-		pj_thread_desc *desc;
-
-		desc = ast_threadstorage_get(&desc_storage, sizeof(pj_thread_desc));
-		if (!desc) {
-			ast_log(LOG_ERROR, "Could not get thread desc from thread-local storage.\n");
-			ao2_ref(keepalive, -1);
-			return 0;
-		}
-
-		pj_bzero(*desc, sizeof(*desc));
-
-		pj_thread_register("Transport Monitor", *desc, &thread);
+	if (sched_thread_register()) {
+		ao2_ref(keepalive, -1);
+		return 0;
 	}
 
 	if (!keepalive->sip_received) {
@@ -142,11 +162,200 @@ static int idle_sched_cb(const void *data)
 	return 0;
 }
 
+/*! \brief Callback function to find the outbound connections that need a keepalive or are idle */
+static int outbound_sweep_transport_cb(void *obj, void *arg, int flags)
+{
+	struct monitored_transport *monitored = obj;
+	time_t now = *(time_t *) arg;
+
+	if (monitored->transport->dir != PJSIP_TP_DIR_OUTGOING) {
+		return 0;
+	}
+
+	if (monitored->max_idle && now - monitored->last_activity >= monitored->max_idle) {
+		/* Shut down once out of the container lock */
+		return CMP_MATCH;
+	}
+
+	if (monitored->keep_alive_interval
+		&& now - monitored->last_keep_alive >= monitored->keep_alive_interval) {
+		monitored->last_keep_alive = now;
+		keepalive_transport_send(monitored);
+	}
+
+	return 0;
+}
+
+/*! \brief Send the keepalives of outbound connections, and shut down idle ones */
+static int outbound_sweep_sched_cb(const void *data)
+{
+	struct ao2_container *transports;
+	struct ao2_iterator *idle;
+	struct monitored_transport *monitored;
+	time_t now = time(NULL);
+
+	if (sched_thread_register()) {
+		return OUTBOUND_SWEEP_INTERVAL;
+	}
+
+	transports = ao2_global_obj_ref(monitored_transports);
+	if (!transports) {
+		return OUTBOUND_SWEEP_INTERVAL;
+	}
+
+	idle = ao2_callback(transports, OBJ_MULTIPLE, outbound_sweep_transport_cb, &now);
+	ao2_ref(transports, -1);
+	if (!idle) {
+		return OUTBOUND_SWEEP_INTERVAL;
+	}
+
+	for (; (monitored = ao2_iterator_next(idle)); ao2_ref(monitored, -1)) {
+		ast_debug(3, "Shutting down outbound transport '%s' since no SIP message was sent or received in %u seconds\n",
+			monitored->transport->info, monitored->max_idle);
+		pjsip_transport_shutdown(monitored->transport);
+	}
+	ao2_iterator_destroy(idle);
+
+	return OUTBOUND_SWEEP_INTERVAL;
+}
+
+/*!
+ * \brief Connect a transport to a destination if it is not already connected
+ *
+ * \param state The TCP or TLS transport to connect from.
+ * \param destination Host and optional port to connect to.
+ */
+static void prewarm_destination(struct ast_sip_transport_state *state, const char *destination)
+{
+	struct ast_sockaddr *addrs;
+	pj_sockaddr remote;
+	pj_str_t remote_str;
+	pjsip_transport_type_e type;
+	pjsip_transport *transport;
+	pjsip_tpselector selector = {
+		.type = PJSIP_TPSELECTOR_LISTENER,
+		.u.listener = state->factory,
+	};
+
+	if (ast_sockaddr_resolve(&addrs, destination, 0, AST_AF_UNSPEC) <= 0) {
+		ast_log(LOG_WARNING, "Could not resolve outbound_prewarm destination '%s' of transport '%s'\n",
+			destination, state->id);
+		return;
+	}
+	if (!ast_sockaddr_port(&addrs[0])) {
+		ast_sockaddr_set_port(&addrs[0], state->type == AST_TRANSPORT_TLS ? 5061 : 5060);
+	}
+
+	pj_cstr(&remote_str, ast_sockaddr_stringify(&addrs[0]));
+	if (pj_sockaddr_parse(pj_AF_UNSPEC(), 0, &remote_str, &remote) != PJ_SUCCESS) {
+		ast_free(addrs);
+		return;
+	}
+
+	type = state->type == AST_TRANSPORT_TLS ? PJSIP_TRANSPORT_TLS : PJSIP_TRANSPORT_TCP;
+	if (ast_sockaddr_is_ipv6(&addrs[0])) {
+		type = (pjsip_transport_type_e)(((int)type) + PJSIP_TRANSPORT_IPV6);
+	}
+	ast_free(addrs);
+
+	/* An existing connection is found, otherwise one is started */
+	if (pjsip_tpmgr_acquire_transport(pjsip_endpt_get_tpmgr(ast_sip_get_pjsip_endpoint()),
+			type, &remote, pj_sockaddr_get_len(&remote), &selector, &transport) != PJ_SUCCESS) {
+		ast_debug(3, "Could not connect transport '%s' to outbound_prewarm destination '%s'\n",
+			state->id, destination);
+		return;
+	}
+	pjsip_transport_dec_ref(transport);
+}
+
+/*! \brief Connect every TCP and TLS transport to its outbound_prewarm destinations */
+static int prewarm_sched_cb(const void *data)
+{
+	struct ao2_container *states;
+	struct ast_sip_transport_state *state;
+	struct ao2_iterator iter;
+
+	if (sched_thread_register()) {
+		return PREWARM_INTERVAL;
+	}
+
+	states = ast_sip_get_transport_states();
+	if (!states) {
+		return PREWARM_INTERVAL;
+	}
+
+	iter = ao2_iterator_init(states, 0);
+	for (; (state = ao2_iterator_next(&iter)); ao2_ref(state, -1)) {
+		struct ast_sip_transport *config;
+		char *destinations;
+		char *remaining;
+		char *destination;
+
+		if ((state->type != AST_TRANSPORT_TCP && state->type != AST_TRANSPORT_TLS)
+			|| !state->factory) {
+			continue;
+		}
+
+		config = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "transport", state->id);
+		if (!config) {
+			continue;
+		}
+		remaining = destinations = ast_strdup(config->outbound_prewarm);
+		ao2_ref(config, -1);
+		if (!destinations) {
+			continue;
+		}
+
+		while ((destination = strsep(&remaining, ","))) {
+			destination = ast_strip(destination);
+			if (!ast_strlen_zero(destination)) {
+				prewarm_destination(state, destination);
+			}
+		}
+		ast_free(destinations);
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_ref(states, -1);
+
+	return PREWARM_INTERVAL;
+}
+
+/*!
+ * \brief Get the configuration of the transport an outbound connection was made from
+ *
+ * \return The transport configuration with a reference, NULL if not found.
+ */
+static struct ast_sip_transport *outbound_transport_config(pjsip_transport *transport)
+{
+	struct ao2_container *states;
+	struct ast_sip_transport_state *state;
+	struct ao2_iterator iter;
+	struct ast_sip_transport *config = NULL;
+
+	if (!transport->factory || !(states = ast_sip_get_transport_states())) {
+		return NULL;
+	}
+
+	iter = ao2_iterator_init(states, 0);
+	for (; !config && (state = ao2_iterator_next(&iter)); ao2_ref(state, -1)) {
+		if (state->factory == transport->factory) {
+			config = ast_sorcery_retrieve_by_id(ast_sip_get_sorcery(), "transport", state->id);
+		}
+	}
+	ao2_iterator_destroy(&iter);
+	ao2_ref(states, -1);
+
+	return config;
+}
+
 /*! \brief Destructor for keepalive transport */
 static void monitored_transport_destroy(void *obj)
 {
 	struct monitored_transport *keepalive = obj;
 
+	if (keepalive->max_idle) {
+		ast_atomic_fetchadd_int(&outbound_idle_monitored, -1);
+	}
 	pjsip_transport_dec_ref(keepalive->transport);
 }
 
@@ -158,12 +367,26 @@ static void monitored_transport_state_callback(pjsip_transport *transport, pjsip
 
 	/* We only care about reliable transports */
 	if (PJSIP_TRANSPORT_IS_RELIABLE(transport)
-		&& (transport->dir == PJSIP_TP_DIR_INCOMING || keepalive_interval)
 		&& (transports = ao2_global_obj_ref(monitored_transports))) {
 		struct monitored_transport *monitored;
+		struct ast_sip_transport *config;
+		unsigned int max_idle = 0;
+		unsigned int interval = 0;
 
 		switch (state) {
 		case PJSIP_TP_STATE_CONNECTED:
+			if (transport->dir != PJSIP_TP_DIR_INCOMING) {
+				if ((config = outbound_transport_config(transport))) {
+					max_idle = config->outbound_max_idle;
+					interval = config->outbound_keep_alive_interval;
+					ao2_ref(config, -1);
+				}
+				if (!keepalive_interval && !max_idle && !interval) {
+					/* Left to PJSIP to close once it is no longer used */
+					break;
+				}
+			}
+
 			monitored = ao2_alloc_options(sizeof(*monitored),
 				monitored_transport_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
 			if (!monitored) {
@@ -171,6 +394,13 @@ static void monitored_transport_state_callback(pjsip_transport *transport, pjsip
 			}
 			monitored->transport = transport;
 			pjsip_transport_add_ref(monitored->transport);
+			monitored->max_idle = max_idle;
+			if (max_idle) {
+				ast_atomic_fetchadd_int(&outbound_idle_monitored, +1);
+			}
+			monitored->keep_alive_interval = interval;
+			monitored->last_activity = time(NULL);
+			monitored->last_keep_alive = monitored->last_activity;
 
 			ao2_link(transports, monitored);
 
@@ -290,6 +520,32 @@ static struct ast_sorcery_observer keepalive_global_observer = {
 	.loaded = keepalive_global_loaded,
 };
 
+/*! \brief Note that a SIP message was sent or received on an outbound connection with a maximum idle time */
+static void outbound_activity(pjsip_transport *transport)
+{
+	struct ao2_container *transports;
+	struct monitored_transport *monitored;
+
+	if (!transport || transport->dir != PJSIP_TP_DIR_OUTGOING
+		|| !PJSIP_TRANSPORT_IS_RELIABLE(transport) || !outbound_idle_monitored) {
+		return;
+	}
+
+	transports = ao2_global_obj_ref(monitored_transports);
+	if (!transports) {
+		return;
+	}
+
+	monitored = ao2_find(transports, transport->obj_name, OBJ_SEARCH_KEY);
+	ao2_ref(transports, -1);
+	if (!monitored) {
+		return;
+	}
+
+	monitored->last_activity = time(NULL);
+	ao2_ref(monitored, -1);
+}
+
 /*!
  * \brief
  * On incoming TCP connections, when we receive a SIP request, we mark that we have
@@ -301,6 +557,11 @@ static pj_bool_t idle_monitor_on_rx_request(pjsip_rx_data *rdata)
 	struct ao2_container *transports;
 	struct monitored_transport *idle_trans;
 
+	if (rdata->tp_info.transport->dir == PJSIP_TP_DIR_OUTGOING) {
+		outbound_activity(rdata->tp_info.transport);
+		return PJ_FALSE;
+	}
+
 	transports = ao2_global_obj_ref(monitored_transports);
 	if (!transports) {
 		return PJ_FALSE;
@@ -318,10 +579,25 @@ static pj_bool_t idle_monitor_on_rx_request(pjsip_rx_data *rdata)
 	return PJ_FALSE;
 }
 
+static pj_bool_t idle_monitor_on_rx_response(pjsip_rx_data *rdata)
+{
+	outbound_activity(rdata->tp_info.transport);
+	return PJ_FALSE;
+}
+
+static pj_status_t idle_monitor_on_tx_message(pjsip_tx_data *tdata)
+{
+	outbound_activity(tdata->tp_info.transport);
+	return PJ_SUCCESS;
+}
+
 static pjsip_module idle_monitor_module = {
 	.name = {"idle monitor module", 19},
 	.priority = PJSIP_MOD_PRIORITY_TRANSPORT_LAYER + 3,
 	.on_rx_request = idle_monitor_on_rx_request,
+	.on_rx_response = idle_monitor_on_rx_response,
+	.on_tx_request = idle_monitor_on_tx_message,
+	.on_tx_response = idle_monitor_on_tx_message,
 };
 
 static int load_module(void)
@@ -361,6 +637,15 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	if (ast_sched_add_variable(sched, OUTBOUND_SWEEP_INTERVAL, outbound_sweep_sched_cb, NULL, 1) < 0
+		|| ast_sched_add_variable(sched, 1000, prewarm_sched_cb, NULL, 1) < 0) {
+		ast_log(LOG_ERROR, "Failed to schedule outbound connection management\n");
+		ast_sched_context_destroy(sched);
+		sched = NULL;
+		ao2_global_obj_release(monitored_transports);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	ast_sip_register_service(&idle_monitor_module);
 
 	tpmgr_state_callback = pjsip_tpmgr_get_state_cb(tpmgr);
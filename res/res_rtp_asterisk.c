@@ -69,6 +69,7 @@
 #include "asterisk/rtp_engine.h"
 #include "asterisk/smoother.h"
 #include "asterisk/test.h"
+#include "asterisk/thread_placement.h"
 
 #define MAX_TIMESTAMP_SKEW	640
 
@@ -83,6 +84,8 @@
 #define MINIMUM_RTP_PORT 1024 /*!< Minimum port number to accept */
 #define MAXIMUM_RTP_PORT 65535 /*!< Maximum port number to accept */
 
+#define RTP_PORT_QUARANTINE 10 /*!< Seconds a released port pair is counted as recently used */
+
 #define DEFAULT_TURN_PORT 3478
 
 #define TURN_STATE_WAIT_TIME 2000
@@ -105,10 +108,31 @@
 
 #define DEFAULT_LEARNING_MIN_SEQUENTIAL 4
 
+#define DEFAULT_RECV_BATCH 1
+#define DEFAULT_P2P_RELAY 0
+#define DEFAULT_RTCP_PUBLISH_INTERVAL 0
+
+#define RTP_RELAY_BURST 16	/*!< Most packets the relay thread reads from one socket in a row */
+#define RTP_RELAY_QUEUE_MAX 32	/*!< Most packets handed back to a channel but not yet read */
+
+#ifdef MSG_WAITFORONE
+/* recvmmsg(2) is available */
+#define RTP_RECV_BATCH_MAX 16	/*!< Most RTP datagrams read by one system call */
+#define RTP_RECV_BATCH_SLOT 2048	/*!< Largest datagram accepted past the first of a batch */
+#endif
+
 #define SRTP_MASTER_KEY_LEN 16
 #define SRTP_MASTER_SALT_LEN 14
 #define SRTP_MASTER_LEN (SRTP_MASTER_KEY_LEN + SRTP_MASTER_SALT_LEN)
 
+#if defined(HAVE_OPENSSL_SRTP) && defined(HAVE_SRTP_GCM) && defined(SRTP_AEAD_AES_128_GCM)
+/*! AEAD_AES_128_GCM is offered first for DTLS-SRTP, it is cheaper than HMAC-SHA1 on processors with AES instructions */
+#define DTLS_SRTP_GCM_PROFILES "SRTP_AEAD_AES_128_GCM:"
+#define SRTP_AEAD_SALT_LEN 12
+#else
+#define DTLS_SRTP_GCM_PROFILES ""
+#endif
+
 enum strict_rtp_state {
 	STRICT_RTP_OPEN = 0, /*! No RTP packets should be dropped, all sources accepted */
 	STRICT_RTP_LEARN,    /*! Accept next packet as source */
@@ -117,6 +141,7 @@ enum strict_rtp_state {
 
 #define DEFAULT_STRICT_RTP STRICT_RTP_CLOSED
 #define DEFAULT_ICESUPPORT 1
+#define DEFAULT_IOQUEUE_THREADS 0
 
 extern struct ast_srtp_res *res_srtp;
 extern struct ast_srtp_policy_res *res_srtp_policy;
@@ -138,8 +163,13 @@ static int nochecksums;
 #endif
 static int strictrtp = DEFAULT_STRICT_RTP; /*< Only accept RTP frames from a defined source. If we receive an indication of a changing source, enter learning mode. */
 static int learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL; /*< Number of sequential RTP frames needed from a single source during learning mode to accept new source. */
+static int recvbatch = DEFAULT_RECV_BATCH; /*< Number of RTP datagrams to read from a socket at once. */
+static int p2prelay = DEFAULT_P2P_RELAY; /*< Relay RTP between locally bridged instances from a dedicated thread. */
+static int rtcp_publish_interval = DEFAULT_RTCP_PUBLISH_INTERVAL; /*< Least seconds between RTCP reports published for an instance, 0 to publish all */
+static struct ast_sched_context *rtcp_sched; /*!< Timer wheel and thread sending the RTCP reports of every instance */
 #ifdef HAVE_PJPROJECT
 static int icesupport = DEFAULT_ICESUPPORT;
+static int ioqueue_threads = DEFAULT_IOQUEUE_THREADS; /*!< Most ioqueue threads to spread TURN sockets over, 0 for one per CPU */
 static struct sockaddr_in stunaddr;
 static pj_str_t turnaddr;
 static int turnport = DEFAULT_TURN_PORT;
@@ -185,6 +215,9 @@ struct ast_rtp_ioqueue_thread {
 /*! \brief List of ioqueue threads */
 static AST_LIST_HEAD_STATIC(ioqueues, ast_rtp_ioqueue_thread);
 
+/*! \brief Number of ioqueue threads in the list, protected by the list lock */
+static unsigned int ioqueue_thread_count;
+
 /*! \brief Structure which contains ICE host candidate mapping information */
 struct ast_ice_host_candidate {
 	pj_sockaddr local;
@@ -228,6 +261,17 @@ struct dtls_details {
 #endif
 
 /*! \brief RTP session description */
+/*! \brief A packet the relay thread could not forward, waiting for the channel to read it */
+struct rtp_relay_packet {
+	AST_LIST_ENTRY(rtp_relay_packet) next;
+	/*! Source address of the packet */
+	struct ast_sockaddr addr;
+	/*! Length of the packet */
+	int len;
+	/*! The packet, after DTLS, ICE and SRTP processing */
+	unsigned char data[0];
+};
+
 struct ast_rtp {
 	int s;
 	struct ast_frame f;
@@ -288,6 +332,16 @@ struct ast_rtp {
 	void *data;
 	struct ast_rtcp *rtcp;
 	struct ast_rtp *bridged;        /*!< Who we are Packet bridged to */
+	int port;                       /*!< Port taken from the port allocator, 0 if none */
+
+	/*!
+	 * Pipe polled by the channel instead of the socket while the relay
+	 * thread reads the socket, -1 when not relayed.  The relay fields are
+	 * protected by the relay lock.
+	 */
+	int relay_alert[2];
+	AST_LIST_HEAD_NOLOCK(, rtp_relay_packet) relay_packets; /*!< Packets handed back to the channel */
+	unsigned int relay_queued;      /*!< Length of relay_packets */
 
 	enum strict_rtp_state strict_rtp_state; /*!< Current state that strict RTP protection is in */
 	struct ast_sockaddr strict_rtp_address;  /*!< Remote address information for strict RTP purposes */
@@ -366,7 +420,9 @@ struct ast_rtcp {
 	struct timeval txlsr;		/*!< Time when we sent or last SR*/
 	unsigned int expected_prior;	/*!< no. packets in previous interval */
 	unsigned int received_prior;	/*!< no. packets received in previous interval */
-	int schedid;			/*!< Schedid returned from ast_sched_add() to schedule RTCP-transmissions*/
+	int schedid;			/*!< Schedid returned from ast_sched_add() on rtcp_sched to schedule RTCP-transmissions*/
+	struct timeval published[2];	/*!< When a sent and a received report were last published to stasis */
+	unsigned int unpublished[2];	/*!< Sent and received reports not published since then */
 	unsigned int rr_count;		/*!< number of RRs we've sent, not including report blocks in SR's */
 	unsigned int sr_count;		/*!< number of SRs we've sent */
 	unsigned int lastsrtxcount;     /*!< Transmit packet count when last SR sent */
@@ -1063,9 +1119,11 @@ static void rtp_ioqueue_thread_remove(struct ast_rtp_ioqueue_thread *ioqueue)
 
 	/* If nothing is using this ioqueue thread destroy it */
 	AST_LIST_LOCK(&ioqueues);
-	if ((ioqueue->count - 2) == 0) {
+	ioqueue->count -= 2;
+	if (!ioqueue->count) {
 		destroy = 1;
 		AST_LIST_REMOVE(&ioqueues, ioqueue, next);
+		ioqueue_thread_count--;
 	}
 	AST_LIST_UNLOCK(&ioqueues);
 
@@ -1076,23 +1134,45 @@ static void rtp_ioqueue_thread_remove(struct ast_rtp_ioqueue_thread *ioqueue)
 	rtp_ioqueue_thread_destroy(ioqueue);
 }
 
-/*! \brief Finder and allocator for an ioqueue thread */
+/*! \brief Most ioqueue threads to create before sharing existing ones */
+static unsigned int rtp_ioqueue_thread_max(void)
+{
+	long cpus;
+
+	if (ioqueue_threads > 0) {
+		return ioqueue_threads;
+	}
+
+	cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	return cpus > 0 ? cpus : 1;
+}
+
+/*!
+ * \brief Finder and allocator for an ioqueue thread
+ *
+ * New threads are started until the configured number exist, after which
+ * sessions go to the least loaded thread.  A thread is only started beyond
+ * that number when every existing one is full.
+ */
 static struct ast_rtp_ioqueue_thread *rtp_ioqueue_thread_get_or_create(void)
 {
 	struct ast_rtp_ioqueue_thread *ioqueue;
+	struct ast_rtp_ioqueue_thread *least = NULL;
 	pj_lock_t *lock;
 
 	AST_LIST_LOCK(&ioqueues);
 
-	/* See if an ioqueue thread exists that can handle more */
+	/* Find the least loaded ioqueue thread that can handle more */
 	AST_LIST_TRAVERSE(&ioqueues, ioqueue, next) {
-		if ((ioqueue->count + 2) < PJ_IOQUEUE_MAX_HANDLES) {
-			break;
+		if ((ioqueue->count + 2) < PJ_IOQUEUE_MAX_HANDLES
+			&& (!least || ioqueue->count < least->count)) {
+			least = ioqueue;
 		}
 	}
 
-	/* If we found one bump it up and return it */
-	if (ioqueue) {
+	/* If we found one and may not start another bump it up and return it */
+	if (least && ioqueue_thread_count >= rtp_ioqueue_thread_max()) {
+		ioqueue = least;
 		ioqueue->count += 2;
 		goto end;
 	}
@@ -1126,6 +1206,7 @@ static struct ast_rtp_ioqueue_thread *rtp_ioqueue_thread_get_or_create(void)
 	}
 
 	AST_LIST_INSERT_HEAD(&ioqueues, ioqueue, next);
+	ioqueue_thread_count++;
 
 	/* Since this is being returned to an active session the count always starts at 2 */
 	ioqueue->count = 2;
@@ -1421,9 +1502,9 @@ static int ast_rtp_dtls_set_configuration(struct ast_rtp_instance *instance, con
 		dtls_verify_callback : NULL);
 
 	if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_80) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_80");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_80");
 	} else if (dtls_cfg->suite == AST_AES_CM_128_HMAC_SHA1_32) {
-		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, "SRTP_AES128_CM_SHA1_32");
+		SSL_CTX_set_tlsext_use_srtp(rtp->ssl_ctx, DTLS_SRTP_GCM_PROFILES "SRTP_AES128_CM_SHA1_32");
 	} else {
 		ast_log(LOG_ERROR, "Unsupported suite specified for DTLS-SRTP on RTP instance '%p'\n", instance);
 		return -1;
@@ -2035,6 +2116,16 @@ static int dtls_srtp_setup(struct ast_rtp *rtp, struct ast_srtp *srtp, struct as
 	struct ast_rtp_instance_stats stats = { 0, };
 	int res = -1;
 	struct dtls_details *dtls = !rtcp ? &rtp->dtls : &rtp->rtcp->dtls;
+	enum ast_srtp_suite suite = rtp->suite;
+	int salt_len = SRTP_MASTER_SALT_LEN;
+#ifdef SRTP_AEAD_SALT_LEN
+	SRTP_PROTECTION_PROFILE *profile = SSL_get_selected_srtp_profile(dtls->ssl);
+
+	if (profile && profile->id == SRTP_AEAD_AES_128_GCM) {
+		suite = AST_AES_GCM_128;
+		salt_len = SRTP_AEAD_SALT_LEN;
+	}
+#endif
 
 	/* If a fingerprint is present in the SDP make sure that the peer certificate matches it */
 	if (rtp->dtls_verify & AST_RTP_DTLS_VERIFY_FINGERPRINT) {
@@ -2081,7 +2172,7 @@ static int dtls_srtp_setup(struct ast_rtp *rtp, struct ast_srtp *srtp, struct as
 	}
 
 	/* Produce key information and set up SRTP */
-	if (!SSL_export_keying_material(dtls->ssl, material, SRTP_MASTER_LEN * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
+	if (!SSL_export_keying_material(dtls->ssl, material, (SRTP_MASTER_KEY_LEN + salt_len) * 2, "EXTRACTOR-dtls_srtp", 19, NULL, 0, 0)) {
 		ast_log(LOG_WARNING, "Unable to extract SRTP keying material from DTLS-SRTP negotiation on RTP instance '%p'\n",
 			instance);
 		return -1;
@@ -2092,25 +2183,25 @@ static int dtls_srtp_setup(struct ast_rtp *rtp, struct ast_srtp *srtp, struct as
 		local_key = material;
 		remote_key = local_key + SRTP_MASTER_KEY_LEN;
 		local_salt = remote_key + SRTP_MASTER_KEY_LEN;
-		remote_salt = local_salt + SRTP_MASTER_SALT_LEN;
+		remote_salt = local_salt + salt_len;
 	} else {
 		remote_key = material;
 		local_key = remote_key + SRTP_MASTER_KEY_LEN;
 		remote_salt = local_key + SRTP_MASTER_KEY_LEN;
-		local_salt = remote_salt + SRTP_MASTER_SALT_LEN;
+		local_salt = remote_salt + salt_len;
 	}
 
 	if (!(local_policy = res_srtp_policy->alloc())) {
 		return -1;
 	}
 
-	if (res_srtp_policy->set_master_key(local_policy, local_key, SRTP_MASTER_KEY_LEN, local_salt, SRTP_MASTER_SALT_LEN) < 0) {
+	if (res_srtp_policy->set_master_key(local_policy, local_key, SRTP_MASTER_KEY_LEN, local_salt, salt_len) < 0) {
 		ast_log(LOG_WARNING, "Could not set key/salt information on local policy of '%p' when setting up DTLS-SRTP\n", rtp);
 		goto error;
 	}
 
-	if (res_srtp_policy->set_suite(local_policy, rtp->suite)) {
-		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+	if (res_srtp_policy->set_suite(local_policy, suite)) {
+		ast_log(LOG_WARNING, "Could not set suite to '%u' on local policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 		goto error;
 	}
 
@@ -2124,13 +2215,13 @@ static int dtls_srtp_setup(struct ast_rtp *rtp, struct ast_srtp *srtp, struct as
 		goto error;
 	}
 
-	if (res_srtp_policy->set_master_key(remote_policy, remote_key, SRTP_MASTER_KEY_LEN, remote_salt, SRTP_MASTER_SALT_LEN) < 0) {
+	if (res_srtp_policy->set_master_key(remote_policy, remote_key, SRTP_MASTER_KEY_LEN, remote_salt, salt_len) < 0) {
 		ast_log(LOG_WARNING, "Could not set key/salt information on remote policy of '%p' when setting up DTLS-SRTP\n", rtp);
 		goto error;
 	}
 
-	if (res_srtp_policy->set_suite(remote_policy, rtp->suite)) {
-		ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", rtp->suite, rtp);
+	if (res_srtp_policy->set_suite(remote_policy, suite)) {
+		ast_log(LOG_WARNING, "Could not set suite to '%u' on remote policy of '%p' when setting up DTLS-SRTP\n", suite, rtp);
 		goto error;
 	}
 
@@ -2163,20 +2254,31 @@ error:
 }
 #endif
 
-static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+/*!
+ * \internal
+ * \brief Handle DTLS, ICE and SRTP for a datagram read from an RTP or RTCP socket
+ *
+ * \param instance The RTP instance the datagram was read for
+ * \param buf The datagram, which is decrypted in place
+ * \param len Length of the datagram
+ * \param sa Source address of the datagram
+ * \param rtcp Non-zero if the datagram was read from the RTCP socket
+ *
+ * \return Length of the packet left in \a buf
+ * \retval 0 if the datagram was consumed by DTLS or ICE
+ * \retval -1 on failure
+ */
+static int rtp_recv_process(struct ast_rtp_instance *instance, void *buf, int len, struct ast_sockaddr *sa, int rtcp)
 {
-	int len;
+#if defined(HAVE_OPENSSL_SRTP) || defined(HAVE_PJPROJECT)
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+#endif
 	struct ast_srtp *srtp = ast_rtp_instance_get_srtp(instance, rtcp);
 	char *in = buf;
 #ifdef HAVE_PJPROJECT
 	struct ast_sockaddr *loop = rtcp ? &rtp->rtcp_loop : &rtp->rtp_loop;
 #endif
 
-	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
-	   return len;
-	}
-
 #ifdef HAVE_OPENSSL_SRTP
 	/* If this is an SSL packet pass it to OpenSSL for processing. RFC section for first byte value:
 	 * https://tools.ietf.org/html/rfc5764#section-5.1.2 */
@@ -2279,6 +2381,18 @@ static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t s
 	return len;
 }
 
+static int __rtp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa, int rtcp)
+{
+	int len;
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+	if ((len = ast_recvfrom(rtcp ? rtp->rtcp->s : rtp->s, buf, size, flags, sa)) < 0) {
+	   return len;
+	}
+
+	return rtp_recv_process(instance, buf, len, sa, rtcp);
+}
+
 static int rtcp_recvfrom(struct ast_rtp_instance *instance, void *buf, size_t size, int flags, struct ast_sockaddr *sa)
 {
 	return __rtp_recvfrom(instance, buf, size, flags, sa, 1);
@@ -2388,6 +2502,166 @@ static double stddev_compute(double stddev, double sample, double normdev, doubl
 #undef SQUARE
 }
 
+/*!
+ * \brief Allocator for the even ports of the RTP port range
+ *
+ * Free port pairs wait in a ring in the order they were released, so the
+ * next one is found in O(1) and a released pair is reused only after every
+ * other free pair.  The ring starts out shuffled to keep ports unpredictable.
+ */
+static struct {
+	/*! First port of the first pair */
+	int base;
+	/*! Number of port pairs in the range */
+	unsigned int pairs;
+	/*! A bit set for each pair handed out */
+	unsigned char *used;
+	/*! Free pairs, least recently released first */
+	unsigned int *free;
+	/*! When each pair was last released, 0 if never */
+	time_t *released;
+	/*! Position in free of the next pair to hand out */
+	unsigned int head;
+	/*! Number of pairs in free */
+	unsigned int count;
+	/*! Times a pair could not be bound because something else had it */
+	unsigned int busy;
+} ports;
+
+AST_MUTEX_DEFINE_STATIC(ports_lock);
+
+/*! \brief Put a pair at the back of the free ring, the ports lock must be held */
+static void rtp_port_push(unsigned int pair, time_t now)
+{
+	ports.free[(ports.head + ports.count++) % ports.pairs] = pair;
+	ports.released[pair] = now;
+}
+
+/*!
+ * \internal
+ * \brief Build the port allocator for a new port range
+ *
+ * Pairs which were handed out and are still in the range stay in use.
+ */
+static int rtp_ports_configure(int start, int end)
+{
+	int base = (start + 1) & ~1;
+	unsigned int pairs = (end - base) / 2 + 1;
+	unsigned char *used = ast_calloc(1, (pairs + 7) / 8);
+	unsigned int *free_pairs = ast_calloc(pairs, sizeof(*free_pairs));
+	time_t *released = ast_calloc(pairs, sizeof(*released));
+	unsigned int i;
+
+	if (!used || !free_pairs || !released) {
+		ast_free(used);
+		ast_free(free_pairs);
+		ast_free(released);
+		return -1;
+	}
+
+	ast_mutex_lock(&ports_lock);
+	for (i = 0; i < ports.pairs; i++) {
+		int port = ports.base + i * 2;
+
+		if ((ports.used[i / 8] & (1 << (i % 8))) && port >= base && port <= end) {
+			unsigned int pair = (port - base) / 2;
+
+			used[pair / 8] |= 1 << (pair % 8);
+		}
+	}
+
+	ast_free(ports.used);
+	ast_free(ports.free);
+	ast_free(ports.released);
+	ports.base = base;
+	ports.pairs = pairs;
+	ports.used = used;
+	ports.free = free_pairs;
+	ports.released = released;
+	ports.head = ports.count = 0;
+
+	for (i = 0; i < pairs; i++) {
+		if (!(used[i / 8] & (1 << (i % 8)))) {
+			rtp_port_push(i, 0);
+		}
+	}
+	/* Fisher-Yates, so the order ports are handed out in is not predictable */
+	for (i = ports.count; i > 1; i--) {
+		unsigned int j = ast_random() % i;
+		unsigned int pair = free_pairs[i - 1];
+
+		free_pairs[i - 1] = free_pairs[j];
+		free_pairs[j] = pair;
+	}
+	ast_mutex_unlock(&ports_lock);
+
+	return 0;
+}
+
+static void rtp_ports_destroy(void)
+{
+	ast_mutex_lock(&ports_lock);
+	ast_free(ports.used);
+	ast_free(ports.free);
+	ast_free(ports.released);
+	memset(&ports, 0, sizeof(ports));
+	ast_mutex_unlock(&ports_lock);
+}
+
+/*!
+ * \internal
+ * \brief Take the least recently released free port pair
+ *
+ * \return The even port of the pair
+ * \retval -1 if every pair is in use
+ */
+static int rtp_port_take(void)
+{
+	unsigned int pair;
+
+	ast_mutex_lock(&ports_lock);
+	if (!ports.count) {
+		ast_mutex_unlock(&ports_lock);
+		return -1;
+	}
+
+	pair = ports.free[ports.head];
+	ports.head = (ports.head + 1) % ports.pairs;
+	ports.count--;
+	ports.used[pair / 8] |= 1 << (pair % 8);
+	ast_mutex_unlock(&ports_lock);
+
+	return ports.base + pair * 2;
+}
+
+/*!
+ * \internal
+ * \brief Give a port pair back to the allocator
+ *
+ * \param port The even port of the pair
+ * \param busy Non-zero if the pair is being given back because it could
+ *        not be bound
+ */
+static void rtp_port_release(int port, int busy)
+{
+	unsigned int pair;
+
+	ast_mutex_lock(&ports_lock);
+	/* The range may have changed since the pair was taken */
+	if (port < ports.base || (pair = (port - ports.base) / 2) >= ports.pairs
+		|| !(ports.used[pair / 8] & (1 << (pair % 8)))) {
+		ast_mutex_unlock(&ports_lock);
+		return;
+	}
+
+	ports.used[pair / 8] &= ~(1 << (pair % 8));
+	rtp_port_push(pair, time(NULL));
+	if (busy) {
+		ports.busy++;
+	}
+	ast_mutex_unlock(&ports_lock);
+}
+
 static int create_new_socket(const char *type, int af)
 {
 	int sock = socket(af, SOCK_DGRAM, 0);
@@ -2636,7 +2910,8 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 		       void *data)
 {
 	struct ast_rtp *rtp = NULL;
-	int x, startplace;
+	int x;
+	unsigned int tries;
 
 	/* Create a new RTP structure to hold all of our data */
 	if (!(rtp = ast_calloc(1, sizeof(*rtp)))) {
@@ -2648,6 +2923,7 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 	ast_cond_init(&rtp->cond, NULL);
 
 	/* Set default parameters on the newly created RTP structure */
+	rtp->relay_alert[0] = rtp->relay_alert[1] = -1;
 	rtp->ssrc = ast_random();
 	rtp->seqno = ast_random() & 0x7fff;
 	rtp->strict_rtp_state = (strictrtp ? STRICT_RTP_LEARN : STRICT_RTP_OPEN);
@@ -2666,27 +2942,33 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 		return -1;
 	}
 
-	/* Now actually find a free RTP port to use */
-	x = (rtpend == rtpstart) ? rtpstart : (ast_random() % (rtpend - rtpstart)) + rtpstart;
-	x = x & ~1;
-	startplace = x;
+	/* Now actually find a free RTP port to use, trying each free pair at most once */
+	ast_mutex_lock(&ports_lock);
+	tries = ports.count;
+	ast_mutex_unlock(&ports_lock);
 
 	for (;;) {
+		if (!tries-- || (x = rtp_port_take()) < 0) {
+			ast_log(LOG_ERROR, "Oh dear... we couldn't allocate a port for RTP instance '%p'\n", instance);
+			close(rtp->s);
+			ast_free(rtp);
+			return -1;
+		}
+
 		ast_sockaddr_set_port(addr, x);
 		/* Try to bind, this will tell us whether the port is available or not */
 		if (!ast_bind(rtp->s, addr)) {
 			ast_debug(1, "Allocated port %d for RTP instance '%p'\n", x, instance);
 			ast_rtp_instance_set_local_address(instance, addr);
+			rtp->port = x;
 			break;
 		}
 
-		x += 2;
-		if (x > rtpend) {
-			x = (rtpstart + 1) & ~1;
-		}
+		/* Something outside of us has the port, so move on to the next pair */
+		rtp_port_release(x, 1);
 
-		/* See if we ran out of ports or if the bind actually failed because of something other than the address being in use */
-		if (x == startplace || (errno != EADDRINUSE && errno != EACCES)) {
+		/* See if the bind actually failed because of something other than the address being in use */
+		if (errno != EADDRINUSE && errno != EACCES) {
 			ast_log(LOG_ERROR, "Oh dear... we couldn't allocate a port for RTP instance '%p'\n", instance);
 			close(rtp->s);
 			ast_free(rtp);
@@ -2730,6 +3012,7 @@ static int ast_rtp_new(struct ast_rtp_instance *instance,
 static int ast_rtp_destroy(struct ast_rtp_instance *instance)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct rtp_relay_packet *packet;
 #ifdef HAVE_PJPROJECT
 	struct timeval wait = ast_tvadd(ast_tvnow(), ast_samp2tv(TURN_STATE_WAIT_TIME, 1000));
 	struct timespec ts = { .tv_sec = wait.tv_sec, .tv_nsec = wait.tv_usec * 1000, };
@@ -2744,10 +3027,21 @@ static int ast_rtp_destroy(struct ast_rtp_instance *instance)
 		ast_smoother_free(rtp->smoother);
 	}
 
+	/* The relay thread holds a reference while relaying, so only handed back packets can be left */
+	ast_assert(rtp->relay_alert[0] < 0);
+	AST_LIST_TRAVERSE_SAFE_BEGIN(&rtp->relay_packets, packet, next) {
+		AST_LIST_REMOVE_CURRENT(next);
+		ast_free(packet);
+	}
+	AST_LIST_TRAVERSE_SAFE_END;
+
 	/* Close our own socket so we no longer get packets */
 	if (rtp->s > -1) {
 		close(rtp->s);
 	}
+	if (rtp->port) {
+		rtp_port_release(rtp->port, 0);
+	}
 
 	/* Destroy RTCP if it was being used */
 	if (rtp->rtcp) {
@@ -3172,6 +3466,40 @@ static void calculate_lost_packet_statistics(struct ast_rtp *rtp,
 	rtp->rtcp->rxlost_count++;
 }
 
+/*!
+ * \brief Decide whether an RTCP report is published to stasis
+ *
+ * \param rtcp The RTCP session of the instance
+ * \param received Non-zero for a report from the far end, zero for one we sent
+ *
+ * With rtcppublishinterval set at most one report in each direction is
+ * published per instance and interval.
+ *
+ * \retval -1 if the report is not published
+ * \return the number of reports skipped since the last one published
+ */
+static int rtcp_publish_skipped(struct ast_rtcp *rtcp, int received)
+{
+	struct timeval now;
+	int skipped;
+
+	if (!rtcp_publish_interval) {
+		return 0;
+	}
+
+	now = ast_tvnow();
+	if (!ast_tvzero(rtcp->published[received])
+		&& ast_tvdiff_ms(now, rtcp->published[received]) < rtcp_publish_interval * 1000) {
+		rtcp->unpublished[received]++;
+		return -1;
+	}
+
+	rtcp->published[received] = now;
+	skipped = rtcp->unpublished[received];
+	rtcp->unpublished[received] = 0;
+	return skipped;
+}
+
 /*! \brief Send RTCP SR or RR report */
 static int ast_rtcp_write_report(struct ast_rtp_instance *instance, int sr)
 {
@@ -3192,6 +3520,7 @@ static int ast_rtcp_write_report(struct ast_rtp_instance *instance, int sr)
 	int header_offset = 0;
 	struct ast_sockaddr remote_address = { { 0, } };
 	struct ast_rtp_rtcp_report_block *report_block = NULL;
+	int skipped;
 	RAII_VAR(struct ast_rtp_rtcp_report *, rtcp_report,
 			ast_rtp_rtcp_report_alloc(rtp->themssrc ? 1 : 0),
 			ao2_cleanup);
@@ -3317,9 +3646,14 @@ static int ast_rtcp_write_report(struct ast_rtp_instance *instance, int sr)
 		}
 	}
 
-	message_blob = ast_json_pack("{s: s, s: s}",
+	if ((skipped = rtcp_publish_skipped(rtp->rtcp, 0)) < 0) {
+		return res;
+	}
+
+	message_blob = ast_json_pack("{s: s, s: s, s: i}",
 			"to", ast_sockaddr_stringify(&remote_address),
-			"from", rtp->rtcp->local_addr_str);
+			"from", rtp->rtcp->local_addr_str,
+			"skipped", skipped);
 	ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_sent_type(),
 			rtcp_report,
 			message_blob);
@@ -3464,7 +3798,7 @@ static int ast_rtp_raw_write(struct ast_rtp_instance *instance, struct ast_frame
 			if (rtp->rtcp && rtp->rtcp->schedid < 0) {
 				ast_debug(1, "Starting RTCP transmission on RTP instance '%p'\n", instance);
 				ao2_ref(instance, +1);
-				rtp->rtcp->schedid = ast_sched_add(rtp->sched, ast_rtcp_calc_interval(rtp), ast_rtcp_write, instance);
+				rtp->rtcp->schedid = ast_sched_add(rtcp_sched, ast_rtcp_calc_interval(rtp), ast_rtcp_write, instance);
 				if (rtp->rtcp->schedid < 0) {
 					ao2_ref(instance, -1);
 					ast_log(LOG_WARNING, "scheduling RTCP transmission failed.\n");
@@ -4138,6 +4472,7 @@ static struct ast_frame *ast_rtcp_read(struct ast_rtp_instance *instance)
 	unsigned int *rtcpheader = (unsigned int *)(rtcpdata + AST_FRIENDLY_OFFSET);
 	int res, packetwords, position = 0;
 	int report_counter = 0;
+	int skipped;
 	struct ast_rtp_rtcp_report_block *report_block;
 	struct ast_frame *f = &ast_null_frame;
 
@@ -4312,10 +4647,14 @@ static struct ast_frame *ast_rtcp_read(struct ast_rtp_instance *instance)
 			 * this loop.
 			 */
 
-			message_blob = ast_json_pack("{s: s, s: s, s: f}",
+			if ((skipped = rtcp_publish_skipped(rtp->rtcp, 1)) < 0) {
+				break;
+			}
+			message_blob = ast_json_pack("{s: s, s: s, s: f, s: i}",
 					"from", ast_sockaddr_stringify(&rtp->rtcp->them),
 					"to", rtp->rtcp->local_addr_str,
-					"rtt", rtp->rtcp->rtt);
+					"rtt", rtp->rtcp->rtt,
+					"skipped", skipped);
 			ast_rtp_publish_rtcp_message(instance, ast_rtp_rtcp_received_type(),
 					rtcp_report,
 					message_blob);
@@ -4464,42 +4803,26 @@ static int bridge_p2p_rtp_write(struct ast_rtp_instance *instance, unsigned int
 	return 0;
 }
 
-static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+/*!
+ * \internal
+ * \brief Turn an RTP packet read into the instance's raw data buffer into frames
+ *
+ * \param instance The RTP instance the packet was read for
+ * \param res Length of the packet, as returned by rtp_recv_process()
+ * \param addr Source address of the packet
+ *
+ * \return The frame, or list of frames, read from the packet
+ * \retval &ast_null_frame if the packet produced no frames
+ */
+static struct ast_frame *rtp_read_packet(struct ast_rtp_instance *instance, int res, struct ast_sockaddr *addr)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
-	struct ast_sockaddr addr;
-	int res, hdrlen = 12, version, payloadtype, padding, mark, ext, cc, prev_seqno;
+	int hdrlen = 12, version, payloadtype, padding, mark, ext, cc, prev_seqno;
 	unsigned int *rtpheader = (unsigned int*)(rtp->rawdata + AST_FRIENDLY_OFFSET), seqno, ssrc, timestamp;
 	RAII_VAR(struct ast_rtp_payload_type *, payload, NULL, ao2_cleanup);
 	struct ast_sockaddr remote_address = { {0,} };
 	struct frame_list frames;
 
-	/* If this is actually RTCP let's hop on over and handle it */
-	if (rtcp) {
-		if (rtp->rtcp) {
-			return ast_rtcp_read(instance);
-		}
-		return &ast_null_frame;
-	}
-
-	/* If we are currently sending DTMF to the remote party send a continuation packet */
-	if (rtp->sending_digit) {
-		ast_rtp_dtmf_continuation(instance);
-	}
-
-	/* Actually read in the data from the socket */
-	if ((res = rtp_recvfrom(instance, rtp->rawdata + AST_FRIENDLY_OFFSET,
-				sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET, 0,
-				&addr)) < 0) {
-		ast_assert(errno != EBADF);
-		if (errno != EAGAIN) {
-			ast_log(LOG_WARNING, "RTP Read error: %s.  Hanging up.\n",
-				(errno) ? strerror(errno) : "Unspecified");
-			return NULL;
-		}
-		return &ast_null_frame;
-	}
-
 	/* If this was handled by the ICE session don't do anything */
 	if (!res) {
 		return &ast_null_frame;
@@ -4526,30 +4849,30 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	if (!(version = (seqno & 0xC0000000) >> 30)) {
 		struct sockaddr_in addr_tmp;
 		struct ast_sockaddr addr_v4;
-		if (ast_sockaddr_is_ipv4(&addr)) {
-			ast_sockaddr_to_sin(&addr, &addr_tmp);
-		} else if (ast_sockaddr_ipv4_mapped(&addr, &addr_v4)) {
+		if (ast_sockaddr_is_ipv4(addr)) {
+			ast_sockaddr_to_sin(addr, &addr_tmp);
+		} else if (ast_sockaddr_ipv4_mapped(addr, &addr_v4)) {
 			ast_debug(1, "Using IPv6 mapped address %s for STUN\n",
-				  ast_sockaddr_stringify(&addr));
+				  ast_sockaddr_stringify(addr));
 			ast_sockaddr_to_sin(&addr_v4, &addr_tmp);
 		} else {
 			ast_debug(1, "Cannot do STUN for non IPv4 address %s\n",
-				  ast_sockaddr_stringify(&addr));
+				  ast_sockaddr_stringify(addr));
 			return &ast_null_frame;
 		}
 		if ((ast_stun_handle_packet(rtp->s, &addr_tmp, rtp->rawdata + AST_FRIENDLY_OFFSET, res, NULL, NULL) == AST_STUN_ACCEPT) &&
 		    ast_sockaddr_isnull(&remote_address)) {
-			ast_sockaddr_from_sin(&addr, &addr_tmp);
-			ast_rtp_instance_set_remote_address(instance, &addr);
+			ast_sockaddr_from_sin(addr, &addr_tmp);
+			ast_rtp_instance_set_remote_address(instance, addr);
 		}
 		return &ast_null_frame;
 	}
 
 	/* If strict RTP protection is enabled see if we need to learn the remote address or if we need to drop the packet */
 	if (rtp->strict_rtp_state == STRICT_RTP_LEARN) {
-		ast_debug(1, "%p -- Probation learning mode pass with source address %s\n", rtp, ast_sockaddr_stringify(&addr));
+		ast_debug(1, "%p -- Probation learning mode pass with source address %s\n", rtp, ast_sockaddr_stringify(addr));
 		/* For now, we always copy the address. */
-		ast_sockaddr_copy(&rtp->strict_rtp_address, &addr);
+		ast_sockaddr_copy(&rtp->strict_rtp_address, addr);
 
 		/* Send the rtp and the seqno from header to rtp_learning_rtp_seq_update to see whether we can exit or not*/
 		if (rtp_learning_rtp_seq_update(&rtp->rtp_source_learn, seqno)) {
@@ -4558,11 +4881,11 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 			return &ast_null_frame;
 		}
 
-		ast_verb(4, "%p -- Probation passed - setting RTP source address to %s\n", rtp, ast_sockaddr_stringify(&addr));
+		ast_verb(4, "%p -- Probation passed - setting RTP source address to %s\n", rtp, ast_sockaddr_stringify(addr));
 		rtp->strict_rtp_state = STRICT_RTP_CLOSED;
 	}
 	if (rtp->strict_rtp_state == STRICT_RTP_CLOSED) {
-		if (!ast_sockaddr_cmp(&rtp->strict_rtp_address, &addr)) {
+		if (!ast_sockaddr_cmp(&rtp->strict_rtp_address, addr)) {
 			/* Always reset the alternate learning source */
 			rtp_learning_seq_init(&rtp->alt_source_learn, seqno);
 		} else {
@@ -4572,23 +4895,23 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 			 */
 			if (rtp_learning_rtp_seq_update(&rtp->alt_source_learn, seqno)) {
 				ast_debug(1, "%p -- Received RTP packet from %s, dropping due to strict RTP protection. Will switch to it in %d packets\n",
-						rtp, ast_sockaddr_stringify(&addr), rtp->alt_source_learn.packets);
+						rtp, ast_sockaddr_stringify(addr), rtp->alt_source_learn.packets);
 				return &ast_null_frame;
 			}
-			ast_verb(4, "%p -- Switching RTP source address to %s\n", rtp, ast_sockaddr_stringify(&addr));
-			ast_sockaddr_copy(&rtp->strict_rtp_address, &addr);
+			ast_verb(4, "%p -- Switching RTP source address to %s\n", rtp, ast_sockaddr_stringify(addr));
+			ast_sockaddr_copy(&rtp->strict_rtp_address, addr);
 		}
 	}
 
 	/* If symmetric RTP is enabled see if the remote side is not what we expected and change where we are sending audio */
 	if (ast_rtp_instance_get_prop(instance, AST_RTP_PROPERTY_NAT)) {
-		if (ast_sockaddr_cmp(&remote_address, &addr)) {
+		if (ast_sockaddr_cmp(&remote_address, addr)) {
 			/* do not update the originally given address, but only the remote */
-			ast_rtp_instance_set_incoming_source_address(instance, &addr);
-			ast_sockaddr_copy(&remote_address, &addr);
+			ast_rtp_instance_set_incoming_source_address(instance, addr);
+			ast_sockaddr_copy(&remote_address, addr);
 			if (rtp->rtcp) {
-				ast_sockaddr_copy(&rtp->rtcp->them, &addr);
-				ast_sockaddr_set_port(&rtp->rtcp->them, ast_sockaddr_port(&addr) + 1);
+				ast_sockaddr_copy(&rtp->rtcp->them, addr);
+				ast_sockaddr_set_port(&rtp->rtcp->them, ast_sockaddr_port(addr) + 1);
 			}
 			rtp->rxseqno = 0;
 			ast_set_flag(rtp, FLAG_NAT_ACTIVE);
@@ -4691,7 +5014,7 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	if (rtp->rtcp && !ast_sockaddr_isnull(&rtp->rtcp->them) && rtp->rtcp->schedid < 0) {
 		/* Schedule transmission of Receiver Report */
 		ao2_ref(instance, +1);
-		rtp->rtcp->schedid = ast_sched_add(rtp->sched, ast_rtcp_calc_interval(rtp), ast_rtcp_write, instance);
+		rtp->rtcp->schedid = ast_sched_add(rtcp_sched, ast_rtcp_calc_interval(rtp), ast_rtcp_write, instance);
 		if (rtp->rtcp->schedid < 0) {
 			ao2_ref(instance, -1);
 			ast_log(LOG_WARNING, "scheduling RTCP transmission failed.\n");
@@ -4707,9 +5030,9 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 		rtp->themssrc = ntohl(rtpheader[2]); /* Record their SSRC to put in future RR */
 	}
 
-	if (rtp_debug_test_addr(&addr)) {
+	if (rtp_debug_test_addr(addr)) {
 		ast_verbose("Got  RTP packet from    %s (type %-2.2d, seq %-6.6u, ts %-6.6u, len %-6.6d)\n",
-			    ast_sockaddr_stringify(&addr),
+			    ast_sockaddr_stringify(addr),
 			    payloadtype, seqno, timestamp,res - hdrlen);
 	}
 
@@ -4727,11 +5050,11 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 			 * by passing the pointer to the frame list to it so that the method
 			 * can append frames to the list as needed.
 			 */
-			process_dtmf_rfc2833(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, &addr, payloadtype, mark, &frames);
+			process_dtmf_rfc2833(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, addr, payloadtype, mark, &frames);
 		} else if (payload->rtp_code == AST_RTP_CISCO_DTMF) {
-			f = process_dtmf_cisco(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, &addr, payloadtype, mark);
+			f = process_dtmf_cisco(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, addr, payloadtype, mark);
 		} else if (payload->rtp_code == AST_RTP_CN) {
-			f = process_cn_rfc3389(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, &addr, payloadtype, mark);
+			f = process_cn_rfc3389(instance, rtp->rawdata + AST_FRIENDLY_OFFSET + hdrlen, res - hdrlen, seqno, timestamp, addr, payloadtype, mark);
 		} else {
 			ast_log(LOG_NOTICE, "Unknown RTP codec %d received from '%s'\n",
 				payloadtype,
@@ -4890,56 +5213,629 @@ static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtc
 	return AST_LIST_FIRST(&frames);
 }
 
-static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value)
+/*!
+ * \internal
+ * \brief Handle a failed read from the RTP socket
+ *
+ * \retval NULL if the channel should be hung up
+ * \retval &ast_null_frame if the failure was temporary
+ */
+static struct ast_frame *rtp_read_failed(void)
+{
+	ast_assert(errno != EBADF);
+	if (errno != EAGAIN) {
+		ast_log(LOG_WARNING, "RTP Read error: %s.  Hanging up.\n",
+			(errno) ? strerror(errno) : "Unspecified");
+		return NULL;
+	}
+	return &ast_null_frame;
+}
+
+#ifdef RTP_RECV_BATCH_MAX
+/*! \brief Per-thread buffers for reading a batch of RTP datagrams */
+struct rtp_recv_batch {
+	struct mmsghdr msgs[RTP_RECV_BATCH_MAX];
+	struct iovec iov[RTP_RECV_BATCH_MAX];
+	struct ast_sockaddr addrs[RTP_RECV_BATCH_MAX];
+	/*! The first datagram is read into the instance's own buffer */
+	unsigned char slots[RTP_RECV_BATCH_MAX - 1][RTP_RECV_BATCH_SLOT];
+};
+
+AST_THREADSTORAGE(rtp_recv_batch_buf);
+
+/*!
+ * \internal
+ * \brief Read every datagram waiting on the RTP socket with one system call
+ *
+ * The first datagram is received straight into the instance's raw data
+ * buffer and the rest into per-thread slots.  Each is then copied into the raw
+ * data buffer in turn and handled as if it had been read on its own.  Frames
+ * from all but the last datagram are duplicated, since the next datagram
+ * reuses the instance's frame and buffer; the channel queues everything
+ * past the first frame of the returned list.
+ *
+ * \return The frames read, as a list
+ * \retval &ast_null_frame if nothing produced a frame
+ * \retval NULL if the channel should be hung up
+ */
+static struct ast_frame *rtp_read_batch(struct ast_rtp_instance *instance)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct rtp_recv_batch *batch;
+	struct frame_list frames;
+	struct ast_sockaddr addr;
+	int received;
+	int i;
 
-	if (property == AST_RTP_PROPERTY_RTCP) {
-		if (value) {
-			struct ast_sockaddr local_addr;
+	batch = ast_threadstorage_get(&rtp_recv_batch_buf, sizeof(*batch));
+	if (!batch) {
+		return NULL;
+	}
 
-			if (rtp->rtcp) {
-				ast_debug(1, "Ignoring duplicate RTCP property on RTP instance '%p'\n", instance);
-				return;
-			}
-			/* Setup RTCP to be activated on the next RTP write */
-			if (!(rtp->rtcp = ast_calloc(1, sizeof(*rtp->rtcp)))) {
-				return;
-			}
+	for (i = 0; i < recvbatch; i++) {
+		if (i) {
+			batch->iov[i].iov_base = batch->slots[i - 1];
+			batch->iov[i].iov_len = sizeof(batch->slots[i - 1]);
+		} else {
+			batch->iov[i].iov_base = rtp->rawdata + AST_FRIENDLY_OFFSET;
+			batch->iov[i].iov_len = sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET;
+		}
+		memset(&batch->msgs[i].msg_hdr, 0, sizeof(batch->msgs[i].msg_hdr));
+		batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i].ss;
+		batch->msgs[i].msg_hdr.msg_namelen = sizeof(batch->addrs[i].ss);
+		batch->msgs[i].msg_hdr.msg_iov = &batch->iov[i];
+		batch->msgs[i].msg_hdr.msg_iovlen = 1;
+	}
 
-			/* Grab the IP address and port we are going to use */
-			ast_rtp_instance_get_local_address(instance, &rtp->rtcp->us);
-			ast_sockaddr_set_port(&rtp->rtcp->us,
-					      ast_sockaddr_port(&rtp->rtcp->us) + 1);
+	if ((received = recvmmsg(rtp->s, batch->msgs, recvbatch, MSG_DONTWAIT, NULL)) < 0) {
+		return rtp_read_failed();
+	}
 
-			if (!ast_find_ourip(&local_addr, &rtp->rtcp->us, 0)) {
-				ast_sockaddr_set_port(&local_addr, ast_sockaddr_port(&rtp->rtcp->us));
-			} else {
-				ast_sockaddr_copy(&local_addr, &rtp->rtcp->us);
+	AST_LIST_HEAD_INIT_NOLOCK(&frames);
+	for (i = 0; i < received; i++) {
+		struct ast_frame *f;
+		struct ast_frame *next;
+		int res = batch->msgs[i].msg_len;
+
+		if (i) {
+			if (batch->msgs[i].msg_hdr.msg_flags & MSG_TRUNC) {
+				ast_debug(1, "%p -- Dropping RTP packet larger than %d bytes\n",
+					rtp, (int) sizeof(batch->slots[i - 1]));
+				continue;
 			}
+			memcpy(rtp->rawdata + AST_FRIENDLY_OFFSET, batch->slots[i - 1], res);
+		}
+		ast_sockaddr_copy(&addr, &batch->addrs[i]);
+		addr.len = batch->msgs[i].msg_hdr.msg_namelen;
 
-			rtp->rtcp->local_addr_str = ast_strdup(ast_sockaddr_stringify(&local_addr));
-			if (!rtp->rtcp->local_addr_str) {
-				ast_free(rtp->rtcp);
-				rtp->rtcp = NULL;
-				return;
+		if ((res = rtp_recv_process(instance, rtp->rawdata + AST_FRIENDLY_OFFSET, res, &addr, 0)) < 0) {
+			f = rtp_read_failed();
+		} else {
+			f = rtp_read_packet(instance, res, &addr);
+		}
+		if (!f) {
+			if (AST_LIST_FIRST(&frames)) {
+				ast_frfree(AST_LIST_FIRST(&frames));
 			}
+			return NULL;
+		}
+		if (f == &ast_null_frame) {
+			continue;
+		}
 
-			if ((rtp->rtcp->s =
-			     create_new_socket("RTCP",
-					       ast_sockaddr_is_ipv4(&rtp->rtcp->us) ?
-					       AF_INET :
-					       ast_sockaddr_is_ipv6(&rtp->rtcp->us) ?
-					       AF_INET6 : -1)) < 0) {
-				ast_debug(1, "Failed to create a new socket for RTCP on instance '%p'\n", instance);
-				ast_free(rtp->rtcp->local_addr_str);
-				ast_free(rtp->rtcp);
-				rtp->rtcp = NULL;
-				return;
+		if (i == received - 1) {
+			/* Frames of the last datagram may point into the instance. */
+			for (; f; f = next) {
+				next = AST_LIST_NEXT(f, frame_list);
+				AST_LIST_INSERT_TAIL(&frames, f, frame_list);
 			}
+			break;
+		}
 
-			/* Try to actually bind to the IP address and port we are going to use for RTCP, if this fails we have to bail out */
-			if (ast_bind(rtp->rtcp->s, &rtp->rtcp->us)) {
+		for (next = f; next; next = AST_LIST_NEXT(next, frame_list)) {
+			struct ast_frame *dup = ast_frdup(next);
+
+			if (dup) {
+				AST_LIST_INSERT_TAIL(&frames, dup, frame_list);
+			}
+		}
+		ast_frfree(f);
+	}
+
+	return AST_LIST_FIRST(&frames) ? AST_LIST_FIRST(&frames) : &ast_null_frame;
+}
+#endif
+
+/*! \brief Lock protecting the relay thread state and the relay fields of every instance */
+AST_MUTEX_DEFINE_STATIC(relay_lock);
+
+/*! \brief The thread relaying RTP between locally bridged instances */
+static struct {
+	/*! The relay thread, AST_PTHREADT_NULL until the first instance is relayed */
+	pthread_t thread;
+	/*! Wakes the relay thread when instances are added or removed */
+	int alert[2];
+	/*! Instances whose sockets the thread reads, each holding a reference */
+	AST_VECTOR(, struct ast_rtp_instance *) instances;
+	/*! Set when instances changed since the thread last built its poll set */
+	unsigned int changed:1;
+	/*! Set to make the thread exit */
+	unsigned int stop:1;
+	/*! Buffer packets are read into, only used by the relay thread */
+	unsigned char buf[8192];
+} relay = {
+	.thread = AST_PTHREADT_NULL,
+	.alert = { -1, -1 },
+};
+
+static void rtp_relay_alert(int fd)
+{
+	char c = 0;
+
+	if (write(fd, &c, 1) < 0 && errno != EAGAIN) {
+		ast_log(LOG_WARNING, "Failed to write to RTP relay alert pipe: %s\n", strerror(errno));
+	}
+}
+
+static int rtp_relay_pipe(int fds[2])
+{
+	if (pipe(fds)) {
+		return -1;
+	}
+	fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+	fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+	return 0;
+}
+
+static void rtp_relay_pipe_close(int fds[2])
+{
+	close(fds[0]);
+	close(fds[1]);
+	fds[0] = fds[1] = -1;
+}
+
+/*!
+ * \internal
+ * \brief Forward a packet read by the relay thread to the bridged instance
+ *
+ * Only packets which need none of the handling ast_rtp_read() does besides
+ * bridge_p2p_rtp_write() are forwarded here.
+ *
+ * \retval 0 if the packet was forwarded or dropped
+ * \retval -1 if the packet must be handed back to the channel
+ */
+static int rtp_relay_forward(struct ast_rtp_instance *instance, int len, struct ast_sockaddr *addr)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	unsigned int *rtpheader = (unsigned int *) relay.buf;
+	unsigned int seqno;
+
+	/* The DTMF continuation packets are paced by the channel's reads */
+	if (len < 12 || rtp->sending_digit || !ast_rtp_instance_get_bridged(instance)) {
+		return -1;
+	}
+
+	seqno = ntohl(rtpheader[0]);
+	if ((seqno & 0xC0000000) >> 30 != 2) {
+		return -1;
+	}
+
+	if (rtp->strict_rtp_state == STRICT_RTP_LEARN) {
+		return -1;
+	}
+	if (rtp->strict_rtp_state == STRICT_RTP_CLOSED) {
+		if (ast_sockaddr_cmp(&rtp->strict_rtp_address, addr)) {
+			return -1;
+		}
+		/* Always reset the alternate learning source */
+		rtp_learning_seq_init(&rtp->alt_source_learn, seqno);
+	}
+
+	if (ast_rtp_instance_get_prop(instance, AST_RTP_PROPERTY_NAT)) {
+		struct ast_sockaddr remote_address = { {0,} };
+
+		ast_rtp_instance_get_remote_address(instance, &remote_address);
+		if (ast_sockaddr_cmp(&remote_address, addr)) {
+			return -1;
+		}
+	}
+
+	return bridge_p2p_rtp_write(instance, rtpheader, len, 12);
+}
+
+/*!
+ * \internal
+ * \brief Queue a packet the relay thread could not forward for the channel
+ *
+ * \note The relay lock must be held.
+ */
+static void rtp_relay_hand_back(struct ast_rtp_instance *instance, int len, struct ast_sockaddr *addr)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct rtp_relay_packet *packet;
+
+	if (rtp->relay_queued >= RTP_RELAY_QUEUE_MAX) {
+		ast_debug(1, "%p -- Dropping relayed RTP packet, the channel is not reading\n", rtp);
+		return;
+	}
+
+	packet = ast_calloc(1, sizeof(*packet) + len);
+	if (!packet) {
+		return;
+	}
+	ast_sockaddr_copy(&packet->addr, addr);
+	packet->len = len;
+	memcpy(packet->data, relay.buf, len);
+
+	AST_LIST_INSERT_TAIL(&rtp->relay_packets, packet, next);
+	rtp->relay_queued++;
+	rtp_relay_alert(rtp->relay_alert[1]);
+}
+
+/*!
+ * \internal
+ * \brief Read the packets waiting on a relayed instance's socket
+ */
+static void rtp_relay_read(struct ast_rtp_instance *instance)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	int i;
+
+	ast_mutex_lock(&relay_lock);
+
+	/* The instance may have stopped being relayed since the poll set was built */
+	for (i = 0; rtp->relay_alert[1] > -1 && i < RTP_RELAY_BURST; i++) {
+		struct ast_sockaddr addr;
+		int len;
+
+		if ((len = rtp_recvfrom(instance, relay.buf, sizeof(relay.buf), 0, &addr)) < 0) {
+			if (errno != EAGAIN) {
+				ast_debug(1, "%p -- RTP relay read error: %s\n", rtp, strerror(errno));
+			}
+			break;
+		}
+
+		/* If this was handled by the ICE session don't do anything */
+		if (!len) {
+			continue;
+		}
+
+		if (rtp_relay_forward(instance, len, &addr)) {
+			rtp_relay_hand_back(instance, len, &addr);
+		}
+	}
+
+	ast_mutex_unlock(&relay_lock);
+}
+
+static void *rtp_relay_thread(void *data)
+{
+	struct pollfd *fds = NULL;
+	struct ast_rtp_instance **instances = NULL;
+	size_t count = 0;
+	size_t i;
+
+	ast_thread_place(AST_THREAD_ROLE_RTP, -1);
+
+	for (;;) {
+		ast_mutex_lock(&relay_lock);
+		if (relay.stop) {
+			ast_mutex_unlock(&relay_lock);
+			break;
+		}
+		if (relay.changed) {
+			size_t size = AST_VECTOR_SIZE(&relay.instances);
+			struct pollfd *new_fds = ast_realloc(fds, sizeof(*fds) * (size + 1));
+			struct ast_rtp_instance **new_instances = new_fds ?
+				ast_realloc(instances, sizeof(*instances) * (size + 1)) : NULL;
+
+			if (new_fds) {
+				fds = new_fds;
+			}
+			if (new_instances) {
+				instances = new_instances;
+				for (i = 0; i < count; i++) {
+					ao2_ref(instances[i], -1);
+				}
+				count = size;
+
+				fds[0].fd = relay.alert[0];
+				fds[0].events = POLLIN;
+				for (i = 0; i < count; i++) {
+					struct ast_rtp *rtp;
+
+					instances[i] = ao2_bump(AST_VECTOR_GET(&relay.instances, i));
+					rtp = ast_rtp_instance_get_data(instances[i]);
+					fds[i + 1].fd = rtp->s;
+					fds[i + 1].events = POLLIN;
+				}
+				relay.changed = 0;
+			}
+		}
+		ast_mutex_unlock(&relay_lock);
+
+		if (!fds) {
+			/* Wait for memory, then try building the poll set again */
+			usleep(1000);
+			continue;
+		}
+
+		if (ast_poll(fds, count + 1, -1) < 0) {
+			if (errno != EINTR) {
+				ast_log(LOG_WARNING, "RTP relay poll failed: %s\n", strerror(errno));
+				usleep(1000);
+			}
+			continue;
+		}
+
+		if (fds[0].revents) {
+			char buf[32];
+
+			while (read(relay.alert[0], buf, sizeof(buf)) > 0) {
+			}
+		}
+		for (i = 0; i < count; i++) {
+			if (fds[i + 1].revents) {
+				rtp_relay_read(instances[i]);
+			}
+		}
+	}
+
+	for (i = 0; i < count; i++) {
+		ao2_ref(instances[i], -1);
+	}
+	ast_free(instances);
+	ast_free(fds);
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Have the relay thread read an instance's socket while it is locally bridged
+ *
+ * The channel polls ast_rtp_fd(), which now returns a pipe, instead.  Packets
+ * which only need forwarding are sent to the bridged instance by the relay
+ * thread, the rest are handed back to the channel through the pipe.
+ */
+static void rtp_relay_start(struct ast_rtp_instance *instance)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+#ifdef HAVE_PJPROJECT
+	if (rtp->ice) {
+		return;
+	}
+#endif
+#ifdef HAVE_OPENSSL_SRTP
+	if (rtp->dtls.ssl) {
+		return;
+	}
+#endif
+
+	ast_mutex_lock(&relay_lock);
+	if (rtp->relay_alert[0] > -1) {
+		ast_mutex_unlock(&relay_lock);
+		return;
+	}
+
+	if (relay.thread == AST_PTHREADT_NULL) {
+		if (rtp_relay_pipe(relay.alert)) {
+			ast_log(LOG_WARNING, "Failed to create RTP relay alert pipe: %s\n", strerror(errno));
+			ast_mutex_unlock(&relay_lock);
+			return;
+		}
+		if (ast_pthread_create_background(&relay.thread, NULL, rtp_relay_thread, NULL)) {
+			ast_log(LOG_WARNING, "Failed to start RTP relay thread\n");
+			rtp_relay_pipe_close(relay.alert);
+			relay.thread = AST_PTHREADT_NULL;
+			ast_mutex_unlock(&relay_lock);
+			return;
+		}
+	}
+
+	if (rtp_relay_pipe(rtp->relay_alert)) {
+		ast_log(LOG_WARNING, "Failed to create RTP relay pipe for instance '%p': %s\n",
+			instance, strerror(errno));
+		rtp->relay_alert[0] = rtp->relay_alert[1] = -1;
+		ast_mutex_unlock(&relay_lock);
+		return;
+	}
+	if (AST_VECTOR_APPEND(&relay.instances, instance)) {
+		rtp_relay_pipe_close(rtp->relay_alert);
+		ast_mutex_unlock(&relay_lock);
+		return;
+	}
+	ao2_ref(instance, +1);
+
+	/* Queued packets are still read by the channel before any that arrive later */
+	if (rtp->relay_queued) {
+		rtp_relay_alert(rtp->relay_alert[1]);
+	}
+
+	relay.changed = 1;
+	rtp_relay_alert(relay.alert[1]);
+	ast_mutex_unlock(&relay_lock);
+
+	ast_debug(1, "%p -- Relaying RTP from the relay thread\n", rtp);
+}
+
+/*!
+ * \internal
+ * \brief Give an instance's socket back to the channel
+ *
+ * Once this returns the relay thread no longer touches the instance.
+ */
+static void rtp_relay_stop(struct ast_rtp_instance *instance)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+	ast_mutex_lock(&relay_lock);
+	if (rtp->relay_alert[0] < 0) {
+		ast_mutex_unlock(&relay_lock);
+		return;
+	}
+
+	AST_VECTOR_REMOVE_ELEM_UNORDERED(&relay.instances, instance, AST_VECTOR_ELEM_CLEANUP_NOOP);
+	rtp_relay_pipe_close(rtp->relay_alert);
+	relay.changed = 1;
+	rtp_relay_alert(relay.alert[1]);
+	ast_mutex_unlock(&relay_lock);
+
+	ast_debug(1, "%p -- No longer relaying RTP from the relay thread\n", rtp);
+	ao2_ref(instance, -1);
+}
+
+/*!
+ * \internal
+ * \brief Take the next packet the relay thread handed back to the channel
+ *
+ * \param rtp The instance being read
+ * \param addr Set to the source address of the packet
+ *
+ * \return Length of the packet, which is copied to the instance's raw data buffer
+ * \retval 0 if there was no packet
+ */
+static int rtp_relay_pop(struct ast_rtp *rtp, struct ast_sockaddr *addr)
+{
+	struct rtp_relay_packet *packet;
+	int len = 0;
+
+	ast_mutex_lock(&relay_lock);
+	if ((packet = AST_LIST_REMOVE_HEAD(&rtp->relay_packets, next))) {
+		char c;
+
+		rtp->relay_queued--;
+		if (rtp->relay_alert[0] > -1 && read(rtp->relay_alert[0], &c, 1) < 0) {
+			ast_debug(1, "%p -- Nothing to read from RTP relay pipe\n", rtp);
+		}
+	}
+	ast_mutex_unlock(&relay_lock);
+
+	if (packet) {
+		len = packet->len;
+		ast_sockaddr_copy(addr, &packet->addr);
+		memcpy(rtp->rawdata + AST_FRIENDLY_OFFSET, packet->data, len);
+		ast_free(packet);
+	}
+
+	return len;
+}
+
+static void rtp_relay_shutdown(void)
+{
+	ast_mutex_lock(&relay_lock);
+	if (relay.thread == AST_PTHREADT_NULL) {
+		ast_mutex_unlock(&relay_lock);
+		return;
+	}
+	relay.stop = 1;
+	rtp_relay_alert(relay.alert[1]);
+	ast_mutex_unlock(&relay_lock);
+
+	pthread_join(relay.thread, NULL);
+	relay.thread = AST_PTHREADT_NULL;
+	relay.stop = 0;
+	rtp_relay_pipe_close(relay.alert);
+	AST_VECTOR_FREE(&relay.instances);
+}
+
+static struct ast_frame *ast_rtp_read(struct ast_rtp_instance *instance, int rtcp)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+	struct ast_sockaddr addr;
+	int res;
+
+	/* If this is actually RTCP let's hop on over and handle it */
+	if (rtcp) {
+		if (rtp->rtcp) {
+			return ast_rtcp_read(instance);
+		}
+		return &ast_null_frame;
+	}
+
+	/* If we are currently sending DTMF to the remote party send a continuation packet */
+	if (rtp->sending_digit) {
+		ast_rtp_dtmf_continuation(instance);
+	}
+
+	/* Checked without the relay lock, queued packets are picked up by a later read */
+	if (rtp->relay_alert[0] > -1 || !AST_LIST_EMPTY(&rtp->relay_packets)) {
+		if ((res = rtp_relay_pop(rtp, &addr))) {
+			return rtp_read_packet(instance, res, &addr);
+		}
+		if (rtp->relay_alert[0] > -1) {
+			/* The relay thread reads the socket until the bridge ends */
+			return &ast_null_frame;
+		}
+	}
+
+#ifdef RTP_RECV_BATCH_MAX
+	if (recvbatch > 1) {
+		return rtp_read_batch(instance);
+	}
+#endif
+
+	/* Actually read in the data from the socket */
+	if ((res = rtp_recvfrom(instance, rtp->rawdata + AST_FRIENDLY_OFFSET,
+				sizeof(rtp->rawdata) - AST_FRIENDLY_OFFSET, 0,
+				&addr)) < 0) {
+		return rtp_read_failed();
+	}
+
+	return rtp_read_packet(instance, res, &addr);
+}
+
+static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_property property, int value)
+{
+	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
+
+	if (property == AST_RTP_PROPERTY_RTCP) {
+		if (value) {
+			struct ast_sockaddr local_addr;
+
+			if (rtp->rtcp) {
+				ast_debug(1, "Ignoring duplicate RTCP property on RTP instance '%p'\n", instance);
+				return;
+			}
+			/* Setup RTCP to be activated on the next RTP write */
+			if (!(rtp->rtcp = ast_calloc(1, sizeof(*rtp->rtcp)))) {
+				return;
+			}
+
+			/* Grab the IP address and port we are going to use */
+			ast_rtp_instance_get_local_address(instance, &rtp->rtcp->us);
+			ast_sockaddr_set_port(&rtp->rtcp->us,
+					      ast_sockaddr_port(&rtp->rtcp->us) + 1);
+
+			if (!ast_find_ourip(&local_addr, &rtp->rtcp->us, 0)) {
+				ast_sockaddr_set_port(&local_addr, ast_sockaddr_port(&rtp->rtcp->us));
+			} else {
+				ast_sockaddr_copy(&local_addr, &rtp->rtcp->us);
+			}
+
+			rtp->rtcp->local_addr_str = ast_strdup(ast_sockaddr_stringify(&local_addr));
+			if (!rtp->rtcp->local_addr_str) {
+				ast_free(rtp->rtcp);
+				rtp->rtcp = NULL;
+				return;
+			}
+
+			if ((rtp->rtcp->s =
+			     create_new_socket("RTCP",
+					       ast_sockaddr_is_ipv4(&rtp->rtcp->us) ?
+					       AF_INET :
+					       ast_sockaddr_is_ipv6(&rtp->rtcp->us) ?
+					       AF_INET6 : -1)) < 0) {
+				ast_debug(1, "Failed to create a new socket for RTCP on instance '%p'\n", instance);
+				ast_free(rtp->rtcp->local_addr_str);
+				ast_free(rtp->rtcp);
+				rtp->rtcp = NULL;
+				return;
+			}
+
+			/* Try to actually bind to the IP address and port we are going to use for RTCP, if this fails we have to bail out */
+			if (ast_bind(rtp->rtcp->s, &rtp->rtcp->us)) {
 				ast_debug(1, "Failed to setup RTCP on RTP instance '%p'\n", instance);
 				close(rtp->rtcp->s);
 				ast_free(rtp->rtcp->local_addr_str);
@@ -4966,7 +5862,7 @@ static void ast_rtp_prop_set(struct ast_rtp_instance *instance, enum ast_rtp_pro
 		} else {
 			if (rtp->rtcp) {
 				if (rtp->rtcp->schedid > -1) {
-					if (!ast_sched_del(rtp->sched, rtp->rtcp->schedid)) {
+					if (!ast_sched_del(rtcp_sched, rtp->rtcp->schedid)) {
 						/* Successfully cancelled scheduler entry. */
 						ao2_ref(instance, -1);
 					} else {
@@ -4997,6 +5893,10 @@ static int ast_rtp_fd(struct ast_rtp_instance *instance, int rtcp)
 {
 	struct ast_rtp *rtp = ast_rtp_instance_get_data(instance);
 
+	if (!rtcp && rtp->relay_alert[0] > -1) {
+		return rtp->relay_alert[0];
+	}
+
 	return rtcp ? (rtp->rtcp ? rtp->rtcp->s : -1) : rtp->s;
 }
 
@@ -5109,6 +6009,12 @@ static int ast_rtp_local_bridge(struct ast_rtp_instance *instance0, struct ast_r
 
 	ast_set_flag(rtp, FLAG_NEED_MARKER_BIT);
 
+	if (instance1 && p2prelay) {
+		rtp_relay_start(instance0);
+	} else if (!instance1) {
+		rtp_relay_stop(instance0);
+	}
+
 	return 0;
 }
 
@@ -5204,7 +6110,7 @@ static void ast_rtp_stop(struct ast_rtp_instance *instance)
 #endif
 
 	if (rtp->rtcp && rtp->rtcp->schedid > -1) {
-		if (!ast_sched_del(rtp->sched, rtp->rtcp->schedid)) {
+		if (!ast_sched_del(rtcp_sched, rtp->rtcp->schedid)) {
 			/* successfully cancelled scheduler entry. */
 			ao2_ref(instance, -1);
 		}
@@ -5451,7 +6357,114 @@ static char *handle_cli_rtcp_set_stats(struct ast_cli_entry *e, int cmd, struct
 	return CLI_SUCCESS;
 }
 
+static char *handle_cli_rtp_settings(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+#ifdef HAVE_PJPROJECT
+	struct ast_rtp_ioqueue_thread *ioqueue;
+	unsigned int sockets = 0;
+#endif
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "rtp show settings";
+		e->usage =
+			"Usage: rtp show settings\n"
+			"       Display RTP configuration settings and ICE/TURN thread usage\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_cli(a->fd, "\n\nGeneral Settings:\n");
+	ast_cli(a->fd, "----------------\n");
+	ast_cli(a->fd, "  Port start:      %d\n", rtpstart);
+	ast_cli(a->fd, "  Port end:        %d\n", rtpend);
+#ifdef SO_NO_CHECK
+	ast_cli(a->fd, "  Checksums:       %s\n", AST_CLI_YESNO(nochecksums == 0));
+#endif
+	ast_cli(a->fd, "  DTMF Timeout:    %d\n", dtmftimeout);
+	ast_cli(a->fd, "  Strict RTP:      %s\n", AST_CLI_YESNO(strictrtp));
+	if (strictrtp) {
+		ast_cli(a->fd, "  Probation:       %d frames\n", learning_min_sequential);
+	}
+	ast_cli(a->fd, "  Receive batch:   %d\n", recvbatch);
+	ast_cli(a->fd, "  P2P relay:       %s\n", AST_CLI_YESNO(p2prelay));
+	ast_cli(a->fd, "  RTCP interval:   %d ms\n", rtcpinterval);
+	if (rtcp_publish_interval) {
+		ast_cli(a->fd, "  RTCP publish:    every %d seconds\n", rtcp_publish_interval);
+	} else {
+		ast_cli(a->fd, "  RTCP publish:    every report\n");
+	}
+
+#ifdef HAVE_PJPROJECT
+	ast_cli(a->fd, "  ICE support:     %s\n", AST_CLI_YESNO(icesupport));
+
+	AST_LIST_LOCK(&ioqueues);
+	ast_cli(a->fd, "\nICE/TURN ioqueue threads: %u of %u", ioqueue_thread_count, rtp_ioqueue_thread_max());
+	ast_cli(a->fd, "%s\n", ioqueue_threads ? "" : " (one per CPU)");
+	AST_LIST_TRAVERSE(&ioqueues, ioqueue, next) {
+		ast_cli(a->fd, "  Thread %p:  %u of %d sockets\n", ioqueue, ioqueue->count, PJ_IOQUEUE_MAX_HANDLES);
+		sockets += ioqueue->count;
+	}
+	AST_LIST_UNLOCK(&ioqueues);
+	ast_cli(a->fd, "  Total sockets:   %u\n", sockets);
+#endif
+
+	return CLI_SUCCESS;
+}
+
+static char *handle_cli_rtp_ports(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	unsigned int i;
+	unsigned int quarantined = 0;
+	unsigned int in_use;
+	time_t now = time(NULL);
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "rtp show ports";
+		e->usage =
+			"Usage: rtp show ports\n"
+			"       Display how much of the RTP port range is in use\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+	ast_mutex_lock(&ports_lock);
+	for (i = 0; i < ports.count; i++) {
+		time_t released = ports.released[ports.free[(ports.head + i) % ports.pairs]];
+
+		if (released && now - released < RTP_PORT_QUARANTINE) {
+			quarantined++;
+		}
+	}
+	in_use = ports.pairs - ports.count;
+
+	ast_cli(a->fd, "\nRTP Port Usage:\n");
+	ast_cli(a->fd, "---------------\n");
+	ast_cli(a->fd, "  Port range:      %d -> %d\n", ports.base, ports.base + (int) ports.pairs * 2 - 1);
+	ast_cli(a->fd, "  Port pairs:      %u\n", ports.pairs);
+	ast_cli(a->fd, "  In use:          %u (%u%%)\n", in_use, ports.pairs ? in_use * 100 / ports.pairs : 0);
+	ast_cli(a->fd, "  Free:            %u\n", ports.count);
+	ast_cli(a->fd, "  Released in the last %d seconds: %u\n", RTP_PORT_QUARANTINE, quarantined);
+	ast_cli(a->fd, "  Found bound elsewhere: %u\n", ports.busy);
+	ast_mutex_unlock(&ports_lock);
+
+	return CLI_SUCCESS;
+}
+
 static struct ast_cli_entry cli_rtp[] = {
+	AST_CLI_DEFINE(handle_cli_rtp_settings,   "Display RTP settings"),
+	AST_CLI_DEFINE(handle_cli_rtp_ports,      "Display RTP port usage"),
 	AST_CLI_DEFINE(handle_cli_rtp_set_debug,  "Enable/Disable RTP debugging"),
 	AST_CLI_DEFINE(handle_cli_rtcp_set_debug, "Enable/Disable RTCP debugging"),
 	AST_CLI_DEFINE(handle_cli_rtcp_set_stats, "Enable/Disable RTCP stats"),
@@ -5478,6 +6491,9 @@ static int rtp_reload(int reload)
 	dtmftimeout = DEFAULT_DTMF_TIMEOUT;
 	strictrtp = DEFAULT_STRICT_RTP;
 	learning_min_sequential = DEFAULT_LEARNING_MIN_SEQUENTIAL;
+	recvbatch = DEFAULT_RECV_BATCH;
+	p2prelay = DEFAULT_P2P_RELAY;
+	rtcp_publish_interval = DEFAULT_RTCP_PUBLISH_INTERVAL;
 
 	/** This resource is not "reloaded" so much as unloaded and loaded again.
 	 * In the case of the TURN related variables, the memory referenced by a
@@ -5489,6 +6505,7 @@ static int rtp_reload(int reload)
 
 #ifdef HAVE_PJPROJECT
 	icesupport = DEFAULT_ICESUPPORT;
+	ioqueue_threads = DEFAULT_IOQUEUE_THREADS;
 	turnport = DEFAULT_TURN_PORT;
 	memset(&stunaddr, 0, sizeof(stunaddr));
 	turnaddr = pj_str(NULL);
@@ -5550,10 +6567,42 @@ static int rtp_reload(int reload)
 					DEFAULT_LEARNING_MIN_SEQUENTIAL);
 			}
 		}
+		if ((s = ast_variable_retrieve(cfg, "general", "recvbatch"))) {
+			if ((sscanf(s, "%d", &recvbatch) <= 0) || recvbatch <= 0) {
+				ast_log(LOG_WARNING, "Value for 'recvbatch' could not be read, using default of '%d' instead\n",
+					DEFAULT_RECV_BATCH);
+				recvbatch = DEFAULT_RECV_BATCH;
+			}
+#ifdef RTP_RECV_BATCH_MAX
+			if (recvbatch > RTP_RECV_BATCH_MAX) {
+				recvbatch = RTP_RECV_BATCH_MAX;
+			}
+#else
+			if (recvbatch > 1) {
+				ast_log(LOG_WARNING, "Reading batches of RTP packets is not supported on this operating system!\n");
+				recvbatch = DEFAULT_RECV_BATCH;
+			}
+#endif
+		}
+		if ((s = ast_variable_retrieve(cfg, "general", "p2prelay"))) {
+			p2prelay = ast_true(s);
+		}
+		if ((s = ast_variable_retrieve(cfg, "general", "rtcppublishinterval"))) {
+			if (sscanf(s, "%30d", &rtcp_publish_interval) != 1 || rtcp_publish_interval < 0) {
+				ast_log(LOG_WARNING, "Invalid rtcppublishinterval value '%s', publishing every RTCP report\n", s);
+				rtcp_publish_interval = DEFAULT_RTCP_PUBLISH_INTERVAL;
+			}
+		}
 #ifdef HAVE_PJPROJECT
 		if ((s = ast_variable_retrieve(cfg, "general", "icesupport"))) {
 			icesupport = ast_true(s);
 		}
+		if ((s = ast_variable_retrieve(cfg, "general", "ioqueue_threads"))) {
+			if (sscanf(s, "%30d", &ioqueue_threads) != 1 || ioqueue_threads < 0) {
+				ast_log(LOG_WARNING, "Invalid ioqueue_threads value '%s', using one per CPU\n", s);
+				ioqueue_threads = DEFAULT_IOQUEUE_THREADS;
+			}
+		}
 		if ((s = ast_variable_retrieve(cfg, "general", "stunaddr"))) {
 			stunaddr.sin_port = htons(STANDARD_STUN_PORT);
 			if (ast_parse_arg(s, PARSE_INADDR, &stunaddr)) {
@@ -5635,6 +6684,11 @@ static int rtp_reload(int reload)
 		rtpstart = DEFAULT_RTP_START;
 		rtpend = DEFAULT_RTP_END;
 	}
+	if (rtp_ports_configure(rtpstart, rtpend)) {
+		ast_log(LOG_ERROR, "Failed to set up the RTP port allocator for port range %d -> %d\n",
+			rtpstart, rtpend);
+		return -1;
+	}
 	ast_verb(2, "RTP Allocating from port range %d -> %d\n", rtpstart, rtpend);
 	return 0;
 }
@@ -5661,6 +6715,24 @@ static void rtp_terminate_pjproject(void)
 }
 #endif
 
+static int rtcp_sched_unref(const void *data)
+{
+	ao2_ref((struct ast_rtp_instance *) data, -1);
+	return 0;
+}
+
+/*! \brief Stop the RTCP scheduler thread, dropping any reports still scheduled */
+static void rtcp_sched_destroy(void)
+{
+	if (!rtcp_sched) {
+		return;
+	}
+
+	ast_sched_clean_by_callback(rtcp_sched, ast_rtcp_write, rtcp_sched_unref);
+	ast_sched_context_destroy(rtcp_sched);
+	rtcp_sched = NULL;
+}
+
 static int load_module(void)
 {
 #ifdef HAVE_PJPROJECT
@@ -5704,7 +6776,18 @@ static int load_module(void)
 
 #endif
 
+	if (!(rtcp_sched = ast_sched_context_create_backend(AST_SCHED_BACKEND_WHEEL))
+		|| ast_sched_start_thread(rtcp_sched)) {
+		ast_log(LOG_ERROR, "Unable to start the RTCP scheduler thread\n");
+		rtcp_sched_destroy();
+#ifdef HAVE_PJPROJECT
+		rtp_terminate_pjproject();
+#endif
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	if (ast_rtp_engine_register(&asterisk_rtp_engine)) {
+		rtcp_sched_destroy();
 #ifdef HAVE_PJPROJECT
 		rtp_terminate_pjproject();
 #endif
@@ -5712,8 +6795,9 @@ static int load_module(void)
 	}
 
 	if (ast_cli_register_multiple(cli_rtp, ARRAY_LEN(cli_rtp))) {
-#ifdef HAVE_PJPROJECT
 		ast_rtp_engine_unregister(&asterisk_rtp_engine);
+		rtcp_sched_destroy();
+#ifdef HAVE_PJPROJECT
 		rtp_terminate_pjproject();
 #endif
 		return AST_MODULE_LOAD_DECLINE;
@@ -5728,6 +6812,9 @@ static int unload_module(void)
 {
 	ast_rtp_engine_unregister(&asterisk_rtp_engine);
 	ast_cli_unregister_multiple(cli_rtp, ARRAY_LEN(cli_rtp));
+	rtp_relay_shutdown();
+	rtcp_sched_destroy();
+	rtp_ports_destroy();
 
 #ifdef HAVE_PJPROJECT
 	host_candidate_overrides_clear();
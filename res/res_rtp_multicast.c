@@ -54,6 +54,7 @@
 #include "asterisk/format_cache.h"
 #include "asterisk/multicast_rtp.h"
 #include "asterisk/app.h"
+#include "asterisk/vector.h"
 
 /*! Command value used for Linksys paging to indicate we are starting */
 #define LINKSYS_MCAST_STARTCMD 6
@@ -95,6 +96,8 @@ struct multicast_rtp {
 	uint16_t seqno;
 	unsigned int lastts;	
 	struct timeval txcore;
+	/*! Destinations the packets are sent to besides the remote address */
+	AST_VECTOR(, struct ast_sockaddr) destinations;
 };
 
 enum {
@@ -129,6 +132,8 @@ struct ast_multicast_rtp_options {
 	struct ast_format *fmt;
 	struct ast_flags opts;
 	char *opt_args[OPT_ARG_ARRAY_SIZE];
+	/*! Destinations to send to besides the remote address */
+	AST_VECTOR(, struct ast_sockaddr) destinations;
 	/*! The type and options are stored in this buffer */
 	char buf[0];
 };
@@ -170,9 +175,24 @@ struct ast_multicast_rtp_options *ast_multicast_rtp_create_options(const char *t
 
 void ast_multicast_rtp_free_options(struct ast_multicast_rtp_options *mcast_options)
 {
+	if (!mcast_options) {
+		return;
+	}
+
+	AST_VECTOR_FREE(&mcast_options->destinations);
 	ast_free(mcast_options);
 }
 
+int ast_multicast_rtp_options_add_destination(struct ast_multicast_rtp_options *mcast_options,
+	const struct ast_sockaddr *addr)
+{
+	struct ast_sockaddr destination;
+
+	ast_sockaddr_copy(&destination, addr);
+
+	return AST_VECTOR_APPEND(&mcast_options->destinations, destination);
+}
+
 struct ast_format *ast_multicast_rtp_options_get_format(struct ast_multicast_rtp_options *mcast_options)
 {
 	if (ast_test_flag(&mcast_options->opts, OPT_CODEC)
@@ -281,6 +301,7 @@ static int multicast_rtp_new(struct ast_rtp_instance *instance, struct ast_sched
 {
 	struct multicast_rtp *multicast;
 	struct ast_multicast_rtp_options *mcast_options = data;
+	int i;
 
 	if (!(multicast = ast_calloc(1, sizeof(*multicast)))) {
 		return -1;
@@ -291,7 +312,16 @@ static int multicast_rtp_new(struct ast_rtp_instance *instance, struct ast_sched
 		return -1;
 	}
 
+	if (AST_VECTOR_INIT(&multicast->destinations, AST_VECTOR_SIZE(&mcast_options->destinations))) {
+		ast_free(multicast);
+		return -1;
+	}
+	for (i = 0; i < AST_VECTOR_SIZE(&mcast_options->destinations); i++) {
+		AST_VECTOR_APPEND(&multicast->destinations, AST_VECTOR_GET(&mcast_options->destinations, i));
+	}
+
 	if ((multicast->socket = socket(AF_INET, SOCK_DGRAM, 0)) < 0) {
+		AST_VECTOR_FREE(&multicast->destinations);
 		ast_free(multicast);
 		return -1;
 	}
@@ -340,13 +370,37 @@ static unsigned int calc_txstamp(struct multicast_rtp *rtp, struct timeval *deli
         return (unsigned int) ms;
 }
 
-/*! \brief Helper function which populates a control packet with useful information and sends it */
-static int multicast_send_control_packet(struct ast_rtp_instance *instance, struct multicast_rtp *multicast, int command)
+/*! \brief Helper function which populates a control packet for one destination and sends it */
+static int multicast_send_control_destination(struct multicast_rtp *multicast, int command,
+	struct ast_sockaddr *control_address, struct ast_sockaddr *destination)
 {
 	struct multicast_control_packet control_packet = { .unique_id = htonl((u_long)time(NULL)),
 							   .command = htonl(command),
 	};
+
+	/* The protocol only supports IPv4. */
+	if (ast_sockaddr_is_ipv6(destination)) {
+		ast_log(LOG_WARNING, "Cannot send control packet for IPv6 "
+			"remote address.\n");
+		return -1;
+	}
+
+	control_packet.ip = htonl(ast_sockaddr_ipv4(destination));
+	control_packet.port = htonl(ast_sockaddr_port(destination));
+
+	/* Based on a recommendation by Brian West who did the FreeSWITCH implementation we send control packets twice */
+	ast_sendto(multicast->socket, &control_packet, sizeof(control_packet), 0, control_address);
+	ast_sendto(multicast->socket, &control_packet, sizeof(control_packet), 0, control_address);
+
+	return 0;
+}
+
+/*! \brief Helper function which sends a control packet for every destination */
+static int multicast_send_control_packet(struct ast_rtp_instance *instance, struct multicast_rtp *multicast, int command)
+{
 	struct ast_sockaddr control_address, remote_address;
+	int res;
+	int i;
 
 	ast_rtp_instance_get_local_address(instance, &control_address);
 	ast_rtp_instance_get_remote_address(instance, &remote_address);
@@ -357,21 +411,15 @@ static int multicast_send_control_packet(struct ast_rtp_instance *instance, stru
 		return -1;
 	}
 
-	/* The protocol only supports IPv4. */
-	if (ast_sockaddr_is_ipv6(&remote_address)) {
-		ast_log(LOG_WARNING, "Cannot send control packet for IPv6 "
-			"remote address.\n");
-		return -1;
+	res = multicast_send_control_destination(multicast, command, &control_address, &remote_address);
+	for (i = 0; i < AST_VECTOR_SIZE(&multicast->destinations); i++) {
+		if (multicast_send_control_destination(multicast, command, &control_address,
+			AST_VECTOR_GET_ADDR(&multicast->destinations, i))) {
+			res = -1;
+		}
 	}
 
-	control_packet.ip = htonl(ast_sockaddr_ipv4(&remote_address));
-	control_packet.port = htonl(ast_sockaddr_port(&remote_address));
-
-	/* Based on a recommendation by Brian West who did the FreeSWITCH implementation we send control packets twice */
-	ast_sendto(multicast->socket, &control_packet, sizeof(control_packet), 0, &control_address);
-	ast_sendto(multicast->socket, &control_packet, sizeof(control_packet), 0, &control_address);
-
-	return 0;
+	return res;
 }
 
 /*! \brief Function called to indicate that audio is now going to flow */
@@ -397,6 +445,7 @@ static int multicast_rtp_destroy(struct ast_rtp_instance *instance)
 
 	close(multicast->socket);
 
+	AST_VECTOR_FREE(&multicast->destinations);
 	ast_free(multicast);
 
 	return 0;
@@ -408,7 +457,7 @@ static int multicast_rtp_write(struct ast_rtp_instance *instance, struct ast_fra
 	struct multicast_rtp *multicast = ast_rtp_instance_get_data(instance);
 	struct ast_frame *f = frame;
 	struct ast_sockaddr remote_address;
-	int hdrlen = 12, res = 0, codec;
+	int hdrlen = 12, res = 0, codec, i;
 	unsigned char *rtpheader;
 	unsigned int ms = calc_txstamp(multicast, &frame->delivery);
 	int rate = rtp_get_rate(frame->subclass.format) / 1000;
@@ -458,6 +507,18 @@ static int multicast_rtp_write(struct ast_rtp_instance *instance, struct ast_fra
 		res = -1;
 	}
 
+	/* The same packet goes to every other destination, so the audio is only encoded once */
+	for (i = 0; i < AST_VECTOR_SIZE(&multicast->destinations); i++) {
+		struct ast_sockaddr *destination = AST_VECTOR_GET_ADDR(&multicast->destinations, i);
+
+		if (ast_sendto(multicast->socket, (void *) rtpheader, f->datalen + hdrlen, 0, destination) < 0) {
+			ast_log(LOG_ERROR, "Multicast RTP Transmission error to %s: %s\n",
+				ast_sockaddr_stringify(destination),
+				strerror(errno));
+			res = -1;
+		}
+	}
+
 	/* If we were forced to duplicate the frame free the new one */
 	if (frame != f) {
 		ast_frfree(f);
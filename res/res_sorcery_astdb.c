@@ -47,6 +47,7 @@ static void sorcery_astdb_retrieve_regex(const struct ast_sorcery *sorcery, void
 static int sorcery_astdb_update(const struct ast_sorcery *sorcery, void *data, void *object);
 static int sorcery_astdb_delete(const struct ast_sorcery *sorcery, void *data, void *object);
 static void sorcery_astdb_close(void *data);
+static int sorcery_astdb_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects);
 
 static struct ast_sorcery_wizard astdb_object_wizard = {
 	.name = "astdb",
@@ -59,6 +60,7 @@ static struct ast_sorcery_wizard astdb_object_wizard = {
 	.update = sorcery_astdb_update,
 	.delete = sorcery_astdb_delete,
 	.close = sorcery_astdb_close,
+	.create_multiple = sorcery_astdb_create_multiple,
 };
 
 static int sorcery_astdb_create(const struct ast_sorcery *sorcery, void *data, void *object)
@@ -358,6 +360,41 @@ static int sorcery_astdb_delete(const struct ast_sorcery *sorcery, void *data, v
 	return ast_db_del(family, ast_sorcery_object_get_id(object));
 }
 
+static int sorcery_astdb_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects)
+{
+	struct ao2_iterator iter;
+	void *object;
+	void *stored;
+
+	/*
+	 * The puts are written to the database in the same transaction by the
+	 * sync thread, but a failure has to remove the entries put before it.
+	 */
+	iter = ao2_iterator_init(objects, 0);
+	while ((object = ao2_iterator_next(&iter))) {
+		if (sorcery_astdb_create(sorcery, data, object)) {
+			break;
+		}
+		ao2_ref(object, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	if (!object) {
+		return 0;
+	}
+
+	iter = ao2_iterator_init(objects, 0);
+	while ((stored = ao2_iterator_next(&iter)) && stored != object) {
+		sorcery_astdb_delete(sorcery, data, stored);
+		ao2_ref(stored, -1);
+	}
+	ao2_cleanup(stored);
+	ao2_iterator_destroy(&iter);
+	ao2_ref(object, -1);
+
+	return -1;
+}
+
 static void *sorcery_astdb_open(const char *data)
 {
 	/* We require a prefix for family string generation, or else stuff could mix together */
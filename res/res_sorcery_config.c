@@ -47,6 +47,9 @@ struct sorcery_config {
 	/*! \brief Objects retrieved from the configuration file */
 	struct ao2_global_obj objects;
 
+	/*! \brief Digests of the categories the objects were built from, only used while loading */
+	struct ao2_container *digests;
+
 	/*! \brief Any specific variable criteria for considering a defined category for this object */
 	struct ast_variable *criteria;
 
@@ -60,6 +63,15 @@ struct sorcery_config {
 	char filename[];
 };
 
+/*! \brief Structure for remembering what configuration an object was built from */
+struct sorcery_config_digest {
+	/*! \brief Digest of the variables of the category */
+	uint64_t digest;
+
+	/*! \brief Identifier of the object */
+	char id[0];
+};
+
 /*! \brief Structure used for fields comparison */
 struct sorcery_config_fields_cmp_params {
 	/*! \brief Pointer to the sorcery structure */
@@ -104,6 +116,7 @@ static void sorcery_config_destructor(void *obj)
 
 	ao2_global_obj_release(config->objects);
 	ast_rwlock_destroy(&config->objects.lock);
+	ao2_cleanup(config->digests);
 	ast_variables_destroy(config->criteria);
 }
 
@@ -214,6 +227,88 @@ static int sorcery_is_criteria_met(struct ast_variable *objset, struct ast_varia
 	return (!criteria || (!ast_sorcery_changeset_create(objset, criteria, &diff) && !diff)) ? 1 : 0;
 }
 
+AO2_STRING_FIELD_HASH_FN(sorcery_config_digest, id);
+AO2_STRING_FIELD_CMP_FN(sorcery_config_digest, id);
+
+/*! \brief Internal function which computes the digest of the variables of a category */
+static uint64_t sorcery_config_digest_calc(const struct ast_variable *variables)
+{
+	/* 64 bit FNV-1a over each name and value, including their terminators */
+	uint64_t digest = 14695981039346656037ULL;
+	const struct ast_variable *variable;
+	const char *str;
+
+	for (variable = variables; variable; variable = variable->next) {
+		for (str = variable->name; ; str++) {
+			digest = (digest ^ (unsigned char) *str) * 1099511628211ULL;
+			if (!*str) {
+				break;
+			}
+		}
+		for (str = variable->value; ; str++) {
+			digest = (digest ^ (unsigned char) *str) * 1099511628211ULL;
+			if (!*str) {
+				break;
+			}
+		}
+	}
+
+	return digest;
+}
+
+/*! \brief Internal function which records the digest of the category an object was built from */
+static int sorcery_config_digest_add(struct ao2_container *digests, const char *id, uint64_t digest)
+{
+	struct sorcery_config_digest *entry;
+
+	entry = ao2_alloc_options(sizeof(*entry) + strlen(id) + 1, NULL, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!entry) {
+		return -1;
+	}
+
+	entry->digest = digest;
+	strcpy(entry->id, id); /* Safe */
+	ao2_link(digests, entry);
+	ao2_ref(entry, -1);
+
+	return 0;
+}
+
+/*! \brief Internal function which returns an existing object if its category is unchanged */
+static void *sorcery_config_unchanged(struct sorcery_config *config, struct ao2_container *old_objects,
+	const char *id, uint64_t digest)
+{
+	struct sorcery_config_digest *entry;
+	void *obj = NULL;
+
+	if (!old_objects || !config->digests) {
+		return NULL;
+	}
+
+	entry = ao2_find(config->digests, id, OBJ_SEARCH_KEY);
+	if (entry && entry->digest == digest) {
+		obj = ao2_find(old_objects, id, OBJ_SEARCH_KEY);
+	}
+	ao2_cleanup(entry);
+
+	return obj;
+}
+
+/*! \brief Internal callback function which notifies observers of an object that is gone after a reload */
+static int sorcery_config_notify_deleted(void *obj, void *arg, void *data, int flags)
+{
+	struct ao2_container *objects = arg;
+	const struct ast_sorcery *sorcery = data;
+	void *current = ao2_find(objects, ast_sorcery_object_get_id(obj), OBJ_SEARCH_KEY);
+
+	if (!current) {
+		ast_sorcery_notify_deleted(sorcery, obj);
+	}
+	ao2_cleanup(current);
+
+	return 0;
+}
+
 static void sorcery_config_internal_load(void *data, const struct ast_sorcery *sorcery, const char *type, unsigned int reload)
 {
 	struct sorcery_config *config = data;
@@ -221,8 +316,13 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 	struct ast_config *cfg = ast_config_load2(config->filename, config->uuid, flags);
 	struct ast_category *category = NULL;
 	RAII_VAR(struct ao2_container *, objects, NULL, ao2_cleanup);
+	RAII_VAR(struct ao2_container *, old_objects, NULL, ao2_cleanup);
+	RAII_VAR(struct ao2_container *, digests, NULL, ao2_cleanup);
+	AST_VECTOR(, void *) changed;
 	const char *id = NULL;
 	unsigned int buckets = 0;
+	unsigned int unchanged = 0;
+	int i;
 
 	if (!cfg) {
 		ast_log(LOG_ERROR, "Unable to load config file '%s'\n", config->filename);
@@ -266,15 +366,30 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 
 	objects = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, buckets,
 		ast_sorcery_object_id_hash, NULL, ast_sorcery_object_id_compare);
-	if (!objects) {
+	digests = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, buckets,
+		sorcery_config_digest_hash_fn, NULL, sorcery_config_digest_cmp_fn);
+	if (!objects || !digests) {
 		ast_log(LOG_ERROR, "Could not create bucket for new objects from '%s', keeping existing objects\n",
 			config->filename);
 		ast_config_destroy(cfg);
 		return;
 	}
 
+	/* On reload objects whose category did not change are kept as they are */
+	if (reload) {
+		old_objects = ao2_global_obj_ref(config->objects);
+	}
+
+	if (AST_VECTOR_INIT(&changed, 0)) {
+		ast_config_destroy(cfg);
+		return;
+	}
+
 	while ((category = ast_category_browse_filtered(cfg, NULL, category, NULL))) {
 		RAII_VAR(void *, obj, NULL, ao2_cleanup);
+		struct sorcery_config_digest *old_digest;
+		uint64_t digest;
+
 		id = ast_category_get_name(category);
 
 		/* If given criteria has not been met skip the category, it is not applicable */
@@ -290,9 +405,19 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 			ast_log(LOG_ERROR, "Config file '%s' could not be loaded; configuration contains a duplicate object: '%s' of type '%s'\n",
 				config->filename, id, type);
 			ast_config_destroy(cfg);
+			AST_VECTOR_CALLBACK_VOID(&changed, ao2_cleanup);
+			AST_VECTOR_FREE(&changed);
 			return;
 		}
 
+		digest = sorcery_config_digest_calc(ast_category_first(category));
+		if ((obj = sorcery_config_unchanged(config, old_objects, id, digest))) {
+			sorcery_config_digest_add(digests, id, digest);
+			ao2_link(objects, obj);
+			unchanged++;
+			continue;
+		}
+
 		if (!(obj = ast_sorcery_alloc(sorcery, type, id)) ||
 		    ast_sorcery_objectset_apply(sorcery, obj, ast_category_first(category))) {
 
@@ -300,6 +425,8 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 				ast_log(LOG_ERROR, "Config file '%s' could not be loaded due to error with object '%s' of type '%s'\n",
 					config->filename, id, type);
 				ast_config_destroy(cfg);
+				AST_VECTOR_CALLBACK_VOID(&changed, ao2_cleanup);
+				AST_VECTOR_FREE(&changed);
 				return;
 			} else {
 				ast_log(LOG_ERROR, "Could not create an object of type '%s' with id '%s' from configuration file '%s'\n",
@@ -314,13 +441,48 @@ static void sorcery_config_internal_load(void *data, const struct ast_sorcery *s
 			}
 
 			ast_log(LOG_NOTICE, "Retaining existing configuration for object of type '%s' with id '%s'\n", type, id);
+
+			/* The retained object still matches what it was built from */
+			old_digest = config->digests ? ao2_find(config->digests, id, OBJ_SEARCH_KEY) : NULL;
+			if (old_digest) {
+				ao2_link(digests, old_digest);
+				ao2_ref(old_digest, -1);
+			}
+		} else {
+			sorcery_config_digest_add(digests, id, digest);
+			if (old_objects && !AST_VECTOR_APPEND(&changed, obj)) {
+				ao2_ref(obj, +1);
+			}
 		}
 
 		ao2_link(objects, obj);
 	}
 
 	ao2_global_obj_replace_unref(config->objects, objects);
+	ao2_replace(config->digests, digests);
 	ast_config_destroy(cfg);
+
+	if (old_objects) {
+		ast_debug(1, "Rebuilt %d of %d objects of type '%s' from '%s'\n",
+			ao2_container_count(objects) - unchanged, ao2_container_count(objects), type, config->filename);
+
+		/* Now that the new objects are in place tell observers about the differences */
+		for (i = 0; i < AST_VECTOR_SIZE(&changed); i++) {
+			void *obj = AST_VECTOR_GET(&changed, i);
+			void *old = ao2_find(old_objects, ast_sorcery_object_get_id(obj), OBJ_SEARCH_KEY);
+
+			if (old) {
+				ast_sorcery_notify_updated(sorcery, obj);
+				ao2_ref(old, -1);
+			} else {
+				ast_sorcery_notify_created(sorcery, obj);
+			}
+		}
+		ao2_callback_data(old_objects, OBJ_NODATA, sorcery_config_notify_deleted, objects, (void *) sorcery);
+	}
+
+	AST_VECTOR_CALLBACK_VOID(&changed, ao2_cleanup);
+	AST_VECTOR_FREE(&changed);
 }
 
 static void sorcery_config_load(void *data, const struct ast_sorcery *sorcery, const char *type)
@@ -41,6 +41,7 @@
 
 static void *sorcery_memory_open(const char *data);
 static int sorcery_memory_create(const struct ast_sorcery *sorcery, void *data, void *object);
+static int sorcery_memory_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects);
 static void *sorcery_memory_retrieve_id(const struct ast_sorcery *sorcery, void *data, const char *type, const char *id);
 static void *sorcery_memory_retrieve_fields(const struct ast_sorcery *sorcery, void *data, const char *type, const struct ast_variable *fields);
 static void sorcery_memory_retrieve_multiple(const struct ast_sorcery *sorcery, void *data, const char *type, struct ao2_container *objects,
@@ -61,6 +62,7 @@ static struct ast_sorcery_wizard memory_object_wizard = {
 	.update = sorcery_memory_update,
 	.delete = sorcery_memory_delete,
 	.close = sorcery_memory_close,
+	.create_multiple = sorcery_memory_create_multiple,
 };
 
 /*! \brief Structure used for fields comparison */
@@ -83,7 +85,7 @@ static int sorcery_memory_hash(const void *obj, const int flags)
 {
 	const char *id = obj;
 
-	return ast_str_hash(flags & OBJ_KEY ? id : ast_sorcery_object_get_id(obj));
+	return ast_str_hash_fast(flags & OBJ_KEY ? id : ast_sorcery_object_get_id(obj));
 }
 
 /*! \brief Comparator function for sorcery objects */
@@ -114,6 +116,44 @@ static int sorcery_memory_create(const struct ast_sorcery *sorcery, void *data,
 	return 0;
 }
 
+static int sorcery_memory_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects)
+{
+	struct ao2_iterator iter;
+	void *object;
+	void *linked;
+	void *existing;
+
+	ao2_lock(data);
+
+	iter = ao2_iterator_init(objects, 0);
+	while ((object = ao2_iterator_next(&iter))) {
+		existing = ao2_find(data, ast_sorcery_object_get_id(object), OBJ_KEY | OBJ_NOLOCK);
+		if (existing) {
+			ao2_ref(existing, -1);
+			break;
+		}
+		ao2_link_flags(data, object, OBJ_NOLOCK);
+		ao2_ref(object, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	if (object) {
+		/* Unlink the objects linked before the one that already exists */
+		iter = ao2_iterator_init(objects, 0);
+		while ((linked = ao2_iterator_next(&iter)) && linked != object) {
+			ao2_unlink_flags(data, linked, OBJ_NOLOCK);
+			ao2_ref(linked, -1);
+		}
+		ao2_cleanup(linked);
+		ao2_iterator_destroy(&iter);
+		ao2_ref(object, -1);
+	}
+
+	ao2_unlock(data);
+
+	return object ? -1 : 0;
+}
+
 static int sorcery_memory_fields_cmp(void *obj, void *arg, int flags)
 {
 	const struct sorcery_memory_fields_cmp_params *params = arg;
@@ -134,6 +134,18 @@ struct sorcery_memory_cache {
 	unsigned int expire_on_reload;
 	/*! \brief Whether this is a cache of the entire backend, 0 if disabled */
 	unsigned int full_backend_cache;
+	/*! \brief The amount of time (in seconds) an object is remembered as missing, 0 if disabled */
+	unsigned int object_lifetime_missing;
+	/*! \brief Whether the results of multiple object retrievals are cached, 0 if disabled */
+	unsigned int query_cache;
+	/*! \brief Identifiers of objects the backend does not have, NULL if disabled */
+	struct ao2_container *missing;
+	/*! \brief Results of multiple object retrievals keyed by the query, NULL if disabled */
+	struct ao2_container *queries;
+	/*! \brief Number of entries remembered in the missing container since it was last purged */
+	unsigned int missing_added;
+	/*! \brief Number of entries remembered in the queries container since it was last purged */
+	unsigned int queries_added;
 	/*! \brief Heap of cached objects. Oldest object is at the top. */
 	struct ast_heap *object_heap;
 	/*! \brief Scheduler item for expiring oldest object. */
@@ -172,6 +184,16 @@ struct sorcery_memory_cached_object {
 	struct ast_variable *objectset;
 };
 
+/*! \brief Structure for a remembered missing object or multiple object retrieval */
+struct sorcery_memory_cached_result {
+	/*! \brief The time at which the result was remembered */
+	struct timeval created;
+	/*! \brief The objects retrieved, NULL for a missing object */
+	struct ao2_container *objects;
+	/*! \brief The object id or query the result is for */
+	char key[0];
+};
+
 /*! \brief Structure used for fields comparison */
 struct sorcery_memory_cache_fields_cmp_params {
 	/*! \brief Pointer to the sorcery structure */
@@ -200,6 +222,12 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 	struct ao2_container *objects, const char *regex);
 static int sorcery_memory_cache_delete(const struct ast_sorcery *sorcery, void *data, void *object);
 static void sorcery_memory_cache_close(void *data);
+static int sorcery_memory_cache_is_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id);
+static void sorcery_memory_cache_cache_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id);
+static void sorcery_memory_cache_cache_multiple(const struct ast_sorcery *sorcery, void *data, const char *type,
+	struct ao2_container *objects, const struct ast_variable *fields, const char *regex);
 
 static struct ast_sorcery_wizard memory_cache_object_wizard = {
 	.name = "memory_cache",
@@ -214,6 +242,9 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 	.retrieve_multiple = sorcery_memory_cache_retrieve_multiple,
 	.retrieve_regex = sorcery_memory_cache_retrieve_regex,
 	.close = sorcery_memory_cache_close,
+	.is_missing = sorcery_memory_cache_is_missing,
+	.cache_missing = sorcery_memory_cache_cache_missing,
+	.cache_multiple = sorcery_memory_cache_cache_multiple,
 };
 
 /*! \brief The bucket size for the container of caches */
@@ -225,6 +256,9 @@ static struct ast_sorcery_wizard memory_cache_object_wizard = {
 /*! \brief Height of heap for cache object heap. Allows 31 initial objects */
 #define CACHE_HEAP_INIT_HEIGHT 5
 
+/*! \brief Number of results remembered between purges of expired ones when there is no maximum */
+#define CACHED_RESULTS_PURGE_INTERVAL 256
+
 /*! \brief Container of created caches */
 static struct ao2_container *caches;
 
@@ -292,7 +326,7 @@ static int sorcery_memory_cache_hash(const void *obj, int flags)
 		name = cache->name;
 		/* Fall through */
 	case OBJ_SEARCH_KEY:
-		hash = ast_str_hash(name);
+		hash = ast_str_hash_fast(name);
 		break;
 	case OBJ_SEARCH_PARTIAL_KEY:
 		/* Should never happen in hash callback. */
@@ -357,7 +391,7 @@ static int sorcery_memory_cached_object_hash(const void *obj, int flags)
 		name = ast_sorcery_object_get_id(cached->object);
 		/* Fall through */
 	case OBJ_SEARCH_KEY:
-		hash = ast_str_hash(name);
+		hash = ast_str_hash_fast(name);
 		break;
 	case OBJ_SEARCH_PARTIAL_KEY:
 		/* Should never happen in hash callback. */
@@ -416,6 +450,8 @@ static void sorcery_memory_cache_destructor(void *obj)
 		ast_heap_destroy(cache->object_heap);
 	}
 	ao2_cleanup(cache->objects);
+	ao2_cleanup(cache->missing);
+	ao2_cleanup(cache->queries);
 	ast_free(cache->object_type);
 }
 
@@ -433,6 +469,195 @@ static void sorcery_memory_cached_object_destructor(void *obj)
 	ast_variables_destroy(cached->objectset);
 }
 
+AO2_STRING_FIELD_HASH_FN(sorcery_memory_cached_result, key);
+AO2_STRING_FIELD_CMP_FN(sorcery_memory_cached_result, key);
+
+/*!
+ * \internal
+ * \brief Destructor function for remembered sorcery memory cache results
+ *
+ * \param obj A sorcery memory cached result
+ */
+static void sorcery_memory_cached_result_destructor(void *obj)
+{
+	struct sorcery_memory_cached_result *result = obj;
+
+	ao2_cleanup(result->objects);
+}
+
+/*!
+ * \internal
+ * \brief Determine whether a remembered result has outlived the given lifetime
+ *
+ * \param result The remembered result
+ * \param lifetime The lifetime (in seconds), 0 if results do not expire
+ *
+ * \retval 0 not expired
+ * \retval 1 expired
+ */
+static int cached_result_expired(const struct sorcery_memory_cached_result *result, unsigned int lifetime)
+{
+	return lifetime &&
+		ast_tvcmp(ast_tvnow(), ast_tvadd(result->created, ast_samp2tv(lifetime, 1))) >= 0;
+}
+
+/*!
+ * \internal
+ * \brief AO2 callback function for finding expired remembered results
+ *
+ * \param obj The remembered result
+ * \param arg The lifetime of results
+ * \param flags Unused flags
+ */
+static int cached_result_expired_callback(void *obj, void *arg, int flags)
+{
+	return cached_result_expired(obj, *(unsigned int *) arg) ? CMP_MATCH : 0;
+}
+
+/*!
+ * \internal
+ * \brief The lifetime (in seconds) of remembered multiple object retrievals
+ *
+ * Query results are held no longer than the objects in them would be, 0 if until invalidated.
+ */
+static unsigned int query_lifetime(const struct sorcery_memory_cache *cache)
+{
+	return cache->object_lifetime_stale ? cache->object_lifetime_stale : cache->object_lifetime_maximum;
+}
+
+/*!
+ * \internal
+ * \brief Remember a result, making room for it if needed
+ *
+ * \param cache The sorcery memory cache
+ * \param container The container of remembered results to add to
+ * \param added The count of results added to the container since it was last purged
+ * \param lifetime The lifetime (in seconds) of results in the container, 0 if they do not expire
+ * \param result The result to remember
+ */
+static void cached_results_add(struct sorcery_memory_cache *cache, struct ao2_container *container,
+	unsigned int *added, unsigned int lifetime, struct sorcery_memory_cached_result *result)
+{
+	ao2_wrlock(container);
+	ao2_find(container, result->key, OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA | OBJ_NOLOCK);
+
+	if (cache->maximum_objects && ao2_container_count(container) >= cache->maximum_objects) {
+		if (lifetime) {
+			ao2_callback(container, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
+				cached_result_expired_callback, &lifetime);
+		}
+		if (ao2_container_count(container) >= cache->maximum_objects) {
+			ao2_callback(container, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+		}
+		*added = 0;
+	} else if (!cache->maximum_objects && lifetime && ++(*added) >= CACHED_RESULTS_PURGE_INTERVAL) {
+		ao2_callback(container, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
+			cached_result_expired_callback, &lifetime);
+		*added = 0;
+	}
+
+	ao2_link_flags(container, result, OBJ_NOLOCK);
+	ao2_unlock(container);
+}
+
+/*!
+ * \internal
+ * \brief Find a remembered result which has not expired
+ *
+ * \param container The container of remembered results
+ * \param key The object id or query
+ * \param lifetime The lifetime (in seconds) of results in the container, 0 if they do not expire
+ *
+ * \retval non-NULL the result, with a reference
+ * \retval NULL no result is remembered
+ */
+static struct sorcery_memory_cached_result *cached_result_find(struct ao2_container *container,
+	const char *key, unsigned int lifetime)
+{
+	struct sorcery_memory_cached_result *result;
+
+	result = ao2_find(container, key, OBJ_SEARCH_KEY);
+	if (result && cached_result_expired(result, lifetime)) {
+		ao2_unlink(container, result);
+		ao2_ref(result, -1);
+		result = NULL;
+	}
+
+	return result;
+}
+
+/*!
+ * \internal
+ * \brief Allocate a remembered result
+ *
+ * \param key The object id or query the result is for
+ *
+ * \retval non-NULL success
+ * \retval NULL failure
+ */
+static struct sorcery_memory_cached_result *cached_result_alloc(const char *key)
+{
+	struct sorcery_memory_cached_result *result;
+	size_t key_len = strlen(key) + 1;
+
+	result = ao2_alloc_options(sizeof(*result) + key_len, sorcery_memory_cached_result_destructor,
+		AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!result) {
+		return NULL;
+	}
+
+	result->created = ast_tvnow();
+	ast_copy_string(result->key, key, key_len);
+
+	return result;
+}
+
+/*!
+ * \internal
+ * \brief Forget the results of all multiple object retrievals
+ *
+ * \param cache The sorcery memory cache
+ */
+static void forget_all_queries(struct sorcery_memory_cache *cache)
+{
+	if (cache->queries) {
+		ao2_callback(cache->queries, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Build the key a multiple object retrieval is remembered by
+ *
+ * \param fields The fields the objects were retrieved by, NULL if all objects or by regex
+ * \param regex The regex the objects were retrieved by, NULL if by fields
+ *
+ * \retval non-NULL success
+ * \retval NULL failure
+ */
+static struct ast_str *query_key_build(const struct ast_variable *fields, const char *regex)
+{
+	struct ast_str *key = ast_str_create(64);
+
+	if (!key) {
+		return NULL;
+	}
+
+	/* Field names and values are separated by unit and record separators, which
+	 * will not occur in either, so that no two different queries share a key.
+	 */
+	if (regex) {
+		ast_str_set(&key, 0, "R%s", regex);
+	} else {
+		ast_str_set(&key, 0, "F");
+		for (; fields; fields = fields->next) {
+			ast_str_append(&key, 0, "%s\x1f%s\x1e", fields->name, fields->value);
+		}
+	}
+
+	return key;
+}
+
 static int schedule_cache_expiration(struct sorcery_memory_cache *cache);
 
 /*!
@@ -547,6 +772,11 @@ static void remove_all_from_cache(struct sorcery_memory_cache *cache)
 	ao2_callback(cache->objects, OBJ_UNLINK | OBJ_NOLOCK | OBJ_NODATA | OBJ_MULTIPLE,
 		NULL, NULL);
 
+	if (cache->missing) {
+		ao2_callback(cache->missing, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	}
+	forget_all_queries(cache);
+
 	cache->del_expire = 1;
 	AST_SCHED_DEL_UNREF(sched, cache->expire_id, ao2_ref(cache, -1));
 	cache->del_expire = 0;
@@ -808,6 +1038,11 @@ static int sorcery_memory_cache_create(const struct ast_sorcery *sorcery, void *
 
 	ao2_wrlock(cache->objects);
 	remove_from_cache(cache, ast_sorcery_object_get_id(object), 1);
+	if (cache->missing) {
+		ao2_find(cache->missing, ast_sorcery_object_get_id(object), OBJ_SEARCH_KEY | OBJ_UNLINK | OBJ_NODATA);
+	}
+	/* The object may now match, or no longer match, remembered queries */
+	forget_all_queries(cache);
 	if (cache->maximum_objects && ao2_container_count(cache->objects) >= cache->maximum_objects) {
 		if (remove_oldest_from_cache(cache)) {
 			ast_log(LOG_ERROR, "Unable to make room in cache for sorcery object '%s'.\n",
@@ -1305,6 +1540,44 @@ static void *sorcery_memory_cache_retrieve_fields(const struct ast_sorcery *sorc
 	return object;
 }
 
+/*!
+ * \internal
+ * \brief Place the remembered result of a multiple object retrieval into a container
+ *
+ * \param cache The sorcery memory cache
+ * \param objects Container to place the objects into
+ * \param fields The fields the objects are being retrieved by
+ * \param regex The regex the objects are being retrieved by
+ *
+ * \retval 0 the result is not remembered
+ * \retval 1 the objects were placed into the container
+ */
+static int retrieve_query(struct sorcery_memory_cache *cache, struct ao2_container *objects,
+	const struct ast_variable *fields, const char *regex)
+{
+	struct ast_str *key;
+	struct sorcery_memory_cached_result *result;
+	int res = 0;
+
+	if (!cache->queries) {
+		return 0;
+	}
+
+	key = query_key_build(fields, regex);
+	if (!key) {
+		return 0;
+	}
+
+	result = cached_result_find(cache->queries, ast_str_buffer(key), query_lifetime(cache));
+	ast_free(key);
+	if (result) {
+		res = !ao2_container_dup(objects, result->objects, 0);
+		ao2_ref(result, -1);
+	}
+
+	return res;
+}
+
 /*!
  * \internal
  * \brief Callback function to retrieve multiple objects from a memory cache
@@ -1326,7 +1599,12 @@ static void sorcery_memory_cache_retrieve_multiple(const struct ast_sorcery *sor
 		.container = objects,
 	};
 
-	if (is_passthru_update() || !cache->full_backend_cache) {
+	if (is_passthru_update()) {
+		return;
+	}
+
+	if (!cache->full_backend_cache) {
+		retrieve_query(cache, objects, fields, NULL);
 		return;
 	}
 
@@ -1360,7 +1638,16 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 		.regex = &expression,
 	};
 
-	if (is_passthru_update() || !cache->full_backend_cache || regcomp(&expression, regex, REG_EXTENDED | REG_NOSUB)) {
+	if (is_passthru_update()) {
+		return;
+	}
+
+	if (!cache->full_backend_cache) {
+		retrieve_query(cache, objects, NULL, regex);
+		return;
+	}
+
+	if (regcomp(&expression, regex, REG_EXTENDED | REG_NOSUB)) {
 		return;
 	}
 
@@ -1373,6 +1660,109 @@ static void sorcery_memory_cache_retrieve_regex(const struct ast_sorcery *sorcer
 	}
 }
 
+/*!
+ * \internal
+ * \brief Callback function to determine whether an object is remembered as missing
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object
+ * \param id The id of the object
+ *
+ * \retval 0 the object is not known to be missing
+ * \retval 1 the backend did not have the object when last asked
+ */
+static int sorcery_memory_cache_is_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cached_result *result;
+
+	if (is_passthru_update() || !cache->missing) {
+		return 0;
+	}
+
+	result = cached_result_find(cache->missing, id, cache->object_lifetime_missing);
+	if (!result) {
+		return 0;
+	}
+
+	ao2_ref(result, -1);
+	return 1;
+}
+
+/*!
+ * \internal
+ * \brief Callback function to remember that the backend does not have an object
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the object
+ * \param id The id of the object
+ */
+static void sorcery_memory_cache_cache_missing(const struct ast_sorcery *sorcery, void *data, const char *type,
+	const char *id)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct sorcery_memory_cached_result *result;
+
+	if (is_passthru_update() || !cache->missing) {
+		return;
+	}
+
+	result = cached_result_alloc(id);
+	if (!result) {
+		return;
+	}
+
+	cached_results_add(cache, cache->missing, &cache->missing_added, cache->object_lifetime_missing, result);
+	ao2_ref(result, -1);
+}
+
+/*!
+ * \internal
+ * \brief Callback function to remember the result of a multiple object retrieval
+ *
+ * \param sorcery The sorcery instance
+ * \param data The sorcery memory cache
+ * \param type The type of the objects
+ * \param objects The objects retrieved
+ * \param fields The fields the objects were retrieved by
+ * \param regex The regex the objects were retrieved by
+ */
+static void sorcery_memory_cache_cache_multiple(const struct ast_sorcery *sorcery, void *data, const char *type,
+	struct ao2_container *objects, const struct ast_variable *fields, const char *regex)
+{
+	struct sorcery_memory_cache *cache = data;
+	struct ast_str *key;
+	struct sorcery_memory_cached_result *result;
+
+	/* Empty results are not remembered as they are indistinguishable from a miss */
+	if (is_passthru_update() || !cache->queries || !ao2_container_count(objects)) {
+		return;
+	}
+
+	key = query_key_build(fields, regex);
+	if (!key) {
+		return;
+	}
+
+	result = cached_result_alloc(ast_str_buffer(key));
+	ast_free(key);
+	if (!result) {
+		return;
+	}
+
+	result->objects = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL);
+	if (!result->objects || ao2_container_dup(result->objects, objects, 0)) {
+		ao2_ref(result, -1);
+		return;
+	}
+
+	cached_results_add(cache, cache->queries, &cache->queries_added, query_lifetime(cache), result);
+	ao2_ref(result, -1);
+}
+
 /*!
  * \internal
  * \brief Callback function to finish configuring the memory cache
@@ -1503,6 +1893,14 @@ static void *sorcery_memory_cache_open(const char *data)
 			cache->expire_on_reload = ast_true(value);
 		} else if (!strcasecmp(name, "full_backend_cache")) {
 			cache->full_backend_cache = ast_true(value);
+		} else if (!strcasecmp(name, "object_lifetime_missing")) {
+			if (configuration_parse_unsigned_integer(value, &cache->object_lifetime_missing) != 1) {
+				ast_log(LOG_ERROR, "Unsupported object missing lifetime value of '%s' used for memory cache\n",
+					value);
+				return NULL;
+			}
+		} else if (!strcasecmp(name, "query_cache")) {
+			cache->query_cache = ast_true(value);
 		} else {
 			ast_log(LOG_ERROR, "Unsupported option '%s' used for memory cache\n", name);
 			return NULL;
@@ -1524,6 +1922,25 @@ static void *sorcery_memory_cache_open(const char *data)
 		return NULL;
 	}
 
+	if (cache->object_lifetime_missing) {
+		cache->missing = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_RWLOCK, CACHE_CONTAINER_BUCKET_SIZE,
+			sorcery_memory_cached_result_hash_fn, sorcery_memory_cached_result_cmp_fn);
+		if (!cache->missing) {
+			ast_log(LOG_ERROR, "Could not create a container to hold missing objects for memory cache\n");
+			return NULL;
+		}
+	}
+
+	/* A full backend cache already answers every query from the objects it holds */
+	if (cache->query_cache && !cache->full_backend_cache) {
+		cache->queries = ao2_container_alloc_options(AO2_ALLOC_OPT_LOCK_RWLOCK, CACHE_CONTAINER_BUCKET_SIZE,
+			sorcery_memory_cached_result_hash_fn, sorcery_memory_cached_result_cmp_fn);
+		if (!cache->queries) {
+			ast_log(LOG_ERROR, "Could not create a container to hold query results for memory cache\n");
+			return NULL;
+		}
+	}
+
 	/* The memory cache is not linked to the caches container until the load callback is invoked.
 	 * Linking occurs there so an intelligent cache name can be constructed using the module of
 	 * the sorcery instance and the specific object type if no cache name was specified as part
@@ -1552,6 +1969,7 @@ static int sorcery_memory_cache_delete(const struct ast_sorcery *sorcery, void *
 
 	ao2_wrlock(cache->objects);
 	res = remove_from_cache(cache, ast_sorcery_object_get_id(object), 1);
+	forget_all_queries(cache);
 	ao2_unlock(cache->objects);
 
 	if (res) {
@@ -1673,6 +2091,18 @@ static char *sorcery_memory_cache_show(struct ast_cli_entry *e, int cmd, struct
 		ast_cli(a->fd, "Object staleness is not enabled - cached objects will not go stale\n");
 	}
 	ast_cli(a->fd, "Expire all objects on reload: %s\n", AST_CLI_ONOFF(cache->expire_on_reload));
+	if (cache->missing) {
+		ast_cli(a->fd, "Number of seconds a missing object is remembered: %d (%d remembered)\n",
+			cache->object_lifetime_missing, ao2_container_count(cache->missing));
+	} else {
+		ast_cli(a->fd, "Missing objects are not remembered\n");
+	}
+	if (cache->queries) {
+		ast_cli(a->fd, "Number of multiple object retrievals remembered: %d\n",
+			ao2_container_count(cache->queries));
+	} else {
+		ast_cli(a->fd, "Multiple object retrievals are not remembered\n");
+	}
 
 	ao2_ref(cache, -1);
 
@@ -2234,7 +2664,9 @@ AST_TEST_DEFINE(open_with_valid_options)
 			"\t* Creates a memory cache with default configuration\n"
 			"\t* Creates a memory cache with a maximum object count of 10 and verifies it\n"
 			"\t* Creates a memory cache with a maximum object lifetime of 60 and verifies it\n"
-			"\t* Creates a memory cache with a stale object lifetime of 90 and verifies it";
+			"\t* Creates a memory cache with a stale object lifetime of 90 and verifies it\n"
+			"\t* Creates a memory cache with a missing object lifetime of 30 and verifies it\n"
+			"\t* Creates a memory cache with query caching and verifies it";
 		return AST_TEST_NOT_RUN;
 	case TEST_EXECUTE:
 		break;
@@ -2284,6 +2716,31 @@ AST_TEST_DEFINE(open_with_valid_options)
 		sorcery_memory_cache_close(cache);
 	}
 
+	cache = sorcery_memory_cache_open("object_lifetime_missing=30");
+	if (!cache) {
+		ast_test_status_update(test, "Failed to create a sorcery memory cache with a missing object lifetime of 30\n");
+		res = AST_TEST_FAIL;
+	} else {
+		if (cache->object_lifetime_missing != 30 || !cache->missing) {
+			ast_test_status_update(test, "Created a sorcery memory cache with a missing object lifetime of 30 but it has '%u'\n",
+				cache->object_lifetime_missing);
+			res = AST_TEST_FAIL;
+		}
+		sorcery_memory_cache_close(cache);
+	}
+
+	cache = sorcery_memory_cache_open("query_cache=yes");
+	if (!cache) {
+		ast_test_status_update(test, "Failed to create a sorcery memory cache with query caching\n");
+		res = AST_TEST_FAIL;
+	} else {
+		if (!cache->query_cache || !cache->queries) {
+			ast_test_status_update(test, "Created a sorcery memory cache with query caching but it is disabled\n");
+			res = AST_TEST_FAIL;
+		}
+		sorcery_memory_cache_close(cache);
+	}
+
 
 	return res;
 }
@@ -2305,7 +2762,9 @@ AST_TEST_DEFINE(open_with_invalid_options)
 			"\t* Create a memory cache with a maximum object lifetime of -1\n"
 			"\t* Create a memory cache with a maximum object lifetime of toast\n"
 			"\t* Create a memory cache with a stale object lifetime of -1\n"
-			"\t* Create a memory cache with a stale object lifetime of toast";
+			"\t* Create a memory cache with a stale object lifetime of toast\n"
+			"\t* Create a memory cache with a missing object lifetime of -1\n"
+			"\t* Create a memory cache with a missing object lifetime of toast";
 		return AST_TEST_NOT_RUN;
 	case TEST_EXECUTE:
 		break;
@@ -2360,6 +2819,20 @@ AST_TEST_DEFINE(open_with_invalid_options)
 		res = AST_TEST_FAIL;
 	}
 
+	cache = sorcery_memory_cache_open("object_lifetime_missing=-1");
+	if (cache) {
+		ast_test_status_update(test, "Created a sorcery memory cache with a missing object lifetime of -1\n");
+		sorcery_memory_cache_close(cache);
+		res = AST_TEST_FAIL;
+	}
+
+	cache = sorcery_memory_cache_open("object_lifetime_missing=toast");
+	if (cache) {
+		ast_test_status_update(test, "Created a sorcery memory cache with a missing object lifetime of toast\n");
+		sorcery_memory_cache_close(cache);
+		res = AST_TEST_FAIL;
+	}
+
 	cache = sorcery_memory_cache_open("tacos");
 	if (cache) {
 		ast_test_status_update(test, "Created a sorcery memory cache with an invalid configuration option 'tacos'\n");
@@ -2886,6 +3359,9 @@ static struct backend_data {
 	int exists;
 } *real_backend_data;
 
+/*! \brief Number of times the mock backend has been asked for objects */
+static int mock_retrievals;
+
 /*!
  * \brief Sorcery object created based on backend data
  */
@@ -2925,6 +3401,8 @@ static void *mock_retrieve_id(const struct ast_sorcery *sorcery, void *data,
 {
 	struct test_data *b_data;
 
+	++mock_retrievals;
+
 	if (!real_backend_data->exists) {
 		return NULL;
 	}
@@ -2957,6 +3435,8 @@ static void mock_retrieve_multiple(const struct ast_sorcery *sorcery, void *data
 {
 	int i;
 
+	++mock_retrievals;
+
 	if (fields) {
 		return;
 	}
@@ -3401,6 +3881,198 @@ cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(missing)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct sorcery_memory_cache *cache = NULL;
+	struct backend_data initial = {
+		.salt = 1,
+		.pepper = 2,
+		.exists = 0,
+	};
+	struct test_data *object;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "missing";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that missing objects are remembered";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache that remembers missing objects for 2 seconds\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Retrieves an object the backend does not have twice and confirms the backend is asked once\n"
+			"\t* Waits for the missing object to be forgotten and confirms the backend is asked again\n"
+			"\t* Caches the object and confirms it is then retrieved from the cache";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache",
+			"name=test_missing,object_lifetime_missing=2", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+	ast_sorcery_load(sorcery);
+
+	cache = ao2_find(caches, "test_missing", OBJ_SEARCH_KEY);
+	if (!cache) {
+		ast_test_status_update(test, "Failed to find the memory cache\n");
+		goto cleanup;
+	}
+
+	real_backend_data = &initial;
+	mock_retrievals = 0;
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	ao2_cleanup(object);
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	ao2_cleanup(object);
+	if (object || mock_retrievals != 1) {
+		ast_test_status_update(test, "Backend was asked for a missing object %d times instead of once\n",
+			mock_retrievals);
+		goto cleanup;
+	}
+
+	sleep(3);
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	ao2_cleanup(object);
+	if (object || mock_retrievals != 2) {
+		ast_test_status_update(test, "Backend was not asked again once the missing object was forgotten\n");
+		goto cleanup;
+	}
+
+	/* Caching the object, as happens when it is created, must forget that it is missing */
+	initial.exists = 1;
+	object = mock_retrieve_id(sorcery, NULL, "test", "test");
+	if (!object || sorcery_memory_cache_create(sorcery, cache, object)) {
+		ast_test_status_update(test, "Failed to cache the object\n");
+		ao2_cleanup(object);
+		goto cleanup;
+	}
+	ao2_ref(object, -1);
+
+	object = ast_sorcery_retrieve_by_id(sorcery, "test", "test");
+	if (!object) {
+		ast_test_status_update(test, "Object is still remembered as missing after being cached\n");
+		goto cleanup;
+	}
+	ao2_ref(object, -1);
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ao2_cleanup(cache);
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	return res;
+}
+
+AST_TEST_DEFINE(query_cache)
+{
+	int res = AST_TEST_FAIL;
+	struct ast_sorcery *sorcery = NULL;
+	struct sorcery_memory_cache *cache = NULL;
+	struct backend_data initial = {
+		.salt = 0,
+		.pepper = 0,
+		.exists = 4,
+	};
+	struct ao2_container *objects;
+	struct test_data *object;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "query_cache";
+		info->category = "/res/res_sorcery_memory_cache/";
+		info->summary = "Ensure that multiple object retrievals are remembered";
+		info->description = "This test performs the following:\n"
+			"\t* Create a sorcery instance with two wizards"
+			"\t\t* The first is a memory cache that remembers queries\n"
+			"\t\t* The second is a mock of a back-end\n"
+			"\t* Retrieves all objects, which returns 4, twice and confirms the backend is asked once\n"
+			"\t* Updates the backend to contain 8 objects and caches an updated object\n"
+			"\t* Retrieves all objects and confirms the number returned is 8";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_sorcery_wizard_register(&mock_wizard);
+
+	sorcery = ast_sorcery_open();
+	if (!sorcery) {
+		ast_test_status_update(test, "Failed to create sorcery instance\n");
+		goto cleanup;
+	}
+
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "memory_cache",
+			"name=test_query_cache,query_cache=yes", 1);
+	ast_sorcery_apply_wizard_mapping(sorcery, "test", "mock", NULL, 0);
+	ast_sorcery_internal_object_register(sorcery, "test", test_data_alloc, NULL, NULL);
+	ast_sorcery_load(sorcery);
+
+	cache = ao2_find(caches, "test_query_cache", OBJ_SEARCH_KEY);
+	if (!cache) {
+		ast_test_status_update(test, "Failed to find the memory cache\n");
+		goto cleanup;
+	}
+
+	real_backend_data = &initial;
+	mock_retrievals = 0;
+
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	ao2_cleanup(objects);
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (!objects || ao2_container_count(objects) != 4 || mock_retrievals != 1) {
+		ast_test_status_update(test, "Expected 4 objects from one backend retrieval but got %d from %d\n",
+			objects ? ao2_container_count(objects) : 0, mock_retrievals);
+		ao2_cleanup(objects);
+		goto cleanup;
+	}
+
+	/* Updating any object must forget the remembered query */
+	object = ao2_callback(objects, 0, NULL, NULL);
+	ao2_ref(objects, -1);
+	initial.exists = 8;
+	if (!object || sorcery_memory_cache_create(sorcery, cache, object)) {
+		ast_test_status_update(test, "Failed to cache an updated object\n");
+		ao2_cleanup(object);
+		goto cleanup;
+	}
+	ao2_ref(object, -1);
+
+	objects = ast_sorcery_retrieve_by_fields(sorcery, "test", AST_RETRIEVE_FLAG_MULTIPLE | AST_RETRIEVE_FLAG_ALL, NULL);
+	if (!objects || ao2_container_count(objects) != 8) {
+		ast_test_status_update(test, "Remembered query was not forgotten when an object was updated\n");
+		ao2_cleanup(objects);
+		goto cleanup;
+	}
+	ao2_ref(objects, -1);
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ao2_cleanup(cache);
+	if (sorcery) {
+		ast_sorcery_unref(sorcery);
+	}
+	ast_sorcery_wizard_unregister(&mock_wizard);
+	return res;
+}
+
 #endif
 
 static int unload_module(void)
@@ -3415,6 +4087,8 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(stale);
 	AST_TEST_UNREGISTER(full_backend_cache_expiration);
 	AST_TEST_UNREGISTER(full_backend_cache_stale);
+	AST_TEST_UNREGISTER(missing);
+	AST_TEST_UNREGISTER(query_cache);
 
 	ast_manager_unregister("SorceryMemoryCacheExpireObject");
 	ast_manager_unregister("SorceryMemoryCacheExpire");
@@ -3496,6 +4170,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(expiration);
 	AST_TEST_REGISTER(full_backend_cache_expiration);
 	AST_TEST_REGISTER(full_backend_cache_stale);
+	AST_TEST_REGISTER(missing);
+	AST_TEST_REGISTER(query_cache);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -60,6 +60,9 @@ static void sorcery_realtime_retrieve_regex(const struct ast_sorcery *sorcery, v
 static int sorcery_realtime_update(const struct ast_sorcery *sorcery, void *data, void *object);
 static int sorcery_realtime_delete(const struct ast_sorcery *sorcery, void *data, void *object);
 static void sorcery_realtime_close(void *data);
+static int sorcery_realtime_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects);
+static int sorcery_realtime_update_fields(const struct ast_sorcery *sorcery, void *data, void *object,
+	const struct ast_variable *fields);
 
 static struct ast_sorcery_wizard realtime_object_wizard = {
 	.name = "realtime",
@@ -72,6 +75,8 @@ static struct ast_sorcery_wizard realtime_object_wizard = {
 	.update = sorcery_realtime_update,
 	.delete = sorcery_realtime_delete,
 	.close = sorcery_realtime_close,
+	.create_multiple = sorcery_realtime_create_multiple,
+	.update_fields = sorcery_realtime_update_fields,
 };
 
 static int sorcery_realtime_create(const struct ast_sorcery *sorcery, void *data, void *object)
@@ -272,6 +277,18 @@ static int sorcery_realtime_update(const struct ast_sorcery *sorcery, void *data
 	return (ast_update_realtime_fields(config->family, UUID_FIELD, ast_sorcery_object_get_id(object), fields) < 0) ? -1 : 0;
 }
 
+static int sorcery_realtime_update_fields(const struct ast_sorcery *sorcery, void *data, void *object,
+	const struct ast_variable *fields)
+{
+	struct sorcery_config *config = data;
+
+	if (!fields) {
+		return 0;
+	}
+
+	return (ast_update_realtime_fields(config->family, UUID_FIELD, ast_sorcery_object_get_id(object), fields) < 0) ? -1 : 0;
+}
+
 static int sorcery_realtime_delete(const struct ast_sorcery *sorcery, void *data, void *object)
 {
 	struct sorcery_config *config = data;
@@ -279,6 +296,38 @@ static int sorcery_realtime_delete(const struct ast_sorcery *sorcery, void *data
 	return (ast_destroy_realtime_fields(config->family, UUID_FIELD, ast_sorcery_object_get_id(object), NULL) <= 0) ? -1 : 0;
 }
 
+static int sorcery_realtime_create_multiple(const struct ast_sorcery *sorcery, void *data, struct ao2_container *objects)
+{
+	struct ao2_iterator iter;
+	void *object;
+	void *stored;
+
+	/* Realtime stores one row at a time, so a failure removes the rows stored before it */
+	iter = ao2_iterator_init(objects, 0);
+	while ((object = ao2_iterator_next(&iter))) {
+		if (sorcery_realtime_create(sorcery, data, object)) {
+			break;
+		}
+		ao2_ref(object, -1);
+	}
+	ao2_iterator_destroy(&iter);
+
+	if (!object) {
+		return 0;
+	}
+
+	iter = ao2_iterator_init(objects, 0);
+	while ((stored = ao2_iterator_next(&iter)) && stored != object) {
+		sorcery_realtime_delete(sorcery, data, stored);
+		ao2_ref(stored, -1);
+	}
+	ao2_cleanup(stored);
+	ao2_iterator_destroy(&iter);
+	ao2_ref(object, -1);
+
+	return -1;
+}
+
 static void *sorcery_realtime_open(const char *data)
 {
 	struct sorcery_config *config;
@@ -37,6 +37,10 @@
 #include "asterisk/term.h"
 #include "asterisk/speech.h"
 #include "asterisk/format_cache.h"
+#include "asterisk/media_fork.h"
+
+/*! \brief Most frames waiting for an engine that writes on its own thread */
+#define SPEECH_FORK_DEPTH 128
 
 static AST_RWLIST_HEAD_STATIC(engines, ast_speech_engine);
 static struct ast_speech_engine *default_engine = NULL;
@@ -146,9 +150,34 @@ int ast_speech_write(struct ast_speech *speech, void *data, int len)
 	if (speech->state != AST_SPEECH_STATE_READY)
 		return -1;
 
+	if (speech->fork) {
+		struct ast_frame frame = {
+			.frametype = AST_FRAME_VOICE,
+			.subclass.format = speech->format,
+			.data.ptr = data,
+			.datalen = len,
+			.src = "speech",
+		};
+
+		frame.samples = ast_codec_samples_count(&frame);
+		return ast_media_fork_write(speech->fork, &frame);
+	}
+
 	return speech->engine->write(speech, data, len);
 }
 
+/*! \brief Hand audio from the media fork to the engine */
+static int speech_fork_write(void *data, struct ast_frame *frame)
+{
+	struct ast_speech *speech = data;
+
+	return speech->engine->write(speech, frame->data.ptr, frame->datalen);
+}
+
+static const struct ast_media_fork_consumer speech_fork_consumer = {
+	.write = speech_fork_write,
+};
+
 /*! \brief Signal to the engine that DTMF was received */
 int ast_speech_dtmf(struct ast_speech *speech, const char *dtmf)
 {
@@ -229,7 +258,20 @@ struct ast_speech *ast_speech_new(const char *engine_name, const struct ast_form
 	if (engine->create(new_speech, best)) {
 		ast_mutex_destroy(&new_speech->lock);
 		ast_free(new_speech);
-		new_speech = NULL;
+		return NULL;
+	}
+
+	/* Keep the channel from waiting on an engine that can take audio on another thread */
+	if (engine->async_write) {
+		char name[64];
+
+		snprintf(name, sizeof(name), "speech/%s", engine->name);
+		new_speech->fork = ast_media_fork_create(name, best, SPEECH_FORK_DEPTH,
+			&speech_fork_consumer, new_speech);
+		if (!new_speech->fork) {
+			ast_log(LOG_WARNING, "Speech engine '%s' will be written to on the channel thread\n",
+				engine->name);
+		}
 	}
 
 	return new_speech;
@@ -240,6 +282,9 @@ int ast_speech_destroy(struct ast_speech *speech)
 {
 	int res = 0;
 
+	/* Audio must stop going to the engine before it is destroyed */
+	ast_media_fork_destroy(speech->fork);
+
 	/* Call our engine so we are destroyed properly */
 	speech->engine->destroy(speech);
 
@@ -46,6 +46,7 @@
 #endif
 
 #include "asterisk/astobj2.h"           /* for ao2_t_ref, etc */
+#include "asterisk/cli.h"               /* for ast_cli, etc */
 #include "asterisk/frame.h"             /* for AST_FRIENDLY_OFFSET */
 #include "asterisk/logger.h"            /* for ast_log, ast_debug, etc */
 #include "asterisk/module.h"            /* for ast_module_info, etc */
@@ -72,6 +73,28 @@ struct ast_srtp_policy {
 /*! Tracks whether or not we've initialized the libsrtp library */
 static int g_initialized = 0;
 
+/*! \brief Counters of every SRTP session, updated without locking */
+static struct {
+	/*! Packets protected */
+	uint64_t protected;
+	/*! Octets protected, before the trailer is added */
+	uint64_t protected_octets;
+	/*! Packets which could not be protected */
+	uint64_t protect_failures;
+	/*! Packets unprotected */
+	uint64_t unprotected;
+	/*! Octets unprotected, after the trailer is removed */
+	uint64_t unprotected_octets;
+	/*! Packets which failed authentication */
+	uint64_t auth_failures;
+	/*! Packets which were replayed or too old */
+	uint64_t replay_failures;
+	/*! Packets which could not be unprotected for any other reason */
+	uint64_t unprotect_failures;
+} srtp_stats;
+
+#define SRTP_STATS_ADD(field, value) __atomic_fetch_add(&srtp_stats.field, (value), __ATOMIC_RELAXED)
+
 /* SRTP functions */
 static int ast_srtp_create(struct ast_srtp **srtp, struct ast_rtp_instance *rtp, struct ast_srtp_policy *policy);
 static int ast_srtp_replace(struct ast_srtp **srtp, struct ast_rtp_instance *rtp, struct ast_srtp_policy *policy);
@@ -433,11 +456,20 @@ tryagain:
 	}
 
 	if (!srtp->session) {
+		SRTP_STATS_ADD(unprotect_failures, 1);
 		errno = EINVAL;
 		return -1;
 	}
 
 	if (res != err_status_ok && res != err_status_replay_fail ) {
+		if (res == err_status_auth_fail) {
+			SRTP_STATS_ADD(auth_failures, 1);
+		} else if (res == err_status_replay_old) {
+			SRTP_STATS_ADD(replay_failures, 1);
+		} else {
+			SRTP_STATS_ADD(unprotect_failures, 1);
+		}
+
 		if ((srtp->warned >= 10) && !((srtp->warned - 10) % 100)) {
 			ast_log(AST_LOG_WARNING, "SRTP unprotect failed with: %s %d\n", srtp_errstr(res), srtp->warned);
 			srtp->warned = 11;
@@ -448,15 +480,24 @@ tryagain:
 		return -1;
 	}
 
+	if (res == err_status_replay_fail) {
+		SRTP_STATS_ADD(replay_failures, 1);
+	} else {
+		SRTP_STATS_ADD(unprotected, 1);
+		SRTP_STATS_ADD(unprotected_octets, *len);
+	}
+
 	return *len;
 }
 
 static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtcp)
 {
 	int res;
+	int octets = *len;
 	unsigned char *localbuf;
 
 	if ((*len + SRTP_MAX_TRAILER_LEN) > sizeof(srtp->buf)) {
+		SRTP_STATS_ADD(protect_failures, 1);
 		return -1;
 	}
 	
@@ -465,9 +506,12 @@ static int ast_srtp_protect(struct ast_srtp *srtp, void **buf, int *len, int rtc
 	memcpy(localbuf, *buf, *len);
 
 	if ((res = rtcp ? srtp_protect_rtcp(srtp->session, localbuf, len) : srtp_protect(srtp->session, localbuf, len)) != err_status_ok && res != err_status_replay_fail) {
+		SRTP_STATS_ADD(protect_failures, 1);
 		ast_log(LOG_WARNING, "SRTP protect: %s\n", srtp_errstr(res));
 		return -1;
 	}
+	SRTP_STATS_ADD(protected, 1);
+	SRTP_STATS_ADD(protected_octets, octets);
 
 	*buf = localbuf;
 	return *len;
@@ -1154,8 +1198,45 @@ static struct ast_sdp_crypto_api res_sdp_crypto_api = {
 	.get_attr = res_sdp_srtp_get_attr,
 };
 
+static char *handle_cli_srtp_show_stats(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "srtp show stats";
+		e->usage =
+			"Usage: srtp show stats\n"
+			"       Shows how many packets and octets every SRTP session protected and\n"
+			"       unprotected since the module was loaded, and why packets failed.\n";
+		return NULL;
+	case CLI_GENERATE:
+		return NULL;
+	}
+
+	if (a->argc != 3) {
+		return CLI_SHOWUSAGE;
+	}
+
+#define FORMAT "%-24s %20" PRIu64 "\n"
+	ast_cli(a->fd, FORMAT, "Protected packets:", __atomic_load_n(&srtp_stats.protected, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Protected octets:", __atomic_load_n(&srtp_stats.protected_octets, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Protect failures:", __atomic_load_n(&srtp_stats.protect_failures, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Unprotected packets:", __atomic_load_n(&srtp_stats.unprotected, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Unprotected octets:", __atomic_load_n(&srtp_stats.unprotected_octets, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Authentication failures:", __atomic_load_n(&srtp_stats.auth_failures, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Replay failures:", __atomic_load_n(&srtp_stats.replay_failures, __ATOMIC_RELAXED));
+	ast_cli(a->fd, FORMAT, "Unprotect failures:", __atomic_load_n(&srtp_stats.unprotect_failures, __ATOMIC_RELAXED));
+#undef FORMAT
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry srtp_cli[] = {
+	AST_CLI_DEFINE(handle_cli_srtp_show_stats, "Show SRTP packet counters"),
+};
+
 static void res_srtp_shutdown(void)
 {
+	ast_cli_unregister_multiple(srtp_cli, ARRAY_LEN(srtp_cli));
 	ast_sdp_crypto_unregister(&res_sdp_crypto_api);
 	ast_rtp_engine_unregister_srtp();
 	srtp_install_event_handler(NULL);
@@ -1190,6 +1271,8 @@ static int res_srtp_init(void)
 		return -1;
 	}
 
+	ast_cli_register_multiple(srtp_cli, ARRAY_LEN(srtp_cli));
+
 	g_initialized = 1;
 	return 0;
 }
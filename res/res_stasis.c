@@ -1343,7 +1343,7 @@ int stasis_app_exec(struct ast_channel *chan, const char *app_name, int argc,
 			continue;
 		}
 
-		r = ast_waitfor(chan, MAX_WAIT_MS);
+		r = control_waitfor(control, chan, MAX_WAIT_MS);
 
 		if (r < 0) {
 			ast_debug(3, "%s: Poll error\n",
@@ -1758,6 +1758,24 @@ static enum stasis_app_subscribe_res app_handle_subscriptions(
 	return STASIS_ASR_OK;
 }
 
+enum stasis_app_event_filter_res stasis_app_event_filter_set(const char *app_name,
+	struct ast_json *filter, struct ast_json **json)
+{
+	RAII_VAR(struct stasis_app *, app, find_app_by_name(app_name), ao2_cleanup);
+	enum stasis_app_event_filter_res res;
+
+	if (!app) {
+		return STASIS_AEF_APP_NOT_FOUND;
+	}
+
+	res = app_event_filter_set(app, filter);
+	if (res == STASIS_AEF_OK && json) {
+		*json = stasis_app_object_to_json(app);
+	}
+
+	return res;
+}
+
 enum stasis_app_subscribe_res stasis_app_subscribe_channel(const char *app_name,
 	struct ast_channel *chan)
 {
@@ -46,10 +46,15 @@
 /*! \brief Index used to keep Snoop channel names unique */
 static unsigned int chan_idx;
 
-/*! \brief Structure which contains all of the snoop information */
-struct stasis_app_snoop {
-	/*! \brief Timer used for waking up Stasis thread */
-	struct ast_timer *timer;
+/*!
+ * \brief Audio spied on a channel, shared by every snoop wanting the same
+ *
+ * Snoops on the same channel in the same direction at the same rate share
+ * one audiohook, so the audio is only mixed and translated once however
+ * many of them there are.  Whichever snoop asks first in an interval reads
+ * the audiohook; the others get a reference to the same payload.
+ */
+struct snoop_tap {
 	/*! \brief Audiohook used to spy on the channel */
 	struct ast_audiohook spy;
 	/*! \brief Direction for spying */
@@ -58,6 +63,29 @@ struct stasis_app_snoop {
 	unsigned int spy_samples;
 	/*! \brief Format in use by the spy audiohook */
 	struct ast_format *spy_format;
+	/*! \brief The last frame read, with a shared payload, or NULL */
+	struct ast_frame *frame;
+	/*! \brief Bumped each time a frame is read from the audiohook */
+	unsigned int seq;
+	/*! \brief Snoops using the tap, protected by the taps container lock */
+	unsigned int users;
+	/*! \brief Uniqueid of the channel spied on */
+	char uniqueid[AST_MAX_UNIQUEID];
+};
+
+/*! \brief Taps with snoops using them */
+static struct ao2_container *taps;
+
+/*! \brief Structure which contains all of the snoop information */
+struct stasis_app_snoop {
+	/*! \brief Timer used for waking up Stasis thread */
+	struct ast_timer *timer;
+	/*! \brief Shared audiohook used to spy on the channel */
+	struct snoop_tap *tap;
+	/*! \brief Sequence of the last frame taken from the tap */
+	unsigned int tap_seq;
+	/*! \brief Format in use by the spy audiohook */
+	struct ast_format *spy_format;
 	/*! \brief Audiohook used to whisper on the channel */
 	struct ast_audiohook whisper;
 	/*! \brief Direction for whispering */
@@ -83,9 +111,7 @@ static void snoop_destroy(void *obj)
 		ast_timer_close(snoop->timer);
 	}
 
-	if (snoop->spy_active) {
-		ast_audiohook_destroy(&snoop->spy);
-	}
+	ao2_cleanup(snoop->tap);
 
 	if (snoop->whisper_active) {
 		ast_audiohook_destroy(&snoop->whisper);
@@ -96,6 +122,150 @@ static void snoop_destroy(void *obj)
 	ast_channel_cleanup(snoop->chan);
 }
 
+/*! \brief Destructor for tap structure */
+static void snoop_tap_destroy(void *obj)
+{
+	struct snoop_tap *tap = obj;
+
+	ast_audiohook_destroy(&tap->spy);
+	if (tap->frame) {
+		ast_frfree(tap->frame);
+	}
+}
+
+static int snoop_tap_cmp(void *obj, void *arg, int flags)
+{
+	struct snoop_tap *tap = obj;
+	struct snoop_tap *key = arg;
+
+	return tap->spy_direction == key->spy_direction
+		&& tap->spy_format == key->spy_format
+		&& !strcmp(tap->uniqueid, key->uniqueid) ? CMP_MATCH | CMP_STOP : 0;
+}
+
+/*!
+ * \internal
+ * \brief Find the tap spying on a channel in a direction at a rate, or attach one.
+ *
+ * \return The tap, with a reference for the caller
+ * \retval NULL on failure
+ */
+static struct snoop_tap *snoop_tap_get(struct ast_channel *chan,
+	enum ast_audiohook_direction direction, struct ast_format *format)
+{
+	struct snoop_tap key = {
+		.spy_direction = direction,
+		.spy_format = format,
+	};
+	struct snoop_tap *tap;
+
+	ast_copy_string(key.uniqueid, ast_channel_uniqueid(chan), sizeof(key.uniqueid));
+
+	ao2_lock(taps);
+	tap = ao2_callback(taps, OBJ_NOLOCK, snoop_tap_cmp, &key);
+	if (tap && tap->spy.status != AST_AUDIOHOOK_STATUS_RUNNING) {
+		/* Being torn down; leave it to the snoops still using it. */
+		ao2_unlink_flags(taps, tap, OBJ_NOLOCK);
+		ao2_ref(tap, -1);
+		tap = NULL;
+	}
+	if (tap) {
+		++tap->users;
+		ao2_unlock(taps);
+		return tap;
+	}
+
+	tap = ao2_alloc_options(sizeof(*tap), snoop_tap_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK);
+	if (!tap) {
+		ao2_unlock(taps);
+		return NULL;
+	}
+	ast_audiohook_init(&tap->spy, AST_AUDIOHOOK_TYPE_SPY, "Snoop", 0);
+	tap->spy_direction = direction;
+	tap->spy_format = format;
+	tap->spy_samples = ast_format_get_sample_rate(format) / (1000 / SNOOP_INTERVAL);
+	ast_copy_string(tap->uniqueid, key.uniqueid, sizeof(tap->uniqueid));
+
+	if (ast_audiohook_attach(chan, &tap->spy)) {
+		ao2_unlock(taps);
+		ao2_ref(tap, -1);
+		return NULL;
+	}
+	tap->users = 1;
+	ao2_link_flags(taps, tap, OBJ_NOLOCK);
+	ao2_unlock(taps);
+
+	return tap;
+}
+
+/*!
+ * \internal
+ * \brief Stop using a tap, detaching its audiohook if it was the last user.
+ *
+ * \note The reference of the snoop is left for its destructor to release.
+ */
+static void snoop_tap_release(struct snoop_tap *tap)
+{
+	int detach;
+
+	ao2_lock(taps);
+	detach = !--tap->users;
+	if (detach) {
+		ao2_unlink_flags(taps, tap, OBJ_NOLOCK);
+	}
+	ao2_unlock(taps);
+
+	if (detach) {
+		ast_audiohook_lock(&tap->spy);
+		ast_audiohook_detach(&tap->spy);
+		ast_audiohook_unlock(&tap->spy);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Get the next frame spied by a tap for one of its snoops.
+ *
+ * \note Called with the tap audiohook locked.
+ *
+ * \return A frame the caller owns, sharing its payload with the other snoops
+ * \retval NULL if there is no audio
+ */
+static struct ast_frame *snoop_tap_read(struct snoop_tap *tap, unsigned int *seq)
+{
+	struct ast_frame *frame;
+
+	if (*seq == tap->seq || !tap->frame) {
+		/* The last frame was taken already, so it is time for a new one. */
+		if (tap->spy_direction != AST_AUDIOHOOK_DIRECTION_BOTH) {
+			/*
+			 * When a singular direction is chosen frames are still written to the
+			 * opposing direction's queue. Those frames must be read so the queue
+			 * does not continue to grow, however since they are not needed for the
+			 * selected direction they can be dropped.
+			 */
+			enum ast_audiohook_direction opposing_direction =
+				tap->spy_direction == AST_AUDIOHOOK_DIRECTION_READ ?
+				AST_AUDIOHOOK_DIRECTION_WRITE : AST_AUDIOHOOK_DIRECTION_READ;
+			ast_frame_dtor(ast_audiohook_read_frame(&tap->spy, tap->spy_samples,
+								opposing_direction, tap->spy_format));
+		}
+
+		frame = ast_audiohook_read_frame(&tap->spy, tap->spy_samples, tap->spy_direction, tap->spy_format);
+		if (tap->frame) {
+			ast_frfree(tap->frame);
+		}
+		tap->frame = frame ? ast_frdup_shared(frame) : NULL;
+		if (frame) {
+			ast_frfree(frame);
+		}
+		++tap->seq;
+	}
+	*seq = tap->seq;
+
+	return tap->frame ? ast_frdup_shared(tap->frame) : NULL;
+}
+
 /*! \internal
  * \brief Publish the chanspy message over Stasis-Core
  * \param snoop The snoop structure
@@ -169,7 +339,7 @@ static struct ast_frame *snoop_read(struct ast_channel *chan)
 
 	/* If we fail to ack the timer OR if any active audiohooks are done hangup */
 	if ((ast_timer_ack(snoop->timer, 1) < 0) ||
-		(snoop->spy_active && snoop->spy.status != AST_AUDIOHOOK_STATUS_RUNNING) ||
+		(snoop->spy_active && snoop->tap->spy.status != AST_AUDIOHOOK_STATUS_RUNNING) ||
 		(snoop->whisper_active && snoop->whisper.status != AST_AUDIOHOOK_STATUS_RUNNING)) {
 		return NULL;
 	}
@@ -179,23 +349,9 @@ static struct ast_frame *snoop_read(struct ast_channel *chan)
 		return &ast_null_frame;
 	}
 
-	ast_audiohook_lock(&snoop->spy);
-	if (snoop->spy_direction != AST_AUDIOHOOK_DIRECTION_BOTH) {
-		/*
-		 * When a singular direction is chosen frames are still written to the
-		 * opposing direction's queue. Those frames must be read so the queue
-		 * does not continue to grow, however since they are not needed for the
-		 * selected direction they can be dropped.
-		 */
-		enum ast_audiohook_direction opposing_direction =
-			snoop->spy_direction == AST_AUDIOHOOK_DIRECTION_READ ?
-			AST_AUDIOHOOK_DIRECTION_WRITE : AST_AUDIOHOOK_DIRECTION_READ;
-		ast_frame_dtor(ast_audiohook_read_frame(&snoop->spy, snoop->spy_samples,
-							opposing_direction, snoop->spy_format));
-	}
-
-	frame = ast_audiohook_read_frame(&snoop->spy, snoop->spy_samples, snoop->spy_direction, snoop->spy_format);
-	ast_audiohook_unlock(&snoop->spy);
+	ast_audiohook_lock(&snoop->tap->spy);
+	frame = snoop_tap_read(snoop->tap, &snoop->tap_seq);
+	ast_audiohook_unlock(&snoop->tap->spy);
 
 	return frame ? frame : &ast_null_frame;
 }
@@ -206,9 +362,7 @@ static int snoop_hangup(struct ast_channel *chan)
 	struct stasis_app_snoop *snoop = ast_channel_tech_pvt(chan);
 
 	if (snoop->spy_active) {
-		ast_audiohook_lock(&snoop->spy);
-		ast_audiohook_detach(&snoop->spy);
-		ast_audiohook_unlock(&snoop->spy);
+		snoop_tap_release(snoop->tap);
 	}
 
 	if (snoop->whisper_active) {
@@ -269,12 +423,10 @@ static void *snoop_stasis_thread(void *obj)
 	return NULL;
 }
 
-/*! \brief Internal helper function which sets up and attaches a snoop audiohook */
-static int snoop_setup_audiohook(struct ast_channel *chan, enum ast_audiohook_type type, enum stasis_app_snoop_direction requested_direction,
-	enum ast_audiohook_direction *direction, struct ast_audiohook *audiohook)
+/*! \brief Internal helper function which maps a requested snoop direction to an audiohook direction */
+static int snoop_direction(enum stasis_app_snoop_direction requested_direction,
+	enum ast_audiohook_direction *direction)
 {
-	ast_audiohook_init(audiohook, type, "Snoop", 0);
-
 	if (requested_direction == STASIS_SNOOP_DIRECTION_OUT) {
 		*direction = AST_AUDIOHOOK_DIRECTION_WRITE;
 	} else if (requested_direction == STASIS_SNOOP_DIRECTION_IN) {
@@ -285,6 +437,19 @@ static int snoop_setup_audiohook(struct ast_channel *chan, enum ast_audiohook_ty
 		return -1;
 	}
 
+	return 0;
+}
+
+/*! \brief Internal helper function which sets up and attaches a snoop audiohook */
+static int snoop_setup_audiohook(struct ast_channel *chan, enum ast_audiohook_type type, enum stasis_app_snoop_direction requested_direction,
+	enum ast_audiohook_direction *direction, struct ast_audiohook *audiohook)
+{
+	ast_audiohook_init(audiohook, type, "Snoop", 0);
+
+	if (snoop_direction(requested_direction, direction)) {
+		return -1;
+	}
+
 	return ast_audiohook_attach(chan, audiohook);
 }
 
@@ -376,12 +541,18 @@ struct ast_channel *stasis_app_control_snoop(struct ast_channel *chan,
 	ast_channel_unlock(snoop->chan);
 
 	if (spy != STASIS_SNOOP_DIRECTION_NONE) {
-		if (snoop_setup_audiohook(chan, AST_AUDIOHOOK_TYPE_SPY, spy, &snoop->spy_direction, &snoop->spy)) {
+		enum ast_audiohook_direction spy_direction;
+
+		if (snoop_direction(spy, &spy_direction)) {
+			ast_hangup(snoop->chan);
+			return NULL;
+		}
+		snoop->tap = snoop_tap_get(chan, spy_direction, snoop->spy_format);
+		if (!snoop->tap) {
 			ast_hangup(snoop->chan);
 			return NULL;
 		}
 
-		snoop->spy_samples = ast_format_get_sample_rate(snoop->spy_format) / (1000 / SNOOP_INTERVAL);
 		snoop->spy_active = 1;
 	}
 
@@ -413,11 +584,19 @@ struct ast_channel *stasis_app_control_snoop(struct ast_channel *chan,
 
 static int load_module(void)
 {
+	taps = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
+	if (!taps) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
+	ao2_cleanup(taps);
+	taps = NULL;
+
 	return 0;
 }
 
@@ -45,6 +45,20 @@
 				<configOption name="add_newline">
 					<synopsis>Append a newline to every event. This is useful if you want to fake out a server using netcat (nc -lu 8125)</synopsis>
 				</configOption>
+				<configOption name="flush_interval">
+					<synopsis>Interval, in milliseconds, at which collected metrics are sent</synopsis>
+					<description>
+						<para>When set to 0, every metric is sent in its own packet as soon as
+						it is logged. Otherwise metrics are collected and sent by a background
+						thread at this interval. Counters with the same name are summed, gauges
+						with the same name are combined into their final value, and all metrics
+						are packed into as few packets as <replaceable>max_packet_size</replaceable>
+						allows.</para>
+					</description>
+				</configOption>
+				<configOption name="max_packet_size">
+					<synopsis>Maximum size of a packet of collected metrics</synopsis>
+				</configOption>
 			</configObject>
 		</configFile>
 	</configInfo>
@@ -52,9 +66,12 @@
 
 #include "asterisk.h"
 
+#include "asterisk/astobj2.h"
 #include "asterisk/config_options.h"
+#include "asterisk/lock.h"
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
+#include "asterisk/vector.h"
 
 #define AST_API_MODULE
 #include "asterisk/statsd.h"
@@ -76,6 +93,10 @@ struct conf_global_options {
 	struct ast_sockaddr statsd_server;
 	/*! Prefix to put on every stat. */
 	char prefix[MAX_PREFIX + 1];
+	/*! Milliseconds between sending collected metrics; 0 sends each metric immediately. */
+	unsigned int flush_interval;
+	/*! Maximum size of a packet of collected metrics. */
+	unsigned int max_packet_size;
 };
 
 /*! \brief All configuration options for statsd client. */
@@ -95,6 +116,215 @@ static void conf_server(const struct conf *cfg, struct ast_sockaddr *addr)
 	}
 }
 
+/*! \brief A counter or gauge collected until the next flush */
+struct statsd_metric {
+	/*! Sum of the counter, or the gauge value */
+	double value;
+	/*! Has an absolute value been logged for the gauge? */
+	unsigned int absolute:1;
+	/*! The prefixed metric name and its type, as "name|type" */
+	char key[0];
+};
+
+AO2_STRING_FIELD_HASH_FN(statsd_metric, key)
+AO2_STRING_FIELD_CMP_FN(statsd_metric, key)
+
+/*! \brief Protects the metrics collected since the last flush */
+AST_MUTEX_DEFINE_STATIC(pending_lock);
+/*! \brief Counters and gauges collected since the last flush */
+static struct ao2_container *pending_metrics;
+/*! \brief Other metrics collected since the last flush, ready to send */
+static AST_VECTOR(statsd_lines, char *) pending_lines;
+
+static ast_cond_t flush_cond;
+static pthread_t flush_thread = AST_PTHREADT_NULL;
+static int flush_thread_stop;
+
+/*!
+ * \internal
+ * \brief Collect a metric for the next flush.
+ *
+ * \note Assumes pending_lock is held.
+ */
+static void statsd_collect(const struct conf *cfg, const char *metric_name,
+	const char *metric_type, const char *value, double sample_rate)
+{
+	const char *prefix = cfg->global->prefix;
+	const char *dot = ast_strlen_zero(prefix) ? "" : ".";
+	int is_counter = !strcmp(metric_type, AST_STATSD_COUNTER);
+	int is_gauge = !strcmp(metric_type, AST_STATSD_GAUGE);
+	struct statsd_metric *metric;
+	char *line;
+	char *key;
+
+	if (!is_counter && !is_gauge) {
+		if (sample_rate < 1.0) {
+			if (ast_asprintf(&line, "%s%s%s:%s|%s|@%.2f", prefix, dot, metric_name, value,
+				metric_type, sample_rate) < 0) {
+				return;
+			}
+		} else if (ast_asprintf(&line, "%s%s%s:%s|%s", prefix, dot, metric_name, value,
+			metric_type) < 0) {
+			return;
+		}
+		if (AST_VECTOR_APPEND(&pending_lines, line)) {
+			ast_free(line);
+		}
+		return;
+	}
+
+	if (ast_asprintf(&key, "%s%s%s|%s", prefix, dot, metric_name, metric_type) < 0) {
+		return;
+	}
+
+	metric = ao2_find(pending_metrics, key, OBJ_SEARCH_KEY | OBJ_NOLOCK);
+	if (!metric) {
+		metric = ao2_alloc_options(sizeof(*metric) + strlen(key) + 1, NULL,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!metric) {
+			ast_free(key);
+			return;
+		}
+		strcpy(metric->key, key); /* SAFE */
+		ao2_link_flags(pending_metrics, metric, OBJ_NOLOCK);
+	}
+	ast_free(key);
+
+	if (is_counter) {
+		/* Scale sampled counters up so the sum does not need a sample rate */
+		metric->value += strtod(value, NULL) / sample_rate;
+	} else if (*value == '+' || *value == '-') {
+		metric->value += strtod(value, NULL);
+	} else {
+		metric->value = strtod(value, NULL);
+		metric->absolute = 1;
+	}
+
+	ao2_ref(metric, -1);
+}
+
+/*!
+ * \internal
+ * \brief Add a metric to a packet, sending the packet first if it would not fit.
+ */
+static void statsd_packet_add(const struct conf *cfg, const struct ast_sockaddr *server,
+	struct ast_str **packet, const char *line)
+{
+	size_t max = cfg->global->max_packet_size;
+
+	if (ast_str_strlen(*packet) && ast_str_strlen(*packet) + 1 + strlen(line) > max) {
+		if (cfg->global->add_newline) {
+			ast_str_append(packet, 0, "\n");
+		}
+		ast_sendto(socket_fd, ast_str_buffer(*packet), ast_str_strlen(*packet), 0, server);
+		ast_str_reset(*packet);
+	}
+
+	ast_str_append(packet, 0, "%s%s", ast_str_strlen(*packet) ? "\n" : "", line);
+}
+
+static void statsd_format_value(char *buf, size_t size, double value, int sign)
+{
+	if (value == (intmax_t)value) {
+		snprintf(buf, size, sign ? "%+jd" : "%jd", (intmax_t)value);
+	} else {
+		snprintf(buf, size, sign ? "%+f" : "%f", value);
+	}
+}
+
+/*!
+ * \internal
+ * \brief Send everything collected since the last flush.
+ */
+static void statsd_flush(void)
+{
+	RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
+	struct statsd_lines lines;
+	struct ao2_iterator *metrics;
+	struct statsd_metric *metric;
+	struct ast_sockaddr statsd_server;
+	struct ast_str *packet;
+	struct ast_str *line;
+	char value[64];
+	size_t i;
+
+	ast_mutex_lock(&pending_lock);
+	lines = pending_lines;
+	AST_VECTOR_INIT(&pending_lines, 0);
+	metrics = ao2_callback(pending_metrics, OBJ_UNLINK | OBJ_MULTIPLE | OBJ_NOLOCK, NULL, NULL);
+	ast_mutex_unlock(&pending_lock);
+
+	packet = ast_str_create(512);
+	line = ast_str_create(128);
+	if (!cfg || socket_fd == -1 || !packet || !line) {
+		goto cleanup;
+	}
+	conf_server(cfg, &statsd_server);
+
+	while (metrics && (metric = ao2_iterator_next(metrics))) {
+		char *type = strrchr(metric->key, '|');
+		int is_gauge = !strcmp(type + 1, AST_STATSD_GAUGE);
+
+		/* A gauge which only changed needs a signed value to send a change */
+		if (!is_gauge || metric->absolute || metric->value) {
+			statsd_format_value(value, sizeof(value), metric->value, is_gauge && !metric->absolute);
+			ast_str_set(&line, 0, "%.*s:%s%s", (int)(type - metric->key), metric->key, value, type);
+			statsd_packet_add(cfg, &statsd_server, &packet, ast_str_buffer(line));
+		}
+		ao2_ref(metric, -1);
+	}
+
+	for (i = 0; i < AST_VECTOR_SIZE(&lines); i++) {
+		statsd_packet_add(cfg, &statsd_server, &packet, AST_VECTOR_GET(&lines, i));
+	}
+
+	if (ast_str_strlen(packet)) {
+		if (cfg->global->add_newline) {
+			ast_str_append(&packet, 0, "\n");
+		}
+		ast_sendto(socket_fd, ast_str_buffer(packet), ast_str_strlen(packet), 0, &statsd_server);
+	}
+
+cleanup:
+	if (metrics) {
+		ao2_iterator_destroy(metrics);
+	}
+	AST_VECTOR_CALLBACK_VOID(&lines, ast_free);
+	AST_VECTOR_FREE(&lines);
+	ast_free(packet);
+	ast_free(line);
+}
+
+static void *statsd_flush_thread_run(void *data)
+{
+	int stop;
+
+	for (;;) {
+		RAII_VAR(struct conf *, cfg, ao2_global_obj_ref(confs), ao2_cleanup);
+		unsigned int interval = cfg && cfg->global->flush_interval ? cfg->global->flush_interval : 1000;
+		struct timeval wait = ast_tvadd(ast_tvnow(), ast_samp2tv(interval, 1000));
+		struct timespec ts = {
+			.tv_sec = wait.tv_sec,
+			.tv_nsec = wait.tv_usec * 1000,
+		};
+
+		ast_mutex_lock(&pending_lock);
+		if (!flush_thread_stop) {
+			ast_cond_timedwait(&flush_cond, &pending_lock, &ts);
+		}
+		stop = flush_thread_stop;
+		ast_mutex_unlock(&pending_lock);
+
+		statsd_flush();
+
+		if (stop) {
+			break;
+		}
+	}
+
+	return NULL;
+}
+
 void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	const char *metric_type, const char *value, double sample_rate)
 {
@@ -117,6 +347,15 @@ void AST_OPTIONAL_API_NAME(ast_statsd_log_string)(const char *metric_name,
 	}
 
 	cfg = ao2_global_obj_ref(confs);
+
+	if (cfg->global->flush_interval && flush_thread != AST_PTHREADT_NULL) {
+		ast_mutex_lock(&pending_lock);
+		statsd_collect(cfg, metric_name, metric_type, value, sample_rate);
+		ast_mutex_unlock(&pending_lock);
+		ao2_cleanup(cfg);
+		return;
+	}
+
 	conf_server(cfg, &statsd_server);
 
 	msg = ast_str_create(40);
@@ -303,6 +542,15 @@ static int statsd_init(void)
 	ast_debug(3, "  statsd server = %s.\n", server);
 	ast_debug(3, "  add newline = %s\n", AST_YESNO(cfg->global->add_newline));
 	ast_debug(3, "  prefix = %s\n", cfg->global->prefix);
+	ast_debug(3, "  flush interval = %u\n", cfg->global->flush_interval);
+
+	if (cfg->global->flush_interval && flush_thread == AST_PTHREADT_NULL) {
+		flush_thread_stop = 0;
+		if (ast_pthread_create(&flush_thread, NULL, statsd_flush_thread_run, NULL)) {
+			ast_log(LOG_WARNING, "Unable to start statsd flush thread; sending each metric immediately\n");
+			flush_thread = AST_PTHREADT_NULL;
+		}
+	}
 
 	return 0;
 }
@@ -310,6 +558,15 @@ static int statsd_init(void)
 static void statsd_shutdown(void)
 {
 	ast_debug(3, "Shutting down statsd client.\n");
+	if (flush_thread != AST_PTHREADT_NULL) {
+		/* The thread sends what has been collected before exiting */
+		ast_mutex_lock(&pending_lock);
+		flush_thread_stop = 1;
+		ast_cond_signal(&flush_cond);
+		ast_mutex_unlock(&pending_lock);
+		pthread_join(flush_thread, NULL);
+		flush_thread = AST_PTHREADT_NULL;
+	}
 	if (socket_fd != -1) {
 		close(socket_fd);
 		socket_fd = -1;
@@ -323,6 +580,15 @@ static int load_module(void)
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
+	pending_metrics = ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, 127,
+		statsd_metric_hash_fn, NULL, statsd_metric_cmp_fn);
+	if (!pending_metrics) {
+		aco_info_destroy(&cfg_info);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+	AST_VECTOR_INIT(&pending_lines, 0);
+	ast_cond_init(&flush_cond, NULL);
+
 	aco_option_register(&cfg_info, "enabled", ACO_EXACT, global_options,
 		"no", OPT_BOOL_T, 1,
 		FLDSET(struct conf_global_options, enabled));
@@ -339,8 +605,18 @@ static int load_module(void)
 		"", OPT_CHAR_ARRAY_T, 0,
 		CHARFLDSET(struct conf_global_options, prefix));
 
+	aco_option_register(&cfg_info, "flush_interval", ACO_EXACT, global_options,
+		"0", OPT_UINT_T, 0,
+		FLDSET(struct conf_global_options, flush_interval));
+
+	aco_option_register(&cfg_info, "max_packet_size", ACO_EXACT, global_options,
+		"1432", OPT_UINT_T, PARSE_IN_RANGE,
+		FLDSET(struct conf_global_options, max_packet_size), 64, 65507);
+
 	if (aco_process_config(&cfg_info, 0)) {
 		aco_info_destroy(&cfg_info);
+		ao2_cleanup(pending_metrics);
+		pending_metrics = NULL;
 		return AST_MODULE_LOAD_DECLINE;
 	}
 
@@ -360,6 +636,11 @@ static int unload_module(void)
 	statsd_shutdown();
 	aco_info_destroy(&cfg_info);
 	ao2_global_obj_release(confs);
+	ao2_cleanup(pending_metrics);
+	pending_metrics = NULL;
+	AST_VECTOR_CALLBACK_VOID(&pending_lines, ast_free);
+	AST_VECTOR_FREE(&pending_lines);
+	ast_cond_destroy(&flush_cond);
 	return 0;
 }
 
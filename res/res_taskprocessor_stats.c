@@ -0,0 +1,121 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \brief Statsd Taskprocessor stats.
+ *
+ * This module periodically sends the queue depth and latency
+ * statistics of every taskprocessor.
+ *
+ * \since 15.0.0
+ */
+
+/*** MODULEINFO
+	<depend>res_statsd</depend>
+	<defaultenabled>no</defaultenabled>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/sched.h"
+#include "asterisk/statsd.h"
+#include "asterisk/taskprocessor.h"
+
+/*! Milliseconds between reports */
+#define TPS_STATS_INTERVAL 10000
+
+/*! Scheduler sending the reports */
+static struct ast_sched_context *sched;
+
+/*!
+ * \internal
+ * \brief Send the statistics of one taskprocessor.
+ */
+static int send_tps_stats(const char *name, const struct ast_taskprocessor_latency *latency, void *arg)
+{
+	char *metric = ast_strdupa(name);
+	char *pos;
+	int i;
+
+	/* Taskprocessor names may contain characters that mean something to statsd. */
+	for (pos = metric; *pos; ++pos) {
+		if (strchr(".:|@/ ", *pos)) {
+			*pos = '_';
+		}
+	}
+
+	ast_statsd_log_full_va("taskprocessors.%s.depth", AST_STATSD_GAUGE, latency->queued, 1.0, metric);
+	ast_statsd_log_full_va("taskprocessors.%s.max_depth", AST_STATSD_GAUGE, latency->max_qsize, 1.0, metric);
+	ast_statsd_log_full_va("taskprocessors.%s.processed", AST_STATSD_GAUGE, latency->processed, 1.0, metric);
+	ast_statsd_log_full_va("taskprocessors.%s.dropped", AST_STATSD_GAUGE, latency->dropped, 1.0, metric);
+	if (latency->processed) {
+		ast_statsd_log_full_va("taskprocessors.%s.wait.avg_us", AST_STATSD_GAUGE,
+			latency->wait_total_us / latency->processed, 1.0, metric);
+		ast_statsd_log_full_va("taskprocessors.%s.exec.avg_us", AST_STATSD_GAUGE,
+			latency->exec_total_us / latency->processed, 1.0, metric);
+	}
+	ast_statsd_log_full_va("taskprocessors.%s.wait.max_us", AST_STATSD_GAUGE, latency->wait_max_us, 1.0, metric);
+	ast_statsd_log_full_va("taskprocessors.%s.exec.max_us", AST_STATSD_GAUGE, latency->exec_max_us, 1.0, metric);
+	for (i = 0; i < AST_TASKPROCESSOR_LATENCY_BUCKETS; ++i) {
+		ast_statsd_log_full_va("taskprocessors.%s.wait.%s", AST_STATSD_GAUGE, latency->wait_histogram[i], 1.0,
+			metric, ast_taskprocessor_latency_bucket_label(i));
+		ast_statsd_log_full_va("taskprocessors.%s.exec.%s", AST_STATSD_GAUGE, latency->exec_histogram[i], 1.0,
+			metric, ast_taskprocessor_latency_bucket_label(i));
+	}
+
+	return 0;
+}
+
+static int send_all_tps_stats(const void *data)
+{
+	ast_taskprocessor_latency_foreach(send_tps_stats, NULL);
+
+	/* Run again after the same interval. */
+	return 1;
+}
+
+static int unload_module(void)
+{
+	ast_sched_context_destroy(sched);
+	sched = NULL;
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	sched = ast_sched_context_create();
+	if (!sched) {
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if (ast_sched_start_thread(sched)
+		|| ast_sched_add(sched, TPS_STATS_INTERVAL, send_all_tps_stats, NULL) < 0) {
+		unload_module();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_DEFAULT, "Taskprocessor statistics",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.nonoptreq = "res_statsd"
+	);
@@ -0,0 +1,460 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ *
+ * \brief Shared clock timing interface
+ *
+ * Instead of a kernel timer for every timer, a few clock threads, one for
+ * each processor, keep the timers in a heap ordered by their next tick and
+ * signal each timer through an eventfd when it is due.  All the timers due
+ * at the same time are signalled in one pass of the thread that owns them.
+ */
+
+/*** MODULEINFO
+	<depend>timerfd</depend>
+	<defaultenabled>no</defaultenabled>
+	<support_level>extended</support_level>
+ ***/
+
+#include "asterisk.h"
+
+/* eventfd() is older than timerfd_create(), so the timerfd check covers it */
+#include <sys/eventfd.h>
+
+#include "asterisk/module.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/timing.h"
+#include "asterisk/logger.h"
+#include "asterisk/utils.h"
+#include "asterisk/time.h"
+#include "asterisk/lock.h"
+#include "asterisk/heap.h"
+
+static void *timing_funcs_handle;
+
+static void *shared_timer_open(void);
+static void shared_timer_close(void *data);
+static int shared_timer_set_rate(void *data, unsigned int rate);
+static int shared_timer_ack(void *data, unsigned int quantity);
+static int shared_timer_enable_continuous(void *data);
+static int shared_timer_disable_continuous(void *data);
+static enum ast_timer_event shared_timer_get_event(void *data);
+static unsigned int shared_timer_get_max_rate(void *data);
+static int shared_timer_fd(void *data);
+
+static struct ast_timing_interface shared_timing = {
+	.name = "shared",
+	.priority = 300,
+	.timer_open = shared_timer_open,
+	.timer_close = shared_timer_close,
+	.timer_set_rate = shared_timer_set_rate,
+	.timer_ack = shared_timer_ack,
+	.timer_enable_continuous = shared_timer_enable_continuous,
+	.timer_disable_continuous = shared_timer_disable_continuous,
+	.timer_get_event = shared_timer_get_event,
+	.timer_get_max_rate = shared_timer_get_max_rate,
+	.timer_fd = shared_timer_fd,
+};
+
+#define SHARED_MAX_RATE 1000
+
+/*! The most clock threads started, whatever the number of processors */
+#define MAX_CLOCKS 32
+
+#define NSEC_PER_SEC 1000000000ULL
+
+/*! \brief A thread driving the timers assigned to it */
+struct shared_clock {
+	pthread_t thread;
+	/*! Protects the heap and the state of every timer of the clock */
+	ast_mutex_t lock;
+	/*! Signalled when a timer becomes the next one due, uses CLOCK_MONOTONIC */
+	ast_cond_t cond;
+	/*! The running timers, the next one due at the top */
+	struct ast_heap *timers;
+	unsigned int stop:1;
+};
+
+struct shared_timer {
+	/*! The eventfd the consumer polls */
+	int fd;
+	/*! The clock driving the timer */
+	struct shared_clock *clock;
+	/*! Nanoseconds between ticks, 0 when stopped */
+	uint64_t interval;
+	/*! The monotonic time in nanoseconds of the next tick */
+	uint64_t next;
+	unsigned int is_continuous:1;
+	/*! Whether the timer is in the heap of its clock */
+	unsigned int running:1;
+	/*! For the heap of the clock */
+	ssize_t __heap_index;
+};
+
+static struct shared_clock *clocks;
+static unsigned int num_clocks;
+
+/*! \brief Spreads the timers over the clocks */
+static unsigned int next_clock;
+
+static uint64_t monotonic_now(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	return (uint64_t) now.tv_sec * NSEC_PER_SEC + now.tv_nsec;
+}
+
+/*! \brief Order the heap so the timer due first is at the top */
+static int shared_timer_cmp(void *a, void *b)
+{
+	struct shared_timer *timer_a = a;
+	struct shared_timer *timer_b = b;
+
+	if (timer_a->next == timer_b->next) {
+		return 0;
+	}
+	return timer_a->next < timer_b->next ? 1 : -1;
+}
+
+/*! \brief Make the eventfd of a timer readable, with the clock locked */
+static void timer_signal(struct shared_timer *timer, uint64_t ticks)
+{
+	if (write(timer->fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+		ast_debug(1, "Failed to signal shared timer %d: %s\n", timer->fd, strerror(errno));
+	}
+}
+
+/*! \brief Empty the eventfd of a timer, returning its ticks */
+static uint64_t timer_unsignal(struct shared_timer *timer)
+{
+	uint64_t ticks;
+
+	if (read(timer->fd, &ticks, sizeof(ticks)) != sizeof(ticks)) {
+		/* Nothing was pending */
+		return 0;
+	}
+
+	return ticks;
+}
+
+/*! \brief Schedule the first tick of a timer, with the clock locked */
+static void timer_start(struct shared_timer *timer)
+{
+	struct shared_clock *clock = timer->clock;
+
+	if (!timer->interval || timer->is_continuous) {
+		return;
+	}
+
+	timer->next = monotonic_now() + timer->interval;
+	ast_heap_push(clock->timers, timer);
+	timer->running = 1;
+	if (ast_heap_peek(clock->timers, 1) == timer) {
+		ast_cond_signal(&clock->cond);
+	}
+}
+
+/*! \brief Take a timer out of the heap of its clock, with the clock locked */
+static void timer_stop(struct shared_timer *timer)
+{
+	if (timer->running) {
+		ast_heap_remove(timer->clock->timers, timer);
+		timer->running = 0;
+	}
+}
+
+static void *shared_clock_thread(void *data)
+{
+	struct shared_clock *clock = data;
+
+	ast_mutex_lock(&clock->lock);
+	while (!clock->stop) {
+		struct shared_timer *timer;
+		struct timespec wait;
+		uint64_t now;
+
+		timer = ast_heap_peek(clock->timers, 1);
+		if (!timer) {
+			ast_cond_wait(&clock->cond, &clock->lock);
+			continue;
+		}
+
+		now = monotonic_now();
+		if (timer->next > now) {
+			wait.tv_sec = timer->next / NSEC_PER_SEC;
+			wait.tv_nsec = timer->next % NSEC_PER_SEC;
+			ast_cond_timedwait(&clock->cond, &clock->lock, &wait);
+			continue;
+		}
+
+		/* Signal every timer that is due, counting the ticks missed */
+		while ((timer = ast_heap_peek(clock->timers, 1)) && timer->next <= now) {
+			uint64_t ticks = (now - timer->next) / timer->interval + 1;
+
+			ast_heap_pop(clock->timers);
+			timer->next += ticks * timer->interval;
+			timer_signal(timer, ticks);
+			ast_heap_push(clock->timers, timer);
+		}
+	}
+	ast_mutex_unlock(&clock->lock);
+
+	return NULL;
+}
+
+static void timer_destroy(void *obj)
+{
+	struct shared_timer *timer = obj;
+
+	if (timer->fd > -1) {
+		close(timer->fd);
+	}
+}
+
+static void *shared_timer_open(void)
+{
+	struct shared_timer *timer;
+
+	if (!(timer = ao2_alloc_options(sizeof(*timer), timer_destroy, AO2_ALLOC_OPT_LOCK_NOLOCK))) {
+		ast_log(LOG_ERROR, "Could not allocate memory for shared_timer structure\n");
+		return NULL;
+	}
+	if ((timer->fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ast_log(LOG_ERROR, "Failed to create eventfd for shared timer: %s\n", strerror(errno));
+		ao2_ref(timer, -1);
+		return NULL;
+	}
+	timer->clock = &clocks[ast_atomic_fetchadd_int((int *) &next_clock, 1) % num_clocks];
+
+	return timer;
+}
+
+static void shared_timer_close(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ast_mutex_lock(&timer->clock->lock);
+	timer_stop(timer);
+	ast_mutex_unlock(&timer->clock->lock);
+
+	ao2_ref(timer, -1);
+}
+
+static int shared_timer_set_rate(void *data, unsigned int rate)
+{
+	struct shared_timer *timer = data;
+
+	ast_mutex_lock(&timer->clock->lock);
+	timer_stop(timer);
+	timer->interval = rate ? NSEC_PER_SEC / rate : 0;
+	timer_start(timer);
+	ast_mutex_unlock(&timer->clock->lock);
+
+	return 0;
+}
+
+static int shared_timer_ack(void *data, unsigned int quantity)
+{
+	struct shared_timer *timer = data;
+	uint64_t ticks;
+
+	ast_mutex_lock(&timer->clock->lock);
+	if (timer->is_continuous) {
+		/* The timer stays readable until continuous mode is disabled */
+		ast_mutex_unlock(&timer->clock->lock);
+		return 0;
+	}
+	ticks = timer_unsignal(timer);
+	ast_mutex_unlock(&timer->clock->lock);
+
+	if (ticks != quantity) {
+		ast_debug(2, "Expected to acknowledge %u ticks but got %llu instead\n", quantity, (unsigned long long) ticks);
+	}
+
+	return 0;
+}
+
+static int shared_timer_enable_continuous(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ast_mutex_lock(&timer->clock->lock);
+	if (!timer->is_continuous) {
+		timer_stop(timer);
+		timer->is_continuous = 1;
+		timer_signal(timer, 1);
+	}
+	ast_mutex_unlock(&timer->clock->lock);
+
+	return 0;
+}
+
+static int shared_timer_disable_continuous(void *data)
+{
+	struct shared_timer *timer = data;
+
+	ast_mutex_lock(&timer->clock->lock);
+	if (timer->is_continuous) {
+		timer->is_continuous = 0;
+		timer_unsignal(timer);
+		timer_start(timer);
+	}
+	ast_mutex_unlock(&timer->clock->lock);
+
+	return 0;
+}
+
+static enum ast_timer_event shared_timer_get_event(void *data)
+{
+	struct shared_timer *timer = data;
+	enum ast_timer_event res;
+
+	ast_mutex_lock(&timer->clock->lock);
+	res = timer->is_continuous ? AST_TIMING_EVENT_CONTINUOUS : AST_TIMING_EVENT_EXPIRED;
+	ast_mutex_unlock(&timer->clock->lock);
+
+	return res;
+}
+
+static unsigned int shared_timer_get_max_rate(void *data)
+{
+	return SHARED_MAX_RATE;
+}
+
+static int shared_timer_fd(void *data)
+{
+	struct shared_timer *timer = data;
+
+	return timer->fd;
+}
+
+static void clocks_destroy(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < num_clocks; i++) {
+		struct shared_clock *clock = &clocks[i];
+
+		if (clock->thread != AST_PTHREADT_NULL) {
+			ast_mutex_lock(&clock->lock);
+			clock->stop = 1;
+			ast_cond_signal(&clock->cond);
+			ast_mutex_unlock(&clock->lock);
+			pthread_join(clock->thread, NULL);
+		}
+		if (clock->timers) {
+			ast_heap_destroy(clock->timers);
+		}
+		ast_cond_destroy(&clock->cond);
+		ast_mutex_destroy(&clock->lock);
+	}
+
+	ast_free(clocks);
+	clocks = NULL;
+	num_clocks = 0;
+}
+
+static int clocks_create(void)
+{
+	pthread_condattr_t attr;
+	long processors = sysconf(_SC_NPROCESSORS_ONLN);
+	unsigned int count = processors > 0 ? MIN(processors, MAX_CLOCKS) : 1;
+	unsigned int i;
+
+	if (!(clocks = ast_calloc(count, sizeof(*clocks)))) {
+		return -1;
+	}
+
+	pthread_condattr_init(&attr);
+	pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+	for (i = 0; i < count; i++) {
+		struct shared_clock *clock = &clocks[i];
+
+		ast_mutex_init(&clock->lock);
+		ast_cond_init(&clock->cond, &attr);
+		clock->thread = AST_PTHREADT_NULL;
+		num_clocks++;
+
+		if (!(clock->timers = ast_heap_create(8, shared_timer_cmp,
+				offsetof(struct shared_timer, __heap_index)))) {
+			pthread_condattr_destroy(&attr);
+			return -1;
+		}
+		if (ast_pthread_create_background(&clock->thread, NULL, shared_clock_thread, clock)) {
+			clock->thread = AST_PTHREADT_NULL;
+			pthread_condattr_destroy(&attr);
+			return -1;
+		}
+	}
+
+	pthread_condattr_destroy(&attr);
+
+	ast_debug(1, "Started %u shared timing clocks\n", num_clocks);
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	int fd;
+
+	/* Make sure we support the necessary calls */
+	if ((fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)) < 0) {
+		ast_log(LOG_ERROR, "eventfd() not supported by the kernel.  Not loading.\n");
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	close(fd);
+
+	if (clocks_create()) {
+		ast_log(LOG_ERROR, "Unable to start the shared timing clocks.  Not loading.\n");
+		clocks_destroy();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	if (!(timing_funcs_handle = ast_register_timing_interface(&shared_timing))) {
+		clocks_destroy();
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+static int unload_module(void)
+{
+	int res;
+
+	if ((res = ast_unregister_timing_interface(timing_funcs_handle))) {
+		/* Timers are still open */
+		return res;
+	}
+
+	clocks_destroy();
+
+	return 0;
+}
+
+AST_MODULE_INFO(ASTERISK_GPL_KEY, AST_MODFLAG_LOAD_ORDER, "Shared Clock Timing Interface",
+	.support_level = AST_MODULE_SUPPORT_EXTENDED,
+	.load = load_module,
+	.unload = unload_module,
+	.load_pri = AST_MODPRI_TIMING,
+);
@@ -62,10 +62,47 @@ struct stasis_app {
 	enum stasis_app_subscription_model subscription_model;
 	/*! Whether or not someone wants to see debug messages about this app */
 	int debug;
+	/*! Event types the application is sent, NULL for all */
+	struct app_event_filter *event_filter;
 	/*! Name of the Stasis application */
 	char name[];
 };
 
+/*! \brief Event types an application is sent */
+struct app_event_filter {
+	/*! Event types to send, or empty to send all that are not disallowed */
+	struct ao2_container *allowed;
+	/*! Event types not to send */
+	struct ao2_container *disallowed;
+};
+
+/*!
+ * \brief The event each type of message the application router passes on
+ * becomes, for those that always become the same event.
+ *
+ * Messages of these types are dropped before they are converted to JSON when
+ * the application is not sent the event.  Anything else is checked once it
+ * has been converted.
+ */
+static const struct {
+	struct stasis_message_type *(*type)(void);
+	const char *event;
+} message_events[] = {
+	{ ast_channel_varset_type, "ChannelVarset" },
+	{ ast_channel_dtmf_end_type, "ChannelDtmfReceived" },
+	{ ast_channel_dial_type, "Dial" },
+	{ ast_channel_hangup_request_type, "ChannelHangupRequest" },
+	{ ast_channel_hold_type, "ChannelHold" },
+	{ ast_channel_unhold_type, "ChannelUnhold" },
+	{ ast_channel_talking_start, "ChannelTalkingStarted" },
+	{ ast_channel_talking_stop, "ChannelTalkingFinished" },
+	{ ast_channel_entered_bridge_type, "ChannelEnteredBridge" },
+	{ ast_channel_left_bridge_type, "ChannelLeftBridge" },
+	{ ast_bridge_merge_message_type, "BridgeMerged" },
+	{ ast_blind_transfer_type, "BridgeBlindTransfer" },
+	{ ast_attended_transfer_type, "BridgeAttendedTransfer" },
+};
+
 enum forward_type {
 	FORWARD_CHANNEL,
 	FORWARD_BRIDGE,
@@ -307,6 +344,97 @@ static void app_dtor(void *obj)
 	app->forwards = NULL;
 	ao2_cleanup(app->data);
 	app->data = NULL;
+	ao2_cleanup(app->event_filter);
+	app->event_filter = NULL;
+}
+
+static void app_event_filter_dtor(void *obj)
+{
+	struct app_event_filter *filter = obj;
+
+	ao2_cleanup(filter->allowed);
+	ao2_cleanup(filter->disallowed);
+}
+
+/*!
+ * \internal
+ * \brief Get the event types an application is sent.
+ *
+ * \return The filter, which must be unreffed.
+ * \retval NULL if the application is sent every event.
+ */
+static struct app_event_filter *app_event_filter_get(const struct stasis_app *app)
+{
+	struct stasis_app *locked = (struct stasis_app *) app;
+	struct app_event_filter *filter;
+
+	ao2_lock(locked);
+	filter = ao2_bump(locked->event_filter);
+	ao2_unlock(locked);
+
+	return filter;
+}
+
+static int event_filter_has(struct ao2_container *types, const char *type)
+{
+	char *found = ao2_find(types, type, OBJ_SEARCH_KEY);
+
+	ao2_cleanup(found);
+	return found != NULL;
+}
+
+/*!
+ * \internal
+ * \brief Whether a filter lets an event type through.
+ *
+ * \param filter The filter, or NULL to let everything through
+ * \param type The event type
+ */
+static int event_filter_allows(const struct app_event_filter *filter, const char *type)
+{
+	if (!filter) {
+		return 1;
+	}
+
+	if (ao2_container_count(filter->allowed) && !event_filter_has(filter->allowed, type)) {
+		return 0;
+	}
+
+	return !event_filter_has(filter->disallowed, type);
+}
+
+/*!
+ * \internal
+ * \brief Whether an application is sent an event type.
+ */
+static int app_event_allowed(struct stasis_app *app, const char *type)
+{
+	struct app_event_filter *filter = app_event_filter_get(app);
+	int allowed = event_filter_allows(filter, type);
+
+	ao2_cleanup(filter);
+	return allowed;
+}
+
+/*!
+ * \internal
+ * \brief Whether an application is sent the event a message becomes.
+ *
+ * \note Messages whose event is not known up front are let through, to be
+ * checked once converted.
+ */
+static int app_message_allowed(struct stasis_app *app, struct stasis_message *message)
+{
+	struct stasis_message_type *type = stasis_message_type(message);
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(message_events); ++i) {
+		if (message_events[i].type() == type) {
+			return app_event_allowed(app, message_events[i].event);
+		}
+	}
+
+	return 1;
 }
 
 static void call_forwarded_handler(struct stasis_app *app, struct stasis_message *message)
@@ -342,6 +470,10 @@ static void sub_default_handler(void *data, struct stasis_subscription *sub,
 		call_forwarded_handler(app, message);
 	}
 
+	if (!app_message_allowed(app, message)) {
+		return;
+	}
+
 	/* By default, send any message that has a JSON representation */
 	json = stasis_message_to_json(message, stasis_app_get_sanitizer());
 	if (!json) {
@@ -517,11 +649,15 @@ static struct ast_json *channel_connected_line(
 		"channel", json_channel);
 }
 
-static channel_snapshot_monitor channel_monitors[] = {
-	channel_state,
-	channel_dialplan,
-	channel_callerid,
-	channel_connected_line,
+static const struct {
+	channel_snapshot_monitor monitor;
+	/*! The event the monitor makes, or NULL if it makes more than one */
+	const char *event;
+} channel_monitors[] = {
+	{ channel_state, NULL },
+	{ channel_dialplan, "ChannelDialplan" },
+	{ channel_callerid, "ChannelCallerId" },
+	{ channel_connected_line, "ChannelConnectedLine" },
 };
 
 static void sub_channel_update_handler(void *data,
@@ -532,6 +668,7 @@ static void sub_channel_update_handler(void *data,
 	struct stasis_cache_update *update;
 	struct ast_channel_snapshot *new_snapshot;
 	struct ast_channel_snapshot *old_snapshot;
+	struct app_event_filter *filter;
 	const struct timeval *tv;
 	int i;
 
@@ -550,14 +687,21 @@ static void sub_channel_update_handler(void *data,
 		stasis_message_timestamp(update->new_snapshot) :
 		stasis_message_timestamp(message);
 
+	filter = app_event_filter_get(app);
 	for (i = 0; i < ARRAY_LEN(channel_monitors); ++i) {
 		RAII_VAR(struct ast_json *, msg, NULL, ast_json_unref);
 
-		msg = channel_monitors[i](old_snapshot, new_snapshot, tv);
+		if (channel_monitors[i].event
+			&& !event_filter_allows(filter, channel_monitors[i].event)) {
+			continue;
+		}
+
+		msg = channel_monitors[i].monitor(old_snapshot, new_snapshot, tv);
 		if (msg) {
 			app_send(app, msg);
 		}
 	}
+	ao2_cleanup(filter);
 
 	if (!new_snapshot && old_snapshot) {
 		unsubscribe(app, "channel", old_snapshot->uniqueid, 1);
@@ -600,6 +744,10 @@ static int message_received_handler(const char *endpoint_id, struct ast_json *js
 		return -1;
 	}
 
+	if (!app_event_allowed(app, "TextMessageReceived")) {
+		return 0;
+	}
+
 	snapshot = ast_endpoint_latest_snapshot(tech, resource);
 	if (!snapshot) {
 		return -1;
@@ -639,7 +787,7 @@ static void sub_endpoint_update_handler(void *data,
 	new_snapshot = stasis_message_data(update->new_snapshot);
 	old_snapshot = stasis_message_data(update->old_snapshot);
 
-	if (new_snapshot) {
+	if (new_snapshot && app_event_allowed(app, "EndpointStateChange")) {
 		tv = stasis_message_timestamp(update->new_snapshot);
 
 		json = simple_endpoint_event("EndpointStateChange", new_snapshot, tv);
@@ -695,11 +843,16 @@ static void sub_bridge_update_handler(void *data,
 		stasis_message_timestamp(message);
 
 	if (!new_snapshot) {
-		json = simple_bridge_event("BridgeDestroyed", old_snapshot, tv);
+		if (app_event_allowed(app, "BridgeDestroyed")) {
+			json = simple_bridge_event("BridgeDestroyed", old_snapshot, tv);
+		}
 	} else if (!old_snapshot) {
-		json = simple_bridge_event("BridgeCreated", new_snapshot, tv);
+		if (app_event_allowed(app, "BridgeCreated")) {
+			json = simple_bridge_event("BridgeCreated", new_snapshot, tv);
+		}
 	} else if (new_snapshot && old_snapshot
-		&& strcmp(new_snapshot->video_source_id, old_snapshot->video_source_id)) {
+		&& strcmp(new_snapshot->video_source_id, old_snapshot->video_source_id)
+		&& app_event_allowed(app, "BridgeVideoSourceChanged")) {
 		json = simple_bridge_event("BridgeVideoSourceChanged", new_snapshot, tv);
 		if (json && !ast_strlen_zero(old_snapshot->video_source_id)) {
 			ast_json_object_set(json, "old_video_source_id",
@@ -952,6 +1105,7 @@ void app_send(struct stasis_app *app, struct ast_json *message)
 	int debug;
 	char eid[20];
 	RAII_VAR(void *, data, NULL, ao2_cleanup);
+	RAII_VAR(struct app_event_filter *, filter, NULL, ao2_cleanup);
 
 	if (ast_json_object_set(message, "asterisk_id", ast_json_string_create(
 			ast_eid_to_str(eid, sizeof(eid), &ast_eid_default)))) {
@@ -968,9 +1122,15 @@ void app_send(struct stasis_app *app, struct ast_json *message)
 			ao2_ref(app->data, +1);
 			data = app->data;
 		}
+		filter = ao2_bump(app->event_filter);
 		/* Name is immutable; no need to copy */
 	}
 
+	if (!event_filter_allows(filter,
+		S_OR(ast_json_string_get(ast_json_object_get(message, "type")), ""))) {
+		return;
+	}
+
 	if (debug) {
 		char *dump = ast_json_dump_string_format(message, AST_JSON_PRETTY);
 		ast_verb(0, "Dispatching message to Stasis app '%s':\n%s\n",
@@ -1122,18 +1282,119 @@ void app_to_cli(const struct stasis_app *app, struct ast_cli_args *a)
 	}
 }
 
+static struct ast_json *event_filter_to_json(struct ao2_container *types)
+{
+	struct ast_json *json = ast_json_array_create();
+	struct ao2_iterator iter;
+	char *type;
+
+	if (!json || !types) {
+		return json;
+	}
+
+	iter = ao2_iterator_init(types, 0);
+	for (; (type = ao2_iterator_next(&iter)); ao2_ref(type, -1)) {
+		ast_json_array_append(json, ast_json_pack("{s: s}", "type", type));
+	}
+	ao2_iterator_destroy(&iter);
+
+	return json;
+}
+
+/*!
+ * \internal
+ * \brief Add the event types of a list in a filter to a container.
+ */
+static enum stasis_app_event_filter_res event_filter_add(struct ao2_container *types,
+	struct ast_json *list)
+{
+	const char *type;
+	size_t i;
+
+	if (!list) {
+		return STASIS_AEF_OK;
+	}
+
+	if (ast_json_typeof(list) != AST_JSON_ARRAY) {
+		return STASIS_AEF_INVALID;
+	}
+
+	for (i = 0; i < ast_json_array_size(list); ++i) {
+		type = ast_json_string_get(ast_json_object_get(ast_json_array_get(list, i), "type"));
+		if (ast_strlen_zero(type)) {
+			return STASIS_AEF_INVALID;
+		}
+		if (ast_str_container_add(types, type)) {
+			return STASIS_AEF_INTERNAL_ERROR;
+		}
+	}
+
+	return STASIS_AEF_OK;
+}
+
+enum stasis_app_event_filter_res app_event_filter_set(struct stasis_app *app, struct ast_json *json)
+{
+	struct app_event_filter *filter = NULL;
+	enum stasis_app_event_filter_res res;
+
+	if (json && ast_json_typeof(json) != AST_JSON_NULL) {
+		if (ast_json_typeof(json) != AST_JSON_OBJECT) {
+			return STASIS_AEF_INVALID;
+		}
+
+		filter = ao2_alloc_options(sizeof(*filter), app_event_filter_dtor,
+			AO2_ALLOC_OPT_LOCK_NOLOCK);
+		if (!filter) {
+			return STASIS_AEF_INTERNAL_ERROR;
+		}
+		/* Never changed once set on the application, so need no lock */
+		filter->allowed = ast_str_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 17);
+		filter->disallowed = ast_str_container_alloc_options(AO2_ALLOC_OPT_LOCK_NOLOCK, 17);
+		if (!filter->allowed || !filter->disallowed) {
+			ao2_ref(filter, -1);
+			return STASIS_AEF_INTERNAL_ERROR;
+		}
+
+		res = event_filter_add(filter->allowed, ast_json_object_get(json, "allowed"));
+		if (res == STASIS_AEF_OK) {
+			res = event_filter_add(filter->disallowed, ast_json_object_get(json, "disallowed"));
+		}
+		if (res != STASIS_AEF_OK) {
+			ao2_ref(filter, -1);
+			return res;
+		}
+
+		if (!ao2_container_count(filter->allowed) && !ao2_container_count(filter->disallowed)) {
+			/* Sends every event, which is quicker to check without a filter */
+			ao2_ref(filter, -1);
+			filter = NULL;
+		}
+	}
+
+	ao2_lock(app);
+	ao2_cleanup(app->event_filter);
+	app->event_filter = filter;
+	ao2_unlock(app);
+
+	return STASIS_AEF_OK;
+}
+
 struct ast_json *app_to_json(const struct stasis_app *app)
 {
 	RAII_VAR(struct ast_json *, json, NULL, ast_json_unref);
+	struct app_event_filter *filter = app_event_filter_get(app);
 	struct ast_json *channels;
 	struct ast_json *bridges;
 	struct ast_json *endpoints;
 	struct ao2_iterator i;
 	void *obj;
 
-	json = ast_json_pack("{s: s, s: [], s: [], s: []}",
+	json = ast_json_pack("{s: s, s: [], s: [], s: [], s: o, s: o}",
 		"name", app->name,
-		"channel_ids", "bridge_ids", "endpoint_ids");
+		"channel_ids", "bridge_ids", "endpoint_ids",
+		"events_allowed", event_filter_to_json(filter ? filter->allowed : NULL),
+		"events_disallowed", event_filter_to_json(filter ? filter->disallowed : NULL));
+	ao2_cleanup(filter);
 	channels = ast_json_object_get(json, "channel_ids");
 	bridges = ast_json_object_get(json, "bridge_ids");
 	endpoints = ast_json_object_get(json, "endpoint_ids");
@@ -127,6 +127,16 @@ void app_send(struct stasis_app *app, struct ast_json *message);
 
 struct app_forwards;
 
+/*!
+ * \brief Set the event types an application is sent.
+ *
+ * \param app The application
+ * \param filter The filter, as given to stasis_app_event_filter_set()
+ *
+ * \return \ref stasis_app_event_filter_res return code.
+ */
+enum stasis_app_event_filter_res app_event_filter_set(struct stasis_app *app, struct ast_json *filter);
+
 /*!
  * \brief Create a JSON representation of a \c stasis_app
  *
@@ -38,6 +38,8 @@ struct stasis_app_command {
 	command_data_destructor_fn data_destructor;
 	int retval;
 	int is_done:1;
+	/*! Next command in a control's queue */
+	struct stasis_app_command *next;
 };
 
 static void command_dtor(void *obj)
@@ -104,6 +106,44 @@ void command_invoke(struct stasis_app_command *command,
 	command_complete(command, retval);
 }
 
+int command_queue_push(struct stasis_app_command **queue,
+	struct stasis_app_command *command)
+{
+	struct stasis_app_command *head = __atomic_load_n(queue, __ATOMIC_SEQ_CST);
+
+	ao2_ref(command, +1);
+	do {
+		command->next = head;
+	} while (!__atomic_compare_exchange_n(queue, &head, command, 0,
+		__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST));
+
+	return head == NULL;
+}
+
+struct stasis_app_command *command_queue_take(struct stasis_app_command **queue)
+{
+	struct stasis_app_command *head = __atomic_exchange_n(queue, NULL, __ATOMIC_SEQ_CST);
+	struct stasis_app_command *fifo = NULL;
+	struct stasis_app_command *next;
+
+	/* Commands are pushed onto the head, so reverse them into queued order. */
+	for (; head; head = next) {
+		next = head->next;
+		head->next = fifo;
+		fifo = head;
+	}
+
+	return fifo;
+}
+
+struct stasis_app_command *command_queue_next(struct stasis_app_command *command)
+{
+	struct stasis_app_command *next = command->next;
+
+	command->next = NULL;
+	return next;
+}
+
 static void command_queue_prestart_destroy(void *obj)
 {
 	/* Clean up the container */
@@ -42,6 +42,42 @@ void command_invoke(struct stasis_app_command *command,
 
 int command_join(struct stasis_app_command *command);
 
+/*!
+ * \brief Push a command onto a lock free command queue
+ *
+ * The queue is a singly linked stack of commands that any thread may push
+ * onto while one thread takes from it.
+ *
+ * \param queue The head of the queue, NULL when it is empty
+ * \param command The command to push. The queue takes its own reference.
+ *
+ * \retval 1 if the queue was empty
+ * \retval 0 otherwise
+ */
+int command_queue_push(struct stasis_app_command **queue,
+	struct stasis_app_command *command);
+
+/*!
+ * \brief Take every command from a lock free command queue
+ *
+ * \param queue The head of the queue, which is left empty
+ *
+ * \return The commands in the order they were pushed, linked by
+ *         command_queue_next(). The caller owns the queue's references.
+ * \retval NULL if the queue was empty
+ */
+struct stasis_app_command *command_queue_take(struct stasis_app_command **queue);
+
+/*!
+ * \brief Unlink a command taken from a queue
+ *
+ * \param command A command returned by command_queue_take() or this function
+ *
+ * \return The command that follows \a command
+ * \retval NULL if \a command was the last one
+ */
+struct stasis_app_command *command_queue_next(struct stasis_app_command *command);
+
 /*!
  * \brief Queue a Stasis() prestart command for a channel
  *
@@ -25,6 +25,10 @@
 
 #include "asterisk.h"
 
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #include "asterisk/stasis_channels.h"
 #include "asterisk/stasis_app.h"
 
@@ -48,9 +52,15 @@ AST_LIST_HEAD(app_control_rules, stasis_app_control_rule);
 static int shutting_down;
 
 struct stasis_app_control {
-	ast_cond_t wait_cond;
-	/*! Queue of commands to dispatch on the channel */
-	struct ao2_container *command_queue;
+	/*!
+	 * Queue of commands to dispatch on the channel, newest first.
+	 * Pushed onto and taken from without locking.
+	 */
+	struct stasis_app_command *command_queue;
+	/*! Wakes the channel's thread when the queue stops being empty */
+	int alert[2];
+	/*! Set while the channel's thread is dispatching commands */
+	int dispatching;
 	/*!
 	 * The associated channel.
 	 * Be very careful with the threading associated w/ manipulating
@@ -84,19 +94,90 @@ struct stasis_app_control {
 	/*!
 	 * When set, /c app_stasis should exit and continue in the dialplan.
 	 */
-	int is_done:1;
+	int is_done;
 };
 
+static int control_alert_init(struct stasis_app_control *control)
+{
+#ifdef HAVE_EVENTFD
+	control->alert[0] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if (control->alert[0] < 0) {
+		return -1;
+	}
+	control->alert[1] = control->alert[0];
+#else
+	int i;
+
+	if (pipe(control->alert)) {
+		control->alert[0] = control->alert[1] = -1;
+		return -1;
+	}
+	for (i = 0; i < 2; ++i) {
+		if (fcntl(control->alert[i], F_SETFL, fcntl(control->alert[i], F_GETFL) | O_NONBLOCK) < 0) {
+			return -1;
+		}
+	}
+#endif
+	return 0;
+}
+
+static void control_alert_write(struct stasis_app_control *control)
+{
+#ifdef HAVE_EVENTFD
+	if (eventfd_write(control->alert[1], 1)) {
+#else
+	char blah = 0x7F;
+
+	/* A full pipe still wakes the channel's thread. */
+	if (write(control->alert[1], &blah, sizeof(blah)) < 0 && errno != EAGAIN) {
+#endif
+		ast_log(LOG_WARNING, "Unable to alert Stasis control: %s\n", strerror(errno));
+	}
+}
+
+static void control_alert_read(struct stasis_app_control *control)
+{
+#ifdef HAVE_EVENTFD
+	eventfd_t value;
+
+	eventfd_read(control->alert[0], &value);
+#else
+	char buf[64];
+
+	while (read(control->alert[0], buf, sizeof(buf)) > 0) {
+	}
+#endif
+}
+
+static void control_alert_close(struct stasis_app_control *control)
+{
+	if (control->alert[0] > -1) {
+		close(control->alert[0]);
+	}
+	if (control->alert[1] > -1 && control->alert[1] != control->alert[0]) {
+		close(control->alert[1]);
+	}
+	control->alert[0] = control->alert[1] = -1;
+}
+
 static void control_dtor(void *obj)
 {
 	struct stasis_app_control *control = obj;
+	struct stasis_app_command *command;
 
-	ao2_cleanup(control->command_queue);
+	command = command_queue_take(&control->command_queue);
+	while (command) {
+		struct stasis_app_command *next = command_queue_next(command);
+
+		command_complete(command, -1);
+		ao2_ref(command, -1);
+		command = next;
+	}
+	control_alert_close(control);
 
 	ast_channel_cleanup(control->channel);
 	ao2_cleanup(control->app);
 
-	ast_cond_destroy(&control->wait_cond);
 	AST_LIST_HEAD_DESTROY(&control->add_rules);
 	AST_LIST_HEAD_DESTROY(&control->remove_rules);
 }
@@ -104,7 +185,6 @@ static void control_dtor(void *obj)
 struct stasis_app_control *control_create(struct ast_channel *channel, struct stasis_app *app)
 {
 	struct stasis_app_control *control;
-	int res;
 
 	control = ao2_alloc(sizeof(*control), control_dtor);
 	if (!control) {
@@ -113,23 +193,16 @@ struct stasis_app_control *control_create(struct ast_channel *channel, struct st
 
 	AST_LIST_HEAD_INIT(&control->add_rules);
 	AST_LIST_HEAD_INIT(&control->remove_rules);
-
-	res = ast_cond_init(&control->wait_cond, NULL);
-	if (res != 0) {
-		ast_log(LOG_ERROR, "Error initializing ast_cond_t: %s\n",
-			strerror(errno));
-		ao2_ref(control, -1);
-		return NULL;
-	}
+	control->alert[0] = control->alert[1] = -1;
 
 	control->app = ao2_bump(app);
 
 	ast_channel_ref(channel);
 	control->channel = channel;
 
-	control->command_queue = ao2_container_alloc_list(
-		AO2_ALLOC_OPT_LOCK_MUTEX, 0, NULL, NULL);
-	if (!control->command_queue) {
+	if (control_alert_init(control)) {
+		ast_log(LOG_ERROR, "Error creating Stasis control alert: %s\n",
+			strerror(errno));
 		ao2_ref(control, -1);
 		return NULL;
 	}
@@ -141,7 +214,7 @@ static void app_control_register_rule(
 	struct stasis_app_control *control,
 	struct app_control_rules *list, struct stasis_app_control_rule *obj)
 {
-	SCOPED_AO2LOCK(lock, control->command_queue);
+	SCOPED_AO2LOCK(lock, control);
 	AST_LIST_INSERT_TAIL(list, obj, next);
 }
 
@@ -150,7 +223,7 @@ static void app_control_unregister_rule(
 	struct app_control_rules *list, struct stasis_app_control_rule *obj)
 {
 	struct stasis_app_control_rule *rule;
-	SCOPED_AO2LOCK(lock, control->command_queue);
+	SCOPED_AO2LOCK(lock, control);
 	AST_RWLIST_TRAVERSE_SAFE_BEGIN(list, rule, next) {
 		if (rule == obj) {
 			AST_RWLIST_REMOVE_CURRENT(next);
@@ -167,7 +240,7 @@ static void app_control_unregister_rule(
  * \details Loops over a list of rules checking for rejections or failures.
  *          If one rule fails its resulting error code is returned.
  *
- * \note Command queue should be locked before calling this function.
+ * \note The control should be locked before calling this function.
  *
  * \param control The stasis application control
  * \param list The list of rules to check
@@ -236,9 +309,45 @@ static int noop_cb(struct stasis_app_control *control,
 }
 
 /*! Callback type to see if the command can execute
-    note: command_queue is locked during callback */
+    note: control is locked during callback */
 typedef int (*app_command_can_exec_cb)(struct stasis_app_control *control);
 
+/*!
+ * \internal
+ * \brief Queue a command for the channel's thread.
+ *
+ * \retval 0 if the command was queued.
+ * \retval -1 if the control is done.
+ */
+static int control_queue(struct stasis_app_control *control,
+	struct stasis_app_command *command)
+{
+	struct stasis_app_command *flushed;
+
+	if (command_queue_push(&control->command_queue, command)) {
+		control_alert_write(control);
+	}
+
+	if (!control_is_done(control)) {
+		return 0;
+	}
+
+	/*
+	 * The control was marked done while the command was pushed, so
+	 * nothing may dispatch it.  Complete whatever is left.
+	 */
+	flushed = command_queue_take(&control->command_queue);
+	while (flushed) {
+		struct stasis_app_command *next = command_queue_next(flushed);
+
+		command_complete(flushed, -1);
+		ao2_ref(flushed, -1);
+		flushed = next;
+	}
+
+	return -1;
+}
+
 static struct stasis_app_command *exec_command_on_condition(
 	struct stasis_app_control *control, stasis_app_command_cb command_fn,
 	void *data, command_data_destructor_fn data_destructor,
@@ -254,21 +363,22 @@ static struct stasis_app_command *exec_command_on_condition(
 		return NULL;
 	}
 
-	ao2_lock(control->command_queue);
-	if (control->is_done) {
-		ao2_unlock(control->command_queue);
+	if (control_is_done(control)) {
 		ao2_ref(command, -1);
 		return NULL;
 	}
-	if (can_exec_fn && (retval = can_exec_fn(control))) {
-		ao2_unlock(control->command_queue);
-		command_complete(command, retval);
-		return command;
+	if (can_exec_fn) {
+		ao2_lock(control);
+		retval = can_exec_fn(control);
+		ao2_unlock(control);
+		if (retval) {
+			command_complete(command, retval);
+			return command;
+		}
 	}
 
-	ao2_link_flags(control->command_queue, command, OBJ_NOLOCK);
-	ast_cond_signal(&control->wait_cond);
-	ao2_unlock(control->command_queue);
+	/* A command flushed by a racing control_mark_done() is already completed. */
+	control_queue(control, command);
 
 	return command;
 }
@@ -280,6 +390,35 @@ static struct stasis_app_command *exec_command(
 	return exec_command_on_condition(control, command_fn, data, data_destructor, NULL);
 }
 
+/*!
+ * \internal
+ * \brief Run a command that does not need the channel's thread right away.
+ *
+ * Only for commands that lock the channel themselves.  While commands are
+ * queued or being dispatched the command is queued behind them instead,
+ * so commands still run in the order they were sent.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the control is done.
+ */
+static int app_send_command_fast(struct stasis_app_control *control,
+	stasis_app_command_cb command_fn, void *data,
+	command_data_destructor_fn data_destructor)
+{
+	if (control == NULL || control_is_done(control)
+		|| control_command_count(control)
+		|| __atomic_load_n(&control->dispatching, __ATOMIC_SEQ_CST)) {
+		return stasis_app_send_command_async(control, command_fn, data, data_destructor);
+	}
+
+	command_fn(control, control->channel, data);
+	if (data_destructor) {
+		data_destructor(data);
+	}
+
+	return 0;
+}
+
 static int app_control_add_role(struct stasis_app_control *control,
 		struct ast_channel *chan, void *data)
 {
@@ -317,21 +456,18 @@ void stasis_app_control_clear_roles(struct stasis_app_control *control)
 
 int control_command_count(struct stasis_app_control *control)
 {
-	return ao2_container_count(control->command_queue);
+	return __atomic_load_n(&control->command_queue, __ATOMIC_SEQ_CST) != NULL;
 }
 
 int control_is_done(struct stasis_app_control *control)
 {
-	/* Called from stasis_app_exec thread; no lock needed */
-	return control->is_done;
+	return __atomic_load_n(&control->is_done, __ATOMIC_SEQ_CST);
 }
 
 void control_mark_done(struct stasis_app_control *control)
 {
-	/* Locking necessary to sync with other threads adding commands to the queue. */
-	ao2_lock(control->command_queue);
-	control->is_done = 1;
-	ao2_unlock(control->command_queue);
+	/* Commands pushed after this is seen are completed by control_queue(). */
+	__atomic_store_n(&control->is_done, 1, __ATOMIC_SEQ_CST);
 }
 
 struct stasis_app_control_continue_data {
@@ -519,7 +655,7 @@ int stasis_app_control_mute(struct stasis_app_control *control, unsigned int dir
 	mute_data->direction = direction;
 	mute_data->frametype = frametype;
 
-	stasis_app_send_command_async(control, app_control_mute, mute_data, ast_free_ptr);
+	app_send_command_fast(control, app_control_mute, mute_data, ast_free_ptr);
 
 	return 0;
 }
@@ -546,7 +682,7 @@ int stasis_app_control_unmute(struct stasis_app_control *control, unsigned int d
 	mute_data->direction = direction;
 	mute_data->frametype = frametype;
 
-	stasis_app_send_command_async(control, app_control_unmute, mute_data, ast_free_ptr);
+	app_send_command_fast(control, app_control_unmute, mute_data, ast_free_ptr);
 
 	return 0;
 }
@@ -611,7 +747,7 @@ int stasis_app_control_set_channel_var(struct stasis_app_control *control, const
 		}
 	}
 
-	stasis_app_send_command_async(control, app_control_set_channel_var, var, free_chanvar);
+	app_send_command_fast(control, app_control_set_channel_var, var, free_chanvar);
 
 	return 0;
 }
@@ -762,7 +898,7 @@ static int app_send_command_on_condition(struct stasis_app_control *control,
 {
 	RAII_VAR(struct stasis_app_command *, command, NULL, ao2_cleanup);
 
-	if (control == NULL || control->is_done) {
+	if (control == NULL || control_is_done(control)) {
 		/* If exec_command_on_condition fails, it calls the data_destructor.
 		 * In order to provide consistent behavior, we'll also call the data_destructor
 		 * on this error path. This way, callers never have to call the
@@ -795,7 +931,7 @@ int stasis_app_send_command_async(struct stasis_app_control *control,
 {
 	RAII_VAR(struct stasis_app_command *, command, NULL, ao2_cleanup);
 
-	if (control == NULL || control->is_done) {
+	if (control == NULL || control_is_done(control)) {
 		/* If exec_command fails, it calls the data_destructor. In order to
 		 * provide consistent behavior, we'll also call the data_destructor
 		 * on this error path. This way, callers never have to call the
@@ -1271,6 +1407,12 @@ const char *stasis_app_control_get_channel_id(
 	return ast_channel_uniqueid(control->channel);
 }
 
+const char *stasis_app_control_get_app_name(
+	const struct stasis_app_control *control)
+{
+	return control->app ? app_name(control->app) : NULL;
+}
+
 void stasis_app_control_publish(
 	struct stasis_app_control *control, struct stasis_message *message)
 {
@@ -1288,33 +1430,40 @@ int stasis_app_control_queue_control(struct stasis_app_control *control,
 
 void control_flush_queue(struct stasis_app_control *control)
 {
-	struct ao2_iterator iter;
 	struct stasis_app_command *command;
+	struct stasis_app_command *next;
 
-	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
-	while ((command = ao2_iterator_next(&iter))) {
+	command = command_queue_take(&control->command_queue);
+	for (; command; command = next) {
+		next = command_queue_next(command);
 		command_complete(command, -1);
 		ao2_ref(command, -1);
 	}
-	ao2_iterator_destroy(&iter);
 }
 
 int control_dispatch_all(struct stasis_app_control *control,
 	struct ast_channel *chan)
 {
 	int count = 0;
-	struct ao2_iterator iter;
 	struct stasis_app_command *command;
+	struct stasis_app_command *next;
 
 	ast_assert(control->channel == chan);
 
-	iter = ao2_iterator_init(control->command_queue, AO2_ITERATOR_UNLINK);
-	while ((command = ao2_iterator_next(&iter))) {
-		command_invoke(command, control, chan);
-		ao2_ref(command, -1);
-		++count;
+	/* Clear the alert first so a command pushed from here on raises it again. */
+	control_alert_read(control);
+
+	__atomic_store_n(&control->dispatching, 1, __ATOMIC_SEQ_CST);
+	while ((command = command_queue_take(&control->command_queue))) {
+		/* Everything queued so far is run as one batch. */
+		for (; command; command = next) {
+			next = command_queue_next(command);
+			command_invoke(command, control, chan);
+			ao2_ref(command, -1);
+			++count;
+		}
 	}
-	ao2_iterator_destroy(&iter);
+	__atomic_store_n(&control->dispatching, 0, __ATOMIC_SEQ_CST);
 
 	return count;
 }
@@ -1325,18 +1474,26 @@ void control_wait(struct stasis_app_control *control)
 		return;
 	}
 
-	ast_assert(control->command_queue != NULL);
-
-	ao2_lock(control->command_queue);
-	while (ao2_container_count(control->command_queue) == 0) {
-		int res = ast_cond_wait(&control->wait_cond,
-			ao2_object_get_lockaddr(control->command_queue));
-		if (res < 0) {
-			ast_log(LOG_ERROR, "Error waiting on command queue\n");
+	while (!control_command_count(control)) {
+		if (ast_wait_for_input(control->alert[0], -1) < 0 && errno != EINTR) {
+			ast_log(LOG_ERROR, "Error waiting on command queue: %s\n", strerror(errno));
 			break;
 		}
+		control_alert_read(control);
 	}
-	ao2_unlock(control->command_queue);
+}
+
+int control_waitfor(struct stasis_app_control *control, struct ast_channel *chan, int ms)
+{
+	struct ast_channel *ready;
+	int outfd = -1;
+
+	ready = ast_waitfor_nandfds(&chan, 1, &control->alert[0], 1, NULL, &outfd, &ms);
+	if (ms < 0) {
+		return -1;
+	}
+
+	return ready ? 1 : 0;
 }
 
 int control_prestart_dispatch_all(struct stasis_app_control *control,
@@ -68,11 +68,25 @@ int control_dispatch_all(struct stasis_app_control *control,
 void control_wait(struct stasis_app_control *control);
 
 /*!
- * \brief Returns the count of items in a control's command queue.
+ * \brief Wait for a frame on \a chan or a command for \a control.
  *
- * \param control Control to count commands on
+ * \param control Control whose commands to wait for.
+ * \param chan Associated channel.
+ * \param ms Longest time to wait in milliseconds.
+ *
+ * \retval 1 if a frame is ready to be read from \a chan.
+ * \retval 0 on a timeout or a queued command.
+ * \retval -1 on error.
+ */
+int control_waitfor(struct stasis_app_control *control, struct ast_channel *chan, int ms);
+
+/*!
+ * \brief Returns whether a control's command queue has commands.
+ *
+ * \param control Control to check the commands of
  *
- * \retval number of commands in the command que
+ * \retval non-zero if commands are queued
+ * \retval 0 if the queue is empty
  */
 int control_command_count(struct stasis_app_control *control);
 
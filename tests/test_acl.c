@@ -36,6 +36,8 @@
 #include "asterisk/module.h"
 #include "asterisk/netsock2.h"
 #include "asterisk/config.h"
+#include "asterisk/strings.h"
+#include "asterisk/utils.h"
 
 AST_TEST_DEFINE(invalid_acl)
 {
@@ -433,10 +435,94 @@ acl_cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(acl_compiled)
+{
+	struct ast_ha *ha = NULL;
+	struct ast_ha *walked = NULL;
+	struct ast_str *rule = ast_str_alloca(128);
+	struct ast_sockaddr addr;
+	char address[64];
+	enum ast_acl_sense compiled_res;
+	enum ast_acl_sense walked_res;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int err = 0;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "acl_compiled";
+		info->category = "/main/acl/";
+		info->summary = "Compiled ACL unit test";
+		info->description =
+			"Tests that a compiled ACL permits and denies the same hosts\n"
+			"as walking its rules";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	/* Overlapping IPv4 and IPv6 rules of every length, so the last match matters. */
+	for (i = 0; i < 500; ++i) {
+		if (ast_random() % 2) {
+			ast_str_set(&rule, 0, "10.%ld.%ld.%ld/%ld", ast_random() % 4,
+				ast_random() % 4, ast_random() % 4, ast_random() % 33);
+		} else {
+			ast_str_set(&rule, 0, "2001:db8:%lx::%lx/%ld", ast_random() % 4,
+				ast_random() % 4, ast_random() % 129);
+		}
+		ha = ast_append_ha(ast_random() % 2 ? "permit" : "deny", ast_str_buffer(rule), ha, &err);
+		if (!ha || err) {
+			ast_test_status_update(test, "Failed to add rule %s\n", ast_str_buffer(rule));
+			res = AST_TEST_FAIL;
+			goto acl_compiled_cleanup;
+		}
+	}
+
+	walked = ast_duplicate_ha_list(ha);
+	if (!walked || ast_ha_compile(ha)) {
+		ast_test_status_update(test, "Failed to compile ACL\n");
+		res = AST_TEST_FAIL;
+		goto acl_compiled_cleanup;
+	}
+
+	for (i = 0; i < 10000; ++i) {
+		switch (ast_random() % 3) {
+		case 0:
+			snprintf(address, sizeof(address), "10.%ld.%ld.%ld", ast_random() % 4,
+				ast_random() % 4, ast_random() % 4);
+			break;
+		case 1:
+			snprintf(address, sizeof(address), "::ffff:10.%ld.%ld.%ld", ast_random() % 4,
+				ast_random() % 4, ast_random() % 4);
+			break;
+		default:
+			snprintf(address, sizeof(address), "2001:db8:%lx::%lx", ast_random() % 4,
+				ast_random() % 4);
+			break;
+		}
+		ast_sockaddr_parse(&addr, address, PARSE_PORT_FORBID);
+
+		compiled_res = ast_apply_ha(ha, &addr);
+		walked_res = ast_apply_ha(walked, &addr);
+		if (compiled_res != walked_res) {
+			ast_test_status_update(test, "Access not as expected to %s on compiled ACL. Expected %u but "
+					"got %u instead\n", address, walked_res, compiled_res);
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+acl_compiled_cleanup:
+	ast_free_ha(ha);
+	ast_free_ha(walked);
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(invalid_acl);
 	AST_TEST_UNREGISTER(acl);
+	AST_TEST_UNREGISTER(acl_compiled);
 	return 0;
 }
 
@@ -444,6 +530,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(invalid_acl);
 	AST_TEST_REGISTER(acl);
+	AST_TEST_REGISTER(acl_compiled);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -244,31 +244,29 @@ static int compare_strings(void *lhs, void *rhs, int flags)
 	}
 }
 
-AST_TEST_DEFINE(hash_test)
+/*!
+ * \brief Thrash the given container from several threads at once.
+ *
+ * \param test Test being run.
+ * \param to_be_thrashed Empty container to thrash.  The reference is stolen.
+ *
+ * \return Test result.
+ */
+static enum ast_test_result_state hash_test_thrash(struct ast_test *test,
+	struct ao2_container *to_be_thrashed)
 {
 	enum ast_test_result_state res = AST_TEST_PASS;
 	struct hash_test data = {};
 	pthread_t grow_thread, count_thread, lookup_thread, shrink_thread;
 	void *thread_results;
+	struct timeval start;
 	int i;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "thrash";
-		info->category = "/main/astobj2/";
-		info->summary = "Testing astobj2 container concurrency";
-		info->description = "Test astobj2 container concurrency correctness.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
-	ast_test_status_update(test, "Executing hash concurrency test...\n");
+	start = ast_tvnow();
 	data.preload = MAX_HASH_ENTRIES / 2;
 	data.max_grow = MAX_HASH_ENTRIES - data.preload;
-	data.deadline = ast_tvadd(ast_tvnow(), ast_tv(MAX_TEST_SECONDS, 0));
-	data.to_be_thrashed = ao2_container_alloc(HASH_BUCKETS, hash_string,
-		compare_strings);
+	data.deadline = ast_tvadd(start, ast_tv(MAX_TEST_SECONDS, 0));
+	data.to_be_thrashed = to_be_thrashed;
 
 	if (data.to_be_thrashed == NULL) {
 		ast_test_status_update(test, "Allocation failed\n");
@@ -332,8 +330,21 @@ AST_TEST_DEFINE(hash_test)
 		res = AST_TEST_FAIL;
 	}
 
+	if (ao2_container_check(data.to_be_thrashed, 0)) {
+		ast_test_status_update(test, "ao2 container integrity check failed\n");
+		res = AST_TEST_FAIL;
+	}
+
 	ao2_ref(data.to_be_thrashed, -1);
 
+	ast_test_status_update(test, "Thrashing took %" PRIi64 " ms\n",
+		ast_tvdiff_ms(ast_tvnow(), start));
+
+	/* Objects unlinked from an RCU container are released a little later. */
+	for (i = 0; i < 100 && ast_atomic_fetchadd_int(&alloc_count, 0); ++i) {
+		usleep(10000);
+	}
+
 	/* check for object leaks */
 	if (ast_atomic_fetchadd_int(&alloc_count, 0) != 0) {
 		ast_test_status_update(test, "Leaked %d objects!\n",
@@ -344,15 +355,79 @@ AST_TEST_DEFINE(hash_test)
 	return res;
 }
 
+AST_TEST_DEFINE(hash_test)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing astobj2 container concurrency";
+		info->description = "Test astobj2 container concurrency correctness.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Executing hash concurrency test...\n");
+	return hash_test_thrash(test, ao2_container_alloc(HASH_BUCKETS, hash_string,
+		compare_strings));
+}
+
+AST_TEST_DEFINE(hash_resize_test)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash_resize";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing resizable astobj2 container concurrency";
+		info->description =
+			"Test resizable astobj2 hash container concurrency correctness.\n"
+			"The container starts with a single bucket and has to grow\n"
+			"while it is being thrashed.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Executing resizable hash concurrency test...\n");
+	return hash_test_thrash(test, ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_MUTEX,
+		AO2_CONTAINER_ALLOC_OPT_HASH_RESIZE, 1, hash_string, NULL, compare_strings));
+}
+
+AST_TEST_DEFINE(hash_rcu_test)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "thrash_rcu";
+		info->category = "/main/astobj2/";
+		info->summary = "Testing lock-free astobj2 container lookups";
+		info->description =
+			"Test RCU astobj2 hash container concurrency correctness.\n"
+			"The lookup thread searches the container without its lock\n"
+			"while the other threads link and unlink objects.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_status_update(test, "Executing RCU hash concurrency test...\n");
+	return hash_test_thrash(test, ao2_container_alloc_hash(AO2_ALLOC_OPT_LOCK_RWLOCK,
+		AO2_CONTAINER_ALLOC_OPT_RCU, HASH_BUCKETS, hash_string, NULL, compare_strings));
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(hash_test);
+	AST_TEST_UNREGISTER(hash_resize_test);
+	AST_TEST_UNREGISTER(hash_rcu_test);
 	return 0;
 }
 
 static int load_module(void)
 {
 	AST_TEST_REGISTER(hash_test);
+	AST_TEST_REGISTER(hash_resize_test);
+	AST_TEST_REGISTER(hash_rcu_test);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
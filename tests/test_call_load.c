@@ -0,0 +1,732 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Synthetic call load generator
+ *
+ * Places Local channel calls at a given rate into dialplan, sends timestamped
+ * audio on each of them once answered and measures how long the calls took
+ * to be answered and how long the audio took to come back.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<use type="module">app_echo</use>
+	<use type="module">app_dial</use>
+	<use type="module">app_confbridge</use>
+	<use type="module">res_musiconhold</use>
+	<use type="module">app_mixmonitor</use>
+	<support_level>core</support_level>
+ ***/
+
+/*** DOCUMENTATION
+	<manager name="CallLoad" language="en_US">
+		<synopsis>
+			Run a synthetic call load and report its latency.
+		</synopsis>
+		<syntax>
+			<xi:include xpointer="xpointer(/docs/manager[@name='Login']/syntax/parameter[@name='ActionID'])" />
+			<parameter name="Scenario" required="true">
+				<para>One of <literal>echo</literal>, <literal>bridge</literal>,
+				<literal>confbridge</literal>, <literal>moh</literal> or
+				<literal>record</literal>, or an <replaceable>exten</replaceable>@<replaceable>context</replaceable>
+				to call instead.</para>
+			</parameter>
+			<parameter name="CPS">
+				<para>Calls to place per second.  Defaults to 10.</para>
+			</parameter>
+			<parameter name="Calls">
+				<para>Calls to place.  Defaults to 100.</para>
+			</parameter>
+			<parameter name="Duration">
+				<para>Seconds each call sends audio for once answered.  Defaults to 10.</para>
+			</parameter>
+		</syntax>
+		<description>
+			<para>Places the calls through Local channels and responds once all of
+			them have hung up.  The response holds the call counts, the 50th, 90th
+			and 99th percentile and maximum of the call setup and audio round trip
+			latency in microseconds, and the CPU time used per call in microseconds.</para>
+		</description>
+	</manager>
+ ***/
+
+#include "asterisk.h"
+
+#include <sys/resource.h>
+
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/cli.h"
+#include "asterisk/manager.h"
+#include "asterisk/channel.h"
+#include "asterisk/pbx.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/json.h"
+#include "asterisk/vector.h"
+
+/*! \brief Context the scenarios are created in */
+#define CALL_LOAD_CONTEXT "call-load"
+
+/*! \brief Length of the audio frames sent, in milliseconds */
+#define CALL_LOAD_FRAME_MS 20
+
+/*! \brief Samples in each audio frame sent */
+#define CALL_LOAD_FRAME_SAMPLES (8 * CALL_LOAD_FRAME_MS)
+
+/*! \brief How long a call may take to be answered, in milliseconds */
+#define CALL_LOAD_SETUP_TIMEOUT 10000
+
+/*! \brief Marks the audio frames this module sent */
+#define CALL_LOAD_MAGIC 0x4c4f4144
+
+/*! \brief Percentiles reported, the last one being the maximum */
+static const unsigned int call_load_points[] = { 50, 90, 99, 100 };
+
+#define CALL_LOAD_POINTS ARRAY_LEN(call_load_points)
+
+/*! \brief A dialplan scenario calls can be placed into */
+struct call_load_scenario {
+	/*! Extension in the call-load context */
+	const char *name;
+	/*! Applications run, with their arguments, one per priority */
+	const char *steps[3][2];
+};
+
+static const struct call_load_scenario scenarios[] = {
+	{ "echo", { { "Answer", "" }, { "Echo", "" } } },
+	{ "bridge", { { "Dial", "Local/echo@" CALL_LOAD_CONTEXT } } },
+	{ "confbridge", { { "Answer", "" }, { "ConfBridge", CALL_LOAD_CONTEXT } } },
+	{ "moh", { { "Answer", "" }, { "MusicOnHold", "default" } } },
+	{ "record", { { "Answer", "" }, { "MixMonitor", CALL_LOAD_CONTEXT "/${UNIQUEID}.wav" }, { "Echo", "" } } },
+};
+
+/*! \brief What is written at the start of each audio frame sent */
+struct call_load_stamp {
+	unsigned int magic;
+	struct timeval sent;
+};
+
+/*! \brief A load being generated */
+struct call_load {
+	ast_mutex_t lock;
+	/*! Signalled when the last call hangs up */
+	ast_cond_t cond;
+	/*! Where the calls are placed */
+	char destination[AST_MAX_EXTENSION + AST_MAX_CONTEXT + 2];
+	/*! Seconds each call sends audio for */
+	unsigned int duration;
+	/*! Calls still up */
+	unsigned int active;
+	/*! Calls answered */
+	unsigned int answered;
+	/*! Calls that could not be placed or were not answered */
+	unsigned int failed;
+	/*! Audio frames sent */
+	unsigned int frames_sent;
+	/*! Audio frames sent that came back */
+	unsigned int frames_received;
+	/*! Time each answered call took to be answered, in microseconds */
+	AST_VECTOR(, unsigned int) setup;
+	/*! Round trip time of each frame that came back, in microseconds */
+	AST_VECTOR(, unsigned int) latency;
+};
+
+/*! \brief The results of a load */
+struct call_load_results {
+	unsigned int calls;
+	unsigned int answered;
+	unsigned int failed;
+	unsigned int frames_sent;
+	unsigned int frames_received;
+	/*! Percentiles of the call setup time, in microseconds */
+	unsigned int setup[CALL_LOAD_POINTS];
+	/*! Percentiles of the frame round trip time, in microseconds */
+	unsigned int latency[CALL_LOAD_POINTS];
+	/*! CPU time used by the whole process per call, in microseconds */
+	unsigned int cpu_per_call;
+	/*! How long the load took, in milliseconds */
+	unsigned int elapsed;
+};
+
+static const struct call_load_scenario *call_load_scenario_find(const char *name)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(scenarios); i++) {
+		if (!strcasecmp(scenarios[i].name, name)) {
+			return &scenarios[i];
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Wait for a call to be answered.
+ *
+ * \retval 0 answered.
+ * \retval -1 the call failed or was not answered in time.
+ */
+static int call_load_wait_answer(struct ast_channel *chan)
+{
+	struct timeval start = ast_tvnow();
+	struct ast_frame *f;
+	int ms;
+	int res;
+
+	while ((ms = ast_remaining_ms(start, CALL_LOAD_SETUP_TIMEOUT))) {
+		res = ast_waitfor(chan, ms);
+		if (res < 0) {
+			return -1;
+		} else if (!res) {
+			continue;
+		}
+		if (!(f = ast_read(chan))) {
+			return -1;
+		}
+		if (f->frametype == AST_FRAME_CONTROL) {
+			switch (f->subclass.integer) {
+			case AST_CONTROL_ANSWER:
+				ast_frfree(f);
+				return 0;
+			case AST_CONTROL_BUSY:
+			case AST_CONTROL_CONGESTION:
+			case AST_CONTROL_HANGUP:
+				ast_frfree(f);
+				return -1;
+			default:
+				break;
+			}
+		}
+		ast_frfree(f);
+	}
+	return -1;
+}
+
+/*!
+ * \internal
+ * \brief Send audio on an answered call and time the frames that come back.
+ */
+static void call_load_media(struct call_load *load, struct ast_channel *chan)
+{
+	int16_t buf[CALL_LOAD_FRAME_SAMPLES] = { 0, };
+	struct ast_frame frame = {
+		.frametype = AST_FRAME_VOICE,
+		.datalen = sizeof(buf),
+		.samples = CALL_LOAD_FRAME_SAMPLES,
+		.src = "test_call_load",
+		.data.ptr = buf,
+	};
+	struct call_load_stamp stamp = { .magic = CALL_LOAD_MAGIC, };
+	struct timeval now = ast_tvnow();
+	struct timeval next = now;
+	struct timeval end = ast_tvadd(now, ast_samp2tv(load->duration, 1));
+	struct ast_frame *f;
+	unsigned int sent = 0;
+	int res;
+
+	frame.subclass.format = ast_format_slin;
+
+	while (ast_tvcmp(now = ast_tvnow(), end) < 0) {
+		if (ast_tvcmp(now, next) >= 0) {
+			stamp.sent = now;
+			memcpy(buf, &stamp, sizeof(stamp));
+			if (ast_write(chan, &frame)) {
+				break;
+			}
+			sent++;
+			next = ast_tvadd(next, ast_samp2tv(CALL_LOAD_FRAME_MS, 1000));
+			continue;
+		}
+
+		res = ast_waitfor(chan, ast_tvdiff_ms(next, now));
+		if (res < 0) {
+			break;
+		} else if (!res) {
+			continue;
+		}
+		if (!(f = ast_read(chan))) {
+			break;
+		}
+		if (f->frametype == AST_FRAME_VOICE && f->datalen >= sizeof(stamp)) {
+			memcpy(&stamp, f->data.ptr, sizeof(stamp));
+			if (stamp.magic == CALL_LOAD_MAGIC) {
+				ast_mutex_lock(&load->lock);
+				load->frames_received++;
+				AST_VECTOR_APPEND(&load->latency, ast_tvdiff_us(ast_tvnow(), stamp.sent));
+				ast_mutex_unlock(&load->lock);
+			}
+			stamp.magic = CALL_LOAD_MAGIC;
+		}
+		ast_frfree(f);
+	}
+
+	ast_mutex_lock(&load->lock);
+	load->frames_sent += sent;
+	ast_mutex_unlock(&load->lock);
+}
+
+/*! \brief Thread placing one call */
+static void *call_load_call(void *data)
+{
+	struct call_load *load = data;
+	struct ast_format_cap *cap;
+	struct ast_channel *chan = NULL;
+	struct timeval start = ast_tvnow();
+	int answered = 0;
+	int cause;
+
+	cap = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (cap && !ast_format_cap_append(cap, ast_format_slin, 0)) {
+		chan = ast_request("Local", cap, NULL, NULL, load->destination, &cause);
+	}
+	ao2_cleanup(cap);
+
+	if (chan
+		&& !ast_set_read_format(chan, ast_format_slin)
+		&& !ast_set_write_format(chan, ast_format_slin)
+		&& !ast_call(chan, load->destination, 0)
+		&& !call_load_wait_answer(chan)) {
+		answered = 1;
+
+		ast_mutex_lock(&load->lock);
+		load->answered++;
+		AST_VECTOR_APPEND(&load->setup, ast_tvdiff_us(ast_tvnow(), start));
+		ast_mutex_unlock(&load->lock);
+
+		call_load_media(load, chan);
+	}
+
+	if (chan) {
+		ast_hangup(chan);
+	}
+
+	ast_mutex_lock(&load->lock);
+	if (!answered) {
+		load->failed++;
+	}
+	if (!--load->active) {
+		ast_cond_signal(&load->cond);
+	}
+	ast_mutex_unlock(&load->lock);
+
+	return NULL;
+}
+
+static int call_load_sample_cmp(const void *a, const void *b)
+{
+	unsigned int left = *(const unsigned int *) a;
+	unsigned int right = *(const unsigned int *) b;
+
+	return (left > right) - (left < right);
+}
+
+/*! \brief Sort samples and pick the reported percentiles out of them */
+static void call_load_percentiles(unsigned int *samples, size_t count, unsigned int *points)
+{
+	int i;
+
+	if (!count) {
+		memset(points, 0, CALL_LOAD_POINTS * sizeof(*points));
+		return;
+	}
+
+	qsort(samples, count, sizeof(*samples), call_load_sample_cmp);
+	for (i = 0; i < CALL_LOAD_POINTS; i++) {
+		points[i] = samples[(count - 1) * call_load_points[i] / 100];
+	}
+}
+
+static int64_t call_load_cpu_us(const struct rusage *usage)
+{
+	return (int64_t) (usage->ru_utime.tv_sec + usage->ru_stime.tv_sec) * 1000000
+		+ usage->ru_utime.tv_usec + usage->ru_stime.tv_usec;
+}
+
+/*!
+ * \internal
+ * \brief Generate a call load and wait for it to finish.
+ *
+ * \param scenario Name of a scenario, or an exten\@context to call.
+ * \param cps Calls to place per second.
+ * \param calls Calls to place.
+ * \param duration Seconds each answered call sends audio for.
+ * \param[out] results The results of the load.
+ *
+ * \retval 0 on success.
+ * \retval -1 if the scenario does not exist or the load could not be set up.
+ */
+static int call_load_run(const char *scenario, unsigned int cps, unsigned int calls,
+	unsigned int duration, struct call_load_results *results)
+{
+	struct call_load load;
+	struct rusage usage_start;
+	struct rusage usage_end;
+	struct timeval start;
+	pthread_t thread;
+	int64_t wait;
+	unsigned int i;
+
+	memset(&load, 0, sizeof(load));
+	if (strchr(scenario, '@')) {
+		ast_copy_string(load.destination, scenario, sizeof(load.destination));
+	} else if (call_load_scenario_find(scenario)) {
+		snprintf(load.destination, sizeof(load.destination), "%s@%s", scenario, CALL_LOAD_CONTEXT);
+	} else {
+		return -1;
+	}
+	load.duration = duration;
+
+	if (AST_VECTOR_INIT(&load.setup, calls)
+		|| AST_VECTOR_INIT(&load.latency, calls)) {
+		AST_VECTOR_FREE(&load.setup);
+		return -1;
+	}
+	ast_mutex_init(&load.lock);
+	ast_cond_init(&load.cond, NULL);
+
+	getrusage(RUSAGE_SELF, &usage_start);
+	start = ast_tvnow();
+
+	for (i = 0; i < calls; i++) {
+		wait = ast_tvdiff_us(ast_tvadd(start, ast_samp2tv(i, cps)), ast_tvnow());
+		if (wait > 0) {
+			usleep(wait);
+		}
+
+		ast_mutex_lock(&load.lock);
+		load.active++;
+		ast_mutex_unlock(&load.lock);
+
+		if (ast_pthread_create_detached(&thread, NULL, call_load_call, &load)) {
+			ast_mutex_lock(&load.lock);
+			load.active--;
+			load.failed++;
+			ast_mutex_unlock(&load.lock);
+		}
+	}
+
+	ast_mutex_lock(&load.lock);
+	while (load.active) {
+		ast_cond_wait(&load.cond, &load.lock);
+	}
+	ast_mutex_unlock(&load.lock);
+
+	getrusage(RUSAGE_SELF, &usage_end);
+
+	memset(results, 0, sizeof(*results));
+	results->calls = calls;
+	results->answered = load.answered;
+	results->failed = load.failed;
+	results->frames_sent = load.frames_sent;
+	results->frames_received = load.frames_received;
+	results->elapsed = ast_tvdiff_ms(ast_tvnow(), start);
+	results->cpu_per_call = calls ? (call_load_cpu_us(&usage_end) - call_load_cpu_us(&usage_start)) / calls : 0;
+	call_load_percentiles(load.setup.elems, AST_VECTOR_SIZE(&load.setup), results->setup);
+	call_load_percentiles(load.latency.elems, AST_VECTOR_SIZE(&load.latency), results->latency);
+
+	AST_VECTOR_FREE(&load.setup);
+	AST_VECTOR_FREE(&load.latency);
+	ast_mutex_destroy(&load.lock);
+	ast_cond_destroy(&load.cond);
+
+	return 0;
+}
+
+static struct ast_json *call_load_percentiles_json(const unsigned int *points)
+{
+	return ast_json_pack("{s: i, s: i, s: i, s: i}",
+		"p50", points[0], "p90", points[1], "p99", points[2], "max", points[3]);
+}
+
+static struct ast_json *call_load_results_json(const char *scenario, unsigned int cps,
+	unsigned int duration, const struct call_load_results *results)
+{
+	return ast_json_pack("{s: s, s: i, s: i, s: i, s: i, s: i, s: i, s: i, s: o, s: o, s: i, s: i}",
+		"scenario", scenario,
+		"cps", cps,
+		"duration", duration,
+		"calls", results->calls,
+		"answered", results->answered,
+		"failed", results->failed,
+		"frames_sent", results->frames_sent,
+		"frames_received", results->frames_received,
+		"setup_latency_us", call_load_percentiles_json(results->setup),
+		"frame_latency_us", call_load_percentiles_json(results->latency),
+		"cpu_per_call_us", results->cpu_per_call,
+		"elapsed_ms", results->elapsed);
+}
+
+/*!
+ * \internal
+ * \brief Parse the rate, count and duration of a load.
+ *
+ * \retval 0 on success.
+ * \retval -1 if one of them is not valid.
+ */
+static int call_load_parse(const char *cps_str, const char *calls_str, const char *duration_str,
+	unsigned int *cps, unsigned int *calls, unsigned int *duration)
+{
+	if (!ast_strlen_zero(cps_str)
+		&& (sscanf(cps_str, "%30u", cps) != 1 || !*cps || *cps > 1000)) {
+		return -1;
+	}
+	if (!ast_strlen_zero(calls_str)
+		&& (sscanf(calls_str, "%30u", calls) != 1 || !*calls || *calls > 100000)) {
+		return -1;
+	}
+	if (!ast_strlen_zero(duration_str)
+		&& (sscanf(duration_str, "%30u", duration) != 1 || *duration > 3600)) {
+		return -1;
+	}
+	return 0;
+}
+
+static char *call_load_complete_scenario(const char *word, int state)
+{
+	int which = 0;
+	int wordlen = strlen(word);
+	int i;
+
+	for (i = 0; i < ARRAY_LEN(scenarios); i++) {
+		if (!strncasecmp(word, scenarios[i].name, wordlen) && ++which > state) {
+			return ast_strdup(scenarios[i].name);
+		}
+	}
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief CLI command implementation for 'test call load'
+ */
+static char *handle_cli_call_load(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
+{
+	struct call_load_results results;
+	unsigned int cps = 0;
+	unsigned int calls = 0;
+	unsigned int duration = 0;
+
+	switch (cmd) {
+	case CLI_INIT:
+		e->command = "test call load";
+		e->usage =
+			"Usage: test call load <scenario> <cps> <calls> <duration> [json]\n"
+			"       Place <calls> Local channel calls at <cps> calls per second, each\n"
+			"       sending audio for <duration> seconds once answered.  <scenario> is\n"
+			"       one of echo, bridge, confbridge, moh or record, or an exten@context\n"
+			"       to call instead.  Reports the call setup and audio round trip\n"
+			"       latency percentiles and the CPU time used per call, as JSON if\n"
+			"       'json' is given.  The record scenario leaves its recordings in the\n"
+			"       " CALL_LOAD_CONTEXT " directory of the monitor spool directory.\n";
+		return NULL;
+	case CLI_GENERATE:
+		if (a->pos == 3) {
+			return call_load_complete_scenario(a->word, a->n);
+		} else if (a->pos == 7) {
+			return ast_cli_complete(a->word, (const char * const []) { "json", NULL }, a->n);
+		}
+		return NULL;
+	}
+
+	if (a->argc != 7 && (a->argc != 8 || strcasecmp(a->argv[7], "json"))) {
+		return CLI_SHOWUSAGE;
+	}
+
+	if (call_load_parse(a->argv[4], a->argv[5], a->argv[6], &cps, &calls, &duration)) {
+		ast_cli(a->fd, "The calls per second must be 1 to 1000, the calls 1 to 100000 and the duration at most 3600 seconds\n");
+		return CLI_FAILURE;
+	}
+
+	if (call_load_run(a->argv[3], cps, calls, duration, &results)) {
+		ast_cli(a->fd, "Unable to run the '%s' scenario\n", a->argv[3]);
+		return CLI_FAILURE;
+	}
+
+	if (a->argc == 8) {
+		struct ast_json *json = call_load_results_json(a->argv[3], cps, duration, &results);
+		char *str = json ? ast_json_dump_string_format(json, AST_JSON_PRETTY) : NULL;
+
+		ast_cli(a->fd, "%s\n", S_OR(str, "{}"));
+		ast_json_free(str);
+		ast_json_unref(json);
+		return CLI_SUCCESS;
+	}
+
+	ast_cli(a->fd, "Scenario: %s, %u calls at %u per second for %u seconds\n",
+		a->argv[3], calls, cps, duration);
+	ast_cli(a->fd, "Answered: %u, failed: %u, took %u ms\n",
+		results.answered, results.failed, results.elapsed);
+	ast_cli(a->fd, "Frames sent: %u, came back: %u\n",
+		results.frames_sent, results.frames_received);
+	ast_cli(a->fd, "%-26s %10s %10s %10s %10s\n", "Latency (microseconds)",
+		"p50", "p90", "p99", "max");
+	ast_cli(a->fd, "%-26s %10u %10u %10u %10u\n", "Call setup",
+		results.setup[0], results.setup[1], results.setup[2], results.setup[3]);
+	ast_cli(a->fd, "%-26s %10u %10u %10u %10u\n", "Audio round trip",
+		results.latency[0], results.latency[1], results.latency[2], results.latency[3]);
+	ast_cli(a->fd, "CPU time per call: %u microseconds\n", results.cpu_per_call);
+
+	return CLI_SUCCESS;
+}
+
+static struct ast_cli_entry cli_call_load[] = {
+	AST_CLI_DEFINE(handle_cli_call_load, "Generate a synthetic call load"),
+};
+
+static int manager_call_load(struct mansession *s, const struct message *m)
+{
+	const char *id = astman_get_header(m, "ActionID");
+	const char *scenario = astman_get_header(m, "Scenario");
+	struct call_load_results results;
+	unsigned int cps = 10;
+	unsigned int calls = 100;
+	unsigned int duration = 10;
+
+	if (ast_strlen_zero(scenario)) {
+		astman_send_error(s, m, "Scenario not specified");
+		return AMI_SUCCESS;
+	}
+
+	if (call_load_parse(astman_get_header(m, "CPS"), astman_get_header(m, "Calls"),
+		astman_get_header(m, "Duration"), &cps, &calls, &duration)) {
+		astman_send_error(s, m, "Invalid CPS, Calls or Duration");
+		return AMI_SUCCESS;
+	}
+
+	if (call_load_run(scenario, cps, calls, duration, &results)) {
+		astman_send_error(s, m, "Unable to run the scenario");
+		return AMI_SUCCESS;
+	}
+
+	astman_append(s, "Response: Success\r\n");
+	if (!ast_strlen_zero(id)) {
+		astman_append(s, "ActionID: %s\r\n", id);
+	}
+	astman_append(s,
+		"Scenario: %s\r\n"
+		"Calls: %u\r\n"
+		"Answered: %u\r\n"
+		"Failed: %u\r\n"
+		"FramesSent: %u\r\n"
+		"FramesReceived: %u\r\n"
+		"SetupLatencyP50: %u\r\n"
+		"SetupLatencyP90: %u\r\n"
+		"SetupLatencyP99: %u\r\n"
+		"SetupLatencyMax: %u\r\n"
+		"FrameLatencyP50: %u\r\n"
+		"FrameLatencyP90: %u\r\n"
+		"FrameLatencyP99: %u\r\n"
+		"FrameLatencyMax: %u\r\n"
+		"CPUPerCall: %u\r\n"
+		"Elapsed: %u\r\n"
+		"\r\n",
+		scenario, results.calls, results.answered, results.failed,
+		results.frames_sent, results.frames_received,
+		results.setup[0], results.setup[1], results.setup[2], results.setup[3],
+		results.latency[0], results.latency[1], results.latency[2], results.latency[3],
+		results.cpu_per_call, results.elapsed);
+
+	return AMI_SUCCESS;
+}
+
+AST_TEST_DEFINE(call_load_echo)
+{
+	struct call_load_results results;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = "/main/call_load/";
+		info->summary = "Generate a small echo call load";
+		info->description =
+			"Place a few calls into the echo scenario and check that they\n"
+			"are all answered and that the audio sent comes back.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (call_load_run("echo", 5, 5, 1, &results)) {
+		ast_test_status_update(test, "Unable to run the echo scenario\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "Setup p99 %u us, audio round trip p99 %u us, %u us CPU per call\n",
+		results.setup[2], results.latency[2], results.cpu_per_call);
+
+	if (results.answered != results.calls) {
+		ast_test_status_update(test, "Only %u of %u calls were answered\n",
+			results.answered, results.calls);
+		return AST_TEST_FAIL;
+	}
+	if (!results.frames_received) {
+		ast_test_status_update(test, "None of the %u frames sent came back\n",
+			results.frames_sent);
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
+static int call_load_create_dialplan(void)
+{
+	int i;
+	int j;
+	int res = 0;
+
+	if (!ast_context_find_or_create(NULL, NULL, CALL_LOAD_CONTEXT, AST_MODULE)) {
+		return -1;
+	}
+
+	for (i = 0; i < ARRAY_LEN(scenarios); i++) {
+		for (j = 0; j < ARRAY_LEN(scenarios[i].steps) && scenarios[i].steps[j][0]; j++) {
+			res |= ast_add_extension(CALL_LOAD_CONTEXT, 0, scenarios[i].name, j + 1, NULL, NULL,
+				scenarios[i].steps[j][0], ast_strdup(scenarios[i].steps[j][1]), ast_free_ptr,
+				AST_MODULE);
+		}
+	}
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(call_load_echo);
+	ast_manager_unregister("CallLoad");
+	ast_cli_unregister_multiple(cli_call_load, ARRAY_LEN(cli_call_load));
+	ast_context_destroy(NULL, AST_MODULE);
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	if (call_load_create_dialplan()) {
+		ast_context_destroy(NULL, AST_MODULE);
+		return AST_MODULE_LOAD_DECLINE;
+	}
+
+	ast_cli_register_multiple(cli_call_load, ARRAY_LEN(cli_call_load));
+	ast_manager_register_xml("CallLoad", EVENT_FLAG_SYSTEM, manager_call_load);
+	AST_TEST_REGISTER(call_load_echo);
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Synthetic call load generator");
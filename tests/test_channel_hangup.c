@@ -0,0 +1,317 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Channel hangup storm tests
+ *
+ * Hangs up many channels at once from several threads, as when a conference
+ * ends or a trunk fails, and reports how long the threads were held up.
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/module.h"
+#include "asterisk/test.h"
+#include "asterisk/channel.h"
+#include "asterisk/pbx.h"
+#include "asterisk/time.h"
+#include "asterisk/format_cache.h"
+
+#define TEST_CATEGORY "/main/channel/hangup/"
+
+#define CHANNEL_TECH_NAME "HangupTestChannel"
+
+/*! \brief Variables set on each channel, so there is something to free */
+#define STORM_VARIABLES 16
+
+/*! \brief A channel technology used for the unit tests */
+static struct ast_channel_tech test_hangup_chan_tech = {
+	.type = CHANNEL_TECH_NAME,
+	.description = "Mock channel technology for hangup tests",
+};
+
+/*! \brief A hangup storm */
+struct hangup_storm {
+	/*! The channels hung up */
+	struct ast_channel **chans;
+	/*! How many channels */
+	unsigned int count;
+	/*! How many threads hang them up */
+	unsigned int threads;
+	/*! Protects started */
+	ast_mutex_t lock;
+	/*! Signalled when the threads are to start */
+	ast_cond_t cond;
+	/*! Non-zero once the threads are to start */
+	int started;
+	/*! Longest a single hangup took, in microseconds */
+	int64_t max_us;
+};
+
+/*! \brief A thread hanging up its share of the channels */
+struct hangup_storm_thread {
+	struct hangup_storm *storm;
+	pthread_t id;
+	/*! First channel it hangs up */
+	unsigned int first;
+	/*! Longest a single hangup took, in microseconds */
+	int64_t max_us;
+};
+
+static struct ast_channel *hangup_storm_channel_alloc(unsigned int index)
+{
+	struct ast_channel *chan;
+	char name[32];
+	char value[32];
+	int i;
+
+	chan = ast_channel_alloc(0, AST_STATE_UP, "100", "Storm", "100", "100",
+		"default", NULL, NULL, 0, CHANNEL_TECH_NAME "/storm-%u", index);
+	if (!chan) {
+		return NULL;
+	}
+
+	ast_channel_nativeformats_set(chan, test_hangup_chan_tech.capabilities);
+	ast_channel_set_rawwriteformat(chan, ast_format_slin);
+	ast_channel_set_rawreadformat(chan, ast_format_slin);
+	ast_channel_set_writeformat(chan, ast_format_slin);
+	ast_channel_set_readformat(chan, ast_format_slin);
+	for (i = 0; i < STORM_VARIABLES; i++) {
+		snprintf(name, sizeof(name), "STORM_%d", i);
+		snprintf(value, sizeof(value), "%u-%d", index, i);
+		pbx_builtin_setvar_helper(chan, name, value);
+	}
+	ast_channel_unlock(chan);
+
+	return chan;
+}
+
+static void *hangup_storm_thread(void *data)
+{
+	struct hangup_storm_thread *thread = data;
+	struct hangup_storm *storm = thread->storm;
+	struct timeval start;
+	int64_t us;
+	unsigned int i;
+
+	ast_mutex_lock(&storm->lock);
+	while (!storm->started) {
+		ast_cond_wait(&storm->cond, &storm->lock);
+	}
+	ast_mutex_unlock(&storm->lock);
+
+	for (i = thread->first; i < storm->count; i += storm->threads) {
+		start = ast_tvnow();
+		ast_hangup(storm->chans[i]);
+		us = ast_tvdiff_us(ast_tvnow(), start);
+		if (us > thread->max_us) {
+			thread->max_us = us;
+		}
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Hang up all the channels of a storm from its threads at once.
+ *
+ * \return Microseconds until the last thread was done
+ * \retval -1 on failure
+ */
+static int64_t hangup_storm_run(struct hangup_storm *storm)
+{
+	struct hangup_storm_thread *threads;
+	struct timeval start;
+	unsigned int launched;
+	unsigned int i;
+	int64_t us;
+
+	threads = ast_calloc(storm->threads, sizeof(*threads));
+	if (!threads) {
+		return -1;
+	}
+
+	for (launched = 0; launched < storm->threads; launched++) {
+		threads[launched].storm = storm;
+		threads[launched].first = launched;
+		if (ast_pthread_create(&threads[launched].id, NULL, hangup_storm_thread, &threads[launched])) {
+			break;
+		}
+	}
+
+	/* Hang up what a thread that failed to start would have */
+	for (i = launched; i < storm->threads; i++) {
+		threads[i].storm = storm;
+		threads[i].first = i;
+	}
+
+	start = ast_tvnow();
+	ast_mutex_lock(&storm->lock);
+	storm->started = 1;
+	ast_cond_broadcast(&storm->cond);
+	ast_mutex_unlock(&storm->lock);
+
+	for (i = launched; i < storm->threads; i++) {
+		hangup_storm_thread(&threads[i]);
+	}
+	for (i = 0; i < launched; i++) {
+		pthread_join(threads[i].id, NULL);
+	}
+	us = ast_tvdiff_us(ast_tvnow(), start);
+
+	for (i = 0; i < storm->threads; i++) {
+		if (threads[i].max_us > storm->max_us) {
+			storm->max_us = threads[i].max_us;
+		}
+	}
+	ast_free(threads);
+
+	return us;
+}
+
+/*!
+ * \internal
+ * \brief Allocate, hang up and report on one storm.
+ */
+static enum ast_test_result_state hangup_storm_test(struct ast_test *test,
+	unsigned int count, unsigned int threads)
+{
+	struct hangup_storm storm = {
+		.count = count,
+		.threads = threads,
+	};
+	struct ast_channel *chan;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	char name[64];
+	unsigned int allocated;
+	int64_t us;
+
+	storm.chans = ast_calloc(count, sizeof(*storm.chans));
+	if (!storm.chans) {
+		return AST_TEST_FAIL;
+	}
+	ast_mutex_init(&storm.lock);
+	ast_cond_init(&storm.cond, NULL);
+
+	for (allocated = 0; allocated < count; allocated++) {
+		storm.chans[allocated] = hangup_storm_channel_alloc(allocated);
+		if (!storm.chans[allocated]) {
+			break;
+		}
+	}
+
+	if (allocated < count) {
+		ast_test_status_update(test, "Failed to allocate channel %u\n", allocated);
+		storm.count = allocated;
+		res = AST_TEST_FAIL;
+	}
+
+	us = hangup_storm_run(&storm);
+	if (us < 0) {
+		ast_test_status_update(test, "Failed to start the hangup threads\n");
+		res = AST_TEST_FAIL;
+	} else if (res == AST_TEST_PASS) {
+		ast_test_status_update(test, "%u channels, %u threads: %" PRId64 " us, "
+			"%" PRId64 " us per hangup, longest hangup %" PRId64 " us\n",
+			count, threads, us, us / count, storm.max_us);
+	}
+
+	/* Hung up channels must be gone from the container */
+	if (us >= 0 && storm.count) {
+		snprintf(name, sizeof(name), CHANNEL_TECH_NAME "/storm-%u", storm.count - 1);
+		chan = ast_channel_get_by_name(name);
+		if (chan) {
+			ast_test_status_update(test, "Channel %s still found after hangup\n", name);
+			ast_channel_unref(chan);
+			res = AST_TEST_FAIL;
+		}
+	} else if (us < 0) {
+		for (allocated = 0; allocated < storm.count; allocated++) {
+			ast_hangup(storm.chans[allocated]);
+		}
+	}
+
+	ast_mutex_destroy(&storm.lock);
+	ast_cond_destroy(&storm.cond);
+	ast_free(storm.chans);
+
+	return res;
+}
+
+AST_TEST_DEFINE(hangup_storm)
+{
+	static const unsigned int counts[] = { 1000, 10000, };
+	static const unsigned int threads[] = { 1, 8, 32, };
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+	int j;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "hangup_storm";
+		info->category = TEST_CATEGORY;
+		info->summary = "Benchmark many channels hanging up at once";
+		info->description =
+			"Hangs up a thousand and ten thousand channels from one and from "
+			"several threads at once, and reports how long it took overall "
+			"and how long the longest single hangup took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(counts) && res == AST_TEST_PASS; i++) {
+		for (j = 0; j < ARRAY_LEN(threads) && res == AST_TEST_PASS; j++) {
+			res = hangup_storm_test(test, counts[i], threads[j]);
+		}
+	}
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(hangup_storm);
+
+	ast_channel_unregister(&test_hangup_chan_tech);
+	ao2_cleanup(test_hangup_chan_tech.capabilities);
+	test_hangup_chan_tech.capabilities = NULL;
+
+	return 0;
+}
+
+static int load_module(void)
+{
+	test_hangup_chan_tech.capabilities = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!test_hangup_chan_tech.capabilities) {
+		return AST_MODULE_LOAD_FAILURE;
+	}
+	ast_format_cap_append(test_hangup_chan_tech.capabilities, ast_format_slin, 0);
+	ast_channel_register(&test_hangup_chan_tech);
+
+	AST_TEST_REGISTER(hangup_storm);
+
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Channel Hangup Storm Tests");
@@ -204,6 +204,93 @@ AST_TEST_DEFINE(gettree_deltree)
 	return res;
 }
 
+/*! \brief Count the entries of an ast_db_gettree() result with a given key and value */
+static int count_entries(struct ast_db_entry *dbes, const char *key, const char *value)
+{
+	struct ast_db_entry *cur;
+	int count = 0;
+
+	for (cur = dbes; cur; cur = cur->next) {
+		if ((!key || !strcmp(cur->key, key)) && (!value || !strcmp(cur->data, value))) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+AST_TEST_DEFINE(gettree_cached)
+{
+	int res = AST_TEST_PASS;
+	struct ast_db_entry *dbes;
+	char buf[16];
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "gettree_cached";
+		info->category = "/main/astdb/";
+		info->summary = "astdb cache consistency unit test";
+		info->description =
+			"Ensures that changes made after a family has been read whole\n"
+			"are seen by later gets and gettrees";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_db_deltree("astdbtest", NULL);
+	ast_db_put("astdbtest", "a", "1");
+	ast_db_put("astdbtest", "b", "2");
+
+	dbes = ast_db_gettree("astdbtest", NULL);
+	if (count_entries(dbes, NULL, NULL) != 2) {
+		ast_test_status_update(test, "Expected 2 entries in astdbtest, got %d\n", count_entries(dbes, NULL, NULL));
+		res = AST_TEST_FAIL;
+	}
+	ast_db_freetree(dbes);
+
+	ast_db_put("astdbtest", "c", "3");
+	ast_db_put("astdbtest", "b", "4");
+	ast_db_del("astdbtest", "a");
+
+	if (!ast_db_get("astdbtest", "a", buf, sizeof(buf))) {
+		ast_test_status_update(test, "Got deleted key astdbtest/a\n");
+		res = AST_TEST_FAIL;
+	}
+	if (ast_db_get("astdbtest", "b", buf, sizeof(buf)) || strcmp(buf, "4")) {
+		ast_test_status_update(test, "Failed to get the latest value of astdbtest/b\n");
+		res = AST_TEST_FAIL;
+	}
+
+	dbes = ast_db_gettree("astdbtest", NULL);
+	if (count_entries(dbes, NULL, NULL) != 2
+		|| count_entries(dbes, "/astdbtest/b", "4") != 1
+		|| count_entries(dbes, "/astdbtest/c", "3") != 1) {
+		ast_test_status_update(test, "Family astdbtest does not reflect the puts and dels made after reading it\n");
+		res = AST_TEST_FAIL;
+	}
+	ast_db_freetree(dbes);
+
+	if (ast_db_deltree("astdbtest", "b") != 1) {
+		ast_test_status_update(test, "Failed to deltree astdbtest/b\n");
+		res = AST_TEST_FAIL;
+	}
+
+	dbes = ast_db_gettree("astdbtest", NULL);
+	if (count_entries(dbes, NULL, NULL) != 1 || count_entries(dbes, "/astdbtest/c", "3") != 1) {
+		ast_test_status_update(test, "Family astdbtest does not reflect the deltree made after reading it\n");
+		res = AST_TEST_FAIL;
+	}
+	ast_db_freetree(dbes);
+
+	if (ast_db_deltree("astdbtest", NULL) != 1) {
+		ast_test_status_update(test, "Failed to deltree astdbtest\n");
+		res = AST_TEST_FAIL;
+	}
+
+	return res;
+}
+
 AST_TEST_DEFINE(perftest)
 {
 	int res = AST_TEST_PASS;
@@ -292,6 +379,7 @@ static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(put_get_del);
 	AST_TEST_UNREGISTER(gettree_deltree);
+	AST_TEST_UNREGISTER(gettree_cached);
 	AST_TEST_UNREGISTER(perftest);
 	AST_TEST_UNREGISTER(put_get_long);
 	return 0;
@@ -301,6 +389,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(put_get_del);
 	AST_TEST_REGISTER(gettree_deltree);
+	AST_TEST_REGISTER(gettree_cached);
 	AST_TEST_REGISTER(perftest);
 	AST_TEST_REGISTER(put_get_long);
 	return AST_MODULE_LOAD_SUCCESS;
@@ -31,6 +31,7 @@
 #include "asterisk/dns_core.h"
 #include "asterisk/dns_resolver.h"
 #include "asterisk/dns_internal.h"
+#include "asterisk/options.h"
 
 /* Used when a stub is needed for certain tests */
 static int stub_resolve(struct ast_dns_query *query)
@@ -1296,6 +1297,144 @@ cleanup:
 	return res;
 }
 
+/*! \brief Number of times the caching test resolver was asked to resolve */
+static int cache_resolve_calls;
+
+/*!
+ * \brief Thread spawned by the caching test resolver
+ *
+ * Waits a little, so that queries made meanwhile are still in flight, and
+ * then returns an A record that may be cached for five minutes.
+ */
+static void *cache_resolution_thread(void *dns_query)
+{
+	struct ast_dns_query *query = dns_query;
+	char v4_buf[sizeof(struct in_addr)];
+
+	usleep(100000);
+
+	ast_dns_resolver_set_result(query, 0, 0, NOERROR, "asterisk.org", DNS_ANSWER, DNS_ANSWER_SIZE);
+	inet_pton(AF_INET, "127.0.0.1", v4_buf);
+	ast_dns_resolver_add_record(query, T_A, C_IN, 300, v4_buf, sizeof(v4_buf));
+	ast_dns_resolver_completed(query);
+
+	ao2_ref(query, -1);
+	return NULL;
+}
+
+static int cache_resolve(struct ast_dns_query *query)
+{
+	pthread_t resolver_thread;
+
+	ast_atomic_fetchadd_int(&cache_resolve_calls, +1);
+	return ast_pthread_create_detached(&resolver_thread, NULL, cache_resolution_thread, ao2_bump(query));
+}
+
+static struct ast_dns_resolver cache_resolver = {
+	.name = "cache_test",
+	.priority = 0,
+	.resolve = cache_resolve,
+	.cancel = stub_cancel,
+};
+
+AST_TEST_DEFINE(resolver_cache)
+{
+	RAII_VAR(struct async_resolution_data *, first_data, NULL, ao2_cleanup);
+	RAII_VAR(struct async_resolution_data *, second_data, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_dns_query_active *, first, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_dns_query_active *, second, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_dns_result *, result, NULL, ast_dns_result_free);
+	unsigned int cache_size = ast_option_dns_cache_size;
+	enum ast_test_result_state res = AST_TEST_PASS;
+	struct async_resolution_data *async_data;
+	struct timespec timeout;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "resolver_cache";
+		info->category = "/main/dns/";
+		info->summary = "Test the DNS result cache";
+		info->description =
+			"This test makes two asynchronous queries for the same name at the same time\n"
+			"and then a synchronous one with the DNS cache enabled. The resolver should\n"
+			"only be called once, and every query should get the record it returned.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	first_data = async_data_alloc();
+	second_data = async_data_alloc();
+	if (!first_data || !second_data) {
+		ast_test_status_update(test, "Failed to allocate asynchronous data\n");
+		return AST_TEST_FAIL;
+	}
+
+	/* Registering the resolver empties the cache. */
+	ast_option_dns_cache_size = 16;
+	cache_resolve_calls = 0;
+	if (ast_dns_resolver_register(&cache_resolver)) {
+		ast_test_status_update(test, "Unable to register caching test resolver\n");
+		ast_option_dns_cache_size = cache_size;
+		return AST_TEST_FAIL;
+	}
+
+	first = ast_dns_resolve_async("asterisk.org", T_A, C_IN, async_callback, first_data);
+	second = ast_dns_resolve_async("asterisk.org", T_A, C_IN, async_callback, second_data);
+	if (!first || !second) {
+		ast_test_status_update(test, "Asynchronous resolution of address failed\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	timeout = ast_tsnow();
+	timeout.tv_sec += 10;
+	for (i = 0; i < 2; ++i) {
+		async_data = i ? second_data : first_data;
+		ast_mutex_lock(&async_data->lock);
+		while (!async_data->complete) {
+			if (ast_cond_timedwait(&async_data->cond, &async_data->lock, &timeout) == ETIMEDOUT) {
+				break;
+			}
+		}
+		ast_mutex_unlock(&async_data->lock);
+
+		if (!async_data->complete) {
+			ast_test_status_update(test, "Asynchronous resolution timed out\n");
+			res = AST_TEST_FAIL;
+			goto cleanup;
+		}
+	}
+
+	if (!ast_dns_query_get_result(first->query)
+		|| !ast_dns_result_get_records(ast_dns_query_get_result(first->query))
+		|| !ast_dns_query_get_result(second->query)
+		|| !ast_dns_result_get_records(ast_dns_query_get_result(second->query))) {
+		ast_test_status_update(test, "Asynchronous resolution yielded no records\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (ast_dns_resolve("asterisk.org", T_A, C_IN, &result) || !result
+		|| !ast_dns_result_get_records(result)) {
+		ast_test_status_update(test, "Synchronous resolution from the cache yielded no records\n");
+		res = AST_TEST_FAIL;
+		goto cleanup;
+	}
+
+	if (cache_resolve_calls != 1) {
+		ast_test_status_update(test, "Resolver was called %d times instead of once\n",
+			cache_resolve_calls);
+		res = AST_TEST_FAIL;
+	}
+
+cleanup:
+	ast_dns_resolver_unregister(&cache_resolver);
+	ast_option_dns_cache_size = cache_size;
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(resolver_register_unregister);
@@ -1311,6 +1450,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(resolver_resolve_async);
 	AST_TEST_UNREGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_UNREGISTER(resolver_resolve_async_cancel);
+	AST_TEST_UNREGISTER(resolver_cache);
 
 	return 0;
 }
@@ -1330,6 +1470,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(resolver_resolve_async);
 	AST_TEST_REGISTER(resolver_resolve_async_off_nominal);
 	AST_TEST_REGISTER(resolver_resolve_async_cancel);
+	AST_TEST_REGISTER(resolver_cache);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -36,6 +36,7 @@
 #include "asterisk/codec.h"
 #include "asterisk/frame.h"
 #include "asterisk/format.h"
+#include "asterisk/format_cache.h"
 #include "asterisk/format_cap.h"
 
 AST_TEST_DEFINE(format_cap_alloc)
@@ -1067,6 +1068,67 @@ AST_TEST_DEFINE(format_cap_iscompatible)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(format_cap_iscompatible_remove)
+{
+	RAII_VAR(struct ast_format_cap *, caps1, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_format_cap *, caps2, NULL, ao2_cleanup);
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "format_cap_iscompatible_remove";
+		info->category = "/main/format_cap/";
+		info->summary = "format capabilities negotiation after removal unit test";
+		info->description =
+			"Test that capabilities structures are no longer compatible once their common formats are removed";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	caps1 = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	caps2 = ast_format_cap_alloc(AST_FORMAT_CAP_FLAG_DEFAULT);
+	if (!caps1 || !caps2) {
+		ast_test_status_update(test, "Could not allocate an empty format capabilities structure\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_format_cap_append(caps1, ast_format_ulaw, 0) || ast_format_cap_append(caps1, ast_format_h264, 0)) {
+		ast_test_status_update(test, "Could not add formats to first capabilities structure\n");
+		return AST_TEST_FAIL;
+	} else if (ast_format_cap_append(caps2, ast_format_alaw, 0) || ast_format_cap_append(caps2, ast_format_h264, 0)) {
+		ast_test_status_update(test, "Could not add formats to second capabilities structure\n");
+		return AST_TEST_FAIL;
+	} else if (!ast_format_cap_iscompatible(caps1, caps2)) {
+		ast_test_status_update(test, "Capability structures sharing h264 are not compatible\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_format_cap_remove_by_type(caps2, AST_MEDIA_TYPE_VIDEO);
+	if (ast_format_cap_iscompatible(caps1, caps2)) {
+		ast_test_status_update(test, "Capability structures are compatible after removing video\n");
+		return AST_TEST_FAIL;
+	} else if (ast_format_cap_has_type(caps2, AST_MEDIA_TYPE_VIDEO)) {
+		ast_test_status_update(test, "Capability structure has video after removing video\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_format_cap_append(caps2, ast_format_ulaw, 0)) {
+		ast_test_status_update(test, "Could not add ulaw to second capabilities structure\n");
+		return AST_TEST_FAIL;
+	} else if (!ast_format_cap_iscompatible(caps1, caps2)) {
+		ast_test_status_update(test, "Capability structures sharing ulaw are not compatible\n");
+		return AST_TEST_FAIL;
+	} else if (ast_format_cap_remove(caps1, ast_format_ulaw)) {
+		ast_test_status_update(test, "Could not remove ulaw from first capabilities structure\n");
+		return AST_TEST_FAIL;
+	} else if (ast_format_cap_iscompatible(caps1, caps2)) {
+		ast_test_status_update(test, "Capability structures are compatible after removing ulaw\n");
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(format_cap_get_names)
 {
 	RAII_VAR(struct ast_format_cap *, empty_caps, NULL, ao2_cleanup);
@@ -1442,6 +1504,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(format_cap_iscompatible_format);
 	AST_TEST_UNREGISTER(format_cap_get_compatible);
 	AST_TEST_UNREGISTER(format_cap_iscompatible);
+	AST_TEST_UNREGISTER(format_cap_iscompatible_remove);
 	AST_TEST_UNREGISTER(format_cap_best_by_type);
 	AST_TEST_UNREGISTER(format_cap_replace_from_cap);
 	return 0;
@@ -1467,6 +1530,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(format_cap_iscompatible_format);
 	AST_TEST_REGISTER(format_cap_get_compatible);
 	AST_TEST_REGISTER(format_cap_iscompatible);
+	AST_TEST_REGISTER(format_cap_iscompatible_remove);
 	AST_TEST_REGISTER(format_cap_best_by_type);
 	AST_TEST_REGISTER(format_cap_replace_from_cap);
 	ast_codec_register(&test_law);
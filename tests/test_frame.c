@@ -0,0 +1,302 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Frame allocation unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/frame.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/utils.h"
+
+/*! Frames handed between threads by the cross thread test */
+#define TEST_FRAMES 256
+
+/*! Payload sizes covering every slab size class and one past the largest */
+static const int test_payloads[] = { 0, 1, 160, 161, 320, 640, 1920, 1921, 4000 };
+
+static void test_frame_fill(struct ast_frame *f, unsigned char *payload, int datalen)
+{
+	int i;
+
+	for (i = 0; i < datalen; i++) {
+		payload[i] = (unsigned char) (i * 7 + datalen);
+	}
+
+	memset(f, 0, sizeof(*f));
+	f->frametype = AST_FRAME_VOICE;
+	f->subclass.format = ast_format_slin;
+	f->datalen = datalen;
+	f->samples = datalen / 2;
+	f->data.ptr = datalen ? payload : NULL;
+	f->src = "test_frame";
+}
+
+static int test_frame_check(struct ast_test *test, const struct ast_frame *orig, const struct ast_frame *copy)
+{
+	if (!copy) {
+		ast_test_status_update(test, "Failed to copy a frame with %d bytes of payload\n", orig->datalen);
+		return -1;
+	}
+	if (copy->datalen != orig->datalen || copy->samples != orig->samples
+		|| copy->subclass.format != orig->subclass.format) {
+		ast_test_status_update(test, "Copied frame header differs with %d bytes of payload\n", orig->datalen);
+		return -1;
+	}
+	if (copy->datalen && memcmp(copy->data.ptr, orig->data.ptr, copy->datalen)) {
+		ast_test_status_update(test, "Copied frame payload differs with %d bytes of payload\n", orig->datalen);
+		return -1;
+	}
+	if (!copy->src || strcmp(copy->src, orig->src)) {
+		ast_test_status_update(test, "Copied frame src differs with %d bytes of payload\n", orig->datalen);
+		return -1;
+	}
+	if (copy->datalen && copy->offset < AST_FRIENDLY_OFFSET) {
+		ast_test_status_update(test, "Copied frame has only %d bytes of offset\n", copy->offset);
+		return -1;
+	}
+	return 0;
+}
+
+AST_TEST_DEFINE(frame_dup_isolate)
+{
+	unsigned char payload[4000];
+	struct ast_frame orig;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "dup_isolate";
+		info->category = "/main/frame/";
+		info->summary = "Test duplicating and isolating frames";
+		info->description =
+			"Duplicates and isolates frames with payloads inside and outside\n"
+			"of every allocator size class, then checks the copies.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(test_payloads); i++) {
+		struct ast_frame *dup;
+		struct ast_frame *isolated;
+		int res;
+
+		test_frame_fill(&orig, payload, test_payloads[i]);
+
+		dup = ast_frdup(&orig);
+		if (test_frame_check(test, &orig, dup)) {
+			ast_frfree(dup);
+			return AST_TEST_FAIL;
+		}
+
+		if (!(isolated = ast_frisolate(&orig))) {
+			ast_test_status_update(test, "Failed to isolate a frame with %d bytes of payload\n",
+				orig.datalen);
+			ast_frfree(dup);
+			return AST_TEST_FAIL;
+		}
+		res = test_frame_check(test, &orig, isolated);
+		ast_frfree(isolated);
+
+		/* Isolating a frame which is already a heap copy must keep it usable. */
+		if (!res && (isolated = ast_frisolate(dup))) {
+			res = test_frame_check(test, &orig, isolated);
+			ast_frfree(isolated);
+		} else {
+			ast_frfree(dup);
+		}
+		if (res) {
+			return AST_TEST_FAIL;
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+AST_TEST_DEFINE(frame_shared_payload)
+{
+	unsigned char payload[320];
+	struct ast_frame orig;
+	struct ast_frame *shared;
+	struct ast_frame *ref;
+	struct ast_frame *isolated;
+	enum ast_test_result_state res = AST_TEST_FAIL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "shared_payload";
+		info->category = "/main/frame/";
+		info->summary = "Test frames sharing a reference counted payload";
+		info->description =
+			"Shares a payload between frames, then checks that references do not\n"
+			"copy it and that making one frame writable leaves the others alone.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	test_frame_fill(&orig, payload, sizeof(payload));
+
+	shared = ast_frdup_shared(&orig);
+	if (!shared) {
+		ast_test_status_update(test, "Failed to share a frame payload\n");
+		return AST_TEST_FAIL;
+	}
+	ref = ast_frdup_shared(shared);
+	if (!ref) {
+		ast_test_status_update(test, "Failed to reference a shared frame payload\n");
+		ast_frfree(shared);
+		return AST_TEST_FAIL;
+	}
+
+	if (!(shared->mallocd & AST_MALLOCD_SHARED) || shared->offset
+		|| shared->datalen != orig.datalen || memcmp(shared->data.ptr, payload, sizeof(payload))
+		|| !shared->src || strcmp(shared->src, orig.src)) {
+		ast_test_status_update(test, "Shared frame does not match the original\n");
+		goto cleanup;
+	}
+	if (ref->data.ptr != shared->data.ptr) {
+		ast_test_status_update(test, "Referencing a shared frame copied its payload\n");
+		goto cleanup;
+	}
+
+	/* Isolating a shared frame keeps the payload it references. */
+	isolated = ast_frisolate(ref);
+	if (!isolated || isolated->data.ptr != shared->data.ptr
+		|| !(isolated->mallocd & AST_MALLOCD_SHARED)) {
+		ast_test_status_update(test, "Isolating a shared frame lost its payload\n");
+		ref = isolated;
+		goto cleanup;
+	}
+	ref = isolated;
+
+	if (ast_frame_make_writable(ref)) {
+		ast_test_status_update(test, "Failed to make a shared frame writable\n");
+		goto cleanup;
+	}
+	if (ref->data.ptr == shared->data.ptr || (ref->mallocd & AST_MALLOCD_SHARED)
+		|| ref->offset < AST_FRIENDLY_OFFSET || memcmp(ref->data.ptr, payload, sizeof(payload))) {
+		ast_test_status_update(test, "Writable frame still shares its payload\n");
+		goto cleanup;
+	}
+
+	memset(ref->data.ptr, 0, ref->datalen);
+	if (memcmp(shared->data.ptr, payload, sizeof(payload))) {
+		ast_test_status_update(test, "Modifying a writable frame changed the shared payload\n");
+		goto cleanup;
+	}
+
+	res = AST_TEST_PASS;
+
+cleanup:
+	ast_frfree(shared);
+	if (ref) {
+		ast_frfree(ref);
+	}
+	return res;
+}
+
+struct test_frame_batch {
+	/*! Frames allocated by the test thread for the freeing thread */
+	struct ast_frame *frames[TEST_FRAMES];
+};
+
+static void *test_frame_free_thread(void *data)
+{
+	struct test_frame_batch *batch = data;
+	int i;
+
+	for (i = 0; i < TEST_FRAMES; i++) {
+		ast_frfree(batch->frames[i]);
+	}
+
+	return NULL;
+}
+
+AST_TEST_DEFINE(frame_cross_thread_free)
+{
+	unsigned char payload[4000];
+	struct test_frame_batch batch;
+	struct ast_frame orig;
+	int round;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "cross_thread_free";
+		info->category = "/main/frame/";
+		info->summary = "Test freeing frames on a different thread";
+		info->description =
+			"Allocates frames on one thread and frees them on another several\n"
+			"times over, so freed blocks are handed back to the allocating thread.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (round = 0; round < 8; round++) {
+		pthread_t thread;
+		int i;
+
+		for (i = 0; i < TEST_FRAMES; i++) {
+			test_frame_fill(&orig, payload, test_payloads[i % ARRAY_LEN(test_payloads)]);
+			batch.frames[i] = ast_frdup(&orig);
+			if (test_frame_check(test, &orig, batch.frames[i])) {
+				while (i >= 0) {
+					ast_frfree(batch.frames[i--]);
+				}
+				return AST_TEST_FAIL;
+			}
+		}
+
+		if (ast_pthread_create(&thread, NULL, test_frame_free_thread, &batch)) {
+			ast_test_status_update(test, "Failed to start the freeing thread\n");
+			test_frame_free_thread(&batch);
+			return AST_TEST_FAIL;
+		}
+		pthread_join(thread, NULL);
+	}
+
+	return AST_TEST_PASS;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(frame_dup_isolate);
+	AST_TEST_UNREGISTER(frame_cross_thread_free);
+	AST_TEST_UNREGISTER(frame_shared_payload);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(frame_dup_isolate);
+	AST_TEST_REGISTER(frame_cross_thread_free);
+	AST_TEST_REGISTER(frame_shared_payload);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Frame allocation test module");
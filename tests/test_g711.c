@@ -0,0 +1,191 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief G.711 bulk conversion unit tests
+ *
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/ulaw.h"
+#include "asterisk/alaw.h"
+
+/*! \brief Every signed linear value, plus an odd tail to exercise the scalar remainder */
+#define LINEAR_SAMPLES (65536 + 7)
+
+/*! \brief Every G.711 byte, plus an odd tail */
+#define LAW_SAMPLES (256 + 5)
+
+static void fill_linear(int16_t *linear)
+{
+	int i;
+
+	for (i = 0; i < LINEAR_SAMPLES; i++) {
+		linear[i] = i - 32768;
+	}
+}
+
+static void fill_law(unsigned char *law)
+{
+	int i;
+
+	for (i = 0; i < LAW_SAMPLES; i++) {
+		law[i] = i;
+	}
+}
+
+AST_TEST_DEFINE(ulaw_bulk)
+{
+	int16_t *linear;
+	unsigned char *encoded;
+	unsigned char law[LAW_SAMPLES];
+	int16_t decoded[LAW_SAMPLES];
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "ulaw_bulk";
+		info->category = "/main/g711/";
+		info->summary = "mu-law bulk conversion";
+		info->description =
+			"Check ast_ulaw_encode() and ast_ulaw_decode() against the mu-law tables.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	linear = ast_malloc(LINEAR_SAMPLES * sizeof(*linear));
+	encoded = ast_malloc(LINEAR_SAMPLES);
+	if (!linear || !encoded) {
+		ast_free(linear);
+		ast_free(encoded);
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "Using the %s kernel\n", ast_ulaw_kernel_name());
+
+	fill_linear(linear);
+	ast_ulaw_encode(encoded, linear, LINEAR_SAMPLES);
+	for (i = 0; i < LINEAR_SAMPLES; i++) {
+		if (encoded[i] != AST_LIN2MU(linear[i])) {
+			ast_test_status_update(test, "Encoded %d as 0x%02x, expected 0x%02x\n",
+				linear[i], encoded[i], AST_LIN2MU(linear[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+	fill_law(law);
+	ast_ulaw_decode(decoded, law, LAW_SAMPLES);
+	for (i = 0; i < LAW_SAMPLES; i++) {
+		if (decoded[i] != AST_MULAW(law[i])) {
+			ast_test_status_update(test, "Decoded 0x%02x as %d, expected %d\n",
+				law[i], decoded[i], AST_MULAW(law[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+	ast_free(linear);
+	ast_free(encoded);
+
+	return res;
+}
+
+AST_TEST_DEFINE(alaw_bulk)
+{
+	int16_t *linear;
+	unsigned char *encoded;
+	unsigned char law[LAW_SAMPLES];
+	int16_t decoded[LAW_SAMPLES];
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "alaw_bulk";
+		info->category = "/main/g711/";
+		info->summary = "a-law bulk conversion";
+		info->description =
+			"Check ast_alaw_encode() and ast_alaw_decode() against the a-law tables.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	linear = ast_malloc(LINEAR_SAMPLES * sizeof(*linear));
+	encoded = ast_malloc(LINEAR_SAMPLES);
+	if (!linear || !encoded) {
+		ast_free(linear);
+		ast_free(encoded);
+		return AST_TEST_FAIL;
+	}
+
+	ast_test_status_update(test, "Using the %s kernel\n", ast_alaw_kernel_name());
+
+	fill_linear(linear);
+	ast_alaw_encode(encoded, linear, LINEAR_SAMPLES);
+	for (i = 0; i < LINEAR_SAMPLES; i++) {
+		if (encoded[i] != AST_LIN2A(linear[i])) {
+			ast_test_status_update(test, "Encoded %d as 0x%02x, expected 0x%02x\n",
+				linear[i], encoded[i], AST_LIN2A(linear[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+	fill_law(law);
+	ast_alaw_decode(decoded, law, LAW_SAMPLES);
+	for (i = 0; i < LAW_SAMPLES; i++) {
+		if (decoded[i] != AST_ALAW(law[i])) {
+			ast_test_status_update(test, "Decoded 0x%02x as %d, expected %d\n",
+				law[i], decoded[i], AST_ALAW(law[i]));
+			res = AST_TEST_FAIL;
+			break;
+		}
+	}
+
+	ast_free(linear);
+	ast_free(encoded);
+
+	return res;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(ulaw_bulk);
+	AST_TEST_UNREGISTER(alaw_bulk);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(ulaw_bulk);
+	AST_TEST_REGISTER(alaw_bulk);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "G.711 bulk conversion test module");
@@ -54,6 +54,13 @@ static int node_cmp(void *_n1, void *_n2)
 	}
 }
 
+static int64_t node_key(void *_n)
+{
+	struct node *n = _n;
+
+	return n->val;
+}
+
 AST_TEST_DEFINE(heap_test_1)
 {
 	struct ast_heap *h;
@@ -285,11 +292,208 @@ return_cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(heap_test_keyed)
+{
+	struct ast_heap *h = NULL;
+	struct node *nodes = NULL;
+	struct node *node;
+	static const unsigned int test_size = 100000;
+	unsigned int i = test_size;
+	long last = LONG_MAX, cur;
+	int random_index;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "heap_test_keyed";
+		info->category = "/main/heap/";
+		info->summary = "keyed heap test";
+		info->description =
+			"Push a hundred thousand random elements with many equal "
+			"keys on to a keyed heap, verify that the heap has been "
+			"properly constructed, randomly remove and re-add 10000 "
+			"elements, and then ensure that the elements come back off "
+			"in the proper order.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(nodes = ast_malloc(test_size * sizeof(*node)))) {
+		ast_test_status_update(test, "memory allocation failure\n");
+		res = AST_TEST_FAIL;
+		goto return_cleanup;
+	}
+
+	/* Start small so the heap has to grow */
+	if (!(h = ast_heap_create_keyed(2, node_key, NULL, offsetof(struct node, index)))) {
+		ast_test_status_update(test, "Failed to allocate heap\n");
+		res = AST_TEST_FAIL;
+		goto return_cleanup;
+	}
+
+	while (i--) {
+		nodes[i].val = ast_random() % 1000;
+		ast_heap_push(h, &nodes[i]);
+	}
+
+	if (ast_heap_verify(h)) {
+		ast_test_status_update(test, "Failed to verify heap after populating it\n");
+		res = AST_TEST_FAIL;
+		goto return_cleanup;
+	}
+
+	i = test_size / 10;
+	while (i--) {
+		random_index = ast_random() % test_size;
+		node = ast_heap_remove(h, &nodes[random_index]);
+		if (node != &nodes[random_index]) {
+			ast_test_status_update(test, "Failed to remove what we expected to\n");
+			res = AST_TEST_FAIL;
+			goto return_cleanup;
+		}
+		nodes[random_index].val = ast_random() % 1000;
+		ast_heap_push(h, &nodes[random_index]);
+	}
+
+	if (ast_heap_verify(h)) {
+		ast_test_status_update(test, "Failed to verify after removals\n");
+		res = AST_TEST_FAIL;
+		goto return_cleanup;
+	}
+
+	i = 0;
+	while ((node = ast_heap_pop(h))) {
+		cur = node->val;
+		if (cur > last) {
+			ast_test_status_update(test, "i: %u, cur: %ld, last: %ld\n", i, cur, last);
+			res = AST_TEST_FAIL;
+			goto return_cleanup;
+		}
+		last = cur;
+		i++;
+	}
+
+	if (i != test_size) {
+		ast_test_status_update(test, "Stopped popping off after only getting %u nodes\n", i);
+		res = AST_TEST_FAIL;
+		goto return_cleanup;
+	}
+
+return_cleanup:
+	if (h) {
+		h = ast_heap_destroy(h);
+	}
+	if (nodes) {
+		ast_free(nodes);
+	}
+
+	return res;
+}
+
+/*!
+ * \internal
+ * \brief Time scheduler-like use of a heap: a steady size with each popped
+ * element pushed back with a later value.
+ *
+ * \return microseconds taken, or -1 on failure
+ */
+static int64_t heap_time(struct ast_heap *h, struct node *nodes, unsigned int count,
+	unsigned int rounds)
+{
+	struct timeval start;
+	struct node *node;
+	unsigned int i;
+
+	start = ast_tvnow();
+
+	for (i = 0; i < count; i++) {
+		nodes[i].val = -(long) (ast_random() % count);
+		if (ast_heap_push(h, &nodes[i])) {
+			return -1;
+		}
+	}
+
+	for (i = 0; i < count * rounds; i++) {
+		node = ast_heap_pop(h);
+		node->val -= ast_random() % count;
+		ast_heap_push(h, node);
+	}
+
+	while (ast_heap_pop(h)) {
+	}
+
+	return ast_tvdiff_us(ast_tvnow(), start);
+}
+
+AST_TEST_DEFINE(heap_benchmark)
+{
+	static const unsigned int sizes[] = { 1000, 100000, 1000000, };
+	struct ast_heap *binary;
+	struct ast_heap *keyed;
+	struct node *nodes;
+	int64_t binary_us;
+	int64_t keyed_us;
+	int i;
+	enum ast_test_result_state res = AST_TEST_PASS;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "heap_benchmark";
+		info->category = "/main/heap/";
+		info->summary = "heap benchmark";
+		info->description =
+			"Reports how long binary and keyed heaps of different sizes "
+			"take to pop elements and push them back with a later time, "
+			"as the scheduler does.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(nodes = ast_malloc(sizes[ARRAY_LEN(sizes) - 1] * sizeof(*nodes)))) {
+		ast_test_status_update(test, "memory allocation failure\n");
+		return AST_TEST_FAIL;
+	}
+
+	for (i = 0; i < ARRAY_LEN(sizes) && res == AST_TEST_PASS; i++) {
+		binary = ast_heap_create(8, node_cmp, offsetof(struct node, index));
+		keyed = ast_heap_create_keyed(8, node_key, NULL, offsetof(struct node, index));
+		if (!binary || !keyed) {
+			ast_test_status_update(test, "Failed to allocate heap\n");
+			res = AST_TEST_FAIL;
+		} else {
+			binary_us = heap_time(binary, nodes, sizes[i], 4);
+			keyed_us = heap_time(keyed, nodes, sizes[i], 4);
+			if (binary_us < 0 || keyed_us < 0) {
+				ast_test_status_update(test, "Failed to push on to heap\n");
+				res = AST_TEST_FAIL;
+			} else {
+				ast_test_status_update(test, "%u elements, %u pops and pushes: "
+					"%" PRId64 " us binary, %" PRId64 " us keyed\n",
+					sizes[i], sizes[i] * 4, binary_us, keyed_us);
+			}
+		}
+		if (binary) {
+			ast_heap_destroy(binary);
+		}
+		if (keyed) {
+			ast_heap_destroy(keyed);
+		}
+	}
+
+	ast_free(nodes);
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(heap_test_1);
 	AST_TEST_UNREGISTER(heap_test_2);
 	AST_TEST_UNREGISTER(heap_test_3);
+	AST_TEST_UNREGISTER(heap_test_keyed);
+	AST_TEST_UNREGISTER(heap_benchmark);
 
 	return 0;
 }
@@ -299,6 +503,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(heap_test_1);
 	AST_TEST_REGISTER(heap_test_2);
 	AST_TEST_REGISTER(heap_test_3);
+	AST_TEST_REGISTER(heap_test_keyed);
+	AST_TEST_REGISTER(heap_benchmark);
 
 	return AST_MODULE_LOAD_SUCCESS;
 }
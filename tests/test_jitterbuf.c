@@ -1233,6 +1233,106 @@ cleanup:
 	return result;
 }
 
+/*! \internal Delays put into the jitter buffer by the history statistics test */
+#define HISTORY_TEST_FRAMES (JB_HISTORY_SZ * 3)
+
+static int test_jb_compare_delays(const void *a, const void *b)
+{
+	long da = *(const long *) a;
+	long db = *(const long *) b;
+
+	return da < db ? -1 : da > db;
+}
+
+AST_TEST_DEFINE(jitterbuffer_history_stats)
+{
+	enum ast_test_result_state result = AST_TEST_FAIL;
+	struct jitterbuf *jb = NULL;
+	struct jb_frame frame;
+	struct jb_info jbinfo;
+	struct jb_conf jbconf;
+	long delays[HISTORY_TEST_FRAMES];
+	long sorted[JB_HISTORY_SZ];
+	unsigned int seed = 1;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "jitterbuffer_history_stats";
+		info->category = "/main/jitterbuf/";
+		info->summary = "Tests the jitter and minimum delay kept over the history";
+		info->description = "Voice frames with varying delays are sent to a jitter "
+			"buffer.  After each frame the jitter and minimum delay it reports are "
+			"compared against those found by sorting the delays in the history "
+			"window, before and after the window fills and starts sliding.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	JB_TEST_BEGIN("jitterbuffer_history_stats");
+
+	if (!(jb = jb_new())) {
+		ast_test_status_update(test, "Failed to allocate memory for jitterbuffer\n");
+		goto cleanup;
+	}
+
+	test_jb_populate_config(&jbconf);
+	/* Keep every frame, and never resync, so each delay lands in the history */
+	jbconf.max_jitterbuf = HISTORY_TEST_FRAMES * 20 * 2;
+	jbconf.resync_threshold = -1;
+	if (jb_setconf(jb, &jbconf) != JB_OK) {
+		ast_test_status_update(test, "Failed to set jitterbuffer configuration\n");
+		goto cleanup;
+	}
+
+	for (i = 0; i < HISTORY_TEST_FRAMES; i++) {
+		long ts = (i + 1) * 20;
+		int count = (i + 1 < JB_HISTORY_SZ) ? i + 1 : JB_HISTORY_SZ;
+		int idx = count * JB_HISTORY_DROPPCT / 100;
+
+		/* Mostly small delays with repeats, and the odd spike */
+		seed = seed * 1103515245 + 12345;
+		delays[i] = (seed >> 16) % 40;
+		if (!((seed >> 8) % 25)) {
+			delays[i] += 300;
+		}
+
+		if (jb_put(jb, NULL, JB_TYPE_VOICE, 20, ts, ts + delays[i]) == JB_DROP) {
+			ast_test_status_update(test, "Jitter buffer dropped packet %d\n", i);
+			goto cleanup;
+		}
+
+		if (jb_getinfo(jb, &jbinfo) != JB_OK) {
+			ast_test_status_update(test, "Failed to get jitterbuffer information\n");
+			goto cleanup;
+		}
+
+		memcpy(sorted, delays + i + 1 - count, count * sizeof(sorted[0]));
+		qsort(sorted, count, sizeof(sorted[0]), test_jb_compare_delays);
+		if (idx > JB_HISTORY_MAXBUF_SZ - 1) {
+			idx = JB_HISTORY_MAXBUF_SZ - 1;
+		}
+
+		JB_NUMERIC_TEST(jbinfo.min, sorted[idx]);
+		JB_NUMERIC_TEST(jbinfo.jitter, sorted[count - 1 - idx] - sorted[idx]);
+	}
+
+	result = AST_TEST_PASS;
+
+cleanup:
+	if (jb) {
+		/* No need to do anything - this will put all frames on the 'free' list,
+		 * so jb_destroy will dispose of them */
+		while (jb_getall(jb, &frame) == JB_OK) { }
+		jb_destroy(jb);
+	}
+
+	JB_TEST_END;
+
+	return result;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(jitterbuffer_nominal_voice_frames);
@@ -1247,6 +1347,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(jitterbuffer_overflow_control);
 	AST_TEST_UNREGISTER(jitterbuffer_resynch_voice);
 	AST_TEST_UNREGISTER(jitterbuffer_resynch_control);
+	AST_TEST_UNREGISTER(jitterbuffer_history_stats);
 	return 0;
 }
 
@@ -1276,6 +1377,9 @@ static int load_module(void)
 	AST_TEST_REGISTER(jitterbuffer_resynch_voice);
 	AST_TEST_REGISTER(jitterbuffer_resynch_control);
 
+	/* History statistics */
+	AST_TEST_REGISTER(jitterbuffer_history_stats);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -1699,6 +1699,55 @@ AST_TEST_DEFINE(json_test_cep)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(json_test_arena)
+{
+	RAII_VAR(struct ast_json *, uut, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, kept, NULL, ast_json_unref);
+	struct ast_json_arena *arena;
+	struct ast_json_arena *nested;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "arena";
+		info->category = CATEGORY;
+		info->summary = "Testing JSON carved from an arena.";
+		info->description = "Test JSON abstraction library.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	arena = ast_json_arena_begin();
+	ast_test_validate(test, NULL != arena);
+
+	uut = ast_json_pack("{s: s, s: i, s: [i, i]}",
+		"name", "arena", "value", 1, "list", 2, 3);
+	ast_test_validate(test, NULL != uut);
+
+	nested = ast_json_arena_begin();
+	ast_test_validate(test, NULL != nested);
+	ast_test_validate(test, 0 == ast_json_object_set(uut, "nested",
+		ast_json_string_create("nested")));
+	ast_json_arena_end(nested);
+
+	ast_json_arena_end(arena);
+
+	/* Values outlive the arena they were carved from. */
+	ast_test_validate(test, 0 == ast_json_object_set(uut, "after",
+		ast_json_string_create("after")));
+	ast_test_validate(test, 3 == ast_json_integer_get(
+		ast_json_array_get(ast_json_object_get(uut, "list"), 1)));
+
+	/* A value kept after the rest is released keeps the arena. */
+	kept = ast_json_ref(ast_json_object_get(uut, "name"));
+	ast_json_unref(uut);
+	uut = NULL;
+	ast_test_validate(test, 0 != alloc_count);
+	ast_test_validate(test, 0 == strcmp("arena", ast_json_string_get(kept)));
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(json_test_false);
@@ -1752,6 +1801,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(json_test_name_number);
 	AST_TEST_UNREGISTER(json_test_timeval);
 	AST_TEST_UNREGISTER(json_test_cep);
+	AST_TEST_UNREGISTER(json_test_arena);
 	return 0;
 }
 
@@ -1808,6 +1858,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(json_test_name_number);
 	AST_TEST_REGISTER(json_test_timeval);
 	AST_TEST_REGISTER(json_test_cep);
+	AST_TEST_REGISTER(json_test_arena);
 
 	ast_test_register_init(CATEGORY, json_test_init);
 	ast_test_register_cleanup(CATEGORY, json_test_cleanup);
@@ -380,6 +380,52 @@ AST_TEST_DEFINE(create_update_metadata)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(prefetch_nominal)
+{
+	int res;
+	int i;
+	char file_path[PATH_MAX];
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = CATEGORY;
+		info->summary = "Test nominal prefetching of a resource";
+		info->description =
+			"This test prefetches a resource and verifies that it "
+			"appears in the media cache without being retrieved.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_media_cache_delete(VALID_RESOURCE);
+
+	res = ast_media_cache_prefetch(VALID_RESOURCE);
+	ast_test_validate(test, res == 0);
+
+	/* The metadata is only found once the item is in the cache */
+	for (i = 0; i < 100; i++) {
+		res = ast_media_cache_retrieve_metadata(VALID_RESOURCE, "accessed",
+			file_path, sizeof(file_path));
+		if (!res) {
+			break;
+		}
+		usleep(10000);
+	}
+	ast_test_validate(test, res == 0);
+
+	res = ast_media_cache_prefetch(INVALID_SCHEME);
+	ast_test_validate(test, res == 0);
+
+	res = ast_media_cache_prefetch(NULL);
+	ast_test_validate(test, res == -1);
+
+	ast_media_cache_delete(VALID_RESOURCE);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(exists_nominal);
@@ -389,6 +435,8 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(create_update_metadata);
 	AST_TEST_UNREGISTER(create_update_off_nominal);
 
+	AST_TEST_UNREGISTER(prefetch_nominal);
+
 	return 0;
 }
 
@@ -407,6 +455,8 @@ static int load_module(void)
 	AST_TEST_REGISTER(create_update_metadata);
 	AST_TEST_REGISTER(create_update_off_nominal);
 
+	AST_TEST_REGISTER(prefetch_nominal);
+
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
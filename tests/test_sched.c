@@ -104,26 +104,15 @@ static int sched_order_8_cb(const void *data)
 	return 0;
 }
 
-AST_TEST_DEFINE(sched_test_order)
+/*! \brief Run the ordering checks against a scheduler context using \a backend */
+static enum ast_test_result_state sched_test_order_backend(struct ast_test *test,
+	enum ast_sched_backend backend)
 {
 	struct ast_sched_context *con;
 	enum ast_test_result_state res = AST_TEST_FAIL;
 	int id1, id2, id3, wait;
 
-	switch (cmd) {
-	case TEST_INIT:
-		info->name = "sched_test_order";
-		info->category = "/main/sched/";
-		info->summary = "Test ordering of events in the scheduler API";
-		info->description =
-			"This test ensures that events are properly ordered by the "
-			"time they are scheduled to execute in the scheduler API.";
-		return AST_TEST_NOT_RUN;
-	case TEST_EXECUTE:
-		break;
-	}
-
-	if (!(con = ast_sched_context_create())) {
+	if (!(con = ast_sched_context_create_backend(backend))) {
 		ast_test_status_update(test,
 				"Test failed - could not create scheduler context\n");
 		return AST_TEST_FAIL;
@@ -262,6 +251,122 @@ return_cleanup:
 	return res;
 }
 
+AST_TEST_DEFINE(sched_test_order)
+{
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_order";
+		info->category = "/main/sched/";
+		info->summary = "Test ordering of events in the scheduler API";
+		info->description =
+			"This test ensures that events are properly ordered by the "
+			"time they are scheduled to execute in the scheduler API, "
+			"with both the heap and the timer wheel backends.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (sched_test_order_backend(test, AST_SCHED_BACKEND_HEAP) != AST_TEST_PASS) {
+		return AST_TEST_FAIL;
+	}
+	ast_test_status_update(test, "Checking the timer wheel backend\n");
+	return sched_test_order_backend(test, AST_SCHED_BACKEND_WHEEL);
+}
+
+/*! Pending timers held by the benchmark test */
+#define SCHED_BENCH_TIMERS 100000
+
+/*!
+ * \brief Time adding, running, and deleting many pending timers on one backend
+ *
+ * \retval 0 on success
+ * \retval -1 on failure
+ */
+static int sched_test_bench_backend(struct ast_test *test, enum ast_sched_backend backend,
+	const char *name, int *sched_ids)
+{
+	struct ast_sched_context *con;
+	struct timeval start;
+	int64_t add_us, run_us;
+	int i;
+	int res = -1;
+
+	if (!(con = ast_sched_context_create_backend(backend))) {
+		ast_test_status_update(test, "Could not create a %s scheduler context\n", name);
+		return -1;
+	}
+
+	/* Timers between 10 seconds and 10 minutes out, like retransmissions and qualifies. */
+	start = ast_tvnow();
+	for (i = 0; i < SCHED_BENCH_TIMERS; i++) {
+		if ((sched_ids[i] = ast_sched_add(con, 10000 + labs(ast_random()) % 590000, sched_cb, NULL)) == -1) {
+			ast_test_status_update(test, "%s: ast_sched_add() failed\n", name);
+			goto cleanup;
+		}
+	}
+	add_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (i = 0; i < 1000; i++) {
+		if (ast_sched_runq(con) || ast_sched_wait(con) < 9000) {
+			ast_test_status_update(test, "%s: a timer ran early\n", name);
+			goto cleanup;
+		}
+	}
+	run_us = ast_tvdiff_us(ast_tvnow(), start);
+
+	start = ast_tvnow();
+	for (i = SCHED_BENCH_TIMERS - 1; i >= 0; i--) {
+		if (ast_sched_del(con, sched_ids[i])) {
+			ast_test_status_update(test, "%s: ast_sched_del() failed\n", name);
+			goto cleanup;
+		}
+	}
+	ast_test_status_update(test, "%s: %d adds %" PRIi64 " us, 1000 idle runs %" PRIi64
+		" us, %d deletes %" PRIi64 " us\n", name, SCHED_BENCH_TIMERS, add_us, run_us,
+		SCHED_BENCH_TIMERS, ast_tvdiff_us(ast_tvnow(), start));
+
+	if (ast_sched_wait(con) != -1) {
+		ast_test_status_update(test, "%s: timers left after deleting them all\n", name);
+		goto cleanup;
+	}
+	res = 0;
+
+cleanup:
+	ast_sched_context_destroy(con);
+	return res;
+}
+
+AST_TEST_DEFINE(sched_test_bench)
+{
+	int *sched_ids;
+	int res;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "sched_test_bench";
+		info->category = "/main/sched/";
+		info->summary = "Benchmark the scheduler backends with many pending timers";
+		info->description =
+			"Adds 100000 pending timers to a scheduler context using each backend,\n"
+			"runs the idle queue, deletes them again, and reports how long each\n"
+			"step took.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(sched_ids = ast_malloc(sizeof(*sched_ids) * SCHED_BENCH_TIMERS))) {
+		return AST_TEST_FAIL;
+	}
+	res = sched_test_bench_backend(test, AST_SCHED_BACKEND_HEAP, "heap", sched_ids)
+		|| sched_test_bench_backend(test, AST_SCHED_BACKEND_WHEEL, "wheel", sched_ids);
+	ast_free(sched_ids);
+
+	return res ? AST_TEST_FAIL : AST_TEST_PASS;
+}
+
 static char *handle_cli_sched_bench(struct ast_cli_entry *e, int cmd, struct ast_cli_args *a)
 {
 	struct ast_sched_context *con;
@@ -343,6 +448,7 @@ static struct ast_cli_entry cli_sched[] = {
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(sched_test_order);
+	AST_TEST_UNREGISTER(sched_test_bench);
 	ast_cli_unregister_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return 0;
 }
@@ -350,6 +456,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(sched_test_order);
+	AST_TEST_REGISTER(sched_test_bench);
 	ast_cli_register_multiple(cli_sched, ARRAY_LEN(cli_sched));
 	return AST_MODULE_LOAD_SUCCESS;
 }
@@ -1748,6 +1748,86 @@ AST_TEST_DEFINE(object_create)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(object_create_multiple)
+{
+	RAII_VAR(struct ast_sorcery *, sorcery, NULL, ast_sorcery_unref);
+	RAII_VAR(struct ao2_container *, objects, NULL, ao2_cleanup);
+	RAII_VAR(struct test_sorcery_object *, obj, NULL, ao2_cleanup);
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "object_create_multiple";
+		info->category = "/main/sorcery/";
+		info->summary = "sorcery multiple object creation unit test";
+		info->description =
+			"Test creating multiple objects at once in sorcery";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(sorcery = alloc_and_initialize_sorcery())) {
+		ast_test_status_update(test, "Failed to open sorcery structure\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(objects = ao2_container_alloc_list(AO2_ALLOC_OPT_LOCK_NOLOCK, 0, NULL, NULL))) {
+		ast_test_status_update(test, "Failed to allocate a container for the objects\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah")) || ao2_link(objects, obj)) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+	ao2_cleanup(obj);
+
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah2")) || ao2_link(objects, obj)) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+	ao2_cleanup(obj);
+	obj = NULL;
+
+	if (ast_sorcery_create_multiple(sorcery, objects)) {
+		ast_test_status_update(test, "Failed to create objects using in-memory wizard\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj = ast_sorcery_retrieve_by_id(sorcery, "test", "blah2"))) {
+		ast_test_status_update(test, "Failed to retrieve an object created with others\n");
+		return AST_TEST_FAIL;
+	}
+	ao2_cleanup(obj);
+
+	/* Creating an object that already exists fails the objects created with it */
+	ao2_callback(objects, OBJ_UNLINK | OBJ_NODATA | OBJ_MULTIPLE, NULL, NULL);
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah3")) || ao2_link(objects, obj)) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+	ao2_cleanup(obj);
+
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah")) || ao2_link(objects, obj)) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+	ao2_cleanup(obj);
+	obj = NULL;
+
+	if (!ast_sorcery_create_multiple(sorcery, objects)) {
+		ast_test_status_update(test, "Created objects when one of them already exists\n");
+		return AST_TEST_FAIL;
+	}
+
+	if ((obj = ast_sorcery_retrieve_by_id(sorcery, "test", "blah3"))) {
+		ast_test_status_update(test, "Object created with one that already exists was not removed\n");
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(object_retrieve_id)
 {
 	RAII_VAR(struct ast_sorcery *, sorcery, NULL, ast_sorcery_unref);
@@ -2114,6 +2194,70 @@ AST_TEST_DEFINE(object_update)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(object_update_fields)
+{
+	RAII_VAR(struct ast_sorcery *, sorcery, NULL, ast_sorcery_unref);
+	RAII_VAR(struct test_sorcery_object *, obj, NULL, ao2_cleanup);
+	RAII_VAR(struct test_sorcery_object *, obj2, NULL, ao2_cleanup);
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "object_update_fields";
+		info->category = "/main/sorcery/";
+		info->summary = "sorcery object partial update unit test";
+		info->description =
+			"Test updating only some fields of an object in sorcery";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(sorcery = alloc_and_initialize_sorcery())) {
+		ast_test_status_update(test, "Failed to open sorcery structure\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah"))) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_sorcery_create(sorcery, obj)) {
+		ast_test_status_update(test, "Failed to create object using in-memory wizard\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj2 = ast_sorcery_copy(sorcery, obj))) {
+		ast_test_status_update(test, "Failed to allocate a known object type for updating\n");
+		return AST_TEST_FAIL;
+	}
+
+	ao2_cleanup(obj);
+	obj = NULL;
+
+	obj2->bob = 42;
+
+	if (!ast_sorcery_update_fields(sorcery, obj2, "bob", "nobody", SENTINEL)) {
+		ast_test_status_update(test, "Updated an object with a field that does not exist\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_sorcery_update_fields(sorcery, obj2, "bob", SENTINEL)) {
+		ast_test_status_update(test, "Failed to update sorcery with new object\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj = ast_sorcery_retrieve_by_id(sorcery, "test", "blah"))) {
+		ast_test_status_update(test, "Failed to retrieve properly updated object\n");
+		return AST_TEST_FAIL;
+	} else if (obj != obj2 || obj->bob != 42) {
+		ast_test_status_update(test, "Object retrieved is not the updated object\n");
+		return AST_TEST_FAIL;
+	}
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(object_update_uncreated)
 {
 	RAII_VAR(struct ast_sorcery *, sorcery, NULL, ast_sorcery_unref);
@@ -2567,6 +2711,97 @@ end:
 	return res;
 }
 
+/*! \brief Wait for an observer notification to set one of the observer fields */
+static int wait_for_observer(const void **field)
+{
+	int notified;
+
+	ast_mutex_lock(&observer.lock);
+	while (!*field) {
+		struct timeval start = ast_tvnow();
+		struct timespec end = {
+			.tv_sec = start.tv_sec + 10,
+			.tv_nsec = start.tv_usec * 1000,
+		};
+		if (ast_cond_timedwait(&observer.cond, &observer.lock, &end) == ETIMEDOUT) {
+			break;
+		}
+	}
+	notified = *field ? 1 : 0;
+	ast_mutex_unlock(&observer.lock);
+
+	return notified;
+}
+
+AST_TEST_DEFINE(object_type_observer_notify)
+{
+	RAII_VAR(struct ast_sorcery *, sorcery, NULL, ast_sorcery_unref);
+	RAII_VAR(struct test_sorcery_object *, obj, NULL, ao2_cleanup);
+	int res = AST_TEST_FAIL;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "object_type_observer_notify";
+		info->category = "/main/sorcery/";
+		info->summary = "sorcery wizard originated observer notification unit test";
+		info->description =
+			"Test that object type observers get called for changes a wizard reports itself";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	if (!(sorcery = alloc_and_initialize_sorcery())) {
+		ast_test_status_update(test, "Failed to open sorcery structure\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_sorcery_observer_add(sorcery, "test", &test_observer)) {
+		ast_test_status_update(test, "Failed to add a proper observer\n");
+		return AST_TEST_FAIL;
+	}
+
+	if (!(obj = ast_sorcery_alloc(sorcery, "test", "blah"))) {
+		ast_test_status_update(test, "Failed to allocate a known object type\n");
+		return AST_TEST_FAIL;
+	}
+
+	ast_mutex_init(&observer.lock);
+	ast_cond_init(&observer.cond, NULL);
+	observer.created = NULL;
+	observer.updated = NULL;
+	observer.deleted = NULL;
+
+	ast_sorcery_notify_created(sorcery, obj);
+	if (!wait_for_observer(&observer.created) || observer.created != obj) {
+		ast_test_status_update(test, "Failed to receive observer notification for object creation within suitable timeframe\n");
+		goto end;
+	}
+
+	ast_sorcery_notify_updated(sorcery, obj);
+	if (!wait_for_observer(&observer.updated) || observer.updated != obj) {
+		ast_test_status_update(test, "Failed to receive observer notification for object updating within suitable timeframe\n");
+		goto end;
+	}
+
+	ast_sorcery_notify_deleted(sorcery, obj);
+	if (!wait_for_observer(&observer.deleted) || observer.deleted != obj) {
+		ast_test_status_update(test, "Failed to receive observer notification for object deletion within suitable timeframe\n");
+		goto end;
+	}
+
+	res = AST_TEST_PASS;
+
+end:
+	observer.created = NULL;
+	observer.updated = NULL;
+	observer.deleted = NULL;
+	ast_mutex_destroy(&observer.lock);
+	ast_cond_destroy(&observer.cond);
+
+	return res;
+}
+
 AST_TEST_DEFINE(configuration_file_wizard)
 {
 	struct ast_flags flags = { CONFIG_FLAG_NOCACHE };
@@ -3582,18 +3817,21 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(changeset_create);
 	AST_TEST_UNREGISTER(changeset_create_unchanged);
 	AST_TEST_UNREGISTER(object_create);
+AST_TEST_UNREGISTER(object_create_multiple);
 	AST_TEST_UNREGISTER(object_retrieve_id);
 	AST_TEST_UNREGISTER(object_retrieve_field);
 	AST_TEST_UNREGISTER(object_retrieve_multiple_all);
 	AST_TEST_UNREGISTER(object_retrieve_multiple_field);
 	AST_TEST_UNREGISTER(object_retrieve_regex);
 	AST_TEST_UNREGISTER(object_update);
+AST_TEST_UNREGISTER(object_update_fields);
 	AST_TEST_UNREGISTER(object_update_uncreated);
 	AST_TEST_UNREGISTER(object_delete);
 	AST_TEST_UNREGISTER(object_delete_uncreated);
 	AST_TEST_UNREGISTER(object_is_stale);
 	AST_TEST_UNREGISTER(caching_wizard_behavior);
 	AST_TEST_UNREGISTER(object_type_observer);
+	AST_TEST_UNREGISTER(object_type_observer_notify);
 	AST_TEST_UNREGISTER(configuration_file_wizard);
 	AST_TEST_UNREGISTER(configuration_file_wizard_with_file_integrity);
 	AST_TEST_UNREGISTER(configuration_file_wizard_with_criteria);
@@ -3639,18 +3877,21 @@ static int load_module(void)
 	AST_TEST_REGISTER(changeset_create);
 	AST_TEST_REGISTER(changeset_create_unchanged);
 	AST_TEST_REGISTER(object_create);
+AST_TEST_REGISTER(object_create_multiple);
 	AST_TEST_REGISTER(object_retrieve_id);
 	AST_TEST_REGISTER(object_retrieve_field);
 	AST_TEST_REGISTER(object_retrieve_multiple_all);
 	AST_TEST_REGISTER(object_retrieve_multiple_field);
 	AST_TEST_REGISTER(object_retrieve_regex);
 	AST_TEST_REGISTER(object_update);
+AST_TEST_REGISTER(object_update_fields);
 	AST_TEST_REGISTER(object_update_uncreated);
 	AST_TEST_REGISTER(object_delete);
 	AST_TEST_REGISTER(object_delete_uncreated);
 	AST_TEST_REGISTER(object_is_stale);
 	AST_TEST_REGISTER(caching_wizard_behavior);
 	AST_TEST_REGISTER(object_type_observer);
+	AST_TEST_REGISTER(object_type_observer_notify);
 	AST_TEST_REGISTER(configuration_file_wizard);
 	AST_TEST_REGISTER(configuration_file_wizard_with_file_integrity);
 	AST_TEST_REGISTER(configuration_file_wizard_with_criteria);
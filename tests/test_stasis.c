@@ -462,6 +462,75 @@ AST_TEST_DEFINE(publish)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(publish_filtered)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_subscription *, uut, NULL, stasis_unsubscribe);
+	RAII_VAR(char *, test_data1, NULL, ao2_cleanup);
+	RAII_VAR(char *, test_data2, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type1, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type2, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message1, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message2, NULL, ao2_cleanup);
+	RAII_VAR(struct consumer *, consumer, NULL, ao2_cleanup);
+	int actual_len;
+	const char *actual;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test publishing to a subscription with a message type filter";
+		info->description = "Test that declined message types are not delivered,\n"
+			"while accepted types and the final message are";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate(test, NULL != topic);
+
+	consumer = consumer_create(1);
+	ast_test_validate(test, NULL != consumer);
+
+	uut = stasis_subscribe(topic, consumer_exec, consumer);
+	ast_test_validate(test, NULL != uut);
+	ao2_ref(consumer, +1);
+
+	ast_test_validate(test, stasis_message_type_create("TestMessage1", NULL, &test_message_type1) == STASIS_MESSAGE_TYPE_SUCCESS);
+	ast_test_validate(test, stasis_message_type_create("TestMessage2", NULL, &test_message_type2) == STASIS_MESSAGE_TYPE_SUCCESS);
+	ast_test_validate(test, stasis_message_type_id(test_message_type1) != stasis_message_type_id(test_message_type2));
+
+	ast_test_validate(test, 0 == stasis_subscription_accept_message_type(uut, test_message_type2));
+	ast_test_validate(test, 0 == stasis_subscription_set_filter(uut, STASIS_SUBSCRIPTION_FILTER_SELECTIVE));
+
+	test_data1 = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data1);
+	test_message1 = stasis_message_create(test_message_type1, test_data1);
+	test_data2 = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data2);
+	test_message2 = stasis_message_create(test_message_type2, test_data2);
+
+	stasis_publish(topic, test_message1);
+	stasis_publish(topic, test_message2);
+
+	actual_len = consumer_wait_for(consumer, 1);
+	ast_test_validate(test, 1 == actual_len);
+	actual = stasis_message_data(consumer->messages_rxed[0]);
+	ast_test_validate(test, test_data2 == actual);
+
+	/* Once declined, the type is dropped again */
+	ast_test_validate(test, 0 == stasis_subscription_decline_message_type(uut, test_message_type2));
+	stasis_publish(topic, test_message2);
+
+	uut = stasis_unsubscribe(uut);
+	ast_test_validate(test, 1 == consumer_wait_for_completion(consumer));
+	ast_test_validate(test, 1 == consumer->messages_rxed_len);
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(publish_sync)
 {
 	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
@@ -1236,6 +1305,104 @@ AST_TEST_DEFINE(cache_dump)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(cache_snapshots)
+{
+	RAII_VAR(struct stasis_message_type *, cache_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_cache *, cache, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_caching_topic *, caching_topic, NULL, stasis_caching_unsubscribe);
+	RAII_VAR(struct consumer *, consumer, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_subscription *, sub, NULL, stasis_unsubscribe);
+	RAII_VAR(struct stasis_message *, test_message1_1, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message2_1, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message1_clear, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_cache_snapshots *, snapshots, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_cache_snapshots *, shared, NULL, ao2_cleanup);
+	struct stasis_message *actual;
+	int actual_len;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test shared cache snapshots.";
+		info->description = "Test that the snapshots of a type are shared until the cache changes.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_validate(test, stasis_message_type_create("Cacheable", NULL, &cache_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	ast_test_validate(test, NULL != cache_type);
+	topic = stasis_topic_create("SomeTopic");
+	ast_test_validate(test, NULL != topic);
+	cache = stasis_cache_create(cache_test_data_id);
+	ast_test_validate(test, NULL != cache);
+	caching_topic = stasis_caching_topic_create(topic, cache);
+	ast_test_validate(test, NULL != caching_topic);
+	consumer = consumer_create(1);
+	ast_test_validate(test, NULL != consumer);
+	sub = stasis_subscribe(stasis_caching_get_topic(caching_topic), consumer_exec, consumer);
+	ast_test_validate(test, NULL != sub);
+	ao2_ref(consumer, +1);
+
+	/* Nothing cached yet */
+	snapshots = stasis_cache_snapshots(cache, cache_type);
+	ast_test_validate(test, NULL != snapshots);
+	ast_test_validate(test, 0 == stasis_cache_snapshots_count(snapshots));
+
+	test_message1_1 = cache_test_message_create(cache_type, "1", "1");
+	ast_test_validate(test, NULL != test_message1_1);
+	test_message2_1 = cache_test_message_create(cache_type, "2", "1");
+	ast_test_validate(test, NULL != test_message2_1);
+
+	stasis_publish(topic, test_message1_1);
+	stasis_publish(topic, test_message2_1);
+	actual_len = consumer_wait_for(consumer, 2);
+	ast_test_validate(test, 2 == actual_len);
+
+	/* The snapshots taken before the change are not affected by it */
+	ast_test_validate(test, 0 == stasis_cache_snapshots_count(snapshots));
+
+	ao2_cleanup(snapshots);
+	snapshots = stasis_cache_snapshots(cache, cache_type);
+	ast_test_validate(test, NULL != snapshots);
+	ast_test_validate(test, 2 == stasis_cache_snapshots_count(snapshots));
+	actual = stasis_cache_snapshots_get(snapshots, 0);
+	ast_test_validate(test, actual == test_message1_1 || actual == test_message2_1);
+	actual = stasis_cache_snapshots_get(snapshots, 1);
+	ast_test_validate(test, actual == test_message1_1 || actual == test_message2_1);
+	ast_test_validate(test, NULL == stasis_cache_snapshots_get(snapshots, 2));
+
+	/* Until the cache changes, everyone gets the same snapshots */
+	shared = stasis_cache_snapshots(cache, cache_type);
+	ast_test_validate(test, shared == snapshots);
+	ao2_cleanup(shared);
+	shared = NULL;
+
+	/* Other types are not mixed in */
+	shared = stasis_cache_snapshots(cache, stasis_subscription_change_type());
+	ast_test_validate(test, NULL != shared);
+	ast_test_validate(test, 0 == stasis_cache_snapshots_count(shared));
+	ao2_cleanup(shared);
+	shared = NULL;
+
+	test_message1_clear = stasis_cache_clear_create(test_message1_1);
+	ast_test_validate(test, NULL != test_message1_clear);
+	stasis_publish(topic, test_message1_clear);
+	actual_len = consumer_wait_for(consumer, 3);
+	ast_test_validate(test, 3 == actual_len);
+
+	shared = stasis_cache_snapshots(cache, cache_type);
+	ast_test_validate(test, NULL != shared);
+	ast_test_validate(test, shared != snapshots);
+	ast_test_validate(test, 1 == stasis_cache_snapshots_count(shared));
+	ast_test_validate(test, test_message2_1 == stasis_cache_snapshots_get(shared, 0));
+	ast_test_validate(test, 2 == stasis_cache_snapshots_count(snapshots));
+
+	return AST_TEST_PASS;
+}
+
 AST_TEST_DEFINE(cache_eid_aggregate)
 {
 	RAII_VAR(struct stasis_message_type *, cache_type, NULL, ao2_cleanup);
@@ -1953,6 +2120,51 @@ AST_TEST_DEFINE(to_ami)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(cached_renderings)
+{
+	RAII_VAR(struct stasis_message_type *, type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, uut, NULL, ao2_cleanup);
+	RAII_VAR(char *, data, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_manager_event_blob *, first_ami, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_manager_event_blob *, second_ami, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_json *, first_json, NULL, ast_json_unref);
+	RAII_VAR(struct ast_json *, second_json, NULL, ast_json_unref);
+	const char *expected_text = "SomeData";
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Test message renderings are kept on the message";
+		info->description = "Test that the AMI rendering of a message is shared\n"
+			"and that each consumer gets its own copy of the JSON rendering.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_validate(test, stasis_message_type_create("SomeMessage", &fake_vtable, &type) == STASIS_MESSAGE_TYPE_SUCCESS);
+
+	data = ao2_alloc(strlen(expected_text) + 1, NULL);
+	strcpy(data, expected_text);
+	uut = stasis_message_create(type, data);
+	ast_test_validate(test, NULL != uut);
+
+	first_ami = stasis_message_to_ami(uut);
+	second_ami = stasis_message_to_ami(uut);
+	ast_test_validate(test, NULL != first_ami);
+	ast_test_validate(test, first_ami == second_ami);
+
+	first_json = stasis_message_to_json(uut, NULL);
+	second_json = stasis_message_to_json(uut, NULL);
+	ast_test_validate(test, NULL != first_json);
+	ast_test_validate(test, NULL != second_json);
+	ast_test_validate(test, first_json != second_json);
+	ast_test_validate(test, ast_json_equal(first_json, second_json));
+
+	return AST_TEST_PASS;
+}
+
 static void noop(void *data, struct stasis_subscription *sub,
 	struct stasis_message *message)
 {
@@ -2044,6 +2256,156 @@ AST_TEST_DEFINE(caching_dtor_order)
 	return AST_TEST_PASS;
 }
 
+/*! Total number of messages published in each publish_throughput run */
+#define THROUGHPUT_PUBLISHES 64000
+
+/*! Number of pool subscribers each publish_throughput message fans out to */
+#define THROUGHPUT_SUBSCRIBERS 4
+
+struct throughput_data {
+	ast_mutex_t lock;
+	ast_cond_t cond;
+	/*! Set once every publisher thread has been created */
+	int go;
+	/*! Number of messages each publisher thread publishes */
+	int publishes;
+	struct stasis_topic *topic;
+	struct stasis_message *message;
+};
+
+static void *throughput_publisher(void *obj)
+{
+	struct throughput_data *data = obj;
+	int i;
+
+	ast_mutex_lock(&data->lock);
+	while (!data->go) {
+		ast_cond_wait(&data->cond, &data->lock);
+	}
+	ast_mutex_unlock(&data->lock);
+
+	for (i = 0; i < data->publishes; ++i) {
+		stasis_publish(data->topic, data->message);
+	}
+
+	return NULL;
+}
+
+/*!
+ * \internal
+ * \brief Measure publishes per second with a number of concurrent publishers
+ *
+ * \return publishes per second
+ * \retval -1 on error
+ */
+static double throughput_run(struct ast_test *test, struct stasis_topic *topic,
+	struct stasis_message *message, int publishers)
+{
+	struct throughput_data data = {
+		.topic = topic,
+		.message = message,
+		.publishes = THROUGHPUT_PUBLISHES / publishers,
+	};
+	pthread_t *threads;
+	struct timeval start;
+	int64_t elapsed;
+	int created;
+
+	threads = ast_calloc(publishers, sizeof(*threads));
+	if (!threads) {
+		return -1;
+	}
+
+	ast_mutex_init(&data.lock);
+	ast_cond_init(&data.cond, NULL);
+
+	for (created = 0; created < publishers; ++created) {
+		if (ast_pthread_create(&threads[created], NULL, throughput_publisher, &data)) {
+			ast_test_status_update(test, "Failed to create publisher thread\n");
+			break;
+		}
+	}
+
+	ast_mutex_lock(&data.lock);
+	data.go = 1;
+	start = ast_tvnow();
+	ast_cond_broadcast(&data.cond);
+	ast_mutex_unlock(&data.lock);
+
+	while (created--) {
+		pthread_join(threads[created], NULL);
+	}
+	elapsed = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_mutex_destroy(&data.lock);
+	ast_cond_destroy(&data.cond);
+	ast_free(threads);
+
+	return (double) data.publishes * publishers * 1000000.0 / MAX(elapsed, 1);
+}
+
+AST_TEST_DEFINE(publish_throughput)
+{
+	RAII_VAR(struct stasis_topic *, topic, NULL, ao2_cleanup);
+	RAII_VAR(char *, test_data, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message_type *, test_message_type, NULL, ao2_cleanup);
+	RAII_VAR(struct stasis_message *, test_message, NULL, ao2_cleanup);
+	struct stasis_subscription *subs[THROUGHPUT_SUBSCRIBERS] = { NULL, };
+	static const int publishers[] = { 1, 8, 64 };
+	enum ast_test_result_state res = AST_TEST_PASS;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = test_category;
+		info->summary = "Benchmark concurrent publishing to a single topic";
+		info->description = "Publishes a fixed number of messages to a topic\n"
+			"with several threadpool subscribers, split across 1, 8 and 64\n"
+			"concurrent publisher threads, and reports the publishes/sec\n"
+			"achieved by each run.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	topic = stasis_topic_create("TestTopic");
+	ast_test_validate(test, NULL != topic);
+
+	test_data = ao2_alloc(1, NULL);
+	ast_test_validate(test, NULL != test_data);
+	ast_test_validate(test, stasis_message_type_create("TestMessage", NULL, &test_message_type) == STASIS_MESSAGE_TYPE_SUCCESS);
+	test_message = stasis_message_create(test_message_type, test_data);
+	ast_test_validate(test, NULL != test_message);
+
+	for (i = 0; i < ARRAY_LEN(subs); ++i) {
+		subs[i] = stasis_subscribe_pool(topic, noop, NULL);
+		if (!subs[i]) {
+			ast_test_status_update(test, "Failed to create subscription\n");
+			res = AST_TEST_FAIL;
+			goto done;
+		}
+	}
+
+	for (i = 0; i < ARRAY_LEN(publishers); ++i) {
+		double rate = throughput_run(test, topic, test_message, publishers[i]);
+
+		if (rate < 0) {
+			res = AST_TEST_FAIL;
+			goto done;
+		}
+		ast_test_status_update(test, "%2d publisher(s): %.0f publishes/sec\n",
+			publishers[i], rate);
+	}
+
+done:
+	for (i = 0; i < ARRAY_LEN(subs); ++i) {
+		stasis_unsubscribe_and_join(subs[i]);
+	}
+
+	return res;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(message_type);
@@ -2051,6 +2413,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(subscription_messages);
 	AST_TEST_UNREGISTER(subscription_pool_messages);
 	AST_TEST_UNREGISTER(publish);
+	AST_TEST_UNREGISTER(publish_filtered);
 	AST_TEST_UNREGISTER(publish_sync);
 	AST_TEST_UNREGISTER(publish_pool);
 	AST_TEST_UNREGISTER(unsubscribe_stops_messages);
@@ -2058,6 +2421,7 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(cache_filter);
 	AST_TEST_UNREGISTER(cache);
 	AST_TEST_UNREGISTER(cache_dump);
+	AST_TEST_UNREGISTER(cache_snapshots);
 	AST_TEST_UNREGISTER(cache_eid_aggregate);
 	AST_TEST_UNREGISTER(router);
 	AST_TEST_UNREGISTER(router_pool);
@@ -2068,8 +2432,10 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(to_json);
 	AST_TEST_UNREGISTER(no_to_ami);
 	AST_TEST_UNREGISTER(to_ami);
+	AST_TEST_UNREGISTER(cached_renderings);
 	AST_TEST_UNREGISTER(dtor_order);
 	AST_TEST_UNREGISTER(caching_dtor_order);
+	AST_TEST_UNREGISTER(publish_throughput);
 	return 0;
 }
 
@@ -2080,6 +2446,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(subscription_messages);
 	AST_TEST_REGISTER(subscription_pool_messages);
 	AST_TEST_REGISTER(publish);
+	AST_TEST_REGISTER(publish_filtered);
 	AST_TEST_REGISTER(publish_sync);
 	AST_TEST_REGISTER(publish_pool);
 	AST_TEST_REGISTER(unsubscribe_stops_messages);
@@ -2087,6 +2454,7 @@ static int load_module(void)
 	AST_TEST_REGISTER(cache_filter);
 	AST_TEST_REGISTER(cache);
 	AST_TEST_REGISTER(cache_dump);
+	AST_TEST_REGISTER(cache_snapshots);
 	AST_TEST_REGISTER(cache_eid_aggregate);
 	AST_TEST_REGISTER(router);
 	AST_TEST_REGISTER(router_pool);
@@ -2097,8 +2465,10 @@ static int load_module(void)
 	AST_TEST_REGISTER(to_json);
 	AST_TEST_REGISTER(no_to_ami);
 	AST_TEST_REGISTER(to_ami);
+	AST_TEST_REGISTER(cached_renderings);
 	AST_TEST_REGISTER(dtor_order);
 	AST_TEST_REGISTER(caching_dtor_order);
+	AST_TEST_REGISTER(publish_throughput);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
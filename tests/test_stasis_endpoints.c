@@ -209,6 +209,8 @@ AST_TEST_DEFINE(channel_messages)
 	RAII_VAR(struct ast_channel *, chan, NULL, ast_hangup);
 	RAII_VAR(struct stasis_message_sink *, sink, NULL, ao2_cleanup);
 	RAII_VAR(struct stasis_subscription *, sub, NULL, stasis_unsubscribe);
+	RAII_VAR(struct ast_endpoint_channel_ids *, channel_ids, NULL, ao2_cleanup);
+	RAII_VAR(struct ast_endpoint_channel_ids *, shared_ids, NULL, ao2_cleanup);
 	struct stasis_message *msg;
 	struct stasis_message_type *type;
 	struct ast_endpoint_snapshot *actual_snapshot;
@@ -252,6 +254,15 @@ AST_TEST_DEFINE(channel_messages)
 	actual_snapshot = stasis_message_data(msg);
 	ast_test_validate(test, 1 == actual_snapshot->num_channels);
 
+	channel_ids = ast_endpoint_snapshot_channel_ids(actual_snapshot);
+	ast_test_validate(test, NULL != channel_ids);
+	ast_test_validate(test, 1 == channel_ids->num_channels);
+	ast_test_validate(test, 0 == strcmp(ast_channel_uniqueid(chan), channel_ids->channel_ids[0]));
+
+	/* Until the channels change, the ids are shared */
+	shared_ids = ast_endpoint_snapshot_channel_ids(actual_snapshot);
+	ast_test_validate(test, channel_ids == shared_ids);
+
 	ast_hangup(chan);
 	chan = NULL;
 
@@ -284,6 +295,12 @@ AST_TEST_DEFINE(channel_messages)
 	actual_snapshot = stasis_message_data(msg);
 	ast_test_validate(test, 0 == actual_snapshot->num_channels);
 
+	ao2_cleanup(shared_ids);
+	shared_ids = ast_endpoint_snapshot_channel_ids(actual_snapshot);
+	ast_test_validate(test, NULL != shared_ids);
+	ast_test_validate(test, 0 == shared_ids->num_channels);
+	ast_test_validate(test, 1 == channel_ids->num_channels);
+
 	return AST_TEST_PASS;
 }
 
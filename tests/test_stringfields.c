@@ -33,6 +33,7 @@
 
 #include "asterisk.h"
 #include "asterisk/module.h"
+#include "asterisk/arena.h"
 #include "asterisk/stringfields.h"
 #include "asterisk/cli.h"
 #include "asterisk/utils.h"
@@ -513,8 +514,90 @@ error:
 	return res;
 }
 
+AST_TEST_DEFINE(string_field_arena_test)
+{
+	enum ast_test_result_state res = AST_TEST_PASS;
+	static const char LONG_STRING[] = "A professional panoramic photograph of the majestic elephant bathing itself and its young by the shores of the raging Mississippi River";
+	struct ast_arena *arena;
+	struct test_struct *inst;
+	struct ast_string_field_pool *pool;
+	char *scratch;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "string_field_arena_test";
+		info->category = "/main/utils/";
+		info->summary = "Test stringfields carved from an arena";
+		info->description =
+			"This tests string field pools allocated from and released to an arena";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	arena = ast_arena_create(256);
+	inst = ast_calloc(1, sizeof(*inst));
+	if (!arena || !inst) {
+		ast_test_status_update(test, "Unable to allocate test arena or structure\n");
+		ast_free(inst);
+		ast_arena_destroy(arena);
+		return AST_TEST_FAIL;
+	}
+
+	if (ast_string_field_init_arena(inst, 32, arena)) {
+		ast_test_status_update(test, "Unable to initialize string fields from the arena\n");
+		ast_free(inst);
+		ast_arena_destroy(arena);
+		return AST_TEST_FAIL;
+	}
+	pool = inst->__field_mgr_pool;
+
+	/* Too long for the first pool, a second one is carved from the arena. */
+	ast_string_field_build(inst, string1, "%s%s", LONG_STRING, LONG_STRING);
+	if (strncmp(inst->string1, LONG_STRING, sizeof(LONG_STRING) - 1)
+		|| strcmp(inst->string1 + sizeof(LONG_STRING) - 1, LONG_STRING)) {
+		ast_test_status_update(test, "Field from the arena has the wrong value '%s'\n", inst->string1);
+		res = AST_TEST_FAIL;
+	}
+	if (inst->__field_mgr_pool == pool || inst->__field_mgr_pool->prev != pool) {
+		ast_test_status_update(test, "Long field did not get a new pool\n");
+		res = AST_TEST_FAIL;
+	}
+
+	ast_string_field_free_memory(inst);
+	if (ast_string_field_init_arena(inst, 32, arena)) {
+		ast_test_status_update(test, "Unable to reinitialize string fields from the arena\n");
+		ast_free(inst);
+		ast_arena_destroy(arena);
+		return AST_TEST_FAIL;
+	}
+	if (inst->__field_mgr_pool != pool) {
+		ast_test_status_update(test, "Released pool was not reused by the arena\n");
+		res = AST_TEST_FAIL;
+	}
+
+	/* Enough scratch memory to need more chunks, all of it zeroed. */
+	for (i = 0; i < 16; ++i) {
+		scratch = ast_arena_calloc(arena, 100);
+		if (!scratch || scratch[0] || scratch[99]) {
+			ast_test_status_update(test, "Scratch allocation %d from the arena failed\n", i);
+			res = AST_TEST_FAIL;
+			break;
+		}
+		memset(scratch, 'x', 100);
+	}
+
+	ast_string_field_free_memory(inst);
+	ast_free(inst);
+	ast_arena_destroy(arena);
+
+	return res;
+}
+
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(string_field_arena_test);
 	AST_TEST_UNREGISTER(string_field_aggregate_test);
 	AST_TEST_UNREGISTER(string_field_test);
 	return 0;
@@ -524,6 +607,7 @@ static int load_module(void)
 {
 	AST_TEST_REGISTER(string_field_test);
 	AST_TEST_REGISTER(string_field_aggregate_test);
+	AST_TEST_REGISTER(string_field_arena_test);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
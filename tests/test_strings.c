@@ -34,10 +34,13 @@
 
 #include "asterisk.h"
 
+#include <math.h>
+
 #include "asterisk/test.h"
 #include "asterisk/utils.h"
 #include "asterisk/strings.h"
 #include "asterisk/module.h"
+#include "asterisk/time.h"
 
 AST_TEST_DEFINE(str_test)
 {
@@ -583,6 +586,222 @@ AST_TEST_DEFINE(strings_match)
 	return AST_TEST_PASS;
 }
 
+AST_TEST_DEFINE(hash_fast_test)
+{
+	static const char * const strs[] = {
+		"", "a", "ab", "abc", "abcd", "abcde", "abcdefgh", "abcdefghi",
+		"abcdefghijklmnop", "abcdefghijklmnopq",
+		"PJSIP/alice-00000001", "PJSIP/alice-00000002", "PJSIP/alice-00000010",
+	};
+	char buf[64];
+	char *pos;
+	int i;
+	int j;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "hash_fast";
+		info->category = "/main/strings/";
+		info->summary = "Test ast_str_hash_fast and ast_str_case_hash_fast";
+		info->description =
+			"Checks that the word at a time hashes agree with themselves,\n"
+			"ignore case only in the case-insensitive variant and tell\n"
+			"similar strings of every tail length apart.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(strs); i++) {
+		ast_test_validate(test, ast_str_hash_fast(strs[i]) >= 0);
+		ast_test_validate(test, ast_str_hash_fast(strs[i])
+			== ast_str_hash_fast_len(strs[i], strlen(strs[i]), 0));
+		for (j = 0; j < i; j++) {
+			ast_test_validate(test, ast_str_hash_fast(strs[i]) != ast_str_hash_fast(strs[j]));
+		}
+
+		ast_copy_string(buf, strs[i], sizeof(buf));
+		for (pos = buf; *pos; pos++) {
+			*pos = toupper(*pos);
+		}
+		ast_test_validate(test, ast_str_case_hash_fast(buf) == ast_str_case_hash_fast(strs[i]));
+		if (strcmp(buf, strs[i])) {
+			ast_test_validate(test, ast_str_hash_fast(buf) != ast_str_hash_fast(strs[i]));
+		}
+	}
+
+	/* Only ASCII letters are folded, so '@' and '`' still differ */
+	ast_test_validate(test, ast_str_case_hash_fast("a@[") != ast_str_case_hash_fast("a`{"));
+
+	/* Hashing more strings on top of a hash depends on every one of them */
+	ast_test_validate(test, ast_str_hash_fast_len("ab", 2, ast_str_hash_fast("c"))
+		!= ast_str_hash_fast_len("c", 1, ast_str_hash_fast("ab")));
+
+	return AST_TEST_PASS;
+}
+
+/*! \brief Number of keys hashed into buckets and for the benchmark */
+#define HASH_KEY_COUNT 100000
+
+/*!
+ * \internal
+ * \brief Chi-squared statistic of how keys fall into buckets
+ *
+ * With a good hash it is close to the number of buckets less one.
+ */
+static double hash_chi_squared(int (*hash)(const char *str), const char *fmt, int buckets)
+{
+	unsigned int *counts = ast_calloc(buckets, sizeof(*counts));
+	double expected = (double) HASH_KEY_COUNT / buckets;
+	double chi = 0;
+	char key[64];
+	int i;
+
+	if (!counts) {
+		return -1;
+	}
+
+	for (i = 0; i < HASH_KEY_COUNT; i++) {
+		snprintf(key, sizeof(key), fmt, i);
+		counts[hash(key) % buckets]++;
+	}
+	for (i = 0; i < buckets; i++) {
+		chi += (counts[i] - expected) * (counts[i] - expected) / expected;
+	}
+
+	ast_free(counts);
+	return chi;
+}
+
+static int hash_djb(const char *str)
+{
+	return ast_str_hash(str);
+}
+
+static int hash_fast(const char *str)
+{
+	return ast_str_hash_fast(str);
+}
+
+static int hash_case_fast(const char *str)
+{
+	return ast_str_case_hash_fast(str);
+}
+
+AST_TEST_DEFINE(hash_distribution_test)
+{
+	/* Sequential keys like the containers hold, and bucket counts they use */
+	static const char * const fmts[] = {
+		"PJSIP/trunk-%08x", "Local/%d@default-00000001;1", "endpoint%d", "%d",
+	};
+	static const int buckets[] = { 17, 563, 1024, 4099 };
+	double chi;
+	double limit;
+	int i;
+	int j;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "hash_distribution";
+		info->category = "/main/strings/";
+		info->summary = "Test how evenly the fast string hashes fill buckets";
+		info->description =
+			"Hashes sequential keys into buckets and checks the chi-squared\n"
+			"statistic of the counts is within six standard deviations of what\n"
+			"a random hash gives.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(fmts); i++) {
+		for (j = 0; j < ARRAY_LEN(buckets); j++) {
+			limit = buckets[j] - 1 + 6 * sqrt(2.0 * (buckets[j] - 1));
+
+			chi = hash_chi_squared(hash_fast, fmts[i], buckets[j]);
+			ast_test_status_update(test, "'%s' into %d buckets: fast %.1f, djb %.1f, limit %.1f\n",
+				fmts[i], buckets[j], chi, hash_chi_squared(hash_djb, fmts[i], buckets[j]), limit);
+			ast_test_validate(test, 0 <= chi && chi < limit);
+
+			chi = hash_chi_squared(hash_case_fast, fmts[i], buckets[j]);
+			ast_test_validate(test, 0 <= chi && chi < limit);
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+/*! \brief Where the benchmark puts its hashes so they are not optimized away */
+static volatile unsigned int hash_sink;
+
+/*!
+ * \internal
+ * \brief Microseconds taken to hash every key a number of times
+ */
+static int64_t hash_time(int (*hash)(const char *str), char **keys, int rounds)
+{
+	struct timeval start = ast_tvnow();
+	unsigned int sum = 0;
+	int i;
+	int j;
+
+	for (j = 0; j < rounds; j++) {
+		for (i = 0; i < HASH_KEY_COUNT; i++) {
+			sum += hash(keys[i]);
+		}
+	}
+
+	hash_sink = sum;
+	return ast_tvdiff_us(ast_tvnow(), start);
+}
+
+AST_TEST_DEFINE(hash_benchmark)
+{
+	char **keys;
+	int64_t djb;
+	int64_t fast;
+	int64_t case_fast;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "hash_benchmark";
+		info->category = "/main/strings/";
+		info->summary = "String hash benchmark";
+		info->description =
+			"Reports how fast ast_str_hash, ast_str_hash_fast and\n"
+			"ast_str_case_hash_fast hash channel names.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	keys = ast_calloc(HASH_KEY_COUNT, sizeof(*keys));
+	ast_test_validate(test, NULL != keys);
+	for (i = 0; i < HASH_KEY_COUNT; i++) {
+		if (ast_asprintf(&keys[i], "PJSIP/trunk-provider-%08x", i) < 0) {
+			keys[i] = NULL;
+			break;
+		}
+	}
+
+	if (i == HASH_KEY_COUNT) {
+		djb = hash_time(hash_djb, keys, 10);
+		fast = hash_time(hash_fast, keys, 10);
+		case_fast = hash_time(hash_case_fast, keys, 10);
+		ast_test_status_update(test, "Hashed %d keys in %" PRId64 " us with ast_str_hash, "
+			"%" PRId64 " us with ast_str_hash_fast and %" PRId64 " us with ast_str_case_hash_fast\n",
+			HASH_KEY_COUNT * 10, djb, fast, case_fast);
+	}
+
+	for (i = 0; i < HASH_KEY_COUNT; i++) {
+		ast_free(keys[i]);
+	}
+	ast_free(keys);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
 	AST_TEST_UNREGISTER(str_test);
@@ -592,6 +811,9 @@ static int unload_module(void)
 	AST_TEST_UNREGISTER(escape_semicolons_test);
 	AST_TEST_UNREGISTER(escape_test);
 	AST_TEST_UNREGISTER(strings_match);
+	AST_TEST_UNREGISTER(hash_fast_test);
+	AST_TEST_UNREGISTER(hash_distribution_test);
+	AST_TEST_UNREGISTER(hash_benchmark);
 	return 0;
 }
 
@@ -604,6 +826,9 @@ static int load_module(void)
 	AST_TEST_REGISTER(escape_semicolons_test);
 	AST_TEST_REGISTER(escape_test);
 	AST_TEST_REGISTER(strings_match);
+	AST_TEST_REGISTER(hash_fast_test);
+	AST_TEST_REGISTER(hash_distribution_test);
+	AST_TEST_REGISTER(hash_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -1726,6 +1726,129 @@ end:
 	return res;
 }
 
+struct steal_spawner_data {
+	/*! The pool the local tasks are pushed to */
+	struct ast_threadpool *pool;
+	/*! Blocks the spawning task until poked */
+	struct complex_task_data *spawner;
+	/*! Tasks pushed by the spawning task */
+	struct complex_task_data *local1;
+	struct complex_task_data *local2;
+	/*! Set if either local task could not be pushed */
+	int push_failed;
+};
+
+static int steal_spawner_task(void *data)
+{
+	struct steal_spawner_data *ssd = data;
+
+	/* These are pushed from a worker thread, so they stay with this worker */
+	if (ast_threadpool_push(ssd->pool, complex_task, ssd->local1)
+		|| ast_threadpool_push(ssd->pool, complex_task, ssd->local2)) {
+		ssd->push_failed = 1;
+	}
+
+	/* Keep this worker busy. The local tasks can only run if stolen. */
+	return complex_task(ssd->spawner);
+}
+
+AST_TEST_DEFINE(threadpool_work_stealing)
+{
+	enum ast_test_result_state res = AST_TEST_FAIL;
+	struct ast_threadpool *pool = NULL;
+	struct steal_spawner_data ssd = { NULL, };
+	struct ast_threadpool_options options = {
+		.version = AST_THREADPOOL_OPTIONS_VERSION,
+		.idle_timeout = 0,
+		.auto_increment = 0,
+		.initial_size = 2,
+		.max_size = 0,
+		.work_stealing = 1,
+	};
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "threadpool_work_stealing";
+		info->category = "/main/threadpool/";
+		info->summary = "Test that idle workers steal tasks from busy ones";
+		info->description =
+			"A task running on a worker pushes two more tasks, which are\n"
+			"queued on that worker, and then blocks. Ensures that the other\n"
+			"worker steals and executes both queued tasks.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	pool = ast_threadpool_create(info->name, NULL, &options);
+	if (!pool) {
+		ast_test_status_update(test, "Could not create threadpool\n");
+		goto end;
+	}
+
+	ssd.pool = pool;
+	ssd.spawner = complex_task_data_alloc();
+	ssd.local1 = complex_task_data_alloc();
+	ssd.local2 = complex_task_data_alloc();
+	if (!ssd.spawner || !ssd.local1 || !ssd.local2) {
+		ast_test_status_update(test, "Allocation failed\n");
+		goto end;
+	}
+
+	if (ast_threadpool_push(pool, steal_spawner_task, &ssd)) {
+		ast_test_status_update(test, "Failed to enqueue spawning task\n");
+		goto end;
+	}
+	if (!wait_for_complex_start(ssd.spawner)) {
+		ast_test_status_update(test, "Spawning task did not start\n");
+		goto end;
+	}
+	if (ssd.push_failed) {
+		ast_test_status_update(test, "Failed to push worker local tasks\n");
+		goto end;
+	}
+
+	/* The spawning task's worker is stuck, so these must have been stolen */
+	if (!wait_for_complex_start(ssd.local1)) {
+		ast_test_status_update(test, "First local task was not stolen\n");
+		goto end;
+	}
+	poke_worker(ssd.local1);
+	if (wait_for_complex_completion(ssd.local1) != AST_TEST_PASS) {
+		ast_test_status_update(test, "First local task did not complete\n");
+		goto end;
+	}
+
+	if (!wait_for_complex_start(ssd.local2)) {
+		ast_test_status_update(test, "Second local task was not stolen\n");
+		goto end;
+	}
+	poke_worker(ssd.local2);
+	if (wait_for_complex_completion(ssd.local2) != AST_TEST_PASS) {
+		ast_test_status_update(test, "Second local task did not complete\n");
+		goto end;
+	}
+
+	poke_worker(ssd.spawner);
+	res = wait_for_complex_completion(ssd.spawner);
+
+end:
+	if (ssd.spawner) {
+		poke_worker(ssd.spawner);
+	}
+	if (ssd.local1) {
+		poke_worker(ssd.local1);
+	}
+	if (ssd.local2) {
+		poke_worker(ssd.local2);
+	}
+	ast_threadpool_shutdown(pool);
+	ast_free(ssd.spawner);
+	ast_free(ssd.local1);
+	ast_free(ssd.local2);
+	return res;
+}
+
 static int unload_module(void)
 {
 	ast_test_unregister(threadpool_push);
@@ -1744,6 +1867,7 @@ static int unload_module(void)
 	ast_test_unregister(threadpool_more_destruction);
 	ast_test_unregister(threadpool_serializer);
 	ast_test_unregister(threadpool_serializer_dupe);
+	ast_test_unregister(threadpool_work_stealing);
 	return 0;
 }
 
@@ -1765,6 +1889,7 @@ static int load_module(void)
 	ast_test_register(threadpool_more_destruction);
 	ast_test_register(threadpool_serializer);
 	ast_test_register(threadpool_serializer_dupe);
+	ast_test_register(threadpool_work_stealing);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
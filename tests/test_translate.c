@@ -0,0 +1,245 @@
+/*
+ * Asterisk -- An open source telephony toolkit.
+ *
+ * Copyright (C) 2017, Digium, Inc.
+ *
+ * See http://www.asterisk.org for more information about
+ * the Asterisk project. Please do not directly contact
+ * any of the maintainers of this project for assistance;
+ * the project provides a web site, mailing lists and IRC
+ * channels for your use.
+ *
+ * This program is free software, distributed under the terms of
+ * the GNU General Public License Version 2. See the LICENSE file
+ * at the top of the source tree.
+ */
+
+/*!
+ * \file
+ * \brief Translation path unit tests
+ */
+
+/*** MODULEINFO
+	<depend>TEST_FRAMEWORK</depend>
+	<support_level>core</support_level>
+ ***/
+
+#include "asterisk.h"
+
+#include "asterisk/test.h"
+#include "asterisk/module.h"
+#include "asterisk/translate.h"
+#include "asterisk/format_cache.h"
+#include "asterisk/frame.h"
+
+/*!
+ * \brief Send a frame of silence through a path
+ *
+ * \retval 0 if the path produced output
+ * \retval -1 otherwise
+ */
+static int test_translate_silence(struct ast_trans_pvt *path, struct ast_format *src)
+{
+	int16_t buf[320] = { 0, };
+	struct ast_frame f = {
+		.frametype = AST_FRAME_VOICE,
+		.subclass.format = src,
+		.data.ptr = buf,
+		.datalen = sizeof(buf),
+		.samples = ARRAY_LEN(buf),
+		.src = "test_translate",
+	};
+	struct ast_frame *out;
+
+	if (ast_format_get_sample_rate(src) == 8000) {
+		f.datalen = sizeof(buf) / 2;
+		f.samples = ARRAY_LEN(buf) / 2;
+	}
+
+	out = ast_translate(path, &f, 0);
+	if (!out) {
+		return -1;
+	}
+	ast_frfree(out);
+	return 0;
+}
+
+AST_TEST_DEFINE(translate_path_reuse)
+{
+	struct ast_format *srcs[] = { ast_format_slin, ast_format_slin16, };
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "path_reuse";
+		info->category = "/main/translate/";
+		info->summary = "Test reusing freed translation paths";
+		info->description =
+			"Builds, uses, and frees translation paths to ulaw, then checks that\n"
+			"building them again reuses the freed paths and that they still work.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(srcs); i++) {
+		struct ast_trans_pvt *first;
+		struct ast_trans_pvt *second;
+		int reused;
+
+		first = ast_translator_build_path(ast_format_ulaw, srcs[i]);
+		if (!first) {
+			ast_test_status_update(test, "No path from %s to ulaw, skipping it\n",
+				ast_format_get_name(srcs[i]));
+			continue;
+		}
+		if (test_translate_silence(first, srcs[i])) {
+			ast_test_status_update(test, "Path from %s to ulaw failed to translate\n",
+				ast_format_get_name(srcs[i]));
+			ast_translator_free_path(first);
+			return AST_TEST_FAIL;
+		}
+		ast_translator_free_path(first);
+
+		second = ast_translator_build_path(ast_format_ulaw, srcs[i]);
+		if (!second) {
+			ast_test_status_update(test, "Failed to build the path from %s to ulaw again\n",
+				ast_format_get_name(srcs[i]));
+			return AST_TEST_FAIL;
+		}
+		/* The pointer comparison is all that is done with the freed path. */
+		reused = second == first;
+		if (!reused || test_translate_silence(second, srcs[i])) {
+			ast_test_status_update(test, "Path from %s to ulaw was %s\n",
+				ast_format_get_name(srcs[i]), reused ? "not usable after reuse" : "not reused");
+			ast_translator_free_path(second);
+			return AST_TEST_FAIL;
+		}
+		ast_translator_free_path(second);
+	}
+
+	return AST_TEST_PASS;
+}
+
+/*! Frames in the batch translated by the batch test */
+#define TEST_BATCH_FRAMES 5
+
+AST_TEST_DEFINE(translate_list)
+{
+	struct ast_format *srcs[] = { ast_format_slin, ast_format_slin16, };
+	int16_t payloads[TEST_BATCH_FRAMES][320];
+	struct ast_frame frames[TEST_BATCH_FRAMES];
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "translate_list";
+		info->category = "/main/translate/";
+		info->summary = "Test translating a batch of frames";
+		info->description =
+			"Translates a list of frames to ulaw in one batch and checks the\n"
+			"result matches translating each of the frames on its own.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	for (i = 0; i < ARRAY_LEN(srcs); i++) {
+		struct ast_trans_pvt *batch_path;
+		struct ast_trans_pvt *single_path;
+		struct ast_frame *batch;
+		struct ast_frame *out;
+		int samples = ast_format_get_sample_rate(srcs[i]) / 50;
+		int j;
+		int res = 0;
+
+		batch_path = ast_translator_build_path(ast_format_ulaw, srcs[i]);
+		single_path = ast_translator_build_path(ast_format_ulaw, srcs[i]);
+		if (!batch_path || !single_path) {
+			ast_test_status_update(test, "No path from %s to ulaw, skipping it\n",
+				ast_format_get_name(srcs[i]));
+			if (batch_path) {
+				ast_translator_free_path(batch_path);
+			}
+			if (single_path) {
+				ast_translator_free_path(single_path);
+			}
+			continue;
+		}
+
+		memset(frames, 0, sizeof(frames));
+		for (j = 0; j < TEST_BATCH_FRAMES; j++) {
+			int k;
+
+			for (k = 0; k < samples; k++) {
+				payloads[j][k] = (k * 97 + j * 1009) % 16000 - 8000;
+			}
+			frames[j].frametype = AST_FRAME_VOICE;
+			frames[j].subclass.format = srcs[i];
+			frames[j].data.ptr = payloads[j];
+			frames[j].datalen = samples * 2;
+			frames[j].samples = samples;
+			frames[j].src = "test_translate";
+			if (j) {
+				AST_LIST_NEXT(&frames[j - 1], frame_list) = &frames[j];
+			}
+		}
+
+		batch = ast_translate_list(batch_path, &frames[0], 0);
+		for (j = 0, out = batch; j < TEST_BATCH_FRAMES; j++) {
+			struct ast_frame single = frames[j];
+			struct ast_frame *expected;
+
+			AST_LIST_NEXT(&single, frame_list) = NULL;
+			expected = ast_translate(single_path, &single, 0);
+			if (!expected) {
+				continue;
+			}
+			if (!out || out->datalen != expected->datalen || out->samples != expected->samples
+				|| memcmp(out->data.ptr, expected->data.ptr, out->datalen)) {
+				ast_test_status_update(test, "Frame %d of the batch from %s differs\n",
+					j, ast_format_get_name(srcs[i]));
+				res = -1;
+			}
+			ast_frfree(expected);
+			if (out) {
+				out = AST_LIST_NEXT(out, frame_list);
+			}
+			if (res) {
+				break;
+			}
+		}
+		if (!res && out) {
+			ast_test_status_update(test, "Batch from %s produced extra frames\n",
+				ast_format_get_name(srcs[i]));
+			res = -1;
+		}
+
+		if (batch) {
+			ast_frfree(batch);
+		}
+		ast_translator_free_path(batch_path);
+		ast_translator_free_path(single_path);
+		if (res) {
+			return AST_TEST_FAIL;
+		}
+	}
+
+	return AST_TEST_PASS;
+}
+
+static int unload_module(void)
+{
+	AST_TEST_UNREGISTER(translate_path_reuse);
+	AST_TEST_UNREGISTER(translate_list);
+	return 0;
+}
+
+static int load_module(void)
+{
+	AST_TEST_REGISTER(translate_path_reuse);
+	AST_TEST_REGISTER(translate_list);
+	return AST_MODULE_LOAD_SUCCESS;
+}
+
+AST_MODULE_INFO_STANDARD(ASTERISK_GPL_KEY, "Translation path test module");
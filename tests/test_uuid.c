@@ -29,6 +29,8 @@
 #include "asterisk/test.h"
 #include "asterisk/uuid.h"
 #include "asterisk/module.h"
+#include "asterisk/astobj2.h"
+#include "asterisk/time.h"
 
 AST_TEST_DEFINE(uuid)
 {
@@ -137,8 +139,67 @@ end:
 	return res;
 }
 
+/*! \brief Number of UUIDs the benchmark generates */
+#define UUID_BENCHMARK_COUNT 100000
+
+/*! \brief Number of UUIDs checked for duplicates */
+#define UUID_UNIQUE_COUNT 1000
+
+AST_TEST_DEFINE(uuid_benchmark)
+{
+	RAII_VAR(struct ao2_container *, seen, NULL, ao2_cleanup);
+	char uuid_str[AST_UUID_STR_LEN];
+	struct timeval start;
+	int64_t elapsed;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = "uuid_benchmark";
+		info->category = "/main/uuid/";
+		info->summary = "UUID generation benchmark";
+		info->description =
+			"Generates many UUIDs, checking that they are random (version 4) UUIDs\n"
+			"that do not repeat, and reports how fast they were generated.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	seen = ast_str_container_alloc(UUID_UNIQUE_COUNT / 2 + 1);
+	ast_test_validate(test, NULL != seen);
+
+	start = ast_tvnow();
+	for (i = 0; i < UUID_BENCHMARK_COUNT; ++i) {
+		ast_uuid_generate_str(uuid_str, sizeof(uuid_str));
+
+		if (i >= UUID_UNIQUE_COUNT) {
+			continue;
+		}
+
+		/* xxxxxxxx-xxxx-4xxx-[89ab]xxx-xxxxxxxxxxxx */
+		if (uuid_str[14] != '4' || !strchr("89ab", uuid_str[19])) {
+			ast_test_status_update(test, "UUID %s is not a random UUID\n", uuid_str);
+			return AST_TEST_FAIL;
+		}
+		if (ao2_find(seen, uuid_str, OBJ_SEARCH_KEY | OBJ_NODATA)) {
+			ast_test_status_update(test, "UUID %s was generated twice\n", uuid_str);
+			return AST_TEST_FAIL;
+		}
+		ast_test_validate(test, 0 == ast_str_container_add(seen, uuid_str));
+	}
+	elapsed = ast_tvdiff_us(ast_tvnow(), start);
+
+	ast_test_status_update(test, "Generated %d UUIDs in %" PRId64 " us, %.0f per second\n",
+		UUID_BENCHMARK_COUNT, elapsed,
+		elapsed ? UUID_BENCHMARK_COUNT * 1000000.0 / elapsed : 0.0);
+
+	return AST_TEST_PASS;
+}
+
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(uuid_benchmark);
 	AST_TEST_UNREGISTER(uuid);
 	return 0;
 }
@@ -146,6 +207,7 @@ static int unload_module(void)
 static int load_module(void)
 {
 	AST_TEST_REGISTER(uuid);
+	AST_TEST_REGISTER(uuid_benchmark);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
@@ -41,6 +41,11 @@
 #define CATEGORY "/res/websocket/"
 #define REMOTE_URL "ws://127.0.0.1:8088/ws"
 
+/*! Frames echoed by the throughput test in each mode */
+#define THROUGHPUT_FRAMES 2000
+/*! Payload size of the throughput test frames */
+#define THROUGHPUT_PAYLOAD_SIZE 1024
+
 AST_TEST_DEFINE(websocket_client_create_and_connect)
 {
 	RAII_VAR(struct ast_websocket *, client, NULL, ao2_cleanup);
@@ -138,17 +143,92 @@ AST_TEST_DEFINE(websocket_client_multiple_protocols)
 	return AST_TEST_PASS;
 }
 
+/*! \brief Read back the echo of a throughput test frame */
+static int throughput_read_echo(struct ast_websocket *client, const char *payload)
+{
+	char *read_buf = NULL;
+	int res;
+
+	res = ast_websocket_read_string(client, &read_buf) != THROUGHPUT_PAYLOAD_SIZE + 1
+		|| strcmp(read_buf, payload);
+	ast_free(read_buf);
+
+	return res ? -1 : 0;
+}
+
+AST_TEST_DEFINE(websocket_client_write_throughput)
+{
+	RAII_VAR(struct ast_websocket *, client, NULL, ao2_cleanup);
+	RAII_VAR(char *, payload, NULL, ao2_cleanup);
+	enum ast_websocket_result result;
+	struct timeval start;
+	int64_t direct_ms;
+	int64_t queued_ms;
+	int i;
+
+	switch (cmd) {
+	case TEST_INIT:
+		info->name = __func__;
+		info->category = CATEGORY;
+		info->summary = "websocket client - write throughput";
+		info->description = "Echoes frames written in place, one at a time, and\n"
+			"then frames written through a send queue from one shared\n"
+			"payload buffer, and reports the rate of each.";
+		return AST_TEST_NOT_RUN;
+	case TEST_EXECUTE:
+		break;
+	}
+
+	ast_test_validate(test, (client = ast_websocket_client_create(
+					 REMOTE_URL, "echo", NULL, &result)));
+
+	/* The payload is a string so the echo can be read back as one. */
+	ast_test_validate(test, (payload = ast_websocket_payload_alloc(THROUGHPUT_PAYLOAD_SIZE + 1)));
+	memset(payload, 'x', THROUGHPUT_PAYLOAD_SIZE);
+	payload[THROUGHPUT_PAYLOAD_SIZE] = '\0';
+
+	start = ast_tvnow();
+	for (i = 0; i < THROUGHPUT_FRAMES; ++i) {
+		ast_test_validate(test, !ast_websocket_write(client, AST_WEBSOCKET_OPCODE_TEXT,
+			payload, THROUGHPUT_PAYLOAD_SIZE));
+		ast_test_validate(test, !throughput_read_echo(client, payload));
+	}
+	direct_ms = MAX(ast_tvdiff_ms(ast_tvnow(), start), 1);
+
+	/* Queued writes return at once, so all of them go out before reading. */
+	ast_test_validate(test, !ast_websocket_set_send_queue(client,
+		THROUGHPUT_FRAMES * THROUGHPUT_PAYLOAD_SIZE, AST_WEBSOCKET_SEND_QUEUE_DISCONNECT));
+	start = ast_tvnow();
+	for (i = 0; i < THROUGHPUT_FRAMES; ++i) {
+		ast_test_validate(test, !ast_websocket_write_payload(client, AST_WEBSOCKET_OPCODE_TEXT,
+			payload, THROUGHPUT_PAYLOAD_SIZE));
+	}
+	for (i = 0; i < THROUGHPUT_FRAMES; ++i) {
+		ast_test_validate(test, !throughput_read_echo(client, payload));
+	}
+	queued_ms = MAX(ast_tvdiff_ms(ast_tvnow(), start), 1);
+
+	ast_test_status_update(test, "%d frames of %d bytes written in place: %" PRId64 " ms, %" PRId64 " frames/s\n",
+		THROUGHPUT_FRAMES, THROUGHPUT_PAYLOAD_SIZE, direct_ms, THROUGHPUT_FRAMES * 1000 / direct_ms);
+	ast_test_status_update(test, "%d frames of %d bytes queued: %" PRId64 " ms, %" PRId64 " frames/s\n",
+		THROUGHPUT_FRAMES, THROUGHPUT_PAYLOAD_SIZE, queued_ms, THROUGHPUT_FRAMES * 1000 / queued_ms);
+
+	return AST_TEST_PASS;
+}
+
 static int load_module(void)
 {
 	AST_TEST_REGISTER(websocket_client_create_and_connect);
 	AST_TEST_REGISTER(websocket_client_bad_url);
 	AST_TEST_REGISTER(websocket_client_unsupported_protocol);
 	AST_TEST_REGISTER(websocket_client_multiple_protocols);
+	AST_TEST_REGISTER(websocket_client_write_throughput);
 	return AST_MODULE_LOAD_SUCCESS;
 }
 
 static int unload_module(void)
 {
+	AST_TEST_UNREGISTER(websocket_client_write_throughput);
 	AST_TEST_UNREGISTER(websocket_client_multiple_protocols);
 	AST_TEST_UNREGISTER(websocket_client_unsupported_protocol);
 	AST_TEST_UNREGISTER(websocket_client_bad_url);